@@ -0,0 +1,91 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Timings from a results file written by a benchmark (e.g. hot-paths): a
+// header row followed by tab-separated rows, keyed by the first
+// ``num_key_columns`` columns, with the time in the column labelled "seconds".
+std::map<std::string, double> read_timings(const std::string & path, unsigned int num_key_columns, std::string & key_labels) {
+    std::ifstream src(path);
+    if (!src) {
+        std::cerr << "Unable to open: '" << path << "'" << std::endl;
+        std::exit(2);
+    }
+    auto split = [] (const std::string & line) {
+        std::vector<std::string> fields;
+        std::istringstream fields_src(line);
+        for (std::string field; std::getline(fields_src, field, '\t'); ) {
+            fields.push_back(field);
+        }
+        return fields;
+    };
+    std::string line;
+    std::getline(src, line);
+    auto header = split(line);
+    std::size_t seconds_idx = header.size();
+    for (std::size_t i = 0; i < header.size(); ++i) {
+        if (header[i] == "seconds") {
+            seconds_idx = i;
+        }
+    }
+    if (seconds_idx == header.size() || seconds_idx < num_key_columns) {
+        std::cerr << "No 'seconds' column after key columns in: '" << path << "'" << std::endl;
+        std::exit(2);
+    }
+    key_labels.clear();
+    for (unsigned int i = 0; i < num_key_columns; ++i) {
+        key_labels += (i > 0 ? "\t" : "") + header[i];
+    }
+    std::map<std::string, double> timings;
+    while (std::getline(src, line)) {
+        auto fields = split(line);
+        if (fields.size() <= seconds_idx) {
+            continue;
+        }
+        std::string key;
+        for (unsigned int i = 0; i < num_key_columns; ++i) {
+            key += (i > 0 ? "\t" : "") + fields[i];
+        }
+        timings[key] = std::strtod(fields[seconds_idx].c_str(), nullptr);
+    }
+    return timings;
+}
+
+int main(int argc, const char * argv []) {
+    if (argc < 3) {
+        std::cerr << "Usage: bench-compare BASELINE-RESULTS CURRENT-RESULTS [TOLERANCE [NUM-KEY-COLUMNS]]" << std::endl;
+        std::cerr << std::endl;
+        std::cerr << "Reports the ratio of current to baseline time for each benchmark" << std::endl;
+        std::cerr << "case found in both, and exits with status 1 if any is slower than" << std::endl;
+        std::cerr << "baseline by more than TOLERANCE (default 0.1, i.e. 10%)." << std::endl;
+        std::exit(2);
+    }
+    double tolerance = argc > 3 ? std::strtod(argv[3], nullptr) : 0.1;
+    unsigned int num_key_columns = argc > 4 ? static_cast<unsigned int>(std::strtoul(argv[4], nullptr, 10)) : 3;
+    std::string key_labels;
+    auto baseline = read_timings(argv[1], num_key_columns, key_labels);
+    auto current = read_timings(argv[2], num_key_columns, key_labels);
+    int num_regressions = 0;
+    std::cout << key_labels << "\tbaseline_seconds\tcurrent_seconds\tratio\tstatus" << std::endl;
+    for (auto & b : baseline) {
+        auto c = current.find(b.first);
+        if (c == current.end()) {
+            std::cout << b.first << "\t" << b.second << "\t\t\tmissing" << std::endl;
+            continue;
+        }
+        double ratio = b.second > 0.0 ? c->second / b.second : 1.0;
+        const char * status = "ok";
+        if (ratio > 1.0 + tolerance) {
+            status = "REGRESSION";
+            ++num_regressions;
+        } else if (ratio < 1.0 - tolerance) {
+            status = "improved";
+        }
+        std::cout << b.first << "\t" << b.second << "\t" << c->second << "\t" << ratio << "\t" << status << std::endl;
+    }
+    return num_regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,276 @@
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <platypus/platypus.hpp>
+#if defined(PLATYPUS_BENCH_WITH_NCL)
+#include <platypus/parse/nclreader.hpp>
+#endif
+
+typedef platypus::StandardNodeValue<> NodeValueType;
+typedef platypus::StandardTree<NodeValueType> TreeType;
+
+// Results, one row per benchmark case, keyed by (benchmark, shape, tips),
+// written to ``out`` as each case is run.
+class Results {
+
+    public:
+        Results(unsigned int num_reps, std::ostream & out)
+            : num_reps_(num_reps)
+            , out_(out) {
+            this->table_.add_key_column<std::string>("benchmark");
+            this->table_.add_key_column<std::string>("shape");
+            this->table_.add_key_column<unsigned long>("tips");
+            this->table_.add_data_column<unsigned long>("items");
+            this->table_.add_data_column<unsigned long>("bytes");
+            this->table_.add_data_column<double>("seconds");
+            this->table_.add_data_column<double>("items_per_second");
+            this->table_.add_data_column<double>("megabytes_per_second");
+            // the header row
+            this->table_.write(this->out_);
+        }
+
+        /**
+         * Times ``fn`` (best of the number of repetitions), which processes
+         * ``num_items`` items (trees, nodes, rows ...) and ``num_bytes`` bytes
+         * per call; ``setup`` is called (untimed) before each call.
+         */
+        void run(const std::string & benchmark,
+                const std::string & shape,
+                unsigned long num_tips,
+                unsigned long num_items,
+                unsigned long num_bytes,
+                const std::function<void ()> & setup,
+                const std::function<void ()> & fn) {
+            double best = 0.0;
+            for (unsigned int rep = 0; rep < this->num_reps_; ++rep) {
+                if (setup) {
+                    setup();
+                }
+                auto start = std::chrono::steady_clock::now();
+                fn();
+                auto stop = std::chrono::steady_clock::now();
+                double t = std::chrono::duration<double>(stop - start).count();
+                if (rep == 0 || t < best) {
+                    best = t;
+                }
+            }
+            double rate = best > 0.0 ? num_items / best : 0.0;
+            double mb_rate = best > 0.0 && num_bytes > 0 ? (num_bytes / 1.0e6) / best : 0.0;
+            auto & row = this->table_.add_row();
+            row << benchmark << shape << num_tips << num_items << num_bytes << best << rate << mb_rate;
+            row.write_formatted(this->out_);
+        }
+
+    private:
+        unsigned int            num_reps_;
+        std::ostream &          out_;
+        platypus::DataTable     table_;
+
+}; // Results
+
+std::vector<NodeValueType> leaf_values(unsigned long num_tips) {
+    std::vector<NodeValueType> leaves;
+    for (unsigned long i = 0; i < num_tips; ++i) {
+        leaves.emplace_back("t" + std::to_string(i));
+    }
+    return leaves;
+}
+
+// Balanced or maximally-unbalanced tree, with all edges of length 1.
+void build_tree(TreeType & tree, const std::string & shape, unsigned long num_tips) {
+    tree.clear();
+    auto leaves = leaf_values(num_tips);
+    if (shape == "balanced") {
+        platypus::build_maximally_balanced_tree(tree, leaves.begin(), leaves.end());
+    } else {
+        platypus::build_maximally_unbalanced_tree(tree, leaves.begin(), leaves.end());
+    }
+    for (auto nd = tree.preorder_begin(); nd != tree.preorder_end(); ++nd) {
+        nd->set_edge_length(1.0);
+    }
+}
+
+unsigned long count_nodes(const TreeType & tree) {
+    unsigned long num_nodes = 0;
+    for (auto nd = tree.preorder_begin(); nd != tree.preorder_end(); ++nd) {
+        ++num_nodes;
+    }
+    return num_nodes;
+}
+
+void run_io_benchmarks(Results & results, const std::string & shape, unsigned long num_tips, unsigned long num_trees) {
+    std::vector<TreeType> trees(num_trees);
+    for (auto & tree : trees) {
+        build_tree(tree, shape, num_tips);
+    }
+    platypus::StandardNewickWriter<TreeType> writer;
+    std::string src;
+    {
+        std::ostringstream out;
+        writer.write(out, trees.begin(), trees.end());
+        src = out.str();
+    }
+
+    results.run("newick-write", shape, num_tips, num_trees, src.size(), nullptr, [&] () {
+        std::ostringstream out;
+        writer.write(out, trees.begin(), trees.end());
+    });
+
+    platypus::StandardNewickReader<TreeType> reader;
+    TreeType tree;
+    auto tree_factory = [&tree] () -> TreeType & { tree.clear(); return tree; };
+    results.run("newick-read-buffer", shape, num_tips, num_trees, src.size(), nullptr, [&] () {
+        if (reader.read_buffer(src, tree_factory) != num_trees) {
+            std::cerr << "newick-read-buffer: unexpected number of trees" << std::endl;
+            std::exit(1);
+        }
+    });
+    results.run("newick-read-stream", shape, num_tips, num_trees, src.size(), nullptr, [&] () {
+        if (reader.read(std::istringstream(src), tree_factory) != num_trees) {
+            std::cerr << "newick-read-stream: unexpected number of trees" << std::endl;
+            std::exit(1);
+        }
+    });
+
+#if defined(PLATYPUS_BENCH_WITH_NCL)
+    platypus::NclTreeReader<TreeType> ncl_reader;
+    platypus::bind_standard_interface(ncl_reader);
+    results.run("ncl-read", shape, num_tips, num_trees, src.size(), nullptr, [&] () {
+        if (ncl_reader.read(std::istringstream(src), tree_factory, "newick") != num_trees) {
+            std::cerr << "ncl-read: unexpected number of trees" << std::endl;
+            std::exit(1);
+        }
+    });
+#endif
+}
+
+void run_tree_benchmarks(Results & results, const std::string & shape, unsigned long num_tips) {
+    TreeType tree;
+    build_tree(tree, shape, num_tips);
+    unsigned long num_nodes = count_nodes(tree);
+    volatile unsigned long sink = 0;
+
+    results.run("traverse-preorder", shape, num_tips, num_nodes, 0, nullptr, [&] () {
+        unsigned long n = 0;
+        for (auto nd = tree.preorder_begin(); nd != tree.preorder_end(); ++nd) {
+            n += nd->get_label().size();
+        }
+        sink = n;
+    });
+    results.run("traverse-postorder", shape, num_tips, num_nodes, 0, nullptr, [&] () {
+        unsigned long n = 0;
+        for (auto nd = tree.postorder_begin(); nd != tree.postorder_end(); ++nd) {
+            n += nd->get_label().size();
+        }
+        sink = n;
+    });
+    results.run("traverse-level-order", shape, num_tips, num_nodes, 0, nullptr, [&] () {
+        unsigned long n = 0;
+        for (auto nd = tree.level_order_begin(); nd != tree.level_order_end(); ++nd) {
+            n += nd->get_label().size();
+        }
+        sink = n;
+    });
+    results.run("traverse-leaves", shape, num_tips, num_tips, 0, nullptr, [&] () {
+        unsigned long n = 0;
+        for (auto nd = tree.leaf_begin(); nd != tree.leaf_end(); ++nd) {
+            n += nd->get_label().size();
+        }
+        sink = n;
+    });
+    results.run("traverse-children", shape, num_tips, num_nodes - 1, 0, nullptr, [&] () {
+        unsigned long n = 0;
+        for (auto nd = tree.preorder_begin(); nd != tree.preorder_end(); ++nd) {
+            for (auto ch = tree.children_begin(nd); ch != tree.children_end(nd); ++ch) {
+                n += ch->get_label().size();
+            }
+        }
+        sink = n;
+    });
+
+    TreeType copy;
+    results.run("deep-copy", shape, num_tips, num_nodes, 0, nullptr, [&] () {
+        copy.deep_copy_from(tree);
+    });
+    (void)sink;
+}
+
+void run_coalescent_benchmarks(Results & results, unsigned long num_tips, unsigned long num_trees) {
+    typedef platypus::coalescent::BasicCoalescentSimulator<TreeType> SimulatorType;
+    TreeType tree;
+    platypus::numeric::RandomNumberGenerator rng(1);
+    SimulatorType simulator(rng,
+            [&tree] () -> TreeType & { tree.clear(); return tree; },
+            [] (TreeType & t, bool is_rooted) { t.set_is_rooted(is_rooted); },
+            [] (NodeValueType & nv, const std::string & label) { nv.set_label(label); },
+            [] (NodeValueType & nv, double edge_length) { nv.set_edge_length(edge_length); });
+    auto leaves = leaf_values(num_tips);
+    results.run("coalescent", "fixed-pop-size", num_tips, num_trees, 0,
+            [&rng] () { rng.set_seed(1); },
+            [&] () {
+                for (unsigned long i = 0; i < num_trees; ++i) {
+                    simulator.generate_fixed_pop_size_tree(leaves.begin(), leaves.end(), 1.0);
+                }
+            });
+}
+
+void run_datatable_benchmarks(Results & results, unsigned long num_rows) {
+    std::unique_ptr<platypus::DataTable> table;
+    auto setup = [&table] () {
+        table.reset(new platypus::DataTable());
+        table->add_key_column<unsigned long>("idx");
+        table->add_key_column<std::string>("name");
+        table->add_data_column<double>("value");
+    };
+    std::vector<std::string> names;
+    for (int i = 0; i < 16; ++i) {
+        names.push_back("name" + std::to_string(i));
+    }
+    results.run("datatable-append", "rows", 0, num_rows, 0, setup, [&] () {
+        for (unsigned long i = 0; i < num_rows; ++i) {
+            table->add_row() << i << names[i % names.size()] << (0.5 * i);
+        }
+    });
+    volatile double sink = 0.0;
+    results.run("datatable-summarize", "rows", 0, num_rows, 0, nullptr, [&] () {
+        sink = table->summarize_column("value").mean;
+    });
+    (void)sink;
+}
+
+int main(int argc, const char * argv []) {
+    // workloads are scaled by ``scale``, and timed as the best of ``num_reps``
+    unsigned int num_reps = 5;
+    double scale = 1.0;
+    if (argc > 1) {
+        num_reps = static_cast<unsigned int>(std::strtoul(argv[1], nullptr, 10));
+    }
+    if (argc > 2) {
+        scale = std::strtod(argv[2], nullptr);
+    }
+    if (num_reps < 1 || scale <= 0.0) {
+        std::cerr << "Usage: hot-paths [NUM-REPS [SCALE]]" << std::endl;
+        std::exit(1);
+    }
+    auto scaled = [scale] (unsigned long n) -> unsigned long {
+        unsigned long s = static_cast<unsigned long>(n * scale);
+        return s < 1 ? 1 : s;
+    };
+    Results results(num_reps, std::cout);
+    for (auto shape : {"balanced", "unbalanced"}) {
+        run_io_benchmarks(results, shape, 1000, scaled(200));
+        run_tree_benchmarks(results, shape, scaled(100000));
+    }
+    for (unsigned long num_tips = 100; num_tips <= 100000; num_tips *= 10) {
+        // roughly the same number of nodes simulated for each size
+        unsigned long num_trees = scaled(100000) / num_tips;
+        run_coalescent_benchmarks(results, num_tips, num_trees < 1 ? 1 : num_trees);
+    }
+    run_datatable_benchmarks(results, scaled(1000000));
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <platypus/platypus.hpp>
+
+struct NodeData {
+    std::string label;
+    double      edge_length;
+};
+typedef platypus::Tree<NodeData> TreeType;
+
+void write_balanced_node(std::ostream & out, unsigned long & tip_idx, unsigned long num_tips) {
+    if (num_tips == 1) {
+        out << "t" << tip_idx++ << ":1.0";
+        return;
+    }
+    out << "(";
+    write_balanced_node(out, tip_idx, num_tips / 2);
+    out << ",";
+    write_balanced_node(out, tip_idx, num_tips - (num_tips / 2));
+    out << "):1.0";
+}
+
+std::string balanced_tree(unsigned long num_tips) {
+    std::ostringstream out;
+    unsigned long tip_idx = 0;
+    write_balanced_node(out, tip_idx, num_tips);
+    out << ";\n";
+    return out.str();
+}
+
+std::string caterpillar_tree(unsigned long num_tips) {
+    std::ostringstream out;
+    for (unsigned long i = 1; i < num_tips; ++i) {
+        out << "(t" << i << ":1.0,";
+    }
+    out << "t" << num_tips << ":1.0";
+    for (unsigned long i = 1; i < num_tips; ++i) {
+        out << "):1.0";
+    }
+    out << ";\n";
+    return out.str();
+}
+
+double time_parse(const std::string & tree_string, unsigned long num_trees, bool recursive_parsing) {
+    std::ostringstream o;
+    for (unsigned long i = 0; i < num_trees; ++i) {
+        o << tree_string;
+    }
+    std::string src = o.str();
+    platypus::NewickReader<TreeType> reader;
+    reader.set_node_label_setter([](NodeData & nd, const std::string & label) { nd.label = label; });
+    reader.set_edge_length_setter([](NodeData & nd, double edge_length) { nd.edge_length = edge_length; });
+    reader.set_recursive_parsing(recursive_parsing);
+    TreeType tree;
+    auto start = std::chrono::steady_clock::now();
+    unsigned long count = reader.read_buffer(src, [&tree]() -> TreeType & { tree.clear(); return tree; });
+    auto stop = std::chrono::steady_clock::now();
+    if (count != num_trees) {
+        std::cerr << "Expecting " << num_trees << " trees but read " << count << std::endl;
+        exit(1);
+    }
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+void run(const std::string & shape, const std::string & tree_string, unsigned long num_tips, unsigned long num_trees) {
+    // best of several alternating runs, to even out warm-up effects
+    double iterative_time = 0.0;
+    double recursive_time = 0.0;
+    for (int rep = 0; rep < 3; ++rep) {
+        double t = time_parse(tree_string, num_trees, false);
+        if (rep == 0 || t < iterative_time) {
+            iterative_time = t;
+        }
+        t = time_parse(tree_string, num_trees, true);
+        if (rep == 0 || t < recursive_time) {
+            recursive_time = t;
+        }
+    }
+    std::cout << std::setw(12) << shape
+              << std::setw(10) << num_tips
+              << std::setw(10) << num_trees
+              << std::setw(14) << std::fixed << std::setprecision(4) << iterative_time
+              << std::setw(14) << std::fixed << std::setprecision(4) << recursive_time
+              << std::setw(10) << std::fixed << std::setprecision(3) << (iterative_time / recursive_time)
+              << std::endl;
+}
+
+int main(int argc, const char * argv []) {
+    // caterpillar trees are kept small enough for the recursive parser to
+    // not overflow the call stack
+    unsigned long num_tips = 2000;
+    unsigned long num_trees = 500;
+    if (argc > 1) {
+        num_tips = std::strtoul(argv[1], nullptr, 10);
+    }
+    if (argc > 2) {
+        num_trees = std::strtoul(argv[2], nullptr, 10);
+    }
+    if (num_tips < 2 || num_trees < 1) {
+        std::cerr << "Usage: newick-parse [NUM-TIPS [NUM-TREES]]" << std::endl;
+        exit(1);
+    }
+    std::cout << std::setw(12) << "shape"
+              << std::setw(10) << "tips"
+              << std::setw(10) << "trees"
+              << std::setw(14) << "iterative(s)"
+              << std::setw(14) << "recursive(s)"
+              << std::setw(10) << "ratio"
+              << std::endl;
+    run("balanced", balanced_tree(num_tips), num_tips, num_trees);
+    run("caterpillar", caterpillar_tree(num_tips), num_tips, num_trees);
+    return 0;
+}
@@ -1,84 +1,184 @@
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 #include <platypus/platypus.hpp>
 #include "../include/cmdopt.hpp"
 
-template <class TreeT, class iter>
-void write_newick_node(const TreeT& tree,
-        const iter& tree_iter,
-        std::ostream& out,
-        const std::function<void (typename TreeT::value_type &, std::ostream&)> & write_node_f) {
-    if (!tree_iter.is_leaf()) {
-        out << "(";
-        int ch_count = 0;
-        for (auto chi = tree.children_begin(tree_iter);
-                chi != tree.children_end(tree_iter);
-                ++chi, ++ch_count) {
-            if (ch_count > 0) {
-                out << ", ";
+typedef platypus::StandardNodeValue<> NodeValueType;
+typedef platypus::StandardTree<NodeValueType> TreeType;
+
+// Passes output through to another stream buffer, counting the bytes
+// written.
+class CountingStreamBuffer : public std::streambuf {
+
+    public:
+        CountingStreamBuffer(std::streambuf * dest)
+            : dest_(dest)
+            , num_bytes_(0) {
+        }
+
+        unsigned long get_num_bytes() const {
+            return this->num_bytes_;
+        }
+
+    protected:
+        int_type overflow(int_type ch) override {
+            if (traits_type::eq_int_type(ch, traits_type::eof())) {
+                return traits_type::not_eof(ch);
+            }
+            if (traits_type::eq_int_type(this->dest_->sputc(traits_type::to_char_type(ch)), traits_type::eof())) {
+                return traits_type::eof();
             }
-            write_newick_node(tree, chi, out, write_node_f);
+            ++this->num_bytes_;
+            return ch;
         }
-        out << ")";
-    }
-    write_node_f(*tree_iter, out);
-}
 
-template <class TreeT>
-void write_newick(const TreeT& tree,
-        std::ostream& out,
-        std::function<void (typename TreeT::value_type &, std::ostream&)> write_node_f) {
-    write_newick_node(tree, tree.begin(), out, write_node_f);
-    out << ";" << std::endl;
-}
+        std::streamsize xsputn(const char * s, std::streamsize n) override {
+            std::streamsize num_written = this->dest_->sputn(s, n);
+            this->num_bytes_ += static_cast<unsigned long>(num_written);
+            return num_written;
+        }
 
-template <class TreeT>
-void write_newick(const TreeT& tree, std::ostream& out) {
-    const std::function<void (typename TreeT::value_type &, std::ostream &)> write_node_f(
-            [] (typename TreeT::value_type & nv, std::ostream & out) { out << nv; });
-    write_newick(tree, out, write_node_f);
-}
+        int sync() override {
+            return this->dest_->pubsync();
+        }
 
-struct NodeData {
-    std::string label;
-    double      edge_length;
-    NodeData & operator=(const NodeData & nd) {
-        this->label = nd.label;
-        this->edge_length = nd.edge_length;
-        return *this;
-    }
-};
+    private:
+        std::streambuf *    dest_;
+        unsigned long       num_bytes_;
 
-int main(int argc, const char * argv []) {
+}; // CountingStreamBuffer
+
+// Collects trees as NewickTreeSink does, writing them as binary containers
+// (see platypus::BinaryTreeWriter) of ``container_size`` trees each (0:
+// a single container of all the trees, written by flush()). A single
+// container is written to ``out``; otherwise, container ``k`` is written
+// to the file ``path.k``.
+class BinaryContainerSink {
+
+    public:
+        BinaryContainerSink(const platypus::BinaryTreeWriter<TreeType> & writer,
+                std::ostream & out,
+                const std::string & path,
+                std::size_t container_size)
+            : writer_(writer)
+            , out_(out)
+            , path_(path)
+            , container_size_(container_size)
+            , num_pending_(0)
+            , num_containers_(0)
+            , num_bytes_(0) {
+        }
+
+        void operator()(TreeType & tree, unsigned long) {
+            if (this->trees_.size() == this->num_pending_) {
+                this->trees_.emplace_back();
+            }
+            std::swap(this->trees_[this->num_pending_], tree);
+            ++this->num_pending_;
+            if (this->container_size_ > 0 && this->num_pending_ >= this->container_size_) {
+                this->flush();
+            }
+        }
+
+        void flush() {
+            if (this->num_pending_ == 0) {
+                return;
+            }
+            auto trees_end = this->trees_.cbegin() + this->num_pending_;
+            if (this->container_size_ == 0) {
+                this->writer_.write(this->out_, this->trees_.cbegin(), trees_end);
+            } else {
+                std::string path = this->path_ + "." + std::to_string(this->num_containers_);
+                std::ofstream dest(path, std::ios::out | std::ios::binary);
+                if (!dest) {
+                    throw std::runtime_error("Unable to open file: '" + path + "'");
+                }
+                this->writer_.write(dest, this->trees_.cbegin(), trees_end);
+                this->num_bytes_ += static_cast<unsigned long>(dest.tellp());
+                dest.close();
+                if (!dest) {
+                    throw std::runtime_error("Error writing file: '" + path + "'");
+                }
+            }
+            this->num_pending_ = 0;
+            ++this->num_containers_;
+        }
 
-    // cmdline::parser args_parser;
-    // args_parser.add<unsigned long>("num-trees", 'n', "number of trees to simulate", false, 1);
-    // args_parser.add<double>("population-size", 'p', "(haploid) population size", false, 1.0);
-    // args_parser.parse_check(argc, argv);
-    // auto & rest = args_parser.rest();
-    // if (rest.size() == 0) {
-    //     std::cerr << "Need to specify the number of tips on each tree" << std::endl;
-    //     exit(1);
-    // }
+        // Bytes written to files (not to ``out``).
+        unsigned long get_num_bytes() const {
+            return this->num_bytes_;
+        }
+
+    private:
+        const platypus::BinaryTreeWriter<TreeType> &    writer_;
+        std::ostream &                                  out_;
+        std::string                                     path_;
+        std::size_t                                     container_size_;
+        std::vector<TreeType>                           trees_;
+        std::size_t                                     num_pending_;
+        unsigned long                                   num_containers_;
+        unsigned long                                   num_bytes_;
+
+}; // BinaryContainerSink
+
+int main(int argc, const char * argv []) {
 
     unsigned long num_tips = 10;
     unsigned long num_trees = 1;
+    unsigned long first_replicate = 0;
     double population_size = 1.0;
     unsigned long edge_len_prec = 4;
+    unsigned long num_threads = 1;
+    unsigned long random_seed = 0;
+    std::string output_path;
+    std::string output_format = "newick";
+    unsigned long batch_size = 0;
+    unsigned long container_size = 0;
+    bool compress = false;
+    bool quiet = false;
     platypus::OptionParser parser(
-            "SimCoalescentTree v1.0.0",
+            "SimCoalescentTree v1.1.0",
             "Simulate basic coalescent trees using the platypus-phyloinformary library.",
             "%prog [options] <NUM-TIPS>");
-    // parser.add_option<unsigned long>(&num_tips, "-t", "--num-tips",
-    //                            "number of tips in each tree");
     parser.add_option<unsigned long>(&num_trees, "-t", "--num-trees",
                                "number of trees to simulate (default = %default)");
+    parser.add_option<unsigned long>(&first_replicate, "-s", "--first-replicate",
+                               "index of the first replicate to simulate, so that a large batch can be "
+                               "split into jobs, each simulating the trees it would contain from this "
+                               "index on with the same random seed (default = %default)");
     parser.add_option<double>(&population_size, "-N", "--pop-size",
                                "haploid population size (default = %default)");
     parser.add_option<unsigned long>(&edge_len_prec, "-e", "--edge-length-precision",
                                "precision for edge length (default = %default)");
+    parser.add_option<unsigned long>(&num_threads, "-j", "--num-threads",
+                               "number of threads to use for simulating and formatting trees; "
+                               "0 = one per hardware thread (default = %default)");
+    parser.add_option<unsigned long>(&random_seed, "-z", "--random-seed",
+                               "random number seed; 0 = seed from clock (default = %default)");
+    parser.add_option<std::string>(&output_path, "-o", "--output",
+                               "path of file to write trees to (default: standard output)");
+    parser.add_option<std::string>(&output_format, "-f", "--format",
+                               "output format: 'newick' or 'binary' (default = %default)");
+    parser.add_option<unsigned long>(&batch_size, "-b", "--batch-size",
+                               "number of trees to collect before formatting them in parallel; "
+                               "0 = 256 per thread (default = %default)");
+    parser.add_option<unsigned long>(&container_size, NULL, "--container-size",
+                               "for binary output, number of trees in each container, written to "
+                               "files '<OUTPUT>.0', '<OUTPUT>.1', etc.; 0 = all trees in a single "
+                               "container, held in memory until written to the output (default = %default)");
+#if defined(PLATYPUS_ENABLE_ZLIB)
+    parser.add_switch(&compress, "-c", "--compress",
+                               "gzip-compress Newick output");
+#endif
+    parser.add_switch(&quiet, "-q", "--quiet",
+                               "do not report throughput on standard error");
     parser.parse(argc, argv);
 
     const auto & args = parser.get_args();
@@ -87,25 +187,92 @@ int main(int argc, const char * argv []) {
         exit(1);
     }
     num_tips = std::atol(args[0].c_str());
+    bool binary_output = false;
+    if (output_format == "binary") {
+        binary_output = true;
+    } else if (output_format != "newick") {
+        std::cerr << "Unrecognized output format: '" << output_format << "'" << std::endl;
+        exit(1);
+    }
+    if (binary_output && compress) {
+        std::cerr << "Binary output cannot be compressed" << std::endl;
+        exit(1);
+    }
+    if (binary_output && container_size > 0 && output_path.empty()) {
+        std::cerr << "Output path required for binary output in multiple containers" << std::endl;
+        exit(1);
+    }
+    if (random_seed == 0) {
+        random_seed = std::time(NULL);
+    }
 
-    typedef platypus::Tree<NodeData> TreeType;
-    std::vector<TreeType> trees;
-    auto tree_factory = [&trees] () -> TreeType& { trees.emplace_back(); return trees.back(); };
-    auto is_rooted_f = [] (TreeType& tree, bool) { return true; };
-    auto node_label_f = [] (NodeData& nd, const std::string& label) {  nd.label = label; };
-    auto node_edge_f = [] (NodeData& nd, double len) {nd.edge_length = len;};
-    const std::function<void (typename TreeType::value_type &, std::ostream &)> write_node_f(
-            [&edge_len_prec] (typename TreeType::value_type & nv, std::ostream & out) {
-                if (!nv.label.empty()) {
-                    out << nv.label;
-                }
-                out << ":" << std::setprecision(edge_len_prec) << nv.edge_length;
-            });
-    platypus::coalescent::BasicCoalescentSimulator<TreeType> sim(tree_factory, is_rooted_f, node_label_f, node_edge_f);
-    for (unsigned long i = 0; i < num_trees; ++i) {
-        auto tree = sim.generate_fixed_pop_size_tree(num_tips, population_size);
-        std::cout << "[&R] ";
-        write_newick(tree, std::cout, write_node_f);
+    // output, counted below any compression
+    std::ofstream output_file;
+    std::streambuf * dest_buffer = std::cout.rdbuf();
+    if (!output_path.empty() && !(binary_output && container_size > 0)) {
+        output_file.open(output_path, std::ios::out | std::ios::binary);
+        if (!output_file) {
+            std::cerr << "Unable to open file: '" << output_path << "'" << std::endl;
+            exit(1);
+        }
+        dest_buffer = output_file.rdbuf();
+    }
+    CountingStreamBuffer counted_buffer(dest_buffer);
+    std::ostream counted_out(&counted_buffer);
+    std::ostream * out = &counted_out;
+#if defined(PLATYPUS_ENABLE_ZLIB)
+    std::unique_ptr<platypus::GzipOutputStream> compressed_out;
+    if (compress) {
+        compressed_out.reset(new platypus::GzipOutputStream(counted_out));
+        out = compressed_out.get();
+    }
+#endif
+
+    // trees are passed to the sink as they are generated (in re-used tree
+    // objects), so the tree factory is not used
+    auto tree_factory = [] () -> TreeType& { throw std::logic_error("tree factory not used"); };
+    platypus::coalescent::BasicCoalescentSimulator<TreeType> sim(tree_factory, nullptr, nullptr, nullptr);
+    platypus::bind_standard_interface(sim);
+    auto start = std::chrono::steady_clock::now();
+    unsigned long num_generated = 0;
+    unsigned long num_file_bytes = 0;
+    if (binary_output) {
+        platypus::BinaryTreeWriter<TreeType> writer;
+        platypus::bind_standard_interface(writer);
+        BinaryContainerSink sink(writer, *out, output_path, container_size);
+        num_generated = sim.generate_batch_range(first_replicate, first_replicate + num_trees,
+                num_tips, population_size, num_threads, std::ref(sink), random_seed);
+        sink.flush();
+        num_file_bytes = sink.get_num_bytes();
+    } else {
+        platypus::StandardNewickWriter<TreeType> writer;
+        writer.set_edge_length_precision(edge_len_prec);
+        platypus::NewickTreeSink<TreeType, platypus::StandardInterfaceGetters> sink(writer, *out, num_threads, batch_size);
+        num_generated = sim.generate_batch_range(first_replicate, first_replicate + num_trees,
+                num_tips, population_size, num_threads, std::ref(sink), random_seed);
+        sink.flush();
+    }
+#if defined(PLATYPUS_ENABLE_ZLIB)
+    if (compressed_out) {
+        compressed_out->close();
+    }
+#endif
+    out->flush();
+    if (!*out || (output_file.is_open() && !output_file)) {
+        std::cerr << "Error writing output" << std::endl;
+        exit(1);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!quiet) {
+        double num_megabytes = (counted_buffer.get_num_bytes() + num_file_bytes) / 1.0e6;
+        std::cerr << "sim-coalescent-trees: "
+            << num_generated << " trees of " << num_tips << " tips (seed " << random_seed << ")"
+            << " in " << std::setprecision(3) << seconds << " s: "
+            << std::setprecision(6) << (seconds > 0.0 ? num_generated / seconds : 0.0) << " trees/s, "
+            << std::setprecision(3) << num_megabytes << " MB written ("
+            << (seconds > 0.0 ? num_megabytes / seconds : 0.0) << " MB/s)"
+            << std::endl;
     }
     return 0;
 }
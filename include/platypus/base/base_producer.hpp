@@ -29,7 +29,10 @@
 #include <string>
 #include <sstream>
 #include <functional>
+#include <utility>
 #include "exception.hpp"
+#include "../model/taxonnamespace.hpp"
+#include "../utility/instrumentation.hpp"
 
 namespace platypus {
 
@@ -45,6 +48,31 @@ class ProducerException : public PlatypusException {
             : PlatypusException(filename, line_num, message) { }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// FunctionSetters
+
+/**
+ * Tag for tree producers that take a ``SettersT`` template parameter (e.g.
+ * platypus::NewickReader), selecting the default, run-time, binding of
+ * setters, i.e. through the function objects set on BaseTreeProducer.
+ *
+ * Any other ``SettersT`` is a class that binds the setters at compile time,
+ * through the static member functions:
+ *
+ *      template <class TreeT>
+ *      static void set_tree_is_rooted(TreeT & tree, bool is_rooted);
+ *      template <class ValueT, class LabelT>
+ *      static void set_node_label(ValueT & nv, const LabelT & label);
+ *      template <class ValueT, class EdgeLengthT>
+ *      static void set_edge_length(ValueT & nv, EdgeLengthT length);
+ *
+ * where ``LabelT`` is the token type of the source, i.e. std::string or
+ * platypus::TokenView, so that labels need not be converted to a
+ * std::string before being stored (see
+ * platypus::StandardInterfaceSetters).
+ */
+struct FunctionSetters { };
+
 ////////////////////////////////////////////////////////////////////////////////
 // BaseTreeProducer (base class for all tree-producing classes)
 
@@ -59,20 +87,47 @@ class BaseTreeProducer {
         typedef typename tree_type::value_type   tree_value_type;
 
         // typedefs for functions used in construction
+        typedef std::function<tree_type & ()>                                                                  tree_factory_fntype;
         typedef std::function<void (tree_type &, bool)>                                                        tree_is_rooted_setter_fntype;
         typedef std::function<void (tree_value_type &, const std::string &)>                                   node_value_label_setter_fntype;
+        typedef std::function<void (tree_value_type &, std::string &&)>                                        node_value_label_mover_fntype;
         typedef std::function<void (tree_value_type &, EdgeLengthT)>                                           node_value_edge_length_setter_fntype;
+        typedef std::function<void (tree_value_type &, TaxonNamespace::index_type)>                            node_value_taxon_setter_fntype;
         typedef std::function<void (tree_type &, unsigned long, unsigned long, unsigned long, EdgeLengthT)>    tree_postprocess_fntype;
 
 
     public:
 
-        BaseTreeProducer() { }
+        BaseTreeProducer()
+            : taxon_namespace_(nullptr) { }
+
+        BaseTreeProducer(
+                const tree_factory_fntype & tree_factory,
+                const tree_is_rooted_setter_fntype & tree_is_rooted_func,
+                const node_value_label_setter_fntype & node_value_label_func,
+                const node_value_edge_length_setter_fntype & node_value_edge_length_func)
+            : tree_factory_(tree_factory)
+            , tree_is_rooted_setter_(tree_is_rooted_func)
+            , node_value_label_setter_(node_value_label_func)
+            , node_value_edge_length_setter_(node_value_edge_length_func)
+            , taxon_namespace_(nullptr) { }
 
         virtual ~BaseTreeProducer() { }
 
         // Setting/binding of functions
 
+        /**
+         * Binds the tree factory function.
+         *
+         * @param tree_factory
+         *   A function that takes no arguments and returns a reference to a
+         *   new (empty) TreeT object, into which the next tree produced will
+         *   be built.
+         */
+        virtual void set_tree_factory(const tree_factory_fntype & tree_factory) {
+            this->tree_factory_ = tree_factory;
+        }
+
 
         /**
          * Binds the tree rooting state setter function.
@@ -105,6 +160,25 @@ class BaseTreeProducer {
             this->node_value_label_setter_ = [] (tree_value_type&, const std::string&) { };
         }
 
+        /**
+         * Binds the node label "mover" function.
+         *
+         * @param node_value_label_func
+         *   A function that takes a reference to a TreeT::value_type object
+         *   and an rvalue reference to a string value representing the label
+         *   for that node, which it may take over rather than copy. If
+         *   bound, this is used instead of the label setter function
+         *   whenever the producer has a label string of its own to give
+         *   away (e.g., a token read from a stream, or a label unescaped
+         *   from its source), so that the label is materialized only once.
+         */
+        virtual void set_node_label_mover(const node_value_label_mover_fntype & node_value_label_func) {
+            this->node_value_label_mover_ = node_value_label_func;
+        }
+        virtual void clear_node_label_mover() {
+            this->node_value_label_mover_ = nullptr;
+        }
+
         /**
          * Binds the edge length setter function.
          *
@@ -122,6 +196,38 @@ class BaseTreeProducer {
             this->node_value_edge_length_setter_ = [] (tree_value_type&, EdgeLengthT) { };
         }
 
+        /**
+         * Binds a taxon namespace to the producer, and the function that
+         * associates node values with its taxa.
+         *
+         * While a namespace is bound, the label of each leaf node is looked
+         * up in (or, if absent, added to) ``taxon_namespace``, and the
+         * resulting taxon index is passed to ``node_value_taxon_func``
+         * *instead* of the label being passed to the label setter. The
+         * labels of internal nodes are unaffected.
+         *
+         * @param taxon_namespace
+         *   Namespace, which must outlive the producer (or until
+         *   clear_taxon_namespace() is called). The same namespace may be
+         *   bound to any number of producers.
+         * @param node_value_taxon_func
+         *   A function that takes a reference to a TreeT::value_type object
+         *   and the index of a taxon in ``taxon_namespace``, and sets the
+         *   object's state accordingly.
+         */
+        virtual void set_taxon_namespace(TaxonNamespace & taxon_namespace,
+                const node_value_taxon_setter_fntype & node_value_taxon_func) {
+            this->taxon_namespace_ = &taxon_namespace;
+            this->node_value_taxon_setter_ = node_value_taxon_func;
+        }
+        virtual void clear_taxon_namespace() {
+            this->taxon_namespace_ = nullptr;
+            this->node_value_taxon_setter_ = nullptr;
+        }
+        inline TaxonNamespace * get_taxon_namespace() const {
+            return this->taxon_namespace_;
+        }
+
         /**
          * Binds the tree post-processing function.
          *
@@ -143,8 +249,29 @@ class BaseTreeProducer {
             this->tree_postprocess_fn_ = [] (tree_type &, unsigned long, unsigned long, unsigned long, EdgeLengthT) { };
         }
 
+        // Instrumentation
+
+        /**
+         * Returns the counts and timings accumulated over everything produced
+         * since construction (or the last call to reset_stats()). These are
+         * all 0 unless PLATYPUS_ENABLE_INSTRUMENTATION is defined (see
+         * platypus::InstrumentationStats).
+         */
+        inline const InstrumentationStats & get_stats() const {
+            return this->stats_;
+        }
+        inline void reset_stats() {
+            this->stats_.clear();
+        }
+
     protected:
 
+        tree_type & create_new_tree() {
+            if (!this->tree_factory_) {
+                throw ProducerException(__FILE__, __LINE__, "platypus::BaseTreeProducer: tree factory function not bound");
+            }
+            return this->tree_factory_();
+        }
         void set_tree_is_rooted(tree_type & tree, bool is_rooted) {
             if (this->tree_is_rooted_setter_) {
                 this->tree_is_rooted_setter_(tree, is_rooted);
@@ -155,22 +282,51 @@ class BaseTreeProducer {
                 this->node_value_label_setter_(nv, label);
             }
         }
+        void set_node_value_label(tree_value_type & nv, std::string && label) {
+            if (this->node_value_label_mover_) {
+                this->node_value_label_mover_(nv, std::move(label));
+            } else if (this->node_value_label_setter_) {
+                this->node_value_label_setter_(nv, label);
+            }
+        }
+        inline bool has_node_value_label_mover() const {
+            return static_cast<bool>(this->node_value_label_mover_);
+        }
         void set_node_value_edge_length(tree_value_type & nv, EdgeLengthT length) {
             if (this->node_value_edge_length_setter_) {
                 this->node_value_edge_length_setter_(nv, length);
             }
         }
+        inline bool has_taxon_namespace() const {
+            return this->taxon_namespace_ != nullptr;
+        }
+        void set_node_value_taxon_index(tree_value_type & nv, TaxonNamespace::index_type taxon_index) {
+            if (this->node_value_taxon_setter_) {
+                this->node_value_taxon_setter_(nv, taxon_index);
+            }
+        }
+        // ``LabelT`` is std::string or a view with ``data()`` and ``size()``.
+        template <class LabelT>
+        void set_node_value_taxon(tree_value_type & nv, const LabelT & label) {
+            this->set_node_value_taxon_index(nv, this->taxon_namespace_->add_taxon(label.data(), label.size()));
+        }
         void postprocess_tree(tree_type & tree, unsigned long idx, unsigned long tips, unsigned long internals, EdgeLengthT length) {
             if (this->tree_postprocess_fn_) {
+                InstrumentationTimer timer(this->stats_.postprocess_seconds);
                 this->tree_postprocess_fn_(tree, idx, tips, internals, length);
             }
         }
 
     protected:
+        tree_factory_fntype                         tree_factory_;
         tree_is_rooted_setter_fntype                tree_is_rooted_setter_;
         node_value_label_setter_fntype              node_value_label_setter_;
+        node_value_label_mover_fntype               node_value_label_mover_;
         node_value_edge_length_setter_fntype        node_value_edge_length_setter_;
         tree_postprocess_fntype                     tree_postprocess_fn_;
+        TaxonNamespace *                            taxon_namespace_;
+        node_value_taxon_setter_fntype              node_value_taxon_setter_;
+        InstrumentationStats                        stats_;
 
 }; // BaseTreeProducer
 
@@ -31,6 +31,8 @@
 #include <sstream>
 #include <memory>
 #include "base_producer.hpp"
+#include "../model/treepool.hpp"
+#include "../utility/treeoffsetindex.hpp"
 
 namespace platypus {
 
@@ -114,12 +116,44 @@ class BaseTreeReader : public BaseTreeProducer<TreeT, EdgeLengthT> {
         //////////////////////////////////////////////////////////////////////////////
         // Life-cycle
 
-        BaseTreeReader() {
+        BaseTreeReader()
+            : skip_first_(0)
+            , every_nth_(1) {
         }
 
         virtual ~BaseTreeReader() {
         }
 
+        //////////////////////////////////////////////////////////////////////////////
+        // Tree selection
+
+        /**
+         * Sets the number of tree statements at the start of the source that
+         * are skipped (e.g., an MCMC burn-in) by all subsequent reads. Skipped
+         * statements are passed over without building any trees, and do not
+         * count towards the ``tree_limit`` of a read or the tree index
+         * passed to the post-processing function.
+         */
+        void set_skip_first(unsigned long skip_first) {
+            this->skip_first_ = skip_first;
+        }
+        unsigned long get_skip_first() const {
+            return this->skip_first_;
+        }
+
+        /**
+         * Sets the thinning interval for all subsequent reads: of the tree
+         * statements that follow those skipped (see set_skip_first()), only
+         * the first and every ``every_nth`` one thereafter are read. A value
+         * of 0 or 1 reads every statement.
+         */
+        void set_every_nth(unsigned long every_nth) {
+            this->every_nth_ = every_nth > 0 ? every_nth : 1;
+        }
+        unsigned long get_every_nth() const {
+            return this->every_nth_;
+        }
+
         //////////////////////////////////////////////////////////////////////////////
         // Reading interface
 
@@ -182,27 +216,224 @@ class BaseTreeReader : public BaseTreeProducer<TreeT, EdgeLengthT> {
             return this->read(src, get_new_tree_reference, tree_limit);
         }
 
+        //////////////////////////////////////////////////////////////////////////////
+        // Streaming interface
+
+        /**
+         * Reads the stream `src` one tree at a time into a single TreeT
+         * object, `tree`, which is reused for every tree in the source, so
+         * that memory requirements are bounded by the largest tree rather
+         * than by the number of trees.
+         *
+         * After each tree has been completely read and post-processed (see
+         * BaseTreeProducer::set_tree_postprocess_fn()), it is passed to
+         * `tree_fn` along with its (0-based) index in the source. The tree is
+         * then cleared and reused for the next tree, so client code must copy
+         * any data it needs to retain beyond the call to `tree_fn`.
+         *
+         * @param src
+         *   Input stream which contains a representation of the tree(s).
+         *
+         * @param tree
+         *   TreeT objected to be (re-)populated with each tree read.
+         *
+         * @param tree_fn
+         *   Function object that will be called with each tree read and its
+         *   index.
+         *
+         * @param tree_limit
+         *   The maximum number of trees to be read from the source. If 0, all
+         *   trees available in the source will be read.
+         *
+         * @return
+         *   The number of trees read.
+         */
+        unsigned long read_each(
+                std::istream & src,
+                TreeT & tree,
+                const std::function<void (TreeT &, unsigned long)> & tree_fn,
+                unsigned long tree_limit=0) {
+            unsigned long num_trees_requested = 0;
+            // By the time the next tree is requested, the previous one has
+            // been completely parsed and post-processed.
+            auto tf = [&tree, &tree_fn, &num_trees_requested]() -> TreeT & {
+                if (num_trees_requested > 0) {
+                    tree_fn(tree, num_trees_requested - 1);
+                }
+                tree.clear();
+                ++num_trees_requested;
+                return tree;
+            };
+            unsigned long tree_count = this->parse_stream(src, tf, tree_limit);
+            if (num_trees_requested > 0) {
+                tree_fn(tree, num_trees_requested - 1);
+            }
+            return tree_count;
+        }
+
+        // overload for binding `src` to temporary
+        unsigned long read_each(
+                std::istream && src,
+                TreeT & tree,
+                const std::function<void (TreeT &, unsigned long)> & tree_fn,
+                unsigned long tree_limit=0) {
+            return this->read_each(src, tree, tree_fn, tree_limit);
+        }
+
+        // As above, but using a default-constructed TreeT object.
+        unsigned long read_each(
+                std::istream & src,
+                const std::function<void (TreeT &, unsigned long)> & tree_fn,
+                unsigned long tree_limit=0) {
+            TreeT tree;
+            return this->read_each(src, tree, tree_fn, tree_limit);
+        }
+
+        // overload for binding `src` to temporary
+        unsigned long read_each(
+                std::istream && src,
+                const std::function<void (TreeT &, unsigned long)> & tree_fn,
+                unsigned long tree_limit=0) {
+            return this->read_each(src, tree_fn, tree_limit);
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Indexed interface
+
+        /**
+         * Reads trees [``begin_idx``, ``end_idx``) of the (seekable) source
+         * ``src``, as indexed by ``index`` (see platypus::TreeOffsetIndex),
+         * by seeking directly to the first of them rather than parsing the
+         * trees that precede it. ``end_idx`` is clamped to the number of
+         * trees in the index. The skip and thinning settings
+         * (set_skip_first(), set_every_nth()) do not apply, and trees are
+         * passed to the post-processing function with their index in the
+         * range.
+         *
+         * @return
+         *   The number of trees read.
+         */
+        virtual unsigned long read_range(
+                std::istream & src,
+                const TreeOffsetIndex & index,
+                std::size_t begin_idx,
+                std::size_t end_idx,
+                const std::function<TreeT & ()> & get_new_tree_reference) {
+            if (end_idx > index.num_trees()) {
+                end_idx = index.num_trees();
+            }
+            if (begin_idx >= end_idx) {
+                return 0;
+            }
+            src.clear();
+            src.seekg(static_cast<std::streamoff>(index.get_tree_offset(begin_idx)));
+            if (!src) {
+                throw ReaderException(__FILE__, __LINE__, "platypus::BaseTreeReader: unable to seek to indexed tree");
+            }
+            return this->parse_stream_unfiltered(src, get_new_tree_reference, end_idx - begin_idx);
+        }
+
+        // overload for binding `src` to temporary
+        unsigned long read_range(
+                std::istream && src,
+                const TreeOffsetIndex & index,
+                std::size_t begin_idx,
+                std::size_t end_idx,
+                const std::function<TreeT & ()> & get_new_tree_reference) {
+            return this->read_range(src, index, begin_idx, end_idx, get_new_tree_reference);
+        }
+
+        // Reads tree ``tree_idx`` into ``tree`` (see read_range()).
+        void read_at(
+                std::istream & src,
+                const TreeOffsetIndex & index,
+                std::size_t tree_idx,
+                TreeT & tree) {
+            if (tree_idx >= index.num_trees()) {
+                throw ReaderException(__FILE__, __LINE__, "platypus::BaseTreeReader: tree index out of range");
+            }
+            this->read_range(src, index, tree_idx, tree_idx + 1, [&tree]() -> TreeT & { return tree; });
+        }
+
+        // overload for binding `src` to temporary
+        void read_at(
+                std::istream && src,
+                const TreeOffsetIndex & index,
+                std::size_t tree_idx,
+                TreeT & tree) {
+            this->read_at(src, index, tree_idx, tree);
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Collection interface
+        //
+        // Each of these reads the trees of a source into a new collection.
+        // Storage for ``tree_limit`` trees, if given, or for all trees in
+        // ``index``, is reserved up front.
+
         std::vector<TreeT> get_tree_vector(
                 std::istream & src,
                 unsigned long tree_limit=0) {
-                // std::function<TreeT&()> new_tree_fn = []()->TreeT&{return TreeT();}) {
             std::vector<TreeT> trees;
+            trees.reserve(tree_limit);
             auto tf = [&trees]()->TreeT & { trees.emplace_back(); return trees.back(); };
             this->parse_stream(src, tf, tree_limit);
             return trees;
         }
 
         std::vector<std::unique_ptr<TreeT>> get_tree_ptr_vector(
-                std::istream& src,
+                std::istream & src,
                 unsigned long tree_limit=0) {
-                // std::function<TreeT&()> new_tree_fn = []()->TreeT&{return TreeT();}) {
             std::vector<std::unique_ptr<TreeT>> trees;
-            // auto tf = [&trees, &new_tree_fn]()->TreeT & { trees.emplace_back(new_tree_fn()); return trees.back(); };
-            auto tf = [&trees]()->TreeT & { std::unique_ptr<TreeT> t(new TreeT()); trees.push_back(t); return *trees.back(); };
+            trees.reserve(tree_limit);
+            auto tf = [&trees]()->TreeT & { trees.emplace_back(new TreeT()); return *trees.back(); };
             this->parse_stream(src, tf, tree_limit);
             return trees;
         }
 
+        /**
+         * As get_tree_ptr_vector(), but with the trees allocated from (and
+         * owned by) a platypus::TreePool, so that they are allocated in a
+         * few blocks and all freed together.
+         */
+        TreePool<TreeT> get_tree_pool(
+                std::istream & src,
+                unsigned long tree_limit=0) {
+            TreePool<TreeT> trees;
+            trees.reserve(tree_limit);
+            auto tf = [&trees]()->TreeT & { return trees.create(); };
+            this->parse_stream(src, tf, tree_limit);
+            return trees;
+        }
+
+        // All trees indexed by ``index`` (see read_range()).
+        std::vector<TreeT> get_tree_vector(
+                std::istream & src,
+                const TreeOffsetIndex & index) {
+            std::vector<TreeT> trees;
+            trees.reserve(index.num_trees());
+            this->read_range(src, index, 0, index.num_trees(), [&trees]()->TreeT & { trees.emplace_back(); return trees.back(); });
+            return trees;
+        }
+
+        std::vector<std::unique_ptr<TreeT>> get_tree_ptr_vector(
+                std::istream & src,
+                const TreeOffsetIndex & index) {
+            std::vector<std::unique_ptr<TreeT>> trees;
+            trees.reserve(index.num_trees());
+            this->read_range(src, index, 0, index.num_trees(), [&trees]()->TreeT & { trees.emplace_back(new TreeT()); return *trees.back(); });
+            return trees;
+        }
+
+        TreePool<TreeT> get_tree_pool(
+                std::istream & src,
+                const TreeOffsetIndex & index) {
+            TreePool<TreeT> trees;
+            trees.reserve(index.num_trees());
+            this->read_range(src, index, 0, index.num_trees(), [&trees]()->TreeT & { return trees.create(); });
+            return trees;
+        }
+
     protected:
 
         // To be implementad by derived classes.
@@ -211,6 +442,60 @@ class BaseTreeReader : public BaseTreeProducer<TreeT, EdgeLengthT> {
                 const std::function<TreeT & ()> & get_new_tree_reference,
                 unsigned long tree_limit=0) = 0;
 
+        // As parse_stream(), but with the skip and thinning settings
+        // suspended.
+        unsigned long parse_stream_unfiltered(
+                std::istream& src,
+                const std::function<TreeT & ()> & get_new_tree_reference,
+                unsigned long tree_limit) {
+            unsigned long skip_first = this->skip_first_;
+            unsigned long every_nth = this->every_nth_;
+            this->skip_first_ = 0;
+            this->every_nth_ = 1;
+            try {
+                unsigned long tree_count = this->parse_stream(src, get_new_tree_reference, tree_limit);
+                this->skip_first_ = skip_first;
+                this->every_nth_ = every_nth;
+                return tree_count;
+            } catch (...) {
+                this->skip_first_ = skip_first;
+                this->every_nth_ = every_nth;
+                throw;
+            }
+        }
+
+        // Whether the tree statement at (0-based) position
+        // ``statement_idx`` in the source is excluded by the current
+        // skip_first/every_nth settings.
+        inline bool is_statement_skipped(unsigned long statement_idx) const {
+            return statement_idx < this->skip_first_
+                || (statement_idx - this->skip_first_) % this->every_nth_ != 0;
+        }
+
+        // Read position of the buffer underlying ``src`` (which, unlike
+        // std::istream::tellg(), is available after the end of the stream
+        // has been reached), or -1 if it cannot be determined or if
+        // instrumentation is disabled.
+        static std::streampos get_instrumentation_position(std::istream & src) {
+            if (!InstrumentationStats::is_enabled() || src.rdbuf() == nullptr) {
+                return std::streampos(-1);
+            }
+            return src.rdbuf()->pubseekoff(0, std::ios::cur, std::ios::in);
+        }
+
+        // Records the number of bytes consumed from ``src`` since
+        // get_instrumentation_position() returned ``start``.
+        void record_stream_bytes_read(std::istream & src, std::streampos start) {
+            std::streampos end = get_instrumentation_position(src);
+            if (start != std::streampos(-1) && end != std::streampos(-1) && end > start) {
+                this->stats_.record_bytes_read(static_cast<unsigned long>(end - start));
+            }
+        }
+
+    protected:
+        unsigned long       skip_first_;
+        unsigned long       every_nth_;
+
 }; // BaseTreeReader
 
 } // namespace platypus
@@ -29,6 +29,7 @@
 #include <sstream>
 #include <functional>
 #include "exception.hpp"
+#include "../utility/instrumentation.hpp"
 
 namespace platypus {
 
@@ -44,6 +45,29 @@ class WriterException : public PlatypusException {
             : PlatypusException(filename, line_num, message) { }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// FunctionGetters
+
+/**
+ * Tag for tree writers that take a ``GettersT`` template parameter (e.g.
+ * platypus::NewickWriter), selecting the default, run-time, binding of
+ * getters, i.e. through the function objects set on BaseTreeWriter.
+ *
+ * Any other ``GettersT`` is a class that binds the getters at compile time,
+ * through the static member functions:
+ *
+ *      template <class TreeT>
+ *      static bool get_tree_is_rooted(const TreeT & tree);
+ *      template <class ValueT>
+ *      static <string type> get_node_label(const ValueT & nv);
+ *      template <class ValueT>
+ *      static <edge length type> get_edge_length(const ValueT & nv);
+ *
+ * where the label may be returned by (const) reference to avoid a copy
+ * (see platypus::StandardInterfaceGetters).
+ */
+struct FunctionGetters { };
+
 ////////////////////////////////////////////////////////////////////////////////
 // BaseTreeWriter
 
@@ -111,11 +135,28 @@ class BaseTreeWriter {
             this->edge_length_precision_ = prec;
         }
 
+        // Instrumentation
+
+        /**
+         * As BaseTreeProducer::get_stats(): the number of trees and bytes
+         * written, and the time spent writing them. Updates are not
+         * synchronized, so a writer whose statistics are of interest should
+         * not be shared between threads.
+         */
+        inline const InstrumentationStats & get_stats() const {
+            return this->stats_;
+        }
+        inline void reset_stats() {
+            this->stats_.clear();
+        }
+
     protected:
         tree_is_rooted_getter_fntype                tree_is_rooted_getter_;
         node_value_label_getter_fntype              node_value_label_getter_;
         node_value_edge_length_getter_fntype        node_value_edge_length_getter_;
         unsigned int                                edge_length_precision_;
+        // updated by (const) write operations
+        mutable InstrumentationStats                stats_;
 
 }; // BaseTreeWriter
 
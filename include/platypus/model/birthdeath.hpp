@@ -0,0 +1,467 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Birth-death (and Yule) tree simulation.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_MODEL_BIRTHDEATH_HPP
+#define PLATYPUS_MODEL_BIRTHDEATH_HPP
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../base/base_producer.hpp"
+#include "../numeric/rng.hpp"
+#include "../utility/parallel.hpp"
+
+namespace platypus {
+namespace birthdeath {
+
+typedef double BirthDeathTimeValueType;
+
+////////////////////////////////////////////////////////////////////////////////
+// BirthDeathParameters
+
+/**
+ * A constant-rate birth-death process, with extant lineages sampled with
+ * probability `sampling_fraction`, and the conditioning of the trees
+ * generated from it.
+ *
+ * Trees are always conditioned on their number of leaves. In addition, they
+ * may be conditioned on:
+ *
+ *  - AgeCondition::None: nothing else; the time of origin is given an
+ *    (improper) uniform prior (Gernhard 2008). This requires
+ *    `birth_rate >= death_rate`;
+ *  - AgeCondition::Crown: the age of the root (i.e., of the most recent
+ *    common ancestor of the leaves) being `age`;
+ *  - AgeCondition::Stem: the time of origin of the process being `age`, in
+ *    which case the edge subtending the root has length `age` less the
+ *    crown age.
+ *
+ * A pure-birth (Yule) process has a `death_rate` of 0.
+ */
+struct BirthDeathParameters {
+
+    enum class AgeCondition {
+            None,
+            Crown,
+            Stem };
+
+    BirthDeathParameters(double birth_rate=1.0,
+            double death_rate=0.0,
+            double sampling_fraction=1.0,
+            double age=0.0,
+            AgeCondition age_condition=AgeCondition::None)
+        : birth_rate(birth_rate)
+        , death_rate(death_rate)
+        , sampling_fraction(sampling_fraction)
+        , age(age)
+        , age_condition(age_condition) { }
+
+    // throws std::logic_error if the parameters do not define a process
+    // that trees can be drawn from
+    void validate() const {
+        if (!(this->birth_rate > 0.0)) {
+            throw std::logic_error("Birth rate must be greater than 0");
+        }
+        if (!(this->death_rate >= 0.0)) {
+            throw std::logic_error("Death rate cannot be less than 0");
+        }
+        if (!(this->sampling_fraction > 0.0 && this->sampling_fraction <= 1.0)) {
+            throw std::logic_error("Sampling fraction must be in (0, 1]");
+        }
+        if (this->age_condition == AgeCondition::None) {
+            if (this->death_rate > this->birth_rate) {
+                throw std::logic_error("Death rate cannot exceed birth rate unless trees are conditioned on age");
+            }
+        } else if (!(this->age > 0.0)) {
+            throw std::logic_error("Age must be greater than 0");
+        }
+    }
+
+    double          birth_rate;
+    double          death_rate;
+    double          sampling_fraction;
+    double          age;
+    AgeCondition    age_condition;
+
+}; // BirthDeathParameters
+
+////////////////////////////////////////////////////////////////////////////////
+// Coalescent point process
+
+/**
+ * Under the coalescent point process representation of the reconstructed
+ * tree of a birth-death process (Popovic 2004; Lambert and Stadler 2013),
+ * the depths of the nodes joining successive leaves (in the planar order of
+ * the tree) are independent and identically distributed, with
+ * P(H > t) = 1 / F(t), where this function returns F(t), which is:
+ *
+ *      1 + rho * b * (exp((b - d) * t) - 1) / (b - d)
+ *
+ * for birth rate b, death rate d, and sampling fraction rho (or
+ * 1 + rho * b * t if b = d).
+ */
+inline double node_depth_inverse_tail(const BirthDeathParameters & params, double t) {
+    double r = params.birth_rate - params.death_rate;
+    double rho_b = params.sampling_fraction * params.birth_rate;
+    if (r == 0.0) {
+        return 1.0 + rho_b * t;
+    }
+    return 1.0 + rho_b * std::expm1(r * t) / r;
+}
+
+/**
+ * Returns the depth t for which node_depth_inverse_tail() is `y`.
+ */
+inline double node_depth_from_inverse_tail(const BirthDeathParameters & params, double y) {
+    double r = params.birth_rate - params.death_rate;
+    double rho_b = params.sampling_fraction * params.birth_rate;
+    if (r == 0.0) {
+        return (y - 1.0) / rho_b;
+    }
+    return std::log1p((y - 1.0) * r / rho_b) / r;
+}
+
+/**
+ * Returns a random node depth of the coalescent point process (see
+ * node_depth_inverse_tail()), by inversion of its distribution function;
+ * if `max_depth` > 0, the depth is conditioned on being less than
+ * `max_depth`.
+ */
+template <class RngT=platypus::numeric::RandomNumberGenerator>
+BirthDeathTimeValueType random_node_depth(
+        RngT & rng,
+        const BirthDeathParameters & params,
+        BirthDeathTimeValueType max_depth=0.0) {
+    double u = rng.uniform_real();
+    double tail = max_depth > 0.0
+        ? 1.0 - u * (1.0 - 1.0 / node_depth_inverse_tail(params, max_depth))
+        : 1.0 - u;
+    return node_depth_from_inverse_tail(params, 1.0 / tail);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BirthDeathTreeSimulator
+
+/**
+ * Simulates reconstructed trees (i.e., of the sampled extant lineages) under
+ * a constant-rate birth-death process, conditioned on the number of leaves
+ * (see BirthDeathParameters).
+ *
+ * Rather than simulating the process forward in time event by event (and
+ * rejecting realizations with the wrong number of leaves), the node depths
+ * of each tree are drawn directly from the coalescent point process (see
+ * random_node_depth()), and the tree is assembled from them in a single
+ * pass, so that a tree of n leaves takes O(n) time, whatever the rates.
+ * Leaf values are assigned to the leaves in random order.
+ *
+ * @tparam TreeT
+ *   Tree type.
+ * @tparam RngT
+ *   Random number generator type.
+ */
+template <typename TreeT, typename RngT=platypus::numeric::RandomNumberGenerator>
+class BirthDeathTreeSimulator : public platypus::BaseTreeProducer<TreeT> {
+
+    public:
+        typedef std::function<void (TreeT &, unsigned long)>    tree_sink_fntype;
+
+    public:
+
+        BirthDeathTreeSimulator(RngT & rng,
+                const typename BaseTreeProducer<TreeT>::tree_factory_fntype & tree_factory,
+                const typename BaseTreeProducer<TreeT>::tree_is_rooted_setter_fntype & tree_is_rooted_func,
+                const typename BaseTreeProducer<TreeT>::node_value_label_setter_fntype & node_value_label_func,
+                const typename BaseTreeProducer<TreeT>::node_value_edge_length_setter_fntype & node_value_edge_length_func)
+            : BaseTreeProducer<TreeT>(
+                    tree_factory,
+                    tree_is_rooted_func,
+                    node_value_label_func,
+                    node_value_edge_length_func)
+            , rng_ptr_(&rng)
+            , allocated_rng_(false) {
+        }
+
+        BirthDeathTreeSimulator(
+                const typename BaseTreeProducer<TreeT>::tree_factory_fntype & tree_factory,
+                const typename BaseTreeProducer<TreeT>::tree_is_rooted_setter_fntype & tree_is_rooted_func,
+                const typename BaseTreeProducer<TreeT>::node_value_label_setter_fntype & node_value_label_func,
+                const typename BaseTreeProducer<TreeT>::node_value_edge_length_setter_fntype & node_value_edge_length_func)
+            : BaseTreeProducer<TreeT>(
+                    tree_factory,
+                    tree_is_rooted_func,
+                    node_value_label_func,
+                    node_value_edge_length_func)
+            , allocated_rng_(true) {
+            this->rng_ptr_ = new RngT();
+        }
+
+        BirthDeathTreeSimulator(const BirthDeathTreeSimulator &) = delete;
+        BirthDeathTreeSimulator & operator=(const BirthDeathTreeSimulator &) = delete;
+
+        ~BirthDeathTreeSimulator() {
+            if (this->allocated_rng_ && this->rng_ptr_) {
+                delete this->rng_ptr_;
+                this->allocated_rng_ = false;
+                this->rng_ptr_ = nullptr;
+            }
+        }
+
+        /**
+         * Generates a tree with a leaf for each of the values in
+         * [`leaf_values_begin`, `leaf_values_end`), under the process given
+         * by `params`.
+         *
+         * @return
+         *   A reference to the tree simulated.
+         */
+        template <typename iter>
+        TreeT & generate_tree(
+                iter leaf_values_begin,
+                iter leaf_values_end,
+                const BirthDeathParameters & params) {
+            params.validate();
+            InstrumentationTimer build_timer(this->stats_.build_seconds);
+            auto & tree = this->create_new_tree();
+            this->set_tree_is_rooted(tree, true);
+            this->leaf_nodes_.clear();
+            for (auto leaf_iter = leaf_values_begin; leaf_iter != leaf_values_end; ++leaf_iter) {
+                this->leaf_nodes_.push_back(tree.create_leaf_node(*leaf_iter));
+            }
+            std::size_t num_leaves = this->leaf_nodes_.size();
+            this->stats_.record_tree(num_leaves == 0 ? 0 : 2 * num_leaves - 1);
+            if (num_leaves == 0) {
+                return tree;
+            }
+            // leaf values in random order along the tree
+            for (std::size_t i = num_leaves - 1; i > 0; --i) {
+                std::swap(this->leaf_nodes_[i], this->leaf_nodes_[this->rng_ptr_->uniform_pos_int(i)]);
+            }
+            bool is_stem_conditioned = params.age_condition == BirthDeathParameters::AgeCondition::Stem;
+            if (num_leaves == 1) {
+                tree.head_node()->add_child(this->leaf_nodes_[0]);
+                this->set_node_value_edge_length(this->leaf_nodes_[0]->value(), is_stem_conditioned ? params.age : 0.0);
+                this->set_node_value_edge_length(tree.head_node()->value(), 0.0);
+                return tree;
+            }
+            // depth of the node joining leaves i and i + 1
+            std::size_t num_nodes = num_leaves - 1;
+            this->depths_.resize(num_nodes);
+            BirthDeathTimeValueType max_depth = params.age_condition == BirthDeathParameters::AgeCondition::None ? 0.0 : params.age;
+            for (std::size_t i = 0; i < num_nodes; ++i) {
+                this->depths_[i] = random_node_depth(*this->rng_ptr_, params, max_depth);
+            }
+            if (params.age_condition == BirthDeathParameters::AgeCondition::Crown) {
+                this->depths_[this->rng_ptr_->uniform_pos_int(num_nodes - 1)] = params.age;
+            }
+            std::size_t root_idx = this->build_node_hierarchy();
+            this->internal_nodes_.resize(num_nodes);
+            for (std::size_t i = 0; i < num_nodes; ++i) {
+                this->internal_nodes_[i] = i == root_idx ? tree.head_node() : tree.create_internal_node();
+            }
+            for (std::size_t i = 0; i < num_nodes; ++i) {
+                auto node = this->internal_nodes_[i];
+                this->attach_child(node, this->depths_[i], this->left_children_[i], i);
+                this->attach_child(node, this->depths_[i], this->right_children_[i], i + 1);
+            }
+            this->set_node_value_edge_length(tree.head_node()->value(),
+                    is_stem_conditioned ? params.age - this->depths_[root_idx] : 0.0);
+            return tree;
+        }
+
+        TreeT & generate_tree(unsigned long num_leaves, const BirthDeathParameters & params) {
+            std::vector<typename TreeT::value_type> leaves;
+            this->create_leaf_values(num_leaves, leaves);
+            return this->generate_tree(leaves.begin(), leaves.end(), params);
+        }
+
+        /**
+         * Generates `num_trees` trees of `num_leaves` tips under the process
+         * given by `params`, distributing the work across `num_threads`
+         * threads (0 = one per hardware thread), and passes each tree and
+         * its 0-based index to `tree_sink` in index order, from the calling
+         * thread.
+         *
+         * As for coalescent::BasicCoalescentSimulator::generate_batch(),
+         * each replicate is simulated with its own random number generator
+         * (see platypus::numeric::ReplicateRandomNumberGenerator), so the
+         * trees produced depend only on `master_seed`, and not on the number
+         * of threads used; and trees are built in (re-used) TreeT objects
+         * owned by this function, so `tree_sink` must copy or move out
+         * anything it wants to keep.
+         *
+         * @return
+         *   The number of trees generated.
+         */
+        unsigned long generate_batch(
+                unsigned long num_trees,
+                unsigned long num_leaves,
+                const BirthDeathParameters & params,
+                unsigned int num_threads,
+                const tree_sink_fntype & tree_sink,
+                std::uint64_t master_seed) {
+            return this->generate_batch_range(0, num_trees, num_leaves, params, num_threads, tree_sink, master_seed);
+        }
+
+        /**
+         * As generate_batch(), but generates only the replicates with indexes
+         * in [`begin_idx`, `end_idx`), which are identical to the
+         * corresponding trees of a full batch with the same `master_seed`.
+         *
+         * @return
+         *   The number of trees generated.
+         */
+        unsigned long generate_batch_range(
+                unsigned long begin_idx,
+                unsigned long end_idx,
+                unsigned long num_leaves,
+                const BirthDeathParameters & params,
+                unsigned int num_threads,
+                const tree_sink_fntype & tree_sink,
+                std::uint64_t master_seed) {
+            if (end_idx <= begin_idx) {
+                return 0;
+            }
+            params.validate();
+            unsigned long num_trees = end_idx - begin_idx;
+            num_threads = resolve_num_threads(num_threads);
+            std::vector<typename TreeT::value_type> leaves;
+            this->create_leaf_values(num_leaves, leaves);
+            unsigned long batch_size = static_cast<unsigned long>(num_threads) * 16;
+            std::vector<TreeT> trees(batch_size < num_trees ? batch_size : num_trees);
+            for (unsigned long batch_start = begin_idx; batch_start < end_idx; batch_start += batch_size) {
+                unsigned long batch_end = batch_start + batch_size;
+                if (batch_end > end_idx) {
+                    batch_end = end_idx;
+                }
+                InstrumentationTimer build_timer(this->stats_.build_seconds);
+                parallel_for(batch_end - batch_start, num_threads, [&] (std::size_t task_idx) {
+                    TreeT & tree = trees[task_idx];
+                    tree.clear();
+                    RngT rng = platypus::numeric::ReplicateRandomNumberGenerator<RngT>::create(
+                            master_seed, batch_start + task_idx);
+                    BirthDeathTreeSimulator<TreeT, RngT> replicate_simulator(rng,
+                            [&tree] () -> TreeT & { return tree; },
+                            this->tree_is_rooted_setter_,
+                            this->node_value_label_setter_,
+                            this->node_value_edge_length_setter_);
+                    replicate_simulator.generate_tree(leaves.begin(), leaves.end(), params);
+                });
+                build_timer.stop();
+                for (unsigned long idx = batch_start; idx < batch_end; ++idx) {
+                    this->stats_.record_tree(num_leaves > 0 ? 2 * num_leaves - 1 : 0);
+                    tree_sink(trees[idx - batch_start], idx);
+                }
+            }
+            return num_trees;
+        }
+
+        /**
+         * As above, but with the master seed drawn from this simulator's
+         * random number generator.
+         */
+        unsigned long generate_batch(
+                unsigned long num_trees,
+                unsigned long num_leaves,
+                const BirthDeathParameters & params,
+                unsigned int num_threads,
+                const tree_sink_fntype & tree_sink) {
+            assert(this->rng_ptr_);
+            std::uint64_t master_seed = this->rng_ptr_->uniform_pos_int(std::numeric_limits<unsigned long>::max());
+            return this->generate_batch(num_trees, num_leaves, params, num_threads, tree_sink, master_seed);
+        }
+
+    private:
+
+        void create_leaf_values(unsigned long num_leaves, std::vector<typename TreeT::value_type> & leaves) {
+            for (unsigned long i = 0; i < num_leaves; ++i) {
+                leaves.emplace_back();
+                this->set_node_value_label(leaves.back(), "T" + std::to_string(i));
+            }
+        }
+
+        // Builds the tree of nodes in which each node is the parent of the
+        // deepest nodes between it and the next deeper node on either side
+        // (i.e., the Cartesian tree of ``depths_``, with a stack in linear
+        // time), setting the children of node i (or npos, for leaves i and
+        // i + 1 respectively). Returns the index of the root.
+        std::size_t build_node_hierarchy() {
+            std::size_t num_nodes = this->depths_.size();
+            this->left_children_.assign(num_nodes, npos());
+            this->right_children_.assign(num_nodes, npos());
+            this->node_stack_.clear();
+            for (std::size_t i = 0; i < num_nodes; ++i) {
+                std::size_t last_popped = npos();
+                while (!this->node_stack_.empty() && this->depths_[this->node_stack_.back()] < this->depths_[i]) {
+                    last_popped = this->node_stack_.back();
+                    this->node_stack_.pop_back();
+                }
+                this->left_children_[i] = last_popped;
+                if (!this->node_stack_.empty()) {
+                    this->right_children_[this->node_stack_.back()] = i;
+                }
+                this->node_stack_.push_back(i);
+            }
+            return this->node_stack_.front();
+        }
+
+        void attach_child(typename TreeT::node_type * parent,
+                BirthDeathTimeValueType parent_depth,
+                std::size_t child_idx,
+                std::size_t leaf_idx) {
+            typename TreeT::node_type * child = nullptr;
+            BirthDeathTimeValueType child_depth = 0.0;
+            if (child_idx == npos()) {
+                child = this->leaf_nodes_[leaf_idx];
+            } else {
+                child = this->internal_nodes_[child_idx];
+                child_depth = this->depths_[child_idx];
+            }
+            parent->add_child(child);
+            this->set_node_value_edge_length(child->value(), parent_depth - child_depth);
+        }
+
+        static constexpr std::size_t npos() {
+            return static_cast<std::size_t>(-1);
+        }
+
+    private:
+        RngT *                                          rng_ptr_;
+        bool                                            allocated_rng_;
+        // working storage, kept between trees
+        std::vector<typename TreeT::node_type *>        leaf_nodes_;
+        std::vector<typename TreeT::node_type *>        internal_nodes_;
+        std::vector<BirthDeathTimeValueType>            depths_;
+        std::vector<std::size_t>                        left_children_;
+        std::vector<std::size_t>                        right_children_;
+        std::vector<std::size_t>                        node_stack_;
+
+}; // BirthDeathTreeSimulator
+
+} // namespace birthdeath
+} // namespace platypus
+
+#endif
@@ -0,0 +1,626 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Discrete character data packed as state sets, aligned for SIMD.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_MODEL_CHARACTERMATRIX_HPP
+#define PLATYPUS_MODEL_CHARACTERMATRIX_HPP
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../base/exception.hpp"
+#include "../utility/alignedbuffer.hpp"
+#include "taxonnamespace.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// CharacterMatrixError
+
+class CharacterMatrixError : public PlatypusException {
+    public:
+        CharacterMatrixError(
+                    const std::string & filename,
+                    unsigned long line_num,
+                    const std::string & message)
+            : PlatypusException(filename, line_num, message) { }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// CharacterStateAlphabet
+
+/**
+ * The states of a discrete character, and the symbols that denote them (or
+ * sets of them). A state set is a bitmask, with bit ``i`` set if state ``i``
+ * (the ``i``-th of the fundamental symbols) is possible, so that ambiguity
+ * codes, gaps and missing data are just sets of more than one state, and
+ * the intersection and union of two sets are a single AND or OR.
+ */
+class CharacterStateAlphabet {
+
+    public:
+        typedef std::uint32_t       state_set_type;
+
+        static constexpr std::size_t max_num_states() {
+            return 32;
+        }
+
+    public:
+
+        /**
+         * @param symbols
+         *   The fundamental states, in order.
+         * @param missing_symbols
+         *   Symbols for gaps and missing data, treated as the set of all
+         *   states.
+         * @param is_case_sensitive
+         *   If false, upper- and lower-case letters denote the same state
+         *   set.
+         */
+        CharacterStateAlphabet(const std::string & symbols,
+                const std::string & missing_symbols="-?",
+                bool is_case_sensitive=false)
+            : symbols_(symbols)
+            , is_case_sensitive_(is_case_sensitive) {
+            if (symbols.empty() || symbols.size() > max_num_states()) {
+                throw CharacterMatrixError(__FILE__, __LINE__, "platypus::CharacterStateAlphabet: number of states must be between 1 and " + std::to_string(max_num_states()));
+            }
+            this->lookup_.fill(0);
+            for (std::size_t state_idx = 0; state_idx < symbols.size(); ++state_idx) {
+                this->set_symbol(symbols[state_idx], state_set_type(1) << state_idx);
+            }
+            for (auto symbol : missing_symbols) {
+                this->set_symbol(symbol, this->get_all_states_set());
+            }
+        }
+
+        /**
+         * Makes ``symbol`` denote the set of the states given by
+         * ``state_symbols`` (e.g., "AG" for the nucleotide ambiguity code
+         * R).
+         */
+        void add_equate(char symbol, const std::string & state_symbols) {
+            state_set_type state_set = 0;
+            for (auto state_symbol : state_symbols) {
+                state_set |= this->get_state_set(state_symbol);
+            }
+            this->set_symbol(symbol, state_set);
+        }
+
+        // A, C, G, T, with the IUPAC ambiguity codes (U as T).
+        static CharacterStateAlphabet dna() {
+            CharacterStateAlphabet alphabet("ACGT");
+            alphabet.add_nucleotide_equates('T');
+            alphabet.add_equate('U', "T");
+            return alphabet;
+        }
+
+        // A, C, G, U, with the IUPAC ambiguity codes (T as U).
+        static CharacterStateAlphabet rna() {
+            CharacterStateAlphabet alphabet("ACGU");
+            alphabet.add_nucleotide_equates('U');
+            alphabet.add_equate('T', "U");
+            return alphabet;
+        }
+
+        // The 20 amino acids, with B (D or N), Z (E or Q), J (I or L) and X.
+        static CharacterStateAlphabet protein() {
+            CharacterStateAlphabet alphabet("ACDEFGHIKLMNPQRSTVWY", "-?X*");
+            alphabet.add_equate('B', "DN");
+            alphabet.add_equate('Z', "EQ");
+            alphabet.add_equate('J', "IL");
+            return alphabet;
+        }
+
+        // Arbitrarily-assigned states, e.g. of morphological characters.
+        static CharacterStateAlphabet standard(const std::string & symbols="0123456789") {
+            return CharacterStateAlphabet(symbols, "-?", true);
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Lookup
+
+        inline std::size_t num_states() const {
+            return this->symbols_.size();
+        }
+
+        inline const std::string & symbols() const {
+            return this->symbols_;
+        }
+
+        inline char get_symbol(std::size_t state_idx) const {
+            return this->symbols_[state_idx];
+        }
+
+        inline state_set_type get_all_states_set() const {
+            return this->symbols_.size() == 32 ? ~state_set_type(0) : (state_set_type(1) << this->symbols_.size()) - 1;
+        }
+
+        inline bool is_valid_symbol(char symbol) const {
+            return this->lookup_[static_cast<unsigned char>(symbol)] != 0;
+        }
+
+        /**
+         * Returns the set of states denoted by ``symbol``.
+         *
+         * @throws CharacterMatrixError
+         *   If ``symbol`` is not part of the alphabet.
+         */
+        inline state_set_type get_state_set(char symbol) const {
+            state_set_type state_set = this->lookup_[static_cast<unsigned char>(symbol)];
+            if (state_set == 0) {
+                throw CharacterMatrixError(__FILE__, __LINE__, std::string("platypus::CharacterStateAlphabet: invalid symbol: '") + symbol + "'");
+            }
+            return state_set;
+        }
+
+        /**
+         * Returns a symbol denoting the set ``state_set``: the fundamental
+         * symbol of a single state, or else the first symbol assigned to
+         * exactly this set.
+         *
+         * @throws CharacterMatrixError
+         *   If no symbol denotes the set.
+         */
+        char get_state_set_symbol(state_set_type state_set) const {
+            if (state_set != 0 && (state_set & (state_set - 1)) == 0) {
+                std::size_t state_idx = 0;
+                while ((state_set >> state_idx) != 1) {
+                    ++state_idx;
+                }
+                if (state_idx < this->symbols_.size()) {
+                    return this->symbols_[state_idx];
+                }
+            }
+            for (auto symbol : this->assigned_symbols_) {
+                if (this->lookup_[static_cast<unsigned char>(symbol)] == state_set) {
+                    return symbol;
+                }
+            }
+            throw CharacterMatrixError(__FILE__, __LINE__, "platypus::CharacterStateAlphabet: no symbol for state set: " + std::to_string(state_set));
+        }
+
+    private:
+
+        void set_symbol(char symbol, state_set_type state_set) {
+            this->assigned_symbols_.push_back(symbol);
+            this->lookup_[static_cast<unsigned char>(symbol)] = state_set;
+            if (!this->is_case_sensitive_) {
+                this->lookup_[static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(symbol)))] = state_set;
+                this->lookup_[static_cast<unsigned char>(std::toupper(static_cast<unsigned char>(symbol)))] = state_set;
+            }
+        }
+
+        void add_nucleotide_equates(char t) {
+            std::string ts(1, t);
+            this->add_equate('R', "AG");
+            this->add_equate('Y', "C" + ts);
+            this->add_equate('M', "AC");
+            this->add_equate('K', "G" + ts);
+            this->add_equate('S', "CG");
+            this->add_equate('W', "A" + ts);
+            this->add_equate('H', "AC" + ts);
+            this->add_equate('B', "CG" + ts);
+            this->add_equate('V', "ACG");
+            this->add_equate('D', "AG" + ts);
+            this->add_equate('N', "ACG" + ts);
+        }
+
+    private:
+        std::string                         symbols_;
+        bool                                is_case_sensitive_;
+        std::array<state_set_type, 256>     lookup_;
+        std::string                         assigned_symbols_;
+
+}; // CharacterStateAlphabet
+
+////////////////////////////////////////////////////////////////////////////////
+// BasicCharacterMatrix
+
+/**
+ * An alignment of discrete characters, with the state of each taxon at each
+ * site held as a state set of type ``StateSetT`` (see
+ * CharacterStateAlphabet): std::uint8_t is enough for nucleotides (a 4-bit
+ * mask in each byte, see NucleotideCharacterMatrix), std::uint32_t for up
+ * to 32 states (e.g., amino acids, see CharacterMatrix).
+ *
+ * Taxa are identified by their index in a platypus::TaxonNamespace, which
+ * can be shared with trees on the same taxa (or, if none is given, is owned
+ * by the matrix). Each taxon is a row, stored in a single contiguous,
+ * cache-line-aligned buffer, with the sites of each row contiguous, and
+ * rows padded to a multiple of 64 bytes, so that a kernel over the sites
+ * of a row can use aligned vector loads without a scalar tail. Padding
+ * holds the set of all states, and so never contributes to a parsimony
+ * score or changes a likelihood.
+ */
+template <class StateSetT>
+class BasicCharacterMatrix {
+
+    public:
+        typedef StateSetT                           state_set_type;
+        typedef TaxonNamespace::index_type          taxon_index_type;
+
+        static constexpr std::size_t npos() {
+            return std::numeric_limits<std::size_t>::max();
+        }
+
+        // Alignment, in bytes, of each row.
+        static constexpr std::size_t row_alignment() {
+            return 64;
+        }
+
+    public:
+
+        /**
+         * @param alphabet
+         *   States of the characters; must have no more states than there
+         *   are bits in ``StateSetT``.
+         * @param taxon_namespace
+         *   Namespace to which the taxa of the matrix are added, which must
+         *   outlive the matrix; if null, the matrix uses a namespace of its
+         *   own.
+         */
+        BasicCharacterMatrix(const CharacterStateAlphabet & alphabet, TaxonNamespace * taxon_namespace=nullptr)
+            : alphabet_(alphabet)
+            , taxon_namespace_(taxon_namespace)
+            , num_sites_(0)
+            , row_stride_(0)
+            , num_rows_(0)
+            , is_compressed_(false) {
+            if (alphabet.num_states() > 8 * sizeof(StateSetT)) {
+                throw CharacterMatrixError(__FILE__, __LINE__, "platypus::BasicCharacterMatrix: too many states for state set type");
+            }
+            if (this->taxon_namespace_ == nullptr) {
+                this->owned_taxon_namespace_ = std::make_shared<TaxonNamespace>();
+                this->taxon_namespace_ = this->owned_taxon_namespace_.get();
+            }
+            this->all_states_ = static_cast<StateSetT>(alphabet.get_all_states_set());
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Shape
+
+        inline std::size_t num_taxa() const {
+            return this->num_rows_;
+        }
+
+        inline std::size_t num_sites() const {
+            return this->num_sites_;
+        }
+
+        /**
+         * Number of state sets from the start of one row to the start of
+         * the next (i.e., the number of sites, padded to a multiple of
+         * row_alignment() bytes).
+         */
+        inline std::size_t row_stride() const {
+            return this->row_stride_;
+        }
+
+        /**
+         * Sets the number of sites of every row (and so of the matrix);
+         * only possible while the matrix has no rows.
+         */
+        void set_num_sites(std::size_t num_sites) {
+            if (this->num_rows_ > 0) {
+                if (num_sites != this->num_sites_) {
+                    throw CharacterMatrixError(__FILE__, __LINE__, "platypus::BasicCharacterMatrix: cannot change number of sites of non-empty matrix");
+                }
+                return;
+            }
+            this->set_row_shape(num_sites);
+        }
+
+        // Allocates storage for ``num_taxa`` rows in total.
+        void reserve(std::size_t num_taxa) {
+            if (num_taxa * this->row_stride_ > this->cells_.size()) {
+                this->cells_.resize(num_taxa * this->row_stride_, this->all_states_);
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Rows
+
+        /**
+         * Adds a row for the taxon with index ``taxon_index`` in the taxon
+         * namespace, setting every site to the set of all states (i.e.,
+         * missing data), and returns its index.
+         *
+         * @throws CharacterMatrixError
+         *   If the matrix already has a row for the taxon.
+         */
+        std::size_t add_row(taxon_index_type taxon_index) {
+            if (this->is_compressed_) {
+                throw CharacterMatrixError(__FILE__, __LINE__, "platypus::BasicCharacterMatrix: cannot add rows to pattern-compressed matrix");
+            }
+            if (this->find_row(taxon_index) != npos()) {
+                throw CharacterMatrixError(__FILE__, __LINE__, "platypus::BasicCharacterMatrix: duplicate taxon: '" + this->taxon_namespace_->get_label(taxon_index) + "'");
+            }
+            std::size_t row_idx = this->num_rows_;
+            if ((row_idx + 1) * this->row_stride_ > this->cells_.size()) {
+                this->reserve(std::max<std::size_t>(2 * row_idx, 4));
+            }
+            if (taxon_index >= this->taxon_rows_.size()) {
+                this->taxon_rows_.resize(static_cast<std::size_t>(taxon_index) + 1, npos());
+            }
+            this->taxon_rows_[taxon_index] = row_idx;
+            this->row_taxa_.push_back(taxon_index);
+            ++this->num_rows_;
+            return row_idx;
+        }
+
+        /**
+         * Adds a row for the taxon labeled ``label`` (added to the taxon
+         * namespace if not already present), with the state sets denoted by
+         * the ``size`` symbols starting at ``symbols``. The first row added
+         * determines the number of sites (unless set beforehand with
+         * set_num_sites()).
+         *
+         * @throws CharacterMatrixError
+         *   If the number of symbols is not the number of sites, or a
+         *   symbol is not part of the alphabet.
+         */
+        std::size_t add_sequence(const std::string & label, const char * symbols, std::size_t size) {
+            if (this->is_compressed_) {
+                throw CharacterMatrixError(__FILE__, __LINE__, "platypus::BasicCharacterMatrix: cannot add rows to pattern-compressed matrix");
+            }
+            if (this->num_rows_ == 0 && this->row_stride_ == 0) {
+                this->set_num_sites(size);
+            }
+            if (size != this->num_sites_) {
+                throw CharacterMatrixError(__FILE__, __LINE__, "platypus::BasicCharacterMatrix: expecting " + std::to_string(this->num_sites_) + " sites but found " + std::to_string(size) + " for taxon '" + label + "'");
+            }
+            std::size_t row_idx = this->add_row(this->taxon_namespace_->add_taxon(label));
+            StateSetT * row = this->row(row_idx);
+            for (std::size_t site_idx = 0; site_idx < size; ++site_idx) {
+                row[site_idx] = static_cast<StateSetT>(this->alphabet_.get_state_set(symbols[site_idx]));
+            }
+            return row_idx;
+        }
+
+        std::size_t add_sequence(const std::string & label, const std::string & symbols) {
+            return this->add_sequence(label, symbols.data(), symbols.size());
+        }
+
+        /**
+         * Removes all rows (and any compression), so that the matrix can be
+         * re-used for different data; the number of sites must be set
+         * again, but storage is kept. Taxa are not removed from the taxon
+         * namespace.
+         */
+        void clear() {
+            this->num_rows_ = 0;
+            this->row_taxa_.clear();
+            this->taxon_rows_.clear();
+            this->is_compressed_ = false;
+            this->set_row_shape(0);
+            this->cells_.fill(this->all_states_);
+        }
+
+        // Returns the row of the taxon with index ``taxon_index``, or npos().
+        inline std::size_t find_row(taxon_index_type taxon_index) const {
+            if (taxon_index >= this->taxon_rows_.size()) {
+                return npos();
+            }
+            return this->taxon_rows_[taxon_index];
+        }
+
+        inline taxon_index_type get_taxon_index(std::size_t row_idx) const {
+            return this->row_taxa_[row_idx];
+        }
+
+        inline const std::string & get_taxon_label(std::size_t row_idx) const {
+            return this->taxon_namespace_->get_label(this->row_taxa_[row_idx]);
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // States
+
+        // The state sets of row ``row_idx``, aligned to row_alignment().
+        inline const StateSetT * row(std::size_t row_idx) const {
+            return this->cells_.data() + row_idx * this->row_stride_;
+        }
+
+        inline StateSetT * row(std::size_t row_idx) {
+            return this->cells_.data() + row_idx * this->row_stride_;
+        }
+
+        inline StateSetT get_state_set(std::size_t row_idx, std::size_t site_idx) const {
+            return this->row(row_idx)[site_idx];
+        }
+
+        inline void set_state_set(std::size_t row_idx, std::size_t site_idx, StateSetT state_set) {
+            this->row(row_idx)[site_idx] = state_set;
+        }
+
+        inline StateSetT get_all_states_set() const {
+            return this->all_states_;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Site Patterns
+
+        /**
+         * Collapses identical sites (columns) into a single site pattern,
+         * weighted by the number of sites it stands for, so that per-site
+         * computations (parsimony, likelihood) need only be done once per
+         * pattern. Patterns keep the order of their first occurrence.
+         * Afterwards, num_sites() is the number of patterns, and the
+         * pattern of each of the original sites is given by
+         * get_site_pattern(); no further rows can be added.
+         *
+         * Columns are hashed in a single pass over the rows (so that the
+         * matrix is read in storage order), and columns with equal hashes
+         * compared in full.
+         *
+         * @return
+         *   The number of patterns.
+         */
+        std::size_t compress_patterns() {
+            if (this->is_compressed_) {
+                return this->num_sites_;
+            }
+            const std::size_t num_sites = this->num_sites_;
+            std::vector<std::uint64_t> hashes(num_sites, 0x9E3779B97F4A7C15ULL);
+            for (std::size_t row_idx = 0; row_idx < this->num_rows_; ++row_idx) {
+                const StateSetT * row = this->row(row_idx);
+                for (std::size_t site_idx = 0; site_idx < num_sites; ++site_idx) {
+                    std::uint64_t h = (hashes[site_idx] ^ static_cast<std::uint64_t>(row[site_idx])) * 0x100000001B3ULL;
+                    hashes[site_idx] = h ^ (h >> 29);
+                }
+            }
+            // first site of each pattern, and patterns by hash
+            std::vector<std::size_t> pattern_sites;
+            std::unordered_multimap<std::uint64_t, std::size_t> patterns_by_hash;
+            patterns_by_hash.reserve(num_sites);
+            std::vector<std::uint32_t> weights;
+            for (std::size_t site_idx = 0; site_idx < num_sites; ++site_idx) {
+                std::size_t pattern_idx = npos();
+                auto range = patterns_by_hash.equal_range(hashes[site_idx]);
+                for (auto pi = range.first; pi != range.second; ++pi) {
+                    if (this->are_sites_equal(pattern_sites[pi->second], site_idx)) {
+                        pattern_idx = pi->second;
+                        break;
+                    }
+                }
+                if (pattern_idx == npos()) {
+                    pattern_idx = pattern_sites.size();
+                    pattern_sites.push_back(site_idx);
+                    weights.push_back(0);
+                    patterns_by_hash.insert(std::make_pair(hashes[site_idx], pattern_idx));
+                }
+                ++weights[pattern_idx];
+                this->site_patterns_[site_idx] = pattern_idx;
+            }
+            // gather the patterns into rows of the new width
+            std::size_t num_patterns = pattern_sites.size();
+            std::vector<std::size_t> site_patterns;
+            site_patterns.swap(this->site_patterns_);
+            AlignedBuffer<StateSetT, 64> cells;
+            cells.swap(this->cells_);
+            std::size_t old_stride = this->row_stride_;
+            this->set_row_shape(num_patterns);
+            this->cells_.resize(this->num_rows_ * this->row_stride_, this->all_states_);
+            for (std::size_t row_idx = 0; row_idx < this->num_rows_; ++row_idx) {
+                const StateSetT * src = cells.data() + row_idx * old_stride;
+                StateSetT * dest = this->row(row_idx);
+                for (std::size_t pattern_idx = 0; pattern_idx < num_patterns; ++pattern_idx) {
+                    dest[pattern_idx] = src[pattern_sites[pattern_idx]];
+                }
+            }
+            this->pattern_weights_.swap(weights);
+            this->site_patterns_.swap(site_patterns);
+            this->is_compressed_ = true;
+            return num_patterns;
+        }
+
+        inline bool is_compressed() const {
+            return this->is_compressed_;
+        }
+
+        // Number of sites before any compression.
+        inline std::size_t num_original_sites() const {
+            return this->site_patterns_.size();
+        }
+
+        // The number of original sites of each (pattern) site; all 1 before compression.
+        inline const std::vector<std::uint32_t> & pattern_weights() const {
+            return this->pattern_weights_;
+        }
+
+        inline std::uint32_t get_pattern_weight(std::size_t pattern_idx) const {
+            return this->pattern_weights_[pattern_idx];
+        }
+
+        // The (pattern) site of original site ``site_idx``.
+        inline std::size_t get_site_pattern(std::size_t site_idx) const {
+            return this->site_patterns_[site_idx];
+        }
+
+        inline const std::vector<std::size_t> & site_patterns() const {
+            return this->site_patterns_;
+        }
+
+    private:
+
+        void set_row_shape(std::size_t num_sites) {
+            const std::size_t cells_per_block = row_alignment() / sizeof(StateSetT);
+            this->num_sites_ = num_sites;
+            this->row_stride_ = (num_sites + cells_per_block - 1) / cells_per_block * cells_per_block;
+            this->pattern_weights_.assign(num_sites, 1);
+            this->site_patterns_.resize(num_sites);
+            for (std::size_t site_idx = 0; site_idx < num_sites; ++site_idx) {
+                this->site_patterns_[site_idx] = site_idx;
+            }
+        }
+
+        bool are_sites_equal(std::size_t site1, std::size_t site2) const {
+            for (std::size_t row_idx = 0; row_idx < this->num_rows_; ++row_idx) {
+                const StateSetT * row = this->row(row_idx);
+                if (row[site1] != row[site2]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    public:
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Metadata
+
+        inline const CharacterStateAlphabet & alphabet() const {
+            return this->alphabet_;
+        }
+
+        inline TaxonNamespace & taxon_namespace() const {
+            return *this->taxon_namespace_;
+        }
+
+    private:
+        CharacterStateAlphabet              alphabet_;
+        TaxonNamespace *                    taxon_namespace_;
+        std::shared_ptr<TaxonNamespace>     owned_taxon_namespace_;
+        StateSetT                           all_states_;
+        std::size_t                         num_sites_;
+        std::size_t                         row_stride_;
+        std::size_t                         num_rows_;
+        AlignedBuffer<StateSetT, 64>        cells_;
+        std::vector<taxon_index_type>       row_taxa_;
+        std::vector<std::size_t>            taxon_rows_;
+        std::vector<std::uint32_t>          pattern_weights_;
+        std::vector<std::size_t>            site_patterns_;
+        bool                                is_compressed_;
+
+}; // BasicCharacterMatrix
+
+typedef BasicCharacterMatrix<std::uint8_t>      NucleotideCharacterMatrix;
+typedef BasicCharacterMatrix<std::uint32_t>     CharacterMatrix;
+
+} // namespace platypus
+
+#endif
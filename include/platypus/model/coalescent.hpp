@@ -22,11 +22,25 @@
 #ifndef PLATYPUS_MODEL_COALSCENT_HPP
 #define PLATYPUS_MODEL_COALSCENT_HPP
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
 #include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "../base/base_producer.hpp"
+#include "nodeages.hpp"
 #include "../numeric/function.hpp"
 #include "../numeric/rng.hpp"
+#include "../utility/parallel.hpp"
 
 namespace platypus {
 namespace coalescent {
@@ -87,7 +101,9 @@ CoalescentTimeValueType random_time_to_coalescence(
         unsigned long num_lineages,
         double haploid_pop_size=1.0,
         unsigned long num_to_coalesce=2) {
-    auto rate = platypus::numeric::binomial_coefficient(num_lineages, num_to_coalesce);
+    auto rate = num_to_coalesce == 2
+        ? platypus::numeric::num_pairs(num_lineages)
+        : platypus::numeric::binomial_coefficient<double>(num_lineages, num_to_coalesce);
     auto tmrca = rng.exponential(rate);
     return tmrca * haploid_pop_size;
 }
@@ -113,10 +129,361 @@ inline CoalescentTimeValueType expected_time_to_coalescence(
         unsigned long num_lineages,
         double haploid_pop_size=1.0,
         unsigned long num_to_coalesce=2) {
-    auto tmrca = 1.0/platypus::numeric::binomial_coefficient(num_lineages, num_to_coalesce);
+    auto rate = num_to_coalesce == 2
+        ? platypus::numeric::num_pairs(num_lineages)
+        : platypus::numeric::binomial_coefficient<double>(num_lineages, num_to_coalesce);
+    auto tmrca = 1.0/rate;
     return tmrca * haploid_pop_size;
 }
 
+/**
+ * A history of the haploid population size, $N(t)$, going back in time
+ * from the present ($t = 0$), as a sequence of epochs. Within each epoch the
+ * population size changes exponentially: an epoch starting at time $s$ with
+ * size $N_s$ and growth rate $r$ has
+ *
+ *      $N(t) = N_s e^{-r (t - s)}$
+ *
+ * so that a positive rate means a population that has been growing towards
+ * the present, and a rate of 0 a constant size. Epochs are added in order of
+ * increasing start time, and the first starts at 0.
+ *
+ * The coalescence rate of $n$ lineages at time $t$ is $\choose{n, 2} /
+ * N(t)$. Waiting times are found by inverting the integrated rate,
+ * $\int 1 / N(t) dt$, in closed form within each epoch (see
+ * get_waiting_time()), so the cost of a draw depends on the number of
+ * epochs crossed, not on the length of the waiting time.
+ *
+ * If the last epoch has a negative growth rate, the population grows
+ * without bound going back in time, and the integrated rate may converge:
+ * get_waiting_time() then returns infinity for waiting times beyond reach.
+ */
+class Demography {
+
+    public:
+        struct Epoch {
+            CoalescentTimeValueType     start_time;
+            double                      haploid_pop_size;
+            double                      growth_rate;
+        };
+
+    public:
+
+        /**
+         * A single epoch, with haploid population size `haploid_pop_size`
+         * at the present and growth rate `growth_rate`.
+         */
+        explicit Demography(double haploid_pop_size=1.0, double growth_rate=0.0) {
+            this->add_epoch(0.0, haploid_pop_size, growth_rate);
+        }
+
+        /**
+         * A population whose size is `pop_sizes[i]` from times
+         * `start_times[i]` to `start_times[i+1]` (with `start_times[0]`
+         * being 0).
+         */
+        static Demography piecewise_constant(const std::vector<CoalescentTimeValueType> & start_times,
+                const std::vector<double> & pop_sizes) {
+            if (start_times.empty() || start_times.size() != pop_sizes.size()) {
+                throw std::invalid_argument("platypus::coalescent::Demography: expecting one population size per epoch");
+            }
+            if (start_times[0] != 0.0) {
+                throw std::invalid_argument("platypus::coalescent::Demography: first epoch must start at 0");
+            }
+            Demography demography(pop_sizes[0]);
+            for (std::size_t idx = 1; idx < start_times.size(); ++idx) {
+                demography.add_epoch(start_times[idx], pop_sizes[idx]);
+            }
+            return demography;
+        }
+
+        /**
+         * Appends an epoch starting at `start_time`, which must be later than
+         * the start of all existing epochs, with haploid population size
+         * `haploid_pop_size` at its start.
+         */
+        void add_epoch(CoalescentTimeValueType start_time, double haploid_pop_size, double growth_rate=0.0) {
+            if (!(haploid_pop_size > 0.0) || !std::isfinite(haploid_pop_size)) {
+                throw std::invalid_argument("platypus::coalescent::Demography: population size must be positive");
+            }
+            if (!std::isfinite(growth_rate)) {
+                throw std::invalid_argument("platypus::coalescent::Demography: growth rate must be finite");
+            }
+            if (this->epochs_.empty() ? start_time != 0.0 : !(start_time > this->epochs_.back().start_time)) {
+                throw std::invalid_argument("platypus::coalescent::Demography: epochs must be added in order of start time, from 0");
+            }
+            Epoch epoch = {start_time, haploid_pop_size, growth_rate};
+            this->epochs_.push_back(epoch);
+        }
+
+        const std::vector<Epoch> & epochs() const {
+            return this->epochs_;
+        }
+
+        bool is_constant() const {
+            return this->epochs_.size() == 1 && this->epochs_[0].growth_rate == 0.0;
+        }
+
+        // Haploid population size at time `t`.
+        double get_pop_size(CoalescentTimeValueType t) const {
+            const Epoch & epoch = this->epochs_[this->find_epoch(t)];
+            return epoch.haploid_pop_size * std::exp(-epoch.growth_rate * (t - epoch.start_time));
+        }
+
+        /**
+         * Returns $\int_{t_0}^{t_1} 1 / N(t) dt$: the time between `t0` and
+         * `t1` in units of the population size (i.e., as it would be with a
+         * constant population of size 1).
+         */
+        double get_scaled_time(CoalescentTimeValueType t0, CoalescentTimeValueType t1) const {
+            double scaled_time = 0.0;
+            std::size_t epoch_idx = this->find_epoch(t0);
+            while (t0 < t1) {
+                CoalescentTimeValueType epoch_end = this->get_epoch_end(epoch_idx);
+                CoalescentTimeValueType t = epoch_end < t1 ? epoch_end : t1;
+                scaled_time += this->get_epoch_scaled_time(epoch_idx, t0, t);
+                t0 = t;
+                ++epoch_idx;
+            }
+            return scaled_time;
+        }
+
+        /**
+         * Returns the time $w$ such that $\int_{t_0}^{t_0 + w} 1 / N(t) dt$
+         * equals `scaled_time`: i.e., maps a waiting time drawn for a
+         * population of constant size 1 to one starting at time `t0` in this
+         * population.
+         */
+        CoalescentTimeValueType get_waiting_time(CoalescentTimeValueType t0, double scaled_time) const {
+            std::size_t epoch_idx = this->find_epoch(t0);
+            CoalescentTimeValueType t = t0;
+            CoalescentTimeValueType waited = 0.0;
+            while (true) {
+                const Epoch & epoch = this->epochs_[epoch_idx];
+                double pop_size = epoch.haploid_pop_size * std::exp(-epoch.growth_rate * (t - epoch.start_time));
+                CoalescentTimeValueType epoch_end = this->get_epoch_end(epoch_idx);
+                CoalescentTimeValueType w = 0.0;
+                if (epoch.growth_rate == 0.0) {
+                    w = scaled_time * pop_size;
+                } else {
+                    // solves (exp(r * w) - 1) / (r * N(t)) = scaled_time
+                    double x = epoch.growth_rate * pop_size * scaled_time;
+                    w = x > -1.0 ? std::log1p(x) / epoch.growth_rate : std::numeric_limits<CoalescentTimeValueType>::infinity();
+                }
+                if (epoch_idx + 1 == this->epochs_.size() || t + w <= epoch_end) {
+                    return waited + w;
+                }
+                scaled_time -= this->get_epoch_scaled_time(epoch_idx, t, epoch_end);
+                waited += epoch_end - t;
+                t = epoch_end;
+                ++epoch_idx;
+            }
+        }
+
+    private:
+        std::size_t find_epoch(CoalescentTimeValueType t) const {
+            std::size_t epoch_idx = 0;
+            while (epoch_idx + 1 < this->epochs_.size() && this->epochs_[epoch_idx + 1].start_time <= t) {
+                ++epoch_idx;
+            }
+            return epoch_idx;
+        }
+
+        CoalescentTimeValueType get_epoch_end(std::size_t epoch_idx) const {
+            return epoch_idx + 1 < this->epochs_.size()
+                ? this->epochs_[epoch_idx + 1].start_time
+                : std::numeric_limits<CoalescentTimeValueType>::infinity();
+        }
+
+        // scaled time between `t0` and `t1`, both within epoch `epoch_idx`
+        double get_epoch_scaled_time(std::size_t epoch_idx, CoalescentTimeValueType t0, CoalescentTimeValueType t1) const {
+            const Epoch & epoch = this->epochs_[epoch_idx];
+            double pop_size = epoch.haploid_pop_size * std::exp(-epoch.growth_rate * (t0 - epoch.start_time));
+            if (epoch.growth_rate == 0.0) {
+                return (t1 - t0) / pop_size;
+            }
+            return std::expm1(epoch.growth_rate * (t1 - t0)) / (epoch.growth_rate * pop_size);
+        }
+
+    private:
+        std::vector<Epoch>      epochs_;
+
+}; // Demography
+
+/**
+ * The rates of the mergers of a Lambda-coalescent, tabulated once for up to
+ * a given number of lineages, for use with
+ * BasicCoalescentSimulator::generate_lambda_coalescent_tree().
+ *
+ * With $b$ lineages, each particular set of $k$ of them merges at rate
+ * $\lambda_{b,k} = \int_0^1 x^{k-2} (1-x)^{b-k} \Lambda(dx)$, so that mergers
+ * of any $k$ occur at rate $w_{b,k} = \choose{b, k} \lambda_{b,k}$, and of
+ * any size at rate $\lambda_b = \sum_{k=2}^b w_{b,k}$. The total rates, and
+ * an AliasTable over $w_{b,2}, \ldots, w_{b,K}$ for $K$ = min($b$,
+ * `max_tabulated_merger_size`), are computed for every $b$ on construction,
+ * so that drawing the size of a merger takes constant time. Mergers larger
+ * than $K$ share a single further entry of the table: when it is drawn, the
+ * size is found by walking the remaining weights. With heavy-tailed merger
+ * sizes this is rare, and it bounds the tables to $O(nK)$ entries rather
+ * than $O(n^2)$.
+ *
+ * The weights are obtained from $w_{b,2}$ by the ratios $w_{b,k+1} /
+ * w_{b,k}$, which are cheap to evaluate for the Beta-coalescent (see
+ * beta()) and other measures with a closed form.
+ *
+ * Instances are read-only once built, and may be shared by concurrent
+ * simulations.
+ */
+class LambdaCoalescentRates {
+
+    public:
+        // $w_{b,2}$, given $b$
+        typedef std::function<double (unsigned long)>                 first_weight_fntype;
+        // $w_{b,k+1} / w_{b,k}$, given $b$ and $k$
+        typedef std::function<double (unsigned long, unsigned long)>  weight_ratio_fntype;
+
+    public:
+
+        /**
+         * @param max_num_lineages
+         *   Largest number of lineages (i.e., sample size) to tabulate.
+         * @param first_weight_fn
+         *   Rate of mergers of two lineages among $b$.
+         * @param weight_ratio_fn
+         *   Ratio of the rates of mergers of $k+1$ and $k$ lineages among
+         *   $b$.
+         * @param max_tabulated_merger_size
+         *   Largest merger size with its own entry in the tables.
+         */
+        LambdaCoalescentRates(unsigned long max_num_lineages,
+                const first_weight_fntype & first_weight_fn,
+                const weight_ratio_fntype & weight_ratio_fn,
+                unsigned long max_tabulated_merger_size=256)
+            : max_num_lineages_(max_num_lineages)
+            , max_tabulated_merger_size_(max_tabulated_merger_size < 2 ? 2 : max_tabulated_merger_size)
+            , first_weight_fn_(first_weight_fn)
+            , weight_ratio_fn_(weight_ratio_fn)
+            , total_rates_(max_num_lineages + 1, 0.0)
+            , tail_first_weights_(max_num_lineages + 1, 0.0)
+            , tail_rates_(max_num_lineages + 1, 0.0)
+            , tables_(max_num_lineages + 1) {
+            std::vector<double> weights;
+            for (unsigned long b = 2; b <= max_num_lineages; ++b) {
+                weights.clear();
+                double weight = this->first_weight_fn_(b);
+                double total_rate = 0.0;
+                double tail_rate = 0.0;
+                for (unsigned long k = 2; k <= b; ++k) {
+                    if (k <= this->max_tabulated_merger_size_) {
+                        weights.push_back(weight);
+                    } else {
+                        if (k == this->max_tabulated_merger_size_ + 1) {
+                            this->tail_first_weights_[b] = weight;
+                        }
+                        tail_rate += weight;
+                    }
+                    total_rate += weight;
+                    if (k < b) {
+                        weight *= this->weight_ratio_fn_(b, k);
+                    }
+                }
+                if (tail_rate > 0.0) {
+                    weights.push_back(tail_rate);
+                }
+                this->total_rates_[b] = total_rate;
+                this->tail_rates_[b] = tail_rate;
+                this->tables_[b].assign(weights.begin(), weights.end());
+            }
+        }
+
+        /**
+         * Rates of the Beta($2 - \alpha$, $\alpha$)-coalescent, for $0 <
+         * \alpha < 2$, for which $\lambda_{b,k} = B(k - \alpha, b - k +
+         * \alpha) / B(2 - \alpha, \alpha)$. With $\alpha = 1$, this is the
+         * Bolthausen-Sznitman coalescent; as $\alpha$ approaches 2, it
+         * approaches the Kingman coalescent.
+         */
+        static LambdaCoalescentRates beta(double alpha,
+                unsigned long max_num_lineages,
+                unsigned long max_tabulated_merger_size=256) {
+            if (!(alpha > 0.0 && alpha < 2.0)) {
+                throw std::invalid_argument("platypus::coalescent::LambdaCoalescentRates: alpha must be in (0, 2)");
+            }
+            return LambdaCoalescentRates(max_num_lineages,
+                    [alpha] (unsigned long b) {
+                        // choose(b, 2) * B(2 - alpha, b - 2 + alpha) / B(2 - alpha, alpha)
+                        double n = static_cast<double>(b);
+                        return 0.5 * n * (n - 1.0) * std::exp(std::lgamma(n - 2.0 + alpha) - std::lgamma(n) - std::lgamma(alpha));
+                    },
+                    [alpha] (unsigned long b, unsigned long k) {
+                        double n = static_cast<double>(b);
+                        double m = static_cast<double>(k);
+                        return (n - m) / (m + 1.0) * (m - alpha) / (n - m - 1.0 + alpha);
+                    },
+                    max_tabulated_merger_size);
+        }
+
+        unsigned long max_num_lineages() const {
+            return this->max_num_lineages_;
+        }
+
+        // $\lambda_b$: the rate of mergers of any size among $b$ lineages.
+        double get_total_rate(unsigned long num_lineages) const {
+            return this->total_rates_[num_lineages];
+        }
+
+        // $w_{b,k}$: the rate of mergers of any $k$ of $b$ lineages.
+        double get_merger_rate(unsigned long num_lineages, unsigned long merger_size) const {
+            if (merger_size < 2 || merger_size > num_lineages) {
+                return 0.0;
+            }
+            double weight = this->first_weight_fn_(num_lineages);
+            for (unsigned long k = 2; k < merger_size; ++k) {
+                weight *= this->weight_ratio_fn_(num_lineages, k);
+            }
+            return weight;
+        }
+
+        /**
+         * Returns the number of lineages (at least 2) merging at an event
+         * among `num_lineages` lineages (at least 2, and at most
+         * max_num_lineages()).
+         */
+        template <class RngT>
+        unsigned long sample_merger_size(RngT & rng, unsigned long num_lineages) const {
+            const platypus::numeric::AliasTable & table = this->tables_[num_lineages];
+            std::size_t idx = table.sample(rng);
+            // the last entry stands for the untabulated mergers only if
+            // their rate did not underflow to 0 (see the constructor)
+            if (this->tail_rates_[num_lineages] == 0.0 || idx + 1 < table.size()) {
+                return static_cast<unsigned long>(idx) + 2;
+            }
+            double target = rng.uniform_real() * this->tail_rates_[num_lineages];
+            double weight = this->tail_first_weights_[num_lineages];
+            unsigned long k = this->max_tabulated_merger_size_ + 1;
+            for (; k < num_lineages; ++k) {
+                if (target < weight) {
+                    break;
+                }
+                target -= weight;
+                weight *= this->weight_ratio_fn_(num_lineages, k);
+            }
+            return k;
+        }
+
+    private:
+        unsigned long                                   max_num_lineages_;
+        unsigned long                                   max_tabulated_merger_size_;
+        first_weight_fntype                             first_weight_fn_;
+        weight_ratio_fntype                             weight_ratio_fn_;
+        std::vector<double>                             total_rates_;
+        // weight of the smallest merger not tabulated, and of all of them
+        std::vector<double>                             tail_first_weights_;
+        std::vector<double>                             tail_rates_;
+        std::vector<platypus::numeric::AliasTable>      tables_;
+
+}; // LambdaCoalescentRates
+
 /**
  * Simulates a trees under a pure, neutral coalescent regime.
  *
@@ -128,6 +495,20 @@ inline CoalescentTimeValueType expected_time_to_coalescence(
 template <typename TreeT, typename RngT=platypus::numeric::RandomNumberGenerator>
 class BasicCoalescentSimulator : public platypus::BaseTreeProducer<TreeT> {
 
+    public:
+
+        /**
+         * A gene lineage still evolving in the population: the node at its
+         * tip, and the time (measured from the present, i.e. the start of the
+         * simulation) at which it arose.
+         */
+        struct Lineage {
+            typename TreeT::node_type *     node;
+            CoalescentTimeValueType         birth_time;
+        };
+        typedef std::vector<Lineage>        lineage_pool_type;
+        typedef std::function<void (TreeT &, unsigned long)>    tree_sink_fntype;
+
     public:
 
         BasicCoalescentSimulator(RngT & rng,
@@ -202,18 +583,23 @@ class BasicCoalescentSimulator : public platypus::BaseTreeProducer<TreeT> {
                 iter leaf_values_end,
                 double haploid_pop_size,
                 bool use_expected_tmrca=false) {
+            InstrumentationTimer build_timer(this->stats_.build_seconds);
             auto & tree = this->create_new_tree();
             this->set_tree_is_rooted(tree, true);
-            std::map<typename TreeT::node_type *, CoalescentTimeValueType> nodes;
-            for (auto & leaf_iter = leaf_values_begin; leaf_iter != leaf_values_end; ++leaf_iter) {
-                typename TreeT::node_type * new_node = tree.create_leaf_node(*leaf_iter);
-                nodes[new_node] = 0.0;
+            lineage_pool_type lineages;
+            for (auto leaf_iter = leaf_values_begin; leaf_iter != leaf_values_end; ++leaf_iter) {
+                Lineage lineage = {tree.create_leaf_node(*leaf_iter), 0.0};
+                lineages.push_back(lineage);
             }
+            // each coalescence adds one node
+            this->stats_.record_tree(lineages.empty() ? 0 : 2 * lineages.size() - 1);
+            CoalescentTimeValueType current_time = 0.0;
             CoalescentTimeValueType time_expended = 0.0;
-            while (nodes.size() > 1) {
+            while (lineages.size() > 1) {
                 this->simulate_basic_coalescent_event(
                         tree,
-                        nodes,
+                        lineages,
+                        current_time,
                         time_expended,
                         haploid_pop_size,
                         0.0,
@@ -240,6 +626,429 @@ class BasicCoalescentSimulator : public platypus::BaseTreeProducer<TreeT> {
                     );
         }
 
+        /**
+         * As generate_fixed_pop_size_tree(), but with the population size
+         * changing through time according to `demography`. Waiting times to
+         * coalescence are drawn as for a population of size 1 (or, if
+         * `use_expected_tmrca` is `true`, set to their expectation), and
+         * mapped to the population history by
+         * Demography::get_waiting_time(); with a constant demography, the
+         * trees are those of generate_fixed_pop_size_tree() for the same
+         * random number sequence.
+         *
+         * @return
+         *   A reference to the tree simulated.
+         */
+        template <typename iter>
+        TreeT & generate_variable_pop_size_tree(
+                iter leaf_values_begin,
+                iter leaf_values_end,
+                const Demography & demography,
+                bool use_expected_tmrca=false) {
+            InstrumentationTimer build_timer(this->stats_.build_seconds);
+            auto & tree = this->create_new_tree();
+            this->set_tree_is_rooted(tree, true);
+            lineage_pool_type lineages;
+            for (auto leaf_iter = leaf_values_begin; leaf_iter != leaf_values_end; ++leaf_iter) {
+                Lineage lineage = {tree.create_leaf_node(*leaf_iter), 0.0};
+                lineages.push_back(lineage);
+            }
+            this->stats_.record_tree(lineages.empty() ? 0 : 2 * lineages.size() - 1);
+            CoalescentTimeValueType current_time = 0.0;
+            CoalescentTimeValueType time_expended = 0.0;
+            while (lineages.size() > 1) {
+                this->simulate_variable_pop_size_coalescent_event(
+                        tree,
+                        lineages,
+                        current_time,
+                        time_expended,
+                        demography,
+                        0.0,
+                        use_expected_tmrca);
+            }
+            return tree;
+        }
+
+        TreeT & generate_variable_pop_size_tree(unsigned long num_leaves,
+                const Demography & demography,
+                bool use_expected_tmrca=false) {
+            std::vector<typename TreeT::value_type> leaves;
+            for (unsigned long i = 0; i < num_leaves; ++i) {
+                leaves.emplace_back();
+                this->set_node_value_label(leaves.back(), "T" + std::to_string(i));
+            }
+            return this->generate_variable_pop_size_tree(
+                    leaves.begin(),
+                    leaves.end(),
+                    demography,
+                    use_expected_tmrca);
+        }
+
+        /**
+         * Generates a tree under a Lambda-coalescent (e.g., the
+         * Beta-coalescent; see LambdaCoalescentRates::beta()), in which any
+         * number of lineages may merge at an event, so that nodes may have
+         * more than two children. Waiting times are drawn from the total
+         * merger rate tabulated in `rates` for the current number of
+         * lineages and multiplied by `time_scale`, and merger sizes are
+         * drawn from its tables in constant time.
+         *
+         * @return
+         *   A reference to the tree simulated.
+         */
+        template <typename iter>
+        TreeT & generate_lambda_coalescent_tree(
+                iter leaf_values_begin,
+                iter leaf_values_end,
+                const LambdaCoalescentRates & rates,
+                double time_scale=1.0) {
+            InstrumentationTimer build_timer(this->stats_.build_seconds);
+            auto & tree = this->create_new_tree();
+            this->set_tree_is_rooted(tree, true);
+            lineage_pool_type lineages;
+            for (auto leaf_iter = leaf_values_begin; leaf_iter != leaf_values_end; ++leaf_iter) {
+                Lineage lineage = {tree.create_leaf_node(*leaf_iter), 0.0};
+                lineages.push_back(lineage);
+            }
+            if (lineages.size() > rates.max_num_lineages() && lineages.size() > 1) {
+                throw std::invalid_argument("platypus::coalescent::BasicCoalescentSimulator: more lineages than tabulated merger rates");
+            }
+            unsigned long num_leaves = lineages.size();
+            CoalescentTimeValueType current_time = 0.0;
+            CoalescentTimeValueType time_expended = 0.0;
+            unsigned long num_nodes = num_leaves;
+            while (lineages.size() > 1) {
+                this->simulate_lambda_coalescent_event(
+                        tree,
+                        lineages,
+                        current_time,
+                        time_expended,
+                        rates,
+                        time_scale);
+                ++num_nodes;
+            }
+            this->stats_.record_tree(num_nodes);
+            return tree;
+        }
+
+        TreeT & generate_lambda_coalescent_tree(unsigned long num_leaves,
+                const LambdaCoalescentRates & rates,
+                double time_scale=1.0) {
+            std::vector<typename TreeT::value_type> leaves;
+            for (unsigned long i = 0; i < num_leaves; ++i) {
+                leaves.emplace_back();
+                this->set_node_value_label(leaves.back(), "T" + std::to_string(i));
+            }
+            return this->generate_lambda_coalescent_tree(
+                    leaves.begin(),
+                    leaves.end(),
+                    rates,
+                    time_scale);
+        }
+
+        /**
+         * Generates `num_trees` coalescent trees of `num_leaves` tips under a
+         * fixed population size, distributing the work across `num_threads`
+         * threads (0 = one per hardware thread), and passes each tree and
+         * its 0-based index to `tree_sink` in index order, from the calling
+         * thread.
+         *
+         * Each replicate is simulated with its own random number generator,
+         * created by platypus::numeric::ReplicateRandomNumberGenerator from
+         * `master_seed` and the replicate index (i.e., seeded with
+         * platypus::numeric::derive_seed(`master_seed`, index), or, for
+         * platypus::numeric::CounterRandomNumberGenerator, using stream
+         * `index` of key `master_seed`), so the trees produced depend only
+         * on `master_seed`, and not on the number of threads used. Trees are
+         * built in (re-used) TreeT objects owned by this function, not those
+         * given by the tree factory, so `tree_sink` must copy or move out
+         * anything it wants to keep.
+         *
+         * @return
+         *   The number of trees generated.
+         */
+        unsigned long generate_batch(
+                unsigned long num_trees,
+                unsigned long num_leaves,
+                double haploid_pop_size,
+                unsigned int num_threads,
+                const tree_sink_fntype & tree_sink,
+                std::uint64_t master_seed,
+                bool use_expected_tmrca=false) {
+            return this->generate_batch_range(0,
+                    num_trees,
+                    num_leaves,
+                    haploid_pop_size,
+                    num_threads,
+                    tree_sink,
+                    master_seed,
+                    use_expected_tmrca);
+        }
+
+        /**
+         * As generate_batch(), but generates only the replicates with indexes
+         * in [`begin_idx`, `end_idx`): these are identical to the
+         * corresponding trees of a full batch with the same `master_seed`,
+         * so that a large batch can be split into shards run separately
+         * (e.g., on different machines), and any one shard re-run on its
+         * own. Trees are passed to `tree_sink` with their index in the full
+         * batch.
+         *
+         * @return
+         *   The number of trees generated.
+         */
+        unsigned long generate_batch_range(
+                unsigned long begin_idx,
+                unsigned long end_idx,
+                unsigned long num_leaves,
+                double haploid_pop_size,
+                unsigned int num_threads,
+                const tree_sink_fntype & tree_sink,
+                std::uint64_t master_seed,
+                bool use_expected_tmrca=false) {
+            return this->generate_replicates(begin_idx, end_idx, num_leaves, num_threads, tree_sink, master_seed,
+                    [haploid_pop_size, use_expected_tmrca] (BasicCoalescentSimulator & simulator,
+                        const std::vector<typename TreeT::value_type> & leaves) {
+                        simulator.generate_fixed_pop_size_tree(leaves.begin(), leaves.end(), haploid_pop_size, use_expected_tmrca);
+                    });
+        }
+
+        /**
+         * As generate_batch() and generate_batch_range() above, but with the
+         * population size changing through time according to `demography`
+         * (see generate_variable_pop_size_tree()).
+         *
+         * @return
+         *   The number of trees generated.
+         */
+        unsigned long generate_batch(
+                unsigned long num_trees,
+                unsigned long num_leaves,
+                const Demography & demography,
+                unsigned int num_threads,
+                const tree_sink_fntype & tree_sink,
+                std::uint64_t master_seed,
+                bool use_expected_tmrca=false) {
+            return this->generate_batch_range(0,
+                    num_trees,
+                    num_leaves,
+                    demography,
+                    num_threads,
+                    tree_sink,
+                    master_seed,
+                    use_expected_tmrca);
+        }
+
+        unsigned long generate_batch_range(
+                unsigned long begin_idx,
+                unsigned long end_idx,
+                unsigned long num_leaves,
+                const Demography & demography,
+                unsigned int num_threads,
+                const tree_sink_fntype & tree_sink,
+                std::uint64_t master_seed,
+                bool use_expected_tmrca=false) {
+            return this->generate_replicates(begin_idx, end_idx, num_leaves, num_threads, tree_sink, master_seed,
+                    [&demography, use_expected_tmrca] (BasicCoalescentSimulator & simulator,
+                        const std::vector<typename TreeT::value_type> & leaves) {
+                        simulator.generate_variable_pop_size_tree(leaves.begin(), leaves.end(), demography, use_expected_tmrca);
+                    });
+        }
+
+        /**
+         * As generate_batch() and generate_batch_range() above, but under a
+         * Lambda-coalescent (see generate_lambda_coalescent_tree()). The
+         * tables of `rates` are shared by all threads.
+         *
+         * @return
+         *   The number of trees generated.
+         */
+        unsigned long generate_batch(
+                unsigned long num_trees,
+                unsigned long num_leaves,
+                const LambdaCoalescentRates & rates,
+                unsigned int num_threads,
+                const tree_sink_fntype & tree_sink,
+                std::uint64_t master_seed,
+                double time_scale=1.0) {
+            return this->generate_batch_range(0,
+                    num_trees,
+                    num_leaves,
+                    rates,
+                    num_threads,
+                    tree_sink,
+                    master_seed,
+                    time_scale);
+        }
+
+        unsigned long generate_batch_range(
+                unsigned long begin_idx,
+                unsigned long end_idx,
+                unsigned long num_leaves,
+                const LambdaCoalescentRates & rates,
+                unsigned int num_threads,
+                const tree_sink_fntype & tree_sink,
+                std::uint64_t master_seed,
+                double time_scale=1.0) {
+            return this->generate_replicates(begin_idx, end_idx, num_leaves, num_threads, tree_sink, master_seed,
+                    [&rates, time_scale] (BasicCoalescentSimulator & simulator,
+                        const std::vector<typename TreeT::value_type> & leaves) {
+                        simulator.generate_lambda_coalescent_tree(leaves.begin(), leaves.end(), rates, time_scale);
+                    });
+        }
+
+        /**
+         * As above, but with the master seed drawn from this simulator's
+         * random number generator.
+         */
+        unsigned long generate_batch(
+                unsigned long num_trees,
+                unsigned long num_leaves,
+                double haploid_pop_size,
+                unsigned int num_threads,
+                const tree_sink_fntype & tree_sink) {
+            assert(this->rng_ptr_);
+            std::uint64_t master_seed = this->rng_ptr_->uniform_pos_int(std::numeric_limits<unsigned long>::max());
+            return this->generate_batch(num_trees, num_leaves, haploid_pop_size, num_threads, tree_sink, master_seed);
+        }
+
+        /**
+         * Generates a gene tree contained within (i.e., evolving under the
+         * multispecies coalescent on) a species tree.
+         *
+         * Gene lineages are sampled at the leaves of `species_tree`, and
+         * coalesce along each branch of the species tree in a population of
+         * the branch's own size, for the duration of the branch. Lineages
+         * that have not coalesced by the end of a branch pass into the
+         * ancestral population, where they join the lineages from the
+         * sibling branches. Lineages remaining at the root of the species
+         * tree coalesce without time limit.
+         *
+         * Species tree branches are processed in postorder, with the lineage
+         * pool of each branch handed on by moving it into the pool of its
+         * parent, so pools are never copied. The age of each species tree
+         * node is taken to be the maximum, over its children, of the age of
+         * the child plus the length of the edge subtending it: i.e.,
+         * `species_tree` is assumed to be ultrametric, with the leaves at
+         * age 0.
+         *
+         * @param species_tree
+         *   Tree (any platypus::Tree type) giving the containing species
+         *   tree.
+         * @param num_genes_fn
+         *   Given the value of a species tree leaf node, returns the number of
+         *   genes sampled from that species.
+         * @param pop_size_fn
+         *   Given the value of a species tree node, returns the haploid
+         *   population size of the edge subtending it.
+         * @param species_edge_length_fn
+         *   Given the value of a species tree node, returns the length
+         *   (duration) of the edge subtending it.
+         * @param gene_label_fn
+         *   Given the value of a species tree leaf node and the 0-based index
+         *   of a gene sampled from it, returns the label for that gene.
+         * @param use_expected_tmrca
+         *   If `true`, then instead of a exponential randomvariate for the
+         *   waiting time to coalescent events, the mean time will be used.
+         * @return
+         *   A reference to the tree simulated.
+         */
+        template <typename SpeciesTreeT>
+        TreeT & generate_contained_tree(
+                const SpeciesTreeT & species_tree,
+                const std::function<unsigned long (const typename SpeciesTreeT::value_type &)> & num_genes_fn,
+                const std::function<double (const typename SpeciesTreeT::value_type &)> & pop_size_fn,
+                const std::function<double (const typename SpeciesTreeT::value_type &)> & species_edge_length_fn,
+                const std::function<std::string (const typename SpeciesTreeT::value_type &, unsigned long)> & gene_label_fn,
+                bool use_expected_tmrca=false) {
+            typedef typename SpeciesTreeT::node_type species_node_type;
+            struct SpeciesLineages {
+                lineage_pool_type           lineages;
+                CoalescentTimeValueType     age;
+            };
+            std::unordered_map<const species_node_type *, SpeciesLineages> open_species;
+            auto & tree = this->create_new_tree();
+            this->set_tree_is_rooted(tree, true);
+            CoalescentTimeValueType time_expended = 0.0;
+            for (auto spi = species_tree.postorder_begin(); spi != species_tree.postorder_end(); ++spi) {
+                const species_node_type * species_node = spi.node();
+                SpeciesLineages & current = open_species[species_node];
+                current.age = 0.0;
+                if (species_node->is_leaf()) {
+                    unsigned long num_genes = num_genes_fn(*spi);
+                    current.lineages.reserve(num_genes);
+                    for (unsigned long i = 0; i < num_genes; ++i) {
+                        Lineage lineage = {tree.create_leaf_node(), 0.0};
+                        this->set_node_value_label(lineage.node->value(), gene_label_fn(*spi, i));
+                        current.lineages.push_back(lineage);
+                    }
+                    continue;
+                }
+                for (auto ch = species_node->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                    CoalescentTimeValueType ch_top = open_species[ch].age + species_edge_length_fn(ch->value());
+                    if (ch_top > current.age) {
+                        current.age = ch_top;
+                    }
+                }
+                for (auto ch = species_node->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                    auto ch_iter = open_species.find(ch);
+                    SpeciesLineages & child = ch_iter->second;
+                    CoalescentTimeValueType current_time = child.age;
+                    double pop_size = pop_size_fn(ch->value());
+                    while (child.lineages.size() > 1) {
+                        // note: a time available of 0 would mean "unlimited"
+                        CoalescentTimeValueType time_available = current.age - current_time;
+                        if (time_available <= 0.0 || this->simulate_basic_coalescent_event(
+                                    tree,
+                                    child.lineages,
+                                    current_time,
+                                    time_expended,
+                                    pop_size,
+                                    time_available,
+                                    use_expected_tmrca) == nullptr) {
+                            break;
+                        }
+                    }
+                    if (current.lineages.size() < child.lineages.size()) {
+                        current.lineages.swap(child.lineages);
+                    }
+                    current.lineages.insert(current.lineages.end(), child.lineages.begin(), child.lineages.end());
+                    open_species.erase(ch_iter);
+                }
+            }
+            SpeciesLineages & root = open_species[species_tree.head_node()];
+            CoalescentTimeValueType current_time = root.age;
+            double pop_size = pop_size_fn(species_tree.head_node()->value());
+            while (root.lineages.size() > 1) {
+                this->simulate_basic_coalescent_event(
+                        tree,
+                        root.lineages,
+                        current_time,
+                        time_expended,
+                        pop_size,
+                        0.0,
+                        use_expected_tmrca);
+            }
+            if (root.lineages.size() == 1 && root.lineages[0].node != tree.head_node()) {
+                // all lineages coalesced below the root of the species tree
+                // (or only a single gene was sampled): the last remaining
+                // lineage becomes the root
+                auto final_node = root.lineages[0].node;
+                std::vector<typename TreeT::node_type *> children;
+                for (auto ch = final_node->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                    children.push_back(ch);
+                }
+                for (auto ch : children) {
+                    tree.head_node()->add_child(ch);
+                }
+                tree.head_node()->value() = final_node->value();
+                this->set_node_value_edge_length(tree.head_node()->value(), 0.0);
+                final_node->clear_links();
+                tree.dispose_node(final_node);
+            }
+            return tree;
+        }
+
         /**
          * Simulates a single coalescence event in a sample of TreeT::node_type
          * pointers to nodes representing gene lineages evolving in a
@@ -266,6 +1075,10 @@ class BasicCoalescentSimulator : public platypus::BaseTreeProducer<TreeT> {
          * $t$, and a pointer to the new ancestral node created will be
          * returned.
          *
+         * If the pool holds only two lineages and no limit is placed on the
+         * time available, then the coalescence is the final one of the tree,
+         * and the ancestral node is the root (head node) of `tree`.
+         *
          * If $t$ is greater than `time_available` or `time_available` is
          * $<0$, the no coalescence occurs. In this case, the pool remains
          * unchanged. The variable `time_expended` will be set equal to
@@ -287,7 +1100,7 @@ class BasicCoalescentSimulator : public platypus::BaseTreeProducer<TreeT> {
                 TreeT & tree,
                 std::map<typename TreeT::node_type *, CoalescentTimeValueType> & nodes,
                 CoalescentTimeValueType & time_expended,
-                unsigned long haploid_pop_size,
+                double haploid_pop_size,
                 CoalescentTimeValueType time_available=0.0,
                 bool use_expected_tmrca=false) {
             if (nodes.size() < 2) {
@@ -304,16 +1117,14 @@ class BasicCoalescentSimulator : public platypus::BaseTreeProducer<TreeT> {
             if (use_expected_tmrca) {
                 tmrca = expected_time_to_coalescence(nodes.size(), haploid_pop_size, 2);
             } else {
-                assert(this->rng_ptr_);
-                tmrca = random_time_to_coalescence(*(this->rng_ptr_), nodes.size(), haploid_pop_size, 2);
+                tmrca = this->random_waiting_time(nodes.size(), haploid_pop_size);
             }
-            tmrca = tmrca * haploid_pop_size;
             if (time_available <= 0.0 || tmrca <= time_available) {
                 for (auto & nde : nodes) {
                     nde.second += tmrca;
                 }
                 typename TreeT::node_type * anc = nullptr;
-                if (nodes.size() > 2) {
+                if (nodes.size() > 2 || time_available > 0.0) {
                     anc = tree.create_internal_node();
                     typename TreeT::node_type * ch = nullptr;
                     for (unsigned int i = 0; i < 2; ++i) {
@@ -344,12 +1155,532 @@ class BasicCoalescentSimulator : public platypus::BaseTreeProducer<TreeT> {
             return nullptr;
         }
 
+        /**
+         * As above, but with the gene lineages held in a vector rather than a
+         * map, so that each event takes constant time regardless of the
+         * number of lineages.
+         *
+         * Instead of incrementing the edge length of every lineage in the
+         * pool at every event, each lineage records the time at which it
+         * arose, and a single clock, `current_time`, records the time
+         * elapsed since the start of the simulation. When a coalescence
+         * occurs, `current_time` is advanced by the waiting time, and the
+         * edge length of each coalescing lineage is set to the difference
+         * between `current_time` and its birth time. Coalescing lineages are
+         * picked by index and removed by swapping with the last element of
+         * the pool, so the order of the lineages in the pool is not
+         * preserved.
+         *
+         * If no coalescence occurs, `current_time` is advanced by
+         * `time_available`, and the pool remains unchanged.
+         *
+         * @param lineages
+         *   Pool of gene lineages still evolving in the population.
+         * @param current_time
+         *   The time elapsed since the start of the simulation (i.e., since
+         *   the lineages with a birth time of 0 arose); updated to the time
+         *   at the end of the event.
+         * @param time_expended
+         * @param haploid_pop_size
+         * @param time_available
+         * @param use_expected_tmrca
+         *
+         * @return
+         *   The new ancestral node, or `nullptr` if no coalescence occurred.
+         */
+        typename TreeT::node_type * simulate_basic_coalescent_event(
+                TreeT & tree,
+                lineage_pool_type & lineages,
+                CoalescentTimeValueType & current_time,
+                CoalescentTimeValueType & time_expended,
+                double haploid_pop_size,
+                CoalescentTimeValueType time_available=0.0,
+                bool use_expected_tmrca=false) {
+            if (lineages.size() < 2) {
+                time_expended = 0.0;
+                return nullptr;
+            }
+            if (time_available < 0.0) {
+                time_available = 0.0;
+            }
+            if (haploid_pop_size < 0.0) {
+                throw std::logic_error("Population size cannot be less than 0");
+            }
+            CoalescentTimeValueType tmrca = 0.0;
+            if (use_expected_tmrca) {
+                tmrca = expected_time_to_coalescence(lineages.size(), haploid_pop_size, 2);
+            } else {
+                tmrca = this->random_waiting_time(lineages.size(), haploid_pop_size);
+            }
+            if (time_available > 0.0 && tmrca > time_available) {
+                current_time += time_available;
+                time_expended = time_available;
+                return nullptr;
+            }
+            current_time += tmrca;
+            typename TreeT::node_type * anc = this->join_lineages(tree, lineages, current_time, time_available);
+            time_expended = tmrca;
+            return anc;
+        }
+
+        /**
+         * As above, but with the population size changing through time
+         * according to `demography`: the waiting time is drawn as for a
+         * population of size 1 (or set to its expectation), and mapped by
+         * Demography::get_waiting_time() to the population history from
+         * `current_time`.
+         *
+         * @return
+         *   The new ancestral node, or `nullptr` if no coalescence occurred.
+         */
+        typename TreeT::node_type * simulate_variable_pop_size_coalescent_event(
+                TreeT & tree,
+                lineage_pool_type & lineages,
+                CoalescentTimeValueType & current_time,
+                CoalescentTimeValueType & time_expended,
+                const Demography & demography,
+                CoalescentTimeValueType time_available=0.0,
+                bool use_expected_tmrca=false) {
+            if (lineages.size() < 2) {
+                time_expended = 0.0;
+                return nullptr;
+            }
+            if (time_available < 0.0) {
+                time_available = 0.0;
+            }
+            CoalescentTimeValueType scaled_time = use_expected_tmrca
+                ? expected_time_to_coalescence(lineages.size(), 1.0, 2)
+                : this->random_waiting_time(lineages.size(), 1.0);
+            CoalescentTimeValueType tmrca = demography.get_waiting_time(current_time, scaled_time);
+            if (time_available > 0.0 && tmrca > time_available) {
+                current_time += time_available;
+                time_expended = time_available;
+                return nullptr;
+            }
+            if (std::isinf(tmrca)) {
+                throw std::logic_error("platypus::coalescent::BasicCoalescentSimulator: lineages never coalesce under demography");
+            }
+            current_time += tmrca;
+            typename TreeT::node_type * anc = this->join_lineages(tree, lineages, current_time, time_available);
+            time_expended = tmrca;
+            return anc;
+        }
+
+        /**
+         * As above, but under a Lambda-coalescent with merger rates
+         * `rates` (with waiting times multiplied by `time_scale`), merging a
+         * random number of lineages.
+         *
+         * @return
+         *   The new ancestral node, or `nullptr` if no coalescence occurred.
+         */
+        typename TreeT::node_type * simulate_lambda_coalescent_event(
+                TreeT & tree,
+                lineage_pool_type & lineages,
+                CoalescentTimeValueType & current_time,
+                CoalescentTimeValueType & time_expended,
+                const LambdaCoalescentRates & rates,
+                double time_scale=1.0,
+                CoalescentTimeValueType time_available=0.0) {
+            if (lineages.size() < 2) {
+                time_expended = 0.0;
+                return nullptr;
+            }
+            if (time_available < 0.0) {
+                time_available = 0.0;
+            }
+            CoalescentTimeValueType tmrca = this->random_exponential(rates.get_total_rate(lineages.size())) * time_scale;
+            if (time_available > 0.0 && tmrca > time_available) {
+                current_time += time_available;
+                time_expended = time_available;
+                return nullptr;
+            }
+            assert(this->rng_ptr_);
+            unsigned long num_to_join = rates.sample_merger_size(*(this->rng_ptr_), lineages.size());
+            current_time += tmrca;
+            typename TreeT::node_type * anc = this->join_lineages(tree, lineages, current_time, time_available, num_to_join);
+            time_expended = tmrca;
+            return anc;
+        }
+
+        /**
+         * Draws the random waiting times to coalescence from a separate
+         * random number generator, seeded with `seed`, through a
+         * platypus::numeric::ExponentialVariateBuffer with the given block
+         * size, instead of from the main random number generator. Trees
+         * simulated depend on `seed` (as well as the seed of the main random
+         * number generator), but not on `block_size`: in particular, a block
+         * size of 1 yields the same trees as drawing each waiting time
+         * individually.
+         */
+        void set_buffered_waiting_times(std::uint64_t seed, std::size_t block_size=256) {
+            this->waiting_time_rng_.reset(new RngT(static_cast<typename RngT::RandomSeedType>(seed)));
+            this->waiting_time_buffer_.reset(new platypus::numeric::ExponentialVariateBuffer<RngT>(*this->waiting_time_rng_, block_size));
+        }
+
+        void clear_buffered_waiting_times() {
+            this->waiting_time_buffer_.reset();
+            this->waiting_time_rng_.reset();
+        }
+
+        bool has_buffered_waiting_times() const {
+            return static_cast<bool>(this->waiting_time_buffer_);
+        }
+
     private:
-        RngT *      rng_ptr_;
-        bool        allocated_rng_;
+
+        // Simulates replicates [`begin_idx`, `end_idx`) for the batch
+        // functions, each by `simulate_fn` with a replicate simulator.
+        template <typename SimulateFnT>
+        unsigned long generate_replicates(
+                unsigned long begin_idx,
+                unsigned long end_idx,
+                unsigned long num_leaves,
+                unsigned int num_threads,
+                const tree_sink_fntype & tree_sink,
+                std::uint64_t master_seed,
+                SimulateFnT simulate_fn) {
+            if (end_idx <= begin_idx) {
+                return 0;
+            }
+            unsigned long num_trees = end_idx - begin_idx;
+            num_threads = resolve_num_threads(num_threads);
+            std::vector<typename TreeT::value_type> leaves;
+            for (unsigned long i = 0; i < num_leaves; ++i) {
+                leaves.emplace_back();
+                this->set_node_value_label(leaves.back(), "T" + std::to_string(i));
+            }
+            unsigned long batch_size = static_cast<unsigned long>(num_threads) * 16;
+            std::vector<TreeT> trees(batch_size < num_trees ? batch_size : num_trees);
+            // nodes of each tree, as recorded by its replicate simulator
+            std::vector<unsigned long> tree_num_nodes(trees.size());
+            for (unsigned long batch_start = begin_idx; batch_start < end_idx; batch_start += batch_size) {
+                unsigned long batch_end = batch_start + batch_size;
+                if (batch_end > end_idx) {
+                    batch_end = end_idx;
+                }
+                InstrumentationTimer build_timer(this->stats_.build_seconds);
+                parallel_for(batch_end - batch_start, num_threads, [&] (std::size_t task_idx) {
+                    TreeT & tree = trees[task_idx];
+                    tree.clear();
+                    RngT rng = platypus::numeric::ReplicateRandomNumberGenerator<RngT>::create(
+                            master_seed, batch_start + task_idx);
+                    BasicCoalescentSimulator<TreeT, RngT> replicate_simulator(rng,
+                            [&tree] () -> TreeT & { return tree; },
+                            this->tree_is_rooted_setter_,
+                            this->node_value_label_setter_,
+                            this->node_value_edge_length_setter_);
+                    if (this->waiting_time_buffer_) {
+                        replicate_simulator.set_buffered_waiting_times(
+                                platypus::numeric::derive_seed(~master_seed, batch_start + task_idx),
+                                this->waiting_time_buffer_->block_size());
+                    }
+                    simulate_fn(replicate_simulator, leaves);
+                    tree_num_nodes[task_idx] = replicate_simulator.get_stats().num_nodes;
+                });
+                build_timer.stop();
+                for (unsigned long idx = batch_start; idx < batch_end; ++idx) {
+                    this->stats_.record_tree(tree_num_nodes[idx - batch_start]);
+                    tree_sink(trees[idx - batch_start], idx);
+                }
+            }
+            return num_trees;
+        }
+
+        // Joins `num_to_join` lineages picked at random (or, if they are the
+        // last ones and the time available is unlimited, under the head node
+        // of `tree`) at `current_time`.
+        typename TreeT::node_type * join_lineages(
+                TreeT & tree,
+                lineage_pool_type & lineages,
+                CoalescentTimeValueType current_time,
+                CoalescentTimeValueType time_available,
+                unsigned long num_to_join=2) {
+            typename TreeT::node_type * anc = nullptr;
+            if (lineages.size() > num_to_join || time_available > 0.0) {
+                anc = tree.create_internal_node();
+                for (unsigned long i = 0; i < num_to_join; ++i) {
+                    auto idx = this->rng_ptr_->uniform_pos_int(lineages.size()-1);
+                    Lineage & lineage = lineages[idx];
+                    this->set_node_value_edge_length(lineage.node->value(), current_time - lineage.birth_time);
+                    anc->add_child(lineage.node);
+                    lineage = lineages.back();
+                    lineages.pop_back();
+                }
+            } else {
+                anc = tree.head_node();
+                for (auto & lineage : lineages) {
+                    this->set_node_value_edge_length(lineage.node->value(), current_time - lineage.birth_time);
+                    anc->add_child(lineage.node);
+                }
+                lineages.clear();
+                this->set_node_value_edge_length(anc->value(), 0.0);
+            }
+            Lineage anc_lineage = {anc, current_time};
+            lineages.push_back(anc_lineage);
+            return anc;
+        }
+
+        CoalescentTimeValueType random_exponential(double rate) {
+            if (this->waiting_time_buffer_) {
+                return this->waiting_time_buffer_->exponential(rate);
+            }
+            assert(this->rng_ptr_);
+            return this->rng_ptr_->exponential(rate);
+        }
+
+        CoalescentTimeValueType random_waiting_time(unsigned long num_lineages, double haploid_pop_size) {
+            if (this->waiting_time_buffer_) {
+                return random_time_to_coalescence(*(this->waiting_time_buffer_), num_lineages, haploid_pop_size, 2);
+            }
+            assert(this->rng_ptr_);
+            return random_time_to_coalescence(*(this->rng_ptr_), num_lineages, haploid_pop_size, 2);
+        }
+
+    private:
+        RngT *                                                              rng_ptr_;
+        bool                                                                allocated_rng_;
+        std::unique_ptr<RngT>                                               waiting_time_rng_;
+        std::unique_ptr<platypus::numeric::ExponentialVariateBuffer<RngT>>  waiting_time_buffer_;
 
 }; // BasicCoalescentSimulator
 
+/**
+ * Evaluates the log density of the node ages of rooted trees (with edge
+ * lengths in units of time, e.g. trees simulated by
+ * BasicCoalescentSimulator, or a posterior sample of dated trees) under the
+ * (Kingman) coalescent, for a constant haploid population size or one
+ * given by a Demography:
+ *
+ *      platypus::coalescent::CoalescentDensity<TreeType> density(
+ *              [](const NodeValue & nv) { return nv.get_edge_length(); });
+ *      density.compute_intervals(tree);
+ *      double log_density = density.get_log_density(haploid_pop_size);
+ *      // trees by population sizes, e.g. for a likelihood profile
+ *      std::vector<double> values = density.get_log_densities(
+ *              trees.cbegin(), trees.cend(), pop_sizes, num_threads);
+ *
+ * As for platypus::LineagesThroughTime, the present is the time of the
+ * leaf furthest from the root, and leaves closer to the root are samples
+ * taken that much earlier, which join the lineages from their age onwards;
+ * ages within the tolerance (relative to the root-to-tip distance) of the
+ * present are taken to be the present. The density is that of the times of
+ * the coalescences given the sampling times: with $k$ lineages, the rate of
+ * coalescence at time $t$ is $\binom{k}{2} / N(t)$, so each interval
+ * contributes $-\binom{k}{2} \int 1 / N(t) dt$ (see
+ * Demography::get_scaled_time()), and each coalescence at time $t$ a
+ * further $-\log N(t)$. Trees with nodes of more than two children have no
+ * density under the Kingman coalescent, and get a log density of negative
+ * infinity.
+ *
+ * The node ages of a tree are sorted once, by compute_intervals(), into the
+ * intervals between events, which are then reused for any number of
+ * population sizes: for a constant size, the density only needs two sums
+ * over them.
+ */
+template <class TreeT>
+class CoalescentDensity {
+
+    public:
+        typedef NodeAges<TreeT, CoalescentTimeValueType>            node_ages_type;
+        typedef typename node_ages_type::edge_length_getter_type   edge_length_getter_type;
+
+    public:
+        CoalescentDensity(const edge_length_getter_type & edge_length_getter, double tolerance=1e-6)
+            : node_ages_(edge_length_getter, tolerance)
+            , sum_scaled_pairs_(0.0)
+            , is_binary_(true) { }
+
+        // Copies the configuration, but not the intervals of the last tree.
+        CoalescentDensity(const CoalescentDensity & other)
+            : node_ages_(other.node_ages_)
+            , sum_scaled_pairs_(0.0)
+            , is_binary_(true) { }
+
+        /**
+         * Computes the intervals between the sampling and coalescence
+         * events of ``tree``, which are held until the next call.
+         *
+         * @return
+         *   The number of coalescences.
+         */
+        std::size_t compute_intervals(const TreeT & tree) {
+            this->node_ages_.compute(tree);
+            std::size_t num_nodes = this->node_ages_.num_nodes();
+            const std::vector<CoalescentTimeValueType> & distances = this->node_ages_.distances_from_root();
+            CoalescentTimeValueType present = 0.0;
+            for (std::size_t idx = 0; idx < num_nodes; ++idx) {
+                if (distances[idx] > present) {
+                    present = distances[idx];
+                }
+            }
+            double tolerance = this->node_ages_.get_tolerance() * std::fabs(present);
+            // (age, change in the number of lineages going back in time)
+            this->events_.clear();
+            this->events_.reserve(num_nodes);
+            this->is_binary_ = true;
+            for (std::size_t idx = 0; idx < num_nodes; ++idx) {
+                const typename TreeT::node_type * nd = this->node_ages_.nodes()[idx];
+                CoalescentTimeValueType age = present - distances[idx];
+                if (age <= tolerance) {
+                    age = 0.0;
+                }
+                if (nd->is_leaf()) {
+                    this->events_.emplace_back(age, 1L);
+                } else {
+                    long num_children = static_cast<long>(nd->num_child_nodes());
+                    if (num_children > 2) {
+                        this->is_binary_ = false;
+                    }
+                    if (num_children > 1) {
+                        this->events_.emplace_back(age, 1L - num_children);
+                    }
+                }
+            }
+            // samples join before coalescences at the same age
+            std::sort(this->events_.begin(), this->events_.end(),
+                    [] (const std::pair<CoalescentTimeValueType, long> & a, const std::pair<CoalescentTimeValueType, long> & b) {
+                        return a.first < b.first || (a.first == b.first && a.second > b.second);
+                    });
+            this->interval_starts_.clear();
+            this->interval_ends_.clear();
+            this->interval_pairs_.clear();
+            this->coalescence_times_.clear();
+            this->sum_scaled_pairs_ = 0.0;
+            long num_lineages = 0;
+            CoalescentTimeValueType t = 0.0;
+            for (auto & event : this->events_) {
+                if (num_lineages > 1 && event.first > t) {
+                    double num_pairs = 0.5 * static_cast<double>(num_lineages) * static_cast<double>(num_lineages - 1);
+                    this->interval_starts_.push_back(t);
+                    this->interval_ends_.push_back(event.first);
+                    this->interval_pairs_.push_back(num_pairs);
+                    this->sum_scaled_pairs_ += num_pairs * (event.first - t);
+                }
+                if (event.second < 0) {
+                    this->coalescence_times_.push_back(event.first);
+                }
+                num_lineages += event.second;
+                t = event.first;
+            }
+            return this->coalescence_times_.size();
+        }
+
+        /**
+         * Log density of the last tree computed (see compute_intervals())
+         * under a constant haploid population size $N$: $-c \log N - S / N$,
+         * for $c$ coalescences and $S$ the sum over intervals of their number
+         * of pairs of lineages times their length.
+         */
+        double get_log_density(double haploid_pop_size) const {
+            if (!this->is_binary_) {
+                return -std::numeric_limits<double>::infinity();
+            }
+            return -static_cast<double>(this->coalescence_times_.size()) * std::log(haploid_pop_size)
+                - this->sum_scaled_pairs_ / haploid_pop_size;
+        }
+
+        // Log density of the last tree computed under ``demography``.
+        double get_log_density(const Demography & demography) const {
+            if (demography.is_constant()) {
+                return this->get_log_density(demography.epochs()[0].haploid_pop_size);
+            }
+            if (!this->is_binary_) {
+                return -std::numeric_limits<double>::infinity();
+            }
+            double log_density = 0.0;
+            for (std::size_t idx = 0; idx < this->interval_starts_.size(); ++idx) {
+                log_density -= this->interval_pairs_[idx] * demography.get_scaled_time(this->interval_starts_[idx], this->interval_ends_[idx]);
+            }
+            for (CoalescentTimeValueType t : this->coalescence_times_) {
+                log_density -= std::log(demography.get_pop_size(t));
+            }
+            return log_density;
+        }
+
+        /**
+         * Log densities of the trees in [``trees_begin``, ``trees_end``)
+         * under each of ``parameters`` (haploid population sizes, or
+         * Demography objects), as a matrix with a row for each tree, in
+         * row-major order: the value for tree ``i`` under parameter ``j`` is
+         * at ``i * parameters.size() + j``. The intervals of each tree are
+         * computed once; the trees are divided into ``num_threads`` (see
+         * resolve_num_threads()) contiguous blocks, evaluated concurrently.
+         */
+        template <class IterT, class ParameterT>
+        std::vector<double> get_log_densities(IterT trees_begin,
+                IterT trees_end,
+                const std::vector<ParameterT> & parameters,
+                unsigned int num_threads=1) const {
+            std::size_t num_trees = static_cast<std::size_t>(std::distance(trees_begin, trees_end));
+            std::size_t num_parameters = parameters.size();
+            std::vector<double> log_densities(num_trees * num_parameters);
+            num_threads = resolve_num_threads(num_threads);
+            std::size_t num_blocks = num_threads < num_trees ? num_threads : num_trees;
+            if (num_blocks == 0) {
+                return log_densities;
+            }
+            std::size_t block_size = (num_trees + num_blocks - 1) / num_blocks;
+            auto evaluate_block = [&] (std::size_t block_idx) {
+                CoalescentDensity density(*this);
+                std::size_t begin_idx = block_idx * block_size;
+                std::size_t end_idx = begin_idx + block_size < num_trees ? begin_idx + block_size : num_trees;
+                IterT tree_iter = trees_begin;
+                std::advance(tree_iter, begin_idx);
+                for (std::size_t idx = begin_idx; idx < end_idx; ++idx, ++tree_iter) {
+                    density.compute_intervals(*tree_iter);
+                    for (std::size_t param_idx = 0; param_idx < num_parameters; ++param_idx) {
+                        log_densities[idx * num_parameters + param_idx] = density.get_log_density(parameters[param_idx]);
+                    }
+                }
+            };
+            if (num_blocks == 1) {
+                evaluate_block(0);
+            } else {
+                parallel_for(num_blocks, num_blocks, evaluate_block);
+            }
+            return log_densities;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Intervals of the last tree computed
+
+        // Number of coalescences.
+        inline std::size_t num_coalescences() const {
+            return this->coalescence_times_.size();
+        }
+        // Ages of the coalescences, in increasing order.
+        inline const std::vector<CoalescentTimeValueType> & coalescence_times() const {
+            return this->coalescence_times_;
+        }
+        // Start and end ages of the intervals with more than one lineage,
+        // and the number of pairs of lineages in each.
+        inline const std::vector<CoalescentTimeValueType> & interval_starts() const {
+            return this->interval_starts_;
+        }
+        inline const std::vector<CoalescentTimeValueType> & interval_ends() const {
+            return this->interval_ends_;
+        }
+        inline const std::vector<double> & interval_pairs() const {
+            return this->interval_pairs_;
+        }
+        // Whether no node has more than two children.
+        inline bool is_binary() const {
+            return this->is_binary_;
+        }
+
+    private:
+        node_ages_type                                              node_ages_;
+        std::vector<std::pair<CoalescentTimeValueType, long>>       events_;
+        std::vector<CoalescentTimeValueType>                        interval_starts_;
+        std::vector<CoalescentTimeValueType>                        interval_ends_;
+        std::vector<double>                                         interval_pairs_;
+        std::vector<CoalescentTimeValueType>                        coalescence_times_;
+        double                                                      sum_scaled_pairs_;
+        bool                                                        is_binary_;
+
+}; // CoalescentDensity
+
 
 } // namespace platypus
 } // namespace coalescent
@@ -0,0 +1,152 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Non-polymorphic node value with an inline label.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_MODEL_COMPACTNODEVALUE_HPP
+#define PLATYPUS_MODEL_COMPACTNODEVALUE_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "standardinterface.hpp"
+#include "taxonnamespace.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// CompactNodeValue
+
+/**
+ * A node value with no virtual methods and no heap storage: a label of up
+ * to ``LabelCapacityT`` characters held inline, a taxon index (see
+ * platypus::TaxonNamespace) and an edge length. It is trivially copyable
+ * (so nodes can be copied or relocated with ``memcpy``), and, with the
+ * default parameters, 24 bytes, against 48 for a
+ * platypus::StandardNodeValue.
+ *
+ * Leaves are typically identified through their taxon index, so that only
+ * the (frequently short or empty) labels of internal nodes need be held;
+ * setting a label longer than label_capacity() throws std::length_error.
+ *
+ * It provides the methods used by bind_standard_interface() and
+ * bind_taxon_namespace(), but get_label() returns a (short, so not
+ * heap-allocated) std::string by value; for compile-time binding of
+ * setters, use CompactNodeValueSetters.
+ *
+ * @tparam EdgeLengthT
+ *   Type of edge length values.
+ * @tparam LabelCapacityT
+ *   Maximum number of characters in a label (at most 255).
+ */
+template <class EdgeLengthT=float, std::size_t LabelCapacityT=15>
+class CompactNodeValue {
+    static_assert(LabelCapacityT < 256, "label capacity must be less than 256");
+
+    public:
+        typedef TaxonNamespace::index_type  taxon_index_type;
+
+    public:
+        // Trivial copy, move and destruction are left implicit.
+        CompactNodeValue()
+            : label_size_(0)
+            , taxon_index_(TaxonNamespace::npos)
+            , edge_length_(0.0) { }
+        CompactNodeValue(const std::string & label)
+            : label_size_(0)
+            , taxon_index_(TaxonNamespace::npos)
+            , edge_length_(0.0) {
+            this->set_label(label);
+        }
+
+        static constexpr std::size_t label_capacity() {
+            return LabelCapacityT;
+        }
+
+        inline void set_label(const char * data, std::size_t size) {
+            if (size > LabelCapacityT) {
+                throw std::length_error("platypus::CompactNodeValue: label '"
+                        + std::string(data, size) + "' is longer than "
+                        + std::to_string(LabelCapacityT) + " characters");
+            }
+            std::memcpy(this->label_, data, size);
+            this->label_size_ = static_cast<unsigned char>(size);
+        }
+        inline void set_label(const std::string & label) {
+            this->set_label(label.data(), label.size());
+        }
+        inline std::string get_label() const {
+            return std::string(this->label_, this->label_size_);
+        }
+        inline const char * label_data() const {
+            return this->label_;
+        }
+        inline std::size_t label_size() const {
+            return this->label_size_;
+        }
+        inline void set_taxon_index(taxon_index_type taxon_index) {
+            this->taxon_index_ = taxon_index;
+        }
+        inline taxon_index_type get_taxon_index() const {
+            return this->taxon_index_;
+        }
+        inline bool has_taxon() const {
+            return this->taxon_index_ != TaxonNamespace::npos;
+        }
+        inline void set_edge_length(EdgeLengthT edge_length) {
+            this->edge_length_ = edge_length;
+        }
+        inline EdgeLengthT get_edge_length() const {
+            return this->edge_length_;
+        }
+        inline void clear() {
+            this->label_size_ = 0;
+            this->taxon_index_ = TaxonNamespace::npos;
+            this->edge_length_ = 0.0;
+        }
+
+    private:
+        char                label_[LabelCapacityT];
+        unsigned char       label_size_;
+        taxon_index_type    taxon_index_;
+        EdgeLengthT         edge_length_;
+
+}; // CompactNodeValue
+
+////////////////////////////////////////////////////////////////////////////////
+// CompactNodeValueSetters
+// Compile-time binding of setters to platypus::CompactNodeValue (see
+// platypus::FunctionSetters).
+
+struct CompactNodeValueSetters : public StandardInterfaceSetters {
+
+    // Copies the label straight from the token, without a std::string.
+    template <class ValueT, class LabelT>
+    static inline void set_node_label(ValueT & nv, const LabelT & label) {
+        nv.set_label(label.data(), label.size());
+    }
+
+}; // CompactNodeValueSetters
+
+} // namespace platypus
+
+#endif
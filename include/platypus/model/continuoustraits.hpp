@@ -0,0 +1,716 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Continuous traits: simulation and independent contrasts.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_MODEL_CONTINUOUSTRAITS_HPP
+#define PLATYPUS_MODEL_CONTINUOUSTRAITS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../numeric/rng.hpp"
+#include "../utility/parallel.hpp"
+#include "taxonnamespace.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// ContinuousTraitMatrix
+
+/**
+ * Values of ``num_traits()`` continuous traits for each of a number of
+ * taxa, identified by their index in a platypus::TaxonNamespace (shared
+ * with trees on the same taxa or, if none is given, owned by the matrix).
+ * The traits of each taxon are contiguous, so that a pass over a tree can
+ * work on all traits of a node at once.
+ */
+class ContinuousTraitMatrix {
+
+    public:
+        typedef TaxonNamespace::index_type          taxon_index_type;
+
+        static constexpr std::size_t npos() {
+            return std::numeric_limits<std::size_t>::max();
+        }
+
+    public:
+
+        ContinuousTraitMatrix(std::size_t num_traits, TaxonNamespace * taxon_namespace=nullptr)
+            : num_traits_(num_traits)
+            , taxon_namespace_(taxon_namespace)
+            , num_rows_(0) {
+            if (this->taxon_namespace_ == nullptr) {
+                this->owned_taxon_namespace_ = std::make_shared<TaxonNamespace>();
+                this->taxon_namespace_ = this->owned_taxon_namespace_.get();
+            }
+        }
+
+        inline std::size_t num_taxa() const {
+            return this->num_rows_;
+        }
+
+        inline std::size_t num_traits() const {
+            return this->num_traits_;
+        }
+
+        /**
+         * Sets the number of traits of every row; only possible while the
+         * matrix has no rows.
+         */
+        void set_num_traits(std::size_t num_traits) {
+            if (this->num_rows_ > 0 && num_traits != this->num_traits_) {
+                throw std::logic_error("platypus::ContinuousTraitMatrix: cannot change number of traits of non-empty matrix");
+            }
+            this->num_traits_ = num_traits;
+        }
+
+        /**
+         * Adds a row, with all traits 0, for the taxon with index
+         * ``taxon_index`` in the taxon namespace, and returns its index.
+         */
+        std::size_t add_row(taxon_index_type taxon_index) {
+            if (this->find_row(taxon_index) != npos()) {
+                throw std::invalid_argument("platypus::ContinuousTraitMatrix: duplicate taxon: '" + this->taxon_namespace_->get_label(taxon_index) + "'");
+            }
+            std::size_t row_idx = this->num_rows_++;
+            this->values_.resize(this->num_rows_ * this->num_traits_, 0.0);
+            std::fill(this->row(row_idx), this->row(row_idx) + this->num_traits_, 0.0);
+            if (taxon_index >= this->taxon_rows_.size()) {
+                this->taxon_rows_.resize(static_cast<std::size_t>(taxon_index) + 1, npos());
+            }
+            this->taxon_rows_[taxon_index] = row_idx;
+            this->row_taxa_.push_back(taxon_index);
+            return row_idx;
+        }
+
+        // Adds a row for the taxon labeled ``label``, with traits ``values``.
+        std::size_t add_row(const std::string & label, const std::vector<double> & values) {
+            if (values.size() != this->num_traits_) {
+                throw std::invalid_argument("platypus::ContinuousTraitMatrix: expecting " + std::to_string(this->num_traits_) + " traits but found " + std::to_string(values.size()) + " for taxon '" + label + "'");
+            }
+            std::size_t row_idx = this->add_row(this->taxon_namespace_->add_taxon(label));
+            std::copy(values.begin(), values.end(), this->row(row_idx));
+            return row_idx;
+        }
+
+        /**
+         * Removes all rows, keeping storage; taxa are not removed from the
+         * taxon namespace.
+         */
+        void clear() {
+            this->num_rows_ = 0;
+            this->row_taxa_.clear();
+            this->taxon_rows_.clear();
+        }
+
+        // Returns the row of the taxon with index ``taxon_index``, or npos().
+        inline std::size_t find_row(taxon_index_type taxon_index) const {
+            if (taxon_index >= this->taxon_rows_.size()) {
+                return npos();
+            }
+            return this->taxon_rows_[taxon_index];
+        }
+
+        inline taxon_index_type get_taxon_index(std::size_t row_idx) const {
+            return this->row_taxa_[row_idx];
+        }
+
+        inline const std::string & get_taxon_label(std::size_t row_idx) const {
+            return this->taxon_namespace_->get_label(this->row_taxa_[row_idx]);
+        }
+
+        inline const double * row(std::size_t row_idx) const {
+            return this->values_.data() + row_idx * this->num_traits_;
+        }
+
+        inline double * row(std::size_t row_idx) {
+            return this->values_.data() + row_idx * this->num_traits_;
+        }
+
+        inline TaxonNamespace & taxon_namespace() {
+            return *this->taxon_namespace_;
+        }
+
+        inline const TaxonNamespace & taxon_namespace() const {
+            return *this->taxon_namespace_;
+        }
+
+    private:
+        std::size_t                         num_traits_;
+        TaxonNamespace *                    taxon_namespace_;
+        std::shared_ptr<TaxonNamespace>     owned_taxon_namespace_;
+        std::size_t                         num_rows_;
+        std::vector<double>                 values_;
+        std::vector<std::size_t>            taxon_rows_;
+        std::vector<taxon_index_type>       row_taxa_;
+
+}; // ContinuousTraitMatrix
+
+////////////////////////////////////////////////////////////////////////////////
+// ContinuousTraitModel
+
+/**
+ * An Ornstein-Uhlenbeck process, with rate ``sigma2`` (the variance
+ * accumulated per unit of time by the random component), strength of
+ * selection ``alpha`` towards the optimum ``theta``, started from
+ * ``root_value``; with ``alpha`` 0, Brownian motion.
+ */
+class ContinuousTraitModel {
+
+    public:
+
+        static ContinuousTraitModel brownian_motion(double sigma2, double root_value=0.0) {
+            return ContinuousTraitModel(sigma2, 0.0, 0.0, root_value);
+        }
+
+        static ContinuousTraitModel ornstein_uhlenbeck(double sigma2, double alpha, double theta, double root_value=0.0) {
+            return ContinuousTraitModel(sigma2, alpha, theta, root_value);
+        }
+
+        ContinuousTraitModel(double sigma2, double alpha, double theta, double root_value)
+            : sigma2_(sigma2)
+            , alpha_(alpha)
+            , theta_(theta)
+            , root_value_(root_value) {
+            if (!(sigma2 >= 0.0) || !(alpha >= 0.0)) {
+                throw std::invalid_argument("platypus::ContinuousTraitModel: rate and strength of selection must be non-negative");
+            }
+        }
+
+        inline double sigma2() const {
+            return this->sigma2_;
+        }
+
+        inline double alpha() const {
+            return this->alpha_;
+        }
+
+        inline double theta() const {
+            return this->theta_;
+        }
+
+        inline double root_value() const {
+            return this->root_value_;
+        }
+
+        /**
+         * Over time ``t``, a value ``x`` becomes normally distributed with
+         * mean ``theta + (x - theta) * decay`` and standard deviation
+         * ``stddev``.
+         */
+        void transition(double t, double & decay, double & stddev) const {
+            if (this->alpha_ == 0.0) {
+                decay = 1.0;
+                stddev = std::sqrt(this->sigma2_ * t);
+                return;
+            }
+            decay = std::exp(-this->alpha_ * t);
+            stddev = std::sqrt(-this->sigma2_ * std::expm1(-2.0 * this->alpha_ * t) / (2.0 * this->alpha_));
+        }
+
+    private:
+        double      sigma2_;
+        double      alpha_;
+        double      theta_;
+        double      root_value_;
+
+}; // ContinuousTraitModel
+
+////////////////////////////////////////////////////////////////////////////////
+// ContinuousTraitSimulator
+
+/**
+ * Simulates continuous traits along trees under a ContinuousTraitModel,
+ * into a ContinuousTraitMatrix with a row for each leaf, in a single
+ * preorder pass. The values of all traits below an edge are drawn
+ * together, from a block of standard normal deviates, and (as with
+ * SequenceSimulator) only the values of nodes with children still to be
+ * visited are kept.
+ *
+ * @tparam TreeT
+ *   A platypus::Tree specialization.
+ * @tparam RngT
+ *   Random number generator type.
+ */
+template <class TreeT, class RngT=platypus::numeric::RandomNumberGenerator>
+class ContinuousTraitSimulator {
+
+    public:
+        typedef typename TreeT::node_type                           node_type;
+        typedef typename TreeT::value_type                          value_type;
+        typedef std::function<std::string (const value_type &)>     label_fn_type;
+        typedef std::function<double (const value_type &)>          edge_length_fn_type;
+        typedef std::function<void (const ContinuousTraitMatrix &, unsigned long)> matrix_sink_fntype;
+
+    public:
+
+        ContinuousTraitSimulator(RngT & rng,
+                const ContinuousTraitModel & model,
+                const label_fn_type & label_fn,
+                const edge_length_fn_type & edge_length_fn)
+            : rng_ptr_(&rng)
+            , model_(model)
+            , label_fn_(label_fn)
+            , edge_length_fn_(edge_length_fn)
+            , num_slots_(0) { }
+
+        inline const ContinuousTraitModel & model() const {
+            return this->model_;
+        }
+
+        /**
+         * Replaces the contents of ``matrix`` with ``num_traits``
+         * independent traits simulated along ``tree``, with rows in the
+         * (preorder) order of the leaves.
+         */
+        void simulate(const TreeT & tree, std::size_t num_traits, ContinuousTraitMatrix & matrix) {
+            RngT & rng = *this->rng_ptr_;
+            matrix.clear();
+            matrix.set_num_traits(num_traits);
+            this->deviates_.resize(num_traits);
+            this->node_slots_.clear();
+            this->free_slots_.clear();
+            this->num_slots_ = 0;
+            std::size_t root_slot = this->acquire_slot(num_traits);
+            double * root_values = this->slot_values(root_slot, num_traits);
+            std::fill(root_values, root_values + num_traits, this->model_.root_value());
+            const node_type * head = tree.head_node();
+            if (head->is_leaf()) {
+                this->add_leaf_row(head, root_values, num_traits, matrix);
+                return;
+            }
+            this->node_slots_.insert(std::make_pair(head, root_slot));
+            const double theta = this->model_.theta();
+            for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+                const node_type * nd = ndi.node();
+                if (nd == head) {
+                    continue;
+                }
+                const node_type * parent = nd->parent_node();
+                std::size_t parent_slot = this->node_slots_.at(parent);
+                double decay;
+                double stddev;
+                this->model_.transition(this->edge_length_fn_(nd->value()), decay, stddev);
+                for (std::size_t trait = 0; trait < num_traits; ++trait) {
+                    this->deviates_[trait] = rng.normal(0.0, 1.0);
+                }
+                std::size_t slot = this->acquire_slot(num_traits);
+                const double * parent_values = this->slot_values(parent_slot, num_traits);
+                double * values = this->slot_values(slot, num_traits);
+                const double * deviates = this->deviates_.data();
+                for (std::size_t trait = 0; trait < num_traits; ++trait) {
+                    values[trait] = theta + (parent_values[trait] - theta) * decay + stddev * deviates[trait];
+                }
+                if (nd->next_sibling_node() == nullptr) {
+                    // all children of the parent visited
+                    this->node_slots_.erase(parent);
+                    this->free_slots_.push_back(parent_slot);
+                }
+                if (nd->is_leaf()) {
+                    this->add_leaf_row(nd, values, num_traits, matrix);
+                    this->free_slots_.push_back(slot);
+                } else {
+                    this->node_slots_.insert(std::make_pair(nd, slot));
+                }
+            }
+        }
+
+        /**
+         * Simulates ``num_traits`` traits on each of the trees in
+         * [``trees_begin``, ``trees_end``), distributing the work across
+         * ``num_threads`` threads (0 = one per hardware thread), and passes
+         * each matrix and the index of its tree to ``matrix_sink`` in index
+         * order, from the calling thread. As with
+         * SequenceSimulator::simulate_batch(), each replicate has its own
+         * random number generator created from ``master_seed`` and the tree
+         * index, so the values do not depend on the number of threads, and
+         * matrices are re-used, so ``matrix_sink`` must copy anything it
+         * wants to keep.
+         *
+         * @return
+         *   The number of matrices simulated.
+         */
+        template <class IterT>
+        unsigned long simulate_batch(IterT trees_begin,
+                IterT trees_end,
+                std::size_t num_traits,
+                unsigned int num_threads,
+                const matrix_sink_fntype & matrix_sink,
+                std::uint64_t master_seed,
+                TaxonNamespace * taxon_namespace=nullptr) {
+            std::vector<IterT> trees;
+            for (; trees_begin != trees_end; ++trees_begin) {
+                trees.push_back(trees_begin);
+            }
+            unsigned long num_trees = trees.size();
+            if (num_trees == 0) {
+                return 0;
+            }
+            num_threads = resolve_num_threads(num_threads);
+            unsigned long batch_size = static_cast<unsigned long>(num_threads) * 16;
+            ContinuousTraitMatrix prototype(num_traits, taxon_namespace);
+            std::vector<ContinuousTraitMatrix> matrices(batch_size < num_trees ? batch_size : num_trees, prototype);
+            for (unsigned long batch_start = 0; batch_start < num_trees; batch_start += batch_size) {
+                unsigned long batch_end = batch_start + batch_size;
+                if (batch_end > num_trees) {
+                    batch_end = num_trees;
+                }
+                parallel_for(batch_end - batch_start, num_threads, [&] (std::size_t task_idx) {
+                    RngT rng = platypus::numeric::ReplicateRandomNumberGenerator<RngT>::create(
+                            master_seed, batch_start + task_idx);
+                    ContinuousTraitSimulator replicate_simulator(rng, *this);
+                    replicate_simulator.simulate(*trees[batch_start + task_idx], num_traits, matrices[task_idx]);
+                });
+                for (unsigned long idx = batch_start; idx < batch_end; ++idx) {
+                    matrix_sink(matrices[idx - batch_start], idx);
+                }
+            }
+            return num_trees;
+        }
+
+    private:
+
+        // Copies the configuration of ``other``, with a different generator.
+        ContinuousTraitSimulator(RngT & rng, const ContinuousTraitSimulator & other)
+            : rng_ptr_(&rng)
+            , model_(other.model_)
+            , label_fn_(other.label_fn_)
+            , edge_length_fn_(other.edge_length_fn_)
+            , num_slots_(0) { }
+
+        std::size_t acquire_slot(std::size_t num_traits) {
+            if (!this->free_slots_.empty()) {
+                std::size_t slot = this->free_slots_.back();
+                this->free_slots_.pop_back();
+                return slot;
+            }
+            std::size_t slot = this->num_slots_++;
+            if (this->num_slots_ * num_traits > this->values_.size()) {
+                this->values_.resize(2 * this->num_slots_ * num_traits);
+            }
+            return slot;
+        }
+
+        inline double * slot_values(std::size_t slot, std::size_t num_traits) {
+            return this->values_.data() + slot * num_traits;
+        }
+
+        void add_leaf_row(const node_type * nd, const double * values, std::size_t num_traits, ContinuousTraitMatrix & matrix) {
+            std::size_t row_idx = matrix.add_row(matrix.taxon_namespace().add_taxon(this->label_fn_(nd->value())));
+            std::copy(values, values + num_traits, matrix.row(row_idx));
+        }
+
+    private:
+        RngT *                                          rng_ptr_;
+        ContinuousTraitModel                            model_;
+        label_fn_type                                   label_fn_;
+        edge_length_fn_type                             edge_length_fn_;
+        // scratch storage
+        std::vector<double>                             deviates_;
+        std::vector<double>                             values_;
+        std::unordered_map<const node_type *, std::size_t> node_slots_;
+        std::vector<std::size_t>                        free_slots_;
+        std::size_t                                     num_slots_;
+
+}; // ContinuousTraitSimulator
+
+////////////////////////////////////////////////////////////////////////////////
+// IndependentContrasts
+
+/**
+ * Felsenstein's (1985) phylogenetically independent contrasts of the
+ * traits of a ContinuousTraitMatrix on a tree, and the likelihood of the
+ * traits under Brownian motion, computed for all traits at once in a
+ * single postorder pass, in time linear in the size of the tree (and
+ * without the covariance matrix of the leaves).
+ *
+ * Each internal node with ``k`` children with data yields ``k - 1``
+ * contrasts: a polytomy is resolved by joining its children in turn with
+ * edges of length 0. Leaves with no row in the matrix are pruned, an
+ * internal node with data below only one child contributing only the
+ * length of its edge. The edge of the head node is ignored, so that the
+ * value at the root is that of the head node. Edges joining leaves with
+ * data must not all have length 0.
+ *
+ * @tparam TreeT
+ *   A platypus::Tree specialization.
+ */
+template <class TreeT>
+class IndependentContrasts {
+
+    public:
+        typedef typename TreeT::node_type           node_type;
+        typedef typename TreeT::value_type          value_type;
+        typedef std::function<TaxonNamespace::index_type (const value_type &)> taxon_index_fn_type;
+        typedef std::function<double (const value_type &)> edge_length_fn_type;
+
+    public:
+
+        /**
+         * ``matrix`` must outlive this object, and not be modified while in
+         * use.
+         */
+        IndependentContrasts(const ContinuousTraitMatrix & matrix,
+                const taxon_index_fn_type & taxon_index_fn,
+                const edge_length_fn_type & edge_length_fn)
+            : matrix_(matrix)
+            , taxon_index_fn_(taxon_index_fn)
+            , edge_length_fn_(edge_length_fn)
+            , num_traits_(matrix.num_traits())
+            , num_leaves_(0)
+            , log_variance_sum_(0.0) { }
+
+        /**
+         * Computes the contrasts of ``tree``, and the estimates at its root.
+         */
+        void compute(const TreeT & tree) {
+            const std::size_t m = this->num_traits_;
+            this->contrasts_.clear();
+            this->contrast_variances_.clear();
+            this->sums_of_squares_.assign(m, 0.0);
+            this->root_values_.assign(m, 0.0);
+            this->num_leaves_ = 0;
+            this->log_variance_sum_ = 0.0;
+            this->stack_.clear();
+            const node_type * head = tree.head_node();
+            for (auto ndi = tree.postorder_begin(); ndi != tree.postorder_end(); ++ndi) {
+                const node_type * nd = ndi.node();
+                double edge_length = nd == head ? 0.0 : this->edge_length_fn_(nd->value());
+                if (ndi.is_leaf()) {
+                    std::size_t row_idx = this->matrix_.find_row(this->taxon_index_fn_(nd->value()));
+                    std::size_t entry = this->push_entry(row_idx != ContinuousTraitMatrix::npos(), edge_length);
+                    if (row_idx != ContinuousTraitMatrix::npos()) {
+                        const double * row = this->matrix_.row(row_idx);
+                        std::copy(row, row + m, this->entry_values(entry));
+                        ++this->num_leaves_;
+                    }
+                    continue;
+                }
+                // the children of ``nd`` are the last entries on the stack
+                std::size_t first = this->stack_.size() - nd->num_child_nodes();
+                this->join_entries(first);
+                this->stack_[first].variance += edge_length;
+            }
+            if (!this->stack_.empty() && this->stack_[0].has_data) {
+                const double * values = this->entry_values(0);
+                std::copy(values, values + m, this->root_values_.begin());
+                this->log_variance_sum_ += std::log(this->stack_[0].variance);
+            }
+        }
+
+        inline std::size_t num_traits() const {
+            return this->num_traits_;
+        }
+
+        // The number of leaves with data in the tree last computed.
+        inline std::size_t num_leaves() const {
+            return this->num_leaves_;
+        }
+
+        // One fewer than the number of leaves with data.
+        inline std::size_t num_contrasts() const {
+            return this->contrast_variances_.size();
+        }
+
+        /**
+         * The contrasts standardized by their standard deviations (as
+         * num_traits() values for each contrast in turn), in postorder of
+         * the nodes at which they are taken.
+         */
+        inline const std::vector<double> & contrasts() const {
+            return this->contrasts_;
+        }
+
+        // The (Brownian-motion, for unit rate) variance of each contrast.
+        inline const std::vector<double> & contrast_variances() const {
+            return this->contrast_variances_;
+        }
+
+        // The estimates (and maximum-likelihood values) of the traits at the root.
+        inline const std::vector<double> & root_values() const {
+            return this->root_values_;
+        }
+
+        // The sum of the squared standardized contrasts of each trait.
+        inline const std::vector<double> & sums_of_squares() const {
+            return this->sums_of_squares_;
+        }
+
+        /**
+         * The restricted maximum likelihood (REML) estimate of the
+         * Brownian-motion rate of ``trait``, the mean squared
+         * standardized contrast.
+         */
+        inline double rate_estimate(std::size_t trait) const {
+            return this->sums_of_squares_[trait] / static_cast<double>(this->num_contrasts());
+        }
+
+        /**
+         * The log-likelihood of the values of ``trait`` at the leaves under
+         * Brownian motion with rate ``sigma2`` and the root value at its
+         * maximum-likelihood estimate: the density of the contrasts and of
+         * the estimate at the root, which are independent, and together a
+         * linear transformation, with unit Jacobian, of the leaf values.
+         */
+        double log_likelihood(std::size_t trait, double sigma2) const {
+            const double log_two_pi = 1.8378770664093454835606594728112;
+            double n = static_cast<double>(this->num_leaves_);
+            return -0.5 * (n * (log_two_pi + std::log(sigma2)) + this->log_variance_sum_ + this->sums_of_squares_[trait] / sigma2);
+        }
+
+        // The log-likelihood at the maximum-likelihood rate of ``trait``.
+        double max_log_likelihood(std::size_t trait) const {
+            double n = static_cast<double>(this->num_leaves_);
+            return this->log_likelihood(trait, this->sums_of_squares_[trait] / n);
+        }
+
+        /**
+         * Fits each trait by maximum likelihood on each of the trees in
+         * [``trees_begin``, ``trees_end``), concurrently on ``num_threads``
+         * threads (see resolve_num_threads()), so the taxon index and edge
+         * length functions must be safe to call concurrently. Sets
+         * ``log_likelihoods`` and ``rates`` to max_log_likelihood() and
+         * rate_estimate() for each trait on each tree in turn (i.e., as
+         * num_traits() values for each tree). The state of this object is
+         * not changed.
+         */
+        template <class IterT>
+        void fit_trees(IterT trees_begin,
+                IterT trees_end,
+                std::vector<double> & log_likelihoods,
+                std::vector<double> & rates,
+                unsigned int num_threads=0) const {
+            const std::size_t m = this->num_traits_;
+            std::size_t num_trees = static_cast<std::size_t>(std::distance(trees_begin, trees_end));
+            log_likelihoods.assign(num_trees * m, 0.0);
+            rates.assign(num_trees * m, 0.0);
+            num_threads = resolve_num_threads(num_threads);
+            std::size_t num_blocks = std::min<std::size_t>(num_threads, num_trees);
+            if (num_blocks == 0) {
+                return;
+            }
+            std::size_t block_size = (num_trees + num_blocks - 1) / num_blocks;
+            parallel_for(num_blocks, num_threads, [&] (std::size_t block_idx) {
+                IndependentContrasts contrasts(this->matrix_, this->taxon_index_fn_, this->edge_length_fn_);
+                std::size_t begin_idx = block_idx * block_size;
+                std::size_t end_idx = std::min(begin_idx + block_size, num_trees);
+                IterT tree_iter = trees_begin;
+                std::advance(tree_iter, begin_idx);
+                for (std::size_t idx = begin_idx; idx < end_idx; ++idx, ++tree_iter) {
+                    contrasts.compute(*tree_iter);
+                    for (std::size_t trait = 0; trait < m; ++trait) {
+                        log_likelihoods[idx * m + trait] = contrasts.max_log_likelihood(trait);
+                        rates[idx * m + trait] = contrasts.rate_estimate(trait);
+                    }
+                }
+            });
+        }
+
+    private:
+
+        struct StackEntry {
+            bool        has_data;
+            double      variance;
+        };
+
+        std::size_t push_entry(bool has_data, double variance) {
+            std::size_t entry = this->stack_.size();
+            this->stack_.push_back(StackEntry{has_data, variance});
+            if (this->stack_.size() * this->num_traits_ > this->stack_values_.size()) {
+                this->stack_values_.resize(2 * this->stack_.size() * this->num_traits_);
+            }
+            return entry;
+        }
+
+        inline double * entry_values(std::size_t entry) {
+            return this->stack_values_.data() + entry * this->num_traits_;
+        }
+
+        /**
+         * Joins the entries from ``first`` to the top of the stack (the
+         * subtrees of the children of a node) in turn, taking a contrast at
+         * each join, into entry ``first``.
+         */
+        void join_entries(std::size_t first) {
+            const std::size_t m = this->num_traits_;
+            for (std::size_t entry = first; entry < this->stack_.size(); ++entry) {
+                if (!this->stack_[entry].has_data) {
+                    continue;
+                }
+                if (!this->stack_[first].has_data) {
+                    std::copy(this->entry_values(entry), this->entry_values(entry) + m, this->entry_values(first));
+                    this->stack_[first] = this->stack_[entry];
+                    continue;
+                }
+                if (entry == first) {
+                    continue;
+                }
+                double va = this->stack_[first].variance;
+                double vb = this->stack_[entry].variance;
+                double v = va + vb;
+                double sd = std::sqrt(v);
+                double * a = this->entry_values(first);
+                const double * b = this->entry_values(entry);
+                std::size_t offset = this->contrasts_.size();
+                this->contrasts_.resize(offset + m);
+                double * contrast = this->contrasts_.data() + offset;
+                double * sums_of_squares = this->sums_of_squares_.data();
+                for (std::size_t trait = 0; trait < m; ++trait) {
+                    double u = (a[trait] - b[trait]) / sd;
+                    contrast[trait] = u;
+                    sums_of_squares[trait] += u * u;
+                    a[trait] = (a[trait] * vb + b[trait] * va) / v;
+                }
+                this->contrast_variances_.push_back(v);
+                this->log_variance_sum_ += std::log(v);
+                this->stack_[first].variance = va * vb / v;
+            }
+            this->stack_.resize(first + 1);
+        }
+
+    private:
+        const ContinuousTraitMatrix &               matrix_;
+        taxon_index_fn_type                         taxon_index_fn_;
+        edge_length_fn_type                         edge_length_fn_;
+        std::size_t                                 num_traits_;
+        std::size_t                                 num_leaves_;
+        double                                      log_variance_sum_;
+        std::vector<double>                         contrasts_;
+        std::vector<double>                         contrast_variances_;
+        std::vector<double>                         sums_of_squares_;
+        std::vector<double>                         root_values_;
+        // postorder stack of the subtrees of the children of unvisited nodes
+        std::vector<StackEntry>                     stack_;
+        std::vector<double>                         stack_values_;
+
+}; // IndependentContrasts
+
+} // namespace platypus
+
+#endif
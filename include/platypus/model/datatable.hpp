@@ -24,17 +24,29 @@
 
 #include <numeric>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <algorithm>
+#include <deque>
 #include <map>
+#include <unordered_map>
+#include <memory>
 #include <set>
 #include <sstream>
 #include <typeinfo>
+#include <type_traits>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <iomanip>
+#include <locale>
 #include <initializer_list>
+#include <iterator>
+#include "../utility/bitops.hpp"
+#include "../utility/memoryusage.hpp"
 #include "../utility/stream.hpp"
+#include "../utility/parallel.hpp"
+#include "../numeric/statistics.hpp"
 #include "../base/exception.hpp"
 
 namespace platypus {
@@ -100,7 +112,19 @@ class DataTableInvalidRowError : public DataTableException {
 // DataTableColumn
 
 class DataTable;
+class DataTableView;
+class DataTableGroups;
+template <class T> class DataTableColumnHandle;
 
+/**
+ * Definition and storage of a single column of a DataTable.
+ *
+ * Values are held contiguously, in a single vector of the implementation
+ * type corresponding to the column's value type, and indexed by row.
+ * Conversion to and from other types happens on access: numeric values are
+ * cast, strings are parsed, and numeric values accessed or assigned as
+ * strings are rendered using the column's formatting.
+ */
 class DataTableColumn {
     public:
 
@@ -118,6 +142,16 @@ class DataTableColumn {
         typedef unsigned long    unsigned_integer_implementation_type;
         typedef long double      floating_point_implementation_type;
         typedef std::string      string_implementation_type;
+        // The implementation type of columns created for values of type ``T``.
+        template <class T> struct implementation_type {
+            typedef typename std::conditional<std::is_floating_point<T>::value,
+                    floating_point_implementation_type,
+                    typename std::conditional<std::is_arithmetic<T>::value,
+                        typename std::conditional<std::is_signed<T>::value,
+                            signed_integer_implementation_type,
+                            unsigned_integer_implementation_type>::type,
+                        string_implementation_type>::type>::type type;
+        };
         template <class T> static ValueType identify_type() {
             if (std::is_floating_point<T>::value) {
                 return ValueType::FloatingPoint;
@@ -160,15 +194,19 @@ class DataTableColumn {
         template <class T>
         void add_formatting(const T & formatter) {
             this->formatters_.push_back(formatter);
+            this->compiled_format_.is_valid = false;
         }
         void add_formatting(const platypus::stream::OutputStreamFormatters & formatters) {
             this->formatters_.insert(this->formatters_.end(), formatters.cbegin(), formatters.cend());
+            this->compiled_format_.is_valid = false;
         }
         void clear_formatting() {
             this->formatters_.clear();
+            this->compiled_format_.is_valid = false;
         }
         void set_formatting(const platypus::stream::OutputStreamFormatters & formatters) {
             this->formatters_ = formatters;
+            this->compiled_format_.is_valid = false;
             // this->formatters_.clear();
             // this->formatters_.insert(this->formatters_.end(), formatters.cbegin(), formatters.cend());
         }
@@ -182,6 +220,93 @@ class DataTableColumn {
             out << val;
             out.copyfmt(std::ios(NULL)); // restore state
         }
+
+        /**
+         * Compiles the formatting of this column into a printf-style format,
+         * so that cells are formatted directly into a character buffer
+         * (write_formatted_cell(), append_formatted_cell()) instead of by
+         * applying each manipulator to the output stream for every cell.
+         *
+         * The manipulators are applied once, to a scratch stream, and the
+         * resulting width, precision, and (decimal, fixed, scientific,
+         * general, sign, point, and adjustment) flags captured. Formatting
+         * that cannot be reproduced this way, such as a fill character
+         * other than a space, non-decimal integers, a change of locale, or a
+         * manipulator that writes text, is left uncompiled. The compiled
+         * format is discarded when the formatting of the column is changed.
+         *
+         * @return
+         *   ``true`` if the formatting was compiled.
+         */
+        bool compile_formatting() {
+            CompiledFormat & cf = this->compiled_format_;
+            cf.is_valid = false;
+            std::ostringstream probe;
+            std::locale initial_locale = probe.getloc();
+            for (auto m : this->formatters_) {
+                probe << m;
+            }
+            if (!probe.str().empty() || probe.getloc() != initial_locale) {
+                return false;
+            }
+            std::ios_base::fmtflags flags = probe.flags();
+            std::streamsize width = probe.width();
+            std::ios_base::fmtflags adjust = flags & std::ios_base::adjustfield;
+            if (width > 0 && (probe.fill() != ' ' || adjust == std::ios_base::internal)) {
+                return false;
+            }
+            std::ios_base::fmtflags base = flags & std::ios_base::basefield;
+            if (base != std::ios_base::dec && base != std::ios_base::fmtflags(0)) {
+                return false;
+            }
+            cf.width = static_cast<int>(width);
+            cf.left_adjust = adjust == std::ios_base::left;
+            std::string spec = "%";
+            if (cf.left_adjust) {
+                spec += '-';
+            }
+            if ((flags & std::ios_base::showpos) && this->value_type_ != ValueType::UnsignedInteger) {
+                spec += '+';
+            }
+            if ((flags & std::ios_base::showpoint) && this->value_type_ == ValueType::FloatingPoint) {
+                spec += '#';
+            }
+            if (width > 0) {
+                spec += std::to_string(width);
+            }
+            switch (this->value_type_) {
+                case ValueType::SignedInteger:
+                    spec += "ld";
+                    break;
+                case ValueType::UnsignedInteger:
+                    spec += "lu";
+                    break;
+                case ValueType::FloatingPoint: {
+                    std::ios_base::fmtflags float_field = flags & std::ios_base::floatfield;
+                    // as std::num_put does
+                    spec += "." + std::to_string(probe.precision() < 0 ? 6 : probe.precision()) + "L";
+                    if (float_field == std::ios_base::fixed) {
+                        spec += 'f';
+                    } else if (float_field == std::ios_base::scientific) {
+                        spec += (flags & std::ios_base::uppercase) ? 'E' : 'e';
+                    } else if (float_field == std::ios_base::fmtflags(0)) {
+                        spec += (flags & std::ios_base::uppercase) ? 'G' : 'g';
+                    } else {
+                        return false;
+                    }
+                    break;
+                }
+                case ValueType::String:
+                    break;
+            }
+            cf.spec = spec;
+            cf.is_valid = true;
+            return true;
+        }
+        bool has_compiled_formatting() const {
+            return this->compiled_format_.is_valid;
+        }
+
         bool is_hidden() const {
             return this->is_hidden_;
         }
@@ -189,256 +314,517 @@ class DataTableColumn {
             this->is_hidden_ = hidden;
         }
         template <class T> T max() const;
-    protected:
-        DataTable &                                 table_;
-        ValueType                                   value_type_;
-        std::string                                 label_;
-        bool                                        is_key_column_;
-        platypus::stream::OutputStreamFormatters    formatters_;
-        bool                                        is_hidden_;
-}; // DataTableColumn
 
-//////////////////////////////////////////////////////////////////////////////
-// DataTableBaseCell
+        //////////////////////////////////////////////////////////////////////////////
+        // Storage
+
+        unsigned long num_values() const {
+            switch (this->value_type_) {
+                case ValueType::SignedInteger: return this->signed_integer_values_.size();
+                case ValueType::UnsignedInteger: return this->unsigned_integer_values_.size();
+                case ValueType::FloatingPoint: return this->floating_point_values_.size();
+                case ValueType::String: return this->string_values_.size();
+            }
+            throw DataTableUndefinedColumnValueType(__FILE__, __LINE__, DataTableColumn::get_value_type_name_as_string(this->value_type_));
+        }
+
+        /**
+         * Direct, read-only access to the storage of this column. ``T`` must
+         * be the implementation type of the column's value type (e.g.,
+         * ``DataTableColumn::floating_point_implementation_type`` for a
+         * floating-point column).
+         */
+        template <class T> const std::vector<T> & values() const {
+            if (DataTableColumn::identify_type<T>() != this->value_type_) {
+                throw DataTableUndefinedColumnValueType(__FILE__, __LINE__,
+                        DataTableColumn::get_value_type_name_as_string(DataTableColumn::identify_type<T>())
+                        + " requested from column '" + this->label_ + "' of type "
+                        + DataTableColumn::get_value_type_name_as_string(this->value_type_));
+            }
+            return this->storage(static_cast<T *>(nullptr));
+        }
 
-class DataTableBaseCell {
-    public:
-        DataTableBaseCell(const DataTableColumn & column)
-            : column_(column) { }
-        virtual ~DataTableBaseCell() { }
-        const DataTableColumn & column() const {
-            return this->column_;
+        /**
+         * Returns a copy of all values in this column, converted to ``T``.
+         */
+        template <class T> std::vector<T> get_values() const {
+            std::vector<T> vals;
+            vals.reserve(this->num_values());
+            this->visit_values_as<T>([&vals](const T & v) { vals.push_back(v); });
+            return vals;
         }
-    protected:
-        const DataTableColumn &    column_;
-}; // DataTableBaseCell
 
-//////////////////////////////////////////////////////////////////////////////
-// DataTableValueTypedCell
+        /**
+         * Calls ``fn`` with each value in rows [``begin_row``, ``end_row``)
+         * of this column, in row order, converted to ``T``. The value type is
+         * resolved once, rather than for every value.
+         */
+        template <class T, class FnT> void visit_values_as(FnT fn,
+                unsigned long begin_row=0,
+                unsigned long end_row=static_cast<unsigned long>(-1)) const {
+            switch (this->value_type_) {
+                case ValueType::SignedInteger:
+                    this->visit_range(this->signed_integer_values_, begin_row, end_row,
+                            [this, &fn](const signed_integer_implementation_type & v) { fn(this->numeric_as<T>(v)); });
+                    return;
+                case ValueType::UnsignedInteger:
+                    this->visit_range(this->unsigned_integer_values_, begin_row, end_row,
+                            [this, &fn](const unsigned_integer_implementation_type & v) { fn(this->numeric_as<T>(v)); });
+                    return;
+                case ValueType::FloatingPoint:
+                    this->visit_range(this->floating_point_values_, begin_row, end_row,
+                            [this, &fn](const floating_point_implementation_type & v) { fn(this->numeric_as<T>(v)); });
+                    return;
+                case ValueType::String:
+                    this->visit_range(this->string_values_, begin_row, end_row,
+                            [this, &fn](const string_implementation_type & v) { fn(this->string_as<T>(v)); });
+                    return;
+            }
+            throw DataTableUndefinedColumnValueType(__FILE__, __LINE__, DataTableColumn::get_value_type_name_as_string(this->value_type_));
+        }
 
-template <class T>
-class DataTableValueTypedCell : public DataTableBaseCell {
-    public:
-        DataTableValueTypedCell(const DataTableColumn & column)
-            : DataTableBaseCell(column) { }
-        DataTableValueTypedCell(const DataTableColumn & column, const T & val)
-            : DataTableBaseCell(column)
-            , value_(val) { }
-        virtual ~DataTableValueTypedCell() {}
-        void write_formatted(std::ostream & out) const {
-            this->column_.write_formatted_value(out, this->value_);
-        }
-        std::string get_formatted_value() const {
-            std::ostringstream o;
-            this->write_formatted_value(o);
-            return o.str();
+        template <class T> T get(unsigned long row_idx) const {
+            switch (this->value_type_) {
+                case ValueType::SignedInteger: return this->numeric_as<T>(this->signed_integer_values_[row_idx]);
+                case ValueType::UnsignedInteger: return this->numeric_as<T>(this->unsigned_integer_values_[row_idx]);
+                case ValueType::FloatingPoint: return this->numeric_as<T>(this->floating_point_values_[row_idx]);
+                case ValueType::String: return this->string_as<T>(this->string_values_[row_idx]);
+            }
+            throw DataTableUndefinedColumnValueType(__FILE__, __LINE__, DataTableColumn::get_value_type_name_as_string(this->value_type_));
         }
-    public:
-        T       value_;
-}; // DataTableValueTypedCell
 
-//////////////////////////////////////////////////////////////////////////////
-// DataTableNumericCell
+        template <class T> void set(unsigned long row_idx, const T & val) {
+            switch (this->value_type_) {
+                case ValueType::SignedInteger: this->assign_numeric(this->signed_integer_values_[row_idx], val); return;
+                case ValueType::UnsignedInteger: this->assign_numeric(this->unsigned_integer_values_[row_idx], val); return;
+                case ValueType::FloatingPoint: this->assign_numeric(this->floating_point_values_[row_idx], val); return;
+                case ValueType::String: this->assign_string(this->string_values_[row_idx], val); return;
+            }
+            throw DataTableUndefinedColumnValueType(__FILE__, __LINE__, DataTableColumn::get_value_type_name_as_string(this->value_type_));
+        }
 
-template <class T>
-class DataTableNumericCell : public DataTableValueTypedCell<T> {
-    public:
-        typedef T value_implementation_type;
-        DataTableNumericCell(const DataTableColumn & column)
-            : DataTableValueTypedCell<T>(column) { }
-        DataTableNumericCell(const DataTableColumn & column, const T & val)
-            : DataTableValueTypedCell<T>(column, val) { }
-        virtual ~DataTableNumericCell() {}
-        virtual void from_string(const std::string & val) {
-            std::istringstream i(val);
-            i >> this->value_;
+        void write_formatted_cell(std::ostream & out, unsigned long row_idx) const {
+            if (this->compiled_format_.is_valid) {
+                std::string buffer;
+                this->append_formatted_cell(buffer, row_idx);
+                out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                return;
+            }
+            switch (this->value_type_) {
+                case ValueType::SignedInteger: this->write_formatted_value(out, this->signed_integer_values_[row_idx]); return;
+                case ValueType::UnsignedInteger: this->write_formatted_value(out, this->unsigned_integer_values_[row_idx]); return;
+                case ValueType::FloatingPoint: this->write_formatted_value(out, this->floating_point_values_[row_idx]); return;
+                case ValueType::String: this->write_formatted_value(out, this->string_values_[row_idx]); return;
+            }
+            throw DataTableUndefinedColumnValueType(__FILE__, __LINE__, DataTableColumn::get_value_type_name_as_string(this->value_type_));
+        }
+
+        // Appends the formatted value of a cell to ``buffer``, using the
+        // compiled formatting if there is any (see compile_formatting()).
+        void append_formatted_cell(std::string & buffer, unsigned long row_idx) const {
+            const CompiledFormat & cf = this->compiled_format_;
+            if (!cf.is_valid) {
+                std::ostringstream o;
+                this->write_formatted_cell(o, row_idx);
+                buffer += o.str();
+                return;
+            }
+            switch (this->value_type_) {
+                case ValueType::SignedInteger: this->append_printf(buffer, this->signed_integer_values_[row_idx]); return;
+                case ValueType::UnsignedInteger: this->append_printf(buffer, this->unsigned_integer_values_[row_idx]); return;
+                case ValueType::FloatingPoint: this->append_printf(buffer, this->floating_point_values_[row_idx]); return;
+                case ValueType::String: {
+                    const std::string & v = this->string_values_[row_idx];
+                    std::size_t padding = v.size() < static_cast<std::size_t>(cf.width) ? cf.width - v.size() : 0;
+                    if (!cf.left_adjust) {
+                        buffer.append(padding, ' ');
+                    }
+                    buffer += v;
+                    if (cf.left_adjust) {
+                        buffer.append(padding, ' ');
+                    }
+                    return;
+                }
+            }
         }
-        virtual std::string to_string() const {
-            std::ostringstream o;
-            this->column_.write_formatted_value(o, this->value_);
-            std::istringstream i(o.str());
-            return o.str();
+
+        // Adds a default-valued (zero or empty) cell for a new row.
+        void append_value() {
+            switch (this->value_type_) {
+                case ValueType::SignedInteger: this->signed_integer_values_.push_back(0); return;
+                case ValueType::UnsignedInteger: this->unsigned_integer_values_.push_back(0); return;
+                case ValueType::FloatingPoint: this->floating_point_values_.push_back(0.0); return;
+                case ValueType::String: this->string_values_.emplace_back(); return;
+            }
+            throw DataTableUndefinedColumnValueType(__FILE__, __LINE__, DataTableColumn::get_value_type_name_as_string(this->value_type_));
         }
-        template <class U> U get() const {
-            return static_cast<U>(this->value_);
+
+        // Resets a cell to its default (zero or empty) value, keeping any
+        // storage it holds.
+        void reset_value(unsigned long row_idx) {
+            switch (this->value_type_) {
+                case ValueType::SignedInteger: this->signed_integer_values_[row_idx] = 0; return;
+                case ValueType::UnsignedInteger: this->unsigned_integer_values_[row_idx] = 0; return;
+                case ValueType::FloatingPoint: this->floating_point_values_[row_idx] = 0.0; return;
+                case ValueType::String: this->string_values_[row_idx].clear(); return;
+            }
         }
-        virtual void set(short int val) { this->value_ = static_cast<T>(val); }
-        virtual void set(unsigned short int val) { this->value_ = static_cast<T>(val); }
-        virtual void set(int val) { this->value_ = static_cast<T>(val); }
-        virtual void set(unsigned int val) { this->value_ = static_cast<T>(val); }
-        virtual void set(long int val) { this->value_ = static_cast<T>(val); }
-        virtual void set(unsigned long int val) { this->value_ = static_cast<T>(val); }
-        virtual void set(long long int val) { this->value_ = static_cast<T>(val); }
-        virtual void set(unsigned long long int val) { this->value_ = static_cast<T>(val); }
-        virtual void set(float val) { this->value_ = static_cast<T>(val); }
-        virtual void set(double val) { this->value_ = static_cast<T>(val); }
-        virtual void set(long double val) { this->value_ = static_cast<T>(val); }
-        virtual void set(const std::string & val) { this->from_string(val); }
 
-}; // DataTableNumericCell
+        void clear_values() {
+            this->signed_integer_values_.clear();
+            this->unsigned_integer_values_.clear();
+            this->floating_point_values_.clear();
+            this->string_values_.clear();
+        }
 
-//////////////////////////////////////////////////////////////////////////////
-// DataTableSignedIntegerCell
+        void reserve(unsigned long num_rows) {
+            switch (this->value_type_) {
+                case ValueType::SignedInteger: this->signed_integer_values_.reserve(num_rows); return;
+                case ValueType::UnsignedInteger: this->unsigned_integer_values_.reserve(num_rows); return;
+                case ValueType::FloatingPoint: this->floating_point_values_.reserve(num_rows); return;
+                case ValueType::String: this->string_values_.reserve(num_rows); return;
+            }
+        }
 
-class DataTableSignedIntegerCell : public DataTableNumericCell<DataTableColumn::signed_integer_implementation_type> {
-    public:
-        typedef DataTableColumn::signed_integer_implementation_type value_implementation_type;
-        DataTableSignedIntegerCell(const DataTableColumn & column)
-            : DataTableNumericCell<value_implementation_type>(column, 0) {
+        /**
+         * Accounts for the memory held by this column: ``num_objects`` is
+         * the number of values, ``object_bytes`` the storage reserved for
+         * them and, for string columns, ``heap_bytes`` the storage of strings
+         * too long to be held in place.
+         */
+        MemoryUsage memory_usage() const {
+            MemoryUsage usage;
+            usage.num_objects = this->num_values();
+            usage.object_bytes = memory::heap_bytes(this->signed_integer_values_)
+                + memory::heap_bytes(this->unsigned_integer_values_)
+                + memory::heap_bytes(this->floating_point_values_)
+                + memory::heap_bytes(this->string_values_);
+            for (auto & v : this->string_values_) {
+                usage.heap_bytes += memory::heap_bytes(v);
+            }
+            return usage;
+        }
+
+        // Moves all values of ``other`` (of the same value type) to the end
+        // of this column, leaving ``other`` empty; if this column is empty,
+        // the storage itself is exchanged rather than its elements moved.
+        void splice_values(DataTableColumn & other) {
+            switch (this->value_type_) {
+                case ValueType::SignedInteger: this->splice(this->signed_integer_values_, other.signed_integer_values_); return;
+                case ValueType::UnsignedInteger: this->splice(this->unsigned_integer_values_, other.unsigned_integer_values_); return;
+                case ValueType::FloatingPoint: this->splice(this->floating_point_values_, other.floating_point_values_); return;
+                case ValueType::String: this->splice(this->string_values_, other.string_values_); return;
+            }
         }
-        template <class U> U get() const {
-            return static_cast<U>(this->value_);
+
+        // Reorders the values from ``begin_row`` on so that the value at
+        // ``begin_row + i`` is the one previously at ``begin_row + order[i]``.
+        void permute_values(unsigned long begin_row, const std::vector<unsigned long> & order) {
+            switch (this->value_type_) {
+                case ValueType::SignedInteger: this->permute(this->signed_integer_values_, begin_row, order); return;
+                case ValueType::UnsignedInteger: this->permute(this->unsigned_integer_values_, begin_row, order); return;
+                case ValueType::FloatingPoint: this->permute(this->floating_point_values_, begin_row, order); return;
+                case ValueType::String: this->permute(this->string_values_, begin_row, order); return;
+            }
         }
-}; // specialization for long
-template <> inline std::string DataTableSignedIntegerCell::get() const { return this->to_string(); }
 
-//////////////////////////////////////////////////////////////////////////////
-// DataTableUnsignedIntegerCell
+    private:
+        // Formatting compiled by compile_formatting().
+        struct CompiledFormat {
+            bool            is_valid = false;
+            std::string     spec;
+            int             width = 0;
+            bool            left_adjust = false;
+        };
 
-class DataTableUnsignedIntegerCell : public DataTableNumericCell<DataTableColumn::unsigned_integer_implementation_type> {
-    public:
-        typedef DataTableColumn::unsigned_integer_implementation_type value_implementation_type;
-        DataTableUnsignedIntegerCell(const DataTableColumn & column)
-            : DataTableNumericCell<value_implementation_type>(column, 0) {
+        template <class U>
+        void append_printf(std::string & buffer, const U & val) const {
+            char local[64];
+            int size = std::snprintf(local, sizeof(local), this->compiled_format_.spec.c_str(), val);
+            if (size < 0) {
+                return;
+            }
+            if (static_cast<std::size_t>(size) < sizeof(local)) {
+                buffer.append(local, static_cast<std::size_t>(size));
+            } else {
+                // e.g., large values in fixed notation
+                std::size_t offset = buffer.size();
+                buffer.resize(offset + static_cast<std::size_t>(size) + 1);
+                std::snprintf(&buffer[offset], static_cast<std::size_t>(size) + 1, this->compiled_format_.spec.c_str(), val);
+                buffer.resize(offset + static_cast<std::size_t>(size));
+            }
         }
-        template <class U> U get() const {
-            return static_cast<U>(this->value_);
+
+        template <class U>
+        static void splice(std::vector<U> & dest, std::vector<U> & src) {
+            if (dest.empty()) {
+                dest.swap(src);
+            } else {
+                dest.insert(dest.end(), std::make_move_iterator(src.begin()), std::make_move_iterator(src.end()));
+            }
+            src.clear();
         }
-}; // specialization for unsigned long
-template <> inline std::string DataTableUnsignedIntegerCell::get() const { return this->to_string(); }
 
-//////////////////////////////////////////////////////////////////////////////
-// DataTableFloatingPointCell
+        template <class U>
+        static void permute(std::vector<U> & vals, unsigned long begin_row, const std::vector<unsigned long> & order) {
+            std::vector<U> permuted;
+            permuted.reserve(order.size());
+            for (auto idx : order) {
+                permuted.push_back(std::move(vals[begin_row + idx]));
+            }
+            std::move(permuted.begin(), permuted.end(), vals.begin() + begin_row);
+        }
 
-class DataTableFloatingPointCell : public DataTableNumericCell<DataTableColumn::floating_point_implementation_type> {
-    public:
-        typedef DataTableColumn::floating_point_implementation_type value_implementation_type;
-        DataTableFloatingPointCell(const DataTableColumn & column)
-            : DataTableNumericCell<value_implementation_type>(column, 0.0) {
+        std::vector<signed_integer_implementation_type> & mutable_storage(signed_integer_implementation_type *) {
+            return this->signed_integer_values_;
         }
-        template <class U> U get() const {
-            return static_cast<U>(this->value_);
+        std::vector<unsigned_integer_implementation_type> & mutable_storage(unsigned_integer_implementation_type *) {
+            return this->unsigned_integer_values_;
+        }
+        std::vector<floating_point_implementation_type> & mutable_storage(floating_point_implementation_type *) {
+            return this->floating_point_values_;
+        }
+        std::vector<string_implementation_type> & mutable_storage(string_implementation_type *) {
+            return this->string_values_;
         }
-}; // specialization for double
-template <> inline std::string DataTableFloatingPointCell::get() const { return this->to_string(); }
 
-//////////////////////////////////////////////////////////////////////////////
-// DataTableStringCell
+        template <class U, class FnT>
+        static void visit_range(const std::vector<U> & vals,
+                unsigned long begin_row,
+                unsigned long end_row,
+                FnT fn) {
+            if (end_row > vals.size()) {
+                end_row = vals.size();
+            }
+            const U * data = vals.data();
+            for (unsigned long idx = begin_row; idx < end_row; ++idx) {
+                fn(data[idx]);
+            }
+        }
 
-class DataTableStringCell : public DataTableValueTypedCell<DataTableColumn::string_implementation_type> {
-    public:
-        typedef DataTableColumn::string_implementation_type value_implementation_type;
+        const std::vector<signed_integer_implementation_type> & storage(signed_integer_implementation_type *) const {
+            return this->signed_integer_values_;
+        }
+        const std::vector<unsigned_integer_implementation_type> & storage(unsigned_integer_implementation_type *) const {
+            return this->unsigned_integer_values_;
+        }
+        const std::vector<floating_point_implementation_type> & storage(floating_point_implementation_type *) const {
+            return this->floating_point_values_;
+        }
+        const std::vector<string_implementation_type> & storage(string_implementation_type *) const {
+            return this->string_values_;
+        }
 
-        DataTableStringCell(const DataTableColumn & column)
-            : DataTableValueTypedCell<value_implementation_type>(column) { }
+        template <class T, class U>
+        typename std::enable_if<!std::is_same<T, string_implementation_type>::value, T>::type
+        numeric_as(const U & v) const {
+            return static_cast<T>(v);
+        }
+        template <class T, class U>
+        typename std::enable_if<std::is_same<T, string_implementation_type>::value, T>::type
+        numeric_as(const U & v) const {
+            std::ostringstream o;
+            this->write_formatted_value(o, v);
+            return o.str();
+        }
+        template <class T>
+        typename std::enable_if<!std::is_same<T, string_implementation_type>::value, T>::type
+        string_as(const string_implementation_type & v) const {
+            T u = T();
+            std::istringstream i(v);
+            i >> u;
+            return u;
+        }
+        template <class T>
+        typename std::enable_if<std::is_same<T, string_implementation_type>::value, T>::type
+        string_as(const string_implementation_type & v) const {
+            return v;
+        }
 
-        template <class U> void set(const U & val) {
+        template <class N, class T>
+        typename std::enable_if<std::is_arithmetic<T>::value>::type
+        assign_numeric(N & target, const T & val) const {
+            target = static_cast<N>(val);
+        }
+        template <class N, class T>
+        typename std::enable_if<!std::is_arithmetic<T>::value>::type
+        assign_numeric(N & target, const T & val) const {
+            std::istringstream i(val);
+            i >> target;
+        }
+        template <class T>
+        typename std::enable_if<std::is_convertible<const T &, string_implementation_type>::value>::type
+        assign_string(string_implementation_type & target, const T & val) const {
+            target = val;
+        }
+        template <class T>
+        typename std::enable_if<!std::is_convertible<const T &, string_implementation_type>::value>::type
+        assign_string(string_implementation_type & target, const T & val) const {
             std::ostringstream o;
-            this->column_.write_formatted_value(o, val);
-            this->value_ = o.str();
+            this->write_formatted_value(o, val);
+            target = o.str();
+        }
+
+    protected:
+        DataTable &                                 table_;
+        ValueType                                   value_type_;
+        std::string                                 label_;
+        bool                                        is_key_column_;
+        platypus::stream::OutputStreamFormatters    formatters_;
+        CompiledFormat                              compiled_format_;
+        bool                                        is_hidden_;
+        // only the vector corresponding to ``value_type_`` is used
+        std::vector<signed_integer_implementation_type>     signed_integer_values_;
+        std::vector<unsigned_integer_implementation_type>   unsigned_integer_values_;
+        std::vector<floating_point_implementation_type>     floating_point_values_;
+        std::vector<string_implementation_type>             string_values_;
+
+    template <class T> friend class DataTableColumnHandle;
+
+}; // DataTableColumn
+
+//////////////////////////////////////////////////////////////////////////////
+// DataTableColumnHandle
+
+/**
+ * A typed reference to a column of a DataTable, obtained through
+ * DataTable::column_handle(). The column is looked up, and its type
+ * checked, once, when the handle is created; values accessed through
+ * the handle are then read or written directly from or to the column
+ * storage, without name lookup or type dispatch:
+ *
+ *      auto length = table.column_handle<double>("tree_length");
+ *      auto ntips = table.column_handle<unsigned long>("num_tips");
+ *      for (...) {
+ *          auto & row = table.add_row();
+ *          row.set(length, tree_length);
+ *          row.set(ntips, num_tips);
+ *      }
+ *
+ * Unlike access by name or index, no conversion between value types takes
+ * place: ``T`` must be a type that maps to the value type of the column
+ * (an integral type of the same signedness, a floating-point type, or
+ * std::string), and values are simply cast to and from the column's
+ * implementation type. A handle remains valid as rows are added, for the
+ * lifetime of the table.
+ */
+template <class T>
+class DataTableColumnHandle {
+    static_assert(std::is_arithmetic<T>::value || std::is_same<T, DataTableColumn::string_implementation_type>::value,
+            "column handles must be of an arithmetic type or std::string");
+    public:
+        typedef T                                                               value_type;
+        typedef typename DataTableColumn::implementation_type<T>::type          implementation_type;
+
+    public:
+        DataTableColumnHandle()
+            : column_(nullptr)
+            , column_index_(0)
+            , values_(nullptr) { }
+        DataTableColumnHandle(DataTableColumn & column, unsigned long column_index)
+            : column_(&column)
+            , column_index_(column_index)
+            , values_(nullptr) {
+            if (DataTableColumn::identify_type<T>() != column.get_value_type()) {
+                throw DataTableUndefinedColumnValueType(__FILE__, __LINE__,
+                        DataTableColumn::get_value_type_name_as_string(DataTableColumn::identify_type<T>())
+                        + " handle requested for column '" + column.get_label() + "' of type "
+                        + DataTableColumn::get_value_type_name_as_string(column.get_value_type()));
+            }
+            this->values_ = &column.mutable_storage(static_cast<implementation_type *>(nullptr));
         }
-        void set(char * val) {
-            this->value_ = val;
+        inline T get(unsigned long row_idx) const {
+            return static_cast<T>((*this->values_)[row_idx]);
         }
-        void set(const char * val) {
-            this->value_ = val;
+        inline void set(unsigned long row_idx, const T & val) const {
+            (*this->values_)[row_idx] = static_cast<implementation_type>(val);
         }
-        template <class U> U get() const {
-            U u;
-            std::istringstream i(this->value_);
-            i >> u;
-            return u;
+        inline DataTableColumn & column() const {
+            return *this->column_;
+        }
+        inline unsigned long column_index() const {
+            return this->column_index_;
         }
-}; // specialization for std::string
-template <> inline std::string DataTableStringCell::get() const { return this->value_; }
-template <> inline void DataTableStringCell::set(const std::string & val) { this->value_ = val; }
+        inline bool is_valid() const {
+            return this->values_ != nullptr;
+        }
+    private:
+        DataTableColumn *                   column_;
+        unsigned long                       column_index_;
+        std::vector<implementation_type> *  values_;
+}; // DataTableColumnHandle
 
 //////////////////////////////////////////////////////////////////////////////
 // DataTableRow
 
+/**
+ * A view onto a single row of a DataTable: the values themselves are held by
+ * the columns.
+ */
 class DataTableRow {
 
     public:
         DataTableRow(
                 std::vector<DataTableColumn *> & columns,
-                std::map<std::string, unsigned long> & column_label_index_map)
+                std::unordered_map<std::string, unsigned long> & column_label_index_map,
+                unsigned long row_idx)
                 : columns_(columns)
                 , column_label_index_map_(column_label_index_map)
+                , row_idx_(row_idx)
                 , current_entry_cell_idx_(0) {
-            this->create_cells();
         }
 
-        ~DataTableRow() {
-            for (auto & c : this->cells_) {
-                delete c;
-            }
+        unsigned long get_row_index() const {
+            return this->row_idx_;
         }
 
         template <class T>
         const T get(unsigned long column_idx) const {
-            if (column_idx >= this->cells_.size()) {
+            if (column_idx >= this->columns_.size()) {
                 throw DataTableInvalidCellError(__FILE__, __LINE__, "column index is out of bounds: " + std::to_string(column_idx));
             }
-            auto * cell = this->cells_[column_idx];
-            return DataTableRow::get_cell_value<T>(cell);
+            return this->columns_[column_idx]->get<T>(this->row_idx_);
         }
 
         template <class T> T get(const std::string & col_name) const {
-            auto citer = this->column_label_index_map_.find(col_name);
-            if (citer == this->column_label_index_map_.end()) {
-                throw DataTableUndefinedColumnError(__FILE__, __LINE__, col_name);
-            }
-            return DataTableRow::get_cell_value<T>(this->cells_[citer->second]);
+            return this->columns_[this->get_column_index(col_name)]->get<T>(this->row_idx_);
+        }
+
+        template <class T> T get(const DataTableColumnHandle<T> & handle) const {
+            return handle.get(this->row_idx_);
+        }
+
+        template <class T> void set(const DataTableColumnHandle<T> & handle, const typename DataTableColumnHandle<T>::value_type & val) {
+            handle.set(this->row_idx_, val);
         }
 
         template <class T>
         DataTableRow & operator<<(const T & val) {
-            if (this->current_entry_cell_idx_ >= this->cells_.size()) {
+            if (this->current_entry_cell_idx_ >= this->columns_.size()) {
                 throw DataTableInvalidCellError(__FILE__, __LINE__, "attempting to add data beyond end of row");
             }
-            auto * cell = this->cells_[this->current_entry_cell_idx_];
-            this->set_cell_value(cell, val);
+            this->columns_[this->current_entry_cell_idx_]->set(this->row_idx_, val);
             ++this->current_entry_cell_idx_;
             return * this;
         }
 
         template <class T>
         void set(unsigned long column_idx, const T & val) {
-            if (column_idx >= this->cells_.size()) {
+            if (column_idx >= this->columns_.size()) {
                 throw DataTableInvalidCellError(__FILE__, __LINE__, "column index is out of bounds: " + std::to_string(column_idx));
             }
-            auto * cell = this->cells_[column_idx];
-            this->set_cell_value(cell, val);
+            this->columns_[column_idx]->set(this->row_idx_, val);
         }
 
         template <class T>
         void set(const std::string & col_name, const T & val) {
-            auto citer = this->column_label_index_map_.find(col_name);
-            if (citer == this->column_label_index_map_.end()) {
-                throw DataTableUndefinedColumnError(__FILE__, __LINE__, col_name);
-            }
-            this->set_cell_value(this->cells_[citer->second], val);
-        }
-
-        const DataTableBaseCell & cell(unsigned long column_idx) const {
-            if (column_idx >= this->cells_.size()) {
-                throw DataTableInvalidCellError(__FILE__, __LINE__, "column index is out of bounds: " + std::to_string(column_idx));
-            }
-            return *this->cells_[column_idx];
-        }
-
-        const DataTableBaseCell & cell(const std::string & col_name) const {
-            auto citer = this->column_label_index_map_.find(col_name);
-            if (citer == this->column_label_index_map_.end()) {
-                throw DataTableUndefinedColumnError(__FILE__, __LINE__, col_name);
-            }
-            return *this->cells_[citer->second];
+            this->columns_[this->get_column_index(col_name)]->set(this->row_idx_, val);
         }
 
         //////////////////////////////////////////////////////////////////////////////
         // Iteration
 
-        template <class ValueT, class IterT>
+        template <class ValueT>
         class iterator {
             public:
 				typedef iterator                     self_type;
@@ -451,11 +837,12 @@ class DataTableRow {
 				typedef int                          difference_type;
 				typedef std::forward_iterator_tag    iterator_category;
 			public:
-                iterator(IterT cell_iter, IterT cell_end)
-                        : cell_iter_(cell_iter)
-                        , cell_end_(cell_end) {
-                    if (this->cell_iter_ != this->cell_end_) {
-                        this->current_value_ = DataTableRow::get_cell_value<ValueT>(*this->cell_iter_);
+                iterator(std::vector<DataTableColumn *> & columns, unsigned long row_idx, unsigned long column_idx)
+                        : columns_(&columns)
+                        , row_idx_(row_idx)
+                        , column_idx_(column_idx) {
+                    if (this->column_idx_ < this->columns_->size()) {
+                        this->current_value_ = (*this->columns_)[this->column_idx_]->template get<ValueT>(this->row_idx_);
                     }
                 }
                 virtual ~iterator() {
@@ -467,17 +854,17 @@ class DataTableRow {
                     return &(this->current_value_);
                 }
                 inline bool operator==(const self_type& rhs) const {
-                    return this->cell_iter_ == rhs.cell_iter_;
+                    return this->column_idx_ == rhs.column_idx_;
                 }
                 inline bool operator!=(const self_type& rhs) const {
                     return !(*this == rhs);
                 }
                 inline const self_type & operator++() {
                 // inline self_type operator++() {
-                    if (this->cell_iter_ != this->cell_end_) {
-                        ++this->cell_iter_;
-                        if (this->cell_iter_ != this->cell_end_) {
-                            this->current_value_ = DataTableRow::get_cell_value<ValueT>(*this->cell_iter_);
+                    if (this->column_idx_ < this->columns_->size()) {
+                        ++this->column_idx_;
+                        if (this->column_idx_ < this->columns_->size()) {
+                            this->current_value_ = (*this->columns_)[this->column_idx_]->template get<ValueT>(this->row_idx_);
                         }
                     }
                     return *this;
@@ -489,27 +876,28 @@ class DataTableRow {
                 }
                 template <class U>
                 inline void set(const U & val) {
-                    if (this->cell_iter_ != this->cell_end_) {
-                        DataTableRow::set_cell_value(*this->cell_iter_, val);
-                        this->current_value_ = DataTableRow::get_cell_value<ValueT>(*this->cell_iter_);
+                    if (this->column_idx_ < this->columns_->size()) {
+                        (*this->columns_)[this->column_idx_]->set(this->row_idx_, val);
+                        this->current_value_ = (*this->columns_)[this->column_idx_]->template get<ValueT>(this->row_idx_);
                     } else {
                         throw DataTableInvalidCellError(__FILE__, __LINE__, "cell index is out of bounds");
                     }
                 }
             protected:
-                IterT   cell_iter_;
-                IterT   cell_end_;
-                ValueT  current_value_;
+                std::vector<DataTableColumn *> *    columns_;
+                unsigned long                       row_idx_;
+                unsigned long                       column_idx_;
+                ValueT                              current_value_;
         }; // iterator
 
         template <class ValueT=std::string>
-        iterator<ValueT, std::vector<DataTableBaseCell *>::iterator> begin() {
-            return iterator<ValueT, std::vector<DataTableBaseCell *>::iterator>(this->cells_.begin(), this->cells_.end());
+        iterator<ValueT> begin() {
+            return iterator<ValueT>(this->columns_, this->row_idx_, 0);
         }
 
         template <class ValueT=std::string>
-        iterator<ValueT, std::vector<DataTableBaseCell *>::iterator> end() {
-            return iterator<ValueT, std::vector<DataTableBaseCell *>::iterator>(this->cells_.end(), this->cells_.end());
+        iterator<ValueT> end() {
+            return iterator<ValueT>(this->columns_, this->row_idx_, this->columns_.size());
         }
 
         //////////////////////////////////////////////////////////////////////////////
@@ -517,12 +905,12 @@ class DataTableRow {
 
         void write_formatted(std::ostream & out, const std::string & column_separator="\t") {
             unsigned long print_idx = 0;
-            for(unsigned long cell_idx = 0; cell_idx < this->cells_.size(); ++cell_idx) {
+            for(unsigned long cell_idx = 0; cell_idx < this->columns_.size(); ++cell_idx) {
                 if (!this->columns_[cell_idx]->is_hidden()) {
                     if (print_idx > 0) {
                         out << column_separator;
                     }
-                    DataTableRow::write_formatted_cell(out, this->cells_[cell_idx]);
+                    this->columns_[cell_idx]->write_formatted_cell(out, this->row_idx_);
                     print_idx += 1;
                 }
             }
@@ -542,7 +930,7 @@ class DataTableRow {
                             if (printed_idx > 0) {
                                 out << column_separator;
                             }
-                            DataTableRow::write_formatted_cell(out, &(this->cell(key_col->get_label())));
+                            key_col->write_formatted_cell(out, this->row_idx_);
                             printed_idx += 1;
                         }
                     } // key colums
@@ -551,106 +939,125 @@ class DataTableRow {
                     }
                     out << data_col->get_label();
                     out << column_separator;
-                    DataTableRow::write_formatted_cell(out, &(this->cell(data_col->get_label())));
+                    data_col->write_formatted_cell(out, this->row_idx_);
                     printed_idx += 2;
                     out << "\n";
                 }
             } // data columns
         }
 
+    private:
+        unsigned long get_column_index(const std::string & col_name) const {
+            auto citer = this->column_label_index_map_.find(col_name);
+            if (citer == this->column_label_index_map_.end()) {
+                throw DataTableUndefinedColumnError(__FILE__, __LINE__, col_name);
+            }
+            return citer->second;
+        }
+
+    private:
+        std::vector<DataTableColumn *> &          columns_;
+        std::unordered_map<std::string, unsigned long> &    column_label_index_map_;
+        unsigned long                             row_idx_;
+        unsigned long                             current_entry_cell_idx_;
+
+    friend class DataTable;
+
+}; // DataTableRow
+
+//////////////////////////////////////////////////////////////////////////////
+// DataTableShard
+
+/**
+ * A buffer of rows with the same columns as a DataTable, for appending rows
+ * from several threads without locking: each thread fills its own shard
+ * (obtained from DataTable::create_shard()), and the shards are then
+ * appended to the table (DataTable::append_shard(), or
+ * DataTable::append_shards()), which moves the column storage of each
+ * rather than copying its rows:
+ *
+ *      std::vector<platypus::DataTableShard> shards;
+ *      for (unsigned int idx = 0; idx < num_threads; ++idx) {
+ *          shards.push_back(table.create_shard());
+ *      }
+ *      platypus::parallel_for(num_replicates, num_threads, [&](std::size_t idx) { ... });
+ *      table.append_shards(shards, "replicate");
+ *
+ * The rows returned by add_row() are transient views onto the shard, valid
+ * until the shard is moved or appended; columns may not be added to the
+ * table while it has shards.
+ */
+class DataTableShard {
+
     public:
+        typedef DataTableRow                     Row;
 
-        template <class T>
-        static const T get_cell_value(DataTableBaseCell * cell) {
-            auto & column_definition = cell->column();
-            auto cell_value_type = column_definition.get_value_type();
-            if (cell_value_type == DataTableColumn::ValueType::SignedInteger) {
-                DataTableSignedIntegerCell * t = dynamic_cast<DataTableSignedIntegerCell *>(cell);
-                return t->get<T>();
-            } else if (cell_value_type == DataTableColumn::ValueType::UnsignedInteger) {
-                DataTableUnsignedIntegerCell * t = dynamic_cast<DataTableUnsignedIntegerCell *>(cell);
-                return t->get<T>();
-            } else if (cell_value_type == DataTableColumn::ValueType::FloatingPoint) {
-                DataTableFloatingPointCell * t = dynamic_cast<DataTableFloatingPointCell *>(cell);
-                return t->get<T>();
-            } else if (cell_value_type == DataTableColumn::ValueType::String) {
-                DataTableStringCell * t = dynamic_cast<DataTableStringCell *>(cell);
-                return t->get<T>();
-            } else {
-                throw DataTableUndefinedColumnValueType(__FILE__, __LINE__, DataTableColumn::get_value_type_name_as_string(cell_value_type));
+    public:
+        DataTableShard(DataTable & table,
+                const std::vector<DataTableColumn *> & table_columns,
+                std::unordered_map<std::string, unsigned long> & column_label_index_map)
+            : column_label_index_map_(&column_label_index_map)
+            , num_rows_(0) {
+            for (auto table_col : table_columns) {
+                this->owned_columns_.emplace_back(new DataTableColumn(table,
+                        table_col->get_value_type(),
+                        table_col->get_label(),
+                        table_col->is_key_column(),
+                        table_col->get_formatting()));
+                this->columns_.push_back(this->owned_columns_.back().get());
+            }
+        }
+        DataTableShard(DataTableShard && other) = default;
+        DataTableShard & operator=(DataTableShard && other) = default;
+        DataTableShard(const DataTableShard &) = delete;
+        DataTableShard & operator=(const DataTableShard &) = delete;
+
+        /**
+         * Adds a new row, with all cells set to zero or empty values, and
+         * returns a view onto it, which may be filled in the same ways as a
+         * DataTable::Row:
+         *
+         *      shard.add_row() << idx << tree_length;
+         */
+        Row add_row() {
+            for (auto & col : this->columns_) {
+                col->append_value();
             }
+            return Row(this->columns_, *this->column_label_index_map_, this->num_rows_++);
         }
 
-        template <class T>
-        static void set_cell_value(DataTableBaseCell * cell, const T & val) {
-            auto & column_definition = cell->column();
-            auto cell_value_type = column_definition.get_value_type();
-            if (cell_value_type == DataTableColumn::ValueType::SignedInteger) {
-                DataTableSignedIntegerCell * t = dynamic_cast<DataTableSignedIntegerCell *>(cell);
-                t->set(val);
-            } else if (cell_value_type == DataTableColumn::ValueType::UnsignedInteger) {
-                DataTableUnsignedIntegerCell * t = dynamic_cast<DataTableUnsignedIntegerCell *>(cell);
-                t->set(val);
-            } else if (cell_value_type == DataTableColumn::ValueType::FloatingPoint) {
-                DataTableFloatingPointCell * t = dynamic_cast<DataTableFloatingPointCell *>(cell);
-                t->set(val);
-            } else if (cell_value_type == DataTableColumn::ValueType::String) {
-                DataTableStringCell * t = dynamic_cast<DataTableStringCell *>(cell);
-                t->set(val);
-            } else {
-                throw DataTableUndefinedColumnValueType(__FILE__, __LINE__, DataTableColumn::get_value_type_name_as_string(cell_value_type));
-            }
-        }
-
-        static void write_formatted_cell(std::ostream & out, const DataTableBaseCell * cell) {
-            auto & column_definition = cell->column();
-            auto cell_value_type = column_definition.get_value_type();
-            if (cell_value_type == DataTableColumn::ValueType::SignedInteger) {
-                const DataTableSignedIntegerCell * t = dynamic_cast<const DataTableSignedIntegerCell *>(cell);
-                t->write_formatted(out);
-            } else if (cell_value_type == DataTableColumn::ValueType::UnsignedInteger) {
-                const DataTableUnsignedIntegerCell * t = dynamic_cast<const DataTableUnsignedIntegerCell *>(cell);
-                t->write_formatted(out);
-            } else if (cell_value_type == DataTableColumn::ValueType::FloatingPoint) {
-                const DataTableFloatingPointCell * t = dynamic_cast<const DataTableFloatingPointCell *>(cell);
-                t->write_formatted(out);
-            } else if (cell_value_type == DataTableColumn::ValueType::String) {
-                const DataTableStringCell * t = dynamic_cast<const DataTableStringCell *>(cell);
-                t->write_formatted(out);
-            } else {
-                throw DataTableUndefinedColumnValueType(__FILE__, __LINE__, DataTableColumn::get_value_type_name_as_string(cell_value_type));
+        // Preallocates column storage for ``num_rows`` rows in total.
+        void reserve(unsigned long num_rows) {
+            for (auto & col : this->columns_) {
+                col->reserve(num_rows);
             }
         }
 
-    protected:
-        void create_cells() {
-            this->current_entry_cell_idx_ = 0;
-            this->cells_.reserve(this->columns_.size());
-            for (auto & column : this->columns_) {
-                auto cell_value_type = column->get_value_type();
-                DataTableBaseCell * new_cell = nullptr;
-                if (cell_value_type == DataTableColumn::ValueType::SignedInteger) {
-                    new_cell = new DataTableSignedIntegerCell(*column);
-                } else if (cell_value_type == DataTableColumn::ValueType::UnsignedInteger) {
-                    new_cell = new DataTableUnsignedIntegerCell(*column);
-                } else if (cell_value_type == DataTableColumn::ValueType::FloatingPoint) {
-                    new_cell = new DataTableFloatingPointCell(*column);
-                } else if (cell_value_type == DataTableColumn::ValueType::String) {
-                    new_cell = new DataTableStringCell(*column);
-                } else {
-                    throw DataTableUndefinedColumnValueType(__FILE__, __LINE__, DataTableColumn::get_value_type_name_as_string(cell_value_type));
-                }
-                this->cells_.push_back(new_cell);
+        unsigned long num_rows() const {
+            return this->num_rows_;
+        }
+
+        /**
+         * Returns a typed handle onto a column of this shard (see
+         * DataTableColumnHandle), to be used with rows of this shard only.
+         */
+        template <class T> DataTableColumnHandle<T> column_handle(const std::string & col_name) {
+            auto citer = this->column_label_index_map_->find(col_name);
+            if (citer == this->column_label_index_map_->end()) {
+                throw DataTableUndefinedColumnError(__FILE__, __LINE__, col_name);
             }
+            return DataTableColumnHandle<T>(*this->columns_[citer->second], citer->second);
         }
 
     private:
-        std::vector<DataTableColumn *> &          columns_;
-        std::map<std::string, unsigned long> &    column_label_index_map_;
-        std::vector<DataTableBaseCell *>          cells_;
-        unsigned long                             current_entry_cell_idx_;
+        std::vector<std::unique_ptr<DataTableColumn>>       owned_columns_;
+        std::vector<DataTableColumn *>                      columns_;
+        std::unordered_map<std::string, unsigned long> *    column_label_index_map_;
+        unsigned long                                       num_rows_;
 
-}; // DataTableRow
+    friend class DataTable;
+
+}; // DataTableShard
 
 //////////////////////////////////////////////////////////////////////////////
 // Table
@@ -672,8 +1079,18 @@ class DataTable {
                 , minimum(0.0)
                 , maximum(0.0)
                 , mean(0.0)
+                , sum_of_squares(0.0)
                 , sample_variance(0.0)
                 , population_variance(0.0) { }
+            Summary(const platypus::numeric::RunningStatistics<T> & stats)
+                : size(static_cast<T>(stats.size()))
+                , sum(stats.sum())
+                , minimum(stats.minimum())
+                , maximum(stats.maximum())
+                , mean(stats.mean())
+                , sum_of_squares(stats.sum_of_squared_deviations())
+                , sample_variance(stats.sample_variance())
+                , population_variance(stats.population_variance()) { }
             Summary(Summary && other) {
                 *this = other;
             }
@@ -702,12 +1119,12 @@ class DataTable {
         };
 
     public:
-        DataTable() {
+        DataTable()
+            : num_rows_streamed_(0)
+            , use_compiled_formatting_(false) {
         }
         ~DataTable() {
-            for (auto & r : this->rows_) {
-                delete r;
-            }
+            this->end_streaming();
             for (auto & c : this->columns_) {
                 delete c;
             }
@@ -729,12 +1146,120 @@ class DataTable {
             auto & col = this->create_column<T>(label, false, formatters);
             return col;
         }
+        /**
+         * Adds a new row, with all cells set to zero or empty values, and
+         * returns a reference to it.
+         *
+         * In streaming mode (see begin_streaming()), the table only ever
+         * holds the row currently being filled: adding a row first writes
+         * out the previous one and then recycles it, so the reference
+         * returned by the previous call refers to the new row.
+         */
         Row & add_row() {
-            Row * r = new Row(this->columns_,
-                    this->column_label_index_map_);
-            this->rows_.push_back(r);
-            return *r;
+            if (this->stream_sink_) {
+                if (!this->rows_.empty()) {
+                    this->write_streamed_row();
+                    Row & row = this->rows_.front();
+                    for (auto & col : this->columns_) {
+                        col->reset_value(0);
+                    }
+                    row.current_entry_cell_idx_ = 0;
+                    return row;
+                }
+            }
+            for (auto & col : this->columns_) {
+                col->append_value();
+            }
+            this->rows_.emplace_back(this->columns_,
+                    this->column_label_index_map_,
+                    this->rows_.size());
+            return this->rows_.back();
+        }
+        // Preallocates column storage for ``num_rows`` rows in total.
+        void reserve(unsigned long num_rows) {
+            for (auto & col : this->columns_) {
+                col->reserve(num_rows);
+            }
+        }
+
+        /**
+         * Returns an empty shard with the columns of this table, to which
+         * rows can be added independently of (and concurrently with) other
+         * shards (see DataTableShard).
+         */
+        DataTableShard create_shard() {
+            return DataTableShard(*this, this->columns_, this->column_label_index_map_);
+        }
+
+        /**
+         * Appends the rows of ``shard`` to this table, in order, leaving the
+         * shard empty. The column storage of the shard is moved rather than
+         * copied (and, for the first shard appended to an empty table,
+         * taken over whole).
+         */
+        void append_shard(DataTableShard & shard) {
+            if (this->stream_sink_) {
+                throw DataTableStructureError(__FILE__, __LINE__, "Cannot append shard: table is streaming");
+            }
+            if (shard.columns_.size() != this->columns_.size()) {
+                throw DataTableStructureError(__FILE__, __LINE__, "Cannot append shard: columns do not match");
+            }
+            for (unsigned long col_idx = 0; col_idx < this->columns_.size(); ++col_idx) {
+                this->columns_[col_idx]->splice_values(*shard.columns_[col_idx]);
+            }
+            for (unsigned long idx = 0; idx < shard.num_rows_; ++idx) {
+                this->rows_.emplace_back(this->columns_,
+                        this->column_label_index_map_,
+                        this->rows_.size());
+            }
+            shard.num_rows_ = 0;
+        }
+
+        /**
+         * Appends the rows of each of ``shards`` in turn (see
+         * append_shard()). If ``order_by_column_name`` is given, the
+         * appended rows are then (stably) sorted by the values of that
+         * column, so that the result does not depend on which rows were
+         * added to which shard, e.g., when rows are keyed by replicate index
+         * and replicates are distributed dynamically across threads.
+         */
+        void append_shards(std::vector<DataTableShard> & shards, const std::string & order_by_column_name="") {
+            unsigned long begin_row = this->rows_.size();
+            unsigned long num_rows = begin_row;
+            for (auto & shard : shards) {
+                num_rows += shard.num_rows();
+            }
+            this->reserve(num_rows);
+            for (auto & shard : shards) {
+                this->append_shard(shard);
+            }
+            if (!order_by_column_name.empty()) {
+                this->sort_rows(begin_row, this->column(order_by_column_name));
+            }
+        }
+
+        /**
+         * Accounts for the memory held by the table: the sum of
+         * DataTableColumn::memory_usage() over the columns, with the row
+         * views and column index as bookkeeping; ``num_objects`` is the
+         * number of rows.
+         */
+        MemoryUsage memory_usage() const {
+            MemoryUsage usage;
+            for (auto & col : this->columns_) {
+                MemoryUsage col_usage = col->memory_usage();
+                usage.object_bytes += col_usage.object_bytes;
+                usage.heap_bytes += col_usage.heap_bytes;
+                usage.bookkeeping_bytes += sizeof(Column) + memory::heap_bytes(col->get_label());
+            }
+            usage.num_objects = this->rows_.size();
+            usage.bookkeeping_bytes += this->rows_.size() * sizeof(Row)
+                + memory::heap_bytes(this->columns_)
+                + this->column_label_index_map_.bucket_count() * sizeof(void *)
+                + this->column_label_index_map_.size() * (sizeof(std::string) + sizeof(unsigned long) + sizeof(void *));
+            return usage;
         }
+
         unsigned long num_columns() const {
             return this->column_label_index_map_.size();
         }
@@ -745,10 +1270,10 @@ class DataTable {
             if (ridx >= this->rows_.size()) {
                 throw DataTableInvalidRowError(__FILE__, __LINE__, "row index is out of bounds");
             }
-            return *this->rows_[ridx];
+            return this->rows_[ridx];
         }
         const Row & operator[](unsigned long ridx) const {
-            return this->operator[](ridx);
+            return const_cast<DataTable *>(this)->operator[](ridx);
         }
         Row & row(unsigned long ridx) {
             return this->operator[](ridx);
@@ -763,7 +1288,7 @@ class DataTable {
             return *(this->columns_[column_idx]);
         }
         const Column & column(unsigned long column_idx) const {
-                                return this->column(column_idx);
+            return const_cast<DataTable *>(this)->column(column_idx);
         }
         Column & column(const std::string & col_name) {
             auto citer = this->column_label_index_map_.find(col_name);
@@ -773,7 +1298,7 @@ class DataTable {
             return *(this->columns_[citer->second]);
         }
         const Column & column(const std::string & col_name) const {
-            return this->column(col_name);
+            return const_cast<DataTable *>(this)->column(col_name);
         }
         const std::vector<const Column *> column_ptrs() const {
             std::vector<const Column *> columns;
@@ -823,36 +1348,112 @@ class DataTable {
         template <class T> const T get(unsigned long ridx, unsigned long cidx) const {
             return this->row(ridx).get<T>(cidx);
         }
+        template <class T> T get(unsigned long ridx, const DataTableColumnHandle<T> & handle) const {
+            return this->row(ridx).get(handle);
+        }
+
+        /**
+         * Returns a typed handle for fast, repeated access to the named
+         * column (see DataTableColumnHandle).
+         *
+         * @throws DataTableUndefinedColumnError
+         *   If there is no column named ``col_name``.
+         * @throws DataTableUndefinedColumnValueType
+         *   If ``T`` does not correspond to the value type of the column.
+         */
+        template <class T> DataTableColumnHandle<T> column_handle(const std::string & col_name) {
+            auto citer = this->column_label_index_map_.find(col_name);
+            if (citer == this->column_label_index_map_.end()) {
+                throw DataTableUndefinedColumnError(__FILE__, __LINE__, col_name);
+            }
+            return DataTableColumnHandle<T>(*this->columns_[citer->second], citer->second);
+        }
+        template <class T> DataTableColumnHandle<T> column_handle(unsigned long column_idx) {
+            return DataTableColumnHandle<T>(this->column(column_idx), column_idx);
+        }
+
         template <class T>
         std::vector<T> get_column(const std::string & col_name) const {
-            std::vector<T> vals;
-            vals.reserve(this->rows_.size());
-            for (auto & row : this->rows_) {
-                vals.push_back(row->get<T>(col_name));
-            }
-            return vals;
+            return this->column(col_name).get_values<T>();
         }
         template <class T>
         std::vector<T> get_column(unsigned long cidx) const {
-            std::vector<T> vals;
-            vals.reserve(this->rows_.size());
-            for (auto & row : this->rows_) {
-                vals.push_back(row->get<T>(cidx));
-            }
-            return vals;
-        }
-
+            return this->column(cidx).get_values<T>();
+        }
+
+        /**
+         * Summarizes the values of a column, converted to ``T``, in a single
+         * pass over the column storage.
+         *
+         * @param num_threads
+         *   If not 1, the rows are split into contiguous blocks which are
+         *   summarized concurrently by up to this many threads (0: as many
+         *   as there are hardware threads) and then merged in row order.
+         * @param use_compensated_sum
+         *   Accumulate the sum with compensated (Kahan-Babuska-Neumaier)
+         *   summation.
+         */
         template <class T=DataTableColumn::floating_point_implementation_type>
-        Summary<T> summarize_column(const std::string & col_name) const {
-            auto vals = this->get_column<T>(col_name);
-            return DataTable::summarize(vals);
+        Summary<T> summarize_column(const std::string & col_name,
+                unsigned int num_threads=1,
+                bool use_compensated_sum=false) const {
+            return Summary<T>(this->accumulate_column<T>(this->column(col_name), num_threads, use_compensated_sum));
         }
 
         template <class T=DataTableColumn::floating_point_implementation_type>
-        Summary<T> summarize_column(unsigned long cidx) const {
-            auto vals = this->get_column<T>(cidx);
-            return DataTable::summarize(vals);
-        }
+        Summary<T> summarize_column(unsigned long cidx,
+                unsigned int num_threads=1,
+                bool use_compensated_sum=false) const {
+            return Summary<T>(this->accumulate_column<T>(this->column(cidx), num_threads, use_compensated_sum));
+        }
+
+        /**
+         * Adds the values of rows [``begin_row``, ``num_rows()``) of a column
+         * to ``stats``. Calling this with the number of rows summarized so
+         * far keeps a summary up to date as rows are added:
+         *
+         *      platypus::numeric::RunningStatistics<> stats;
+         *      unsigned long num_summarized = 0;
+         *      ...
+         *      table.update_column_summary("length", stats, num_summarized);
+         *      num_summarized = table.num_rows();
+         */
+        template <class T>
+        void update_column_summary(const std::string & col_name,
+                platypus::numeric::RunningStatistics<T> & stats,
+                unsigned long begin_row=0) const {
+            this->column(col_name).visit_values_as<T>(
+                    [&stats](const T & v) { stats.add(v); },
+                    begin_row);
+        }
+
+        /**
+         * Groups the rows by the values of the columns named in
+         * ``key_column_names`` (by default, the key columns of the table),
+         * for grouped summaries (see DataTableGroups):
+         *
+         *      platypus::DataTable summary;
+         *      table.group_by({"birth_rate", "death_rate"}).summarize(summary, {"tree_length"});
+         *
+         * The grouping holds a reference to this table, and is invalidated
+         * if rows are added.
+         */
+        DataTableGroups group_by(const std::vector<std::string> & key_column_names={},
+                unsigned int num_threads=1) const;
+
+        /**
+         * Returns a view of the columns named in ``column_names`` (by
+         * default, all columns) and all rows of this table, whose rows may
+         * then be filtered without copying any values (see DataTableView):
+         *
+         *      auto view = table.select({"birth_rate", "tree_length"})
+         *          .where<double>("birth_rate", [](double v) { return v > 0.1; });
+         *      auto summary = view.summarize_column("tree_length");
+         *
+         * The view holds a reference to this table, and is invalidated if
+         * rows are added.
+         */
+        DataTableView select(const std::vector<std::string> & column_names={}) const;
 
         //////////////////////////////////////////////////////////////////////////////
         // Iteration
@@ -877,10 +1478,10 @@ class DataTable {
                 virtual ~iterator() {
                 }
                 inline reference operator*() {
-                    return **this->row_iter_;
+                    return *this->row_iter_;
                 }
                 inline pointer operator->() {
-                    return &(**this->row_iter_);
+                    return &(*this->row_iter_);
                 }
                 inline bool operator==(const self_type& rhs) const {
                     return this->row_iter_ == rhs.row_iter_;
@@ -905,12 +1506,103 @@ class DataTable {
                 IterT   row_end_;
         }; // iterator
 
-        iterator<std::vector<Row *>::iterator> begin() {
-            return iterator<std::vector<Row *>::iterator>(this->rows_.begin(), this->rows_.end());
+        iterator<std::deque<Row>::iterator> begin() {
+            return iterator<std::deque<Row>::iterator>(this->rows_.begin(), this->rows_.end());
         }
 
-        iterator<std::vector<Row *>::iterator> end() {
-            return iterator< std::vector<Row *>::iterator>(this->rows_.end(), this->rows_.end());
+        iterator<std::deque<Row>::iterator> end() {
+            return iterator<std::deque<Row>::iterator>(this->rows_.end(), this->rows_.end());
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Streaming
+
+        /**
+         * Switches the table to streaming mode, in which rows are written to
+         * ``out`` as they are completed rather than held in memory. The
+         * header row is written immediately, and no further columns may be
+         * added. A row is complete when the next row is added, or when
+         * streaming ends (end_streaming(), or destruction of the table).
+         *
+         * Formatted rows are collected in a buffer that is written to
+         * ``out`` whenever it reaches ``block_size`` bytes, by a background
+         * thread if ``write_in_background`` is true (in which case ``out``
+         * must not be used by anything else until streaming ends).
+         */
+        void begin_streaming(std::ostream & out,
+                const std::string & column_separator="\t",
+                bool include_header_row=true,
+                std::size_t block_size=65536,
+                bool write_in_background=false) {
+            if (this->stream_sink_) {
+                throw DataTableStructureError(__FILE__, __LINE__, "Cannot begin streaming: table is already streaming");
+            }
+            if (!this->rows_.empty()) {
+                throw DataTableStructureError(__FILE__, __LINE__, "Cannot begin streaming: rows have already been added");
+            }
+            if (this->use_compiled_formatting_) {
+                this->compile_column_formatting();
+            }
+            this->stream_sink_.reset(new platypus::stream::BlockOutputBuffer(out, block_size, write_in_background));
+            this->stream_column_separator_ = column_separator;
+            this->num_rows_streamed_ = 0;
+            if (include_header_row) {
+                std::string & buffer = this->stream_sink_->buffer();
+                unsigned long printed_idx = 0;
+                for (auto & col : this->columns_) {
+                    if (!col->is_hidden()) {
+                        if (printed_idx > 0) {
+                            buffer += column_separator;
+                        }
+                        buffer += col->get_label();
+                        printed_idx += 1;
+                    }
+                }
+                buffer += "\n";
+                this->stream_sink_->commit();
+            }
+        }
+
+        /**
+         * Writes out the row in progress (if any), flushes all output, and
+         * returns the table to normal (non-streaming) mode, empty of rows.
+         */
+        void end_streaming() {
+            if (!this->stream_sink_) {
+                return;
+            }
+            if (!this->rows_.empty()) {
+                this->write_streamed_row();
+            }
+            this->stream_sink_->close();
+            this->stream_sink_.reset();
+            this->rows_.clear();
+            for (auto & col : this->columns_) {
+                col->clear_values();
+            }
+        }
+
+        bool is_streaming() const {
+            return static_cast<bool>(this->stream_sink_);
+        }
+
+        // Number of rows written out in the current (or last) streaming session.
+        unsigned long num_rows_streamed() const {
+            return this->num_rows_streamed_;
+        }
+
+        /**
+         * If ``compiled`` is true, the formatting of each column is compiled
+         * (see DataTableColumn::compile_formatting()) when the table is
+         * written or streaming begins, and rows are formatted into a buffer
+         * that is written out in blocks, rather than cell by cell through
+         * the stream.
+         */
+        void set_compiled_formatting(bool compiled) {
+            this->use_compiled_formatting_ = compiled;
+        }
+        bool is_formatting_compiled() const {
+            return this->use_compiled_formatting_;
         }
 
         void write(std::ostream & out,
@@ -932,8 +1624,21 @@ class DataTable {
             }
             out << "\n";
 
+            if (this->use_compiled_formatting_) {
+                this->compile_column_formatting();
+                std::string buffer;
+                for (unsigned long row_idx = 0; row_idx < this->rows_.size(); ++row_idx) {
+                    this->append_formatted_row(buffer, row_idx, column_separator);
+                    if (buffer.size() >= COMPILED_OUTPUT_BLOCK_SIZE) {
+                        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                        buffer.clear();
+                    }
+                }
+                out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                return;
+            }
             for (auto & row : this->rows_) {
-                row->write_formatted(out, column_separator);
+                row.write_formatted(out, column_separator);
             }
         }
 
@@ -973,38 +1678,233 @@ class DataTable {
             out << stacked_field_identifier_label << column_separator << stacked_field_value_label << "\n";
 
             // print rows
+            if (this->use_compiled_formatting_) {
+                this->compile_column_formatting();
+            }
             for (auto & row : this->rows_) {
-                row->write_stacked(out,
+                row.write_stacked(out,
                         key_columns,
                         data_columns,
                         column_separator);
             } // row
         }
 
+        /**
+         * Writes the table in a binary, column-oriented layout, with each
+         * column stored as a single contiguous array so that it can be mapped
+         * directly into a typed array by the reader (e.g., with
+         * ``numpy.frombuffer()`` in Python or ``readBin()`` in R). All values
+         * are little-endian, and every column array begins at an offset that
+         * is a multiple of 8 bytes from the start of the output:
+         *
+         *      magic           8 bytes, "PLTYDTB" followed by a zero byte
+         *      version         uint32 (1)
+         *      num_columns     uint32
+         *      num_rows        uint64
+         *      for each column:
+         *          value_type  uint8: 0 (int64), 1 (uint64), 2 (float64),
+         *                      or 3 (UTF-8 string)
+         *          flags       uint8: bit 0 set for key columns, bit 1 set
+         *                      for hidden columns
+         *          reserved    uint16 (0)
+         *          label_size  uint32
+         *          label       label_size bytes
+         *      padding to a multiple of 8 bytes
+         *      for each column:
+         *          int64, uint64 or float64 columns: num_rows values
+         *          string columns: num_rows + 1 uint64 offsets into the
+         *              character data that follows (the value of row ``i``
+         *              spans [offsets[i], offsets[i+1])), then the
+         *              character data itself
+         *          padding to a multiple of 8 bytes
+         *
+         * Values are written unformatted, and floating-point values are
+         * written in double precision. Hidden columns are skipped unless
+         * ``include_hidden_columns`` is true.
+         */
+        void write_binary(std::ostream & out, bool include_hidden_columns=false) const {
+            std::vector<const Column *> columns;
+            for (auto & col : this->columns_) {
+                if (include_hidden_columns || !col->is_hidden()) {
+                    columns.push_back(col);
+                }
+            }
+            std::uint64_t num_rows = this->rows_.size();
+            platypus::stream::LittleEndianWriter writer(out);
+            writer.write_bytes("PLTYDTB\0", 8);
+            writer.write_uint32(1);
+            writer.write_uint32(static_cast<std::uint32_t>(columns.size()));
+            writer.write_uint64(num_rows);
+            for (auto & col : columns) {
+                writer.write_uint8(static_cast<std::uint8_t>(col->get_value_type()));
+                writer.write_uint8((col->is_key_column() ? 1 : 0) | (col->is_hidden() ? 2 : 0));
+                writer.write_uint16(0);
+                writer.write_uint32(static_cast<std::uint32_t>(col->get_label().size()));
+                writer.write_bytes(col->get_label());
+            }
+            writer.pad_to(8);
+            for (auto & col : columns) {
+                switch (col->get_value_type()) {
+                    case Column::ValueType::SignedInteger:
+                        for (auto v : col->values<Column::signed_integer_implementation_type>()) {
+                            writer.write_int64(static_cast<std::int64_t>(v));
+                        }
+                        break;
+                    case Column::ValueType::UnsignedInteger:
+                        for (auto v : col->values<Column::unsigned_integer_implementation_type>()) {
+                            writer.write_uint64(static_cast<std::uint64_t>(v));
+                        }
+                        break;
+                    case Column::ValueType::FloatingPoint:
+                        for (auto v : col->values<Column::floating_point_implementation_type>()) {
+                            writer.write_float64(static_cast<double>(v));
+                        }
+                        break;
+                    case Column::ValueType::String: {
+                        auto & vals = col->values<Column::string_implementation_type>();
+                        std::uint64_t offset = 0;
+                        writer.write_uint64(offset);
+                        for (auto & v : vals) {
+                            offset += v.size();
+                            writer.write_uint64(offset);
+                        }
+                        for (auto & v : vals) {
+                            writer.write_bytes(v);
+                        }
+                        break;
+                    }
+                }
+                writer.pad_to(8);
+            }
+            writer.flush();
+        }
+
     public:
         template <class T=DataTableColumn::floating_point_implementation_type>
-        static Summary<T> summarize(const std::vector<T> & vals) {
-            Summary<T> summary;
-            summary.size = vals.size();
-            if (summary.size > 0) {
-                summary.sum = std::accumulate(vals.begin(), vals.end(), 0.0);
-                summary.mean = summary.sum / summary.size;
-                auto ss_f = [&summary](const T & a, const T & b)->T {
-                    return a + std::pow(b - summary.mean, 2);
-                };
-                summary.sum_of_squares = std::accumulate(vals.begin(), vals.end(), 0.0, ss_f);
-                if (summary.size > 1) {
-                    summary.sample_variance = summary.sum_of_squares / (summary.size - 1);
-                    summary.population_variance = summary.sum_of_squares / (summary.size);
-                }
-                auto range = std::minmax_element(vals.begin(), vals.end());
-                summary.minimum = *(range.first);
-                summary.maximum = *(range.second);
+        static Summary<T> summarize(const std::vector<T> & vals, bool use_compensated_sum=false) {
+            platypus::numeric::RunningStatistics<T> stats(use_compensated_sum);
+            for (auto & v : vals) {
+                stats.add(v);
+            }
+            return Summary<T>(stats);
+        }
+
+    private:
+        // rows per block below which a column is not split across threads
+        static const unsigned long MIN_ROWS_PER_SUMMARY_BLOCK = 16384;
+
+        template <class T>
+        platypus::numeric::RunningStatistics<T> accumulate_column(const Column & col,
+                unsigned int num_threads,
+                bool use_compensated_sum) const {
+            unsigned long num_rows = col.num_values();
+            unsigned long num_blocks = num_threads == 1 ? 1 : platypus::resolve_num_threads(num_threads);
+            if (num_blocks > num_rows / MIN_ROWS_PER_SUMMARY_BLOCK) {
+                num_blocks = num_rows / MIN_ROWS_PER_SUMMARY_BLOCK;
             }
-            return summary;
+            if (num_blocks <= 1) {
+                platypus::numeric::RunningStatistics<T> stats(use_compensated_sum);
+                col.visit_values_as<T>([&stats](const T & v) { stats.add(v); });
+                return stats;
+            }
+            std::vector<platypus::numeric::RunningStatistics<T>> block_stats(num_blocks,
+                    platypus::numeric::RunningStatistics<T>(use_compensated_sum));
+            unsigned long block_size = (num_rows + num_blocks - 1) / num_blocks;
+            platypus::parallel_for(num_blocks, static_cast<unsigned int>(num_blocks),
+                    [&](std::size_t block_idx) {
+                        auto & stats = block_stats[block_idx];
+                        col.visit_values_as<T>([&stats](const T & v) { stats.add(v); },
+                                block_idx * block_size,
+                                (block_idx + 1) * block_size);
+                    });
+            platypus::numeric::RunningStatistics<T> stats(use_compensated_sum);
+            for (auto & b : block_stats) {
+                stats.merge(b);
+            }
+            return stats;
         }
 
     private:
+        // compiled output is written in blocks of (at least) this many bytes
+        static const std::size_t COMPILED_OUTPUT_BLOCK_SIZE = 65536;
+
+        void compile_column_formatting() {
+            for (auto & col : this->columns_) {
+                if (!col->has_compiled_formatting()) {
+                    col->compile_formatting();
+                }
+            }
+        }
+
+        void append_formatted_row(std::string & buffer, unsigned long row_idx, const std::string & column_separator) const {
+            unsigned long printed_idx = 0;
+            for (auto & col : this->columns_) {
+                if (!col->is_hidden()) {
+                    if (printed_idx > 0) {
+                        buffer += column_separator;
+                    }
+                    col->append_formatted_cell(buffer, row_idx);
+                    printed_idx += 1;
+                }
+            }
+            buffer += '\n';
+        }
+
+        void write_streamed_row() {
+            if (this->use_compiled_formatting_) {
+                this->append_formatted_row(this->stream_sink_->buffer(), 0, this->stream_column_separator_);
+                this->stream_sink_->commit();
+                ++this->num_rows_streamed_;
+                return;
+            }
+            this->stream_row_formatter_.str(std::string());
+            unsigned long printed_idx = 0;
+            for (auto & col : this->columns_) {
+                if (!col->is_hidden()) {
+                    if (printed_idx > 0) {
+                        this->stream_row_formatter_ << this->stream_column_separator_;
+                    }
+                    col->write_formatted_cell(this->stream_row_formatter_, 0);
+                    printed_idx += 1;
+                }
+            }
+            this->stream_row_formatter_ << '\n';
+            this->stream_sink_->buffer() += this->stream_row_formatter_.str();
+            this->stream_sink_->commit();
+            ++this->num_rows_streamed_;
+        }
+
+        // Stably sorts rows from ``begin_row`` on by the values of ``key_col``.
+        void sort_rows(unsigned long begin_row, const Column & key_col) {
+            unsigned long num_rows = this->rows_.size() - begin_row;
+            std::vector<unsigned long> order(num_rows);
+            std::iota(order.begin(), order.end(), 0UL);
+            switch (key_col.get_value_type()) {
+                case Column::ValueType::SignedInteger:
+                    DataTable::sort_order(key_col.values<Column::signed_integer_implementation_type>(), begin_row, order);
+                    break;
+                case Column::ValueType::UnsignedInteger:
+                    DataTable::sort_order(key_col.values<Column::unsigned_integer_implementation_type>(), begin_row, order);
+                    break;
+                case Column::ValueType::FloatingPoint:
+                    DataTable::sort_order(key_col.values<Column::floating_point_implementation_type>(), begin_row, order);
+                    break;
+                case Column::ValueType::String:
+                    DataTable::sort_order(key_col.values<Column::string_implementation_type>(), begin_row, order);
+                    break;
+            }
+            for (auto & col : this->columns_) {
+                col->permute_values(begin_row, order);
+            }
+        }
+
+        template <class U>
+        static void sort_order(const std::vector<U> & vals, unsigned long begin_row, std::vector<unsigned long> & order) {
+            const U * data = vals.data() + begin_row;
+            std::stable_sort(order.begin(), order.end(),
+                    [data](unsigned long a, unsigned long b) { return data[a] < data[b]; });
+        }
+
         template <class T> Column & create_column(
                 const std::string & label,
                 bool is_key_column=false,
@@ -1012,6 +1912,9 @@ class DataTable {
             if (!this->rows_.empty()) {
                 throw DataTableStructureError(__FILE__, __LINE__, "Cannot add new column: rows have already been added");
             }
+            if (this->stream_sink_) {
+                throw DataTableStructureError(__FILE__, __LINE__, "Cannot add new column: table is streaming");
+            }
             if (this->column_label_index_map_.find(label) != this->column_label_index_map_.end()) {
                 throw DataTableStructureError(__FILE__, __LINE__, "Cannot add new column: duplicate column name");
             }
@@ -1022,22 +1925,742 @@ class DataTable {
         }
     private:
         std::vector<Column *>                   columns_;
-        std::map<std::string, unsigned long>    column_label_index_map_;
-        std::vector<Row *>                      rows_;
+        std::unordered_map<std::string, unsigned long>    column_label_index_map_;
+        // rows are views onto the column storage; a deque keeps references
+        // to them valid as rows are added
+        std::deque<Row>                         rows_;
+        // streaming mode
+        std::unique_ptr<platypus::stream::BlockOutputBuffer>   stream_sink_;
+        std::string                             stream_column_separator_;
+        std::ostringstream                      stream_row_formatter_;
+        unsigned long                           num_rows_streamed_;
+        bool                                    use_compiled_formatting_;
 }; // DataTable
 
+//////////////////////////////////////////////////////////////////////////////
+// DataTableView
+
+/**
+ * A projection of the columns and a selection of the rows of a DataTable,
+ * as returned by DataTable::select(), over the storage of the table itself:
+ * no values are copied.
+ *
+ * The selection is a bitmap with a bit for each row of the table, all set
+ * initially; each call to where() clears the bits of the (selected) rows
+ * failing its predicate, so that successive calls combine as a
+ * conjunction. The selected rows are then visited by scanning the bitmap a
+ * word at a time, in row order.
+ *
+ * The projection determines the columns written by write() and the
+ * default data columns summarized by group_by(); any column of the table
+ * may still be named in where(), summarize_column() or as a key of
+ * group_by().
+ *
+ * The view holds a reference to the table, and is invalidated if rows are
+ * added to it.
+ */
+class DataTableView {
+
+    public:
+        typedef std::uint64_t   word_type;
+
+    public:
+        DataTableView(const DataTable & table, const std::vector<std::string> & column_names={})
+            : table_(&table)
+            , num_table_rows_(table.num_rows())
+            , num_selected_(table.num_rows()) {
+            if (column_names.empty()) {
+                this->columns_ = table.column_ptrs();
+            } else {
+                for (auto & name : column_names) {
+                    this->columns_.push_back(&table.column(name));
+                }
+            }
+            this->selection_.assign((this->num_table_rows_ + BITS_PER_WORD - 1) / BITS_PER_WORD, ~word_type(0));
+            if (this->num_table_rows_ % BITS_PER_WORD != 0) {
+                this->selection_.back() = (word_type(1) << (this->num_table_rows_ % BITS_PER_WORD)) - 1;
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Filtering
+
+        /**
+         * Deselects the rows for which ``predicate``, called with the value
+         * of the column named ``col_name`` converted to ``T``, returns
+         * false. The predicate is only called for selected rows.
+         *
+         * @param num_threads
+         *   If not 1, the rows are split into contiguous blocks which are
+         *   filtered concurrently by up to this many threads (0: as many as
+         *   there are hardware threads), so ``predicate`` must then be safe
+         *   to call concurrently.
+         */
+        template <class T, class PredicateT>
+        DataTableView & where(const std::string & col_name, PredicateT predicate, unsigned int num_threads=1) {
+            const DataTableColumn & col = this->table_->column(col_name);
+            this->filter_blocks(num_threads, [&](unsigned long begin_row, unsigned long end_row) {
+                unsigned long row_idx = begin_row;
+                col.visit_values_as<T>([&](const T & v) {
+                            word_type bit = word_type(1) << (row_idx % BITS_PER_WORD);
+                            word_type & word = this->selection_[row_idx / BITS_PER_WORD];
+                            if ((word & bit) && !predicate(v)) {
+                                word &= ~bit;
+                            }
+                            ++row_idx;
+                        },
+                        begin_row,
+                        end_row);
+            });
+            return *this;
+        }
+
+        /**
+         * Deselects the rows for which ``predicate``, called with the row
+         * (a DataTable::Row), returns false. The predicate is only called
+         * for selected rows; see where() above for ``num_threads``.
+         */
+        template <class PredicateT>
+        DataTableView & where(PredicateT predicate, unsigned int num_threads=1) {
+            this->filter_blocks(num_threads, [&](unsigned long begin_row, unsigned long end_row) {
+                this->visit_rows([&](unsigned long row_idx) {
+                            if (!predicate(this->table_->row(row_idx))) {
+                                this->selection_[row_idx / BITS_PER_WORD] &= ~(word_type(1) << (row_idx % BITS_PER_WORD));
+                            }
+                        },
+                        begin_row,
+                        end_row);
+            });
+            return *this;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Access
+
+        const DataTable & table() const {
+            return *this->table_;
+        }
+
+        // Number of rows selected.
+        unsigned long num_rows() const {
+            return this->num_selected_;
+        }
+
+        unsigned long num_columns() const {
+            return this->columns_.size();
+        }
+
+        const std::vector<const DataTableColumn *> & column_ptrs() const {
+            return this->columns_;
+        }
+
+        std::vector<std::string> column_names() const {
+            std::vector<std::string> column_names;
+            column_names.reserve(this->columns_.size());
+            for (auto col : this->columns_) {
+                column_names.push_back(col->get_label());
+            }
+            return column_names;
+        }
+
+        bool is_selected(unsigned long row_idx) const {
+            return row_idx < this->num_table_rows_
+                && (this->selection_[row_idx / BITS_PER_WORD] >> (row_idx % BITS_PER_WORD)) & 1;
+        }
+
+        // Selection bitmap, with row ``i`` at bit ``i % 64`` of word ``i / 64``.
+        const std::vector<word_type> & selection() const {
+            return this->selection_;
+        }
+
+        /**
+         * Calls ``fn`` with the index (in the table) of each selected row in
+         * [``begin_row``, ``end_row``), in row order.
+         */
+        template <class FnT>
+        void visit_rows(FnT fn,
+                unsigned long begin_row=0,
+                unsigned long end_row=static_cast<unsigned long>(-1)) const {
+            if (end_row > this->num_table_rows_) {
+                end_row = this->num_table_rows_;
+            }
+            if (begin_row >= end_row) {
+                return;
+            }
+            unsigned long word_idx = begin_row / BITS_PER_WORD;
+            unsigned long end_word_idx = (end_row + BITS_PER_WORD - 1) / BITS_PER_WORD;
+            for (; word_idx < end_word_idx; ++word_idx) {
+                word_type word = this->selection_[word_idx];
+                unsigned long word_begin_row = word_idx * BITS_PER_WORD;
+                if (word_begin_row < begin_row) {
+                    word &= ~word_type(0) << (begin_row - word_begin_row);
+                }
+                if (word_begin_row + BITS_PER_WORD > end_row) {
+                    word &= (word_type(1) << (end_row - word_begin_row)) - 1;
+                }
+                while (word != 0) {
+                    fn(word_begin_row + bitops::lowest_bit(word));
+                    word &= word - 1;
+                }
+            }
+        }
+
+        // Indexes (in the table) of the selected rows.
+        std::vector<unsigned long> row_indexes() const {
+            std::vector<unsigned long> row_indexes;
+            row_indexes.reserve(this->num_selected_);
+            this->visit_rows([&row_indexes](unsigned long row_idx) { row_indexes.push_back(row_idx); });
+            return row_indexes;
+        }
+
+        // Values of the selected rows of a column, converted to ``T``.
+        template <class T>
+        std::vector<T> get_column(const std::string & col_name) const {
+            const DataTableColumn & col = this->table_->column(col_name);
+            std::vector<T> vals;
+            vals.reserve(this->num_selected_);
+            this->visit_rows([&](unsigned long row_idx) { vals.push_back(col.get<T>(row_idx)); });
+            return vals;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Summaries
+
+        /**
+         * Summarizes the values of the selected rows of a column, converted
+         * to ``T``, as DataTable::summarize_column() does for all rows.
+         */
+        template <class T=DataTableColumn::floating_point_implementation_type>
+        DataTable::Summary<T> summarize_column(const std::string & col_name,
+                unsigned int num_threads=1,
+                bool use_compensated_sum=false) const {
+            const DataTableColumn & col = this->table_->column(col_name);
+            unsigned long num_blocks = this->get_num_blocks(num_threads);
+            unsigned long block_size = this->get_block_size(num_blocks);
+            std::vector<platypus::numeric::RunningStatistics<T>> block_stats(num_blocks,
+                    platypus::numeric::RunningStatistics<T>(use_compensated_sum));
+            platypus::parallel_for(num_blocks, static_cast<unsigned int>(num_blocks), [&](std::size_t block_idx) {
+                auto & stats = block_stats[block_idx];
+                unsigned long row_idx = block_idx * block_size;
+                col.visit_values_as<T>([&](const T & v) {
+                            if ((this->selection_[row_idx / BITS_PER_WORD] >> (row_idx % BITS_PER_WORD)) & 1) {
+                                stats.add(v);
+                            }
+                            ++row_idx;
+                        },
+                        row_idx,
+                        std::min(this->num_table_rows_, row_idx + block_size));
+            });
+            for (unsigned long block_idx = 1; block_idx < num_blocks; ++block_idx) {
+                block_stats[0].merge(block_stats[block_idx]);
+            }
+            return DataTable::Summary<T>(block_stats[0]);
+        }
+
+        /**
+         * Groups the selected rows by the values of the columns named in
+         * ``key_column_names`` (by default, the key columns of the table),
+         * as DataTable::group_by() does for all rows; by default, the data
+         * columns summarized are those of this view.
+         */
+        DataTableGroups group_by(const std::vector<std::string> & key_column_names={},
+                unsigned int num_threads=1) const;
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Output
+
+        /**
+         * Writes the (non-hidden) columns of the view for the selected rows,
+         * formatted as by DataTable::write().
+         */
+        void write(std::ostream & out,
+                const std::string & column_separator="\t",
+                bool include_header_row=true) const {
+            std::vector<const DataTableColumn *> columns;
+            for (auto col : this->columns_) {
+                if (!col->is_hidden()) {
+                    columns.push_back(col);
+                }
+            }
+            if (include_header_row) {
+                for (std::size_t col_idx = 0; col_idx < columns.size(); ++col_idx) {
+                    if (col_idx > 0) {
+                        out << column_separator;
+                    }
+                    out << columns[col_idx]->get_label();
+                }
+                out << "\n";
+            }
+            std::string buffer;
+            this->visit_rows([&](unsigned long row_idx) {
+                for (std::size_t col_idx = 0; col_idx < columns.size(); ++col_idx) {
+                    if (col_idx > 0) {
+                        buffer += column_separator;
+                    }
+                    columns[col_idx]->append_formatted_cell(buffer, row_idx);
+                }
+                buffer += '\n';
+                if (buffer.size() >= OUTPUT_BLOCK_SIZE) {
+                    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                    buffer.clear();
+                }
+            });
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        }
+
+    private:
+        static const unsigned long BITS_PER_WORD = 64;
+        // rows per block below which rows are not split across threads
+        static const unsigned long MIN_ROWS_PER_BLOCK = 16384;
+        // output is written in blocks of (at least) this many bytes
+        static const std::size_t OUTPUT_BLOCK_SIZE = 65536;
+
+        unsigned long get_num_blocks(unsigned int num_threads) const {
+            unsigned long num_blocks = num_threads == 1 ? 1 : platypus::resolve_num_threads(num_threads);
+            if (num_blocks > this->num_table_rows_ / MIN_ROWS_PER_BLOCK) {
+                num_blocks = this->num_table_rows_ / MIN_ROWS_PER_BLOCK;
+            }
+            return num_blocks > 0 ? num_blocks : 1;
+        }
+
+        // Rows per block, rounded up to whole words of the bitmap so that
+        // blocks never share a word.
+        unsigned long get_block_size(unsigned long num_blocks) const {
+            unsigned long block_size = (this->num_table_rows_ + num_blocks - 1) / num_blocks;
+            return (block_size + BITS_PER_WORD - 1) / BITS_PER_WORD * BITS_PER_WORD;
+        }
+
+        // Calls ``filter_fn`` with the bounds of each block of rows, then
+        // recounts the selected rows.
+        template <class FilterFnT>
+        void filter_blocks(unsigned int num_threads, FilterFnT filter_fn) {
+            unsigned long num_blocks = this->get_num_blocks(num_threads);
+            unsigned long block_size = this->get_block_size(num_blocks);
+            platypus::parallel_for(num_blocks, static_cast<unsigned int>(num_blocks), [&](std::size_t block_idx) {
+                unsigned long begin_row = block_idx * block_size;
+                filter_fn(begin_row, std::min(this->num_table_rows_, begin_row + block_size));
+            });
+            this->num_selected_ = 0;
+            for (auto word : this->selection_) {
+                this->num_selected_ += bitops::popcount(word);
+            }
+        }
+
+    private:
+        const DataTable *                       table_;
+        std::vector<const DataTableColumn *>    columns_;
+        std::vector<word_type>                  selection_;
+        unsigned long                           num_table_rows_;
+        unsigned long                           num_selected_;
+
+}; // DataTableView
+
+inline DataTableView DataTable::select(const std::vector<std::string> & column_names) const {
+    return DataTableView(*this, column_names);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// DataTableGroups
+
+/**
+ * The rows of a DataTable grouped by the values of a set of key columns, as
+ * returned by DataTable::group_by().
+ *
+ * Grouping is a single pass over the column storage: each row's key tuple is
+ * hashed (concurrently, in blocks of rows, if more than one thread is
+ * requested), and rows are assigned to groups through a hash map, comparing
+ * key values against the first row of a group only on a hash match. Groups
+ * are numbered in order of their first row. Floating-point keys compare
+ * numerically, except that all NaNs are taken to be equal.
+ *
+ * summarize() then accumulates the data columns of each group in blocks of
+ * rows, one set of per-group RunningStatistics per block, which are merged
+ * in row order into one DataTable::Summary per group and column.
+ *
+ * Grouping a DataTableView (DataTableView::group_by()) groups only the rows
+ * it selects, reading the column storage of its table directly.
+ */
+class DataTableGroups {
+
+    public:
+        DataTableGroups(const DataTable & table,
+                const std::vector<std::string> & key_column_names,
+                unsigned int num_threads=1)
+            : table_(table)
+            , columns_(table.column_ptrs())
+            , num_rows_(table.num_rows()) {
+            this->build(key_column_names, nullptr, num_threads);
+        }
+
+        /**
+         * Groups only the rows selected by ``view`` (see
+         * DataTable::select()); other rows belong to no group (npos()).
+         */
+        DataTableGroups(const DataTableView & view,
+                const std::vector<std::string> & key_column_names,
+                unsigned int num_threads=1)
+            : table_(view.table())
+            , columns_(view.column_ptrs())
+            , num_rows_(view.table().num_rows()) {
+            this->build(key_column_names, &view, num_threads);
+        }
+
+        static constexpr std::size_t npos() {
+            return static_cast<std::size_t>(-1);
+        }
+
+        std::size_t num_groups() const {
+            return this->first_rows_.size();
+        }
+
+        // Group of each row of the table (npos() for rows not grouped).
+        const std::vector<std::size_t> & row_groups() const {
+            return this->row_groups_;
+        }
+
+        unsigned long get_group_size(std::size_t group_idx) const {
+            return this->group_sizes_[group_idx];
+        }
+
+        // Index of the first row of a group, holding its key values.
+        unsigned long get_first_row(std::size_t group_idx) const {
+            return this->first_rows_[group_idx];
+        }
+
+        /**
+         * Returns the summary, for each group in order, of the values of a
+         * column converted to ``T``.
+         */
+        template <class T=DataTableColumn::floating_point_implementation_type>
+        std::vector<DataTable::Summary<T>> summarize_column(const std::string & col_name,
+                unsigned int num_threads=1,
+                bool use_compensated_sum=false) const {
+            auto stats = this->accumulate<T>({&this->table_.column(col_name)}, num_threads, use_compensated_sum);
+            return std::vector<DataTable::Summary<T>>(stats.begin(), stats.end());
+        }
+
+        /**
+         * Adds a row for each group to ``result``, which must be empty of
+         * rows, with:
+         *
+         *  -   the key values of the group, in (key) columns of the same
+         *      names and types as those grouped by;
+         *  -   the number of rows in the group, in column "count";
+         *  -   for each column named in ``data_column_names`` (by default,
+         *      all numeric columns of the table, or of the view grouped,
+         *      that are neither key columns nor grouped by), the mean,
+         *      sample variance, minimum and maximum of its values in the
+         *      group, converted to ``T``, in
+         *      columns "<name>_mean", "<name>_variance", "<name>_min" and
+         *      "<name>_max".
+         *
+         * If ``result`` has no columns, they are added first; otherwise it
+         * must have (at least) these columns.
+         */
+        template <class T=DataTableColumn::floating_point_implementation_type>
+        void summarize(DataTable & result,
+                const std::vector<std::string> & data_column_names={},
+                unsigned int num_threads=1,
+                bool use_compensated_sum=false) const {
+            std::vector<const DataTableColumn *> data_columns;
+            if (data_column_names.empty()) {
+                for (auto col : this->columns_) {
+                    if (!col->is_key_column()
+                            && col->get_value_type() != DataTableColumn::ValueType::String
+                            && std::find(this->key_columns_.begin(), this->key_columns_.end(), col) == this->key_columns_.end()) {
+                        data_columns.push_back(col);
+                    }
+                }
+            } else {
+                for (auto & name : data_column_names) {
+                    data_columns.push_back(&this->table_.column(name));
+                }
+            }
+            if (result.num_columns() == 0) {
+                for (auto col : this->key_columns_) {
+                    switch (col->get_value_type()) {
+                        case DataTableColumn::ValueType::SignedInteger:
+                            result.add_key_column<DataTableColumn::signed_integer_implementation_type>(col->get_label());
+                            break;
+                        case DataTableColumn::ValueType::UnsignedInteger:
+                            result.add_key_column<DataTableColumn::unsigned_integer_implementation_type>(col->get_label());
+                            break;
+                        case DataTableColumn::ValueType::FloatingPoint:
+                            result.add_key_column<DataTableColumn::floating_point_implementation_type>(col->get_label());
+                            break;
+                        case DataTableColumn::ValueType::String:
+                            result.add_key_column<DataTableColumn::string_implementation_type>(col->get_label());
+                            break;
+                    }
+                }
+                result.add_data_column<unsigned long>("count");
+                for (auto col : data_columns) {
+                    result.add_data_column<T>(col->get_label() + "_mean");
+                    result.add_data_column<T>(col->get_label() + "_variance");
+                    result.add_data_column<T>(col->get_label() + "_min");
+                    result.add_data_column<T>(col->get_label() + "_max");
+                }
+            }
+            std::vector<DataTableColumn *> result_key_columns;
+            for (auto col : this->key_columns_) {
+                result_key_columns.push_back(&result.column(col->get_label()));
+            }
+            auto count_handle = result.column_handle<unsigned long>("count");
+            std::vector<DataTableColumnHandle<T>> mean_handles;
+            std::vector<DataTableColumnHandle<T>> variance_handles;
+            std::vector<DataTableColumnHandle<T>> min_handles;
+            std::vector<DataTableColumnHandle<T>> max_handles;
+            for (auto col : data_columns) {
+                mean_handles.push_back(result.column_handle<T>(col->get_label() + "_mean"));
+                variance_handles.push_back(result.column_handle<T>(col->get_label() + "_variance"));
+                min_handles.push_back(result.column_handle<T>(col->get_label() + "_min"));
+                max_handles.push_back(result.column_handle<T>(col->get_label() + "_max"));
+            }
+            auto stats = this->accumulate<T>(data_columns, num_threads, use_compensated_sum);
+            std::size_t num_groups = this->num_groups();
+            result.reserve(result.num_rows() + num_groups);
+            for (std::size_t group_idx = 0; group_idx < num_groups; ++group_idx) {
+                auto & row = result.add_row();
+                unsigned long row_idx = row.get_row_index();
+                unsigned long first_row = this->first_rows_[group_idx];
+                for (std::size_t key_idx = 0; key_idx < this->key_columns_.size(); ++key_idx) {
+                    this->copy_key_value(*this->key_columns_[key_idx], first_row, *result_key_columns[key_idx], row_idx);
+                }
+                row.set(count_handle, this->group_sizes_[group_idx]);
+                for (std::size_t col_idx = 0; col_idx < data_columns.size(); ++col_idx) {
+                    const auto & col_stats = stats[col_idx * num_groups + group_idx];
+                    row.set(mean_handles[col_idx], col_stats.mean());
+                    row.set(variance_handles[col_idx], col_stats.sample_variance());
+                    row.set(min_handles[col_idx], col_stats.minimum());
+                    row.set(max_handles[col_idx], col_stats.maximum());
+                }
+            }
+        }
+
+    private:
+        // rows per block below which rows are not split across threads
+        static const unsigned long MIN_ROWS_PER_BLOCK = 16384;
+
+        // Assigns the rows (selected by ``view``, if given) to groups.
+        void build(const std::vector<std::string> & key_column_names,
+                const DataTableView * view,
+                unsigned int num_threads) {
+            for (auto & name : key_column_names) {
+                this->key_columns_.push_back(&this->table_.column(name));
+            }
+            std::vector<std::uint64_t> row_hashes(this->num_rows_);
+            unsigned long num_blocks = this->get_num_blocks(num_threads);
+            unsigned long block_size = (this->num_rows_ + num_blocks - 1) / (num_blocks > 0 ? num_blocks : 1);
+            platypus::parallel_for(num_blocks, static_cast<unsigned int>(num_blocks), [&](std::size_t block_idx) {
+                unsigned long end_row = std::min(this->num_rows_, (block_idx + 1) * block_size);
+                for (unsigned long row_idx = block_idx * block_size; row_idx < end_row; ++row_idx) {
+                    if (view == nullptr || view->is_selected(row_idx)) {
+                        row_hashes[row_idx] = this->hash_row(row_idx);
+                    }
+                }
+            });
+            // groups with the same hash are chained through
+            // ``next_group_with_hash``
+            std::unordered_map<std::uint64_t, std::size_t> first_group_with_hash;
+            std::vector<std::size_t> next_group_with_hash;
+            this->row_groups_.resize(this->num_rows_);
+            for (unsigned long row_idx = 0; row_idx < this->num_rows_; ++row_idx) {
+                if (view != nullptr && !view->is_selected(row_idx)) {
+                    this->row_groups_[row_idx] = npos();
+                    continue;
+                }
+                auto inserted = first_group_with_hash.emplace(row_hashes[row_idx], this->first_rows_.size());
+                std::size_t group_idx = inserted.first->second;
+                if (!inserted.second) {
+                    while (!this->is_same_key(row_idx, this->first_rows_[group_idx])) {
+                        std::size_t next = next_group_with_hash[group_idx];
+                        if (next == npos()) {
+                            next = this->first_rows_.size();
+                            next_group_with_hash[group_idx] = next;
+                            group_idx = next;
+                            break;
+                        }
+                        group_idx = next;
+                    }
+                }
+                if (group_idx == this->first_rows_.size()) {
+                    this->first_rows_.push_back(row_idx);
+                    this->group_sizes_.push_back(0);
+                    next_group_with_hash.push_back(npos());
+                }
+                this->row_groups_[row_idx] = group_idx;
+                ++this->group_sizes_[group_idx];
+            }
+        }
+
+        unsigned long get_num_blocks(unsigned int num_threads) const {
+            unsigned long num_blocks = num_threads == 1 ? 1 : platypus::resolve_num_threads(num_threads);
+            if (num_blocks > this->num_rows_ / MIN_ROWS_PER_BLOCK) {
+                num_blocks = this->num_rows_ / MIN_ROWS_PER_BLOCK;
+            }
+            return num_blocks > 0 ? num_blocks : 1;
+        }
+
+        static std::uint64_t mix(std::uint64_t h, std::uint64_t v) {
+            h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            return h;
+        }
+
+        std::uint64_t hash_row(unsigned long row_idx) const {
+            std::uint64_t h = 0;
+            for (auto col : this->key_columns_) {
+                switch (col->get_value_type()) {
+                    case DataTableColumn::ValueType::SignedInteger:
+                        h = mix(h, static_cast<std::uint64_t>(col->values<DataTableColumn::signed_integer_implementation_type>()[row_idx]));
+                        break;
+                    case DataTableColumn::ValueType::UnsignedInteger:
+                        h = mix(h, static_cast<std::uint64_t>(col->values<DataTableColumn::unsigned_integer_implementation_type>()[row_idx]));
+                        break;
+                    case DataTableColumn::ValueType::FloatingPoint: {
+                        auto v = col->values<DataTableColumn::floating_point_implementation_type>()[row_idx];
+                        // equal values (including 0 and -0, and all NaNs) hash alike
+                        h = mix(h, std::isnan(v) ? 0x7ff8000000000000ULL : std::hash<double>()(static_cast<double>(v) + 0.0));
+                        break;
+                    }
+                    case DataTableColumn::ValueType::String:
+                        h = mix(h, std::hash<std::string>()(col->values<DataTableColumn::string_implementation_type>()[row_idx]));
+                        break;
+                }
+            }
+            return h;
+        }
+
+        bool is_same_key(unsigned long row1, unsigned long row2) const {
+            for (auto col : this->key_columns_) {
+                switch (col->get_value_type()) {
+                    case DataTableColumn::ValueType::SignedInteger: {
+                        auto & vals = col->values<DataTableColumn::signed_integer_implementation_type>();
+                        if (vals[row1] != vals[row2]) {
+                            return false;
+                        }
+                        break;
+                    }
+                    case DataTableColumn::ValueType::UnsignedInteger: {
+                        auto & vals = col->values<DataTableColumn::unsigned_integer_implementation_type>();
+                        if (vals[row1] != vals[row2]) {
+                            return false;
+                        }
+                        break;
+                    }
+                    case DataTableColumn::ValueType::FloatingPoint: {
+                        auto & vals = col->values<DataTableColumn::floating_point_implementation_type>();
+                        if (vals[row1] != vals[row2] && !(std::isnan(vals[row1]) && std::isnan(vals[row2]))) {
+                            return false;
+                        }
+                        break;
+                    }
+                    case DataTableColumn::ValueType::String: {
+                        auto & vals = col->values<DataTableColumn::string_implementation_type>();
+                        if (vals[row1] != vals[row2]) {
+                            return false;
+                        }
+                        break;
+                    }
+                }
+            }
+            return true;
+        }
+
+        void copy_key_value(const DataTableColumn & src, unsigned long src_row, DataTableColumn & dest, unsigned long dest_row) const {
+            switch (src.get_value_type()) {
+                case DataTableColumn::ValueType::SignedInteger:
+                    dest.set(dest_row, src.values<DataTableColumn::signed_integer_implementation_type>()[src_row]);
+                    break;
+                case DataTableColumn::ValueType::UnsignedInteger:
+                    dest.set(dest_row, src.values<DataTableColumn::unsigned_integer_implementation_type>()[src_row]);
+                    break;
+                case DataTableColumn::ValueType::FloatingPoint:
+                    dest.set(dest_row, src.values<DataTableColumn::floating_point_implementation_type>()[src_row]);
+                    break;
+                case DataTableColumn::ValueType::String:
+                    dest.set(dest_row, src.values<DataTableColumn::string_implementation_type>()[src_row]);
+                    break;
+            }
+        }
+
+        // Statistics of each column (major) and group (minor).
+        template <class T=DataTableColumn::floating_point_implementation_type>
+        std::vector<platypus::numeric::RunningStatistics<T>> accumulate(const std::vector<const DataTableColumn *> & columns,
+                unsigned int num_threads,
+                bool use_compensated_sum) const {
+            std::size_t num_groups = this->num_groups();
+            std::size_t num_stats = columns.size() * num_groups;
+            unsigned long num_blocks = this->get_num_blocks(num_threads);
+            unsigned long block_size = (this->num_rows_ + num_blocks - 1) / num_blocks;
+            std::vector<std::vector<platypus::numeric::RunningStatistics<T>>> block_stats(num_blocks,
+                    std::vector<platypus::numeric::RunningStatistics<T>>(num_stats, platypus::numeric::RunningStatistics<T>(use_compensated_sum)));
+            platypus::parallel_for(num_blocks, static_cast<unsigned int>(num_blocks), [&](std::size_t block_idx) {
+                auto & stats = block_stats[block_idx];
+                unsigned long begin_row = block_idx * block_size;
+                for (std::size_t col_idx = 0; col_idx < columns.size(); ++col_idx) {
+                    auto col_stats = stats.begin() + col_idx * num_groups;
+                    unsigned long row_idx = begin_row;
+                    columns[col_idx]->visit_values_as<T>([&](const T & v) {
+                                std::size_t group_idx = this->row_groups_[row_idx++];
+                                if (group_idx != npos()) {
+                                    col_stats[group_idx].add(v);
+                                }
+                            },
+                            begin_row,
+                            std::min(this->num_rows_, begin_row + block_size));
+                }
+            });
+            for (unsigned long block_idx = 1; block_idx < num_blocks; ++block_idx) {
+                for (std::size_t stat_idx = 0; stat_idx < num_stats; ++stat_idx) {
+                    block_stats[0][stat_idx].merge(block_stats[block_idx][stat_idx]);
+                }
+            }
+            return std::move(block_stats[0]);
+        }
+
+    private:
+        const DataTable &                       table_;
+        std::vector<const DataTableColumn *>    columns_;
+        unsigned long                           num_rows_;
+        std::vector<const DataTableColumn *>    key_columns_;
+        std::vector<std::size_t>                row_groups_;
+        std::vector<unsigned long>              first_rows_;
+        std::vector<unsigned long>              group_sizes_;
+
+}; // DataTableGroups
+
+inline DataTableGroups DataTable::group_by(const std::vector<std::string> & key_column_names,
+        unsigned int num_threads) const {
+    return DataTableGroups(*this,
+            key_column_names.empty() ? this->key_column_names() : key_column_names,
+            num_threads);
+}
+
+inline DataTableGroups DataTableView::group_by(const std::vector<std::string> & key_column_names,
+        unsigned int num_threads) const {
+    return DataTableGroups(*this,
+            key_column_names.empty() ? this->table_->key_column_names() : key_column_names,
+            num_threads);
+}
+
 } // namespace platypus
 
 //////////////////////////////////////////////////////////////////////////////
 // DataTableColumn
 
 template <class T> T platypus::DataTableColumn::max() const {
-    std::vector<T> vals;
-    vals.reserve(this->table_.num_rows());
-    for (auto & row : this->table_) {
-        vals.push_back(row.get<T>(this->label_));
+    if (this->num_values() == 0) {
+        throw DataTableStructureError(__FILE__, __LINE__, "Cannot take maximum of empty column: '" + this->label_ + "'");
     }
-    return *(std::max_element(vals.begin(), vals.end()));
+    bool is_first = true;
+    T result = T();
+    this->visit_values_as<T>([&result, &is_first](const T & v) {
+        if (is_first || result < v) {
+            result = v;
+            is_first = false;
+        }
+    });
+    return result;
 }
 
 #endif
@@ -0,0 +1,409 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Compact, immutable, array-based tree representation.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_MODEL_FLATTREE_HPP
+#define PLATYPUS_MODEL_FLATTREE_HPP
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// FlatTree
+
+/**
+ * A read-only snapshot of the structure, labels and edge lengths of a
+ * platypus::Tree, stored as a set of contiguous arrays rather than as linked,
+ * individually-allocated nodes.
+ *
+ * Nodes are identified by their index in a preorder traversal of the source
+ * tree, so that the root is node 0; the descendents of a node ``nd`` occupy
+ * the contiguous range of indexes [``nd + 1``, ``subtree_end(nd)``). Parent,
+ * child and sibling relationships are given as indexes, with
+ * ``FlatTree::npos`` denoting a missing relative. Preorder, postorder and
+ * leaf traversals are linear scans over arrays of indexes, and the leaves of
+ * any subtree are a contiguous range of the array of leaves:
+ *
+ *      platypus::FlatTree<> flat_tree(tree,
+ *              [](const NodeValue & nv) { return nv.get_label(); },
+ *              [](const NodeValue & nv) { return nv.get_edge_length(); });
+ *      double length = 0.0;
+ *      for (auto nd = flat_tree.preorder_begin(); nd != flat_tree.preorder_end(); ++nd) {
+ *          length += flat_tree.edge_length(*nd);
+ *      }
+ *
+ * Combined with BaseTreeReader::read_each(), a FlatTree can be built for each
+ * tree in a source as it is parsed, reusing a single scratch tree.
+ *
+ * @tparam EdgeLengthT
+ *   Type of edge length values.
+ */
+template <typename EdgeLengthT=double>
+class FlatTree {
+
+    public:
+        typedef std::uint32_t               index_type;
+        typedef EdgeLengthT                 edge_length_type;
+        typedef std::vector<index_type>     index_vector_type;
+
+        static const index_type npos = std::numeric_limits<index_type>::max();
+
+        /**
+         * Iterates over the consecutive node indexes [begin, end), i.e. over
+         * the nodes of a subtree in preorder.
+         */
+        class index_iterator : public std::iterator<std::random_access_iterator_tag, index_type, std::ptrdiff_t, const index_type *, index_type> {
+            public:
+                index_iterator(index_type idx=0) : idx_(idx) { }
+                inline index_type operator*() const {
+                    return this->idx_;
+                }
+                inline index_iterator & operator++() {
+                    ++this->idx_;
+                    return *this;
+                }
+                inline index_iterator operator++(int) {
+                    index_iterator i = *this;
+                    ++this->idx_;
+                    return i;
+                }
+                inline index_iterator & operator--() {
+                    --this->idx_;
+                    return *this;
+                }
+                inline index_iterator & operator+=(std::ptrdiff_t n) {
+                    this->idx_ += n;
+                    return *this;
+                }
+                inline index_iterator operator+(std::ptrdiff_t n) const {
+                    return index_iterator(this->idx_ + n);
+                }
+                inline std::ptrdiff_t operator-(const index_iterator & other) const {
+                    return static_cast<std::ptrdiff_t>(this->idx_) - static_cast<std::ptrdiff_t>(other.idx_);
+                }
+                inline bool operator==(const index_iterator & other) const {
+                    return this->idx_ == other.idx_;
+                }
+                inline bool operator!=(const index_iterator & other) const {
+                    return this->idx_ != other.idx_;
+                }
+                inline bool operator<(const index_iterator & other) const {
+                    return this->idx_ < other.idx_;
+                }
+            private:
+                index_type idx_;
+        }; // index_iterator
+
+        typedef index_iterator                                  preorder_iterator;
+        typedef typename index_vector_type::const_iterator      postorder_iterator;
+        typedef typename index_vector_type::const_iterator      leaf_iterator;
+
+    public:
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Lifecycle
+
+        FlatTree() { }
+
+        /**
+         * Builds a snapshot of ``tree``. If ``label_getter`` (or
+         * ``edge_length_getter``) is empty, all labels are empty (or all edge
+         * lengths are default-constructed).
+         */
+        template <typename TreeT>
+        FlatTree(const TreeT & tree,
+                const std::function<std::string (const typename TreeT::value_type &)> & label_getter,
+                const std::function<EdgeLengthT (const typename TreeT::value_type &)> & edge_length_getter) {
+            this->assign(tree, label_getter, edge_length_getter);
+        }
+
+        /**
+         * Replaces the contents of this object with a snapshot of ``tree``,
+         * reusing existing storage where possible.
+         */
+        template <typename TreeT>
+        void assign(const TreeT & tree,
+                const std::function<std::string (const typename TreeT::value_type &)> & label_getter,
+                const std::function<EdgeLengthT (const typename TreeT::value_type &)> & edge_length_getter) {
+            typedef typename TreeT::node_type node_type;
+            this->clear();
+            // ancestors of the current node that have not yet been completed
+            index_vector_type open_nodes;
+            // most-recently added child of each node
+            index_vector_type last_child;
+            const node_type * subtree_root = tree.begin().node();
+            const node_type * node = subtree_root;
+            while (true) {
+                index_type parent_idx = open_nodes.empty() ? npos : open_nodes.back();
+                index_type idx = static_cast<index_type>(this->parents_.size());
+                this->parents_.push_back(parent_idx);
+                this->first_children_.push_back(npos);
+                this->next_siblings_.push_back(npos);
+                this->num_children_.push_back(0);
+                this->subtree_ends_.push_back(npos);
+                last_child.push_back(npos);
+                if (label_getter) {
+                    this->labels_.push_back(label_getter(node->value()));
+                } else {
+                    this->labels_.emplace_back();
+                }
+                if (edge_length_getter) {
+                    this->edge_lengths_.push_back(edge_length_getter(node->value()));
+                } else {
+                    this->edge_lengths_.push_back(EdgeLengthT());
+                }
+                if (parent_idx != npos) {
+                    if (last_child[parent_idx] == npos) {
+                        this->first_children_[parent_idx] = idx;
+                    } else {
+                        this->next_siblings_[last_child[parent_idx]] = idx;
+                    }
+                    last_child[parent_idx] = idx;
+                    ++this->num_children_[parent_idx];
+                }
+                if (!node->is_leaf()) {
+                    open_nodes.push_back(idx);
+                    node = node->first_child_node();
+                    continue;
+                }
+                // leaf: complete it, and all ancestors that it completes
+                this->leaves_.push_back(idx);
+                this->subtree_ends_[idx] = idx + 1;
+                this->postorder_.push_back(idx);
+                while (node != subtree_root && node->next_sibling_node() == nullptr) {
+                    node = node->parent_node();
+                    index_type completed_idx = open_nodes.back();
+                    open_nodes.pop_back();
+                    this->subtree_ends_[completed_idx] = static_cast<index_type>(this->parents_.size());
+                    this->postorder_.push_back(completed_idx);
+                }
+                if (node == subtree_root) {
+                    break;
+                }
+                node = node->next_sibling_node();
+            }
+            // leaves are added in preorder
+            this->leaf_offsets_.reserve(this->parents_.size() + 1);
+            index_type num_leaves = 0;
+            for (index_type idx = 0; idx < this->parents_.size(); ++idx) {
+                this->leaf_offsets_.push_back(num_leaves);
+                if (this->first_children_[idx] == npos) {
+                    ++num_leaves;
+                }
+            }
+            this->leaf_offsets_.push_back(num_leaves);
+        }
+
+        void clear() {
+            this->parents_.clear();
+            this->first_children_.clear();
+            this->next_siblings_.clear();
+            this->num_children_.clear();
+            this->subtree_ends_.clear();
+            this->postorder_.clear();
+            this->leaves_.clear();
+            this->leaf_offsets_.clear();
+            this->labels_.clear();
+            this->edge_lengths_.clear();
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Metrics
+
+        inline std::size_t size() const {
+            return this->parents_.size();
+        }
+
+        inline bool empty() const {
+            return this->parents_.empty();
+        }
+
+        inline std::size_t num_leaves() const {
+            return this->leaves_.size();
+        }
+
+        inline std::size_t num_internal_nodes() const {
+            return this->parents_.size() - this->leaves_.size();
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Structure
+
+        inline index_type root() const {
+            return 0;
+        }
+
+        inline index_type parent(index_type nd) const {
+            return this->parents_[nd];
+        }
+
+        inline index_type first_child(index_type nd) const {
+            return this->first_children_[nd];
+        }
+
+        inline index_type next_sibling(index_type nd) const {
+            return this->next_siblings_[nd];
+        }
+
+        inline index_type num_children(index_type nd) const {
+            return this->num_children_[nd];
+        }
+
+        inline bool is_leaf(index_type nd) const {
+            return this->first_children_[nd] == npos;
+        }
+
+        /**
+         * One past the index of the last node of the subtree rooted at
+         * ``nd``, so that the subtree consists of the nodes [``nd``,
+         * ``subtree_end(nd)``).
+         */
+        inline index_type subtree_end(index_type nd) const {
+            return this->subtree_ends_[nd];
+        }
+
+        inline std::size_t subtree_size(index_type nd) const {
+            return this->subtree_ends_[nd] - nd;
+        }
+
+        // True if ``nd`` is ``subtree_root`` or one of its descendents.
+        inline bool is_in_subtree(index_type nd, index_type subtree_root) const {
+            return nd >= subtree_root && nd < this->subtree_ends_[subtree_root];
+        }
+
+        // Number of leaves in the subtree rooted at ``nd`` (1 if ``nd`` is a leaf).
+        inline std::size_t num_leaves(index_type nd) const {
+            return this->leaf_offsets_[this->subtree_ends_[nd]] - this->leaf_offsets_[nd];
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Values
+
+        inline const std::string & label(index_type nd) const {
+            return this->labels_[nd];
+        }
+
+        inline EdgeLengthT edge_length(index_type nd) const {
+            return this->edge_lengths_[nd];
+        }
+
+        // Labels of all nodes, in preorder.
+        inline const std::vector<std::string> & labels() const {
+            return this->labels_;
+        }
+
+        // Edge lengths of all nodes, in preorder.
+        inline const std::vector<EdgeLengthT> & edge_lengths() const {
+            return this->edge_lengths_;
+        }
+
+        inline const index_vector_type & parents() const {
+            return this->parents_;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Traversal
+
+        inline preorder_iterator preorder_begin() const {
+            return preorder_iterator(0);
+        }
+
+        inline preorder_iterator preorder_end() const {
+            return preorder_iterator(static_cast<index_type>(this->parents_.size()));
+        }
+
+        // Nodes of the subtree rooted at ``nd``, in preorder.
+        inline preorder_iterator preorder_begin(index_type nd) const {
+            return preorder_iterator(nd);
+        }
+
+        inline preorder_iterator preorder_end(index_type nd) const {
+            return preorder_iterator(this->subtree_ends_[nd]);
+        }
+
+        inline postorder_iterator postorder_begin() const {
+            return this->postorder_.cbegin();
+        }
+
+        inline postorder_iterator postorder_end() const {
+            return this->postorder_.cend();
+        }
+
+        inline leaf_iterator leaf_begin() const {
+            return this->leaves_.cbegin();
+        }
+
+        inline leaf_iterator leaf_end() const {
+            return this->leaves_.cend();
+        }
+
+        /**
+         * Leaves of the subtree rooted at ``nd`` (which, unlike
+         * Tree::leaf_begin(), include ``nd`` itself if it is a leaf), in
+         * preorder. These are a contiguous range of the leaves of the tree,
+         * found in constant time, so that visiting the leaves of every clade
+         * takes no traversal of the structure.
+         */
+        inline leaf_iterator leaf_begin(index_type nd) const {
+            return this->leaves_.cbegin() + this->leaf_offsets_[nd];
+        }
+
+        inline leaf_iterator leaf_end(index_type nd) const {
+            return this->leaves_.cbegin() + this->leaf_offsets_[this->subtree_ends_[nd]];
+        }
+
+        /**
+         * Position of the first leaf of the subtree rooted at ``nd`` in the
+         * leaves of the tree (so that the leaves of the subtree occupy
+         * positions [``leaf_offset(nd)``, ``leaf_offset(nd) + num_leaves(nd)``)
+         * of leaf_begin()).
+         */
+        inline std::size_t leaf_offset(index_type nd) const {
+            return this->leaf_offsets_[nd];
+        }
+
+    private:
+        index_vector_type               parents_;
+        index_vector_type               first_children_;
+        index_vector_type               next_siblings_;
+        index_vector_type               num_children_;
+        index_vector_type               subtree_ends_;
+        index_vector_type               postorder_;
+        index_vector_type               leaves_;
+        // number of leaves before each node in preorder (and in all)
+        index_vector_type               leaf_offsets_;
+        std::vector<std::string>        labels_;
+        std::vector<EdgeLengthT>        edge_lengths_;
+
+}; // FlatTree
+
+template <typename EdgeLengthT>
+const typename FlatTree<EdgeLengthT>::index_type FlatTree<EdgeLengthT>::npos;
+
+} // namespace platypus
+
+#endif
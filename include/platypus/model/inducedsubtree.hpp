@@ -0,0 +1,370 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Subtrees induced by subsets of taxa.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+
+#ifndef PLATYPUS_MODEL_INDUCEDSUBTREE_HPP
+#define PLATYPUS_MODEL_INDUCEDSUBTREE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "../utility/parallel.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// InducedSubtree
+
+/**
+ * Reduces trees to the subtrees induced by a fixed subset of taxa, i.e.,
+ * restricts each tree to the leaves of the taxa in the subset, removing
+ * every other leaf and the internal nodes left without leaves, and
+ * suppressing the nodes left with a single child (with the length of the
+ * edge of a suppressed node added to that of its surviving child).
+ *
+ * Membership of the subset is held as a mask indexed by taxon index, so
+ * that a tree is reduced in a single postorder pass, either in place by
+ * relinking its surviving nodes (restrict(), which uses
+ * Tree::retain_leaves()), or by emitting only the surviving nodes into
+ * another tree (extract()), without first copying the source tree. Both
+ * give the same tree: as in Tree::collapse_unifurcations(), if the head
+ * node is left with a single internal child, the child is merged into
+ * the head node, which keeps its own value.
+ *
+ * restrict_trees() and extract_trees() reduce a collection of trees
+ * concurrently.
+ *
+ * Leaf taxa are obtained through a ``taxon_index_fn`` (``std::size_t
+ * f(const value_type &)``); leaves with an index outside the subset (e.g.,
+ * TaxonNamespace::npos) are removed.
+ */
+class InducedSubtree {
+
+    public:
+
+        /**
+         * Builds the mask of the taxa with indexes in [``taxon_indexes_begin``,
+         * ``taxon_indexes_end``).
+         */
+        template <class IterT>
+        InducedSubtree(IterT taxon_indexes_begin, IterT taxon_indexes_end)
+            : num_taxa_(0) {
+            for (IterT idx = taxon_indexes_begin; idx != taxon_indexes_end; ++idx) {
+                std::size_t taxon_index = static_cast<std::size_t>(*idx);
+                if (taxon_index >= this->mask_.size()) {
+                    this->mask_.resize(taxon_index + 1, 0);
+                }
+                if (!this->mask_[taxon_index]) {
+                    this->mask_[taxon_index] = 1;
+                    ++this->num_taxa_;
+                }
+            }
+        }
+
+        InducedSubtree(const std::vector<std::size_t> & taxon_indexes)
+            : InducedSubtree(taxon_indexes.begin(), taxon_indexes.end()) { }
+
+        // number of (distinct) taxa in the subset
+        inline std::size_t size() const {
+            return this->num_taxa_;
+        }
+
+        inline bool contains(std::size_t taxon_index) const {
+            return taxon_index < this->mask_.size() && this->mask_[taxon_index];
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // In place
+
+        /**
+         * Reduces ``tree`` to the subtree induced by the subset.
+         *
+         * @return
+         *   The number of leaves kept.
+         */
+        template <class TreeT, class TaxonIndexFnT>
+        unsigned long restrict(TreeT & tree, TaxonIndexFnT taxon_index_fn) const {
+            return tree.retain_leaves([this, &taxon_index_fn] (const typename TreeT::value_type & nv) {
+                        return this->contains(static_cast<std::size_t>(taxon_index_fn(nv))); });
+        }
+
+        /**
+         * As above, with edge lengths, through an ``edge_length_getter``
+         * (``L get(const value_type &)``) and ``edge_length_setter`` (``void
+         * set(value_type &, L)``).
+         */
+        template <class TreeT, class TaxonIndexFnT, class EdgeLengthGetterT, class EdgeLengthSetterT>
+        unsigned long restrict(TreeT & tree,
+                TaxonIndexFnT taxon_index_fn,
+                EdgeLengthGetterT edge_length_getter,
+                EdgeLengthSetterT edge_length_setter) const {
+            return tree.retain_leaves([this, &taxon_index_fn] (const typename TreeT::value_type & nv) {
+                        return this->contains(static_cast<std::size_t>(taxon_index_fn(nv))); },
+                    edge_length_getter,
+                    edge_length_setter);
+        }
+
+        /**
+         * Reduces each of the trees in [``trees_begin``, ``trees_end``) in
+         * place, with up to ``num_threads`` threads (0 for the number of
+         * hardware threads).
+         *
+         * @return
+         *   The number of leaves kept in each tree.
+         */
+        template <class IterT, class TaxonIndexFnT, class EdgeLengthGetterT, class EdgeLengthSetterT>
+        std::vector<unsigned long> restrict_trees(IterT trees_begin,
+                IterT trees_end,
+                TaxonIndexFnT taxon_index_fn,
+                EdgeLengthGetterT edge_length_getter,
+                EdgeLengthSetterT edge_length_setter,
+                unsigned int num_threads=0) const {
+            std::size_t num_trees = static_cast<std::size_t>(std::distance(trees_begin, trees_end));
+            std::vector<unsigned long> num_kept(num_trees, 0);
+            this->for_each_block(num_trees, num_threads, [&] (std::size_t begin_idx, std::size_t end_idx) {
+                IterT tree_iter = trees_begin;
+                std::advance(tree_iter, begin_idx);
+                for (std::size_t idx = begin_idx; idx < end_idx; ++idx, ++tree_iter) {
+                    num_kept[idx] = this->restrict(*tree_iter, taxon_index_fn, edge_length_getter, edge_length_setter);
+                }
+            });
+            return num_kept;
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Into another tree
+
+        /**
+         * Builds the subtree of ``src_tree`` induced by the subset into
+         * ``dest_tree`` (which is cleared first), creating only the nodes
+         * that survive, with their values assigned from those of the
+         * corresponding source nodes.
+         *
+         * @return
+         *   The number of leaves kept.
+         */
+        template <class SrcTreeT, class DestTreeT, class TaxonIndexFnT>
+        unsigned long extract(const SrcTreeT & src_tree,
+                DestTreeT & dest_tree,
+                TaxonIndexFnT taxon_index_fn) const {
+            return this->extract(src_tree,
+                    dest_tree,
+                    taxon_index_fn,
+                    [] (const typename SrcTreeT::value_type & src, typename DestTreeT::value_type & dest) { dest = src; },
+                    [] (const typename SrcTreeT::value_type &) { return 0; },
+                    [] (typename DestTreeT::value_type &, int) { });
+        }
+
+        /**
+         * As above, with the values of surviving nodes copied by
+         * ``copy_value_fn`` (``void f(const SrcTreeT::value_type & src,
+         * DestTreeT::value_type & dest)``), and edge lengths read from the
+         * source tree by ``edge_length_getter`` (``L get(const
+         * SrcTreeT::value_type &)``) and written to the destination tree by
+         * ``edge_length_setter`` (``void set(DestTreeT::value_type &, L)``),
+         * after the value has been copied.
+         */
+        template <class SrcTreeT, class DestTreeT, class TaxonIndexFnT, class CopyValueFnT, class EdgeLengthGetterT, class EdgeLengthSetterT>
+        unsigned long extract(const SrcTreeT & src_tree,
+                DestTreeT & dest_tree,
+                TaxonIndexFnT taxon_index_fn,
+                CopyValueFnT copy_value_fn,
+                EdgeLengthGetterT edge_length_getter,
+                EdgeLengthSetterT edge_length_setter) const {
+            std::vector<std::pair<typename DestTreeT::node_type *, edge_length_type<SrcTreeT, EdgeLengthGetterT>>> subtrees;
+            return this->extract(src_tree, dest_tree, taxon_index_fn, copy_value_fn, edge_length_getter, edge_length_setter, subtrees);
+        }
+
+        /**
+         * Builds the induced subtree of each of the trees in
+         * [``trees_begin``, ``trees_end``) into the corresponding tree of the
+         * range starting at ``dest_begin``, with up to ``num_threads``
+         * threads (0 for the number of hardware threads).
+         *
+         * @return
+         *   The number of leaves kept in each tree.
+         */
+        template <class IterT, class DestIterT, class TaxonIndexFnT, class CopyValueFnT, class EdgeLengthGetterT, class EdgeLengthSetterT>
+        std::vector<unsigned long> extract_trees(IterT trees_begin,
+                IterT trees_end,
+                DestIterT dest_begin,
+                TaxonIndexFnT taxon_index_fn,
+                CopyValueFnT copy_value_fn,
+                EdgeLengthGetterT edge_length_getter,
+                EdgeLengthSetterT edge_length_setter,
+                unsigned int num_threads=0) const {
+            typedef typename std::iterator_traits<IterT>::value_type src_tree_type;
+            typedef typename std::iterator_traits<DestIterT>::value_type dest_tree_type;
+            std::size_t num_trees = static_cast<std::size_t>(std::distance(trees_begin, trees_end));
+            std::vector<unsigned long> num_kept(num_trees, 0);
+            this->for_each_block(num_trees, num_threads, [&] (std::size_t begin_idx, std::size_t end_idx) {
+                std::vector<std::pair<typename dest_tree_type::node_type *, edge_length_type<src_tree_type, EdgeLengthGetterT>>> subtrees;
+                IterT tree_iter = trees_begin;
+                std::advance(tree_iter, begin_idx);
+                DestIterT dest_iter = dest_begin;
+                std::advance(dest_iter, begin_idx);
+                for (std::size_t idx = begin_idx; idx < end_idx; ++idx, ++tree_iter, ++dest_iter) {
+                    num_kept[idx] = this->extract(*tree_iter, *dest_iter, taxon_index_fn, copy_value_fn, edge_length_getter, edge_length_setter, subtrees);
+                }
+            });
+            return num_kept;
+        }
+
+    private:
+
+        template <class TreeT, class EdgeLengthGetterT>
+        using edge_length_type = typename std::decay<decltype(std::declval<EdgeLengthGetterT &>()(std::declval<const typename TreeT::value_type &>()))>::type;
+
+        // Postorder walk of ``src_tree``, with ``subtrees`` holding an entry
+        // for each surviving subtree whose parent has yet to be visited: the
+        // node that represents it in ``dest_tree``, and the length of the
+        // edge subtending it (including those of suppressed nodes above it).
+        // The entries of the children of each internal node on the current
+        // path are preceded by an empty entry.
+        template <class SrcTreeT, class DestTreeT, class TaxonIndexFnT, class CopyValueFnT, class EdgeLengthGetterT, class EdgeLengthSetterT, class EntryT>
+        unsigned long extract(const SrcTreeT & src_tree,
+                DestTreeT & dest_tree,
+                TaxonIndexFnT & taxon_index_fn,
+                CopyValueFnT & copy_value_fn,
+                EdgeLengthGetterT & edge_length_getter,
+                EdgeLengthSetterT & edge_length_setter,
+                std::vector<EntryT> & subtrees) const {
+            typedef typename SrcTreeT::node_type src_node_type;
+            typedef typename DestTreeT::node_type dest_node_type;
+            dest_tree.clear();
+            subtrees.clear();
+            unsigned long num_kept = 0;
+            const src_node_type * src_root = src_tree.head_node();
+            const src_node_type * src_node = this->descend(src_root, subtrees);
+            while (src_node != src_root) {
+                if (src_node->is_leaf()) {
+                    if (this->contains(static_cast<std::size_t>(taxon_index_fn(src_node->value())))) {
+                        dest_node_type * nd = dest_tree.create_leaf_node();
+                        copy_value_fn(src_node->value(), nd->value());
+                        subtrees.emplace_back(nd, edge_length_getter(src_node->value()));
+                        ++num_kept;
+                    }
+                } else {
+                    std::size_t num_children = this->count_children(subtrees);
+                    if (num_children == 0) {
+                        subtrees.pop_back();
+                    } else if (num_children == 1) {
+                        EntryT & survivor = subtrees[subtrees.size() - 2];
+                        survivor = subtrees.back();
+                        survivor.second += edge_length_getter(src_node->value());
+                        subtrees.pop_back();
+                    } else {
+                        dest_node_type * nd = dest_tree.create_internal_node();
+                        copy_value_fn(src_node->value(), nd->value());
+                        this->attach_children(nd, num_children, subtrees, edge_length_setter);
+                        subtrees.emplace_back(nd, edge_length_getter(src_node->value()));
+                    }
+                }
+                const src_node_type * next = src_node->next_sibling_node();
+                if (next == nullptr) {
+                    src_node = src_node->parent_node();
+                } else {
+                    src_node = this->descend(next, subtrees);
+                }
+            }
+            dest_node_type * head = dest_tree.head_node();
+            copy_value_fn(src_root->value(), head->value());
+            if (!src_root->is_leaf()) {
+                std::size_t num_children = this->count_children(subtrees);
+                if (num_children == 1 && !subtrees.back().first->is_leaf()) {
+                    dest_node_type * ch = subtrees.back().first;
+                    edge_length_setter(head->value(), edge_length_getter(src_root->value()) + subtrees.back().second);
+                    head->take_children(ch);
+                    dest_tree.dispose_node(ch);
+                    subtrees.clear();
+                } else {
+                    this->attach_children(head, num_children, subtrees, edge_length_setter);
+                }
+            }
+            dest_tree.mark_structure_modified();
+            return num_kept;
+        }
+
+        // Returns the first leaf in postorder of the subtree rooted at
+        // ``nd``, opening the entries of each internal node on the way.
+        template <class NodeT, class EntryT>
+        const NodeT * descend(const NodeT * nd, std::vector<EntryT> & subtrees) const {
+            while (nd->first_child_node() != nullptr) {
+                subtrees.emplace_back();
+                nd = nd->first_child_node();
+            }
+            return nd;
+        }
+
+        // Number of surviving children of the internal node being visited.
+        template <class EntryT>
+        std::size_t count_children(const std::vector<EntryT> & subtrees) const {
+            std::size_t num_children = 0;
+            for (auto entry = subtrees.rbegin(); entry->first != nullptr; ++entry) {
+                ++num_children;
+            }
+            return num_children;
+        }
+
+        // Attaches the nodes of the last ``num_children`` entries to ``nd``,
+        // removing them (and the empty entry before them).
+        template <class NodeT, class EntryT, class EdgeLengthSetterT>
+        void attach_children(NodeT * nd,
+                std::size_t num_children,
+                std::vector<EntryT> & subtrees,
+                EdgeLengthSetterT & edge_length_setter) const {
+            auto children_begin = subtrees.end() - static_cast<std::ptrdiff_t>(num_children);
+            for (auto chi = children_begin; chi != subtrees.end(); ++chi) {
+                edge_length_setter(chi->first->value(), chi->second);
+                nd->add_child(chi->first);
+            }
+            subtrees.erase(children_begin - 1, subtrees.end());
+        }
+
+        template <class FnT>
+        void for_each_block(std::size_t num_trees, unsigned int num_threads, FnT fn) const {
+            num_threads = resolve_num_threads(num_threads);
+            std::size_t num_blocks = std::min<std::size_t>(num_threads, num_trees);
+            if (num_blocks == 0) {
+                return;
+            }
+            std::size_t block_size = (num_trees + num_blocks - 1) / num_blocks;
+            parallel_for(num_blocks, num_threads, [&] (std::size_t block_idx) {
+                std::size_t begin_idx = block_idx * block_size;
+                std::size_t end_idx = std::min(begin_idx + block_size, num_trees);
+                if (begin_idx < end_idx) {
+                    fn(begin_idx, end_idx);
+                }
+            });
+        }
+
+    private:
+        std::vector<char>   mask_;
+        std::size_t         num_taxa_;
+
+}; // InducedSubtree
+
+} // namespace platypus
+
+#endif
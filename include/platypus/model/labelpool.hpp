@@ -0,0 +1,174 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Shared storage for labels repeated across nodes and trees.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_MODEL_LABELPOOL_HPP
+#define PLATYPUS_MODEL_LABELPOOL_HPP
+
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include "../base/base_producer.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// LabelPool
+
+/**
+ * A set of distinct label strings, each stored once, so that nodes (across
+ * any number of trees) that carry the same label can refer to a single
+ * string rather than each owning a copy. This is typically the case for the
+ * leaves of a collection of trees on the same taxa.
+ *
+ * Pooled strings are immutable, and remain valid (at the same address) until
+ * the pool is cleared or destroyed, so nodes can hold them by pointer (see
+ * platypus::InternedLabelNodeValue). A LabelPool is not thread-safe.
+ */
+class LabelPool {
+
+    public:
+        typedef const std::string *     label_type;
+
+    public:
+        LabelPool() {
+            this->empty_label_ = this->intern(std::string());
+        }
+        LabelPool(const LabelPool &) = delete;
+        LabelPool & operator=(const LabelPool &) = delete;
+
+        /**
+         * Returns the pooled copy of ``label``, adding it to the pool if it
+         * is not already there.
+         */
+        label_type intern(const std::string & label) {
+            return &(*this->labels_.insert(label).first);
+        }
+
+        // As above, but takes over ``label`` if it has to be added.
+        label_type intern(std::string && label) {
+            return &(*this->labels_.insert(std::move(label)).first);
+        }
+
+        // As above, for a label given as a character range.
+        label_type intern(const char * data, std::size_t size) {
+            this->scratch_.assign(data, size);
+            auto found = this->labels_.find(this->scratch_);
+            if (found != this->labels_.end()) {
+                return &(*found);
+            }
+            return &(*this->labels_.insert(std::move(this->scratch_)).first);
+        }
+
+        inline label_type empty_label() const {
+            return this->empty_label_;
+        }
+
+        // Number of distinct labels stored (including the empty label).
+        inline std::size_t size() const {
+            return this->labels_.size();
+        }
+
+        /**
+         * Removes all labels from the pool, invalidating all labels
+         * previously returned.
+         */
+        void clear() {
+            this->labels_.clear();
+            this->empty_label_ = this->intern(std::string());
+        }
+
+    private:
+        std::unordered_set<std::string>     labels_;
+        std::string                         scratch_;
+        label_type                          empty_label_;
+
+}; // LabelPool
+
+////////////////////////////////////////////////////////////////////////////////
+// InternedLabelNodeValue
+
+/**
+ * A node value that holds its label as a reference into a
+ * platypus::LabelPool rather than as a string of its own, so that a node
+ * value is the size of a pointer plus an edge length regardless of the
+ * length of its label. A default-constructed value has an empty label that
+ * does not belong to any pool.
+ */
+template <class EdgeLengthT=double>
+class InternedLabelNodeValue {
+    public:
+        InternedLabelNodeValue()
+            : label_(nullptr)
+            , edge_length_(0.0) { }
+        InternedLabelNodeValue(LabelPool::label_type label)
+            : label_(label)
+            , edge_length_(0.0) { }
+        void set_label(LabelPool::label_type label) {
+            this->label_ = label;
+        }
+        const std::string & get_label() const {
+            return this->label_ == nullptr ? InternedLabelNodeValue::no_label() : *this->label_;
+        }
+        LabelPool::label_type get_label_ptr() const {
+            return this->label_;
+        }
+        void set_edge_length(EdgeLengthT edge_length) {
+            this->edge_length_ = edge_length;
+        }
+        EdgeLengthT get_edge_length() const {
+            return this->edge_length_;
+        }
+    private:
+        static const std::string & no_label() {
+            static const std::string empty;
+            return empty;
+        }
+    private:
+        LabelPool::label_type   label_;
+        EdgeLengthT             edge_length_;
+}; // InternedLabelNodeValue
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions
+
+/**
+ * Binds the label setter (and mover) functions of ``producer`` to intern
+ * labels in ``pool``, and store them in node values through:
+ *
+ *      void set_label(platypus::LabelPool::label_type);
+ *
+ * (e.g. platypus::InternedLabelNodeValue). ``pool`` must outlive both the
+ * producer and the trees produced.
+ */
+template <class TreeT, class EdgeLengthT>
+void bind_label_pool(BaseTreeProducer<TreeT, EdgeLengthT> & producer, LabelPool & pool) {
+    LabelPool * pool_ptr = &pool;
+    producer.set_node_label_setter([pool_ptr] (typename TreeT::value_type & nv, const std::string & label) {
+        nv.set_label(pool_ptr->intern(label));
+    });
+    producer.set_node_label_mover([pool_ptr] (typename TreeT::value_type & nv, std::string && label) {
+        nv.set_label(pool_ptr->intern(std::move(label)));
+    });
+}
+
+} // namespace platypus
+
+#endif
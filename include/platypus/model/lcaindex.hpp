@@ -0,0 +1,250 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Constant-time lowest common ancestor queries.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_MODEL_LCAINDEX_HPP
+#define PLATYPUS_MODEL_LCAINDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// LcaIndex
+
+/**
+ * Answers lowest common ancestor (most recent common ancestor) queries on a
+ * tree in constant time, after an O(n log n) preprocessing pass:
+ *
+ *      platypus::LcaIndex<TreeType> lca_index(tree);
+ *      auto mrca = lca_index.lca(nd1, nd2);
+ *      auto clade_mrca = lca_index.mrca(nodes.begin(), nodes.end());
+ *
+ * Nodes are numbered in preorder, so that the subtree of each node is a
+ * contiguous range of numbers. For nodes ``u`` and ``v`` numbered ``a`` <
+ * ``b``, with ``u`` not an ancestor of ``v``, the shallowest node numbered in
+ * (``a``, ``b``] is a child of their lowest common ancestor; the minimum
+ * over any range is found with a sparse table of minima over ranges of
+ * power-of-two lengths. This is equivalent to a range-minimum query over an
+ * Euler tour of the tree, but with half the entries.
+ *
+ * As with TreeAnnotationCache, the index is rebuilt on the first query
+ * after the structure of the tree has changed (as given by
+ * Tree::structure_version()). The tree must outlive the index, and queries
+ * (which may rebuild) must not be made concurrently unless update() has
+ * been called since the last change to the tree.
+ *
+ * @tparam TreeT
+ *   Type of tree (platypus::Tree or derived).
+ */
+template <class TreeT>
+class LcaIndex {
+
+    public:
+        typedef typename TreeT::node_type       node_type;
+        typedef std::uint32_t                   index_type;
+
+    public:
+
+        LcaIndex(const TreeT & tree)
+            : tree_(tree)
+            , is_valid_(false)
+            , structure_version_(0) { }
+
+        inline const TreeT & tree() const {
+            return this->tree_;
+        }
+
+        // Forces a rebuild on the next query.
+        inline void invalidate() {
+            this->is_valid_ = false;
+        }
+
+        inline bool is_current() const {
+            return this->is_valid_ && this->structure_version_ == this->tree_.structure_version();
+        }
+
+        // Rebuilds the index, if out of date.
+        inline void update() {
+            if (!this->is_current()) {
+                this->compute();
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Queries
+
+        // Number of nodes in the tree.
+        inline std::size_t size() {
+            this->update();
+            return this->nodes_.size();
+        }
+
+        // Returns the lowest common ancestor of ``a`` and ``b``.
+        const node_type * lca(const node_type * a, const node_type * b) {
+            index_type ia = this->get_index(a);
+            index_type ib = this->get_index(b);
+            return this->nodes_[this->lca_index(ia, ib)];
+        }
+
+        /**
+         * Returns the most recent common ancestor of the nodes in
+         * [``nodes_begin``, ``nodes_end``), or null if the range is empty.
+         * Only the first and last of the nodes in preorder need be compared,
+         * so this takes time linear in the number of nodes given.
+         */
+        template <class IterT>
+        const node_type * mrca(IterT nodes_begin, IterT nodes_end) {
+            if (nodes_begin == nodes_end) {
+                return nullptr;
+            }
+            index_type first = this->get_index(*nodes_begin);
+            index_type last = first;
+            for (++nodes_begin; nodes_begin != nodes_end; ++nodes_begin) {
+                index_type idx = this->get_index(*nodes_begin);
+                if (idx < first) {
+                    first = idx;
+                }
+                if (idx > last) {
+                    last = idx;
+                }
+            }
+            return this->nodes_[this->lca_index(first, last)];
+        }
+
+        // True if ``ancestor`` is ``nd`` or one of its ancestors.
+        bool is_ancestor(const node_type * ancestor, const node_type * nd) {
+            index_type ia = this->get_index(ancestor);
+            index_type in = this->get_index(nd);
+            return ia <= in && in < ia + this->subtree_sizes_[ia];
+        }
+
+        // Number of edges between the root and ``nd``.
+        inline unsigned long depth(const node_type * nd) {
+            return this->depths_[this->get_index(nd)];
+        }
+
+    private:
+
+        inline index_type get_index(const node_type * nd) {
+            this->update();
+            auto found = this->indexes_.find(nd);
+            if (found == this->indexes_.end()) {
+                throw std::invalid_argument("platypus::LcaIndex: node is not in the tree");
+            }
+            return found->second;
+        }
+
+        // Of the nodes numbered ``a`` and ``b``.
+        inline index_type lca_index(index_type a, index_type b) const {
+            if (a > b) {
+                std::swap(a, b);
+            }
+            if (a == b || b < a + this->subtree_sizes_[a]) {
+                return a;
+            }
+            return this->parents_[this->shallowest(a + 1, b)];
+        }
+
+        // Shallowest node numbered in [``first``, ``last``].
+        inline index_type shallowest(index_type first, index_type last) const {
+            unsigned int level = this->log2_[last - first + 1];
+            const std::vector<index_type> & minima = this->sparse_table_[level];
+            index_type x = minima[first];
+            index_type y = minima[last + 1 - (index_type(1) << level)];
+            return this->depths_[x] <= this->depths_[y] ? x : y;
+        }
+
+        void compute() {
+            this->indexes_.clear();
+            this->nodes_.clear();
+            this->parents_.clear();
+            this->depths_.clear();
+            for (auto ndi = this->tree_.preorder_begin(); ndi != this->tree_.preorder_end(); ++ndi) {
+                const node_type * nd = ndi.node();
+                index_type idx = static_cast<index_type>(this->nodes_.size());
+                this->indexes_[nd] = idx;
+                this->nodes_.push_back(nd);
+                if (idx == 0) {
+                    this->parents_.push_back(0);
+                    this->depths_.push_back(0);
+                } else {
+                    index_type parent_idx = this->indexes_[nd->parent_node()];
+                    this->parents_.push_back(parent_idx);
+                    this->depths_.push_back(this->depths_[parent_idx] + 1);
+                }
+            }
+            std::size_t n = this->nodes_.size();
+            this->subtree_sizes_.assign(n, 1);
+            for (std::size_t idx = n; idx-- > 1; ) {
+                this->subtree_sizes_[this->parents_[idx]] += this->subtree_sizes_[idx];
+            }
+            this->log2_.assign(n + 1, 0);
+            for (std::size_t len = 2; len <= n; ++len) {
+                this->log2_[len] = this->log2_[len / 2] + 1;
+            }
+            unsigned int num_levels = n > 0 ? this->log2_[n] + 1 : 0;
+            this->sparse_table_.resize(num_levels);
+            if (num_levels > 0) {
+                this->sparse_table_[0].resize(n);
+                for (std::size_t idx = 0; idx < n; ++idx) {
+                    this->sparse_table_[0][idx] = static_cast<index_type>(idx);
+                }
+            }
+            for (unsigned int level = 1; level < num_levels; ++level) {
+                const std::vector<index_type> & previous = this->sparse_table_[level - 1];
+                std::vector<index_type> & minima = this->sparse_table_[level];
+                std::size_t half = std::size_t(1) << (level - 1);
+                minima.resize(n - 2 * half + 1);
+                for (std::size_t idx = 0; idx < minima.size(); ++idx) {
+                    index_type x = previous[idx];
+                    index_type y = previous[idx + half];
+                    minima[idx] = this->depths_[x] <= this->depths_[y] ? x : y;
+                }
+            }
+            this->is_valid_ = true;
+            this->structure_version_ = this->tree_.structure_version();
+        }
+
+    private:
+        const TreeT &                                       tree_;
+        bool                                                is_valid_;
+        unsigned long                                       structure_version_;
+        std::unordered_map<const node_type *, index_type>   indexes_;
+        // by index, in preorder
+        std::vector<const node_type *>                      nodes_;
+        std::vector<index_type>                             parents_;
+        std::vector<unsigned long>                          depths_;
+        std::vector<index_type>                             subtree_sizes_;
+        std::vector<unsigned char>                          log2_;
+        // sparse_table_[k][i]: shallowest node numbered in [i, i + 2^k)
+        std::vector<std::vector<index_type>>                sparse_table_;
+
+}; // LcaIndex
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,180 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Index of the leaf nodes of a tree by label or taxon.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_MODEL_LEAFINDEX_HPP
+#define PLATYPUS_MODEL_LEAFINDEX_HPP
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// LeafIndex
+
+/**
+ * A hash index of the leaf nodes of a tree by a key derived from their
+ * values (e.g., their labels or taxon indexes), built in one pass over the
+ * leaves, so that each lookup is constant-time rather than a scan of the
+ * tree:
+ *
+ *      platypus::LeafIndex<TreeType> by_label(tree,
+ *              [](const NodeValue & nv) { return nv.get_label(); });
+ *      auto outgroup = by_label.find(std::vector<std::string>{"a", "b"});
+ *
+ *      platypus::LeafIndex<TreeType, platypus::TaxonNamespace::index_type> by_taxon(tree,
+ *              [](const NodeValue & nv) { return nv.get_taxon_index(); });
+ *
+ * If several leaves share a key, the first of them in preorder is indexed.
+ *
+ * As with TreeAnnotationCache, the index is rebuilt on the first lookup
+ * after the structure of the tree has changed (as given by
+ * Tree::structure_version()); changes to the keys of node values are not
+ * tracked: call invalidate() after making them. The tree must outlive the
+ * index, and lookups (which may rebuild it) must not be made concurrently
+ * unless update() has been called since the last change to the tree.
+ *
+ * @tparam TreeT
+ *   Type of tree (platypus::Tree or derived).
+ * @tparam KeyT
+ *   Type of key, hashed with ``HashT``.
+ */
+template <class TreeT, class KeyT=std::string, class HashT=std::hash<KeyT>>
+class LeafIndex {
+
+    public:
+        typedef typename TreeT::node_type       node_type;
+        typedef typename TreeT::value_type      value_type;
+        typedef KeyT                            key_type;
+        typedef std::function<KeyT (const value_type &)> key_getter_type;
+
+    public:
+
+        LeafIndex(const TreeT & tree, const key_getter_type & key_getter)
+            : tree_(tree)
+            , key_getter_(key_getter)
+            , is_valid_(false)
+            , structure_version_(0)
+            , num_leaves_(0) { }
+
+        inline const TreeT & tree() const {
+            return this->tree_;
+        }
+
+        // Forces a rebuild on the next lookup.
+        inline void invalidate() {
+            this->is_valid_ = false;
+        }
+
+        inline bool is_current() const {
+            return this->is_valid_ && this->structure_version_ == this->tree_.structure_version();
+        }
+
+        // Rebuilds the index, if out of date.
+        inline void update() {
+            if (!this->is_current()) {
+                this->build();
+            }
+        }
+
+        // Number of leaves of the tree (indexed or, if their keys are
+        // duplicated, not).
+        inline std::size_t num_leaves() {
+            this->update();
+            return this->num_leaves_;
+        }
+
+        // Number of distinct keys.
+        inline std::size_t size() {
+            this->update();
+            return this->nodes_.size();
+        }
+
+        // Whether every leaf has a distinct key.
+        inline bool is_unique() {
+            this->update();
+            return this->nodes_.size() == this->num_leaves_;
+        }
+
+        // The leaf with key ``key``, or null if there is none.
+        node_type * find(const KeyT & key) {
+            this->update();
+            auto iter = this->nodes_.find(key);
+            return iter == this->nodes_.end() ? nullptr : iter->second;
+        }
+
+        /**
+         * Appends the leaf with each key of [``keys_begin``, ``keys_end``)
+         * (or null, for a key of no leaf) to ``nodes``, and returns the
+         * number of keys not found.
+         */
+        template <class IterT>
+        std::size_t find(IterT keys_begin, IterT keys_end, std::vector<node_type *> & nodes) {
+            this->update();
+            std::size_t num_missing = 0;
+            for (; keys_begin != keys_end; ++keys_begin) {
+                auto iter = this->nodes_.find(*keys_begin);
+                if (iter == this->nodes_.end()) {
+                    nodes.push_back(nullptr);
+                    ++num_missing;
+                } else {
+                    nodes.push_back(iter->second);
+                }
+            }
+            return num_missing;
+        }
+
+        // The leaves with keys ``keys``, in order (null for a key of no leaf).
+        std::vector<node_type *> find(const std::vector<KeyT> & keys) {
+            std::vector<node_type *> nodes;
+            nodes.reserve(keys.size());
+            this->find(keys.begin(), keys.end(), nodes);
+            return nodes;
+        }
+
+    private:
+        void build() {
+            this->nodes_.clear();
+            this->num_leaves_ = 0;
+            for (auto nd = this->tree_.leaf_begin(); nd != this->tree_.leaf_end(); ++nd) {
+                this->nodes_.emplace(this->key_getter_(nd.node()->value()), nd.node());
+                ++this->num_leaves_;
+            }
+            this->structure_version_ = this->tree_.structure_version();
+            this->is_valid_ = true;
+        }
+
+    private:
+        const TreeT &                                       tree_;
+        key_getter_type                                     key_getter_;
+        bool                                                is_valid_;
+        unsigned long                                       structure_version_;
+        std::size_t                                         num_leaves_;
+        std::unordered_map<KeyT, node_type *, HashT>        nodes_;
+
+}; // LeafIndex
+
+} // namespace platypus
+
+#endif
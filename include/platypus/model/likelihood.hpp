@@ -0,0 +1,1025 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Tree likelihoods under Markov models of character evolution.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_MODEL_LIKELIHOOD_HPP
+#define PLATYPUS_MODEL_LIKELIHOOD_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../utility/alignedbuffer.hpp"
+#include "../utility/parallel.hpp"
+#include "charactermatrix.hpp"
+#include "datatable.hpp"
+
+namespace platypus {
+
+namespace likelihood { namespace detail {
+
+/**
+ * Eigen-decomposition of the symmetric ``n`` x ``n`` matrix ``a`` (row-major,
+ * overwritten) by cyclic Jacobi rotations: on return, ``values`` holds the
+ * eigenvalues and column ``k`` of ``vectors`` (row-major) the eigenvector of
+ * ``values[k]``.
+ */
+inline void symmetric_eigen(std::vector<double> & a,
+        std::size_t n,
+        std::vector<double> & values,
+        std::vector<double> & vectors) {
+    vectors.assign(n * n, 0.0);
+    for (std::size_t i = 0; i < n; ++i) {
+        vectors[i * n + i] = 1.0;
+    }
+    for (int sweep = 0; sweep < 100; ++sweep) {
+        double off_diagonal = 0.0;
+        for (std::size_t p = 0; p < n; ++p) {
+            for (std::size_t q = p + 1; q < n; ++q) {
+                off_diagonal += a[p * n + q] * a[p * n + q];
+            }
+        }
+        if (off_diagonal < 1e-30) {
+            break;
+        }
+        for (std::size_t p = 0; p < n; ++p) {
+            for (std::size_t q = p + 1; q < n; ++q) {
+                double apq = a[p * n + q];
+                if (std::fabs(apq) < 1e-300) {
+                    continue;
+                }
+                double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+                double t = (theta >= 0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                double c = 1.0 / std::sqrt(t * t + 1.0);
+                double s = t * c;
+                for (std::size_t k = 0; k < n; ++k) {
+                    double akp = a[k * n + p];
+                    double akq = a[k * n + q];
+                    a[k * n + p] = c * akp - s * akq;
+                    a[k * n + q] = s * akp + c * akq;
+                }
+                for (std::size_t k = 0; k < n; ++k) {
+                    double apk = a[p * n + k];
+                    double aqk = a[q * n + k];
+                    a[p * n + k] = c * apk - s * aqk;
+                    a[q * n + k] = s * apk + c * aqk;
+                }
+                for (std::size_t k = 0; k < n; ++k) {
+                    double vkp = vectors[k * n + p];
+                    double vkq = vectors[k * n + q];
+                    vectors[k * n + p] = c * vkp - s * vkq;
+                    vectors[k * n + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    values.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        values[i] = a[i * n + i];
+    }
+}
+
+// Regularized lower incomplete gamma function, P(a, x).
+inline double incomplete_gamma(double a, double x) {
+    if (x <= 0.0) {
+        return 0.0;
+    }
+    double log_prefix = -x + a * std::log(x) - std::lgamma(a);
+    if (x < a + 1.0) {
+        double term = 1.0 / a;
+        double sum = term;
+        for (int n = 1; n < 1000; ++n) {
+            term *= x / (a + n);
+            sum += term;
+            if (std::fabs(term) < std::fabs(sum) * 1e-15) {
+                break;
+            }
+        }
+        return std::min(1.0, sum * std::exp(log_prefix));
+    }
+    // continued fraction for Q(a, x), by the modified Lentz method
+    const double tiny = 1e-300;
+    double b = x + 1.0 - a;
+    double c = 1.0 / tiny;
+    double d = 1.0 / b;
+    double h = d;
+    for (int n = 1; n < 1000; ++n) {
+        double an = -n * (n - a);
+        b += 2.0;
+        d = an * d + b;
+        if (std::fabs(d) < tiny) {
+            d = tiny;
+        }
+        c = b + an / c;
+        if (std::fabs(c) < tiny) {
+            c = tiny;
+        }
+        d = 1.0 / d;
+        double delta = d * c;
+        h *= delta;
+        if (std::fabs(delta - 1.0) < 1e-15) {
+            break;
+        }
+    }
+    return std::max(0.0, 1.0 - std::exp(log_prefix) * h);
+}
+
+// The ``p`` quantile of the gamma distribution with shape ``a`` and rate 1.
+inline double gamma_quantile(double a, double p) {
+    double lower = 0.0;
+    double upper = std::max(1.0, a);
+    while (incomplete_gamma(a, upper) < p) {
+        upper *= 2.0;
+    }
+    for (int iter = 0; iter < 200 && upper - lower > 1e-14 * upper; ++iter) {
+        double mid = 0.5 * (lower + upper);
+        if (incomplete_gamma(a, mid) < p) {
+            lower = mid;
+        } else {
+            upper = mid;
+        }
+    }
+    return 0.5 * (lower + upper);
+}
+
+/**
+ * Multiplies each of the ``num_patterns`` x ``num_categories`` partial
+ * likelihood vectors in ``dest`` by the transition probability matrix of
+ * its category (in ``pmats``) applied to the corresponding vector of a
+ * child (at ``child_pattern_stride`` and ``child_category_stride``).
+ *
+ * ``NumStatesT`` fixes the number of states at compile time, so that the
+ * inner loops are unrolled and vectorized; 0 uses ``num_states``.
+ */
+template <std::size_t NumStatesT>
+inline void multiply_child_partials(double * dest,
+        const double * child,
+        std::size_t child_pattern_stride,
+        std::size_t child_category_stride,
+        const double * pmats,
+        std::size_t num_patterns,
+        std::size_t num_categories,
+        std::size_t num_states) {
+    const std::size_t n = NumStatesT > 0 ? NumStatesT : num_states;
+    for (std::size_t pattern = 0; pattern < num_patterns; ++pattern) {
+        for (std::size_t category = 0; category < num_categories; ++category) {
+            const double * pmat = pmats + category * n * n;
+            const double * in = child + pattern * child_pattern_stride + category * child_category_stride;
+            double * out = dest + (pattern * num_categories + category) * n;
+            for (std::size_t i = 0; i < n; ++i) {
+                double sum = 0.0;
+                for (std::size_t j = 0; j < n; ++j) {
+                    sum += pmat[i * n + j] * in[j];
+                }
+                out[i] *= sum;
+            }
+        }
+    }
+}
+
+} } // namespace likelihood::detail
+
+/**
+ * Returns the mean rates of ``num_categories`` equiprobable categories of
+ * the gamma distribution with shape ``shape`` and mean 1 (Yang 1994).
+ */
+inline std::vector<double> discrete_gamma_rates(double shape, unsigned int num_categories) {
+    if (num_categories == 0) {
+        throw std::invalid_argument("platypus::discrete_gamma_rates: number of categories must be positive");
+    }
+    if (num_categories == 1) {
+        return std::vector<double>(1, 1.0);
+    }
+    if (!(shape > 0.0)) {
+        throw std::invalid_argument("platypus::discrete_gamma_rates: shape must be positive");
+    }
+    std::vector<double> rates(num_categories);
+    double lower = 0.0;
+    double total = 0.0;
+    for (unsigned int category = 0; category < num_categories; ++category) {
+        double upper = 1.0;
+        if (category + 1 < num_categories) {
+            double cut = likelihood::detail::gamma_quantile(shape, static_cast<double>(category + 1) / num_categories);
+            upper = likelihood::detail::incomplete_gamma(shape + 1.0, cut);
+        }
+        rates[category] = (upper - lower) * num_categories;
+        total += rates[category];
+        lower = upper;
+    }
+    for (auto & rate : rates) {
+        rate *= num_categories / total;
+    }
+    return rates;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SubstitutionModel
+
+/**
+ * A time-reversible continuous-time Markov model of character evolution,
+ * given by the exchangeabilities of pairs of states and the stationary
+ * state frequencies, and scaled to one expected substitution per unit
+ * time. Transition probabilities are computed from the eigen-decomposition
+ * of the rate matrix.
+ */
+class SubstitutionModel {
+
+    public:
+
+        /**
+         * Constructs a model over ``frequencies.size()`` states.
+         *
+         * @param exchangeabilities
+         *   Exchangeabilities of the pairs of states in row-major order of
+         *   the upper triangle of the rate matrix: for nucleotides, A-C,
+         *   A-G, A-T, C-G, C-T and G-T.
+         * @param frequencies
+         *   Stationary state frequencies (normalized to sum to 1).
+         */
+        SubstitutionModel(const std::vector<double> & exchangeabilities, const std::vector<double> & frequencies)
+            : exchangeabilities_(exchangeabilities)
+            , frequencies_(frequencies) {
+            std::size_t n = frequencies.size();
+            if (n < 2) {
+                throw std::invalid_argument("platypus::SubstitutionModel: at least two states are required");
+            }
+            if (exchangeabilities.size() != n * (n - 1) / 2) {
+                throw std::invalid_argument("platypus::SubstitutionModel: expecting " + std::to_string(n * (n - 1) / 2) + " exchangeabilities");
+            }
+            double total = 0.0;
+            for (auto freq : frequencies) {
+                if (!(freq > 0.0)) {
+                    throw std::invalid_argument("platypus::SubstitutionModel: state frequencies must be positive");
+                }
+                total += freq;
+            }
+            for (auto & freq : this->frequencies_) {
+                freq /= total;
+            }
+            for (auto rate : exchangeabilities) {
+                if (!(rate >= 0.0)) {
+                    throw std::invalid_argument("platypus::SubstitutionModel: exchangeabilities must not be negative");
+                }
+            }
+            this->decompose();
+        }
+
+        // Jukes and Cantor (1969).
+        static SubstitutionModel jc69() {
+            return SubstitutionModel(std::vector<double>(6, 1.0), std::vector<double>(4, 0.25));
+        }
+
+        // Hasegawa, Kishino and Yano (1985): transitions at ``kappa`` times
+        // the rate of transversions.
+        static SubstitutionModel hky85(double kappa, const std::vector<double> & frequencies) {
+            return SubstitutionModel(std::vector<double>{1.0, kappa, 1.0, 1.0, kappa, 1.0}, frequencies);
+        }
+
+        // General time-reversible model (Tavare 1986).
+        static SubstitutionModel gtr(const std::vector<double> & exchangeabilities, const std::vector<double> & frequencies) {
+            return SubstitutionModel(exchangeabilities, frequencies);
+        }
+
+        inline std::size_t num_states() const {
+            return this->frequencies_.size();
+        }
+
+        inline const std::vector<double> & frequencies() const {
+            return this->frequencies_;
+        }
+
+        inline const std::vector<double> & exchangeabilities() const {
+            return this->exchangeabilities_;
+        }
+
+        // The (scaled) rate matrix, in row-major order.
+        inline const std::vector<double> & rate_matrix() const {
+            return this->rate_matrix_;
+        }
+
+        /**
+         * Writes the matrix of probabilities of change from state ``i``
+         * (row) to state ``j`` (column) over time ``t`` into ``dest``, in
+         * row-major order. Not safe to call concurrently on the same
+         * model (copies may be used instead).
+         */
+        void transition_probabilities(double t, double * dest) const {
+            const std::size_t n = this->num_states();
+            for (std::size_t k = 0; k < n; ++k) {
+                this->exp_values_[k] = std::exp(this->eigenvalues_[k] * t);
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t j = 0; j < n; ++j) {
+                    double sum = 0.0;
+                    for (std::size_t k = 0; k < n; ++k) {
+                        sum += this->left_vectors_[i * n + k] * this->exp_values_[k] * this->right_vectors_[k * n + j];
+                    }
+                    dest[i * n + j] = sum < 0.0 ? 0.0 : sum;
+                }
+            }
+        }
+
+    private:
+
+        // Q = D^-1/2 U L U' D^1/2, for the symmetric D^1/2 Q D^-1/2 = U L U'
+        void decompose() {
+            const std::size_t n = this->num_states();
+            this->rate_matrix_.assign(n * n, 0.0);
+            std::size_t pair_idx = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t j = i + 1; j < n; ++j, ++pair_idx) {
+                    this->rate_matrix_[i * n + j] = this->exchangeabilities_[pair_idx] * this->frequencies_[j];
+                    this->rate_matrix_[j * n + i] = this->exchangeabilities_[pair_idx] * this->frequencies_[i];
+                }
+            }
+            double mean_rate = 0.0;
+            for (std::size_t i = 0; i < n; ++i) {
+                double row_sum = 0.0;
+                for (std::size_t j = 0; j < n; ++j) {
+                    row_sum += this->rate_matrix_[i * n + j];
+                }
+                this->rate_matrix_[i * n + i] = -row_sum;
+                mean_rate += this->frequencies_[i] * row_sum;
+            }
+            if (!(mean_rate > 0.0)) {
+                throw std::invalid_argument("platypus::SubstitutionModel: all exchangeabilities are zero");
+            }
+            for (auto & rate : this->rate_matrix_) {
+                rate /= mean_rate;
+            }
+            std::vector<double> symmetric(n * n);
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t j = 0; j < n; ++j) {
+                    symmetric[i * n + j] = this->rate_matrix_[i * n + j] * std::sqrt(this->frequencies_[i] / this->frequencies_[j]);
+                }
+            }
+            std::vector<double> vectors;
+            likelihood::detail::symmetric_eigen(symmetric, n, this->eigenvalues_, vectors);
+            this->left_vectors_.resize(n * n);
+            this->right_vectors_.resize(n * n);
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t k = 0; k < n; ++k) {
+                    this->left_vectors_[i * n + k] = vectors[i * n + k] / std::sqrt(this->frequencies_[i]);
+                    this->right_vectors_[k * n + i] = vectors[i * n + k] * std::sqrt(this->frequencies_[i]);
+                }
+            }
+            this->exp_values_.resize(n);
+        }
+
+    private:
+        std::vector<double>             exchangeabilities_;
+        std::vector<double>             frequencies_;
+        std::vector<double>             rate_matrix_;
+        std::vector<double>             eigenvalues_;
+        std::vector<double>             left_vectors_;
+        std::vector<double>             right_vectors_;
+        mutable std::vector<double>     exp_values_;
+
+}; // SubstitutionModel
+
+////////////////////////////////////////////////////////////////////////////////
+// TreeLikelihood
+
+/**
+ * Computes the log-likelihood of trees on the sites (or weighted site
+ * patterns; see BasicCharacterMatrix::compress_patterns()) of a character
+ * matrix under a SubstitutionModel with (optionally) discrete-gamma
+ * distributed rates across sites, by Felsenstein's pruning algorithm.
+ *
+ * Leaves are matched to rows of the matrix by a taxon index function, as in
+ * FitchParsimony, and leaves with no row are treated as missing data. The
+ * edge length of a node is given by an edge length function, and the edge
+ * length of the root is ignored.
+ *
+ * Partial likelihoods are held in a single aligned pool with one block per
+ * internal node, in postorder, laid out by pattern, then rate category,
+ * then state. The pool is reused across calls, and grows only for larger
+ * trees. Partials that fall below scaling_threshold() are rescaled, the
+ * logarithms of the scale factors being accumulated per node and pattern,
+ * so that large trees do not underflow.
+ *
+ * After the edge lengths of some nodes change (or their nodes are
+ * relinked, as by TreeRearrangements), update_log_likelihood() recomputes
+ * only the partials of their ancestors.
+ */
+template <class TreeT, class StateSetT>
+class TreeLikelihood {
+
+    public:
+        typedef BasicCharacterMatrix<StateSetT>     matrix_type;
+        typedef typename TreeT::node_type           node_type;
+        typedef typename TreeT::value_type          value_type;
+        typedef std::function<TaxonNamespace::index_type (const value_type &)> taxon_index_fn_type;
+        typedef std::function<double (const value_type &)> edge_length_fn_type;
+
+    public:
+
+        /**
+         * ``matrix`` must outlive this object, and not be modified while in
+         * use. Its alphabet must have as many states as ``model``.
+         */
+        TreeLikelihood(const matrix_type & matrix,
+                const SubstitutionModel & model,
+                const taxon_index_fn_type & taxon_index_fn,
+                const edge_length_fn_type & edge_length_fn,
+                unsigned int num_rate_categories=1,
+                double gamma_shape=1.0)
+            : matrix_(matrix)
+            , model_(model)
+            , taxon_index_fn_(taxon_index_fn)
+            , edge_length_fn_(edge_length_fn)
+            , num_states_(model.num_states())
+            , num_patterns_(matrix.num_sites())
+            , partial_block_size_(0)
+            , log_likelihood_(0.0) {
+            if (matrix.alphabet().num_states() != this->num_states_) {
+                throw std::invalid_argument("platypus::TreeLikelihood: number of states of matrix and model differ");
+            }
+            for (std::size_t pattern = 0; pattern < this->num_patterns_; ++pattern) {
+                this->pattern_weights_.push_back(matrix.get_pattern_weight(pattern));
+            }
+            // tip partials: one block per row, and one of missing data
+            std::size_t block_size = this->num_patterns_ * this->num_states_;
+            this->tip_partials_.resize((matrix.num_taxa() + 1) * block_size, 1.0);
+            for (std::size_t row = 0; row < matrix.num_taxa(); ++row) {
+                double * partials = this->tip_partials_.data() + row * block_size;
+                for (std::size_t pattern = 0; pattern < this->num_patterns_; ++pattern) {
+                    StateSetT state_set = matrix.get_state_set(row, pattern);
+                    for (std::size_t state = 0; state < this->num_states_; ++state) {
+                        partials[pattern * this->num_states_ + state] = (state_set >> state) & 1 ? 1.0 : 0.0;
+                    }
+                }
+            }
+            this->set_rate_categories(num_rate_categories, gamma_shape);
+        }
+
+        /**
+         * Sets the number of discrete-gamma rate categories and the shape of
+         * the gamma distribution.
+         */
+        void set_rate_categories(unsigned int num_rate_categories, double gamma_shape) {
+            this->category_rates_ = discrete_gamma_rates(gamma_shape, num_rate_categories);
+            this->pmats_.resize(this->category_rates_.size() * this->num_states_ * this->num_states_);
+            this->node_slots_.clear();
+        }
+
+        void set_model(const SubstitutionModel & model) {
+            if (model.num_states() != this->num_states_) {
+                throw std::invalid_argument("platypus::TreeLikelihood: number of states of matrix and model differ");
+            }
+            this->model_ = model;
+            this->node_slots_.clear();
+        }
+
+        inline const SubstitutionModel & model() const {
+            return this->model_;
+        }
+
+        inline const std::vector<double> & category_rates() const {
+            return this->category_rates_;
+        }
+
+        inline double get_log_likelihood() const {
+            return this->log_likelihood_;
+        }
+
+        // Partials smaller than this are rescaled.
+        static constexpr double scaling_threshold() {
+            return 1.0 / 18446744073709551616.0 / 18446744073709551616.0;
+        }
+
+        /**
+         * Computes the log-likelihood of ``tree`` from scratch.
+         */
+        double log_likelihood(const TreeT & tree) {
+            this->node_slots_.clear();
+            for (auto ndi = tree.postorder_begin(); ndi != tree.postorder_end(); ++ndi) {
+                if (!ndi.is_leaf()) {
+                    this->node_slots_.insert(std::make_pair(ndi.node(), this->node_slots_.size()));
+                }
+            }
+            std::size_t num_slots = this->node_slots_.size();
+            this->partial_block_size_ = this->num_patterns_ * this->category_rates_.size() * this->num_states_;
+            // keep blocks aligned
+            const std::size_t doubles_per_line = AlignedBuffer<double>::alignment() / sizeof(double);
+            this->partial_block_size_ = (this->partial_block_size_ + doubles_per_line - 1) / doubles_per_line * doubles_per_line;
+            if (this->partials_.size() < num_slots * this->partial_block_size_) {
+                this->partials_.resize(num_slots * this->partial_block_size_);
+            }
+            if (this->log_scales_.size() < num_slots * this->num_patterns_) {
+                this->log_scales_.resize(num_slots * this->num_patterns_);
+            }
+            for (auto ndi = tree.postorder_begin(); ndi != tree.postorder_end(); ++ndi) {
+                if (!ndi.is_leaf()) {
+                    this->update_node(ndi.node());
+                }
+            }
+            return this->compute_root_log_likelihood(tree);
+        }
+
+        /**
+         * Returns the log-likelihoods of the trees in [``trees_begin``,
+         * ``trees_end``), evaluated concurrently on ``num_threads`` threads
+         * (see resolve_num_threads()), so the taxon index and edge length
+         * functions must be safe to call concurrently. Each thread evaluates
+         * a contiguous block of trees with its own copy of the model and
+         * tip partials of this object, and buffers of partials that are
+         * reused from tree to tree. The state of this object is not changed.
+         *
+         * Only tree-level parallelism is provided: the trees of a block are
+         * evaluated one after another, exactly as by log_likelihood(), and
+         * the partials of nodes of different trees are never batched
+         * together.
+         */
+        template <class IterT>
+        std::vector<double> log_likelihood_trees(IterT trees_begin,
+                IterT trees_end,
+                unsigned int num_threads=0) const {
+            std::size_t num_trees = static_cast<std::size_t>(std::distance(trees_begin, trees_end));
+            std::vector<double> log_likelihoods(num_trees);
+            num_threads = resolve_num_threads(num_threads);
+            std::size_t num_blocks = std::min<std::size_t>(num_threads, num_trees);
+            if (num_blocks == 0) {
+                return log_likelihoods;
+            }
+            std::size_t block_size = (num_trees + num_blocks - 1) / num_blocks;
+            parallel_for(num_blocks, num_threads, [&] (std::size_t block_idx) {
+                TreeLikelihood likelihood(*this, 0);
+                std::size_t begin_idx = block_idx * block_size;
+                std::size_t end_idx = std::min(begin_idx + block_size, num_trees);
+                IterT tree_iter = trees_begin;
+                std::advance(tree_iter, begin_idx);
+                for (std::size_t idx = begin_idx; idx < end_idx; ++idx, ++tree_iter) {
+                    log_likelihoods[idx] = likelihood.log_likelihood(*tree_iter);
+                }
+            });
+            return log_likelihoods;
+        }
+
+        /**
+         * Updates the log-likelihood of ``tree`` after a change to the edge
+         * lengths of ``modified_nodes``, recomputing only the partials of
+         * their ancestors, in order of decreasing depth. The nodes of the
+         * tree must not have changed since the last call to
+         * log_likelihood(), but they may have been relinked (e.g., by
+         * TreeRearrangements::apply(), with ``modified_nodes`` given by
+         * TreeRearrangements::relinked_nodes()), as long as no leaf has
+         * become internal or internal node a leaf.
+         */
+        double update_log_likelihood(const TreeT & tree, const std::vector<node_type *> & modified_nodes) {
+            if (this->node_slots_.empty() && !tree.head_node()->is_leaf()) {
+                return this->log_likelihood(tree);
+            }
+            this->path_nodes_.clear();
+            for (const node_type * nd : modified_nodes) {
+                std::size_t path_begin = this->path_nodes_.size();
+                for (nd = nd->parent_node(); nd != nullptr; nd = nd->parent_node()) {
+                    this->path_nodes_.push_back(std::make_pair(0UL, nd));
+                }
+                std::size_t path_length = this->path_nodes_.size() - path_begin;
+                for (std::size_t idx = path_begin; idx < this->path_nodes_.size(); ++idx) {
+                    this->path_nodes_[idx].first = path_length - (idx - path_begin);
+                }
+            }
+            std::sort(this->path_nodes_.begin(), this->path_nodes_.end(),
+                    [] (const std::pair<unsigned long, const node_type *> & a, const std::pair<unsigned long, const node_type *> & b) {
+                        return a.first > b.first || (a.first == b.first && std::less<const node_type *>()(a.second, b.second));
+                    });
+            const node_type * previous = nullptr;
+            for (auto & path_node : this->path_nodes_) {
+                if (path_node.second != previous) {
+                    this->update_node(path_node.second);
+                }
+                previous = path_node.second;
+            }
+            return this->compute_root_log_likelihood(tree);
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Ancestral States
+
+        /**
+         * Computes the marginal posterior probabilities of the states of
+         * every internal node of ``tree``, for every site pattern, reusing
+         * the partials of the last call to log_likelihood() or
+         * update_log_likelihood() (which must be current for ``tree``; if
+         * none has been made, log_likelihood() is called), with a single
+         * preorder pass for the partial likelihoods of the data outside the
+         * subtree of each node. This takes about the time of one more pass
+         * over the tree, rather than one pass for each node rerooted.
+         *
+         * The probability of each state is that of the data with the node
+         * in that state (under each rate category, averaged across
+         * categories) relative to that of the data, so that the
+         * probabilities of the states of each node sum to one.
+         *
+         * @return
+         *   The log-likelihood of the tree.
+         */
+        double compute_ancestral_states(const TreeT & tree) {
+            if (this->node_slots_.empty() && !tree.head_node()->is_leaf()) {
+                this->log_likelihood(tree);
+            }
+            const std::size_t num_categories = this->category_rates_.size();
+            const std::size_t n = this->num_states_;
+            const std::size_t num_slots = this->node_slots_.size();
+            const std::size_t block_size = this->num_patterns_ * num_categories * n;
+            if (this->outside_partials_.size() < num_slots * this->partial_block_size_) {
+                this->outside_partials_.resize(num_slots * this->partial_block_size_);
+            }
+            this->state_probabilities_.resize(num_slots * this->num_patterns_ * n);
+            if (num_slots == 0) {
+                return this->log_likelihood_;
+            }
+            // the root: the data outside its subtree is none, and its states
+            // are weighted by the equilibrium frequencies
+            const std::vector<double> & frequencies = this->model_.frequencies();
+            double * root_outside = this->outside_partials_.data() + this->get_slot(tree.head_node()) * this->partial_block_size_;
+            for (std::size_t idx = 0; idx < block_size; ++idx) {
+                root_outside[idx] = frequencies[idx % n];
+            }
+            for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+                if (!ndi.is_leaf()) {
+                    this->update_outside_partials(ndi.node());
+                }
+            }
+            return this->log_likelihood_;
+        }
+
+        /**
+         * The state probabilities of internal node ``nd`` computed by the
+         * last call to compute_ancestral_states(), as num_states()
+         * probabilities for each site pattern in turn.
+         */
+        const double * get_ancestral_state_probabilities(const node_type * nd) const {
+            return this->state_probabilities_.data() + this->get_slot(nd) * this->num_patterns_ * this->num_states_;
+        }
+
+        inline std::size_t num_states() const {
+            return this->num_states_;
+        }
+
+        inline std::size_t num_patterns() const {
+            return this->num_patterns_;
+        }
+
+        /**
+         * Adds the state probabilities computed by the last call to
+         * compute_ancestral_states() to ``table``, one row for each internal
+         * node and site pattern: "node" (the index of the node in preorder,
+         * counting all nodes from 0 at the head node) and "pattern" (key
+         * columns; see BasicCharacterMatrix::get_site_pattern() for the
+         * pattern of each original site), and one data column for each
+         * state, named by its symbol in the alphabet of the matrix. The
+         * columns are added if ``table`` has none.
+         */
+        void export_ancestral_states(const TreeT & tree, DataTable & table) const {
+            const std::size_t n = this->num_states_;
+            const CharacterStateAlphabet & alphabet = this->matrix_.alphabet();
+            if (table.num_columns() == 0) {
+                table.add_key_column<unsigned long>("node");
+                table.add_key_column<unsigned long>("pattern");
+                for (std::size_t state = 0; state < n; ++state) {
+                    table.add_data_column<double>(std::string(1, alphabet.get_symbol(state)));
+                }
+            }
+            auto node_handle = table.column_handle<unsigned long>("node");
+            auto pattern_handle = table.column_handle<unsigned long>("pattern");
+            std::vector<DataTableColumnHandle<double>> state_handles;
+            for (std::size_t state = 0; state < n; ++state) {
+                state_handles.push_back(table.column_handle<double>(std::string(1, alphabet.get_symbol(state))));
+            }
+            table.reserve(table.num_rows() + this->node_slots_.size() * this->num_patterns_);
+            unsigned long node_idx = 0;
+            for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi, ++node_idx) {
+                if (ndi.is_leaf()) {
+                    continue;
+                }
+                const double * probabilities = this->get_ancestral_state_probabilities(ndi.node());
+                for (std::size_t pattern = 0; pattern < this->num_patterns_; ++pattern) {
+                    auto & row = table.add_row();
+                    row.set(node_handle, node_idx);
+                    row.set(pattern_handle, static_cast<unsigned long>(pattern));
+                    for (std::size_t state = 0; state < n; ++state) {
+                        row.set(state_handles[state], probabilities[pattern * n + state]);
+                    }
+                }
+            }
+        }
+
+    private:
+
+        // A copy of the matrix, model and tip partials of ``other``, without
+        // its partials, for an evaluation of other trees.
+        TreeLikelihood(const TreeLikelihood & other, int)
+            : matrix_(other.matrix_)
+            , model_(other.model_)
+            , taxon_index_fn_(other.taxon_index_fn_)
+            , edge_length_fn_(other.edge_length_fn_)
+            , num_states_(other.num_states_)
+            , num_patterns_(other.num_patterns_)
+            , pattern_weights_(other.pattern_weights_)
+            , category_rates_(other.category_rates_)
+            , tip_partials_(other.tip_partials_)
+            , partial_block_size_(0)
+            , pmats_(other.pmats_)
+            , log_likelihood_(0.0) {
+        }
+
+        std::size_t get_slot(const node_type * nd) const {
+            auto found = this->node_slots_.find(nd);
+            if (found == this->node_slots_.end()) {
+                throw std::logic_error("platypus::TreeLikelihood: node has not been visited by log_likelihood()");
+            }
+            return found->second;
+        }
+
+        const double * get_tip_partials(const node_type * nd) const {
+            std::size_t row = this->matrix_.find_row(this->taxon_index_fn_(nd->value()));
+            if (row == matrix_type::npos()) {
+                row = this->matrix_.num_taxa();
+            }
+            return this->tip_partials_.data() + row * this->num_patterns_ * this->num_states_;
+        }
+
+        void update_node(const node_type * nd) {
+            const std::size_t num_categories = this->category_rates_.size();
+            const std::size_t n = this->num_states_;
+            std::size_t slot = this->get_slot(nd);
+            double * partials = this->partials_.data() + slot * this->partial_block_size_;
+            double * log_scales = this->log_scales_.data() + slot * this->num_patterns_;
+            std::fill(partials, partials + this->num_patterns_ * num_categories * n, 1.0);
+            std::fill(log_scales, log_scales + this->num_patterns_, 0.0);
+            for (auto ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                double edge_length = this->edge_length_fn_(ch->value());
+                for (std::size_t category = 0; category < num_categories; ++category) {
+                    this->model_.transition_probabilities(edge_length * this->category_rates_[category], this->pmats_.data() + category * n * n);
+                }
+                const double * child_partials;
+                std::size_t pattern_stride;
+                std::size_t category_stride;
+                if (ch->is_leaf()) {
+                    child_partials = this->get_tip_partials(ch);
+                    pattern_stride = n;
+                    category_stride = 0;
+                } else {
+                    std::size_t child_slot = this->get_slot(ch);
+                    child_partials = this->partials_.data() + child_slot * this->partial_block_size_;
+                    pattern_stride = num_categories * n;
+                    category_stride = n;
+                    const double * child_log_scales = this->log_scales_.data() + child_slot * this->num_patterns_;
+                    for (std::size_t pattern = 0; pattern < this->num_patterns_; ++pattern) {
+                        log_scales[pattern] += child_log_scales[pattern];
+                    }
+                }
+                if (n == 4) {
+                    likelihood::detail::multiply_child_partials<4>(partials, child_partials, pattern_stride, category_stride,
+                            this->pmats_.data(), this->num_patterns_, num_categories, n);
+                } else {
+                    likelihood::detail::multiply_child_partials<0>(partials, child_partials, pattern_stride, category_stride,
+                            this->pmats_.data(), this->num_patterns_, num_categories, n);
+                }
+            }
+            const std::size_t pattern_block = num_categories * n;
+            for (std::size_t pattern = 0; pattern < this->num_patterns_; ++pattern) {
+                double * pattern_partials = partials + pattern * pattern_block;
+                double max_partial = *std::max_element(pattern_partials, pattern_partials + pattern_block);
+                if (max_partial < scaling_threshold() && max_partial > 0.0) {
+                    for (std::size_t idx = 0; idx < pattern_block; ++idx) {
+                        pattern_partials[idx] /= max_partial;
+                    }
+                    log_scales[pattern] += std::log(max_partial);
+                }
+            }
+        }
+
+        /**
+         * Computes the state probabilities of ``nd``, whose outside
+         * partials are current, and the outside partials of its internal
+         * children: for each child in turn, the outside partials of ``nd``
+         * times the messages (the transition probabilities applied to the
+         * partials) of all the other children, found as products of the
+         * messages before and after it, so that a node with ``k`` children
+         * takes time linear in ``k``, carried down the edge of the child.
+         * Outside partials are rescaled per pattern as they become small,
+         * as only their proportions matter.
+         */
+        void update_outside_partials(const node_type * nd) {
+            const std::size_t num_categories = this->category_rates_.size();
+            const std::size_t n = this->num_states_;
+            const std::size_t block_size = this->num_patterns_ * num_categories * n;
+            const std::size_t slot = this->get_slot(nd);
+            const double * outside = this->outside_partials_.data() + slot * this->partial_block_size_;
+            const double * partials = this->partials_.data() + slot * this->partial_block_size_;
+            double * probabilities = this->state_probabilities_.data() + slot * this->num_patterns_ * n;
+            for (std::size_t pattern = 0; pattern < this->num_patterns_; ++pattern) {
+                double * pattern_probabilities = probabilities + pattern * n;
+                std::fill(pattern_probabilities, pattern_probabilities + n, 0.0);
+                for (std::size_t category = 0; category < num_categories; ++category) {
+                    std::size_t offset = (pattern * num_categories + category) * n;
+                    for (std::size_t state = 0; state < n; ++state) {
+                        pattern_probabilities[state] += outside[offset + state] * partials[offset + state];
+                    }
+                }
+                double total = std::accumulate(pattern_probabilities, pattern_probabilities + n, 0.0);
+                if (total > 0.0) {
+                    for (std::size_t state = 0; state < n; ++state) {
+                        pattern_probabilities[state] /= total;
+                    }
+                }
+            }
+            std::size_t num_children = nd->num_child_nodes();
+            bool has_internal_child = false;
+            for (auto ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                has_internal_child = has_internal_child || !ch->is_leaf();
+            }
+            if (!has_internal_child) {
+                return;
+            }
+            // messages of the children, their transition probabilities and
+            // the running products of the messages before each child
+            this->child_messages_.resize(num_children * block_size);
+            this->child_pmats_.resize(num_children * num_categories * n * n);
+            this->message_products_.resize(num_children * block_size);
+            std::size_t child_idx = 0;
+            for (auto ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node(), ++child_idx) {
+                double edge_length = this->edge_length_fn_(ch->value());
+                double * pmats = this->child_pmats_.data() + child_idx * num_categories * n * n;
+                for (std::size_t category = 0; category < num_categories; ++category) {
+                    this->model_.transition_probabilities(edge_length * this->category_rates_[category], pmats + category * n * n);
+                }
+                double * message = this->child_messages_.data() + child_idx * block_size;
+                std::fill(message, message + block_size, 1.0);
+                const double * child_partials;
+                std::size_t pattern_stride;
+                std::size_t category_stride;
+                if (ch->is_leaf()) {
+                    child_partials = this->get_tip_partials(ch);
+                    pattern_stride = n;
+                    category_stride = 0;
+                } else {
+                    child_partials = this->partials_.data() + this->get_slot(ch) * this->partial_block_size_;
+                    pattern_stride = num_categories * n;
+                    category_stride = n;
+                }
+                if (n == 4) {
+                    likelihood::detail::multiply_child_partials<4>(message, child_partials, pattern_stride, category_stride,
+                            pmats, this->num_patterns_, num_categories, n);
+                } else {
+                    likelihood::detail::multiply_child_partials<0>(message, child_partials, pattern_stride, category_stride,
+                            pmats, this->num_patterns_, num_categories, n);
+                }
+                double * product = this->message_products_.data() + child_idx * block_size;
+                if (child_idx == 0) {
+                    std::copy(outside, outside + block_size, product);
+                } else {
+                    const double * previous_product = product - block_size;
+                    const double * previous_message = message - block_size;
+                    for (std::size_t idx = 0; idx < block_size; ++idx) {
+                        product[idx] = previous_product[idx] * previous_message[idx];
+                    }
+                }
+            }
+            // back through the children, with the product of the messages after each
+            this->suffix_product_.assign(block_size, 1.0);
+            double * suffix = this->suffix_product_.data();
+            this->children_.clear();
+            for (auto ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                this->children_.push_back(ch);
+            }
+            for (std::size_t idx = num_children; idx > 0; --idx) {
+                const node_type * ch = this->children_[idx - 1];
+                double * product = this->message_products_.data() + (idx - 1) * block_size;
+                if (!ch->is_leaf()) {
+                    for (std::size_t k = 0; k < block_size; ++k) {
+                        product[k] *= suffix[k];
+                    }
+                    double * child_outside = this->outside_partials_.data() + this->get_slot(ch) * this->partial_block_size_;
+                    const double * pmats = this->child_pmats_.data() + (idx - 1) * num_categories * n * n;
+                    for (std::size_t pattern = 0; pattern < this->num_patterns_; ++pattern) {
+                        double max_partial = 0.0;
+                        for (std::size_t category = 0; category < num_categories; ++category) {
+                            const double * pmat = pmats + category * n * n;
+                            std::size_t offset = (pattern * num_categories + category) * n;
+                            const double * in = product + offset;
+                            double * out = child_outside + offset;
+                            for (std::size_t j = 0; j < n; ++j) {
+                                double sum = 0.0;
+                                for (std::size_t i = 0; i < n; ++i) {
+                                    sum += in[i] * pmat[i * n + j];
+                                }
+                                out[j] = sum;
+                                max_partial = std::max(max_partial, sum);
+                            }
+                        }
+                        if (max_partial < scaling_threshold() && max_partial > 0.0) {
+                            double * pattern_partials = child_outside + pattern * num_categories * n;
+                            for (std::size_t k = 0; k < num_categories * n; ++k) {
+                                pattern_partials[k] /= max_partial;
+                            }
+                        }
+                    }
+                }
+                const double * message = this->child_messages_.data() + (idx - 1) * block_size;
+                for (std::size_t k = 0; k < block_size; ++k) {
+                    suffix[k] *= message[k];
+                }
+            }
+        }
+
+        double compute_root_log_likelihood(const TreeT & tree) {
+            const node_type * root = tree.head_node();
+            const std::size_t n = this->num_states_;
+            const std::size_t num_categories = this->category_rates_.size();
+            const std::vector<double> & frequencies = this->model_.frequencies();
+            const double * partials;
+            const double * log_scales = nullptr;
+            std::size_t pattern_stride;
+            std::size_t category_stride;
+            if (root->is_leaf()) {
+                partials = this->get_tip_partials(root);
+                pattern_stride = n;
+                category_stride = 0;
+            } else {
+                std::size_t slot = this->get_slot(root);
+                partials = this->partials_.data() + slot * this->partial_block_size_;
+                log_scales = this->log_scales_.data() + slot * this->num_patterns_;
+                pattern_stride = num_categories * n;
+                category_stride = n;
+            }
+            double log_likelihood = 0.0;
+            for (std::size_t pattern = 0; pattern < this->num_patterns_; ++pattern) {
+                double site_likelihood = 0.0;
+                for (std::size_t category = 0; category < num_categories; ++category) {
+                    const double * pattern_partials = partials + pattern * pattern_stride + category * category_stride;
+                    for (std::size_t state = 0; state < n; ++state) {
+                        site_likelihood += frequencies[state] * pattern_partials[state];
+                    }
+                }
+                double site_log_likelihood = std::log(site_likelihood / num_categories);
+                if (log_scales != nullptr) {
+                    site_log_likelihood += log_scales[pattern];
+                }
+                log_likelihood += this->pattern_weights_[pattern] * site_log_likelihood;
+            }
+            this->log_likelihood_ = log_likelihood;
+            return log_likelihood;
+        }
+
+    private:
+        const matrix_type &                                         matrix_;
+        SubstitutionModel                                           model_;
+        taxon_index_fn_type                                         taxon_index_fn_;
+        edge_length_fn_type                                         edge_length_fn_;
+        std::size_t                                                 num_states_;
+        std::size_t                                                 num_patterns_;
+        std::vector<double>                                         pattern_weights_;
+        std::vector<double>                                         category_rates_;
+        AlignedBuffer<double>                                       tip_partials_;
+        AlignedBuffer<double>                                       partials_;
+        AlignedBuffer<double>                                       log_scales_;
+        std::size_t                                                 partial_block_size_;
+        std::vector<double>                                         pmats_;
+        std::unordered_map<const node_type *, std::size_t>          node_slots_;
+        std::vector<std::pair<unsigned long, const node_type *>>    path_nodes_;
+        double                                                      log_likelihood_;
+        // ancestral states
+        AlignedBuffer<double>                                       outside_partials_;
+        std::vector<double>                                         state_probabilities_;
+        std::vector<double>                                         child_messages_;
+        std::vector<double>                                         child_pmats_;
+        std::vector<double>                                         message_products_;
+        std::vector<double>                                         suffix_product_;
+        std::vector<const node_type *>                              children_;
+
+}; // TreeLikelihood
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,424 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Lineage-through-time curves, accumulated over collections of trees.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_MODEL_LINEAGESTHROUGHTIME_HPP
+#define PLATYPUS_MODEL_LINEAGESTHROUGHTIME_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "datatable.hpp"
+#include "nodeages.hpp"
+#include "../utility/parallel.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// LineagesThroughTime
+
+/**
+ * Accumulates the lineage-through-time (LTT) curves of a collection of
+ * rooted trees with edge lengths in units of time (e.g. a posterior sample
+ * of dated trees) on a common grid of ages, i.e. times before the present,
+ * and summarizes their distribution at each grid age:
+ *
+ *      auto grid = platypus::LineagesThroughTime<TreeType>::uniform_grid(50.0, 201);
+ *      platypus::LineagesThroughTime<TreeType> ltt(
+ *              [](const NodeValue & nv) { return nv.get_edge_length(); }, grid);
+ *      ltt.add_trees(trees.cbegin(), trees.cend(), num_threads);
+ *      platypus::DataTable table;
+ *      ltt.export_table(table, {0.025, 0.975});
+ *
+ * The present is the time of the leaf furthest from the root, so that the
+ * age of a node is the distance from the root of that leaf less its own
+ * (for trees that are not ultrametric, e.g. with extinct lineages, leaves
+ * closer to the root end their lineages before the present). The number
+ * of lineages at age ``t`` is the number of edges that span it, i.e. whose
+ * child is no older than ``t`` and whose parent is older; the (stem)
+ * edge of the root is not counted, so that there are no lineages at or
+ * beyond the age of the root. Ages within the tolerance of NodeAges of the
+ * present are taken to be the present.
+ *
+ * The number of lineages at each grid age is tallied, over all trees, in a
+ * histogram of counts, so that means and quantiles are exact, and merging
+ * accumulators (of threads, or, through their partial states, of shards;
+ * see platypus::PartialStateWriter) is exact and independent of order.
+ *
+ * @tparam TreeT
+ *   Type of tree (platypus::Tree or derived).
+ * @tparam EdgeLengthT
+ *   Type of edge length values.
+ */
+template <class TreeT, class EdgeLengthT=double>
+class LineagesThroughTime {
+
+    public:
+        typedef NodeAges<TreeT, EdgeLengthT>                        node_ages_type;
+        typedef typename node_ages_type::edge_length_getter_type   edge_length_getter_type;
+
+    public:
+
+        /**
+         * @param edge_length_getter
+         *   Returns the edge length of a node value.
+         * @param grid
+         *   The ages at which lineages are counted, in increasing order.
+         */
+        LineagesThroughTime(const edge_length_getter_type & edge_length_getter,
+                const std::vector<double> & grid)
+            : node_ages_(edge_length_getter)
+            , grid_(grid)
+            , histograms_(grid.size())
+            , num_trees_(0) {
+            for (std::size_t idx = 1; idx < this->grid_.size(); ++idx) {
+                if (!(this->grid_[idx - 1] < this->grid_[idx])) {
+                    throw std::invalid_argument("platypus::LineagesThroughTime: grid ages are not increasing");
+                }
+            }
+        }
+
+        // Copies the configuration (edge length getter and grid), but none
+        // of the counts.
+        LineagesThroughTime(const LineagesThroughTime & other, int)
+            : node_ages_(other.node_ages_)
+            , grid_(other.grid_)
+            , histograms_(other.grid_.size())
+            , num_trees_(0) { }
+
+        /**
+         * ``num_points`` ages evenly spaced from the present (0) to
+         * ``max_age`` inclusive.
+         */
+        static std::vector<double> uniform_grid(double max_age, std::size_t num_points) {
+            std::vector<double> grid(num_points);
+            for (std::size_t idx = 0; idx < num_points; ++idx) {
+                grid[idx] = num_points > 1 ? max_age * static_cast<double>(idx) / static_cast<double>(num_points - 1) : 0.0;
+            }
+            return grid;
+        }
+
+        inline const std::vector<double> & grid() const {
+            return this->grid_;
+        }
+
+        inline void set_tolerance(double tolerance) {
+            this->node_ages_.set_tolerance(tolerance);
+        }
+        inline double get_tolerance() const {
+            return this->node_ages_.get_tolerance();
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Single trees
+
+        /**
+         * Computes the number of lineages of ``tree`` at each grid age,
+         * without adding them to the accumulated counts. The result is
+         * valid until the next tree is computed or added.
+         */
+        const std::vector<unsigned long> & compute(const TreeT & tree) {
+            auto summary = this->node_ages_.compute(tree);
+            std::size_t num_grid = this->grid_.size();
+            // each edge adds one lineage over the grid ages in
+            // [child age, parent age): tallied as differences, and summed
+            this->differences_.assign(num_grid + 1, 0L);
+            std::size_t num_nodes = this->node_ages_.num_nodes();
+            this->node_times_.resize(num_nodes);
+            const std::vector<EdgeLengthT> & distances = this->node_ages_.distances_from_root();
+            double present = static_cast<double>(summary.max_root_to_tip);
+            double tolerance = this->node_ages_.get_tolerance() * std::fabs(present);
+            for (std::size_t idx = 0; idx < num_nodes; ++idx) {
+                double age = present - static_cast<double>(distances[idx]);
+                this->node_times_[idx] = age <= tolerance ? 0.0 : age;
+            }
+            const std::vector<typename node_ages_type::index_type> & parents = this->node_ages_.parents();
+            for (std::size_t idx = 1; idx < num_nodes; ++idx) {
+                double child_age = this->node_times_[idx];
+                double parent_age = this->node_times_[parents[idx]];
+                std::size_t begin = static_cast<std::size_t>(std::lower_bound(this->grid_.begin(), this->grid_.end(), child_age) - this->grid_.begin());
+                std::size_t end = static_cast<std::size_t>(std::lower_bound(this->grid_.begin() + begin, this->grid_.end(), parent_age) - this->grid_.begin());
+                if (begin < end) {
+                    ++this->differences_[begin];
+                    --this->differences_[end];
+                }
+            }
+            this->counts_.resize(num_grid);
+            long count = 0;
+            for (std::size_t idx = 0; idx < num_grid; ++idx) {
+                count += this->differences_[idx];
+                this->counts_[idx] = static_cast<unsigned long>(count);
+            }
+            return this->counts_;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Accumulation
+
+        void add_tree(const TreeT & tree) {
+            this->compute(tree);
+            for (std::size_t idx = 0; idx < this->counts_.size(); ++idx) {
+                std::vector<unsigned long> & histogram = this->histograms_[idx];
+                unsigned long count = this->counts_[idx];
+                if (count >= histogram.size()) {
+                    histogram.resize(count + 1, 0);
+                }
+                ++histogram[count];
+            }
+            ++this->num_trees_;
+        }
+
+        /**
+         * Adds the trees in [``trees_begin``, ``trees_end``), divided into
+         * ``num_threads`` contiguous blocks (see resolve_num_threads()) that
+         * are accumulated concurrently, each by a thread-local copy, merged
+         * at the end. The edge length getter is called concurrently.
+         */
+        template <class IterT>
+        void add_trees(IterT trees_begin, IterT trees_end, unsigned int num_threads=1) {
+            std::size_t num_trees = static_cast<std::size_t>(std::distance(trees_begin, trees_end));
+            std::size_t num_blocks = resolve_num_threads(num_threads);
+            if (num_blocks > num_trees) {
+                num_blocks = num_trees;
+            }
+            if (num_blocks <= 1) {
+                for (; trees_begin != trees_end; ++trees_begin) {
+                    this->add_tree(*trees_begin);
+                }
+                return;
+            }
+            std::vector<LineagesThroughTime> block_accumulators(num_blocks, LineagesThroughTime(*this, 0));
+            std::size_t block_size = (num_trees + num_blocks - 1) / num_blocks;
+            parallel_for(num_blocks, static_cast<unsigned int>(num_blocks), [&] (std::size_t block_idx) {
+                std::size_t begin_idx = block_idx * block_size;
+                std::size_t end_idx = std::min(begin_idx + block_size, num_trees);
+                IterT tree_iter = trees_begin;
+                std::advance(tree_iter, begin_idx);
+                for (std::size_t idx = begin_idx; idx < end_idx; ++idx, ++tree_iter) {
+                    block_accumulators[block_idx].add_tree(*tree_iter);
+                }
+            });
+            for (auto & block_accumulator : block_accumulators) {
+                this->merge(block_accumulator);
+            }
+        }
+
+        // Adds the counts of ``other``, which must have the same grid.
+        void merge(const LineagesThroughTime & other) {
+            if (other.grid_ != this->grid_) {
+                throw std::invalid_argument("platypus::LineagesThroughTime: cannot merge counts on different grids");
+            }
+            for (std::size_t idx = 0; idx < this->histograms_.size(); ++idx) {
+                this->merge_histogram(idx, other.histograms_[idx]);
+            }
+            this->num_trees_ += other.num_trees_;
+        }
+
+        void clear() {
+            for (auto & histogram : this->histograms_) {
+                histogram.clear();
+            }
+            this->num_trees_ = 0;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Summaries
+
+        inline unsigned long num_trees() const {
+            return this->num_trees_;
+        }
+
+        /**
+         * Number of trees with ``num_lineages`` lineages at the grid age of
+         * index ``grid_idx``.
+         */
+        inline unsigned long get_count(std::size_t grid_idx, unsigned long num_lineages) const {
+            const std::vector<unsigned long> & histogram = this->histograms_[grid_idx];
+            return num_lineages < histogram.size() ? histogram[num_lineages] : 0;
+        }
+
+        // Mean number of lineages at the grid age of index ``grid_idx``.
+        double get_mean(std::size_t grid_idx) const {
+            if (this->num_trees_ == 0) {
+                return 0.0;
+            }
+            const std::vector<unsigned long> & histogram = this->histograms_[grid_idx];
+            double sum = 0.0;
+            for (std::size_t count = 0; count < histogram.size(); ++count) {
+                sum += static_cast<double>(count) * static_cast<double>(histogram[count]);
+            }
+            return sum / static_cast<double>(this->num_trees_);
+        }
+
+        /**
+         * The ``q`` quantile of the number of lineages at the grid age of
+         * index ``grid_idx`` over the trees added: the least number of
+         * lineages of at least a proportion ``q`` of the trees (so the
+         * lower median for ``q = 0.5``).
+         */
+        unsigned long get_quantile(std::size_t grid_idx, double q) const {
+            const std::vector<unsigned long> & histogram = this->histograms_[grid_idx];
+            double threshold = q * static_cast<double>(this->num_trees_);
+            unsigned long cumulative = 0;
+            for (std::size_t count = 0; count < histogram.size(); ++count) {
+                cumulative += histogram[count];
+                if (cumulative > 0 && static_cast<double>(cumulative) >= threshold) {
+                    return static_cast<unsigned long>(count);
+                }
+            }
+            return histogram.empty() ? 0 : static_cast<unsigned long>(histogram.size() - 1);
+        }
+
+        /**
+         * Appends a row for each grid age to ``table``, with the columns
+         * "age" (a key column), "mean", "median", "min", "max", and one for
+         * each of the ``quantiles`` (named "q" followed by the quantile,
+         * e.g. "q0.025"), all of the number of lineages. If ``table`` has
+         * no columns, they are added first; otherwise it must have these
+         * columns already.
+         */
+        void export_table(DataTable & table, const std::vector<double> & quantiles=std::vector<double>{0.025, 0.975}) const {
+            std::vector<std::string> quantile_names;
+            for (double q : quantiles) {
+                std::ostringstream name;
+                name << "q" << q;
+                quantile_names.push_back(name.str());
+            }
+            if (table.num_columns() == 0) {
+                table.add_key_column<double>("age");
+                table.add_data_column<double>("mean");
+                table.add_data_column<unsigned long>("median");
+                table.add_data_column<unsigned long>("min");
+                table.add_data_column<unsigned long>("max");
+                for (auto & name : quantile_names) {
+                    table.add_data_column<unsigned long>(name);
+                }
+            }
+            auto age_handle = table.column_handle<double>("age");
+            auto mean_handle = table.column_handle<double>("mean");
+            auto median_handle = table.column_handle<unsigned long>("median");
+            auto min_handle = table.column_handle<unsigned long>("min");
+            auto max_handle = table.column_handle<unsigned long>("max");
+            std::vector<decltype(median_handle)> quantile_handles;
+            for (auto & name : quantile_names) {
+                quantile_handles.push_back(table.column_handle<unsigned long>(name));
+            }
+            table.reserve(table.num_rows() + this->grid_.size());
+            for (std::size_t idx = 0; idx < this->grid_.size(); ++idx) {
+                auto & row = table.add_row();
+                row.set(age_handle, this->grid_[idx]);
+                row.set(mean_handle, this->get_mean(idx));
+                row.set(median_handle, this->get_quantile(idx, 0.5));
+                row.set(min_handle, this->get_quantile(idx, 0.0));
+                row.set(max_handle, this->get_quantile(idx, 1.0));
+                for (std::size_t q_idx = 0; q_idx < quantiles.size(); ++q_idx) {
+                    row.set(quantile_handles[q_idx], this->get_quantile(idx, quantiles[q_idx]));
+                }
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Partial state
+
+        /**
+         * The counts of a shard of the trees (see
+         * platypus::save_partial_state()), merged by merge_state() as by
+         * merge(), into an accumulator with the same grid.
+         */
+        static std::string partial_state_kind() {
+            return "LineagesThroughTime";
+        }
+
+        template <class WriterT>
+        void write_state(WriterT & writer) const {
+            writer.write_u64(this->grid_.size());
+            for (double age : this->grid_) {
+                writer.write_f64(age);
+            }
+            writer.write_u64(this->num_trees_);
+            for (auto & histogram : this->histograms_) {
+                writer.write_u64(histogram.size());
+                for (unsigned long count : histogram) {
+                    writer.write_u64(count);
+                }
+            }
+        }
+
+        template <class ReaderT>
+        void merge_state(ReaderT & reader) {
+            std::size_t num_grid = reader.read_count(8);
+            if (num_grid != this->grid_.size()) {
+                reader.fail("grid size differs");
+            }
+            for (std::size_t idx = 0; idx < num_grid; ++idx) {
+                if (reader.read_f64() != this->grid_[idx]) {
+                    reader.fail("grid ages differ");
+                }
+            }
+            unsigned long num_trees = static_cast<unsigned long>(reader.read_u64());
+            std::vector<unsigned long> histogram;
+            for (std::size_t idx = 0; idx < num_grid; ++idx) {
+                histogram.resize(reader.read_count(8));
+                unsigned long total = 0;
+                for (auto & count : histogram) {
+                    count = static_cast<unsigned long>(reader.read_u64());
+                    total += count;
+                }
+                if (total != num_trees) {
+                    reader.fail("lineage counts do not match number of trees");
+                }
+                this->merge_histogram(idx, histogram);
+            }
+            this->num_trees_ += num_trees;
+        }
+
+    private:
+
+        void merge_histogram(std::size_t grid_idx, const std::vector<unsigned long> & other) {
+            std::vector<unsigned long> & histogram = this->histograms_[grid_idx];
+            if (other.size() > histogram.size()) {
+                histogram.resize(other.size(), 0);
+            }
+            for (std::size_t count = 0; count < other.size(); ++count) {
+                histogram[count] += other[count];
+            }
+        }
+
+    private:
+        node_ages_type                              node_ages_;
+        std::vector<double>                         grid_;
+        // for each grid age, the number of trees by number of lineages
+        std::vector<std::vector<unsigned long>>     histograms_;
+        unsigned long                               num_trees_;
+        // scratch, for the last tree
+        std::vector<double>                         node_times_;
+        std::vector<long>                           differences_;
+        std::vector<unsigned long>                  counts_;
+
+}; // LineagesThroughTime
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,225 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       File-backed storage for the slabs of tree node arenas.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_MODEL_MAPPEDNODEARENA_HPP
+#define PLATYPUS_MODEL_MAPPEDNODEARENA_HPP
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "treenodearena.hpp"
+#include "../utility/mappedfile.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedSlabStorage
+
+/**
+ * Source of the slabs of a platypus::TreeNodeArena that maps them from a
+ * scratch file rather than taking them from the heap, so that the nodes of
+ * very large trees are paged out to (and back in from) that file by the
+ * operating system instead of competing for physical memory and swap.
+ *
+ * The scratch file is created in ``directory`` (by default, that named by
+ * the ``TMPDIR`` environment variable, or "/tmp") when the first slab is
+ * requested, and is unlinked immediately, so that it disappears with the
+ * storage (or the process) however that ends. It grows by one
+ * page-aligned region per slab, and is truncated when the arena is
+ * released. Where memory mapping is not available, slabs come from the
+ * heap, as with platypus::HeapSlabStorage.
+ *
+ * Copies start out with no scratch file of their own (but in the same
+ * directory), so that a copied arena never shares slabs.
+ */
+class MappedSlabStorage {
+
+    public:
+
+        MappedSlabStorage()
+            : MappedSlabStorage(MappedSlabStorage::default_directory()) { }
+
+        explicit MappedSlabStorage(const std::string & directory)
+            : directory_(directory)
+            , fd_(-1)
+            , file_size_(0) { }
+
+        MappedSlabStorage(const MappedSlabStorage & other)
+            : directory_(other.directory_)
+            , fd_(-1)
+            , file_size_(0) { }
+
+        MappedSlabStorage(MappedSlabStorage && other) noexcept
+            : directory_(std::move(other.directory_))
+            , fd_(other.fd_)
+            , file_size_(other.file_size_) {
+            other.fd_ = -1;
+            other.file_size_ = 0;
+        }
+
+        // Storage is never shared: assignment leaves the storage as-is.
+        MappedSlabStorage & operator=(const MappedSlabStorage &) {
+            return *this;
+        }
+
+        // Only to be called once all slabs of this storage are deallocated.
+        MappedSlabStorage & operator=(MappedSlabStorage && other) noexcept {
+            if (this != &other) {
+                this->close();
+                this->directory_ = std::move(other.directory_);
+                this->fd_ = other.fd_;
+                this->file_size_ = other.file_size_;
+                other.fd_ = -1;
+                other.file_size_ = 0;
+            }
+            return *this;
+        }
+
+        ~MappedSlabStorage() {
+            this->close();
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Slabs
+
+        void * allocate_slab(std::size_t num_bytes) {
+#if defined(PLATYPUS_HAVE_MMAP)
+            if (this->fd_ < 0) {
+                this->open();
+            }
+            std::size_t mapped_bytes = MappedSlabStorage::page_aligned(num_bytes);
+            if (::ftruncate(this->fd_, static_cast<off_t>(this->file_size_ + mapped_bytes)) != 0) {
+                throw MappedFileError(__FILE__, __LINE__, "Unable to extend node storage file in: '" + this->directory_ + "'");
+            }
+            void * addr = ::mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd_, static_cast<off_t>(this->file_size_));
+            if (addr == MAP_FAILED) {
+                throw MappedFileError(__FILE__, __LINE__, "Unable to map node storage file in: '" + this->directory_ + "'");
+            }
+            this->file_size_ += mapped_bytes;
+            return addr;
+#else
+            return ::operator new(num_bytes);
+#endif
+        }
+
+        void deallocate_slab(void * slab, std::size_t num_bytes) {
+#if defined(PLATYPUS_HAVE_MMAP)
+            ::munmap(slab, MappedSlabStorage::page_aligned(num_bytes));
+#else
+            ::operator delete(slab);
+#endif
+        }
+
+        // Gives the space of the (all deallocated) slabs back to the file
+        // system, keeping the scratch file open for reuse.
+        void release() {
+#if defined(PLATYPUS_HAVE_MMAP)
+            if (this->fd_ >= 0 && this->file_size_ > 0) {
+                if (::ftruncate(this->fd_, 0) != 0) {
+                    throw MappedFileError(__FILE__, __LINE__, "Unable to truncate node storage file in: '" + this->directory_ + "'");
+                }
+            }
+#endif
+            this->file_size_ = 0;
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Metrics
+
+        const std::string & directory() const {
+            return this->directory_;
+        }
+
+        // Current size of the scratch file, in bytes.
+        std::size_t file_size() const {
+            return this->file_size_;
+        }
+
+        static std::string default_directory() {
+            const char * tmpdir = std::getenv("TMPDIR");
+            if (tmpdir != nullptr && tmpdir[0] != '\0') {
+                return tmpdir;
+            }
+            return "/tmp";
+        }
+
+    private:
+
+#if defined(PLATYPUS_HAVE_MMAP)
+        static std::size_t page_aligned(std::size_t num_bytes) {
+            std::size_t page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            return (num_bytes + page_size - 1) / page_size * page_size;
+        }
+
+        void open() {
+            std::string path = this->directory_ + "/platypus-nodes-XXXXXX";
+            std::vector<char> path_template(path.begin(), path.end());
+            path_template.push_back('\0');
+            this->fd_ = ::mkstemp(path_template.data());
+            if (this->fd_ < 0) {
+                throw MappedFileError(__FILE__, __LINE__, "Unable to create node storage file in: '" + this->directory_ + "'");
+            }
+            ::unlink(path_template.data());
+        }
+#endif
+
+        void close() {
+#if defined(PLATYPUS_HAVE_MMAP)
+            if (this->fd_ >= 0) {
+                ::close(this->fd_);
+            }
+#endif
+            this->fd_ = -1;
+            this->file_size_ = 0;
+        }
+
+    private:
+        std::string     directory_;
+        int             fd_;
+        std::size_t     file_size_;
+
+}; // MappedSlabStorage
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedNodeArena
+
+/**
+ * A platypus::TreeNodeArena whose slabs are mapped from a scratch file (see
+ * platypus::MappedSlabStorage), for use as the ``TreeNodeAllocatorT``
+ * parameter of platypus::Tree:
+ *
+ *      typedef platypus::TreeNode<MyValue> NodeType;
+ *      platypus::Tree<MyValue, platypus::MappedNodeArena<NodeType>> tree;
+ *
+ * Nodes are placed in the order in which they are created, so a tree read
+ * by platypus::NewickReader (which creates nodes in preorder) is laid out
+ * in preorder, and preorder traversals touch the file sequentially. With
+ * NewickReader::set_prescan_node_counts(), each tree read from a buffer is
+ * mapped as a single region. Only the nodes themselves are placed in the
+ * file: any heap storage owned by the node values (e.g. the characters of
+ * long std::string labels) is not.
+ */
+template <class T>
+using MappedNodeArena = TreeNodeArena<T, MappedSlabStorage>;
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,387 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Neighbor-joining trees from distance matrices.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_MODEL_NEIGHBORJOINING_HPP
+#define PLATYPUS_MODEL_NEIGHBORJOINING_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include "treedistance.hpp"
+#include "../utility/parallel.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// NeighborJoining
+
+/**
+ * Builds neighbor-joining (Saitou and Nei 1987) trees from matrices of
+ * pairwise distances (e.g., as read by NclDistanceMatrixReader, or as
+ * calculated by PatristicDistances or RobinsonFouldsDistances).
+ *
+ * The pair of nodes to join at each step is found as in RapidNJ (Simonsen,
+ * Mailund and Pedersen 2008): the distances of each row are kept sorted, so
+ * that a row can be abandoned as soon as its distances are too large for
+ * any of its remaining pairs (whatever the net divergence of the other
+ * node) to beat the best pair found so far. The pair selected is exactly
+ * that of the standard algorithm, with ties broken in favor of the pair of
+ * earliest-created nodes, whatever the number of threads used. The
+ * sorted rows take about as much memory again as the working copy of the
+ * matrix.
+ *
+ * The tree produced is unrooted, with a basal trifurcation (if there are
+ * more than two taxa). Negative edge length estimates are set to 0.
+ *
+ * @tparam T
+ *   Type of the working distances (e.g., float, to halve memory use on
+ *   large matrices).
+ */
+template <class T=double>
+class NeighborJoining {
+
+    public:
+        typedef T value_type;
+
+        // minimum number of rows for which the search for the pair to join
+        // is run concurrently
+        static constexpr std::size_t min_parallel_rows() {
+            return 1024;
+        }
+
+    public:
+
+        NeighborJoining()
+            : num_pairs_evaluated_(0) { }
+
+        /**
+         * Builds the neighbor-joining tree of ``distances`` into ``tree``
+         * (which is cleared first), using up to ``num_threads`` threads (see
+         * resolve_num_threads()).
+         *
+         * @param leaf_value_fn
+         *   Called with the value of each leaf node and the (0-based) row of
+         *   ``distances`` it corresponds to.
+         * @param edge_length_setter
+         *   Called with the value of each node other than the head node,
+         *   and the length of the edge subtending it.
+         */
+        template <class TreeT, class DistanceT, class LeafValueFnT, class EdgeLengthSetterT>
+        void build(TreeT & tree,
+                const TriangularMatrix<DistanceT> & distances,
+                LeafValueFnT leaf_value_fn,
+                EdgeLengthSetterT edge_length_setter,
+                unsigned int num_threads=1) {
+            typedef typename TreeT::node_type node_type;
+            num_threads = resolve_num_threads(num_threads);
+            this->num_pairs_evaluated_ = 0;
+            tree.clear();
+            std::size_t num_taxa = distances.size();
+            if (num_taxa == 0) {
+                return;
+            }
+            if (num_taxa > std::numeric_limits<std::uint32_t>::max() / 2) {
+                throw std::invalid_argument("platypus::NeighborJoining: matrix too large");
+            }
+            std::vector<node_type *> slot_nodes(num_taxa);
+            for (std::size_t idx = 0; idx < num_taxa; ++idx) {
+                slot_nodes[idx] = tree.create_leaf_node();
+                leaf_value_fn(slot_nodes[idx]->value(), idx);
+            }
+            if (num_taxa < 3) {
+                T length = num_taxa == 2 ? static_cast<T>(distances.get(0, 1)) / 2 : T(0);
+                for (auto nd : slot_nodes) {
+                    edge_length_setter(nd->value(), std::max(length, T(0)));
+                    tree.head_node()->add_child(nd);
+                }
+                tree.mark_structure_modified();
+                return;
+            }
+            this->initialize(distances, num_threads);
+            while (this->active_slots_.size() > 3) {
+                std::size_t slot_i = 0;
+                std::size_t slot_j = 0;
+                this->find_pair(slot_i, slot_j, num_threads);
+                T length_i = 0;
+                T length_j = 0;
+                this->join(slot_i, slot_j, length_i, length_j);
+                node_type * nd = tree.create_internal_node();
+                edge_length_setter(slot_nodes[slot_i]->value(), length_i);
+                edge_length_setter(slot_nodes[slot_j]->value(), length_j);
+                nd->add_child(slot_nodes[slot_i]);
+                nd->add_child(slot_nodes[slot_j]);
+                slot_nodes[slot_i] = nd;
+                slot_nodes[slot_j] = nullptr;
+            }
+            // the three remaining nodes are joined at the head node
+            std::size_t a = this->active_slots_[0];
+            std::size_t b = this->active_slots_[1];
+            std::size_t c = this->active_slots_[2];
+            T d_ab = this->distances_.get(a, b);
+            T d_ac = this->distances_.get(a, c);
+            T d_bc = this->distances_.get(b, c);
+            edge_length_setter(slot_nodes[a]->value(), std::max(T(0), (d_ab + d_ac - d_bc) / 2));
+            edge_length_setter(slot_nodes[b]->value(), std::max(T(0), (d_ab + d_bc - d_ac) / 2));
+            edge_length_setter(slot_nodes[c]->value(), std::max(T(0), (d_ac + d_bc - d_ab) / 2));
+            std::sort(this->active_slots_.begin(), this->active_slots_.end());
+            for (auto slot : this->active_slots_) {
+                tree.head_node()->add_child(slot_nodes[slot]);
+            }
+            tree.mark_structure_modified();
+            this->release();
+        }
+
+        /**
+         * As above, with each leaf given the taxon index of its row (i.e.,
+         * for a matrix indexed by taxon namespace index, as produced by
+         * PatristicDistances), and lengths set by ``set_edge_length()``, of
+         * node values (e.g., platypus::TaxonNodeValue).
+         */
+        template <class TreeT, class DistanceT>
+        void build(TreeT & tree,
+                const TriangularMatrix<DistanceT> & distances,
+                unsigned int num_threads=1) {
+            typedef typename TreeT::value_type tree_value_type;
+            this->build(tree,
+                    distances,
+                    [] (tree_value_type & nv, std::size_t row) { nv.set_taxon_index(static_cast<TaxonNamespace::index_type>(row)); },
+                    [] (tree_value_type & nv, T length) { nv.set_edge_length(length); },
+                    num_threads);
+        }
+
+        /**
+         * Number of candidate pairs for which the join criterion was
+         * evaluated by the last call to build(), against the ``(n^3 -
+         * n) / 6`` or so of an exhaustive search.
+         */
+        inline unsigned long long get_num_pairs_evaluated() const {
+            return this->num_pairs_evaluated_;
+        }
+
+    private:
+        // A distance in a sorted row, to the node with identifier ``id``.
+        struct RowEntry {
+            T               distance;
+            std::uint32_t   id;
+            inline bool operator<(const RowEntry & other) const {
+                return this->distance < other.distance
+                    || (this->distance == other.distance && this->id < other.id);
+            }
+        };
+
+        // The best pair found by a search of some rows.
+        struct Candidate {
+            T               q;
+            std::uint32_t   lo_id;
+            std::uint32_t   hi_id;
+            std::size_t     slot_i;
+            std::size_t     slot_j;
+            unsigned long long num_evaluated;
+            inline bool is_better(T other_q, std::uint32_t other_lo, std::uint32_t other_hi) const {
+                return other_q < this->q
+                    || (other_q == this->q && (other_lo < this->lo_id || (other_lo == this->lo_id && other_hi < this->hi_id)));
+            }
+        };
+
+        static constexpr std::size_t npos() {
+            return static_cast<std::size_t>(-1);
+        }
+
+        // Nodes occupy slots (the rows of the working matrix); each node
+        // created has a new identifier, so that the entries of sorted rows
+        // referring to nodes since joined are recognized (and skipped).
+        template <class DistanceT>
+        void initialize(const TriangularMatrix<DistanceT> & distances, unsigned int num_threads) {
+            std::size_t num_taxa = distances.size();
+            this->distances_.resize(num_taxa);
+            this->net_divergences_.assign(num_taxa, T(0));
+            this->slot_ids_.resize(num_taxa);
+            this->id_slots_.assign(2 * num_taxa, npos());
+            this->active_slots_.resize(num_taxa);
+            for (std::size_t i = 0; i < num_taxa; ++i) {
+                this->slot_ids_[i] = static_cast<std::uint32_t>(i);
+                this->id_slots_[i] = i;
+                this->active_slots_[i] = i;
+                for (std::size_t j = i + 1; j < num_taxa; ++j) {
+                    T d = static_cast<T>(distances.get(i, j));
+                    this->distances_.set(i, j, d);
+                    this->net_divergences_[i] += d;
+                    this->net_divergences_[j] += d;
+                }
+            }
+            this->next_id_ = static_cast<std::uint32_t>(num_taxa);
+            // each pair of taxa appears in the row of the first only
+            this->rows_.clear();
+            this->rows_.resize(2 * num_taxa);
+            parallel_for(num_taxa, num_taxa >= min_parallel_rows() ? num_threads : 1, [&] (std::size_t i) {
+                std::vector<RowEntry> & row = this->rows_[i];
+                row.reserve(num_taxa - i - 1);
+                for (std::size_t j = i + 1; j < num_taxa; ++j) {
+                    row.push_back(RowEntry{this->distances_.get(i, j), static_cast<std::uint32_t>(j)});
+                }
+                std::sort(row.begin(), row.end());
+            });
+            this->num_active_at_compaction_ = num_taxa;
+        }
+
+        // Finds the active pair minimizing Q(i, j) = d(i, j) - u_i - u_j, where
+        // u_i is the net divergence of i divided by (n - 2).
+        void find_pair(std::size_t & slot_i, std::size_t & slot_j, unsigned int num_threads) {
+            std::size_t num_active = this->active_slots_.size();
+            T scale = T(1) / static_cast<T>(num_active - 2);
+            this->scaled_divergences_.resize(this->distances_.size());
+            T max_u = -std::numeric_limits<T>::max();
+            for (auto slot : this->active_slots_) {
+                T u = this->net_divergences_[slot] * scale;
+                this->scaled_divergences_[slot] = u;
+                max_u = std::max(max_u, u);
+            }
+            std::size_t num_blocks = num_active >= min_parallel_rows() ? std::min<std::size_t>(num_active, 4 * static_cast<std::size_t>(num_threads)) : 1;
+            std::vector<Candidate> candidates(num_blocks, Candidate{std::numeric_limits<T>::infinity(),
+                    std::numeric_limits<std::uint32_t>::max(), std::numeric_limits<std::uint32_t>::max(), npos(), npos(), 0});
+            // rows are interleaved across blocks, as later rows are shorter
+            parallel_for(num_blocks, num_threads, [&] (std::size_t block_idx) {
+                Candidate & best = candidates[block_idx];
+                for (std::size_t pos = block_idx; pos < num_active; pos += num_blocks) {
+                    this->search_row(this->active_slots_[pos], max_u, best);
+                }
+            });
+            Candidate best = candidates[0];
+            this->num_pairs_evaluated_ += best.num_evaluated;
+            for (std::size_t block_idx = 1; block_idx < num_blocks; ++block_idx) {
+                const Candidate & c = candidates[block_idx];
+                this->num_pairs_evaluated_ += c.num_evaluated;
+                if (c.slot_i != npos() && best.is_better(c.q, c.lo_id, c.hi_id)) {
+                    best = c;
+                }
+            }
+            if (best.slot_i == npos()) {
+                throw std::invalid_argument("platypus::NeighborJoining: distances must be finite");
+            }
+            slot_i = best.slot_i;
+            slot_j = best.slot_j;
+        }
+
+        void search_row(std::size_t slot, T max_u, Candidate & best) const {
+            std::uint32_t id = this->slot_ids_[slot];
+            T u = this->scaled_divergences_[slot];
+            for (const RowEntry & entry : this->rows_[id]) {
+                std::size_t other_slot = this->id_slots_[entry.id];
+                if (other_slot == npos()) {
+                    continue;
+                }
+                // no later entry can do better than this bound for any u
+                if (entry.distance - u - max_u > best.q) {
+                    break;
+                }
+                ++best.num_evaluated;
+                T q = entry.distance - u - this->scaled_divergences_[other_slot];
+                std::uint32_t lo_id = std::min(id, entry.id);
+                std::uint32_t hi_id = std::max(id, entry.id);
+                if (best.is_better(q, lo_id, hi_id)) {
+                    best.q = q;
+                    best.lo_id = lo_id;
+                    best.hi_id = hi_id;
+                    best.slot_i = std::min(slot, other_slot);
+                    best.slot_j = std::max(slot, other_slot);
+                }
+            }
+        }
+
+        // Replaces the nodes in ``slot_i`` and ``slot_j`` by a new node
+        // joining them (in ``slot_i``), and sets the lengths of the edges
+        // from the new node to each.
+        void join(std::size_t slot_i, std::size_t slot_j, T & length_i, T & length_j) {
+            std::size_t num_active = this->active_slots_.size();
+            T d_ij = this->distances_.get(slot_i, slot_j);
+            length_i = d_ij / 2 + (this->net_divergences_[slot_i] - this->net_divergences_[slot_j]) / (2 * static_cast<T>(num_active - 2));
+            length_j = d_ij - length_i;
+            length_i = std::max(length_i, T(0));
+            length_j = std::max(length_j, T(0));
+            for (auto slot : {slot_i, slot_j}) {
+                std::uint32_t id = this->slot_ids_[slot];
+                this->id_slots_[id] = npos();
+                std::vector<RowEntry>().swap(this->rows_[id]);
+            }
+            this->active_slots_.erase(std::find(this->active_slots_.begin(), this->active_slots_.end(), slot_j));
+            std::uint32_t new_id = this->next_id_++;
+            this->slot_ids_[slot_i] = new_id;
+            this->id_slots_[new_id] = slot_i;
+            std::vector<RowEntry> & row = this->rows_[new_id];
+            row.reserve(this->active_slots_.size() - 1);
+            T net_divergence = 0;
+            for (auto slot : this->active_slots_) {
+                if (slot == slot_i) {
+                    continue;
+                }
+                T d_im = this->distances_.get(slot_i, slot);
+                T d_jm = this->distances_.get(slot_j, slot);
+                T d = (d_im + d_jm - d_ij) / 2;
+                this->distances_.set(slot_i, slot, d);
+                this->net_divergences_[slot] += d - d_im - d_jm;
+                net_divergence += d;
+                row.push_back(RowEntry{d, this->slot_ids_[slot]});
+            }
+            this->net_divergences_[slot_i] = net_divergence;
+            std::sort(row.begin(), row.end());
+            if (2 * this->active_slots_.size() <= this->num_active_at_compaction_) {
+                this->compact_rows();
+            }
+        }
+
+        // Drops the entries of sorted rows that refer to nodes since joined.
+        void compact_rows() {
+            for (auto slot : this->active_slots_) {
+                std::vector<RowEntry> & row = this->rows_[this->slot_ids_[slot]];
+                row.erase(std::remove_if(row.begin(), row.end(), [this] (const RowEntry & entry) {
+                    return this->id_slots_[entry.id] == npos();
+                }), row.end());
+                row.shrink_to_fit();
+            }
+            this->num_active_at_compaction_ = this->active_slots_.size();
+        }
+
+        void release() {
+            this->distances_.resize(0);
+            std::vector<std::vector<RowEntry>>().swap(this->rows_);
+        }
+
+    private:
+        TriangularMatrix<T>                     distances_;
+        std::vector<T>                          net_divergences_;
+        std::vector<T>                          scaled_divergences_;
+        std::vector<std::uint32_t>              slot_ids_;
+        std::vector<std::size_t>                id_slots_;
+        std::vector<std::size_t>                active_slots_;
+        std::vector<std::vector<RowEntry>>      rows_;
+        std::uint32_t                           next_id_;
+        std::size_t                             num_active_at_compaction_;
+        unsigned long long                      num_pairs_evaluated_;
+
+}; // NeighborJoining
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,423 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Node ages and distances from the root.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+
+#ifndef PLATYPUS_MODEL_NODEAGES_HPP
+#define PLATYPUS_MODEL_NODEAGES_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <vector>
+#include "datatable.hpp"
+#include "../utility/parallel.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// NodeAgeSummary
+
+/**
+ * Summary of the node ages of a single tree, as computed by NodeAges.
+ */
+template <class EdgeLengthT=double>
+struct NodeAgeSummary {
+    unsigned long   num_nodes;
+    unsigned long   num_leaves;
+    // age of the root: the greatest sum of edge lengths between the root
+    // and any leaf
+    EdgeLengthT     root_age;
+    // least and greatest sums of edge lengths between the root and a leaf
+    EdgeLengthT     min_root_to_tip;
+    EdgeLengthT     max_root_to_tip;
+    // whether every leaf is at the same distance from the root, to within
+    // the tolerance of the NodeAges object
+    bool            is_ultrametric;
+}; // NodeAgeSummary
+
+////////////////////////////////////////////////////////////////////////////////
+// NodeAges
+
+/**
+ * Computes the distance from the root (sum of edge lengths from the root)
+ * and the age (greatest sum of edge lengths to any descendent leaf) of
+ * every node of a rooted tree, in one preorder pass and one postorder pass
+ * over an array of the nodes, and checks whether the tree is ultrametric:
+ *
+ *      platypus::NodeAges<TreeType> node_ages(
+ *              [](const NodeValue & nv) { return nv.get_edge_length(); });
+ *      auto summary = node_ages.compute(tree);
+ *      for (std::size_t idx = 0; idx < node_ages.num_nodes(); ++idx) {
+ *          ... node_ages.nodes()[idx] ... node_ages.ages()[idx] ...
+ *      }
+ *
+ * The results for the last tree are held in arrays indexed by the
+ * position of the node in preorder (the head node at 0), and remain valid
+ * until the next call of compute(). For an ultrametric tree, the age of a
+ * node is the age of the root less its distance from the root. The edge
+ * length of the head node is ignored.
+ *
+ * A tree is taken to be ultrametric if the distances from the root of its
+ * leaves differ by no more than ``tolerance`` times the greatest of them.
+ *
+ * The scratch storage of a NodeAges object is reused between trees, so
+ * that the arrays settle at the size of the largest tree. tabulate()
+ * and tabulate_nodes() process streams of trees concurrently, each thread
+ * with its own copy.
+ *
+ * @tparam TreeT
+ *   Type of tree (platypus::Tree or derived).
+ * @tparam EdgeLengthT
+ *   Type of edge length values.
+ */
+template <class TreeT, class EdgeLengthT=double>
+class NodeAges {
+
+    public:
+        typedef typename TreeT::node_type       node_type;
+        typedef typename TreeT::value_type      value_type;
+        typedef NodeAgeSummary<EdgeLengthT>     summary_type;
+        typedef std::uint32_t                   index_type;
+        typedef std::function<EdgeLengthT (const value_type &)> edge_length_getter_type;
+
+    public:
+
+        NodeAges(const edge_length_getter_type & edge_length_getter, double tolerance=1e-6)
+            : edge_length_getter_(edge_length_getter)
+            , tolerance_(tolerance) { }
+
+        NodeAges(const NodeAges & other)
+            : edge_length_getter_(other.edge_length_getter_)
+            , tolerance_(other.tolerance_) { }
+
+        inline double get_tolerance() const {
+            return this->tolerance_;
+        }
+        inline void set_tolerance(double tolerance) {
+            this->tolerance_ = tolerance;
+        }
+
+        /**
+         * Computes the distances from the root and the ages of the nodes of
+         * ``tree``, returning their summary.
+         */
+        summary_type compute(const TreeT & tree) {
+            this->nodes_.clear();
+            this->parents_.clear();
+            this->edge_lengths_.clear();
+            this->distances_from_root_.clear();
+            // preorder: the parent of each node is on the path from the
+            // root to the previous node
+            std::vector<index_type> & path = this->path_;
+            path.clear();
+            for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+                const node_type * nd = ndi.node();
+                index_type idx = static_cast<index_type>(this->nodes_.size());
+                if (path.empty()) {
+                    this->parents_.push_back(npos);
+                    this->edge_lengths_.push_back(EdgeLengthT());
+                    this->distances_from_root_.push_back(EdgeLengthT());
+                } else {
+                    while (this->nodes_[path.back()] != nd->parent_node()) {
+                        path.pop_back();
+                    }
+                    index_type parent_idx = path.back();
+                    EdgeLengthT edge_length = this->edge_length_getter_(nd->value());
+                    this->parents_.push_back(parent_idx);
+                    this->edge_lengths_.push_back(edge_length);
+                    this->distances_from_root_.push_back(this->distances_from_root_[parent_idx] + edge_length);
+                }
+                this->nodes_.push_back(nd);
+                if (!nd->is_leaf()) {
+                    path.push_back(idx);
+                }
+            }
+            summary_type summary;
+            std::size_t n = this->nodes_.size();
+            summary.num_nodes = n;
+            summary.num_leaves = 0;
+            summary.min_root_to_tip = EdgeLengthT();
+            summary.max_root_to_tip = EdgeLengthT();
+            // postorder, by walking the preorder backwards
+            this->ages_.assign(n, EdgeLengthT());
+            for (std::size_t idx = n; idx-- > 0; ) {
+                if (this->nodes_[idx]->is_leaf()) {
+                    EdgeLengthT distance = this->distances_from_root_[idx];
+                    if (summary.num_leaves == 0 || distance < summary.min_root_to_tip) {
+                        summary.min_root_to_tip = distance;
+                    }
+                    if (summary.num_leaves == 0 || distance > summary.max_root_to_tip) {
+                        summary.max_root_to_tip = distance;
+                    }
+                    ++summary.num_leaves;
+                }
+                if (idx > 0) {
+                    index_type parent_idx = this->parents_[idx];
+                    EdgeLengthT age = this->ages_[idx] + this->edge_lengths_[idx];
+                    if (age > this->ages_[parent_idx]) {
+                        this->ages_[parent_idx] = age;
+                    }
+                }
+            }
+            summary.root_age = n > 0 ? this->ages_[0] : EdgeLengthT();
+            summary.is_ultrametric = static_cast<double>(summary.max_root_to_tip - summary.min_root_to_tip)
+                <= this->tolerance_ * std::fabs(static_cast<double>(summary.max_root_to_tip));
+            return summary;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Results of the last tree, by preorder index
+
+        inline std::size_t num_nodes() const {
+            return this->nodes_.size();
+        }
+        inline const std::vector<const node_type *> & nodes() const {
+            return this->nodes_;
+        }
+        // preorder index of the parent of each node (NodeAges::npos for the
+        // head node)
+        inline const std::vector<index_type> & parents() const {
+            return this->parents_;
+        }
+        inline const std::vector<EdgeLengthT> & distances_from_root() const {
+            return this->distances_from_root_;
+        }
+        inline const std::vector<EdgeLengthT> & ages() const {
+            return this->ages_;
+        }
+
+        /**
+         * Passes the age of each node of the last tree to ``age_setter``
+         * (``void f(value_type &, EdgeLengthT)``), for trees whose node
+         * values have a field for it; the tree must not have been changed
+         * since it was computed.
+         */
+        template <class AgeSetterT>
+        void assign_ages(TreeT & tree, AgeSetterT age_setter) const {
+            std::size_t idx = 0;
+            for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi, ++idx) {
+                age_setter(*ndi, this->ages_[idx]);
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Streams of trees
+
+        /**
+         * Appends a row summarizing each tree in [``trees_begin``,
+         * ``trees_end``) (forward iterators) to ``table``, in order. Trees
+         * are processed concurrently by ``num_threads`` threads (see
+         * resolve_num_threads()), in batches, so that only the results of
+         * one batch are held at a time and the range may be as large as
+         * need be. If ``table`` has no columns, they are added first (see
+         * add_columns()); otherwise it must have (at least) the columns
+         * that add_columns() would add, of the same types.
+         */
+        template <class IterT>
+        void tabulate(IterT trees_begin,
+                IterT trees_end,
+                DataTable & table,
+                unsigned int num_threads=1) const {
+            if (table.num_columns() == 0) {
+                add_columns(table);
+            }
+            auto tree_handle = table.column_handle<unsigned long>("tree");
+            auto num_leaves_handle = table.column_handle<unsigned long>("num_leaves");
+            auto root_age_handle = table.column_handle<EdgeLengthT>("root_age");
+            auto min_root_to_tip_handle = table.column_handle<EdgeLengthT>("min_root_to_tip");
+            auto max_root_to_tip_handle = table.column_handle<EdgeLengthT>("max_root_to_tip");
+            auto is_ultrametric_handle = table.column_handle<unsigned long>("is_ultrametric");
+            std::vector<summary_type> batch_summaries;
+            this->process_batches(trees_begin, trees_end, num_threads,
+                    [&batch_summaries] (std::size_t batch_size) {
+                        batch_summaries.resize(batch_size);
+                    },
+                    [&batch_summaries] (NodeAges & node_ages, const TreeT & tree, std::size_t idx) {
+                        batch_summaries[idx] = node_ages.compute(tree);
+                    },
+                    [&] () {
+                        table.reserve(table.num_rows() + batch_summaries.size());
+                        for (auto & summary : batch_summaries) {
+                            unsigned long tree_idx = table.num_rows();
+                            auto & row = table.add_row();
+                            row.set(tree_handle, tree_idx);
+                            row.set(num_leaves_handle, summary.num_leaves);
+                            row.set(root_age_handle, summary.root_age);
+                            row.set(min_root_to_tip_handle, summary.min_root_to_tip);
+                            row.set(max_root_to_tip_handle, summary.max_root_to_tip);
+                            row.set(is_ultrametric_handle, static_cast<unsigned long>(summary.is_ultrametric));
+                        }
+                    });
+        }
+
+        /**
+         * Adds the columns filled by tabulate() to ``table``: "tree" (a key
+         * column, numbering rows from 0 in the order they are added),
+         * followed by one data column for each of the fields of
+         * NodeAgeSummary other than "num_nodes" ("is_ultrametric" as 0 or
+         * 1).
+         */
+        static void add_columns(DataTable & table) {
+            table.add_key_column<unsigned long>("tree");
+            table.add_data_column<unsigned long>("num_leaves");
+            table.add_data_column<EdgeLengthT>("root_age");
+            table.add_data_column<EdgeLengthT>("min_root_to_tip");
+            table.add_data_column<EdgeLengthT>("max_root_to_tip");
+            table.add_data_column<unsigned long>("is_ultrametric");
+        }
+
+        /**
+         * As tabulate(), but appending a row for each node of each tree,
+         * in preorder, with the columns added by add_node_columns(). Trees
+         * are numbered from ``first_tree_idx``.
+         */
+        template <class IterT>
+        void tabulate_nodes(IterT trees_begin,
+                IterT trees_end,
+                DataTable & table,
+                unsigned int num_threads=1,
+                unsigned long first_tree_idx=0) const {
+            if (table.num_columns() == 0) {
+                add_node_columns(table);
+            }
+            auto tree_handle = table.column_handle<unsigned long>("tree");
+            auto node_handle = table.column_handle<unsigned long>("node");
+            auto parent_handle = table.column_handle<long>("parent");
+            auto distance_from_root_handle = table.column_handle<EdgeLengthT>("distance_from_root");
+            auto age_handle = table.column_handle<EdgeLengthT>("age");
+            struct NodeRow {
+                index_type      parent;
+                EdgeLengthT     distance_from_root;
+                EdgeLengthT     age;
+            };
+            std::vector<std::vector<NodeRow>> batch_rows;
+            unsigned long tree_idx = first_tree_idx;
+            this->process_batches(trees_begin, trees_end, num_threads,
+                    [&batch_rows] (std::size_t batch_size) {
+                        batch_rows.resize(batch_size);
+                    },
+                    [&batch_rows] (NodeAges & node_ages, const TreeT & tree, std::size_t idx) {
+                        node_ages.compute(tree);
+                        std::vector<NodeRow> & rows = batch_rows[idx];
+                        rows.resize(node_ages.num_nodes());
+                        for (std::size_t nd_idx = 0; nd_idx < rows.size(); ++nd_idx) {
+                            rows[nd_idx].parent = node_ages.parents_[nd_idx];
+                            rows[nd_idx].distance_from_root = node_ages.distances_from_root_[nd_idx];
+                            rows[nd_idx].age = node_ages.ages_[nd_idx];
+                        }
+                    },
+                    [&] () {
+                        std::size_t num_rows = 0;
+                        for (auto & rows : batch_rows) {
+                            num_rows += rows.size();
+                        }
+                        table.reserve(table.num_rows() + num_rows);
+                        for (auto & rows : batch_rows) {
+                            for (std::size_t nd_idx = 0; nd_idx < rows.size(); ++nd_idx) {
+                                auto & row = table.add_row();
+                                row.set(tree_handle, tree_idx);
+                                row.set(node_handle, static_cast<unsigned long>(nd_idx));
+                                row.set(parent_handle, rows[nd_idx].parent == npos ? -1L : static_cast<long>(rows[nd_idx].parent));
+                                row.set(distance_from_root_handle, rows[nd_idx].distance_from_root);
+                                row.set(age_handle, rows[nd_idx].age);
+                            }
+                            ++tree_idx;
+                        }
+                    });
+        }
+
+        /**
+         * Adds the columns filled by tabulate_nodes() to ``table``: "tree"
+         * and "node" (key columns, numbering trees in order and nodes in
+         * preorder, from 0), "parent" (preorder index of the parent, or -1
+         * for the root), "distance_from_root" and "age".
+         */
+        static void add_node_columns(DataTable & table) {
+            table.add_key_column<unsigned long>("tree");
+            table.add_key_column<unsigned long>("node");
+            table.add_data_column<long>("parent");
+            table.add_data_column<EdgeLengthT>("distance_from_root");
+            table.add_data_column<EdgeLengthT>("age");
+        }
+
+    public:
+        static const index_type npos = static_cast<index_type>(-1);
+
+    private:
+
+        // Runs ``compute_fn(node_ages, tree, idx)`` on the trees of each
+        // batch concurrently (after ``start_fn(batch_size)``), and then
+        // ``finish_fn()`` on the calling thread.
+        template <class IterT, class StartFnT, class ComputeFnT, class FinishFnT>
+        void process_batches(IterT trees_begin,
+                IterT trees_end,
+                unsigned int num_threads,
+                StartFnT start_fn,
+                ComputeFnT compute_fn,
+                FinishFnT finish_fn) const {
+            num_threads = resolve_num_threads(num_threads);
+            std::size_t batch_size = static_cast<std::size_t>(num_threads) * 256;
+            std::vector<IterT> batch_trees;
+            batch_trees.reserve(batch_size);
+            while (trees_begin != trees_end) {
+                batch_trees.clear();
+                for (; trees_begin != trees_end && batch_trees.size() < batch_size; ++trees_begin) {
+                    batch_trees.push_back(trees_begin);
+                }
+                start_fn(batch_trees.size());
+                std::size_t num_blocks = std::min<std::size_t>(num_threads, batch_trees.size());
+                std::size_t block_size = (batch_trees.size() + num_blocks - 1) / num_blocks;
+                parallel_for(num_blocks, num_threads, [&] (std::size_t block_idx) {
+                    NodeAges node_ages(*this);
+                    std::size_t begin_idx = block_idx * block_size;
+                    std::size_t end_idx = std::min(begin_idx + block_size, batch_trees.size());
+                    for (std::size_t idx = begin_idx; idx < end_idx; ++idx) {
+                        compute_fn(node_ages, *batch_trees[idx], idx);
+                    }
+                });
+                finish_fn();
+            }
+        }
+
+    private:
+        edge_length_getter_type                 edge_length_getter_;
+        double                                  tolerance_;
+        // by preorder index
+        std::vector<const node_type *>          nodes_;
+        std::vector<index_type>                 parents_;
+        std::vector<EdgeLengthT>                edge_lengths_;
+        std::vector<EdgeLengthT>                distances_from_root_;
+        std::vector<EdgeLengthT>                ages_;
+        // preorder indexes of the internal nodes on the path from the root
+        std::vector<index_type>                 path_;
+
+}; // NodeAges
+
+template <class TreeT, class EdgeLengthT>
+const typename NodeAges<TreeT, EdgeLengthT>::index_type NodeAges<TreeT, EdgeLengthT>::npos;
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,447 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Typed, columnar store of node metadata (NHX, BEAST annotations).
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_MODEL_NODEATTRIBUTES_HPP
+#define PLATYPUS_MODEL_NODEATTRIBUTES_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+#include "../utility/numberparsing.hpp"
+#include "../utility/tokenizer.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// NodeAttributeTable
+
+/**
+ * Metadata attached to the nodes of a single tree, as key-value pairs in
+ * comments, e.g. (BEAST):
+ *
+ *      [&height=1.2,rate=0.3,height_95%_HPD={0.9,1.6},state="forest"]
+ *
+ * or (NHX):
+ *
+ *      [&&NHX:S=human:D=N]
+ *
+ * Storage is columnar: each attribute (key) has a column holding the values
+ * of all nodes. A value is a list of one (or, for ``{...}``, any number of)
+ * elements, each of which is a number if it can be parsed as one, and text
+ * otherwise. Numbers are parsed directly from the source, and text is
+ * copied into a single buffer per column, so that no strings are allocated
+ * per value.
+ *
+ * Nodes are identified by 0-based index in the order in which they appear
+ * in the tree statement, which is the order in which platypus::NewickReader
+ * creates them (and hence that of a preorder traversal of the tree), with
+ * the root at index 0. Attributes are identified by index in the order in
+ * which they are first encountered.
+ */
+class NodeAttributeTable {
+
+    public:
+        typedef std::uint32_t       index_type;
+        static const index_type npos = std::numeric_limits<index_type>::max();
+
+    public:
+
+        NodeAttributeTable()
+            : num_nodes_(0)
+            , last_attribute_(0) { }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Lifecycle
+
+        /**
+         * Removes all values, but keeps the attributes (so that attribute
+         * indexes remain the same across trees read into a table that is
+         * reused), and the storage allocated.
+         */
+        void clear() {
+            for (auto & column : this->columns_) {
+                column.values.clear();
+                column.elements.clear();
+                column.text.clear();
+                column.current_node = npos;
+            }
+            this->num_nodes_ = 0;
+        }
+
+        // Removes all values and attributes.
+        void reset() {
+            this->columns_.clear();
+            this->num_nodes_ = 0;
+            this->last_attribute_ = 0;
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Attributes
+
+        inline index_type num_attributes() const {
+            return static_cast<index_type>(this->columns_.size());
+        }
+
+        inline const std::string & get_attribute_name(index_type attr_idx) const {
+            return this->columns_[attr_idx].name;
+        }
+
+        /**
+         * Returns the index of the attribute named ``name``, or
+         * NodeAttributeTable::npos if there is no such attribute.
+         */
+        index_type find_attribute(const char * name, std::size_t size) const {
+            for (index_type attr_idx = 0; attr_idx < this->columns_.size(); ++attr_idx) {
+                const std::string & column_name = this->columns_[attr_idx].name;
+                if (column_name.size() == size && std::memcmp(column_name.data(), name, size) == 0) {
+                    return attr_idx;
+                }
+            }
+            return npos;
+        }
+        index_type find_attribute(const std::string & name) const {
+            return this->find_attribute(name.data(), name.size());
+        }
+
+        /**
+         * Returns the index of the attribute named ``name``, adding it if it
+         * does not already exist. Attributes are looked up by a linear scan
+         * (as trees typically carry a handful of attributes), starting with
+         * the one following the attribute last added to, so that keys that
+         * come in the same order on every node are found immediately.
+         */
+        index_type add_attribute(const char * name, std::size_t size) {
+            index_type num_columns = this->num_attributes();
+            for (index_type offset = 0; offset < num_columns; ++offset) {
+                index_type attr_idx = (this->last_attribute_ + 1 + offset) % num_columns;
+                const std::string & column_name = this->columns_[attr_idx].name;
+                if (column_name.size() == size && std::memcmp(column_name.data(), name, size) == 0) {
+                    this->last_attribute_ = attr_idx;
+                    return attr_idx;
+                }
+            }
+            this->columns_.emplace_back();
+            this->columns_.back().name.assign(name, size);
+            this->last_attribute_ = num_columns;
+            return num_columns;
+        }
+        index_type add_attribute(const std::string & name) {
+            return this->add_attribute(name.data(), name.size());
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Values
+
+        /**
+         * Number of nodes in the tree (set by the reader once the tree has
+         * been read); nodes with indexes below this may or may not have
+         * values.
+         */
+        inline index_type num_nodes() const {
+            return this->num_nodes_;
+        }
+        inline void set_num_nodes(index_type num_nodes) {
+            this->num_nodes_ = num_nodes;
+        }
+
+        inline bool has_value(index_type node_idx, index_type attr_idx) const {
+            return this->find_value(node_idx, attr_idx) != nullptr;
+        }
+
+        // Number of elements of the value (0 if the node has no value, or
+        // if the key is given without a value).
+        inline index_type get_num_elements(index_type node_idx, index_type attr_idx) const {
+            const ValueRange * value = this->find_value(node_idx, attr_idx);
+            return value == nullptr ? 0 : value->end - value->begin;
+        }
+
+        inline bool is_number(index_type node_idx, index_type attr_idx, index_type element_idx=0) const {
+            const Element * element = this->find_element(node_idx, attr_idx, element_idx);
+            return element != nullptr && element->is_number;
+        }
+
+        /**
+         * Returns element ``element_idx`` of the value of attribute
+         * ``attr_idx`` for node ``node_idx`` if it is a number, or NaN
+         * otherwise (including if there is no such element).
+         */
+        inline double get_number(index_type node_idx, index_type attr_idx, index_type element_idx=0) const {
+            const Element * element = this->find_element(node_idx, attr_idx, element_idx);
+            if (element == nullptr || !element->is_number) {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+            return element->number;
+        }
+
+        /**
+         * Returns element ``element_idx`` of the value of attribute
+         * ``attr_idx`` for node ``node_idx`` if it is text (without any
+         * enclosing quotes), or an empty view otherwise. The view is valid
+         * until values are next added to the table, or it is cleared.
+         */
+        inline TokenView get_text(index_type node_idx, index_type attr_idx, index_type element_idx=0) const {
+            const Element * element = this->find_element(node_idx, attr_idx, element_idx);
+            if (element == nullptr || element->is_number) {
+                return TokenView();
+            }
+            return TokenView(this->columns_[attr_idx].text.data() + element->text_offset, element->text_size);
+        }
+
+        /**
+         * Returns the first element of the value of attribute ``attr_idx``
+         * for every node, in node index order, with NaN for nodes without a
+         * numeric value.
+         */
+        std::vector<double> get_numbers(index_type attr_idx) const {
+            std::vector<double> numbers(this->num_nodes_, std::numeric_limits<double>::quiet_NaN());
+            for (index_type node_idx = 0; node_idx < this->num_nodes_; ++node_idx) {
+                numbers[node_idx] = this->get_number(node_idx, attr_idx);
+            }
+            return numbers;
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Building
+
+        /**
+         * Starts a new (empty) value of attribute ``attr_idx`` for node
+         * ``node_idx``, replacing any previous one. Elements are then added
+         * to it by append_number() and append_text().
+         */
+        void begin_value(index_type node_idx, index_type attr_idx) {
+            Column & column = this->columns_[attr_idx];
+            if (column.values.size() <= node_idx) {
+                ValueRange absent = {npos, npos};
+                column.values.resize(node_idx + 1, absent);
+            }
+            index_type num_elements = static_cast<index_type>(column.elements.size());
+            ValueRange value = {num_elements, num_elements};
+            column.values[node_idx] = value;
+            column.current_node = node_idx;
+            if (node_idx >= this->num_nodes_) {
+                this->num_nodes_ = node_idx + 1;
+            }
+        }
+
+        void append_number(index_type attr_idx, double number) {
+            Column & column = this->columns_[attr_idx];
+            Element element = {number, 0, 0, true};
+            column.elements.push_back(element);
+            column.values[column.current_node].end = static_cast<index_type>(column.elements.size());
+        }
+
+        void append_text(index_type attr_idx, const char * text, std::size_t size) {
+            Column & column = this->columns_[attr_idx];
+            Element element = {0.0, static_cast<index_type>(column.text.size()), static_cast<index_type>(size), false};
+            column.text.append(text, size);
+            column.elements.push_back(element);
+            column.values[column.current_node].end = static_cast<index_type>(column.elements.size());
+        }
+
+        /**
+         * Parses the text of a comment (without its enclosing brackets) from
+         * ``begin`` to ``end``, adding any key-value pairs in it to the values
+         * of node ``node_idx``. Comments that do not start with '&' are not
+         * metadata, and are ignored.
+         *
+         * @return
+         *   Whether the comment was metadata.
+         */
+        bool parse_comment(index_type node_idx, const char * begin, const char * end) {
+            const char * pos = begin;
+            if (pos == end || *pos != '&') {
+                return false;
+            }
+            ++pos;
+            char separator = ',';
+            if (pos < end && *pos == '&') {
+                // NHX: "&&NHX:key=value:key=value"
+                ++pos;
+                if (end - pos >= 3 && std::memcmp(pos, "NHX", 3) == 0) {
+                    pos += 3;
+                }
+                separator = ':';
+                if (pos < end && *pos == separator) {
+                    ++pos;
+                }
+            }
+            while (pos < end) {
+                pos = skip_spaces(pos, end);
+                const char * key_begin = pos;
+                while (pos < end && *pos != '=' && *pos != separator) {
+                    ++pos;
+                }
+                const char * key_end = trim_spaces(key_begin, pos);
+                if (key_end > key_begin) {
+                    index_type attr_idx = this->add_attribute(key_begin, key_end - key_begin);
+                    this->begin_value(node_idx, attr_idx);
+                    if (pos < end && *pos == '=') {
+                        pos = this->parse_value(attr_idx, pos + 1, end, separator);
+                    }
+                }
+                // move past the separator
+                while (pos < end && *pos != separator) {
+                    ++pos;
+                }
+                if (pos < end) {
+                    ++pos;
+                }
+            }
+            return true;
+        }
+
+    private:
+
+        struct ValueRange {
+            index_type      begin;          // npos if no value
+            index_type      end;
+        };
+
+        struct Element {
+            double          number;
+            index_type      text_offset;
+            index_type      text_size;
+            bool            is_number;
+        };
+
+        struct Column {
+            std::string                 name;
+            std::vector<ValueRange>     values;         // by node index
+            std::vector<Element>        elements;
+            std::string                 text;
+            index_type                  current_node;   // of begin_value()
+        };
+
+        inline const ValueRange * find_value(index_type node_idx, index_type attr_idx) const {
+            if (attr_idx >= this->columns_.size()) {
+                return nullptr;
+            }
+            const Column & column = this->columns_[attr_idx];
+            if (node_idx >= column.values.size() || column.values[node_idx].begin == npos) {
+                return nullptr;
+            }
+            return &column.values[node_idx];
+        }
+
+        inline const Element * find_element(index_type node_idx, index_type attr_idx, index_type element_idx) const {
+            const ValueRange * value = this->find_value(node_idx, attr_idx);
+            if (value == nullptr || element_idx >= value->end - value->begin) {
+                return nullptr;
+            }
+            return &this->columns_[attr_idx].elements[value->begin + element_idx];
+        }
+
+        // Parses the value following '=', which is either a single element,
+        // terminated by ``separator``, or a list of elements enclosed in
+        // braces (and separated by commas), and returns the position
+        // following it.
+        const char * parse_value(index_type attr_idx, const char * pos, const char * end, char separator) {
+            pos = skip_spaces(pos, end);
+            if (pos == end || *pos != '{') {
+                return this->parse_element(attr_idx, pos, end, separator, separator);
+            }
+            // nested lists are flattened
+            unsigned int nesting = 0;
+            while (pos < end) {
+                if (*pos == '{') {
+                    ++nesting;
+                    ++pos;
+                } else if (*pos == '}') {
+                    ++pos;
+                    if (--nesting == 0) {
+                        break;
+                    }
+                } else if (*pos == ',') {
+                    ++pos;
+                } else {
+                    pos = this->parse_element(attr_idx, pos, end, ',', '}');
+                }
+                pos = skip_spaces(pos, end);
+            }
+            return pos;
+        }
+
+        // Parses a single (possibly quoted) element that is terminated by
+        // either of ``stop1`` or ``stop2``, and returns the position of the
+        // terminator (or of ``end``).
+        const char * parse_element(index_type attr_idx, const char * pos, const char * end, char stop1, char stop2) {
+            pos = skip_spaces(pos, end);
+            if (pos < end && (*pos == '"' || *pos == '\'')) {
+                char quote = *pos++;
+                const char * text_begin = pos;
+                while (pos < end && *pos != quote) {
+                    ++pos;
+                }
+                this->append_text(attr_idx, text_begin, pos - text_begin);
+                if (pos < end) {
+                    ++pos;
+                }
+                while (pos < end && *pos != stop1 && *pos != stop2) {
+                    ++pos;
+                }
+                return pos;
+            }
+            const char * element_begin = pos;
+            while (pos < end && *pos != stop1 && *pos != stop2) {
+                ++pos;
+            }
+            const char * element_end = trim_spaces(element_begin, pos);
+            double number = 0.0;
+            if (parse_number(element_begin, element_end, number)) {
+                this->append_number(attr_idx, number);
+            } else {
+                this->append_text(attr_idx, element_begin, element_end - element_begin);
+            }
+            return pos;
+        }
+
+        // Whether all of [begin, end) is a number (stored in ``number``).
+        static inline bool parse_number(const char * begin, const char * end, double & number) {
+            return parse_decimal(begin, end, number);
+        }
+
+        static inline const char * skip_spaces(const char * pos, const char * end) {
+            while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r')) {
+                ++pos;
+            }
+            return pos;
+        }
+
+        static inline const char * trim_spaces(const char * begin, const char * end) {
+            while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r')) {
+                --end;
+            }
+            return end;
+        }
+
+    private:
+        std::vector<Column>     columns_;
+        index_type              num_nodes_;
+        index_type              last_attribute_;
+
+}; // NodeAttributeTable
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,490 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Task-parallel bottom-up and top-down traversal of large trees.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_MODEL_PARALLELTRAVERSAL_HPP
+#define PLATYPUS_MODEL_PARALLELTRAVERSAL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <vector>
+#include "flattree.hpp"
+#include "../utility/parallel.hpp"
+
+namespace platypus {
+
+namespace detail {
+
+// Access to the structure of a (pointer-based) platypus::Tree, whose nodes
+// are identified by pointer.
+template <class TreeT>
+struct ParallelTraversalTraits {
+
+    typedef typename TreeT::node_type * node_handle_type;
+
+    static inline node_handle_type root(const TreeT & tree) {
+        return tree.head_node();
+    }
+
+    static inline unsigned long structure_version(const TreeT & tree) {
+        return tree.structure_version();
+    }
+
+    static inline std::size_t num_children(const TreeT &, node_handle_type nd) {
+        return nd->num_child_nodes();
+    }
+
+    template <class FnT>
+    static void postorder(const TreeT & tree, FnT & fn) {
+        for (auto ndi = tree.postorder_begin(); ndi != tree.postorder_end(); ++ndi) {
+            fn(ndi.node());
+        }
+    }
+
+    template <class FnT>
+    static void subtree_postorder(const TreeT &, node_handle_type subtree_root, FnT & fn) {
+        node_handle_type nd = subtree_root;
+        while (nd->first_child_node() != nullptr) {
+            nd = nd->first_child_node();
+        }
+        while (true) {
+            fn(nd);
+            if (nd == subtree_root) {
+                break;
+            }
+            if (nd->next_sibling_node() != nullptr) {
+                nd = nd->next_sibling_node();
+                while (nd->first_child_node() != nullptr) {
+                    nd = nd->first_child_node();
+                }
+            } else {
+                nd = nd->parent_node();
+            }
+        }
+    }
+
+    template <class FnT>
+    static void subtree_preorder(const TreeT &, node_handle_type subtree_root, FnT & fn) {
+        node_handle_type nd = subtree_root;
+        while (true) {
+            fn(nd);
+            if (nd->first_child_node() != nullptr) {
+                nd = nd->first_child_node();
+                continue;
+            }
+            while (nd != subtree_root && nd->next_sibling_node() == nullptr) {
+                nd = nd->parent_node();
+            }
+            if (nd == subtree_root) {
+                break;
+            }
+            nd = nd->next_sibling_node();
+        }
+    }
+
+}; // ParallelTraversalTraits
+
+// Access to the structure of a platypus::FlatTree, whose nodes are
+// identified by (preorder) index.
+template <class EdgeLengthT>
+struct ParallelTraversalTraits<FlatTree<EdgeLengthT>> {
+
+    typedef FlatTree<EdgeLengthT>           tree_type;
+    typedef typename tree_type::index_type  node_handle_type;
+
+    static inline node_handle_type root(const tree_type & tree) {
+        return tree.root();
+    }
+
+    // A FlatTree has no structure versioning (see ParallelTreeTraversal).
+    static inline unsigned long structure_version(const tree_type &) {
+        return 0;
+    }
+
+    static inline std::size_t num_children(const tree_type & tree, node_handle_type nd) {
+        return tree.num_children(nd);
+    }
+
+    template <class FnT>
+    static void postorder(const tree_type & tree, FnT & fn) {
+        for (auto ndi = tree.postorder_begin(); ndi != tree.postorder_end(); ++ndi) {
+            fn(*ndi);
+        }
+    }
+
+    // Descendents have greater indexes than their ancestors, so a reverse
+    // scan visits every node after all of its descendents.
+    template <class FnT>
+    static void subtree_postorder(const tree_type & tree, node_handle_type subtree_root, FnT & fn) {
+        for (node_handle_type nd = tree.subtree_end(subtree_root); nd-- > subtree_root; ) {
+            fn(nd);
+        }
+    }
+
+    template <class FnT>
+    static void subtree_preorder(const tree_type & tree, node_handle_type subtree_root, FnT & fn) {
+        for (node_handle_type nd = subtree_root; nd < tree.subtree_end(subtree_root); ++nd) {
+            fn(nd);
+        }
+    }
+
+}; // ParallelTraversalTraits
+
+} // namespace detail
+
+////////////////////////////////////////////////////////////////////////////////
+// ParallelTreeTraversal
+
+/**
+ * Visits every node of a (large) tree with a user functor, concurrently
+ * across threads, either bottom-up (each node after all of its
+ * descendents, as in a postorder traversal) or top-down (each node after
+ * all of its ancestors, as in a preorder traversal):
+ *
+ *      platypus::ParallelTreeTraversal<TreeType> traversal(tree, 4096, num_threads);
+ *      traversal.bottom_up([&](TreeType::node_type * nd) {
+ *          ... combine the values of the children of nd into nd ...
+ *      });
+ *
+ * The tree is divided into tasks: every subtree of at most
+ * ``serial_cutoff`` nodes whose parent subtends more is visited as a
+ * whole, serially (in postorder or preorder), by one thread, while each of
+ * the remaining nodes (the "backbone" of the tree, near the root) is a task
+ * of its own. A task becomes ready once the tasks below it (bottom-up) or
+ * above it (top-down) have completed, and ready tasks are taken up by idle
+ * threads. Trees of at most ``serial_cutoff`` nodes, or traversals with a
+ * single thread, are visited serially, without scheduling.
+ *
+ * Nodes are identified by pointer (``TreeT::node_type *``) for a
+ * platypus::Tree and by index for a platypus::FlatTree; the nodes of
+ * FlatTree subtrees visited serially bottom-up are visited in reverse
+ * preorder, which, like postorder, visits every node after its
+ * descendents.
+ *
+ * The division of the tree is computed (with one serial pass over the
+ * tree) on the first traversal, and reused until the structure of the
+ * tree changes (as given by Tree::structure_version()); a FlatTree is not
+ * versioned, so invalidate() must be called if it is reassigned. The
+ * functor must not change the structure of the tree. It is called
+ * concurrently for different nodes, so it must only write to state of its
+ * own node (e.g., its value) or otherwise synchronize; all writes made
+ * while visiting a node are visible when its dependents are visited (see
+ * platypus::Tree for the conditions under which trees may be read
+ * concurrently).
+ *
+ * @tparam TreeT
+ *   platypus::Tree (or derived) or platypus::FlatTree.
+ */
+template <class TreeT>
+class ParallelTreeTraversal {
+
+    public:
+        typedef detail::ParallelTraversalTraits<TreeT>      traits_type;
+        typedef typename traits_type::node_handle_type      node_handle_type;
+        typedef std::uint32_t                               task_index_type;
+
+    public:
+
+        ParallelTreeTraversal(const TreeT & tree,
+                std::size_t serial_cutoff=4096,
+                unsigned int num_threads=0)
+            : tree_(tree)
+            , serial_cutoff_(serial_cutoff)
+            , num_threads_(num_threads)
+            , is_valid_(false)
+            , structure_version_(0) { }
+
+        inline const TreeT & tree() const {
+            return this->tree_;
+        }
+
+        inline std::size_t get_serial_cutoff() const {
+            return this->serial_cutoff_;
+        }
+        inline void set_serial_cutoff(std::size_t serial_cutoff) {
+            this->serial_cutoff_ = serial_cutoff;
+            this->is_valid_ = false;
+        }
+
+        // 0 to use all hardware threads (see resolve_num_threads()).
+        inline unsigned int get_num_threads() const {
+            return this->num_threads_;
+        }
+        inline void set_num_threads(unsigned int num_threads) {
+            this->num_threads_ = num_threads;
+        }
+
+        // Forces the division of the tree to be recomputed on the next traversal.
+        inline void invalidate() {
+            this->is_valid_ = false;
+        }
+
+        inline bool is_current() const {
+            return this->is_valid_ && this->structure_version_ == traits_type::structure_version(this->tree_);
+        }
+
+        // Recomputes the division of the tree into tasks, if out of date.
+        inline void update() {
+            if (!this->is_current()) {
+                this->compute_tasks();
+            }
+        }
+
+        // Number of tasks the tree is divided into.
+        inline std::size_t num_tasks() {
+            this->update();
+            return this->tasks_.size();
+        }
+
+        /**
+         * Calls ``fn(nd)`` for every node ``nd``, each after all of its
+         * descendents.
+         */
+        template <class FnT>
+        void bottom_up(FnT fn) {
+            this->traverse(true, fn);
+        }
+
+        /**
+         * Calls ``fn(nd)`` for every node ``nd``, each after all of its
+         * ancestors.
+         */
+        template <class FnT>
+        void top_down(FnT fn) {
+            this->traverse(false, fn);
+        }
+
+    private:
+
+        struct Task {
+            node_handle_type    root;
+            // if true, the whole subtree of ``root``, otherwise ``root`` alone
+            bool                is_subtree;
+            task_index_type     parent;
+        };
+
+        // A node visited in the postorder pass whose parent is not yet.
+        struct PendingNode {
+            node_handle_type    node;
+            std::size_t         size;
+            task_index_type     task;
+        };
+
+        static constexpr task_index_type npos() {
+            return std::numeric_limits<task_index_type>::max();
+        }
+
+        inline task_index_type add_task(node_handle_type root, bool is_subtree) {
+            Task task;
+            task.root = root;
+            task.is_subtree = is_subtree;
+            task.parent = npos();
+            this->tasks_.push_back(task);
+            return static_cast<task_index_type>(this->tasks_.size() - 1);
+        }
+
+        void compute_tasks() {
+            this->tasks_.clear();
+            std::vector<PendingNode> pending;
+            auto visit = [&] (node_handle_type nd) {
+                std::size_t num_children = traits_type::num_children(this->tree_, nd);
+                std::size_t first = pending.size() - num_children;
+                PendingNode node;
+                node.node = nd;
+                node.size = 1;
+                node.task = npos();
+                for (std::size_t idx = first; idx < pending.size(); ++idx) {
+                    node.size += pending[idx].size;
+                }
+                if (node.size > this->serial_cutoff_) {
+                    node.task = this->add_task(nd, false);
+                    for (std::size_t idx = first; idx < pending.size(); ++idx) {
+                        task_index_type child_task = pending[idx].task;
+                        if (child_task == npos()) {
+                            child_task = this->add_task(pending[idx].node, true);
+                        }
+                        this->tasks_[child_task].parent = node.task;
+                    }
+                }
+                pending.resize(first);
+                pending.push_back(node);
+            };
+            if (this->tree_size() > 0) {
+                traits_type::postorder(this->tree_, visit);
+                if (pending.back().task == npos()) {
+                    this->add_task(pending.back().node, true);
+                }
+            }
+            // child tasks, grouped by parent task, for top-down traversals
+            std::size_t num_tasks = this->tasks_.size();
+            this->child_task_offsets_.assign(num_tasks + 1, 0);
+            for (auto & task : this->tasks_) {
+                if (task.parent != npos()) {
+                    ++this->child_task_offsets_[task.parent + 1];
+                }
+            }
+            for (std::size_t idx = 0; idx < num_tasks; ++idx) {
+                this->child_task_offsets_[idx + 1] += this->child_task_offsets_[idx];
+            }
+            this->child_tasks_.resize(this->child_task_offsets_[num_tasks]);
+            std::vector<std::size_t> next(this->child_task_offsets_.begin(), this->child_task_offsets_.end() - 1);
+            for (std::size_t idx = 0; idx < num_tasks; ++idx) {
+                if (this->tasks_[idx].parent != npos()) {
+                    this->child_tasks_[next[this->tasks_[idx].parent]++] = static_cast<task_index_type>(idx);
+                }
+            }
+            this->is_valid_ = true;
+            this->structure_version_ = traits_type::structure_version(this->tree_);
+        }
+
+        inline std::size_t tree_size() const {
+            return this->tree_size(static_cast<const TreeT *>(nullptr));
+        }
+        template <class T>
+        inline std::size_t tree_size(const T *) const {
+            return 1;
+        }
+        template <class EdgeLengthT>
+        inline std::size_t tree_size(const FlatTree<EdgeLengthT> *) const {
+            return this->tree_.size();
+        }
+
+        template <class FnT>
+        inline void run_task(const Task & task, bool is_bottom_up, FnT & fn) {
+            if (!task.is_subtree) {
+                fn(task.root);
+            } else if (is_bottom_up) {
+                traits_type::subtree_postorder(this->tree_, task.root, fn);
+            } else {
+                traits_type::subtree_preorder(this->tree_, task.root, fn);
+            }
+        }
+
+        template <class FnT>
+        void traverse(bool is_bottom_up, FnT & fn) {
+            if (this->tree_size() == 0) {
+                return;
+            }
+            unsigned int num_threads = resolve_num_threads(this->num_threads_);
+            if (num_threads == 1) {
+                Task task;
+                task.root = traits_type::root(this->tree_);
+                task.is_subtree = true;
+                this->run_task(task, is_bottom_up, fn);
+                return;
+            }
+            this->update();
+            std::size_t num_tasks = this->tasks_.size();
+            if (num_tasks == 1) {
+                this->run_task(this->tasks_[0], is_bottom_up, fn);
+                return;
+            }
+            // tasks whose dependencies have completed, and the number of
+            // outstanding dependencies of each task
+            std::vector<task_index_type> ready;
+            std::vector<std::size_t> num_waiting(num_tasks, 0);
+            ready.reserve(num_tasks);
+            for (std::size_t idx = 0; idx < num_tasks; ++idx) {
+                if (is_bottom_up) {
+                    num_waiting[idx] = this->child_task_offsets_[idx + 1] - this->child_task_offsets_[idx];
+                    if (num_waiting[idx] == 0) {
+                        ready.push_back(static_cast<task_index_type>(idx));
+                    }
+                } else if (this->tasks_[idx].parent == npos()) {
+                    ready.push_back(static_cast<task_index_type>(idx));
+                }
+            }
+            std::size_t num_completed = 0;
+            bool failed = false;
+            std::exception_ptr error;
+            std::mutex mutex;
+            std::condition_variable task_available;
+            auto worker = [&] (std::size_t) {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (true) {
+                    task_available.wait(lock, [&] () {
+                        return failed || num_completed == num_tasks || !ready.empty();
+                    });
+                    if (failed || num_completed == num_tasks) {
+                        return;
+                    }
+                    task_index_type task_idx = ready.back();
+                    ready.pop_back();
+                    lock.unlock();
+                    try {
+                        this->run_task(this->tasks_[task_idx], is_bottom_up, fn);
+                    } catch (...) {
+                        lock.lock();
+                        if (!failed) {
+                            failed = true;
+                            error = std::current_exception();
+                        }
+                        task_available.notify_all();
+                        return;
+                    }
+                    lock.lock();
+                    ++num_completed;
+                    std::size_t num_ready = ready.size();
+                    if (is_bottom_up) {
+                        task_index_type parent = this->tasks_[task_idx].parent;
+                        if (parent != npos() && --num_waiting[parent] == 0) {
+                            ready.push_back(parent);
+                        }
+                    } else {
+                        for (std::size_t idx = this->child_task_offsets_[task_idx]; idx < this->child_task_offsets_[task_idx + 1]; ++idx) {
+                            ready.push_back(this->child_tasks_[idx]);
+                        }
+                    }
+                    if (num_completed == num_tasks) {
+                        task_available.notify_all();
+                    } else if (ready.size() > num_ready + 1) {
+                        task_available.notify_all();
+                    } else if (ready.size() == num_ready + 1) {
+                        task_available.notify_one();
+                    }
+                }
+            };
+            parallel_for(num_threads, num_threads, worker);
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+    private:
+        const TreeT &                   tree_;
+        std::size_t                     serial_cutoff_;
+        unsigned int                    num_threads_;
+        bool                            is_valid_;
+        unsigned long                   structure_version_;
+        // in the order created, i.e. each after all tasks below it
+        std::vector<Task>               tasks_;
+        std::vector<std::size_t>        child_task_offsets_;
+        std::vector<task_index_type>    child_tasks_;
+
+}; // ParallelTreeTraversal
+
+} // namespace platypus
+
+#endif
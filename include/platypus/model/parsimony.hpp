@@ -0,0 +1,414 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Fitch parsimony scores of trees on a character matrix.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_MODEL_PARSIMONY_HPP
+#define PLATYPUS_MODEL_PARSIMONY_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../utility/alignedbuffer.hpp"
+#include "../utility/parallel.hpp"
+#include "charactermatrix.hpp"
+
+namespace platypus {
+
+namespace parsimony { namespace detail {
+
+/**
+ * Fitch's rule at ``num_cells`` sites: ``dest`` is the intersection of the
+ * state sets of ``a`` and ``b`` where that is not empty, and their union
+ * (at a cost of the weight of the site) where it is. ``dest`` may be
+ * either of ``a`` or ``b``.
+ *
+ * The loop is branch-free, and runs over whole, aligned rows (padding has
+ * weight 0), so that compilers vectorize it for the target architecture
+ * (e.g., with AVX2 or NEON) without a scalar tail.
+ */
+template <class StateSetT>
+inline std::uint64_t fitch_join(const StateSetT * a,
+        const StateSetT * b,
+        StateSetT * dest,
+        const std::uint32_t * weights,
+        std::size_t num_cells) {
+    std::uint32_t cost = 0;
+    for (std::size_t idx = 0; idx < num_cells; ++idx) {
+        StateSetT intersection = static_cast<StateSetT>(a[idx] & b[idx]);
+        StateSetT with_union = static_cast<StateSetT>(-static_cast<StateSetT>(intersection == 0));
+        dest[idx] = static_cast<StateSetT>(intersection | ((a[idx] | b[idx]) & with_union));
+        cost += weights[idx] & static_cast<std::uint32_t>(-static_cast<std::int32_t>(intersection == 0));
+    }
+    return cost;
+}
+
+} } // namespace parsimony::detail
+
+////////////////////////////////////////////////////////////////////////////////
+// FitchParsimony
+
+/**
+ * Scores trees by (unordered, weighted) Fitch parsimony on the sites (or
+ * site patterns; see BasicCharacterMatrix::compress_patterns()) of a
+ * character matrix. Nodes with more than two children are resolved by
+ * joining their children's state sets in turn.
+ *
+ * Leaves are matched to rows of the matrix through a taxon index function,
+ * ``TaxonNamespace::index_type f(const value_type &)``, giving the index of
+ * the taxon of a leaf in the namespace of the matrix; leaves whose taxon
+ * has no row are treated as missing data. Leaf rows are used in place, and
+ * the state sets of internal nodes are held in a pool of aligned rows that
+ * is reused across calls, with only as many rows live at a time as there
+ * are pending subtrees in the postorder traversal, so scoring does not
+ * allocate once the pool has grown.
+ *
+ * A single scorer must not be used from multiple threads concurrently;
+ * score_trees() scores trees concurrently, each thread with its own
+ * scratch storage.
+ */
+template <class StateSetT>
+class FitchParsimony {
+
+    public:
+        typedef BasicCharacterMatrix<StateSetT>     matrix_type;
+        typedef StateSetT                           state_set_type;
+
+    public:
+
+        // ``matrix`` must outlive the scorer, and not be modified while in use.
+        FitchParsimony(const matrix_type & matrix)
+            : matrix_(matrix)
+            , row_stride_(matrix.row_stride())
+            , weights_(matrix.row_stride(), 0)
+            , missing_row_(matrix.row_stride(), matrix.get_all_states_set())
+            , pool_data_(nullptr)
+            , num_slots_(0) {
+            for (std::size_t idx = 0; idx < matrix.num_sites(); ++idx) {
+                this->weights_[idx] = matrix.get_pattern_weight(idx);
+            }
+        }
+
+        inline const matrix_type & matrix() const {
+            return this->matrix_;
+        }
+
+        /**
+         * Returns the parsimony score of ``tree``.
+         */
+        template <class TreeT, class TaxonIndexFnT>
+        std::uint64_t score(const TreeT & tree, TaxonIndexFnT taxon_index_fn) {
+            typedef typename TreeT::node_type node_type;
+            // state sets of the subtrees visited but whose parents are not
+            // yet, and the pool rows holding them (npos() for leaf rows)
+            this->pending_sets_.clear();
+            this->pending_slots_.clear();
+            std::uint64_t score = 0;
+            for (auto ndi = tree.postorder_begin(); ndi != tree.postorder_end(); ++ndi) {
+                const node_type * nd = ndi.node();
+                if (nd->is_leaf()) {
+                    this->pending_sets_.push_back(this->get_leaf_row(nd->value(), taxon_index_fn));
+                    this->pending_slots_.push_back(npos());
+                    continue;
+                }
+                std::size_t num_children = nd->num_child_nodes();
+                std::size_t first = this->pending_sets_.size() - num_children;
+                std::size_t slot = this->acquire_slot();
+                // the pool may have been reallocated
+                this->refresh_pending_rows();
+                StateSetT * dest = this->slot_row(slot);
+                score += this->join(this->pending_sets_.data() + first, num_children, dest);
+                for (std::size_t idx = first; idx < this->pending_slots_.size(); ++idx) {
+                    this->release_slot(this->pending_slots_[idx]);
+                }
+                this->pending_sets_.resize(first);
+                this->pending_slots_.resize(first);
+                this->pending_sets_.push_back(dest);
+                this->pending_slots_.push_back(slot);
+            }
+            return score;
+        }
+
+        // As above, with taxa given by ``get_taxon_index()`` of node values
+        // (e.g., platypus::TaxonNodeValue).
+        template <class TreeT>
+        std::uint64_t score(const TreeT & tree) {
+            return this->score(tree, [] (const typename TreeT::value_type & nv) { return nv.get_taxon_index(); });
+        }
+
+        /**
+         * Returns the scores of the trees in [``trees_begin``,
+         * ``trees_end``), scored concurrently on ``num_threads`` threads (see
+         * resolve_num_threads()), so ``taxon_index_fn`` must be safe to call
+         * concurrently.
+         */
+        template <class IterT, class TaxonIndexFnT>
+        std::vector<std::uint64_t> score_trees(IterT trees_begin,
+                IterT trees_end,
+                TaxonIndexFnT taxon_index_fn,
+                unsigned int num_threads=0) const {
+            std::size_t num_trees = static_cast<std::size_t>(std::distance(trees_begin, trees_end));
+            std::vector<std::uint64_t> scores(num_trees);
+            num_threads = resolve_num_threads(num_threads);
+            std::size_t num_blocks = std::min<std::size_t>(num_threads, num_trees);
+            if (num_blocks == 0) {
+                return scores;
+            }
+            std::size_t block_size = (num_trees + num_blocks - 1) / num_blocks;
+            parallel_for(num_blocks, num_threads, [&] (std::size_t block_idx) {
+                FitchParsimony scorer(*this);
+                std::size_t begin_idx = block_idx * block_size;
+                std::size_t end_idx = std::min(begin_idx + block_size, num_trees);
+                IterT tree_iter = trees_begin;
+                std::advance(tree_iter, begin_idx);
+                for (std::size_t idx = begin_idx; idx < end_idx; ++idx, ++tree_iter) {
+                    scores[idx] = scorer.score(*tree_iter, taxon_index_fn);
+                }
+            });
+            return scores;
+        }
+
+    protected:
+
+        static constexpr std::size_t npos() {
+            return std::numeric_limits<std::size_t>::max();
+        }
+
+        template <class NodeValueT, class TaxonIndexFnT>
+        const StateSetT * get_leaf_row(const NodeValueT & nv, TaxonIndexFnT & taxon_index_fn) const {
+            std::size_t row_idx = this->matrix_.find_row(taxon_index_fn(nv));
+            return row_idx == matrix_type::npos() ? this->missing_row_.data() : this->matrix_.row(row_idx);
+        }
+
+        // Joins the state sets of ``num_sets`` subtrees into ``dest``.
+        std::uint64_t join(const StateSetT * const * sets, std::size_t num_sets, StateSetT * dest) const {
+            if (num_sets == 1) {
+                std::copy(sets[0], sets[0] + this->row_stride_, dest);
+                return 0;
+            }
+            std::uint64_t cost = parsimony::detail::fitch_join(sets[0], sets[1], dest, this->weights_.data(), this->row_stride_);
+            for (std::size_t idx = 2; idx < num_sets; ++idx) {
+                cost += parsimony::detail::fitch_join(dest, sets[idx], dest, this->weights_.data(), this->row_stride_);
+            }
+            return cost;
+        }
+
+        std::size_t acquire_slot() {
+            if (!this->free_slots_.empty()) {
+                std::size_t slot = this->free_slots_.back();
+                this->free_slots_.pop_back();
+                return slot;
+            }
+            std::size_t slot = this->num_slots_++;
+            if (this->num_slots_ * this->row_stride_ > this->pool_.size()) {
+                this->pool_.resize(2 * this->num_slots_ * this->row_stride_);
+            }
+            return slot;
+        }
+
+        void release_slot(std::size_t slot) {
+            if (slot != npos()) {
+                this->free_slots_.push_back(slot);
+            }
+        }
+
+        inline StateSetT * slot_row(std::size_t slot) {
+            return this->pool_.data() + slot * this->row_stride_;
+        }
+
+        // Re-derives pointers to pool rows after the pool has grown.
+        void refresh_pending_rows() {
+            if (this->pool_.data() == this->pool_data_) {
+                return;
+            }
+            this->pool_data_ = this->pool_.data();
+            for (std::size_t idx = 0; idx < this->pending_slots_.size(); ++idx) {
+                if (this->pending_slots_[idx] != npos()) {
+                    this->pending_sets_[idx] = this->slot_row(this->pending_slots_[idx]);
+                }
+            }
+        }
+
+        // Copies configuration, but not scratch storage.
+        FitchParsimony(const FitchParsimony & other)
+            : matrix_(other.matrix_)
+            , row_stride_(other.row_stride_)
+            , weights_(other.weights_)
+            , missing_row_(other.missing_row_)
+            , pool_data_(nullptr)
+            , num_slots_(0) { }
+
+    protected:
+        const matrix_type &                 matrix_;
+        std::size_t                         row_stride_;
+        AlignedBuffer<std::uint32_t>        weights_;
+        AlignedBuffer<StateSetT>            missing_row_;
+        AlignedBuffer<StateSetT>            pool_;
+        const StateSetT *                   pool_data_;
+        std::size_t                         num_slots_;
+        std::vector<std::size_t>            free_slots_;
+        std::vector<const StateSetT *>      pending_sets_;
+        std::vector<std::size_t>            pending_slots_;
+
+}; // FitchParsimony
+
+////////////////////////////////////////////////////////////////////////////////
+// IncrementalFitchParsimony
+
+/**
+ * Scores a single tree as FitchParsimony, but keeps the state sets (and
+ * costs) of all internal nodes, so that after a local rearrangement only
+ * the nodes on the paths from the rearranged nodes to the root need be
+ * recomputed (see rescore()).
+ */
+template <class TreeT, class StateSetT>
+class IncrementalFitchParsimony : protected FitchParsimony<StateSetT> {
+
+    public:
+        typedef BasicCharacterMatrix<StateSetT>     matrix_type;
+        typedef typename TreeT::node_type           node_type;
+        typedef typename TreeT::value_type          value_type;
+        typedef std::function<TaxonNamespace::index_type (const value_type &)> taxon_index_fn_type;
+
+    public:
+
+        IncrementalFitchParsimony(const matrix_type & matrix, const taxon_index_fn_type & taxon_index_fn)
+            : FitchParsimony<StateSetT>(matrix)
+            , taxon_index_fn_(taxon_index_fn)
+            , score_(0) { }
+
+        /**
+         * Scores ``tree`` from scratch, keeping the state sets of all of its
+         * internal nodes.
+         */
+        std::uint64_t score(const TreeT & tree) {
+            this->node_slots_.clear();
+            this->slot_costs_.clear();
+            this->free_slots_.clear();
+            this->num_slots_ = 0;
+            for (auto ndi = tree.postorder_begin(); ndi != tree.postorder_end(); ++ndi) {
+                if (!ndi.is_leaf()) {
+                    this->update_node(ndi.node());
+                }
+            }
+            return this->sum_costs(tree);
+        }
+
+        /**
+         * Updates the score of ``tree`` after a change to its structure
+         * (e.g., by Tree::prune_subtree() and Tree::regraft()), given the
+         * internal nodes whose children have changed: for a prune and
+         * regraft, the node that was the grandparent of the pruned subtree
+         * (or its parent, if that was not removed), and the node created by
+         * the regraft; for a move applied (or undone) by
+         * TreeRearrangements, its modified_nodes(). Only these nodes and their ancestors are recomputed,
+         * in order of decreasing depth.
+         *
+         * Nodes removed from the tree since the last call to score() keep
+         * their storage until the next call to score().
+         */
+        std::uint64_t rescore(const TreeT & tree, const std::vector<node_type *> & modified_nodes) {
+            // the union of the paths, deepest nodes first, so that the
+            // children of each node are updated before it
+            this->path_nodes_.clear();
+            for (auto nd : modified_nodes) {
+                std::size_t path_begin = this->path_nodes_.size();
+                for (; nd != nullptr; nd = nd->parent_node()) {
+                    this->path_nodes_.push_back(std::make_pair(0UL, nd));
+                }
+                std::size_t path_length = this->path_nodes_.size() - path_begin;
+                for (std::size_t idx = path_begin; idx < this->path_nodes_.size(); ++idx) {
+                    this->path_nodes_[idx].first = path_length - (idx - path_begin);
+                }
+            }
+            std::sort(this->path_nodes_.begin(), this->path_nodes_.end(),
+                    [] (const std::pair<unsigned long, const node_type *> & a, const std::pair<unsigned long, const node_type *> & b) {
+                        return a.first > b.first || (a.first == b.first && std::less<const node_type *>()(a.second, b.second));
+                    });
+            const node_type * previous = nullptr;
+            for (auto & path_node : this->path_nodes_) {
+                if (path_node.second != previous && !path_node.second->is_leaf()) {
+                    this->update_node(path_node.second);
+                }
+                previous = path_node.second;
+            }
+            return this->sum_costs(tree);
+        }
+
+        inline std::uint64_t get_score() const {
+            return this->score_;
+        }
+
+    private:
+
+        void update_node(const node_type * nd) {
+            auto found = this->node_slots_.find(nd);
+            std::size_t slot;
+            if (found == this->node_slots_.end()) {
+                slot = this->acquire_slot();
+                this->node_slots_.insert(std::make_pair(nd, slot));
+                this->slot_costs_.resize(this->num_slots_, 0);
+            } else {
+                slot = found->second;
+            }
+            this->child_sets_.clear();
+            for (auto ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                if (ch->is_leaf()) {
+                    this->child_sets_.push_back(this->get_leaf_row(ch->value(), this->taxon_index_fn_));
+                } else {
+                    auto ch_found = this->node_slots_.find(ch);
+                    if (ch_found == this->node_slots_.end()) {
+                        throw std::logic_error("platypus::IncrementalFitchParsimony: node has a child that has not been scored");
+                    }
+                    this->child_sets_.push_back(this->slot_row(ch_found->second));
+                }
+            }
+            this->slot_costs_[slot] = this->join(this->child_sets_.data(), this->child_sets_.size(), this->slot_row(slot));
+        }
+
+        std::uint64_t sum_costs(const TreeT & tree) {
+            this->score_ = 0;
+            for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+                if (!ndi.is_leaf()) {
+                    this->score_ += this->slot_costs_[this->node_slots_.at(ndi.node())];
+                }
+            }
+            return this->score_;
+        }
+
+    private:
+        taxon_index_fn_type                                     taxon_index_fn_;
+        std::unordered_map<const node_type *, std::size_t>      node_slots_;
+        std::vector<std::uint64_t>                              slot_costs_;
+        std::vector<const StateSetT *>                          child_sets_;
+        std::vector<std::pair<unsigned long, const node_type *>> path_nodes_;
+        std::uint64_t                                           score_;
+
+}; // IncrementalFitchParsimony
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,538 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Trees that share unchanged subtrees with their copies.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+
+#ifndef PLATYPUS_MODEL_PERSISTENTTREE_HPP
+#define PLATYPUS_MODEL_PERSISTENTTREE_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// PersistentTree
+
+/**
+ * A tree whose copies share structure: copying a tree takes constant time,
+ * with the nodes of the copy shared with those of the original (by
+ * reference count), and editing a tree copies only the nodes on the path
+ * from the root to the edit that are still shared with another tree,
+ * modifying the rest in place. This suits workflows that derive many
+ * variants of a tree, each by a local edit (e.g., exploring the
+ * neighborhood of a tree in a topology search, or simulating along a
+ * tree), where a platypus::Tree would have to be copied in full for each
+ * variant:
+ *
+ *      platypus::PersistentTree<NodeValue> base(tree);  // from a platypus::Tree
+ *      for (auto nd = base.leaf_begin(); nd != base.leaf_end(); ++nd) {
+ *          platypus::PersistentTree<NodeValue> variant(base);
+ *          variant.value(nd).set_edge_length(0.0);
+ *          ...
+ *      }
+ *
+ * As nodes may be shared, they do not link to their parents. Instead,
+ * iterators (preorder, postorder and leaf, with the interface of those of
+ * platypus::Tree) keep the path from the root to the current node, and
+ * it is by this path (the positions of each node among the children of its
+ * parent) that edits are addressed: an iterator over a tree can be used to
+ * edit any tree of the same shape down to the node it refers to (such as a
+ * copy of that tree). Edits invalidate the iterators of the tree edited.
+ *
+ * Each node keeps the number of nodes and leaves in its subtree, which
+ * edits update along the copied path.
+ *
+ * Trees (including ones that share nodes) can be read concurrently, but a
+ * tree must not be copied or destroyed while another is being edited on
+ * another thread, as whether a node is shared is determined by its
+ * reference count.
+ *
+ * @tparam ValueT
+ *   Type of node value.
+ */
+template <class ValueT>
+class PersistentTree {
+
+    public:
+        typedef ValueT value_type;
+
+        class Node {
+            public:
+                inline const value_type & value() const {
+                    return this->value_;
+                }
+                inline bool is_leaf() const {
+                    return this->children_.empty();
+                }
+                inline std::size_t num_child_nodes() const {
+                    return this->children_.size();
+                }
+                inline const Node * child_node(std::size_t idx) const {
+                    return this->children_[idx].get();
+                }
+                // number of nodes (or leaves) in the subtree rooted here
+                inline std::size_t num_nodes() const {
+                    return this->num_nodes_;
+                }
+                inline std::size_t num_leaves() const {
+                    return this->num_leaves_;
+                }
+
+            public:
+                Node(const value_type & value)
+                    : value_(value)
+                    , num_nodes_(1)
+                    , num_leaves_(1) { }
+
+            private:
+                void update_counts() {
+                    if (this->children_.empty()) {
+                        this->num_nodes_ = 1;
+                        this->num_leaves_ = 1;
+                        return;
+                    }
+                    this->num_nodes_ = 1;
+                    this->num_leaves_ = 0;
+                    for (auto & ch : this->children_) {
+                        this->num_nodes_ += ch->num_nodes_;
+                        this->num_leaves_ += ch->num_leaves_;
+                    }
+                }
+
+            private:
+                value_type                          value_;
+                std::vector<std::shared_ptr<Node>>  children_;
+                std::size_t                         num_nodes_;
+                std::size_t                         num_leaves_;
+
+            friend class PersistentTree;
+        }; // Node
+
+        typedef Node node_type;
+
+        /////////////////////////////////////////////////////////////////////////
+        // Iterators
+
+        class base_iterator {
+            public:
+                inline const value_type & operator*() const {
+                    return this->path_.back().node->value();
+                }
+                inline const value_type * operator->() const {
+                    return &(this->path_.back().node->value());
+                }
+                inline const node_type * node() const {
+                    return this->path_.empty() ? nullptr : this->path_.back().node;
+                }
+                inline bool is_leaf() const {
+                    return this->path_.back().node->is_leaf();
+                }
+                inline const node_type * parent_node() const {
+                    return this->path_.size() < 2 ? nullptr : this->path_[this->path_.size() - 2].node;
+                }
+                // number of edges between the root and the current node
+                inline std::size_t depth() const {
+                    return this->path_.size() - 1;
+                }
+                // the position of the current node among the children of its
+                // parent (0 for the root)
+                inline std::size_t child_index() const {
+                    return this->path_.back().child_idx;
+                }
+                inline bool operator==(const base_iterator & other) const {
+                    return this->path_.size() == other.path_.size()
+                        && (this->path_.empty() || this->path_.back().node == other.path_.back().node);
+                }
+                inline bool operator!=(const base_iterator & other) const {
+                    return !(*this == other);
+                }
+
+            protected:
+                struct Frame {
+                    const node_type *   node;
+                    std::uint32_t       child_idx;
+                };
+
+                base_iterator() { }
+                base_iterator(const node_type * root) {
+                    if (root != nullptr) {
+                        this->path_.push_back(Frame{root, 0});
+                    }
+                }
+
+                // Descends to the first leaf, in postorder, below the current
+                // node.
+                void descend() {
+                    while (!this->path_.back().node->is_leaf()) {
+                        this->path_.push_back(Frame{this->path_.back().node->child_node(0), 0});
+                    }
+                }
+
+                // Moves to the next node in preorder.
+                void advance_preorder() {
+                    const node_type * nd = this->path_.back().node;
+                    if (!nd->is_leaf()) {
+                        this->path_.push_back(Frame{nd->child_node(0), 0});
+                        return;
+                    }
+                    while (this->path_.size() > 1) {
+                        std::uint32_t next_idx = this->path_.back().child_idx + 1;
+                        this->path_.pop_back();
+                        const node_type * parent = this->path_.back().node;
+                        if (next_idx < parent->num_child_nodes()) {
+                            this->path_.push_back(Frame{parent->child_node(next_idx), next_idx});
+                            return;
+                        }
+                    }
+                    this->path_.clear();
+                }
+
+            protected:
+                std::vector<Frame>  path_;
+
+            friend class PersistentTree;
+        }; // base_iterator
+
+        class preorder_iterator : public base_iterator {
+            public:
+                preorder_iterator() { }
+                explicit preorder_iterator(const node_type * root)
+                    : base_iterator(root) { }
+                inline preorder_iterator & operator++() {
+                    this->advance_preorder();
+                    return *this;
+                }
+                inline preorder_iterator operator++(int) {
+                    preorder_iterator i = *this;
+                    ++(*this);
+                    return i;
+                }
+        }; // preorder_iterator
+
+        class postorder_iterator : public base_iterator {
+            public:
+                postorder_iterator() { }
+                explicit postorder_iterator(const node_type * root)
+                    : base_iterator(root) {
+                    if (root != nullptr) {
+                        this->descend();
+                    }
+                }
+                inline postorder_iterator & operator++() {
+                    if (this->path_.size() == 1) {
+                        this->path_.clear();
+                        return *this;
+                    }
+                    std::uint32_t next_idx = this->path_.back().child_idx + 1;
+                    this->path_.pop_back();
+                    const node_type * parent = this->path_.back().node;
+                    if (next_idx < parent->num_child_nodes()) {
+                        this->path_.push_back(Frame{parent->child_node(next_idx), next_idx});
+                        this->descend();
+                    }
+                    return *this;
+                }
+                inline postorder_iterator operator++(int) {
+                    postorder_iterator i = *this;
+                    ++(*this);
+                    return i;
+                }
+            private:
+                typedef typename base_iterator::Frame Frame;
+        }; // postorder_iterator
+
+        class leaf_iterator : public base_iterator {
+            public:
+                leaf_iterator() { }
+                explicit leaf_iterator(const node_type * root)
+                    : base_iterator(root) {
+                    if (root != nullptr) {
+                        this->descend();
+                    }
+                }
+                inline leaf_iterator & operator++() {
+                    do {
+                        this->advance_preorder();
+                    } while (!this->path_.empty() && !this->path_.back().node->is_leaf());
+                    return *this;
+                }
+                inline leaf_iterator operator++(int) {
+                    leaf_iterator i = *this;
+                    ++(*this);
+                    return i;
+                }
+        }; // leaf_iterator
+
+        typedef preorder_iterator iterator;
+
+    public:
+
+        /////////////////////////////////////////////////////////////////////////
+        // Lifecycle
+
+        // An empty tree (without even a root).
+        PersistentTree() { }
+
+        // A tree of a single node.
+        explicit PersistentTree(const value_type & value)
+            : root_(std::make_shared<Node>(value)) { }
+
+        /**
+         * A tree with a root of value ``value`` and the given subtrees as
+         * its children (shared with ``children``).
+         */
+        PersistentTree(const value_type & value, const std::vector<PersistentTree> & children)
+            : root_(std::make_shared<Node>(value)) {
+            for (auto & ch : children) {
+                if (ch.root_) {
+                    this->root_->children_.push_back(ch.root_);
+                }
+            }
+            this->root_->update_counts();
+        }
+
+        /**
+         * A copy of the structure and values of ``tree`` (a platypus::Tree
+         * or derived), in one postorder pass.
+         */
+        template <class TreeT, typename = typename std::enable_if<!std::is_same<TreeT, PersistentTree>::value>::type>
+        explicit PersistentTree(const TreeT & tree) {
+            this->assign(tree);
+        }
+
+        template <class TreeT>
+        void assign(const TreeT & tree) {
+            std::vector<std::shared_ptr<Node>> subtrees;
+            for (auto ndi = tree.postorder_begin(); ndi != tree.postorder_end(); ++ndi) {
+                auto nd = std::make_shared<Node>(*ndi);
+                if (!ndi.node()->is_leaf()) {
+                    std::size_t num_children = ndi.node()->num_child_nodes();
+                    auto children_begin = subtrees.end() - static_cast<std::ptrdiff_t>(num_children);
+                    nd->children_.assign(std::make_move_iterator(children_begin), std::make_move_iterator(subtrees.end()));
+                    subtrees.erase(children_begin, subtrees.end());
+                    nd->update_counts();
+                }
+                subtrees.push_back(std::move(nd));
+            }
+            this->root_ = subtrees.empty() ? nullptr : std::move(subtrees.back());
+        }
+
+        /**
+         * Rebuilds ``tree`` (a platypus::Tree or derived) as a copy of
+         * this tree, with the value of the root assigned to its head node.
+         */
+        template <class TreeT>
+        void copy_to(TreeT & tree) const {
+            typedef typename TreeT::node_type tree_node_type;
+            tree.clear();
+            if (!this->root_) {
+                return;
+            }
+            tree.head_node()->value() = this->root_->value();
+            std::vector<tree_node_type *> parents{tree.head_node()};
+            for (auto ndi = ++this->preorder_begin(); ndi != this->preorder_end(); ++ndi) {
+                parents.resize(ndi.depth());
+                tree_node_type * nd = ndi.is_leaf() ? tree.create_leaf_node(*ndi) : tree.create_internal_node(*ndi);
+                parents.back()->add_child(nd);
+                parents.push_back(nd);
+            }
+            tree.mark_structure_modified();
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Metrics and access
+
+        inline bool empty() const {
+            return !this->root_;
+        }
+        inline std::size_t size() const {
+            return this->root_ ? this->root_->num_nodes() : 0;
+        }
+        inline std::size_t num_leaves() const {
+            return this->root_ ? this->root_->num_leaves() : 0;
+        }
+        inline const node_type * root_node() const {
+            return this->root_.get();
+        }
+
+        // The subtree rooted at ``pos``, shared with this tree.
+        PersistentTree subtree(const base_iterator & pos) const {
+            PersistentTree result;
+            result.root_ = this->find(pos);
+            return result;
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Iteration
+
+        inline preorder_iterator preorder_begin() const {
+            return preorder_iterator(this->root_.get());
+        }
+        inline preorder_iterator preorder_end() const {
+            return preorder_iterator();
+        }
+        inline preorder_iterator begin() const {
+            return this->preorder_begin();
+        }
+        inline preorder_iterator end() const {
+            return this->preorder_end();
+        }
+        inline postorder_iterator postorder_begin() const {
+            return postorder_iterator(this->root_.get());
+        }
+        inline postorder_iterator postorder_end() const {
+            return postorder_iterator();
+        }
+        inline leaf_iterator leaf_begin() const {
+            return leaf_iterator(this->root_.get());
+        }
+        inline leaf_iterator leaf_end() const {
+            return leaf_iterator();
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Edits
+        //
+        // Each edit is addressed by an iterator over this tree or over a tree
+        // of the same shape down to the node it refers to, and copies the
+        // nodes on the path to that node that are shared with other trees.
+
+        /**
+         * The value of the node at ``pos``, for modification.
+         */
+        value_type & value(const base_iterator & pos) {
+            return this->own_path(pos).back()->value_;
+        }
+
+        /**
+         * Replaces the subtree rooted at ``pos`` with ``subtree`` (which is
+         * shared, not copied).
+         */
+        void replace_subtree(const base_iterator & pos, const PersistentTree & subtree) {
+            if (!subtree.root_) {
+                throw std::invalid_argument("PersistentTree::replace_subtree(): empty subtree");
+            }
+            if (pos.path_.size() == 1) {
+                this->root_ = subtree.root_;
+                return;
+            }
+            std::vector<Node *> path = this->own_path(pos, 1);
+            path.back()->children_[pos.path_.back().child_idx] = subtree.root_;
+            this->update_counts(path);
+        }
+
+        /**
+         * Adds ``subtree`` (which is shared, not copied) as the last child of
+         * the node at ``pos``.
+         */
+        void add_child(const base_iterator & pos, const PersistentTree & subtree) {
+            if (!subtree.root_) {
+                throw std::invalid_argument("PersistentTree::add_child(): empty subtree");
+            }
+            std::vector<Node *> path = this->own_path(pos);
+            path.back()->children_.push_back(subtree.root_);
+            this->update_counts(path);
+        }
+
+        /**
+         * Removes the subtree rooted at ``pos`` (which must not be the root)
+         * from this tree, returning it. The parent is kept, even if it is
+         * left with a single child or none.
+         */
+        PersistentTree remove_subtree(const base_iterator & pos) {
+            if (pos.path_.size() < 2) {
+                throw std::invalid_argument("PersistentTree::remove_subtree(): cannot remove root");
+            }
+            std::vector<Node *> path = this->own_path(pos, 1);
+            auto & children = path.back()->children_;
+            auto child = children.begin() + pos.path_.back().child_idx;
+            PersistentTree removed;
+            removed.root_ = std::move(*child);
+            children.erase(child);
+            this->update_counts(path);
+            return removed;
+        }
+
+    private:
+
+        // The node at ``pos``, following its path from the root of this tree.
+        std::shared_ptr<Node> find(const base_iterator & pos) const {
+            if (pos.path_.empty() || !this->root_) {
+                throw std::out_of_range("PersistentTree: invalid position");
+            }
+            std::shared_ptr<Node> nd = this->root_;
+            for (std::size_t idx = 1; idx < pos.path_.size(); ++idx) {
+                std::size_t child_idx = pos.path_[idx].child_idx;
+                if (child_idx >= nd->children_.size()) {
+                    throw std::out_of_range("PersistentTree: invalid position");
+                }
+                nd = nd->children_[child_idx];
+            }
+            return nd;
+        }
+
+        // The nodes on the path from the root to ``pos`` (less the last
+        // ``num_excluded``), each copied first if it is shared.
+        std::vector<Node *> own_path(const base_iterator & pos, std::size_t num_excluded=0) {
+            if (pos.path_.size() <= num_excluded || !this->root_) {
+                throw std::out_of_range("PersistentTree: invalid position");
+            }
+            std::size_t path_size = pos.path_.size() - num_excluded;
+            std::vector<Node *> path;
+            path.reserve(path_size);
+            std::shared_ptr<Node> * link = &this->root_;
+            for (std::size_t idx = 0; idx < path_size; ++idx) {
+                if (idx > 0) {
+                    std::size_t child_idx = pos.path_[idx].child_idx;
+                    if (child_idx >= path.back()->children_.size()) {
+                        throw std::out_of_range("PersistentTree: invalid position");
+                    }
+                    link = &path.back()->children_[child_idx];
+                }
+                if (link->use_count() > 1) {
+                    *link = std::make_shared<Node>(**link);
+                }
+                path.push_back(link->get());
+            }
+            return path;
+        }
+
+        void update_counts(const std::vector<Node *> & path) {
+            for (auto nd = path.rbegin(); nd != path.rend(); ++nd) {
+                (*nd)->update_counts();
+            }
+        }
+
+    private:
+        std::shared_ptr<Node>   root_;
+
+}; // PersistentTree
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,359 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Simulation of character data along trees.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_MODEL_SEQUENCESIMULATOR_HPP
+#define PLATYPUS_MODEL_SEQUENCESIMULATOR_HPP
+
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../numeric/rng.hpp"
+#include "../utility/instrumentation.hpp"
+#include "../utility/parallel.hpp"
+#include "charactermatrix.hpp"
+#include "likelihood.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// SequenceSimulator
+
+/**
+ * Simulates alignments along trees under a SubstitutionModel with
+ * (optionally) discrete-gamma distributed rates across sites, in the manner
+ * of Seq-Gen, into a BasicCharacterMatrix with a row for each leaf (e.g., to
+ * be written with CharacterMatrixWriter, or scored directly).
+ *
+ * The states at the root are drawn from the stationary frequencies, and
+ * those of each other node, in preorder, from the transition probabilities
+ * along the edge from its parent. The cumulative transition probabilities
+ * of an edge are computed once for each distinct edge length in the tree,
+ * and the states of all sites below an edge are drawn in a single pass
+ * over a block of uniform deviates. Only the states of nodes with children
+ * still to be visited are kept, so storage grows with the depth of the
+ * tree rather than its size.
+ *
+ * @tparam TreeT
+ *   A platypus::Tree specialization.
+ * @tparam StateSetT
+ *   State set type of the matrices produced.
+ * @tparam RngT
+ *   Random number generator type.
+ */
+template <class TreeT, class StateSetT=std::uint8_t, class RngT=platypus::numeric::RandomNumberGenerator>
+class SequenceSimulator {
+
+    public:
+        typedef BasicCharacterMatrix<StateSetT>                     matrix_type;
+        typedef typename TreeT::node_type                           node_type;
+        typedef typename TreeT::value_type                          value_type;
+        typedef std::function<std::string (const value_type &)>     label_fn_type;
+        typedef std::function<double (const value_type &)>          edge_length_fn_type;
+        typedef std::function<void (const matrix_type &, unsigned long)> matrix_sink_fntype;
+
+    public:
+
+        /**
+         * @param rng
+         *   Random number generator used by simulate().
+         * @param model
+         *   Substitution model.
+         * @param alphabet
+         *   States of the matrices produced: must have as many states as
+         *   ``model``.
+         * @param label_fn
+         *   Label of the taxon of a leaf.
+         * @param edge_length_fn
+         *   Length of the edge subtending a node, in expected substitutions
+         *   per site.
+         */
+        SequenceSimulator(RngT & rng,
+                const SubstitutionModel & model,
+                const CharacterStateAlphabet & alphabet,
+                const label_fn_type & label_fn,
+                const edge_length_fn_type & edge_length_fn,
+                unsigned int num_rate_categories=1,
+                double gamma_shape=1.0)
+            : rng_ptr_(&rng)
+            , model_(model)
+            , alphabet_(alphabet)
+            , label_fn_(label_fn)
+            , edge_length_fn_(edge_length_fn)
+            , category_rates_(discrete_gamma_rates(gamma_shape, num_rate_categories))
+            , num_slots_(0) {
+            if (alphabet.num_states() != model.num_states()) {
+                throw std::invalid_argument("platypus::SequenceSimulator: number of states of alphabet and model differ");
+            }
+            if (alphabet.num_states() > 8 * sizeof(StateSetT)) {
+                throw std::invalid_argument("platypus::SequenceSimulator: too many states for state set type");
+            }
+        }
+
+        void set_rate_categories(unsigned int num_rate_categories, double gamma_shape) {
+            this->category_rates_ = discrete_gamma_rates(gamma_shape, num_rate_categories);
+        }
+
+        inline const std::vector<double> & category_rates() const {
+            return this->category_rates_;
+        }
+
+        inline const SubstitutionModel & model() const {
+            return this->model_;
+        }
+
+        inline const CharacterStateAlphabet & alphabet() const {
+            return this->alphabet_;
+        }
+
+        /**
+         * Replaces the contents of ``matrix`` (see
+         * BasicCharacterMatrix::clear()) with ``num_sites`` sites simulated
+         * along ``tree``, with rows in the (preorder) order of the leaves.
+         */
+        void simulate(const TreeT & tree, std::size_t num_sites, matrix_type & matrix) {
+            const std::size_t n = this->model_.num_states();
+            const std::size_t num_categories = this->category_rates_.size();
+            RngT & rng = *this->rng_ptr_;
+            matrix.clear();
+            matrix.set_num_sites(num_sites);
+            this->uniforms_.resize(num_sites);
+            // rate categories of sites
+            this->site_categories_.assign(num_sites, 0);
+            if (num_categories > 1) {
+                rng.fill_uniform(this->uniforms_.data(), num_sites);
+                for (std::size_t site = 0; site < num_sites; ++site) {
+                    std::size_t category = static_cast<std::size_t>(this->uniforms_[site] * num_categories);
+                    this->site_categories_[site] = static_cast<std::uint32_t>(category < num_categories ? category : num_categories - 1);
+                }
+            }
+            // cumulative stationary frequencies, as a single "category"
+            this->cumulative_.assign(n, 0.0);
+            double total = 0.0;
+            for (std::size_t state = 0; state < n; ++state) {
+                total += this->model_.frequencies()[state];
+                this->cumulative_[state] = total;
+            }
+            this->edge_tables_.clear();
+            this->node_slots_.clear();
+            this->free_slots_.clear();
+            this->num_slots_ = 0;
+            std::size_t root_slot = this->acquire_slot(num_sites);
+            rng.fill_uniform(this->uniforms_.data(), num_sites);
+            std::uint8_t * root_states = this->slot_states(root_slot, num_sites);
+            for (std::size_t site = 0; site < num_sites; ++site) {
+                root_states[site] = draw_state(this->cumulative_.data(), n, this->uniforms_[site]);
+            }
+            const node_type * head = tree.head_node();
+            if (head->is_leaf()) {
+                this->add_leaf_row(head, root_states, num_sites, matrix);
+                return;
+            }
+            this->node_slots_.insert(std::make_pair(head, root_slot));
+            for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+                const node_type * nd = ndi.node();
+                if (nd == head) {
+                    continue;
+                }
+                const node_type * parent = nd->parent_node();
+                std::size_t parent_slot = this->node_slots_.at(parent);
+                std::size_t table_offset = this->get_edge_table(this->edge_length_fn_(nd->value()));
+                std::size_t slot = this->acquire_slot(num_sites);
+                rng.fill_uniform(this->uniforms_.data(), num_sites);
+                const std::uint8_t * parent_states = this->slot_states(parent_slot, num_sites);
+                std::uint8_t * states = this->slot_states(slot, num_sites);
+                const double * tables = this->cumulative_.data() + table_offset;
+                const std::uint32_t * categories = this->site_categories_.data();
+                const double * uniforms = this->uniforms_.data();
+                for (std::size_t site = 0; site < num_sites; ++site) {
+                    const double * row = tables + (categories[site] * n + parent_states[site]) * n;
+                    states[site] = draw_state(row, n, uniforms[site]);
+                }
+                if (nd->next_sibling_node() == nullptr) {
+                    // all children of the parent visited
+                    this->node_slots_.erase(parent);
+                    this->free_slots_.push_back(parent_slot);
+                }
+                if (nd->is_leaf()) {
+                    this->add_leaf_row(nd, states, num_sites, matrix);
+                    this->free_slots_.push_back(slot);
+                } else {
+                    this->node_slots_.insert(std::make_pair(nd, slot));
+                }
+            }
+        }
+
+        /**
+         * Simulates an alignment of ``num_sites`` sites on each of the trees
+         * in [``trees_begin``, ``trees_end``), distributing the work across
+         * ``num_threads`` threads (0 = one per hardware thread), and passes
+         * each alignment and the index of its tree to ``matrix_sink`` in
+         * index order, from the calling thread (e.g., to write them to a
+         * single stream with a CharacterMatrixWriter).
+         *
+         * As with BasicCoalescentSimulator::generate_batch(), each replicate
+         * is simulated with its own random number generator created from
+         * ``master_seed`` and the tree index, so the alignments produced do
+         * not depend on the number of threads. Alignments are built in
+         * (re-used) matrices owned by this function, whose taxa are added to
+         * ``taxon_namespace`` (or, if null, a namespace shared by the
+         * matrices), so ``matrix_sink`` must copy anything it wants to keep.
+         *
+         * @return
+         *   The number of alignments simulated.
+         */
+        template <class IterT>
+        unsigned long simulate_batch(IterT trees_begin,
+                IterT trees_end,
+                std::size_t num_sites,
+                unsigned int num_threads,
+                const matrix_sink_fntype & matrix_sink,
+                std::uint64_t master_seed,
+                TaxonNamespace * taxon_namespace=nullptr) {
+            std::vector<IterT> trees;
+            for (; trees_begin != trees_end; ++trees_begin) {
+                trees.push_back(trees_begin);
+            }
+            unsigned long num_trees = trees.size();
+            if (num_trees == 0) {
+                return 0;
+            }
+            num_threads = resolve_num_threads(num_threads);
+            unsigned long batch_size = static_cast<unsigned long>(num_threads) * 16;
+            matrix_type prototype(this->alphabet_, taxon_namespace);
+            std::vector<matrix_type> matrices(batch_size < num_trees ? batch_size : num_trees, prototype);
+            for (unsigned long batch_start = 0; batch_start < num_trees; batch_start += batch_size) {
+                unsigned long batch_end = batch_start + batch_size;
+                if (batch_end > num_trees) {
+                    batch_end = num_trees;
+                }
+                parallel_for(batch_end - batch_start, num_threads, [&] (std::size_t task_idx) {
+                    RngT rng = platypus::numeric::ReplicateRandomNumberGenerator<RngT>::create(
+                            master_seed, batch_start + task_idx);
+                    SequenceSimulator replicate_simulator(rng, *this);
+                    replicate_simulator.simulate(*trees[batch_start + task_idx], num_sites, matrices[task_idx]);
+                });
+                for (unsigned long idx = batch_start; idx < batch_end; ++idx) {
+                    matrix_sink(matrices[idx - batch_start], idx);
+                }
+            }
+            return num_trees;
+        }
+
+    private:
+
+        // Copies the configuration of ``other``, with a different generator.
+        SequenceSimulator(RngT & rng, const SequenceSimulator & other)
+            : rng_ptr_(&rng)
+            , model_(other.model_)
+            , alphabet_(other.alphabet_)
+            , label_fn_(other.label_fn_)
+            , edge_length_fn_(other.edge_length_fn_)
+            , category_rates_(other.category_rates_)
+            , num_slots_(0) { }
+
+        // The number of cumulative probabilities in ``row`` not above ``u``
+        // (the last, 1, is not needed).
+        static inline std::uint8_t draw_state(const double * row, std::size_t n, double u) {
+            std::uint8_t state = 0;
+            for (std::size_t j = 0; j + 1 < n; ++j) {
+                state = static_cast<std::uint8_t>(state + (u >= row[j]));
+            }
+            return state;
+        }
+
+        // Returns the offset in cumulative_ of the tables of cumulative
+        // transition probabilities (one per category) of an edge.
+        std::size_t get_edge_table(double edge_length) {
+            auto found = this->edge_tables_.find(edge_length);
+            if (found != this->edge_tables_.end()) {
+                return found->second;
+            }
+            const std::size_t n = this->model_.num_states();
+            const std::size_t num_categories = this->category_rates_.size();
+            std::size_t offset = this->cumulative_.size();
+            this->cumulative_.resize(offset + num_categories * n * n);
+            for (std::size_t category = 0; category < num_categories; ++category) {
+                double * pmat = this->cumulative_.data() + offset + category * n * n;
+                this->model_.transition_probabilities(edge_length * this->category_rates_[category], pmat);
+                for (std::size_t i = 0; i < n; ++i) {
+                    double total = 0.0;
+                    for (std::size_t j = 0; j < n; ++j) {
+                        total += pmat[i * n + j];
+                        pmat[i * n + j] = total;
+                    }
+                }
+            }
+            this->edge_tables_.insert(std::make_pair(edge_length, offset));
+            return offset;
+        }
+
+        std::size_t acquire_slot(std::size_t num_sites) {
+            if (!this->free_slots_.empty()) {
+                std::size_t slot = this->free_slots_.back();
+                this->free_slots_.pop_back();
+                return slot;
+            }
+            std::size_t slot = this->num_slots_++;
+            if (this->num_slots_ * num_sites > this->states_.size()) {
+                this->states_.resize(2 * this->num_slots_ * num_sites);
+            }
+            return slot;
+        }
+
+        inline std::uint8_t * slot_states(std::size_t slot, std::size_t num_sites) {
+            return this->states_.data() + slot * num_sites;
+        }
+
+        void add_leaf_row(const node_type * nd, const std::uint8_t * states, std::size_t num_sites, matrix_type & matrix) {
+            std::size_t row_idx = matrix.add_row(matrix.taxon_namespace().add_taxon(this->label_fn_(nd->value())));
+            StateSetT * row = matrix.row(row_idx);
+            for (std::size_t site = 0; site < num_sites; ++site) {
+                row[site] = static_cast<StateSetT>(StateSetT(1) << states[site]);
+            }
+        }
+
+    private:
+        RngT *                                          rng_ptr_;
+        SubstitutionModel                               model_;
+        CharacterStateAlphabet                          alphabet_;
+        label_fn_type                                   label_fn_;
+        edge_length_fn_type                             edge_length_fn_;
+        std::vector<double>                             category_rates_;
+        // scratch storage
+        std::vector<double>                             uniforms_;
+        std::vector<std::uint32_t>                      site_categories_;
+        std::vector<double>                             cumulative_;
+        std::unordered_map<double, std::size_t>         edge_tables_;
+        std::vector<std::uint8_t>                       states_;
+        std::unordered_map<const node_type *, std::size_t> node_slots_;
+        std::vector<std::size_t>                        free_slots_;
+        std::size_t                                     num_slots_;
+
+}; // SequenceSimulator
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,658 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Taxon bitmask (split, or bipartition) encoding of trees.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_MODEL_SPLIT_HPP
+#define PLATYPUS_MODEL_SPLIT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../base/exception.hpp"
+#include "../utility/bitops.hpp"
+#include "taxonnamespace.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// SplitError
+
+class SplitError : public PlatypusException {
+    public:
+        SplitError(
+                    const std::string & filename,
+                    unsigned long line_num,
+                    const std::string & message)
+            : PlatypusException(filename, line_num, message) { }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Split word operations
+
+/**
+ * Operations on taxon bitmasks given as arrays of ``num_words`` 64-bit words,
+ * with taxon ``i`` at bit ``i % 64`` of word ``i / 64``, shared by
+ * platypus::Split and platypus::SplitSet. The loops are over whole words,
+ * without branches, so that they can be vectorized by the compiler.
+ */
+namespace split_words {
+
+typedef std::uint64_t word_type;
+
+static const std::size_t bits_per_word = 64;
+
+inline std::size_t num_words(std::size_t num_taxa) {
+    return (num_taxa + bits_per_word - 1) / bits_per_word;
+}
+
+// Mask of the bits of the last word that correspond to taxa.
+inline word_type last_word_mask(std::size_t num_taxa) {
+    std::size_t num_bits = num_taxa % bits_per_word;
+    return num_bits == 0 ? ~word_type(0) : ((word_type(1) << num_bits) - 1);
+}
+
+using bitops::popcount;
+using bitops::lowest_bit;
+
+inline std::size_t count(const word_type * a, std::size_t num_words) {
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < num_words; ++i) {
+        n += popcount(a[i]);
+    }
+    return n;
+}
+
+inline void bitwise_or(word_type * dest, const word_type * src, std::size_t num_words) {
+    for (std::size_t i = 0; i < num_words; ++i) {
+        dest[i] |= src[i];
+    }
+}
+
+inline void bitwise_and(word_type * dest, const word_type * src, std::size_t num_words) {
+    for (std::size_t i = 0; i < num_words; ++i) {
+        dest[i] &= src[i];
+    }
+}
+
+inline void bitwise_xor(word_type * dest, const word_type * src, std::size_t num_words) {
+    for (std::size_t i = 0; i < num_words; ++i) {
+        dest[i] ^= src[i];
+    }
+}
+
+// Complements the taxa of ``a`` (bits beyond ``num_taxa`` remain unset).
+inline void complement(word_type * a, std::size_t num_taxa) {
+    std::size_t nw = num_words(num_taxa);
+    for (std::size_t i = 0; i < nw; ++i) {
+        a[i] = ~a[i];
+    }
+    if (nw > 0) {
+        a[nw - 1] &= last_word_mask(num_taxa);
+    }
+}
+
+inline bool equal(const word_type * a, const word_type * b, std::size_t num_words) {
+    return num_words == 0 || std::memcmp(a, b, num_words * sizeof(word_type)) == 0;
+}
+
+// True if every taxon in ``a`` is also in ``b``.
+inline bool is_subset(const word_type * a, const word_type * b, std::size_t num_words) {
+    word_type extra = 0;
+    for (std::size_t i = 0; i < num_words; ++i) {
+        extra |= a[i] & ~b[i];
+    }
+    return extra == 0;
+}
+
+inline bool is_disjoint(const word_type * a, const word_type * b, std::size_t num_words) {
+    word_type common = 0;
+    for (std::size_t i = 0; i < num_words; ++i) {
+        common |= a[i] & b[i];
+    }
+    return common == 0;
+}
+
+inline std::size_t hash(const word_type * a, std::size_t num_words) {
+    std::uint64_t h = 0xcbf29ce484222325ULL ^ num_words;
+    for (std::size_t i = 0; i < num_words; ++i) {
+        std::uint64_t w = a[i] * 0x9e3779b97f4a7c15ULL;
+        h ^= w ^ (w >> 29);
+        h *= 0x100000001b3ULL;
+    }
+    return static_cast<std::size_t>(h ^ (h >> 32));
+}
+
+} // namespace split_words
+
+////////////////////////////////////////////////////////////////////////////////
+// Split
+
+/**
+ * A set of taxa (given by their indexes in a platypus::TaxonNamespace),
+ * represented as a bitmask: e.g., the taxa descending from an edge of a tree,
+ * which split the taxa of the tree into two parts.
+ *
+ * Bitmasks of up to ``Split::num_inline_words * 64`` taxa are stored within
+ * the object itself; larger ones are allocated. Splits are hashable (see
+ * ``std::hash<platypus::Split>``) and ordered, for use as keys in
+ * (unordered) maps and sets. Operations on two splits require them to be
+ * on the same number of taxa.
+ */
+class Split {
+
+    public:
+        typedef split_words::word_type      word_type;
+
+        static const std::size_t num_inline_words = 2;
+
+    public:
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Lifecycle
+
+        Split()
+            : num_taxa_(0)
+            , num_words_(0)
+            , data_(inline_words_) {
+            this->inline_words_[0] = 0;
+            this->inline_words_[1] = 0;
+        }
+
+        // An empty set of taxa (out of ``num_taxa``).
+        explicit Split(std::size_t num_taxa)
+            : num_taxa_(0)
+            , num_words_(0)
+            , data_(inline_words_) {
+            this->allocate(num_taxa);
+            std::memset(this->data_, 0, this->num_words_ * sizeof(word_type));
+        }
+
+        // The set of taxa given by the bitmask ``words``.
+        Split(const word_type * words, std::size_t num_taxa)
+            : num_taxa_(0)
+            , num_words_(0)
+            , data_(inline_words_) {
+            this->allocate(num_taxa);
+            if (this->num_words_ > 0) {
+                std::memcpy(this->data_, words, this->num_words_ * sizeof(word_type));
+            }
+        }
+
+        Split(const Split & other)
+            : Split(other.data_, other.num_taxa_) { }
+
+        // Replaces the set with that given by ``words``, reusing storage.
+        void assign(const word_type * words, std::size_t num_taxa) {
+            if (split_words::num_words(num_taxa) != this->num_words_) {
+                this->allocate(num_taxa);
+            }
+            this->num_taxa_ = num_taxa;
+            if (this->num_words_ > 0) {
+                std::memcpy(this->data_, words, this->num_words_ * sizeof(word_type));
+            }
+        }
+
+        Split(Split && other) noexcept
+            : num_taxa_(other.num_taxa_)
+            , num_words_(other.num_words_)
+            , data_(inline_words_) {
+            if (other.heap_words_) {
+                this->heap_words_ = std::move(other.heap_words_);
+                this->data_ = this->heap_words_.get();
+            } else {
+                this->inline_words_[0] = other.inline_words_[0];
+                this->inline_words_[1] = other.inline_words_[1];
+            }
+            other.num_taxa_ = 0;
+            other.num_words_ = 0;
+            other.data_ = other.inline_words_;
+        }
+
+        Split & operator=(const Split & other) {
+            if (this != &other) {
+                if (this->num_words_ != other.num_words_) {
+                    this->allocate(other.num_taxa_);
+                }
+                this->num_taxa_ = other.num_taxa_;
+                if (this->num_words_ > 0) {
+                    std::memcpy(this->data_, other.data_, this->num_words_ * sizeof(word_type));
+                }
+            }
+            return *this;
+        }
+
+        Split & operator=(Split && other) noexcept {
+            if (this != &other) {
+                this->num_taxa_ = other.num_taxa_;
+                this->num_words_ = other.num_words_;
+                if (other.heap_words_) {
+                    this->heap_words_ = std::move(other.heap_words_);
+                    this->data_ = this->heap_words_.get();
+                } else {
+                    this->heap_words_.reset();
+                    this->inline_words_[0] = other.inline_words_[0];
+                    this->inline_words_[1] = other.inline_words_[1];
+                    this->data_ = this->inline_words_;
+                }
+                other.num_taxa_ = 0;
+                other.num_words_ = 0;
+                other.data_ = other.inline_words_;
+            }
+            return *this;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Metrics
+
+        inline std::size_t num_taxa() const {
+            return this->num_taxa_;
+        }
+
+        inline std::size_t num_words() const {
+            return this->num_words_;
+        }
+
+        inline const word_type * words() const {
+            return this->data_;
+        }
+
+        inline word_type * words() {
+            return this->data_;
+        }
+
+        // Number of taxa in the set.
+        inline std::size_t count() const {
+            return split_words::count(this->data_, this->num_words_);
+        }
+
+        inline bool none() const {
+            return this->count() == 0;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Taxa
+
+        inline bool test(std::size_t taxon_idx) const {
+            return (this->data_[taxon_idx / split_words::bits_per_word] >> (taxon_idx % split_words::bits_per_word)) & 1;
+        }
+
+        inline void set(std::size_t taxon_idx) {
+            this->data_[taxon_idx / split_words::bits_per_word] |= word_type(1) << (taxon_idx % split_words::bits_per_word);
+        }
+
+        inline void reset(std::size_t taxon_idx) {
+            this->data_[taxon_idx / split_words::bits_per_word] &= ~(word_type(1) << (taxon_idx % split_words::bits_per_word));
+        }
+
+        // Index of the first taxon in the set, or num_taxa() if it is empty.
+        std::size_t find_first() const {
+            for (std::size_t i = 0; i < this->num_words_; ++i) {
+                if (this->data_[i] != 0) {
+                    return i * split_words::bits_per_word + split_words::lowest_bit(this->data_[i]);
+                }
+            }
+            return this->num_taxa_;
+        }
+
+        // Calls ``fn(taxon_idx)`` for each taxon in the set, in order.
+        template <class FnT>
+        void for_each_taxon(FnT fn) const {
+            for (std::size_t i = 0; i < this->num_words_; ++i) {
+                word_type w = this->data_[i];
+                while (w != 0) {
+                    fn(i * split_words::bits_per_word + split_words::lowest_bit(w));
+                    w &= w - 1;
+                }
+            }
+        }
+
+        // Replaces the set with its complement (in the set of all taxa).
+        inline void complement() {
+            split_words::complement(this->data_, this->num_taxa_);
+        }
+
+        /**
+         * Complements the set if it includes the first taxon (index 0), so
+         * that the two sides of an unrooted split are represented by the same
+         * bitmask.
+         */
+        inline void normalize() {
+            if (this->num_taxa_ > 0 && this->test(0)) {
+                this->complement();
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Set Operations
+
+        inline Split & operator|=(const Split & other) {
+            split_words::bitwise_or(this->data_, other.data_, this->num_words_);
+            return *this;
+        }
+
+        inline Split & operator&=(const Split & other) {
+            split_words::bitwise_and(this->data_, other.data_, this->num_words_);
+            return *this;
+        }
+
+        inline Split & operator^=(const Split & other) {
+            split_words::bitwise_xor(this->data_, other.data_, this->num_words_);
+            return *this;
+        }
+
+        inline bool is_subset_of(const Split & other) const {
+            return split_words::is_subset(this->data_, other.data_, this->num_words_);
+        }
+
+        inline bool is_disjoint_from(const Split & other) const {
+            return split_words::is_disjoint(this->data_, other.data_, this->num_words_);
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Comparison
+
+        inline bool operator==(const Split & other) const {
+            return this->num_taxa_ == other.num_taxa_
+                && split_words::equal(this->data_, other.data_, this->num_words_);
+        }
+
+        inline bool operator!=(const Split & other) const {
+            return !(*this == other);
+        }
+
+        // An arbitrary, but strict weak, order.
+        inline bool operator<(const Split & other) const {
+            if (this->num_taxa_ != other.num_taxa_) {
+                return this->num_taxa_ < other.num_taxa_;
+            }
+            for (std::size_t i = this->num_words_; i > 0; --i) {
+                if (this->data_[i - 1] != other.data_[i - 1]) {
+                    return this->data_[i - 1] < other.data_[i - 1];
+                }
+            }
+            return false;
+        }
+
+        inline std::size_t hash() const {
+            return split_words::hash(this->data_, this->num_words_);
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Representation
+
+        // '1' or '0' for each taxon in the namespace, in order of index.
+        std::string to_string() const {
+            std::string s(this->num_taxa_, '0');
+            for (std::size_t i = 0; i < this->num_taxa_; ++i) {
+                if (this->test(i)) {
+                    s[i] = '1';
+                }
+            }
+            return s;
+        }
+
+    private:
+        // Sets up storage for ``num_taxa`` (contents undefined).
+        void allocate(std::size_t num_taxa) {
+            this->num_taxa_ = num_taxa;
+            this->num_words_ = split_words::num_words(num_taxa);
+            if (this->num_words_ <= num_inline_words) {
+                this->heap_words_.reset();
+                this->data_ = this->inline_words_;
+            } else {
+                this->heap_words_.reset(new word_type[this->num_words_]);
+                this->data_ = this->heap_words_.get();
+            }
+        }
+
+    private:
+        std::size_t                     num_taxa_;
+        std::size_t                     num_words_;
+        word_type                       inline_words_[num_inline_words];
+        std::unique_ptr<word_type[]>    heap_words_;
+        word_type *                     data_;
+
+}; // Split
+
+////////////////////////////////////////////////////////////////////////////////
+// SplitSet
+
+/**
+ * The splits of a tree: for each node, the set of taxa descending from it
+ * (i.e., the split induced by the edge subtending it), as computed by a
+ * single postorder pass over the tree, OR-ing the bitmasks of the children
+ * of each node together.
+ *
+ * Splits are in postorder of the nodes of the tree (so that the last is the
+ * split of the root, i.e. all the taxa of the tree), and their bitmasks are
+ * stored contiguously (rather than as individual platypus::Split objects),
+ * so that encoding a tree, or comparing the splits of trees, touches a
+ * single block of memory. Re-assigning a SplitSet reuses its storage, so
+ * that the splits of each tree of a large collection can be encoded in
+ * turn without allocation:
+ *
+ *      platypus::SplitSet splits;
+ *      reader.read_each(src, scratch_tree, [&] (const TreeType & tree) {
+ *          splits.assign(tree, taxon_namespace);
+ *          for (std::size_t i = 0; i < splits.size(); ++i) {
+ *              ++counts[splits.get_split(i)];
+ *          }
+ *      });
+ */
+class SplitSet {
+
+    public:
+        typedef split_words::word_type      word_type;
+
+    public:
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Lifecycle
+
+        SplitSet()
+            : num_taxa_(0)
+            , num_words_(0) { }
+
+        template <typename TreeT, typename TaxonIndexFnT>
+        SplitSet(const TreeT & tree,
+                std::size_t num_taxa,
+                TaxonIndexFnT taxon_index_fn,
+                bool normalize=false)
+            : num_taxa_(0)
+            , num_words_(0) {
+            this->assign(tree, num_taxa, taxon_index_fn, normalize);
+        }
+
+        template <typename TreeT>
+        SplitSet(const TreeT & tree,
+                const TaxonNamespace & taxon_namespace,
+                bool normalize=false)
+            : num_taxa_(0)
+            , num_words_(0) {
+            this->assign(tree, taxon_namespace, normalize);
+        }
+
+        /**
+         * Replaces the contents of this object with the splits of ``tree``.
+         *
+         * @param tree
+         *   Tree to encode.
+         * @param num_taxa
+         *   Number of taxa (or size of the taxon namespace) over which
+         *   splits are defined.
+         * @param taxon_index_fn
+         *   Function returning the index (in [0, ``num_taxa``)) of the taxon
+         *   associated with the value of a leaf node; SplitError is thrown
+         *   on any other value.
+         * @param normalize
+         *   If true, splits are normalized (see Split::normalize()), as they
+         *   should be when comparing unrooted trees.
+         */
+        template <typename TreeT, typename TaxonIndexFnT>
+        void assign(const TreeT & tree,
+                std::size_t num_taxa,
+                TaxonIndexFnT taxon_index_fn,
+                bool normalize=false) {
+            typedef typename TreeT::node_type node_type;
+            this->clear();
+            this->num_taxa_ = num_taxa;
+            this->num_words_ = split_words::num_words(num_taxa);
+            const std::size_t nw = this->num_words_;
+            // splits of nodes whose parent has not yet been visited
+            auto & pending = this->pending_;
+            pending.clear();
+            for (auto nd = tree.postorder_begin(); nd != tree.postorder_end(); ++nd) {
+                const node_type * node = nd.node();
+                std::size_t split_idx = this->is_leaf_.size();
+                this->words_.resize(this->words_.size() + nw, 0);
+                word_type * dest = this->words_.data() + split_idx * nw;
+                if (node->first_child_node() == nullptr) {
+                    auto taxon_idx = taxon_index_fn(node->value());
+                    if (static_cast<std::size_t>(taxon_idx) >= num_taxa) {
+                        throw SplitError(__FILE__, __LINE__, "platypus::SplitSet: leaf node without a valid taxon index");
+                    }
+                    dest[taxon_idx / split_words::bits_per_word] |= word_type(1) << (taxon_idx % split_words::bits_per_word);
+                    this->is_leaf_.push_back(1);
+                } else {
+                    std::size_t num_children = 0;
+                    for (const node_type * ch = node->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                        ++num_children;
+                    }
+                    for (std::size_t i = pending.size() - num_children; i < pending.size(); ++i) {
+                        split_words::bitwise_or(dest, this->words_.data() + pending[i] * nw, nw);
+                    }
+                    pending.resize(pending.size() - num_children);
+                    this->is_leaf_.push_back(0);
+                }
+                pending.push_back(split_idx);
+            }
+            if (normalize) {
+                for (std::size_t idx = 0; idx < this->is_leaf_.size(); ++idx) {
+                    word_type * split = this->words_.data() + idx * nw;
+                    if (num_taxa > 0 && (split[0] & 1)) {
+                        split_words::complement(split, num_taxa);
+                    }
+                }
+            }
+        }
+
+        /**
+         * As above, with leaf nodes associated with taxa of
+         * ``taxon_namespace`` through ``get_taxon_index()`` of the node value
+         * (e.g. platypus::TaxonNodeValue).
+         */
+        template <typename TreeT>
+        void assign(const TreeT & tree,
+                const TaxonNamespace & taxon_namespace,
+                bool normalize=false) {
+            this->assign(tree,
+                    taxon_namespace.size(),
+                    [] (const typename TreeT::value_type & nv) -> TaxonNamespace::index_type { return nv.get_taxon_index(); },
+                    normalize);
+        }
+
+        void clear() {
+            this->words_.clear();
+            this->is_leaf_.clear();
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Metrics
+
+        // Number of splits (i.e., nodes of the tree).
+        inline std::size_t size() const {
+            return this->is_leaf_.size();
+        }
+
+        inline bool empty() const {
+            return this->is_leaf_.empty();
+        }
+
+        inline std::size_t num_taxa() const {
+            return this->num_taxa_;
+        }
+
+        inline std::size_t num_words() const {
+            return this->num_words_;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Splits
+
+        // Bitmask of split ``idx``, of num_words() words.
+        inline const word_type * words(std::size_t idx) const {
+            return this->words_.data() + idx * this->num_words_;
+        }
+
+        inline Split get_split(std::size_t idx) const {
+            return Split(this->words(idx), this->num_taxa_);
+        }
+
+        // Number of taxa on the (descendent, unless normalized) side of split ``idx``.
+        inline std::size_t count(std::size_t idx) const {
+            return split_words::count(this->words(idx), this->num_words_);
+        }
+
+        // True if split ``idx`` is that of a leaf node.
+        inline bool is_leaf(std::size_t idx) const {
+            return this->is_leaf_[idx] != 0;
+        }
+
+        /**
+         * True if split ``idx`` is trivial as a bipartition, i.e. found in
+         * every unrooted tree on the same taxa: one with fewer than two taxa
+         * on either side (that of a leaf, of the root, or of a child of the
+         * root that includes all taxa but one).
+         */
+        inline bool is_trivial(std::size_t idx) const {
+            std::size_t n = this->count(idx);
+            return n < 2 || n + 2 > this->num_taxa_;
+        }
+
+        inline bool contains(std::size_t idx, std::size_t taxon_idx) const {
+            return (this->words(idx)[taxon_idx / split_words::bits_per_word] >> (taxon_idx % split_words::bits_per_word)) & 1;
+        }
+
+    private:
+        std::size_t                 num_taxa_;
+        std::size_t                 num_words_;
+        std::vector<word_type>      words_;
+        std::vector<unsigned char>  is_leaf_;
+        std::vector<std::size_t>    pending_;
+
+}; // SplitSet
+
+} // namespace platypus
+
+namespace std {
+
+template <>
+struct hash<platypus::Split> {
+    std::size_t operator()(const platypus::Split & split) const {
+        return split.hash();
+    }
+};
+
+} // namespace std
+
+#endif
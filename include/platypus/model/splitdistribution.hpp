@@ -0,0 +1,820 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Split (clade) frequencies over collections of trees, and consensus trees.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_MODEL_SPLITDISTRIBUTION_HPP
+#define PLATYPUS_MODEL_SPLITDISTRIBUTION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "datatable.hpp"
+#include "split.hpp"
+#include "taxonnamespace.hpp"
+#include "../numeric/statistics.hpp"
+#include "../utility/parallel.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// SplitDistribution
+
+/**
+ * Accumulates the number of trees in which each split (or, for rooted trees,
+ * clade) occurs, along with statistics of the lengths of the edges
+ * corresponding to the split, over a collection of trees on (subsets of) the
+ * taxa of a platypus::TaxonNamespace.
+ *
+ * Trees can be added one at a time (e.g. as they are read with
+ * BaseTreeReader::read_each()), or in batches with add_trees(), which
+ * divides the batch among threads that each accumulate into a local
+ * distribution, merged into this one at the end. The distribution can be
+ * summarized as a platypus::DataTable (summarize()) or as a consensus tree
+ * (build_consensus_tree()), or used to select the maximum clade credibility
+ * tree of the collection (find_mcc_tree()) in a second pass.
+ *
+ * The root split (i.e., the set of all taxa of a tree) is not counted. If
+ * the trees are unrooted, splits are normalized (see Split::normalize()),
+ * so that the two sides of a bipartition count as the same split, and the
+ * two edges of a basal bifurcation are counted as one.
+ *
+ * @tparam EdgeLengthT
+ *   Type of edge length values.
+ */
+template <class EdgeLengthT=double>
+class SplitDistribution {
+
+    public:
+        struct SplitStatistics {
+            SplitStatistics()
+                : count(0) { }
+            // number of trees in which the split occurs
+            unsigned long                                       count;
+            platypus::numeric::RunningStatistics<EdgeLengthT>   edge_lengths;
+            // heights (greatest distance to a leaf below) of the nodes of
+            // the clade, if the trees are rooted
+            platypus::numeric::RunningStatistics<EdgeLengthT>   node_heights;
+        };
+        typedef std::unordered_map<Split, SplitStatistics>  split_map_type;
+
+    public:
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Lifecycle
+
+        /**
+         * @param num_taxa
+         *   Number of taxa (or size of the taxon namespace) over which splits
+         *   are defined.
+         * @param is_rooted
+         *   If false, splits are normalized, and treated as bipartitions.
+         */
+        SplitDistribution(std::size_t num_taxa, bool is_rooted=true)
+            : num_taxa_(num_taxa)
+            , is_rooted_(is_rooted)
+            , num_trees_(0)
+            , observed_taxa_(num_taxa)
+            , scratch_split_(num_taxa) { }
+
+        // ``taxon_namespace`` is expected to have all taxa by now.
+        SplitDistribution(const TaxonNamespace & taxon_namespace, bool is_rooted=true)
+            : SplitDistribution(taxon_namespace.size(), is_rooted) { }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Accumulation
+
+        /**
+         * Adds the splits of ``tree``, where ``taxon_index_fn`` returns the
+         * index of the taxon associated with the value of a leaf node (see
+         * SplitSet::assign()), and ``edge_length_fn`` returns the length of
+         * the edge subtending a node given its value.
+         */
+        template <class TreeT, class TaxonIndexFnT, class EdgeLengthFnT>
+        void add_tree(const TreeT & tree, TaxonIndexFnT taxon_index_fn, EdgeLengthFnT edge_length_fn) {
+            typedef typename TreeT::node_type node_type;
+            this->tree_splits_.assign(tree, this->num_taxa_, taxon_index_fn);
+            if (this->tree_splits_.empty()) {
+                return;
+            }
+            std::size_t root_idx = this->tree_splits_.size() - 1;
+            split_words::bitwise_or(this->observed_taxa_.words(), this->tree_splits_.words(root_idx), this->tree_splits_.num_words());
+            // in an unrooted tree, the two edges of a basal bifurcation are
+            // a single edge (and split), with the length of both
+            const node_type * root = tree.head_node();
+            const node_type * basal_child = nullptr;
+            if (!this->is_rooted_
+                    && root->first_child_node() != nullptr
+                    && root->first_child_node()->next_sibling_node() != nullptr
+                    && root->first_child_node()->next_sibling_node()->next_sibling_node() == nullptr) {
+                basal_child = root->first_child_node();
+            }
+            EdgeLengthT basal_edge_length = EdgeLengthT();
+            // heights of the subtrees of nodes whose parents are still to be
+            // visited, plus the lengths of their edges
+            this->pending_heights_.clear();
+            std::size_t idx = 0;
+            for (auto nd = tree.postorder_begin(); idx < root_idx; ++nd, ++idx) {
+                EdgeLengthT edge_length = edge_length_fn(*nd);
+                EdgeLengthT height = EdgeLengthT();
+                if (this->is_rooted_) {
+                    height = this->pop_height(nd.node()->num_child_nodes());
+                    this->pending_heights_.push_back(height + edge_length);
+                }
+                if (basal_child != nullptr && nd.node()->parent_node() == root) {
+                    if (nd.node() == basal_child) {
+                        basal_edge_length = edge_length;
+                        continue;
+                    }
+                    edge_length += basal_edge_length;
+                }
+                this->scratch_split_.assign(this->tree_splits_.words(idx), this->num_taxa_);
+                if (!this->is_rooted_) {
+                    this->scratch_split_.normalize();
+                }
+                SplitStatistics & stats = this->splits_[this->scratch_split_];
+                ++stats.count;
+                stats.edge_lengths.add(edge_length);
+                if (this->is_rooted_) {
+                    stats.node_heights.add(height);
+                }
+            }
+            if (this->is_rooted_) {
+                this->root_heights_.add(this->pop_height(this->pending_heights_.size()));
+            }
+            ++this->num_trees_;
+        }
+
+        /**
+         * As above, with taxa and edge lengths given by
+         * ``get_taxon_index()`` and ``get_edge_length()`` of node values (e.g.
+         * platypus::TaxonNodeValue).
+         */
+        template <class TreeT>
+        void add_tree(const TreeT & tree) {
+            typedef typename TreeT::value_type value_type;
+            this->add_tree(tree,
+                    [] (const value_type & nv) -> TaxonNamespace::index_type { return nv.get_taxon_index(); },
+                    [] (const value_type & nv) -> EdgeLengthT { return nv.get_edge_length(); });
+        }
+
+        /**
+         * Adds the splits of the trees in [``trees_begin``, ``trees_end``),
+         * divided into ``num_threads`` contiguous blocks (see
+         * resolve_num_threads()) that are accumulated concurrently, each in
+         * a thread-local distribution, merged in order at the end.
+         * ``taxon_index_fn`` and ``edge_length_fn`` are as for add_tree(),
+         * and are called concurrently.
+         */
+        template <class IterT, class TaxonIndexFnT, class EdgeLengthFnT>
+        void add_trees(IterT trees_begin,
+                IterT trees_end,
+                TaxonIndexFnT taxon_index_fn,
+                EdgeLengthFnT edge_length_fn,
+                unsigned int num_threads=1) {
+            std::size_t num_trees = static_cast<std::size_t>(std::distance(trees_begin, trees_end));
+            std::size_t num_blocks = resolve_num_threads(num_threads);
+            if (num_blocks > num_trees) {
+                num_blocks = num_trees;
+            }
+            if (num_blocks <= 1) {
+                for (; trees_begin != trees_end; ++trees_begin) {
+                    this->add_tree(*trees_begin, taxon_index_fn, edge_length_fn);
+                }
+                return;
+            }
+            std::vector<SplitDistribution> block_distributions(num_blocks, SplitDistribution(this->num_taxa_, this->is_rooted_));
+            std::size_t block_size = (num_trees + num_blocks - 1) / num_blocks;
+            parallel_for(num_blocks, static_cast<unsigned int>(num_blocks), [&] (std::size_t block_idx) {
+                std::size_t begin_idx = block_idx * block_size;
+                std::size_t end_idx = std::min(begin_idx + block_size, num_trees);
+                IterT tree_iter = trees_begin;
+                std::advance(tree_iter, begin_idx);
+                for (std::size_t idx = begin_idx; idx < end_idx; ++idx, ++tree_iter) {
+                    block_distributions[block_idx].add_tree(*tree_iter, taxon_index_fn, edge_length_fn);
+                }
+            });
+            for (auto & block_distribution : block_distributions) {
+                this->merge(block_distribution);
+            }
+        }
+
+        template <class IterT>
+        void add_trees(IterT trees_begin, IterT trees_end, unsigned int num_threads=1) {
+            typedef typename std::iterator_traits<IterT>::value_type::value_type value_type;
+            this->add_trees(trees_begin,
+                    trees_end,
+                    [] (const value_type & nv) -> TaxonNamespace::index_type { return nv.get_taxon_index(); },
+                    [] (const value_type & nv) -> EdgeLengthT { return nv.get_edge_length(); },
+                    num_threads);
+        }
+
+        // Adds the counts and edge length statistics of ``other``.
+        void merge(const SplitDistribution & other) {
+            for (auto & entry : other.splits_) {
+                SplitStatistics & stats = this->splits_[entry.first];
+                stats.count += entry.second.count;
+                stats.edge_lengths.merge(entry.second.edge_lengths);
+                stats.node_heights.merge(entry.second.node_heights);
+            }
+            this->root_heights_.merge(other.root_heights_);
+            this->observed_taxa_ |= other.observed_taxa_;
+            this->num_trees_ += other.num_trees_;
+        }
+
+        void clear() {
+            this->splits_.clear();
+            this->root_heights_ = platypus::numeric::RunningStatistics<EdgeLengthT>();
+            this->observed_taxa_ = Split(this->num_taxa_);
+            this->num_trees_ = 0;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Partial state
+
+        /**
+         * The distribution of a shard of the trees, written by a worker
+         * with platypus::save_partial_state() (for example), and merged by
+         * merge_state() as by merge(), into a distribution over the same
+         * number of taxa and with the same rootedness.
+         */
+        static std::string partial_state_kind() {
+            return "SplitDistribution";
+        }
+
+        template <class WriterT>
+        void write_state(WriterT & writer) const {
+            writer.write_u64(this->num_taxa_);
+            writer.write_bool(this->is_rooted_);
+            writer.write_u64(this->num_trees_);
+            this->write_words(writer, this->observed_taxa_);
+            writer.write_u64(this->splits_.size());
+            for (auto & entry : this->splits_) {
+                this->write_words(writer, entry.first);
+                writer.write_u64(entry.second.count);
+                entry.second.edge_lengths.write_state(writer);
+                entry.second.node_heights.write_state(writer);
+            }
+            this->root_heights_.write_state(writer);
+        }
+
+        template <class ReaderT>
+        void merge_state(ReaderT & reader) {
+            std::uint64_t num_taxa = reader.read_u64();
+            bool is_rooted = reader.read_bool();
+            if (num_taxa != this->num_taxa_ || is_rooted != this->is_rooted_) {
+                reader.fail("split distribution over " + std::to_string(num_taxa)
+                        + (is_rooted ? " rooted" : " unrooted") + " taxa cannot be merged into one over "
+                        + std::to_string(this->num_taxa_) + (this->is_rooted_ ? " rooted" : " unrooted") + " taxa");
+            }
+            unsigned long num_trees = static_cast<unsigned long>(reader.read_u64());
+            this->read_words(reader, this->scratch_split_);
+            this->observed_taxa_ |= this->scratch_split_;
+            std::size_t num_words = this->scratch_split_.num_words();
+            std::size_t num_splits = reader.read_count(8 * (num_words + 1));
+            for (std::size_t idx = 0; idx < num_splits; ++idx) {
+                this->read_words(reader, this->scratch_split_);
+                SplitStatistics & stats = this->splits_[this->scratch_split_];
+                stats.count += static_cast<unsigned long>(reader.read_u64());
+                stats.edge_lengths.merge_state(reader);
+                stats.node_heights.merge_state(reader);
+            }
+            this->root_heights_.merge_state(reader);
+            this->num_trees_ += num_trees;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Access
+
+        inline unsigned long num_trees() const {
+            return this->num_trees_;
+        }
+
+        // Number of distinct splits.
+        inline std::size_t size() const {
+            return this->splits_.size();
+        }
+
+        inline std::size_t num_taxa() const {
+            return this->num_taxa_;
+        }
+
+        inline bool is_rooted() const {
+            return this->is_rooted_;
+        }
+
+        // Taxa found in any of the trees added.
+        inline const Split & observed_taxa() const {
+            return this->observed_taxa_;
+        }
+
+        inline const split_map_type & splits() const {
+            return this->splits_;
+        }
+
+        // Number of trees in which ``split`` occurs (``split`` is normalized first if trees are unrooted).
+        unsigned long get_count(const Split & split) const {
+            const SplitStatistics * stats = this->find(split);
+            return stats == nullptr ? 0 : stats->count;
+        }
+
+        double get_frequency(const Split & split) const {
+            if (this->num_trees_ == 0) {
+                return 0.0;
+            }
+            return static_cast<double>(this->get_count(split)) / static_cast<double>(this->num_trees_);
+        }
+
+        DataTable::Summary<EdgeLengthT> get_edge_length_summary(const Split & split) const {
+            const SplitStatistics * stats = this->find(split);
+            if (stats == nullptr) {
+                return DataTable::Summary<EdgeLengthT>();
+            }
+            return DataTable::Summary<EdgeLengthT>(stats->edge_lengths);
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Summarization
+
+        /**
+         * Adds a row to ``table`` for each split, in order of decreasing
+         * frequency, with columns "split" (see Split::to_string()),
+         * "count", "frequency", "mean_edge_length" and
+         * "edge_length_variance" (sample variance), which are added to the
+         * table if it has no columns.
+         *
+         * @param include_trivial
+         *   If false, splits of single taxa (and, if the trees are unrooted,
+         *   their complements) are omitted.
+         */
+        void summarize(DataTable & table, bool include_trivial=false) const {
+            if (table.num_columns() == 0) {
+                table.add_key_column<std::string>("split");
+                table.add_data_column<unsigned long>("count");
+                table.add_data_column<double>("frequency");
+                table.add_data_column<EdgeLengthT>("mean_edge_length");
+                table.add_data_column<EdgeLengthT>("edge_length_variance");
+            }
+            for (auto entry : this->get_sorted_splits(0.0, include_trivial)) {
+                auto & row = table.add_row();
+                row << entry->first.to_string()
+                    << entry->second.count
+                    << static_cast<double>(entry->second.count) / static_cast<double>(this->num_trees_)
+                    << entry->second.edge_lengths.mean()
+                    << entry->second.edge_lengths.sample_variance();
+            }
+        }
+
+        /**
+         * Builds, in ``tree``, the consensus of the trees added: the tree
+         * composed of the splits that occur with a frequency greater than
+         * ``min_frequency`` and, if ``min_frequency`` is less than 0.5, that
+         * are compatible with all splits of higher frequency (added greedily
+         * in order of decreasing frequency). The default is the majority-rule
+         * consensus tree.
+         *
+         * ``tree`` is cleared first. Each node is passed, in preorder, to
+         * ``set_node_value(value, split, stats)``, along with the split
+         * (clade) it represents and the statistics of that split; the leaves
+         * are the observed taxa (with splits of a single taxon), and the
+         * statistics passed for the root are those of the root split (with a
+         * count of num_trees() and no edge lengths). If the trees are
+         * unrooted, the consensus tree is rooted at the parent of the first
+         * taxon, which is taken out of all splits by normalization, and
+         * ``split`` is the descendent side of each edge.
+         */
+        template <class TreeT, class NodeValueFnT>
+        void build_consensus_tree(TreeT & tree, double min_frequency, NodeValueFnT set_node_value) const {
+            typedef typename TreeT::node_type node_type;
+            tree.clear();
+            std::size_t num_observed = this->observed_taxa_.count();
+            // splits supported, other than those of leaves (or their
+            // complements), or the root
+            std::vector<typename split_map_type::const_iterator> clades;
+            for (auto entry : this->get_sorted_splits(min_frequency, false)) {
+                std::size_t n = entry->first.count();
+                if (n >= num_observed) {
+                    continue;
+                }
+                if (!this->is_rooted_ && n + 1 >= num_observed) {
+                    continue;
+                }
+                if (min_frequency < 0.5) {
+                    bool is_compatible = true;
+                    for (auto & clade : clades) {
+                        const Split & a = entry->first;
+                        const Split & b = clade->first;
+                        if (!a.is_subset_of(b) && !b.is_subset_of(a) && !a.is_disjoint_from(b)) {
+                            is_compatible = false;
+                            break;
+                        }
+                    }
+                    if (!is_compatible) {
+                        continue;
+                    }
+                }
+                clades.push_back(entry);
+            }
+            // larger clades before the clades they contain
+            std::stable_sort(clades.begin(), clades.end(),
+                    [] (const typename split_map_type::const_iterator & a, const typename split_map_type::const_iterator & b) {
+                        return a->first.count() > b->first.count();
+                    });
+            SplitStatistics root_stats;
+            root_stats.count = this->num_trees_;
+            set_node_value(tree.head_node()->value(), this->observed_taxa_, root_stats);
+            // the smallest clade (so far) that each taxon belongs to
+            std::vector<node_type *> parent_nodes(this->num_taxa_, tree.head_node());
+            for (auto & clade : clades) {
+                node_type * node = tree.create_internal_node();
+                parent_nodes[clade->first.find_first()]->add_child(node);
+                clade->first.for_each_taxon([&parent_nodes, node] (std::size_t taxon_idx) { parent_nodes[taxon_idx] = node; });
+                set_node_value(node->value(), clade->first, clade->second);
+            }
+            SplitStatistics no_stats;
+            Split leaf_split(this->num_taxa_);
+            this->observed_taxa_.for_each_taxon([&] (std::size_t taxon_idx) {
+                node_type * node = tree.create_leaf_node();
+                parent_nodes[taxon_idx]->add_child(node);
+                leaf_split.set(taxon_idx);
+                const SplitStatistics * stats = this->find(leaf_split);
+                set_node_value(node->value(), leaf_split, stats == nullptr ? no_stats : *stats);
+                leaf_split.reset(taxon_idx);
+            });
+        }
+
+        /**
+         * As above, for node values with ``set_taxon_index()``,
+         * ``set_label()`` and ``set_edge_length()`` (e.g.
+         * platypus::TaxonNodeValue): leaves are associated with their taxa,
+         * internal nodes (other than the root) are labeled with the
+         * frequency of their split, and edge lengths are the mean lengths of
+         * the corresponding edges.
+         */
+        template <class TreeT>
+        void build_consensus_tree(TreeT & tree, double min_frequency=0.5) const {
+            std::size_t num_observed = this->observed_taxa_.count();
+            double num_trees = static_cast<double>(this->num_trees_);
+            this->build_consensus_tree(tree, min_frequency,
+                    [num_observed, num_trees] (typename TreeT::value_type & nv, const Split & split, const SplitStatistics & stats) {
+                        std::size_t n = split.count();
+                        if (n == 1) {
+                            nv.set_taxon_index(static_cast<TaxonNamespace::index_type>(split.find_first()));
+                        } else if (n < num_observed) {
+                            std::ostringstream label;
+                            label << static_cast<double>(stats.count) / num_trees;
+                            nv.set_label(label.str());
+                        }
+                        if (stats.edge_lengths.size() > 0) {
+                            nv.set_edge_length(stats.edge_lengths.mean());
+                        }
+                    });
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Maximum clade credibility
+
+        /**
+         * The log clade credibility of ``tree``: the sum, over the splits
+         * (clades) of its nodes other than the root, of the log of their
+         * frequencies in the distribution (-infinity if any does not
+         * occur). ``taxon_index_fn`` is as for add_tree().
+         */
+        template <class TreeT, class TaxonIndexFnT>
+        double get_log_clade_credibility(const TreeT & tree, TaxonIndexFnT taxon_index_fn) const {
+            SplitSet tree_splits;
+            Split split(this->num_taxa_);
+            return this->compute_log_clade_credibility(tree, taxon_index_fn, tree_splits, split);
+        }
+
+        template <class TreeT>
+        double get_log_clade_credibility(const TreeT & tree) const {
+            typedef typename TreeT::value_type value_type;
+            return this->get_log_clade_credibility(tree,
+                    [] (const value_type & nv) -> TaxonNamespace::index_type { return nv.get_taxon_index(); });
+        }
+
+        /**
+         * The log clade credibilities of the trees in [``trees_begin``,
+         * ``trees_end``), scored in ``num_threads`` contiguous blocks (see
+         * resolve_num_threads()) concurrently, so ``taxon_index_fn`` must be
+         * safe to call concurrently. For collections too large to hold in
+         * memory, trees can be scored by get_log_clade_credibility() as
+         * they are read again (e.g., in shards with a TreeOffsetIndex).
+         */
+        template <class IterT, class TaxonIndexFnT>
+        std::vector<double> score_trees(IterT trees_begin,
+                IterT trees_end,
+                TaxonIndexFnT taxon_index_fn,
+                unsigned int num_threads) const {
+            std::size_t num_trees = static_cast<std::size_t>(std::distance(trees_begin, trees_end));
+            std::vector<double> scores(num_trees);
+            num_threads = resolve_num_threads(num_threads);
+            std::size_t num_blocks = std::min<std::size_t>(num_threads, num_trees);
+            if (num_blocks == 0) {
+                return scores;
+            }
+            std::size_t block_size = (num_trees + num_blocks - 1) / num_blocks;
+            parallel_for(num_blocks, num_threads, [&] (std::size_t block_idx) {
+                SplitSet tree_splits;
+                Split split(this->num_taxa_);
+                std::size_t begin_idx = block_idx * block_size;
+                std::size_t end_idx = std::min(begin_idx + block_size, num_trees);
+                IterT tree_iter = trees_begin;
+                std::advance(tree_iter, begin_idx);
+                for (std::size_t idx = begin_idx; idx < end_idx; ++idx, ++tree_iter) {
+                    scores[idx] = this->compute_log_clade_credibility(*tree_iter, taxon_index_fn, tree_splits, split);
+                }
+            });
+            return scores;
+        }
+
+        template <class IterT>
+        std::vector<double> score_trees(IterT trees_begin, IterT trees_end, unsigned int num_threads=1) const {
+            typedef typename std::iterator_traits<IterT>::value_type::value_type value_type;
+            return this->score_trees(trees_begin,
+                    trees_end,
+                    [] (const value_type & nv) -> TaxonNamespace::index_type { return nv.get_taxon_index(); },
+                    num_threads);
+        }
+
+        /**
+         * The index of the maximum clade credibility tree of [``trees_begin``,
+         * ``trees_end``) (the first, if more than one has the highest score;
+         * see score_trees()), which is normally the collection the
+         * distribution was built from.
+         */
+        template <class IterT>
+        std::size_t find_mcc_tree(IterT trees_begin, IterT trees_end, unsigned int num_threads=1) const {
+            std::vector<double> scores = this->score_trees(trees_begin, trees_end, num_threads);
+            return static_cast<std::size_t>(std::max_element(scores.begin(), scores.end()) - scores.begin());
+        }
+
+        /**
+         * Passes each node of ``tree`` (e.g., the maximum clade credibility
+         * tree), in postorder, to ``set_node_value(value, split, stats)``,
+         * with the split (clade) it represents and the statistics of that
+         * split in the distribution (empty, if it does not occur; for the
+         * root, a count of num_trees() and the heights of the roots of the
+         * trees), as for build_consensus_tree().
+         */
+        template <class TreeT, class TaxonIndexFnT, class NodeValueFnT>
+        void annotate_tree(TreeT & tree, TaxonIndexFnT taxon_index_fn, NodeValueFnT set_node_value) const {
+            SplitSet tree_splits;
+            tree_splits.assign(tree, this->num_taxa_, taxon_index_fn);
+            if (tree_splits.empty()) {
+                return;
+            }
+            std::size_t root_idx = tree_splits.size() - 1;
+            Split split(this->num_taxa_);
+            SplitStatistics no_stats;
+            SplitStatistics root_stats;
+            root_stats.count = this->num_trees_;
+            root_stats.node_heights = this->root_heights_;
+            std::size_t idx = 0;
+            for (auto nd = tree.postorder_begin(); nd != tree.postorder_end(); ++nd, ++idx) {
+                split.assign(tree_splits.words(idx), this->num_taxa_);
+                if (idx == root_idx) {
+                    set_node_value(*nd, split, root_stats);
+                    continue;
+                }
+                const SplitStatistics * stats = this->find(split);
+                set_node_value(*nd, split, stats == nullptr ? no_stats : *stats);
+            }
+        }
+
+        /**
+         * As above, for node values with ``get_taxon_index()``,
+         * ``set_label()`` and ``set_edge_length()`` (e.g.
+         * platypus::TaxonNodeValue), as with TreeAnnotator: internal nodes
+         * (other than the root) are labeled with the frequency of their
+         * clade and, if the trees are rooted, edge lengths are set so that
+         * the height of each node is the mean height of its clade (or, if
+         * the clade does not occur, of the node in ``tree``); otherwise,
+         * they are the mean lengths of the corresponding edges (for the two
+         * edges of a basal bifurcation, which are one edge, divided between
+         * them in the proportions of their lengths in ``tree``).
+         */
+        template <class TreeT>
+        void annotate_tree(TreeT & tree) const {
+            typedef typename TreeT::value_type value_type;
+            typedef typename TreeT::node_type node_type;
+            double num_trees = static_cast<double>(this->num_trees_);
+            const value_type * root_value = &(tree.head_node()->value());
+            std::unordered_map<const value_type *, EdgeLengthT> mean_heights;
+            std::vector<EdgeLengthT> heights;
+            // heights in ``tree``, for clades that do not occur
+            for (auto nd = tree.postorder_begin(); nd != tree.postorder_end(); ++nd) {
+                EdgeLengthT height = EdgeLengthT();
+                std::size_t num_children = nd.node()->num_child_nodes();
+                for (std::size_t k = heights.size() - num_children; k < heights.size(); ++k) {
+                    height = std::max(height, heights[k]);
+                }
+                heights.resize(heights.size() - num_children);
+                heights.push_back(height + nd->get_edge_length());
+                mean_heights[&(*nd)] = height;
+            }
+            // in an unrooted tree, the two edges of a basal bifurcation are
+            // one split, whose mean length is that of both together
+            node_type * root = tree.head_node();
+            node_type * basal_children[2] = {nullptr, nullptr};
+            EdgeLengthT basal_edge_lengths[2] = {EdgeLengthT(), EdgeLengthT()};
+            if (!this->is_rooted_
+                    && root->first_child_node() != nullptr
+                    && root->first_child_node()->next_sibling_node() != nullptr
+                    && root->first_child_node()->next_sibling_node()->next_sibling_node() == nullptr) {
+                basal_children[0] = root->first_child_node();
+                basal_children[1] = basal_children[0]->next_sibling_node();
+                basal_edge_lengths[0] = basal_children[0]->value().get_edge_length();
+                basal_edge_lengths[1] = basal_children[1]->value().get_edge_length();
+            }
+            bool is_basal_edge_annotated = false;
+            const value_type * basal_value = basal_children[0] == nullptr ? nullptr : &(basal_children[0]->value());
+            this->annotate_tree(tree,
+                    [] (const value_type & nv) -> TaxonNamespace::index_type { return nv.get_taxon_index(); },
+                    [this, num_trees, root_value, basal_value, &is_basal_edge_annotated, &mean_heights] (value_type & nv, const Split & split, const SplitStatistics & stats) {
+                        if (split.count() > 1 && &nv != root_value) {
+                            std::ostringstream label;
+                            label << static_cast<double>(stats.count) / num_trees;
+                            nv.set_label(label.str());
+                        }
+                        if (this->is_rooted_ && stats.node_heights.size() > 0) {
+                            mean_heights[&nv] = stats.node_heights.mean();
+                        } else if (!this->is_rooted_ && stats.edge_lengths.size() > 0) {
+                            nv.set_edge_length(stats.edge_lengths.mean());
+                            if (&nv == basal_value) {
+                                is_basal_edge_annotated = true;
+                            }
+                        }
+                    });
+            if (is_basal_edge_annotated) {
+                // divided in the proportions of the edges in ``tree`` (or, if
+                // both are of zero length, all on the first)
+                EdgeLengthT mean_length = basal_children[0]->value().get_edge_length();
+                EdgeLengthT total_length = basal_edge_lengths[0] + basal_edge_lengths[1];
+                EdgeLengthT first_length = total_length > EdgeLengthT() ? mean_length * (basal_edge_lengths[0] / total_length) : mean_length;
+                basal_children[0]->value().set_edge_length(first_length);
+                basal_children[1]->value().set_edge_length(mean_length - first_length);
+            }
+            if (this->is_rooted_) {
+                for (auto nd = tree.preorder_begin(); nd != tree.preorder_end(); ++nd) {
+                    const node_type * parent = nd.node()->parent_node();
+                    if (parent != nullptr) {
+                        nd->set_edge_length(mean_heights[&(parent->value())] - mean_heights[&(*nd)]);
+                    }
+                }
+            }
+        }
+
+    private:
+
+        // Pops the last ``num_heights`` pending heights, returning the greatest.
+        EdgeLengthT pop_height(std::size_t num_heights) {
+            EdgeLengthT height = EdgeLengthT();
+            std::size_t end = this->pending_heights_.size();
+            for (std::size_t k = end - num_heights; k < end; ++k) {
+                height = std::max(height, this->pending_heights_[k]);
+            }
+            this->pending_heights_.resize(end - num_heights);
+            return height;
+        }
+
+        template <class TreeT, class TaxonIndexFnT>
+        double compute_log_clade_credibility(const TreeT & tree,
+                TaxonIndexFnT taxon_index_fn,
+                SplitSet & tree_splits,
+                Split & split) const {
+            typedef typename TreeT::node_type node_type;
+            tree_splits.assign(tree, this->num_taxa_, taxon_index_fn);
+            if (tree_splits.empty() || this->num_trees_ == 0) {
+                return 0.0;
+            }
+            std::size_t root_idx = tree_splits.size() - 1;
+            const node_type * root = tree.head_node();
+            // in an unrooted tree, the two edges of a basal bifurcation are one split
+            const node_type * basal_child = nullptr;
+            if (!this->is_rooted_
+                    && root->first_child_node() != nullptr
+                    && root->first_child_node()->next_sibling_node() != nullptr
+                    && root->first_child_node()->next_sibling_node()->next_sibling_node() == nullptr) {
+                basal_child = root->first_child_node();
+            }
+            double log_num_trees = std::log(static_cast<double>(this->num_trees_));
+            double score = 0.0;
+            std::size_t idx = 0;
+            for (auto nd = tree.postorder_begin(); idx < root_idx; ++nd, ++idx) {
+                if (tree_splits.is_leaf(idx) || nd.node() == basal_child) {
+                    continue;
+                }
+                split.assign(tree_splits.words(idx), this->num_taxa_);
+                if (!this->is_rooted_) {
+                    split.normalize();
+                }
+                auto found = this->splits_.find(split);
+                if (found == this->splits_.end()) {
+                    return -std::numeric_limits<double>::infinity();
+                }
+                score += std::log(static_cast<double>(found->second.count)) - log_num_trees;
+            }
+            return score;
+        }
+
+        template <class WriterT>
+        static void write_words(WriterT & writer, const Split & split) {
+            for (std::size_t idx = 0; idx < split.num_words(); ++idx) {
+                writer.write_u64(split.words()[idx]);
+            }
+        }
+
+        // Reads the words of ``split``, which has ``num_taxa_`` taxa.
+        template <class ReaderT>
+        void read_words(ReaderT & reader, Split & split) const {
+            std::size_t num_words = split.num_words();
+            for (std::size_t idx = 0; idx < num_words; ++idx) {
+                split.words()[idx] = reader.read_u64();
+            }
+            if (num_words > 0 && (split.words()[num_words - 1] & ~split_words::last_word_mask(this->num_taxa_)) != 0) {
+                reader.fail("split with taxa beyond " + std::to_string(this->num_taxa_) + " taxa");
+            }
+        }
+
+        const SplitStatistics * find(const Split & split) const {
+            auto found = this->splits_.end();
+            if (!this->is_rooted_ && split.num_taxa() > 0 && split.test(0)) {
+                Split normalized(split);
+                normalized.normalize();
+                found = this->splits_.find(normalized);
+            } else {
+                found = this->splits_.find(split);
+            }
+            return found == this->splits_.end() ? nullptr : &(found->second);
+        }
+
+        // Splits with a frequency greater than ``min_frequency``, in order of
+        // decreasing count (ties broken by split order, so that the order is
+        // reproducible).
+        std::vector<typename split_map_type::const_iterator> get_sorted_splits(double min_frequency, bool include_trivial) const {
+            std::vector<typename split_map_type::const_iterator> entries;
+            std::size_t num_observed = this->observed_taxa_.count();
+            for (auto entry = this->splits_.cbegin(); entry != this->splits_.cend(); ++entry) {
+                if (static_cast<double>(entry->second.count) <= min_frequency * static_cast<double>(this->num_trees_)) {
+                    continue;
+                }
+                if (!include_trivial) {
+                    std::size_t n = entry->first.count();
+                    if (n <= 1 || (!this->is_rooted_ && n + 1 >= num_observed)) {
+                        continue;
+                    }
+                }
+                entries.push_back(entry);
+            }
+            std::sort(entries.begin(), entries.end(),
+                    [] (const typename split_map_type::const_iterator & a, const typename split_map_type::const_iterator & b) {
+                        if (a->second.count != b->second.count) {
+                            return a->second.count > b->second.count;
+                        }
+                        return a->first < b->first;
+                    });
+            return entries;
+        }
+
+    private:
+        std::size_t         num_taxa_;
+        bool                is_rooted_;
+        unsigned long       num_trees_;
+        split_map_type      splits_;
+        Split               observed_taxa_;
+        platypus::numeric::RunningStatistics<EdgeLengthT>   root_heights_;
+        // scratch space for add_tree()
+        SplitSet            tree_splits_;
+        Split               scratch_split_;
+        std::vector<EdgeLengthT>    pending_heights_;
+
+}; // SplitDistribution
+
+} // namespace platypus
+
+#endif
@@ -23,7 +23,10 @@
 #ifndef PLATYPUS_MODEL_STANDARDNODE_HPP
 #define PLATYPUS_MODEL_STANDARDNODE_HPP
 
+#include <string>
+#include <utility>
 #include "tree.hpp"
+#include "taxonnamespace.hpp"
 #include "../base/base_producer.hpp"
 #include "../base/base_reader.hpp"
 #include "../base/base_writer.hpp"
@@ -39,6 +42,10 @@ class StandardInterfaceNodeValue {
     public:
         virtual ~StandardInterfaceNodeValue() { }
         virtual void set_label(const std::string & label) = 0;
+        // Implementations that can take over ``label`` should override this.
+        virtual void set_label(std::string && label) {
+            this->set_label(static_cast<const std::string &>(label));
+        }
         virtual std::string & get_label() = 0;
         virtual const std::string & get_label() const = 0;
         virtual void set_edge_length(EdgeLengthT edge_length) = 0;
@@ -58,13 +65,17 @@ class StandardTreeInterface : public Tree<NodeValueT, TreeNodeAllocatorT> {
         StandardTreeInterface(const StandardTreeInterface & other)
                 : Tree<NodeValueT, TreeNodeAllocatorT>(other) {
         }
-        StandardTreeInterface(StandardTreeInterface && other)
-                : Tree<NodeValueT, TreeNodeAllocatorT>(other) {
+        StandardTreeInterface(StandardTreeInterface && other) noexcept
+                : Tree<NodeValueT, TreeNodeAllocatorT>(std::move(other)) {
         }
-        virtual StandardTreeInterface & operator=(StandardTreeInterface && other) {
+        StandardTreeInterface & operator=(const StandardTreeInterface & other) {
             Tree<NodeValueT, TreeNodeAllocatorT>::operator=(other);
             return * this;
         }
+        virtual StandardTreeInterface & operator=(StandardTreeInterface && other) noexcept {
+            Tree<NodeValueT, TreeNodeAllocatorT>::operator=(std::move(other));
+            return * this;
+        }
         virtual ~StandardTreeInterface() { }
         virtual bool is_rooted() const = 0;
         virtual void set_is_rooted(bool rooted) = 0;
@@ -82,6 +93,9 @@ class StandardNodeValue : public StandardInterfaceNodeValue<EdgeLengthT> {
         StandardNodeValue(const std::string & label)
             : label_(label)
               , edge_length_(0.0) { }
+        StandardNodeValue(std::string && label)
+            : label_(std::move(label))
+              , edge_length_(0.0) { }
         virtual ~StandardNodeValue() { }
         virtual StandardNodeValue & operator=(const StandardNodeValue & nd) {
             this->label_ = nd.label_;
@@ -96,6 +110,9 @@ class StandardNodeValue : public StandardInterfaceNodeValue<EdgeLengthT> {
         virtual void set_label(const std::string & label) override {
             this->label_ = label;
         }
+        virtual void set_label(std::string && label) override {
+            this->label_ = std::move(label);
+        }
         virtual std::string & get_label() override {
             return this->label_;
         }
@@ -125,13 +142,17 @@ template <class NodeValueT, class TreeNodeAllocatorT = std::allocator<TreeNode<N
 class StandardTree : public StandardTreeInterface<NodeValueT, TreeNodeAllocatorT> {
     public:
         StandardTree(bool is_rooted=false, bool manage_node_allocation=true)
-            : StandardTreeInterface<NodeValueT, TreeNodeAllocatorT>(manage_node_allocation)
+            : StandardTreeInterface<NodeValueT, TreeNodeAllocatorT>(is_rooted, manage_node_allocation)
             , is_rooted_(is_rooted) {
         }
         StandardTree(const StandardTree & other)
             : StandardTreeInterface<NodeValueT, TreeNodeAllocatorT>(other)
               , is_rooted_(other.is_rooted_) {
         }
+        StandardTree(StandardTree && other) noexcept
+            : StandardTreeInterface<NodeValueT, TreeNodeAllocatorT>(std::move(other))
+              , is_rooted_(other.is_rooted_) {
+        }
         virtual ~StandardTree() {
         }
         virtual StandardTree & operator=(const StandardTree & other) {
@@ -139,6 +160,11 @@ class StandardTree : public StandardTreeInterface<NodeValueT, TreeNodeAllocatorT
             this->is_rooted_ = other.is_rooted_;
             return * this;
         }
+        virtual StandardTree & operator=(StandardTree && other) noexcept {
+            Tree<NodeValueT, TreeNodeAllocatorT>::operator=(std::move(other));
+            this->is_rooted_ = other.is_rooted_;
+            return * this;
+        }
         virtual bool is_rooted() const {
             return this->is_rooted_;
         }
@@ -149,6 +175,56 @@ class StandardTree : public StandardTreeInterface<NodeValueT, TreeNodeAllocatorT
         bool is_rooted_;
 }; // StandardTree
 
+//////////////////////////////////////////////////////////////////////////////
+// StandardInterfaceSetters
+// Compile-time binding of setters to the standard interface (see
+// platypus::FunctionSetters).
+
+struct StandardInterfaceSetters {
+
+    template <class TreeT>
+    static inline void set_tree_is_rooted(TreeT & tree, bool is_rooted) {
+        tree.set_is_rooted(is_rooted);
+    }
+
+    // Assigns to the label in place (reusing its storage), rather than
+    // through ``set_label()``.
+    template <class ValueT, class LabelT>
+    static inline void set_node_label(ValueT & nv, const LabelT & label) {
+        nv.get_label().assign(label.data(), label.size());
+    }
+
+    template <class ValueT, class EdgeLengthT>
+    static inline void set_edge_length(ValueT & nv, EdgeLengthT length) {
+        nv.set_edge_length(length);
+    }
+
+}; // StandardInterfaceSetters
+
+//////////////////////////////////////////////////////////////////////////////
+// StandardInterfaceGetters
+// Compile-time binding of getters to the standard interface (see
+// platypus::FunctionGetters).
+
+struct StandardInterfaceGetters {
+
+    template <class TreeT>
+    static inline bool get_tree_is_rooted(const TreeT & tree) {
+        return tree.is_rooted();
+    }
+
+    template <class ValueT>
+    static inline auto get_node_label(const ValueT & nv) -> decltype(nv.get_label()) {
+        return nv.get_label();
+    }
+
+    template <class ValueT>
+    static inline auto get_edge_length(const ValueT & nv) -> decltype(nv.get_edge_length()) {
+        return nv.get_edge_length();
+    }
+
+}; // StandardInterfaceGetters
+
 //////////////////////////////////////////////////////////////////////////////
 // Functions
 
@@ -163,11 +239,16 @@ class StandardTree : public StandardTreeInterface<NodeValueT, TreeNodeAllocatorT
  *
  *      void set_label(const std::string &);
  *      void set_edge_length(double);
+ *
+ * and, optionally (labels are otherwise copied in through the above):
+ *
+ *      void set_label(std::string &&);
  */
 template <class TreeT, class EdgeLengthT=double>
 void bind_standard_interface(BaseTreeProducer<TreeT> & producer) {
     producer.set_tree_is_rooted_setter([] (TreeT & tree, bool rooted) { tree.set_is_rooted(rooted); });
     producer.set_node_label_setter([] (typename TreeT::value_type & nv, const std::string& label) { nv.set_label(label); });
+    producer.set_node_label_mover([] (typename TreeT::value_type & nv, std::string&& label) { nv.set_label(std::move(label)); });
     producer.set_edge_length_setter([] (typename TreeT::value_type & nv, EdgeLengthT length) { nv.set_edge_length(length); });
 }
 
@@ -190,5 +271,40 @@ void bind_standard_interface(BaseTreeWriter<TreeT> & writer) {
     writer.set_edge_length_getter([] (const typename TreeT::value_type & nv) -> EdgeLengthT {return nv.get_edge_length(); });
 }
 
+/**
+ * Binds ``taxon_namespace`` to ``producer``, so that the taxa of leaf nodes
+ * are recorded (see BaseTreeProducer::set_taxon_namespace()) through:
+ *
+ *      void set_taxon_index(platypus::TaxonNamespace::index_type);
+ *
+ * of TreeT::value_type (e.g., platypus::TaxonNodeValue).
+ */
+template <class TreeT, class EdgeLengthT>
+void bind_taxon_namespace(BaseTreeProducer<TreeT, EdgeLengthT> & producer, TaxonNamespace & taxon_namespace) {
+    producer.set_taxon_namespace(taxon_namespace,
+            [] (typename TreeT::value_type & nv, TaxonNamespace::index_type taxon_index) { nv.set_taxon_index(taxon_index); });
+}
+
+/**
+ * Binds the label getter of ``writer`` to write the label of the taxon of
+ * nodes associated with one, and the node's own label otherwise.
+ *
+ * `TreeT::value_type` will have to provide:
+ *
+ *      bool has_taxon() const;
+ *      platypus::TaxonNamespace::index_type get_taxon_index() const;
+ *      std::string get_label() const;
+ */
+template <class TreeT, class EdgeLengthT>
+void bind_taxon_namespace(BaseTreeWriter<TreeT, EdgeLengthT> & writer, const TaxonNamespace & taxon_namespace) {
+    const TaxonNamespace * tns = &taxon_namespace;
+    writer.set_node_label_getter([tns] (const typename TreeT::value_type & nv) -> std::string {
+        if (nv.has_taxon()) {
+            return tns->get_label(nv.get_taxon_index());
+        }
+        return nv.get_label();
+    });
+}
+
 } // namespae platypus
 #endif
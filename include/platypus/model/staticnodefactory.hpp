@@ -0,0 +1,159 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Compile-time node factory policies for trees.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_MODEL_STATICNODEFACTORY_HPP
+#define PLATYPUS_MODEL_STATICNODEFACTORY_HPP
+
+#include <utility>
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// DefaultNodeFactory
+
+/**
+ * Node factory policy for platypus::StaticNodeFactoryTree that creates
+ * leaf and internal nodes alike, through the (non-virtual) node creation
+ * and disposal methods of platypus::Tree.
+ *
+ * A policy is any class providing the static member function templates
+ * below; each is passed the tree for which nodes are being created or
+ * disposed of.
+ */
+struct DefaultNodeFactory {
+
+    template <class TreeT>
+    static inline typename TreeT::node_type * create_node(TreeT & tree) {
+        return tree.new_node();
+    }
+
+    template <class TreeT>
+    static inline typename TreeT::node_type * create_node(TreeT & tree, const typename TreeT::value_type & value) {
+        return tree.new_node(value);
+    }
+
+    template <class TreeT>
+    static inline typename TreeT::node_type * create_leaf_node(TreeT & tree) {
+        return tree.new_node();
+    }
+
+    template <class TreeT>
+    static inline typename TreeT::node_type * create_leaf_node(TreeT & tree, const typename TreeT::value_type & value) {
+        return tree.new_node(value);
+    }
+
+    template <class TreeT>
+    static inline typename TreeT::node_type * create_internal_node(TreeT & tree) {
+        return tree.new_node();
+    }
+
+    template <class TreeT>
+    static inline typename TreeT::node_type * create_internal_node(TreeT & tree, const typename TreeT::value_type & value) {
+        return tree.new_node(value);
+    }
+
+    template <class TreeT>
+    static inline void dispose_node(TreeT & tree, typename TreeT::node_type * nd) {
+        tree.delete_node(nd);
+    }
+
+}; // DefaultNodeFactory
+
+////////////////////////////////////////////////////////////////////////////////
+// StaticNodeFactoryTree
+
+/**
+ * Wraps a platypus::Tree (or any class derived from it, e.g.
+ * platypus::StandardTree), fixing the creation and disposal of nodes at
+ * compile time to the policy ``NodeFactoryT`` (see
+ * platypus::DefaultNodeFactory).
+ *
+ * The virtual node factory methods of the base tree are overridden as
+ * ``final``, so that calls made through a reference to this type (or a
+ * type derived from it), as the tree readers, tree pattern builders and
+ * coalescent simulator all do, are resolved at compile time and can be
+ * inlined into the calling loop. Combined with an allocator such as
+ * platypus::TreeNodeArena, node creation then reduces to a few pointer
+ * operations:
+ *
+ *      typedef platypus::StandardTree<Value, platypus::TreeNodeArena<platypus::TreeNode<Value>>> ArenaTree;
+ *      typedef platypus::StaticNodeFactoryTree<ArenaTree> FastTree;
+ *      platypus::NewickReader<FastTree> reader;
+ *
+ * Calls made through a reference to the base tree type still dispatch
+ * virtually, and reach the same policy.
+ *
+ * @tparam BaseTreeT
+ *   Specialization of, or class derived from, platypus::Tree.
+ * @tparam NodeFactoryT
+ *   Node factory policy.
+ */
+template <class BaseTreeT, class NodeFactoryT=DefaultNodeFactory>
+class StaticNodeFactoryTree : public BaseTreeT {
+
+    public:
+        typedef BaseTreeT                           base_tree_type;
+        typedef NodeFactoryT                        node_factory_type;
+        typedef typename BaseTreeT::node_type       node_type;
+        typedef typename BaseTreeT::value_type      value_type;
+
+    public:
+        using BaseTreeT::BaseTreeT;
+
+        StaticNodeFactoryTree() = default;
+        StaticNodeFactoryTree(const StaticNodeFactoryTree & other) = default;
+        StaticNodeFactoryTree(StaticNodeFactoryTree && other) = default;
+        StaticNodeFactoryTree & operator=(const StaticNodeFactoryTree & other) = default;
+        StaticNodeFactoryTree & operator=(StaticNodeFactoryTree && other) = default;
+
+        inline node_type * create_node() override final {
+            return NodeFactoryT::create_node(*this);
+        }
+
+        inline node_type * create_node(const value_type & value) override final {
+            return NodeFactoryT::create_node(*this, value);
+        }
+
+        inline node_type * create_leaf_node() override final {
+            return NodeFactoryT::create_leaf_node(*this);
+        }
+
+        inline node_type * create_leaf_node(const value_type & value) override final {
+            return NodeFactoryT::create_leaf_node(*this, value);
+        }
+
+        inline node_type * create_internal_node() override final {
+            return NodeFactoryT::create_internal_node(*this);
+        }
+
+        inline node_type * create_internal_node(const value_type & value) override final {
+            return NodeFactoryT::create_internal_node(*this, value);
+        }
+
+        inline void dispose_node(node_type * nd) override final {
+            NodeFactoryT::dispose_node(*this, nd);
+        }
+
+}; // StaticNodeFactoryTree
+
+} // namespace platypus
+
+#endif
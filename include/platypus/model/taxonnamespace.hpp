@@ -0,0 +1,244 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Taxon namespaces: shared, indexed sets of taxon labels.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_MODEL_TAXONNAMESPACE_HPP
+#define PLATYPUS_MODEL_TAXONNAMESPACE_HPP
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "../base/exception.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// TaxonNamespaceError
+
+class TaxonNamespaceError : public PlatypusException {
+    public:
+        TaxonNamespaceError(
+                    const std::string & filename,
+                    unsigned long line_num,
+                    const std::string & message)
+            : PlatypusException(filename, line_num, message) { }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// TaxonNamespace
+
+/**
+ * An indexed set of taxon labels, shared by a collection of trees, so that
+ * leaf nodes can refer to their taxon by a compact integer index (the order
+ * in which the taxon was added to the namespace, starting from 0) rather
+ * than each holding a copy of its label.
+ *
+ * A namespace is populated either explicitly (add_taxon()), or by tree
+ * readers that have been bound to it (see
+ * BaseTreeProducer::set_taxon_namespace()), which add the label of each
+ * leaf node if it is not already present. A namespace can be locked, after
+ * which adding a label not already present is an error
+ * (TaxonNamespaceError); this is useful when reading trees that must all be
+ * on the same, known, set of taxa.
+ *
+ * Adding taxa (and looking up labels by index) is thread-safe, so that a
+ * namespace can be populated by NewickReader::read_parallel(), but note
+ * that the indexes assigned to taxa are then in an unspecified order: add
+ * (or read) taxa beforehand if indexes need to be reproducible.
+ */
+class TaxonNamespace {
+
+    public:
+        typedef std::uint32_t       index_type;
+
+        static const index_type npos = std::numeric_limits<index_type>::max();
+
+    public:
+
+        TaxonNamespace()
+            : is_locked_(false) { }
+
+        template <class IterT>
+        TaxonNamespace(IterT labels_begin, IterT labels_end)
+            : is_locked_(false) {
+            for (; labels_begin != labels_end; ++labels_begin) {
+                this->add_taxon(*labels_begin);
+            }
+        }
+
+        TaxonNamespace(const TaxonNamespace &) = delete;
+        TaxonNamespace & operator=(const TaxonNamespace &) = delete;
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Taxa
+
+        /**
+         * Returns the index of the taxon with label ``label``, adding it if
+         * it is not already present (and the namespace is not locked).
+         */
+        index_type add_taxon(const std::string & label) {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            return this->add_taxon_unlocked(label);
+        }
+
+        // As above, for a label given as a character range.
+        index_type add_taxon(const char * data, std::size_t size) {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            this->scratch_.assign(data, size);
+            return this->add_taxon_unlocked(this->scratch_);
+        }
+
+        /**
+         * Returns the index of the taxon with label ``label``, or
+         * TaxonNamespace::npos if there is no such taxon.
+         */
+        index_type find_taxon(const std::string & label) const {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            auto found = this->indexes_.find(label);
+            if (found == this->indexes_.end()) {
+                return npos;
+            }
+            return found->second;
+        }
+
+        // The reference remains valid until the namespace is cleared.
+        const std::string & get_label(index_type idx) const {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            return this->labels_[idx];
+        }
+
+        std::size_t size() const {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            return this->labels_.size();
+        }
+
+        bool empty() const {
+            return this->size() == 0;
+        }
+
+        /**
+         * Labels of all taxa, in order of index; not to be called while
+         * taxa are being added.
+         */
+        inline const std::deque<std::string> & labels() const {
+            return this->labels_;
+        }
+
+        void clear() {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            this->labels_.clear();
+            this->indexes_.clear();
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Locking
+
+        inline void set_is_locked(bool is_locked) {
+            this->is_locked_ = is_locked;
+        }
+
+        inline bool is_locked() const {
+            return this->is_locked_;
+        }
+
+    private:
+
+        index_type add_taxon_unlocked(const std::string & label) {
+            auto found = this->indexes_.find(label);
+            if (found != this->indexes_.end()) {
+                return found->second;
+            }
+            if (this->is_locked_) {
+                throw TaxonNamespaceError(__FILE__, __LINE__, "platypus::TaxonNamespace: taxon not in locked namespace: '" + label + "'");
+            }
+            if (this->labels_.size() >= npos) {
+                throw TaxonNamespaceError(__FILE__, __LINE__, "platypus::TaxonNamespace: too many taxa");
+            }
+            index_type idx = static_cast<index_type>(this->labels_.size());
+            this->labels_.push_back(label);
+            this->indexes_.insert(std::make_pair(label, idx));
+            return idx;
+        }
+
+    private:
+        mutable std::mutex                              mutex_;
+        std::deque<std::string>                         labels_;
+        std::unordered_map<std::string, index_type>     indexes_;
+        std::string                                     scratch_;
+        bool                                            is_locked_;
+
+}; // TaxonNamespace
+
+////////////////////////////////////////////////////////////////////////////////
+// TaxonNodeValue
+
+/**
+ * A node value that identifies the taxon of a leaf node by its index in a
+ * platypus::TaxonNamespace (of which it holds no reference), so that
+ * comparing the taxa of nodes is an integer comparison. Nodes that are not
+ * associated with a taxon (internal nodes, or unlabeled leaves) have a
+ * taxon index of TaxonNamespace::npos, and may still carry a label of their
+ * own (e.g., a support value).
+ */
+template <class EdgeLengthT=double>
+class TaxonNodeValue {
+    public:
+        typedef TaxonNamespace::index_type  taxon_index_type;
+    public:
+        TaxonNodeValue()
+            : taxon_index_(TaxonNamespace::npos)
+            , edge_length_(0.0) { }
+        inline void set_taxon_index(taxon_index_type taxon_index) {
+            this->taxon_index_ = taxon_index;
+        }
+        inline taxon_index_type get_taxon_index() const {
+            return this->taxon_index_;
+        }
+        inline bool has_taxon() const {
+            return this->taxon_index_ != TaxonNamespace::npos;
+        }
+        inline void set_label(const std::string & label) {
+            this->label_ = label;
+        }
+        inline void set_label(std::string && label) {
+            this->label_ = std::move(label);
+        }
+        inline const std::string & get_label() const {
+            return this->label_;
+        }
+        inline void set_edge_length(EdgeLengthT edge_length) {
+            this->edge_length_ = edge_length;
+        }
+        inline EdgeLengthT get_edge_length() const {
+            return this->edge_length_;
+        }
+    private:
+        taxon_index_type    taxon_index_;
+        std::string         label_;
+        EdgeLengthT         edge_length_;
+}; // TaxonNodeValue
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,363 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Random subsampling of the tips of trees, and rarefaction.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_MODEL_TIPSUBSAMPLER_HPP
+#define PLATYPUS_MODEL_TIPSUBSAMPLER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "datatable.hpp"
+#include "inducedsubtree.hpp"
+#include "../numeric/rng.hpp"
+#include "../numeric/statistics.hpp"
+#include "../utility/parallel.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// TipSubsampler
+
+/**
+ * Draws random subsets of the leaves of a tree, and computes statistics of
+ * the subtrees they induce without building them, or builds them:
+ *
+ *      platypus::TipSubsampler<TreeType> subsampler(tree,
+ *              [](const NodeValue & nv) { return nv.get_edge_length(); });
+ *      // phylogenetic diversity and tree length of 10000 subsets of 50 tips
+ *      auto values = subsampler.compute_subsamples(50, 10000, seed, num_threads);
+ *      // mean, variance, etc. of each over subsets of 10, 20, ..., 100 tips
+ *      platypus::DataTable table;
+ *      subsampler.export_rarefaction(table, sizes, 10000, seed, num_threads);
+ *
+ * Subsets of ``k`` of the ``n`` leaves are drawn by Floyd's algorithm, with
+ * ``k`` draws from the random number generator. Leaves are identified by
+ * their index in leaves(), i.e., in preorder. The statistics of a subset
+ * are computed in a single pass over the nodes of the tree, held as flat
+ * arrays of parent indexes and edge lengths in preorder, which counts the
+ * leaves of the subset below each node:
+ *
+ *  -   the phylogenetic diversity (Faith's PD) of the subset is the total
+ *      length of the edges with a leaf of the subset below them, i.e., of
+ *      the union of the paths from the leaves to the root;
+ *  -   the tree length of the subtree induced by the subset (as built by
+ *      platypus::InducedSubtree, but for the edge of its root) is that of
+ *      the edges with some, but not all, of the leaves of the subset below
+ *      them.
+ *
+ * The edge of the head node is not counted in either.
+ *
+ * The batch functions draw subset ``i`` with a random number generator of
+ * its own, seeded from the master seed and ``i`` (see
+ * platypus::numeric::ReplicateRandomNumberGenerator), so that the results
+ * do not depend on the number of threads used.
+ *
+ * The subsampler holds a reference to the tree, and is invalidated if the
+ * tree is modified.
+ *
+ * @tparam TreeT
+ *   Type of tree (platypus::Tree or derived).
+ * @tparam EdgeLengthT
+ *   Type of edge length values.
+ */
+template <class TreeT, class EdgeLengthT=double>
+class TipSubsampler {
+
+    public:
+        typedef typename TreeT::node_type       node_type;
+        typedef typename TreeT::value_type      value_type;
+        typedef std::function<EdgeLengthT (const value_type &)> edge_length_getter_type;
+
+        struct Statistics {
+            Statistics()
+                : phylogenetic_diversity(0)
+                , tree_length(0) { }
+            EdgeLengthT     phylogenetic_diversity;
+            EdgeLengthT     tree_length;
+        };
+
+    public:
+
+        TipSubsampler(const TreeT & tree, const edge_length_getter_type & edge_length_getter)
+            : tree_(&tree)
+            , edge_length_getter_(edge_length_getter) {
+            std::unordered_map<const node_type *, std::size_t> node_indexes;
+            for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+                const node_type * nd = ndi.node();
+                std::size_t idx = this->parents_.size();
+                node_indexes[nd] = idx;
+                this->parents_.push_back(nd->parent_node() == nullptr ? 0 : node_indexes[nd->parent_node()]);
+                this->edge_lengths_.push_back(idx == 0 ? EdgeLengthT() : edge_length_getter(nd->value()));
+                if (nd->is_leaf()) {
+                    this->leaves_.push_back(nd);
+                    this->leaf_nodes_.push_back(idx);
+                }
+            }
+            this->counts_.assign(this->parents_.size(), 0);
+            this->is_drawn_.assign(this->leaves_.size(), 0);
+        }
+
+        inline std::size_t num_leaves() const {
+            return this->leaves_.size();
+        }
+
+        // Leaves of the tree, in preorder.
+        inline const std::vector<const node_type *> & leaves() const {
+            return this->leaves_;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Single subsets
+
+        /**
+         * Draws a subset of ``k`` distinct leaves uniformly at random, into
+         * ``subset`` (as indexes into leaves(), in no particular order).
+         */
+        template <class RngT>
+        void draw(unsigned long k, RngT & rng, std::vector<std::size_t> & subset) {
+            std::size_t n = this->leaves_.size();
+            if (k > n) {
+                throw std::invalid_argument("platypus::TipSubsampler: more tips requested than there are leaves");
+            }
+            subset.clear();
+            subset.reserve(k);
+            for (std::size_t j = n - k; j < n; ++j) {
+                std::size_t t = static_cast<std::size_t>(rng.uniform_pos_int(0, j));
+                std::size_t leaf_idx = this->is_drawn_[t] ? j : t;
+                this->is_drawn_[leaf_idx] = 1;
+                subset.push_back(leaf_idx);
+            }
+            for (auto leaf_idx : subset) {
+                this->is_drawn_[leaf_idx] = 0;
+            }
+        }
+
+        // Statistics of the subset of the leaves with indexes in ``subset``.
+        Statistics compute(const std::vector<std::size_t> & subset) {
+            Statistics values;
+            unsigned long k = subset.size();
+            std::size_t num_nodes = this->parents_.size();
+            std::fill(this->counts_.begin(), this->counts_.end(), 0);
+            for (auto leaf_idx : subset) {
+                this->counts_[this->leaf_nodes_[leaf_idx]] = 1;
+            }
+            for (std::size_t idx = num_nodes; idx-- > 1; ) {
+                unsigned long count = this->counts_[idx];
+                this->counts_[this->parents_[idx]] += count;
+                EdgeLengthT length = this->edge_lengths_[idx];
+                values.phylogenetic_diversity += count > 0 ? length : EdgeLengthT();
+                values.tree_length += count > 0 && count < k ? length : EdgeLengthT();
+            }
+            return values;
+        }
+
+        /**
+         * Builds the subtree of the tree induced by the leaves with indexes
+         * in ``subset`` into ``dest_tree``, through
+         * InducedSubtree::extract(), with the leaves identified to it by
+         * ``taxon_index_fn`` (which must give distinct indexes to the leaves
+         * of the tree).
+         *
+         * @return
+         *   The number of leaves kept.
+         */
+        template <class DestTreeT, class TaxonIndexFnT, class CopyValueFnT, class EdgeLengthSetterT>
+        unsigned long extract(const std::vector<std::size_t> & subset,
+                DestTreeT & dest_tree,
+                TaxonIndexFnT taxon_index_fn,
+                CopyValueFnT copy_value_fn,
+                EdgeLengthSetterT edge_length_setter) const {
+            std::vector<std::size_t> taxon_indexes;
+            taxon_indexes.reserve(subset.size());
+            for (auto leaf_idx : subset) {
+                taxon_indexes.push_back(static_cast<std::size_t>(taxon_index_fn(this->leaves_[leaf_idx]->value())));
+            }
+            InducedSubtree induced_subtree(taxon_indexes);
+            return induced_subtree.extract(*this->tree_,
+                    dest_tree,
+                    taxon_index_fn,
+                    copy_value_fn,
+                    this->edge_length_getter_,
+                    edge_length_setter);
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Batches
+
+        /**
+         * Returns the statistics of each of ``num_subsamples`` random subsets
+         * of ``k`` leaves, drawn and computed with up to ``num_threads``
+         * threads (see resolve_num_threads()).
+         */
+        template <class RngT=platypus::numeric::RandomNumberGenerator>
+        std::vector<Statistics> compute_subsamples(unsigned long k,
+                unsigned long num_subsamples,
+                std::uint64_t master_seed,
+                unsigned int num_threads=1) const {
+            std::vector<Statistics> values(num_subsamples);
+            this->for_each_block(num_subsamples, num_threads, [&] (TipSubsampler & subsampler, std::size_t begin_idx, std::size_t end_idx) {
+                std::vector<std::size_t> subset;
+                for (std::size_t idx = begin_idx; idx < end_idx; ++idx) {
+                    RngT rng = platypus::numeric::ReplicateRandomNumberGenerator<RngT>::create(master_seed, idx);
+                    subsampler.draw(k, rng, subset);
+                    values[idx] = subsampler.compute(subset);
+                }
+            });
+            return values;
+        }
+
+        /**
+         * Builds the subtrees induced by ``num_subsamples`` random subsets of
+         * ``k`` leaves (the same subsets as compute_subsamples() for the same
+         * seed) into the trees of the range starting at ``dest_begin``; see
+         * extract().
+         */
+        template <class RngT=platypus::numeric::RandomNumberGenerator, class DestIterT, class TaxonIndexFnT, class CopyValueFnT, class EdgeLengthSetterT>
+        void extract_subsamples(unsigned long k,
+                unsigned long num_subsamples,
+                std::uint64_t master_seed,
+                DestIterT dest_begin,
+                TaxonIndexFnT taxon_index_fn,
+                CopyValueFnT copy_value_fn,
+                EdgeLengthSetterT edge_length_setter,
+                unsigned int num_threads=1) const {
+            this->for_each_block(num_subsamples, num_threads, [&] (TipSubsampler & subsampler, std::size_t begin_idx, std::size_t end_idx) {
+                std::vector<std::size_t> subset;
+                DestIterT dest_iter = dest_begin;
+                std::advance(dest_iter, begin_idx);
+                for (std::size_t idx = begin_idx; idx < end_idx; ++idx, ++dest_iter) {
+                    RngT rng = platypus::numeric::ReplicateRandomNumberGenerator<RngT>::create(master_seed, idx);
+                    subsampler.draw(k, rng, subset);
+                    subsampler.extract(subset, *dest_iter, taxon_index_fn, copy_value_fn, edge_length_setter);
+                }
+            });
+        }
+
+        /**
+         * Adds a row to ``table`` for each number of leaves in ``sizes``,
+         * summarizing the statistics of ``num_subsamples`` random subsets of
+         * that many leaves (drawn as by compute_subsamples(), with the
+         * master seed derived from ``master_seed`` and the number of
+         * leaves), with columns:
+         *
+         *  -   "num_leaves" (key column): the number of leaves;
+         *  -   "phylogenetic_diversity_mean", "phylogenetic_diversity_variance"
+         *      (sample variance), "phylogenetic_diversity_min" and
+         *      "phylogenetic_diversity_max";
+         *  -   "tree_length_mean", "tree_length_variance", "tree_length_min"
+         *      and "tree_length_max".
+         *
+         * If ``table`` has no columns, they are added first; otherwise it
+         * must have (at least) these columns.
+         */
+        template <class RngT=platypus::numeric::RandomNumberGenerator>
+        void export_rarefaction(DataTable & table,
+                const std::vector<unsigned long> & sizes,
+                unsigned long num_subsamples,
+                std::uint64_t master_seed,
+                unsigned int num_threads=1) const {
+            const char * statistic_names[] = {"phylogenetic_diversity", "tree_length"};
+            if (table.num_columns() == 0) {
+                table.add_key_column<unsigned long>("num_leaves");
+                for (auto name : statistic_names) {
+                    table.add_data_column<double>(std::string(name) + "_mean");
+                    table.add_data_column<double>(std::string(name) + "_variance");
+                    table.add_data_column<double>(std::string(name) + "_min");
+                    table.add_data_column<double>(std::string(name) + "_max");
+                }
+            }
+            auto num_leaves_handle = table.column_handle<unsigned long>("num_leaves");
+            std::vector<DataTableColumnHandle<double>> handles;
+            for (auto name : statistic_names) {
+                handles.push_back(table.column_handle<double>(std::string(name) + "_mean"));
+                handles.push_back(table.column_handle<double>(std::string(name) + "_variance"));
+                handles.push_back(table.column_handle<double>(std::string(name) + "_min"));
+                handles.push_back(table.column_handle<double>(std::string(name) + "_max"));
+            }
+            for (auto k : sizes) {
+                std::vector<Statistics> values = this->template compute_subsamples<RngT>(k,
+                        num_subsamples,
+                        platypus::numeric::derive_seed(master_seed, k),
+                        num_threads);
+                platypus::numeric::RunningStatistics<> pd_stats;
+                platypus::numeric::RunningStatistics<> length_stats;
+                for (auto & v : values) {
+                    pd_stats.add(static_cast<long double>(v.phylogenetic_diversity));
+                    length_stats.add(static_cast<long double>(v.tree_length));
+                }
+                auto & row = table.add_row();
+                row.set(num_leaves_handle, k);
+                std::size_t handle_idx = 0;
+                for (auto stats : {&pd_stats, &length_stats}) {
+                    row.set(handles[handle_idx++], static_cast<double>(stats->mean()));
+                    row.set(handles[handle_idx++], static_cast<double>(stats->sample_variance()));
+                    row.set(handles[handle_idx++], static_cast<double>(stats->minimum()));
+                    row.set(handles[handle_idx++], static_cast<double>(stats->maximum()));
+                }
+            }
+        }
+
+    private:
+
+        // Calls ``fn`` with a subsampler of its own and the bounds of each of
+        // up to ``num_threads`` contiguous blocks of [0, ``num_items``).
+        template <class FnT>
+        void for_each_block(std::size_t num_items, unsigned int num_threads, FnT fn) const {
+            num_threads = resolve_num_threads(num_threads);
+            std::size_t num_blocks = num_threads < num_items ? num_threads : num_items;
+            if (num_blocks == 0) {
+                return;
+            }
+            std::size_t block_size = (num_items + num_blocks - 1) / num_blocks;
+            std::vector<TipSubsampler> subsamplers(num_blocks, *this);
+            parallel_for(num_blocks, static_cast<unsigned int>(num_blocks), [&] (std::size_t block_idx) {
+                std::size_t begin_idx = block_idx * block_size;
+                std::size_t end_idx = begin_idx + block_size < num_items ? begin_idx + block_size : num_items;
+                if (begin_idx < end_idx) {
+                    fn(subsamplers[block_idx], begin_idx, end_idx);
+                }
+            });
+        }
+
+    private:
+        const TreeT *                       tree_;
+        edge_length_getter_type             edge_length_getter_;
+        std::vector<std::size_t>            parents_;
+        std::vector<EdgeLengthT>            edge_lengths_;
+        std::vector<const node_type *>      leaves_;
+        // index of the node of each leaf in ``parents_``
+        std::vector<std::size_t>            leaf_nodes_;
+        // leaves of the subset below each node
+        std::vector<unsigned long>          counts_;
+        // leaves drawn so far in draw()
+        std::vector<char>                   is_drawn_;
+
+}; // TipSubsampler
+
+} // namespace platypus
+
+#endif
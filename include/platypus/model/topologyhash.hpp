@@ -0,0 +1,647 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Canonical hashing of tree topologies, and a cache of distinct topologies.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+
+#ifndef PLATYPUS_MODEL_TOPOLOGYHASH_HPP
+#define PLATYPUS_MODEL_TOPOLOGYHASH_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../utility/parallel.hpp"
+
+namespace platypus {
+
+namespace topology_hash {
+
+// SplitMix64 finalizer
+inline std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+inline std::uint64_t leaf_hash(std::size_t taxon_idx) {
+    return mix(0x51afd7ed558ccd1fULL ^ static_cast<std::uint64_t>(taxon_idx));
+}
+
+// Hash of a subtree as seen across the edge subtending it.
+inline std::uint64_t edge_hash(std::uint64_t subtree_hash, double edge_length) {
+    // so that 0.0 and -0.0 hash alike
+    if (edge_length == 0.0) {
+        edge_length = 0.0;
+    }
+    std::uint64_t bits;
+    std::memcpy(&bits, &edge_length, sizeof(bits));
+    return mix(subtree_hash ^ mix(bits + 0x9e3779b97f4a7c15ULL));
+}
+
+// Hash of a node given the (sorted) edge hashes of its neighbours.
+template <class IterT>
+inline std::uint64_t node_hash(IterT begin, IterT end) {
+    std::uint64_t h = mix(0xc2b2ae3d27d4eb4fULL + static_cast<std::uint64_t>(std::distance(begin, end)));
+    for (; begin != end; ++begin) {
+        h = mix(h ^ *begin);
+    }
+    return h;
+}
+
+} // namespace topology_hash
+
+////////////////////////////////////////////////////////////////////////////////
+// TopologyHash
+
+/**
+ * Computes a 64-bit hash of the topology of a tree that does not depend on
+ * the order of children, in one postorder pass in which the hash of each
+ * subtree is composed from the sorted hashes of its child subtrees:
+ *
+ *      platypus::TopologyHash<TreeType> topology_hash(
+ *              [](const NodeValue & nv) { return nv.get_taxon_index(); });
+ *      if (topology_hash.compute(tree1) == topology_hash.compute(tree2)) ...
+ *
+ * Leaves are identified by the index of their taxon, as returned by the
+ * taxon index getter. If an edge length getter is given, edge lengths
+ * (other than that of the root) are hashed along with the subtree they
+ * subtend, and compared exactly; otherwise only the topology counts.
+ *
+ * If the hash is unrooted, the tree is hashed as if rooted at the leaf with
+ * the smallest taxon index, so that all rootings of an unrooted tree hash
+ * alike. Root edges are then suppressed, as are bifurcating roots (whose two
+ * edges count as a single edge, of the combined length). Other nodes with a
+ * single child are kept.
+ *
+ * Distinct topologies hash alike with negligible probability (about
+ * ``n^2 / 2^65`` for ``n`` distinct topologies), which is what TopologyCache
+ * relies on.
+ *
+ * The scratch storage of a TopologyHash object is reused between trees, so
+ * compute() must not be called concurrently on the same object.
+ *
+ * @tparam TreeT
+ *   Type of tree (platypus::Tree or derived).
+ * @tparam EdgeLengthT
+ *   Type of edge length values.
+ */
+template <class TreeT, class EdgeLengthT=double>
+class TopologyHash {
+
+    public:
+        typedef typename TreeT::node_type                       node_type;
+        typedef typename TreeT::value_type                      value_type;
+        typedef std::function<std::size_t (const value_type &)> taxon_index_getter_type;
+        typedef std::function<EdgeLengthT (const value_type &)> edge_length_getter_type;
+
+    public:
+
+        /**
+         * @param taxon_index_getter
+         *   Returns the index of the taxon associated with the value of a
+         *   leaf node.
+         * @param is_rooted
+         *   If false, all rootings of the same unrooted tree hash alike.
+         * @param edge_length_getter
+         *   If empty, edge lengths are ignored.
+         */
+        TopologyHash(const taxon_index_getter_type & taxon_index_getter,
+                bool is_rooted=true,
+                const edge_length_getter_type & edge_length_getter=edge_length_getter_type())
+            : taxon_index_getter_(taxon_index_getter)
+            , edge_length_getter_(edge_length_getter)
+            , is_rooted_(is_rooted)
+            , anchor_hash_(0) { }
+
+        TopologyHash(const TopologyHash & other)
+            : taxon_index_getter_(other.taxon_index_getter_)
+            , edge_length_getter_(other.edge_length_getter_)
+            , is_rooted_(other.is_rooted_)
+            , anchor_hash_(0) { }
+
+        bool is_rooted() const {
+            return this->is_rooted_;
+        }
+
+        bool has_edge_lengths() const {
+            return static_cast<bool>(this->edge_length_getter_);
+        }
+
+        /**
+         * Returns the hash of ``tree`` (which must not be empty).
+         */
+        std::uint64_t compute(const TreeT & tree) {
+            this->subtrees_.clear();
+            this->path_.clear();
+            this->path_others_.clear();
+            this->path_offsets_.clear();
+            if (!this->is_rooted_) {
+                // the path from the anchoring leaf up to the root
+                const node_type * anchor = nullptr;
+                std::size_t anchor_taxon_idx = 0;
+                for (auto ndi = tree.leaf_begin(); ndi != tree.leaf_end(); ++ndi) {
+                    std::size_t taxon_idx = this->taxon_index_getter_(ndi.node()->value());
+                    if (anchor == nullptr || taxon_idx < anchor_taxon_idx) {
+                        anchor = ndi.node();
+                        anchor_taxon_idx = taxon_idx;
+                    }
+                }
+                this->anchor_hash_ = topology_hash::leaf_hash(anchor_taxon_idx);
+                for (const node_type * nd = anchor; nd != nullptr; nd = nd->parent_node()) {
+                    this->path_.push_back(nd);
+                }
+            }
+            // path nodes are visited in order, from the anchor up
+            std::size_t path_pos = 0;
+            for (auto ndi = tree.postorder_begin(); ndi != tree.postorder_end(); ++ndi) {
+                const node_type * nd = ndi.node();
+                Subtree subtree;
+                subtree.hash = 0;
+                subtree.edge_length = nd == tree.head_node() ? EdgeLengthT() : this->get_edge_length(nd);
+                subtree.is_on_path = path_pos < this->path_.size() && nd == this->path_[path_pos];
+                if (nd->is_leaf()) {
+                    subtree.hash = topology_hash::leaf_hash(this->taxon_index_getter_(nd->value()));
+                } else {
+                    // the children are the topmost subtrees on the stack
+                    std::size_t num_children = nd->num_child_nodes();
+                    std::size_t first = this->subtrees_.size() - num_children;
+                    if (subtree.is_on_path) {
+                        // set aside the children off the path, to be combined
+                        // with the rest of the tree once it has been visited
+                        this->path_offsets_.push_back(this->path_others_.size());
+                        for (std::size_t idx = first; idx < this->subtrees_.size(); ++idx) {
+                            if (!this->subtrees_[idx].is_on_path) {
+                                this->path_others_.push_back(this->subtrees_[idx]);
+                            }
+                        }
+                    } else {
+                        subtree.hash = this->combine(this->subtrees_.begin() + first, this->subtrees_.end(), nullptr);
+                    }
+                    this->subtrees_.resize(first);
+                }
+                if (subtree.is_on_path) {
+                    ++path_pos;
+                }
+                this->subtrees_.push_back(subtree);
+            }
+            if (this->is_rooted_) {
+                return this->subtrees_.back().hash;
+            }
+            return this->compute_unrooted();
+        }
+
+        /**
+         * Returns the hashes of the trees in [``trees_begin``,
+         * ``trees_end``) (forward iterators), in order, computed
+         * concurrently by ``num_threads`` threads (see
+         * resolve_num_threads()).
+         */
+        template <class IterT>
+        std::vector<std::uint64_t> compute_trees(IterT trees_begin,
+                IterT trees_end,
+                unsigned int num_threads=1) const {
+            std::vector<IterT> trees;
+            for (; trees_begin != trees_end; ++trees_begin) {
+                trees.push_back(trees_begin);
+            }
+            std::vector<std::uint64_t> hashes(trees.size());
+            num_threads = resolve_num_threads(num_threads);
+            std::size_t num_blocks = std::min<std::size_t>(num_threads, trees.size());
+            if (num_blocks == 0) {
+                return hashes;
+            }
+            std::size_t block_size = (trees.size() + num_blocks - 1) / num_blocks;
+            parallel_for(num_blocks, num_threads, [&] (std::size_t block_idx) {
+                TopologyHash topology_hash(*this);
+                std::size_t begin_idx = block_idx * block_size;
+                std::size_t end_idx = std::min(begin_idx + block_size, trees.size());
+                for (std::size_t idx = begin_idx; idx < end_idx; ++idx) {
+                    hashes[idx] = topology_hash.compute(*trees[idx]);
+                }
+            });
+            return hashes;
+        }
+
+    private:
+        struct Subtree {
+            std::uint64_t   hash;
+            EdgeLengthT     edge_length;
+            bool            is_on_path;
+        };
+        typedef typename std::vector<Subtree>::iterator subtree_iterator;
+
+        EdgeLengthT get_edge_length(const node_type * nd) const {
+            if (this->edge_length_getter_) {
+                return this->edge_length_getter_(nd->value());
+            }
+            return EdgeLengthT();
+        }
+
+        // Hash of a node with neighbouring subtrees [``begin``, ``end``) and,
+        // if not null, ``extra``.
+        std::uint64_t combine(subtree_iterator begin, subtree_iterator end, const Subtree * extra) {
+            this->edge_hashes_.clear();
+            for (; begin != end; ++begin) {
+                this->edge_hashes_.push_back(topology_hash::edge_hash(begin->hash, static_cast<double>(begin->edge_length)));
+            }
+            if (extra != nullptr) {
+                this->edge_hashes_.push_back(topology_hash::edge_hash(extra->hash, static_cast<double>(extra->edge_length)));
+            }
+            std::sort(this->edge_hashes_.begin(), this->edge_hashes_.end());
+            return topology_hash::node_hash(this->edge_hashes_.begin(), this->edge_hashes_.end());
+        }
+
+        // Walks down from the root to the anchoring leaf, carrying the hash
+        // of the part of the tree above each path node.
+        std::uint64_t compute_unrooted() {
+            std::size_t num_path_nodes = this->path_.size();
+            if (num_path_nodes == 1) {
+                return this->anchor_hash_;
+            }
+            this->path_offsets_.push_back(this->path_others_.size());
+            // ``path_offsets_[pos - 1]`` is the start of the children set
+            // aside for ``path_[pos]``
+            auto others_begin = [this] (std::size_t pos) { return this->path_others_.begin() + this->path_offsets_[pos - 1]; };
+            auto others_end = [this] (std::size_t pos) { return this->path_others_.begin() + this->path_offsets_[pos]; };
+            Subtree above;
+            bool has_above = false;
+            std::size_t root_pos = num_path_nodes - 1;
+            const node_type * below = this->path_[root_pos - 1];
+            std::size_t num_root_others = static_cast<std::size_t>(others_end(root_pos) - others_begin(root_pos));
+            if (num_root_others == 1) {
+                // bifurcating root: joins the edges of its two children
+                above = *others_begin(root_pos);
+                above.edge_length += this->get_edge_length(below);
+                has_above = true;
+            } else if (num_root_others > 1) {
+                above.hash = this->combine(others_begin(root_pos), others_end(root_pos), nullptr);
+                above.edge_length = this->get_edge_length(below);
+                has_above = true;
+            }
+            for (std::size_t pos = root_pos - 1; pos > 0; --pos) {
+                above.hash = this->combine(others_begin(pos), others_end(pos), has_above ? &above : nullptr);
+                above.edge_length = this->get_edge_length(this->path_[pos - 1]);
+                has_above = true;
+            }
+            if (!has_above) {
+                return this->anchor_hash_;
+            }
+            return topology_hash::mix(this->anchor_hash_ ^ topology_hash::edge_hash(above.hash, static_cast<double>(above.edge_length)));
+        }
+
+    private:
+        taxon_index_getter_type         taxon_index_getter_;
+        edge_length_getter_type         edge_length_getter_;
+        bool                            is_rooted_;
+        std::uint64_t                   anchor_hash_;
+        std::vector<Subtree>            subtrees_;
+        std::vector<const node_type *>  path_;
+        std::vector<Subtree>            path_others_;
+        std::vector<std::size_t>        path_offsets_;
+        std::vector<std::uint64_t>      edge_hashes_;
+
+}; // TopologyHash
+
+////////////////////////////////////////////////////////////////////////////////
+// TopologyCache
+
+/**
+ * Counts the distinct topologies (as identified by a TopologyHash) in a
+ * stream of trees, keeping a single copy of each, in order of first
+ * occurrence:
+ *
+ *      platypus::TopologyCache<TreeType> cache(topology_hash);
+ *      reader.read_each(src, tree, [&cache](TreeType & t) { cache.add_tree(std::move(t)); });
+ *      for (auto & topology : cache) {
+ *          ... topology.tree ... topology.count ...
+ *      }
+ *
+ * @tparam TreeT
+ *   Type of tree (platypus::Tree or derived).
+ * @tparam EdgeLengthT
+ *   Type of edge length values.
+ */
+template <class TreeT, class EdgeLengthT=double>
+class TopologyCache {
+
+    public:
+        typedef TopologyHash<TreeT, EdgeLengthT> topology_hash_type;
+        struct Topology {
+            std::uint64_t   hash;
+            // the first tree with this topology
+            TreeT           tree;
+            // number of trees with this topology
+            unsigned long   count;
+            // index of the first tree with this topology among all trees added
+            unsigned long   first_index;
+        };
+        typedef typename std::vector<Topology>::const_iterator const_iterator;
+
+        static constexpr std::size_t npos() {
+            return static_cast<std::size_t>(-1);
+        }
+
+    public:
+        TopologyCache(const topology_hash_type & topology_hash)
+            : topology_hash_(topology_hash)
+            , num_trees_(0) { }
+
+        /**
+         * Counts ``tree``, storing a copy of it if its topology has not been
+         * seen before.
+         *
+         * @return
+         *   ``true`` if the topology of ``tree`` is new.
+         */
+        bool add_tree(const TreeT & tree) {
+            std::uint64_t hash = this->topology_hash_.compute(tree);
+            if (this->count(hash)) {
+                return false;
+            }
+            this->insert(hash, TreeT(tree));
+            return true;
+        }
+
+        // As above, but moves ``tree`` into the cache if its topology is new.
+        bool add_tree(TreeT && tree) {
+            std::uint64_t hash = this->topology_hash_.compute(tree);
+            if (this->count(hash)) {
+                return false;
+            }
+            this->insert(hash, std::move(tree));
+            return true;
+        }
+
+        /**
+         * Adds the trees in [``trees_begin``, ``trees_end``) (forward
+         * iterators) in order, hashing them concurrently by ``num_threads``
+         * threads (see TopologyHash::compute_trees()).
+         *
+         * @return
+         *   The number of new topologies.
+         */
+        template <class IterT>
+        std::size_t add_trees(IterT trees_begin,
+                IterT trees_end,
+                unsigned int num_threads=1) {
+            std::vector<std::uint64_t> hashes = this->topology_hash_.compute_trees(trees_begin, trees_end, num_threads);
+            std::size_t num_new = 0;
+            for (std::size_t idx = 0; idx < hashes.size(); ++idx, ++trees_begin) {
+                if (!this->count(hashes[idx])) {
+                    this->insert(hashes[idx], TreeT(*trees_begin));
+                    ++num_new;
+                }
+            }
+            return num_new;
+        }
+
+        // Index of the topology with hash ``hash``, or npos() if not seen.
+        std::size_t find(std::uint64_t hash) const {
+            auto found = this->indexes_.find(hash);
+            return found == this->indexes_.end() ? npos() : found->second;
+        }
+
+        std::size_t find(const TreeT & tree) {
+            return this->find(this->topology_hash_.compute(tree));
+        }
+
+        // Number of distinct topologies.
+        std::size_t size() const {
+            return this->topologies_.size();
+        }
+
+        // Number of trees added.
+        unsigned long get_num_trees() const {
+            return this->num_trees_;
+        }
+
+        const Topology & operator[](std::size_t idx) const {
+            return this->topologies_[idx];
+        }
+
+        const_iterator begin() const {
+            return this->topologies_.cbegin();
+        }
+
+        const_iterator end() const {
+            return this->topologies_.cend();
+        }
+
+        void clear() {
+            this->topologies_.clear();
+            this->indexes_.clear();
+            this->num_trees_ = 0;
+        }
+
+    private:
+        // Counts a tree with the given hash, returning false if it is new.
+        bool count(std::uint64_t hash) {
+            ++this->num_trees_;
+            auto found = this->indexes_.find(hash);
+            if (found == this->indexes_.end()) {
+                return false;
+            }
+            ++this->topologies_[found->second].count;
+            return true;
+        }
+
+        void insert(std::uint64_t hash, TreeT && tree) {
+            this->indexes_.emplace(hash, this->topologies_.size());
+            this->topologies_.push_back(Topology{hash, std::move(tree), 1, this->num_trees_ - 1});
+        }
+
+    private:
+        topology_hash_type                              topology_hash_;
+        std::vector<Topology>                           topologies_;
+        std::unordered_map<std::uint64_t, std::size_t>  indexes_;
+        unsigned long                                   num_trees_;
+
+}; // TopologyCache
+
+////////////////////////////////////////////////////////////////////////////////
+// TopologyCounts
+
+/**
+ * Counts the distinct topologies in a stream of trees by their hashes (see
+ * TopologyHash) alone, in order of first occurrence, without keeping the
+ * trees (unlike TopologyCache), so that the counts of shards of a
+ * collection can be computed separately and merged:
+ *
+ *      platypus::TopologyCounts counts;
+ *      for (auto hash : topology_hash.compute_trees(trees.cbegin(), trees.cend(), num_threads)) {
+ *          counts.add(hash);
+ *      }
+ *      platypus::save_partial_state(counts, path);
+ *
+ * merge() (and merge_state()) take the trees of the other counts to follow
+ * those of this one, so that merging the counts of consecutive shards in
+ * order gives the same counts, first indexes and order of topologies as
+ * counting all the trees at once.
+ */
+class TopologyCounts {
+
+    public:
+        struct Topology {
+            std::uint64_t   hash;
+            // number of trees with this topology
+            unsigned long   count;
+            // index of the first tree with this topology among all trees added
+            unsigned long   first_index;
+        };
+        typedef std::vector<Topology>::const_iterator const_iterator;
+
+        static constexpr std::size_t npos() {
+            return static_cast<std::size_t>(-1);
+        }
+
+    public:
+        TopologyCounts()
+            : num_trees_(0) { }
+
+        /**
+         * Counts a tree with the given hash.
+         *
+         * @return
+         *   ``true`` if the topology is new.
+         */
+        bool add(std::uint64_t hash) {
+            return this->insert_count(hash, 1, this->num_trees_++);
+        }
+
+        // Counts trees with the hashes in [``hashes_begin``, ``hashes_end``), in order.
+        template <class IterT>
+        std::size_t add(IterT hashes_begin, IterT hashes_end) {
+            std::size_t num_new = 0;
+            for (; hashes_begin != hashes_end; ++hashes_begin) {
+                num_new += this->add(*hashes_begin) ? 1 : 0;
+            }
+            return num_new;
+        }
+
+        // Adds the counts of ``other``, whose trees follow those added so far.
+        void merge(const TopologyCounts & other) {
+            for (auto & topology : other.topologies_) {
+                this->insert_count(topology.hash, topology.count, this->num_trees_ + topology.first_index);
+            }
+            this->num_trees_ += other.num_trees_;
+        }
+
+        // Index of the topology with hash ``hash``, or npos() if not seen.
+        std::size_t find(std::uint64_t hash) const {
+            auto found = this->indexes_.find(hash);
+            return found == this->indexes_.end() ? npos() : found->second;
+        }
+
+        // Number of trees with hash ``hash``.
+        unsigned long get_count(std::uint64_t hash) const {
+            std::size_t idx = this->find(hash);
+            return idx == npos() ? 0 : this->topologies_[idx].count;
+        }
+
+        // Number of distinct topologies.
+        std::size_t size() const {
+            return this->topologies_.size();
+        }
+
+        // Number of trees added.
+        unsigned long get_num_trees() const {
+            return this->num_trees_;
+        }
+
+        const Topology & operator[](std::size_t idx) const {
+            return this->topologies_[idx];
+        }
+
+        const_iterator begin() const {
+            return this->topologies_.cbegin();
+        }
+
+        const_iterator end() const {
+            return this->topologies_.cend();
+        }
+
+        void clear() {
+            this->topologies_.clear();
+            this->indexes_.clear();
+            this->num_trees_ = 0;
+        }
+
+        // Partial state (see platypus::PartialStateWriter).
+        static std::string partial_state_kind() {
+            return "TopologyCounts";
+        }
+
+        template <class WriterT>
+        void write_state(WriterT & writer) const {
+            writer.write_u64(this->num_trees_);
+            writer.write_u64(this->topologies_.size());
+            for (auto & topology : this->topologies_) {
+                writer.write_u64(topology.hash);
+                writer.write_u64(topology.count);
+                writer.write_u64(topology.first_index);
+            }
+        }
+
+        template <class ReaderT>
+        void merge_state(ReaderT & reader) {
+            unsigned long num_trees = static_cast<unsigned long>(reader.read_u64());
+            std::size_t num_topologies = reader.read_count(24);
+            for (std::size_t idx = 0; idx < num_topologies; ++idx) {
+                std::uint64_t hash = reader.read_u64();
+                unsigned long count = static_cast<unsigned long>(reader.read_u64());
+                unsigned long first_index = static_cast<unsigned long>(reader.read_u64());
+                if (first_index >= num_trees || count == 0 || count > num_trees) {
+                    reader.fail("topology count out of range");
+                }
+                this->insert_count(hash, count, this->num_trees_ + first_index);
+            }
+            this->num_trees_ += num_trees;
+        }
+
+    private:
+        bool insert_count(std::uint64_t hash, unsigned long count, unsigned long first_index) {
+            auto inserted = this->indexes_.emplace(hash, this->topologies_.size());
+            if (!inserted.second) {
+                this->topologies_[inserted.first->second].count += count;
+                return false;
+            }
+            this->topologies_.push_back(Topology{hash, count, first_index});
+            return true;
+        }
+
+    private:
+        std::vector<Topology>                           topologies_;
+        std::unordered_map<std::uint64_t, std::size_t>  indexes_;
+        unsigned long                                   num_trees_;
+
+}; // TopologyCounts
+
+} // namespace platypus
+
+#endif
@@ -35,12 +35,72 @@
 #include <iostream>
 #include <stdexcept>
 #include <map>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include <functional>
+#include <type_traits>
+#include "../utility/memoryusage.hpp"
+#include "../utility/parallel.hpp"
 
 namespace platypus {
 
+namespace detail {
+
+/**
+ * Evaluates to std::true_type if the allocator ``AllocatorT`` declares a
+ * nested ``tracks_node_ownership`` type that is itself std::true_type, i.e.
+ * if the allocator itself knows about all the nodes it has handed out and
+ * can destroy them in bulk (e.g., platypus::TreeNodeArena), and to
+ * std::false_type otherwise.
+ */
+template <class AllocatorT>
+class allocator_tracks_node_ownership {
+        template <class U>
+        static typename U::tracks_node_ownership test(typename U::tracks_node_ownership *);
+        template <class U>
+        static std::false_type test(...);
+    public:
+        typedef decltype(test<AllocatorT>(nullptr)) type;
+        static const bool value = type::value;
+};
+
+/**
+ * Evaluates to std::true_type if the allocator ``AllocatorT`` has a
+ * ``reserve(size_type)`` member (e.g., platypus::TreeNodeArena), and to
+ * std::false_type otherwise.
+ */
+template <class AllocatorT>
+class allocator_supports_reserve {
+        template <class U>
+        static std::true_type test(decltype(std::declval<U &>().reserve(std::declval<typename U::size_type>())) *);
+        template <class U>
+        static std::false_type test(...);
+    public:
+        typedef decltype(test<AllocatorT>(nullptr)) type;
+        static const bool value = type::value;
+};
+
+/**
+ * Evaluates to std::true_type if the allocator ``AllocatorT`` reports the
+ * number of objects it can hold without allocating further storage, through
+ * a ``capacity()`` member (e.g., platypus::TreeNodeArena), and to
+ * std::false_type otherwise.
+ */
+template <class AllocatorT>
+class allocator_reports_capacity {
+        template <class U>
+        static std::true_type test(decltype(std::declval<const U &>().capacity()) *);
+        template <class U>
+        static std::false_type test(...);
+    public:
+        typedef decltype(test<AllocatorT>(nullptr)) type;
+        static const bool value = type::value;
+};
+
+} // namespace detail
+
 ////////////////////////////////////////////////////////////////////////////////
 // TreeNode
 
@@ -65,13 +125,17 @@ class TreeNode {
             : parent_(nullptr)
               , first_child_(nullptr)
               , last_child_(nullptr)
-              , next_sibling_(nullptr) { }
+              , next_sibling_(nullptr)
+              , prev_sibling_(nullptr)
+              , num_children_(0) { }
 
         TreeNode(const NodeValueT& value)
             : parent_(nullptr)
               , first_child_(nullptr)
               , last_child_(nullptr)
-              , next_sibling_(nullptr) {
+              , next_sibling_(nullptr)
+              , prev_sibling_(nullptr)
+              , num_children_(0) {
             this->value_ = value;
         }
 
@@ -79,12 +143,16 @@ class TreeNode {
             : parent_(other.parent_)
               , first_child_(other.first_child_)
               , last_child_(other.last_child_)
-              , next_sibling_(other.next_sibling_) {
+              , next_sibling_(other.next_sibling_)
+              , prev_sibling_(other.prev_sibling_)
+              , num_children_(other.num_children_) {
             this->value_ = std::move(other.value_);
             other.parent_ = nullptr;
             other.first_child_ = nullptr;
             other.last_child_ = nullptr;
             other.next_sibling_ = nullptr;
+            other.prev_sibling_ = nullptr;
+            other.num_children_ = 0;
         }
 
         // note: shallow copy!
@@ -92,7 +160,9 @@ class TreeNode {
             : parent_(other.parent_)
               , first_child_(other.first_child_)
               , last_child_(other.last_child_)
-              , next_sibling_(other.next_sibling_) {
+              , next_sibling_(other.next_sibling_)
+              , prev_sibling_(other.prev_sibling_)
+              , num_children_(other.num_children_) {
             this->value_ = other.value_;
         }
 
@@ -102,27 +172,57 @@ class TreeNode {
             this->first_child_ = other.first_child_;
             this->last_child_ = other.last_child_;
             this->next_sibling_ = other.next_sibling_;
+            this->prev_sibling_ = other.prev_sibling_;
+            this->num_children_ = other.num_children_;
             this->value_ = other.value_;
             return *this;
         }
 
-        ~TreeNode() {
-            this->clear_links();
-        }
+        // Trivial, so that arena allocators can release nodes in bulk without
+        // visiting each one (if NodeValueT is also trivially destructible).
+        ~TreeNode() = default;
 
         /////////////////////////////////////////////////////////////////////////
         // Structure
 
+        // Children are held in a doubly linked list of siblings, with their
+        // number, so that counting, removing or replacing children takes
+        // constant time even at nodes of very high degree.
+
         inline void add_child(TreeNode<NodeValueT> * ch) {
             if (this->first_child_ == nullptr) {
                 this->first_child_ = ch;
                 this->last_child_ = ch;
+                ch->prev_sibling_ = nullptr;
             } else {
                 this->last_child_->next_sibling_ = ch;
+                ch->prev_sibling_ = this->last_child_;
                 this->last_child_ = ch;
             }
             ch->parent_ = this;
             ch->next_sibling_ = nullptr;
+            ++this->num_children_;
+        }
+
+        // Inserts ``ch`` (which must not be a child of any node) among the
+        // children of this node, immediately before the child ``pos``, or
+        // at the end if ``pos`` is null.
+        inline void insert_child(TreeNode<NodeValueT> * pos, TreeNode<NodeValueT> * ch) {
+            if (pos == nullptr) {
+                this->add_child(ch);
+                return;
+            }
+            assert(pos->parent_ == this);
+            ch->prev_sibling_ = pos->prev_sibling_;
+            ch->next_sibling_ = pos;
+            if (pos->prev_sibling_ == nullptr) {
+                this->first_child_ = ch;
+            } else {
+                pos->prev_sibling_->next_sibling_ = ch;
+            }
+            pos->prev_sibling_ = ch;
+            ch->parent_ = this;
+            ++this->num_children_;
         }
 
         inline TreeNode<NodeValueT> * parent_node() const {
@@ -148,6 +248,98 @@ class TreeNode {
             this->next_sibling_ = nd;
         }
 
+        inline TreeNode<NodeValueT> * prev_sibling_node() const {
+            return this->prev_sibling_;
+        }
+
+        // Returns the child at (zero-based) position ``idx``, walking from
+        // whichever end of the children is nearer.
+        inline TreeNode<NodeValueT> * child_node(std::size_t idx) const {
+            assert(idx < this->num_children_);
+            TreeNode<NodeValueT> * nd = nullptr;
+            if (idx <= this->num_children_ / 2) {
+                nd = this->first_child_;
+                for (; idx > 0; --idx) {
+                    nd = nd->next_sibling_;
+                }
+            } else {
+                nd = this->last_child_;
+                for (idx = this->num_children_ - 1 - idx; idx > 0; --idx) {
+                    nd = nd->prev_sibling_;
+                }
+            }
+            return nd;
+        }
+
+        // Removes ``ch`` from the children of this node, clearing its
+        // parent and sibling links; its own children are untouched.
+        inline void remove_child(TreeNode<NodeValueT> * ch) {
+            assert(ch->parent_ == this);
+            if (ch->prev_sibling_ == nullptr) {
+                this->first_child_ = ch->next_sibling_;
+            } else {
+                ch->prev_sibling_->next_sibling_ = ch->next_sibling_;
+            }
+            if (ch->next_sibling_ == nullptr) {
+                this->last_child_ = ch->prev_sibling_;
+            } else {
+                ch->next_sibling_->prev_sibling_ = ch->prev_sibling_;
+            }
+            --this->num_children_;
+            ch->parent_ = nullptr;
+            ch->next_sibling_ = nullptr;
+            ch->prev_sibling_ = nullptr;
+        }
+
+        // Puts ``new_ch`` (which must not be a child of any node) in the
+        // place of ``old_ch`` among the children of this node, clearing
+        // the parent and sibling links of ``old_ch``.
+        inline void replace_child(TreeNode<NodeValueT> * old_ch, TreeNode<NodeValueT> * new_ch) {
+            assert(old_ch->parent_ == this);
+            if (old_ch->prev_sibling_ == nullptr) {
+                this->first_child_ = new_ch;
+            } else {
+                old_ch->prev_sibling_->next_sibling_ = new_ch;
+            }
+            if (old_ch->next_sibling_ == nullptr) {
+                this->last_child_ = new_ch;
+            } else {
+                old_ch->next_sibling_->prev_sibling_ = new_ch;
+            }
+            new_ch->parent_ = this;
+            new_ch->next_sibling_ = old_ch->next_sibling_;
+            new_ch->prev_sibling_ = old_ch->prev_sibling_;
+            old_ch->parent_ = nullptr;
+            old_ch->next_sibling_ = nullptr;
+            old_ch->prev_sibling_ = nullptr;
+        }
+
+        // Moves all children of ``src`` (in order) to the end of the
+        // children of this node.
+        inline void take_children(TreeNode<NodeValueT> * src) {
+            TreeNode<NodeValueT> * ch = src->first_child_;
+            src->first_child_ = nullptr;
+            src->last_child_ = nullptr;
+            src->num_children_ = 0;
+            while (ch != nullptr) {
+                TreeNode<NodeValueT> * next = ch->next_sibling_;
+                this->add_child(ch);
+                ch = next;
+            }
+        }
+
+        // Forgets the children of this node without touching their links,
+        // so that they can be added back (with add_child()) in a new order.
+        inline void unlink_children() {
+            this->first_child_ = nullptr;
+            this->last_child_ = nullptr;
+            this->num_children_ = 0;
+        }
+
+        inline std::size_t num_child_nodes() const {
+            return this->num_children_;
+        }
+
         bool is_leaf() const {
             return this->first_child_ == nullptr;
         }
@@ -157,6 +349,8 @@ class TreeNode {
             this->first_child_ = nullptr;
             this->last_child_ = nullptr;
             this->next_sibling_ = nullptr;
+            this->prev_sibling_ = nullptr;
+            this->num_children_ = 0;
         }
 
         /////////////////////////////////////////////////////////////////////////
@@ -204,6 +398,8 @@ class TreeNode {
         TreeNode<NodeValueT> *        first_child_;
         TreeNode<NodeValueT> *        last_child_;
         TreeNode<NodeValueT> *        next_sibling_;
+        TreeNode<NodeValueT> *        prev_sibling_;
+        std::size_t                   num_children_;
         NodeValueT                    value_;
 
 }; // TreeNode
@@ -211,12 +407,28 @@ class TreeNode {
 ////////////////////////////////////////////////////////////////////////////////
 // Tree
 
+/**
+ * A rooted tree of TreeNode objects, each holding a ``NodeValueT``.
+ *
+ * Thread safety: a tree holds no state that is changed by its const
+ * methods, so any number of threads may traverse (with the preorder,
+ * postorder, leaf, level-order, child and sibling iterators) and read the
+ * same tree concurrently, as long as no thread modifies the tree, its
+ * structure or its node values at the same time. Distinct trees may be
+ * modified concurrently.
+ */
 template<class NodeValueT, class TreeNodeAllocatorT = std::allocator<TreeNode<NodeValueT>>>
 class Tree {
 
     public:
         typedef TreeNode<NodeValueT> node_type;
         typedef NodeValueT value_type;
+        typedef TreeNodeAllocatorT allocator_type;
+
+        // If true, the allocator keeps track of the nodes it hands out (e.g.
+        // platypus::TreeNodeArena), and the tree does not record each
+        // allocated node individually.
+        static const bool allocator_tracks_node_ownership = detail::allocator_tracks_node_ownership<TreeNodeAllocatorT>::value;
 
     public:
 
@@ -234,7 +446,9 @@ class Tree {
         // constructed node objects to service as the tree before any
         // operations.
         Tree(bool manage_node_allocation=true)
-                : manage_node_allocation_(manage_node_allocation) {
+                : manage_node_allocation_(manage_node_allocation)
+                , recycle_nodes_(false)
+                , structure_version_(0) {
             if (this->manage_node_allocation_) {
                 this->initialize(this->create_internal_node(), this->create_internal_node());
             }
@@ -245,22 +459,34 @@ class Tree {
         // or not the node value is deep copied or shallow copied depends
         // on the behavior of this operator
         Tree(const Tree& other)
-            : manage_node_allocation_(other.manage_node_allocation_) {
+            : manage_node_allocation_(other.manage_node_allocation_)
+            , recycle_nodes_(other.recycle_nodes_)
+            , head_node_(nullptr)
+            , stop_node_(nullptr)
+            , structure_version_(0) {
             *this = other;
         }
 
-        Tree(Tree&& other)
+        // Takes over the nodes of ``other`` without allocating or copying
+        // any; ``other`` is left empty (with no head or stop node), and must
+        // be cleared (``Tree::clear()``) before being used again.
+        Tree(Tree&& other) noexcept
                 : tree_node_allocator_(std::move(other.tree_node_allocator_)),
                   manage_node_allocation_(std::move(other.manage_node_allocation_)),
+                  recycle_nodes_(other.recycle_nodes_),
+                  allocated_nodes_(std::move(other.allocated_nodes_)),
+                  spare_nodes_(std::move(other.spare_nodes_)),
                   head_node_(std::move(other.head_node_)),
-                  stop_node_(std::move(other.stop_node_)) {
+                  stop_node_(std::move(other.stop_node_)),
+                  structure_version_(0) {
+            other.allocated_nodes_.clear();
+            other.spare_nodes_.clear();
             other.head_node_ = nullptr;
             other.stop_node_ = nullptr;
         }
 
         virtual ~Tree() {
-            this->dispose_node(this->head_node_);
-            this->dispose_node(this->stop_node_);
+            this->dispose_all_nodes();
         }
 
         // Creates a deep copy of structure; node value is copied using the
@@ -272,6 +498,28 @@ class Tree {
             return *this;
         }
 
+        // Disposes of the current nodes of this tree, and takes over those of
+        // ``other``, which is left in the same state as after a move
+        // construction.
+        Tree& operator=(Tree&& other) noexcept {
+            if (this != &other) {
+                this->dispose_all_nodes();
+                this->tree_node_allocator_ = std::move(other.tree_node_allocator_);
+                this->manage_node_allocation_ = other.manage_node_allocation_;
+                this->recycle_nodes_ = other.recycle_nodes_;
+                this->allocated_nodes_ = std::move(other.allocated_nodes_);
+                this->spare_nodes_ = std::move(other.spare_nodes_);
+                this->head_node_ = other.head_node_;
+                this->stop_node_ = other.stop_node_;
+                ++this->structure_version_;
+                other.allocated_nodes_.clear();
+                other.spare_nodes_.clear();
+                other.head_node_ = nullptr;
+                other.stop_node_ = nullptr;
+            }
+            return *this;
+        }
+
         // If node allocation is non-managed (``manage_node_allocation ==
         // false``), then client code *must* call this method, passing in two
         // node objects before this class is used.
@@ -279,20 +527,115 @@ class Tree {
             this->head_node_ = head_node;
             this->stop_node_ = stop_node;
             this->head_node_->set_next_sibling_node(this->stop_node_);
+            ++this->structure_version_;
         }
 
         void clear() {
             if (this->manage_node_allocation_) {
-                while (this->allocated_nodes_.size() > 0) {
-                    auto ndi = this->allocated_nodes_.begin();
-                    (*ndi)->clear_links();
-                    this->dispose_node(*ndi);
+                if (this->recycle_nodes_) {
+                    this->reset();
+                    return;
                 }
+                // also safe on a moved-from tree
+                this->dispose_all_nodes();
                 this->initialize(this->create_internal_node(), this->create_internal_node());
             } else {
             }
         }
 
+        /////////////////////////////////////////////////////////////////////////
+        // Node Recycling
+
+        /**
+         * Empties the tree, as clear(), but instead of disposing of its
+         * nodes, keeps the head and stop nodes and moves every other node
+         * reachable from the head into a pool of spare nodes. Subsequent
+         * calls to create_node() (and so create_leaf_node() etc.) are served
+         * from this pool before any new node is requested from the
+         * allocator, so a tree that is repeatedly reset and rebuilt to a
+         * similar size settles at no allocations per rebuild.
+         *
+         * Recycled nodes have their links cleared and their values reset by
+         * assignment from a default-constructed ``value_type``. Nodes that
+         * were created but never added to the tree are not recycled, but are
+         * disposed of with the tree as usual.
+         */
+        void reset() {
+            if (!this->manage_node_allocation_) {
+                return;
+            }
+            if (this->head_node_ == nullptr || this->stop_node_ == nullptr) {
+                // moved-from tree
+                this->dispose_all_nodes();
+                this->initialize(this->create_internal_node(), this->create_internal_node());
+                return;
+            }
+            // the pool doubles as the queue of a level-order walk
+            std::size_t begin = this->spare_nodes_.size();
+            for (auto ch = this->head_node_->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                this->spare_nodes_.push_back(ch);
+            }
+            for (std::size_t idx = begin; idx < this->spare_nodes_.size(); ++idx) {
+                for (auto ch = this->spare_nodes_[idx]->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                    this->spare_nodes_.push_back(ch);
+                }
+            }
+            for (std::size_t idx = begin; idx < this->spare_nodes_.size(); ++idx) {
+                this->recycle_node(this->spare_nodes_[idx]);
+            }
+            this->recycle_node(this->head_node_);
+            this->stop_node_->clear_links();
+            this->initialize(this->head_node_, this->stop_node_);
+        }
+
+        /**
+         * If ``recycle_nodes`` is true, then clear() behaves as reset(), and
+         * nodes passed to dispose_node() are added to the pool of spare
+         * nodes instead of being returned to the allocator.
+         */
+        void set_node_recycling(bool recycle_nodes) {
+            this->recycle_nodes_ = recycle_nodes;
+        }
+        bool get_node_recycling() const {
+            return this->recycle_nodes_;
+        }
+
+        // Number of nodes held in the pool of spare nodes.
+        std::size_t num_spare_nodes() const {
+            return this->spare_nodes_.size();
+        }
+
+        /**
+         * Prepares for the creation of ``n`` further nodes: if the allocator
+         * supports it (e.g., platypus::TreeNodeArena), storage for all of
+         * them (less those available from the pool of spare nodes) is
+         * obtained in a single block; otherwise, the bookkeeping of
+         * allocated nodes is sized so that it does not grow while they are
+         * created.
+         */
+        void reserve_nodes(std::size_t n) {
+            if (!this->manage_node_allocation_) {
+                return;
+            }
+            std::size_t num_spare = this->spare_nodes_.size();
+            if (n <= num_spare) {
+                return;
+            }
+            n -= num_spare;
+            if (!allocator_tracks_node_ownership) {
+                this->allocated_nodes_.reserve(this->allocated_nodes_.size() + n);
+            }
+            this->reserve_allocator_nodes(n, typename detail::allocator_supports_reserve<TreeNodeAllocatorT>::type());
+        }
+
+        // Returns all spare nodes to the allocator.
+        void release_spare_nodes() {
+            for (auto nd : this->spare_nodes_) {
+                this->deallocate_node(nd);
+            }
+            this->spare_nodes_.clear();
+        }
+
         /////////////////////////////////////////////////////////////////////////
         // Iterators
 
@@ -433,27 +776,60 @@ class Tree {
                 }
         }; // postorder_iterator
 
+        /**
+         * Visits nodes breadth-first, either from the root to the tips or,
+         * if constructed with ``order_root_to_tips`` false, from the tips
+         * to the root.
+         *
+         * The queue of nodes is shared by all copies of an iterator, and only
+         * grows, so that a copy remains valid and does not duplicate the
+         * queue. When visiting root to tips, the queue is extended one node
+         * at a time as the iterator advances; when visiting tips to root,
+         * the queue is filled in a single pass on construction and walked
+         * backwards.
+         */
         class level_order_iterator : public base_iterator {
             public:
                 typedef level_order_iterator self_type;
-                level_order_iterator(const std::vector<node_type *> & nodes)
-                    : base_iterator(nullptr)
-                      , nodes_(nodes) {
-                    this->node_iter_ = this->nodes_.begin();
-                    if (!nodes.empty()) {
-                        this->node_ = *this->node_iter_;
+                level_order_iterator(node_type * root_node,
+                        bool include_leaves=true,
+                        bool order_root_to_tips=true)
+                    : base_iterator(root_node)
+                      , queue_(std::make_shared<Queue>(include_leaves))
+                      , position_(0)
+                      , order_root_to_tips_(order_root_to_tips) {
+                    if (root_node == nullptr) {
+                        return;
+                    }
+                    this->queue_->nodes.push_back(root_node);
+                    if (!order_root_to_tips) {
+                        while (this->queue_->expand_next()) { }
+                        this->position_ = this->queue_->nodes.size() - 1;
+                        this->node_ = this->queue_->nodes[this->position_];
                     }
                 }
                 level_order_iterator()
-                    : base_iterator(nullptr) {
+                    : base_iterator(nullptr)
+                      , position_(0)
+                      , order_root_to_tips_(true) {
                 }
                 virtual ~level_order_iterator() {}
                 const self_type& operator++() {
-                    ++this->node_iter_;
-                    if (this->node_iter_ != this->nodes_.end()) {
-                        this->node_ = *this->node_iter_;
+                    if (this->order_root_to_tips_) {
+                        ++this->position_;
+                        while (this->position_ >= this->queue_->nodes.size() && this->queue_->expand_next()) { }
+                        if (this->position_ < this->queue_->nodes.size()) {
+                            this->node_ = this->queue_->nodes[this->position_];
+                        } else {
+                            this->node_ = nullptr;
+                        }
                     } else {
-                        this->node_ = nullptr;
+                        if (this->position_ > 0) {
+                            --this->position_;
+                            this->node_ = this->queue_->nodes[this->position_];
+                        } else {
+                            this->node_ = nullptr;
+                        }
                     }
                     return *this;
                 }
@@ -463,8 +839,31 @@ class Tree {
                     return i;
                 }
             private:
-                std::vector<node_type *>                       nodes_;
-                typename std::vector<node_type *>::iterator    node_iter_;
+                struct Queue {
+                    Queue(bool include_leaves)
+                        : num_expanded(0)
+                        , include_leaves(include_leaves) { }
+                    // Appends the children of the next unexpanded node in the
+                    // queue; returns false if there are none left.
+                    bool expand_next() {
+                        if (this->num_expanded == this->nodes.size()) {
+                            return false;
+                        }
+                        node_type * nd = this->nodes[this->num_expanded++];
+                        for (node_type * ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                            if (this->include_leaves || !ch->is_leaf()) {
+                                this->nodes.push_back(ch);
+                            }
+                        }
+                        return true;
+                    }
+                    std::vector<node_type *>    nodes;
+                    std::size_t                 num_expanded;
+                    bool                        include_leaves;
+                };
+                std::shared_ptr<Queue>          queue_;
+                std::size_t                     position_;
+                bool                            order_root_to_tips_;
         }; // level_order_iterator
 
         class leaf_iterator : public base_iterator {
@@ -564,33 +963,36 @@ class Tree {
 
         // -- level-order--
 
-        std::vector<node_type *> level_order_nodes(bool order_root_to_tips=true, bool include_leaves=true) const {
-            std::vector<node_type *> nodes_in_level_order;
-            std::map<node_type *, unsigned long> node_steps_from_root;
-            for (auto ndi = this->preorder_begin(); ndi != this->preorder_end(); ++ndi) {
-                node_type * nptr = ndi.node();
-                if (ndi.parent_node() == nullptr) {
-                    node_steps_from_root[nptr] = 0;
-                } else if (include_leaves || !nptr->is_leaf()) {
-                    node_steps_from_root[nptr] = node_steps_from_root[ndi.parent_node()] + 1;
+        /**
+         * Fills ``nodes`` with the nodes of the tree in breadth-first order,
+         * reusing its existing storage. Runs in time linear in the number of
+         * nodes, with ``nodes`` itself serving as the queue.
+         */
+        void level_order_nodes(std::vector<node_type *> & nodes,
+                bool order_root_to_tips=true,
+                bool include_leaves=true) const {
+            nodes.clear();
+            nodes.push_back(this->head_node_);
+            for (std::size_t idx = 0; idx < nodes.size(); ++idx) {
+                for (node_type * ch = nodes[idx]->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                    if (include_leaves || !ch->is_leaf()) {
+                        nodes.push_back(ch);
+                    }
                 }
             }
-            std::multimap<unsigned long, node_type *> steps_from_root_nodes;
-            for (auto & si : node_steps_from_root) {
-                steps_from_root_nodes.insert(std::make_pair(si.second, si.first));
-            }
-            nodes_in_level_order.reserve(steps_from_root_nodes.size());
-            for (auto & si : steps_from_root_nodes) {
-                nodes_in_level_order.push_back(si.second);
-            }
             if (!order_root_to_tips) {
-                std::reverse(nodes_in_level_order.begin(), nodes_in_level_order.end());
+                std::reverse(nodes.begin(), nodes.end());
             }
+        }
+
+        std::vector<node_type *> level_order_nodes(bool order_root_to_tips=true, bool include_leaves=true) const {
+            std::vector<node_type *> nodes_in_level_order;
+            this->level_order_nodes(nodes_in_level_order, order_root_to_tips, include_leaves);
             return nodes_in_level_order;
         }
 
         level_order_iterator level_order_begin(bool include_leaves=true) const {
-            return level_order_iterator(this->level_order_nodes(true, include_leaves));
+            return level_order_iterator(this->head_node_, include_leaves, true);
         }
 
         level_order_iterator level_order_end() const {
@@ -598,7 +1000,7 @@ class Tree {
         }
 
         level_order_iterator level_order_rbegin(bool include_leaves=true) const {
-            return level_order_iterator(this->level_order_nodes(false, include_leaves));
+            return level_order_iterator(this->head_node_, include_leaves, false);
         }
 
         level_order_iterator level_order_rend() const {
@@ -699,6 +1101,68 @@ class Tree {
             return leaf_count;
         }
 
+        /**
+         * Accounts for the memory held by this tree (see
+         * platypus::MemoryUsage):
+         *
+         *  - ``num_objects``: nodes allocated by the tree, including the head
+         *    and stop nodes and the pool of spare nodes (or, with
+         *    non-managed allocation, the nodes in the tree);
+         *  - ``object_bytes``: storage of these nodes or, if the allocator
+         *    reports its capacity (e.g., platypus::TreeNodeArena), all of the
+         *    node storage it holds;
+         *  - ``bookkeeping_bytes``: the record of allocated nodes (for
+         *    allocators that do not track them) and the pool of spare nodes;
+         *  - ``heap_bytes``: the sum of ``value_heap_bytes(value)`` over the
+         *    nodes in the tree, if given (e.g., memory::heap_bytes() of the
+         *    label of each node).
+         */
+        MemoryUsage memory_usage(const std::function<std::size_t (const value_type &)> & value_heap_bytes={}) const {
+            MemoryUsage usage;
+            std::size_t num_tree_nodes = 0;
+            if (this->head_node_ != nullptr) {
+                for (auto ndi = this->preorder_begin(); ndi != this->preorder_end(); ++ndi) {
+                    ++num_tree_nodes;
+                    if (value_heap_bytes) {
+                        usage.heap_bytes += value_heap_bytes(*ndi);
+                    }
+                }
+            }
+            if (!this->manage_node_allocation_) {
+                usage.num_objects = num_tree_nodes;
+            } else if (allocator_tracks_node_ownership) {
+                // head and stop nodes
+                usage.num_objects = num_tree_nodes + (this->stop_node_ != nullptr ? 1 : 0) + this->spare_nodes_.size();
+            } else {
+                usage.num_objects = this->allocated_nodes_.size();
+                usage.bookkeeping_bytes += memory::heap_bytes(this->allocated_nodes_);
+            }
+            usage.object_bytes = this->allocator_node_capacity(usage.num_objects,
+                    typename detail::allocator_reports_capacity<TreeNodeAllocatorT>::type()) * sizeof(node_type);
+            usage.bookkeeping_bytes += memory::heap_bytes(this->spare_nodes_);
+            return usage;
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Structure Versioning
+
+        /**
+         * A counter that changes whenever the structure of the tree is
+         * changed through its own methods (add_child(), clear(), reset(),
+         * assignment etc.), so that anything derived from the structure
+         * (e.g., platypus::TreeAnnotationCache) can tell whether it is out of
+         * date. Client code that relinks nodes directly (e.g., with
+         * TreeNode::add_child()) should call mark_structure_modified()
+         * afterwards.
+         */
+        inline unsigned long structure_version() const {
+            return this->structure_version_;
+        }
+
+        inline void mark_structure_modified() {
+            ++this->structure_version_;
+        }
+
         /////////////////////////////////////////////////////////////////////////
         // Structure Access
 
@@ -715,6 +1179,7 @@ class Tree {
 
         template<typename iter> iter add_child(iter& pos, node_type * node) {
             pos.node()->add_child(node);
+            ++this->structure_version_;
             return iter(node);
         }
 
@@ -730,25 +1195,424 @@ class Tree {
             return this->add_child(pos, std::move(value_type(args...)));
         }
 
+        /////////////////////////////////////////////////////////////////////////
+        // Structure Editing
+        //
+        // These relink existing nodes rather than copying them, in time
+        // proportional to the nodes (and their siblings) that are relinked.
+        // Nodes that become redundant are passed to dispose_node(), and nodes
+        // that are needed are obtained from create_internal_node(), so these
+        // respect node recycling and the tracking of allocated nodes. The
+        // head node always remains the head node (and keeps its value).
+        //
+        // Operations that change edges come in two forms: one that changes
+        // the topology only, and one that also maintains edge lengths,
+        // taking an ``edge_length_getter`` (``L get(const value_type &)``)
+        // and ``edge_length_setter`` (``void set(value_type &, L)``) for the
+        // length of the edge subtending a node.
+
+        /**
+         * Detaches the subtree rooted at ``nd`` (which must not be the head
+         * node) from the tree. The nodes of the subtree remain owned by this
+         * tree, and can be attached elsewhere with regraft() or
+         * TreeNode::add_child(), or disposed of with dispose_subtree().
+         *
+         * If ``suppress_unifurcation`` is true, and the former parent of
+         * ``nd`` is left with a single child, the parent is removed, with
+         * the child taking its place (if the parent is the head node, the
+         * child is merged into it instead, unless the child is a leaf).
+         *
+         * @return
+         *   ``nd``.
+         */
+        node_type * prune_subtree(node_type * nd, bool suppress_unifurcation=true) {
+            return this->prune_subtree(nd,
+                    [] (const value_type &) { return 0; },
+                    [] (value_type &, int) { },
+                    suppress_unifurcation);
+        }
+
+        /**
+         * As above, with the length of the edge of a removed unifurcation
+         * added to that of its surviving child.
+         */
+        template <typename EdgeLengthGetterT, typename EdgeLengthSetterT>
+        node_type * prune_subtree(node_type * nd,
+                EdgeLengthGetterT edge_length_getter,
+                EdgeLengthSetterT edge_length_setter,
+                bool suppress_unifurcation=true) {
+            node_type * parent = nd->parent_node();
+            assert(nd != this->head_node_ && parent != nullptr);
+            parent->remove_child(nd);
+            if (suppress_unifurcation && parent->first_child_node() != nullptr
+                    && parent->first_child_node() == parent->last_child_node()) {
+                this->suppress_unifurcation(parent, edge_length_getter, edge_length_setter);
+            }
+            ++this->structure_version_;
+            return nd;
+        }
+
+        /**
+         * Attaches the (detached) subtree rooted at ``nd`` to the edge
+         * subtending ``target``, by inserting a new node on that edge, in the
+         * place of ``target``, with ``target`` and ``nd`` (in that order) as
+         * its children. If ``target`` is the head node, the new node takes
+         * over the children of the head node, and ``nd`` becomes the
+         * second child of the head node.
+         *
+         * @return
+         *   The new node.
+         */
+        node_type * regraft(node_type * nd, node_type * target) {
+            return this->regraft(nd,
+                    target,
+                    [] (const value_type &) { return 0; },
+                    [] (value_type &, int) { },
+                    0.5);
+        }
+
+        /**
+         * As above, with ``split_proportion`` of the length of the edge
+         * subtending ``target`` left to ``target``, and the rest given to
+         * the new node. The edge length of ``nd`` is unchanged.
+         */
+        template <typename EdgeLengthGetterT, typename EdgeLengthSetterT>
+        node_type * regraft(node_type * nd,
+                node_type * target,
+                EdgeLengthGetterT edge_length_getter,
+                EdgeLengthSetterT edge_length_setter,
+                double split_proportion=0.5) {
+            assert(nd->parent_node() == nullptr && nd != this->head_node_);
+            auto length = edge_length_getter(target->value());
+            node_type * new_node = this->create_internal_node();
+            if (target == this->head_node_) {
+                new_node->take_children(target);
+                target->add_child(new_node);
+                edge_length_setter(new_node->value(), length * split_proportion);
+                edge_length_setter(target->value(), length - length * split_proportion);
+                target->add_child(nd);
+            } else {
+                target->parent_node()->replace_child(target, new_node);
+                new_node->add_child(target);
+                edge_length_setter(target->value(), length * split_proportion);
+                edge_length_setter(new_node->value(), length - length * split_proportion);
+                new_node->add_child(nd);
+            }
+            ++this->structure_version_;
+            return new_node;
+        }
+
+        /**
+         * Reroots the tree on the edge subtending ``nd``, so that ``nd`` and
+         * its former parent become the children of the head node, reversing
+         * the path from the former parent to the head node. The former root
+         * is removed if it is left with a single child, and otherwise
+         * represented by a new node that takes over its remaining children.
+         * Takes time proportional to the length of the path (and the number
+         * of children of the nodes along it).
+         */
+        void reroot_at_edge(node_type * nd) {
+            this->reroot_at_edge(nd,
+                    [] (const value_type &) { return 0; },
+                    [] (value_type &, int) { },
+                    0.5);
+        }
+
+        /**
+         * As above, with edge lengths carried along the reversed path, and
+         * ``split_proportion`` of the length of the edge subtending ``nd``
+         * left to ``nd`` and the rest given to its former parent. If ``nd``
+         * is a child of a bifurcating root, the rerooted edge is taken to
+         * be the one joining ``nd`` and its sibling.
+         */
+        template <typename EdgeLengthGetterT, typename EdgeLengthSetterT>
+        void reroot_at_edge(node_type * nd,
+                EdgeLengthGetterT edge_length_getter,
+                EdgeLengthSetterT edge_length_setter,
+                double split_proportion=0.5) {
+            node_type * head = this->head_node_;
+            if (nd == head) {
+                return;
+            }
+            node_type * parent = nd->parent_node();
+            assert(parent != nullptr);
+            auto nd_length = edge_length_getter(nd->value());
+            if (parent == head) {
+                node_type * sibling = nd == head->first_child_node() ? nd->next_sibling_node() : head->first_child_node();
+                if (sibling == nullptr) {
+                    return;
+                }
+                if (head->num_child_nodes() == 2) {
+                    auto length = nd_length + edge_length_getter(sibling->value());
+                    edge_length_setter(nd->value(), length * split_proportion);
+                    edge_length_setter(sibling->value(), length - length * split_proportion);
+                    head->unlink_children();
+                    head->add_child(nd);
+                    head->add_child(sibling);
+                } else {
+                    head->remove_child(nd);
+                    node_type * old_root = this->create_internal_node();
+                    old_root->take_children(head);
+                    edge_length_setter(nd->value(), nd_length * split_proportion);
+                    edge_length_setter(old_root->value(), nd_length - nd_length * split_proportion);
+                    head->add_child(nd);
+                    head->add_child(old_root);
+                }
+                ++this->structure_version_;
+                return;
+            }
+            parent->remove_child(nd);
+            // walk up from the former parent, making each node the parent of
+            // the one above it, with the edge length moving down the edge
+            node_type * lower = parent;
+            auto lower_length = edge_length_getter(lower->value());
+            node_type * upper = lower->parent_node();
+            upper->remove_child(lower);
+            while (upper != head) {
+                node_type * next_upper = upper->parent_node();
+                auto upper_length = edge_length_getter(upper->value());
+                next_upper->remove_child(upper);
+                lower->add_child(upper);
+                edge_length_setter(upper->value(), lower_length);
+                lower = upper;
+                lower_length = upper_length;
+                upper = next_upper;
+            }
+            // remaining children of the former root hang from the node
+            // below it on the path
+            node_type * remaining = head->first_child_node();
+            if (remaining != nullptr && remaining == head->last_child_node()) {
+                head->remove_child(remaining);
+                lower->add_child(remaining);
+                edge_length_setter(remaining->value(), edge_length_getter(remaining->value()) + lower_length);
+            } else if (remaining != nullptr) {
+                node_type * old_root = this->create_internal_node();
+                old_root->take_children(head);
+                lower->add_child(old_root);
+                edge_length_setter(old_root->value(), lower_length);
+            }
+            edge_length_setter(nd->value(), nd_length * split_proportion);
+            edge_length_setter(parent->value(), nd_length - nd_length * split_proportion);
+            head->add_child(nd);
+            head->add_child(parent);
+            ++this->structure_version_;
+        }
+
+        /**
+         * Sorts the children of every node by the number of leaves they
+         * subtend, smallest first if ``ascending`` is true (so that the
+         * tree "ladderizes" to the right) and largest first otherwise; ties
+         * keep their existing order. Uses working storage proportional to
+         * the depth of the tree (and the number of children of the nodes
+         * along a path).
+         */
+        void ladderize(bool ascending=true) {
+            std::vector<std::pair<unsigned long, node_type *>> subtree_sizes;
+            for (auto ndi = this->postorder_begin(); ndi != this->postorder_end(); ++ndi) {
+                node_type * nd = ndi.node();
+                if (nd->is_leaf()) {
+                    subtree_sizes.emplace_back(1, nd);
+                    continue;
+                }
+                std::size_t num_children = nd->num_child_nodes();
+                auto children_begin = subtree_sizes.end() - static_cast<std::ptrdiff_t>(num_children);
+                if (ascending) {
+                    std::stable_sort(children_begin, subtree_sizes.end(),
+                            [] (const std::pair<unsigned long, node_type *> & a, const std::pair<unsigned long, node_type *> & b) {
+                                return a.first < b.first; });
+                } else {
+                    std::stable_sort(children_begin, subtree_sizes.end(),
+                            [] (const std::pair<unsigned long, node_type *> & a, const std::pair<unsigned long, node_type *> & b) {
+                                return a.first > b.first; });
+                }
+                unsigned long num_leaves = 0;
+                nd->unlink_children();
+                for (auto chi = children_begin; chi != subtree_sizes.end(); ++chi) {
+                    nd->add_child(chi->second);
+                    num_leaves += chi->first;
+                }
+                subtree_sizes.erase(children_begin, subtree_sizes.end());
+                subtree_sizes.emplace_back(num_leaves, nd);
+            }
+            ++this->structure_version_;
+        }
+
+        /**
+         * Removes every node with exactly one child, with the child taking
+         * its place (a head node with a single internal child instead
+         * absorbs the child).
+         */
+        void collapse_unifurcations() {
+            this->collapse_unifurcations(
+                    [] (const value_type &) { return 0; },
+                    [] (value_type &, int) { });
+        }
+
+        /**
+         * As above, with the length of the edge of a removed node added to
+         * that of its child.
+         */
+        template <typename EdgeLengthGetterT, typename EdgeLengthSetterT>
+        void collapse_unifurcations(EdgeLengthGetterT edge_length_getter,
+                EdgeLengthSetterT edge_length_setter) {
+            auto ndi = this->postorder_begin();
+            while (ndi != this->postorder_end()) {
+                node_type * nd = ndi.node();
+                ++ndi;
+                if (nd != this->head_node_ && nd->first_child_node() != nullptr
+                        && nd->first_child_node() == nd->last_child_node()) {
+                    this->suppress_unifurcation(nd, edge_length_getter, edge_length_setter);
+                }
+            }
+            node_type * head = this->head_node_;
+            while (head->first_child_node() != nullptr
+                    && head->first_child_node() == head->last_child_node()
+                    && !head->first_child_node()->is_leaf()) {
+                this->suppress_unifurcation(head, edge_length_getter, edge_length_setter);
+            }
+            ++this->structure_version_;
+        }
+
+        /**
+         * Removes every leaf whose value fails ``keep_fn`` (``bool f(const
+         * value_type &)``), together with the internal nodes left without
+         * leaves, and suppresses every node left with a single child (as
+         * collapse_unifurcations()), in a single postorder pass that relinks
+         * the surviving nodes in place. If no leaf is kept, the head node is
+         * left without children.
+         *
+         * @return
+         *   The number of leaves kept.
+         */
+        template <typename KeepFnT>
+        unsigned long retain_leaves(KeepFnT keep_fn) {
+            return this->retain_leaves(keep_fn,
+                    [] (const value_type &) { return 0; },
+                    [] (value_type &, int) { });
+        }
+
+        /**
+         * As above, with the length of the edge of a removed unifurcation
+         * added to that of its surviving child.
+         */
+        template <typename KeepFnT, typename EdgeLengthGetterT, typename EdgeLengthSetterT>
+        unsigned long retain_leaves(KeepFnT keep_fn,
+                EdgeLengthGetterT edge_length_getter,
+                EdgeLengthSetterT edge_length_setter) {
+            node_type * head = this->head_node_;
+            unsigned long num_kept = 0;
+            // set when a removal takes the last child of a node, which is
+            // then the next node visited, and so removed in turn
+            bool is_emptied = false;
+            auto ndi = this->postorder_begin();
+            while (ndi != this->postorder_end()) {
+                node_type * nd = ndi.node();
+                ++ndi;
+                if (nd == head) {
+                    break;
+                }
+                node_type * ch = nd->first_child_node();
+                if (ch == nullptr && !is_emptied && keep_fn(nd->value())) {
+                    ++num_kept;
+                } else if (ch == nullptr) {
+                    node_type * parent = nd->parent_node();
+                    parent->remove_child(nd);
+                    this->dispose_node(nd);
+                    is_emptied = parent->first_child_node() == nullptr;
+                    continue;
+                } else if (ch == nd->last_child_node()) {
+                    this->suppress_unifurcation(nd, edge_length_getter, edge_length_setter);
+                }
+                is_emptied = false;
+            }
+            if (head->first_child_node() != nullptr
+                    && head->first_child_node() == head->last_child_node()
+                    && !head->first_child_node()->is_leaf()) {
+                this->suppress_unifurcation(head, edge_length_getter, edge_length_setter);
+            }
+            ++this->structure_version_;
+            return num_kept;
+        }
+
+        /**
+         * Disposes of every node in the subtree rooted at ``nd``, which must
+         * have been detached from the tree (e.g., with prune_subtree()).
+         */
+        void dispose_subtree(node_type * nd) {
+            assert(nd->parent_node() == nullptr && nd != this->head_node_);
+            node_type * current = nd;
+            while (current->first_child_node() != nullptr) {
+                current = current->first_child_node();
+            }
+            while (true) {
+                node_type * next = nullptr;
+                if (current != nd) {
+                    next = current->next_sibling_node();
+                    if (next == nullptr) {
+                        next = current->parent_node();
+                    } else {
+                        while (next->first_child_node() != nullptr) {
+                            next = next->first_child_node();
+                        }
+                    }
+                }
+                this->dispose_node(current);
+                if (next == nullptr) {
+                    break;
+                }
+                current = next;
+            }
+            ++this->structure_version_;
+        }
+
         /////////////////////////////////////////////////////////////////////////
         // Default generic allocators
 
         virtual node_type * create_node() {
+            return this->new_node();
+        }
+
+        virtual node_type * create_node(const value_type& value) {
+            return this->new_node(value);
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Non-virtual node creation and disposal, as used by the default
+        // generic allocators and deallocators. These are available to node
+        // factory policies (see platypus::StaticNodeFactoryTree) that need
+        // to create nodes without going through any virtual call.
+
+        inline node_type * new_node() {
             if (this->manage_node_allocation_) {
+                if (!this->spare_nodes_.empty()) {
+                    node_type * nd = this->spare_nodes_.back();
+                    this->spare_nodes_.pop_back();
+                    return nd;
+                }
                 node_type * nd = this->tree_node_allocator_.allocate(1, 0);
                 this->tree_node_allocator_.construct(nd);
-                this->allocated_nodes_.insert(nd);
+                if (!allocator_tracks_node_ownership) {
+                    this->allocated_nodes_.insert(nd);
+                }
                 return nd;
             } else {
                 throw std::logic_error("Tree::create_node(): Request for node allocation but resource is not managed");
             }
         }
 
-        virtual node_type * create_node(const value_type& value) {
+        inline node_type * new_node(const value_type& value) {
             if (this->manage_node_allocation_) {
+                if (!this->spare_nodes_.empty()) {
+                    node_type * nd = this->spare_nodes_.back();
+                    this->spare_nodes_.pop_back();
+                    nd->set_value(value);
+                    return nd;
+                }
                 node_type * nd = this->tree_node_allocator_.allocate(1, 0);
                 this->tree_node_allocator_.construct(nd, value);
-                this->allocated_nodes_.insert(nd);
+                if (!allocator_tracks_node_ownership) {
+                    this->allocated_nodes_.insert(nd);
+                }
                 return nd;
             } else {
                 throw std::logic_error("Tree::create_node(const value_type& value): Request for node allocation but resource is not managed");
@@ -795,30 +1659,51 @@ class Tree {
         // Default dealllocators
 
         virtual void dispose_node(node_type * nd) {
+            this->delete_node(nd);
+        }
+
+        inline void delete_node(node_type * nd) {
             if (this->manage_node_allocation_) {
-                this->allocated_nodes_.erase(nd);
-                this->tree_node_allocator_.destroy(nd);
-                this->tree_node_allocator_.deallocate(nd, 1);
+                if (this->recycle_nodes_) {
+                    this->recycle_node(nd);
+                    this->spare_nodes_.push_back(nd);
+                } else {
+                    this->deallocate_node(nd);
+                }
             }
         }
 
+        /////////////////////////////////////////////////////////////////////////
+        // Allocator Access
+
+        const TreeNodeAllocatorT & node_allocator() const {
+            return this->tree_node_allocator_;
+        }
+
         /////////////////////////////////////////////////////////////////////////
         // Cloning/Copying
 
         /**
          * Rebuilds this as a deep copy of ``other``.
          *
+         * The source is walked in preorder by following first-child,
+         * next-sibling and parent links, with each new node created as the
+         * corresponding source node is reached, so no map from source to
+         * copied nodes is needed.
+         *
          * @tparam T
          *   Specialization or derived of platypus::Tree.
+         * @tparam CopyValueFnT
+         *   Type of function object which deep copies nodes: a lambda or
+         *   other functor can be passed directly (and will be inlined),
+         *   without being wrapped in a std::function.
          * @param src_tree
          *   Tree to be copied.
          * @param deep_copy_node_value_f
          *   Function object which deep copies nodes: f(const typename T::value_type & src, typename Tree::value_type & dest)
          */
-        template <typename T>
-        void deep_copy_from(const T& src_tree,
-                const std::function<void (const typename T::value_type &, typename Tree::value_type &)> deep_copy_node_value_f
-                ) {
+        template <typename T, typename CopyValueFnT>
+        void deep_copy_from(const T& src_tree, CopyValueFnT deep_copy_node_value_f) {
             this->clear();
             if (this->head_node_ == nullptr && this->stop_node_ == nullptr) {
                 this->initialize(this->create_internal_node(), this->create_internal_node());
@@ -827,35 +1712,32 @@ class Tree {
             } else if (this->stop_node_ == nullptr) {
                 this->initialize(this->head_node_, this->create_internal_node());
             }
-            std::unordered_map<typename T::node_type *, node_type *> node_map;
-            typename T::node_type * other_node = nullptr;
-            typename T::node_type * other_child_node = nullptr;
-            node_type * new_node = nullptr;
-            for (auto ndi = src_tree.postorder_begin();
-                    ndi != src_tree.postorder_end();
-                    ++ndi) {
-                other_node = ndi.node();
-                new_node = nullptr;
-                if (other_node->is_leaf()) {
-                    new_node = this->create_leaf_node();
-                } else {
-                    if (other_node == src_tree.head_node()) {
-                        new_node = this->head_node_;
-                    } else {
-                        new_node = this->create_internal_node();
+            const typename T::node_type * src_root = src_tree.head_node();
+            const typename T::node_type * src_node = src_root;
+            node_type * new_node = this->head_node_;
+            deep_copy_node_value_f(src_node->value(), new_node->value());
+            while (true) {
+                const typename T::node_type * src_child = src_node->first_child_node();
+                if (src_child == nullptr) {
+                    // leaf: back up to the first ancestor with a next sibling
+                    while (src_node != src_root && src_node->next_sibling_node() == nullptr) {
+                        src_node = src_node->parent_node();
+                        new_node = new_node->parent_node();
                     }
-                    for (auto chi = src_tree.children_begin(ndi);
-                            chi != src_tree.children_end(ndi);
-                            ++chi) {
-                        other_child_node = chi.node();
-                        assert(node_map.find(other_child_node) != node_map.end());
-                        new_node->add_child(node_map[other_child_node]);
+                    if (src_node == src_root) {
+                        break;
                     }
+                    src_child = src_node->next_sibling_node();
+                    src_node = src_node->parent_node();
+                    new_node = new_node->parent_node();
                 }
-                // new_node->set_value(other_node->value());
-                // new_node->value() = other_node->value();
-                deep_copy_node_value_f(other_node->value(), new_node->value());
-                node_map[other_node] = new_node;
+                node_type * new_child = src_child->is_leaf()
+                    ? this->create_leaf_node()
+                    : this->create_internal_node();
+                deep_copy_node_value_f(src_child->value(), new_child->value());
+                new_node->add_child(new_child);
+                src_node = src_child;
+                new_node = new_child;
             }
         }
 
@@ -872,20 +1754,126 @@ class Tree {
          */
         template <typename T>
         void deep_copy_from(const T& src_tree) {
-            // std::function<void (const typename T::value_type &, typename Tree::value_type &)> deep_copy_node_value_f( [] (const typename T::value_type & src, typename Tree::value_type & dest) { dest = src; } );
-            std::function<void (const typename T::value_type &, typename Tree::value_type &)> deep_copy_node_value_f( [] (const typename T::value_type & src, typename Tree::value_type & dest) { dest = src; } );
-            this->deep_copy_from(src_tree, deep_copy_node_value_f);
+            this->deep_copy_from(src_tree, [] (const typename T::value_type & src, typename Tree::value_type & dest) { dest = src; });
+        }
+
+    protected:
+
+        // Removes ``nd``, which has a single child, with the child taking
+        // its place and its edge length (see prune_subtree()); if ``nd`` is
+        // the head node, an internal child is merged into it instead.
+        template <typename EdgeLengthGetterT, typename EdgeLengthSetterT>
+        void suppress_unifurcation(node_type * nd,
+                EdgeLengthGetterT & edge_length_getter,
+                EdgeLengthSetterT & edge_length_setter) {
+            node_type * ch = nd->first_child_node();
+            if (nd == this->head_node_) {
+                if (ch->is_leaf()) {
+                    return;
+                }
+                nd->remove_child(ch);
+                nd->take_children(ch);
+                edge_length_setter(nd->value(), edge_length_getter(nd->value()) + edge_length_getter(ch->value()));
+                this->dispose_node(ch);
+            } else {
+                nd->remove_child(ch);
+                nd->parent_node()->replace_child(nd, ch);
+                edge_length_setter(ch->value(), edge_length_getter(ch->value()) + edge_length_getter(nd->value()));
+                this->dispose_node(nd);
+            }
+        }
+
+        // Prepares a node for reuse (see reset()).
+        void recycle_node(node_type * nd) {
+            nd->clear_links();
+            nd->value() = value_type();
+        }
+
+        void deallocate_node(node_type * nd) {
+            if (!allocator_tracks_node_ownership) {
+                this->allocated_nodes_.erase(nd);
+            }
+            this->tree_node_allocator_.destroy(nd);
+            this->tree_node_allocator_.deallocate(nd, 1);
+        }
+
+        // Destroys and deallocates every node created by this tree (including
+        // the head and stop nodes, and any spare nodes), if node allocation
+        // is managed.
+        void dispose_all_nodes() {
+            if (this->manage_node_allocation_) {
+                this->dispose_all_nodes(std::integral_constant<bool, allocator_tracks_node_ownership>());
+            }
+            this->spare_nodes_.clear();
+            this->head_node_ = nullptr;
+            this->stop_node_ = nullptr;
+        }
+
+        void dispose_all_nodes(std::true_type) {
+            this->tree_node_allocator_.release();
+        }
+
+        void dispose_all_nodes(std::false_type) {
+            for (auto nd : this->allocated_nodes_) {
+                this->tree_node_allocator_.destroy(nd);
+                this->tree_node_allocator_.deallocate(nd, 1);
+            }
+            this->allocated_nodes_.clear();
+        }
+
+        void reserve_allocator_nodes(std::size_t n, std::true_type) {
+            this->tree_node_allocator_.reserve(n);
+        }
+
+        void reserve_allocator_nodes(std::size_t, std::false_type) { }
+
+        std::size_t allocator_node_capacity(std::size_t num_nodes, std::true_type) const {
+            return std::max(num_nodes, static_cast<std::size_t>(this->tree_node_allocator_.capacity()));
+        }
+
+        std::size_t allocator_node_capacity(std::size_t num_nodes, std::false_type) const {
+            return num_nodes;
         }
 
     protected:
         TreeNodeAllocatorT                  tree_node_allocator_;
         bool                                manage_node_allocation_;
+        bool                                recycle_nodes_;
         std::unordered_set<node_type *>     allocated_nodes_;
+        // constructed nodes available for reuse (see reset())
+        std::vector<node_type *>            spare_nodes_;
         node_type *                         head_node_;
         node_type *                         stop_node_;
+        unsigned long                       structure_version_;
 
 }; // Tree
 
+template <class NodeValueT, class TreeNodeAllocatorT>
+const bool Tree<NodeValueT, TreeNodeAllocatorT>::allocator_tracks_node_ownership;
+
+////////////////////////////////////////////////////////////////////////////////
+// clone_n
+
+/**
+ * Returns ``n`` independent copies of ``src_tree``, made by copy assignment
+ * (so that any state of derived tree types, e.g. rooting, is copied as well
+ * as the structure and node values). Copies are made concurrently on
+ * ``num_threads`` threads (see platypus::parallel_for()), each copy into a
+ * tree with its own allocator, so ``TreeT`` must be default-constructible,
+ * and copying its node values must be safe to do concurrently from the same
+ * source.
+ */
+template <class TreeT>
+std::vector<TreeT> clone_n(const TreeT & src_tree,
+        std::size_t n,
+        unsigned int num_threads=1) {
+    std::vector<TreeT> trees(n);
+    parallel_for(n, num_threads, [&trees, &src_tree] (std::size_t idx) {
+        trees[idx] = src_tree;
+    });
+    return trees;
+}
+
 } // namespace platypus
 
 #endif
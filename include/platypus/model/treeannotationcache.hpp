@@ -0,0 +1,278 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Cached per-node subtree aggregates.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_MODEL_TREEANNOTATIONCACHE_HPP
+#define PLATYPUS_MODEL_TREEANNOTATIONCACHE_HPP
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// TreeAnnotationCache
+
+/**
+ * Per-node aggregates of a tree (number of leaves subtended, depth and
+ * distance from the root, height and age), computed for every node at once,
+ * in one postorder and one preorder pass, and kept in arrays on the side so
+ * that each lookup is constant-time:
+ *
+ *      platypus::TreeAnnotationCache<TreeType> annotations(tree,
+ *              [](const NodeValue & nv) { return nv.get_edge_length(); });
+ *      for (auto nd = tree.preorder_begin(); nd != tree.preorder_end(); ++nd) {
+ *          ... annotations.num_leaves(nd.node()) ... annotations.age(nd.node()) ...
+ *      }
+ *
+ * The aggregates are recomputed on the first lookup after the structure of
+ * the tree has changed (as given by Tree::structure_version()). Leaf nodes
+ * added to the tree one at a time can instead be folded in by calling
+ * child_added(), which updates only the ancestors of the new node. Changes
+ * to edge lengths are not tracked: call invalidate() after making them.
+ *
+ * The tree must outlive the cache, and lookups (which may recompute) must
+ * not be made concurrently unless update() has been called since the last
+ * change to the tree.
+ *
+ * @tparam TreeT
+ *   Type of tree (platypus::Tree or derived).
+ * @tparam EdgeLengthT
+ *   Type of edge length values.
+ */
+template <class TreeT, class EdgeLengthT=double>
+class TreeAnnotationCache {
+
+    public:
+        typedef typename TreeT::node_type       node_type;
+        typedef typename TreeT::value_type      value_type;
+        typedef std::uint32_t                   index_type;
+        typedef std::function<EdgeLengthT (const value_type &)> edge_length_getter_type;
+
+    public:
+
+        /**
+         * If ``edge_length_getter`` is empty, all edge lengths are
+         * default-constructed (so that only leaf counts, depths and heights
+         * are meaningful).
+         */
+        TreeAnnotationCache(const TreeT & tree,
+                const edge_length_getter_type & edge_length_getter=edge_length_getter_type())
+            : tree_(tree)
+            , edge_length_getter_(edge_length_getter)
+            , is_valid_(false)
+            , structure_version_(0) { }
+
+        inline const TreeT & tree() const {
+            return this->tree_;
+        }
+
+        // Forces recomputation on the next lookup.
+        inline void invalidate() {
+            this->is_valid_ = false;
+        }
+
+        inline bool is_current() const {
+            return this->is_valid_ && this->structure_version_ == this->tree_.structure_version();
+        }
+
+        // Recomputes all aggregates, if out of date.
+        inline void update() {
+            if (!this->is_current()) {
+                this->compute();
+            }
+        }
+
+        /**
+         * Folds ``node``, a leaf node that has just been added to the tree
+         * (with Tree::add_child()), into the current aggregates, updating
+         * only its ancestors. If the aggregates were not current before the
+         * node was added, or if ``node`` has children, they are instead
+         * recomputed on the next lookup.
+         */
+        void child_added(const node_type * node) {
+            if (!this->is_valid_
+                    || this->structure_version_ + 1 != this->tree_.structure_version()
+                    || !node->is_leaf()
+                    || this->indexes_.count(node) > 0) {
+                this->is_valid_ = false;
+                return;
+            }
+            auto parent_iter = this->indexes_.find(node->parent_node());
+            if (parent_iter == this->indexes_.end()) {
+                this->is_valid_ = false;
+                return;
+            }
+            index_type parent_idx = parent_iter->second;
+            index_type idx = static_cast<index_type>(this->parents_.size());
+            EdgeLengthT edge_length = this->get_edge_length(node);
+            this->indexes_[node] = idx;
+            this->parents_.push_back(parent_idx);
+            this->edge_lengths_.push_back(edge_length);
+            this->num_leaves_.push_back(1);
+            this->depths_.push_back(this->depths_[parent_idx] + 1);
+            this->heights_.push_back(0);
+            this->distances_from_root_.push_back(this->distances_from_root_[parent_idx] + edge_length);
+            this->ages_.push_back(EdgeLengthT());
+            // a leaf that gains its first child still subtends one leaf
+            bool parent_was_leaf = node->parent_node()->first_child_node() == node && node->next_sibling_node() == nullptr;
+            bool is_height_changed = true;
+            for (index_type ch = idx, nd = parent_idx; nd != npos; ch = nd, nd = this->parents_[nd]) {
+                if (!parent_was_leaf) {
+                    ++this->num_leaves_[nd];
+                }
+                if (is_height_changed) {
+                    is_height_changed = false;
+                    if (this->heights_[ch] + 1 > this->heights_[nd]) {
+                        this->heights_[nd] = this->heights_[ch] + 1;
+                        is_height_changed = true;
+                    }
+                    EdgeLengthT age = this->ages_[ch] + this->edge_lengths_[ch];
+                    if (age > this->ages_[nd]) {
+                        this->ages_[nd] = age;
+                        is_height_changed = true;
+                    }
+                }
+                if (parent_was_leaf && !is_height_changed) {
+                    break;
+                }
+            }
+            this->structure_version_ = this->tree_.structure_version();
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Lookups
+
+        // Number of nodes in the tree.
+        inline std::size_t size() {
+            this->update();
+            return this->parents_.size();
+        }
+
+        // Number of leaves in the subtree rooted at ``nd`` (1 for a leaf).
+        inline unsigned long num_leaves(const node_type * nd) {
+            return this->num_leaves_[this->get_index(nd)];
+        }
+
+        // Number of edges between the root and ``nd``.
+        inline unsigned long depth(const node_type * nd) {
+            return this->depths_[this->get_index(nd)];
+        }
+
+        // Number of edges between ``nd`` and its most distant descendent leaf.
+        inline unsigned long height(const node_type * nd) {
+            return this->heights_[this->get_index(nd)];
+        }
+
+        // Sum of edge lengths between the root and ``nd``.
+        inline EdgeLengthT distance_from_root(const node_type * nd) {
+            return this->distances_from_root_[this->get_index(nd)];
+        }
+
+        /**
+         * Greatest sum of edge lengths between ``nd`` and any of its
+         * descendent leaves (i.e., its age if the tree is ultrametric).
+         */
+        inline EdgeLengthT age(const node_type * nd) {
+            return this->ages_[this->get_index(nd)];
+        }
+
+    private:
+        static const index_type npos = static_cast<index_type>(-1);
+
+        inline index_type get_index(const node_type * nd) {
+            this->update();
+            return this->indexes_.at(nd);
+        }
+
+        inline EdgeLengthT get_edge_length(const node_type * nd) const {
+            return this->edge_length_getter_ ? this->edge_length_getter_(nd->value()) : EdgeLengthT();
+        }
+
+        void compute() {
+            this->indexes_.clear();
+            this->parents_.clear();
+            this->edge_lengths_.clear();
+            for (auto nd = this->tree_.preorder_begin(); nd != this->tree_.preorder_end(); ++nd) {
+                const node_type * node = nd.node();
+                index_type idx = static_cast<index_type>(this->parents_.size());
+                this->indexes_[node] = idx;
+                this->parents_.push_back(idx == 0 ? npos : this->indexes_[node->parent_node()]);
+                this->edge_lengths_.push_back(this->get_edge_length(node));
+            }
+            std::size_t n = this->parents_.size();
+            this->num_leaves_.assign(n, 0);
+            this->depths_.assign(n, 0);
+            this->heights_.assign(n, 0);
+            this->distances_from_root_.assign(n, EdgeLengthT());
+            this->ages_.assign(n, EdgeLengthT());
+            // postorder: children come after their parents in preorder
+            for (std::size_t idx = n; idx-- > 1; ) {
+                index_type parent_idx = this->parents_[idx];
+                if (this->num_leaves_[idx] == 0) {
+                    this->num_leaves_[idx] = 1;
+                }
+                this->num_leaves_[parent_idx] += this->num_leaves_[idx];
+                if (this->heights_[idx] + 1 > this->heights_[parent_idx]) {
+                    this->heights_[parent_idx] = this->heights_[idx] + 1;
+                }
+                EdgeLengthT age = this->ages_[idx] + this->edge_lengths_[idx];
+                if (age > this->ages_[parent_idx]) {
+                    this->ages_[parent_idx] = age;
+                }
+            }
+            if (n > 0 && this->num_leaves_[0] == 0) {
+                this->num_leaves_[0] = 1;
+            }
+            // preorder
+            for (std::size_t idx = 1; idx < n; ++idx) {
+                index_type parent_idx = this->parents_[idx];
+                this->depths_[idx] = this->depths_[parent_idx] + 1;
+                this->distances_from_root_[idx] = this->distances_from_root_[parent_idx] + this->edge_lengths_[idx];
+            }
+            this->is_valid_ = true;
+            this->structure_version_ = this->tree_.structure_version();
+        }
+
+    private:
+        const TreeT &                                       tree_;
+        edge_length_getter_type                             edge_length_getter_;
+        bool                                                is_valid_;
+        unsigned long                                       structure_version_;
+        std::unordered_map<const node_type *, index_type>   indexes_;
+        // by index, in preorder (followed by nodes added with child_added())
+        std::vector<index_type>                             parents_;
+        std::vector<EdgeLengthT>                            edge_lengths_;
+        std::vector<unsigned long>                          num_leaves_;
+        std::vector<unsigned long>                          depths_;
+        std::vector<unsigned long>                          heights_;
+        std::vector<EdgeLengthT>                            distances_from_root_;
+        std::vector<EdgeLengthT>                            ages_;
+
+}; // TreeAnnotationCache
+
+template <class TreeT, class EdgeLengthT>
+const typename TreeAnnotationCache<TreeT, EdgeLengthT>::index_type TreeAnnotationCache<TreeT, EdgeLengthT>::npos;
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,1577 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Distances between trees.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_MODEL_TREEDISTANCE_HPP
+#define PLATYPUS_MODEL_TREEDISTANCE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "datatable.hpp"
+#include "split.hpp"
+#include "taxonnamespace.hpp"
+#include "../utility/binaryformat.hpp"
+#include "../utility/parallel.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// TriangularMatrix
+
+/**
+ * A symmetric matrix with an implicit (default-valued) diagonal, storing
+ * only the ``n * (n - 1) / 2`` elements above the diagonal, row by row, in
+ * a single array.
+ */
+template <class T>
+class TriangularMatrix {
+
+    public:
+        typedef T value_type;
+
+    public:
+        TriangularMatrix(std::size_t size=0)
+            : size_(0) {
+            this->resize(size);
+        }
+
+        // Resizes to ``size`` x ``size``, with all elements reset.
+        void resize(std::size_t size) {
+            this->size_ = size;
+            this->values_.assign(size < 2 ? 0 : size * (size - 1) / 2, T());
+        }
+
+        inline std::size_t size() const {
+            return this->size_;
+        }
+
+        inline T get(std::size_t i, std::size_t j) const {
+            if (i == j) {
+                return T();
+            }
+            return this->values_[this->index(i, j)];
+        }
+
+        inline void set(std::size_t i, std::size_t j, const T & value) {
+            this->values_[this->index(i, j)] = value;
+        }
+
+        // Elements above the diagonal, in row order.
+        inline const std::vector<T> & values() const {
+            return this->values_;
+        }
+
+    private:
+        inline std::size_t index(std::size_t i, std::size_t j) const {
+            if (i > j) {
+                std::swap(i, j);
+            }
+            return i * (2 * this->size_ - i - 1) / 2 + (j - i - 1);
+        }
+
+    private:
+        std::size_t         size_;
+        std::vector<T>      values_;
+
+}; // TriangularMatrix
+
+////////////////////////////////////////////////////////////////////////////////
+// for_each_pair_tile
+
+/**
+ * Divides the pairs (``i``, ``j``), ``i`` < ``j`` < ``n``, of a collection
+ * of ``n`` items into square tiles of ``tile_size`` x ``tile_size`` items,
+ * on and above the diagonal, and calls ``fn(i_begin, i_end, j_begin,
+ * j_end)`` for each tile, concurrently by ``num_threads`` threads, so that
+ * the items being compared by a thread stay in cache. ``fn`` compares the
+ * pairs of the tile with ``j > i``.
+ */
+template <class FnT>
+void for_each_pair_tile(std::size_t n,
+        std::size_t tile_size,
+        unsigned int num_threads,
+        FnT fn) {
+    std::size_t num_tiles_per_side = (n + tile_size - 1) / tile_size;
+    std::vector<std::pair<std::size_t, std::size_t>> tiles;
+    for (std::size_t ti = 0; ti < num_tiles_per_side; ++ti) {
+        for (std::size_t tj = ti; tj < num_tiles_per_side; ++tj) {
+            tiles.push_back(std::make_pair(ti, tj));
+        }
+    }
+    parallel_for(tiles.size(), num_threads, [n, tile_size, &tiles, &fn] (std::size_t tile_idx) {
+        std::size_t i_begin = tiles[tile_idx].first * tile_size;
+        std::size_t j_begin = tiles[tile_idx].second * tile_size;
+        fn(i_begin, std::min(i_begin + tile_size, n), j_begin, std::min(j_begin + tile_size, n));
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SplitSignature
+
+/**
+ * A compact summary of the splits of a tree, for comparing trees: the hashes
+ * (see split_words::hash()) of its non-trivial splits, in ascending order,
+ * so that the splits shared by two trees are found by a single merge of two
+ * arrays, and (optionally) the corresponding edge lengths along with the
+ * lengths of the edges subtending each taxon.
+ *
+ * Splits are identified by their hashes alone, so that comparisons are exact
+ * up to collisions of hashes (vanishingly rare where ``std::size_t`` has 64
+ * bits).
+ *
+ * If trees are unrooted, splits are normalized, the splits of the two edges
+ * of a basal bifurcation are merged (and their lengths summed), and a split
+ * separating a single taxon from the others is the edge of that taxon.
+ */
+template <class EdgeLengthT=double>
+class SplitSignature {
+
+    public:
+        typedef std::uint64_t   hash_type;
+
+    public:
+        SplitSignature() { }
+
+        /**
+         * Replaces the contents with the splits of ``tree``.
+         *
+         * @param tree
+         *   Tree.
+         * @param num_taxa
+         *   Number of taxa over which splits are defined.
+         * @param taxon_index_fn
+         *   See SplitSet::assign().
+         * @param edge_length_fn
+         *   Function returning the length of the edge subtending a node
+         *   given its value, if ``with_edge_lengths`` is true.
+         * @param is_rooted
+         *   If false, splits are treated as bipartitions.
+         * @param with_edge_lengths
+         *   If true, edge lengths are recorded.
+         * @param scratch
+         *   Space for encoding splits, which can be reused across calls.
+         */
+        template <class TreeT, class TaxonIndexFnT, class EdgeLengthFnT>
+        void assign(const TreeT & tree,
+                std::size_t num_taxa,
+                TaxonIndexFnT taxon_index_fn,
+                EdgeLengthFnT edge_length_fn,
+                bool is_rooted,
+                bool with_edge_lengths,
+                SplitSet & scratch) {
+            typedef split_words::word_type word_type;
+            this->hashes_.clear();
+            this->edge_lengths_.clear();
+            this->taxon_edge_lengths_.clear();
+            scratch.assign(tree, num_taxa, taxon_index_fn);
+            if (scratch.empty()) {
+                return;
+            }
+            const std::size_t nw = scratch.num_words();
+            const std::size_t root_idx = scratch.size() - 1;
+            const word_type * root_split = scratch.words(root_idx);
+            const std::size_t num_tree_taxa = scratch.count(root_idx);
+            if (with_edge_lengths) {
+                this->taxon_edge_lengths_.assign(num_taxa, EdgeLengthT());
+            }
+            std::vector<std::pair<hash_type, EdgeLengthT>> & entries = this->entries_;
+            entries.clear();
+            std::vector<word_type> & normalized = this->normalized_;
+            normalized.resize(nw);
+            std::size_t idx = 0;
+            for (auto nd = tree.postorder_begin(); idx < root_idx; ++nd, ++idx) {
+                EdgeLengthT edge_length = with_edge_lengths ? static_cast<EdgeLengthT>(edge_length_fn(*nd)) : EdgeLengthT();
+                const word_type * split = scratch.words(idx);
+                std::size_t n = scratch.count(idx);
+                if (n == 1 || (!is_rooted && n + 1 == num_tree_taxa)) {
+                    // edge subtending a single taxon
+                    if (with_edge_lengths) {
+                        std::size_t taxon_idx = 0;
+                        for (std::size_t w = 0; w < nw; ++w) {
+                            word_type bits = n == 1 ? split[w] : (root_split[w] & ~split[w]);
+                            if (bits != 0) {
+                                taxon_idx = w * split_words::bits_per_word + split_words::lowest_bit(bits);
+                                break;
+                            }
+                        }
+                        this->taxon_edge_lengths_[taxon_idx] += edge_length;
+                    }
+                    continue;
+                }
+                if (!is_rooted && num_taxa > 0 && (split[0] & 1)) {
+                    std::copy(split, split + nw, normalized.begin());
+                    split_words::complement(normalized.data(), num_taxa);
+                    split = normalized.data();
+                }
+                entries.push_back(std::make_pair(static_cast<hash_type>(split_words::hash(split, nw)), edge_length));
+            }
+            std::sort(entries.begin(), entries.end(),
+                    [] (const std::pair<hash_type, EdgeLengthT> & a, const std::pair<hash_type, EdgeLengthT> & b) {
+                        return a.first < b.first;
+                    });
+            for (auto & entry : entries) {
+                if (!this->hashes_.empty() && this->hashes_.back() == entry.first) {
+                    // the other edge of a basal bifurcation
+                    if (with_edge_lengths) {
+                        this->edge_lengths_.back() += entry.second;
+                    }
+                    continue;
+                }
+                this->hashes_.push_back(entry.first);
+                if (with_edge_lengths) {
+                    this->edge_lengths_.push_back(entry.second);
+                }
+            }
+            entries.clear();
+        }
+
+        // Number of non-trivial splits.
+        inline std::size_t size() const {
+            return this->hashes_.size();
+        }
+
+        inline const std::vector<hash_type> & hashes() const {
+            return this->hashes_;
+        }
+
+        // Lengths of the edges of non-trivial splits, in order of hash.
+        inline const std::vector<EdgeLengthT> & edge_lengths() const {
+            return this->edge_lengths_;
+        }
+
+        // Lengths of the edges subtending each taxon (0 for taxa not in the tree).
+        inline const std::vector<EdgeLengthT> & taxon_edge_lengths() const {
+            return this->taxon_edge_lengths_;
+        }
+
+    private:
+        std::vector<hash_type>                          hashes_;
+        std::vector<EdgeLengthT>                        edge_lengths_;
+        std::vector<EdgeLengthT>                        taxon_edge_lengths_;
+        // scratch space
+        std::vector<std::pair<hash_type, EdgeLengthT>>  entries_;
+        std::vector<split_words::word_type>             normalized_;
+
+}; // SplitSignature
+
+/**
+ * Robinson-Foulds (symmetric difference) distance between two trees: the
+ * number of non-trivial splits found in one tree but not the other.
+ */
+template <class EdgeLengthT>
+unsigned long robinson_foulds_distance(const SplitSignature<EdgeLengthT> & a, const SplitSignature<EdgeLengthT> & b) {
+    const auto * ha = a.hashes().data();
+    const auto * hb = b.hashes().data();
+    std::size_t na = a.size();
+    std::size_t nb = b.size();
+    std::size_t i = 0;
+    std::size_t j = 0;
+    std::size_t num_shared = 0;
+    while (i < na && j < nb) {
+        if (ha[i] < hb[j]) {
+            ++i;
+        } else if (hb[j] < ha[i]) {
+            ++j;
+        } else {
+            ++num_shared;
+            ++i;
+            ++j;
+        }
+    }
+    return static_cast<unsigned long>(na + nb - 2 * num_shared);
+}
+
+/**
+ * Weighted Robinson-Foulds distance between two trees (whose signatures
+ * include edge lengths): the sum, over the splits of both trees (including
+ * those of single taxa), of the absolute difference between the lengths of
+ * the corresponding edges, with the length of an edge missing from a tree
+ * taken to be 0.
+ */
+template <class EdgeLengthT>
+EdgeLengthT weighted_robinson_foulds_distance(const SplitSignature<EdgeLengthT> & a, const SplitSignature<EdgeLengthT> & b) {
+    const auto * ha = a.hashes().data();
+    const auto * hb = b.hashes().data();
+    const EdgeLengthT * la = a.edge_lengths().data();
+    const EdgeLengthT * lb = b.edge_lengths().data();
+    std::size_t na = a.size();
+    std::size_t nb = b.size();
+    std::size_t i = 0;
+    std::size_t j = 0;
+    EdgeLengthT distance = EdgeLengthT();
+    while (i < na && j < nb) {
+        if (ha[i] < hb[j]) {
+            distance += std::abs(la[i++]);
+        } else if (hb[j] < ha[i]) {
+            distance += std::abs(lb[j++]);
+        } else {
+            distance += std::abs(la[i++] - lb[j++]);
+        }
+    }
+    for (; i < na; ++i) {
+        distance += std::abs(la[i]);
+    }
+    for (; j < nb; ++j) {
+        distance += std::abs(lb[j]);
+    }
+    const auto & ta = a.taxon_edge_lengths();
+    const auto & tb = b.taxon_edge_lengths();
+    std::size_t num_taxa = std::min(ta.size(), tb.size());
+    for (std::size_t t = 0; t < num_taxa; ++t) {
+        distance += std::abs(ta[t] - tb[t]);
+    }
+    return distance;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RobinsonFouldsDistances
+
+/**
+ * Pairwise (weighted) Robinson-Foulds distances between all trees of a
+ * collection (e.g., as returned by BaseTreeReader::get_tree_vector()).
+ *
+ * The trees are first reduced to split signatures (see SplitSignature), in
+ * parallel. Pairs are then compared in square tiles of
+ * ``TILE_SIZE`` x ``TILE_SIZE`` trees, distributed among threads, so that
+ * the signatures being compared by a thread stay in cache; each comparison
+ * is a merge of two sorted arrays of hashes. Distances are stored in
+ * triangular matrices.
+ *
+ * @tparam EdgeLengthT
+ *   Type of edge length values.
+ */
+template <class EdgeLengthT=double>
+class RobinsonFouldsDistances {
+
+    public:
+        // number of trees along each side of a tile of comparisons
+        static const std::size_t TILE_SIZE = 32;
+
+    public:
+
+        /**
+         * @param is_rooted
+         *   If false, trees are compared as unrooted trees.
+         * @param with_weighted_distances
+         *   If true, weighted distances are also calculated.
+         */
+        RobinsonFouldsDistances(bool is_rooted=false, bool with_weighted_distances=false)
+            : is_rooted_(is_rooted)
+            , with_weighted_distances_(with_weighted_distances) { }
+
+        /**
+         * Calculates the distances between all trees in [``trees_begin``,
+         * ``trees_end``), using ``num_threads`` threads (see
+         * resolve_num_threads()). ``taxon_index_fn`` and ``edge_length_fn``
+         * are as for SplitSignature::assign(), and are called concurrently.
+         */
+        template <class IterT, class TaxonIndexFnT, class EdgeLengthFnT>
+        void assign(IterT trees_begin,
+                IterT trees_end,
+                std::size_t num_taxa,
+                TaxonIndexFnT taxon_index_fn,
+                EdgeLengthFnT edge_length_fn,
+                unsigned int num_threads=0) {
+            std::size_t num_trees = static_cast<std::size_t>(std::distance(trees_begin, trees_end));
+            num_threads = resolve_num_threads(num_threads);
+            this->signatures_.clear();
+            this->signatures_.resize(num_trees);
+            std::size_t num_blocks = std::min<std::size_t>(num_threads, num_trees);
+            if (num_blocks > 0) {
+                std::size_t block_size = (num_trees + num_blocks - 1) / num_blocks;
+                parallel_for(num_blocks, num_threads, [&] (std::size_t block_idx) {
+                    SplitSet scratch;
+                    std::size_t begin_idx = block_idx * block_size;
+                    std::size_t end_idx = std::min(begin_idx + block_size, num_trees);
+                    IterT tree_iter = trees_begin;
+                    std::advance(tree_iter, begin_idx);
+                    for (std::size_t idx = begin_idx; idx < end_idx; ++idx, ++tree_iter) {
+                        this->signatures_[idx].assign(*tree_iter,
+                                num_taxa,
+                                taxon_index_fn,
+                                edge_length_fn,
+                                this->is_rooted_,
+                                this->with_weighted_distances_,
+                                scratch);
+                    }
+                });
+            }
+            this->calculate_distances(num_threads);
+        }
+
+        /**
+         * As above, with taxa and edge lengths given by
+         * ``get_taxon_index()`` and ``get_edge_length()`` of node values (e.g.,
+         * platypus::TaxonNodeValue).
+         */
+        template <class IterT>
+        void assign(IterT trees_begin,
+                IterT trees_end,
+                const TaxonNamespace & taxon_namespace,
+                unsigned int num_threads=0) {
+            typedef typename std::iterator_traits<IterT>::value_type::value_type value_type;
+            this->assign(trees_begin,
+                    trees_end,
+                    taxon_namespace.size(),
+                    [] (const value_type & nv) -> TaxonNamespace::index_type { return nv.get_taxon_index(); },
+                    [] (const value_type & nv) -> EdgeLengthT { return nv.get_edge_length(); },
+                    num_threads);
+        }
+
+        // Number of trees.
+        inline std::size_t size() const {
+            return this->signatures_.size();
+        }
+
+        inline unsigned long get_distance(std::size_t i, std::size_t j) const {
+            return this->distances_.get(i, j);
+        }
+
+        inline EdgeLengthT get_weighted_distance(std::size_t i, std::size_t j) const {
+            return this->weighted_distances_.get(i, j);
+        }
+
+        inline const TriangularMatrix<unsigned long> & distances() const {
+            return this->distances_;
+        }
+
+        // Empty unless weighted distances were requested.
+        inline const TriangularMatrix<EdgeLengthT> & weighted_distances() const {
+            return this->weighted_distances_;
+        }
+
+        /**
+         * Adds a row to ``table`` for each pair of trees (``i`` < ``j``), in
+         * order, with columns "tree1", "tree2" (indexes of the trees),
+         * "rf" and (if calculated) "weighted_rf", which are added to the
+         * table if it has no columns.
+         */
+        void export_table(DataTable & table) const {
+            if (table.num_columns() == 0) {
+                table.add_key_column<unsigned long>("tree1");
+                table.add_key_column<unsigned long>("tree2");
+                table.add_data_column<unsigned long>("rf");
+                if (this->with_weighted_distances_) {
+                    table.add_data_column<EdgeLengthT>("weighted_rf");
+                }
+            }
+            std::size_t n = this->size();
+            table.reserve(table.num_rows() + this->distances_.values().size());
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t j = i + 1; j < n; ++j) {
+                    auto & row = table.add_row();
+                    row << static_cast<unsigned long>(i)
+                        << static_cast<unsigned long>(j)
+                        << this->distances_.get(i, j);
+                    if (this->with_weighted_distances_) {
+                        row << this->weighted_distances_.get(i, j);
+                    }
+                }
+            }
+        }
+
+    private:
+
+        void calculate_distances(unsigned int num_threads) {
+            std::size_t n = this->signatures_.size();
+            this->distances_.resize(n);
+            this->weighted_distances_.resize(this->with_weighted_distances_ ? n : 0);
+            for_each_pair_tile(n, TILE_SIZE, num_threads, [this] (std::size_t i_begin,
+                        std::size_t i_end,
+                        std::size_t j_begin,
+                        std::size_t j_end) {
+                for (std::size_t i = i_begin; i < i_end; ++i) {
+                    const SplitSignature<EdgeLengthT> & a = this->signatures_[i];
+                    for (std::size_t j = std::max(j_begin, i + 1); j < j_end; ++j) {
+                        const SplitSignature<EdgeLengthT> & b = this->signatures_[j];
+                        this->distances_.set(i, j, robinson_foulds_distance(a, b));
+                        if (this->with_weighted_distances_) {
+                            this->weighted_distances_.set(i, j, weighted_robinson_foulds_distance(a, b));
+                        }
+                    }
+                }
+            });
+        }
+
+    private:
+        bool                                        is_rooted_;
+        bool                                        with_weighted_distances_;
+        std::vector<SplitSignature<EdgeLengthT>>    signatures_;
+        TriangularMatrix<unsigned long>             distances_;
+        TriangularMatrix<EdgeLengthT>               weighted_distances_;
+
+}; // RobinsonFouldsDistances
+
+template <class EdgeLengthT>
+const std::size_t RobinsonFouldsDistances<EdgeLengthT>::TILE_SIZE;
+
+////////////////////////////////////////////////////////////////////////////////
+// PatristicDistances
+
+/**
+ * The patristic distances (sums of the lengths of the edges on the paths)
+ * between all pairs of taxa of a tree, held as a TriangularMatrix indexed
+ * by taxon.
+ *
+ * The distances of all pairs are found in a single postorder pass, in
+ * O(n^2) time overall: each subtree is represented by the distances from
+ * its root to each of its leaves, kept contiguously on a single stack, so
+ * that at each internal node the distances between the leaves of each pair
+ * of child subtrees are filled in from their two ranges, and the ranges
+ * then become that of the node without any copying. Where the two ranges
+ * span many pairs, they are filled in concurrently.
+ *
+ * @tparam EdgeLengthT
+ *   Type of edge length values.
+ */
+template <class EdgeLengthT=double>
+class PatristicDistances {
+
+    public:
+        // minimum number of pairs of leaves at a node for which pairs are
+        // filled in concurrently
+        static constexpr std::size_t min_parallel_pairs() {
+            return 1 << 18;
+        }
+
+    public:
+
+        PatristicDistances() { }
+
+        /**
+         * Calculates the distances between all leaves of ``tree``, using up
+         * to ``num_threads`` threads (see resolve_num_threads()).
+         *
+         * @param num_taxa
+         *   Number of taxa (or size of the taxon namespace): the size of
+         *   the matrix. Pairs of taxa that are not both in the tree have a
+         *   distance of 0.
+         * @param taxon_index_fn
+         *   Function returning the index (in [0, ``num_taxa``)) of the taxon
+         *   associated with the value of a leaf node; std::invalid_argument
+         *   is thrown on any other value.
+         * @param edge_length_fn
+         *   Function returning the length of the edge subtending a node
+         *   from its value.
+         */
+        template <class TreeT, class TaxonIndexFnT, class EdgeLengthFnT>
+        void assign(const TreeT & tree,
+                std::size_t num_taxa,
+                TaxonIndexFnT taxon_index_fn,
+                EdgeLengthFnT edge_length_fn,
+                unsigned int num_threads=1) {
+            typedef typename TreeT::node_type node_type;
+            num_threads = resolve_num_threads(num_threads);
+            this->distances_.resize(num_taxa);
+            this->leaves_.clear();
+            this->subtree_begins_.clear();
+            for (auto ndi = tree.postorder_begin(); ndi != tree.postorder_end(); ++ndi) {
+                const node_type * nd = ndi.node();
+                if (nd->is_leaf()) {
+                    auto taxon_idx = taxon_index_fn(nd->value());
+                    if (static_cast<std::size_t>(taxon_idx) >= num_taxa) {
+                        throw std::invalid_argument("platypus::PatristicDistances: leaf node without a valid taxon index");
+                    }
+                    this->subtree_begins_.push_back(this->leaves_.size());
+                    this->leaves_.push_back(std::make_pair(static_cast<std::size_t>(taxon_idx), EdgeLengthT()));
+                    continue;
+                }
+                std::size_t num_children = 0;
+                for (const node_type * ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                    ++num_children;
+                }
+                std::size_t first = this->subtree_begins_.size() - num_children;
+                // distances from the leaves of each child to this node
+                std::size_t child_idx = first;
+                for (const node_type * ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node(), ++child_idx) {
+                    EdgeLengthT edge_length = edge_length_fn(ch->value());
+                    std::size_t end = this->subtree_end(child_idx);
+                    for (std::size_t idx = this->subtree_begins_[child_idx]; idx < end; ++idx) {
+                        this->leaves_[idx].second += edge_length;
+                    }
+                }
+                for (std::size_t i = first; i < this->subtree_begins_.size(); ++i) {
+                    for (std::size_t j = i + 1; j < this->subtree_begins_.size(); ++j) {
+                        this->fill_pairs(this->subtree_begins_[i], this->subtree_end(i),
+                                this->subtree_begins_[j], this->subtree_end(j),
+                                num_threads);
+                    }
+                }
+                this->subtree_begins_.resize(first + 1);
+            }
+        }
+
+        /**
+         * As above, with taxa and edge lengths given by
+         * ``get_taxon_index()`` and ``get_edge_length()`` of node values (e.g.,
+         * platypus::TaxonNodeValue).
+         */
+        template <class TreeT>
+        void assign(const TreeT & tree,
+                const TaxonNamespace & taxon_namespace,
+                unsigned int num_threads=1) {
+            typedef typename TreeT::value_type value_type;
+            this->assign(tree,
+                    taxon_namespace.size(),
+                    [] (const value_type & nv) -> TaxonNamespace::index_type { return nv.get_taxon_index(); },
+                    [] (const value_type & nv) -> EdgeLengthT { return nv.get_edge_length(); },
+                    num_threads);
+        }
+
+        // Number of taxa.
+        inline std::size_t size() const {
+            return this->distances_.size();
+        }
+
+        inline EdgeLengthT get_distance(std::size_t i, std::size_t j) const {
+            return this->distances_.get(i, j);
+        }
+
+        inline const TriangularMatrix<EdgeLengthT> & distances() const {
+            return this->distances_;
+        }
+
+        /**
+         * Adds a row to ``table`` for each pair of taxa (``i`` < ``j``), in
+         * order, with columns "taxon1", "taxon2" (indexes of the taxa) and
+         * "distance", which are added to the table if it has no columns.
+         */
+        void export_table(DataTable & table) const {
+            if (table.num_columns() == 0) {
+                table.add_key_column<unsigned long>("taxon1");
+                table.add_key_column<unsigned long>("taxon2");
+                table.add_data_column<EdgeLengthT>("distance");
+            }
+            std::size_t n = this->size();
+            table.reserve(table.num_rows() + this->distances_.values().size());
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t j = i + 1; j < n; ++j) {
+                    auto & row = table.add_row();
+                    row << static_cast<unsigned long>(i)
+                        << static_cast<unsigned long>(j)
+                        << this->distances_.get(i, j);
+                }
+            }
+        }
+
+        /**
+         * Writes the matrix to ``out`` in binary: the number of taxa (u64),
+         * followed by the distances above the diagonal, row by row (f64),
+         * all little-endian, in blocks of (about) ``block_size`` bytes.
+         */
+        void write_binary(std::ostream & out, std::size_t block_size=65536) const {
+            std::string buffer;
+            buffer.reserve(block_size + 8);
+            binary_format::append_u64(buffer, this->size());
+            for (auto value : this->distances_.values()) {
+                binary_format::append_f64(buffer, static_cast<double>(value));
+                if (buffer.size() >= block_size) {
+                    out.write(buffer.data(), buffer.size());
+                    buffer.clear();
+                }
+            }
+            out.write(buffer.data(), buffer.size());
+        }
+
+    private:
+
+        inline std::size_t subtree_end(std::size_t subtree_idx) const {
+            return subtree_idx + 1 < this->subtree_begins_.size() ? this->subtree_begins_[subtree_idx + 1] : this->leaves_.size();
+        }
+
+        void fill_pairs(std::size_t a_begin,
+                std::size_t a_end,
+                std::size_t b_begin,
+                std::size_t b_end,
+                unsigned int num_threads) {
+            std::size_t num_a = a_end - a_begin;
+            std::size_t num_pairs = num_a * (b_end - b_begin);
+            auto fill_rows = [this, b_begin, b_end] (std::size_t row_begin, std::size_t row_end) {
+                for (std::size_t ia = row_begin; ia < row_end; ++ia) {
+                    const std::pair<std::size_t, EdgeLengthT> & a = this->leaves_[ia];
+                    for (std::size_t ib = b_begin; ib < b_end; ++ib) {
+                        const std::pair<std::size_t, EdgeLengthT> & b = this->leaves_[ib];
+                        if (a.first != b.first) {
+                            this->distances_.set(a.first, b.first, a.second + b.second);
+                        }
+                    }
+                }
+            };
+            if (num_threads <= 1 || num_pairs < min_parallel_pairs() || num_a < 2) {
+                fill_rows(a_begin, a_end);
+                return;
+            }
+            std::size_t num_blocks = std::min<std::size_t>(num_a, 4 * static_cast<std::size_t>(num_threads));
+            std::size_t rows_per_block = (num_a + num_blocks - 1) / num_blocks;
+            parallel_for(num_blocks, num_threads, [&] (std::size_t block_idx) {
+                std::size_t row_begin = a_begin + block_idx * rows_per_block;
+                fill_rows(row_begin, std::min(row_begin + rows_per_block, a_end));
+            });
+        }
+
+    private:
+        TriangularMatrix<EdgeLengthT>                   distances_;
+        // (taxon, distance to the root of the subtree) of the leaves of
+        // the subtrees whose parents have not yet been visited
+        std::vector<std::pair<std::size_t, EdgeLengthT>> leaves_;
+        std::vector<std::size_t>                        subtree_begins_;
+
+}; // PatristicDistances
+
+////////////////////////////////////////////////////////////////////////////////
+// TopologyProfile
+
+/**
+ * The topology of a tree reduced to arrays, for counting the triplets and
+ * quartets of taxa that two trees resolve alike (see TopologyIntersections):
+ * its nodes in postorder, with the children of each, and with the leaves
+ * in postorder, so that the leaves of each subtree are a contiguous range.
+ */
+class TopologyProfile {
+
+    public:
+        typedef std::uint32_t index_type;
+
+        static constexpr index_type npos() {
+            return static_cast<index_type>(-1);
+        }
+
+    public:
+        TopologyProfile() { }
+
+        /**
+         * @param num_taxa
+         *   Number of taxa (or size of the taxon namespace).
+         * @param taxon_index_fn
+         *   Function returning the index (in [0, ``num_taxa``)) of the taxon
+         *   associated with the value of a leaf node; std::invalid_argument
+         *   is thrown on any other value, or if a taxon is found on more
+         *   than one leaf.
+         */
+        template <class TreeT, class TaxonIndexFnT>
+        void assign(const TreeT & tree, std::size_t num_taxa, TaxonIndexFnT taxon_index_fn) {
+            typedef typename TreeT::node_type node_type;
+            this->parents_.clear();
+            this->child_offsets_.assign(1, 0);
+            this->children_.clear();
+            this->leaf_begins_.clear();
+            this->leaf_ends_.clear();
+            this->internal_indexes_.clear();
+            this->internal_nodes_.clear();
+            this->leaf_nodes_.clear();
+            this->leaf_taxa_.clear();
+            this->taxon_leaves_.assign(num_taxa, npos());
+            std::vector<index_type> & pending = this->pending_;
+            pending.clear();
+            for (auto ndi = tree.postorder_begin(); ndi != tree.postorder_end(); ++ndi) {
+                const node_type * nd = ndi.node();
+                index_type node_idx = static_cast<index_type>(this->parents_.size());
+                this->parents_.push_back(npos());
+                if (nd->is_leaf()) {
+                    auto taxon_idx = taxon_index_fn(nd->value());
+                    if (static_cast<std::size_t>(taxon_idx) >= num_taxa
+                            || this->taxon_leaves_[static_cast<std::size_t>(taxon_idx)] != npos()) {
+                        throw std::invalid_argument("platypus::TopologyProfile: leaf node without a valid, distinct taxon index");
+                    }
+                    index_type leaf_idx = static_cast<index_type>(this->leaf_nodes_.size());
+                    this->taxon_leaves_[static_cast<std::size_t>(taxon_idx)] = leaf_idx;
+                    this->leaf_nodes_.push_back(node_idx);
+                    this->leaf_taxa_.push_back(static_cast<index_type>(taxon_idx));
+                    this->leaf_begins_.push_back(leaf_idx);
+                    this->leaf_ends_.push_back(leaf_idx + 1);
+                    this->internal_indexes_.push_back(npos());
+                } else {
+                    std::size_t num_children = 0;
+                    for (const node_type * ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                        ++num_children;
+                    }
+                    std::size_t first = pending.size() - num_children;
+                    for (std::size_t idx = first; idx < pending.size(); ++idx) {
+                        this->parents_[pending[idx]] = node_idx;
+                        this->children_.push_back(pending[idx]);
+                    }
+                    this->leaf_begins_.push_back(this->leaf_begins_[pending[first]]);
+                    this->leaf_ends_.push_back(static_cast<index_type>(this->leaf_nodes_.size()));
+                    this->internal_indexes_.push_back(static_cast<index_type>(this->internal_nodes_.size()));
+                    this->internal_nodes_.push_back(node_idx);
+                    pending.resize(first);
+                }
+                this->child_offsets_.push_back(static_cast<index_type>(this->children_.size()));
+                pending.push_back(node_idx);
+            }
+        }
+
+        inline std::size_t num_nodes() const {
+            return this->parents_.size();
+        }
+
+        inline std::size_t num_leaves() const {
+            return this->leaf_nodes_.size();
+        }
+
+        inline std::size_t num_internal_nodes() const {
+            return this->internal_nodes_.size();
+        }
+
+        // Nodes are indexed in postorder, so the root is the last.
+        inline index_type root() const {
+            return static_cast<index_type>(this->parents_.size() - 1);
+        }
+
+        inline index_type parent(index_type node_idx) const {
+            return this->parents_[node_idx];
+        }
+
+        inline bool is_leaf(index_type node_idx) const {
+            return this->internal_indexes_[node_idx] == npos();
+        }
+
+        inline const index_type * children_begin(index_type node_idx) const {
+            return this->children_.data() + this->child_offsets_[node_idx];
+        }
+
+        inline const index_type * children_end(index_type node_idx) const {
+            return this->children_.data() + this->child_offsets_[node_idx + 1];
+        }
+
+        inline std::size_t num_children(index_type node_idx) const {
+            return this->child_offsets_[node_idx + 1] - this->child_offsets_[node_idx];
+        }
+
+        // Range [``leaf_begin()``, ``leaf_end()``) of the leaves of the subtree of a node.
+        inline index_type leaf_begin(index_type node_idx) const {
+            return this->leaf_begins_[node_idx];
+        }
+
+        inline index_type leaf_end(index_type node_idx) const {
+            return this->leaf_ends_[node_idx];
+        }
+
+        // Index of a node among the internal nodes (in postorder), or npos() for leaves.
+        inline index_type internal_index(index_type node_idx) const {
+            return this->internal_indexes_[node_idx];
+        }
+
+        inline index_type internal_node(index_type internal_idx) const {
+            return this->internal_nodes_[internal_idx];
+        }
+
+        inline index_type leaf_node(index_type leaf_idx) const {
+            return this->leaf_nodes_[leaf_idx];
+        }
+
+        inline index_type leaf_taxon(index_type leaf_idx) const {
+            return this->leaf_taxa_[leaf_idx];
+        }
+
+        // Index of the leaf of a taxon, or npos() if the taxon is not in the tree.
+        inline index_type taxon_leaf(std::size_t taxon_idx) const {
+            return this->taxon_leaves_[taxon_idx];
+        }
+
+    private:
+        std::vector<index_type>     parents_;
+        std::vector<index_type>     child_offsets_;
+        std::vector<index_type>     children_;
+        std::vector<index_type>     leaf_begins_;
+        std::vector<index_type>     leaf_ends_;
+        std::vector<index_type>     internal_indexes_;
+        std::vector<index_type>     internal_nodes_;
+        std::vector<index_type>     leaf_nodes_;
+        std::vector<index_type>     leaf_taxa_;
+        std::vector<index_type>     taxon_leaves_;
+        // scratch space: subtrees whose parents have not yet been visited
+        std::vector<index_type>     pending_;
+
+}; // TopologyProfile
+
+////////////////////////////////////////////////////////////////////////////////
+// TopologyIntersections
+
+/**
+ * The numbers of taxa shared by each subtree of one tree and each subtree of
+ * another (over the same taxon namespace), from which the triplets
+ * (count_triplets()) and quartets (count_quartets()) of shared taxa that
+ * the two trees resolve alike are counted without enumerating them.
+ *
+ * Counts are held for each pair of internal nodes, in a table of
+ * ``n1 * n2`` 32-bit integers (for trees of ``n1`` and ``n2`` internal
+ * nodes), filled in a single postorder pass over the first tree, each row
+ * being the sum of those of the children; counts involving leaves are read
+ * off the leaf ranges of the profiles. Both counts then take O(n^2) time:
+ * each pair of nodes (``u``, ``v``) contributes a closed-form function of
+ * the table of the numbers of taxa shared by the subtrees (or, for
+ * quartets, the branches) around ``u`` and ``v``, which is O(1) per pair
+ * for binary trees and O(``deg(u) * deg(v)``) in general (times
+ * ``min(deg(u), deg(v))`` for the quartets that both trees leave
+ * unresolved). An object can be reused for many pairs of trees, but not
+ * concurrently.
+ */
+class TopologyIntersections {
+
+    public:
+        typedef TopologyProfile::index_type index_type;
+
+        struct TripletCounts {
+            // number of taxa in both trees
+            std::uint64_t   num_taxa;
+            // triplets resolved alike (as ``ab|c``) by both trees
+            std::uint64_t   num_shared_resolved;
+            // triplets unresolved (a polytomy) in both trees
+            std::uint64_t   num_shared_unresolved;
+            // triplets of shared taxa not induced alike by both trees
+            std::uint64_t distance() const {
+                return binomial(this->num_taxa, 3) - this->num_shared_resolved - this->num_shared_unresolved;
+            }
+        };
+
+        struct QuartetCounts {
+            // number of taxa in both trees
+            std::uint64_t   num_taxa;
+            // quartets resolved alike (as ``ab|cd``) by both trees
+            std::uint64_t   num_shared_resolved;
+            // quartets unresolved (a polytomy) in both trees
+            std::uint64_t   num_shared_unresolved;
+            // quartets of shared taxa not induced alike by both trees
+            std::uint64_t distance() const {
+                return binomial(this->num_taxa, 4) - this->num_shared_resolved - this->num_shared_unresolved;
+            }
+        };
+
+    public:
+        TopologyIntersections()
+            : a_(nullptr)
+            , b_(nullptr)
+            , num_rows_(0)
+            , num_cols_(0) { }
+
+        // Fills the table of shared taxa of the subtrees of ``a`` and ``b``, which must outlive the counts.
+        void assign(const TopologyProfile & a, const TopologyProfile & b) {
+            this->a_ = &a;
+            this->b_ = &b;
+            std::size_t nb = b.num_internal_nodes();
+            this->counts_.assign(a.num_internal_nodes() * nb, 0);
+            for (index_type ia = 0; ia < a.num_internal_nodes(); ++ia) {
+                index_type u = a.internal_node(ia);
+                std::uint32_t * row = this->counts_.data() + ia * nb;
+                for (const index_type * ch = a.children_begin(u); ch != a.children_end(u); ++ch) {
+                    if (!a.is_leaf(*ch)) {
+                        const std::uint32_t * child_row = this->counts_.data() + a.internal_index(*ch) * nb;
+                        for (std::size_t ib = 0; ib < nb; ++ib) {
+                            row[ib] += child_row[ib];
+                        }
+                        continue;
+                    }
+                    index_type leaf_idx = b.taxon_leaf(a.leaf_taxon(a.leaf_begin(*ch)));
+                    if (leaf_idx == TopologyProfile::npos()) {
+                        continue;
+                    }
+                    for (index_type v = b.parent(b.leaf_node(leaf_idx)); v != TopologyProfile::npos(); v = b.parent(v)) {
+                        ++row[b.internal_index(v)];
+                    }
+                }
+            }
+            if (a.num_nodes() == 0 || b.num_nodes() == 0) {
+                return;
+            }
+            this->a_sizes_.resize(a.num_nodes());
+            for (index_type u = 0; u < a.num_nodes(); ++u) {
+                this->a_sizes_[u] = this->count(u, b.root());
+            }
+            this->b_sizes_.resize(b.num_nodes());
+            for (index_type v = 0; v < b.num_nodes(); ++v) {
+                this->b_sizes_[v] = this->count(a.root(), v);
+            }
+        }
+
+        // Number of taxa in both the subtree of node ``u`` of the first tree and that of node ``v`` of the second.
+        inline std::uint64_t count(index_type u, index_type v) const {
+            const TopologyProfile & a = *this->a_;
+            const TopologyProfile & b = *this->b_;
+            index_type ia = a.internal_index(u);
+            index_type ib = b.internal_index(v);
+            if (ia != TopologyProfile::npos() && ib != TopologyProfile::npos()) {
+                return this->counts_[ia * b.num_internal_nodes() + ib];
+            }
+            if (ia == TopologyProfile::npos()) {
+                index_type leaf_idx = b.taxon_leaf(a.leaf_taxon(a.leaf_begin(u)));
+                return leaf_idx != TopologyProfile::npos() && leaf_idx >= b.leaf_begin(v) && leaf_idx < b.leaf_end(v) ? 1 : 0;
+            }
+            index_type leaf_idx = a.taxon_leaf(b.leaf_taxon(b.leaf_begin(v)));
+            return leaf_idx != TopologyProfile::npos() && leaf_idx >= a.leaf_begin(u) && leaf_idx < a.leaf_end(u) ? 1 : 0;
+        }
+
+        /**
+         * Counts the triplets of shared taxa resolved alike by the two
+         * trees as rooted trees. A triplet ``ab|c`` is resolved by both
+         * trees iff ``a`` and ``b`` descend from distinct children of a node
+         * ``u`` of the first tree and of a node ``v`` of the second, and
+         * ``c`` descends from neither; it is unresolved in both iff all
+         * three descend from distinct children of such nodes.
+         */
+        TripletCounts count_triplets() {
+            const TopologyProfile & a = *this->a_;
+            const TopologyProfile & b = *this->b_;
+            if (a.num_nodes() == 0 || b.num_nodes() == 0) {
+                return TripletCounts{0, 0, 0};
+            }
+            std::int64_t n = static_cast<std::int64_t>(this->count(a.root(), b.root()));
+            std::int64_t num_resolved = 0;
+            std::int64_t num_unresolved = 0;
+            for (index_type ia = 0; ia < a.num_internal_nodes(); ++ia) {
+                index_type u = a.internal_node(ia);
+                for (index_type ib = 0; ib < b.num_internal_nodes(); ++ib) {
+                    if (this->counts_[ia * b.num_internal_nodes() + ib] < 2) {
+                        continue;
+                    }
+                    index_type v = b.internal_node(ib);
+                    this->fill_cells(u, v, false);
+                    CellSums sums = this->sum_cells();
+                    std::int64_t num_outside = n - static_cast<std::int64_t>(this->a_sizes_[u] + this->b_sizes_[v]) + sums.total;
+                    num_resolved += sums.num_pairs() * num_outside;
+                    if (this->num_rows_ >= 3 && this->num_cols_ >= 3 && sums.total >= 3) {
+                        num_unresolved += this->count_cell_triples(sums);
+                    }
+                }
+            }
+            TripletCounts result;
+            result.num_taxa = static_cast<std::uint64_t>(n);
+            result.num_shared_resolved = static_cast<std::uint64_t>(num_resolved);
+            result.num_shared_unresolved = static_cast<std::uint64_t>(num_unresolved);
+            return result;
+        }
+
+        /**
+         * Counts the quartets of shared taxa resolved alike by the two
+         * trees as unrooted trees. A quartet ``ab|cd`` is resolved by a tree
+         * iff there is a node with ``a`` and ``b`` on two of its branches
+         * and ``c`` and ``d`` on a third, and that node is unique, as is
+         * the node with ``c`` and ``d`` on two branches and ``a`` and ``b``
+         * on a third: so each quartet resolved alike by both trees is
+         * counted twice over the pairs of nodes of the two trees. A quartet
+         * is unresolved by a tree iff its four taxa are on distinct branches
+         * of a node, which is unique; so it is unresolved in both iff
+         * there is one pair of such nodes.
+         */
+        QuartetCounts count_quartets() {
+            const TopologyProfile & a = *this->a_;
+            const TopologyProfile & b = *this->b_;
+            if (a.num_nodes() == 0 || b.num_nodes() == 0) {
+                return QuartetCounts{0, 0, 0};
+            }
+            std::int64_t total = 0;
+            std::int64_t num_unresolved = 0;
+            for (index_type ia = 0; ia < a.num_internal_nodes(); ++ia) {
+                index_type u = a.internal_node(ia);
+                if (a.num_children(u) + (u == a.root() ? 0 : 1) < 3) {
+                    continue;
+                }
+                for (index_type ib = 0; ib < b.num_internal_nodes(); ++ib) {
+                    index_type v = b.internal_node(ib);
+                    if (b.num_children(v) + (v == b.root() ? 0 : 1) < 3) {
+                        continue;
+                    }
+                    this->fill_cells(u, v, true);
+                    total += this->count_cell_quartets();
+                    if (this->num_rows_ >= 4 && this->num_cols_ >= 4) {
+                        CellSums sums = this->sum_cells();
+                        if (sums.total >= 4) {
+                            num_unresolved += this->count_cell_quadruples(sums);
+                        }
+                    }
+                }
+            }
+            QuartetCounts result;
+            result.num_taxa = this->count(a.root(), b.root());
+            // count_cell_quartets() counts twice each of the two pairs of
+            // nodes at which a quartet is found
+            result.num_shared_resolved = static_cast<std::uint64_t>(total / 4);
+            result.num_shared_unresolved = static_cast<std::uint64_t>(num_unresolved);
+            return result;
+        }
+
+        static std::uint64_t binomial(std::uint64_t n, std::uint64_t k) {
+            if (k > n) {
+                return 0;
+            }
+            std::uint64_t result = 1;
+            for (std::uint64_t i = 1; i <= k; ++i) {
+                result = result * (n - k + i) / i;
+            }
+            return result;
+        }
+
+    private:
+        struct CellSums {
+            std::int64_t total;
+            std::int64_t sum_of_squared_rows;
+            std::int64_t sum_of_squared_cols;
+            std::int64_t sum_of_squared_cells;
+            // pairs of taxa in distinct rows and distinct columns
+            std::int64_t num_pairs() const {
+                return (this->total * this->total - this->sum_of_squared_rows - this->sum_of_squared_cols + this->sum_of_squared_cells) / 2;
+            }
+        };
+
+        // Fills the table of the numbers of taxa shared by the branches
+        // (subtrees of the children and, if ``with_ancestors``, the rest of
+        // the tree) of ``u`` (rows) and ``v`` (columns).
+        void fill_cells(index_type u, index_type v, bool with_ancestors) {
+            const TopologyProfile & a = *this->a_;
+            const TopologyProfile & b = *this->b_;
+            bool u_up = with_ancestors && u != a.root();
+            bool v_up = with_ancestors && v != b.root();
+            this->num_rows_ = a.num_children(u) + (u_up ? 1 : 0);
+            this->num_cols_ = b.num_children(v) + (v_up ? 1 : 0);
+            this->cells_.resize(this->num_rows_ * this->num_cols_);
+            this->row_sums_.assign(this->num_rows_, 0);
+            this->col_sums_.assign(this->num_cols_, 0);
+            std::int64_t * cell = this->cells_.data();
+            std::size_t row = 0;
+            for (const index_type * c = a.children_begin(u); c != a.children_end(u); ++c, ++row) {
+                std::size_t col = 0;
+                for (const index_type * d = b.children_begin(v); d != b.children_end(v); ++d, ++col) {
+                    *cell++ = static_cast<std::int64_t>(this->count(*c, *d));
+                }
+                if (v_up) {
+                    *cell++ = static_cast<std::int64_t>(this->a_sizes_[*c] - this->count(*c, v));
+                }
+            }
+            if (u_up) {
+                for (const index_type * d = b.children_begin(v); d != b.children_end(v); ++d) {
+                    *cell++ = static_cast<std::int64_t>(this->b_sizes_[*d] - this->count(u, *d));
+                }
+                if (v_up) {
+                    *cell++ = static_cast<std::int64_t>(this->count(a.root(), b.root()) + this->count(u, v))
+                        - static_cast<std::int64_t>(this->a_sizes_[u] + this->b_sizes_[v]);
+                }
+            }
+            for (std::size_t i = 0; i < this->num_rows_; ++i) {
+                for (std::size_t j = 0; j < this->num_cols_; ++j) {
+                    std::int64_t m = this->cells_[i * this->num_cols_ + j];
+                    this->row_sums_[i] += m;
+                    this->col_sums_[j] += m;
+                }
+            }
+        }
+
+        CellSums sum_cells() const {
+            CellSums sums{0, 0, 0, 0};
+            for (std::int64_t m : this->cells_) {
+                sums.total += m;
+                sums.sum_of_squared_cells += m * m;
+            }
+            for (std::int64_t r : this->row_sums_) {
+                sums.sum_of_squared_rows += r * r;
+            }
+            for (std::int64_t c : this->col_sums_) {
+                sums.sum_of_squared_cols += c * c;
+            }
+            return sums;
+        }
+
+        // Number of triples of taxa in distinct rows and distinct columns:
+        // those in distinct rows, less those of which two or three share a
+        // column.
+        std::int64_t count_cell_triples(const CellSums & sums) const {
+            std::int64_t result = elementary_symmetric3(this->row_sums_);
+            for (std::size_t j = 0; j < this->num_cols_; ++j) {
+                const std::int64_t * col = this->cells_.data() + j;
+                std::int64_t c = this->col_sums_[j];
+                std::int64_t e1 = 0;
+                std::int64_t e2 = 0;
+                std::int64_t e3 = 0;
+                std::int64_t weighted = 0;
+                for (std::size_t i = 0; i < this->num_rows_; ++i) {
+                    std::int64_t m = col[i * this->num_cols_];
+                    e3 += e2 * m;
+                    e2 += e1 * m;
+                    e1 += m;
+                    weighted += m * (this->row_sums_[i] - m) * (c - m);
+                }
+                result -= e3 + (sums.total - c) * e2 - weighted;
+            }
+            return result;
+        }
+
+        // Number of sets of four taxa in distinct rows and distinct columns,
+        // by inclusion-exclusion over the ways in which the columns of four
+        // taxa in distinct rows can coincide: all distinct, one pair, two
+        // pairs, three or all four. The ``t_*`` are numbers of ordered
+        // tuples.
+        std::int64_t count_cell_quadruples(const CellSums & sums) const {
+            std::size_t nr = this->num_rows_;
+            std::size_t nc = this->num_cols_;
+            std::int64_t n = sums.total;
+            std::int64_t t_pair = 0;
+            std::int64_t t_three = 0;
+            std::int64_t t_four = 0;
+            std::int64_t sum_col_pairs = 0;
+            for (std::size_t j = 0; j < nc; ++j) {
+                const std::int64_t * col = this->cells_.data() + j;
+                std::int64_t c = this->col_sums_[j];
+                std::int64_t e1 = 0;
+                std::int64_t e2 = 0;
+                std::int64_t e3 = 0;
+                std::int64_t e4 = 0;
+                std::int64_t m2 = 0;
+                std::int64_t mr = 0;
+                std::int64_t mr2 = 0;
+                std::int64_t m2r = 0;
+                std::int64_t m2r2 = 0;
+                for (std::size_t i = 0; i < nr; ++i) {
+                    std::int64_t m = col[i * nc];
+                    std::int64_t r = this->row_sums_[i];
+                    e4 += e3 * m;
+                    e3 += e2 * m;
+                    e2 += e1 * m;
+                    e1 += m;
+                    m2 += m * m;
+                    mr += m * r;
+                    mr2 += m * r * r;
+                    m2r += m * m * r;
+                    m2r2 += m * m * r * r;
+                }
+                // a pair in the column in distinct rows, and the other two
+                // taxa in distinct other rows
+                std::int64_t pairs = c * c - m2;
+                sum_col_pairs += pairs;
+                t_pair += (n * n - sums.sum_of_squared_rows) * pairs
+                    - 4 * n * (mr * c - m2r)
+                    + 4 * (mr2 * c - m2r2)
+                    + 2 * (mr * mr - m2r2);
+                // three taxa in the column in distinct rows, and the fourth
+                // in another row
+                std::int64_t three = n * e3;
+                for (std::size_t i = 0; i < nr; ++i) {
+                    std::int64_t m = col[i * nc];
+                    three -= m * this->row_sums_[i] * (e2 - m * (c - m));
+                }
+                t_three += 6 * three;
+                t_four += 24 * e4;
+            }
+            // two pairs, each in a column and in distinct rows: all pairs of
+            // such pairs, less those sharing a row, plus those sharing two
+            // rows (the squared entries of the Gram matrix of the table, off
+            // the diagonal)
+            std::int64_t shared_one = 0;
+            std::int64_t shared_two = 0;
+            for (std::size_t i = 0; i < nr; ++i) {
+                std::int64_t w = 0;
+                std::int64_t q = 0;
+                for (std::size_t j = 0; j < nc; ++j) {
+                    std::int64_t m = this->cells_[i * nc + j];
+                    w += m * (this->col_sums_[j] - m);
+                    q += m * m;
+                }
+                shared_one += w * w;
+                shared_two -= q * q;
+            }
+            bool by_rows = nr <= nc;
+            std::size_t ng = by_rows ? nr : nc;
+            std::size_t nk = by_rows ? nc : nr;
+            for (std::size_t x = 0; x < ng; ++x) {
+                for (std::size_t y = 0; y < ng; ++y) {
+                    std::int64_t g = 0;
+                    for (std::size_t k = 0; k < nk; ++k) {
+                        g += by_rows
+                            ? this->cells_[x * nc + k] * this->cells_[y * nc + k]
+                            : this->cells_[k * nc + x] * this->cells_[k * nc + y];
+                    }
+                    shared_two += g * g;
+                }
+            }
+            std::int64_t t_two_pairs = sum_col_pairs * sum_col_pairs - 4 * shared_one + 2 * shared_two;
+            std::int64_t t_distinct = 24 * elementary_symmetric4(this->row_sums_);
+            return (t_distinct - 6 * t_pair + 3 * t_two_pairs + 8 * t_three - 6 * t_four) / 24;
+        }
+
+        // Twice the number of pairs ({a, b}, {c, d}) of pairs of taxa, with
+        // ``a`` and ``b`` in distinct rows and distinct columns, and ``c``
+        // and ``d`` in a single cell of another row and another column.
+        std::int64_t count_cell_quartets() const {
+            std::size_t nc = this->num_cols_;
+            std::int64_t n = 0;
+            std::int64_t pairs_total = 0;
+            this->row_pairs_.assign(this->num_rows_, 0);
+            this->col_pairs_.assign(nc, 0);
+            for (std::size_t i = 0; i < this->num_rows_; ++i) {
+                for (std::size_t j = 0; j < nc; ++j) {
+                    std::int64_t m = this->cells_[i * nc + j];
+                    std::int64_t q = m * (m - 1) / 2;
+                    n += m;
+                    pairs_total += q;
+                    this->row_pairs_[i] += q;
+                    this->col_pairs_[j] += q;
+                }
+            }
+            std::int64_t result = 0;
+            for (std::size_t i = 0; i < this->num_rows_; ++i) {
+                for (std::size_t j = 0; j < nc; ++j) {
+                    std::int64_t m = this->cells_[i * nc + j];
+                    std::int64_t q = m * (m - 1) / 2;
+                    std::int64_t r = this->row_sums_[i] - m;
+                    std::int64_t c = this->col_sums_[j] - m;
+                    // taxa in other rows and other columns
+                    std::int64_t k = n - r - c - m;
+                    result += m * k * (pairs_total + 2 * (q - this->row_pairs_[i] - this->col_pairs_[j]));
+                    result += 2 * q * r * c;
+                }
+            }
+            return result;
+        }
+
+        // Sum of the products of all triples of ``values``.
+        static std::int64_t elementary_symmetric3(const std::vector<std::int64_t> & values) {
+            std::int64_t e1 = 0;
+            std::int64_t e2 = 0;
+            std::int64_t e3 = 0;
+            for (std::int64_t x : values) {
+                e3 += e2 * x;
+                e2 += e1 * x;
+                e1 += x;
+            }
+            return e3;
+        }
+
+        // Sum of the products of all quadruples of ``values``.
+        static std::int64_t elementary_symmetric4(const std::vector<std::int64_t> & values) {
+            std::int64_t e1 = 0;
+            std::int64_t e2 = 0;
+            std::int64_t e3 = 0;
+            std::int64_t e4 = 0;
+            for (std::int64_t x : values) {
+                e4 += e3 * x;
+                e3 += e2 * x;
+                e2 += e1 * x;
+                e1 += x;
+            }
+            return e4;
+        }
+
+    private:
+        const TopologyProfile *             a_;
+        const TopologyProfile *             b_;
+        std::vector<std::uint32_t>          counts_;
+        std::vector<std::uint64_t>          a_sizes_;
+        std::vector<std::uint64_t>          b_sizes_;
+        // table of the branches of a pair of nodes
+        std::size_t                         num_rows_;
+        std::size_t                         num_cols_;
+        std::vector<std::int64_t>           cells_;
+        std::vector<std::int64_t>           row_sums_;
+        std::vector<std::int64_t>           col_sums_;
+        mutable std::vector<std::int64_t>   row_pairs_;
+        mutable std::vector<std::int64_t>   col_pairs_;
+
+}; // TopologyIntersections
+
+////////////////////////////////////////////////////////////////////////////////
+// TripletDistances, QuartetDistances
+
+/**
+ * Pairwise triplet or quartet distances between all trees of a collection
+ * on a shared taxon namespace (see TripletDistances and QuartetDistances).
+ *
+ * The trees are first reduced to topology profiles (see TopologyProfile), in
+ * parallel. Pairs are then compared in square tiles of
+ * ``TILE_SIZE`` x ``TILE_SIZE`` trees, distributed among threads (see
+ * for_each_pair_tile()), each with its own table of shared taxa (see
+ * TopologyIntersections) reused for all the pairs of a tile. Each comparison
+ * takes O(n^2) time and space for trees of ``n`` taxa. Distances are stored
+ * in triangular matrices.
+ */
+class TopologyDistances {
+
+    public:
+        // number of trees along each side of a tile of comparisons
+        static const std::size_t TILE_SIZE = 8;
+
+    public:
+
+        /**
+         * Calculates the distances between all trees in [``trees_begin``,
+         * ``trees_end``), using ``num_threads`` threads (see
+         * resolve_num_threads()). ``taxon_index_fn`` is as for
+         * TopologyProfile::assign(), and is called concurrently. Trees
+         * are compared over the taxa that they share.
+         */
+        template <class IterT, class TaxonIndexFnT>
+        void assign(IterT trees_begin,
+                IterT trees_end,
+                std::size_t num_taxa,
+                TaxonIndexFnT taxon_index_fn,
+                unsigned int num_threads=0) {
+            std::size_t num_trees = static_cast<std::size_t>(std::distance(trees_begin, trees_end));
+            num_threads = resolve_num_threads(num_threads);
+            this->profiles_.clear();
+            this->profiles_.resize(num_trees);
+            std::size_t num_blocks = std::min<std::size_t>(num_threads, num_trees);
+            if (num_blocks > 0) {
+                std::size_t block_size = (num_trees + num_blocks - 1) / num_blocks;
+                parallel_for(num_blocks, num_threads, [&] (std::size_t block_idx) {
+                    std::size_t begin_idx = block_idx * block_size;
+                    std::size_t end_idx = std::min(begin_idx + block_size, num_trees);
+                    IterT tree_iter = trees_begin;
+                    std::advance(tree_iter, begin_idx);
+                    for (std::size_t idx = begin_idx; idx < end_idx; ++idx, ++tree_iter) {
+                        this->profiles_[idx].assign(*tree_iter, num_taxa, taxon_index_fn);
+                    }
+                });
+            }
+            this->calculate_distances(num_threads);
+        }
+
+        /**
+         * As above, with taxa given by ``get_taxon_index()`` of node values
+         * (e.g., platypus::TaxonNodeValue).
+         */
+        template <class IterT>
+        void assign(IterT trees_begin,
+                IterT trees_end,
+                const TaxonNamespace & taxon_namespace,
+                unsigned int num_threads=0) {
+            typedef typename std::iterator_traits<IterT>::value_type::value_type value_type;
+            this->assign(trees_begin,
+                    trees_end,
+                    taxon_namespace.size(),
+                    [] (const value_type & nv) -> TaxonNamespace::index_type { return nv.get_taxon_index(); },
+                    num_threads);
+        }
+
+        // Number of trees.
+        inline std::size_t size() const {
+            return this->profiles_.size();
+        }
+
+        inline std::uint64_t get_distance(std::size_t i, std::size_t j) const {
+            return this->distances_.get(i, j);
+        }
+
+        // Number of triplets or quartets resolved alike by trees ``i`` and ``j``.
+        inline std::uint64_t get_num_shared_resolved(std::size_t i, std::size_t j) const {
+            return this->shared_resolved_.get(i, j);
+        }
+
+        inline const TriangularMatrix<std::uint64_t> & distances() const {
+            return this->distances_;
+        }
+
+        /**
+         * Adds a row to ``table`` for each pair of trees (``i`` < ``j``), in
+         * order, with columns "tree1", "tree2" (indexes of the trees), and
+         * "triplet_distance" and "shared_triplets" (or "quartet_distance"
+         * and "shared_quartets"), which are added to the table if it has no
+         * columns.
+         */
+        void export_table(DataTable & table) const {
+            std::string subset_name = this->with_quartets_ ? "quartet" : "triplet";
+            if (table.num_columns() == 0) {
+                table.add_key_column<unsigned long>("tree1");
+                table.add_key_column<unsigned long>("tree2");
+                table.add_data_column<unsigned long>(subset_name + "_distance");
+                table.add_data_column<unsigned long>("shared_" + subset_name + "s");
+            }
+            std::size_t n = this->size();
+            table.reserve(table.num_rows() + this->distances_.values().size());
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t j = i + 1; j < n; ++j) {
+                    auto & row = table.add_row();
+                    row << static_cast<unsigned long>(i)
+                        << static_cast<unsigned long>(j)
+                        << static_cast<unsigned long>(this->distances_.get(i, j))
+                        << static_cast<unsigned long>(this->shared_resolved_.get(i, j));
+                }
+            }
+        }
+
+    protected:
+        TopologyDistances(bool with_quartets)
+            : with_quartets_(with_quartets) { }
+
+    private:
+
+        void calculate_distances(unsigned int num_threads) {
+            std::size_t n = this->profiles_.size();
+            this->distances_.resize(n);
+            this->shared_resolved_.resize(n);
+            for_each_pair_tile(n, TILE_SIZE, num_threads, [this] (std::size_t i_begin,
+                        std::size_t i_end,
+                        std::size_t j_begin,
+                        std::size_t j_end) {
+                TopologyIntersections intersections;
+                for (std::size_t i = i_begin; i < i_end; ++i) {
+                    for (std::size_t j = std::max(j_begin, i + 1); j < j_end; ++j) {
+                        intersections.assign(this->profiles_[i], this->profiles_[j]);
+                        if (this->with_quartets_) {
+                            TopologyIntersections::QuartetCounts counts = intersections.count_quartets();
+                            this->distances_.set(i, j, counts.distance());
+                            this->shared_resolved_.set(i, j, counts.num_shared_resolved);
+                        } else {
+                            TopologyIntersections::TripletCounts counts = intersections.count_triplets();
+                            this->distances_.set(i, j, counts.distance());
+                            this->shared_resolved_.set(i, j, counts.num_shared_resolved);
+                        }
+                    }
+                }
+            });
+        }
+
+    private:
+        bool                                with_quartets_;
+        std::vector<TopologyProfile>        profiles_;
+        TriangularMatrix<std::uint64_t>     distances_;
+        TriangularMatrix<std::uint64_t>     shared_resolved_;
+
+}; // TopologyDistances
+
+/**
+ * Triplet distances between rooted trees: the number of triplets of taxa
+ * (shared by both trees) whose induced rooted topologies (``ab|c``,
+ * ``ac|b``, ``bc|a`` or unresolved) differ.
+ */
+class TripletDistances : public TopologyDistances {
+    public:
+        TripletDistances()
+            : TopologyDistances(false) { }
+}; // TripletDistances
+
+/**
+ * Quartet distances between unrooted trees: the number of quartets of
+ * taxa (shared by both trees) that are not resolved alike (``ab|cd``,
+ * ``ac|bd`` or ``ad|bc``) by both trees, nor left unresolved by both:
+ * i.e., the number of quartets whose induced unrooted topologies differ.
+ */
+class QuartetDistances : public TopologyDistances {
+    public:
+        QuartetDistances()
+            : TopologyDistances(true) { }
+}; // QuartetDistances
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,402 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Slab-based arena allocator for tree nodes.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_MODEL_TREENODEARENA_HPP
+#define PLATYPUS_MODEL_TREENODEARENA_HPP
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// HeapSlabStorage
+
+/**
+ * Default source of the slabs of a platypus::TreeNodeArena: the global
+ * allocator. Other sources (e.g. platypus::MappedSlabStorage) provide the
+ * same three methods.
+ */
+class HeapSlabStorage {
+    public:
+        void * allocate_slab(std::size_t num_bytes) {
+            return ::operator new(num_bytes);
+        }
+        void deallocate_slab(void * slab, std::size_t) {
+            ::operator delete(slab);
+        }
+        // Called once all slabs have been deallocated.
+        void release() { }
+
+}; // HeapSlabStorage
+
+////////////////////////////////////////////////////////////////////////////////
+// TreeNodeArena
+
+/**
+ * An allocator that hands out objects (typically, platypus::TreeNode
+ * instances) from contiguous slabs of storage, for use as the
+ * ``TreeNodeAllocatorT`` parameter of platypus::Tree:
+ *
+ *      typedef platypus::TreeNode<MyValue> NodeType;
+ *      platypus::Tree<MyValue, platypus::TreeNodeArena<NodeType>> tree;
+ *
+ * Ownership is tracked per slab rather than per pointer, so the tree does
+ * not need to maintain its own record of allocated nodes. Individually
+ * deallocated slots are recycled through an intrusive free list, and all
+ * storage goes away in a single sweep over the slabs when the arena is
+ * released.
+ *
+ * Copies of an arena do *not* share storage: a copy-constructed arena starts
+ * out empty (a copied tree allocates its own nodes), while a moved arena
+ * takes over the slabs of its source.
+ *
+ * @tparam T
+ *   Type of object allocated.
+ * @tparam SlabStorageT
+ *   Source of the storage of the slabs (see platypus::HeapSlabStorage and
+ *   platypus::MappedSlabStorage). Copies of an arena start out with a copy
+ *   of its storage object, which must hence not share any slabs either.
+ */
+template <class T, class SlabStorageT=HeapSlabStorage>
+class TreeNodeArena {
+
+    public:
+        typedef T                   value_type;
+        typedef T *                 pointer;
+        typedef const T *           const_pointer;
+        typedef T &                 reference;
+        typedef const T &           const_reference;
+        typedef std::size_t         size_type;
+        typedef std::ptrdiff_t      difference_type;
+
+        // Tells platypus::Tree that this allocator knows which objects it has
+        // handed out, and can destroy them all in bulk.
+        typedef std::true_type      tracks_node_ownership;
+
+        template <class U> struct rebind {
+            typedef TreeNodeArena<U, SlabStorageT> other;
+        };
+
+    public:
+
+        /////////////////////////////////////////////////////////////////////////
+        // Lifecycle
+
+        /**
+         * @param initial_slab_size
+         *   Number of objects in the first slab allocated; subsequent slabs
+         *   double in size up to ``max_slab_size``.
+         * @param max_slab_size
+         *   Upper limit on the number of objects in slabs allocated on demand
+         *   (explicit calls to ``reserve()`` are not bound by this).
+         */
+        TreeNodeArena(size_type initial_slab_size=64,
+                size_type max_slab_size=65536,
+                const SlabStorageT & storage=SlabStorageT())
+            : initial_slab_size_(initial_slab_size > 0 ? initial_slab_size : 1)
+            , max_slab_size_(max_slab_size > initial_slab_size_ ? max_slab_size : initial_slab_size_)
+            , storage_(storage)
+            , current_slab_(0)
+            , free_list_(nullptr)
+            , num_live_(0) { }
+
+        TreeNodeArena(const TreeNodeArena& other)
+            : initial_slab_size_(other.initial_slab_size_)
+            , max_slab_size_(other.max_slab_size_)
+            , storage_(other.storage_)
+            , current_slab_(0)
+            , free_list_(nullptr)
+            , num_live_(0) { }
+
+        template <class U>
+        TreeNodeArena(const TreeNodeArena<U, SlabStorageT>& other)
+            : initial_slab_size_(other.initial_slab_size())
+            , max_slab_size_(other.max_slab_size())
+            , storage_(other.storage())
+            , current_slab_(0)
+            , free_list_(nullptr)
+            , num_live_(0) { }
+
+        TreeNodeArena(TreeNodeArena&& other) noexcept
+            : initial_slab_size_(other.initial_slab_size_)
+            , max_slab_size_(other.max_slab_size_)
+            , storage_(std::move(other.storage_))
+            , slabs_(std::move(other.slabs_))
+            , current_slab_(other.current_slab_)
+            , free_list_(other.free_list_)
+            , num_live_(other.num_live_) {
+            other.slabs_.clear();
+            other.current_slab_ = 0;
+            other.free_list_ = nullptr;
+            other.num_live_ = 0;
+        }
+
+        // Storage is never shared: assignment leaves the arena as-is.
+        TreeNodeArena& operator=(const TreeNodeArena&) {
+            return *this;
+        }
+
+        TreeNodeArena& operator=(TreeNodeArena&& other) noexcept {
+            if (this != &other) {
+                this->release();
+                this->initial_slab_size_ = other.initial_slab_size_;
+                this->max_slab_size_ = other.max_slab_size_;
+                this->storage_ = std::move(other.storage_);
+                this->slabs_ = std::move(other.slabs_);
+                this->current_slab_ = other.current_slab_;
+                this->free_list_ = other.free_list_;
+                this->num_live_ = other.num_live_;
+                other.slabs_.clear();
+                other.current_slab_ = 0;
+                other.free_list_ = nullptr;
+                other.num_live_ = 0;
+            }
+            return *this;
+        }
+
+        ~TreeNodeArena() {
+            this->release();
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Allocation
+
+        /**
+         * Returns storage for a single object. Requests for more than one
+         * object are passed through to the global allocator.
+         *
+         * Note that every slot handed out by the arena is assumed to hold a
+         * constructed object until it is deallocated, as bulk destruction
+         * (``destroy_all()``, ``release()``) will invoke the destructor on
+         * it.
+         */
+        pointer allocate(size_type n, const void * =0) {
+            if (n != 1) {
+                return static_cast<pointer>(::operator new(n * sizeof(value_type)));
+            }
+            if (this->free_list_ != nullptr) {
+                Slot * slot = this->free_list_;
+                this->free_list_ = slot->next_free;
+                ++this->num_live_;
+                return reinterpret_cast<pointer>(slot);
+            }
+            while (this->current_slab_ < this->slabs_.size()
+                    && this->slabs_[this->current_slab_].used == this->slabs_[this->current_slab_].capacity) {
+                ++this->current_slab_;
+            }
+            if (this->current_slab_ == this->slabs_.size()) {
+                size_type slab_size = this->initial_slab_size_;
+                if (!this->slabs_.empty()) {
+                    slab_size = this->slabs_.back().capacity * 2;
+                    if (slab_size > this->max_slab_size_) {
+                        slab_size = this->max_slab_size_;
+                    }
+                }
+                this->add_slab(slab_size);
+            }
+            Slab & slab = this->slabs_[this->current_slab_];
+            ++this->num_live_;
+            return reinterpret_cast<pointer>(slab.slots + slab.used++);
+        }
+
+        /**
+         * Returns storage for a single object to the arena's free list, to be
+         * handed out by the next call to ``allocate()``.
+         */
+        void deallocate(pointer p, size_type n) {
+            if (p == nullptr) {
+                return;
+            }
+            if (n != 1) {
+                ::operator delete(p);
+                return;
+            }
+            Slot * slot = reinterpret_cast<Slot *>(p);
+            slot->next_free = this->free_list_;
+            this->free_list_ = slot;
+            --this->num_live_;
+        }
+
+        template <class U, class... Args>
+        void construct(U * p, Args&&... args) {
+            ::new(static_cast<void *>(p)) U(std::forward<Args>(args)...);
+        }
+
+        template <class U>
+        void destroy(U * p) {
+            p->~U();
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Bulk Management
+
+        /**
+         * Ensures that at least ``n`` further objects can be allocated
+         * without any further requests to the system allocator.
+         */
+        void reserve(size_type n) {
+            size_type available = 0;
+            for (size_type i = this->current_slab_; i < this->slabs_.size(); ++i) {
+                available += this->slabs_[i].capacity - this->slabs_[i].used;
+            }
+            if (available < n) {
+                this->add_slab(n - available);
+            }
+        }
+
+        /**
+         * Destroys every object still alive in the arena, but keeps the slabs
+         * so that subsequent allocations reuse the same storage.
+         */
+        void destroy_all() {
+            if (!std::is_trivially_destructible<value_type>::value) {
+                // slots on the free list have already been destroyed
+                std::vector<std::vector<bool>> is_free(this->slabs_.size());
+                for (Slot * slot = this->free_list_; slot != nullptr; slot = slot->next_free) {
+                    for (size_type si = 0; si < this->slabs_.size(); ++si) {
+                        Slab & slab = this->slabs_[si];
+                        if (slot >= slab.slots && slot < slab.slots + slab.capacity) {
+                            if (is_free[si].empty()) {
+                                is_free[si].resize(slab.used, false);
+                            }
+                            is_free[si][slot - slab.slots] = true;
+                            break;
+                        }
+                    }
+                }
+                for (size_type si = 0; si < this->slabs_.size(); ++si) {
+                    Slab & slab = this->slabs_[si];
+                    for (size_type i = 0; i < slab.used; ++i) {
+                        if (is_free[si].empty() || !is_free[si][i]) {
+                            reinterpret_cast<pointer>(slab.slots + i)->~value_type();
+                        }
+                    }
+                }
+            }
+            for (auto & slab : this->slabs_) {
+                slab.used = 0;
+            }
+            this->current_slab_ = 0;
+            this->free_list_ = nullptr;
+            this->num_live_ = 0;
+        }
+
+        /**
+         * Destroys every object still alive in the arena and returns all
+         * storage to the system. If ``value_type`` is trivially destructible,
+         * this is O(number of slabs); otherwise each object still alive is
+         * visited once to invoke its destructor.
+         */
+        void release() {
+            this->destroy_all();
+            for (auto & slab : this->slabs_) {
+                this->storage_.deallocate_slab(slab.slots, slab.capacity * sizeof(Slot));
+            }
+            this->slabs_.clear();
+            this->storage_.release();
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Metrics
+
+        size_type size() const {
+            return this->num_live_;
+        }
+
+        size_type capacity() const {
+            size_type count = 0;
+            for (auto & slab : this->slabs_) {
+                count += slab.capacity;
+            }
+            return count;
+        }
+
+        size_type num_slabs() const {
+            return this->slabs_.size();
+        }
+
+        size_type initial_slab_size() const {
+            return this->initial_slab_size_;
+        }
+
+        size_type max_slab_size() const {
+            return this->max_slab_size_;
+        }
+
+        const SlabStorageT & storage() const {
+            return this->storage_;
+        }
+
+        size_type max_size() const {
+            return static_cast<size_type>(-1) / sizeof(value_type);
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Comparison
+
+        // Arenas never share storage, so only an arena is equal to itself.
+        bool operator==(const TreeNodeArena& other) const {
+            return this == &other;
+        }
+
+        bool operator!=(const TreeNodeArena& other) const {
+            return this != &other;
+        }
+
+    private:
+
+        union Slot {
+            Slot * next_free;
+            typename std::aligned_storage<sizeof(value_type), std::alignment_of<value_type>::value>::type storage;
+        };
+
+        struct Slab {
+            Slot *          slots;
+            size_type       capacity;
+            size_type       used;
+        };
+
+        void add_slab(size_type slab_size) {
+            Slab slab;
+            slab.slots = static_cast<Slot *>(this->storage_.allocate_slab(slab_size * sizeof(Slot)));
+            slab.capacity = slab_size;
+            slab.used = 0;
+            this->slabs_.push_back(slab);
+        }
+
+    private:
+        size_type               initial_slab_size_;
+        size_type               max_slab_size_;
+        SlabStorageT            storage_;
+        std::vector<Slab>       slabs_;
+        size_type               current_slab_;
+        Slot *                  free_list_;
+        size_type               num_live_;
+
+}; // TreeNodeArena
+
+} // namespace platypus
+
+#endif
@@ -22,45 +22,33 @@
 #define PLATYPUS_SIMULATE_ARCHETYPALTREE_HPP
 
 #include <cassert>
+#include <iterator>
 #include <stdexcept>
-#include <stack>
-#include <set>
-#include <queue>
+#include <vector>
 
 namespace platypus {
 
 namespace treepattern { namespace detail {
 
-template <typename TreeT, typename NodeValueT>
-typename TreeT::node_type * join_nodes(
+// Creates a leaf node for each value in [leaf_values_begin,
+// leaf_values_end), after reserving storage for these and the
+// ``num_leaves - 1`` internal nodes (less the head node) of a bifurcating
+// tree on them.
+template <typename TreeT, typename LeafIterT>
+void create_leaf_nodes(
         TreeT & tree,
-        std::vector<NodeValueT> & node_pool,
-        unsigned long start_idx,
-        unsigned long stop_idx) {
-    assert(stop_idx > start_idx);
-    unsigned long span = stop_idx - start_idx;
-    if (span == 2) {
-        typename TreeT::node_type * node = tree.create_internal_node();
-        node->add_child(node_pool[start_idx]);
-        node->add_child(node_pool[start_idx+1]);
-        return node;
-    } else if (span == 3) {
-        typename TreeT::node_type * node1 = tree.create_internal_node();
-        node1->add_child(node_pool[start_idx]);
-        node1->add_child(node_pool[start_idx+1]);
-        typename TreeT::node_type * node2 = tree.create_internal_node();
-        node2->add_child(node_pool[start_idx+2]);
-        node2->add_child(node1);
-        return node2;
+        LeafIterT leaf_values_begin,
+        LeafIterT leaf_values_end,
+        std::vector<typename TreeT::node_type *> & leaf_nodes) {
+    auto num_leaves = static_cast<std::size_t>(std::distance(leaf_values_begin, leaf_values_end));
+    if (num_leaves > 1) {
+        tree.reserve_nodes(2 * num_leaves - 2);
     } else {
-        unsigned long mid = static_cast<unsigned long>(span/2);
-        mid = start_idx + mid;
-        auto * ch1 = detail::join_nodes(tree, node_pool, start_idx, mid);
-        auto * ch2 = detail::join_nodes(tree, node_pool, mid, stop_idx);
-        typename TreeT::node_type * node = tree.create_internal_node();
-        node->add_child(ch1);
-        node->add_child(ch2);
-        return node;
+        tree.reserve_nodes(num_leaves);
+    }
+    leaf_nodes.reserve(num_leaves);
+    for (auto leaf_iter = leaf_values_begin; leaf_iter != leaf_values_end; ++leaf_iter) {
+        leaf_nodes.push_back(tree.create_leaf_node(*leaf_iter));
     }
 }
 
@@ -69,13 +57,17 @@ typename TreeT::node_type * join_nodes(
 /**
  * Generates a fully-pectinate, comb, or ladderized tree.
  *
+ * Storage for all nodes is reserved up front (see Tree::reserve_nodes()),
+ * and the tree is wired in a single pass.
+ *
  * @tparam TreeT
  * @tparam LeafIterT
+ *   A forward iterator.
  * @param tree
  * @param leaf_values_begin
  *   Iterator to beginning of sequence of leaf values that will
  *   become attached to leaf nodes.
- * @param leaf_values_begin
+ * @param leaf_values_end
  *   Iterator to one past the end of sequence of leaf values that will
  *   become attached to leaf nodes.
  */
@@ -85,42 +77,28 @@ void build_maximally_unbalanced_tree(
         LeafIterT leaf_values_begin,
         LeafIterT leaf_values_end,
         bool ladderize_right=true) {
-    std::queue<typename TreeT::node_type *> leaf_nodes;
-    for (auto & leaf_iter = leaf_values_begin; leaf_iter != leaf_values_end; ++leaf_iter) {
-        typename TreeT::node_type * node = tree.create_leaf_node(*leaf_iter);
-        leaf_nodes.push(node);
-    }
+    std::vector<typename TreeT::node_type *> leaf_nodes;
+    treepattern::detail::create_leaf_nodes(tree, leaf_values_begin, leaf_values_end, leaf_nodes);
+    std::size_t num_leaves = leaf_nodes.size();
     auto apical_node = tree.head_node();
-    auto insert_leaf_node = [&leaf_nodes, &apical_node] () {
-        apical_node->add_child(leaf_nodes.front());
-        leaf_nodes.pop();
-    };
-    if (ladderize_right) {
-        auto insert_internal_node = [&apical_node, &tree] () {
-                typename TreeT::node_type * node = tree.create_internal_node();
-                apical_node->add_child(node);
-                apical_node = node;
-        };
-        while (!leaf_nodes.empty()) {
-            insert_leaf_node();
-            if (leaf_nodes.size() > 1) {
-                insert_internal_node();
-            } else {
-                insert_leaf_node();
-            }
-        }
-    } else {
-        while (!leaf_nodes.empty()) {
-            if (leaf_nodes.size() > 2) {
-                typename TreeT::node_type * node = tree.create_internal_node();
-                apical_node->add_child(node);
-                insert_leaf_node();
-                apical_node = node;
-            } else {
-                insert_leaf_node();
-                insert_leaf_node();
-            }
+    if (num_leaves == 1) {
+        apical_node->add_child(leaf_nodes[0]);
+        return;
+    }
+    for (std::size_t leaf_idx = 0; leaf_idx + 2 < num_leaves; ++leaf_idx) {
+        typename TreeT::node_type * node = tree.create_internal_node();
+        if (ladderize_right) {
+            apical_node->add_child(leaf_nodes[leaf_idx]);
+            apical_node->add_child(node);
+        } else {
+            apical_node->add_child(node);
+            apical_node->add_child(leaf_nodes[leaf_idx]);
         }
+        apical_node = node;
+    }
+    if (num_leaves >= 2) {
+        apical_node->add_child(leaf_nodes[num_leaves - 2]);
+        apical_node->add_child(leaf_nodes[num_leaves - 1]);
     }
 }
 
@@ -128,13 +106,19 @@ void build_maximally_unbalanced_tree(
 /**
  * Generates a balanced or symmetric tree.
  *
+ * The leaves are split in half at the root, and each half recursively split
+ * in half (with a span of three leaves joined as "(c,(a,b))"). Storage for
+ * all nodes is reserved up front (see Tree::reserve_nodes()), and spans are
+ * processed using an explicit stack rather than by recursion.
+ *
  * @tparam TreeT
  * @tparam LeafIterT
+ *   A forward iterator.
  * @param tree
  * @param leaf_values_begin
  *   Iterator to beginning of sequence of leaf values that will
  *   become attached to leaf nodes.
- * @param leaf_values_begin
+ * @param leaf_values_end
  *   Iterator to one past the end of sequence of leaf values that will
  *   become attached to leaf nodes.
  */
@@ -143,80 +127,260 @@ void build_maximally_balanced_tree(
         TreeT & tree,
         LeafIterT leaf_values_begin,
         LeafIterT leaf_values_end) {
-    std::vector<typename TreeT::node_type *> node_pool;
-    for (auto & leaf_iter = leaf_values_begin; leaf_iter != leaf_values_end; ++leaf_iter) {
-        typename TreeT::node_type * node = tree.create_leaf_node(*leaf_iter);
-        node_pool.push_back(node);
-    }
-    unsigned long mid = static_cast<unsigned long>(node_pool.size()/2);
-    auto * ch1 = treepattern::detail::join_nodes(tree, node_pool, 0, mid);
-    auto * ch2 = treepattern::detail::join_nodes(tree, node_pool, mid, node_pool.size());
-    tree.head_node()->add_child(ch1);
-    tree.head_node()->add_child(ch2);
-
-    // std::stack<typename treet::node_type *> node_pool;
-    // for (auto & leaf_iter = leaf_values_begin; leaf_iter != leaf_values_end; ++leaf_iter) {
-    //     typename TreeT::node_type * node = tree.create_leaf_node(*leaf_iter);
-    //     node_pool.push(node);
-    // }
-    // while (node_pool.size() > 2) {
-    //     std::set<typename TreeT::node_type *> nodes_to_add;
-    //     while (node_pool.size() > 1) {
-    //         if (node_pool.size() > 1) {
-    //             typename TreeT::node_type * node = tree.create_internal_node();
-    //             node->add_child(node_pool.top());
-    //             node_pool.pop();
-    //             node->add_child(node_pool.top());
-    //             node_pool.pop();
-    //             nodes_to_add.insert(node);
-    //             if (node_pool.size() % 2 != 0) {
-    //                 break;
-    //             }
-    //         } else {
-    //             nodes_to_add.insert(node_pool.top());
-    //             node_pool.pop();
-    //         }
-    //     }
-    //     for (auto & nd : nodes_to_add) {
-    //         node_pool.push(nd);
-    //     }
-    // }
-    // tree.head_node()->add_child(node_pool.top());
-    // node_pool.pop();
-    // tree.head_node()->add_child(node_pool.top());
-    // node_pool.pop();
-
-    // unsigned long num_tips_needed = 0;
-    // for (auto leaf_iter = leaf_values_begin; leaf_iter != leaf_values_end; ++leaf_iter) {
-    //     ++num_tips_needed;
-    // }
-    // std::set<typename TreeT::node_type *> current_tips;
-    // current_tips.insert(tree.head_node());
-    // while (current_tips.size() < num_tips_needed) {
-    //     std::set<typename TreeT::node_type *> new_tips;
-    //     auto tip_iter = current_tips.begin();
-    //     while (tip_iter != current_tips.end()) {
-    //         typename TreeT::node_type * new_ch1 = tree.create_node();
-    //         typename TreeT::node_type * new_ch2 = tree.create_node();
-    //         (*tip_iter)->add_child(new_ch1);
-    //         (*tip_iter)->add_child(new_ch2);
-    //         new_tips.insert(new_ch1);
-    //         new_tips.insert(new_ch2);
-    //         current_tips.erase(tip_iter++);
-    //         if (current_tips.size() + new_tips.size() >= num_tips_needed) {
-    //             break;
-    //         }
-    //     }
-    //     current_tips.insert(new_tips.begin(), new_tips.end());
-    // }
-    // auto current_leaf_value_iter = leaf_values_begin;
-    // // for (auto new_leaf_node_iter = current_tips.begin(); new_leaf_node_iter != current_tips.end(); ++new_leaf_node_iter, ++current_leaf_value_iter) {
-    // for (auto new_leaf_node_iter = tree.leaf_begin(); new_leaf_node_iter != tree.leaf_end(); ++new_leaf_node_iter, ++current_leaf_value_iter) {
-    //     if (current_leaf_value_iter == leaf_values_end) {
-    //         throw std::runtime_error("Leaf values exhausted before all tips on trees assigned values");
-    //     }
-    //     *new_leaf_node_iter = *current_leaf_value_iter;
-    // }
+    typedef typename TreeT::node_type node_type;
+    std::vector<node_type *> leaf_nodes;
+    treepattern::detail::create_leaf_nodes(tree, leaf_values_begin, leaf_values_end, leaf_nodes);
+    std::size_t num_leaves = leaf_nodes.size();
+    if (num_leaves == 0) {
+        return;
+    }
+    // spans of leaves [start, stop) still to be joined under ``parent``;
+    // popped in order so that each parent receives its children in order
+    struct Span {
+        node_type *     parent;
+        std::size_t     start;
+        std::size_t     stop;
+    };
+    std::vector<Span> spans;
+    std::size_t mid = num_leaves / 2;
+    if (mid > 0) {
+        spans.push_back(Span{tree.head_node(), mid, num_leaves});
+        spans.push_back(Span{tree.head_node(), 0, mid});
+    } else {
+        spans.push_back(Span{tree.head_node(), 0, num_leaves});
+    }
+    while (!spans.empty()) {
+        Span span = spans.back();
+        spans.pop_back();
+        std::size_t size = span.stop - span.start;
+        if (size == 1) {
+            span.parent->add_child(leaf_nodes[span.start]);
+        } else if (size == 2) {
+            node_type * node = tree.create_internal_node();
+            span.parent->add_child(node);
+            node->add_child(leaf_nodes[span.start]);
+            node->add_child(leaf_nodes[span.start + 1]);
+        } else if (size == 3) {
+            node_type * node2 = tree.create_internal_node();
+            span.parent->add_child(node2);
+            node2->add_child(leaf_nodes[span.start + 2]);
+            node_type * node1 = tree.create_internal_node();
+            node2->add_child(node1);
+            node1->add_child(leaf_nodes[span.start]);
+            node1->add_child(leaf_nodes[span.start + 1]);
+        } else {
+            node_type * node = tree.create_internal_node();
+            span.parent->add_child(node);
+            std::size_t span_mid = span.start + size / 2;
+            spans.push_back(Span{node, span_mid, span.stop});
+            spans.push_back(Span{node, span.start, span_mid});
+        }
+    }
+}
+
+namespace treepattern { namespace detail {
+
+// Wires a uniformly-distributed random bifurcating tree on ``leaf_nodes``
+// by Remy's (1985) algorithm, returning the internal nodes in order of
+// creation (the last of which, if any, is the head node).
+template <typename TreeT, typename RngT>
+void wire_uniform_random_tree(
+        TreeT & tree,
+        std::vector<typename TreeT::node_type *> & leaf_nodes,
+        RngT & rng,
+        std::vector<typename TreeT::node_type *> & internal_nodes) {
+    typedef typename TreeT::node_type node_type;
+    std::size_t num_leaves = leaf_nodes.size();
+    if (num_leaves <= 1) {
+        if (num_leaves == 1) {
+            tree.head_node()->add_child(leaf_nodes[0]);
+        }
+        return;
+    }
+    // nodes 0, ..., num_leaves - 1 are the leaves, in order, and the
+    // others internal nodes, in order of creation; each internal node has
+    // two child slots, and ``parents[i]`` is the slot of node ``i``
+    const std::size_t no_parent = static_cast<std::size_t>(-1);
+    std::size_t num_nodes = 2 * num_leaves - 1;
+    std::vector<std::size_t> parents(num_nodes, no_parent);
+    std::vector<std::size_t> children(2 * num_nodes, no_parent);
+    std::size_t root = 0;
+    // the first leaf alone (0), then each other leaf in turn, on an edge
+    // above one of the 2k - 1 nodes (including the root) of the tree on
+    // the first k leaves, each as likely as the others and on either side
+    for (std::size_t leaf = 1; leaf < num_leaves; ++leaf) {
+        std::size_t num_placed = 2 * leaf - 1;
+        unsigned long draw = rng.uniform_pos_int(2 * num_placed - 1);
+        std::size_t target = static_cast<std::size_t>(draw >> 1);
+        target = target < leaf ? target : target - leaf + num_leaves;
+        std::size_t node = num_leaves + leaf - 1;
+        std::size_t slot = parents[target];
+        parents[node] = slot;
+        if (slot == no_parent) {
+            root = node;
+        } else {
+            children[slot] = node;
+        }
+        std::size_t side = static_cast<std::size_t>(draw & 1);
+        children[2 * node + side] = target;
+        children[2 * node + 1 - side] = leaf;
+        parents[target] = 2 * node + side;
+        parents[leaf] = 2 * node + 1 - side;
+    }
+    internal_nodes.resize(num_leaves - 1);
+    for (std::size_t idx = 0; idx + 1 < num_leaves; ++idx) {
+        internal_nodes[idx] = num_leaves + idx == root ? tree.head_node() : tree.create_internal_node();
+    }
+    auto get_node = [&] (std::size_t idx) -> node_type * {
+        return idx < num_leaves ? leaf_nodes[idx] : internal_nodes[idx - num_leaves];
+    };
+    for (std::size_t node = num_leaves; node < num_nodes; ++node) {
+        get_node(node)->add_child(get_node(children[2 * node]));
+        get_node(node)->add_child(get_node(children[2 * node + 1]));
+    }
+}
+
+} } // namespace treepattern::detail
+
+/**
+ * Generates a random bifurcating tree on the given leaves, uniformly
+ * distributed over all (rooted, leaf-labelled) topologies, with Remy's
+ * (1985) algorithm: each leaf in turn is attached to a point on an edge
+ * (or above the root) of the tree of the leaves before it, chosen
+ * uniformly at random. This takes time linear in the number of leaves,
+ * with a single random integer drawn for each, and storage for all nodes
+ * is reserved up front (see Tree::reserve_nodes()).
+ *
+ * As the tree depends only on the draws from ``rng``, batches of trees can
+ * be generated in parallel reproducibly, with a generator for each tree
+ * (e.g., from platypus::numeric::ReplicateRandomNumberGenerator).
+ *
+ * @tparam TreeT
+ * @tparam LeafIterT
+ *   A forward iterator.
+ * @tparam RngT
+ *   A platypus::numeric::RandomNumberGeneratorTemplate specialization.
+ * @param tree
+ * @param leaf_values_begin
+ *   Iterator to beginning of sequence of leaf values that will
+ *   become attached to leaf nodes.
+ * @param leaf_values_end
+ *   Iterator to one past the end of sequence of leaf values that will
+ *   become attached to leaf nodes.
+ * @param rng
+ */
+template <typename TreeT, typename LeafIterT, typename RngT>
+void build_uniform_random_tree(
+        TreeT & tree,
+        LeafIterT leaf_values_begin,
+        LeafIterT leaf_values_end,
+        RngT & rng) {
+    std::vector<typename TreeT::node_type *> leaf_nodes;
+    std::vector<typename TreeT::node_type *> internal_nodes;
+    treepattern::detail::create_leaf_nodes(tree, leaf_values_begin, leaf_values_end, leaf_nodes);
+    treepattern::detail::wire_uniform_random_tree(tree, leaf_nodes, rng, internal_nodes);
+}
+
+/**
+ * As above, and sets the length of the edge of every node other than the
+ * head node, by ``edge_length_setter(node_value, length)``, to an
+ * exponential random variate with mean ``mean_edge_length``, drawn after
+ * the topology.
+ */
+template <typename TreeT, typename LeafIterT, typename RngT, typename EdgeLengthSetterT>
+void build_uniform_random_tree(
+        TreeT & tree,
+        LeafIterT leaf_values_begin,
+        LeafIterT leaf_values_end,
+        RngT & rng,
+        EdgeLengthSetterT edge_length_setter,
+        double mean_edge_length=1.0) {
+    std::vector<typename TreeT::node_type *> leaf_nodes;
+    std::vector<typename TreeT::node_type *> internal_nodes;
+    treepattern::detail::create_leaf_nodes(tree, leaf_values_begin, leaf_values_end, leaf_nodes);
+    treepattern::detail::wire_uniform_random_tree(tree, leaf_nodes, rng, internal_nodes);
+    double rate = mean_edge_length > 0.0 ? 1.0 / mean_edge_length : 0.0;
+    for (auto nd : leaf_nodes) {
+        if (nd->parent_node() != nullptr) {
+            edge_length_setter(nd->value(), rng.exponential(rate));
+        }
+    }
+    for (auto nd : internal_nodes) {
+        if (nd != tree.head_node()) {
+            edge_length_setter(nd->value(), rng.exponential(rate));
+        }
+    }
+}
+
+/**
+ * Builds the tree in which node ``i`` has the value ``values[i]`` and is a
+ * child of node ``parents[i]``; the root, whose value is assigned to the
+ * head node of ``tree``, is the (single) node with a parent index of -1 (or,
+ * for unsigned index types, the maximum value of the type). Children are
+ * added to their parents in order of index. ``tree`` is expected to be
+ * empty.
+ *
+ * Storage for all nodes is reserved up front (see Tree::reserve_nodes()),
+ * and the tree is wired in a single pass, so that there is no limit on
+ * its depth.
+ *
+ * @throws std::invalid_argument
+ *   If ``parents`` and ``values`` differ in length, a parent index is out
+ *   of range, or the indexes do not describe a single tree (no root, more
+ *   than one root, or a cycle). ``tree`` is then left in an unspecified
+ *   (but valid) state.
+ */
+template <typename TreeT, typename ParentIndexT, typename NodeValueT>
+void build_from_parent_array(
+        TreeT & tree,
+        const std::vector<ParentIndexT> & parents,
+        const std::vector<NodeValueT> & values) {
+    typedef typename TreeT::node_type node_type;
+    if (parents.size() != values.size()) {
+        throw std::invalid_argument("build_from_parent_array(): number of parent indexes does not match number of values");
+    }
+    std::size_t num_nodes = parents.size();
+    if (num_nodes == 0) {
+        return;
+    }
+    const ParentIndexT root_marker = static_cast<ParentIndexT>(-1);
+    std::size_t root_idx = num_nodes;
+    for (std::size_t idx = 0; idx < num_nodes; ++idx) {
+        if (parents[idx] == root_marker) {
+            if (root_idx != num_nodes) {
+                throw std::invalid_argument("build_from_parent_array(): more than one root");
+            }
+            root_idx = idx;
+        } else if (static_cast<std::size_t>(parents[idx]) >= num_nodes) {
+            throw std::invalid_argument("build_from_parent_array(): parent index out of range");
+        }
+    }
+    if (root_idx == num_nodes) {
+        throw std::invalid_argument("build_from_parent_array(): no root");
+    }
+    tree.reserve_nodes(num_nodes - 1);
+    std::vector<node_type *> nodes(num_nodes);
+    for (std::size_t idx = 0; idx < num_nodes; ++idx) {
+        if (idx == root_idx) {
+            nodes[idx] = tree.head_node();
+            nodes[idx]->set_value(values[idx]);
+        } else {
+            nodes[idx] = tree.create_node(values[idx]);
+        }
+    }
+    for (std::size_t idx = 0; idx < num_nodes; ++idx) {
+        if (idx != root_idx) {
+            nodes[static_cast<std::size_t>(parents[idx])]->add_child(nodes[idx]);
+        }
+    }
+    // every node must be reachable from the root (i.e., not on a cycle)
+    std::size_t num_reachable = 0;
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        ++num_reachable;
+    }
+    if (num_reachable != num_nodes) {
+        throw std::invalid_argument("build_from_parent_array(): parent indexes include a cycle");
+    }
 }
 
 
@@ -0,0 +1,215 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Pooled storage for collections of trees.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_MODEL_TREEPOOL_HPP
+#define PLATYPUS_MODEL_TREEPOOL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "../utility/memoryusage.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// TreePool
+
+/**
+ * A collection of trees constructed in place in contiguous slabs of
+ * storage that the pool owns, so that a large number of trees is
+ * allocated in a few blocks rather than one at a time, and all of them
+ * (along with their nodes, including any node arenas, e.g.
+ * platypus::TreeNodeArena, that they own) are destroyed together when the
+ * pool is cleared or destroyed:
+ *
+ *      platypus::TreePool<TreeType> trees = reader.get_tree_pool(src);
+ *      for (auto tree : trees) {
+ *          ... tree->... ...
+ *      }
+ *
+ * Trees stay at the same address for the lifetime of the pool (including
+ * when the pool itself is moved), so they can be held by pointer or
+ * reference. Iteration is over pointers to the trees, in the order they
+ * were created.
+ *
+ * @tparam TreeT
+ *   Type of tree (platypus::Tree or derived).
+ */
+template <class TreeT>
+class TreePool {
+
+    public:
+        typedef TreeT                                           tree_type;
+        typedef typename std::vector<TreeT *>::const_iterator   iterator;
+        typedef iterator                                        const_iterator;
+
+    public:
+
+        // Storage is allocated for (at least) ``slab_size`` trees at a time.
+        TreePool(std::size_t slab_size=64)
+            : slab_size_(slab_size > 0 ? slab_size : 1) { }
+
+        TreePool(const TreePool &) = delete;
+        TreePool & operator=(const TreePool &) = delete;
+
+        TreePool(TreePool && other) noexcept
+            : slab_size_(other.slab_size_)
+            , slabs_(std::move(other.slabs_))
+            , trees_(std::move(other.trees_)) {
+            other.slabs_.clear();
+            other.trees_.clear();
+        }
+
+        TreePool & operator=(TreePool && other) noexcept {
+            if (this != &other) {
+                this->clear();
+                this->slab_size_ = other.slab_size_;
+                this->slabs_ = std::move(other.slabs_);
+                this->trees_ = std::move(other.trees_);
+                other.slabs_.clear();
+                other.trees_.clear();
+            }
+            return *this;
+        }
+
+        ~TreePool() {
+            this->clear();
+        }
+
+        /**
+         * Constructs a new tree in the pool (with ``args``), and returns a
+         * reference to it; e.g., as the tree factory of a reader:
+         *
+         *      reader.read(src, [&pool]() -> TreeType & { return pool.create(); });
+         */
+        template <class... Types>
+        TreeT & create(Types &&... args) {
+            // so that recording the tree cannot fail once it is constructed
+            this->trees_.reserve(this->trees_.size() + 1);
+            TreeT * slot = this->next_slot();
+            ::new (static_cast<void *>(slot)) TreeT(std::forward<Types>(args)...);
+            ++this->slabs_.back().num_used;
+            this->trees_.push_back(slot);
+            return *slot;
+        }
+
+        /**
+         * Ensures that storage for ``num_trees`` trees in all is allocated,
+         * by adding (at most) one slab.
+         */
+        void reserve(std::size_t num_trees) {
+            if (num_trees <= this->trees_.size()) {
+                return;
+            }
+            this->trees_.reserve(num_trees);
+            std::size_t num_needed = num_trees - this->trees_.size();
+            std::size_t num_spare = this->slabs_.empty() ? 0 : this->slabs_.back().capacity - this->slabs_.back().num_used;
+            if (num_needed > num_spare) {
+                this->add_slab(std::max(num_needed, this->slab_size_));
+            }
+        }
+
+        // Destroys all trees, and releases all storage.
+        void clear() {
+            for (auto tree = this->trees_.rbegin(); tree != this->trees_.rend(); ++tree) {
+                (*tree)->~TreeT();
+            }
+            this->trees_.clear();
+            std::allocator<TreeT> allocator;
+            for (auto & slab : this->slabs_) {
+                allocator.deallocate(slab.storage, slab.capacity);
+            }
+            this->slabs_.clear();
+        }
+
+        inline std::size_t size() const {
+            return this->trees_.size();
+        }
+        inline bool empty() const {
+            return this->trees_.empty();
+        }
+        /**
+         * Accounts for the memory held by the pool: the sum of
+         * Tree::memory_usage() over its trees, with the storage of the pool
+         * itself (its slabs, including unused slots, and the index of trees)
+         * as bookkeeping.
+         */
+        MemoryUsage memory_usage(const std::function<std::size_t (const typename TreeT::value_type &)> & value_heap_bytes={}) const {
+            MemoryUsage usage;
+            for (auto tree : this->trees_) {
+                usage += tree->memory_usage(value_heap_bytes);
+            }
+            for (auto & slab : this->slabs_) {
+                usage.bookkeeping_bytes += slab.capacity * sizeof(TreeT);
+            }
+            usage.bookkeeping_bytes += memory::heap_bytes(this->slabs_) + memory::heap_bytes(this->trees_);
+            return usage;
+        }
+
+        inline TreeT & operator[](std::size_t idx) const {
+            return *this->trees_[idx];
+        }
+        inline iterator begin() const {
+            return this->trees_.begin();
+        }
+        inline iterator end() const {
+            return this->trees_.end();
+        }
+
+    private:
+
+        struct Slab {
+            TreeT *         storage;
+            std::size_t     capacity;
+            std::size_t     num_used;
+        };
+
+        inline TreeT * next_slot() {
+            if (this->slabs_.empty() || this->slabs_.back().num_used == this->slabs_.back().capacity) {
+                this->add_slab(this->slab_size_);
+            }
+            return this->slabs_.back().storage + this->slabs_.back().num_used;
+        }
+
+        // Any space left in the current last slab is abandoned.
+        void add_slab(std::size_t capacity) {
+            this->slabs_.reserve(this->slabs_.size() + 1);
+            Slab slab;
+            slab.storage = std::allocator<TreeT>().allocate(capacity);
+            slab.capacity = capacity;
+            slab.num_used = 0;
+            this->slabs_.push_back(slab);
+        }
+
+    private:
+        std::size_t                 slab_size_;
+        std::vector<Slab>           slabs_;
+        std::vector<TreeT *>        trees_;
+
+}; // TreePool
+
+} // namespace platypus
+
+#endif
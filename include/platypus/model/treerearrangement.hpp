@@ -0,0 +1,860 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Enumeration of NNI and SPR rearrangements applied in place.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_MODEL_TREEREARRANGEMENT_HPP
+#define PLATYPUS_MODEL_TREEREARRANGEMENT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "split.hpp"
+#include "taxonnamespace.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// TreeRearrangements
+
+/**
+ * Enumerates the nearest-neighbor interchange (NNI) and subtree prune and
+ * regraft (SPR) neighbors of a tree, each as a small Move that is applied
+ * to (and undone on) the tree in place, by relinking its existing nodes, so
+ * that a search can visit every neighbor without copying the tree, or
+ * creating or destroying any node:
+ *
+ *      platypus::TreeRearrangements<TreeType> rearrangements(tree, taxa);
+ *      std::vector<platypus::TreeRearrangements<TreeType>::Move> moves;
+ *      rearrangements.spr_moves(moves);
+ *      for (auto & move : moves) {
+ *          rearrangements.get_split_changes(move, lost, gained);
+ *          rearrangements.apply(move);
+ *          auto score = parsimony.rescore(tree, rearrangements.modified_nodes());
+ *          rearrangements.undo();
+ *          parsimony.rescore(tree, rearrangements.modified_nodes());
+ *      }
+ *
+ * An NNI move swaps a child ``subtree`` of an internal node with
+ * ``target``, a sibling of that node (or, across the edge joining the two
+ * children of a bifurcating root of an unrooted tree, a child of the
+ * other child), each keeping its place among its new siblings. An SPR
+ * move prunes ``subtree``, whose parent must have exactly two children,
+ * removing the parent from the path between its other child and its
+ * grandparent, and reinserts the parent on the edge subtending ``target``,
+ * with ``target`` and ``subtree`` (in that order) as its children, as
+ * Tree::prune_subtree() and Tree::regraft() would. If the parent is the
+ * head node, a child of the head node is reinserted instead (see
+ * reinserted_node()). Moves that would give back the same tree are not
+ * generated.
+ *
+ * For an unrooted tree (given by ``is_rooted`` on construction), moves
+ * that only differ in the placement of the root are not generated, so that
+ * a binary tree on ``n`` taxa has exactly 2(``n`` - 3) NNI neighbors, and
+ * SPR moves onto the edge of the head node are not generated. Instead, an
+ * SPR move may also prune the rest of the tree from the edge of a subtree
+ * with two children, and regraft it within the subtree (given by a
+ * ``target`` within ``subtree``), so that every SPR neighbor of a binary
+ * unrooted tree, of which there are 2(``n`` - 3)(2``n`` - 7), is given by
+ * some move. Different moves may give the same neighbor.
+ *
+ * Applying a move records the original children (and any changed edge
+ * lengths) of the nodes it relinks, so that undo() restores the tree
+ * exactly, including the order of children. Only one move may be applied
+ * at a time, and the tree must not otherwise change until it is undone (or
+ * kept, with commit()). Tree::mark_structure_modified() is called on both
+ * apply() and undo().
+ *
+ * Scorers can be updated incrementally after apply() or undo(): the
+ * internal nodes whose children changed are given by modified_nodes() (as
+ * needed by IncrementalFitchParsimony::rescore()), and the nodes whose
+ * parent or edge length changed by relinked_nodes() (as needed by
+ * TreeLikelihood::update_log_likelihood()). get_split_changes() gives the
+ * exact splits that a move gains and loses.
+ *
+ * @tparam TreeT
+ *   Type of tree (platypus::Tree or derived).
+ * @tparam EdgeLengthT
+ *   Type in which edge lengths changed by SPR moves are recorded.
+ */
+template <class TreeT, class EdgeLengthT=double>
+class TreeRearrangements {
+
+    public:
+        typedef typename TreeT::node_type       node_type;
+        typedef typename TreeT::value_type      value_type;
+        typedef EdgeLengthT                     edge_length_type;
+        typedef std::function<TaxonNamespace::index_type (const value_type &)> taxon_index_fn_type;
+
+        enum class MoveKind {
+            nni,
+            spr,
+        };
+
+        struct Move {
+            MoveKind        kind;
+            node_type *     subtree;
+            node_type *     target;
+        };
+
+    public:
+
+        /**
+         * Rearrangements of ``tree``, which must outlive this object. Split
+         * changes are only available if taxa are given (below).
+         */
+        TreeRearrangements(TreeT & tree, bool is_rooted=false)
+            : tree_(tree)
+            , is_rooted_(is_rooted)
+            , num_taxa_(0)
+            , is_applied_(false)
+            , num_edits_(0)
+            , is_splits_valid_(false)
+            , splits_version_(0)
+            , num_tree_taxa_(0) {
+            // so that references to edits stay valid while a move is built
+            this->edits_.reserve(4);
+        }
+
+        /**
+         * As above, with leaf nodes associated with taxa (in [0,
+         * ``num_taxa``)) by ``taxon_index_fn``, for get_split_changes().
+         */
+        TreeRearrangements(TreeT & tree,
+                std::size_t num_taxa,
+                const taxon_index_fn_type & taxon_index_fn,
+                bool is_rooted=false)
+            : TreeRearrangements(tree, is_rooted) {
+            this->num_taxa_ = num_taxa;
+            this->taxon_index_fn_ = taxon_index_fn;
+        }
+
+        /**
+         * As above, with leaf nodes associated with taxa of
+         * ``taxon_namespace`` through ``get_taxon_index()`` of the node
+         * value (e.g., platypus::TaxonNodeValue).
+         */
+        TreeRearrangements(TreeT & tree,
+                const TaxonNamespace & taxon_namespace,
+                bool is_rooted=false)
+            : TreeRearrangements(tree,
+                    taxon_namespace.size(),
+                    [] (const value_type & nv) -> TaxonNamespace::index_type { return nv.get_taxon_index(); },
+                    is_rooted) { }
+
+        TreeRearrangements(const TreeRearrangements &) = delete;
+        TreeRearrangements & operator=(const TreeRearrangements &) = delete;
+
+        inline TreeT & tree() const {
+            return this->tree_;
+        }
+
+        inline bool is_rooted() const {
+            return this->is_rooted_;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Enumeration
+
+        /**
+         * Appends the NNI moves of the tree (in its current state) to
+         * ``moves``. For trees with polytomies, every swap of a child of a
+         * node with a sibling of the node is generated, and some may give
+         * the same neighbor.
+         */
+        void nni_moves(std::vector<Move> & moves) const {
+            node_type * head = this->tree_.head_node();
+            if (head == nullptr) {
+                return;
+            }
+            for (auto ndi = this->tree_.preorder_begin(); ndi != this->tree_.preorder_end(); ++ndi) {
+                node_type * nd = ndi.node();
+                if (nd == head || nd->is_leaf()) {
+                    continue;
+                }
+                node_type * parent = nd->parent_node();
+                // for an unrooted tree, the edges of the head node's children
+                // meet at a node of degree greater than two, and the last
+                // sibling plays the part of the parent's edge
+                node_type * fixed_sibling = nullptr;
+                if (!this->is_rooted_ && parent == head) {
+                    fixed_sibling = head->last_child_node() != nd
+                        ? head->last_child_node()
+                        : nd->prev_sibling_node();
+                }
+                for (node_type * ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                    for (node_type * sib = parent->first_child_node(); sib != nullptr; sib = sib->next_sibling_node()) {
+                        if (sib != nd && sib != fixed_sibling) {
+                            moves.push_back(Move{MoveKind::nni, ch, sib});
+                        }
+                    }
+                }
+            }
+            // the single edge across a bifurcating head node of an unrooted tree
+            node_type * first = head->first_child_node();
+            node_type * last = head->last_child_node();
+            if (!this->is_rooted_
+                    && first != nullptr
+                    && first->next_sibling_node() == last
+                    && !first->is_leaf()
+                    && last != nullptr
+                    && !last->is_leaf()) {
+                for (node_type * ch = first->first_child_node(); ch != first->last_child_node(); ch = ch->next_sibling_node()) {
+                    for (node_type * other = last->first_child_node(); other != nullptr; other = other->next_sibling_node()) {
+                        moves.push_back(Move{MoveKind::nni, ch, other});
+                    }
+                }
+            }
+        }
+
+        /**
+         * Appends the SPR moves of the tree (in its current state) to
+         * ``moves``: for each subtree that can be pruned (see
+         * reinserted_node()), every target edge that gives a different
+         * tree and, for an unrooted tree and a subtree with two children,
+         * every edge within the subtree onto which the rest of the tree can
+         * be regrafted.
+         */
+        void spr_moves(std::vector<Move> & moves) {
+            node_type * head = this->tree_.head_node();
+            if (head == nullptr) {
+                return;
+            }
+            // postorder, so that the subtree of each node is the range of
+            // nodes ending with it
+            auto & nodes = this->postorder_nodes_;
+            auto & subtree_sizes = this->subtree_sizes_;
+            nodes.clear();
+            subtree_sizes.clear();
+            this->pending_.clear();
+            for (auto ndi = this->tree_.postorder_begin(); ndi != this->tree_.postorder_end(); ++ndi) {
+                std::size_t size = 1;
+                std::size_t num_children = ndi.node()->num_child_nodes();
+                for (std::size_t i = this->pending_.size() - num_children; i < this->pending_.size(); ++i) {
+                    size += subtree_sizes[this->pending_[i]];
+                }
+                this->pending_.resize(this->pending_.size() - num_children);
+                this->pending_.push_back(nodes.size());
+                nodes.push_back(ndi.node());
+                subtree_sizes.push_back(size);
+            }
+            std::size_t head_degree = head->num_child_nodes();
+            for (std::size_t subtree_idx = 0; subtree_idx + 1 < nodes.size(); ++subtree_idx) {
+                node_type * subtree = nodes[subtree_idx];
+                node_type * parent = subtree->parent_node();
+                std::size_t subtree_begin = subtree_idx + 1 - subtree_sizes[subtree_idx];
+                node_type * reinserted = this->reinserted_node(subtree);
+                if (reinserted != nullptr) {
+                    // edges that are (without a root, if the edges of the two
+                    // children of the head node are one) where the subtree
+                    // already is
+                    node_type * skipped = nullptr;
+                    node_type * other_skipped = nullptr;
+                    bool skip_children = false;
+                    if (parent != head) {
+                        skipped = other_child(parent, subtree);
+                        if (!this->is_rooted_ && head_degree == 2) {
+                            other_skipped = parent->parent_node() == head
+                                ? other_child(head, parent)
+                                : head->last_child_node();
+                        }
+                    } else {
+                        skipped = remaining_child(head, subtree, reinserted);
+                        skip_children = !this->is_rooted_ && head_degree == 2 && reinserted->num_child_nodes() == 2;
+                    }
+                    bool allow_head = this->is_rooted_ && parent != head;
+                    for (std::size_t idx = 0; idx < nodes.size(); ++idx) {
+                        node_type * target = nodes[idx];
+                        if ((idx >= subtree_begin && idx <= subtree_idx)
+                                || target == reinserted
+                                || target == skipped
+                                || target == other_skipped
+                                || (target == head && !allow_head)
+                                || (skip_children && target->parent_node() == reinserted)) {
+                            continue;
+                        }
+                        moves.push_back(Move{MoveKind::spr, subtree, target});
+                    }
+                }
+                // the rest of an unrooted tree, pruned from the edge of the
+                // subtree (unless that is the pruning of the other child of
+                // a bifurcating head node, above), onto an edge within it
+                // other than those of its two children
+                if (!this->is_rooted_
+                        && subtree->num_child_nodes() == 2
+                        && !(parent == head && head_degree == 2)) {
+                    for (std::size_t idx = subtree_begin; idx < subtree_idx; ++idx) {
+                        if (nodes[idx]->parent_node() != subtree) {
+                            moves.push_back(Move{MoveKind::spr, subtree, nodes[idx]});
+                        }
+                    }
+                }
+            }
+        }
+
+        /**
+         * The node that an SPR move pruning ``subtree`` (that is, not one
+         * with a target within the subtree) reinserts on the target edge,
+         * or null if it cannot be pruned: the parent of the subtree, if that
+         * has exactly two children and is not the head node; if the parent
+         * is the head node, and has two children, the other child, unless
+         * that is a leaf; if the parent is the head node of an unrooted tree
+         * and has three children, the first of the others that is not a
+         * leaf. In the last two cases, the head node takes over the
+         * children of the reinserted node.
+         */
+        node_type * reinserted_node(const node_type * subtree) const {
+            node_type * head = this->tree_.head_node();
+            node_type * parent = subtree->parent_node();
+            if (parent != head) {
+                return other_child(parent, subtree) != nullptr ? parent : nullptr;
+            }
+            std::size_t head_degree = head->num_child_nodes();
+            if (head_degree == 2) {
+                node_type * sibling = other_child(head, subtree);
+                return sibling->is_leaf() ? nullptr : sibling;
+            }
+            if (head_degree == 3 && !this->is_rooted_) {
+                for (node_type * ch = head->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                    if (ch != subtree && !ch->is_leaf()) {
+                        return ch;
+                    }
+                }
+            }
+            return nullptr;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Application
+
+        // Applies ``move`` (generated for the tree in its current state).
+        void apply(const Move & move) {
+            this->apply(move,
+                    [] (const value_type &) { return 0; },
+                    [] (value_type &, int) { },
+                    0.5);
+        }
+
+        /**
+         * As above, with edge lengths as by Tree::prune_subtree() and
+         * Tree::regraft(). For an SPR move, the edges merged when the
+         * subtree is pruned are joined (the other child of the parent
+         * takes over the length of the parent's edge), and
+         * ``split_proportion`` of the length of the edge subtending the
+         * target is left to the target, the rest going to the reinserted
+         * node. If the parent is the head node, the length of the edge of
+         * the reinserted child of the head node goes to the subtree (with
+         * two children) or to the remaining child (with three). If the rest
+         * of the tree is regrafted within the subtree, the lengths of the
+         * edges along the reversed path move with them. The total length of
+         * the tree is unchanged. NNI moves do not change edge lengths.
+         */
+        template <typename EdgeLengthGetterT, typename EdgeLengthSetterT>
+        void apply(const Move & move,
+                EdgeLengthGetterT edge_length_getter,
+                EdgeLengthSetterT edge_length_setter,
+                double split_proportion=0.5) {
+            if (this->is_applied_) {
+                throw std::logic_error("platypus::TreeRearrangements: a move has already been applied");
+            }
+            this->num_edits_ = 0;
+            this->original_lengths_.clear();
+            this->relinked_nodes_.clear();
+            this->applied_version_ = this->tree_.structure_version();
+            node_type * head = this->tree_.head_node();
+            node_type * subtree = move.subtree;
+            node_type * target = move.target;
+            if (move.kind == MoveKind::nni) {
+                auto & from = this->edit(subtree->parent_node());
+                auto & to = this->edit(target->parent_node());
+                std::replace(from.children.begin(), from.children.end(), subtree, target);
+                std::replace(to.children.begin(), to.children.end(), target, subtree);
+            } else if (is_descendant(target, subtree)) {
+                this->apply_complement(subtree, target, edge_length_getter, edge_length_setter, split_proportion);
+            } else if (subtree->parent_node() != head) {
+                node_type * parent = subtree->parent_node();
+                node_type * sibling = other_child(parent, subtree);
+                node_type * grandparent = parent->parent_node();
+                if (target == head) {
+                    auto & grandparent_edit = this->edit(grandparent);
+                    auto & head_edit = this->edit(head);
+                    auto & parent_edit = this->edit(parent);
+                    std::replace(grandparent_edit.children.begin(), grandparent_edit.children.end(), parent, sibling);
+                    parent_edit.children = head_edit.children;
+                    head_edit.children.assign({parent, subtree});
+                } else {
+                    auto & grandparent_edit = this->edit(grandparent);
+                    auto & target_parent_edit = this->edit(target->parent_node());
+                    auto & parent_edit = this->edit(parent);
+                    std::replace(grandparent_edit.children.begin(), grandparent_edit.children.end(), parent, sibling);
+                    std::replace(target_parent_edit.children.begin(), target_parent_edit.children.end(), target, parent);
+                    parent_edit.children.assign({target, subtree});
+                }
+                this->set_length(sibling, edge_length_getter(sibling->value()) + edge_length_getter(parent->value()),
+                        edge_length_getter, edge_length_setter);
+                this->split_length(target, parent, split_proportion, edge_length_getter, edge_length_setter);
+            } else {
+                node_type * reinserted = this->reinserted_node(subtree);
+                node_type * remaining = remaining_child(head, subtree, reinserted);
+                node_type * target_parent = target->parent_node();
+                auto & head_edit = this->edit(head);
+                auto & reinserted_edit = this->edit(reinserted);
+                head_edit.children.clear();
+                for (node_type * ch : head_edit.original_children) {
+                    if (ch == reinserted) {
+                        head_edit.children.insert(head_edit.children.end(),
+                                reinserted_edit.original_children.begin(),
+                                reinserted_edit.original_children.end());
+                    } else if (ch != subtree) {
+                        head_edit.children.push_back(ch);
+                    }
+                }
+                if (target_parent == reinserted) {
+                    std::replace(head_edit.children.begin(), head_edit.children.end(), target, reinserted);
+                } else {
+                    auto & target_parent_edit = this->edit(target_parent);
+                    std::replace(target_parent_edit.children.begin(), target_parent_edit.children.end(), target, reinserted);
+                }
+                reinserted_edit.children.assign({target, subtree});
+                node_type * joined = remaining != nullptr ? remaining : subtree;
+                this->set_length(joined, edge_length_getter(joined->value()) + edge_length_getter(reinserted->value()),
+                        edge_length_getter, edge_length_setter);
+                this->split_length(target, reinserted, split_proportion, edge_length_getter, edge_length_setter);
+            }
+            for (std::size_t idx = 0; idx < this->num_edits_; ++idx) {
+                for (node_type * ch : this->edits_[idx].children) {
+                    if (ch->parent_node() != this->edits_[idx].node) {
+                        this->relinked_nodes_.push_back(ch);
+                    }
+                }
+            }
+            for (auto & original_length : this->original_lengths_) {
+                if (std::find(this->relinked_nodes_.begin(), this->relinked_nodes_.end(), original_length.first) == this->relinked_nodes_.end()) {
+                    this->relinked_nodes_.push_back(original_length.first);
+                }
+            }
+            this->relink(false);
+            this->is_applied_ = true;
+        }
+
+        /**
+         * Restores the tree to its state before the last move was applied.
+         * Edge lengths changed by the move are not restored (see below).
+         */
+        void undo() {
+            this->undo([] (value_type &, int) { });
+        }
+
+        // As above, restoring edge lengths with ``edge_length_setter``.
+        template <typename EdgeLengthSetterT>
+        void undo(EdgeLengthSetterT edge_length_setter) {
+            if (!this->is_applied_) {
+                throw std::logic_error("platypus::TreeRearrangements: no move to undo");
+            }
+            this->relink(true);
+            for (auto & original_length : this->original_lengths_) {
+                edge_length_setter(original_length.first->value(), original_length.second);
+            }
+            // the structure is that from which the splits were recorded
+            if (this->is_splits_valid_ && this->splits_version_ == this->applied_version_) {
+                this->splits_version_ = this->tree_.structure_version();
+            }
+            this->is_applied_ = false;
+        }
+
+        // Keeps the applied move, so that another can be applied.
+        void commit() {
+            if (!this->is_applied_) {
+                throw std::logic_error("platypus::TreeRearrangements: no move to commit");
+            }
+            this->is_applied_ = false;
+        }
+
+        inline bool is_applied() const {
+            return this->is_applied_;
+        }
+
+        /**
+         * The internal nodes whose children were changed by the last move
+         * applied (or undone).
+         */
+        std::vector<node_type *> modified_nodes() const {
+            std::vector<node_type *> nodes;
+            for (std::size_t idx = 0; idx < this->num_edits_; ++idx) {
+                nodes.push_back(this->edits_[idx].node);
+            }
+            return nodes;
+        }
+
+        /**
+         * The nodes whose parent or edge length was changed by the last
+         * move applied (or undone). Each node of modified_nodes() is the
+         * parent of one of these.
+         */
+        inline const std::vector<node_type *> & relinked_nodes() const {
+            return this->relinked_nodes_;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Splits
+
+        /**
+         * Fills ``lost`` and ``gained`` (in order) with the splits of the
+         * tree (in its current state) that ``move`` would remove and add,
+         * as given by SplitSet: normalized, for an unrooted tree, and
+         * without the splits of leaves, of the head node, or (for an
+         * unrooted tree) of nodes that include all taxa of the tree but one.
+         * Only the nodes on the paths between the nodes relinked by the
+         * move are visited, after an initial pass over the tree that is
+         * repeated whenever its structure changes (other than by undo()).
+         */
+        void get_split_changes(const Move & move, std::vector<Split> & lost, std::vector<Split> & gained) {
+            lost.clear();
+            gained.clear();
+            this->update_splits();
+            this->split_deltas_.clear();
+            if (move.kind == MoveKind::nni) {
+                Split change(this->cluster(move.subtree));
+                change ^= this->cluster(move.target);
+                this->add_path_changes(move.subtree->parent_node(), move.target->parent_node(), change, change, nullptr);
+            } else if (is_descendant(move.target, move.subtree)) {
+                // the path between the subtree and the target is reversed,
+                // so that each node on it is left with the subtree less the
+                // node below it on the path
+                const Split & subtree_cluster = this->cluster(move.subtree);
+                const node_type * below = move.target;
+                for (const node_type * nd = move.target->parent_node(); nd != move.subtree; nd = nd->parent_node()) {
+                    Split changed(subtree_cluster);
+                    changed ^= this->cluster(below);
+                    this->add_cluster_change(this->cluster(nd), -1);
+                    this->add_cluster_change(changed, 1);
+                    below = nd;
+                }
+            } else {
+                node_type * head = this->tree_.head_node();
+                node_type * parent = move.subtree->parent_node();
+                node_type * inserted = this->reinserted_node(move.subtree);
+                // the target side of the inserted node, and the subtree
+                const Split & subtree_cluster = this->cluster(move.subtree);
+                Split new_cluster(this->cluster(move.target));
+                if (move.target == head) {
+                    new_cluster ^= subtree_cluster;
+                } else {
+                    new_cluster |= subtree_cluster;
+                }
+                this->add_cluster_change(this->cluster(inserted), -1);
+                this->add_cluster_change(new_cluster, 1);
+                this->add_path_changes(parent != head ? parent->parent_node() : head,
+                        move.target == head ? head : move.target->parent_node(),
+                        subtree_cluster,
+                        subtree_cluster,
+                        inserted);
+            }
+            for (auto & delta : this->split_deltas_) {
+                if (delta.second == 0) {
+                    continue;
+                }
+                auto found = this->split_counts_.find(delta.first);
+                long count = found == this->split_counts_.end() ? 0 : static_cast<long>(found->second);
+                if (count > 0 && count + delta.second <= 0) {
+                    lost.push_back(delta.first);
+                } else if (count == 0 && delta.second > 0) {
+                    gained.push_back(delta.first);
+                }
+            }
+            std::sort(lost.begin(), lost.end());
+            std::sort(gained.begin(), gained.end());
+        }
+
+    private:
+        struct Edit {
+            node_type *                 node;
+            std::vector<node_type *>    original_children;
+            std::vector<node_type *>    children;
+        };
+
+        static bool is_descendant(const node_type * nd, const node_type * ancestor) {
+            for (nd = nd->parent_node(); nd != nullptr; nd = nd->parent_node()) {
+                if (nd == ancestor) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // The child of ``head``, if it has three children, other than ``a`` and ``b``.
+        static node_type * remaining_child(const node_type * head, const node_type * a, const node_type * b) {
+            node_type * remaining = nullptr;
+            std::size_t num_children = 0;
+            for (node_type * ch = head->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                ++num_children;
+                if (ch != a && ch != b) {
+                    remaining = ch;
+                }
+            }
+            return num_children == 3 ? remaining : nullptr;
+        }
+
+        // The other child of ``parent``, if it has exactly two children.
+        static node_type * other_child(const node_type * parent, const node_type * ch) {
+            node_type * first = parent->first_child_node();
+            if (first == nullptr || first->next_sibling_node() == nullptr || first->next_sibling_node()->next_sibling_node() != nullptr) {
+                return nullptr;
+            }
+            return first == ch ? first->next_sibling_node() : first;
+        }
+
+        // The edit of the children of ``nd``, begun with its current children.
+        Edit & edit(node_type * nd) {
+            for (std::size_t idx = 0; idx < this->num_edits_; ++idx) {
+                if (this->edits_[idx].node == nd) {
+                    return this->edits_[idx];
+                }
+            }
+            if (this->num_edits_ == this->edits_.size()) {
+                this->edits_.emplace_back();
+            }
+            Edit & e = this->edits_[this->num_edits_++];
+            e.node = nd;
+            e.original_children.clear();
+            for (node_type * ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                e.original_children.push_back(ch);
+            }
+            e.children = e.original_children;
+            return e;
+        }
+
+        void relink(bool to_original) {
+            for (std::size_t idx = 0; idx < this->num_edits_; ++idx) {
+                Edit & e = this->edits_[idx];
+                e.node->unlink_children();
+                for (node_type * ch : to_original ? e.original_children : e.children) {
+                    e.node->add_child(ch);
+                }
+            }
+            this->tree_.mark_structure_modified();
+        }
+
+        /**
+         * Prunes the rest of the tree from the edge of ``subtree`` (which has
+         * two children) and regrafts it onto the edge of ``target`` (within
+         * the subtree, but not a child of it): the subtree is rerooted on
+         * that edge, reusing its own node, with ``target`` and the reversed
+         * path from the parent of ``target`` as its children, and the other
+         * child of ``subtree`` joined to the end of the path.
+         */
+        template <typename EdgeLengthGetterT, typename EdgeLengthSetterT>
+        void apply_complement(node_type * subtree,
+                node_type * target,
+                EdgeLengthGetterT edge_length_getter,
+                EdgeLengthSetterT edge_length_setter,
+                double split_proportion) {
+            auto & path = this->path_nodes_;
+            path.clear();
+            for (node_type * nd = target->parent_node(); nd != subtree; nd = nd->parent_node()) {
+                path.push_back(nd);
+            }
+            node_type * other = other_child(subtree, path.back());
+            // edges move down the path, the last joining that of the other
+            // child, computed before any is changed
+            auto & new_lengths = this->new_lengths_;
+            new_lengths.clear();
+            new_lengths.push_back(std::make_pair(other,
+                        static_cast<edge_length_type>(edge_length_getter(other->value()) + edge_length_getter(path.back()->value()))));
+            for (std::size_t idx = 1; idx < path.size(); ++idx) {
+                new_lengths.push_back(std::make_pair(path[idx],
+                            static_cast<edge_length_type>(edge_length_getter(path[idx - 1]->value()))));
+            }
+            // (edits in place: references to edits are not kept while
+            // there may be more than fit the reserved storage)
+            this->edit(subtree);
+            for (node_type * nd : path) {
+                this->edit(nd);
+            }
+            for (std::size_t idx = 0; idx < path.size(); ++idx) {
+                auto & children = this->edits_[idx + 1].children;
+                std::replace(children.begin(), children.end(),
+                        idx == 0 ? target : path[idx - 1],
+                        idx + 1 < path.size() ? path[idx + 1] : other);
+            }
+            this->edits_[0].children.assign({target, path[0]});
+            for (auto & new_length : new_lengths) {
+                this->set_length(new_length.first, new_length.second, edge_length_getter, edge_length_setter);
+            }
+            this->split_length(target, path[0], split_proportion, edge_length_getter, edge_length_setter);
+        }
+
+        template <typename EdgeLengthGetterT, typename EdgeLengthSetterT>
+        void set_length(node_type * nd,
+                edge_length_type length,
+                EdgeLengthGetterT edge_length_getter,
+                EdgeLengthSetterT edge_length_setter) {
+            bool is_recorded = false;
+            for (auto & original_length : this->original_lengths_) {
+                is_recorded = is_recorded || original_length.first == nd;
+            }
+            if (!is_recorded) {
+                this->original_lengths_.push_back(std::make_pair(nd, static_cast<edge_length_type>(edge_length_getter(nd->value()))));
+            }
+            edge_length_setter(nd->value(), length);
+        }
+
+        template <typename EdgeLengthGetterT, typename EdgeLengthSetterT>
+        void split_length(node_type * target,
+                node_type * inserted,
+                double split_proportion,
+                EdgeLengthGetterT edge_length_getter,
+                EdgeLengthSetterT edge_length_setter) {
+            edge_length_type length = edge_length_getter(target->value());
+            if (target == this->tree_.head_node()) {
+                this->set_length(inserted, length * split_proportion, edge_length_getter, edge_length_setter);
+                this->set_length(target, length - length * split_proportion, edge_length_getter, edge_length_setter);
+            } else {
+                this->set_length(target, length * split_proportion, edge_length_getter, edge_length_setter);
+                this->set_length(inserted, length - length * split_proportion, edge_length_getter, edge_length_setter);
+            }
+        }
+
+        void update_splits() {
+            if (!this->taxon_index_fn_) {
+                throw std::logic_error("platypus::TreeRearrangements: taxa are needed for split changes");
+            }
+            if (this->is_splits_valid_ && this->splits_version_ == this->tree_.structure_version()) {
+                return;
+            }
+            this->splits_.assign(this->tree_, this->num_taxa_, this->taxon_index_fn_, false);
+            this->node_indexes_.clear();
+            this->depths_.assign(this->splits_.size(), 0);
+            this->clusters_.clear();
+            this->split_counts_.clear();
+            std::size_t idx = 0;
+            for (auto ndi = this->tree_.postorder_begin(); ndi != this->tree_.postorder_end(); ++ndi, ++idx) {
+                this->node_indexes_[ndi.node()] = idx;
+                this->clusters_.push_back(this->splits_.get_split(idx));
+            }
+            for (auto ndi = this->tree_.preorder_begin(); ndi != this->tree_.preorder_end(); ++ndi) {
+                const node_type * parent = ndi.node()->parent_node();
+                if (parent != nullptr) {
+                    this->depths_[this->node_indexes_[ndi.node()]] = this->depths_[this->node_indexes_[parent]] + 1;
+                }
+            }
+            this->num_tree_taxa_ = this->clusters_.empty() ? 0 : this->clusters_.back().count();
+            for (auto & cluster : this->clusters_) {
+                if (this->is_edge_cluster(cluster)) {
+                    ++this->split_counts_[this->get_key(cluster)];
+                }
+            }
+            this->is_splits_valid_ = true;
+            this->splits_version_ = this->tree_.structure_version();
+        }
+
+        inline std::size_t get_index(const node_type * nd) const {
+            return this->node_indexes_.find(nd)->second;
+        }
+
+        inline const Split & cluster(const node_type * nd) const {
+            return this->clusters_[this->get_index(nd)];
+        }
+
+        inline bool is_edge_cluster(const Split & cluster) const {
+            std::size_t n = cluster.count();
+            return this->is_rooted_ ? n >= 2 && n < this->num_tree_taxa_ : n >= 2 && n + 2 <= this->num_tree_taxa_;
+        }
+
+        inline Split get_key(const Split & cluster) const {
+            Split key(cluster);
+            if (!this->is_rooted_) {
+                key.normalize();
+            }
+            return key;
+        }
+
+        void add_cluster_change(const Split & cluster, long change) {
+            if (this->is_edge_cluster(cluster)) {
+                this->split_deltas_[this->get_key(cluster)] += change;
+            }
+        }
+
+        // Changes the clusters of the nodes from ``a`` and ``b`` up to (but
+        // not including) their lowest common ancestor, other than ``skipped``,
+        // by ``a_change`` and ``b_change``.
+        void add_path_changes(const node_type * a,
+                const node_type * b,
+                const Split & a_change,
+                const Split & b_change,
+                const node_type * skipped) {
+            std::size_t a_depth = this->depths_[this->get_index(a)];
+            std::size_t b_depth = this->depths_[this->get_index(b)];
+            while (a != b) {
+                bool is_a = a_depth >= b_depth;
+                const node_type * nd = is_a ? a : b;
+                if (nd != skipped) {
+                    Split changed(this->cluster(nd));
+                    changed ^= is_a ? a_change : b_change;
+                    this->add_cluster_change(this->cluster(nd), -1);
+                    this->add_cluster_change(changed, 1);
+                }
+                if (is_a) {
+                    a = a->parent_node();
+                    --a_depth;
+                } else {
+                    b = b->parent_node();
+                    --b_depth;
+                }
+            }
+        }
+
+    private:
+        TreeT &                                         tree_;
+        bool                                            is_rooted_;
+        std::size_t                                     num_taxa_;
+        taxon_index_fn_type                             taxon_index_fn_;
+        // the applied move
+        bool                                            is_applied_;
+        unsigned long                                   applied_version_;
+        std::vector<Edit>                               edits_;
+        std::size_t                                     num_edits_;
+        std::vector<std::pair<node_type *, edge_length_type>> original_lengths_;
+        std::vector<node_type *>                        relinked_nodes_;
+        std::vector<node_type *>                        path_nodes_;
+        std::vector<std::pair<node_type *, edge_length_type>> new_lengths_;
+        // enumeration
+        std::vector<node_type *>                        postorder_nodes_;
+        std::vector<std::size_t>                        subtree_sizes_;
+        std::vector<std::size_t>                        pending_;
+        // splits (clusters, in postorder) of the tree
+        bool                                            is_splits_valid_;
+        unsigned long                                   splits_version_;
+        SplitSet                                        splits_;
+        std::unordered_map<const node_type *, std::size_t> node_indexes_;
+        std::vector<std::size_t>                        depths_;
+        std::vector<Split>                              clusters_;
+        std::size_t                                     num_tree_taxa_;
+        std::unordered_map<Split, unsigned long>        split_counts_;
+        std::unordered_map<Split, long>                 split_deltas_;
+
+}; // TreeRearrangements
+
+} // namespace platypus
+
+#endif
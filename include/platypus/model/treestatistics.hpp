@@ -0,0 +1,320 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Tree shape, balance and branching-time statistics.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_MODEL_TREESTATISTICS_HPP
+#define PLATYPUS_MODEL_TREESTATISTICS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <vector>
+#include "datatable.hpp"
+#include "../utility/parallel.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// TreeShapeStatistics
+
+/**
+ * Shape and branching-time statistics of a single tree, as computed by
+ * TreeStatistics.
+ */
+template <class EdgeLengthT=double>
+struct TreeShapeStatistics {
+    unsigned long   num_leaves;
+    // sum over nodes with two children of the difference in the number of
+    // leaves they subtend (nodes with any other number of children do not
+    // contribute)
+    unsigned long   colless;
+    // sum over leaves of the number of edges from the root
+    unsigned long   sackin;
+    // number of nodes whose only children are two leaves
+    unsigned long   cherries;
+    // Shao and Sokal's B1: sum over internal nodes other than the root of
+    // 1 / (number of edges to the most distant descendent leaf)
+    double          b1;
+    // sum of the lengths of all edges but that subtending the root
+    EdgeLengthT     tree_length;
+    // greatest sum of edge lengths between the root and any leaf
+    EdgeLengthT     tree_height;
+    // Pybus and Harvey's gamma (NaN if there are fewer than three leaves)
+    double          gamma;
+}; // TreeShapeStatistics
+
+////////////////////////////////////////////////////////////////////////////////
+// TreeStatistics
+
+/**
+ * Computes TreeShapeStatistics in one postorder pass over a tree, in which
+ * the leaf counts, heights and ages of each subtree are carried up to its
+ * parent on a stack rather than recomputed:
+ *
+ *      platypus::TreeStatistics<TreeType> statistics(
+ *              [](const NodeValue & nv) { return nv.get_edge_length(); });
+ *      auto values = statistics.compute(tree);
+ *      ... values.colless ... values.gamma ...
+ *
+ * or, for many trees at once, appending one row per tree to a DataTable:
+ *
+ *      platypus::DataTable table;
+ *      statistics.tabulate(trees.begin(), trees.end(), table, num_threads);
+ *
+ * The internode intervals used for gamma are taken from node ages (the
+ * greatest sum of edge lengths to a descendent leaf), so that the tree is
+ * treated as ultrametric. A node with ``k`` children is treated as ``k -
+ * 1`` simultaneous branching events, so gamma is defined for trees with
+ * polytomies and unifurcations.
+ *
+ * The scratch storage of a TreeStatistics object is reused between trees,
+ * so compute() must not be called concurrently on the same object.
+ *
+ * @tparam TreeT
+ *   Type of tree (platypus::Tree or derived).
+ * @tparam EdgeLengthT
+ *   Type of edge length values.
+ */
+template <class TreeT, class EdgeLengthT=double>
+class TreeStatistics {
+
+    public:
+        typedef typename TreeT::node_type       node_type;
+        typedef typename TreeT::value_type      value_type;
+        typedef TreeShapeStatistics<EdgeLengthT> values_type;
+        typedef std::function<EdgeLengthT (const value_type &)> edge_length_getter_type;
+
+    public:
+
+        /**
+         * If ``edge_length_getter`` is empty, all edge lengths are
+         * default-constructed (so that only the topological statistics are
+         * meaningful).
+         */
+        TreeStatistics(const edge_length_getter_type & edge_length_getter=edge_length_getter_type())
+            : edge_length_getter_(edge_length_getter) { }
+
+        TreeStatistics(const TreeStatistics & other)
+            : edge_length_getter_(other.edge_length_getter_) { }
+
+        /**
+         * Returns the statistics of ``tree``.
+         */
+        values_type compute(const TreeT & tree) {
+            values_type values;
+            values.num_leaves = 0;
+            values.colless = 0;
+            values.sackin = 0;
+            values.cherries = 0;
+            values.b1 = 0.0;
+            values.tree_length = EdgeLengthT();
+            values.tree_height = EdgeLengthT();
+            this->subtrees_.clear();
+            this->branching_ages_.clear();
+            for (auto ndi = tree.postorder_begin(); ndi != tree.postorder_end(); ++ndi) {
+                const node_type * nd = ndi.node();
+                Subtree subtree;
+                if (nd->is_leaf()) {
+                    subtree.num_leaves = 1;
+                    subtree.height = 0;
+                    subtree.age = EdgeLengthT();
+                    ++values.num_leaves;
+                } else {
+                    // the children are the topmost subtrees on the stack
+                    std::size_t num_children = nd->num_child_nodes();
+                    std::size_t first = this->subtrees_.size() - num_children;
+                    subtree.num_leaves = 0;
+                    subtree.height = 0;
+                    subtree.age = this->subtrees_[first].age_above;
+                    for (std::size_t idx = first; idx < this->subtrees_.size(); ++idx) {
+                        const Subtree & child = this->subtrees_[idx];
+                        subtree.num_leaves += child.num_leaves;
+                        subtree.height = std::max(subtree.height, child.height + 1);
+                        subtree.age = std::max(subtree.age, child.age_above);
+                    }
+                    if (num_children == 2) {
+                        const Subtree & left = this->subtrees_[first];
+                        const Subtree & right = this->subtrees_[first + 1];
+                        values.colless += left.num_leaves > right.num_leaves
+                            ? left.num_leaves - right.num_leaves
+                            : right.num_leaves - left.num_leaves;
+                        if (left.height == 0 && right.height == 0) {
+                            ++values.cherries;
+                        }
+                    }
+                    values.sackin += subtree.num_leaves;
+                    if (nd != tree.head_node()) {
+                        values.b1 += 1.0 / subtree.height;
+                    }
+                    for (std::size_t idx = 1; idx < num_children; ++idx) {
+                        this->branching_ages_.push_back(subtree.age);
+                    }
+                    this->subtrees_.resize(first);
+                }
+                subtree.age_above = subtree.age;
+                if (nd != tree.head_node()) {
+                    EdgeLengthT edge_length = this->get_edge_length(nd);
+                    values.tree_length += edge_length;
+                    subtree.age_above += edge_length;
+                } else {
+                    values.tree_height = subtree.age;
+                }
+                this->subtrees_.push_back(subtree);
+            }
+            values.gamma = this->compute_gamma(values.num_leaves);
+            return values;
+        }
+
+        /**
+         * Appends a row of statistics to ``table`` for each tree in
+         * [``trees_begin``, ``trees_end``) (forward iterators), in order.
+         * Trees are processed concurrently by ``num_threads`` threads (see
+         * resolve_num_threads()), in batches, so that only the statistics of
+         * one batch are held at a time and the range may be as large as need
+         * be. If ``table`` has no columns, they are added first (see
+         * add_columns()); otherwise it must have (at least) the columns
+         * that add_columns() would add, of the same types.
+         */
+        template <class IterT>
+        void tabulate(IterT trees_begin,
+                IterT trees_end,
+                DataTable & table,
+                unsigned int num_threads=1) const {
+            if (table.num_columns() == 0) {
+                add_columns(table);
+            }
+            auto tree_handle = table.column_handle<unsigned long>("tree");
+            auto num_leaves_handle = table.column_handle<unsigned long>("num_leaves");
+            auto colless_handle = table.column_handle<unsigned long>("colless");
+            auto sackin_handle = table.column_handle<unsigned long>("sackin");
+            auto cherries_handle = table.column_handle<unsigned long>("cherries");
+            auto b1_handle = table.column_handle<double>("b1");
+            auto tree_length_handle = table.column_handle<EdgeLengthT>("tree_length");
+            auto tree_height_handle = table.column_handle<EdgeLengthT>("tree_height");
+            auto gamma_handle = table.column_handle<double>("gamma");
+            num_threads = resolve_num_threads(num_threads);
+            std::size_t batch_size = static_cast<std::size_t>(num_threads) * 256;
+            std::vector<IterT> batch_trees;
+            std::vector<values_type> batch_values;
+            batch_trees.reserve(batch_size);
+            while (trees_begin != trees_end) {
+                batch_trees.clear();
+                for (; trees_begin != trees_end && batch_trees.size() < batch_size; ++trees_begin) {
+                    batch_trees.push_back(trees_begin);
+                }
+                batch_values.resize(batch_trees.size());
+                std::size_t num_blocks = std::min<std::size_t>(num_threads, batch_trees.size());
+                std::size_t block_size = (batch_trees.size() + num_blocks - 1) / num_blocks;
+                parallel_for(num_blocks, num_threads, [&] (std::size_t block_idx) {
+                    TreeStatistics statistics(*this);
+                    std::size_t begin_idx = block_idx * block_size;
+                    std::size_t end_idx = std::min(begin_idx + block_size, batch_trees.size());
+                    for (std::size_t idx = begin_idx; idx < end_idx; ++idx) {
+                        batch_values[idx] = statistics.compute(*batch_trees[idx]);
+                    }
+                });
+                table.reserve(table.num_rows() + batch_values.size());
+                for (auto & values : batch_values) {
+                    unsigned long tree_idx = table.num_rows();
+                    auto & row = table.add_row();
+                    row.set(tree_handle, tree_idx);
+                    row.set(num_leaves_handle, values.num_leaves);
+                    row.set(colless_handle, values.colless);
+                    row.set(sackin_handle, values.sackin);
+                    row.set(cherries_handle, values.cherries);
+                    row.set(b1_handle, values.b1);
+                    row.set(tree_length_handle, values.tree_length);
+                    row.set(tree_height_handle, values.tree_height);
+                    row.set(gamma_handle, values.gamma);
+                }
+            }
+        }
+
+        /**
+         * Adds the columns filled by tabulate() to ``table``: "tree" (a key
+         * column, numbering rows from 0 in the order they are added),
+         * followed by one data column for each of the statistics, named as
+         * in TreeShapeStatistics.
+         */
+        static void add_columns(DataTable & table) {
+            table.add_key_column<unsigned long>("tree");
+            table.add_data_column<unsigned long>("num_leaves");
+            table.add_data_column<unsigned long>("colless");
+            table.add_data_column<unsigned long>("sackin");
+            table.add_data_column<unsigned long>("cherries");
+            table.add_data_column<double>("b1");
+            table.add_data_column<EdgeLengthT>("tree_length");
+            table.add_data_column<EdgeLengthT>("tree_height");
+            table.add_data_column<double>("gamma");
+        }
+
+    private:
+
+        struct Subtree {
+            unsigned long   num_leaves;
+            // number of edges to the most distant descendent leaf
+            unsigned long   height;
+            EdgeLengthT     age;
+            // age plus the length of the subtending edge
+            EdgeLengthT     age_above;
+        };
+
+        inline EdgeLengthT get_edge_length(const node_type * nd) const {
+            return this->edge_length_getter_ ? this->edge_length_getter_(nd->value()) : EdgeLengthT();
+        }
+
+        // From the ages of the branching events of the last tree.
+        double compute_gamma(unsigned long num_leaves) {
+            if (num_leaves < 3) {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+            std::sort(this->branching_ages_.begin(), this->branching_ages_.end(), std::greater<EdgeLengthT>());
+            // the ``k``-th interval (from 2) is spent with ``k`` lineages
+            double total = 0.0;
+            double sum_of_partial_totals = 0.0;
+            std::size_t num_intervals = this->branching_ages_.size();
+            for (std::size_t idx = 0; idx < num_intervals; ++idx) {
+                double interval = static_cast<double>(this->branching_ages_[idx])
+                    - (idx + 1 < num_intervals ? static_cast<double>(this->branching_ages_[idx + 1]) : 0.0);
+                total += (idx + 2) * interval;
+                if (idx + 1 < num_intervals) {
+                    sum_of_partial_totals += total;
+                }
+            }
+            double n = static_cast<double>(num_leaves);
+            return (sum_of_partial_totals / (n - 2.0) - total / 2.0)
+                / (total * std::sqrt(1.0 / (12.0 * (n - 2.0))));
+        }
+
+    private:
+        edge_length_getter_type                 edge_length_getter_;
+        // subtrees whose parents have not yet been visited
+        std::vector<Subtree>                    subtrees_;
+        std::vector<EdgeLengthT>                branching_ages_;
+
+}; // TreeStatistics
+
+} // namespace platypus
+
+#endif
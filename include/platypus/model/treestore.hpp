@@ -0,0 +1,680 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Read-only, memory-mappable store of flattened trees.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_MODEL_TREESTORE_HPP
+#define PLATYPUS_MODEL_TREESTORE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../base/exception.hpp"
+#include "../utility/mappedfile.hpp"
+#include "../utility/tokenizer.hpp"
+#include "flattree.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// TreeStoreError
+
+class TreeStoreError : public PlatypusException {
+    public:
+        TreeStoreError(
+                    const std::string & filename,
+                    unsigned long line_num,
+                    const std::string & message)
+            : PlatypusException(filename, line_num, message) { }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// tree_store_format
+
+/**
+ * The file written by platypus::TreeStoreWriter and read by
+ * platypus::TreeStore: a header followed by arrays, each starting at a
+ * multiple of 8 bytes from the start of the file, that are used in place
+ * (and so are in the byte order of the machine that wrote them, which is
+ * recorded in the header and checked when the store is opened):
+ *
+ *      header:     "PLTS", u32 version, u32 byte order mark (0x01020304),
+ *                  u32 reserved, u64 number of trees (T), u64 number of
+ *                  nodes of all trees (N), u64 number of leaves of all trees
+ *                  (L), u64 number of labels (M), u64 bytes of label text
+ *      u64 x (T + 1):  offset of the nodes of each tree in the node arrays
+ *      u64 x (T + 1):  offset of the leaves of each tree in the leaf array
+ *      u32 x N:    parent of each node (FlatTree::npos for the root)
+ *      u32 x N:    subtree end of each node (see FlatTree::subtree_end())
+ *      u32 x N:    number of children of each node
+ *      u32 x N:    number of leaves preceding each node in its tree
+ *      u32 x N:    label index of each node (npos if unlabeled)
+ *      f64 x N:    edge length of each node
+ *      u32 x L:    leaves of each tree, in preorder
+ *      u64 x (M + 1):  offset of each label in the label text
+ *      char x (label text bytes)
+ *
+ * Node indexes are local to each tree, and in preorder as in
+ * platypus::FlatTree. Labels (e.g., taxon names) are pooled, so that
+ * each distinct label is stored once for all trees.
+ */
+namespace tree_store_format {
+
+static const char           MAGIC[4] = {'P', 'L', 'T', 'S'};
+static const std::uint32_t  VERSION = 1;
+static const std::uint32_t  BYTE_ORDER_MARK = 0x01020304;
+static const std::size_t    HEADER_SIZE = 56;
+
+inline std::size_t padded_size(std::size_t num_bytes) {
+    return (num_bytes + 7) & ~static_cast<std::size_t>(7);
+}
+
+} // namespace tree_store_format
+
+////////////////////////////////////////////////////////////////////////////////
+// TreeStoreView
+
+/**
+ * A read-only view of a tree of a platypus::TreeStore, with the structure,
+ * value and traversal interface of platypus::FlatTree: nodes are
+ * identified by their preorder index, with the root at 0. The view only
+ * holds pointers into the store's arrays, and so is cheap to copy, but is
+ * valid only as long as the store.
+ */
+class TreeStoreView {
+
+    public:
+        typedef std::uint32_t                       index_type;
+        typedef double                              edge_length_type;
+        typedef FlatTree<>::index_iterator          preorder_iterator;
+        typedef const index_type *                  leaf_iterator;
+
+        static const index_type npos = FlatTree<>::npos;
+
+        /**
+         * Visits the nodes in postorder, working out each next node from the
+         * parents and subtree ends of the nodes rather than from a stored
+         * sequence. Iterators refer to the arrays of the store rather than
+         * to the view, and so remain valid (as long as the store) when the
+         * view they were obtained from does not.
+         */
+        class postorder_iterator : public std::iterator<std::forward_iterator_tag, index_type, std::ptrdiff_t, const index_type *, index_type> {
+            public:
+                postorder_iterator(const index_type * parents=nullptr, const index_type * subtree_ends=nullptr, index_type idx=npos)
+                    : parents_(parents)
+                    , subtree_ends_(subtree_ends)
+                    , idx_(idx) { }
+                inline index_type operator*() const {
+                    return this->idx_;
+                }
+                inline postorder_iterator & operator++() {
+                    index_type parent = this->parents_[this->idx_];
+                    index_type next = this->subtree_ends_[this->idx_];
+                    if (parent == npos) {
+                        this->idx_ = npos;
+                    } else if (next < this->subtree_ends_[parent]) {
+                        // descend from the next sibling to its first leaf
+                        while (this->subtree_ends_[next] != next + 1) {
+                            ++next;
+                        }
+                        this->idx_ = next;
+                    } else {
+                        this->idx_ = parent;
+                    }
+                    return *this;
+                }
+                inline postorder_iterator operator++(int) {
+                    postorder_iterator i = *this;
+                    ++(*this);
+                    return i;
+                }
+                inline bool operator==(const postorder_iterator & other) const {
+                    return this->idx_ == other.idx_;
+                }
+                inline bool operator!=(const postorder_iterator & other) const {
+                    return this->idx_ != other.idx_;
+                }
+            private:
+                const index_type *  parents_;
+                const index_type *  subtree_ends_;
+                index_type          idx_;
+        }; // postorder_iterator
+
+    public:
+
+        TreeStoreView()
+            : size_(0)
+            , num_leaves_(0)
+            , parents_(nullptr)
+            , subtree_ends_(nullptr)
+            , num_children_(nullptr)
+            , leaf_offsets_(nullptr)
+            , label_indexes_(nullptr)
+            , edge_lengths_(nullptr)
+            , leaves_(nullptr)
+            , label_offsets_(nullptr)
+            , label_text_(nullptr) {
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Metrics
+
+        inline std::size_t size() const {
+            return this->size_;
+        }
+
+        inline bool empty() const {
+            return this->size_ == 0;
+        }
+
+        inline std::size_t num_leaves() const {
+            return this->num_leaves_;
+        }
+
+        inline std::size_t num_internal_nodes() const {
+            return this->size_ - this->num_leaves_;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Structure
+
+        inline index_type root() const {
+            return 0;
+        }
+
+        inline index_type parent(index_type nd) const {
+            return this->parents_[nd];
+        }
+
+        inline index_type first_child(index_type nd) const {
+            return this->is_leaf(nd) ? npos : nd + 1;
+        }
+
+        inline index_type next_sibling(index_type nd) const {
+            index_type parent = this->parents_[nd];
+            if (parent == npos || this->subtree_ends_[nd] == this->subtree_ends_[parent]) {
+                return npos;
+            }
+            return this->subtree_ends_[nd];
+        }
+
+        inline index_type num_children(index_type nd) const {
+            return this->num_children_[nd];
+        }
+
+        inline bool is_leaf(index_type nd) const {
+            return this->subtree_ends_[nd] == nd + 1;
+        }
+
+        // As FlatTree::subtree_end().
+        inline index_type subtree_end(index_type nd) const {
+            return this->subtree_ends_[nd];
+        }
+
+        inline std::size_t subtree_size(index_type nd) const {
+            return this->subtree_ends_[nd] - nd;
+        }
+
+        inline bool is_in_subtree(index_type nd, index_type subtree_root) const {
+            return nd >= subtree_root && nd < this->subtree_ends_[subtree_root];
+        }
+
+        inline std::size_t num_leaves(index_type nd) const {
+            return this->leaf_offset(this->subtree_ends_[nd]) - this->leaf_offsets_[nd];
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Values
+
+        // View into the store of the label of ``nd`` (empty if unlabeled).
+        inline TokenView label(index_type nd) const {
+            index_type label_idx = this->label_indexes_[nd];
+            if (label_idx == npos) {
+                return TokenView();
+            }
+            return TokenView(this->label_text_ + this->label_offsets_[label_idx],
+                    static_cast<std::size_t>(this->label_offsets_[label_idx + 1] - this->label_offsets_[label_idx]));
+        }
+
+        // Index of the label of ``nd`` in the store (see TreeStore::label()),
+        // or npos if unlabeled.
+        inline index_type label_index(index_type nd) const {
+            return this->label_indexes_[nd];
+        }
+
+        inline double edge_length(index_type nd) const {
+            return this->edge_lengths_[nd];
+        }
+
+        // Edge lengths of all nodes, in preorder.
+        inline const double * edge_lengths() const {
+            return this->edge_lengths_;
+        }
+
+        inline const index_type * parents() const {
+            return this->parents_;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Traversal
+
+        inline preorder_iterator preorder_begin() const {
+            return preorder_iterator(0);
+        }
+
+        inline preorder_iterator preorder_end() const {
+            return preorder_iterator(static_cast<index_type>(this->size_));
+        }
+
+        inline preorder_iterator preorder_begin(index_type nd) const {
+            return preorder_iterator(nd);
+        }
+
+        inline preorder_iterator preorder_end(index_type nd) const {
+            return preorder_iterator(this->subtree_ends_[nd]);
+        }
+
+        inline postorder_iterator postorder_begin() const {
+            if (this->size_ == 0) {
+                return this->postorder_end();
+            }
+            // the first leaf, reached through the first children
+            index_type nd = 0;
+            while (!this->is_leaf(nd)) {
+                ++nd;
+            }
+            return postorder_iterator(this->parents_, this->subtree_ends_, nd);
+        }
+
+        inline postorder_iterator postorder_end() const {
+            return postorder_iterator(this->parents_, this->subtree_ends_, npos);
+        }
+
+        inline leaf_iterator leaf_begin() const {
+            return this->leaves_;
+        }
+
+        inline leaf_iterator leaf_end() const {
+            return this->leaves_ + this->num_leaves_;
+        }
+
+        // As FlatTree::leaf_begin(index_type).
+        inline leaf_iterator leaf_begin(index_type nd) const {
+            return this->leaves_ + this->leaf_offsets_[nd];
+        }
+
+        inline leaf_iterator leaf_end(index_type nd) const {
+            return this->leaves_ + this->leaf_offset(this->subtree_ends_[nd]);
+        }
+
+        inline std::size_t leaf_offset(index_type nd) const {
+            return nd == this->size_ ? this->num_leaves_ : this->leaf_offsets_[nd];
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Conversion
+
+        /**
+         * Builds the tree into ``tree`` (which is cleared first), setting
+         * the label of each labeled node with ``label_setter`` and the edge
+         * length of every node with ``edge_length_setter`` (either of which
+         * may be empty).
+         */
+        template <typename TreeT>
+        void copy_to(TreeT & tree,
+                const std::function<void (typename TreeT::value_type &, const std::string &)> & label_setter,
+                const std::function<void (typename TreeT::value_type &, double)> & edge_length_setter) const {
+            typedef typename TreeT::node_type tree_node_type;
+            tree.clear();
+            if (this->size_ == 0) {
+                return;
+            }
+            std::vector<tree_node_type *> nodes;
+            nodes.reserve(this->size_);
+            nodes.push_back(tree.head_node());
+            for (index_type nd = 1; nd < this->size_; ++nd) {
+                tree_node_type * node = this->is_leaf(nd) ? tree.create_leaf_node() : tree.create_internal_node();
+                nodes[this->parents_[nd]]->add_child(node);
+                nodes.push_back(node);
+            }
+            for (index_type nd = 0; nd < this->size_; ++nd) {
+                if (label_setter && this->label_indexes_[nd] != npos) {
+                    label_setter(nodes[nd]->value(), this->label(nd).str());
+                }
+                if (edge_length_setter) {
+                    edge_length_setter(nodes[nd]->value(), this->edge_lengths_[nd]);
+                }
+            }
+            tree.mark_structure_modified();
+        }
+
+    private:
+        std::size_t             size_;
+        std::size_t             num_leaves_;
+        const index_type *      parents_;
+        const index_type *      subtree_ends_;
+        const index_type *      num_children_;
+        const index_type *      leaf_offsets_;
+        const index_type *      label_indexes_;
+        const double *          edge_lengths_;
+        const index_type *      leaves_;
+        const std::uint64_t *   label_offsets_;
+        const char *            label_text_;
+
+    friend class TreeStore;
+
+}; // TreeStoreView
+
+////////////////////////////////////////////////////////////////////////////////
+// TreeStore
+
+/**
+ * A read-only collection of trees in the format written by
+ * platypus::TreeStoreWriter (see platypus::tree_store_format), used in
+ * place: opening a store file only maps it into memory (see
+ * platypus::MappedFile) and checks the sizes of its arrays, so that any
+ * number of processes can open the same store, and share the pages of the
+ * file in the operating system's page cache, without parsing or copying
+ * any trees. Trees are accessed through views (see
+ * platypus::TreeStoreView):
+ *
+ *      platypus::TreeStore store("reference.pts");
+ *      for (std::size_t tree_idx = 0; tree_idx < store.num_trees(); ++tree_idx) {
+ *          platypus::TreeStoreView tree = store.tree(tree_idx);
+ *          for (auto nd = tree.postorder_begin(); nd != tree.postorder_end(); ++nd) {
+ *              ...
+ *          }
+ *      }
+ *
+ * The contents of the arrays are not validated, and should be those written
+ * by platypus::TreeStoreWriter.
+ */
+class TreeStore {
+
+    public:
+        typedef TreeStoreView::index_type       index_type;
+
+    public:
+
+        // Opens the store in the file at ``path``.
+        TreeStore(const std::string & path)
+            : file_(new MappedFile(path)) {
+            this->open(this->file_->data(), this->file_->size());
+        }
+
+        /**
+         * Uses the store in the ``size`` bytes at ``data``, which are not
+         * copied, and must outlive the store. ``data`` must be aligned to
+         * 8 bytes.
+         */
+        TreeStore(const char * data, std::size_t size) {
+            this->open(data, size);
+        }
+
+        TreeStore(TreeStore &&) = default;
+        TreeStore(const TreeStore &) = delete;
+        TreeStore & operator=(const TreeStore &) = delete;
+
+        inline std::size_t num_trees() const {
+            return this->num_trees_;
+        }
+
+        // Total number of nodes in all trees.
+        inline std::size_t num_nodes() const {
+            return this->num_nodes_;
+        }
+
+        inline std::size_t num_labels() const {
+            return this->num_labels_;
+        }
+
+        inline TokenView label(std::size_t label_idx) const {
+            return TokenView(this->label_text_ + this->label_offsets_[label_idx],
+                    static_cast<std::size_t>(this->label_offsets_[label_idx + 1] - this->label_offsets_[label_idx]));
+        }
+
+        TreeStoreView tree(std::size_t tree_idx) const {
+            std::size_t node_offset = static_cast<std::size_t>(this->tree_node_offsets_[tree_idx]);
+            std::size_t leaf_offset = static_cast<std::size_t>(this->tree_leaf_offsets_[tree_idx]);
+            TreeStoreView view;
+            view.size_ = static_cast<std::size_t>(this->tree_node_offsets_[tree_idx + 1]) - node_offset;
+            view.num_leaves_ = static_cast<std::size_t>(this->tree_leaf_offsets_[tree_idx + 1]) - leaf_offset;
+            view.parents_ = this->parents_ + node_offset;
+            view.subtree_ends_ = this->subtree_ends_ + node_offset;
+            view.num_children_ = this->num_children_ + node_offset;
+            view.leaf_offsets_ = this->leaf_offsets_ + node_offset;
+            view.label_indexes_ = this->label_indexes_ + node_offset;
+            view.edge_lengths_ = this->edge_lengths_ + node_offset;
+            view.leaves_ = this->leaves_ + leaf_offset;
+            view.label_offsets_ = this->label_offsets_;
+            view.label_text_ = this->label_text_;
+            return view;
+        }
+
+    private:
+
+        template <typename T>
+        static const T * take_array(const char * & pos, const char * end, std::size_t count) {
+            std::size_t num_bytes = count * sizeof(T);
+            if (count > static_cast<std::size_t>(end - pos) / sizeof(T)) {
+                throw TreeStoreError(__FILE__, __LINE__, "platypus::TreeStore: truncated store");
+            }
+            const T * array = reinterpret_cast<const T *>(pos);
+            pos += std::min(tree_store_format::padded_size(num_bytes), static_cast<std::size_t>(end - pos));
+            return array;
+        }
+
+        void open(const char * data, std::size_t size) {
+            if (reinterpret_cast<std::uintptr_t>(data) % 8 != 0) {
+                throw TreeStoreError(__FILE__, __LINE__, "platypus::TreeStore: store data not aligned to 8 bytes");
+            }
+            if (size < tree_store_format::HEADER_SIZE || std::memcmp(data, tree_store_format::MAGIC, 4) != 0) {
+                throw TreeStoreError(__FILE__, __LINE__, "platypus::TreeStore: not a tree store");
+            }
+            std::uint32_t header_u32[3];
+            std::memcpy(header_u32, data + 4, sizeof(header_u32));
+            if (header_u32[1] != tree_store_format::BYTE_ORDER_MARK) {
+                throw TreeStoreError(__FILE__, __LINE__, "platypus::TreeStore: store written on a machine of different byte order");
+            }
+            if (header_u32[0] != tree_store_format::VERSION) {
+                throw TreeStoreError(__FILE__, __LINE__, "platypus::TreeStore: unsupported version");
+            }
+            const std::uint64_t * counts = reinterpret_cast<const std::uint64_t *>(data + 16);
+            this->num_trees_ = static_cast<std::size_t>(counts[0]);
+            this->num_nodes_ = static_cast<std::size_t>(counts[1]);
+            std::size_t num_leaves = static_cast<std::size_t>(counts[2]);
+            this->num_labels_ = static_cast<std::size_t>(counts[3]);
+            std::size_t label_bytes = static_cast<std::size_t>(counts[4]);
+            const char * pos = data + tree_store_format::HEADER_SIZE;
+            const char * end = data + size;
+            this->tree_node_offsets_ = take_array<std::uint64_t>(pos, end, this->num_trees_ + 1);
+            this->tree_leaf_offsets_ = take_array<std::uint64_t>(pos, end, this->num_trees_ + 1);
+            this->parents_ = take_array<index_type>(pos, end, this->num_nodes_);
+            this->subtree_ends_ = take_array<index_type>(pos, end, this->num_nodes_);
+            this->num_children_ = take_array<index_type>(pos, end, this->num_nodes_);
+            this->leaf_offsets_ = take_array<index_type>(pos, end, this->num_nodes_);
+            this->label_indexes_ = take_array<index_type>(pos, end, this->num_nodes_);
+            this->edge_lengths_ = take_array<double>(pos, end, this->num_nodes_);
+            this->leaves_ = take_array<index_type>(pos, end, num_leaves);
+            this->label_offsets_ = take_array<std::uint64_t>(pos, end, this->num_labels_ + 1);
+            this->label_text_ = take_array<char>(pos, end, label_bytes);
+            if (this->tree_node_offsets_[this->num_trees_] != this->num_nodes_
+                    || this->tree_leaf_offsets_[this->num_trees_] != num_leaves
+                    || this->label_offsets_[this->num_labels_] != label_bytes) {
+                throw TreeStoreError(__FILE__, __LINE__, "platypus::TreeStore: inconsistent array sizes");
+            }
+        }
+
+    private:
+        std::unique_ptr<MappedFile>     file_;
+        std::size_t                     num_trees_;
+        std::size_t                     num_nodes_;
+        std::size_t                     num_labels_;
+        const std::uint64_t *           tree_node_offsets_;
+        const std::uint64_t *           tree_leaf_offsets_;
+        const index_type *              parents_;
+        const index_type *              subtree_ends_;
+        const index_type *              num_children_;
+        const index_type *              leaf_offsets_;
+        const index_type *              label_indexes_;
+        const double *                  edge_lengths_;
+        const index_type *              leaves_;
+        const std::uint64_t *           label_offsets_;
+        const char *                    label_text_;
+
+}; // TreeStore
+
+////////////////////////////////////////////////////////////////////////////////
+// TreeStoreWriter
+
+/**
+ * Accumulates trees, flattened as platypus::FlatTree objects, and writes
+ * them as a store to be opened with platypus::TreeStore. Labels are
+ * pooled as they are added, and empty labels are stored as unlabeled
+ * nodes.
+ */
+class TreeStoreWriter {
+
+    public:
+        typedef TreeStoreView::index_type       index_type;
+
+    public:
+
+        TreeStoreWriter() {
+            this->tree_node_offsets_.push_back(0);
+            this->tree_leaf_offsets_.push_back(0);
+            this->label_offsets_.push_back(0);
+        }
+
+        template <typename EdgeLengthT>
+        void add_tree(const FlatTree<EdgeLengthT> & tree) {
+            index_type num_nodes = static_cast<index_type>(tree.size());
+            for (index_type nd = 0; nd < num_nodes; ++nd) {
+                this->parents_.push_back(tree.parent(nd));
+                this->subtree_ends_.push_back(tree.subtree_end(nd));
+                this->num_children_.push_back(tree.num_children(nd));
+                this->leaf_offsets_.push_back(static_cast<index_type>(tree.leaf_offset(nd)));
+                this->label_indexes_.push_back(this->get_label_index(tree.label(nd)));
+                this->edge_lengths_.push_back(static_cast<double>(tree.edge_length(nd)));
+            }
+            this->leaves_.insert(this->leaves_.end(), tree.leaf_begin(), tree.leaf_end());
+            this->tree_node_offsets_.push_back(this->parents_.size());
+            this->tree_leaf_offsets_.push_back(this->leaves_.size());
+        }
+
+        // Adds ``tree``, flattened as by the corresponding FlatTree
+        // constructor.
+        template <typename TreeT>
+        void add_tree(const TreeT & tree,
+                const std::function<std::string (const typename TreeT::value_type &)> & label_getter,
+                const std::function<double (const typename TreeT::value_type &)> & edge_length_getter) {
+            this->add_tree(FlatTree<double>(tree, label_getter, edge_length_getter));
+        }
+
+        inline std::size_t num_trees() const {
+            return this->tree_node_offsets_.size() - 1;
+        }
+
+        void write(std::ostream & out) const {
+            std::string header(tree_store_format::MAGIC, 4);
+            std::uint32_t header_u32[3] = {tree_store_format::VERSION, tree_store_format::BYTE_ORDER_MARK, 0};
+            header.append(reinterpret_cast<const char *>(header_u32), sizeof(header_u32));
+            std::uint64_t counts[5] = {
+                this->num_trees(),
+                this->parents_.size(),
+                this->leaves_.size(),
+                this->label_offsets_.size() - 1,
+                this->label_text_.size()};
+            header.append(reinterpret_cast<const char *>(counts), sizeof(counts));
+            out.write(header.data(), header.size());
+            write_array(out, this->tree_node_offsets_);
+            write_array(out, this->tree_leaf_offsets_);
+            write_array(out, this->parents_);
+            write_array(out, this->subtree_ends_);
+            write_array(out, this->num_children_);
+            write_array(out, this->leaf_offsets_);
+            write_array(out, this->label_indexes_);
+            write_array(out, this->edge_lengths_);
+            write_array(out, this->leaves_);
+            write_array(out, this->label_offsets_);
+            write_array(out, this->label_text_);
+        }
+
+        void write_file(const std::string & path) const {
+            std::ofstream out(path, std::ios::out | std::ios::binary);
+            if (!out) {
+                throw TreeStoreError(__FILE__, __LINE__, "platypus::TreeStoreWriter: unable to open file: '" + path + "'");
+            }
+            this->write(out);
+            out.close();
+            if (!out) {
+                throw TreeStoreError(__FILE__, __LINE__, "platypus::TreeStoreWriter: error writing file: '" + path + "'");
+            }
+        }
+
+    private:
+
+        index_type get_label_index(const std::string & label) {
+            if (label.empty()) {
+                return TreeStoreView::npos;
+            }
+            auto inserted = this->label_indexes_by_label_.insert(std::make_pair(label, static_cast<index_type>(this->label_offsets_.size() - 1)));
+            if (inserted.second) {
+                this->label_text_ += label;
+                this->label_offsets_.push_back(this->label_text_.size());
+            }
+            return inserted.first->second;
+        }
+
+        // Writes the elements of ``array``, padded with zeros to a multiple
+        // of 8 bytes.
+        template <typename ContainerT>
+        static void write_array(std::ostream & out, const ContainerT & array) {
+            static const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+            std::size_t num_bytes = array.size() * sizeof(typename ContainerT::value_type);
+            out.write(reinterpret_cast<const char *>(array.data()), num_bytes);
+            out.write(padding, tree_store_format::padded_size(num_bytes) - num_bytes);
+        }
+
+    private:
+        std::vector<std::uint64_t>                      tree_node_offsets_;
+        std::vector<std::uint64_t>                      tree_leaf_offsets_;
+        std::vector<index_type>                         parents_;
+        std::vector<index_type>                         subtree_ends_;
+        std::vector<index_type>                         num_children_;
+        std::vector<index_type>                         leaf_offsets_;
+        std::vector<index_type>                         label_indexes_;
+        std::vector<double>                             edge_lengths_;
+        std::vector<index_type>                         leaves_;
+        std::vector<std::uint64_t>                      label_offsets_;
+        std::string                                     label_text_;
+        std::unordered_map<std::string, index_type>     label_indexes_by_label_;
+
+}; // TreeStoreWriter
+
+} // namespace platypus
+
+#endif
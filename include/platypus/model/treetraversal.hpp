@@ -0,0 +1,249 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Inlinable traversal algorithms over trees.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_MODEL_TREETRAVERSAL_HPP
+#define PLATYPUS_MODEL_TREETRAVERSAL_HPP
+
+#include <cstddef>
+#include <vector>
+#include "flattree.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// for_each_postorder, for_each_preorder
+
+/**
+ * Calls ``fn(nd)`` with (a pointer to) each node of ``tree`` in postorder.
+ *
+ * Equivalent to iterating from Tree::postorder_begin() to
+ * Tree::postorder_end(), but as a plain loop over the node links, with no
+ * iterator object (or virtual destructor) and with ``fn`` taken by value so
+ * that it can be inlined into the loop.
+ */
+template <class TreeT, class FnT>
+inline void for_each_postorder(const TreeT & tree, FnT fn) {
+    typedef typename TreeT::node_type node_type;
+    node_type * head = tree.head_node();
+    node_type * nd = head;
+    while (nd->first_child_node() != nullptr) {
+        nd = nd->first_child_node();
+    }
+    while (true) {
+        // the successor is found before the call, so that ``fn`` may
+        // modify the links of nodes already visited
+        node_type * next = nullptr;
+        if (nd != head) {
+            next = nd->next_sibling_node();
+            if (next == nullptr) {
+                next = nd->parent_node();
+            } else {
+                while (next->first_child_node() != nullptr) {
+                    next = next->first_child_node();
+                }
+            }
+        }
+        fn(nd);
+        if (next == nullptr) {
+            return;
+        }
+        nd = next;
+    }
+}
+
+// Calls ``fn(nd)`` with each node index of ``tree`` in postorder.
+template <class EdgeLengthT, class FnT>
+inline void for_each_postorder(const FlatTree<EdgeLengthT> & tree, FnT fn) {
+    for (auto ndi = tree.postorder_begin(); ndi != tree.postorder_end(); ++ndi) {
+        fn(*ndi);
+    }
+}
+
+// Calls ``fn(nd)`` with (a pointer to) each node of ``tree`` in preorder.
+template <class TreeT, class FnT>
+inline void for_each_preorder(const TreeT & tree, FnT fn) {
+    typedef typename TreeT::node_type node_type;
+    node_type * head = tree.head_node();
+    node_type * nd = head;
+    while (true) {
+        fn(nd);
+        if (nd->first_child_node() != nullptr) {
+            nd = nd->first_child_node();
+            continue;
+        }
+        while (nd != head && nd->next_sibling_node() == nullptr) {
+            nd = nd->parent_node();
+        }
+        if (nd == head) {
+            return;
+        }
+        nd = nd->next_sibling_node();
+    }
+}
+
+// Calls ``fn(nd)`` with each node index of ``tree`` in preorder.
+template <class EdgeLengthT, class FnT>
+inline void for_each_preorder(const FlatTree<EdgeLengthT> & tree, FnT fn) {
+    typedef typename FlatTree<EdgeLengthT>::index_type index_type;
+    index_type num_nodes = static_cast<index_type>(tree.size());
+    for (index_type nd = 0; nd < num_nodes; ++nd) {
+        fn(nd);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// for_each_child_before_parent
+
+/**
+ * Calls ``fn(nd)`` with each node index of ``tree`` in reverse preorder. Like
+ * postorder, this visits every node after all of its descendants (so that
+ * any bottom-up calculation can use it), but children are visited last to
+ * first, and as a FlatTree identifies nodes by their preorder index, it is a
+ * single pass down contiguous memory.
+ */
+template <class EdgeLengthT, class FnT>
+inline void for_each_child_before_parent(const FlatTree<EdgeLengthT> & tree, FnT fn) {
+    typedef typename FlatTree<EdgeLengthT>::index_type index_type;
+    for (index_type nd = static_cast<index_type>(tree.size()); nd > 0; --nd) {
+        fn(nd - 1);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PreorderNodeSequence
+
+/**
+ * The nodes of a platypus::Tree, collected in preorder in a single pass, for
+ * repeated traversals that do not chase the links between nodes: preorder
+ * (for_each_preorder()) or reverse preorder (for_each_child_before_parent(),
+ * in which each node is visited after all of its descendants, as in
+ * postorder, but children last to first).
+ *
+ * When the nodes of a tree were created in preorder from a contiguous
+ * allocator (e.g., platypus::TreeNodeArena, with trees built by the
+ * readers), both traversals also step through the nodes themselves in
+ * (forward or reverse) memory order.
+ *
+ * The sequence records the Tree::structure_version() of the tree it was
+ * built from, so is_current() tells whether it needs to be rebuilt (with
+ * assign(), which reuses the storage) after the tree has been modified.
+ */
+template <class TreeT>
+class PreorderNodeSequence {
+
+    public:
+        typedef typename TreeT::node_type           node_type;
+        typedef std::vector<node_type *>            node_vector_type;
+        typedef typename node_vector_type::const_iterator const_iterator;
+
+    public:
+        PreorderNodeSequence()
+            : tree_(nullptr)
+            , head_node_(nullptr)
+            , structure_version_(0) {
+        }
+        explicit PreorderNodeSequence(const TreeT & tree)
+            : tree_(nullptr)
+            , head_node_(nullptr)
+            , structure_version_(0) {
+            this->assign(tree);
+        }
+
+        void assign(const TreeT & tree) {
+            this->nodes_.clear();
+            platypus::for_each_preorder(tree, [this](node_type * nd) { this->nodes_.push_back(nd); });
+            this->tree_ = &tree;
+            this->head_node_ = tree.head_node();
+            this->structure_version_ = tree.structure_version();
+        }
+
+        // Whether the sequence reflects the current structure of ``tree``.
+        bool is_current(const TreeT & tree) const {
+            return this->tree_ == &tree
+                && this->head_node_ == tree.head_node()
+                && this->structure_version_ == tree.structure_version();
+        }
+
+        // Rebuilds the sequence from ``tree`` if it is not current.
+        void update(const TreeT & tree) {
+            if (!this->is_current(tree)) {
+                this->assign(tree);
+            }
+        }
+
+        void clear() {
+            this->nodes_.clear();
+            this->tree_ = nullptr;
+        }
+
+        std::size_t size() const {
+            return this->nodes_.size();
+        }
+        bool empty() const {
+            return this->nodes_.empty();
+        }
+        const node_vector_type & nodes() const {
+            return this->nodes_;
+        }
+        const_iterator begin() const {
+            return this->nodes_.cbegin();
+        }
+        const_iterator end() const {
+            return this->nodes_.cend();
+        }
+
+        template <class FnT>
+        void for_each_preorder(FnT fn) const {
+            for (auto nd : this->nodes_) {
+                fn(nd);
+            }
+        }
+
+        template <class FnT>
+        void for_each_child_before_parent(FnT fn) const {
+            for (auto ndi = this->nodes_.crbegin(); ndi != this->nodes_.crend(); ++ndi) {
+                fn(*ndi);
+            }
+        }
+
+    private:
+        node_vector_type    nodes_;
+        const TreeT *       tree_;
+        node_type *         head_node_;
+        unsigned long       structure_version_;
+
+}; // PreorderNodeSequence
+
+/**
+ * Calls ``fn(nd)`` with (a pointer to) each node of ``tree`` in reverse
+ * preorder (see PreorderNodeSequence, which avoids re-collecting the nodes
+ * on repeated traversals of the same tree).
+ */
+template <class TreeT, class FnT>
+inline void for_each_child_before_parent(const TreeT & tree, FnT fn) {
+    PreorderNodeSequence<TreeT> nodes(tree);
+    nodes.for_each_child_before_parent(fn);
+}
+
+} // namespace platypus
+
+#endif
@@ -22,13 +22,147 @@
 #ifndef PLATYPUS_NUMERIC_FUNCTION_HPP
 #define PLATYPUS_NUMERIC_FUNCTION_HPP
 
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
 namespace platypus {
 namespace numeric {
 
+namespace detail {
+
+// Largest n for which every binomial coefficient $\choose{n, k}$ fits in
+// a 64-bit unsigned integer.
+static const unsigned long BINOMIAL_COEFFICIENT_TABLE_MAX_N = 67;
+
+/**
+ * Rows 0 through BINOMIAL_COEFFICIENT_TABLE_MAX_N of Pascal's triangle, built
+ * (by addition only, so without overflow) on first use.
+ */
+class BinomialCoefficientTable {
+    public:
+        static const BinomialCoefficientTable & instance() {
+            static const BinomialCoefficientTable table;
+            return table;
+        }
+        inline std::uint64_t operator()(unsigned long n, unsigned long k) const {
+            return this->rows_[n][k];
+        }
+    private:
+        BinomialCoefficientTable() {
+            for (unsigned long n = 0; n <= BINOMIAL_COEFFICIENT_TABLE_MAX_N; ++n) {
+                this->rows_[n][0] = 1;
+                this->rows_[n][n] = 1;
+                for (unsigned long k = 1; k < n; ++k) {
+                    this->rows_[n][k] = this->rows_[n-1][k-1] + this->rows_[n-1][k];
+                }
+                for (unsigned long k = n + 1; k <= BINOMIAL_COEFFICIENT_TABLE_MAX_N; ++k) {
+                    this->rows_[n][k] = 0;
+                }
+            }
+        }
+    private:
+        std::uint64_t rows_[BINOMIAL_COEFFICIENT_TABLE_MAX_N + 1][BINOMIAL_COEFFICIENT_TABLE_MAX_N + 1];
+};
+
+} // namespace detail
+
+/**
+ * Calculates the natural logarithm of the binomial coefficient, $\choose{n,
+ * k}$, using the log-gamma function, in constant time.
+ *
+ * @return
+ *   $\log \choose{n, k}$, or negative infinity if $k > n$.
+ */
+inline double log_binomial_coefficient(unsigned long n, unsigned long k) {
+    if (k > n) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    if (0 == k || n == k) {
+        return 0.0;
+    }
+    return std::lgamma(static_cast<double>(n) + 1.0)
+        - std::lgamma(static_cast<double>(k) + 1.0)
+        - std::lgamma(static_cast<double>(n - k) + 1.0);
+}
+
+/**
+ * Calculates the binomial coefficient, $\choose{n, k}$, exactly, as a 64-bit
+ * unsigned integer.
+ *
+ * Values for $n \leq 67$ are looked up from a table. Beyond that, the value
+ * is built up multiplicatively in $\min(k, n-k)$ steps, each of which is
+ * checked for overflow.
+ *
+ * @throws std::overflow_error
+ *   If the result cannot be represented in 64 bits.
+ */
+inline std::uint64_t binomial_coefficient_exact(unsigned long n, unsigned long k) {
+    if (k > n) {
+        return 0;
+    }
+    if (n <= detail::BINOMIAL_COEFFICIENT_TABLE_MAX_N) {
+        return detail::BinomialCoefficientTable::instance()(n, k);
+    }
+    if (k > (n - k)) {
+        k = n - k;
+    }
+    std::uint64_t b = 1;
+    for (unsigned long i = 1; i <= k; ++i) {
+        // b = b * m / i, where the division is exact, computed as
+        // (b / i) * m + ((b % i) * m) / i to defer overflow
+        std::uint64_t m = n - k + i;
+        std::uint64_t q = b / i;
+        std::uint64_t r = b % i;
+        if (q > std::numeric_limits<std::uint64_t>::max() / m) {
+            throw std::overflow_error("platypus::numeric::binomial_coefficient_exact: result overflows 64-bit integer");
+        }
+        std::uint64_t hi = q * m;
+        std::uint64_t lo = (r * m) / i;
+        if (hi > std::numeric_limits<std::uint64_t>::max() - lo) {
+            throw std::overflow_error("platypus::numeric::binomial_coefficient_exact: result overflows 64-bit integer");
+        }
+        b = hi + lo;
+    }
+    return b;
+}
+
+/**
+ * Calculates the binomial coefficient, $\choose{n, k}$, as a floating-point
+ * value, in constant time: exactly (up to the precision of a double) from a
+ * table for $n \leq 67$, and through the log-gamma function beyond that.
+ * Does not overflow for any $n$ for which the result is representable.
+ */
+inline double binomial_coefficient_real(unsigned long n, unsigned long k) {
+    if (k > n) {
+        return 0.0;
+    }
+    if (n <= detail::BINOMIAL_COEFFICIENT_TABLE_MAX_N) {
+        return static_cast<double>(detail::BinomialCoefficientTable::instance()(n, k));
+    }
+    if (k > (n - k)) {
+        k = n - k;
+    }
+    if (k == 1) {
+        return static_cast<double>(n);
+    }
+    if (k == 2) {
+        return 0.5 * static_cast<double>(n) * static_cast<double>(n - 1);
+    }
+    return std::round(std::exp(log_binomial_coefficient(n, k)));
+}
+
 /**
  * Calculates the binomial coefficient, $\choose{n, k}$, i.e., the number of
- * distinct sets of $k$ elements that can be sampled with replacement from a
- * population of $n$ elements.
+ * distinct sets of $k$ elements that can be sampled without replacement from
+ * a population of $n$ elements.
+ *
+ * If `T` is an integral type, the result is exact (see
+ * binomial_coefficient_exact()), and std::overflow_error is thrown if it
+ * cannot be represented in `T`. If `T` is a floating-point type, the result
+ * is calculated in floating point (see binomial_coefficient_real()).
  *
  * @tparam T
  *   Numeric type. Defaults to unsigned long.
@@ -39,33 +173,38 @@ namespace numeric {
  *
  * @return
  *   The binomial coefficient, $\choose{n, k}$.
- *
- * @note
- *    Modified from: http://etceterology.com/fast-binomial-coefficients
  */
 template <class T = unsigned long>
-T binomial_coefficient(unsigned long n, unsigned long k) {
-    unsigned long i;
-    T b;
-    if (0 == k || n == k) {
-        return 1;
+typename std::enable_if<std::is_integral<T>::value, T>::type
+binomial_coefficient(unsigned long n, unsigned long k) {
+    std::uint64_t b = binomial_coefficient_exact(n, k);
+    if (b > static_cast<typename std::make_unsigned<T>::type>(std::numeric_limits<T>::max())) {
+        throw std::overflow_error("platypus::numeric::binomial_coefficient: result overflows return type");
     }
-    if (k > n) {
+    return static_cast<T>(b);
+}
+
+template <class T>
+typename std::enable_if<std::is_floating_point<T>::value, T>::type
+binomial_coefficient(unsigned long n, unsigned long k) {
+    return static_cast<T>(binomial_coefficient_real(n, k));
+}
+
+/**
+ * Returns the number of distinct pairs in a set of $n$ elements, $\choose{n,
+ * 2} = \frac{n(n-1)}{2}$, in closed form. Equal to binomial_coefficient(n,
+ * 2), but without the loop.
+ */
+inline unsigned long num_pairs(unsigned long n) {
+    if (n < 2) {
         return 0;
     }
-    if (k > (n - k)) {
-        k = n - k;
+    // divide the even factor first, to avoid overflow of the product
+    if (n % 2 == 0) {
+        return (n / 2) * (n - 1);
+    } else {
+        return n * ((n - 1) / 2);
     }
-    if (1 == k) {
-        return n;
-    }
-    b = 1;
-    for (i = 1; i <= k; ++i) {
-        b *= (n - (k - i));
-        if (b < 0) return -1; /* Overflow */
-        b /= i;
-    }
-    return b;
 }
 
 } // namespace numeric
@@ -19,8 +19,15 @@
  *
  */
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <ctime>
+#include <limits>
 #include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 
 #ifndef PLATYPUS_NUMERIC_RNG_HPP
 #define PLATYPUS_NUMERIC_RNG_HPP
@@ -28,6 +35,293 @@
 namespace platypus {
 namespace numeric {
 
+////////////////////////////////////////////////////////////////////////////////
+// Seed derivation
+
+/**
+ * Returns a seed for the independent random number stream with index
+ * `stream_idx` derived from `master_seed`, by passing their combination
+ * through the SplitMix64 finalizer. The same master seed and index always
+ * yield the same seed, while adjacent indexes yield uncorrelated seeds, so
+ * that, e.g., each replicate of a simulation can be given its own generator
+ * and results do not depend on how replicates are distributed across
+ * threads.
+ */
+inline std::uint64_t derive_seed(std::uint64_t master_seed, std::uint64_t stream_idx) {
+    std::uint64_t z = master_seed + (stream_idx + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Xoshiro256StarStar
+
+/**
+ * The xoshiro256** engine of Blackman and Vigna: a 256-bit state, 64-bit
+ * output generator that is several times faster than std::mt19937_64 and
+ * passes all standard statistical test batteries. Meets the requirements
+ * of a standard random number engine (so it can be used with the
+ * distributions of <random>), and in addition supports ``jump()`` and
+ * ``long_jump()``, which advance the state by 2^128 and 2^192 draws
+ * respectively, to partition a single seeded sequence into
+ * non-overlapping streams for parallel use.
+ *
+ * The state is initialized from a seed using the SplitMix64 sequence (see
+ * derive_seed()), as recommended by the authors.
+ */
+class Xoshiro256StarStar {
+
+    public:
+        typedef std::uint64_t result_type;
+
+        static constexpr result_type default_seed = 5489u;
+
+        static constexpr result_type min() {
+            return 0;
+        }
+        static constexpr result_type max() {
+            return std::numeric_limits<result_type>::max();
+        }
+
+    public:
+        Xoshiro256StarStar() {
+            this->seed(default_seed);
+        }
+        explicit Xoshiro256StarStar(result_type seed_value) {
+            this->seed(seed_value);
+        }
+
+        void seed(result_type seed_value=default_seed) {
+            for (unsigned int i = 0; i < 4; ++i) {
+                this->state_[i] = derive_seed(seed_value, i);
+            }
+        }
+
+        inline result_type operator()() {
+            const std::uint64_t result = rotl(this->state_[1] * 5, 7) * 9;
+            const std::uint64_t t = this->state_[1] << 17;
+            this->state_[2] ^= this->state_[0];
+            this->state_[3] ^= this->state_[1];
+            this->state_[1] ^= this->state_[2];
+            this->state_[0] ^= this->state_[3];
+            this->state_[2] ^= t;
+            this->state_[3] = rotl(this->state_[3], 45);
+            return result;
+        }
+
+        void discard(unsigned long long n) {
+            for (; n > 0; --n) {
+                (*this)();
+            }
+        }
+
+        // equivalent to 2^128 calls to operator()
+        void jump() {
+            static const std::uint64_t polynomial[] = {
+                0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+            this->apply_jump(polynomial);
+        }
+
+        // equivalent to 2^192 calls to operator()
+        void long_jump() {
+            static const std::uint64_t polynomial[] = {
+                0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+                0x77710069854ee241ULL, 0x39109bb02acbe635ULL };
+            this->apply_jump(polynomial);
+        }
+
+        bool operator==(const Xoshiro256StarStar & other) const {
+            return this->state_[0] == other.state_[0]
+                && this->state_[1] == other.state_[1]
+                && this->state_[2] == other.state_[2]
+                && this->state_[3] == other.state_[3];
+        }
+        bool operator!=(const Xoshiro256StarStar & other) const {
+            return !(*this == other);
+        }
+
+    private:
+        static inline std::uint64_t rotl(std::uint64_t x, int k) {
+            return (x << k) | (x >> (64 - k));
+        }
+
+        void apply_jump(const std::uint64_t * polynomial) {
+            std::uint64_t s[4] = {0, 0, 0, 0};
+            for (unsigned int i = 0; i < 4; ++i) {
+                for (unsigned int b = 0; b < 64; ++b) {
+                    if (polynomial[i] & (std::uint64_t(1) << b)) {
+                        for (unsigned int j = 0; j < 4; ++j) {
+                            s[j] ^= this->state_[j];
+                        }
+                    }
+                    (*this)();
+                }
+            }
+            for (unsigned int j = 0; j < 4; ++j) {
+                this->state_[j] = s[j];
+            }
+        }
+
+    private:
+        std::uint64_t state_[4];
+
+}; // Xoshiro256StarStar
+
+////////////////////////////////////////////////////////////////////////////////
+// Philox4x32
+
+/**
+ * The Philox4x32-10 counter-based engine of Salmon et al. (2011), as in the
+ * Random123 library. Rather than evolving a state, each block of four
+ * 32-bit outputs is a keyed bijection of a 128-bit counter, so that:
+ *
+ *  - the key (set from the seed) and the high 64 bits of the counter (the
+ *    stream index, see ``set_stream()``) select one of 2^64 independent
+ *    streams per seed, each of 2^65 64-bit values, with no state
+ *    derivation needed: the output of stream ``i`` depends only on the
+ *    seed and ``i``;
+ *  - ``discard()`` takes constant time, so that any position in a stream
+ *    can be reached directly.
+ *
+ * Meets the requirements of a standard random number engine, with 64-bit
+ * output (each block yields two values).
+ */
+class Philox4x32 {
+
+    public:
+        typedef std::uint64_t result_type;
+
+        static constexpr result_type default_seed = 5489u;
+
+        static constexpr result_type min() {
+            return 0;
+        }
+        static constexpr result_type max() {
+            return std::numeric_limits<result_type>::max();
+        }
+
+        /**
+         * Applies the Philox4x32-10 bijection keyed by ``key`` to
+         * ``counter``, writing the result to ``out``.
+         */
+        static void generate_block(const std::uint32_t * counter,
+                const std::uint32_t * key,
+                std::uint32_t * out) {
+            std::uint32_t c0 = counter[0];
+            std::uint32_t c1 = counter[1];
+            std::uint32_t c2 = counter[2];
+            std::uint32_t c3 = counter[3];
+            std::uint32_t k0 = key[0];
+            std::uint32_t k1 = key[1];
+            for (unsigned int round = 0; round < 10; ++round) {
+                if (round > 0) {
+                    k0 += 0x9E3779B9U;
+                    k1 += 0xBB67AE85U;
+                }
+                std::uint64_t p0 = static_cast<std::uint64_t>(0xD2511F53U) * c0;
+                std::uint64_t p1 = static_cast<std::uint64_t>(0xCD9E8D57U) * c2;
+                std::uint32_t hi0 = static_cast<std::uint32_t>(p0 >> 32);
+                std::uint32_t lo0 = static_cast<std::uint32_t>(p0);
+                std::uint32_t hi1 = static_cast<std::uint32_t>(p1 >> 32);
+                std::uint32_t lo1 = static_cast<std::uint32_t>(p1);
+                c0 = hi1 ^ c1 ^ k0;
+                c1 = lo1;
+                c2 = hi0 ^ c3 ^ k1;
+                c3 = lo0;
+            }
+            out[0] = c0;
+            out[1] = c1;
+            out[2] = c2;
+            out[3] = c3;
+        }
+
+    public:
+        Philox4x32() {
+            this->seed(default_seed);
+        }
+        explicit Philox4x32(result_type seed_value, std::uint64_t stream_idx=0) {
+            this->seed(seed_value);
+            this->set_stream(stream_idx);
+        }
+
+        // sets the key, and rewinds to the start of the current stream
+        void seed(result_type seed_value=default_seed) {
+            this->key_[0] = static_cast<std::uint32_t>(seed_value);
+            this->key_[1] = static_cast<std::uint32_t>(seed_value >> 32);
+            this->set_position(0);
+        }
+
+        // selects the stream ``stream_idx``, and rewinds to its start
+        void set_stream(std::uint64_t stream_idx) {
+            this->stream_idx_ = stream_idx;
+            this->set_position(0);
+        }
+        std::uint64_t get_stream() const {
+            return this->stream_idx_;
+        }
+
+        // the number of values drawn from the current stream (modulo 2^64)
+        std::uint64_t get_position() const {
+            return 2 * this->block_idx_ - (this->output_idx_ < 2 ? 2 - this->output_idx_ : 0);
+        }
+        void set_position(std::uint64_t position) {
+            this->block_idx_ = position / 2;
+            this->output_idx_ = 2;
+            if (position % 2 != 0) {
+                this->refill();
+                this->output_idx_ = 1;
+            }
+        }
+
+        inline result_type operator()() {
+            if (this->output_idx_ == 2) {
+                this->refill();
+            }
+            return this->outputs_[this->output_idx_++];
+        }
+
+        void discard(unsigned long long n) {
+            this->set_position(this->get_position() + n);
+        }
+
+        bool operator==(const Philox4x32 & other) const {
+            return this->key_[0] == other.key_[0]
+                && this->key_[1] == other.key_[1]
+                && this->stream_idx_ == other.stream_idx_
+                && this->get_position() == other.get_position();
+        }
+        bool operator!=(const Philox4x32 & other) const {
+            return !(*this == other);
+        }
+
+    private:
+        void refill() {
+            std::uint32_t counter[4] = {
+                static_cast<std::uint32_t>(this->block_idx_),
+                static_cast<std::uint32_t>(this->block_idx_ >> 32),
+                static_cast<std::uint32_t>(this->stream_idx_),
+                static_cast<std::uint32_t>(this->stream_idx_ >> 32) };
+            std::uint32_t out[4];
+            generate_block(counter, this->key_, out);
+            this->outputs_[0] = static_cast<std::uint64_t>(out[0]) | (static_cast<std::uint64_t>(out[1]) << 32);
+            this->outputs_[1] = static_cast<std::uint64_t>(out[2]) | (static_cast<std::uint64_t>(out[3]) << 32);
+            ++this->block_idx_;
+            this->output_idx_ = 0;
+        }
+
+    private:
+        std::uint32_t   key_[2];
+        std::uint64_t   stream_idx_;
+        // index of the next block to be generated
+        std::uint64_t   block_idx_;
+        std::uint64_t   outputs_[2];
+        // index of the next value in outputs_ (2: none left)
+        unsigned int    output_idx_;
+
+}; // Philox4x32
+
 ////////////////////////////////////////////////////////////////////////////////
 // RandomNumberGeneratorTemplate
 
@@ -46,6 +340,14 @@ namespace numeric {
  *      RandomNumberGeneratorTemplate<std::ranlux24>          rng_ranlux24;
  *      RandomNumberGeneratorTemplate<std::ranlux48>          rng_ranlux48;
  *      RandomNumberGeneratorTemplate<std::knuth_b>           rng_knuth_b;
+ *      RandomNumberGeneratorTemplate<Xoshiro256StarStar>     rng_xoshiro;
+ *      RandomNumberGeneratorTemplate<Philox4x32>             rng_philox;
+ *
+ * For engines that produce full-range 64-bit output (std::mt19937_64,
+ * Xoshiro256StarStar and Philox4x32), bounded integers are drawn using Lemire's
+ * multiply-and-shift method, which needs a division only on (rare)
+ * rejection, and reals by scaling the top 53 bits of a single draw, rather
+ * than through the <random> distribution objects.
  *
  * @tparam EngineT
  *   One of:
@@ -58,6 +360,9 @@ namespace numeric {
  *       std::ranlux24
  *       std::ranlux48
  *       std::knuth_b
+ *       platypus::numeric::Xoshiro256StarStar
+ *       platypus::numeric::Philox4x32
+ *   or any other standard random number engine.
  */
 template <typename EngineT=std::mt19937_64>
 class RandomNumberGeneratorTemplate {
@@ -71,12 +376,12 @@ class RandomNumberGeneratorTemplate {
             this->set_seed_from_time();
         }
         RandomNumberGeneratorTemplate(RandomSeedType rng_seed) {
-            this->set_seed_(rng_seed);
+            this->set_seed(rng_seed);
         }
         ~RandomNumberGeneratorTemplate() {};
 
         RandomSeedType get_seed() const {
-            return this->engine_;
+            return this->seed_;
         }
 
         void set_seed(typename EngineT::result_type seed) {
@@ -93,34 +398,70 @@ class RandomNumberGeneratorTemplate {
             this->set_seed(rd());
         }
 
+        // underlying engine, e.g. for use with distributions not wrapped here
+        EngineT & engine() {
+            return this->engine_;
+        }
+
+        // advances the engine as by EngineT::jump() (only available if the
+        // engine supports it, e.g. Xoshiro256StarStar), so that generators
+        // copied from this one and jumped 0, 1, 2, ... times give
+        // non-overlapping streams
+        void jump() {
+            this->engine_.jump();
+        }
+
+        // selects stream ``stream_idx`` of a counter-based engine (only
+        // available if the engine supports it, e.g. Philox4x32)
+        void set_stream(std::uint64_t stream_idx) {
+            this->engine_.set_stream(stream_idx);
+        }
+
         // returns integer value uniformly distributed in [a, b]
         inline long uniform_int(long a, long b) {
-            return this->uniform_int_(this->engine_,
-                    typename decltype(this->uniform_int_rng_)::param_type (a, b));
+            return this->uniform_int_rng(a, b, has_full_64_bit_output());
         }
 
         // returns integer value uniformly distributed in [0, b], where a >= 0.
         inline unsigned long uniform_pos_int(unsigned long b) {
-            return this->uniform_pos_int_rng_(this->engine_,
-                    typename decltype(this->uniform_pos_int_rng_)::param_type (0, b));
+            return this->uniform_pos_int_rng(0, b, has_full_64_bit_output());
         }
 
         // returns integer value uniformly distributed in [a, b], where a >= 0
         inline unsigned long uniform_pos_int(unsigned long a, unsigned long b) {
-            return this->uniform_pos_int_rng_(this->engine_,
-                    typename decltype(this->uniform_pos_int_rng_)::param_type (a, b));
+            return this->uniform_pos_int_rng(a, b, has_full_64_bit_output());
         }
 
-        // returns real value uniformly distributed in [0, 1]
+        // returns real value uniformly distributed in [0, 1)
         inline double uniform_real() {
-            return this->uniform_real_rng_(this->engine_,
-                    typename decltype(this->uniform_real_rng_)::param_type (0.0, 1.0));
+            return this->uniform_real_rng(has_full_64_bit_output());
         }
 
-        // // returns real value uniformly distributed in [a, b]
+        // // returns real value uniformly distributed in [a, b)
         inline double uniform_real(double a, double b) {
-            return this->uniform_real_rng_(this->engine_,
-                    typename decltype(this->uniform_real_rng_)::param_type (a, b));
+            return a + (b - a) * this->uniform_real();
+        }
+
+        // fills ``values[0..n)`` with reals uniformly distributed in [0, 1)
+        void fill_uniform(double * values, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) {
+                values[i] = this->uniform_real();
+            }
+        }
+
+        // fills ``values[0..n)`` with exponential variates with rate
+        // parameter ``p``; uniform deviates are drawn for the whole range
+        // first, and then transformed in a second pass that does not touch
+        // the engine (and so can be vectorized)
+        void fill_exponential(double * values, std::size_t n, double p) {
+            if (p == 0) {
+                std::fill(values, values + n, 0.0);
+                return;
+            }
+            this->fill_uniform(values, n);
+            for (std::size_t i = 0; i < n; ++i) {
+                values[i] = -std::log(1.0 - values[i]) / p;
+            }
         }
 
         // returns an integer in {0, 1} sampled from a Bernoulli distribution with probability of 1
@@ -167,6 +508,77 @@ class RandomNumberGeneratorTemplate {
                     typename decltype(this->poisson_rng_)::param_type (mu));
         }
 
+    private:
+        typedef std::integral_constant<bool,
+                EngineT::min() == 0
+                && EngineT::max() == std::numeric_limits<std::uint64_t>::max()> has_full_64_bit_output;
+
+        // returns integer value uniformly distributed in [0, range), for
+        // range > 0, by Lemire's method: the high word of draw * range is
+        // uniform over [0, range) once draws whose low word falls below
+        // 2^64 mod range are rejected
+        inline std::uint64_t bounded_uint64(std::uint64_t range) {
+            std::uint64_t high;
+            std::uint64_t low = multiply_64x64(this->engine_(), range, high);
+            if (low < range) {
+                const std::uint64_t threshold = (0 - range) % range;
+                while (low < threshold) {
+                    low = multiply_64x64(this->engine_(), range, high);
+                }
+            }
+            return high;
+        }
+
+        // returns the low word of the 128-bit product of a and b, and sets
+        // high to the high word
+        static inline std::uint64_t multiply_64x64(std::uint64_t a, std::uint64_t b, std::uint64_t & high) {
+#if defined(__SIZEOF_INT128__)
+            unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+            high = static_cast<std::uint64_t>(product >> 64);
+            return static_cast<std::uint64_t>(product);
+#else
+            std::uint64_t a_lo = a & 0xFFFFFFFFULL;
+            std::uint64_t a_hi = a >> 32;
+            std::uint64_t b_lo = b & 0xFFFFFFFFULL;
+            std::uint64_t b_hi = b >> 32;
+            std::uint64_t lo_lo = a_lo * b_lo;
+            std::uint64_t hi_lo = a_hi * b_lo;
+            std::uint64_t lo_hi = a_lo * b_hi;
+            std::uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFULL) + lo_hi;
+            high = a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+            return (cross << 32) | (lo_lo & 0xFFFFFFFFULL);
+#endif
+        }
+
+        inline unsigned long uniform_pos_int_rng(unsigned long a, unsigned long b, std::true_type) {
+            std::uint64_t range = static_cast<std::uint64_t>(b - a) + 1;
+            if (range == 0) {
+                return static_cast<unsigned long>(this->engine_());
+            }
+            return a + static_cast<unsigned long>(this->bounded_uint64(range));
+        }
+        inline unsigned long uniform_pos_int_rng(unsigned long a, unsigned long b, std::false_type) {
+            return this->uniform_pos_int_rng_(this->engine_,
+                    typename decltype(this->uniform_pos_int_rng_)::param_type (a, b));
+        }
+
+        inline long uniform_int_rng(long a, long b, std::true_type) {
+            std::uint64_t range = static_cast<std::uint64_t>(b) - static_cast<std::uint64_t>(a) + 1;
+            std::uint64_t offset = range == 0 ? this->engine_() : this->bounded_uint64(range);
+            return static_cast<long>(static_cast<std::uint64_t>(a) + offset);
+        }
+        inline long uniform_int_rng(long a, long b, std::false_type) {
+            return this->uniform_int_rng_(this->engine_,
+                    typename decltype(this->uniform_int_rng_)::param_type (a, b));
+        }
+
+        inline double uniform_real_rng(std::true_type) {
+            return static_cast<double>(this->engine_() >> 11) * (1.0 / 9007199254740992.0);
+        }
+        inline double uniform_real_rng(std::false_type) {
+            return this->uniform_real_rng_(this->engine_);
+        }
+
     private:
         RandomSeedType                                          seed_;
         EngineT                                                 engine_;
@@ -189,8 +601,229 @@ class RandomNumberGeneratorTemplate {
  * Default random number generator engine.
  */
 class RandomNumberGenerator : public RandomNumberGeneratorTemplate<std::mt19937_64> {
+    public:
+        RandomNumberGenerator() { }
+        RandomNumberGenerator(RandomSeedType rng_seed)
+            : RandomNumberGeneratorTemplate<std::mt19937_64>(rng_seed) { }
 }; // RandomNumberGenerator
 
+////////////////////////////////////////////////////////////////////////////////
+// FastRandomNumberGenerator
+
+/**
+ * Random number generator using the Xoshiro256StarStar engine, which is
+ * faster than the default and supports jump() for parallel streams.
+ */
+class FastRandomNumberGenerator : public RandomNumberGeneratorTemplate<Xoshiro256StarStar> {
+    public:
+        FastRandomNumberGenerator() { }
+        FastRandomNumberGenerator(RandomSeedType rng_seed)
+            : RandomNumberGeneratorTemplate<Xoshiro256StarStar>(rng_seed) { }
+}; // FastRandomNumberGenerator
+
+////////////////////////////////////////////////////////////////////////////////
+// CounterRandomNumberGenerator
+
+/**
+ * Random number generator using the counter-based Philox4x32 engine: the
+ * values drawn from stream ``stream_idx`` depend only on the seed and on
+ * ``stream_idx``.
+ */
+class CounterRandomNumberGenerator : public RandomNumberGeneratorTemplate<Philox4x32> {
+    public:
+        CounterRandomNumberGenerator() { }
+        CounterRandomNumberGenerator(RandomSeedType rng_seed, std::uint64_t stream_idx=0)
+            : RandomNumberGeneratorTemplate<Philox4x32>(rng_seed) {
+            this->set_stream(stream_idx);
+        }
+}; // CounterRandomNumberGenerator
+
+////////////////////////////////////////////////////////////////////////////////
+// Replicate generators
+
+/**
+ * Creates the random number generator for replicate ``replicate_idx`` of a
+ * batch simulation with seed ``master_seed``, such that its output depends
+ * only on the pair: by default, seeded with derive_seed(``master_seed``,
+ * ``replicate_idx``). Specialized for CounterRandomNumberGenerator to
+ * select the stream ``replicate_idx`` of the key ``master_seed`` instead,
+ * which guarantees that the streams of different replicates do not
+ * overlap.
+ */
+template <typename RngT>
+struct ReplicateRandomNumberGenerator {
+    static RngT create(std::uint64_t master_seed, std::uint64_t replicate_idx) {
+        return RngT(static_cast<typename RngT::RandomSeedType>(derive_seed(master_seed, replicate_idx)));
+    }
+};
+
+template <>
+struct ReplicateRandomNumberGenerator<CounterRandomNumberGenerator> {
+    static CounterRandomNumberGenerator create(std::uint64_t master_seed, std::uint64_t replicate_idx) {
+        return CounterRandomNumberGenerator(master_seed, replicate_idx);
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// ExponentialVariateBuffer
+
+/**
+ * Draws exponential random variates in blocks.
+ *
+ * Uniform deviates are pulled from the engine of a
+ * RandomNumberGeneratorTemplate object for a whole block at a time and then
+ * transformed to standard exponential deviates in a separate pass, which
+ * does not touch the engine and so can be vectorized by the compiler. Each
+ * call to exponential() then costs only a division.
+ *
+ * The sequence of values returned does not depend on the block size, and
+ * (using the GNU C++ standard library) is identical to that of successive
+ * calls to the `exponential()` method of a generator seeded with the same
+ * value. As blocks are drawn ahead of demand, however, the generator should
+ * be dedicated to this buffer: other draws from it will consume values in
+ * between blocks and change the sequence.
+ *
+ * @tparam RngT
+ *   A RandomNumberGeneratorTemplate specialization (or derived class).
+ */
+template <typename RngT>
+class ExponentialVariateBuffer {
+
+    public:
+        ExponentialVariateBuffer(RngT & rng, std::size_t block_size=256)
+            : rng_(rng)
+            , block_(block_size > 0 ? block_size : 1)
+            , position_(block_.size()) { }
+
+        // returns a random variate from an exponential distribution with rate parameter p
+        inline double exponential(double p) {
+            if (p == 0) {
+                return 0.0;
+            }
+            if (this->position_ == this->block_.size()) {
+                this->refill();
+            }
+            return this->block_[this->position_++] / p;
+        }
+
+        std::size_t block_size() const {
+            return this->block_.size();
+        }
+
+    private:
+        void refill() {
+            auto & engine = this->rng_.engine();
+            std::size_t n = this->block_.size();
+            double * block = this->block_.data();
+            for (std::size_t i = 0; i < n; ++i) {
+                block[i] = std::generate_canonical<double, std::numeric_limits<double>::digits>(engine);
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                block[i] = -std::log(1.0 - block[i]);
+            }
+            this->position_ = 0;
+        }
+
+    private:
+        RngT &                  rng_;
+        std::vector<double>     block_;
+        std::size_t             position_;
+
+}; // ExponentialVariateBuffer
+
+////////////////////////////////////////////////////////////////////////////////
+// AliasTable
+
+/**
+ * Samples indexes in [0, ``size()``) with probabilities proportional to a
+ * set of weights, in constant time per draw, using Walker's alias method (as
+ * built by Vose's algorithm, in time linear in the number of weights).
+ *
+ * Each draw takes a single uniform deviate from the generator: its integral
+ * part (scaled by the number of weights) picks a column, and its fractional
+ * part decides between the column and its alias.
+ */
+class AliasTable {
+
+    public:
+        AliasTable() { }
+
+        template <typename IterT>
+        AliasTable(IterT weights_begin, IterT weights_end) {
+            this->assign(weights_begin, weights_end);
+        }
+
+        /**
+         * Rebuilds the table from the weights in [``weights_begin``,
+         * ``weights_end``), which must be non-negative and finite, with at
+         * least one positive.
+         */
+        template <typename IterT>
+        void assign(IterT weights_begin, IterT weights_end) {
+            this->probabilities_.assign(weights_begin, weights_end);
+            std::size_t n = this->probabilities_.size();
+            double total = 0.0;
+            for (double weight : this->probabilities_) {
+                if (!(weight >= 0.0) || !std::isfinite(weight)) {
+                    throw std::invalid_argument("platypus::numeric::AliasTable: weights must be non-negative and finite");
+                }
+                total += weight;
+            }
+            if (!(total > 0.0)) {
+                throw std::invalid_argument("platypus::numeric::AliasTable: at least one weight must be positive");
+            }
+            this->aliases_.resize(n);
+            std::vector<std::size_t> small;
+            std::vector<std::size_t> large;
+            for (std::size_t idx = 0; idx < n; ++idx) {
+                this->probabilities_[idx] *= n / total;
+                this->aliases_[idx] = idx;
+                (this->probabilities_[idx] < 1.0 ? small : large).push_back(idx);
+            }
+            while (!small.empty() && !large.empty()) {
+                std::size_t less = small.back();
+                small.pop_back();
+                std::size_t more = large.back();
+                this->aliases_[less] = more;
+                this->probabilities_[more] -= 1.0 - this->probabilities_[less];
+                if (this->probabilities_[more] < 1.0) {
+                    large.pop_back();
+                    small.push_back(more);
+                }
+            }
+            // what remains is (up to rounding) exactly 1
+            for (std::size_t idx : small) {
+                this->probabilities_[idx] = 1.0;
+            }
+            for (std::size_t idx : large) {
+                this->probabilities_[idx] = 1.0;
+            }
+        }
+
+        std::size_t size() const {
+            return this->probabilities_.size();
+        }
+
+        bool empty() const {
+            return this->probabilities_.empty();
+        }
+
+        template <typename RngT>
+        inline std::size_t sample(RngT & rng) const {
+            double u = rng.uniform_real() * this->probabilities_.size();
+            std::size_t idx = static_cast<std::size_t>(u);
+            if (idx >= this->probabilities_.size()) {
+                idx = this->probabilities_.size() - 1;
+            }
+            return u - idx < this->probabilities_[idx] ? idx : this->aliases_[idx];
+        }
+
+    private:
+        std::vector<double>         probabilities_;
+        std::vector<std::size_t>    aliases_;
+
+}; // AliasTable
+
 } // namespace numeric
 } // namespace platypus
 
@@ -0,0 +1,222 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Incremental summary statistics.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_NUMERIC_STATISTICS_HPP
+#define PLATYPUS_NUMERIC_STATISTICS_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+
+namespace platypus {
+namespace numeric {
+
+////////////////////////////////////////////////////////////////////////////////
+// RunningStatistics
+
+/**
+ * Accumulates the size, sum, mean, variance, minimum and maximum of a
+ * sequence of values in a single pass, in constant space.
+ *
+ * The mean and sum of squared deviations are updated with Welford's method,
+ * which does not suffer the cancellation of the textbook "sum of squares
+ * minus square of sum" formula. Two accumulators over disjoint sets of values
+ * can be combined with merge() (Chan et al.'s pairwise update), so that
+ * partial summaries can be computed in parallel, or kept up to date as
+ * values arrive, and combined afterwards.
+ *
+ * If compensated summation is requested, the running sum is accumulated
+ * with the Kahan-Babuska-Neumaier algorithm, which keeps the rounding error
+ * of the total independent of the number of values added.
+ *
+ * @tparam T
+ *   Floating-point type in which statistics are accumulated.
+ */
+template <class T=long double>
+class RunningStatistics {
+
+    public:
+        typedef T value_type;
+
+    public:
+        RunningStatistics(bool use_compensated_sum=false)
+            : use_compensated_sum_(use_compensated_sum)
+            , size_(0)
+            , sum_(0)
+            , sum_compensation_(0)
+            , mean_(0)
+            , sum_of_squared_deviations_(0)
+            , minimum_(0)
+            , maximum_(0) { }
+
+        void clear() {
+            this->size_ = 0;
+            this->sum_ = 0;
+            this->sum_compensation_ = 0;
+            this->mean_ = 0;
+            this->sum_of_squared_deviations_ = 0;
+            this->minimum_ = 0;
+            this->maximum_ = 0;
+        }
+
+        inline void add(T x) {
+            ++this->size_;
+            if (this->size_ == 1) {
+                this->minimum_ = x;
+                this->maximum_ = x;
+            } else if (x < this->minimum_) {
+                this->minimum_ = x;
+            } else if (x > this->maximum_) {
+                this->maximum_ = x;
+            }
+            this->add_to_sum(x);
+            T delta = x - this->mean_;
+            this->mean_ += delta / static_cast<T>(this->size_);
+            this->sum_of_squared_deviations_ += delta * (x - this->mean_);
+        }
+
+        inline void operator()(T x) {
+            this->add(x);
+        }
+
+        /**
+         * Combines the statistics of ``other``, calculated over a separate
+         * set of values, into this one.
+         */
+        void merge(const RunningStatistics & other) {
+            if (other.size_ == 0) {
+                return;
+            }
+            if (this->size_ == 0) {
+                bool use_compensated_sum = this->use_compensated_sum_;
+                *this = other;
+                this->use_compensated_sum_ = use_compensated_sum;
+                return;
+            }
+            T na = static_cast<T>(this->size_);
+            T nb = static_cast<T>(other.size_);
+            T n = na + nb;
+            T delta = other.mean_ - this->mean_;
+            this->mean_ += delta * (nb / n);
+            this->sum_of_squared_deviations_ += other.sum_of_squared_deviations_ + delta * delta * (na * nb / n);
+            this->add_to_sum(other.sum_);
+            this->sum_compensation_ += other.sum_compensation_;
+            if (other.minimum_ < this->minimum_) {
+                this->minimum_ = other.minimum_;
+            }
+            if (other.maximum_ > this->maximum_) {
+                this->maximum_ = other.maximum_;
+            }
+            this->size_ += other.size_;
+        }
+
+        /**
+         * Partial state (see platypus::PartialStateWriter), so that
+         * statistics accumulated by separate processes can be merged
+         * exactly as by merge().
+         */
+        static std::string partial_state_kind() {
+            return "RunningStatistics";
+        }
+
+        template <class WriterT>
+        void write_state(WriterT & writer) const {
+            writer.write_u64(this->size_);
+            writer.write_real(this->sum_);
+            writer.write_real(this->sum_compensation_);
+            writer.write_real(this->mean_);
+            writer.write_real(this->sum_of_squared_deviations_);
+            writer.write_real(this->minimum_);
+            writer.write_real(this->maximum_);
+        }
+
+        template <class ReaderT>
+        void merge_state(ReaderT & reader) {
+            RunningStatistics other(this->use_compensated_sum_);
+            other.size_ = static_cast<std::size_t>(reader.read_u64());
+            other.sum_ = reader.template read_real<T>();
+            other.sum_compensation_ = reader.template read_real<T>();
+            other.mean_ = reader.template read_real<T>();
+            other.sum_of_squared_deviations_ = reader.template read_real<T>();
+            other.minimum_ = reader.template read_real<T>();
+            other.maximum_ = reader.template read_real<T>();
+            this->merge(other);
+        }
+
+        inline bool get_use_compensated_sum() const {
+            return this->use_compensated_sum_;
+        }
+        inline std::size_t size() const {
+            return this->size_;
+        }
+        inline T sum() const {
+            return this->sum_ + this->sum_compensation_;
+        }
+        inline T mean() const {
+            return this->mean_;
+        }
+        inline T minimum() const {
+            return this->minimum_;
+        }
+        inline T maximum() const {
+            return this->maximum_;
+        }
+        inline T sum_of_squared_deviations() const {
+            return this->sum_of_squared_deviations_;
+        }
+        inline T sample_variance() const {
+            return this->size_ > 1 ? this->sum_of_squared_deviations_ / static_cast<T>(this->size_ - 1) : T(0);
+        }
+        inline T population_variance() const {
+            return this->size_ > 1 ? this->sum_of_squared_deviations_ / static_cast<T>(this->size_) : T(0);
+        }
+
+    private:
+        inline void add_to_sum(T x) {
+            if (!this->use_compensated_sum_) {
+                this->sum_ += x;
+                return;
+            }
+            T t = this->sum_ + x;
+            if (std::fabs(this->sum_) >= std::fabs(x)) {
+                this->sum_compensation_ += (this->sum_ - t) + x;
+            } else {
+                this->sum_compensation_ += (x - t) + this->sum_;
+            }
+            this->sum_ = t;
+        }
+
+    private:
+        bool            use_compensated_sum_;
+        std::size_t     size_;
+        T               sum_;
+        T               sum_compensation_;
+        T               mean_;
+        T               sum_of_squared_deviations_;
+        T               minimum_;
+        T               maximum_;
+
+}; // RunningStatistics
+
+} // namespace numeric
+} // namespace platypus
+
+#endif
@@ -0,0 +1,392 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Reading of trees in the platypus binary container format.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_PARSE_BINARY_HPP
+#define PLATYPUS_PARSE_BINARY_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "../base/base_reader.hpp"
+#include "../utility/binaryformat.hpp"
+#include "../utility/mappedfile.hpp"
+#include "../utility/tokenizer.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// BinaryTreeReaderError
+
+/**
+ * Exception thrown when a binary tree container is malformed.
+ */
+class BinaryTreeReaderError : public ReaderException {
+    public:
+        BinaryTreeReaderError(
+                    const std::string & filename,
+                    unsigned long line_num,
+                    const std::string & message)
+            : ReaderException(filename, line_num, message) { }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// BinaryTreeArchive
+
+/**
+ * Index of a binary tree container (see platypus::binary_format) held in
+ * memory: the label table and tree offsets read from its footer. The
+ * container is not copied, and must outlive the archive.
+ */
+class BinaryTreeArchive {
+
+    public:
+
+        BinaryTreeArchive(const char * data, std::size_t size)
+            : data_(data)
+            , size_(size) {
+            if (size < binary_format::HEADER_SIZE + binary_format::TRAILER_SIZE
+                    || std::memcmp(data, binary_format::HEADER_MAGIC, 4) != 0
+                    || std::memcmp(data + size - 4, binary_format::TRAILER_MAGIC, 4) != 0) {
+                throw BinaryTreeReaderError(__FILE__, __LINE__, "platypus::BinaryTreeArchive: not a binary tree container");
+            }
+            if (binary_format::decode_u32(data + 4) != binary_format::VERSION) {
+                throw BinaryTreeReaderError(__FILE__, __LINE__, "platypus::BinaryTreeArchive: unsupported version");
+            }
+            std::uint64_t footer_offset = binary_format::decode_u64(data + size - binary_format::TRAILER_SIZE);
+            std::size_t footer_end = size - binary_format::TRAILER_SIZE;
+            if (footer_offset < binary_format::HEADER_SIZE || footer_offset > footer_end) {
+                throw BinaryTreeReaderError(__FILE__, __LINE__, "platypus::BinaryTreeArchive: invalid footer offset");
+            }
+            this->footer_offset_ = static_cast<std::size_t>(footer_offset);
+            const char * pos = data + this->footer_offset_;
+            const char * end = data + footer_end;
+            std::uint32_t num_labels = read_u32(pos, end);
+            this->labels_.reserve(num_labels);
+            for (std::uint32_t idx = 0; idx < num_labels; ++idx) {
+                std::uint32_t label_size = read_u32(pos, end);
+                require(pos, end, label_size);
+                this->labels_.push_back(TokenView(pos, label_size));
+                pos += label_size;
+            }
+            require(pos, end, 8);
+            std::uint64_t num_trees = binary_format::decode_u64(pos);
+            pos += 8;
+            if (num_trees > static_cast<std::uint64_t>(end - pos) / 8) {
+                throw BinaryTreeReaderError(__FILE__, __LINE__, "platypus::BinaryTreeArchive: truncated footer");
+            }
+            this->tree_offsets_.reserve(static_cast<std::size_t>(num_trees));
+            for (std::uint64_t idx = 0; idx < num_trees; ++idx) {
+                std::uint64_t offset = binary_format::decode_u64(pos);
+                if (offset < binary_format::HEADER_SIZE || offset >= this->footer_offset_) {
+                    throw BinaryTreeReaderError(__FILE__, __LINE__, "platypus::BinaryTreeArchive: invalid tree offset");
+                }
+                this->tree_offsets_.push_back(static_cast<std::size_t>(offset));
+                pos += 8;
+            }
+        }
+
+        inline const char * data() const {
+            return this->data_;
+        }
+        inline std::size_t size() const {
+            return this->size_;
+        }
+
+        inline std::size_t num_trees() const {
+            return this->tree_offsets_.size();
+        }
+
+        // Offset of the record of tree ``tree_idx`` from the start of the
+        // container.
+        inline std::size_t get_tree_offset(std::size_t tree_idx) const {
+            return this->tree_offsets_[tree_idx];
+        }
+
+        // Offset of the footer, i.e. the end of the tree records.
+        inline std::size_t get_footer_offset() const {
+            return this->footer_offset_;
+        }
+
+        inline std::size_t num_labels() const {
+            return this->labels_.size();
+        }
+
+        // View into the container of label ``label_idx``.
+        inline const TokenView & get_label(std::size_t label_idx) const {
+            return this->labels_[label_idx];
+        }
+
+    private:
+
+        static void require(const char * pos, const char * end, std::size_t size) {
+            if (static_cast<std::size_t>(end - pos) < size) {
+                throw BinaryTreeReaderError(__FILE__, __LINE__, "platypus::BinaryTreeArchive: truncated footer");
+            }
+        }
+
+        static std::uint32_t read_u32(const char * & pos, const char * end) {
+            require(pos, end, 4);
+            std::uint32_t value = binary_format::decode_u32(pos);
+            pos += 4;
+            return value;
+        }
+
+    private:
+        const char *                data_;
+        std::size_t                 size_;
+        std::size_t                 footer_offset_;
+        std::vector<TokenView>      labels_;
+        std::vector<std::size_t>    tree_offsets_;
+
+}; // BinaryTreeArchive
+
+////////////////////////////////////////////////////////////////////////////////
+// BinaryTreeReader
+
+/**
+ * Reads trees from binary containers written by platypus::BinaryTreeWriter.
+ * Trees are built straight from the preorder child counts, label indexes
+ * and edge lengths of each record, without any tokenizing.
+ *
+ * As well as the sequential interface of BaseTreeReader (which reads
+ * a stream into memory before reading the trees), containers can be read
+ * in place from memory or a memory-mapped file, and individual trees can
+ * be read by index through a BinaryTreeArchive (see read_tree()).
+ */
+template <typename TreeT, typename EdgeLengthT=double>
+class BinaryTreeReader : public BaseTreeReader<TreeT, EdgeLengthT> {
+
+    public:
+        typedef TreeT                          tree_type;
+        typedef typename tree_type::node_type  tree_node_type;
+        typedef typename tree_type::value_type tree_value_type;
+
+    public:
+
+        BinaryTreeReader()
+            : BaseTreeReader<TreeT, EdgeLengthT>() {
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Buffer reading interface
+
+        /**
+         * Reads the trees of the container in the ``size`` bytes starting at
+         * ``data``, subject to BaseTreeReader::set_skip_first(),
+         * BaseTreeReader::set_every_nth() and ``tree_limit``.
+         *
+         * @return
+         *   The number of trees read.
+         */
+        unsigned long read_buffer(
+                const char * data,
+                std::size_t size,
+                const std::function<TreeT & ()> & get_new_tree_reference,
+                unsigned long tree_limit=0) {
+            BinaryTreeArchive archive(data, size);
+            this->stats_.record_bytes_read(size);
+            // taxa of leaf labels, looked up once per container
+            std::vector<TaxonNamespace::index_type> label_taxa;
+            if (this->has_taxon_namespace()) {
+                label_taxa.resize(archive.num_labels(), TaxonNamespace::index_type(TaxonNamespace::npos));
+            }
+            unsigned long tree_count = 0;
+            for (std::size_t tree_idx = 0; tree_idx < archive.num_trees(); ++tree_idx) {
+                if (this->is_statement_skipped(tree_idx)) {
+                    continue;
+                }
+                auto & tree = get_new_tree_reference();
+                this->build_tree(archive, tree_idx, tree, tree_count, label_taxa);
+                ++tree_count;
+                if (tree_limit > 0 && tree_count >= tree_limit) {
+                    break;
+                }
+            }
+            return tree_count;
+        }
+
+        unsigned long read_buffer(
+                const std::string & src,
+                const std::function<TreeT & ()> & get_new_tree_reference,
+                unsigned long tree_limit=0) {
+            return this->read_buffer(src.data(), src.size(), get_new_tree_reference, tree_limit);
+        }
+
+        // Reads the container in the file at ``path``, which is memory-mapped
+        // (see platypus::MappedFile).
+        unsigned long read_file(
+                const std::string & path,
+                const std::function<TreeT & ()> & get_new_tree_reference,
+                unsigned long tree_limit=0) {
+            MappedFile src(path);
+            return this->read_buffer(src.data(), src.size(), get_new_tree_reference, tree_limit);
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Random access
+
+        /**
+         * Builds tree ``tree_idx`` of ``archive`` into ``tree`` (which should
+         * be empty), and post-processes it with ``tree_idx`` as its index.
+         * The skip and thinning settings do not apply.
+         */
+        void read_tree(const BinaryTreeArchive & archive, std::size_t tree_idx, TreeT & tree) {
+            if (tree_idx >= archive.num_trees()) {
+                throw BinaryTreeReaderError(__FILE__, __LINE__, "platypus::BinaryTreeReader: tree index out of range");
+            }
+            std::vector<TaxonNamespace::index_type> label_taxa;
+            if (this->has_taxon_namespace()) {
+                label_taxa.resize(archive.num_labels(), TaxonNamespace::index_type(TaxonNamespace::npos));
+            }
+            this->build_tree(archive, tree_idx, tree, tree_idx, label_taxa);
+        }
+
+    protected:
+
+        unsigned long parse_stream(
+                std::istream & src,
+                const std::function<tree_type & ()> & get_new_tree_reference,
+                unsigned long tree_limit=0) override {
+            std::string buffer((std::istreambuf_iterator<char>(src)), std::istreambuf_iterator<char>());
+            return this->read_buffer(buffer.data(), buffer.size(), get_new_tree_reference, tree_limit);
+        }
+
+        /**
+         * Builds the tree in record ``tree_idx`` of ``archive``, and passes it
+         * to the post-processing function with index ``tree_count``. If a
+         * taxon namespace is bound, ``label_taxa`` caches the taxon index of
+         * each label (TaxonNamespace::npos if not yet looked up).
+         */
+        void build_tree(const BinaryTreeArchive & archive,
+                std::size_t tree_idx,
+                TreeT & tree,
+                unsigned long tree_count,
+                std::vector<TaxonNamespace::index_type> & label_taxa) {
+            InstrumentationTimer build_timer(this->stats_.build_seconds);
+            const char * pos = archive.data() + archive.get_tree_offset(tree_idx);
+            const char * end = archive.data() + archive.get_footer_offset();
+            if (end - pos < 5) {
+                throw BinaryTreeReaderError(__FILE__, __LINE__, "platypus::BinaryTreeReader: truncated tree record");
+            }
+            std::uint32_t num_nodes = binary_format::decode_u32(pos);
+            std::uint8_t flags = static_cast<std::uint8_t>(pos[4]);
+            pos += 5;
+            std::size_t edge_length_size = 0;
+            if (flags & binary_format::HAS_EDGE_LENGTHS) {
+                edge_length_size = (flags & binary_format::SINGLE_PRECISION_EDGE_LENGTHS) ? 4 : 8;
+            }
+            std::size_t node_size = 4 + ((flags & binary_format::HAS_LABELS) ? 4 : 0) + edge_length_size;
+            if (num_nodes == 0 || static_cast<std::size_t>(end - pos) / node_size < num_nodes) {
+                throw BinaryTreeReaderError(__FILE__, __LINE__, "platypus::BinaryTreeReader: truncated tree record");
+            }
+            const char * child_counts = pos;
+            const char * label_indexes = child_counts + 4 * static_cast<std::size_t>(num_nodes);
+            const char * edge_lengths = label_indexes + ((flags & binary_format::HAS_LABELS) ? 4 * static_cast<std::size_t>(num_nodes) : 0);
+
+            if (flags & binary_format::HAS_ROOTING) {
+                this->set_tree_is_rooted(tree, (flags & binary_format::IS_ROOTED) != 0);
+            }
+            // nodes still expecting children, with the number expected
+            this->open_nodes_.clear();
+            unsigned long num_leaf_nodes = 0;
+            unsigned long num_internal_nodes = 1; // root
+            EdgeLengthT tree_length = 0.0;
+            for (std::uint32_t node_idx = 0; node_idx < num_nodes; ++node_idx) {
+                std::uint32_t num_children = binary_format::decode_u32(child_counts + 4 * static_cast<std::size_t>(node_idx));
+                tree_node_type * node = nullptr;
+                if (node_idx == 0) {
+                    node = tree.head_node();
+                } else {
+                    if (this->open_nodes_.empty()) {
+                        throw BinaryTreeReaderError(__FILE__, __LINE__, "platypus::BinaryTreeReader: inconsistent child counts");
+                    }
+                    if (num_children > 0) {
+                        node = tree.create_internal_node();
+                        ++num_internal_nodes;
+                    } else {
+                        node = tree.create_leaf_node();
+                        ++num_leaf_nodes;
+                    }
+                    auto & parent = this->open_nodes_.back();
+                    parent.first->add_child(node);
+                    if (--parent.second == 0) {
+                        this->open_nodes_.pop_back();
+                    }
+                }
+                if (num_children > 0) {
+                    this->open_nodes_.push_back(std::make_pair(node, num_children));
+                }
+                if (flags & binary_format::HAS_LABELS) {
+                    std::uint32_t label_idx = binary_format::decode_u32(label_indexes + 4 * static_cast<std::size_t>(node_idx));
+                    if (label_idx != binary_format::NO_LABEL) {
+                        if (label_idx >= archive.num_labels()) {
+                            throw BinaryTreeReaderError(__FILE__, __LINE__, "platypus::BinaryTreeReader: invalid label index");
+                        }
+                        this->apply_label(node, archive.get_label(label_idx), label_idx, num_children == 0, label_taxa);
+                    }
+                }
+                if (edge_length_size > 0) {
+                    const char * src = edge_lengths + edge_length_size * node_idx;
+                    EdgeLengthT edge_length = static_cast<EdgeLengthT>(edge_length_size == 4
+                            ? static_cast<double>(binary_format::decode_f32(src))
+                            : binary_format::decode_f64(src));
+                    this->set_node_value_edge_length(node->value(), edge_length);
+                    tree_length += edge_length;
+                }
+            }
+            if (!this->open_nodes_.empty()) {
+                throw BinaryTreeReaderError(__FILE__, __LINE__, "platypus::BinaryTreeReader: inconsistent child counts");
+            }
+            tree.mark_structure_modified();
+            build_timer.stop();
+            this->stats_.record_tree(num_nodes);
+            this->postprocess_tree(tree, tree_count, num_leaf_nodes, num_internal_nodes, tree_length);
+        }
+
+        // As NewickReader: if a taxon namespace is bound, leaf labels are
+        // taxa instead (see BaseTreeProducer::set_taxon_namespace()).
+        void apply_label(tree_node_type * node,
+                const TokenView & label,
+                std::uint32_t label_idx,
+                bool is_leaf,
+                std::vector<TaxonNamespace::index_type> & label_taxa) {
+            if (this->has_taxon_namespace() && is_leaf) {
+                TaxonNamespace::index_type & taxon_index = label_taxa[label_idx];
+                if (taxon_index == TaxonNamespace::npos) {
+                    taxon_index = this->taxon_namespace_->add_taxon(label.data(), label.size());
+                }
+                this->set_node_value_taxon_index(node->value(), taxon_index);
+                return;
+            }
+            this->set_node_value_label(node->value(), label.str());
+        }
+
+    private:
+        std::vector<std::pair<tree_node_type *, std::uint32_t>>    open_nodes_;
+
+}; // BinaryTreeReader
+
+} // namespace platypus
+
+#endif
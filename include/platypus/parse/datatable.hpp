@@ -0,0 +1,495 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Reading of DataTable objects from delimited text.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_PARSE_DATATABLE_HPP
+#define PLATYPUS_PARSE_DATATABLE_HPP
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+#include "../model/datatable.hpp"
+#include "../utility/mappedfile.hpp"
+#include "../utility/numberparsing.hpp"
+#include "../utility/parallel.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// DataTableReaderError
+
+class DataTableReaderError : public DataTableException {
+    public:
+        DataTableReaderError(
+                    const std::string & filename,
+                    unsigned long line_num,
+                    unsigned long input_line_num,
+                    const std::string & message)
+            : DataTableException(filename, line_num, "Line " + std::to_string(input_line_num) + ": " + message)
+            , input_line_num_(input_line_num) { }
+        // Line of the input (counting from 1) at which the error occurred.
+        unsigned long get_input_line_num() const {
+            return this->input_line_num_;
+        }
+    private:
+        unsigned long input_line_num_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// DataTableReader
+
+/**
+ * Reads delimited text, as written by DataTable::write() (tab-separated, by
+ * default, or e.g. comma-separated), into the columns of a DataTable.
+ *
+ * If the table has no columns, they are created from the header row (or
+ * named "column_1", "column_2", etc., if there is none), with value types
+ * given by set_column_type() or, for other columns, inferred from the first
+ * set_num_inference_rows() rows: integer if every (non-empty) value in the
+ * sample is an integer, floating-point if every value is a number, and
+ * string otherwise. If the table already has columns, e.g. when merging the
+ * output of many runs, the header names must all be columns of the table
+ * (columns not in the input are left with zero or empty values), and values
+ * are parsed as the types of those columns.
+ *
+ * Lines are found with std::memchr() rather than through a stream, and
+ * numbers parsed in place with platypus::parse_integer() and
+ * platypus::parse_decimal(). With more than one thread, the input is split
+ * into chunks at line boundaries, which are parsed concurrently into shards
+ * of the table (see DataTableShard) and appended in input order. Fields are
+ * not unquoted: the separator may not occur within a value.
+ */
+class DataTableReader {
+
+    public:
+        typedef DataTableColumn::ValueType ValueType;
+
+    public:
+        DataTableReader(char separator='\t', bool has_header_row=true)
+            : separator_(separator)
+            , has_header_row_(has_header_row)
+            , num_inference_rows_(1000) {
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Configuration
+
+        void set_separator(char separator) {
+            this->separator_ = separator;
+        }
+        char get_separator() const {
+            return this->separator_;
+        }
+        void set_has_header_row(bool has_header_row) {
+            this->has_header_row_ = has_header_row;
+        }
+        bool has_header_row() const {
+            return this->has_header_row_;
+        }
+        // Fixes the value type of the named column, when columns are created.
+        void set_column_type(const std::string & col_name, ValueType value_type) {
+            this->column_types_[col_name] = value_type;
+        }
+        void clear_column_types() {
+            this->column_types_.clear();
+        }
+        // Names of columns created as key columns.
+        void set_key_column_names(const std::vector<std::string> & col_names) {
+            this->key_column_names_ = col_names;
+        }
+        // Number of rows sampled to infer column types (0: all rows).
+        void set_num_inference_rows(unsigned long num_rows) {
+            this->num_inference_rows_ = num_rows;
+        }
+        unsigned long get_num_inference_rows() const {
+            return this->num_inference_rows_;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Reading
+
+        /**
+         * Appends the rows in the ``size`` characters starting at ``data``
+         * to ``table``, parsing chunks of at least MIN_BYTES_PER_CHUNK bytes
+         * concurrently with up to ``num_threads`` threads (if 0, the number
+         * of hardware threads available).
+         *
+         * @return
+         *   The number of rows read.
+         *
+         * @throws DataTableReaderError
+         *   If the header names a column that is not in (a non-empty)
+         *   ``table``, a line has the wrong number of fields, or a value
+         *   cannot be parsed as the type of its column. No rows are added to
+         *   the table.
+         */
+        unsigned long read_buffer(DataTable & table,
+                const char * data,
+                std::size_t size,
+                unsigned int num_threads=1) {
+            const char * pos = data;
+            const char * end = data + size;
+            unsigned long line_num = 0;
+            std::vector<std::string> header;
+            if (this->has_header_row_) {
+                while (pos != end && header.empty()) {
+                    const char * line_end = DataTableReader::find_line_end(pos, end);
+                    ++line_num;
+                    this->split_fields(pos, DataTableReader::trim_line_end(pos, line_end), header);
+                    pos = DataTableReader::next_line(line_end, end);
+                }
+                if (header.empty()) {
+                    return 0;
+                }
+            }
+            if (table.num_columns() == 0) {
+                this->create_columns(table, header, pos, end, line_num);
+            }
+            std::vector<unsigned long> field_columns = this->map_fields(table, header, line_num);
+
+            unsigned long num_chunks = 1;
+            if (num_threads != 1) {
+                num_chunks = std::min(static_cast<unsigned long>(resolve_num_threads(num_threads)),
+                        static_cast<unsigned long>((end - pos) / MIN_BYTES_PER_CHUNK));
+                num_chunks = std::max(num_chunks, 1UL);
+            }
+            std::vector<const char *> chunk_begins{pos};
+            for (unsigned long chunk_idx = 1; chunk_idx < num_chunks; ++chunk_idx) {
+                const char * split = std::max(chunk_begins.back(), pos + (end - pos) * chunk_idx / num_chunks);
+                chunk_begins.push_back(DataTableReader::next_line(DataTableReader::find_line_end(split, end), end));
+            }
+            chunk_begins.push_back(end);
+
+            std::vector<DataTableShard> shards;
+            std::vector<ChunkError> errors(num_chunks);
+            for (unsigned long chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx) {
+                shards.push_back(table.create_shard());
+            }
+            parallel_for(num_chunks, static_cast<unsigned int>(num_chunks), [&](std::size_t chunk_idx) {
+                this->parse_rows(chunk_begins[chunk_idx], chunk_begins[chunk_idx + 1], field_columns,
+                        table, shards[chunk_idx], errors[chunk_idx]);
+            });
+            for (unsigned long chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx) {
+                if (!errors[chunk_idx].message.empty()) {
+                    unsigned long error_line_num = line_num + errors[chunk_idx].line_num;
+                    for (unsigned long prev_idx = 0; prev_idx < chunk_idx; ++prev_idx) {
+                        error_line_num += DataTableReader::count_lines(chunk_begins[prev_idx], chunk_begins[prev_idx + 1]);
+                    }
+                    throw DataTableReaderError(__FILE__, __LINE__, error_line_num, errors[chunk_idx].message);
+                }
+            }
+            unsigned long num_rows_read = 0;
+            for (auto & shard : shards) {
+                num_rows_read += shard.num_rows();
+            }
+            table.append_shards(shards);
+            return num_rows_read;
+        }
+
+        unsigned long read_buffer(DataTable & table, const std::string & src, unsigned int num_threads=1) {
+            return this->read_buffer(table, src.data(), src.size(), num_threads);
+        }
+
+        // Reads the file at ``path``, which is memory-mapped (see
+        // platypus::MappedFile).
+        unsigned long read_file(DataTable & table, const std::string & path, unsigned int num_threads=1) {
+            MappedFile src(path);
+            return this->read_buffer(table, src.data(), src.size(), num_threads);
+        }
+
+        unsigned long read(DataTable & table, std::istream & src, unsigned int num_threads=1) {
+            std::string buffer((std::istreambuf_iterator<char>(src)), std::istreambuf_iterator<char>());
+            return this->read_buffer(table, buffer, num_threads);
+        }
+        unsigned long read(DataTable & table, std::istream && src, unsigned int num_threads=1) {
+            return this->read(table, src, num_threads);
+        }
+
+    public:
+        // chunks smaller than this are not split across threads
+        static const std::size_t MIN_BYTES_PER_CHUNK = 1 << 20;
+
+    private:
+        // First parse error in a chunk, at a line counted from the start of
+        // the chunk.
+        struct ChunkError {
+            unsigned long   line_num = 0;
+            std::string     message;
+        };
+
+        static const char * find_line_end(const char * pos, const char * end) {
+            const char * line_end = static_cast<const char *>(std::memchr(pos, '\n', static_cast<std::size_t>(end - pos)));
+            return line_end == nullptr ? end : line_end;
+        }
+        static const char * next_line(const char * line_end, const char * end) {
+            return line_end == end ? end : line_end + 1;
+        }
+        static const char * trim_line_end(const char * line_begin, const char * line_end) {
+            return (line_end != line_begin && *(line_end - 1) == '\r') ? line_end - 1 : line_end;
+        }
+        static unsigned long count_lines(const char * begin, const char * end) {
+            unsigned long num_lines = static_cast<unsigned long>(std::count(begin, end, '\n'));
+            return (end != begin && *(end - 1) != '\n') ? num_lines + 1 : num_lines;
+        }
+
+        // Calls ``fn(field_begin, field_end)`` for each field of the line in
+        // [``begin``, ``end``), returning the number of fields (0 for an
+        // empty line).
+        template <class FnT>
+        unsigned long visit_fields(const char * begin, const char * end, FnT fn) const {
+            if (begin == end) {
+                return 0;
+            }
+            unsigned long num_fields = 0;
+            while (true) {
+                const char * field_end = static_cast<const char *>(std::memchr(begin, this->separator_, static_cast<std::size_t>(end - begin)));
+                if (field_end == nullptr) {
+                    fn(num_fields, begin, end);
+                    return num_fields + 1;
+                }
+                fn(num_fields, begin, field_end);
+                ++num_fields;
+                begin = field_end + 1;
+            }
+        }
+
+        void split_fields(const char * begin, const char * end, std::vector<std::string> & fields) const {
+            fields.clear();
+            this->visit_fields(begin, end, [&fields](unsigned long, const char * b, const char * e) {
+                fields.emplace_back(b, e);
+            });
+        }
+
+        static bool parse_floating_point(const char * begin, const char * end, double & value) {
+            if (parse_decimal(begin, end, value)) {
+                return true;
+            }
+            // as written by streams
+            std::string s(begin, end);
+            if (s == "nan" || s == "-nan" || s == "NaN") {
+                value = std::numeric_limits<double>::quiet_NaN();
+            } else if (s == "inf" || s == "+inf" || s == "Inf") {
+                value = std::numeric_limits<double>::infinity();
+            } else if (s == "-inf" || s == "-Inf") {
+                value = -std::numeric_limits<double>::infinity();
+            } else {
+                return false;
+            }
+            return true;
+        }
+
+        void create_columns(DataTable & table,
+                std::vector<std::string> & header,
+                const char * pos,
+                const char * end,
+                unsigned long line_num) const {
+            // sample rows to infer the types of columns not in the schema
+            std::vector<bool> can_be_integer;
+            std::vector<bool> can_be_number;
+            std::vector<bool> has_value;
+            unsigned long num_sampled = 0;
+            while (pos != end && (this->num_inference_rows_ == 0 || num_sampled < this->num_inference_rows_)) {
+                const char * line_end = DataTableReader::find_line_end(pos, end);
+                ++line_num;
+                unsigned long num_fields = this->visit_fields(pos, DataTableReader::trim_line_end(pos, line_end),
+                        [&](unsigned long field_idx, const char * b, const char * e) {
+                            if (field_idx >= can_be_integer.size()) {
+                                can_be_integer.resize(field_idx + 1, true);
+                                can_be_number.resize(field_idx + 1, true);
+                                has_value.resize(field_idx + 1, false);
+                            }
+                            if (b == e) {
+                                return;
+                            }
+                            has_value[field_idx] = true;
+                            long lv = 0;
+                            double dv = 0.0;
+                            if (can_be_integer[field_idx] && !parse_integer(b, e, lv)) {
+                                can_be_integer[field_idx] = false;
+                            }
+                            if (!can_be_integer[field_idx] && can_be_number[field_idx] && !DataTableReader::parse_floating_point(b, e, dv)) {
+                                can_be_number[field_idx] = false;
+                            }
+                        });
+                if (num_fields > 0) {
+                    if (!this->has_header_row_ && header.empty()) {
+                        for (unsigned long field_idx = 0; field_idx < num_fields; ++field_idx) {
+                            header.push_back("column_" + std::to_string(field_idx + 1));
+                        }
+                    }
+                    if (num_fields != header.size()) {
+                        throw DataTableReaderError(__FILE__, __LINE__, line_num,
+                                "expecting " + std::to_string(header.size()) + " fields but found " + std::to_string(num_fields));
+                    }
+                    ++num_sampled;
+                }
+                pos = DataTableReader::next_line(line_end, end);
+            }
+            for (unsigned long field_idx = 0; field_idx < header.size(); ++field_idx) {
+                const std::string & name = header[field_idx];
+                ValueType value_type = ValueType::String;
+                auto type_iter = this->column_types_.find(name);
+                if (type_iter != this->column_types_.end()) {
+                    value_type = type_iter->second;
+                } else if (field_idx < has_value.size() && has_value[field_idx]) {
+                    if (can_be_integer[field_idx]) {
+                        value_type = ValueType::SignedInteger;
+                    } else if (can_be_number[field_idx]) {
+                        value_type = ValueType::FloatingPoint;
+                    }
+                }
+                bool is_key_column = std::find(this->key_column_names_.begin(), this->key_column_names_.end(), name) != this->key_column_names_.end();
+                switch (value_type) {
+                    case ValueType::SignedInteger:
+                        table.add_column<DataTableColumn::signed_integer_implementation_type>(name, {}, is_key_column);
+                        break;
+                    case ValueType::UnsignedInteger:
+                        table.add_column<DataTableColumn::unsigned_integer_implementation_type>(name, {}, is_key_column);
+                        break;
+                    case ValueType::FloatingPoint:
+                        table.add_column<DataTableColumn::floating_point_implementation_type>(name, {}, is_key_column);
+                        break;
+                    case ValueType::String:
+                        table.add_column<DataTableColumn::string_implementation_type>(name, {}, is_key_column);
+                        break;
+                }
+            }
+        }
+
+        // Index of the table column of each field.
+        std::vector<unsigned long> map_fields(DataTable & table,
+                const std::vector<std::string> & header,
+                unsigned long line_num) const {
+            std::vector<unsigned long> field_columns;
+            if (header.empty()) {
+                for (unsigned long col_idx = 0; col_idx < table.num_columns(); ++col_idx) {
+                    field_columns.push_back(col_idx);
+                }
+                return field_columns;
+            }
+            std::vector<std::string> column_names = table.column_names();
+            for (auto & name : header) {
+                auto col_iter = std::find(column_names.begin(), column_names.end(), name);
+                if (col_iter == column_names.end()) {
+                    throw DataTableReaderError(__FILE__, __LINE__, line_num, "column '" + name + "' is not in the table");
+                }
+                field_columns.push_back(static_cast<unsigned long>(col_iter - column_names.begin()));
+            }
+            return field_columns;
+        }
+
+        void parse_rows(const char * pos,
+                const char * end,
+                const std::vector<unsigned long> & field_columns,
+                const DataTable & table,
+                DataTableShard & shard,
+                ChunkError & error) const {
+            std::vector<const DataTableColumn *> columns;
+            for (auto col_idx : field_columns) {
+                columns.push_back(&table.column(col_idx));
+            }
+            shard.reserve(static_cast<unsigned long>(std::count(pos, end, '\n')) + 1);
+            unsigned long line_num = 0;
+            while (pos != end) {
+                const char * line_end = DataTableReader::find_line_end(pos, end);
+                const char * line_begin = pos;
+                pos = DataTableReader::next_line(line_end, end);
+                ++line_num;
+                line_end = DataTableReader::trim_line_end(line_begin, line_end);
+                if (line_begin == line_end) {
+                    continue;
+                }
+                auto row = shard.add_row();
+                unsigned long num_fields = this->visit_fields(line_begin, line_end,
+                        [&](unsigned long field_idx, const char * b, const char * e) {
+                            if (field_idx >= columns.size() || b == e || !error.message.empty()) {
+                                return;
+                            }
+                            if (!DataTableReader::parse_field(row, field_columns[field_idx], columns[field_idx]->get_value_type(), b, e)) {
+                                error.message = "cannot parse '" + std::string(b, e) + "' as a value of column '"
+                                    + columns[field_idx]->get_label() + "' (of type "
+                                    + DataTableColumn::get_value_type_name_as_string(columns[field_idx]->get_value_type()) + ")";
+                            }
+                        });
+                if (error.message.empty() && num_fields != columns.size()) {
+                    error.message = "expecting " + std::to_string(columns.size()) + " fields but found " + std::to_string(num_fields);
+                }
+                if (!error.message.empty()) {
+                    error.line_num = line_num;
+                    return;
+                }
+            }
+        }
+
+        static bool parse_field(DataTableRow & row,
+                unsigned long col_idx,
+                ValueType value_type,
+                const char * begin,
+                const char * end) {
+            switch (value_type) {
+                case ValueType::SignedInteger: {
+                    DataTableColumn::signed_integer_implementation_type v = 0;
+                    if (!parse_integer(begin, end, v)) {
+                        return false;
+                    }
+                    row.set(col_idx, v);
+                    return true;
+                }
+                case ValueType::UnsignedInteger: {
+                    DataTableColumn::unsigned_integer_implementation_type v = 0;
+                    if (!parse_integer(begin, end, v)) {
+                        return false;
+                    }
+                    row.set(col_idx, v);
+                    return true;
+                }
+                case ValueType::FloatingPoint: {
+                    double v = 0.0;
+                    if (!DataTableReader::parse_floating_point(begin, end, v)) {
+                        return false;
+                    }
+                    row.set(col_idx, v);
+                    return true;
+                }
+                case ValueType::String:
+                    row.set(col_idx, std::string(begin, end));
+                    return true;
+            }
+            return false;
+        }
+
+    private:
+        char                                    separator_;
+        bool                                    has_header_row_;
+        unsigned long                           num_inference_rows_;
+        std::map<std::string, ValueType>        column_types_;
+        std::vector<std::string>                key_column_names_;
+
+}; // DataTableReader
+
+} // namespace platypus
+
+#endif
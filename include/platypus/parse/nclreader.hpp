@@ -29,13 +29,79 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <algorithm>
 #include <functional>
-#include <map>
+#include <memory>
+#include <utility>
 #include <ncl/nxsmultiformat.h>
 #include "../base/base_reader.hpp"
+#include "../model/charactermatrix.hpp"
+#include "../model/treedistance.hpp"
 
 namespace platypus {
 
+template <typename TreeT, class EdgeLengthT> class NclTreeCollection;
+
+////////////////////////////////////////////////////////////////////////////////
+// NclReaderSession
+
+/**
+ * A configured NCL reader, with its block factories, kept from one source to
+ * the next. Constructing and configuring NCL's reader dominates the cost of
+ * parsing small sources, so when many are read in turn, binding a session to
+ * the tree reader (see NclTreeReader::set_session()) avoids paying it for
+ * each:
+ *
+ *      NclReaderSession session;
+ *      reader.set_session(&session);
+ *      for (auto & path : paths) {
+ *          reader.read_file(path, get_new_tree_reference);
+ *      }
+ *
+ * The blocks read from each source are deleted once its trees have been
+ * built. A session must not be used by more than one parse at a time.
+ */
+class NclReaderSession {
+
+    public:
+        NclReaderSession()
+            : reader_(create_reader()) { }
+        NclReaderSession(const NclReaderSession &) = delete;
+        NclReaderSession & operator=(const NclReaderSession &) = delete;
+        ~NclReaderSession() {
+            this->reset();
+        }
+
+        MultiFormatReader & get_reader() {
+            return *this->reader_;
+        }
+
+        /**
+         * Deletes and forgets the blocks read from the last source (and any
+         * tree callbacks installed for it), leaving the reader as configured
+         * for the next source.
+         */
+        void reset() {
+            this->reader_->GetTreesBlockTemplate()->setValidationCallbacks(nullptr, nullptr);
+            this->reader_->DeleteBlocksFromFactories();
+            this->reader_->ClearUsedBlockList();
+        }
+
+        /**
+         * Returns a new NCL reader configured as the platypus readers use it.
+         */
+        static std::unique_ptr<MultiFormatReader> create_reader() {
+            std::unique_ptr<MultiFormatReader> reader(new MultiFormatReader(-1, NxsReader::IGNORE_WARNINGS));
+            reader->SetWarningOutputLevel(NxsReader::AMBIGUOUS_CONTENT_WARNING);
+            reader->SetCoerceUnderscoresToSpaces(false);
+            return reader;
+        }
+
+    private:
+        std::unique_ptr<MultiFormatReader>      reader_;
+
+}; // NclReaderSession
+
 ////////////////////////////////////////////////////////////////////////////////
 // NclTreeReader
 
@@ -49,7 +115,51 @@ class NclTreeReader : public BaseTreeReader<TreeT> {
 
     public:
 
-        NclTreeReader() { }
+        NclTreeReader()
+            : is_streaming_(false)
+            , session_(nullptr)
+            , cached_taxa_block_(nullptr)
+            , cached_taxon_namespace_(nullptr) { }
+
+        /**
+         * If ``streaming`` is true, read() (and the other reading functions
+         * of BaseTreeReader) build each tree as soon as NCL has parsed its
+         * TREE statement, and NCL discards the statement's description once
+         * the tree is built, rather than keeping the descriptions of all the
+         * trees of the source until the end of the parse. Peak memory use is
+         * then independent of the number of trees in the source, and parsing
+         * stops at the statement that reaches the tree limit.
+         *
+         * Taxa blocks and translate tables are still processed by NCL before
+         * the trees that refer to them. Unlike non-streaming reads, which
+         * only build the trees associated with the last taxa block of the
+         * source, the trees of every trees block are built, in their order
+         * in the source. read_lazy() is unaffected by this setting.
+         */
+        void set_streaming(bool streaming) {
+            this->is_streaming_ = streaming;
+        }
+        bool is_streaming() const {
+            return this->is_streaming_;
+        }
+
+        /**
+         * Parses sources with the NCL reader of ``session`` rather than with
+         * a reader constructed and configured for each source; null restores
+         * the latter. While a session is bound, the conversion of taxon labels
+         * and their lookup in the bound taxon namespace are also kept from
+         * source to source, for as long as the taxa blocks of consecutive
+         * sources begin with the same labels; the bound taxon namespace must
+         * then not be cleared between sources. read_lazy() does not use the
+         * session.
+         */
+        void set_session(NclReaderSession * session) {
+            this->session_ = session;
+        }
+        NclReaderSession * get_session() const {
+            return this->session_;
+        }
+
         unsigned long read(
                 std::istream & src,
                 const std::function<tree_type & ()> & get_new_tree_reference,
@@ -66,42 +176,152 @@ class NclTreeReader : public BaseTreeReader<TreeT> {
             return this->parse_stream(src, get_new_tree_reference, format, tree_limit);
         }
 
-    protected:
+        /**
+         * Parses ``src``, but defers building trees until they are requested
+         * from the returned collection (see NclTreeCollection). The
+         * collection builds trees using a copy of this reader's setters and
+         * post-processing functions, as configured at the time of the call.
+         */
+        NclTreeCollection<TreeT, EdgeLengthT> read_lazy(
+                std::istream & src,
+                const std::string & format="nexus");
 
-        unsigned long parse_stream(
+        NclTreeCollection<TreeT, EdgeLengthT> read_lazy(
+                std::istream && src,
+                const std::string & format="nexus") {
+            return this->read_lazy(src, format);
+        }
+
+        using BaseTreeReader<TreeT>::read_range;
+
+        /**
+         * As BaseTreeReader::read_range(), for a NEXUS source indexed by
+         * ``index``: NCL is given only the part of the source preceding the
+         * first tree (taxa blocks, the start of the trees block and any
+         * translate table), followed by the tree commands of the range, so
+         * that the trees preceding the range are never parsed.
+         */
+        unsigned long read_range(
                 std::istream & src,
-                const std::function<tree_type & ()> & get_new_tree_reference,
-                unsigned long tree_limit=0) override {
-            return this->parse_stream(src, get_new_tree_reference,"nexus", tree_limit);
+                const TreeOffsetIndex & index,
+                std::size_t begin_idx,
+                std::size_t end_idx,
+                const std::function<tree_type & ()> & get_new_tree_reference) override {
+            if (!index.is_nexus()) {
+                return BaseTreeReader<TreeT>::read_range(src, index, begin_idx, end_idx, get_new_tree_reference);
+            }
+            if (end_idx > index.num_trees()) {
+                end_idx = index.num_trees();
+            }
+            if (begin_idx >= end_idx) {
+                return 0;
+            }
+            std::string buffer;
+            read_source_range(src, 0, index.get_tree_offset(0), buffer);
+            read_source_range(src, index.get_tree_offset(begin_idx), index.get_range_end_offset(end_idx), buffer);
+            buffer += "\nEND;\n";
+            std::istringstream range_src(buffer);
+            return this->parse_stream_unfiltered(range_src, get_new_tree_reference, end_idx - begin_idx);
         }
 
-        unsigned long parse_stream(
+    protected:
+
+        // Appends the bytes [``begin``, ``end``) of ``src`` to ``buffer``.
+        static void read_source_range(std::istream & src,
+                TreeOffsetIndex::offset_type begin,
+                TreeOffsetIndex::offset_type end,
+                std::string & buffer) {
+            src.clear();
+            src.seekg(static_cast<std::streamoff>(begin));
+            std::size_t offset = buffer.size();
+            buffer.resize(offset + static_cast<std::size_t>(end - begin));
+            src.read(&buffer[offset], static_cast<std::streamsize>(end - begin));
+            if (!src) {
+                throw ReaderException(__FILE__, __LINE__, "platypus::NclTreeReader: unable to read indexed range");
+            }
+        }
+
+        // Parses ``src`` with ``reader``.
+        void read_ncl_stream(
+                MultiFormatReader & reader,
                 std::istream & src,
-                const std::function<tree_type & ()> & get_new_tree_reference,
-                const std::string & format,
-                unsigned long tree_limit=0) {
-            MultiFormatReader reader(-1, NxsReader::IGNORE_WARNINGS);
-            reader.SetWarningOutputLevel(NxsReader::AMBIGUOUS_CONTENT_WARNING);
-            reader.SetCoerceUnderscoresToSpaces(false);
+                const std::string & format) {
             const char * format_cstr = nullptr;
             if (format == "newick") {
                 format_cstr = "relaxedphyliptree";
             } else {
                 format_cstr = format.c_str();
             }
+            // taxa blocks from any previous parse will be gone, but their
+            // labels are kept for comparison when in a session
+            this->cached_taxa_block_ = nullptr;
+            if (!this->session_) {
+                this->taxon_labels_.clear();
+                this->namespace_taxon_indexes_.clear();
+            }
             reader.ReadStream(src, format_cstr);
+        }
+
+        /**
+         * Parses ``src`` with ``reader``, and returns the trees block
+         * associated with the last taxa block parsed (or null if there is
+         * none) and, in ``taxa_block``, that taxa block.
+         */
+        NxsTreesBlock * load_trees_block(
+                MultiFormatReader & reader,
+                std::istream & src,
+                const std::string & format,
+                NxsTaxaBlock *& taxa_block) {
+            this->read_ncl_stream(reader, src, format);
             unsigned num_taxa_blocks = reader.GetNumTaxaBlocks();
-            NxsTaxaBlock *  taxa_block = reader.GetTaxaBlock(num_taxa_blocks-1);
+            taxa_block = reader.GetTaxaBlock(num_taxa_blocks-1);
             if (!taxa_block) {
                 throw std::runtime_error("platypus::NclTreeReader::read_from_stream(): No taxon definitions were parsed (invalid file format?)");
             }
-            NxsTreesBlock * trees_block = reader.GetTreesBlock(taxa_block, 0);
+            return reader.GetTreesBlock(taxa_block, 0);
+        }
+
+        unsigned long parse_stream(
+                std::istream & src,
+                const std::function<tree_type & ()> & get_new_tree_reference,
+                unsigned long tree_limit=0) override {
+            return this->parse_stream(src, get_new_tree_reference,"nexus", tree_limit);
+        }
+
+        unsigned long parse_stream(
+                std::istream & src,
+                const std::function<tree_type & ()> & get_new_tree_reference,
+                const std::string & format,
+                unsigned long tree_limit=0) {
+            std::unique_ptr<NclReaderSession> own_session;
+            NclReaderSession * session = this->session_;
+            if (!session) {
+                own_session.reset(new NclReaderSession());
+                session = own_session.get();
+            }
+            SessionReset session_reset{*session};
+            MultiFormatReader & reader = session->get_reader();
+            if (this->is_streaming_) {
+                return this->parse_stream_streaming(reader, src, get_new_tree_reference, format, tree_limit);
+            }
+            NxsTaxaBlock * taxa_block = nullptr;
+            // NCL tokenizes and parses the entire source up front
+            std::streampos start = this->get_instrumentation_position(src);
+            InstrumentationTimer scan_timer(this->stats_.scan_seconds);
+            NxsTreesBlock * trees_block = this->load_trees_block(reader, src, format, taxa_block);
+            scan_timer.stop();
+            this->record_stream_bytes_read(src, start);
             if (!trees_block) {
                 return 0;
             }
             unsigned int num_trees = trees_block->GetNumTrees();
             unsigned long tree_count = 0;
+            // NCL has already processed every tree description, but skipped
+            // trees are at least never built
             for (unsigned int tree_idx = 0; tree_idx < num_trees; ++tree_idx) {
+                if (this->is_statement_skipped(tree_idx)) {
+                    continue;
+                }
                 auto & tree = get_new_tree_reference();
                 const NxsFullTreeDescription & ftd = trees_block->GetFullTreeDescription(tree_idx);
                 this->build_tree(tree, taxa_block, ftd, tree_count);
@@ -113,64 +333,175 @@ class NclTreeReader : public BaseTreeReader<TreeT> {
             return tree_count;
         }
 
+        // Resets a session once the trees of a source have been built.
+        struct SessionReset {
+            NclReaderSession & session;
+            ~SessionReset() {
+                this->session.reset();
+            }
+        };
+
+        // State of a streaming parse, passed to process_streamed_tree()
+        // through NCL.
+        struct StreamingParse {
+            NclTreeReader *                             reader;
+            const std::function<tree_type & ()> *       get_new_tree_reference;
+            unsigned long                               tree_limit;
+            unsigned long                               num_statements;
+            unsigned long                               tree_count;
+            bool is_limit_reached() const {
+                return this->tree_limit > 0 && this->tree_count >= this->tree_limit;
+            }
+        };
+
+        // Builds trees from within the NCL parse of ``src``, as each TREE
+        // statement is processed (see set_streaming()).
+        unsigned long parse_stream_streaming(
+                MultiFormatReader & reader,
+                std::istream & src,
+                const std::function<tree_type & ()> & get_new_tree_reference,
+                const std::string & format,
+                unsigned long tree_limit) {
+            StreamingParse parse{this, &get_new_tree_reference, tree_limit, 0, 0};
+            // trees blocks are cloned from the template, callbacks and all
+            reader.GetTreesBlockTemplate()->setValidationCallbacks(&NclTreeReader::process_streamed_tree, &parse);
+            std::streampos start = this->get_instrumentation_position(src);
+            try {
+                this->read_ncl_stream(reader, src, format);
+            } catch (const NxsException &) {
+                if (!parse.is_limit_reached()) {
+                    throw;
+                }
+                // the remainder of the source is deliberately left unparsed
+            }
+            this->record_stream_bytes_read(src, start);
+            return parse.tree_count;
+        }
+
+        // NCL callback for each processed tree description during a
+        // streaming parse: builds the tree (unless skipped) and returns
+        // false, so that NCL does not store the description.
+        static bool process_streamed_tree(
+                NxsFullTreeDescription & ftd,
+                void * parse_ptr,
+                NxsTreesBlock * trees_block) {
+            StreamingParse & parse = *static_cast<StreamingParse *>(parse_ptr);
+            unsigned long statement_idx = parse.num_statements++;
+            if (parse.reader->is_statement_skipped(statement_idx)) {
+                return false;
+            }
+            const NxsTaxaBlock * taxa_block = dynamic_cast<const NxsTaxaBlock *>(trees_block->GetTaxaBlockPtr(nullptr));
+            if (!taxa_block) {
+                throw std::runtime_error("platypus::NclTreeReader::read_from_stream(): No taxon definitions were parsed (invalid file format?)");
+            }
+            auto & tree = (*parse.get_new_tree_reference)();
+            parse.reader->build_tree(tree, taxa_block, ftd, parse.tree_count);
+            ++parse.tree_count;
+            if (parse.is_limit_reached()) {
+                // stops the parse: NCL only discards the block being read
+                // for its own exception type
+                throw NxsException("platypus::NclTreeReader: tree limit reached");
+            }
+            return false;
+        }
+
+        /**
+         * Builds ``ttree`` from the NCL description of a tree.
+         *
+         * The NCL tree is visited in preorder by following its first-child
+         * and next-sibling links, with an explicit stack pairing each NCL node
+         * still to be visited with its (already-created) native parent, so
+         * that no traversal vector, child list copies or node-to-node map
+         * are needed.
+         *
+         * If a taxon namespace is bound, each leaf is given the index of its
+         * taxon in the namespace, looked up through a table indexed by NCL
+         * taxon index (i.e., by translate table key), and no label is copied
+         * into the tree: labels are only materialized when the tree is
+         * written by a writer bound to the same namespace. Otherwise, each
+         * leaf is given a copy of its taxon label.
+         */
         void build_tree(TreeT& ttree,
                 const NxsTaxaBlock * tb,
                 const NxsFullTreeDescription & ftd,
                 unsigned long tree_count=0) {
             this->set_tree_is_rooted(ttree, ftd.IsRooted());
             NxsSimpleTree ncl_tree(ftd, -1, -1.0);
-            auto * root = ttree.head_node();
-            decltype(root) node_parent = nullptr;
-            decltype(root) new_node = nullptr;
-            std::vector<const NxsSimpleNode *> ncl_nodes = ncl_tree.GetPreorderTraversal();
-            std::map<const NxsSimpleNode *, decltype(root)> ncl_to_native;
+            const NxsSimpleNode * ncl_root = ncl_tree.GetRootConst();
+            if (!ncl_root) {
+                throw std::runtime_error("platypus::NclTreeReader::build_tree(): Empty tree");
+            }
             unsigned long num_leaf_nodes = 0;
             unsigned long num_internal_nodes = 1; // start at one to count root
             EdgeLengthT tree_length = 0.0;
-            for (auto & ncl_node : ncl_nodes) {
+            InstrumentationTimer build_timer(this->stats_.build_seconds);
+            // leaves are resolved through per-taxa-block tables, filled once
+            // for all the taxa of the block, so that (e.g., for translated
+            // tree statements) each leaf costs only an index lookup
+            const bool has_taxon_namespace = this->has_taxon_namespace();
+            const std::vector<std::string> & taxon_labels = this->get_taxon_labels(tb);
+            const std::vector<TaxonNamespace::index_type> * taxon_indexes = has_taxon_namespace ? &this->get_namespace_taxon_indexes() : nullptr;
+            auto & to_visit = this->node_stack_;
+            to_visit.clear();
+            to_visit.push_back(std::make_pair(ncl_root, static_cast<tree_node_type *>(nullptr)));
+            while (!to_visit.empty()) {
+                const NxsSimpleNode * ncl_node = to_visit.back().first;
+                tree_node_type * node_parent = to_visit.back().second;
+                to_visit.pop_back();
                 const NxsSimpleEdge & ncl_edge = ncl_node->GetEdgeToParentRef();
-                const NxsSimpleNode * ncl_par = ncl_edge.GetParent();
-                std::vector<NxsSimpleNode *> ncl_child_nodes = ncl_node->GetChildren();
-                unsigned int nchildren = ncl_child_nodes.size();
                 EdgeLengthT edge_len = static_cast<EdgeLengthT>(ncl_edge.GetDblEdgeLen());
                 if (edge_len < 0) {
                     edge_len = 0.0;
                 } else {
                     tree_length += edge_len;
                 }
-                std::string label;
-                if (nchildren == 1) {
-                    throw std::runtime_error("platypus::NclTreeReader::build_tree(): Tree source has node with only 1 child");
-                } else if (nchildren == 0) {
-                    unsigned int ncl_taxon_idx = ncl_node->GetTaxonIndex();
-                    label = tb->GetTaxonLabel(ncl_taxon_idx).c_str();
-                    // new_node = &this->tree_leaf_node_factory(ttree);
+                const NxsSimpleNode * ncl_first_child = ncl_node->GetFirstChild();
+                tree_node_type * new_node = nullptr;
+                if (!ncl_first_child) {
                     new_node = ttree.create_leaf_node();
+                    unsigned int taxon_idx = ncl_node->GetTaxonIndex();
+                    if (taxon_idx >= taxon_labels.size()) {
+                        throw std::runtime_error("platypus::NclTreeReader::build_tree(): Taxon index out of range");
+                    }
+                    if (has_taxon_namespace) {
+                        this->set_node_value_taxon_index(new_node->value(), (*taxon_indexes)[taxon_idx]);
+                    } else {
+                        this->set_node_value_label(new_node->value(), taxon_labels[taxon_idx]);
+                    }
                     ++num_leaf_nodes;
                 } else {
-                    label = NxsString::GetEscaped(ncl_node->GetName()).c_str();
-                    if (!ncl_par) {
+                    if (!ncl_first_child->GetNextSib()) {
+                        throw std::runtime_error("platypus::NclTreeReader::build_tree(): Tree source has node with only 1 child");
+                    }
+                    if (!node_parent) {
                         new_node = ttree.head_node();
                     } else {
-                        // new_node = &this->tree_internal_node_factory(ttree);
                         new_node = ttree.create_internal_node();
                         ++num_internal_nodes;
                     }
+                    std::string name = ncl_node->GetName();
+                    if (name.empty()) {
+                        this->set_node_value_label(new_node->value(), name);
+                    } else {
+                        this->set_node_value_label(new_node->value(), NxsString::GetEscaped(name));
+                    }
                 }
-                this->set_node_value_label(new_node->value(), label);
                 this->set_node_value_edge_length(new_node->value(), edge_len);
-                ncl_to_native[ncl_node] = new_node;
-                if (ncl_par) {
-                    if (ncl_to_native.find(ncl_par) == ncl_to_native.end()) {
-                        throw std::runtime_error("platypus::NclTreeReader::build_tree(): Parent node not visited in preorder traversal");
-                    }
-                    node_parent = ncl_to_native[ncl_par];
-                    if (!node_parent) {
-                        throw std::runtime_error("platypus::NclTreeReader::build_tree(): Null parent node");
-                    }
+                if (node_parent) {
                     node_parent->add_child(new_node);
                 }
+                if (ncl_first_child) {
+                    // children are pushed last-to-first, so that they are
+                    // visited (and added to ``new_node``) first-to-last
+                    std::size_t first_pushed = to_visit.size();
+                    for (const NxsSimpleNode * ch = ncl_first_child; ch != nullptr; ch = ch->GetNextSib()) {
+                        to_visit.push_back(std::make_pair(ch, new_node));
+                    }
+                    std::reverse(to_visit.begin() + first_pushed, to_visit.end());
+                }
             }
+            build_timer.stop();
+            this->stats_.record_tree(num_leaf_nodes + num_internal_nodes);
             this->postprocess_tree(
                     ttree,
                     tree_count,
@@ -179,8 +510,423 @@ class NclTreeReader : public BaseTreeReader<TreeT> {
                     tree_length);
         }
 
+    private:
+        // Taxon labels are converted from NCL strings once per taxa block,
+        // rather than once per leaf; the returned labels are those of all the
+        // taxa of ``tb`` (which may gain taxa during a parse).
+        const std::vector<std::string> & get_taxon_labels(const NxsTaxaBlock * tb) {
+            if (tb != this->cached_taxa_block_) {
+                this->switch_taxa_block(tb);
+            }
+            unsigned int num_taxa = tb->GetNumTaxonLabels();
+            for (unsigned int idx = static_cast<unsigned int>(this->taxon_labels_.size()); idx < num_taxa; ++idx) {
+                this->taxon_labels_.push_back(tb->GetTaxonLabel(idx).c_str());
+            }
+            return this->taxon_labels_;
+        }
+
+        // Keeps only the labels (and namespace indexes) cached for the
+        // labels with which ``tb`` begins, e.g. all of them when consecutive
+        // sources share their taxa.
+        void switch_taxa_block(const NxsTaxaBlock * tb) {
+            std::size_t num_taxa = tb->GetNumTaxonLabels();
+            std::size_t num_shared = 0;
+            while (num_shared < this->taxon_labels_.size()
+                    && num_shared < num_taxa
+                    && this->taxon_labels_[num_shared] == tb->GetTaxonLabel(static_cast<unsigned int>(num_shared))) {
+                ++num_shared;
+            }
+            this->taxon_labels_.resize(num_shared);
+            if (this->namespace_taxon_indexes_.size() > num_shared) {
+                this->namespace_taxon_indexes_.resize(num_shared);
+            }
+            this->cached_taxa_block_ = tb;
+        }
+
+        // Likewise, each taxon of a taxa block is looked up in the bound
+        // taxon namespace only once; the returned indexes correspond to the
+        // labels returned by get_taxon_labels(), which must be called first.
+        const std::vector<TaxonNamespace::index_type> & get_namespace_taxon_indexes() {
+            if (this->taxon_namespace_ != this->cached_taxon_namespace_) {
+                this->namespace_taxon_indexes_.clear();
+                this->cached_taxon_namespace_ = this->taxon_namespace_;
+            }
+            for (std::size_t idx = this->namespace_taxon_indexes_.size(); idx < this->taxon_labels_.size(); ++idx) {
+                this->namespace_taxon_indexes_.push_back(this->taxon_namespace_->add_taxon(this->taxon_labels_[idx]));
+            }
+            return this->namespace_taxon_indexes_;
+        }
+
+    private:
+        bool                                                                is_streaming_;
+        NclReaderSession *                                                  session_;
+        std::vector<std::pair<const NxsSimpleNode *, tree_node_type *>>     node_stack_;
+        const NxsTaxaBlock *                                                cached_taxa_block_;
+        std::vector<std::string>                                            taxon_labels_;
+        const TaxonNamespace *                                              cached_taxon_namespace_;
+        std::vector<TaxonNamespace::index_type>                             namespace_taxon_indexes_;
+
+    friend class NclTreeCollection<TreeT, EdgeLengthT>;
+
 }; // NclTreeReader
 
+////////////////////////////////////////////////////////////////////////////////
+// NclTreeCollection
+
+/**
+ * The trees parsed from a source by NclTreeReader::read_lazy(), held as
+ * NCL tree descriptions, each of which is only built into a ``TreeT``
+ * object when requested. Subsets of trees can be built without the cost of
+ * building the others, e.g., to discard a burn-in and thin an MCMC sample:
+ *
+ *      auto trees = reader.read_lazy(src, "nexus");
+ *      auto selected = trees.select(trees.size() / 4, 10);
+ *      trees.get_each(selected, [](tree_type & tree, unsigned long idx) {
+ *          ...
+ *      });
+ *
+ * Trees are indexed by their position in the source, and this index is
+ * passed to the tree post-processing function when a tree is built.
+ */
+template <typename TreeT, class EdgeLengthT=double>
+class NclTreeCollection {
+
+    public:
+        typedef TreeT tree_type;
+
+    public:
+        NclTreeCollection(
+                const NclTreeReader<TreeT, EdgeLengthT> & builder,
+                std::istream & src,
+                const std::string & format)
+            : builder_(builder)
+            , ncl_reader_(NclReaderSession::create_reader())
+            , taxa_block_(nullptr)
+            , trees_block_(nullptr) {
+            this->trees_block_ = this->builder_.load_trees_block(*this->ncl_reader_, src, format, this->taxa_block_);
+        }
+
+        NclTreeCollection(NclTreeCollection && other)
+            : builder_(std::move(other.builder_))
+            , ncl_reader_(std::move(other.ncl_reader_))
+            , taxa_block_(other.taxa_block_)
+            , trees_block_(other.trees_block_) {
+            other.taxa_block_ = nullptr;
+            other.trees_block_ = nullptr;
+        }
+
+        /**
+         * Releases the blocks of the source this collection holds before
+         * taking over those of ``other``, which is left empty.
+         */
+        NclTreeCollection & operator=(NclTreeCollection && other) {
+            if (this != &other) {
+                this->release_blocks();
+                this->builder_ = std::move(other.builder_);
+                this->ncl_reader_ = std::move(other.ncl_reader_);
+                this->taxa_block_ = other.taxa_block_;
+                this->trees_block_ = other.trees_block_;
+                other.taxa_block_ = nullptr;
+                other.trees_block_ = nullptr;
+            }
+            return *this;
+        }
+
+        ~NclTreeCollection() {
+            this->release_blocks();
+        }
+
+        unsigned long size() const {
+            return this->trees_block_ ? this->trees_block_->GetNumTrees() : 0;
+        }
+
+        bool empty() const {
+            return this->size() == 0;
+        }
+
+        std::string get_tree_name(unsigned long tree_idx) const {
+            return this->get_description(tree_idx).GetName();
+        }
+
+        /**
+         * Builds tree ``tree_idx`` of the source into ``tree``, which should
+         * be empty.
+         */
+        void get(unsigned long tree_idx, TreeT & tree) {
+            this->builder_.build_tree(tree, this->taxa_block_, this->get_description(tree_idx), tree_idx);
+        }
+
+        /**
+         * Returns the indexes of the trees remaining once the first
+         * ``skip_first`` trees are discarded, keeping every ``every_nth``
+         * tree thereafter (starting with the first one not discarded), up to
+         * at most ``limit`` trees (0: no limit).
+         */
+        std::vector<unsigned long> select(
+                unsigned long skip_first=0,
+                unsigned long every_nth=1,
+                unsigned long limit=0) const {
+            std::vector<unsigned long> indexes;
+            if (every_nth == 0) {
+                every_nth = 1;
+            }
+            for (unsigned long idx = skip_first; idx < this->size(); idx += every_nth) {
+                if (limit > 0 && indexes.size() >= limit) {
+                    break;
+                }
+                indexes.push_back(idx);
+            }
+            return indexes;
+        }
+
+        /**
+         * Builds each of the trees given by ``tree_indexes`` in turn, into a
+         * tree obtained from ``get_new_tree_reference``.
+         */
+        unsigned long get(
+                const std::vector<unsigned long> & tree_indexes,
+                const std::function<TreeT & ()> & get_new_tree_reference) {
+            for (auto tree_idx : tree_indexes) {
+                this->get(tree_idx, get_new_tree_reference());
+            }
+            return tree_indexes.size();
+        }
+
+        /**
+         * Builds each of the trees given by ``tree_indexes`` in turn into
+         * ``tree``, which is cleared before each, and calls ``tree_fn`` with
+         * the tree and its index in the source.
+         */
+        unsigned long get_each(
+                const std::vector<unsigned long> & tree_indexes,
+                TreeT & tree,
+                const std::function<void (TreeT &, unsigned long)> & tree_fn) {
+            for (auto tree_idx : tree_indexes) {
+                tree.clear();
+                this->get(tree_idx, tree);
+                tree_fn(tree, tree_idx);
+            }
+            return tree_indexes.size();
+        }
+
+        unsigned long get_each(
+                const std::vector<unsigned long> & tree_indexes,
+                const std::function<void (TreeT &, unsigned long)> & tree_fn) {
+            TreeT tree;
+            return this->get_each(tree_indexes, tree, tree_fn);
+        }
+
+    private:
+        const NxsFullTreeDescription & get_description(unsigned long tree_idx) const {
+            if (tree_idx >= this->size()) {
+                throw std::out_of_range("platypus::NclTreeCollection: tree index out of range: " + std::to_string(tree_idx));
+            }
+            return this->trees_block_->GetFullTreeDescription(static_cast<unsigned int>(tree_idx));
+        }
+
+        void release_blocks() {
+            if (this->ncl_reader_) {
+                this->ncl_reader_->DeleteBlocksFromFactories();
+            }
+            this->taxa_block_ = nullptr;
+            this->trees_block_ = nullptr;
+        }
+
+    private:
+        NclTreeReader<TreeT, EdgeLengthT>       builder_;
+        std::unique_ptr<MultiFormatReader>      ncl_reader_;
+        NxsTaxaBlock *                          taxa_block_;
+        NxsTreesBlock *                         trees_block_;
+
+}; // NclTreeCollection
+
+template <typename TreeT, class EdgeLengthT>
+NclTreeCollection<TreeT, EdgeLengthT> NclTreeReader<TreeT, EdgeLengthT>::read_lazy(
+        std::istream & src,
+        const std::string & format) {
+    return NclTreeCollection<TreeT, EdgeLengthT>(*this, src, format);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NclCharacterMatrixReader
+
+/**
+ * Reads discrete character data (e.g., the CHARACTERS or DATA block of a
+ * NEXUS source, or a FASTA or PHYLIP alignment) into a platypus
+ * BasicCharacterMatrix. NCL's per-taxon vectors of state codes are
+ * translated into packed state sets through a table built once per source,
+ * so each cell costs a single lookup.
+ */
+class NclCharacterMatrixReader {
+
+    public:
+
+        /**
+         * Parses ``src`` and returns the matrix of the last characters
+         * block parsed, with taxa added to ``taxon_namespace`` (or a
+         * namespace owned by the matrix, if null). Nucleotide and protein
+         * data use CharacterStateAlphabet::dna(), rna() or protein();
+         * other data, an alphabet of the symbols of the block. Gaps and
+         * missing data become the set of all states. Taxa without data are
+         * omitted.
+         *
+         * @tparam MatrixT
+         *   A BasicCharacterMatrix specialization (e.g., CharacterMatrix or
+         *   NucleotideCharacterMatrix).
+         * @param format
+         *   An NCL format name (e.g., "nexus", "dnafasta", "relaxedphylip").
+         * @param compress_patterns
+         *   If true, identical sites are collapsed into weighted patterns
+         *   (see BasicCharacterMatrix::compress_patterns()).
+         */
+        template <class MatrixT>
+        static MatrixT read(std::istream & src,
+                const std::string & format="nexus",
+                TaxonNamespace * taxon_namespace=nullptr,
+                bool compress_patterns=false) {
+            MultiFormatReader reader(-1, NxsReader::IGNORE_WARNINGS);
+            reader.SetWarningOutputLevel(NxsReader::AMBIGUOUS_CONTENT_WARNING);
+            reader.SetCoerceUnderscoresToSpaces(false);
+            reader.ReadStream(src, format.c_str());
+            std::unique_ptr<MultiFormatReader, void (*)(MultiFormatReader *)> blocks(&reader,
+                    [] (MultiFormatReader * r) { r->DeleteBlocksFromFactories(); });
+            unsigned num_taxa_blocks = reader.GetNumTaxaBlocks();
+            NxsTaxaBlock * taxa_block = num_taxa_blocks > 0 ? reader.GetTaxaBlock(num_taxa_blocks - 1) : nullptr;
+            unsigned num_char_blocks = taxa_block ? reader.GetNumCharactersBlocks(taxa_block) : 0;
+            if (num_char_blocks == 0) {
+                throw ReaderException(__FILE__, __LINE__, "platypus::NclCharacterMatrixReader: no character data were parsed");
+            }
+            NxsCharactersBlock * char_block = reader.GetCharactersBlock(taxa_block, num_char_blocks - 1);
+            NxsCharactersBlock::DataTypesEnum data_type = char_block->GetDataType();
+            if (data_type == NxsCharactersBlock::continuous || data_type == NxsCharactersBlock::mixed) {
+                throw ReaderException(__FILE__, __LINE__, "platypus::NclCharacterMatrixReader: only single-datatype, discrete character data are supported");
+            }
+            unsigned num_sites = char_block->GetNCharTotal();
+            const NxsDiscreteDatatypeMapper * mapper = num_sites > 0 ? char_block->GetDatatypeMapperForChar(0) : nullptr;
+            if (mapper == nullptr) {
+                throw ReaderException(__FILE__, __LINE__, "platypus::NclCharacterMatrixReader: no discrete characters");
+            }
+            std::string symbols = mapper->GetSymbols();
+            CharacterStateAlphabet alphabet = get_alphabet(data_type, symbols);
+            MatrixT matrix(alphabet, taxon_namespace);
+            typedef typename MatrixT::state_set_type state_set_type;
+            // state sets of NCL state codes, offset so that the gap code is 0
+            std::vector<state_set_type> code_state_sets;
+            for (NxsDiscreteStateCell code = NXS_GAP_STATE_CODE; code <= mapper->GetHighestStateCode(); ++code) {
+                state_set_type state_set = 0;
+                if (code >= 0) {
+                    for (auto state : mapper->GetStateSetForCode(code)) {
+                        if (state >= 0) {
+                            state_set |= static_cast<state_set_type>(alphabet.get_state_set(symbols[static_cast<std::size_t>(state)]));
+                        }
+                    }
+                }
+                code_state_sets.push_back(state_set == 0 ? matrix.get_all_states_set() : state_set);
+            }
+            matrix.set_num_sites(num_sites);
+            unsigned num_taxa = taxa_block->GetNTax();
+            matrix.reserve(num_taxa);
+            for (unsigned taxon_idx = 0; taxon_idx < num_taxa; ++taxon_idx) {
+                if (!char_block->TaxonIndHasData(taxon_idx)) {
+                    continue;
+                }
+                std::size_t row_idx = matrix.add_row(matrix.taxon_namespace().add_taxon(taxa_block->GetTaxonLabel(taxon_idx).c_str()));
+                state_set_type * row = matrix.row(row_idx);
+                const NxsDiscreteStateRow & codes = char_block->GetDiscreteMatrixRow(taxon_idx);
+                for (unsigned site_idx = 0; site_idx < num_sites && site_idx < codes.size(); ++site_idx) {
+                    row[site_idx] = code_state_sets[static_cast<std::size_t>(codes[site_idx] - NXS_GAP_STATE_CODE)];
+                }
+            }
+            if (compress_patterns) {
+                matrix.compress_patterns();
+            }
+            return matrix;
+        }
+
+    private:
+
+        static CharacterStateAlphabet get_alphabet(NxsCharactersBlock::DataTypesEnum data_type, const std::string & symbols) {
+            if ((data_type == NxsCharactersBlock::dna || data_type == NxsCharactersBlock::nucleotide) && symbols == "ACGT") {
+                return CharacterStateAlphabet::dna();
+            } else if (data_type == NxsCharactersBlock::rna && symbols == "ACGU") {
+                return CharacterStateAlphabet::rna();
+            } else if (data_type == NxsCharactersBlock::protein && symbols == "ACDEFGHIKLMNPQRSTVWY") {
+                return CharacterStateAlphabet::protein();
+            }
+            return CharacterStateAlphabet(symbols, "", true);
+        }
+
+}; // NclCharacterMatrixReader
+
+////////////////////////////////////////////////////////////////////////////////
+// NclDistanceMatrixReader
+
+/**
+ * Reads the last DISTANCES block of a NEXUS source into a condensed
+ * (upper-triangular) TriangularMatrix, e.g., for NeighborJoining. NCL keeps
+ * only the triangle(s) given by the block (by default, the lower one), so
+ * the distance between taxa ``i < j`` is that of cell ``(i, j)`` or, if
+ * this is missing, of cell ``(j, i)``.
+ */
+class NclDistanceMatrixReader {
+
+    public:
+
+        /**
+         * Parses ``src`` and fills ``matrix`` with the distances of the last
+         * distances block parsed, with a row for each taxon of its taxa
+         * block, in order. The taxa are added to ``taxon_namespace``, and
+         * their indexes in it (by row) are returned. Missing distances raise
+         * a ReaderException.
+         */
+        template <class T>
+        static std::vector<TaxonNamespace::index_type> read(std::istream & src,
+                TriangularMatrix<T> & matrix,
+                TaxonNamespace & taxon_namespace,
+                const std::string & format="nexus") {
+            std::unique_ptr<MultiFormatReader> reader = NclReaderSession::create_reader();
+            reader->ReadStream(src, format.c_str());
+            std::unique_ptr<MultiFormatReader, void (*)(MultiFormatReader *)> blocks(reader.get(),
+                    [] (MultiFormatReader * r) { r->DeleteBlocksFromFactories(); });
+            unsigned num_taxa_blocks = reader->GetNumTaxaBlocks();
+            NxsTaxaBlock * taxa_block = num_taxa_blocks > 0 ? reader->GetTaxaBlock(num_taxa_blocks - 1) : nullptr;
+            unsigned num_distances_blocks = taxa_block ? reader->GetNumDistancesBlocks(taxa_block) : 0;
+            if (num_distances_blocks == 0) {
+                throw ReaderException(__FILE__, __LINE__, "platypus::NclDistanceMatrixReader: no distances were parsed");
+            }
+            const NxsDistancesBlock * distances_block = reader->GetDistancesBlock(taxa_block, num_distances_blocks - 1);
+            unsigned num_taxa = taxa_block->GetNumTaxonLabels();
+            std::vector<TaxonNamespace::index_type> taxon_indexes;
+            taxon_indexes.reserve(num_taxa);
+            for (unsigned taxon_idx = 0; taxon_idx < num_taxa; ++taxon_idx) {
+                taxon_indexes.push_back(taxon_namespace.add_taxon(taxa_block->GetTaxonLabel(taxon_idx).c_str()));
+            }
+            matrix.resize(num_taxa);
+            for (unsigned i = 0; i < num_taxa; ++i) {
+                for (unsigned j = i + 1; j < num_taxa; ++j) {
+                    if (!distances_block->IsMissing(i, j)) {
+                        matrix.set(i, j, static_cast<T>(distances_block->GetDistance(i, j)));
+                    } else if (!distances_block->IsMissing(j, i)) {
+                        matrix.set(i, j, static_cast<T>(distances_block->GetDistance(j, i)));
+                    } else {
+                        throw ReaderException(__FILE__, __LINE__, "platypus::NclDistanceMatrixReader: missing distance between '"
+                                + taxon_namespace.get_label(taxon_indexes[i]) + "' and '" + taxon_namespace.get_label(taxon_indexes[j]) + "'");
+                    }
+                }
+            }
+            return taxon_indexes;
+        }
+
+        template <class T>
+        static std::vector<TaxonNamespace::index_type> read(std::istream && src,
+                TriangularMatrix<T> & matrix,
+                TaxonNamespace & taxon_namespace,
+                const std::string & format="nexus") {
+            return read(src, matrix, taxon_namespace, format);
+        }
+
+}; // NclDistanceMatrixReader
+
 } // namespace platypus
 
 #endif
@@ -23,10 +23,20 @@
 #define PLATYPUS_PARSE_NEWICK_HPP
 
 #include <stdlib.h>
+#include <algorithm>
+#include <cstring>
 #include <exception>
+#include <iterator>
 #include <string>
+#include <type_traits>
+#include <vector>
 #include "../utility/tokenizer.hpp"
+#include "../utility/mappedfile.hpp"
+#include "../utility/numberparsing.hpp"
+#include "../utility/parallel.hpp"
 #include "../base/base_reader.hpp"
+#include "../model/standardinterface.hpp"
+#include "../model/nodeattributes.hpp"
 
 namespace platypus {
 
@@ -75,27 +85,745 @@ class NewickReaderMalformedStatementError : public NewickReaderException {
 /**
  * Parses NEWICK tree data sources and instantiates corresponding tree objects.
  */
-template <typename TreeT, typename EdgeLengthT=double>
+template <typename TreeT, typename EdgeLengthT=double, typename SettersT=FunctionSetters>
 class NewickReader : public BaseTreeReader<TreeT, EdgeLengthT> {
 
     public:
         typedef TreeT                          tree_type;
         typedef typename tree_type::node_type  tree_node_type;
         typedef typename tree_type::value_type tree_value_type;
+        typedef SettersT                       setters_type;
+        typedef std::function<void (tree_type &, unsigned long, const NodeAttributeTable &)> node_attributes_fntype;
+
+        // If true, node labels and edge lengths are set through ``SettersT``
+        // (see platypus::FunctionSetters), and the setter function objects
+        // are ignored.
+        static const bool has_static_setters = !std::is_same<SettersT, FunctionSetters>::value;
 
     public:
 
-        NewickReader() : BaseTreeReader<TreeT, EdgeLengthT>() { }
+        NewickReader()
+            : BaseTreeReader<TreeT, EdgeLengthT>()
+            , recursive_parsing_(false)
+            , prescan_node_counts_(false) {
+            this->set_capture_comments(false);
+        }
         ~NewickReader() { }
 
+        //////////////////////////////////////////////////////////////////////////////
+        // Configuration
+
+        /**
+         * By default, nodes are parsed using an explicit stack, so that the
+         * depth of nesting that can be parsed is not limited by the size of
+         * the call stack. If ``recursive_parsing`` is true, then a recursive
+         * descent parser is used instead (which may be marginally faster on
+         * shallow trees).
+         */
+        void set_recursive_parsing(bool recursive_parsing) {
+            this->recursive_parsing_ = recursive_parsing;
+        }
+        bool get_recursive_parsing() const {
+            return this->recursive_parsing_;
+        }
+
+        /**
+         * If ``prescan_node_counts`` is true, then when reading from a
+         * buffer (read_buffer(), read_file(), read_parallel()), the
+         * parentheses and commas of each tree statement (outside quotes and
+         * comments) are first counted, and storage for that many nodes is
+         * reserved in the tree before it is built (see Tree::reserve_nodes()),
+         * so that, e.g., a platypus::TreeNodeArena allocates a single slab
+         * per tree. The count is exact for well-formed statements, and only
+         * a hint otherwise. Reading from streams is unaffected.
+         */
+        void set_prescan_node_counts(bool prescan_node_counts) {
+            this->prescan_node_counts_ = prescan_node_counts;
+        }
+        bool get_prescan_node_counts() const {
+            return this->prescan_node_counts_;
+        }
+
+        /**
+         * Sets whether the tokenizers capture the text of comments. Nothing
+         * in the reader itself makes use of comments, so by default they are
+         * not captured, but only skipped over, which saves building strings
+         * for e.g. the per-node annotations of BEAST trees.
+         */
+        void set_capture_comments(bool capture_comments) {
+            this->tokenizer_.set_capture_comments(capture_comments);
+            this->buffer_tokenizer_.set_capture_comments(capture_comments);
+        }
+        bool get_capture_comments() const {
+            return this->buffer_tokenizer_.get_capture_comments();
+        }
+
+        /**
+         * Binds a function that is called with each tree, its index, and the
+         * metadata of its nodes (NHX or BEAST-style "[&key=value,...]"
+         * comments, see platypus::NodeAttributeTable) after the tree has been
+         * built, but before the post-processing function is called. Turns on
+         * comment capture (see set_capture_comments()), as metadata is parsed
+         * from the captured comments as they are read.
+         *
+         * Comments preceding a node, or following its label, closing
+         * parenthesis or edge length, belong to the node; comments preceding
+         * the opening parenthesis of the tree statement (e.g., "[&R]") are
+         * ignored. Nodes are indexed in the order in which they are created,
+         * i.e. in preorder, with the root at 0.
+         *
+         * The table passed is owned by the reader, and reused for each tree.
+         */
+        void set_node_attributes_fn(const node_attributes_fntype & node_attributes_fn) {
+            this->node_attributes_fn_ = node_attributes_fn;
+            this->set_capture_comments(true);
+        }
+        void clear_node_attributes_fn() {
+            this->node_attributes_fn_ = nullptr;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Buffer reading interface
+
+        /**
+         * Reads trees from the ``size`` characters starting at ``data``,
+         * creating tree objects using `get_new_tree_reference` (see
+         * BaseTreeReader::read()). This avoids the per-character stream
+         * overhead of reading from a std::istream, as tokens are taken
+         * directly from the buffer (see platypus::BufferTokenizer).
+         *
+         * @return
+         *   The number of trees read.
+         */
+        unsigned long read_buffer(
+                const char * data,
+                std::size_t size,
+                const std::function<TreeT & ()> & get_new_tree_reference,
+                unsigned long tree_limit=0) {
+            NexusBufferTokenizer::iterator src_iter = this->buffer_tokenizer_.begin(data, size);
+            unsigned long tree_count = this->parse_token_stream(src_iter, get_new_tree_reference, tree_limit);
+            this->stats_.record_bytes_read(static_cast<unsigned long>(src_iter.position() - data));
+            this->stats_.record_tokens(src_iter.num_tokens(), src_iter.num_comments());
+            return tree_count;
+        }
+
+        unsigned long read_buffer(
+                const std::string & src,
+                const std::function<TreeT & ()> & get_new_tree_reference,
+                unsigned long tree_limit=0) {
+            return this->read_buffer(src.data(), src.size(), get_new_tree_reference, tree_limit);
+        }
+
+        /**
+         * Reads trees from the file at ``path``, which is memory-mapped (see
+         * platypus::MappedFile) and tokenized in place.
+         *
+         * @return
+         *   The number of trees read.
+         */
+        unsigned long read_file(
+                const std::string & path,
+                const std::function<TreeT & ()> & get_new_tree_reference,
+                unsigned long tree_limit=0) {
+            MappedFile src(path);
+            return this->read_buffer(src.data(), src.size(), get_new_tree_reference, tree_limit);
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Parallel reading interface
+
+        /**
+         * Reads trees from the ``size`` characters starting at ``data``,
+         * parsing multiple tree statements concurrently using
+         * ``num_threads`` threads (if 0, the number of hardware threads
+         * available).
+         *
+         * The buffer is pre-scanned for tree statement boundaries, i.e.
+         * semi-colons that are not in quotes or comments, and statements are
+         * parsed in batches by worker threads into private TreeT objects.
+         * These are then move-assigned, in input order and in the calling
+         * thread, into the objects returned by `get_new_tree_reference`
+         * (see BaseTreeReader::read()), after which the post-processing
+         * function is called (also in the calling thread). TreeT must hence
+         * be default-constructible and (preferably, move-) assignable.
+         *
+         * The node label and edge length setter functions *are* called from
+         * the worker threads, and so must be safe to call concurrently on
+         * different node values.
+         *
+         * Tree statements excluded by BaseTreeReader::set_skip_first() or
+         * BaseTreeReader::set_every_nth() are identified by the pre-scan,
+         * and never handed to the worker threads.
+         *
+         * If a parse error occurs, all trees preceding the erroneous
+         * statement are delivered before the exception is rethrown in the
+         * calling thread.
+         *
+         * @return
+         *   The number of trees read.
+         */
+        unsigned long read_parallel(
+                const char * data,
+                std::size_t size,
+                const std::function<TreeT & ()> & get_new_tree_reference,
+                unsigned int num_threads=0,
+                unsigned long tree_limit=0) {
+            num_threads = resolve_num_threads(num_threads);
+            const std::size_t max_batch_size = num_threads * 16;
+            std::vector<std::pair<const char *, const char *>> statements;
+            statements.reserve(max_batch_size);
+            std::vector<ParsedTreeStatements> parsed(max_batch_size);
+            const char * pos = data;
+            const char * end = data + size;
+            unsigned long tree_count = 0;
+            unsigned long statement_count = 0;
+            while (pos < end) {
+                std::size_t batch_size = max_batch_size;
+                if (tree_limit > 0 && tree_limit - tree_count < batch_size) {
+                    batch_size = tree_limit - tree_count;
+                }
+                statements.clear();
+                const char * batch_begin = pos;
+                InstrumentationTimer scan_timer(this->stats_.scan_seconds);
+                while (pos < end && statements.size() < batch_size) {
+                    const char * statement_end = this->buffer_tokenizer_.find_statement_end(pos, end);
+                    // empty statements (e.g., repeated semi-colons) are not
+                    // counted when skipping
+                    if ((this->skip_first_ == 0 && this->every_nth_ == 1)
+                            || (this->has_tree_statement(pos, statement_end)
+                                && !this->is_statement_skipped(statement_count++))) {
+                        statements.push_back(std::make_pair(pos, statement_end));
+                    }
+                    pos = statement_end;
+                }
+                scan_timer.stop();
+                this->stats_.record_bytes_read(static_cast<unsigned long>(pos - batch_begin));
+                InstrumentationTimer build_timer(this->stats_.build_seconds);
+                parallel_for(statements.size(), num_threads, [this, &statements, &parsed] (std::size_t idx) {
+                    auto & result = parsed[idx];
+                    result.trees.clear();
+                    result.summaries.clear();
+                    result.error = nullptr;
+                    result.num_tokens = 0;
+                    result.num_comments = 0;
+                    try {
+                        this->parse_tree_statements(statements[idx].first,
+                                statements[idx].second,
+                                result);
+                    } catch (...) {
+                        result.error = std::current_exception();
+                    }
+                });
+                build_timer.stop();
+                for (std::size_t idx = 0; idx < statements.size(); ++idx) {
+                    if (this->deliver_tree_statements(parsed[idx], get_new_tree_reference, tree_count, tree_limit)) {
+                        return tree_count;
+                    }
+                }
+            }
+            return tree_count;
+        }
+
+        unsigned long read_parallel(
+                const std::string & src,
+                const std::function<TreeT & ()> & get_new_tree_reference,
+                unsigned int num_threads=0,
+                unsigned long tree_limit=0) {
+            return this->read_parallel(src.data(), src.size(), get_new_tree_reference, num_threads, tree_limit);
+        }
+
+        // Reads the entire stream into memory before parsing.
+        unsigned long read_parallel(
+                std::istream & src,
+                const std::function<TreeT & ()> & get_new_tree_reference,
+                unsigned int num_threads=0,
+                unsigned long tree_limit=0) {
+            std::string buffer((std::istreambuf_iterator<char>(src)), std::istreambuf_iterator<char>());
+            return this->read_parallel(buffer.data(), buffer.size(), get_new_tree_reference, num_threads, tree_limit);
+        }
+
+        // overload for binding `src` to temporary
+        unsigned long read_parallel(
+                std::istream && src,
+                const std::function<TreeT & ()> & get_new_tree_reference,
+                unsigned int num_threads=0,
+                unsigned long tree_limit=0) {
+            return this->read_parallel(src, get_new_tree_reference, num_threads, tree_limit);
+        }
+
+        unsigned long read_file_parallel(
+                const std::string & path,
+                const std::function<TreeT & ()> & get_new_tree_reference,
+                unsigned int num_threads=0,
+                unsigned long tree_limit=0) {
+            MappedFile src(path);
+            return this->read_parallel(src.data(), src.size(), get_new_tree_reference, num_threads, tree_limit);
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Pipelined reading interface
+
+        /**
+         * Reads trees from the stream ``src`` in three overlapping stages, so
+         * that waiting on the source (e.g., on a network filesystem or a
+         * decompressing stream) does not stall parsing, and vice versa:
+         *
+         *  - an I/O thread reads the source in chunks of ``chunk_size``
+         *    characters;
+         *  - a scanner thread splits the chunks into tree statements (see
+         *    read_parallel()), applying the skip and thinning settings, and
+         *    groups them into batches;
+         *  - ``num_threads`` builder threads (if 0, the number of hardware
+         *    threads available) parse the batches into private TreeT
+         *    objects.
+         *
+         * Trees are handed over in input order, and post-processed, in the
+         * calling thread, as for read_parallel(), with the same
+         * requirements on TreeT and on the setter functions. Stages are
+         * connected by bounded queues (see platypus::BoundedQueue), and at
+         * most ``4 * num_threads`` batches are in flight at a time, so that
+         * memory use is bounded however far the source outpaces the
+         * builders, or the builders the caller.
+         *
+         * Unlike read_parallel(), the source is never held in memory in its
+         * entirety (only a single tree statement need fit in memory). If
+         * reading from ``src`` fails, or a parse error occurs, all trees
+         * preceding the point of failure are delivered before the exception
+         * is rethrown in the calling thread.
+         *
+         * If instrumentation is enabled, ``scan_seconds`` and
+         * ``build_seconds`` are the times spent busy by the scanner and
+         * (summed over threads) builder stages respectively.
+         *
+         * @return
+         *   The number of trees read.
+         */
+        unsigned long read_pipelined(
+                std::istream & src,
+                const std::function<TreeT & ()> & get_new_tree_reference,
+                unsigned int num_threads=0,
+                unsigned long tree_limit=0,
+                std::size_t chunk_size=1 << 20) {
+            num_threads = resolve_num_threads(num_threads);
+            if (chunk_size == 0) {
+                chunk_size = 1;
+            }
+            const std::size_t max_batches_in_flight = num_threads * 4;
+            const std::size_t batch_size = std::max(chunk_size / num_threads, static_cast<std::size_t>(4096));
+            PipelineState state(max_batches_in_flight);
+            std::vector<std::thread> threads;
+            // tears down the pipeline on every exit from this function
+            struct PipelineGuard {
+                PipelineState & state;
+                std::vector<std::thread> & threads;
+                ~PipelineGuard() {
+                    this->stop();
+                }
+                void stop() {
+                    {
+                        std::lock_guard<std::mutex> lock(state.mutex);
+                        state.is_stopped = true;
+                    }
+                    state.slot_freed.notify_all();
+                    state.chunks.cancel();
+                    state.batches.cancel();
+                    for (auto & t : threads) {
+                        t.join();
+                    }
+                    threads.clear();
+                }
+            } guard{state, threads};
+            threads.emplace_back([&state, &src, chunk_size] () {
+                NewickReader::run_pipeline_reader(state, src, chunk_size);
+            });
+            threads.emplace_back([this, &state, batch_size] () {
+                this->run_pipeline_scanner(state, batch_size);
+            });
+            for (unsigned int i = 0; i < num_threads; ++i) {
+                threads.emplace_back([this, &state] () {
+                    this->run_pipeline_builder(state);
+                });
+            }
+            unsigned long tree_count = 0;
+            for (std::size_t batch_idx = 0; ; ++batch_idx) {
+                std::size_t slot_idx = batch_idx % state.slots.size();
+                {
+                    std::unique_lock<std::mutex> lock(state.mutex);
+                    state.slot_filled.wait(lock, [&state, slot_idx, batch_idx] () {
+                        return state.is_slot_filled[slot_idx]
+                            || (state.is_scan_complete && batch_idx >= state.num_batches);
+                    });
+                    if (!state.is_slot_filled[slot_idx]) {
+                        break;
+                    }
+                }
+                if (this->deliver_tree_statements(state.slots[slot_idx], get_new_tree_reference, tree_count, tree_limit)) {
+                    return tree_count;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(state.mutex);
+                    state.is_slot_filled[slot_idx] = false;
+                    state.num_batches_delivered = batch_idx + 1;
+                }
+                state.slot_freed.notify_all();
+            }
+            guard.stop();
+            this->stats_.record_bytes_read(state.num_bytes_read);
+            this->stats_.scan_seconds += state.scan_seconds;
+            this->stats_.build_seconds += state.build_seconds;
+            if (state.error) {
+                std::rethrow_exception(state.error);
+            }
+            return tree_count;
+        }
+
+        // overload for binding `src` to temporary
+        unsigned long read_pipelined(
+                std::istream && src,
+                const std::function<TreeT & ()> & get_new_tree_reference,
+                unsigned int num_threads=0,
+                unsigned long tree_limit=0,
+                std::size_t chunk_size=1 << 20) {
+            return this->read_pipelined(src, get_new_tree_reference, num_threads, tree_limit, chunk_size);
+        }
+
     protected:
 
+        // Node and length counts of a parsed tree statement, as passed to the
+        // post-processing function.
+        struct TreeStatementSummary {
+            unsigned long   num_leaf_nodes;
+            unsigned long   num_internal_nodes;
+            EdgeLengthT     tree_length;
+        };
+
+        // Trees parsed by a worker thread from a single chunk of the source.
+        struct ParsedTreeStatements {
+            std::vector<TreeT>                  trees;
+            std::vector<TreeStatementSummary>   summaries;
+            std::exception_ptr                  error;
+            unsigned long                       num_tokens;
+            unsigned long                       num_comments;
+            // per tree, if metadata is extracted; kept across batches so
+            // that storage is reused
+            std::vector<NodeAttributeTable>     attributes;
+        };
+
+        // Hands the trees in ``result`` over, in order, to the objects
+        // returned by `get_new_tree_reference`, calling the post-processing
+        // function on each, and then rethrows the error that ended the
+        // parse of ``result``, if any. Returns true if ``tree_limit`` has
+        // been reached.
+        bool deliver_tree_statements(ParsedTreeStatements & result,
+                const std::function<TreeT & ()> & get_new_tree_reference,
+                unsigned long & tree_count,
+                unsigned long tree_limit) {
+            this->stats_.record_tokens(result.num_tokens, result.num_comments);
+            for (std::size_t tree_idx = 0; tree_idx < result.summaries.size(); ++tree_idx) {
+                auto & tree = get_new_tree_reference();
+                tree = std::move(result.trees[tree_idx]);
+                auto & summary = result.summaries[tree_idx];
+                this->stats_.record_tree(summary.num_leaf_nodes + summary.num_internal_nodes);
+                if (this->node_attributes_fn_) {
+                    this->node_attributes_fn_(tree, tree_count, result.attributes[tree_idx]);
+                }
+                this->postprocess_tree(tree,
+                        tree_count,
+                        summary.num_leaf_nodes,
+                        summary.num_internal_nodes,
+                        summary.tree_length);
+                ++tree_count;
+                if (tree_limit > 0 && tree_count >= tree_limit) {
+                    return true;
+                }
+            }
+            if (result.error) {
+                std::rethrow_exception(result.error);
+            }
+            return false;
+        }
+
+        // A run of consecutive tree statements, as passed from the scanner
+        // to the builders of a pipelined read.
+        struct PipelineBatch {
+            std::size_t     batch_idx;
+            std::string     text;
+        };
+
+        // State shared by the stages of read_pipelined(). Batch
+        // ``batch_idx`` is parsed into ``slots[batch_idx % slots.size()]``;
+        // the scanner only releases a batch once the batch that last used
+        // its slot has been delivered.
+        struct PipelineState {
+            PipelineState(std::size_t max_batches_in_flight)
+                : chunks(4)
+                , batches(max_batches_in_flight)
+                , slots(max_batches_in_flight)
+                , is_slot_filled(max_batches_in_flight, false)
+                , num_batches_delivered(0)
+                , num_batches(0)
+                , is_scan_complete(false)
+                , is_stopped(false)
+                , num_bytes_read(0)
+                , scan_seconds(0.0)
+                , build_seconds(0.0) { }
+            BoundedQueue<std::string>           chunks;
+            BoundedQueue<PipelineBatch>         batches;
+            std::vector<ParsedTreeStatements>   slots;
+            // guarded by ``mutex``
+            std::vector<bool>                   is_slot_filled;
+            std::size_t                         num_batches_delivered;
+            std::size_t                         num_batches;
+            bool                                is_scan_complete;
+            bool                                is_stopped;
+            std::exception_ptr                  read_error;
+            std::exception_ptr                  error;
+            std::mutex                          mutex;
+            std::condition_variable             slot_filled;
+            std::condition_variable             slot_freed;
+            // written by the scanner and builder stages, read once they
+            // have been joined
+            unsigned long                       num_bytes_read;
+            double                              scan_seconds;
+            double                              build_seconds;
+        };
+
+        // I/O stage of read_pipelined().
+        static void run_pipeline_reader(PipelineState & state,
+                std::istream & src,
+                std::size_t chunk_size) {
+            std::exception_ptr error;
+            while (src && !error) {
+                std::string chunk(chunk_size, '\0');
+                try {
+                    src.read(&chunk[0], static_cast<std::streamsize>(chunk_size));
+                    if (src.bad()) {
+                        throw ReaderException(__FILE__, __LINE__, "platypus::NewickReader: error reading from source");
+                    }
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                // pass on whatever was extracted before a failure
+                chunk.resize(static_cast<std::size_t>(src.gcount()));
+                if (chunk.empty()) {
+                    break;
+                }
+                if (!state.chunks.push(std::move(chunk))) {
+                    return;
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.read_error = error;
+            }
+            state.chunks.close();
+        }
+
+        // Scanner stage of read_pipelined(). Statements that span chunks are
+        // carried over; so that a long statement is not rescanned from its
+        // beginning with every new chunk, scanning resumes only once the
+        // carried-over text has at least doubled in size.
+        void run_pipeline_scanner(PipelineState & state, std::size_t batch_size) {
+            std::size_t batch_idx = 0;
+            std::exception_ptr error;
+            try {
+                const bool is_filtering = this->skip_first_ != 0 || this->every_nth_ != 1;
+                unsigned long statement_count = 0;
+                std::string pending;
+                std::size_t rescan_size = 0;
+                PipelineBatch batch;
+                auto publish_batch = [&state, &batch, &batch_idx] () -> bool {
+                    if (batch.text.empty()) {
+                        return true;
+                    }
+                    {
+                        std::unique_lock<std::mutex> lock(state.mutex);
+                        state.slot_freed.wait(lock, [&state, &batch_idx] () {
+                            return state.is_stopped
+                                || batch_idx < state.num_batches_delivered + state.slots.size();
+                        });
+                        if (state.is_stopped) {
+                            return false;
+                        }
+                    }
+                    batch.batch_idx = batch_idx;
+                    if (!state.batches.push(std::move(batch))) {
+                        return false;
+                    }
+                    ++batch_idx;
+                    batch.text.clear();
+                    return true;
+                };
+                auto add_statement = [this, &batch, &statement_count, is_filtering] (const char * begin, const char * end) {
+                    if (!is_filtering
+                            || (this->has_tree_statement(begin, end)
+                                && !this->is_statement_skipped(statement_count++))) {
+                        batch.text.append(begin, end);
+                    }
+                };
+                std::string chunk;
+                while (state.chunks.pop(chunk)) {
+                    state.num_bytes_read += chunk.size();
+                    pending.append(chunk);
+                    if (pending.size() < rescan_size) {
+                        continue;
+                    }
+                    InstrumentationTimer scan_timer(state.scan_seconds);
+                    const char * begin = pending.data();
+                    const char * end = begin + pending.size();
+                    const char * pos = begin;
+                    while (pos < end) {
+                        const char * statement_end = this->buffer_tokenizer_.find_statement_end(pos, end);
+                        // a statement running up to the end of the text may
+                        // yet continue in the next chunk
+                        if (statement_end == end) {
+                            break;
+                        }
+                        add_statement(pos, statement_end);
+                        pos = statement_end;
+                        if (batch.text.size() >= batch_size) {
+                            scan_timer.stop();
+                            if (!publish_batch()) {
+                                return;
+                            }
+                        }
+                    }
+                    pending.erase(0, static_cast<std::size_t>(pos - begin));
+                    rescan_size = 2 * pending.size();
+                    scan_timer.stop();
+                    if (!publish_batch()) {
+                        return;
+                    }
+                }
+                bool is_read_complete = false;
+                {
+                    std::lock_guard<std::mutex> lock(state.mutex);
+                    is_read_complete = !state.read_error;
+                }
+                if (is_read_complete) {
+                    // the final statement, terminated or not
+                    const char * begin = pending.data();
+                    const char * end = begin + pending.size();
+                    const char * pos = begin;
+                    while (pos < end) {
+                        const char * statement_end = this->buffer_tokenizer_.find_statement_end(pos, end);
+                        add_statement(pos, statement_end);
+                        pos = statement_end;
+                    }
+                    if (!publish_batch()) {
+                        return;
+                    }
+                }
+            } catch (...) {
+                error = std::current_exception();
+                state.chunks.cancel();
+            }
+            state.batches.close();
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.is_scan_complete = true;
+                state.num_batches = batch_idx;
+                state.error = error ? error : state.read_error;
+            }
+            state.slot_filled.notify_all();
+        }
+
+        // Builder stage of read_pipelined().
+        void run_pipeline_builder(PipelineState & state) {
+            PipelineBatch batch;
+            double build_seconds = 0.0;
+            while (state.batches.pop(batch)) {
+                std::size_t slot_idx = batch.batch_idx % state.slots.size();
+                auto & result = state.slots[slot_idx];
+                result.trees.clear();
+                result.summaries.clear();
+                result.error = nullptr;
+                result.num_tokens = 0;
+                result.num_comments = 0;
+                {
+                    InstrumentationTimer build_timer(build_seconds);
+                    try {
+                        this->parse_tree_statements(batch.text.data(),
+                                batch.text.data() + batch.text.size(),
+                                result);
+                    } catch (...) {
+                        result.error = std::current_exception();
+                    }
+                }
+                {
+                    std::lock_guard<std::mutex> lock(state.mutex);
+                    state.is_slot_filled[slot_idx] = true;
+                }
+                state.slot_filled.notify_all();
+            }
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.build_seconds += build_seconds;
+        }
+
+        // Whether [begin, end) holds anything other than semi-colons,
+        // whitespace and comments.
+        bool has_tree_statement(const char * begin, const char * end) {
+            NexusBufferTokenizer::iterator src_iter = this->buffer_tokenizer_.begin(begin, end);
+            while (!src_iter.eof() && *src_iter == ";") {
+                ++src_iter;
+            }
+            return !src_iter.eof();
+        }
+
+        // Parses all trees in [begin, end) into ``result``, without calling
+        // the post-processing function.
+        void parse_tree_statements(const char * begin,
+                const char * end,
+                ParsedTreeStatements & result) {
+            NexusBufferTokenizer::iterator src_iter = this->buffer_tokenizer_.begin(begin, end);
+            while (!src_iter.eof() && *src_iter == ";") {
+                ++src_iter;
+            }
+            while (!src_iter.eof()) {
+                result.trees.emplace_back();
+                NodeAttributeTable * attributes = nullptr;
+                if (this->node_attributes_fn_) {
+                    if (result.attributes.size() < result.trees.size()) {
+                        result.attributes.resize(result.trees.size());
+                    }
+                    attributes = &result.attributes[result.trees.size() - 1];
+                }
+                TreeStatementSummary summary;
+                this->parse_tree_statement(result.trees.back(),
+                        src_iter,
+                        summary.num_leaf_nodes,
+                        summary.num_internal_nodes,
+                        summary.tree_length,
+                        attributes);
+                result.summaries.push_back(summary);
+            }
+            result.num_tokens = src_iter.num_tokens();
+            result.num_comments = src_iter.num_comments();
+        }
+
         unsigned long parse_stream(
                 std::istream & src,
                 const std::function<tree_type & ()> & get_new_tree_reference,
                 unsigned long tree_limit=0) override {
-            NexusTokenizer::iterator src_iter = this->tokenizer_.begin(src);
+            std::streampos start = this->get_instrumentation_position(src);
+            NewickTokenizer::iterator src_iter = this->tokenizer_.begin(src);
+            unsigned long tree_count = this->parse_token_stream(src_iter, get_new_tree_reference, tree_limit);
+            this->record_stream_bytes_read(src, start);
+            this->stats_.record_tokens(src_iter.num_tokens(), src_iter.num_comments());
+            return tree_count;
+        }
+
+        /**
+         * Parses all tree statements from a token stream (that of a
+         * platypus::Tokenizer or platypus::BufferTokenizer).
+         */
+        template <class TokenIteratorT>
+        unsigned long parse_token_stream(
+                TokenIteratorT & src_iter,
+                const std::function<tree_type & ()> & get_new_tree_reference,
+                unsigned long tree_limit=0) {
             unsigned long tree_count = 0;
+            unsigned long statement_count = 0;
             // skip over leading semi-colons
             while (!src_iter.eof() && *src_iter == ";") {
                 ++src_iter;
@@ -103,7 +831,14 @@ class NewickReader : public BaseTreeReader<TreeT, EdgeLengthT> {
             if (src_iter.eof()) {
                 return 0;
             }
-            while (src_iter != this->tokenizer_.end()) {
+            while (!src_iter.eof()) {
+                if (this->is_statement_skipped(statement_count++)) {
+                    src_iter.skip_past(';');
+                    while (!src_iter.eof() && *src_iter == ";") {
+                        ++src_iter;
+                    }
+                    continue;
+                }
                 auto & tree = get_new_tree_reference();
                 this->parse_tree_from_stream(tree, src_iter, tree_count);
                 ++tree_count;
@@ -127,27 +862,82 @@ class NewickReader : public BaseTreeReader<TreeT, EdgeLengthT> {
          *   An iterator over the token stream. Expects the current token to
          *   be the first parenthesis of a tree statement.
          */
+        template <class TokenIteratorT>
         tree_type & parse_tree_from_stream(TreeT & tree,
-                NexusTokenizer::iterator & src_iter,
+                TokenIteratorT & src_iter,
                 unsigned long tree_count=0) {
-            if (*src_iter != "(") {
-                throw NewickReaderInvalidTokenError(__FILE__, __LINE__, *src_iter);
-            }
             unsigned long num_leaf_nodes = 0;
-            unsigned long num_internal_nodes = 1; // start at one to count root
+            unsigned long num_internal_nodes = 0;
             EdgeLengthT tree_length = 0.0;
-            this->parse_node_from_stream(tree,
-                    tree.head_node(),
+            NodeAttributeTable * attributes = this->node_attributes_fn_ ? &this->node_attributes_ : nullptr;
+            InstrumentationTimer build_timer(this->stats_.build_seconds);
+            this->parse_tree_statement(tree,
                     src_iter,
                     num_leaf_nodes,
                     num_internal_nodes,
-                    tree_length);
+                    tree_length,
+                    attributes);
+            build_timer.stop();
+            this->stats_.record_tree(num_leaf_nodes + num_internal_nodes);
+            if (attributes != nullptr) {
+                this->node_attributes_fn_(tree, tree_count, *attributes);
+            }
             this->postprocess_tree(tree, tree_count, num_leaf_nodes, num_internal_nodes, tree_length);
+            return tree;
+        }
+
+        /**
+         * As parse_tree_from_stream(), but without calling the
+         * post-processing function: instead, the node counts and tree length
+         * are returned in ``num_leaf_nodes``, ``num_internal_nodes`` and
+         * ``tree_length``. If ``attributes`` is given, it is cleared, and
+         * the metadata of the nodes is extracted into it.
+         */
+        template <class TokenIteratorT>
+        void parse_tree_statement(TreeT & tree,
+                TokenIteratorT & src_iter,
+                unsigned long & num_leaf_nodes,
+                unsigned long & num_internal_nodes,
+                EdgeLengthT & tree_length,
+                NodeAttributeTable * attributes=nullptr) {
+            if (*src_iter != "(") {
+                throw NewickReaderInvalidTokenError(__FILE__, __LINE__, *src_iter);
+            }
+            if (this->prescan_node_counts_) {
+                this->reserve_statement_nodes(tree, src_iter);
+            }
+            num_leaf_nodes = 0;
+            num_internal_nodes = 1; // start at one to count root
+            tree_length = 0.0;
+            if (attributes != nullptr) {
+                attributes->clear();
+                // tree-level comments, e.g. "[&R]"
+                src_iter.clear_captured_comments();
+            }
+            if (this->recursive_parsing_) {
+                this->parse_node_from_stream(tree,
+                        tree.head_node(),
+                        src_iter,
+                        num_leaf_nodes,
+                        num_internal_nodes,
+                        tree_length,
+                        attributes);
+            } else {
+                this->parse_node_from_stream_iterative(tree,
+                        tree.head_node(),
+                        src_iter,
+                        num_leaf_nodes,
+                        num_internal_nodes,
+                        tree_length,
+                        attributes);
+            }
+            if (attributes != nullptr) {
+                attributes->set_num_nodes(static_cast<NodeAttributeTable::index_type>(num_leaf_nodes + num_internal_nodes));
+            }
             // skip over multiple consecutive trailing semi-colons
             while (!src_iter.eof() && *src_iter == ";") {
                 ++src_iter;
             }
-            return tree;
         }
 
         /**
@@ -161,13 +951,18 @@ class NewickReader : public BaseTreeReader<TreeT, EdgeLengthT> {
          * or the comma following a leaf label or the token following the
          * semi-colon terminating a tree statement.
          */
+        template <class TokenIteratorT>
         tree_node_type * parse_node_from_stream(
                 tree_type & tree,
                 tree_node_type * current_node,
-                NexusTokenizer::iterator & src_iter,
+                TokenIteratorT & src_iter,
                 unsigned long & num_leaf_nodes,
                 unsigned long & num_internal_nodes,
-                EdgeLengthT & tree_length) {
+                EdgeLengthT & tree_length,
+                NodeAttributeTable * attributes) {
+            // the current node is the last one created
+            unsigned long node_index = num_leaf_nodes + num_internal_nodes - 1;
+            this->extract_node_attributes(src_iter, attributes, node_index);
             if (*src_iter == "(") {
                 // begin processing of child nodes
                 // if (src_iter.eof()) {
@@ -186,6 +981,7 @@ class NewickReader : public BaseTreeReader<TreeT, EdgeLengthT> {
                             // preceding blank node
                             current_node->add_child(tree.create_leaf_node());
                             ++num_leaf_nodes;
+                            this->extract_node_attributes(src_iter, attributes, num_leaf_nodes + num_internal_nodes - 1);
                             // do not flag node as created to allow for an extra node to be created in the event of (..,)
                         }
                         src_iter.require_next();
@@ -193,6 +989,7 @@ class NewickReader : public BaseTreeReader<TreeT, EdgeLengthT> {
                             // another blank node
                             auto new_node = tree.create_leaf_node();
                             ++num_leaf_nodes;
+                            this->extract_node_attributes(src_iter, attributes, num_leaf_nodes + num_internal_nodes - 1);
                             current_node->add_child(new_node);
                             src_iter.require_next();
                             node_created = true;
@@ -201,6 +998,7 @@ class NewickReader : public BaseTreeReader<TreeT, EdgeLengthT> {
                             // end of node
                             current_node->add_child(tree.create_leaf_node());
                             ++num_leaf_nodes;
+                            this->extract_node_attributes(src_iter, attributes, num_leaf_nodes + num_internal_nodes - 1);
                             node_created = true;
                         }
                     } else if (*src_iter == ")") {
@@ -219,7 +1017,8 @@ class NewickReader : public BaseTreeReader<TreeT, EdgeLengthT> {
                                     src_iter,
                                     num_leaf_nodes,
                                     num_internal_nodes,
-                                    tree_length);
+                                    tree_length,
+                                    attributes);
                             current_node->add_child(new_node);
                             node_created = true;
                         } else {
@@ -231,7 +1030,8 @@ class NewickReader : public BaseTreeReader<TreeT, EdgeLengthT> {
                                     src_iter,
                                     num_leaf_nodes,
                                     num_internal_nodes,
-                                    tree_length);
+                                    tree_length,
+                                    attributes);
                             current_node->add_child(new_node);
                             node_created = true;
                         }
@@ -244,10 +1044,11 @@ class NewickReader : public BaseTreeReader<TreeT, EdgeLengthT> {
             // }
             bool label_parsed = false;
             while (true) {
+                this->extract_node_attributes(src_iter, attributes, node_index);
                 if (*src_iter == ":") {
                     src_iter.require_next();
-                    EdgeLengthT edge_len = std::atof(src_iter->c_str());
-                    this->set_node_value_edge_length(current_node->value(), edge_len);
+                    EdgeLengthT edge_len = this->parse_edge_length(*src_iter);
+                    this->apply_edge_length(current_node->value(), edge_len);
                     tree_length += edge_len;
                     src_iter.require_next();
                 } else if (*src_iter == ")") {
@@ -269,7 +1070,7 @@ class NewickReader : public BaseTreeReader<TreeT, EdgeLengthT> {
                     if (label_parsed) {
                         throw NewickReaderMalformedStatementError(__FILE__, __LINE__, "platypus::NewickReader: Expecting ':', ')', ',' or ';' after reading label");
                     } else {
-                        this->set_node_value_label(current_node->value(), *src_iter);
+                        this->apply_label(current_node, src_iter);
                         label_parsed = true;
                         src_iter.require_next();
                     }
@@ -278,14 +1079,245 @@ class NewickReader : public BaseTreeReader<TreeT, EdgeLengthT> {
             return current_node;
         }
 
+        /**
+         * Equivalent to parse_node_from_stream(), but instead of recursing
+         * into child nodes, maintains an explicit stack of the nodes that are
+         * open (i.e., whose closing parenthesis has not yet been read), so
+         * that stack usage does not grow with the depth of the tree.
+         */
+        template <class TokenIteratorT>
+        tree_node_type * parse_node_from_stream_iterative(
+                tree_type & tree,
+                tree_node_type * current_node,
+                TokenIteratorT & src_iter,
+                unsigned long & num_leaf_nodes,
+                unsigned long & num_internal_nodes,
+                EdgeLengthT & tree_length,
+                NodeAttributeTable * attributes) {
+            // parse state of a node: the same as the local variables of
+            // parse_node_from_stream()
+            struct NodeParseState {
+                tree_node_type *    node;
+                unsigned long       node_index;
+                bool                parsing_children;
+                bool                node_created;
+                bool                label_parsed;
+            };
+            std::vector<NodeParseState> open_nodes;
+            auto open_node = [this, &open_nodes, &src_iter, &num_leaf_nodes, &num_internal_nodes, attributes] (tree_node_type * node) {
+                // the node is the last one created
+                NodeParseState state = {node, num_leaf_nodes + num_internal_nodes - 1, false, false, false};
+                this->extract_node_attributes(src_iter, attributes, state.node_index);
+                if (*src_iter == "(") {
+                    // begin processing of child nodes
+                    src_iter.require_next();
+                    state.parsing_children = true;
+                }
+                open_nodes.push_back(state);
+            };
+            auto close_node = [&open_nodes] () {
+                tree_node_type * node = open_nodes.back().node;
+                open_nodes.pop_back();
+                if (!open_nodes.empty()) {
+                    open_nodes.back().node->add_child(node);
+                }
+            };
+            open_node(current_node);
+            while (!open_nodes.empty()) {
+                NodeParseState & state = open_nodes.back();
+                if (state.parsing_children) {
+                    if (*src_iter == ",") {
+                        // next child
+                        if (!state.node_created) {
+                            // no node has been created yet: ',' designates a
+                            // preceding blank node
+                            state.node->add_child(tree.create_leaf_node());
+                            ++num_leaf_nodes;
+                            this->extract_node_attributes(src_iter, attributes, num_leaf_nodes + num_internal_nodes - 1);
+                            // do not flag node as created to allow for an extra node to be created in the event of (..,)
+                        }
+                        src_iter.require_next();
+                        while (*src_iter == ",") {
+                            // another blank node
+                            auto new_node = tree.create_leaf_node();
+                            ++num_leaf_nodes;
+                            this->extract_node_attributes(src_iter, attributes, num_leaf_nodes + num_internal_nodes - 1);
+                            state.node->add_child(new_node);
+                            src_iter.require_next();
+                            state.node_created = true;
+                        }
+                        if (!state.node_created && *src_iter == ")") {
+                            // end of node
+                            state.node->add_child(tree.create_leaf_node());
+                            ++num_leaf_nodes;
+                            this->extract_node_attributes(src_iter, attributes, num_leaf_nodes + num_internal_nodes - 1);
+                            state.node_created = true;
+                        }
+                    } else if (*src_iter == ")") {
+                        // end of child nodes
+                        src_iter.require_next();
+                        state.parsing_children = false;
+                    } else {
+                        // assume child nodes: a leaf node (if a label) or
+                        // internal (if a parenthesis)
+                        tree_node_type * new_node = nullptr;
+                        if (*src_iter == "(") {
+                            new_node = tree.create_internal_node();
+                            ++num_internal_nodes;
+                        } else {
+                            new_node = tree.create_leaf_node();
+                            ++num_leaf_nodes;
+                        }
+                        state.node_created = true;
+                        // note: invalidates ``state``; the new node is added
+                        // to its parent once it has been completely parsed
+                        open_node(new_node);
+                    }
+                } else {
+                    this->extract_node_attributes(src_iter, attributes, state.node_index);
+                    if (*src_iter == ":") {
+                        src_iter.require_next();
+                        EdgeLengthT edge_len = this->parse_edge_length(*src_iter);
+                        this->apply_edge_length(state.node->value(), edge_len);
+                        tree_length += edge_len;
+                        src_iter.require_next();
+                    } else if (*src_iter == ")") {
+                        // closing of parent token
+                        close_node();
+                    } else if (*src_iter == ";") {
+                        // end of tree statement
+                        ++src_iter;
+                        close_node();
+                    } else if (*src_iter == ",") {
+                        // end of this node
+                        close_node();
+                    } else if (*src_iter == "(") {
+                        // start of another node or tree without finishing this
+                        // node
+                        throw NewickReaderMalformedStatementError(__FILE__, __LINE__, "platypus::NewickReader: malformed tree statement");
+                    } else {
+                        // label
+                        if (state.label_parsed) {
+                            throw NewickReaderMalformedStatementError(__FILE__, __LINE__, "platypus::NewickReader: Expecting ':', ')', ',' or ';' after reading label");
+                        } else {
+                            this->apply_label(state.node, src_iter);
+                            state.label_parsed = true;
+                            src_iter.require_next();
+                        }
+                    }
+                }
+            }
+            return current_node;
+        }
+
+        // Reserves storage for the nodes of the tree statement whose opening
+        // parenthesis is the current token of ``src_iter``: a node with k
+        // commas among its children has k + 1 of them, and every further
+        // parenthesis opens a child node, while the root is the (already
+        // allocated) head node. The statement can only be scanned ahead of
+        // the tokens when parsing from a buffer.
+        void reserve_statement_nodes(TreeT & tree, const BufferTokenizer::iterator & src_iter) {
+            tree.reserve_nodes(src_iter.count_in_statement("(,") + 1);
+        }
+        template <class TokenIteratorT>
+        void reserve_statement_nodes(TreeT &, const TokenIteratorT &) {
+        }
+
+        // Sets the label of ``node`` to the current token of ``src_iter``.
+        // With run-time setters, a bound label mover takes the token over
+        // (see BaseTreeProducer::set_node_label_mover()). If a taxon
+        // namespace is bound, leaf labels are taxa instead (see
+        // BaseTreeProducer::set_taxon_namespace()).
+        template <class TokenIteratorT>
+        inline void apply_label(tree_node_type * node, TokenIteratorT & src_iter) {
+            if (this->has_taxon_namespace() && node->is_leaf()) {
+                this->set_node_value_taxon(node->value(), *src_iter);
+                return;
+            }
+            this->apply_label(std::integral_constant<bool, has_static_setters>(), node->value(), src_iter);
+        }
+        template <class TokenIteratorT>
+        inline void apply_label(std::true_type, tree_value_type & nv, TokenIteratorT & src_iter) {
+            SettersT::set_node_label(nv, *src_iter);
+        }
+        template <class TokenIteratorT>
+        inline void apply_label(std::false_type, tree_value_type & nv, TokenIteratorT & src_iter) {
+            if (this->has_node_value_label_mover()) {
+                this->set_node_value_label(nv, src_iter.release_token());
+            } else {
+                this->set_node_value_label(nv, *src_iter);
+            }
+        }
+
+        // Parses the comments captured up to the current token of
+        // ``src_iter`` into the metadata of node ``node_index``.
+        template <class TokenIteratorT>
+        inline void extract_node_attributes(TokenIteratorT & src_iter,
+                NodeAttributeTable * attributes,
+                unsigned long node_index) {
+            if (attributes == nullptr || !src_iter.token_has_comments()) {
+                return;
+            }
+            for (auto & comment : src_iter.captured_comment_views()) {
+                attributes->parse_comment(static_cast<NodeAttributeTable::index_type>(node_index),
+                        comment.data(),
+                        comment.data() + comment.size());
+            }
+            src_iter.clear_captured_comments();
+        }
+
+        inline void apply_edge_length(tree_value_type & nv, EdgeLengthT edge_length) {
+            this->apply_edge_length(std::integral_constant<bool, has_static_setters>(), nv, edge_length);
+        }
+        inline void apply_edge_length(std::true_type, tree_value_type & nv, EdgeLengthT edge_length) {
+            SettersT::set_edge_length(nv, edge_length);
+        }
+        inline void apply_edge_length(std::false_type, tree_value_type & nv, EdgeLengthT edge_length) {
+            this->set_node_value_edge_length(nv, edge_length);
+        }
+
+        EdgeLengthT parse_edge_length(const std::string & token) const {
+            return this->parse_edge_length(token.data(), token.data() + token.size());
+        }
+
+        EdgeLengthT parse_edge_length(const TokenView & token) const {
+            return this->parse_edge_length(token.begin(), token.end());
+        }
+
+        // Parses the edge length in [begin, end), in place and independently
+        // of locale (see platypus::parse_decimal()).
+        EdgeLengthT parse_edge_length(const char * begin, const char * end) const {
+            double edge_length = 0.0;
+            if (!parse_decimal(begin, end, edge_length)) {
+                throw NewickReaderInvalidTokenError(__FILE__, __LINE__,
+                        "platypus::NewickReader: invalid edge length: '" + std::string(begin, end) + "'");
+            }
+            return static_cast<EdgeLengthT>(edge_length);
+        }
+
     // protected:
     //     static constexpr const char * default_format_ = "newick";
 
     private:
-        NexusTokenizer      tokenizer_;
+        NewickTokenizer         tokenizer_;
+        NexusBufferTokenizer    buffer_tokenizer_;
+        bool                    recursive_parsing_;
+        bool                    prescan_node_counts_;
+        node_attributes_fntype  node_attributes_fn_;
+        NodeAttributeTable      node_attributes_;
 
 }; // NewickTreeReader
 
+template <typename TreeT, typename EdgeLengthT, typename SettersT>
+const bool NewickReader<TreeT, EdgeLengthT, SettersT>::has_static_setters;
+
+/**
+ * A NewickReader with node labels and edge lengths bound at compile time to
+ * the standard interface (see platypus::StandardInterfaceSetters).
+ */
+template <typename TreeT, typename EdgeLengthT=double>
+using StandardNewickReader = NewickReader<TreeT, EdgeLengthT, StandardInterfaceSetters>;
+
 
 } // platypus
 
@@ -23,12 +23,59 @@
 
 #include "base/exception.hpp"
 #include "model/datatable.hpp"
+#include "model/charactermatrix.hpp"
+#include "model/parsimony.hpp"
+#include "model/sequencesimulator.hpp"
+#include "model/continuoustraits.hpp"
+#include "model/birthdeath.hpp"
 #include "model/coalescent.hpp"
+#include "model/flattree.hpp"
+#include "model/persistenttree.hpp"
+#include "model/treestore.hpp"
+#include "model/paralleltraversal.hpp"
+#include "model/treetraversal.hpp"
+#include "model/labelpool.hpp"
+#include "model/likelihood.hpp"
+#include "model/nodeattributes.hpp"
+#include "model/split.hpp"
+#include "model/splitdistribution.hpp"
+#include "model/treedistance.hpp"
+#include "model/neighborjoining.hpp"
 #include "model/tree.hpp"
+#include "model/treeannotationcache.hpp"
+#include "model/leafindex.hpp"
+#include "model/inducedsubtree.hpp"
+#include "model/tipsubsampler.hpp"
+#include "model/lcaindex.hpp"
+#include "model/treestatistics.hpp"
+#include "model/nodeages.hpp"
+#include "model/lineagesthroughtime.hpp"
+#include "model/topologyhash.hpp"
+#include "model/treenodearena.hpp"
+#include "model/mappednodearena.hpp"
+#include "model/treepool.hpp"
 #include "model/treepattern.hpp"
+#include "model/treerearrangement.hpp"
 #include "model/standardinterface.hpp"
+#include "model/compactnodevalue.hpp"
+#include "model/taxonnamespace.hpp"
+#include "model/staticnodefactory.hpp"
 #include "numeric/rng.hpp"
+#include "numeric/statistics.hpp"
+#include "parse/binary.hpp"
+#include "parse/datatable.hpp"
 #include "parse/newick.hpp"
+#include "serialize/binary.hpp"
+#include "serialize/charactermatrix.hpp"
 #include "serialize/newick.hpp"
+#include "utility/alignedbuffer.hpp"
+#include "utility/memoryusage.hpp"
+#include "utility/treeoffsetindex.hpp"
+#include "utility/partialstate.hpp"
+
+// requires linking with zlib
+#if defined(PLATYPUS_ENABLE_ZLIB)
+#include "utility/gzipstream.hpp"
+#endif
 
 #endif
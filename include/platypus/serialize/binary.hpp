@@ -0,0 +1,236 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Writing of trees in the platypus binary container format.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_SERIALIZE_BINARY_HPP
+#define PLATYPUS_SERIALIZE_BINARY_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../base/base_writer.hpp"
+#include "../utility/binaryformat.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// BinaryTreeWriter
+
+/**
+ * Writes trees in the platypus binary container format (see
+ * platypus::binary_format), which platypus::BinaryTreeReader reads back
+ * without any text parsing, and with random access to individual trees.
+ *
+ * Each call to write() produces a complete container: rooting state, node
+ * labels and edge lengths are stored if the corresponding getter is bound
+ * (see BaseTreeWriter), and labels are pooled across all the trees
+ * written by the call.
+ */
+template <typename TreeT, typename EdgeLengthT=double>
+class BinaryTreeWriter : public BaseTreeWriter<TreeT, EdgeLengthT> {
+
+    public:
+        typedef TreeT                          tree_type;
+        typedef typename tree_type::node_type  tree_node_type;
+        typedef typename tree_type::value_type tree_value_type;
+
+    public:
+
+        BinaryTreeWriter()
+            : single_precision_edge_lengths_(false)
+            , output_block_size_(65536) {
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Main interface
+
+        template <typename IterT>
+        void write(std::ostream & out, IterT trees_begin, IterT trees_end) const {
+            InstrumentationTimer timer(this->stats_.write_seconds);
+            ContainerState state;
+            std::string buffer;
+            buffer.reserve(this->output_block_size_ + 1024);
+            buffer.append(binary_format::HEADER_MAGIC, 4);
+            binary_format::append_u32(buffer, binary_format::VERSION);
+            for (auto trees_iter = trees_begin; trees_iter != trees_end; ++trees_iter) {
+                state.tree_offsets.push_back(state.num_bytes_flushed + buffer.size());
+                this->append_tree(buffer, state, *trees_iter);
+                if (buffer.size() >= this->output_block_size_) {
+                    this->flush(out, buffer, state);
+                }
+            }
+            this->append_footer(buffer, state);
+            this->flush(out, buffer, state);
+        }
+
+        void write(std::ostream & out, const tree_type & tree) const {
+            const tree_type * trees = &tree;
+            this->write(out, trees, trees + 1);
+        }
+
+        // support pointers
+        void write(std::ostream & out, const tree_type * tree) const {
+            this->write(out, *tree);
+        }
+
+        void write(std::ostream & out, const std::shared_ptr<tree_type> & tree) const {
+            this->write(out, *tree);
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Customization
+
+        /**
+         * If true, edge lengths are stored as 32-bit rather than 64-bit
+         * floating-point values, halving their storage at the cost of
+         * precision.
+         */
+        void set_single_precision_edge_lengths(bool single_precision) {
+            this->single_precision_edge_lengths_ = single_precision;
+        }
+        bool get_single_precision_edge_lengths() const {
+            return this->single_precision_edge_lengths_;
+        }
+
+        void set_output_block_size(std::size_t block_size) {
+            this->output_block_size_ = block_size;
+        }
+        std::size_t get_output_block_size() const {
+            return this->output_block_size_;
+        }
+
+    protected:
+
+        // State accumulated over the trees of a single container.
+        struct ContainerState {
+            std::unordered_map<std::string, std::uint32_t>  label_indexes;
+            std::vector<const std::string *>                labels;     // keys of ``label_indexes``
+            std::vector<std::uint64_t>                      tree_offsets;
+            std::uint64_t                                   num_bytes_flushed;
+            // per-tree scratch
+            std::vector<const tree_node_type *>             nodes;
+            ContainerState() : num_bytes_flushed(0) { }
+        };
+
+        void flush(std::ostream & out, std::string & buffer, ContainerState & state) const {
+            out.write(buffer.data(), buffer.size());
+            this->stats_.record_bytes_written(buffer.size());
+            state.num_bytes_flushed += buffer.size();
+            buffer.clear();
+        }
+
+        void append_tree(std::string & buffer, ContainerState & state, const tree_type & tree) const {
+            // nodes in preorder, visited through the parent and sibling links
+            auto & nodes = state.nodes;
+            nodes.clear();
+            const tree_node_type * root = tree.head_node();
+            const tree_node_type * node = root;
+            while (node != nullptr) {
+                nodes.push_back(node);
+                if (!node->is_leaf()) {
+                    node = node->first_child_node();
+                    continue;
+                }
+                while (node != root && node->next_sibling_node() == nullptr) {
+                    node = node->parent_node();
+                }
+                node = (node == root) ? nullptr : node->next_sibling_node();
+            }
+            std::uint8_t flags = 0;
+            if (this->tree_is_rooted_getter_) {
+                flags |= binary_format::HAS_ROOTING;
+                if (this->tree_is_rooted_getter_(tree)) {
+                    flags |= binary_format::IS_ROOTED;
+                }
+            }
+            if (this->node_value_label_getter_) {
+                flags |= binary_format::HAS_LABELS;
+            }
+            if (this->node_value_edge_length_getter_) {
+                flags |= binary_format::HAS_EDGE_LENGTHS;
+                if (this->single_precision_edge_lengths_) {
+                    flags |= binary_format::SINGLE_PRECISION_EDGE_LENGTHS;
+                }
+            }
+            binary_format::append_u32(buffer, static_cast<std::uint32_t>(nodes.size()));
+            buffer.push_back(static_cast<char>(flags));
+            for (auto nd : nodes) {
+                std::uint32_t num_children = 0;
+                for (auto ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+                    ++num_children;
+                }
+                binary_format::append_u32(buffer, num_children);
+            }
+            if (flags & binary_format::HAS_LABELS) {
+                for (auto nd : nodes) {
+                    binary_format::append_u32(buffer, this->get_label_index(state, this->node_value_label_getter_(nd->value())));
+                }
+            }
+            if (flags & binary_format::HAS_EDGE_LENGTHS) {
+                for (auto nd : nodes) {
+                    double edge_length = static_cast<double>(this->node_value_edge_length_getter_(nd->value()));
+                    if (this->single_precision_edge_lengths_) {
+                        binary_format::append_f32(buffer, static_cast<float>(edge_length));
+                    } else {
+                        binary_format::append_f64(buffer, edge_length);
+                    }
+                }
+            }
+            this->stats_.record_tree(nodes.size());
+        }
+
+        std::uint32_t get_label_index(ContainerState & state, const std::string & label) const {
+            if (label.empty()) {
+                return binary_format::NO_LABEL;
+            }
+            auto inserted = state.label_indexes.insert(std::make_pair(label, static_cast<std::uint32_t>(state.labels.size())));
+            if (inserted.second) {
+                state.labels.push_back(&inserted.first->first);
+            }
+            return inserted.first->second;
+        }
+
+        void append_footer(std::string & buffer, ContainerState & state) const {
+            std::uint64_t footer_offset = state.num_bytes_flushed + buffer.size();
+            binary_format::append_u32(buffer, static_cast<std::uint32_t>(state.labels.size()));
+            for (auto label : state.labels) {
+                binary_format::append_u32(buffer, static_cast<std::uint32_t>(label->size()));
+                buffer += *label;
+            }
+            binary_format::append_u64(buffer, state.tree_offsets.size());
+            for (auto offset : state.tree_offsets) {
+                binary_format::append_u64(buffer, offset);
+            }
+            binary_format::append_u64(buffer, footer_offset);
+            buffer.append(binary_format::TRAILER_MAGIC, 4);
+        }
+
+    protected:
+        bool            single_precision_edge_lengths_;
+        std::size_t     output_block_size_;
+
+}; // BinaryTreeWriter
+
+} // namespace platypus
+
+#endif
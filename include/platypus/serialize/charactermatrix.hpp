@@ -0,0 +1,199 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       FASTA and PHYLIP character matrix writing.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_SERIALIZE_CHARACTERMATRIX_HPP
+#define PLATYPUS_SERIALIZE_CHARACTERMATRIX_HPP
+
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include "../base/base_writer.hpp"
+#include "../model/charactermatrix.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// CharacterMatrixWriter
+
+/**
+ * Writes a BasicCharacterMatrix as FASTA or (relaxed, sequential) PHYLIP,
+ * one symbol per site, with each state set written as the symbol given by
+ * CharacterStateAlphabet::get_state_set_symbol(). Pattern-compressed
+ * matrices are written with their original sites.
+ *
+ * As with NewickWriter, output is composed into an internal buffer which is
+ * written to the stream in blocks of (approximately) the output block size
+ * (see set_output_block_size()), so that writing many matrices (e.g.,
+ * simulated replicates) to the same stream does not go a row at a time.
+ */
+template <class MatrixT>
+class CharacterMatrixWriter {
+
+    public:
+        typedef MatrixT                                 matrix_type;
+        typedef typename MatrixT::state_set_type        state_set_type;
+
+        enum class Format {
+            FASTA,
+            PHYLIP,
+        };
+
+    public:
+
+        CharacterMatrixWriter(Format format=Format::FASTA)
+            : format_(format)
+            , line_width_(0)
+            , output_block_size_(65536) { }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Main interface
+
+        std::string format(const matrix_type & matrix) const {
+            std::ostringstream o;
+            this->write(o, matrix);
+            return o.str();
+        }
+
+        void write(std::ostream & out, const matrix_type & matrix) const {
+            InstrumentationTimer timer(this->stats_.write_seconds);
+            this->prepare_symbols(matrix);
+            this->buffer_.clear();
+            this->buffer_.reserve(this->output_block_size_ + 1024);
+            std::size_t num_sites = matrix.num_original_sites();
+            if (this->format_ == Format::PHYLIP) {
+                this->buffer_ += std::to_string(matrix.num_taxa());
+                this->buffer_ += " ";
+                this->buffer_ += std::to_string(num_sites);
+                this->buffer_ += "\n";
+            }
+            for (std::size_t row_idx = 0; row_idx < matrix.num_taxa(); ++row_idx) {
+                if (this->format_ == Format::FASTA) {
+                    this->buffer_ += ">";
+                    this->buffer_ += matrix.get_taxon_label(row_idx);
+                    this->buffer_ += "\n";
+                } else {
+                    this->buffer_ += matrix.get_taxon_label(row_idx);
+                    this->buffer_ += "  ";
+                }
+                const state_set_type * row = matrix.row(row_idx);
+                for (std::size_t site_idx = 0; site_idx < num_sites; ++site_idx) {
+                    if (this->format_ == Format::FASTA
+                            && this->line_width_ > 0
+                            && site_idx > 0
+                            && site_idx % this->line_width_ == 0) {
+                        this->buffer_ += "\n";
+                    }
+                    std::size_t pattern_idx = matrix.is_compressed() ? matrix.get_site_pattern(site_idx) : site_idx;
+                    this->buffer_ += this->get_symbol(matrix, row[pattern_idx]);
+                }
+                this->buffer_ += "\n";
+                if (this->buffer_.size() >= this->output_block_size_) {
+                    this->flush(out);
+                }
+            }
+            this->flush(out);
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Customization
+
+        void set_format(Format format) {
+            this->format_ = format;
+        }
+
+        Format get_format() const {
+            return this->format_;
+        }
+
+        // Number of FASTA symbols per line; 0 writes each sequence on a single line.
+        void set_line_width(std::size_t line_width) {
+            this->line_width_ = line_width;
+        }
+
+        std::size_t get_line_width() const {
+            return this->line_width_;
+        }
+
+        void set_output_block_size(std::size_t block_size) {
+            this->output_block_size_ = block_size;
+        }
+
+        std::size_t get_output_block_size() const {
+            return this->output_block_size_;
+        }
+
+        // As BaseTreeWriter::get_stats(), with no trees.
+        inline const InstrumentationStats & get_stats() const {
+            return this->stats_;
+        }
+        inline void reset_stats() {
+            this->stats_.clear();
+        }
+
+    private:
+
+        // Symbols of single states are looked up directly; others are cached.
+        void prepare_symbols(const matrix_type & matrix) const {
+            const CharacterStateAlphabet & alphabet = matrix.alphabet();
+            this->state_symbols_ = alphabet.symbols();
+            this->other_symbols_.clear();
+        }
+
+        inline char get_symbol(const matrix_type & matrix, state_set_type state_set) const {
+            if (state_set != 0 && (state_set & (state_set - 1)) == 0) {
+                std::size_t state_idx = 0;
+                while ((state_set >> state_idx) != 1) {
+                    ++state_idx;
+                }
+                return this->state_symbols_[state_idx];
+            }
+            auto found = this->other_symbols_.find(state_set);
+            if (found != this->other_symbols_.end()) {
+                return found->second;
+            }
+            char symbol = matrix.alphabet().get_state_set_symbol(state_set);
+            this->other_symbols_.insert(std::make_pair(state_set, symbol));
+            return symbol;
+        }
+
+        void flush(std::ostream & out) const {
+            out.write(this->buffer_.data(), this->buffer_.size());
+            this->stats_.record_bytes_written(this->buffer_.size());
+            this->buffer_.clear();
+        }
+
+    private:
+        Format                                          format_;
+        std::size_t                                     line_width_;
+        std::size_t                                     output_block_size_;
+        // updated by (const) write operations
+        mutable std::string                             buffer_;
+        mutable std::string                             state_symbols_;
+        mutable std::unordered_map<state_set_type, char> other_symbols_;
+        mutable InstrumentationStats                    stats_;
+
+}; // CharacterMatrixWriter
+
+} // namespace platypus
+
+#endif
@@ -23,25 +23,38 @@
 #define PLATYPUS_SERIALIZE_NEWICK_HPP
 
 #include <stdlib.h>
+#include <cstdio>
 #include <exception>
 #include <string>
 #include <sstream>
 #include <iomanip>
 #include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "../base/base_writer.hpp"
+#include "../model/standardinterface.hpp"
+#include "../utility/parallel.hpp"
 
 namespace platypus {
 
 ////////////////////////////////////////////////////////////////////////////////
 // NewickWriter
 
-template <typename TreeT>
+template <typename TreeT, typename GettersT=FunctionGetters>
 class NewickWriter : public BaseTreeWriter<TreeT> {
 
     public:
         typedef TreeT                          tree_type;
         typedef typename tree_type::node_type  tree_node_type;
         typedef typename tree_type::value_type tree_value_type;
+        typedef GettersT                       getters_type;
+
+        // If true, rooting state, node labels and edge lengths are obtained
+        // through ``GettersT`` (see platypus::FunctionGetters), and the
+        // getter function objects are ignored.
+        static const bool has_static_getters = !std::is_same<GettersT, FunctionGetters>::value;
 
     public:
 
@@ -52,7 +65,8 @@ class NewickWriter : public BaseTreeWriter<TreeT> {
             : suppress_rooting_(false)
               , suppress_internal_node_labels_(false)
               , suppress_edge_lengths_(false)
-              , compact_spaces_(false) {
+              , compact_spaces_(false)
+              , output_block_size_(65536) {
         }
 
         ~NewickWriter() {
@@ -82,28 +96,109 @@ class NewickWriter : public BaseTreeWriter<TreeT> {
             return this->format(*tree);
         }
 
+        /**
+         * Trees are composed into an internal buffer which is written to
+         * ``out`` in blocks of (approximately) ``output_block_size`` bytes
+         * (see set_output_block_size()), rather than a node at a time.
+         */
         template <typename IterT>
         void write(std::ostream & out, IterT trees_begin, IterT trees_end) const {
+            InstrumentationTimer timer(this->stats_.write_seconds);
+            std::string buffer;
+            buffer.reserve(this->output_block_size_ + 1024);
             for (auto trees_iter = trees_begin; trees_iter != trees_end; ++trees_iter) {
-                this->write(out, *trees_iter);
-                out << "\n";
+                this->append_tree(buffer, *trees_iter);
+                buffer += "\n";
+                this->stats_.record_tree(0);
+                if (buffer.size() >= this->output_block_size_) {
+                    out.write(buffer.data(), buffer.size());
+                    this->stats_.record_bytes_written(buffer.size());
+                    buffer.clear();
+                }
             }
+            out.write(buffer.data(), buffer.size());
+            this->stats_.record_bytes_written(buffer.size());
         }
 
-        // workhorse
-        void write(std::ostream & out, const tree_type & tree) const {
-            if (this->tree_is_rooted_getter_ && !this->suppress_rooting_) {
-                if (this->tree_is_rooted_getter_(tree)) {
-                    out << "[&R]";
-                } else {
-                    out << "[&U]";
+        /**
+         * As write(), but the trees are formatted concurrently by up to
+         * ``num_threads`` threads (0: one per hardware thread), each
+         * composing a run of consecutive trees into its own buffer. A
+         * sequencing thread writes the buffers to ``out`` in input order
+         * while the next batch of trees is being formatted, so the output is
+         * identical to that of write().
+         *
+         * The trees must not be modified until this returns; they are only
+         * read, and may be formatted by any of the threads.
+         */
+        template <typename IterT>
+        void write_parallel(std::ostream & out,
+                IterT trees_begin,
+                IterT trees_end,
+                unsigned int num_threads=0) const {
+            num_threads = resolve_num_threads(num_threads);
+            if (num_threads == 1) {
+                this->write(out, trees_begin, trees_end);
+                return;
+            }
+            InstrumentationTimer timer(this->stats_.write_seconds);
+            const std::size_t trees_per_buffer = 16;
+            const std::size_t buffers_per_batch = num_threads * 4;
+            std::vector<IterT> batch;
+            batch.reserve(trees_per_buffer * buffers_per_batch);
+            std::vector<std::string> buffers(buffers_per_batch);
+            // two batches may be in flight: one being written while the next
+            // is being formatted
+            BoundedQueue<std::string> queue(buffers_per_batch);
+            std::thread sequencer([this, &out, &queue] () {
+                std::string buffer;
+                while (queue.pop(buffer)) {
+                    out.write(buffer.data(), buffer.size());
+                    this->stats_.record_bytes_written(buffer.size());
                 }
-                if (!this->compact_spaces_) {
-                    out << " ";
+            });
+            try {
+                auto trees_iter = trees_begin;
+                while (trees_iter != trees_end) {
+                    batch.clear();
+                    while (trees_iter != trees_end && batch.size() < batch.capacity()) {
+                        batch.push_back(trees_iter);
+                        ++trees_iter;
+                    }
+                    std::size_t num_buffers = (batch.size() + trees_per_buffer - 1) / trees_per_buffer;
+                    parallel_for(num_buffers, num_threads, [this, &batch, &buffers, trees_per_buffer] (std::size_t buffer_idx) {
+                        std::string & buffer = buffers[buffer_idx];
+                        buffer.clear();
+                        std::size_t end_idx = std::min(batch.size(), (buffer_idx + 1) * trees_per_buffer);
+                        for (std::size_t idx = buffer_idx * trees_per_buffer; idx < end_idx; ++idx) {
+                            this->append_tree(buffer, *batch[idx]);
+                            buffer += "\n";
+                        }
+                    });
+                    for (std::size_t idx = 0; idx < batch.size(); ++idx) {
+                        this->stats_.record_tree(0);
+                    }
+                    for (std::size_t buffer_idx = 0; buffer_idx < num_buffers; ++buffer_idx) {
+                        queue.push(std::move(buffers[buffer_idx]));
+                    }
                 }
+            } catch (...) {
+                queue.cancel();
+                sequencer.join();
+                throw;
             }
-            this->write_node(tree, tree.begin(), out);
-            out << ";";
+            queue.close();
+            sequencer.join();
+        }
+
+        // workhorse
+        void write(std::ostream & out, const tree_type & tree) const {
+            InstrumentationTimer timer(this->stats_.write_seconds);
+            std::string buffer;
+            this->append_tree(buffer, tree);
+            out.write(buffer.data(), buffer.size());
+            this->stats_.record_tree(0);
+            this->stats_.record_bytes_written(buffer.size());
         }
 
         // support pointers
@@ -134,45 +229,246 @@ class NewickWriter : public BaseTreeWriter<TreeT> {
             this->compact_spaces_ = compact;
         }
 
+        void set_output_block_size(std::size_t block_size) {
+            this->output_block_size_ = block_size;
+        }
+
+        std::size_t get_output_block_size() const {
+            return this->output_block_size_;
+        }
+
     protected:
 
         void write_node(const tree_type & tree,
                 const typename tree_type::iterator & node_iter,
                 std::ostream& out) const {
-            bool is_leaf = node_iter.is_leaf();
-            if (!is_leaf) {
-                out << "(";
-                int ch_count = 0;
-                for (auto chi = tree.children_begin(node_iter);
-                        chi != tree.children_end(node_iter);
-                        ++chi, ++ch_count) {
-                    if (ch_count > 0) {
-                        out << ",";
+            std::string buffer;
+            this->append_node(buffer, node_iter.node());
+            out.write(buffer.data(), buffer.size());
+        }
+
+        /**
+         * Composes the Newick string representation of ``tree`` (including
+         * the terminating semi-colon, but not a newline) and appends it to
+         * ``buffer``.
+         */
+        void append_tree(std::string & buffer, const tree_type & tree) const {
+            this->append_tree(std::integral_constant<bool, has_static_getters>(), buffer, tree);
+        }
+
+        void append_tree(std::true_type, std::string & buffer, const tree_type & tree) const {
+            if (!this->suppress_rooting_) {
+                buffer += GettersT::get_tree_is_rooted(tree) ? "[&R]" : "[&U]";
+                if (!this->compact_spaces_) {
+                    buffer += " ";
+                }
+            }
+            this->append_node(buffer, tree.begin().node());
+            buffer += ";";
+        }
+
+        void append_tree(std::false_type, std::string & buffer, const tree_type & tree) const {
+            if (this->tree_is_rooted_getter_ && !this->suppress_rooting_) {
+                if (this->tree_is_rooted_getter_(tree)) {
+                    buffer += "[&R]";
+                } else {
+                    buffer += "[&U]";
+                }
+                if (!this->compact_spaces_) {
+                    buffer += " ";
+                }
+            }
+            this->append_node(buffer, tree.begin().node());
+            buffer += ";";
+        }
+
+        /**
+         * Composes the Newick string representation of the subtree rooted at
+         * ``subtree_root`` and appends it to ``buffer``. The subtree is
+         * visited in a single non-recursive pass, using the parent and sibling
+         * links of the nodes to move back up the tree.
+         */
+        void append_node(std::string & buffer, const tree_node_type * subtree_root) const {
+            const tree_node_type * node = subtree_root;
+            while (true) {
+                if (!node->is_leaf()) {
+                    buffer += "(";
+                    node = node->first_child_node();
+                    continue;
+                }
+                // all children of ``node`` have been written: finish it, and
+                // ascend until a node with a next sibling is found
+                while (true) {
+                    this->append_node_value(buffer, node->value(), node->is_leaf());
+                    if (node == subtree_root) {
+                        return;
+                    }
+                    if (node->next_sibling_node() != nullptr) {
+                        buffer += ",";
                         if (!this->compact_spaces_) {
-                            out << " ";
+                            buffer += " ";
                         }
+                        node = node->next_sibling_node();
+                        break;
                     }
-                    this->write_node(tree, chi, out);
+                    buffer += ")";
+                    node = node->parent_node();
                 }
-                out << ")";
             }
+        }
+
+        void append_node_value(std::string & buffer, const tree_value_type & nv, bool is_leaf) const {
+            this->append_node_value(std::integral_constant<bool, has_static_getters>(), buffer, nv, is_leaf);
+        }
+
+        inline void append_node_value(std::true_type, std::string & buffer, const tree_value_type & nv, bool is_leaf) const {
+            if (is_leaf || !this->suppress_internal_node_labels_) {
+                buffer += GettersT::get_node_label(nv);
+            }
+            if (!this->suppress_edge_lengths_) {
+                buffer += ":";
+                this->append_edge_length(buffer, GettersT::get_edge_length(nv));
+            }
+        }
+
+        void append_node_value(std::false_type, std::string & buffer, const tree_value_type & nv, bool is_leaf) const {
             if (this->node_value_label_getter_ && (is_leaf || !this->suppress_internal_node_labels_)) {
-                out << this->node_value_label_getter_(*node_iter);
+                buffer += this->node_value_label_getter_(nv);
             }
             if (this->node_value_edge_length_getter_ && !this->suppress_edge_lengths_) {
-                out << ":" << std::fixed << std::setprecision(this->edge_length_precision_) << this->node_value_edge_length_getter_(*node_iter);
-                out.copyfmt(std::ios(NULL)); // restore state
+                buffer += ":";
+                this->append_edge_length(buffer, this->node_value_edge_length_getter_(nv));
+            }
+        }
+
+        /**
+         * Appends ``edge_length`` formatted in fixed-point notation with
+         * ``edge_length_precision_`` decimal places (i.e., as it would be
+         * written by an ostream in the default locale with ``std::fixed`` and
+         * ``std::setprecision()``), without touching any stream state.
+         */
+        void append_edge_length(std::string & buffer, double edge_length) const {
+            char local_buffer[64];
+            int precision = static_cast<int>(this->edge_length_precision_);
+            int len = std::snprintf(local_buffer, sizeof(local_buffer), "%.*f", precision, edge_length);
+            if (len < 0) {
+                return;
+            }
+            if (static_cast<std::size_t>(len) < sizeof(local_buffer)) {
+                buffer.append(local_buffer, len);
+            } else {
+                // very large magnitude or precision
+                std::size_t offset = buffer.size();
+                buffer.resize(offset + len + 1);
+                std::snprintf(&buffer[offset], len + 1, "%.*f", precision, edge_length);
+                buffer.resize(offset + len);
             }
         }
 
     protected:
-        bool    suppress_rooting_;
-        bool    suppress_internal_node_labels_;
-        bool    suppress_edge_lengths_;
-        bool    compact_spaces_;
+        bool            suppress_rooting_;
+        bool            suppress_internal_node_labels_;
+        bool            suppress_edge_lengths_;
+        bool            compact_spaces_;
+        std::size_t     output_block_size_;
 
 }; // NewickWriter
 
+template <typename TreeT, typename GettersT>
+const bool NewickWriter<TreeT, GettersT>::has_static_getters;
+
+////////////////////////////////////////////////////////////////////////////////
+// NewickTreeSink
+
+/**
+ * Collects trees delivered one at a time, e.g., by the batch simulators
+ * (see BasicCoalescentSimulator::generate_batch() and
+ * BirthDeathTreeSimulator::generate_batch()), and writes them to ``out``
+ * with NewickWriter::write_parallel() whenever ``batch_size`` trees have
+ * accumulated (0: 256 per formatting thread), in the order received.
+ *
+ * A delivered tree is taken over by swapping it with a previously written
+ * one, so the caller gets back a tree with arbitrary content which it is
+ * expected to clear before re-use (as the simulators do). Since callables
+ * are copied by ``std::function``, pass the sink with ``std::ref()``.
+ *
+ * The remaining trees are written by flush(), which is also called on
+ * destruction; call it explicitly to have any exception propagate.
+ */
+template <typename TreeT, typename GettersT=FunctionGetters>
+class NewickTreeSink {
+
+    public:
+        typedef NewickWriter<TreeT, GettersT> writer_type;
+
+    public:
+        NewickTreeSink(const writer_type & writer,
+                std::ostream & out,
+                unsigned int num_threads=0,
+                std::size_t batch_size=0)
+            : writer_(writer)
+              , out_(out)
+              , num_threads_(resolve_num_threads(num_threads))
+              , batch_size_(batch_size > 0 ? batch_size : num_threads_ * 256)
+              , num_pending_(0)
+              , num_written_(0) {
+        }
+        NewickTreeSink(const NewickTreeSink &) = delete;
+        NewickTreeSink & operator=(const NewickTreeSink &) = delete;
+        ~NewickTreeSink() {
+            try {
+                this->flush();
+            } catch (...) {
+            }
+        }
+
+        void operator()(TreeT & tree, unsigned long) {
+            if (this->trees_.size() == this->num_pending_) {
+                this->trees_.emplace_back();
+            }
+            std::swap(this->trees_[this->num_pending_], tree);
+            ++this->num_pending_;
+            if (this->num_pending_ >= this->batch_size_) {
+                this->flush();
+            }
+        }
+
+        void flush() {
+            if (this->num_pending_ == 0) {
+                return;
+            }
+            std::size_t num_pending = this->num_pending_;
+            this->num_pending_ = 0;
+            this->writer_.write_parallel(this->out_,
+                    this->trees_.cbegin(),
+                    this->trees_.cbegin() + num_pending,
+                    this->num_threads_);
+            this->num_written_ += num_pending;
+        }
+
+        unsigned long get_num_trees_written() const {
+            return this->num_written_;
+        }
+
+    private:
+        const writer_type & writer_;
+        std::ostream &      out_;
+        unsigned int        num_threads_;
+        std::size_t         batch_size_;
+        std::vector<TreeT>  trees_;
+        std::size_t         num_pending_;
+        unsigned long       num_written_;
+
+}; // NewickTreeSink
+
+/**
+ * A NewickWriter with rooting state, node labels and edge lengths bound at
+ * compile time to the standard interface (see
+ * platypus::StandardInterfaceGetters).
+ */
+template <typename TreeT>
+using StandardNewickWriter = NewickWriter<TreeT, StandardInterfaceGetters>;
+
 } // platypus
 
 #endif
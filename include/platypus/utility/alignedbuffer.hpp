@@ -0,0 +1,229 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Contiguous, over-aligned storage for SIMD kernels.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_UTILITY_ALIGNEDBUFFER_HPP
+#define PLATYPUS_UTILITY_ALIGNEDBUFFER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// AlignedBuffer
+
+/**
+ * A resizable array of trivially-copyable ``T`` whose first element lies on
+ * an ``Alignment``-byte boundary (by default, that of a cache line, which is
+ * also sufficient for any SIMD load), so that kernels over the buffer can
+ * use aligned vector loads and stores.
+ *
+ * Unlike std::vector, growing the buffer does not over-allocate: callers
+ * that append repeatedly should size the buffer up front.
+ */
+template <class T, std::size_t Alignment=64>
+class AlignedBuffer {
+
+    static_assert(std::is_trivially_copyable<T>::value, "AlignedBuffer requires a trivially-copyable element type");
+    static_assert(Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0, "alignment must be a power of two, and at least that of the element type");
+
+    public:
+        typedef T                   value_type;
+        typedef std::size_t         size_type;
+
+        static constexpr std::size_t alignment() {
+            return Alignment;
+        }
+
+    public:
+
+        AlignedBuffer()
+            : storage_(nullptr)
+            , data_(nullptr)
+            , size_(0) { }
+
+        explicit AlignedBuffer(size_type n, const T & value=T())
+            : storage_(nullptr)
+            , data_(nullptr)
+            , size_(0) {
+            this->resize(n, value);
+        }
+
+        AlignedBuffer(const AlignedBuffer & other)
+            : storage_(nullptr)
+            , data_(nullptr)
+            , size_(0) {
+            this->allocate(other.size_);
+            if (other.size_ > 0) {
+                std::memcpy(this->data_, other.data_, other.size_ * sizeof(T));
+            }
+        }
+
+        AlignedBuffer(AlignedBuffer && other) noexcept
+            : storage_(other.storage_)
+            , data_(other.data_)
+            , size_(other.size_) {
+            other.storage_ = nullptr;
+            other.data_ = nullptr;
+            other.size_ = 0;
+        }
+
+        AlignedBuffer & operator=(const AlignedBuffer & other) {
+            if (this != &other) {
+                AlignedBuffer copy(other);
+                this->swap(copy);
+            }
+            return *this;
+        }
+
+        AlignedBuffer & operator=(AlignedBuffer && other) noexcept {
+            if (this != &other) {
+                this->release();
+                this->storage_ = other.storage_;
+                this->data_ = other.data_;
+                this->size_ = other.size_;
+                other.storage_ = nullptr;
+                other.data_ = nullptr;
+                other.size_ = 0;
+            }
+            return *this;
+        }
+
+        ~AlignedBuffer() {
+            this->release();
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Access
+
+        inline T * data() {
+            return this->data_;
+        }
+
+        inline const T * data() const {
+            return this->data_;
+        }
+
+        inline size_type size() const {
+            return this->size_;
+        }
+
+        inline bool empty() const {
+            return this->size_ == 0;
+        }
+
+        inline T & operator[](size_type idx) {
+            return this->data_[idx];
+        }
+
+        inline const T & operator[](size_type idx) const {
+            return this->data_[idx];
+        }
+
+        inline T * begin() {
+            return this->data_;
+        }
+
+        inline T * end() {
+            return this->data_ + this->size_;
+        }
+
+        inline const T * begin() const {
+            return this->data_;
+        }
+
+        inline const T * end() const {
+            return this->data_ + this->size_;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Sizing
+
+        /**
+         * Sets the number of elements to ``n``, keeping existing elements
+         * (up to ``n``) and setting any new ones to ``value``. Reallocates
+         * (invalidating pointers into the buffer) whenever the size changes.
+         */
+        void resize(size_type n, const T & value=T()) {
+            if (n == this->size_) {
+                return;
+            }
+            AlignedBuffer resized;
+            resized.allocate(n);
+            size_type num_kept = std::min(n, this->size_);
+            if (num_kept > 0) {
+                std::memcpy(resized.data_, this->data_, num_kept * sizeof(T));
+            }
+            std::fill(resized.data_ + num_kept, resized.data_ + n, value);
+            this->swap(resized);
+        }
+
+        // Sets every element to ``value``.
+        void fill(const T & value) {
+            std::fill(this->begin(), this->end(), value);
+        }
+
+        void clear() {
+            this->release();
+        }
+
+        void swap(AlignedBuffer & other) noexcept {
+            std::swap(this->storage_, other.storage_);
+            std::swap(this->data_, other.data_);
+            std::swap(this->size_, other.size_);
+        }
+
+    private:
+
+        void allocate(size_type n) {
+            this->release();
+            if (n == 0) {
+                return;
+            }
+            this->storage_ = ::operator new(n * sizeof(T) + Alignment - 1);
+            std::uintptr_t address = reinterpret_cast<std::uintptr_t>(this->storage_);
+            address = (address + Alignment - 1) & ~static_cast<std::uintptr_t>(Alignment - 1);
+            this->data_ = reinterpret_cast<T *>(address);
+            this->size_ = n;
+        }
+
+        void release() {
+            ::operator delete(this->storage_);
+            this->storage_ = nullptr;
+            this->data_ = nullptr;
+            this->size_ = 0;
+        }
+
+    private:
+        void *          storage_;
+        T *             data_;
+        size_type       size_;
+
+}; // AlignedBuffer
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,133 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Layout and encoding of the platypus binary tree container format.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_UTILITY_BINARYFORMAT_HPP
+#define PLATYPUS_UTILITY_BINARYFORMAT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace platypus {
+
+/**
+ * The binary tree container written by platypus::BinaryTreeWriter and read
+ * by platypus::BinaryTreeReader. All integers and floating-point values are
+ * little-endian.
+ *
+ *      header:     "PLTB", u32 version
+ *      trees:      one record per tree:
+ *                      u32 number of nodes (n)
+ *                      u8  flags (see below)
+ *                      u32 x n: number of children of each node, in preorder
+ *                      u32 x n: label index of each node, or 0xFFFFFFFF if
+ *                               unlabeled (if HAS_LABELS)
+ *                      f32 or f64 x n: edge length of each node (if
+ *                               HAS_EDGE_LENGTHS; f32 if
+ *                               SINGLE_PRECISION_EDGE_LENGTHS)
+ *      footer:     u32 number of labels, then for each label:
+ *                      u32 size, bytes
+ *                  u64 number of trees, then for each tree:
+ *                      u64 offset of record from start of container
+ *      trailer:    u64 offset of footer from start of container, "PLTI"
+ *
+ * The node labels of all trees in a container are held in a single table
+ * in the footer, so that each distinct label (e.g., taxon name) is stored
+ * once, and the footer indexes all tree records, so that any tree can be
+ * read without reading those preceding it.
+ */
+namespace binary_format {
+
+static const char           HEADER_MAGIC[4] = {'P', 'L', 'T', 'B'};
+static const char           TRAILER_MAGIC[4] = {'P', 'L', 'T', 'I'};
+static const std::uint32_t  VERSION = 1;
+static const std::size_t    HEADER_SIZE = 8;
+static const std::size_t    TRAILER_SIZE = 12;
+static const std::uint32_t  NO_LABEL = 0xFFFFFFFF;
+
+// tree record flags
+static const std::uint8_t   IS_ROOTED = 1;
+static const std::uint8_t   HAS_ROOTING = 2;
+static const std::uint8_t   HAS_LABELS = 4;
+static const std::uint8_t   HAS_EDGE_LENGTHS = 8;
+static const std::uint8_t   SINGLE_PRECISION_EDGE_LENGTHS = 16;
+
+inline void append_u32(std::string & buffer, std::uint32_t value) {
+    char bytes[4];
+    for (int i = 0; i < 4; ++i) {
+        bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+    buffer.append(bytes, 4);
+}
+
+inline void append_u64(std::string & buffer, std::uint64_t value) {
+    char bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+    buffer.append(bytes, 8);
+}
+
+inline void append_f32(std::string & buffer, float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    append_u32(buffer, bits);
+}
+
+inline void append_f64(std::string & buffer, double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    append_u64(buffer, bits);
+}
+
+inline std::uint32_t decode_u32(const char * src) {
+    const unsigned char * bytes = reinterpret_cast<const unsigned char *>(src);
+    return static_cast<std::uint32_t>(bytes[0])
+        | (static_cast<std::uint32_t>(bytes[1]) << 8)
+        | (static_cast<std::uint32_t>(bytes[2]) << 16)
+        | (static_cast<std::uint32_t>(bytes[3]) << 24);
+}
+
+inline std::uint64_t decode_u64(const char * src) {
+    return static_cast<std::uint64_t>(decode_u32(src))
+        | (static_cast<std::uint64_t>(decode_u32(src + 4)) << 32);
+}
+
+inline float decode_f32(const char * src) {
+    std::uint32_t bits = decode_u32(src);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline double decode_f64(const char * src) {
+    std::uint64_t bits = decode_u64(src);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+} // namespace binary_format
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,59 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Bit operations on 64-bit words.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_UTILITY_BITOPS_HPP
+#define PLATYPUS_UTILITY_BITOPS_HPP
+
+#include <cstdint>
+
+namespace platypus {
+namespace bitops {
+
+// Number of set bits of ``w``.
+inline unsigned int popcount(std::uint64_t w) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned int>(__builtin_popcountll(w));
+#else
+    w = w - ((w >> 1) & 0x5555555555555555ULL);
+    w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+    w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<unsigned int>((w * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Index of the lowest set bit of ``w``, which must not be 0.
+inline unsigned int lowest_bit(std::uint64_t w) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned int>(__builtin_ctzll(w));
+#else
+    unsigned int idx = 0;
+    while ((w & 1) == 0) {
+        w >>= 1;
+        ++idx;
+    }
+    return idx;
+#endif
+}
+
+} // namespace bitops
+} // namespace platypus
+
+#endif
@@ -0,0 +1,559 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Streaming gzip decompression and compression (requires zlib).
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_UTILITY_GZIPSTREAM_HPP
+#define PLATYPUS_UTILITY_GZIPSTREAM_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+#include "../base/exception.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// GzipStreamError
+
+class GzipStreamError : public PlatypusException {
+    public:
+        GzipStreamError(
+                    const std::string & filename,
+                    unsigned long line_num,
+                    const std::string & message)
+            : PlatypusException(filename, line_num, message) { }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// GzipInputStreamBuffer
+
+/**
+ * A read-only stream buffer that decompresses gzip data read from another
+ * stream. Decompression runs on a separate thread, which fills a bounded
+ * queue of chunks of decompressed data ahead of the consumer, so that
+ * decompression overlaps with the parsing of the data already decompressed.
+ *
+ * Concatenated gzip members are decompressed in sequence, as by ``gzip
+ * -d``. Data that does not start with the gzip magic number is passed
+ * through as-is, so that plain and compressed sources can be read
+ * through the same code.
+ *
+ * Read errors and corrupt data are reported by throwing GzipStreamError
+ * from underflow(), i.e. out of the read operation of the consumer (the
+ * platypus tokenizers read the stream buffer directly, and so pass the
+ * exception on; a std::istream swallows it unless ``badbit`` is set in
+ * its exception mask, as GzipInputStream does).
+ */
+class GzipInputStreamBuffer : public std::streambuf {
+
+    public:
+
+        /**
+         * @param src
+         *   Source of compressed data, which must remain valid until this
+         *   object has been destroyed, and must not be read otherwise in
+         *   the meantime.
+         * @param chunk_size
+         *   Size of each chunk of decompressed data.
+         * @param max_chunks_ahead
+         *   Maximum number of decompressed chunks queued ahead of the
+         *   consumer.
+         */
+        GzipInputStreamBuffer(std::istream & src,
+                std::size_t chunk_size=262144,
+                std::size_t max_chunks_ahead=4)
+            : src_(src)
+            , chunk_size_(chunk_size > 0 ? chunk_size : 1)
+            , max_chunks_ahead_(max_chunks_ahead > 0 ? max_chunks_ahead : 1)
+            , is_finished_(false)
+            , is_cancelled_(false)
+            , num_bytes_consumed_(0) {
+            this->setg(nullptr, nullptr, nullptr);
+            this->decompressor_ = std::thread(&GzipInputStreamBuffer::run_decompressor, this);
+        }
+
+        GzipInputStreamBuffer(const GzipInputStreamBuffer &) = delete;
+        GzipInputStreamBuffer & operator=(const GzipInputStreamBuffer &) = delete;
+
+        ~GzipInputStreamBuffer() {
+            {
+                std::lock_guard<std::mutex> lock(this->mutex_);
+                this->is_cancelled_ = true;
+            }
+            this->chunk_consumed_.notify_all();
+            this->decompressor_.join();
+        }
+
+    protected:
+
+        int_type underflow() override {
+            if (this->gptr() < this->egptr()) {
+                return traits_type::to_int_type(*this->gptr());
+            }
+            std::unique_lock<std::mutex> lock(this->mutex_);
+            if (!this->current_chunk_.empty()) {
+                this->num_bytes_consumed_ += this->current_chunk_.size();
+                this->free_chunks_.push_back(std::move(this->current_chunk_));
+                this->current_chunk_.clear();
+                this->chunk_consumed_.notify_one();
+            }
+            this->setg(nullptr, nullptr, nullptr);
+            this->chunk_ready_.wait(lock, [this] () {
+                return !this->ready_chunks_.empty() || this->is_finished_;
+            });
+            if (this->ready_chunks_.empty()) {
+                if (this->error_) {
+                    std::exception_ptr error = this->error_;
+                    this->error_ = nullptr;
+                    std::rethrow_exception(error);
+                }
+                return traits_type::eof();
+            }
+            this->current_chunk_ = std::move(this->ready_chunks_.front());
+            this->ready_chunks_.pop_front();
+            this->chunk_consumed_.notify_one();
+            char * begin = &this->current_chunk_[0];
+            this->setg(begin, begin, begin + this->current_chunk_.size());
+            return traits_type::to_int_type(*this->gptr());
+        }
+
+        // Only supports querying the current position (in the decompressed
+        // data), e.g. by ``tellg()``.
+        pos_type seekoff(off_type off,
+                std::ios_base::seekdir dir,
+                std::ios_base::openmode which=std::ios_base::in) override {
+            if (off != 0 || dir != std::ios_base::cur || !(which & std::ios_base::in)) {
+                return pos_type(off_type(-1));
+            }
+            return pos_type(static_cast<off_type>(this->num_bytes_consumed_ + (this->gptr() - this->eback())));
+        }
+
+    private:
+
+        // Waits for a free slot in the queue, and returns a buffer to fill
+        // (or false if cancelled).
+        bool acquire_chunk(std::string & chunk) {
+            std::unique_lock<std::mutex> lock(this->mutex_);
+            this->chunk_consumed_.wait(lock, [this] () {
+                return this->ready_chunks_.size() < this->max_chunks_ahead_ || this->is_cancelled_;
+            });
+            if (this->is_cancelled_) {
+                return false;
+            }
+            if (!this->free_chunks_.empty()) {
+                chunk = std::move(this->free_chunks_.back());
+                this->free_chunks_.pop_back();
+            }
+            chunk.resize(this->chunk_size_);
+            return true;
+        }
+
+        void publish_chunk(std::string & chunk, std::size_t size) {
+            if (size == 0) {
+                return;
+            }
+            chunk.resize(size);
+            {
+                std::lock_guard<std::mutex> lock(this->mutex_);
+                this->ready_chunks_.push_back(std::move(chunk));
+            }
+            chunk.clear();
+            this->chunk_ready_.notify_one();
+        }
+
+        // Reads up to ``size`` bytes of compressed data into ``buffer``.
+        std::size_t read_source(char * buffer, std::size_t size) {
+            this->src_.read(buffer, static_cast<std::streamsize>(size));
+            if (this->src_.bad()) {
+                throw GzipStreamError(__FILE__, __LINE__, "platypus::GzipInputStreamBuffer: error reading source");
+            }
+            return static_cast<std::size_t>(this->src_.gcount());
+        }
+
+        void run_decompressor() {
+            try {
+                this->decompress();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(this->mutex_);
+                this->error_ = std::current_exception();
+            }
+            {
+                std::lock_guard<std::mutex> lock(this->mutex_);
+                this->is_finished_ = true;
+            }
+            this->chunk_ready_.notify_all();
+        }
+
+        void decompress() {
+            std::vector<char> input(this->chunk_size_);
+            std::size_t input_size = this->read_source(input.data(), input.size());
+            std::string chunk;
+            if (input_size < 2
+                    || static_cast<unsigned char>(input[0]) != 0x1f
+                    || static_cast<unsigned char>(input[1]) != 0x8b) {
+                // not compressed: pass through
+                while (input_size > 0) {
+                    if (!this->acquire_chunk(chunk)) {
+                        return;
+                    }
+                    chunk.assign(input.data(), input_size);
+                    this->publish_chunk(chunk, input_size);
+                    input_size = this->read_source(input.data(), input.size());
+                }
+                return;
+            }
+            z_stream zs;
+            zs.zalloc = Z_NULL;
+            zs.zfree = Z_NULL;
+            zs.opaque = Z_NULL;
+            zs.next_in = Z_NULL;
+            zs.avail_in = 0;
+            if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+                throw GzipStreamError(__FILE__, __LINE__, "platypus::GzipInputStreamBuffer: unable to initialize decompression");
+            }
+            std::unique_ptr<z_stream, int (*)(z_streamp)> zs_guard(&zs, inflateEnd);
+            zs.next_in = reinterpret_cast<Bytef *>(input.data());
+            zs.avail_in = static_cast<uInt>(input_size);
+            bool member_complete = false;
+            while (true) {
+                if (!this->acquire_chunk(chunk)) {
+                    return;
+                }
+                zs.next_out = reinterpret_cast<Bytef *>(&chunk[0]);
+                zs.avail_out = static_cast<uInt>(chunk.size());
+                while (zs.avail_out > 0) {
+                    if (zs.avail_in == 0) {
+                        input_size = this->read_source(input.data(), input.size());
+                        if (input_size == 0) {
+                            break;
+                        }
+                        zs.next_in = reinterpret_cast<Bytef *>(input.data());
+                        zs.avail_in = static_cast<uInt>(input_size);
+                    }
+                    if (member_complete) {
+                        // another member follows
+                        inflateReset(&zs);
+                        member_complete = false;
+                    }
+                    int status = inflate(&zs, Z_NO_FLUSH);
+                    if (status == Z_STREAM_END) {
+                        member_complete = true;
+                    } else if (status != Z_OK && status != Z_BUF_ERROR) {
+                        throw GzipStreamError(__FILE__, __LINE__,
+                                std::string("platypus::GzipInputStreamBuffer: corrupt compressed data")
+                                + (zs.msg != nullptr ? std::string(": ") + zs.msg : std::string()));
+                    }
+                }
+                std::size_t size = chunk.size() - zs.avail_out;
+                this->publish_chunk(chunk, size);
+                if (zs.avail_out > 0) {
+                    // source exhausted
+                    if (!member_complete) {
+                        throw GzipStreamError(__FILE__, __LINE__, "platypus::GzipInputStreamBuffer: unexpected end of compressed data");
+                    }
+                    return;
+                }
+            }
+        }
+
+    private:
+        std::istream &              src_;
+        std::size_t                 chunk_size_;
+        std::size_t                 max_chunks_ahead_;
+        std::thread                 decompressor_;
+        std::mutex                  mutex_;
+        std::condition_variable     chunk_ready_;
+        std::condition_variable     chunk_consumed_;
+        std::deque<std::string>     ready_chunks_;
+        std::vector<std::string>    free_chunks_;
+        bool                        is_finished_;
+        bool                        is_cancelled_;
+        std::exception_ptr          error_;
+        // owned by the consumer
+        std::string                 current_chunk_;
+        std::size_t                 num_bytes_consumed_;
+
+}; // GzipInputStreamBuffer
+
+////////////////////////////////////////////////////////////////////////////////
+// GzipOutputStreamBuffer
+
+/**
+ * A write-only stream buffer that compresses data written to it in gzip
+ * format, and writes it to another stream. The gzip stream is completed
+ * by close(), or on destruction.
+ */
+class GzipOutputStreamBuffer : public std::streambuf {
+
+    public:
+
+        /**
+         * @param dest
+         *   Destination for the compressed data, which must remain valid
+         *   until this object has been closed.
+         * @param level
+         *   Compression level, from 1 (fastest) to 9 (best compression);
+         *   the zlib default (currently, 6) if -1.
+         * @param buffer_size
+         *   Amount of uncompressed data buffered before compression.
+         */
+        GzipOutputStreamBuffer(std::ostream & dest,
+                int level=Z_DEFAULT_COMPRESSION,
+                std::size_t buffer_size=262144)
+            : dest_(dest)
+            , buffer_(buffer_size > 0 ? buffer_size : 1)
+            , output_(buffer_.size() + 64)
+            , is_open_(true) {
+            this->zs_.zalloc = Z_NULL;
+            this->zs_.zfree = Z_NULL;
+            this->zs_.opaque = Z_NULL;
+            if (deflateInit2(&this->zs_, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                throw GzipStreamError(__FILE__, __LINE__, "platypus::GzipOutputStreamBuffer: unable to initialize compression");
+            }
+            this->setp(this->buffer_.data(), this->buffer_.data() + this->buffer_.size());
+        }
+
+        GzipOutputStreamBuffer(const GzipOutputStreamBuffer &) = delete;
+        GzipOutputStreamBuffer & operator=(const GzipOutputStreamBuffer &) = delete;
+
+        ~GzipOutputStreamBuffer() {
+            try {
+                this->close();
+            } catch (...) {
+                // destructors do not throw
+            }
+        }
+
+        /**
+         * Compresses any data still buffered, writes the gzip trailer, and
+         * flushes the destination. Nothing may be written afterwards.
+         */
+        void close() {
+            if (!this->is_open_) {
+                return;
+            }
+            this->is_open_ = false;
+            try {
+                this->compress(Z_FINISH);
+            } catch (...) {
+                deflateEnd(&this->zs_);
+                throw;
+            }
+            deflateEnd(&this->zs_);
+            this->dest_.flush();
+        }
+
+    protected:
+
+        int_type overflow(int_type ch) override {
+            if (!this->is_open_) {
+                return traits_type::eof();
+            }
+            this->compress(Z_NO_FLUSH);
+            if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                *this->pptr() = traits_type::to_char_type(ch);
+                this->pbump(1);
+            }
+            return traits_type::not_eof(ch);
+        }
+
+        // Data is compressed with Z_SYNC_FLUSH, so that everything written
+        // so far can be decompressed (at some cost in compression).
+        int sync() override {
+            if (!this->is_open_) {
+                return 0;
+            }
+            this->compress(Z_SYNC_FLUSH);
+            this->dest_.flush();
+            return this->dest_ ? 0 : -1;
+        }
+
+        std::streamsize xsputn(const char * s, std::streamsize count) override {
+            std::streamsize num_written = 0;
+            while (num_written < count) {
+                std::streamsize available = this->epptr() - this->pptr();
+                if (available == 0) {
+                    if (traits_type::eq_int_type(this->overflow(traits_type::eof()), traits_type::eof())) {
+                        break;
+                    }
+                    continue;
+                }
+                std::streamsize n = std::min(available, count - num_written);
+                traits_type::copy(this->pptr(), s + num_written, static_cast<std::size_t>(n));
+                this->pbump(static_cast<int>(n));
+                num_written += n;
+            }
+            return num_written;
+        }
+
+    private:
+
+        // Compresses the buffered data, and writes out what is produced.
+        void compress(int flush) {
+            this->zs_.next_in = reinterpret_cast<Bytef *>(this->pbase());
+            this->zs_.avail_in = static_cast<uInt>(this->pptr() - this->pbase());
+            while (true) {
+                this->zs_.next_out = reinterpret_cast<Bytef *>(this->output_.data());
+                this->zs_.avail_out = static_cast<uInt>(this->output_.size());
+                int status = deflate(&this->zs_, flush);
+                if (status == Z_STREAM_ERROR) {
+                    throw GzipStreamError(__FILE__, __LINE__, "platypus::GzipOutputStreamBuffer: compression error");
+                }
+                std::size_t size = this->output_.size() - this->zs_.avail_out;
+                this->dest_.write(this->output_.data(), static_cast<std::streamsize>(size));
+                if (!this->dest_) {
+                    throw GzipStreamError(__FILE__, __LINE__, "platypus::GzipOutputStreamBuffer: error writing destination");
+                }
+                if (flush == Z_FINISH ? status == Z_STREAM_END : (this->zs_.avail_out > 0 && this->zs_.avail_in == 0)) {
+                    break;
+                }
+            }
+            this->setp(this->buffer_.data(), this->buffer_.data() + this->buffer_.size());
+        }
+
+    private:
+        std::ostream &      dest_;
+        std::vector<char>   buffer_;
+        std::vector<char>   output_;
+        z_stream            zs_;
+        bool                is_open_;
+
+}; // GzipOutputStreamBuffer
+
+////////////////////////////////////////////////////////////////////////////////
+// GzipInputStream
+
+/**
+ * An input stream of the data decompressed from a gzip-compressed stream
+ * or file (see GzipInputStreamBuffer), for passing to
+ * BaseTreeReader::read() and similar:
+ *
+ *      platypus::GzipInputStream src("trees.nex.gz");
+ *      tree_reader.read(src, tree_factory);
+ *
+ * Errors in the compressed data are thrown as GzipStreamError.
+ */
+class GzipInputStream : public std::istream {
+
+    public:
+
+        GzipInputStream(std::istream & src,
+                std::size_t chunk_size=262144,
+                std::size_t max_chunks_ahead=4)
+            : std::istream(nullptr)
+            , buffer_(new GzipInputStreamBuffer(src, chunk_size, max_chunks_ahead)) {
+            this->rdbuf(this->buffer_.get());
+            this->exceptions(std::ios::badbit);
+        }
+
+        GzipInputStream(const std::string & path,
+                std::size_t chunk_size=262144,
+                std::size_t max_chunks_ahead=4)
+            : std::istream(nullptr)
+            , file_(new std::ifstream(path, std::ios::in | std::ios::binary)) {
+            if (!*this->file_) {
+                throw GzipStreamError(__FILE__, __LINE__, "Unable to open file: '" + path + "'");
+            }
+            this->buffer_.reset(new GzipInputStreamBuffer(*this->file_, chunk_size, max_chunks_ahead));
+            this->rdbuf(this->buffer_.get());
+            this->exceptions(std::ios::badbit);
+        }
+
+        ~GzipInputStream() {
+            // stop the decompressor before closing its source
+            this->buffer_.reset();
+        }
+
+    private:
+        std::unique_ptr<std::ifstream>              file_;
+        std::unique_ptr<GzipInputStreamBuffer>      buffer_;
+
+}; // GzipInputStream
+
+////////////////////////////////////////////////////////////////////////////////
+// GzipOutputStream
+
+/**
+ * An output stream that gzip-compresses the data written to it into
+ * another stream or a file (see GzipOutputStreamBuffer), for passing to
+ * NewickWriter::write() and similar:
+ *
+ *      platypus::GzipOutputStream dest("trees.tre.gz");
+ *      tree_writer.write(dest, trees.begin(), trees.end());
+ *      dest.close();
+ *
+ * The compressed stream is completed by close(), or on destruction.
+ */
+class GzipOutputStream : public std::ostream {
+
+    public:
+
+        GzipOutputStream(std::ostream & dest,
+                int level=Z_DEFAULT_COMPRESSION,
+                std::size_t buffer_size=262144)
+            : std::ostream(nullptr)
+            , buffer_(new GzipOutputStreamBuffer(dest, level, buffer_size)) {
+            this->rdbuf(this->buffer_.get());
+        }
+
+        GzipOutputStream(const std::string & path,
+                int level=Z_DEFAULT_COMPRESSION,
+                std::size_t buffer_size=262144)
+            : std::ostream(nullptr)
+            , file_(new std::ofstream(path, std::ios::out | std::ios::binary)) {
+            if (!*this->file_) {
+                throw GzipStreamError(__FILE__, __LINE__, "Unable to open file: '" + path + "'");
+            }
+            this->buffer_.reset(new GzipOutputStreamBuffer(*this->file_, level, buffer_size));
+            this->rdbuf(this->buffer_.get());
+        }
+
+        ~GzipOutputStream() {
+            // complete the stream before closing its destination
+            this->buffer_.reset();
+        }
+
+        void close() {
+            this->buffer_->close();
+            if (this->file_) {
+                this->file_->close();
+            }
+        }
+
+    private:
+        std::unique_ptr<std::ofstream>              file_;
+        std::unique_ptr<GzipOutputStreamBuffer>     buffer_;
+
+}; // GzipOutputStream
+
+} // namespace platypus
+
+#endif
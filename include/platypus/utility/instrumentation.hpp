@@ -0,0 +1,267 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Optional counters and phase timers for readers, writers and simulators.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_UTILITY_INSTRUMENTATION_HPP
+#define PLATYPUS_UTILITY_INSTRUMENTATION_HPP
+
+#include <algorithm>
+#include <chrono>
+#include "memoryusage.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// Instrumentation
+//
+// Counters and phase timers for readers, writers and simulators are compiled
+// in only if PLATYPUS_ENABLE_INSTRUMENTATION is defined (before any platypus
+// header is included). Otherwise, all recording operations are empty inline
+// functions, and all statistics remain zero.
+
+////////////////////////////////////////////////////////////////////////////////
+// InstrumentationCounter
+
+/**
+ * A count that is only incremented if instrumentation is enabled.
+ */
+class InstrumentationCounter {
+
+    public:
+        InstrumentationCounter()
+            : value_(0) { }
+
+#if defined(PLATYPUS_ENABLE_INSTRUMENTATION)
+        inline void increment(unsigned long n=1) {
+            this->value_ += n;
+        }
+#else
+        inline void increment(unsigned long=1) { }
+#endif
+        inline unsigned long value() const {
+            return this->value_;
+        }
+        inline void clear() {
+            this->value_ = 0;
+        }
+
+    private:
+        unsigned long value_;
+
+}; // InstrumentationCounter
+
+////////////////////////////////////////////////////////////////////////////////
+// InstrumentationTimer
+
+/**
+ * Adds the (wall-clock) time elapsed over its lifetime, or until ``stop()``
+ * is called, to ``seconds``, if instrumentation is enabled.
+ */
+class InstrumentationTimer {
+
+    public:
+#if defined(PLATYPUS_ENABLE_INSTRUMENTATION)
+        InstrumentationTimer(double & seconds)
+            : seconds_(seconds)
+            , start_(std::chrono::steady_clock::now())
+            , is_running_(true) { }
+        ~InstrumentationTimer() {
+            this->stop();
+        }
+        inline void stop() {
+            if (this->is_running_) {
+                this->seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start_).count();
+                this->is_running_ = false;
+            }
+        }
+#else
+        InstrumentationTimer(double &) { }
+        inline void stop() { }
+#endif
+        InstrumentationTimer(const InstrumentationTimer &) = delete;
+        InstrumentationTimer & operator=(const InstrumentationTimer &) = delete;
+
+#if defined(PLATYPUS_ENABLE_INSTRUMENTATION)
+    private:
+        double &                                    seconds_;
+        std::chrono::steady_clock::time_point       start_;
+        bool                                        is_running_;
+#endif
+
+}; // InstrumentationTimer
+
+////////////////////////////////////////////////////////////////////////////////
+// InstrumentationStats
+
+/**
+ * Work done and time spent by a tree producer (see
+ * BaseTreeProducer::get_stats()) or writer (see
+ * BaseTreeWriter::get_stats()), to tell whether a job is bound by I/O,
+ * tokenizing or tree construction.
+ *
+ * Phases are timed as follows:
+ *
+ *  - ``scan_seconds``: passes over the source made before any trees are
+ *    built, i.e. the pre-scan for tree statement boundaries when reading
+ *    in parallel, or the parsing of the source into NCL data structures;
+ *  - ``build_seconds``: constructing trees; for readers, this includes
+ *    tokenizing, as tokens are consumed as they are produced, so that the
+ *    difference between ``build_seconds`` and the time taken to scan the
+ *    same number of bytes is the cost of construction proper;
+ *  - ``postprocess_seconds``: calling the tree post-processing function;
+ *  - ``write_seconds``: composing and writing trees.
+ *
+ * ``peak_resident_bytes`` is the peak resident set size of the process (see
+ * memory::peak_resident_bytes()) when bytes were last read or written.
+ */
+class InstrumentationStats {
+
+    public:
+        // Whether statistics are being collected at all.
+        static constexpr bool is_enabled() {
+#if defined(PLATYPUS_ENABLE_INSTRUMENTATION)
+            return true;
+#else
+            return false;
+#endif
+        }
+
+    public:
+        InstrumentationStats() {
+            this->clear();
+        }
+
+        void clear() {
+            this->num_bytes_read = 0;
+            this->num_tokens = 0;
+            this->num_comments = 0;
+            this->num_nodes = 0;
+            this->num_trees = 0;
+            this->num_bytes_written = 0;
+            this->scan_seconds = 0.0;
+            this->build_seconds = 0.0;
+            this->postprocess_seconds = 0.0;
+            this->write_seconds = 0.0;
+            this->peak_resident_bytes = 0;
+        }
+
+        InstrumentationStats & operator+=(const InstrumentationStats & other) {
+            this->num_bytes_read += other.num_bytes_read;
+            this->num_tokens += other.num_tokens;
+            this->num_comments += other.num_comments;
+            this->num_nodes += other.num_nodes;
+            this->num_trees += other.num_trees;
+            this->num_bytes_written += other.num_bytes_written;
+            this->scan_seconds += other.scan_seconds;
+            this->build_seconds += other.build_seconds;
+            this->postprocess_seconds += other.postprocess_seconds;
+            this->write_seconds += other.write_seconds;
+            this->peak_resident_bytes = std::max(this->peak_resident_bytes, other.peak_resident_bytes);
+            return *this;
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Recording (no-ops unless instrumentation is enabled)
+
+#if defined(PLATYPUS_ENABLE_INSTRUMENTATION)
+        inline void record_bytes_read(unsigned long n) {
+            this->num_bytes_read += n;
+            this->record_peak_memory();
+        }
+        inline void record_tokens(unsigned long n, unsigned long comments) {
+            this->num_tokens += n;
+            this->num_comments += comments;
+        }
+        inline void record_tree(unsigned long nodes) {
+            this->num_nodes += nodes;
+            ++this->num_trees;
+        }
+        inline void record_bytes_written(unsigned long n) {
+            this->num_bytes_written += n;
+            this->record_peak_memory();
+        }
+        inline void record_peak_memory() {
+            this->peak_resident_bytes = std::max(this->peak_resident_bytes,
+                    static_cast<unsigned long>(memory::peak_resident_bytes()));
+        }
+#else
+        inline void record_bytes_read(unsigned long) { }
+        inline void record_tokens(unsigned long, unsigned long) { }
+        inline void record_tree(unsigned long) { }
+        inline void record_bytes_written(unsigned long) { }
+        inline void record_peak_memory() { }
+#endif
+
+        /////////////////////////////////////////////////////////////////////////
+        // Reporting
+
+        /**
+         * Appends a row with the statistics to ``table`` (a
+         * platypus::DataTable), first adding the columns if the table has
+         * none.
+         */
+        template <class DataTableT>
+        void export_table(DataTableT & table) const {
+            if (table.num_columns() == 0) {
+                table.template add_data_column<unsigned long>("bytes_read");
+                table.template add_data_column<unsigned long>("tokens");
+                table.template add_data_column<unsigned long>("comments");
+                table.template add_data_column<unsigned long>("nodes");
+                table.template add_data_column<unsigned long>("trees");
+                table.template add_data_column<unsigned long>("bytes_written");
+                table.template add_data_column<double>("scan_seconds");
+                table.template add_data_column<double>("build_seconds");
+                table.template add_data_column<double>("postprocess_seconds");
+                table.template add_data_column<double>("write_seconds");
+                table.template add_data_column<unsigned long>("peak_resident_bytes");
+            }
+            auto & row = table.add_row();
+            row << this->num_bytes_read
+                << this->num_tokens
+                << this->num_comments
+                << this->num_nodes
+                << this->num_trees
+                << this->num_bytes_written
+                << this->scan_seconds
+                << this->build_seconds
+                << this->postprocess_seconds
+                << this->write_seconds
+                << this->peak_resident_bytes;
+        }
+
+    public:
+        unsigned long   num_bytes_read;
+        unsigned long   num_tokens;
+        unsigned long   num_comments;
+        unsigned long   num_nodes;
+        unsigned long   num_trees;
+        unsigned long   num_bytes_written;
+        double          scan_seconds;
+        double          build_seconds;
+        double          postprocess_seconds;
+        double          write_seconds;
+        unsigned long   peak_resident_bytes;
+
+}; // InstrumentationStats
+
+} // namespace platypus
+
+#endif
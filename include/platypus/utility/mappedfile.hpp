@@ -0,0 +1,173 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Read-only memory-mapped file.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_UTILITY_MAPPEDFILE_HPP
+#define PLATYPUS_UTILITY_MAPPEDFILE_HPP
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include "../base/exception.hpp"
+
+#if defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__))
+#define PLATYPUS_HAVE_MMAP 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedFileError
+
+class MappedFileError : public PlatypusException {
+    public:
+        MappedFileError(
+                    const std::string & filename,
+                    unsigned long line_num,
+                    const std::string & message)
+            : PlatypusException(filename, line_num, message) { }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedFile
+
+/**
+ * Provides read-only access to the contents of a file as a contiguous
+ * character buffer, by mapping it into memory where the platform supports it
+ * (and by reading it into memory where it does not). The buffer is valid for
+ * the lifetime of the object.
+ */
+class MappedFile {
+
+    public:
+
+        MappedFile(const std::string & path)
+            : data_(nullptr)
+            , size_(0)
+            , is_mapped_(false) {
+            this->open(path);
+        }
+
+        MappedFile(MappedFile && other)
+            : data_(other.data_)
+            , size_(other.size_)
+            , is_mapped_(other.is_mapped_)
+            , fallback_buffer_(std::move(other.fallback_buffer_)) {
+            if (!this->is_mapped_) {
+                this->data_ = this->fallback_buffer_.data();
+            }
+            other.data_ = nullptr;
+            other.size_ = 0;
+            other.is_mapped_ = false;
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile & operator=(const MappedFile &) = delete;
+
+        ~MappedFile() {
+            this->close();
+        }
+
+        inline const char * data() const {
+            return this->data_;
+        }
+
+        inline std::size_t size() const {
+            return this->size_;
+        }
+
+        inline const char * begin() const {
+            return this->data_;
+        }
+
+        inline const char * end() const {
+            return this->data_ + this->size_;
+        }
+
+        inline bool is_mapped() const {
+            return this->is_mapped_;
+        }
+
+    private:
+
+        void open(const std::string & path) {
+#if defined(PLATYPUS_HAVE_MMAP)
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw MappedFileError(__FILE__, __LINE__, "Unable to open file: '" + path + "'");
+            }
+            struct stat file_stat;
+            if (::fstat(fd, &file_stat) != 0) {
+                ::close(fd);
+                throw MappedFileError(__FILE__, __LINE__, "Unable to determine size of file: '" + path + "'");
+            }
+            this->size_ = static_cast<std::size_t>(file_stat.st_size);
+            if (this->size_ > 0) {
+                void * addr = ::mmap(nullptr, this->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (addr != MAP_FAILED) {
+                    ::madvise(addr, this->size_, MADV_SEQUENTIAL);
+                    this->data_ = static_cast<const char *>(addr);
+                    this->is_mapped_ = true;
+                }
+            }
+            ::close(fd);
+            if (this->is_mapped_ || this->size_ == 0) {
+                return;
+            }
+#endif
+            // not mappable: read into memory instead
+            std::ifstream src(path, std::ios::in | std::ios::binary);
+            if (!src) {
+                throw MappedFileError(__FILE__, __LINE__, "Unable to open file: '" + path + "'");
+            }
+            std::ostringstream contents;
+            contents << src.rdbuf();
+            this->fallback_buffer_ = contents.str();
+            this->data_ = this->fallback_buffer_.data();
+            this->size_ = this->fallback_buffer_.size();
+        }
+
+        void close() {
+#if defined(PLATYPUS_HAVE_MMAP)
+            if (this->is_mapped_) {
+                ::munmap(const_cast<char *>(this->data_), this->size_);
+            }
+#endif
+            this->data_ = nullptr;
+            this->size_ = 0;
+            this->is_mapped_ = false;
+            this->fallback_buffer_.clear();
+        }
+
+    private:
+        const char *    data_;
+        std::size_t     size_;
+        bool            is_mapped_;
+        std::string     fallback_buffer_;
+
+}; // MappedFile
+
+} // namespace platypus
+
+#endif
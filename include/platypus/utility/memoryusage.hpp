@@ -0,0 +1,246 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Accounting of memory used by trees, tables, and the process.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_UTILITY_MEMORYUSAGE_HPP
+#define PLATYPUS_UTILITY_MEMORYUSAGE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__))
+#define PLATYPUS_HAS_GETRUSAGE
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// MemoryUsage
+
+/**
+ * An account of the memory held by a data structure (e.g., from
+ * Tree::memory_usage() or DataTable::memory_usage()), in bytes:
+ *
+ *  - ``object_bytes``: storage of the elements themselves (e.g., tree
+ *    nodes, or column values), including any reserved but unused capacity;
+ *  - ``bookkeeping_bytes``: containers that index or track the elements
+ *    (e.g., the set of nodes allocated by a tree);
+ *  - ``heap_bytes``: storage owned by the elements and allocated separately
+ *    (e.g., label strings too long to be held in place).
+ *
+ * Container overheads are estimated from their sizes and capacities, as
+ * allocators do not report them: they do not include allocator headers or
+ * fragmentation, so the figures are lower bounds on what the process uses.
+ */
+struct MemoryUsage {
+
+    MemoryUsage()
+        : num_objects(0)
+        , object_bytes(0)
+        , bookkeeping_bytes(0)
+        , heap_bytes(0) {
+    }
+
+    std::size_t total_bytes() const {
+        return this->object_bytes + this->bookkeeping_bytes + this->heap_bytes;
+    }
+
+    MemoryUsage & operator+=(const MemoryUsage & other) {
+        this->num_objects += other.num_objects;
+        this->object_bytes += other.object_bytes;
+        this->bookkeeping_bytes += other.bookkeeping_bytes;
+        this->heap_bytes += other.heap_bytes;
+        return *this;
+    }
+
+    // number of elements (e.g., nodes, or rows)
+    std::size_t     num_objects;
+    std::size_t     object_bytes;
+    std::size_t     bookkeeping_bytes;
+    std::size_t     heap_bytes;
+
+}; // MemoryUsage
+
+namespace memory {
+
+// Bytes allocated by ``s`` outside of the object itself (zero if the string
+// is held in the small-string buffer).
+inline std::size_t heap_bytes(const std::string & s) {
+    static const std::size_t local_capacity = std::string().capacity();
+    return s.capacity() > local_capacity ? s.capacity() + 1 : 0;
+}
+
+// Bytes allocated by ``v`` for its elements (not including any storage owned
+// by the elements themselves).
+template <class T, class A>
+inline std::size_t heap_bytes(const std::vector<T, A> & v) {
+    return v.capacity() * sizeof(T);
+}
+
+// Estimated bytes allocated by ``s``: its bucket array, and one node (value
+// and link) per element.
+template <class T, class H, class E, class A>
+inline std::size_t heap_bytes(const std::unordered_set<T, H, E, A> & s) {
+    return s.bucket_count() * sizeof(void *) + s.size() * (sizeof(T) + sizeof(void *));
+}
+
+/**
+ * The peak resident set size of the process so far, in bytes, or 0 if it
+ * cannot be determined on this platform.
+ */
+inline std::size_t peak_resident_bytes() {
+#if defined(PLATYPUS_HAS_GETRUSAGE)
+    struct rusage usage;
+    if (::getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__) && defined(__MACH__)
+    return static_cast<std::size_t>(usage.ru_maxrss);          // bytes
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;   // kilobytes
+#endif
+#else
+    return 0;
+#endif
+}
+
+/**
+ * The current resident set size of the process, in bytes, or 0 if it cannot
+ * be determined (it is read from /proc/self/statm, and so only available on
+ * Linux).
+ */
+inline std::size_t current_resident_bytes() {
+#if defined(__linux__)
+    std::FILE * src = std::fopen("/proc/self/statm", "r");
+    if (src == nullptr) {
+        return 0;
+    }
+    unsigned long num_pages = 0;
+    unsigned long num_resident_pages = 0;
+    int num_read = std::fscanf(src, "%lu %lu", &num_pages, &num_resident_pages);
+    std::fclose(src);
+    if (num_read != 2) {
+        return 0;
+    }
+    return static_cast<std::size_t>(num_resident_pages) * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+} // namespace memory
+
+////////////////////////////////////////////////////////////////////////////////
+// MemoryProfile
+
+/**
+ * Records the memory used by the process at the end of each phase of a job
+ * (e.g., reading, simulating, summarizing), to be logged with the job's
+ * other statistics:
+ *
+ *      platypus::MemoryProfile profile;
+ *      reader.read_file(path, get_tree);
+ *      profile.checkpoint("read", trees_memory.total_bytes());
+ *      ...
+ *      profile.export_table(table);
+ *      table.write(log);
+ *
+ * Unlike the counters in platypus::InstrumentationStats, checkpoints are
+ * always recorded, as they are made explicitly and are cheap.
+ */
+class MemoryProfile {
+
+    public:
+        struct Checkpoint {
+            std::string     phase;
+            // wall-clock time since the profile was started
+            double          elapsed_seconds;
+            std::size_t     current_resident_bytes;
+            std::size_t     peak_resident_bytes;
+            // as given by the caller (e.g., MemoryUsage::total_bytes() of
+            // the main data structures)
+            std::size_t     accounted_bytes;
+        };
+
+    public:
+        MemoryProfile()
+            : start_(std::chrono::steady_clock::now()) {
+        }
+
+        void checkpoint(const std::string & phase, std::size_t accounted_bytes=0) {
+            Checkpoint cp;
+            cp.phase = phase;
+            cp.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start_).count();
+            cp.current_resident_bytes = memory::current_resident_bytes();
+            cp.peak_resident_bytes = memory::peak_resident_bytes();
+            cp.accounted_bytes = accounted_bytes;
+            this->checkpoints_.push_back(cp);
+        }
+
+        const std::vector<Checkpoint> & checkpoints() const {
+            return this->checkpoints_;
+        }
+
+        void clear() {
+            this->checkpoints_.clear();
+            this->start_ = std::chrono::steady_clock::now();
+        }
+
+        /**
+         * Appends a row for each checkpoint to ``table`` (a
+         * platypus::DataTable), first adding the columns if the table has
+         * none.
+         */
+        template <class DataTableT>
+        void export_table(DataTableT & table) const {
+            if (table.num_columns() == 0) {
+                table.template add_key_column<std::string>("phase");
+                table.template add_data_column<double>("elapsed_seconds");
+                table.template add_data_column<unsigned long>("current_resident_bytes");
+                table.template add_data_column<unsigned long>("peak_resident_bytes");
+                table.template add_data_column<unsigned long>("accounted_bytes");
+            }
+            for (auto & cp : this->checkpoints_) {
+                auto & row = table.add_row();
+                row << cp.phase
+                    << cp.elapsed_seconds
+                    << static_cast<unsigned long>(cp.current_resident_bytes)
+                    << static_cast<unsigned long>(cp.peak_resident_bytes)
+                    << static_cast<unsigned long>(cp.accounted_bytes);
+            }
+        }
+
+    private:
+        std::chrono::steady_clock::time_point   start_;
+        std::vector<Checkpoint>                 checkpoints_;
+
+}; // MemoryProfile
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,212 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Locale-independent parsing of numbers from character buffers.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_UTILITY_NUMBERPARSING_HPP
+#define PLATYPUS_UTILITY_NUMBERPARSING_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// parse_decimal
+
+namespace detail {
+
+// Powers of ten that are exactly representable as doubles.
+inline double exact_power_of_ten(unsigned int exponent) {
+    static const double powers[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+    return powers[exponent];
+}
+
+inline bool is_digit(char ch) {
+    return ch >= '0' && ch <= '9';
+}
+
+} // namespace detail
+
+/**
+ * Parses the characters in [``begin``, ``end``) as a decimal floating-point
+ * number, in the form accepted by std::strtod() in the "C" locale but
+ * without leading whitespace, hexadecimal or "inf"/"nan": an optional sign,
+ * digits with an optional decimal point, and an optional exponent (e.g.
+ * "-1.5", ".25", "3e-7", "1.2E+10"). Unlike std::atof(), the source need not
+ * be null-terminated, the result does not depend on the current locale, and
+ * malformed input is reported rather than yielding 0.
+ *
+ * In the common case of at most 19 significant digits and a small exponent,
+ * the (correctly rounded) result is computed directly from the digits;
+ * otherwise, parsing falls back to a "C"-locale stream. As with
+ * std::strtod(), numbers too large in magnitude to be represented are
+ * stored as ``HUGE_VAL`` (or ``-HUGE_VAL``).
+ *
+ * @return
+ *   ``true`` if all of the characters make up a number, which is stored in
+ *   ``value``; ``false`` otherwise, in which case ``value`` is unchanged.
+ */
+inline bool parse_decimal(const char * begin, const char * end, double & value) {
+    const char * pos = begin;
+    bool is_negative = false;
+    if (pos < end && (*pos == '-' || *pos == '+')) {
+        is_negative = (*pos == '-');
+        ++pos;
+    }
+    std::uint64_t mantissa = 0;
+    unsigned int num_digits = 0;        // significant digits in ``mantissa``
+    int exponent = 0;
+    bool has_digits = false;
+    bool is_exact = true;
+    for (; pos < end && detail::is_digit(*pos); ++pos) {
+        has_digits = true;
+        if (num_digits < 19) {
+            mantissa = mantissa * 10 + static_cast<unsigned int>(*pos - '0');
+            if (mantissa > 0) {
+                ++num_digits;
+            }
+        } else {
+            ++exponent;
+            is_exact = false;
+        }
+    }
+    if (pos < end && *pos == '.') {
+        ++pos;
+        for (; pos < end && detail::is_digit(*pos); ++pos) {
+            has_digits = true;
+            if (num_digits < 19) {
+                mantissa = mantissa * 10 + static_cast<unsigned int>(*pos - '0');
+                if (mantissa > 0) {
+                    ++num_digits;
+                }
+                --exponent;
+            } else {
+                is_exact = false;
+            }
+        }
+    }
+    if (!has_digits) {
+        return false;
+    }
+    if (pos < end && (*pos == 'e' || *pos == 'E')) {
+        ++pos;
+        bool exponent_is_negative = false;
+        if (pos < end && (*pos == '-' || *pos == '+')) {
+            exponent_is_negative = (*pos == '-');
+            ++pos;
+        }
+        if (pos == end || !detail::is_digit(*pos)) {
+            return false;
+        }
+        int explicit_exponent = 0;
+        for (; pos < end && detail::is_digit(*pos); ++pos) {
+            if (explicit_exponent < 100000) {
+                explicit_exponent = explicit_exponent * 10 + (*pos - '0');
+            }
+        }
+        exponent += exponent_is_negative ? -explicit_exponent : explicit_exponent;
+    }
+    if (pos != end) {
+        return false;
+    }
+    // exact when both the mantissa and the power of ten are exactly
+    // representable (so that only one rounding takes place)
+    if (is_exact && mantissa <= (std::uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+        double result = static_cast<double>(mantissa);
+        if (exponent < 0) {
+            result /= detail::exact_power_of_ten(static_cast<unsigned int>(-exponent));
+        } else {
+            result *= detail::exact_power_of_ten(static_cast<unsigned int>(exponent));
+        }
+        value = is_negative ? -result : result;
+        return true;
+    }
+    // the input is known to be well-formed at this point
+    std::istringstream src(std::string(begin, end));
+    src.imbue(std::locale::classic());
+    double result = 0.0;
+    src >> result;
+    if (src.fail() && std::fabs(result) == std::numeric_limits<double>::max()) {
+        // out of range: the stream yields the largest finite value instead
+        result = is_negative ? -HUGE_VAL : HUGE_VAL;
+    }
+    value = result;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// parse_integer
+
+/**
+ * Parses the characters in [``begin``, ``end``) as a decimal integer: an
+ * optional sign (only "+" for unsigned types) followed by one or more
+ * digits, with no surrounding whitespace.
+ *
+ * @return
+ *   ``true`` if all of the characters make up an integer that is
+ *   representable as a ``T``, which is stored in ``value``; ``false``
+ *   otherwise, in which case ``value`` is unchanged.
+ */
+template <class T>
+inline bool parse_integer(const char * begin, const char * end, T & value) {
+    static_assert(std::is_integral<T>::value, "parse_integer() requires an integral type");
+    typedef typename std::make_unsigned<T>::type unsigned_type;
+    const char * pos = begin;
+    bool is_negative = false;
+    if (pos != end && (*pos == '-' || *pos == '+')) {
+        is_negative = *pos == '-';
+        if (is_negative && !std::is_signed<T>::value) {
+            return false;
+        }
+        ++pos;
+    }
+    if (pos == end) {
+        return false;
+    }
+    // the magnitude of the most negative value of a signed type is one more
+    // than that of its maximum value
+    unsigned_type limit = static_cast<unsigned_type>(std::numeric_limits<T>::max()) + (is_negative ? 1 : 0);
+    unsigned_type magnitude = 0;
+    for (; pos != end; ++pos) {
+        if (!detail::is_digit(*pos)) {
+            return false;
+        }
+        unsigned_type digit = static_cast<unsigned_type>(*pos - '0');
+        if (magnitude > (limit - digit) / 10) {
+            return false;
+        }
+        magnitude = magnitude * 10 + digit;
+    }
+    value = is_negative ? static_cast<T>(0 - magnitude) : static_cast<T>(magnitude);
+    return true;
+}
+
+} // namespace platypus
+
+#endif
@@ -0,0 +1,469 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Simple thread-based parallel execution support.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_UTILITY_PARALLEL_HPP
+#define PLATYPUS_UTILITY_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace platypus {
+
+/**
+ * Returns the number of worker threads to use given a requested number:
+ * if ``num_threads`` is 0, this is the number of hardware threads available
+ * (or 1, if this cannot be determined).
+ */
+inline unsigned int resolve_num_threads(unsigned int num_threads) {
+    if (num_threads == 0) {
+        num_threads = std::thread::hardware_concurrency();
+    }
+    return num_threads == 0 ? 1 : num_threads;
+}
+
+/**
+ * Calls ``fn(idx)`` for every ``idx`` in [0, ``num_tasks``), distributing
+ * the calls dynamically across ``num_threads`` threads (see
+ * ``resolve_num_threads()``). The order in which tasks are executed is
+ * unspecified. If any call throws, remaining tasks are abandoned, and the
+ * first exception caught is rethrown in the calling thread once all
+ * threads have finished.
+ *
+ * If only one thread is requested, or if there is only one task, all tasks
+ * are executed in the calling thread.
+ */
+inline void parallel_for(std::size_t num_tasks,
+        unsigned int num_threads,
+        const std::function<void (std::size_t)> & fn) {
+    num_threads = resolve_num_threads(num_threads);
+    if (num_threads > num_tasks) {
+        num_threads = static_cast<unsigned int>(num_tasks);
+    }
+    if (num_threads <= 1) {
+        for (std::size_t idx = 0; idx < num_tasks; ++idx) {
+            fn(idx);
+        }
+        return;
+    }
+    std::atomic<std::size_t> next_task(0);
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto worker = [&] () {
+        while (!failed.load()) {
+            std::size_t idx = next_task.fetch_add(1);
+            if (idx >= num_tasks) {
+                break;
+            }
+            try {
+                fn(idx);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed.store(true);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (unsigned int i = 1; i < num_threads; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto & t : threads) {
+        t.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BoundedQueue
+
+/**
+ * A first-in, first-out queue of at most ``capacity`` items, for passing
+ * work between the stages of a pipeline. Producers block while the queue is
+ * full, and consumers while it is empty, so that a fast stage cannot run
+ * arbitrarily far ahead of a slow one.
+ *
+ * Once ``close()`` is called, no further items are accepted, and consumers
+ * drain the remaining items; ``cancel()`` additionally discards them, to
+ * tear down a pipeline early.
+ */
+template <class T>
+class BoundedQueue {
+
+    public:
+
+        BoundedQueue(std::size_t capacity)
+            : capacity_(capacity > 0 ? capacity : 1)
+            , is_closed_(false) { }
+
+        BoundedQueue(const BoundedQueue &) = delete;
+        BoundedQueue & operator=(const BoundedQueue &) = delete;
+
+        /**
+         * Appends ``item``, waiting for space if the queue is full.
+         *
+         * @return
+         *   ``false`` if the queue was closed (in which case ``item`` is
+         *   left untouched), ``true`` otherwise.
+         */
+        bool push(T && item) {
+            std::unique_lock<std::mutex> lock(this->mutex_);
+            this->not_full_.wait(lock, [this] () {
+                return this->is_closed_ || this->items_.size() < this->capacity_;
+            });
+            if (this->is_closed_) {
+                return false;
+            }
+            this->items_.push_back(std::move(item));
+            lock.unlock();
+            this->not_empty_.notify_one();
+            return true;
+        }
+
+        /**
+         * Moves the item at the front of the queue into ``item``, waiting
+         * for one if the queue is empty.
+         *
+         * @return
+         *   ``false`` if the queue is closed and empty, ``true`` otherwise.
+         */
+        bool pop(T & item) {
+            std::unique_lock<std::mutex> lock(this->mutex_);
+            this->not_empty_.wait(lock, [this] () {
+                return this->is_closed_ || !this->items_.empty();
+            });
+            if (this->items_.empty()) {
+                return false;
+            }
+            item = std::move(this->items_.front());
+            this->items_.pop_front();
+            lock.unlock();
+            this->not_full_.notify_one();
+            return true;
+        }
+
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(this->mutex_);
+                this->is_closed_ = true;
+            }
+            this->not_full_.notify_all();
+            this->not_empty_.notify_all();
+        }
+
+        void cancel() {
+            {
+                std::lock_guard<std::mutex> lock(this->mutex_);
+                this->is_closed_ = true;
+                this->items_.clear();
+            }
+            this->not_full_.notify_all();
+            this->not_empty_.notify_all();
+        }
+
+    private:
+        std::size_t                 capacity_;
+        bool                        is_closed_;
+        std::deque<T>               items_;
+        std::mutex                  mutex_;
+        std::condition_variable     not_full_;
+        std::condition_variable     not_empty_;
+
+}; // BoundedQueue
+
+////////////////////////////////////////////////////////////////////////////////
+// Tree Collection Algorithms
+
+namespace parallel {
+
+/**
+ * A flag shared by the caller and the tasks of a parallel algorithm (e.g.,
+ * for_each_tree()): once cancel() is called, from any thread, no further
+ * items are started, although those already started run to completion.
+ */
+class CancellationToken {
+
+    public:
+        CancellationToken()
+            : is_cancelled_(false) { }
+        CancellationToken(const CancellationToken &) = delete;
+        CancellationToken & operator=(const CancellationToken &) = delete;
+
+        inline void cancel() {
+            this->is_cancelled_.store(true, std::memory_order_relaxed);
+        }
+        inline bool is_cancelled() const {
+            return this->is_cancelled_.load(std::memory_order_relaxed);
+        }
+        inline void reset() {
+            this->is_cancelled_.store(false, std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<bool>   is_cancelled_;
+
+}; // CancellationToken
+
+namespace detail {
+
+// Access to the tree of an element of a collection of trees, or of
+// (smart) pointers to trees.
+template <class ElementT>
+struct TreeElementTraits {
+    typedef ElementT tree_type;
+    static inline tree_type & get(ElementT & element) {
+        return element;
+    }
+};
+
+template <class T, class D>
+struct TreeElementTraits<std::unique_ptr<T, D>> {
+    typedef T tree_type;
+    static inline tree_type & get(const std::unique_ptr<T, D> & element) {
+        return *element;
+    }
+};
+
+template <class T, class D>
+struct TreeElementTraits<const std::unique_ptr<T, D>> : public TreeElementTraits<std::unique_ptr<T, D>> { };
+
+template <class T>
+struct TreeElementTraits<std::shared_ptr<T>> {
+    typedef T tree_type;
+    static inline tree_type & get(const std::shared_ptr<T> & element) {
+        return *element;
+    }
+};
+
+template <class T>
+struct TreeElementTraits<const std::shared_ptr<T>> : public TreeElementTraits<std::shared_ptr<T>> { };
+
+template <class T>
+struct TreeElementTraits<T *> {
+    typedef T tree_type;
+    static inline tree_type & get(T * element) {
+        return *element;
+    }
+};
+
+template <class T>
+struct TreeElementTraits<T * const> : public TreeElementTraits<T *> { };
+
+template <class ContainerT>
+struct TreeCollectionTraits {
+    typedef typename std::remove_reference<decltype(*std::begin(std::declval<ContainerT &>()))>::type element_type;
+    typedef TreeElementTraits<element_type> element_traits;
+    typedef typename element_traits::tree_type tree_type;
+    typedef std::function<std::size_t (const tree_type &)> cost_fn_type;
+};
+
+/**
+ * Maximum number of chunks a collection is divided into. This does not
+ * depend on the number of threads, so that the chunks, and the order in
+ * which transform_reduce_trees() combines values, do not either.
+ */
+inline constexpr std::size_t max_tree_chunks() {
+    return 1024;
+}
+
+/**
+ * Returns the boundaries of the chunks into which items [0, ``num_items``)
+ * are divided, each of about the same total cost, given the cost of each
+ * item in ``costs`` (or of about the same number of items, if ``costs`` is
+ * empty).
+ */
+inline std::vector<std::size_t> partition_by_cost(std::size_t num_items, const std::vector<std::size_t> & costs) {
+    std::size_t num_chunks = std::min(num_items, max_tree_chunks());
+    std::vector<std::size_t> boundaries(1, 0);
+    if (num_chunks == 0) {
+        return boundaries;
+    }
+    double total_cost = 0.0;
+    for (auto cost : costs) {
+        total_cost += static_cast<double>(cost);
+    }
+    if (total_cost == 0.0) {
+        for (std::size_t chunk_idx = 1; chunk_idx <= num_chunks; ++chunk_idx) {
+            boundaries.push_back(chunk_idx * num_items / num_chunks);
+        }
+        return boundaries;
+    }
+    double cost_so_far = 0.0;
+    for (std::size_t idx = 0; idx < num_items; ++idx) {
+        cost_so_far += static_cast<double>(costs[idx]);
+        // cut once this chunk's share of the total is reached
+        if (cost_so_far * num_chunks >= total_cost * boundaries.size() && idx + 1 < num_items) {
+            boundaries.push_back(idx + 1);
+        }
+    }
+    boundaries.push_back(num_items);
+    return boundaries;
+}
+
+// Calls ``fn(chunk_idx, item_idx)`` for every item (until cancelled).
+template <class FnT>
+void run_chunks(const std::vector<std::size_t> & boundaries,
+        unsigned int num_threads,
+        const CancellationToken * cancellation_token,
+        FnT & fn) {
+    parallel_for(boundaries.size() - 1, num_threads, [&] (std::size_t chunk_idx) {
+        for (std::size_t idx = boundaries[chunk_idx]; idx < boundaries[chunk_idx + 1]; ++idx) {
+            if (cancellation_token != nullptr && cancellation_token->is_cancelled()) {
+                return;
+            }
+            fn(chunk_idx, idx);
+        }
+    });
+}
+
+template <class ContainerT>
+std::vector<std::size_t> partition_trees(ContainerT & trees,
+        unsigned int num_threads,
+        const typename TreeCollectionTraits<ContainerT>::cost_fn_type & cost_fn) {
+    typedef typename TreeCollectionTraits<ContainerT>::element_traits element_traits;
+    std::size_t num_items = static_cast<std::size_t>(std::distance(std::begin(trees), std::end(trees)));
+    std::vector<std::size_t> costs;
+    if (cost_fn) {
+        costs.resize(num_items);
+        auto begin = std::begin(trees);
+        auto cost_of = [&] (std::size_t, std::size_t idx) {
+            costs[idx] = cost_fn(element_traits::get(begin[idx]));
+        };
+        run_chunks(partition_by_cost(num_items, std::vector<std::size_t>()), num_threads, nullptr, cost_of);
+    }
+    return partition_by_cost(num_items, costs);
+}
+
+} // namespace detail
+
+/**
+ * Calls ``fn(tree, idx)`` for each tree of ``trees``, concurrently across
+ * ``num_threads`` threads (see resolve_num_threads()), where ``trees`` is
+ * a random-access collection of trees or of (smart) pointers to trees,
+ * e.g. as returned by BaseTreeReader::get_tree_vector(),
+ * BaseTreeReader::get_tree_ptr_vector() or BaseTreeReader::get_tree_pool(),
+ * ``tree`` is a reference to a
+ * tree (const if ``trees`` is) and ``idx`` is its position in ``trees``:
+ *
+ *      platypus::parallel::for_each_tree(trees, [&](const TreeType & tree, std::size_t idx) {
+ *          statistics[idx] = compute_statistic(tree);
+ *      });
+ *
+ * The collection is divided into chunks of consecutive trees, which idle
+ * threads take up one at a time, so that threads that happen to get
+ * faster chunks go on to take more of them. If ``cost_fn`` is given, it
+ * is called (concurrently) once for each tree to estimate the work it
+ * takes (e.g., its number of leaves), and the chunks are made of about
+ * equal cost, rather than of equal numbers of trees.
+ *
+ * See platypus::Tree for the conditions under which trees may be
+ * traversed concurrently.
+ *
+ * @return
+ *   ``false`` if ``cancellation_token`` was cancelled before all trees were
+ *   visited, ``true`` otherwise. If ``fn`` throws, remaining trees are
+ *   abandoned, and the exception is rethrown.
+ */
+template <class ContainerT, class FnT>
+bool for_each_tree(ContainerT & trees,
+        FnT fn,
+        unsigned int num_threads=0,
+        const typename detail::TreeCollectionTraits<ContainerT>::cost_fn_type & cost_fn=nullptr,
+        const CancellationToken * cancellation_token=nullptr) {
+    typedef typename detail::TreeCollectionTraits<ContainerT>::element_traits element_traits;
+    auto begin = std::begin(trees);
+    auto visit = [&] (std::size_t, std::size_t idx) {
+        fn(element_traits::get(begin[idx]), idx);
+    };
+    detail::run_chunks(detail::partition_trees(trees, num_threads, cost_fn), num_threads, cancellation_token, visit);
+    return cancellation_token == nullptr || !cancellation_token->is_cancelled();
+}
+
+/**
+ * Returns ``init`` combined, using ``reduce_op``, with
+ * ``transform_fn(tree)`` for each tree of ``trees``, where these are
+ * computed concurrently as for for_each_tree():
+ *
+ *      double total_length = platypus::parallel::transform_reduce_trees(trees, 0.0,
+ *              std::plus<double>(),
+ *              [](const TreeType & tree) { return tree_length(tree); });
+ *
+ * Values are combined in the order of their trees within each chunk, and
+ * chunks in order, so ``reduce_op`` need only be associative and, since
+ * the chunks do not depend on the number of threads, the result is the
+ * same (even with floating-point rounding) whatever the number of
+ * threads.
+ *
+ * If ``cancellation_token`` is cancelled, the result combines the values
+ * of the trees visited until then.
+ */
+template <class ContainerT, class T, class ReduceOpT, class TransformFnT>
+T transform_reduce_trees(ContainerT & trees,
+        T init,
+        ReduceOpT reduce_op,
+        TransformFnT transform_fn,
+        unsigned int num_threads=0,
+        const typename detail::TreeCollectionTraits<ContainerT>::cost_fn_type & cost_fn=nullptr,
+        const CancellationToken * cancellation_token=nullptr) {
+    typedef typename detail::TreeCollectionTraits<ContainerT>::element_traits element_traits;
+    std::vector<std::size_t> boundaries = detail::partition_trees(trees, num_threads, cost_fn);
+    std::size_t num_chunks = boundaries.size() - 1;
+    std::vector<T> partials(num_chunks, init);
+    std::vector<char> has_partial(num_chunks, 0);
+    auto begin = std::begin(trees);
+    auto visit = [&] (std::size_t chunk_idx, std::size_t idx) {
+        if (has_partial[chunk_idx]) {
+            partials[chunk_idx] = reduce_op(std::move(partials[chunk_idx]), transform_fn(element_traits::get(begin[idx])));
+        } else {
+            partials[chunk_idx] = transform_fn(element_traits::get(begin[idx]));
+            has_partial[chunk_idx] = 1;
+        }
+    };
+    detail::run_chunks(boundaries, num_threads, cancellation_token, visit);
+    for (std::size_t chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx) {
+        if (has_partial[chunk_idx]) {
+            init = reduce_op(std::move(init), std::move(partials[chunk_idx]));
+        }
+    }
+    return init;
+}
+
+} // namespace parallel
+
+} // namespace platypus
+
+#endif
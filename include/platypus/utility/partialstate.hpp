@@ -0,0 +1,356 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Serializable partial states of sharded computations.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLATYPUS_UTILITY_PARTIALSTATE_HPP
+#define PLATYPUS_UTILITY_PARTIALSTATE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../base/exception.hpp"
+#include "binaryformat.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// PartialStateError
+
+class PartialStateError : public PlatypusException {
+    public:
+        PartialStateError(
+                    const std::string & filename,
+                    unsigned long line_num,
+                    const std::string & message)
+            : PlatypusException(filename, line_num, message) { }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// shard_range
+
+/**
+ * Returns the range [``first``, ``second``) of items of shard ``shard_idx``
+ * when ``num_items`` items are divided into ``num_shards`` contiguous
+ * shards whose sizes differ by at most one; the shards, in order, cover all
+ * the items. With a TreeOffsetIndex, each worker can read just its own
+ * trees (and, if needed, find its byte range of the source):
+ *
+ *      auto shard = platypus::shard_range(index.num_trees(), rank, num_ranks);
+ *      reader.read_range(src, index, shard.first, shard.second, tree_factory);
+ *      // bytes [index.get_tree_offset(shard.first), index.get_range_end_offset(shard.second))
+ */
+inline std::pair<unsigned long, unsigned long> shard_range(unsigned long num_items,
+        unsigned long shard_idx,
+        unsigned long num_shards) {
+    if (num_shards == 0 || shard_idx >= num_shards) {
+        throw PartialStateError(__FILE__, __LINE__, "Invalid shard index "
+                + std::to_string(shard_idx) + " of " + std::to_string(num_shards) + " shards");
+    }
+    unsigned long base_size = num_items / num_shards;
+    unsigned long num_larger = num_items % num_shards;
+    unsigned long begin = shard_idx * base_size + (shard_idx < num_larger ? shard_idx : num_larger);
+    return std::make_pair(begin, begin + base_size + (shard_idx < num_larger ? 1 : 0));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PartialStateWriter
+
+/**
+ * Encodes the state of an accumulator (e.g., a SplitDistribution,
+ * TopologyCounts, or platypus::numeric::RunningStatistics) computed over a
+ * shard of the data, so that it can be sent to (over MPI, through files,
+ * etc.) and merged by another process.
+ *
+ * A mergeable class ``T`` provides:
+ *
+ *      static std::string partial_state_kind();
+ *      template <class WriterT> void write_state(WriterT & writer) const;
+ *      template <class ReaderT> void merge_state(ReaderT & reader);
+ *
+ * where merge_state() has the same effect as merge() on the original
+ * object, so that merging the partial states of all the shards, in order,
+ * gives the same result as accumulating all the data in one pass (with
+ * the same merges of thread blocks). State is written in a compact,
+ * little-endian binary format: a header ("PLTP", a format version and the
+ * kind, to guard against merging the state of a different accumulator),
+ * followed by the values written by write_state(). Floating point values
+ * of any precision are written exactly (see write_real()).
+ */
+class PartialStateWriter {
+
+    public:
+        PartialStateWriter(const std::string & kind) {
+            this->buffer_.append(magic(), 4);
+            binary_format::append_u32(this->buffer_, version());
+            this->write_string(kind);
+        }
+
+        static constexpr const char * magic() {
+            return "PLTP";
+        }
+
+        static constexpr std::uint32_t version() {
+            return 1;
+        }
+
+        void write_bool(bool value) {
+            this->buffer_.push_back(value ? 1 : 0);
+        }
+
+        void write_u64(std::uint64_t value) {
+            binary_format::append_u64(this->buffer_, value);
+        }
+
+        void write_f64(double value) {
+            binary_format::append_f64(this->buffer_, value);
+        }
+
+        /**
+         * Writes ``value`` as the sum of two doubles, the second of which
+         * is zero unless ``T`` is wider than double, so that a long double
+         * (with a mantissa of up to 106 bits, within the exponent range of
+         * double) is restored exactly.
+         */
+        template <class T>
+        void write_real(T value) {
+            double hi = static_cast<double>(value);
+            this->write_f64(hi);
+            this->write_f64(static_cast<double>(value - static_cast<T>(hi)));
+        }
+
+        void write_string(const std::string & value) {
+            this->write_u64(value.size());
+            this->buffer_.append(value);
+        }
+
+        // The encoded state.
+        inline const std::string & bytes() const {
+            return this->buffer_;
+        }
+
+        void write(std::ostream & out) const {
+            out.write(this->buffer_.data(), static_cast<std::streamsize>(this->buffer_.size()));
+        }
+
+        void save(const std::string & path) const {
+            std::ofstream out(path, std::ios::out | std::ios::binary);
+            if (!out) {
+                throw PartialStateError(__FILE__, __LINE__, "Unable to open file: '" + path + "'");
+            }
+            this->write(out);
+            out.close();
+            if (!out) {
+                throw PartialStateError(__FILE__, __LINE__, "Error writing file: '" + path + "'");
+            }
+        }
+
+    private:
+        std::string     buffer_;
+
+}; // PartialStateWriter
+
+////////////////////////////////////////////////////////////////////////////////
+// PartialStateReader
+
+/**
+ * Decodes a state written by PartialStateWriter, checking the header
+ * against the kind of state expected, and that no value is read beyond the
+ * end of the data. The data (if not loaded from a file) must outlive the
+ * reader.
+ */
+class PartialStateReader {
+
+    public:
+        PartialStateReader(const char * data, std::size_t size, const std::string & kind)
+            : data_(data)
+            , size_(size)
+            , pos_(0) {
+            this->read_header(kind);
+        }
+
+        PartialStateReader(const std::string & bytes, const std::string & kind)
+            : PartialStateReader(bytes.data(), bytes.size(), kind) { }
+
+        PartialStateReader(const PartialStateReader &) = delete;
+        PartialStateReader & operator=(const PartialStateReader &) = delete;
+
+        // Reads the state saved in the file at ``path``.
+        static std::string load_bytes(const std::string & path) {
+            std::ifstream src(path, std::ios::in | std::ios::binary);
+            if (!src) {
+                throw PartialStateError(__FILE__, __LINE__, "Unable to open file: '" + path + "'");
+            }
+            std::string bytes((std::istreambuf_iterator<char>(src)), std::istreambuf_iterator<char>());
+            if (src.bad()) {
+                throw PartialStateError(__FILE__, __LINE__, "Error reading file: '" + path + "'");
+            }
+            return bytes;
+        }
+
+        bool read_bool() {
+            return *this->advance(1) != 0;
+        }
+
+        std::uint64_t read_u64() {
+            return binary_format::decode_u64(this->advance(8));
+        }
+
+        double read_f64() {
+            return binary_format::decode_f64(this->advance(8));
+        }
+
+        template <class T>
+        T read_real() {
+            double hi = this->read_f64();
+            double lo = this->read_f64();
+            return static_cast<T>(hi) + static_cast<T>(lo);
+        }
+
+        std::string read_string() {
+            std::uint64_t size = this->read_u64();
+            if (size > this->size_ - this->pos_) {
+                this->fail("truncated data");
+            }
+            return std::string(this->advance(static_cast<std::size_t>(size)), static_cast<std::size_t>(size));
+        }
+
+        // Reads a count of items, each of at least ``min_item_size`` bytes,
+        // failing if the data cannot hold them (e.g., if it is corrupt).
+        std::size_t read_count(std::size_t min_item_size) {
+            std::uint64_t count = this->read_u64();
+            if (min_item_size > 0 && count > (this->size_ - this->pos_) / min_item_size) {
+                this->fail("truncated data");
+            }
+            return static_cast<std::size_t>(count);
+        }
+
+        inline bool at_end() const {
+            return this->pos_ == this->size_;
+        }
+
+        // Fails unless all the data has been read.
+        void finish() const {
+            if (!this->at_end()) {
+                this->fail("unexpected data after end of state");
+            }
+        }
+
+        // Reports a state that cannot be decoded or merged.
+        [[noreturn]] void fail(const std::string & message) const {
+            throw PartialStateError(__FILE__, __LINE__, "Invalid partial state: " + message);
+        }
+
+    private:
+        const char * advance(std::size_t num_bytes) {
+            if (num_bytes > this->size_ - this->pos_) {
+                this->fail("truncated data");
+            }
+            const char * p = this->data_ + this->pos_;
+            this->pos_ += num_bytes;
+            return p;
+        }
+
+        void read_header(const std::string & kind) {
+            if (this->size_ < 4 || std::memcmp(this->data_, PartialStateWriter::magic(), 4) != 0) {
+                this->fail("bad magic");
+            }
+            this->pos_ = 4;
+            std::uint32_t version = binary_format::decode_u32(this->advance(4));
+            if (version != PartialStateWriter::version()) {
+                this->fail("unsupported version " + std::to_string(version));
+            }
+            std::string found_kind = this->read_string();
+            if (found_kind != kind) {
+                this->fail("expecting state of '" + kind + "' but found '" + found_kind + "'");
+            }
+        }
+
+    private:
+        const char *    data_;
+        std::size_t     size_;
+        std::size_t     pos_;
+
+}; // PartialStateReader
+
+////////////////////////////////////////////////////////////////////////////////
+// Partial state functions
+
+/**
+ * Returns the encoded partial state of ``state``, e.g. to send to another
+ * process.
+ */
+template <class StateT>
+std::string encode_partial_state(const StateT & state) {
+    PartialStateWriter writer(StateT::partial_state_kind());
+    state.write_state(writer);
+    return writer.bytes();
+}
+
+template <class StateT>
+void save_partial_state(const StateT & state, const std::string & path) {
+    PartialStateWriter writer(StateT::partial_state_kind());
+    state.write_state(writer);
+    writer.save(path);
+}
+
+// Merges the partial state encoded in [``data``, ``data + size``) into ``state``.
+template <class StateT>
+void merge_partial_state(StateT & state, const char * data, std::size_t size) {
+    PartialStateReader reader(data, size, StateT::partial_state_kind());
+    state.merge_state(reader);
+    reader.finish();
+}
+
+template <class StateT>
+void merge_partial_state(StateT & state, const std::string & bytes) {
+    merge_partial_state(state, bytes.data(), bytes.size());
+}
+
+/**
+ * Merges the partial states saved by save_partial_state() in the files at
+ * ``paths`` into ``state``, in order:
+ *
+ *      // worker k of n
+ *      platypus::SplitDistribution<> splits(taxa, false);
+ *      auto shard = platypus::shard_range(index.num_trees(), k, n);
+ *      reader.read_range(src, index, shard.first, shard.second, ...);
+ *      ... splits.add_trees(...) ...
+ *      platypus::save_partial_state(splits, "splits." + std::to_string(k));
+ *
+ *      // merge step
+ *      platypus::SplitDistribution<> splits(taxa, false);
+ *      platypus::merge_partial_state_files(splits, paths);
+ */
+template <class StateT>
+void merge_partial_state_files(StateT & state, const std::vector<std::string> & paths) {
+    for (auto & path : paths) {
+        std::string bytes = PartialStateReader::load_bytes(path);
+        merge_partial_state(state, bytes);
+    }
+}
+
+} // namespace platypus
+
+#endif
@@ -22,9 +22,16 @@
 #ifndef PLATYPUS_UTILITY_STREAM_HPP
 #define PLATYPUS_UTILITY_STREAM_HPP
 
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <iostream>
 #include <iomanip>
+#include <string>
+#include <thread>
 #include <vector>
 
 namespace platypus { namespace stream {
@@ -70,6 +77,256 @@ inline std::ostream& operator<<(std::ostream& out, const ostream_manipulator& ma
 typedef ostream_manipulator                     OutputStreamFormatter;
 typedef std::vector<OutputStreamFormatter>      OutputStreamFormatters;
 
+//////////////////////////////////////////////////////////////////////////////
+// BlockOutputBuffer
+
+/**
+ * Collects output text in memory and passes it on to an output stream in
+ * blocks of (at least) a given size, rather than piecemeal, optionally
+ * handing the writing of each block off to a background thread so that
+ * producing output and writing it overlap.
+ *
+ * Text is appended directly to buffer(); commit() then hands the buffer
+ * over for writing once it has reached the block size.
+ *
+ *      platypus::stream::BlockOutputBuffer sink(out, 65536, true);
+ *      for (...) {
+ *          sink.buffer() += line;
+ *          sink.commit();
+ *      }
+ *      sink.close();
+ *
+ * At most ``max_pending_blocks`` blocks are queued for the background
+ * thread at any time; beyond that, commit() waits for the writer to catch
+ * up. Written blocks are recycled, so that steady-state output does not
+ * allocate.
+ */
+class BlockOutputBuffer {
+
+    public:
+        BlockOutputBuffer(std::ostream & out,
+                std::size_t block_size=65536,
+                bool write_in_background=false,
+                std::size_t max_pending_blocks=4)
+            : out_(out)
+            , block_size_(block_size)
+            , max_pending_blocks_(max_pending_blocks > 0 ? max_pending_blocks : 1)
+            , is_closed_(false)
+            , is_done_(false) {
+            this->buffer_.reserve(this->block_size_);
+            if (write_in_background) {
+                this->writer_thread_ = std::thread(&BlockOutputBuffer::run_writer, this);
+            }
+        }
+
+        BlockOutputBuffer(const BlockOutputBuffer &) = delete;
+        BlockOutputBuffer & operator=(const BlockOutputBuffer &) = delete;
+
+        ~BlockOutputBuffer() {
+            this->close();
+        }
+
+        inline std::string & buffer() {
+            return this->buffer_;
+        }
+
+        // Hands the buffer over for writing if it has reached the block size.
+        inline void commit() {
+            if (this->buffer_.size() >= this->block_size_) {
+                this->flush_buffer();
+            }
+        }
+
+        // Hands the buffer over for writing, whatever its size.
+        void flush() {
+            this->flush_buffer();
+        }
+
+        /**
+         * Writes out all remaining text, waits for the background thread (if
+         * any) to finish, and flushes the output stream.
+         */
+        void close() {
+            if (this->is_closed_) {
+                return;
+            }
+            this->flush_buffer();
+            if (this->writer_thread_.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(this->mutex_);
+                    this->is_done_ = true;
+                }
+                this->queue_changed_.notify_all();
+                this->writer_thread_.join();
+            }
+            this->out_.flush();
+            this->is_closed_ = true;
+        }
+
+        inline std::size_t get_block_size() const {
+            return this->block_size_;
+        }
+
+        inline bool is_writing_in_background() const {
+            return this->writer_thread_.joinable();
+        }
+
+    private:
+        void flush_buffer() {
+            if (this->buffer_.empty()) {
+                return;
+            }
+            if (!this->writer_thread_.joinable()) {
+                this->out_.write(this->buffer_.data(), this->buffer_.size());
+                this->buffer_.clear();
+                return;
+            }
+            std::unique_lock<std::mutex> lock(this->mutex_);
+            this->queue_changed_.wait(lock, [this] { return this->pending_blocks_.size() < this->max_pending_blocks_; });
+            this->pending_blocks_.push_back(std::move(this->buffer_));
+            if (!this->spare_blocks_.empty()) {
+                this->buffer_ = std::move(this->spare_blocks_.back());
+                this->spare_blocks_.pop_back();
+            } else {
+                this->buffer_ = std::string();
+                this->buffer_.reserve(this->block_size_);
+            }
+            lock.unlock();
+            this->queue_changed_.notify_all();
+        }
+
+        void run_writer() {
+            std::unique_lock<std::mutex> lock(this->mutex_);
+            while (true) {
+                this->queue_changed_.wait(lock, [this] { return this->is_done_ || !this->pending_blocks_.empty(); });
+                if (this->pending_blocks_.empty()) {
+                    break; // done, and nothing left to write
+                }
+                std::string block = std::move(this->pending_blocks_.front());
+                this->pending_blocks_.pop_front();
+                lock.unlock();
+                this->out_.write(block.data(), block.size());
+                block.clear();
+                lock.lock();
+                this->spare_blocks_.push_back(std::move(block));
+                this->queue_changed_.notify_all();
+            }
+        }
+
+    private:
+        std::ostream &              out_;
+        std::size_t                 block_size_;
+        std::size_t                 max_pending_blocks_;
+        bool                        is_closed_;
+        std::string                 buffer_;
+        std::thread                 writer_thread_;
+        std::mutex                  mutex_;
+        std::condition_variable     queue_changed_;
+        std::deque<std::string>     pending_blocks_;
+        std::vector<std::string>    spare_blocks_;
+        bool                        is_done_;
+
+}; // BlockOutputBuffer
+
+//////////////////////////////////////////////////////////////////////////////
+// LittleEndianWriter
+
+/**
+ * Writes fixed-width binary values to an output stream in little-endian
+ * byte order, whatever the byte order of the host, through an internal
+ * buffer. Keeps track of the number of bytes written, so that data can be
+ * aligned relative to the start of the output.
+ */
+class LittleEndianWriter {
+
+    public:
+        LittleEndianWriter(std::ostream & out, std::size_t buffer_size=65536)
+            : out_(out)
+            , buffer_size_(buffer_size > 16 ? buffer_size : 16)
+            , num_bytes_written_(0) {
+            this->buffer_.reserve(this->buffer_size_);
+        }
+
+        LittleEndianWriter(const LittleEndianWriter &) = delete;
+        LittleEndianWriter & operator=(const LittleEndianWriter &) = delete;
+
+        ~LittleEndianWriter() {
+            this->flush();
+        }
+
+        inline void write_uint8(std::uint8_t v) {
+            this->buffer_.push_back(static_cast<char>(v));
+            this->commit(1);
+        }
+        inline void write_uint16(std::uint16_t v) {
+            this->put_bytes(v, 2);
+        }
+        inline void write_uint32(std::uint32_t v) {
+            this->put_bytes(v, 4);
+        }
+        inline void write_uint64(std::uint64_t v) {
+            this->put_bytes(v, 8);
+        }
+        inline void write_int64(std::int64_t v) {
+            this->put_bytes(static_cast<std::uint64_t>(v), 8);
+        }
+        // IEEE 754 binary64.
+        inline void write_float64(double v) {
+            std::uint64_t bits;
+            std::memcpy(&bits, &v, sizeof(bits));
+            this->put_bytes(bits, 8);
+        }
+        void write_bytes(const char * data, std::size_t size) {
+            if (size >= this->buffer_size_) {
+                this->flush();
+                this->out_.write(data, size);
+                this->num_bytes_written_ += size;
+                return;
+            }
+            this->buffer_.append(data, size);
+            this->commit(size);
+        }
+        inline void write_bytes(const std::string & s) {
+            this->write_bytes(s.data(), s.size());
+        }
+        // Writes zero bytes up to the next multiple of ``alignment``.
+        void pad_to(std::size_t alignment) {
+            while (this->num_bytes_written_ % alignment != 0) {
+                this->write_uint8(0);
+            }
+        }
+        void flush() {
+            if (!this->buffer_.empty()) {
+                this->out_.write(this->buffer_.data(), this->buffer_.size());
+                this->buffer_.clear();
+            }
+        }
+        inline std::uint64_t num_bytes_written() const {
+            return this->num_bytes_written_;
+        }
+
+    private:
+        inline void put_bytes(std::uint64_t v, unsigned int num_bytes) {
+            for (unsigned int i = 0; i < num_bytes; ++i) {
+                this->buffer_.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+            }
+            this->commit(num_bytes);
+        }
+        inline void commit(std::size_t num_bytes) {
+            this->num_bytes_written_ += num_bytes;
+            if (this->buffer_.size() >= this->buffer_size_) {
+                this->flush();
+            }
+        }
+
+    private:
+        std::ostream &      out_;
+        std::size_t         buffer_size_;
+        std::string         buffer_;
+        std::uint64_t       num_bytes_written_;
+
+}; // LittleEndianWriter
+
 } } // namespace platypus::stream
 
 #endif
@@ -29,7 +29,10 @@
 #include <sstream>
 #include <iostream>
 #include <vector>
+#include <memory>
+#include <cstring>
 #include "../base/exception.hpp"
+#include "instrumentation.hpp"
 
 namespace platypus {
 
@@ -63,6 +66,812 @@ class TokenizerUnexpectedEndOfStreamError : public TokenizerException {
             : TokenizerException(filename, line_num, message) { }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// CharacterClassTable
+
+/**
+ * Lookup table mapping each of the 256 possible character values to the
+ * roles (delimiter, quote, comment begin/end) it plays in a tokenizer
+ * configuration, so that a character can be classified with a single array
+ * access, instead of searching each of the configuration strings.
+ */
+class CharacterClassTable {
+
+    public:
+        enum CharacterClass {
+            ORDINARY                = 0,
+            UNCAPTURED_DELIMITER    = 1,
+            CAPTURED_DELIMITER      = 2,
+            QUOTE                   = 4,
+            COMMENT_BEGIN           = 8,
+            COMMENT_END             = 16,
+        };
+
+    public:
+        CharacterClassTable() {
+            std::memset(this->classes_, ORDINARY, sizeof(this->classes_));
+        }
+        CharacterClassTable(
+            const std::string & uncaptured_delimiters,
+            const std::string & captured_delimiters,
+            const std::string & quote_chars,
+            const std::string & comment_begin,
+            const std::string & comment_end) {
+            std::memset(this->classes_, ORDINARY, sizeof(this->classes_));
+            this->add(uncaptured_delimiters, UNCAPTURED_DELIMITER);
+            this->add(captured_delimiters, CAPTURED_DELIMITER);
+            this->add(quote_chars, QUOTE);
+            this->add(comment_begin, COMMENT_BEGIN);
+            this->add(comment_end, COMMENT_END);
+        }
+
+        // ``ch`` is a character value as returned by std::istream::get() (or
+        // EOF, which is classified as ORDINARY).
+        inline unsigned char operator[](int ch) const {
+            return ch < 0 ? static_cast<unsigned char>(ORDINARY) : this->classes_[ch & 0xFF];
+        }
+        inline unsigned char operator[](char ch) const {
+            return this->classes_[static_cast<unsigned char>(ch)];
+        }
+        inline bool is(int ch, CharacterClass char_class) const {
+            return ((*this)[ch] & char_class) != 0;
+        }
+        inline bool is(char ch, CharacterClass char_class) const {
+            return ((*this)[ch] & char_class) != 0;
+        }
+        inline bool is_ordinary(char ch) const {
+            return (*this)[ch] == ORDINARY;
+        }
+
+    private:
+        void add(const std::string & chars, CharacterClass char_class) {
+            for (auto ch : chars) {
+                this->classes_[static_cast<unsigned char>(ch)] |= char_class;
+            }
+        }
+
+    private:
+        unsigned char   classes_[256];
+
+}; // CharacterClassTable
+
+////////////////////////////////////////////////////////////////////////////////
+// StaticCharacterClassTable
+
+/**
+ * The interface of platypus::CharacterClassTable, for a syntax whose classes
+ * of characters are fixed at compile time, given by ``SyntaxT`` (e.g.,
+ * platypus::NewickSyntax) as:
+ *
+ *      static unsigned char classify(unsigned char ch);
+ *
+ * returning the CharacterClassTable::CharacterClass flags of ``ch``. Holds
+ * no data: lookups call ``SyntaxT::classify()`` directly, so that they can
+ * be inlined into the scanning loops of the tokenizer.
+ */
+template <class SyntaxT>
+class StaticCharacterClassTable {
+
+    public:
+        inline unsigned char operator[](int ch) const {
+            return ch < 0 ? static_cast<unsigned char>(CharacterClassTable::ORDINARY) : SyntaxT::classify(static_cast<unsigned char>(ch));
+        }
+        inline unsigned char operator[](char ch) const {
+            return SyntaxT::classify(static_cast<unsigned char>(ch));
+        }
+        inline bool is(int ch, CharacterClassTable::CharacterClass char_class) const {
+            return ((*this)[ch] & char_class) != 0;
+        }
+        inline bool is(char ch, CharacterClassTable::CharacterClass char_class) const {
+            return ((*this)[ch] & char_class) != 0;
+        }
+        inline bool is_ordinary(char ch) const {
+            return (*this)[ch] == CharacterClassTable::ORDINARY;
+        }
+
+}; // StaticCharacterClassTable
+
+////////////////////////////////////////////////////////////////////////////////
+// TokenView
+
+/**
+ * A non-owning reference to a sequence of characters, as returned by
+ * platypus::BufferTokenizer. This is *not* null-terminated: use
+ * ``TokenView::str()`` to get a std::string if needed.
+ */
+class TokenView {
+
+    public:
+        typedef std::size_t         size_type;
+        typedef const char *        const_iterator;
+
+    public:
+        TokenView()
+            : data_(nullptr)
+            , size_(0) { }
+        TokenView(const char * data, size_type size)
+            : data_(data)
+            , size_(size) { }
+        explicit TokenView(const std::string & str)
+            : data_(str.data())
+            , size_(str.size()) { }
+
+        inline const char * data() const {
+            return this->data_;
+        }
+        inline size_type size() const {
+            return this->size_;
+        }
+        inline bool empty() const {
+            return this->size_ == 0;
+        }
+        inline const_iterator begin() const {
+            return this->data_;
+        }
+        inline const_iterator end() const {
+            return this->data_ + this->size_;
+        }
+        inline char operator[](size_type idx) const {
+            return this->data_[idx];
+        }
+        inline void clear() {
+            this->data_ = nullptr;
+            this->size_ = 0;
+        }
+        inline std::string str() const {
+            return std::string(this->data_, this->size_);
+        }
+        inline operator std::string() const {
+            return this->str();
+        }
+
+        inline bool operator==(const TokenView & other) const {
+            return this->size_ == other.size_
+                && (this->size_ == 0 || std::memcmp(this->data_, other.data_, this->size_) == 0);
+        }
+        inline bool operator==(const std::string & other) const {
+            return *this == TokenView(other);
+        }
+        inline bool operator==(const char * other) const {
+            return *this == TokenView(other, std::strlen(other));
+        }
+        template <class T>
+        inline bool operator!=(const T & other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const char *    data_;
+        size_type       size_;
+
+}; // TokenView
+
+inline bool operator==(const std::string & a, const TokenView & b) {
+    return b == a;
+}
+inline bool operator!=(const std::string & a, const TokenView & b) {
+    return !(b == a);
+}
+inline bool operator==(const char * a, const TokenView & b) {
+    return b == a;
+}
+inline bool operator!=(const char * a, const TokenView & b) {
+    return !(b == a);
+}
+inline std::ostream & operator<<(std::ostream & out, const TokenView & token) {
+    out.write(token.data(), token.size());
+    return out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CharacterViewBuffer
+
+/**
+ * A read-only stream buffer over a block of characters that it neither
+ * copies nor owns (and so which must outlive it), used to tokenize strings
+ * in place. Copies read from the same block, from the same position.
+ */
+class CharacterViewBuffer : public std::streambuf {
+
+    public:
+        CharacterViewBuffer() { }
+        CharacterViewBuffer(const char * data, std::size_t size) {
+            char * begin = const_cast<char *>(data);
+            this->setg(begin, begin, begin + size);
+        }
+        CharacterViewBuffer(const CharacterViewBuffer & other)
+            : std::streambuf() {
+            this->setg(other.eback(), other.gptr(), other.egptr());
+        }
+        CharacterViewBuffer & operator=(const CharacterViewBuffer & other) {
+            this->setg(other.eback(), other.gptr(), other.egptr());
+            return *this;
+        }
+
+        // The next character to be read.
+        const char * position() const {
+            return this->gptr();
+        }
+
+}; // CharacterViewBuffer
+
+////////////////////////////////////////////////////////////////////////////////
+// BasicTokenizerIterator
+
+/**
+ * Iterator over the tokens of a stream, or of a string or other block of
+ * characters (either tokenized in place, or a private copy of it),
+ * as returned by platypus::Tokenizer and platypus::BasicTokenizer. The
+ * roles of characters are looked up in ``CharClassesT``: a
+ * platypus::CharacterClassTable built from a runtime configuration, or a
+ * platypus::StaticCharacterClassTable for a syntax fixed at compile time
+ * (which holds no data, so that nothing is copied to construct the
+ * iterator).
+ */
+template <class CharClassesT>
+class BasicTokenizerIterator {
+    public:
+				typedef BasicTokenizerIterator      self_type;
+				typedef std::string                 value_type;
+				typedef value_type *                pointer;
+				typedef value_type &                reference;
+				typedef unsigned long               size_type;
+				typedef int                         difference_type;
+				typedef std::forward_iterator_tag   iterator_category;
+
+			public:
+
+			    BasicTokenizerIterator(std::istream & src,
+                const std::string & uncaptured_delimiters,
+                const std::string & captured_delimiters,
+                const std::string & quote_chars,
+                bool esc_quote_chars_by_doubling,
+                const std::string & esc_chars,
+                const std::string & comment_begin,
+                const std::string & comment_end,
+                bool capture_comments)
+                : src_(src)
+                    , char_classes_(uncaptured_delimiters,
+                            captured_delimiters,
+                            quote_chars,
+                            comment_begin,
+                            comment_end)
+                    , esc_quote_chars_by_doubling_(esc_quote_chars_by_doubling)
+                    , capture_comments_(capture_comments)
+                    , cur_char_(0)
+                    , eof_flag_(false) {
+            this->get_next_token();
+        }
+
+			    BasicTokenizerIterator(std::istream & src,
+                const CharClassesT & char_classes,
+                bool esc_quote_chars_by_doubling,
+                bool capture_comments)
+                : src_(src)
+                    , char_classes_(char_classes)
+                    , esc_quote_chars_by_doubling_(esc_quote_chars_by_doubling)
+                    , capture_comments_(capture_comments)
+                    , cur_char_(0)
+                    , eof_flag_(false) {
+            this->get_next_token();
+        }
+
+			    BasicTokenizerIterator(std::string str,
+                const std::string & uncaptured_delimiters,
+                const std::string & captured_delimiters,
+                const std::string & quote_chars,
+                bool esc_quote_chars_by_doubling,
+                const std::string & esc_chars,
+                const std::string & comment_begin,
+                const std::string & comment_end,
+                bool capture_comments)
+                : src_string_copy_(std::make_shared<std::string>(std::move(str)))
+                    , src_(src_string_copy_->data(), src_string_copy_->size())
+                    , char_classes_(uncaptured_delimiters,
+                            captured_delimiters,
+                            quote_chars,
+                            comment_begin,
+                            comment_end)
+                    , esc_quote_chars_by_doubling_(esc_quote_chars_by_doubling)
+                    , capture_comments_(capture_comments)
+                    , cur_char_(0)
+                    , eof_flag_(false) {
+            this->get_next_token();
+        }
+
+			    BasicTokenizerIterator(std::string str,
+                const CharClassesT & char_classes,
+                bool esc_quote_chars_by_doubling,
+                bool capture_comments)
+                : src_string_copy_(std::make_shared<std::string>(std::move(str)))
+                    , src_(src_string_copy_->data(), src_string_copy_->size())
+                    , char_classes_(char_classes)
+                    , esc_quote_chars_by_doubling_(esc_quote_chars_by_doubling)
+                    , capture_comments_(capture_comments)
+                    , cur_char_(0)
+                    , eof_flag_(false) {
+            this->get_next_token();
+        }
+
+        // Tokenizes the ``size`` characters starting at ``data`` in place:
+        // the characters are neither copied nor owned, and so must outlive
+        // the iterator (and any copies of it).
+			    BasicTokenizerIterator(const char * data,
+                std::size_t size,
+                const CharClassesT & char_classes,
+                bool esc_quote_chars_by_doubling,
+                bool capture_comments)
+                : src_(data, size)
+                    , char_classes_(char_classes)
+                    , esc_quote_chars_by_doubling_(esc_quote_chars_by_doubling)
+                    , capture_comments_(capture_comments)
+                    , cur_char_(0)
+                    , eof_flag_(false) {
+            this->get_next_token();
+        }
+
+        BasicTokenizerIterator()
+            : esc_quote_chars_by_doubling_(true)
+                , eof_flag_(true) {
+        }
+
+        inline reference operator*() {
+            return this->token_;
+        }
+
+        inline pointer operator->() {
+            return &(this->token_);
+        }
+
+        inline bool operator==(const self_type& rhs) const {
+            if (this->eof_flag_ == false && rhs.eof_flag_ == false) {
+                return true;
+            } else if (this->src_.buf == rhs.src_.buf) {
+                return true;
+            } else {
+                return false;
+            }
+        }
+
+        inline bool operator!=(const self_type& rhs) const {
+            return !(*this == rhs);
+        }
+
+        inline const self_type & operator++() {
+            if (!this->src_.buf || !this->src_.good) {
+                this->set_eof();
+            } else if (this->src_.buf != nullptr) {
+                this->get_next_token();
+            }
+            return *this;
+        }
+
+        inline const self_type & require_next() {
+            if (!this->src_.buf || !this->src_.good) {
+                throw TokenizerUnexpectedEndOfStreamError(__FILE__, __LINE__, "Unexpected end of stream");
+            }
+            this->get_next_token();
+            return *this;
+        }
+
+        inline self_type operator++(int) {
+            self_type i = *this;
+            ++(*this);
+            return i;
+        }
+
+        /**
+         * Advances to the token following the next occurrence of
+         * ``terminator`` (which should be a captured delimiter) that
+         * is not inside a quoted token or a comment, scanning from
+         * the end of the current token without building any tokens
+         * along the way. Comments in the skipped text are not
+         * captured, and any captured so far are discarded. The
+         * current token should not itself be ``terminator``.
+         */
+        inline const self_type & skip_past(char terminator=';') {
+            if (this->eof_flag_ || this->src_.buf == nullptr) {
+                return *this;
+            }
+            this->clear_captured_comments();
+            std::streambuf * sb = this->src_.buf;
+            const int eof = std::char_traits<char>::eof();
+            // the current character has not yet been consumed
+            int ch = this->src_.good ? this->cur_char_ : eof;
+            while (ch != eof && ch != terminator) {
+                unsigned char char_class = this->char_classes_[ch];
+                if (char_class & CharacterClassTable::QUOTE) {
+                    // doubled (escaped) quotes simply close and
+                    // re-open the quote
+                    int quote_char = ch;
+                    do {
+                        ch = sb->sbumpc();
+                    } while (ch != eof && ch != quote_char);
+                } else if (char_class & CharacterClassTable::COMMENT_BEGIN) {
+                    unsigned int nesting = 1;
+                    while (nesting > 0) {
+                        ch = sb->sbumpc();
+                        if (ch == eof) {
+                            break;
+                        } else if (this->char_classes_.is(ch, CharacterClassTable::COMMENT_END)) {
+                            --nesting;
+                        } else if (this->char_classes_.is(ch, CharacterClassTable::COMMENT_BEGIN)) {
+                            ++nesting;
+                        }
+                    }
+                }
+                if (ch != eof) {
+                    ch = sb->sbumpc();
+                }
+            }
+            if (ch != eof) {
+                ch = sb->sbumpc();
+            }
+            if (ch == eof) {
+                this->src_.set_end();
+                this->set_eof();
+                return *this;
+            }
+            this->cur_char_ = ch;
+            this->get_next_token();
+            return *this;
+        }
+
+        inline bool eof() {
+            return this->eof_flag_;
+        }
+
+        inline void set_eof() {
+            this->src_.buf = nullptr;
+            this->token_.clear();
+            this->eof_flag_ = true;
+        }
+
+        /**
+         * Moves the current token out of the iterator (leaving it
+         * empty), e.g. so that a label can be stored without being
+         * copied. The token should not be used again before the
+         * iterator is advanced.
+         */
+        inline std::string release_token() {
+            std::string token(std::move(this->token_));
+            this->token_.clear();
+            return token;
+        }
+
+        inline bool token_is_quoted() {
+            return this->token_is_quoted_;
+        }
+
+        inline bool token_has_comments() {
+            return !this->comment_ends_.empty();
+        }
+
+        /**
+         * Returns the comments captured since the last call to
+         * clear_captured_comments(). The text of the comments is
+         * accumulated in a single buffer as it is read, so that no
+         * strings are allocated per comment unless (and until) this
+         * is called.
+         */
+        inline std::vector<std::string>& captured_comments() {
+            std::size_t begin = this->captured_comments_.empty() ? 0 : this->comment_ends_[this->captured_comments_.size() - 1];
+            for (std::size_t idx = this->captured_comments_.size(); idx < this->comment_ends_.size(); ++idx) {
+                this->captured_comments_.emplace_back(this->comment_text_, begin, this->comment_ends_[idx] - begin);
+                begin = this->comment_ends_[idx];
+            }
+            return this->captured_comments_;
+        }
+
+        /**
+         * Returns the comments captured since the last call to
+         * clear_captured_comments() as views into the iterator's
+         * comment buffer, without copying them. The views are
+         * invalidated when the iterator is advanced.
+         */
+        inline const std::vector<TokenView>& captured_comment_views() {
+            this->comment_views_.clear();
+            std::size_t begin = 0;
+            for (auto end : this->comment_ends_) {
+                this->comment_views_.push_back(TokenView(this->comment_text_.data() + begin, end - begin));
+                begin = end;
+            }
+            return this->comment_views_;
+        }
+
+        inline void clear_captured_comments() {
+            this->comment_text_.clear();
+            this->comment_ends_.clear();
+            this->captured_comments_.clear();
+        }
+
+        // Number of tokens produced, and comments captured, so far
+        // (always 0 unless PLATYPUS_ENABLE_INSTRUMENTATION is
+        // defined; see platypus::InstrumentationStats).
+        inline unsigned long num_tokens() const {
+            return this->num_tokens_.value();
+        }
+        inline unsigned long num_comments() const {
+            return this->num_comments_.value();
+        }
+
+    protected:
+
+        inline value_type & get_next_token() {
+            assert(this->src_.buf != nullptr);
+            this->token_is_quoted_ = false;
+            auto & src = this->src_;
+            this->skip_to_next_significant_char();
+            if (this->cur_char_ == EOF && !src.good) {
+                this->set_eof();
+                return this->token_;
+            }
+            if (this->is_captured_delimiter()) {
+                this->token_ = this->cur_char_;
+                this->get_next_char();
+                this->num_tokens_.increment();
+                return this->token_;
+            } else if (this->is_quote_char()) {
+                this->token_is_quoted_ = true;
+                std::string & dest = this->token_;
+                dest.clear();
+                int cur_quote_char = this->cur_char_;
+                if (!src.good) {
+                    throw TokenizerUnterminatedQuoteError(__FILE__, __LINE__, "Unterminated quote");
+                    // // TODO! unterminated quote
+                    // this->set_eof();
+                    // return this->token_;
+                }
+                this->get_next_char();
+                while (true) {
+                    if (!src.good) {
+                        throw TokenizerUnterminatedQuoteError(__FILE__, __LINE__, "Unterminated quote");
+                        // // TODO! unterminated quote
+                        // this->set_eof();
+                        // return this->token_;
+                    }
+                    if (this->cur_char_ == cur_quote_char) {
+                        this->get_next_char();
+                        if (this->esc_quote_chars_by_doubling_) {
+                            if (this->cur_char_ == cur_quote_char) {
+                                dest.push_back(static_cast<char>(cur_quote_char));
+                                this->get_next_char();
+                            } else {
+                                // this->get_next_char();
+                                break;
+                            }
+                        } else {
+                            this->get_next_char();
+                            break;
+                        }
+                    } else {
+                        dest.push_back(static_cast<char>(this->cur_char_));
+                        this->get_next_char();
+                    }
+                }
+                this->num_tokens_.increment();
+                return this->token_;
+            } else {
+                std::string & dest = this->token_;
+                dest.clear();
+                this->token_is_quoted_ = false;
+                while (src.good && this->cur_char_ != EOF) {
+                    unsigned char char_class = this->char_classes_[this->cur_char_];
+                    if (char_class == CharacterClassTable::ORDINARY) {
+                        this->consume_ordinary_chars(dest);
+                    } else if (char_class & CharacterClassTable::UNCAPTURED_DELIMITER) {
+                        this->get_next_char();
+                        break;
+                    } else if (char_class & CharacterClassTable::CAPTURED_DELIMITER) {
+                        break;
+                    } else if (char_class & CharacterClassTable::COMMENT_BEGIN) {
+                        this->handle_comment();
+                        if (!src.good) {
+                            this->src_.buf = nullptr;
+                            break;
+                        }
+                    } else {
+                        dest.push_back(static_cast<char>(this->cur_char_));
+                        this->get_next_char();
+                    }
+                }
+                if (this->token_.empty()) {
+                    if (src.good) {
+                        return this->get_next_token();
+                    }
+                    this->set_eof();
+                } else {
+                    this->num_tokens_.increment();
+                }
+                return this->token_;
+            }
+        }
+
+        inline void skip_to_next_significant_char() {
+            auto & src = this->src_;
+            if (! src.good ) {
+                this->set_eof();
+                return;
+            }
+            if (this->cur_char_ == 0) {
+                this->get_next_char();
+            }
+            if ( !this->is_uncaptured_delimiter() ) {
+                return;
+            }
+            while ( src.good && this->is_uncaptured_delimiter() ) {
+                this->get_next_char();
+            }
+            if (!src.good && this->is_uncaptured_delimiter()) {
+                this->set_eof();
+            }
+        }
+
+        inline void handle_comment() {
+            auto & src = this->src_;
+            std::string & dest = this->comment_text_;
+            unsigned int nesting = 0;
+            bool comment_complete = false;
+            while (src.good) {
+                if ( this->is_comment_end() ) {
+                    nesting -= 1;
+                    if (nesting <= 0) {
+                        comment_complete = true;
+                        this->get_next_char();
+                        break;
+                    }
+                } else if ( this->is_comment_begin() ) {
+                    nesting += 1;
+                } else if (this->capture_comments_) {
+                    dest.push_back(static_cast<char>(this->cur_char_));
+                }
+                this->get_next_char();
+            }
+            if (!src.good && !comment_complete) {
+                this->set_eof();
+            }
+            if (this->capture_comments_) {
+                this->comment_ends_.push_back(dest.size());
+                this->num_comments_.increment();
+            }
+        }
+
+        inline bool is_uncaptured_delimiter() {
+            return this->char_classes_.is(this->cur_char_, CharacterClassTable::UNCAPTURED_DELIMITER);
+        }
+
+        inline bool is_captured_delimiter() {
+            return this->char_classes_.is(this->cur_char_, CharacterClassTable::CAPTURED_DELIMITER);
+        }
+
+        inline bool is_quote_char() {
+            return this->char_classes_.is(this->cur_char_, CharacterClassTable::QUOTE);
+        }
+
+        inline bool is_comment_begin() {
+            return this->char_classes_.is(this->cur_char_, CharacterClassTable::COMMENT_BEGIN);
+        }
+
+        inline bool is_comment_end() {
+            return this->char_classes_.is(this->cur_char_, CharacterClassTable::COMMENT_END);
+        }
+
+        inline int get_next_char() {
+            this->cur_char_ = this->src_.get();
+            return this->cur_char_;
+        }
+
+        // Appends the current character and all immediately following
+        // ordinary (non-delimiter, non-quote, non-comment) characters
+        // to ``dest``. On return, the current character is the first
+        // non-ordinary character (or EOF, in which case the end of the
+        // source is recorded as by Source::get()).
+        inline void consume_ordinary_chars(std::string & dest) {
+            dest.push_back(static_cast<char>(this->cur_char_));
+            std::streambuf * sb = this->src_.buf;
+            while (true) {
+                int ch = sb->sbumpc();
+                if (ch == std::char_traits<char>::eof()) {
+                    this->src_.set_end();
+                    this->cur_char_ = EOF;
+                    return;
+                }
+                if (this->char_classes_[ch] != CharacterClassTable::ORDINARY) {
+                    this->cur_char_ = ch;
+                    return;
+                }
+                dest.push_back(static_cast<char>(ch));
+            }
+        }
+
+    protected:
+
+        // The source of characters, which are read directly from a
+        // stream buffer rather than character-by-character through a
+        // std::istream: that of a stream, or a CharacterViewBuffer
+        // over a block of memory (so that tokenizing a string needs
+        // neither a copy of it nor a std::istringstream).
+        struct Source {
+            std::istream *          stream;     // nullptr if not reading a stream
+            CharacterViewBuffer     view;
+            std::streambuf *        buf;        // nullptr once exhausted
+            bool                    good;       // as std::istream::good()
+
+            Source()
+                : stream(nullptr)
+                , buf(nullptr)
+                , good(false) {
+            }
+            explicit Source(std::istream & src)
+                : stream(&src)
+                , buf(src.rdbuf())
+                , good(src.good() && src.rdbuf() != nullptr) {
+            }
+            Source(const char * data, std::size_t size)
+                : stream(nullptr)
+                , view(data, size)
+                , buf(&this->view)
+                , good(true) {
+            }
+            Source(const Source & other)
+                : stream(other.stream)
+                , view(other.view)
+                , buf(other.buf == &other.view ? &this->view : other.buf)
+                , good(other.good) {
+            }
+            Source & operator=(const Source & other) {
+                this->stream = other.stream;
+                this->view = other.view;
+                this->buf = other.buf == &other.view ? &this->view : other.buf;
+                this->good = other.good;
+                return *this;
+            }
+
+            // As std::istream::get(): at the end of the source, returns
+            // EOF and sets the eofbit and failbit of the stream (if any).
+            inline int get() {
+                int ch = this->buf->sbumpc();
+                if (ch == std::char_traits<char>::eof()) {
+                    this->set_end();
+                }
+                return ch;
+            }
+
+            inline void set_end() {
+                this->good = false;
+                if (this->stream != nullptr) {
+                    this->stream->setstate(std::ios::eofbit | std::ios::failbit);
+                }
+            }
+        }; // Source
+
+        //  copy of source over lifespan (shared by copies of the iterator)
+        std::shared_ptr<const std::string>  src_string_copy_;
+
+        // src characters
+        Source                      src_;
+
+        // configuration
+        CharClassesT                char_classes_;
+        bool                        esc_quote_chars_by_doubling_;
+        bool                        capture_comments_;
+
+        // local storage
+        std::string                 token_;
+        int                         cur_char_;
+        bool                        token_is_quoted_;
+        std::string                 comment_text_;      // all captured comments, concatenated
+        std::vector<std::size_t>    comment_ends_;      // end of each comment in ``comment_text_``
+        std::vector<TokenView>      comment_views_;     // built on demand
+        std::vector<std::string>    captured_comments_; // built on demand
+        bool                        eof_flag_;
+
+        // instrumentation
+        InstrumentationCounter      num_tokens_;
+        InstrumentationCounter      num_comments_;
+
+}; // BasicTokenizerIterator
+
 ////////////////////////////////////////////////////////////////////////////////
 // Tokenizer
 class Tokenizer {
@@ -84,105 +893,349 @@ class Tokenizer {
             , esc_chars_(esc_chars)
             , comment_begin_(comment_begin)
             , comment_end_(comment_end)
-            , capture_comments_(capture_comments) {
+            , capture_comments_(capture_comments)
+            , char_classes_(uncaptured_delimiters,
+                    captured_delimiters,
+                    quote_chars,
+                    comment_begin,
+                    comment_end) {
         }
 
         virtual ~Tokenizer() {}
 
+        typedef BasicTokenizerIterator<CharacterClassTable> iterator;
+
+        iterator begin(std::istream & src) {
+            return Tokenizer::iterator(src,
+                this->char_classes_,
+                this->esc_quote_chars_by_doubling_,
+                this->capture_comments_);
+        }
+
+        /**
+         * Tokenizes ``str`` in place, without copying it: ``str`` must
+         * hence outlive the iterator, and not be modified while it is in
+         * use. Temporaries are instead moved into (and owned by) the
+         * iterator.
+         */
+        iterator begin(const std::string & str) {
+            return this->begin(str.data(), str.size());
+        }
+        iterator begin(std::string && str) {
+            return Tokenizer::iterator(std::move(str),
+                this->char_classes_,
+                this->esc_quote_chars_by_doubling_,
+                this->capture_comments_);
+        }
+
+        /**
+         * Tokenizes the ``size`` characters starting at ``data`` in place,
+         * without copying them or taking ownership of them (as
+         * begin(const std::string &)).
+         */
+        iterator begin(const char * data, std::size_t size) {
+            return Tokenizer::iterator(data,
+                size,
+                this->char_classes_,
+                this->esc_quote_chars_by_doubling_,
+                this->capture_comments_);
+        }
+        iterator end() {
+            return Tokenizer::iterator();
+        }
+
+        /**
+         * Sets whether iterators created subsequently capture the text of
+         * comments (see iterator::captured_comments()). If not, comments
+         * are skipped over without any of their text being stored.
+         */
+        void set_capture_comments(bool capture_comments) {
+            this->capture_comments_ = capture_comments;
+        }
+        bool get_capture_comments() const {
+            return this->capture_comments_;
+        }
+
+    private:
+        std::string     uncaptured_delimiters_;
+        std::string     captured_delimiters_;
+        std::string     quote_chars_;
+        bool            esc_quote_chars_by_doubling_;
+        std::string     esc_chars_;
+        std::string     comment_begin_;
+        std::string     comment_end_;
+        bool            capture_comments_;
+        CharacterClassTable char_classes_;
+
+}; // Tokenizer
+
+////////////////////////////////////////////////////////////////////////////////
+// NexusTokenizer
+
+class NexusTokenizer : public Tokenizer {
+    public:
+        NexusTokenizer()
+            : Tokenizer(
+                    " \t\n\r",      // uncaptured delimiters
+                    "(),;:",        // captured delimiters
+                    "\"'",          // quote_chars
+                    true,           // esc_quote_chars_by_doubling
+                    "",             // esc_chars
+                    "[",            // comment_begin
+                    "]",            // comment_end
+                    true            // capture_comments
+                    ) {
+        }
+}; // NexusTokenizer
+
+////////////////////////////////////////////////////////////////////////////////
+// NewickSyntaxClasses
+
+// The CharacterClassTable::CharacterClass flags of each character in
+// platypus::NewickSyntax (a template only so that the table can be defined
+// in this header). Characters from 128 up are all ordinary.
+template <class T=void>
+struct NewickSyntaxClasses {
+    enum {
+        U = CharacterClassTable::UNCAPTURED_DELIMITER,
+        C = CharacterClassTable::CAPTURED_DELIMITER,
+        Q = CharacterClassTable::QUOTE,
+        B = CharacterClassTable::COMMENT_BEGIN,
+        E = CharacterClassTable::COMMENT_END,
+    };
+    static const unsigned char classes[256];
+}; // NewickSyntaxClasses
+
+template <class T>
+const unsigned char NewickSyntaxClasses<T>::classes[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, U, U, 0, 0, U, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    U, 0, Q, 0, 0, 0, 0, Q, C, C, 0, 0, C, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, C, C, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, B, 0, E, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// NewickSyntax
+
+/**
+ * The syntax of platypus::NexusTokenizer (and so of Newick and NEXUS tree
+ * statements), fixed at compile time, for use with platypus::BasicTokenizer.
+ */
+struct NewickSyntax {
+
+    static inline unsigned char classify(unsigned char ch) {
+        return NewickSyntaxClasses<>::classes[ch];
+    }
+
+    static constexpr bool esc_quote_chars_by_doubling() {
+        return true;
+    }
+
+    static constexpr bool capture_comments() {
+        return true;
+    }
+
+}; // NewickSyntax
+
+////////////////////////////////////////////////////////////////////////////////
+// BasicTokenizer
+
+/**
+ * A tokenizer with the interface of platypus::Tokenizer, but whose syntax
+ * (delimiters, quotes, comments and the escaping of quotes) is fixed at
+ * compile time by ``SyntaxT`` (see platypus::NewickSyntax and
+ * platypus::StaticCharacterClassTable), so that characters are classified
+ * by code that the compiler can inline into the scanning loops (for
+ * platypus::NewickSyntax, a lookup in a single constant table), and
+ * iterators hold no copy of the configuration. Whether comments are
+ * captured remains a runtime setting.
+ */
+template <class SyntaxT>
+class BasicTokenizer {
+
+    public:
+        typedef SyntaxT                                                     syntax_type;
+        typedef BasicTokenizerIterator<StaticCharacterClassTable<SyntaxT>>  iterator;
+
+    public:
+        BasicTokenizer()
+            : capture_comments_(SyntaxT::capture_comments()) { }
+
+        iterator begin(std::istream & src) {
+            return iterator(src,
+                StaticCharacterClassTable<SyntaxT>(),
+                SyntaxT::esc_quote_chars_by_doubling(),
+                this->capture_comments_);
+        }
+        // As Tokenizer::begin(const std::string &), etc.: ``str`` is not
+        // copied, so must outlive the iterator; temporaries are moved into
+        // the iterator.
+        iterator begin(const std::string & str) {
+            return this->begin(str.data(), str.size());
+        }
+        iterator begin(std::string && str) {
+            return iterator(std::move(str),
+                StaticCharacterClassTable<SyntaxT>(),
+                SyntaxT::esc_quote_chars_by_doubling(),
+                this->capture_comments_);
+        }
+        iterator begin(const char * data, std::size_t size) {
+            return iterator(data,
+                size,
+                StaticCharacterClassTable<SyntaxT>(),
+                SyntaxT::esc_quote_chars_by_doubling(),
+                this->capture_comments_);
+        }
+        iterator end() {
+            return iterator();
+        }
+
+        // As Tokenizer::set_capture_comments().
+        void set_capture_comments(bool capture_comments) {
+            this->capture_comments_ = capture_comments;
+        }
+        bool get_capture_comments() const {
+            return this->capture_comments_;
+        }
+
+    private:
+        bool            capture_comments_;
+
+}; // BasicTokenizer
+
+typedef BasicTokenizer<NewickSyntax> NewickTokenizer;
+
+////////////////////////////////////////////////////////////////////////////////
+// BufferTokenizer
+
+/**
+ * Tokenizes a contiguous, in-memory, character buffer (e.g., the contents of
+ * a memory-mapped file; see platypus::MappedFile) instead of a stream.
+ *
+ * Configuration and tokenization rules are the same as platypus::Tokenizer,
+ * but tokens are returned as platypus::TokenView objects that refer directly
+ * into the buffer. Characters are only copied if the token cannot be
+ * represented as a single contiguous run of the source, i.e. quoted tokens
+ * with escaped (doubled) quote characters, or unquoted tokens broken up by
+ * comments. The buffer must outlive all iterators over it, and the token
+ * referenced by an iterator is only valid until the iterator is advanced.
+ */
+class BufferTokenizer {
+
+    public:
+        BufferTokenizer(
+            const std::string & uncaptured_delimiters,
+            const std::string & captured_delimiters,
+            const std::string & quote_chars,
+            bool esc_quote_chars_by_doubling,
+            const std::string & esc_chars,
+            const std::string & comment_begin,
+            const std::string & comment_end,
+            bool capture_comments)
+            : uncaptured_delimiters_(uncaptured_delimiters)
+            , captured_delimiters_(captured_delimiters)
+            , quote_chars_(quote_chars)
+            , esc_quote_chars_by_doubling_(esc_quote_chars_by_doubling)
+            , esc_chars_(esc_chars)
+            , comment_begin_(comment_begin)
+            , comment_end_(comment_end)
+            , capture_comments_(capture_comments)
+            , char_classes_(uncaptured_delimiters,
+                    captured_delimiters,
+                    quote_chars,
+                    comment_begin,
+                    comment_end) {
+        }
+
+        virtual ~BufferTokenizer() {}
+
         class iterator {
             public:
 				typedef iterator                    self_type;
-				typedef std::string                 value_type;
-				typedef value_type *                pointer;
-				typedef value_type &                reference;
+				typedef TokenView                   value_type;
+				typedef const value_type *          pointer;
+				typedef const value_type &          reference;
 				typedef unsigned long               size_type;
 				typedef int                         difference_type;
 				typedef std::forward_iterator_tag   iterator_category;
 
 			public:
 
-			    iterator(std::istream & src,
-                        const std::string & uncaptured_delimiters,
-                        const std::string & captured_delimiters,
-                        const std::string & quote_chars,
-                        bool esc_quote_chars_by_doubling,
-                        const std::string & esc_chars,
-                        const std::string & comment_begin,
-                        const std::string & comment_end,
-                        bool capture_comments)
-                        : allocated_src_ptr_(nullptr)
-                            , src_ptr_(&src)
-                            , uncaptured_delimiters_(uncaptured_delimiters)
-                            , captured_delimiters_(captured_delimiters)
-                            , quote_chars_(quote_chars)
-                            , esc_quote_chars_by_doubling_(esc_quote_chars_by_doubling)
-                            , esc_chars_(esc_chars)
-                            , comment_begin_(comment_begin)
-                            , comment_end_(comment_end)
-                            , capture_comments_(capture_comments)
-                            , cur_char_(0)
-                            , eof_flag_(false) {
-                    this->get_next_token();
-                }
-
-			    iterator(const std::string & str,
-                        const std::string & uncaptured_delimiters,
-                        const std::string & captured_delimiters,
-                        const std::string & quote_chars,
-                        bool esc_quote_chars_by_doubling,
-                        const std::string & esc_chars,
-                        const std::string & comment_begin,
-                        const std::string & comment_end,
-                        bool capture_comments)
-                        : src_string_copy_(str)
-                            , allocated_src_ptr_(new std::istringstream(src_string_copy_))
-                            , src_ptr_(this->allocated_src_ptr_)
-                            , uncaptured_delimiters_(uncaptured_delimiters)
-                            , captured_delimiters_(captured_delimiters)
-                            , quote_chars_(quote_chars)
-                            , esc_quote_chars_by_doubling_(esc_quote_chars_by_doubling)
-                            , esc_chars_(esc_chars)
-                            , comment_begin_(comment_begin)
-                            , comment_end_(comment_end)
-                            , capture_comments_(capture_comments)
-                            , cur_char_(0)
+			    iterator(const BufferTokenizer * tokenizer,
+                        const char * begin,
+                        const char * end)
+                        : tokenizer_(tokenizer)
+                            , pos_(begin)
+                            , end_(end)
+                            , token_is_quoted_(false)
+                            , token_in_scratch_(false)
                             , eof_flag_(false) {
                     this->get_next_token();
                 }
 
                 iterator()
-                    : allocated_src_ptr_(nullptr)
-                        , src_ptr_(nullptr)
-                        , esc_quote_chars_by_doubling_(true)
+                    : tokenizer_(nullptr)
+                        , pos_(nullptr)
+                        , end_(nullptr)
+                        , token_is_quoted_(false)
+                        , token_in_scratch_(false)
                         , eof_flag_(true) {
                 }
 
-                ~iterator() {
-                    if (this->allocated_src_ptr_ != nullptr) {
-                        delete this->allocated_src_ptr_;
-                        this->allocated_src_ptr_ = nullptr;
+                iterator(const iterator & other)
+                    : tokenizer_(other.tokenizer_)
+                        , pos_(other.pos_)
+                        , end_(other.end_)
+                        , token_(other.token_)
+                        , token_is_quoted_(other.token_is_quoted_)
+                        , token_in_scratch_(other.token_in_scratch_)
+                        , scratch_(other.scratch_)
+                        , comment_views_(other.comment_views_)
+                        , captured_comments_(other.captured_comments_)
+                        , eof_flag_(other.eof_flag_)
+                        , num_tokens_(other.num_tokens_)
+                        , num_comments_(other.num_comments_) {
+                    if (this->token_in_scratch_) {
+                        this->token_ = TokenView(this->scratch_);
                     }
                 }
 
-                inline reference operator*() {
+                iterator & operator=(const iterator & other) {
+                    this->tokenizer_ = other.tokenizer_;
+                    this->pos_ = other.pos_;
+                    this->end_ = other.end_;
+                    this->token_ = other.token_;
+                    this->token_is_quoted_ = other.token_is_quoted_;
+                    this->token_in_scratch_ = other.token_in_scratch_;
+                    this->scratch_ = other.scratch_;
+                    this->comment_views_ = other.comment_views_;
+                    this->captured_comments_ = other.captured_comments_;
+                    this->eof_flag_ = other.eof_flag_;
+                    this->num_tokens_ = other.num_tokens_;
+                    this->num_comments_ = other.num_comments_;
+                    if (this->token_in_scratch_) {
+                        this->token_ = TokenView(this->scratch_);
+                    }
+                    return *this;
+                }
+
+                inline reference operator*() const {
                     return this->token_;
                 }
 
-                inline pointer operator->() {
+                inline pointer operator->() const {
                     return &(this->token_);
                 }
 
                 inline bool operator==(const self_type& rhs) const {
-                    if (this->eof_flag_ == false && rhs.eof_flag_ == false) {
-                        return true;
-                    } else if ( this->src_ptr_ == rhs.src_ptr_) {
-                        return true;
-                    } else if (this->src_ptr_ && rhs.src_ptr_) {
-                        /* return *(this->src_ptr_) == *(rhs.src_ptr_); */
-                        return false;
-                    } else {
-                        return false;
+                    if (this->eof_flag_ || rhs.eof_flag_) {
+                        return this->eof_flag_ == rhs.eof_flag_;
                     }
+                    return this->pos_ == rhs.pos_;
                 }
 
                 inline bool operator!=(const self_type& rhs) const {
@@ -190,16 +1243,16 @@ class Tokenizer {
                 }
 
                 inline const self_type & operator++() {
-                    if (!this->src_ptr_ || !this->src_ptr_->good()) {
+                    if (this->eof_flag_ || this->pos_ >= this->end_) {
                         this->set_eof();
-                    } else if (this->src_ptr_ != nullptr) {
+                    } else {
                         this->get_next_token();
                     }
                     return *this;
                 }
 
                 inline const self_type & require_next() {
-                    if (!this->src_ptr_->good()) {
+                    if (this->eof_flag_ || this->pos_ >= this->end_) {
                         throw TokenizerUnexpectedEndOfStreamError(__FILE__, __LINE__, "Unexpected end of stream");
                     }
                     this->get_next_token();
@@ -212,254 +1265,445 @@ class Tokenizer {
                     return i;
                 }
 
-                inline bool eof() {
-                    return this->eof_flag_;
-                    if (this->src_ptr_ && !this->src_ptr_->good()) {
-                        this->src_ptr_ = nullptr;
+                /**
+                 * As Tokenizer::iterator::skip_past(): advances to the token
+                 * following the next unquoted, uncommented ``terminator``
+                 * without building any tokens in between (see
+                 * BufferTokenizer::find_statement_end()).
+                 */
+                inline const self_type & skip_past(char terminator=';') {
+                    if (this->eof_flag_) {
+                        return *this;
+                    }
+                    this->clear_captured_comments();
+                    this->pos_ = this->tokenizer_->find_statement_end(this->pos_, this->end_, terminator);
+                    if (this->pos_ >= this->end_) {
+                        this->set_eof();
+                    } else {
+                        this->get_next_token();
                     }
-                    // return (this->src_ptr_ == nullptr) || (!this->src_ptr_->good());
-                    return (this->src_ptr_ == nullptr);
+                    return *this;
+                }
+
+                /**
+                 * Counts the unquoted, uncommented occurrences of any of
+                 * ``chars`` between the current token and the end of the
+                 * statement (see BufferTokenizer::count_in_statement()),
+                 * without advancing.
+                 */
+                inline std::size_t count_in_statement(const char * chars, char terminator=';') const {
+                    if (this->eof_flag_) {
+                        return 0;
+                    }
+                    return this->tokenizer_->count_in_statement(this->pos_, this->end_, chars, terminator);
+                }
+
+                inline bool eof() const {
+                    return this->eof_flag_;
                 }
 
                 inline void set_eof() {
-                    this->src_ptr_ = nullptr;
+                    this->pos_ = this->end_;
                     this->token_.clear();
+                    this->token_in_scratch_ = false;
                     this->eof_flag_ = true;
                 }
 
-                inline bool token_is_quoted() {
+                /**
+                 * Returns the current token as a string. Unlike
+                 * Tokenizer::iterator::release_token(), this copies the token
+                 * (which refers to the buffer), but leaves it valid.
+                 */
+                inline std::string release_token() const {
+                    return this->token_.str();
+                }
+
+                inline bool token_is_quoted() const {
                     return this->token_is_quoted_;
                 }
 
-                inline bool token_has_comments() {
-                    return !this->captured_comments_.empty();
+                inline bool token_has_comments() const {
+                    return !this->comment_views_.empty();
                 }
 
+                /**
+                 * Returns the comments captured since the last call to
+                 * clear_captured_comments(), as Tokenizer::iterator does.
+                 * Comments are recorded as views into the buffer while it is
+                 * tokenized, and are only copied into strings when this is
+                 * called (see captured_comment_views()).
+                 */
                 inline std::vector<std::string>& captured_comments() {
+                    for (std::size_t idx = this->captured_comments_.size(); idx < this->comment_views_.size(); ++idx) {
+                        const TokenView & view = this->comment_views_[idx];
+                        this->captured_comments_.emplace_back();
+                        std::string & comment = this->captured_comments_.back();
+                        comment.reserve(view.size());
+                        for (const char * ch = view.begin(); ch != view.end(); ++ch) {
+                            if (!this->is_comment_begin(*ch) && !this->is_comment_end(*ch)) {
+                                comment.push_back(*ch);
+                            }
+                        }
+                    }
                     return this->captured_comments_;
                 }
 
+                /**
+                 * Returns the comments captured since the last call to
+                 * clear_captured_comments() as views into the buffer,
+                 * without copying them. Unlike the strings returned by
+                 * captured_comments(), the views span any nested comments
+                 * verbatim, including their delimiters.
+                 */
+                inline const std::vector<TokenView>& captured_comment_views() const {
+                    return this->comment_views_;
+                }
+
                 inline void clear_captured_comments() {
+                    this->comment_views_.clear();
                     this->captured_comments_.clear();
                 }
 
+                // Position in the buffer of the character following the
+                // current token.
+                inline const char * position() const {
+                    return this->pos_;
+                }
+
+                // As Tokenizer::iterator::num_tokens() and
+                // Tokenizer::iterator::num_comments().
+                inline unsigned long num_tokens() const {
+                    return this->num_tokens_.value();
+                }
+                inline unsigned long num_comments() const {
+                    return this->num_comments_.value();
+                }
+
             protected:
 
-                inline value_type & get_next_token() {
-                    assert(this->src_ptr_ != nullptr);
-                    this->token_is_quoted_ = false;
-                    auto & src = *(this->src_ptr_);
-                    this->skip_to_next_significant_char();
-                    if (this->cur_char_ == EOF && !src.good()) {
-                        this->set_eof();
-                        return this->token_;
+                inline void get_next_token() {
+                    assert(this->tokenizer_ != nullptr);
+                    while (true) {
+                        this->token_is_quoted_ = false;
+                        this->token_in_scratch_ = false;
+                        while (this->pos_ < this->end_ && this->is_uncaptured_delimiter(*this->pos_)) {
+                            ++this->pos_;
+                        }
+                        if (this->pos_ >= this->end_) {
+                            this->set_eof();
+                            return;
+                        }
+                        char ch = *this->pos_;
+                        if (this->is_captured_delimiter(ch)) {
+                            this->token_ = TokenView(this->pos_, 1);
+                            ++this->pos_;
+                            this->num_tokens_.increment();
+                            return;
+                        } else if (this->is_quote_char(ch)) {
+                            this->read_quoted_token();
+                            this->num_tokens_.increment();
+                            return;
+                        } else if (this->read_unquoted_token()) {
+                            this->num_tokens_.increment();
+                            return;
+                        } else if (this->eof_flag_ || this->pos_ >= this->end_) {
+                            this->set_eof();
+                            return;
+                        }
+                        // empty token (e.g., only a comment): try again
                     }
-                    if (this->is_captured_delimiter()) {
-                        this->token_ = this->cur_char_;
-                        this->get_next_char();
-                        return this->token_;
-                    } else if (this->is_quote_char()) {
-                        this->token_is_quoted_ = true;
-                        std::ostringstream dest;
-                        int cur_quote_char = this->cur_char_;
-                        if (!src.good()) {
+                }
+
+                inline void read_quoted_token() {
+                    this->token_is_quoted_ = true;
+                    const char quote_char = *this->pos_;
+                    ++this->pos_;
+                    const char * token_begin = this->pos_;
+                    bool copying = false;
+                    while (true) {
+                        if (this->pos_ >= this->end_) {
                             throw TokenizerUnterminatedQuoteError(__FILE__, __LINE__, "Unterminated quote");
-                            // // TODO! unterminated quote
-                            // this->set_eof();
-                            // return this->token_;
                         }
-                        this->get_next_char();
-                        while (true) {
-                            if (!src.good()) {
-                                throw TokenizerUnterminatedQuoteError(__FILE__, __LINE__, "Unterminated quote");
-                                // // TODO! unterminated quote
-                                // this->set_eof();
-                                // return this->token_;
-                            }
-                            if (this->cur_char_ == cur_quote_char) {
-                                this->get_next_char();
-                                if (this->esc_quote_chars_by_doubling_) {
-                                    if (this->cur_char_ == cur_quote_char) {
-                                        dest.put(cur_quote_char);
-                                        this->get_next_char();
-                                    } else {
-                                        // this->get_next_char();
-                                        break;
-                                    }
-                                } else {
-                                    this->get_next_char();
-                                    break;
+                        if (*this->pos_ == quote_char) {
+                            if (this->tokenizer_->esc_quote_chars_by_doubling_
+                                    && this->pos_ + 1 < this->end_
+                                    && *(this->pos_ + 1) == quote_char) {
+                                if (!copying) {
+                                    this->scratch_.assign(token_begin, this->pos_);
+                                    copying = true;
                                 }
-                            } else {
-                                dest.put(this->cur_char_);
-                                this->get_next_char();
+                                this->scratch_.push_back(quote_char);
+                                this->pos_ += 2;
+                                continue;
                             }
-                        }
-                        this->token_ = dest.str();
-                        return this->token_;
-                    } else {
-                        std::ostringstream dest;
-                        this->token_is_quoted_ = false;
-                        while (src.good() && this->cur_char_ != EOF) {
-                            if (this->is_uncaptured_delimiter() ) {
-                                this->get_next_char();
-                                break;
-                            } else if (this->is_captured_delimiter()) {
-                                break;
-                            } else if (this->is_comment_begin()) {
-                                this->handle_comment();
-                                if (!src.good()) {
-                                    this->src_ptr_ = nullptr;
-                                    break;
-                                }
+                            if (copying) {
+                                this->set_token_from_scratch();
                             } else {
-                                dest.put(this->cur_char_);
-                                this->get_next_char();
+                                this->token_ = TokenView(token_begin, this->pos_ - token_begin);
                             }
+                            ++this->pos_;
+                            return;
                         }
-                        this->token_ = dest.str();
-                        if (this->token_.empty()) {
-                            if (src.good()) {
-                                this->get_next_token();
-                            } else {
-                                this->set_eof();
-                            }
+                        if (copying) {
+                            this->scratch_.push_back(*this->pos_);
                         }
-                        return this->token_;
+                        ++this->pos_;
                     }
                 }
 
-                inline void skip_to_next_significant_char() {
-                    auto & src = *(this->src_ptr_);
-                    if (! src.good() ) {
-                        this->set_eof();
-                        return;
-                    }
-                    if (this->cur_char_ == 0) {
-                        this->get_next_char();
-                    }
-                    if ( !this->is_uncaptured_delimiter() ) {
-                        return;
+                // Returns false if no token characters were found.
+                inline bool read_unquoted_token() {
+                    const char * segment_begin = this->pos_;
+                    // first run of characters, if interrupted by a comment,
+                    // but not yet copied
+                    const char * pending_begin = nullptr;
+                    const char * pending_end = nullptr;
+                    bool copying = false;
+                    const CharacterClassTable & char_classes = this->tokenizer_->char_classes_;
+                    while (this->pos_ < this->end_) {
+                        // bulk advance over runs of ordinary characters
+                        while (this->pos_ < this->end_ && char_classes.is_ordinary(*this->pos_)) {
+                            ++this->pos_;
+                        }
+                        if (this->pos_ >= this->end_) {
+                            break;
+                        }
+                        char ch = *this->pos_;
+                        if (char_classes.is(ch, CharacterClassTable::UNCAPTURED_DELIMITER)
+                                || char_classes.is(ch, CharacterClassTable::CAPTURED_DELIMITER)) {
+                            break;
+                        } else if (char_classes.is(ch, CharacterClassTable::COMMENT_BEGIN)) {
+                            if (this->pos_ > segment_begin) {
+                                if (copying) {
+                                    this->scratch_.append(segment_begin, this->pos_);
+                                } else if (pending_begin == nullptr) {
+                                    pending_begin = segment_begin;
+                                    pending_end = this->pos_;
+                                } else {
+                                    this->scratch_.assign(pending_begin, pending_end);
+                                    this->scratch_.append(segment_begin, this->pos_);
+                                    copying = true;
+                                }
+                            }
+                            if (!this->handle_comment()) {
+                                // unterminated comment
+                                this->set_eof();
+                                return false;
+                            }
+                            segment_begin = this->pos_;
+                        } else {
+                            ++this->pos_;
+                        }
                     }
-                    while ( src.good() && this->is_uncaptured_delimiter() ) {
-                        this->get_next_char();
+                    if (this->pos_ > segment_begin) {
+                        if (copying) {
+                            this->scratch_.append(segment_begin, this->pos_);
+                            this->set_token_from_scratch();
+                        } else if (pending_begin != nullptr) {
+                            this->scratch_.assign(pending_begin, pending_end);
+                            this->scratch_.append(segment_begin, this->pos_);
+                            this->set_token_from_scratch();
+                        } else {
+                            this->token_ = TokenView(segment_begin, this->pos_ - segment_begin);
+                        }
+                    } else if (copying) {
+                        this->set_token_from_scratch();
+                    } else if (pending_begin != nullptr) {
+                        this->token_ = TokenView(pending_begin, pending_end - pending_begin);
+                    } else {
+                        this->token_.clear();
                     }
-                    if (!src.good() && this->is_uncaptured_delimiter()) {
-                        this->set_eof();
+                    if (this->pos_ < this->end_ && this->is_uncaptured_delimiter(*this->pos_)) {
+                        ++this->pos_;
                     }
+                    return !this->token_.empty();
                 }
 
-                inline void handle_comment() {
-                    auto & src = *(this->src_ptr_);
-                    std::ostringstream dest;
+                // Returns false if the comment is not terminated.
+                inline bool handle_comment() {
+                    // the current character opens the comment
+                    const char * comment_begin = this->pos_ + 1;
                     unsigned int nesting = 0;
-                    bool comment_complete = false;
-                    while (src.good()) {
-                        if ( this->is_comment_end() ) {
+                    while (this->pos_ < this->end_) {
+                        char ch = *this->pos_;
+                        if (this->is_comment_end(ch)) {
                             nesting -= 1;
                             if (nesting <= 0) {
-                                comment_complete = true;
-                                this->get_next_char();
-                                break;
+                                this->capture_comment(comment_begin, this->pos_);
+                                ++this->pos_;
+                                return true;
                             }
-                        } else if ( this->is_comment_begin() ) {
+                        } else if (this->is_comment_begin(ch)) {
                             nesting += 1;
-                        } else if (this->capture_comments_) {
-                            dest.put(this->cur_char_);
                         }
-                        this->get_next_char();
-                    }
-                    if (!src.good() && !comment_complete) {
-                        this->set_eof();
-                    }
-                    if (this->capture_comments_) {
-                        this->captured_comments_.push_back(dest.str());
+                        ++this->pos_;
                     }
+                    this->capture_comment(comment_begin, this->end_);
+                    return false;
                 }
 
-                inline bool is_uncaptured_delimiter() {
-                    return this->uncaptured_delimiters_.find(this->cur_char_) != std::string::npos;
+                inline void capture_comment(const char * begin, const char * end) {
+                    if (this->tokenizer_->capture_comments_) {
+                        this->comment_views_.push_back(TokenView(begin, end - begin));
+                        this->num_comments_.increment();
+                    }
                 }
 
-                inline bool is_captured_delimiter(const std::string & s) {
-                    return this->captured_delimiters_.find(s) != std::string::npos;
+                inline void set_token_from_scratch() {
+                    this->token_ = TokenView(this->scratch_);
+                    this->token_in_scratch_ = true;
                 }
 
-                inline bool is_captured_delimiter() {
-                    return this->captured_delimiters_.find(this->cur_char_) != std::string::npos;
+                inline bool is_uncaptured_delimiter(char ch) const {
+                    return this->tokenizer_->char_classes_.is(ch, CharacterClassTable::UNCAPTURED_DELIMITER);
                 }
 
-                inline bool is_quote_char() {
-                    return this->quote_chars_.find(this->cur_char_) != std::string::npos;
+                inline bool is_captured_delimiter(char ch) const {
+                    return this->tokenizer_->char_classes_.is(ch, CharacterClassTable::CAPTURED_DELIMITER);
                 }
 
-                inline bool is_comment_begin() {
-                    return this->comment_begin_.find(this->cur_char_) != std::string::npos;
+                inline bool is_quote_char(char ch) const {
+                    return this->tokenizer_->char_classes_.is(ch, CharacterClassTable::QUOTE);
                 }
 
-                inline bool is_comment_end() {
-                    return this->comment_end_.find(this->cur_char_) != std::string::npos;
+                inline bool is_comment_begin(char ch) const {
+                    return this->tokenizer_->char_classes_.is(ch, CharacterClassTable::COMMENT_BEGIN);
                 }
 
-                inline int get_next_char() {
-                    this->cur_char_ = this->src_ptr_->get();
-                    return this->cur_char_;
+                inline bool is_comment_end(char ch) const {
+                    return this->tokenizer_->char_classes_.is(ch, CharacterClassTable::COMMENT_END);
                 }
 
             protected:
-                //  copy of source over lifespan
-                std::string                 src_string_copy_;
-                std::istream *              allocated_src_ptr_;
-
-                // src stream
-                std::istream *              src_ptr_;
-
                 // configuration
-                std::string                 uncaptured_delimiters_;
-                std::string                 captured_delimiters_;
-                std::string                 quote_chars_;
-                bool                        esc_quote_chars_by_doubling_;
-                std::string                 esc_chars_;
-                std::string                 comment_begin_;
-                std::string                 comment_end_;
-                bool                        capture_comments_;
+                const BufferTokenizer *     tokenizer_;
+
+                // source
+                const char *                pos_;
+                const char *                end_;
 
                 // local storage
-                std::string                 token_;
-                int                         cur_char_;
+                TokenView                   token_;
                 bool                        token_is_quoted_;
-                std::vector<std::string>    captured_comments_;
+                bool                        token_in_scratch_;
+                std::string                 scratch_;
+                std::vector<TokenView>      comment_views_;
+                std::vector<std::string>    captured_comments_; // built on demand
                 bool                        eof_flag_;
 
+                // instrumentation
+                InstrumentationCounter      num_tokens_;
+                InstrumentationCounter      num_comments_;
+
         }; // iterator
 
-        iterator begin(std::istream & src) {
-            return Tokenizer::iterator(src,
-                this->uncaptured_delimiters_,
-                this->captured_delimiters_,
-                this->quote_chars_,
-                this->esc_quote_chars_by_doubling_,
-                this->esc_chars_,
-                this->comment_begin_,
-                this->comment_end_,
-                this->capture_comments_);
+        iterator begin(const char * data, std::size_t size) const {
+            return BufferTokenizer::iterator(this, data, data + size);
         }
-        iterator begin(const std::string & str) {
-            return Tokenizer::iterator(str,
-                this->uncaptured_delimiters_,
-                this->captured_delimiters_,
-                this->quote_chars_,
-                this->esc_quote_chars_by_doubling_,
-                this->esc_chars_,
-                this->comment_begin_,
-                this->comment_end_,
-                this->capture_comments_);
+        iterator begin(const char * begin, const char * end) const {
+            return BufferTokenizer::iterator(this, begin, end);
         }
-        iterator end() {
-            return Tokenizer::iterator();
+        // note: ``str`` must outlive the iterator
+        iterator begin(const std::string & str) const {
+            return BufferTokenizer::iterator(this, str.data(), str.data() + str.size());
+        }
+        iterator end() const {
+            return BufferTokenizer::iterator();
+        }
+
+        /**
+         * Scans forward from ``begin`` for the first occurrence of the
+         * character ``terminator`` that is not inside a quoted token or a
+         * comment, without otherwise tokenizing the buffer.
+         *
+         * @return
+         *   Pointer to the character following the terminator, or ``end`` if
+         *   there is no (unquoted, uncommented) terminator before ``end``.
+         */
+        const char * find_statement_end(const char * begin,
+                const char * end,
+                char terminator=';') const {
+            return this->scan_statement(begin, end, terminator, [](char) { });
+        }
+
+        /**
+         * Counts the occurrences of any of the characters in ``chars`` that
+         * are not inside a quoted token or a comment, from ``begin`` up to
+         * the statement terminator (as found by find_statement_end()) or
+         * ``end``. Used, e.g., to size a tree before parsing its statement
+         * (see NewickReader::set_prescan_node_counts()).
+         */
+        std::size_t count_in_statement(const char * begin,
+                const char * end,
+                const char * chars,
+                char terminator=';') const {
+            std::size_t count = 0;
+            this->scan_statement(begin, end, terminator, [&count, chars](char ch) {
+                if (ch != '\0' && std::strchr(chars, ch) != nullptr) {
+                    ++count;
+                }
+            });
+            return count;
+        }
+
+        const CharacterClassTable & char_classes() const {
+            return this->char_classes_;
+        }
+
+        // As Tokenizer::set_capture_comments().
+        void set_capture_comments(bool capture_comments) {
+            this->capture_comments_ = capture_comments;
+        }
+        bool get_capture_comments() const {
+            return this->capture_comments_;
         }
 
     private:
+        // Scans [begin, end) up to the first unquoted, uncommented
+        // ``terminator``, calling ``on_char`` with every other character
+        // that is outside quotes and comments.
+        template <class CharFnT>
+        const char * scan_statement(const char * begin,
+                const char * end,
+                char terminator,
+                CharFnT on_char) const {
+            const char * pos = begin;
+            while (pos < end) {
+                char ch = *pos;
+                if (ch == terminator) {
+                    return pos + 1;
+                }
+                unsigned char char_class = this->char_classes_[ch];
+                if (char_class & CharacterClassTable::QUOTE) {
+                    // doubled (escaped) quotes simply close and re-open the
+                    // quote, so need no special handling here
+                    ++pos;
+                    while (pos < end && *pos != ch) {
+                        ++pos;
+                    }
+                } else if (char_class & CharacterClassTable::COMMENT_BEGIN) {
+                    unsigned int nesting = 1;
+                    ++pos;
+                    while (pos < end && nesting > 0) {
+                        if (this->char_classes_.is(*pos, CharacterClassTable::COMMENT_END)) {
+                            --nesting;
+                        } else if (this->char_classes_.is(*pos, CharacterClassTable::COMMENT_BEGIN)) {
+                            ++nesting;
+                        }
+                        if (nesting > 0) {
+                            ++pos;
+                        }
+                    }
+                } else {
+                    on_char(ch);
+                }
+                if (pos < end) {
+                    ++pos;
+                }
+            }
+            return end;
+        }
+
         std::string     uncaptured_delimiters_;
         std::string     captured_delimiters_;
         std::string     quote_chars_;
@@ -468,16 +1712,17 @@ class Tokenizer {
         std::string     comment_begin_;
         std::string     comment_end_;
         bool            capture_comments_;
+        CharacterClassTable char_classes_;
 
-}; // Tokenizer
+}; // BufferTokenizer
 
 ////////////////////////////////////////////////////////////////////////////////
-// NexusTokenizer
+// NexusBufferTokenizer
 
-class NexusTokenizer : public Tokenizer {
+class NexusBufferTokenizer : public BufferTokenizer {
     public:
-        NexusTokenizer()
-            : Tokenizer(
+        NexusBufferTokenizer()
+            : BufferTokenizer(
                     " \t\n\r",      // uncaptured delimiters
                     "(),;:",        // captured delimiters
                     "\"'",          // quote_chars
@@ -488,7 +1733,7 @@ class NexusTokenizer : public Tokenizer {
                     true            // capture_comments
                     ) {
         }
-}; // NewickTokenizer
+}; // NexusBufferTokenizer
 
 } // namespace platypus
 
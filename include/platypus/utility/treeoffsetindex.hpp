@@ -0,0 +1,293 @@
+/**
+ * @package     platypus-phyloinformary
+ * @brief       Index of the byte offsets of the trees in a Newick or NEXUS source.
+ * @author      Jeet Sukumaran
+ * @copyright   Copyright (C) 2013 Jeet Sukumaran.
+ *              This file is part of "platypus-phyloinformary".
+ *              "platypus-phyloinformary" is free software: you can
+ *              redistribute it and/or modify it under the terms of the GNU
+ *              General Public License as published by the Free Software
+ *              Foundation, either version 3 of the License, or (at your
+ *              option) any later version.  "platypus-phyloinformary" is
+ *              distributed in the hope that it will be useful, but WITHOUT ANY
+ *              WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *              or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+ *              Public License for more details.  You should have received a
+ *              copy of the GNU General Public License along with
+ *              "platypus-phyloinformary".  If not, see
+ *              <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef PLATYPUS_UTILITY_TREEOFFSETINDEX_HPP
+#define PLATYPUS_UTILITY_TREEOFFSETINDEX_HPP
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+#include "../base/exception.hpp"
+#include "binaryformat.hpp"
+#include "mappedfile.hpp"
+#include "tokenizer.hpp"
+
+namespace platypus {
+
+////////////////////////////////////////////////////////////////////////////////
+// TreeOffsetIndexError
+
+class TreeOffsetIndexError : public PlatypusException {
+    public:
+        TreeOffsetIndexError(
+                    const std::string & filename,
+                    unsigned long line_num,
+                    const std::string & message)
+            : PlatypusException(filename, line_num, message) { }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// TreeOffsetIndex
+
+/**
+ * The byte offset of each tree statement in a Newick or NEXUS source, as
+ * found by a single pass over the source that locates statement
+ * terminators without parsing any trees. An index is typically built once
+ * and saved in a small sidecar file next to the source, so that other
+ * processes can load it and read any tree or range of trees by seeking
+ * directly to it (see BaseTreeReader::read_range()).
+ *
+ * For Newick sources, offsets are those of the start of each non-empty
+ * statement (i.e., the character following the preceding semi-colon, so
+ * that any rooting comment is included). For NEXUS sources (starting with
+ * "#NEXUS"), offsets are those of the "TREE" commands of the first TREES
+ * block, and the offsets of the start of the block and of its "END"
+ * command are recorded as well.
+ */
+class TreeOffsetIndex {
+
+    public:
+        typedef std::uint64_t       offset_type;
+        static constexpr offset_type npos() {
+            return std::numeric_limits<offset_type>::max();
+        }
+
+    public:
+
+        TreeOffsetIndex()
+            : source_size_(0)
+            , trees_block_offset_(npos())
+            , trees_block_end_offset_(npos()) { }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Building
+
+        // Indexes the ``size`` bytes starting at ``data``.
+        static TreeOffsetIndex build(const char * data, std::size_t size) {
+            TreeOffsetIndex index;
+            index.source_size_ = size;
+            NexusBufferTokenizer tokenizer;
+            tokenizer.set_capture_comments(false);
+            NexusBufferTokenizer::iterator first_token = tokenizer.begin(data, size);
+            if (!first_token.eof() && equals_ignore_case(*first_token, "#nexus")) {
+                index.index_nexus(tokenizer, data, size);
+            } else {
+                index.index_newick(tokenizer, data, size);
+            }
+            return index;
+        }
+
+        static TreeOffsetIndex build(const std::string & src) {
+            return build(src.data(), src.size());
+        }
+
+        // Indexes the file at ``path``, which is memory-mapped.
+        static TreeOffsetIndex build_from_file(const std::string & path) {
+            MappedFile src(path);
+            return build(src.data(), src.size());
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Access
+
+        inline std::size_t num_trees() const {
+            return this->tree_offsets_.size();
+        }
+
+        inline offset_type get_tree_offset(std::size_t tree_idx) const {
+            return this->tree_offsets_[tree_idx];
+        }
+
+        // Size of the source indexed, to check that an index loaded from a
+        // sidecar file still matches its source.
+        inline offset_type get_source_size() const {
+            return this->source_size_;
+        }
+
+        inline bool is_nexus() const {
+            return this->trees_block_offset_ != npos();
+        }
+
+        // Offset of the "BEGIN TREES" command, or npos() for Newick sources.
+        inline offset_type get_trees_block_offset() const {
+            return this->trees_block_offset_;
+        }
+
+        // Offset of the "END" command of the TREES block (the end of the
+        // source if unterminated), or npos() for Newick sources.
+        inline offset_type get_trees_block_end_offset() const {
+            return this->trees_block_end_offset_;
+        }
+
+        /**
+         * Offset of the end of the statements of trees [``begin_idx``,
+         * ``end_idx``): the start of tree ``end_idx`` if there is one, and
+         * otherwise the end of the TREES block (NEXUS) or source (Newick).
+         */
+        inline offset_type get_range_end_offset(std::size_t end_idx) const {
+            if (end_idx < this->tree_offsets_.size()) {
+                return this->tree_offsets_[end_idx];
+            }
+            return this->is_nexus() ? this->trees_block_end_offset_ : this->source_size_;
+        }
+
+        /////////////////////////////////////////////////////////////////////////
+        // Sidecar files
+
+        void write(std::ostream & out) const {
+            std::string buffer(sidecar_magic(), 4);
+            binary_format::append_u32(buffer, binary_format::VERSION);
+            binary_format::append_u64(buffer, this->source_size_);
+            binary_format::append_u64(buffer, this->trees_block_offset_);
+            binary_format::append_u64(buffer, this->trees_block_end_offset_);
+            binary_format::append_u64(buffer, this->tree_offsets_.size());
+            for (auto offset : this->tree_offsets_) {
+                binary_format::append_u64(buffer, offset);
+            }
+            out.write(buffer.data(), buffer.size());
+        }
+
+        static TreeOffsetIndex read(std::istream & src) {
+            std::string buffer((std::istreambuf_iterator<char>(src)), std::istreambuf_iterator<char>());
+            const std::size_t header_size = 4 + 4 + 8 * 4;
+            if (buffer.size() < header_size
+                    || std::memcmp(buffer.data(), sidecar_magic(), 4) != 0
+                    || binary_format::decode_u32(buffer.data() + 4) != binary_format::VERSION) {
+                throw TreeOffsetIndexError(__FILE__, __LINE__, "platypus::TreeOffsetIndex: not a tree offset index");
+            }
+            TreeOffsetIndex index;
+            const char * pos = buffer.data() + 8;
+            index.source_size_ = binary_format::decode_u64(pos);
+            index.trees_block_offset_ = binary_format::decode_u64(pos + 8);
+            index.trees_block_end_offset_ = binary_format::decode_u64(pos + 16);
+            std::uint64_t num_trees = binary_format::decode_u64(pos + 24);
+            pos += 32;
+            if (num_trees != (buffer.size() - header_size) / 8 || (buffer.size() - header_size) % 8 != 0) {
+                throw TreeOffsetIndexError(__FILE__, __LINE__, "platypus::TreeOffsetIndex: truncated tree offset index");
+            }
+            index.tree_offsets_.reserve(static_cast<std::size_t>(num_trees));
+            for (std::uint64_t idx = 0; idx < num_trees; ++idx) {
+                index.tree_offsets_.push_back(binary_format::decode_u64(pos));
+                pos += 8;
+            }
+            return index;
+        }
+
+        void save(const std::string & path) const {
+            std::ofstream out(path, std::ios::out | std::ios::binary);
+            if (!out) {
+                throw TreeOffsetIndexError(__FILE__, __LINE__, "Unable to open file: '" + path + "'");
+            }
+            this->write(out);
+        }
+
+        static TreeOffsetIndex load(const std::string & path) {
+            std::ifstream src(path, std::ios::in | std::ios::binary);
+            if (!src) {
+                throw TreeOffsetIndexError(__FILE__, __LINE__, "Unable to open file: '" + path + "'");
+            }
+            return read(src);
+        }
+
+    private:
+
+        static constexpr const char * sidecar_magic() {
+            return "PLTX";
+        }
+
+        static bool equals_ignore_case(const TokenView & token, const char * word) {
+            std::size_t size = std::strlen(word);
+            if (token.size() != size) {
+                return false;
+            }
+            for (std::size_t idx = 0; idx < size; ++idx) {
+                if (std::tolower(static_cast<unsigned char>(token[idx])) != word[idx]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void index_newick(const NexusBufferTokenizer & tokenizer, const char * data, std::size_t size) {
+            const char * pos = data;
+            const char * end = data + size;
+            while (pos < end) {
+                const char * statement_end = tokenizer.find_statement_end(pos, end);
+                NexusBufferTokenizer::iterator src_iter = tokenizer.begin(pos, statement_end);
+                if (!src_iter.eof() && *src_iter != ";") {
+                    this->tree_offsets_.push_back(static_cast<offset_type>(pos - data));
+                }
+                pos = statement_end;
+            }
+        }
+
+        void index_nexus(const NexusBufferTokenizer & tokenizer, const char * data, std::size_t size) {
+            const char * pos = data;
+            const char * end = data + size;
+            bool in_trees_block = false;
+            while (pos < end) {
+                const char * statement_end = tokenizer.find_statement_end(pos, end);
+                NexusBufferTokenizer::iterator src_iter = tokenizer.begin(pos, statement_end);
+                if (pos == data && !src_iter.eof()) {
+                    ++src_iter; // "#NEXUS" is not terminated
+                }
+                if (!src_iter.eof()) {
+                    offset_type offset = static_cast<offset_type>(pos - data);
+                    if (in_trees_block) {
+                        if (equals_ignore_case(*src_iter, "tree")) {
+                            this->tree_offsets_.push_back(offset);
+                        } else if (equals_ignore_case(*src_iter, "end") || equals_ignore_case(*src_iter, "endblock")) {
+                            this->trees_block_end_offset_ = offset;
+                            return;
+                        }
+                    } else if (equals_ignore_case(*src_iter, "begin")) {
+                        ++src_iter;
+                        if (!src_iter.eof() && equals_ignore_case(*src_iter, "trees")) {
+                            this->trees_block_offset_ = offset;
+                            in_trees_block = true;
+                        }
+                    }
+                }
+                pos = statement_end;
+            }
+            if (in_trees_block) {
+                this->trees_block_end_offset_ = static_cast<offset_type>(size);
+            }
+        }
+
+    private:
+        offset_type                 source_size_;
+        offset_type                 trees_block_offset_;
+        offset_type                 trees_block_end_offset_;
+        std::vector<offset_type>    tree_offsets_;
+
+}; // TreeOffsetIndex
+
+} // namespace platypus
+
+#endif
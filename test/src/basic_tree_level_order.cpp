@@ -84,12 +84,72 @@ int test_level_order_rev_internal_iterator() {
 }
 
 
+int test_level_order_breadth_first() {
+    BasicTree tree;
+    build_tree(tree, STANDARD_TEST_TREE_STRING);
+    int fails = 0;
+    std::string visits;
+    for (auto ndi = tree.level_order_begin(); ndi != tree.level_order_end(); ++ndi) {
+        visits += *ndi;
+    }
+    fails += platypus::testing::compare_equal(std::string("abciegfjklmnhop"), visits, __FILE__, __LINE__);
+    visits.clear();
+    for (auto ndi = tree.level_order_rbegin(false); ndi != tree.level_order_rend(); ++ndi) {
+        visits += *ndi;
+    }
+    fails += platypus::testing::compare_equal(std::string("hfgecba"), visits, __FILE__, __LINE__);
+    return fails;
+}
+
+int test_level_order_iterator_copies() {
+    BasicTree tree;
+    build_tree(tree, STANDARD_TEST_TREE_STRING);
+    int fails = 0;
+    auto ndi = tree.level_order_begin();
+    ++ndi;
+    auto ndi_copy = ndi;
+    std::string visits;
+    for (; ndi != tree.level_order_end(); ++ndi) {
+        visits += *ndi;
+    }
+    std::string copy_visits;
+    for (; ndi_copy != tree.level_order_end(); ndi_copy++) {
+        copy_visits += *ndi_copy;
+    }
+    fails += platypus::testing::compare_equal(std::string("bciegfjklmnhop"), visits, __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(visits, copy_visits, __FILE__, __LINE__);
+    return fails;
+}
+
+int test_level_order_nodes_reuse() {
+    BasicTree tree;
+    build_tree(tree, STANDARD_TEST_TREE_STRING);
+    int fails = 0;
+    std::vector<BasicTree::node_type *> nodes;
+    tree.level_order_nodes(nodes, true, false);
+    std::string visits;
+    for (auto nd : nodes) {
+        visits += nd->value();
+    }
+    fails += platypus::testing::compare_equal(std::string("abcegfh"), visits, __FILE__, __LINE__);
+    tree.level_order_nodes(nodes, false, true);
+    visits.clear();
+    for (auto nd : nodes) {
+        visits += nd->value();
+    }
+    fails += platypus::testing::compare_equal(std::string("pohnmlkjfgeicba"), visits, __FILE__, __LINE__);
+    return fails;
+}
+
 int main() {
     int fails = 0;
     fails += test_level_order_iterator();
     fails += test_level_order_rev_iterator();
     fails += test_level_order_internal_iterator();
     fails += test_level_order_rev_internal_iterator();
+    fails += test_level_order_breadth_first();
+    fails += test_level_order_iterator_copies();
+    fails += test_level_order_nodes_reuse();
     if (fails == 0) {
         return EXIT_SUCCESS;
     } else {
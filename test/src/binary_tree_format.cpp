@@ -0,0 +1,168 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <platypus/model/standardinterface.hpp>
+#include <platypus/model/taxonnamespace.hpp>
+#include <platypus/parse/binary.hpp>
+#include <platypus/parse/newick.hpp>
+#include <platypus/serialize/binary.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+std::string write_binary(const std::vector<TestDataTree> & trees, bool single_precision=false) {
+    platypus::BinaryTreeWriter<TestDataTree> writer;
+    platypus::bind_standard_interface(writer);
+    writer.set_single_precision_edge_lengths(single_precision);
+    writer.set_output_block_size(64);
+    std::ostringstream out;
+    writer.write(out, trees.begin(), trees.end());
+    return out.str();
+}
+
+int main() {
+    int fails = 0;
+
+    std::ostringstream o;
+    unsigned long num_trees = 30;
+    for (unsigned long i = 0; i < num_trees; ++i) {
+        if (i % 3 == 0) {
+            o << "[&R] ((a:1, 'b c':2)0.9" << i << ":3, (d:4, (e:5, f:0.125)0.5:7):8);\n";
+        } else if (i % 3 == 1) {
+            o << "[&U] (((f:1, e:2):3, d:4)g:5, ('b c':6, a:" << i << "):8);\n";
+        } else {
+            o << "[&R] (a, (b, c, d, (e, f)), g:1e-5)h;\n";
+        }
+    }
+    auto newick_trees = get_test_data_tree_vector_from_string<TestDataTree>(o.str());
+    auto newick_writer = get_standard_newick_writer<TestDataTree>();
+    newick_writer.set_edge_length_precision(10);
+    std::string expected = newick_writer.format(newick_trees.begin(), newick_trees.end());
+
+    std::string binary = write_binary(newick_trees);
+    platypus::BinaryTreeReader<TestDataTree> reader;
+    platypus::bind_standard_interface(reader);
+    std::vector<TestDataTree> trees;
+    auto tree_factory = [&trees]() -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+    std::vector<unsigned long> postprocessed_tips;
+    reader.set_tree_postprocess_fn([&postprocessed_tips](TestDataTree &, unsigned long, unsigned long tips, unsigned long, double) {
+        postprocessed_tips.push_back(tips);
+    });
+
+    // round trip, from buffer and stream
+    for (int mode = 0; mode < 2; ++mode) {
+        trees.clear();
+        postprocessed_tips.clear();
+        if (mode == 0) {
+            reader.read_buffer(binary, tree_factory);
+        } else {
+            reader.read(std::istringstream(binary), tree_factory);
+        }
+        fails += platypus::testing::compare_equal(expected, newick_writer.format(trees.begin(), trees.end()), __FILE__, __LINE__, mode == 0 ? "buffer" : "stream");
+        fails += platypus::testing::compare_equal(num_trees, postprocessed_tips.size(), __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(5UL, postprocessed_tips[0], __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(7UL, postprocessed_tips[2], __FILE__, __LINE__);
+    }
+
+    // from file
+    std::string path = "binary_tree_format.tmp";
+    {
+        std::ofstream f(path, std::ios::out | std::ios::binary);
+        f.write(binary.data(), binary.size());
+    }
+    trees.clear();
+    reader.read_file(path, tree_factory);
+    std::remove(path.c_str());
+    fails += platypus::testing::compare_equal(expected, newick_writer.format(trees.begin(), trees.end()), __FILE__, __LINE__, "file");
+
+    // labels are pooled
+    platypus::BinaryTreeArchive archive(binary.data(), binary.size());
+    fails += platypus::testing::compare_equal(num_trees, archive.num_trees(), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(true, archive.num_labels() < 30, __FILE__, __LINE__);
+
+    // random access
+    for (std::size_t tree_idx : {29, 0, 14, 2}) {
+        TestDataTree tree;
+        reader.read_tree(archive, tree_idx, tree);
+        fails += platypus::testing::compare_equal(newick_writer.format(newick_trees[tree_idx]), newick_writer.format(tree), __FILE__, __LINE__, "random access");
+    }
+
+    // skipping and thinning
+    reader.set_skip_first(10);
+    reader.set_every_nth(5);
+    trees.clear();
+    fails += platypus::testing::compare_equal(3UL, reader.read_buffer(binary, tree_factory, 3), __FILE__, __LINE__);
+    for (std::size_t idx = 0; idx < trees.size(); ++idx) {
+        fails += platypus::testing::compare_equal(newick_writer.format(newick_trees[10 + 5 * idx]), newick_writer.format(trees[idx]), __FILE__, __LINE__, "thinned");
+    }
+    reader.set_skip_first(0);
+    reader.set_every_nth(1);
+
+    // single-precision edge lengths
+    std::string compact = write_binary(newick_trees, true);
+    fails += platypus::testing::compare_equal(true, compact.size() < binary.size(), __FILE__, __LINE__);
+    trees.clear();
+    reader.read_buffer(compact, tree_factory);
+    double max_error = 0.0;
+    for (std::size_t idx = 0; idx < num_trees; ++idx) {
+        auto ndi2 = trees[idx].preorder_begin();
+        for (auto ndi1 = newick_trees[idx].preorder_begin(); ndi1 != newick_trees[idx].preorder_end(); ++ndi1, ++ndi2) {
+            max_error = std::max(max_error, std::fabs(ndi1->get_edge_length() - ndi2->get_edge_length()));
+        }
+    }
+    fails += platypus::testing::compare_equal(true, max_error < 1e-6, __FILE__, __LINE__, "single precision");
+
+    // taxon namespace
+    {
+        platypus::TaxonNamespace taxon_namespace;
+        platypus::BinaryTreeReader<TaxonTree> taxon_reader;
+        platypus::bind_standard_interface(taxon_reader);
+        platypus::bind_taxon_namespace(taxon_reader, taxon_namespace);
+        std::vector<TaxonTree> taxon_trees;
+        taxon_reader.read_buffer(binary, [&taxon_trees]() -> TaxonTree & { taxon_trees.emplace_back(); return taxon_trees.back(); });
+        std::vector<std::string> expected_labels{"a", "b c", "d", "e", "f", "b", "c", "g"};
+        fails += platypus::testing::compare_equal(expected_labels.size(), static_cast<std::size_t>(taxon_namespace.size()), __FILE__, __LINE__);
+        platypus::NewickWriter<TaxonTree> taxon_writer;
+        platypus::bind_standard_interface(taxon_writer);
+        platypus::bind_taxon_namespace(taxon_writer, taxon_namespace);
+        taxon_writer.set_edge_length_precision(10);
+        fails += platypus::testing::compare_equal(expected, taxon_writer.format(taxon_trees.begin(), taxon_trees.end()), __FILE__, __LINE__, "taxa");
+    }
+
+    // single tree, and an empty container
+    {
+        platypus::BinaryTreeWriter<TestDataTree> writer;
+        platypus::bind_standard_interface(writer);
+        std::ostringstream out;
+        writer.write(out, newick_trees[1]);
+        trees.clear();
+        reader.read_buffer(out.str(), tree_factory);
+        fails += platypus::testing::compare_equal(1UL, trees.size(), __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(newick_writer.format(newick_trees[1]), newick_writer.format(trees[0]), __FILE__, __LINE__);
+        std::vector<TestDataTree> none;
+        std::string empty = write_binary(none);
+        trees.clear();
+        fails += platypus::testing::compare_equal(0UL, reader.read_buffer(empty, tree_factory), __FILE__, __LINE__);
+    }
+
+    // malformed containers
+    std::string corrupt_counts = binary;
+    corrupt_counts[8 + 5] = static_cast<char>(99);
+    for (const std::string & bad : {std::string("(a,b);"), binary.substr(0, binary.size() - 1), binary.substr(1), corrupt_counts}) {
+        bool caught = false;
+        try {
+            trees.clear();
+            reader.read_buffer(bad, tree_factory);
+        } catch (const platypus::BinaryTreeReaderError &) {
+            caught = true;
+        }
+        fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "malformed");
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
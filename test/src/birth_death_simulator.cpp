@@ -0,0 +1,191 @@
+#include <cmath>
+#include <set>
+#include <unordered_map>
+#include <platypus/model/birthdeath.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::birthdeath::BirthDeathTreeSimulator<TestDataTree> SimulatorType;
+typedef platypus::birthdeath::BirthDeathParameters Parameters;
+
+// Checks that the tree is strictly bifurcating with `num_tips` distinctly
+// labelled tips and that all tips are at the same distance from the root;
+// returns that distance in `height`.
+int check_tree(const TestDataTree & tree, unsigned long num_tips, double & height, const std::string & remarks) {
+    int fails = 0;
+    std::unordered_map<TestDataTree::node_type *, double> dist_from_root;
+    std::set<std::string> labels;
+    unsigned long num_internal = 0;
+    double min_height = -1.0;
+    double max_height = -1.0;
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        double d = 0.0;
+        if (ndi.parent_node() != nullptr) {
+            d = dist_from_root[ndi.parent_node()] + ndi->get_edge_length();
+            if (ndi->get_edge_length() < 0.0) {
+                fails += 1;
+            }
+        }
+        dist_from_root[ndi.node()] = d;
+        if (ndi.is_leaf()) {
+            labels.insert(ndi->get_label());
+            if (min_height < 0 || d < min_height) {
+                min_height = d;
+            }
+            if (max_height < 0 || d > max_height) {
+                max_height = d;
+            }
+        } else {
+            ++num_internal;
+            unsigned long num_children = 0;
+            for (auto chi = tree.children_begin(ndi); chi != tree.children_end(ndi); ++chi) {
+                ++num_children;
+            }
+            fails += platypus::testing::compare_equal(2UL, num_children, __FILE__, __LINE__, remarks);
+        }
+    }
+    fails += platypus::testing::compare_equal(num_tips, static_cast<unsigned long>(labels.size()), __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(num_tips - 1, num_internal, __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(true, std::fabs(max_height - min_height) <= 1e-8 * max_height, __FILE__, __LINE__, remarks, ": not ultrametric");
+    height = max_height;
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    std::vector<TestDataTree> trees;
+    auto tree_factory = [&trees] () -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+    auto is_rooted_f = [] (TestDataTree & tree, bool is_rooted) { tree.set_is_rooted(is_rooted); };
+    auto node_label_f = [] (TestData & nd, const std::string & label) { nd.set_label(label); };
+    auto node_edge_f = [] (TestData & nd, double len) { nd.set_edge_length(len); };
+    platypus::numeric::RandomNumberGenerator rng(42);
+    SimulatorType sim(rng, tree_factory, is_rooted_f, node_label_f, node_edge_f);
+
+    // tree shape, under different processes and conditions
+    double height = 0.0;
+    std::vector<Parameters> processes = {
+        Parameters(1.0),
+        Parameters(2.0, 1.5, 0.1),
+        Parameters(1.0, 1.0, 0.5, 3.0, Parameters::AgeCondition::Crown),
+        Parameters(1.0, 2.0, 1.0, 3.0, Parameters::AgeCondition::Stem) };
+    for (auto & params : processes) {
+        for (unsigned long num_tips : {2UL, 3UL, 10UL, 20000UL}) {
+            trees.clear();
+            auto & tree = sim.generate_tree(num_tips, params);
+            fails += check_tree(tree, num_tips, height, "shape");
+            fails += platypus::testing::compare_equal(true, tree.is_rooted(), __FILE__, __LINE__);
+            double root_edge = tree.head_node()->value().get_edge_length();
+            if (params.age_condition == Parameters::AgeCondition::Crown) {
+                fails += platypus::testing::compare_equal(true, std::fabs(height - params.age) < 1e-9, __FILE__, __LINE__, "crown age: ", height);
+                fails += platypus::testing::compare_equal(0.0, root_edge, __FILE__, __LINE__);
+            } else if (params.age_condition == Parameters::AgeCondition::Stem) {
+                fails += platypus::testing::compare_equal(true, height < params.age, __FILE__, __LINE__, "crown age: ", height);
+                fails += platypus::testing::compare_equal(true, std::fabs(height + root_edge - params.age) < 1e-9, __FILE__, __LINE__, "stem age: ", height + root_edge);
+            }
+        }
+    }
+
+    // Yule trees conditioned only on the number of tips: the crown age is
+    // the maximum of n - 1 independent unit exponential node depths, with
+    // expectation equal to the (n - 1)-th harmonic number; and four-tip
+    // trees are balanced with probability 1/3
+    {
+        const unsigned long num_reps = 4000;
+        double sum_crown_age = 0.0;
+        unsigned long num_balanced = 0;
+        for (unsigned long rep = 0; rep < num_reps; ++rep) {
+            trees.clear();
+            auto & tree = sim.generate_tree(10, Parameters(1.0));
+            fails += check_tree(tree, 10, height, "yule");
+            sum_crown_age += height;
+            trees.clear();
+            auto & tree4 = sim.generate_tree(4, Parameters(1.0));
+            bool is_balanced = true;
+            for (auto chi = tree4.children_begin(tree4.head_node()); chi != tree4.children_end(tree4.head_node()); ++chi) {
+                if (chi.is_leaf()) {
+                    is_balanced = false;
+                }
+            }
+            num_balanced += is_balanced ? 1 : 0;
+        }
+        double harmonic = 0.0;
+        for (int i = 1; i <= 9; ++i) {
+            harmonic += 1.0 / i;
+        }
+        double mean_crown_age = sum_crown_age / num_reps;
+        fails += platypus::testing::compare_equal(true, std::fabs(mean_crown_age - harmonic) < 0.1, __FILE__, __LINE__, "mean crown age: ", mean_crown_age);
+        double balanced_fraction = static_cast<double>(num_balanced) / num_reps;
+        fails += platypus::testing::compare_equal(true, std::fabs(balanced_fraction - 1.0 / 3.0) < 0.03, __FILE__, __LINE__, "balanced: ", balanced_fraction);
+    }
+
+    // node depths: sampled by inversion of the coalescent point process
+    {
+        Parameters params(2.0, 1.0, 0.25);
+        for (double t : {0.1, 1.0, 4.0}) {
+            double y = platypus::birthdeath::node_depth_inverse_tail(params, t);
+            fails += platypus::testing::compare_equal(true, std::fabs(platypus::birthdeath::node_depth_from_inverse_tail(params, y) - t) < 1e-12, __FILE__, __LINE__);
+        }
+        // P(H > 1) = 1 / F(1)
+        unsigned long num_deeper = 0;
+        const unsigned long num_reps = 20000;
+        for (unsigned long rep = 0; rep < num_reps; ++rep) {
+            double h = platypus::birthdeath::random_node_depth(rng, params);
+            num_deeper += h > 1.0 ? 1 : 0;
+            double truncated = platypus::birthdeath::random_node_depth(rng, params, 0.5);
+            if (truncated >= 0.5 || truncated < 0.0) {
+                fails += platypus::testing::compare_equal(true, false, __FILE__, __LINE__, "truncated depth: ", truncated);
+                break;
+            }
+        }
+        double expected = 1.0 / platypus::birthdeath::node_depth_inverse_tail(params, 1.0);
+        double observed = static_cast<double>(num_deeper) / num_reps;
+        fails += platypus::testing::compare_equal(true, std::fabs(observed - expected) < 0.015, __FILE__, __LINE__, "P(H > 1): ", observed, " vs ", expected);
+    }
+
+    // invalid parameters
+    for (auto & params : {Parameters(0.0), Parameters(1.0, 2.0), Parameters(1.0, 0.0, 0.0), Parameters(1.0, 0.0, 1.0, 0.0, Parameters::AgeCondition::Crown)}) {
+        bool caught = false;
+        try {
+            sim.generate_tree(5, params);
+        } catch (const std::logic_error & e) {
+            caught = true;
+        }
+        fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__);
+    }
+
+    // batch generation: reproducible given the master seed, regardless of
+    // the number of threads, and by shards
+    {
+        auto writer = get_standard_newick_writer<TestDataTree>();
+        Parameters params(1.0, 0.5, 0.5, 10.0, Parameters::AgeCondition::Crown);
+        std::vector<std::string> expected;
+        for (unsigned int num_threads : {1u, 3u, 8u}) {
+            std::vector<std::string> observed;
+            unsigned long count = sim.generate_batch(100, 50, params, num_threads,
+                    [&] (TestDataTree & tree, unsigned long idx) {
+                        fails += check_tree(tree, 50, height, "batch");
+                        fails += platypus::testing::compare_equal(static_cast<unsigned long>(observed.size()), idx, __FILE__, __LINE__);
+                        observed.push_back(writer.format(tree));
+                    },
+                    12345);
+            fails += platypus::testing::compare_equal(100UL, count, __FILE__, __LINE__);
+            if (expected.empty()) {
+                expected = observed;
+            } else {
+                fails += platypus::testing::compare_equal(expected, observed, __FILE__, __LINE__, "threads: ", num_threads);
+            }
+        }
+        fails += platypus::testing::compare_equal(true, expected[0] != expected[1], __FILE__, __LINE__);
+        std::vector<std::string> shard;
+        sim.generate_batch_range(40, 60, 50, params, 2, [&] (TestDataTree & tree, unsigned long) { shard.push_back(writer.format(tree)); }, 12345);
+        fails += platypus::testing::compare_equal(std::vector<std::string>(expected.begin() + 40, expected.begin() + 60), shard, __FILE__, __LINE__);
+    }
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,172 @@
+#include <stdlib.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <platypus/model/charactermatrix.hpp>
+#include "platypus_testing.hpp"
+
+int check_alphabets() {
+    int fails = 0;
+    auto dna = platypus::CharacterStateAlphabet::dna();
+    fails += platypus::testing::compare_equal(4UL, static_cast<unsigned long>(dna.num_states()), __FILE__, __LINE__, "DNA states");
+    fails += platypus::testing::compare_equal(1U, dna.get_state_set('A'), __FILE__, __LINE__, "A");
+    fails += platypus::testing::compare_equal(8U, dna.get_state_set('t'), __FILE__, __LINE__, "t");
+    fails += platypus::testing::compare_equal(8U, dna.get_state_set('U'), __FILE__, __LINE__, "U");
+    fails += platypus::testing::compare_equal(5U, dna.get_state_set('R'), __FILE__, __LINE__, "R");
+    fails += platypus::testing::compare_equal(10U, dna.get_state_set('y'), __FILE__, __LINE__, "y");
+    fails += platypus::testing::compare_equal(15U, dna.get_state_set('N'), __FILE__, __LINE__, "N");
+    fails += platypus::testing::compare_equal(15U, dna.get_state_set('-'), __FILE__, __LINE__, "gap");
+    fails += platypus::testing::compare_equal(15U, dna.get_state_set('?'), __FILE__, __LINE__, "missing");
+    fails += platypus::testing::compare_equal(false, dna.is_valid_symbol('X'), __FILE__, __LINE__, "X is not DNA");
+    bool caught = false;
+    try {
+        dna.get_state_set('!');
+    } catch (const platypus::CharacterMatrixError &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "invalid symbol not rejected");
+
+    auto protein = platypus::CharacterStateAlphabet::protein();
+    fails += platypus::testing::compare_equal(20UL, static_cast<unsigned long>(protein.num_states()), __FILE__, __LINE__, "protein states");
+    fails += platypus::testing::compare_equal(
+            protein.get_state_set('D') | protein.get_state_set('N'),
+            protein.get_state_set('B'),
+            __FILE__, __LINE__, "B");
+    fails += platypus::testing::compare_equal(0xFFFFFU, protein.get_state_set('X'), __FILE__, __LINE__, "X");
+
+    auto standard = platypus::CharacterStateAlphabet::standard("01");
+    fails += platypus::testing::compare_equal(3U, standard.get_state_set('?'), __FILE__, __LINE__, "standard missing");
+    return fails;
+}
+
+int check_matrix() {
+    int fails = 0;
+    platypus::TaxonNamespace taxa;
+    taxa.add_taxon("z");
+    platypus::NucleotideCharacterMatrix matrix(platypus::CharacterStateAlphabet::dna(), &taxa);
+    matrix.add_sequence("a", "ACGTN-");
+    matrix.add_sequence("b", "acgtRY");
+    matrix.add_sequence("z", "??????");
+    for (int i = 0; i < 10; ++i) {
+        matrix.add_sequence("t" + std::to_string(i), "AAAAAA");
+    }
+    fails += platypus::testing::compare_equal(13UL, static_cast<unsigned long>(matrix.num_taxa()), __FILE__, __LINE__, "number of taxa");
+    fails += platypus::testing::compare_equal(6UL, static_cast<unsigned long>(matrix.num_sites()), __FILE__, __LINE__, "number of sites");
+    fails += platypus::testing::compare_equal(64UL, static_cast<unsigned long>(matrix.row_stride()), __FILE__, __LINE__, "row stride");
+    fails += platypus::testing::compare_equal(13UL, static_cast<unsigned long>(taxa.size()), __FILE__, __LINE__, "taxa added to namespace");
+    fails += platypus::testing::compare_equal(2UL, static_cast<unsigned long>(matrix.find_row(0)), __FILE__, __LINE__, "row of existing taxon");
+    fails += platypus::testing::compare_equal(std::string("b"), matrix.get_taxon_label(1), __FILE__, __LINE__, "taxon label");
+    std::size_t row_b = matrix.find_row(taxa.find_taxon("b"));
+    std::string expected_b{1, 2, 4, 8, 5, 10};
+    for (std::size_t site = 0; site < 6; ++site) {
+        fails += platypus::testing::compare_equal(static_cast<unsigned>(expected_b[site]), static_cast<unsigned>(matrix.get_state_set(row_b, site)), __FILE__, __LINE__, "state set at site ", site);
+    }
+    for (std::size_t row = 0; row < matrix.num_taxa(); ++row) {
+        fails += platypus::testing::compare_equal(true, reinterpret_cast<std::uintptr_t>(matrix.row(row)) % 64 == 0, __FILE__, __LINE__, "row not aligned: ", row);
+        for (std::size_t site = matrix.num_sites(); site < matrix.row_stride(); ++site) {
+            if (matrix.get_state_set(row, site) != 15) {
+                fails += platypus::testing::fail_test(__FILE__, __LINE__, 15, static_cast<unsigned>(matrix.get_state_set(row, site)), "padding is not the set of all states");
+                break;
+            }
+        }
+    }
+
+    bool caught = false;
+    try {
+        matrix.add_sequence("c", "ACG");
+    } catch (const platypus::CharacterMatrixError &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "wrong number of sites not rejected");
+    caught = false;
+    try {
+        matrix.add_sequence("a", "ACGTAC");
+    } catch (const platypus::CharacterMatrixError &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "duplicate taxon not rejected");
+    caught = false;
+    try {
+        platypus::NucleotideCharacterMatrix protein_matrix(platypus::CharacterStateAlphabet::protein());
+    } catch (const platypus::CharacterMatrixError &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "too many states for state set type not rejected");
+
+    // wide state sets, with an owned namespace
+    platypus::CharacterMatrix protein_matrix(platypus::CharacterStateAlphabet::protein());
+    protein_matrix.add_sequence("p", std::string(20, 'W'));
+    fails += platypus::testing::compare_equal(32UL, static_cast<unsigned long>(protein_matrix.row_stride()), __FILE__, __LINE__, "wide row stride");
+    fails += platypus::testing::compare_equal(1UL << 18, static_cast<unsigned long>(protein_matrix.get_state_set(0, 19)), __FILE__, __LINE__, "wide state set");
+    fails += platypus::testing::compare_equal(1UL, static_cast<unsigned long>(protein_matrix.taxon_namespace().size()), __FILE__, __LINE__, "owned namespace");
+    return fails;
+}
+
+int check_pattern_compression() {
+    int fails = 0;
+    platypus::NucleotideCharacterMatrix matrix(platypus::CharacterStateAlphabet::dna());
+    // sites 0, 2, 5 share a pattern, as do 1 and 4; 3 and 6 are unique
+    //                   0123456
+    matrix.add_sequence("a", "ACATCAA");
+    matrix.add_sequence("b", "AGAGGAN");
+    matrix.add_sequence("c", "CTCTTCC");
+    std::size_t num_patterns = matrix.compress_patterns();
+    fails += platypus::testing::compare_equal(4UL, static_cast<unsigned long>(num_patterns), __FILE__, __LINE__, "number of patterns");
+    fails += platypus::testing::compare_equal(4UL, static_cast<unsigned long>(matrix.num_sites()), __FILE__, __LINE__, "number of sites after compression");
+    fails += platypus::testing::compare_equal(7UL, static_cast<unsigned long>(matrix.num_original_sites()), __FILE__, __LINE__, "number of original sites");
+    fails += platypus::testing::compare_equal(true, matrix.is_compressed(), __FILE__, __LINE__, "compressed flag");
+    std::vector<std::uint32_t> expected_weights{3, 2, 1, 1};
+    fails += platypus::testing::compare_equal(expected_weights, matrix.pattern_weights(), __FILE__, __LINE__, "pattern weights");
+    std::vector<std::size_t> expected_site_patterns{0, 1, 0, 2, 1, 0, 3};
+    fails += platypus::testing::compare_equal(expected_site_patterns, matrix.site_patterns(), __FILE__, __LINE__, "site patterns");
+    // every original site is reproduced by its pattern
+    std::vector<std::string> sequences{"ACATCAA", "AGAGGAN", "CTCTTCC"};
+    auto alphabet = platypus::CharacterStateAlphabet::dna();
+    for (std::size_t row = 0; row < 3; ++row) {
+        for (std::size_t site = 0; site < 7; ++site) {
+            fails += platypus::testing::compare_equal(
+                    alphabet.get_state_set(sequences[row][site]),
+                    static_cast<std::uint32_t>(matrix.get_state_set(row, matrix.get_site_pattern(site))),
+                    __FILE__, __LINE__, "row ", row, " site ", site);
+        }
+        for (std::size_t site = matrix.num_sites(); site < matrix.row_stride(); ++site) {
+            fails += platypus::testing::compare_equal(15U, static_cast<unsigned>(matrix.get_state_set(row, site)), __FILE__, __LINE__, "padding after compression");
+        }
+    }
+    bool caught = false;
+    try {
+        matrix.add_sequence("d", "AAAA");
+    } catch (const platypus::CharacterMatrixError &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "row added to compressed matrix");
+
+    // many sites with few patterns
+    platypus::NucleotideCharacterMatrix large(platypus::CharacterStateAlphabet::dna());
+    std::string s1, s2;
+    for (int i = 0; i < 100000; ++i) {
+        s1 += "ACGT"[i % 4];
+        s2 += "ACGT"[(i / 4) % 4];
+    }
+    large.add_sequence("x", s1);
+    large.add_sequence("y", s2);
+    fails += platypus::testing::compare_equal(16UL, static_cast<unsigned long>(large.compress_patterns()), __FILE__, __LINE__, "large number of patterns");
+    unsigned long total_weight = 0;
+    for (auto w : large.pattern_weights()) {
+        total_weight += w;
+    }
+    fails += platypus::testing::compare_equal(100000UL, total_weight, __FILE__, __LINE__, "total pattern weight");
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_alphabets();
+    fails += check_matrix();
+    fails += check_pattern_compression();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
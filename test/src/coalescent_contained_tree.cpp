@@ -0,0 +1,148 @@
+#include <cmath>
+#include <set>
+#include <unordered_map>
+#include <platypus/model/coalescent.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::coalescent::BasicCoalescentSimulator<TestDataTree> SimulatorType;
+
+// For each node of the gene tree, the set of species from which the genes
+// descending from it were sampled (given by the prefix of the gene labels
+// before the '.'); also checks that tips are equidistant from the root.
+int check_gene_tree(const TestDataTree & tree,
+        unsigned long num_genes,
+        std::set<std::string> & clades,
+        double & height,
+        const std::string & remarks) {
+    int fails = 0;
+    std::unordered_map<TestDataTree::node_type *, std::set<std::string>> species;
+    std::unordered_map<TestDataTree::node_type *, double> dist_from_root;
+    double min_height = -1.0;
+    double max_height = -1.0;
+    unsigned long num_leaves = 0;
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        double d = 0.0;
+        if (ndi.parent_node() != nullptr) {
+            d = dist_from_root[ndi.parent_node()] + ndi->get_edge_length();
+        }
+        dist_from_root[ndi.node()] = d;
+        if (ndi.is_leaf()) {
+            ++num_leaves;
+            if (min_height < 0 || d < min_height) {
+                min_height = d;
+            }
+            if (max_height < 0 || d > max_height) {
+                max_height = d;
+            }
+        }
+    }
+    for (auto ndi = tree.postorder_begin(); ndi != tree.postorder_end(); ++ndi) {
+        if (ndi.is_leaf()) {
+            species[ndi.node()].insert(ndi->get_label().substr(0, ndi->get_label().find('.')));
+        } else {
+            unsigned long num_children = 0;
+            for (auto chi = tree.children_begin(ndi); chi != tree.children_end(ndi); ++chi) {
+                species[ndi.node()].insert(species[chi.node()].begin(), species[chi.node()].end());
+                ++num_children;
+            }
+            fails += platypus::testing::compare_equal(2UL, num_children, __FILE__, __LINE__, remarks);
+            std::string clade;
+            for (auto & sp : species[ndi.node()]) {
+                clade += sp;
+            }
+            clades.insert(clade);
+        }
+    }
+    fails += platypus::testing::compare_equal(num_genes, num_leaves, __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(true, std::fabs(max_height - min_height) <= 1e-8 * max_height, __FILE__, __LINE__, remarks, ": not ultrametric");
+    height = max_height;
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+
+    auto species_trees = get_test_data_tree_vector_from_string<TestDataTree>("((A:1,B:1)AB:1,C:2)ABC;");
+    auto & species_tree = species_trees[0];
+
+    std::vector<TestDataTree> trees;
+    auto tree_factory = [&trees] () -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+    auto is_rooted_f = [] (TestDataTree & tree, bool is_rooted) { tree.set_is_rooted(is_rooted); };
+    auto node_label_f = [] (TestData & nd, const std::string & label) { nd.set_label(label); };
+    auto node_edge_f = [] (TestData & nd, double len) { nd.set_edge_length(len); };
+    platypus::numeric::RandomNumberGenerator rng(1);
+    SimulatorType sim(rng, tree_factory, is_rooted_f, node_label_f, node_edge_f);
+
+    auto num_genes_f = [] (const TestData & nv) -> unsigned long { return nv.get_label() == "C" ? 2 : 3; };
+    auto edge_length_f = [] (const TestData & nv) { return nv.get_edge_length(); };
+    auto gene_label_f = [] (const TestData & nv, unsigned long idx) { return nv.get_label() + "." + std::to_string(idx); };
+
+    // tiny populations: genes coalesce within their own species, and gene
+    // tree matches species tree
+    for (int rep = 0; rep < 20; ++rep) {
+        trees.clear();
+        auto & tree = sim.generate_contained_tree(species_tree,
+                num_genes_f,
+                [] (const TestData &) { return 1e-6; },
+                edge_length_f,
+                gene_label_f);
+        std::set<std::string> clades;
+        double height = 0.0;
+        fails += check_gene_tree(tree, 8, clades, height, "small populations");
+        std::vector<std::string> expected_clades{"A", "AB", "ABC", "B", "C"};
+        fails += platypus::testing::compare_equal(expected_clades, std::vector<std::string>(clades.begin(), clades.end()), __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(true, height > 2.0 && height < 2.0001, __FILE__, __LINE__, "height: ", height);
+    }
+
+    // huge ancestral populations: no coalescence before the root of the
+    // species tree, so the gene tree is older than the species tree
+    {
+        trees.clear();
+        auto & tree = sim.generate_contained_tree(species_tree,
+                num_genes_f,
+                [] (const TestData & nv) { return nv.get_label() == "ABC" ? 1.0 : 1e9; },
+                edge_length_f,
+                gene_label_f,
+                true);
+        std::set<std::string> clades;
+        double height = 0.0;
+        fails += check_gene_tree(tree, 8, clades, height, "large populations");
+        // 8 lineages entering root population of size 1: 2 + 2(1 - 1/8)
+        fails += platypus::testing::compare_equal(true, std::fabs(height - (2.0 + 2.0 * (1.0 - 1.0 / 8.0))) < 1e-9, __FILE__, __LINE__, "height: ", height);
+    }
+
+    // single gene sampled in total: a tree of one node
+    {
+        trees.clear();
+        auto & tree = sim.generate_contained_tree(species_tree,
+                [] (const TestData & nv) -> unsigned long { return nv.get_label() == "A" ? 1 : 0; },
+                [] (const TestData &) { return 1.0; },
+                edge_length_f,
+                gene_label_f);
+        fails += platypus::testing::compare_equal(true, tree.head_node()->is_leaf(), __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(std::string("A.0"), tree.head_node()->value().get_label(), __FILE__, __LINE__);
+    }
+
+    // genes of one species coalesce below the root: that lineage becomes the
+    // root of the gene tree
+    {
+        trees.clear();
+        auto & tree = sim.generate_contained_tree(species_tree,
+                [] (const TestData & nv) -> unsigned long { return nv.get_label() == "A" ? 4 : 0; },
+                [] (const TestData &) { return 1e-6; },
+                edge_length_f,
+                gene_label_f);
+        std::set<std::string> clades;
+        double height = 0.0;
+        fails += check_gene_tree(tree, 4, clades, height, "single species");
+        fails += platypus::testing::compare_equal(true, height < 0.001, __FILE__, __LINE__, "height: ", height);
+    }
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
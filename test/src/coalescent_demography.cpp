@@ -0,0 +1,138 @@
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <platypus/model/coalescent.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::coalescent::BasicCoalescentSimulator<TestDataTree> SimulatorType;
+typedef platypus::coalescent::Demography Demography;
+
+int check_demography() {
+    int fails = 0;
+    {
+        Demography demography(4.0);
+        fails += platypus::testing::compare_equal(true, demography.is_constant(), __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(4.0, demography.get_pop_size(10.0), __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(2.0, demography.get_waiting_time(3.0, 0.5), __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(0.5, demography.get_scaled_time(3.0, 5.0), __FILE__, __LINE__);
+    }
+    {
+        Demography demography = Demography::piecewise_constant({0.0, 1.0, 3.0}, {1.0, 2.0, 0.5});
+        fails += platypus::testing::compare_equal(false, demography.is_constant(), __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(2.0, demography.get_pop_size(1.0), __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(0.5, demography.get_pop_size(100.0), __FILE__, __LINE__);
+        // 1 up to time 1, then 1 more over the 2 units of the second epoch, then 1 in half a unit
+        fails += platypus::testing::compare_equal(3.0, demography.get_scaled_time(0.0, 3.5), __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(3.5, demography.get_waiting_time(0.0, 3.0), __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(2.5, demography.get_waiting_time(1.0, 2.0), __FILE__, __LINE__);
+    }
+    {
+        Demography demography(2.0, 1.5);
+        demography.add_epoch(2.0, 0.25, -0.5);
+        fails += platypus::testing::compare_equal(true, std::fabs(2.0 * std::exp(-1.5) - demography.get_pop_size(1.0)) < 1e-12, __FILE__, __LINE__);
+        for (double t0 : {0.0, 0.7, 1.9, 2.0, 4.0}) {
+            for (double scaled_time : {1e-6, 0.1, 1.0, 3.0, 7.0}) {
+                double w = demography.get_waiting_time(t0, scaled_time);
+                if (std::isinf(w)) {
+                    // the integrated rate converges going back in time
+                    fails += platypus::testing::compare_equal(true, demography.get_scaled_time(t0, t0 + 1e3) < scaled_time, __FILE__, __LINE__,
+                            "t0: ", t0, ", scaled time: ", scaled_time);
+                    continue;
+                }
+                double observed = demography.get_scaled_time(t0, t0 + w);
+                fails += platypus::testing::compare_equal(true, std::fabs(scaled_time - observed) < 1e-9 * (1 + scaled_time), __FILE__, __LINE__,
+                        "t0: ", t0, ", scaled time: ", scaled_time, ", observed: ", observed);
+            }
+        }
+        fails += platypus::testing::compare_equal(true, std::isinf(demography.get_waiting_time(0.0, 100.0)), __FILE__, __LINE__);
+    }
+    auto check_throws = [&fails] (std::function<void ()> fn, int line) {
+        try {
+            fn();
+            fails += platypus::testing::fail_test(__FILE__, line, "std::invalid_argument", "no exception");
+        } catch (const std::invalid_argument &) {
+        }
+    };
+    check_throws([] () { Demography demography(0.0); }, __LINE__);
+    check_throws([] () { Demography demography(1.0); demography.add_epoch(0.0, 2.0); }, __LINE__);
+    check_throws([] () { Demography demography(1.0); demography.add_epoch(1.0, -2.0); }, __LINE__);
+    check_throws([] () { Demography::piecewise_constant({0.0, 1.0}, {1.0}); }, __LINE__);
+    check_throws([] () { Demography::piecewise_constant({1.0}, {1.0}); }, __LINE__);
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_demography();
+
+    std::vector<TestDataTree> trees;
+    auto tree_factory = [&trees] () -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+    auto is_rooted_f = [] (TestDataTree & tree, bool is_rooted) { tree.set_is_rooted(is_rooted); };
+    auto node_label_f = [] (TestData & nd, const std::string & label) { nd.set_label(label); };
+    auto node_edge_f = [] (TestData & nd, double len) { nd.set_edge_length(len); };
+    platypus::numeric::RandomNumberGenerator rng(42);
+    SimulatorType sim(rng, tree_factory, is_rooted_f, node_label_f, node_edge_f);
+    auto writer = get_standard_newick_writer<TestDataTree>();
+
+    // a constant demography gives the trees of a fixed population size
+    {
+        std::vector<std::string> expected;
+        std::vector<std::string> observed;
+        sim.generate_batch(50, 12, 3.0, 2, [&] (TestDataTree & tree, unsigned long) { expected.push_back(writer.format(tree)); }, 99);
+        sim.generate_batch(50, 12, Demography(3.0), 3, [&] (TestDataTree & tree, unsigned long) { observed.push_back(writer.format(tree)); }, 99);
+        fails += platypus::testing::compare_equal(expected, observed, __FILE__, __LINE__, "constant demography");
+        // with expected waiting times, the trees differ only in the order of coalescence
+        std::string tree = writer.format(sim.generate_variable_pop_size_tree(5, Demography(2.0), true));
+        std::string fixed_tree = writer.format(sim.generate_fixed_pop_size_tree(5, 2.0, true));
+        fails += platypus::testing::compare_equal(fixed_tree.size(), tree.size(), __FILE__, __LINE__, "expected waiting times");
+    }
+
+    // mean time to coalescence of two lineages against its expectation,
+    // the integral of the probability of no coalescence by time t
+    {
+        std::vector<std::pair<std::string, Demography>> scenarios{
+            {"piecewise constant", Demography::piecewise_constant({0.0, 0.5, 2.0}, {1.0, 4.0, 0.5})},
+            {"exponential growth", Demography(1.0, 2.0)},
+            {"bottleneck", Demography(2.0, -1.0)},
+        };
+        scenarios[2].second.add_epoch(1.0, 0.2, 0.5);
+        for (auto & scenario : scenarios) {
+            const Demography & demography = scenario.second;
+            double expected = 0.0;
+            const double dt = 1e-4;
+            for (double t = 0.0; t < 50.0; t += dt) {
+                expected += dt * 0.5 * (std::exp(-demography.get_scaled_time(0.0, t)) + std::exp(-demography.get_scaled_time(0.0, t + dt)));
+            }
+            const unsigned long num_trees = 20000;
+            double sum = 0.0;
+            sim.generate_batch(num_trees, 2, demography, 4,
+                    [&] (TestDataTree & tree, unsigned long) { sum += tree.head_node()->first_child_node()->value().get_edge_length(); },
+                    12345);
+            double observed = sum / num_trees;
+            fails += platypus::testing::compare_equal(true, std::fabs(expected - observed) < 0.03 * expected, __FILE__, __LINE__,
+                    scenario.first, ": mean tmrca ", observed, ", expected ", expected);
+        }
+    }
+
+    // lineages that never coalesce
+    {
+        Demography demography(1.0, -20.0);
+        try {
+            for (int idx = 0; idx < 10; ++idx) {
+                sim.generate_variable_pop_size_tree(2, demography);
+            }
+            fails += platypus::testing::fail_test(__FILE__, __LINE__, "std::logic_error", "no exception");
+        } catch (const std::logic_error &) {
+        }
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
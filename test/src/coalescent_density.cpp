@@ -0,0 +1,147 @@
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <platypus/model/coalescent.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::coalescent::BasicCoalescentSimulator<TestDataTree> SimulatorType;
+typedef platypus::coalescent::CoalescentDensity<TestDataTree> DensityType;
+typedef platypus::coalescent::Demography Demography;
+
+int check_close(double expected, double observed, double tolerance, int line, const std::string & remarks) {
+    if (std::fabs(expected - observed) > tolerance * (1.0 + std::fabs(expected))) {
+        return platypus::testing::fail_test(__FILE__, line, expected, observed, remarks);
+    }
+    return 0;
+}
+
+int check_single_trees() {
+    int fails = 0;
+    DensityType density(get_edge_length);
+    {
+        // three lineages over [0, 1], two over [1, 3]
+        TestDataTree tree = read_tree("((a:1,b:1):2,c:3);");
+        fails += platypus::testing::compare_equal(2UL, static_cast<unsigned long>(density.compute_intervals(tree)), __FILE__, __LINE__, "coalescences");
+        fails += platypus::testing::compare_equal(std::vector<double>{1.0, 3.0}, density.coalescence_times(), __FILE__, __LINE__, "coalescence times");
+        fails += platypus::testing::compare_equal(std::vector<double>{3.0, 1.0}, density.interval_pairs(), __FILE__, __LINE__, "pairs");
+        for (double pop_size : {0.5, 2.0, 7.0}) {
+            double expected = -2.0 * std::log(pop_size) - 5.0 / pop_size;
+            fails += check_close(expected, density.get_log_density(pop_size), 1e-12, __LINE__, "constant population size");
+            fails += check_close(expected, density.get_log_density(Demography(pop_size)), 1e-12, __LINE__, "constant demography");
+        }
+        // size 1 up to time 2, then 4: 3 * 1 + 1 * (1 + 1 / 4) scaled, and
+        // the second coalescence in a population of 4
+        Demography demography = Demography::piecewise_constant({0.0, 2.0}, {1.0, 4.0});
+        fails += check_close(-4.25 - std::log(4.0), density.get_log_density(demography), 1e-12, __LINE__, "piecewise constant demography");
+    }
+    {
+        // a sampled a unit of time before b
+        TestDataTree tree = read_tree("(a:1,b:2);");
+        density.compute_intervals(tree);
+        fails += platypus::testing::compare_equal(std::vector<double>{1.0}, density.interval_starts(), __FILE__, __LINE__, "heterochronous interval start");
+        fails += check_close(-std::log(3.0) - 1.0 / 3.0, density.get_log_density(3.0), 1e-12, __LINE__, "heterochronous samples");
+    }
+    {
+        TestDataTree tree = read_tree("(a:1,b:1,c:1);");
+        density.compute_intervals(tree);
+        fails += platypus::testing::compare_equal(false, density.is_binary(), __FILE__, __LINE__, "polytomy not detected");
+        fails += platypus::testing::compare_equal(-std::numeric_limits<double>::infinity(), density.get_log_density(1.0), __FILE__, __LINE__, "polytomy");
+    }
+    return fails;
+}
+
+int check_batches() {
+    int fails = 0;
+    std::vector<TestDataTree> trees;
+    auto tree_factory = [&trees] () -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+    auto is_rooted_f = [] (TestDataTree & tree, bool is_rooted) { tree.set_is_rooted(is_rooted); };
+    auto node_label_f = [] (TestData & nd, const std::string & label) { nd.set_label(label); };
+    auto node_edge_f = [] (TestData & nd, double len) { nd.set_edge_length(len); };
+    platypus::numeric::RandomNumberGenerator rng(17);
+    SimulatorType sim(rng, tree_factory, is_rooted_f, node_label_f, node_edge_f);
+    const unsigned long num_trees = 2000;
+    const unsigned long num_leaves = 10;
+    Demography demography = Demography::piecewise_constant({0.0, 0.5, 3.0}, {1.0, 6.0, 0.5});
+    std::vector<TestDataTree> sampled_trees;
+    sim.generate_batch(num_trees, num_leaves, demography, 4,
+            [&] (TestDataTree & tree, unsigned long) { sampled_trees.push_back(std::move(tree)); }, 23);
+    trees.clear();
+    fails += platypus::testing::compare_equal(num_trees, static_cast<unsigned long>(sampled_trees.size()), __FILE__, __LINE__, "trees simulated");
+
+    DensityType density(get_edge_length);
+    std::vector<double> pop_sizes{0.5, 1.0, 2.0, 4.0};
+    std::vector<Demography> demographies{Demography(1.0), Demography(2.0), demography};
+    std::vector<double> single_pop_sizes;
+    std::vector<double> single_demographies;
+    for (auto & tree : sampled_trees) {
+        density.compute_intervals(tree);
+        for (double pop_size : pop_sizes) {
+            single_pop_sizes.push_back(density.get_log_density(pop_size));
+        }
+        for (auto & d : demographies) {
+            single_demographies.push_back(density.get_log_density(d));
+        }
+    }
+    for (unsigned int num_threads : {1U, 3U, 8U}) {
+        fails += platypus::testing::compare_equal(single_pop_sizes,
+                density.get_log_densities(sampled_trees.cbegin(), sampled_trees.cend(), pop_sizes, num_threads),
+                __FILE__, __LINE__, "population sizes, threads: ", num_threads);
+        fails += platypus::testing::compare_equal(single_demographies,
+                density.get_log_densities(sampled_trees.cbegin(), sampled_trees.cend(), demographies, num_threads),
+                __FILE__, __LINE__, "demographies, threads: ", num_threads);
+    }
+    fails += platypus::testing::compare_equal(0UL,
+            static_cast<unsigned long>(density.get_log_densities(sampled_trees.cbegin(), sampled_trees.cbegin(), pop_sizes, 4).size()),
+            __FILE__, __LINE__, "no trees");
+
+    // the demography the trees were simulated under fits them better than
+    // constant population sizes
+    double sum_true = 0.0;
+    double sum_constant_1 = 0.0;
+    double sum_constant_2 = 0.0;
+    for (unsigned long idx = 0; idx < num_trees; ++idx) {
+        sum_constant_1 += single_demographies[idx * 3];
+        sum_constant_2 += single_demographies[idx * 3 + 1];
+        sum_true += single_demographies[idx * 3 + 2];
+    }
+    fails += platypus::testing::compare_equal(true, sum_true > sum_constant_1 && sum_true > sum_constant_2, __FILE__, __LINE__,
+            "log densities: ", sum_true, ", ", sum_constant_1, ", ", sum_constant_2);
+
+    // under a constant population size, the maximum likelihood estimate of
+    // the size from each tree is unbiased
+    std::vector<TestDataTree> constant_trees;
+    sim.generate_batch(num_trees, num_leaves, 3.0, 4,
+            [&] (TestDataTree & tree, unsigned long) { constant_trees.push_back(std::move(tree)); }, 29);
+    trees.clear();
+    double sum_estimates = 0.0;
+    for (auto & tree : constant_trees) {
+        density.compute_intervals(tree);
+        double sum_scaled_pairs = 0.0;
+        for (std::size_t idx = 0; idx < density.interval_pairs().size(); ++idx) {
+            sum_scaled_pairs += density.interval_pairs()[idx] * (density.interval_ends()[idx] - density.interval_starts()[idx]);
+        }
+        double estimate = sum_scaled_pairs / static_cast<double>(density.num_coalescences());
+        sum_estimates += estimate;
+        double at_estimate = density.get_log_density(estimate);
+        if (!(at_estimate >= density.get_log_density(estimate * 1.01) && at_estimate >= density.get_log_density(estimate * 0.99))) {
+            fails += platypus::testing::fail_test(__FILE__, __LINE__, "maximum", "not maximum", "log density at estimate ", estimate);
+        }
+    }
+    double mean_estimate = sum_estimates / static_cast<double>(num_trees);
+    fails += platypus::testing::compare_equal(true, std::fabs(mean_estimate - 3.0) < 0.1, __FILE__, __LINE__, "mean estimate: ", mean_estimate);
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_single_trees();
+    fails += check_batches();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,226 @@
+#include <cmath>
+#include <unordered_map>
+#include <platypus/model/coalescent.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::coalescent::BasicCoalescentSimulator<TestDataTree> SimulatorType;
+
+// Checks that the tree is strictly bifurcating with `num_tips` tips and
+// that all tips are at the same distance from the root; returns that distance
+// in `height`.
+int check_coalescent_tree(const TestDataTree & tree, unsigned long num_tips, double & height, const std::string & remarks) {
+    int fails = 0;
+    std::unordered_map<TestDataTree::node_type *, double> dist_from_root;
+    unsigned long num_leaves = 0;
+    unsigned long num_internal = 0;
+    double min_height = -1.0;
+    double max_height = -1.0;
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        double d = 0.0;
+        if (ndi.parent_node() != nullptr) {
+            d = dist_from_root[ndi.parent_node()] + ndi->get_edge_length();
+            if (ndi->get_edge_length() < 0.0) {
+                fails += 1;
+            }
+        }
+        dist_from_root[ndi.node()] = d;
+        if (ndi.is_leaf()) {
+            ++num_leaves;
+            if (min_height < 0 || d < min_height) {
+                min_height = d;
+            }
+            if (max_height < 0 || d > max_height) {
+                max_height = d;
+            }
+        } else {
+            ++num_internal;
+            unsigned long num_children = 0;
+            for (auto chi = tree.children_begin(ndi); chi != tree.children_end(ndi); ++chi) {
+                ++num_children;
+            }
+            fails += platypus::testing::compare_equal(2UL, num_children, __FILE__, __LINE__, remarks);
+        }
+    }
+    fails += platypus::testing::compare_equal(num_tips, num_leaves, __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(num_tips - 1, num_internal, __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(true, std::fabs(max_height - min_height) <= 1e-8 * max_height, __FILE__, __LINE__, remarks, ": not ultrametric");
+    height = max_height;
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    std::vector<TestDataTree> trees;
+    auto tree_factory = [&trees] () -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+    auto is_rooted_f = [] (TestDataTree & tree, bool is_rooted) { tree.set_is_rooted(is_rooted); };
+    auto node_label_f = [] (TestData & nd, const std::string & label) { nd.set_label(label); };
+    auto node_edge_f = [] (TestData & nd, double len) { nd.set_edge_length(len); };
+    platypus::numeric::RandomNumberGenerator rng(42);
+    SimulatorType sim(rng, tree_factory, is_rooted_f, node_label_f, node_edge_f);
+
+    // random waiting times
+    double height = 0.0;
+    for (unsigned long num_tips : {2UL, 3UL, 10UL, 20000UL}) {
+        trees.clear();
+        auto & tree = sim.generate_fixed_pop_size_tree(num_tips, 1.0);
+        fails += check_coalescent_tree(tree, num_tips, height, "random waiting times");
+        fails += platypus::testing::compare_equal(true, tree.is_rooted(), __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(std::string("T"), tree.leaf_begin()->get_label().substr(0, 1), __FILE__, __LINE__);
+    }
+
+    // expected waiting times: height = sum_{k=2}^{n} N / C(k, 2) = 2N(1 - 1/n)
+    for (double pop_size : {1.0, 1000.0}) {
+        unsigned long num_tips = 500;
+        trees.clear();
+        auto & tree = sim.generate_fixed_pop_size_tree(num_tips, pop_size, true);
+        fails += check_coalescent_tree(tree, num_tips, height, "expected waiting times");
+        double expected_height = 2.0 * pop_size * (1.0 - 1.0 / num_tips);
+        fails += platypus::testing::compare_equal(true, std::fabs(height - expected_height) < 1e-9 * expected_height, __FILE__, __LINE__,
+                "population size: ", pop_size, ", expected height: ", expected_height, ", observed height: ", height);
+    }
+
+    // event-wise simulation: map-based and vector-based pools agree
+    {
+        unsigned long num_tips = 50;
+        TestDataTree tree1;
+        std::map<TestDataTree::node_type *, platypus::coalescent::CoalescentTimeValueType> nodes;
+        TestDataTree tree2;
+        SimulatorType::lineage_pool_type lineages;
+        for (unsigned long i = 0; i < num_tips; ++i) {
+            nodes[tree1.create_leaf_node()] = 0.0;
+            SimulatorType::Lineage lineage = {tree2.create_leaf_node(), 0.0};
+            lineages.push_back(lineage);
+        }
+        double time_expended = 0.0;
+        double current_time = 0.0;
+        double total_time1 = 0.0;
+        while (nodes.size() > 1) {
+            sim.simulate_basic_coalescent_event(tree1, nodes, time_expended, 10.0, 0.0, true);
+            total_time1 += time_expended;
+        }
+        while (lineages.size() > 1) {
+            sim.simulate_basic_coalescent_event(tree2, lineages, current_time, time_expended, 10.0, 0.0, true);
+        }
+        double height1 = 0.0;
+        double height2 = 0.0;
+        fails += check_coalescent_tree(tree1, num_tips, height1, "map-based events");
+        fails += check_coalescent_tree(tree2, num_tips, height2, "vector-based events");
+        fails += platypus::testing::compare_equal(true, std::fabs(height1 - height2) < 1e-9 * height1, __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(true, std::fabs(height2 - current_time) < 1e-9 * height2, __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(true, std::fabs(height1 - total_time1) < 1e-9 * height1, __FILE__, __LINE__);
+
+        // limited time available: no coalescence, clock advances
+        TestDataTree tree3;
+        lineages.clear();
+        for (unsigned long i = 0; i < 4; ++i) {
+            SimulatorType::Lineage lineage = {tree3.create_leaf_node(), 0.0};
+            lineages.push_back(lineage);
+        }
+        current_time = 0.0;
+        auto anc = sim.simulate_basic_coalescent_event(tree3, lineages, current_time, time_expended, 1.0, 1e-6, true);
+        fails += platypus::testing::compare_equal(true, anc == nullptr, __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(4UL, lineages.size(), __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(1e-6, current_time, __FILE__, __LINE__);
+    }
+
+    // batch generation: reproducible given the master seed, regardless of
+    // the number of threads
+    {
+        auto writer = get_standard_newick_writer<TestDataTree>();
+        std::vector<std::string> expected;
+        for (unsigned int num_threads : {1u, 3u, 8u}) {
+            std::vector<std::string> observed;
+            std::vector<unsigned long> indexes;
+            unsigned long count = sim.generate_batch(100, 20, 1.0, num_threads,
+                    [&] (TestDataTree & tree, unsigned long idx) {
+                        double height = 0.0;
+                        fails += check_coalescent_tree(tree, 20, height, "batch");
+                        observed.push_back(writer.format(tree));
+                        indexes.push_back(idx);
+                    },
+                    12345);
+            fails += platypus::testing::compare_equal(100UL, count, __FILE__, __LINE__);
+            for (unsigned long i = 0; i < indexes.size(); ++i) {
+                fails += platypus::testing::compare_equal(i, indexes[i], __FILE__, __LINE__);
+            }
+            if (expected.empty()) {
+                expected = observed;
+            } else {
+                fails += platypus::testing::compare_equal(expected, observed, __FILE__, __LINE__, "threads: ", num_threads);
+            }
+        }
+        // replicates differ from each other, and with the master seed
+        fails += platypus::testing::compare_equal(true, expected[0] != expected[1], __FILE__, __LINE__);
+        std::string other;
+        sim.generate_batch(1, 20, 1.0, 1, [&] (TestDataTree & tree, unsigned long) { other = writer.format(tree); }, 54321);
+        fails += platypus::testing::compare_equal(true, expected[0] != other, __FILE__, __LINE__);
+    }
+
+    // shards of a batch reproduce the corresponding replicates of the full
+    // batch, including with a counter-based generator
+    {
+        auto writer = get_standard_newick_writer<TestDataTree>();
+        platypus::numeric::CounterRandomNumberGenerator counter_rng(7);
+        platypus::coalescent::BasicCoalescentSimulator<TestDataTree, platypus::numeric::CounterRandomNumberGenerator> counter_sim(
+                counter_rng, tree_factory, is_rooted_f, node_label_f, node_edge_f);
+        std::vector<std::string> full;
+        std::vector<std::string> counter_full;
+        sim.generate_batch(40, 10, 1.0, 3, [&] (TestDataTree & tree, unsigned long) { full.push_back(writer.format(tree)); }, 2718);
+        counter_sim.generate_batch(40, 10, 1.0, 3, [&] (TestDataTree & tree, unsigned long) { counter_full.push_back(writer.format(tree)); }, 2718);
+        fails += platypus::testing::compare_equal(true, counter_full[0] != counter_full[1], __FILE__, __LINE__);
+        for (unsigned long shard_begin : {0UL, 13UL, 26UL}) {
+            unsigned long shard_end = shard_begin + 13 < 40 ? shard_begin + 13 : 40;
+            std::vector<unsigned long> indexes;
+            std::vector<std::string> shard;
+            std::vector<std::string> counter_shard;
+            unsigned long count = sim.generate_batch_range(shard_begin, shard_end, 10, 1.0, 2,
+                    [&] (TestDataTree & tree, unsigned long idx) { shard.push_back(writer.format(tree)); indexes.push_back(idx); },
+                    2718);
+            counter_sim.generate_batch_range(shard_begin, shard_end, 10, 1.0, 4,
+                    [&] (TestDataTree & tree, unsigned long) { counter_shard.push_back(writer.format(tree)); },
+                    2718);
+            fails += platypus::testing::compare_equal(shard_end - shard_begin, count, __FILE__, __LINE__);
+            fails += platypus::testing::compare_equal(shard_begin, indexes.front(), __FILE__, __LINE__);
+            fails += platypus::testing::compare_equal(
+                    std::vector<std::string>(full.begin() + shard_begin, full.begin() + shard_end),
+                    shard, __FILE__, __LINE__, "shard: ", shard_begin);
+            fails += platypus::testing::compare_equal(
+                    std::vector<std::string>(counter_full.begin() + shard_begin, counter_full.begin() + shard_end),
+                    counter_shard, __FILE__, __LINE__, "shard: ", shard_begin);
+        }
+    }
+
+    // buffered waiting times: trees do not depend on the block size
+    {
+        auto writer = get_standard_newick_writer<TestDataTree>();
+        std::vector<std::string> expected;
+        for (std::size_t block_size : {static_cast<std::size_t>(1), static_cast<std::size_t>(7), static_cast<std::size_t>(256)}) {
+            platypus::numeric::RandomNumberGenerator rng2(99);
+            SimulatorType sim2(rng2, tree_factory, is_rooted_f, node_label_f, node_edge_f);
+            sim2.set_buffered_waiting_times(314, block_size);
+            fails += platypus::testing::compare_equal(true, sim2.has_buffered_waiting_times(), __FILE__, __LINE__);
+            std::vector<std::string> observed;
+            for (int i = 0; i < 5; ++i) {
+                trees.clear();
+                auto & tree = sim2.generate_fixed_pop_size_tree(100, 1.0);
+                fails += check_coalescent_tree(tree, 100, height, "buffered waiting times");
+                observed.push_back(writer.format(tree));
+            }
+            sim2.generate_batch(10, 20, 1.0, 2, [&] (TestDataTree & tree, unsigned long) { observed.push_back(writer.format(tree)); }, 5);
+            if (expected.empty()) {
+                expected = observed;
+            } else {
+                fails += platypus::testing::compare_equal(expected, observed, __FILE__, __LINE__, "block size: ", block_size);
+            }
+        }
+    }
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,94 @@
+#include <stdlib.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <platypus/model/compactnodevalue.hpp>
+#include <platypus/parse/newick.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+typedef platypus::CompactNodeValue<> CompactValueType;
+typedef platypus::StandardTree<CompactValueType> CompactTreeType;
+
+static_assert(std::is_trivially_copyable<CompactValueType>::value, "compact node value is not trivially copyable");
+static_assert(!std::is_polymorphic<CompactValueType>::value, "compact node value is polymorphic");
+static_assert(sizeof(CompactValueType) == 24, "unexpected size of compact node value");
+static_assert(sizeof(CompactValueType) < sizeof(platypus::StandardNodeValue<>), "compact node value is not smaller");
+
+template <class ReaderT>
+std::vector<CompactTreeType> read_all(ReaderT & reader, const std::string & src) {
+    std::vector<CompactTreeType> trees;
+    reader.read(std::istringstream(src), [&trees]() -> CompactTreeType & { trees.emplace_back(); return trees.back(); });
+    return trees;
+}
+
+int main() {
+    int fails = 0;
+    const std::string src = "((a:1.5,'b c':2)c:3,(d:4,(e:5,f:0.25)g:6)hhhhhhhhhhhhhhh:7)i:0.5;\n"
+                            "(x:1,(y:2,z:3)yz:4);\n";
+    // as written from standard node values
+    typedef platypus::StandardTree<platypus::StandardNodeValue<>> StandardTreeType;
+    std::vector<StandardTreeType> standard_trees;
+    platypus::StandardNewickReader<StandardTreeType> standard_reader;
+    standard_reader.read(std::istringstream(src), [&standard_trees]() -> StandardTreeType & { standard_trees.emplace_back(); return standard_trees.back(); });
+    platypus::StandardNewickWriter<StandardTreeType> standard_writer;
+    standard_writer.set_compact_spaces(true);
+    standard_writer.set_suppress_rooting(true);
+    const std::string expected = standard_writer.format(standard_trees.begin(), standard_trees.end());
+
+    // run-time binding
+    platypus::NewickReader<CompactTreeType> function_reader;
+    platypus::bind_standard_interface(function_reader);
+    auto trees = read_all(function_reader, src);
+    platypus::NewickWriter<CompactTreeType> function_writer;
+    platypus::bind_standard_interface(function_writer);
+    function_writer.set_compact_spaces(true);
+    function_writer.set_suppress_rooting(true);
+    fails += platypus::testing::compare_equal(expected, function_writer.format(trees.begin(), trees.end()), __FILE__, __LINE__, "function setters and getters");
+
+    // compile-time binding
+    platypus::NewickReader<CompactTreeType, double, platypus::CompactNodeValueSetters> static_reader;
+    auto static_trees = read_all(static_reader, src);
+    platypus::StandardNewickWriter<CompactTreeType> static_writer;
+    static_writer.set_compact_spaces(true);
+    static_writer.set_suppress_rooting(true);
+    fails += platypus::testing::compare_equal(expected, static_writer.format(static_trees.begin(), static_trees.end()), __FILE__, __LINE__, "static setters and getters");
+
+    // copies of trees are independent
+    CompactTreeType copy(trees[1]);
+    copy.head_node()->first_child_node()->value().set_label("w");
+    fails += platypus::testing::compare_equal(std::string("x"), trees[1].head_node()->first_child_node()->value().get_label(), __FILE__, __LINE__, "copy");
+
+    // taxa
+    platypus::TaxonNamespace taxa;
+    platypus::NewickReader<CompactTreeType> taxon_reader;
+    platypus::bind_standard_interface(taxon_reader);
+    platypus::bind_taxon_namespace(taxon_reader, taxa);
+    auto taxon_trees = read_all(taxon_reader, "(a_taxon_label_longer_than_fifteen:1,b:2);");
+    const CompactValueType & leaf = taxon_trees[0].head_node()->first_child_node()->value();
+    fails += platypus::testing::compare_equal(true, leaf.has_taxon(), __FILE__, __LINE__, "leaf taxon");
+    platypus::NewickWriter<CompactTreeType> taxon_writer;
+    platypus::bind_standard_interface(taxon_writer);
+    platypus::bind_taxon_namespace(taxon_writer, taxa);
+    taxon_writer.set_compact_spaces(true);
+    taxon_writer.set_suppress_rooting(true);
+    fails += platypus::testing::compare_equal(std::string("(a_taxon_label_longer_than_fifteen:1.000000,b:2.000000):0.000000;\n"),
+            taxon_writer.format(taxon_trees.begin(), taxon_trees.end()), __FILE__, __LINE__, "labels from taxa");
+
+    bool caught = false;
+    try {
+        CompactValueType nv;
+        nv.set_label("a_label_longer_than_fifteen");
+    } catch (const std::length_error &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "label too long");
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,264 @@
+#include <stdlib.h>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+#include <platypus/model/continuoustraits.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree TreeType;
+typedef TreeType::node_type NodeType;
+typedef platypus::ContinuousTraitSimulator<TreeType> SimulatorType;
+typedef platypus::IndependentContrasts<TreeType> ContrastsType;
+
+template <typename... Types>
+int check_close(double expected, double observed, double tolerance, unsigned long line_num, const Types&... args) {
+    if (!(std::fabs(expected - observed) <= tolerance * (1.0 + std::fabs(expected)))) {
+        return platypus::testing::fail_test(__FILE__, line_num, expected, observed, args...);
+    }
+    return 0;
+}
+
+// distance from the head node (ignoring its edge)
+double node_depth(const NodeType * nd) {
+    double depth = 0.0;
+    for (; nd->parent_node() != nullptr; nd = nd->parent_node()) {
+        depth += nd->value().get_edge_length();
+    }
+    return depth;
+}
+
+double shared_depth(const NodeType * a, const NodeType * b) {
+    for (const NodeType * x = a; x != nullptr; x = x->parent_node()) {
+        for (const NodeType * y = b; y != nullptr; y = y->parent_node()) {
+            if (x == y) {
+                return node_depth(x);
+            }
+        }
+    }
+    return 0.0;
+}
+
+// solves ``a x = b`` in place (``b`` becomes ``x``), and returns log |det(a)|
+double solve(std::vector<double> a, std::vector<double> & b, std::size_t n) {
+    double log_det = 0.0;
+    for (std::size_t col = 0; col < n; ++col) {
+        std::size_t pivot = col;
+        for (std::size_t row = col + 1; row < n; ++row) {
+            if (std::fabs(a[row * n + col]) > std::fabs(a[pivot * n + col])) {
+                pivot = row;
+            }
+        }
+        for (std::size_t k = 0; k < n; ++k) {
+            std::swap(a[col * n + k], a[pivot * n + k]);
+        }
+        std::swap(b[col], b[pivot]);
+        log_det += std::log(std::fabs(a[col * n + col]));
+        for (std::size_t row = col + 1; row < n; ++row) {
+            double f = a[row * n + col] / a[col * n + col];
+            for (std::size_t k = col; k < n; ++k) {
+                a[row * n + k] -= f * a[col * n + k];
+            }
+            b[row] -= f * b[col];
+        }
+    }
+    for (std::size_t row = n; row > 0; --row) {
+        double sum = b[row - 1];
+        for (std::size_t k = row; k < n; ++k) {
+            sum -= a[(row - 1) * n + k] * b[k];
+        }
+        b[row - 1] = sum / a[(row - 1) * n + row - 1];
+    }
+    return log_det;
+}
+
+// against the likelihood of the leaf values, normal with covariance sigma2 C
+int check_contrasts() {
+    int fails = 0;
+    platypus::TaxonNamespace taxa;
+    platypus::ContinuousTraitMatrix matrix(3, &taxa);
+    std::map<std::string, std::vector<double>> data{
+        {"a", {1.0, -2.0, 0.5}},
+        {"b", {1.5, -1.0, 0.4}},
+        {"c", {0.2, 0.0, 0.9}},
+        {"d", {3.0, 2.5, -0.3}},
+        {"e", {2.2, 1.5, 0.0}},
+        {"f", {-0.5, 0.7, 1.2}},
+    };
+    for (auto & entry : data) {
+        matrix.add_row(entry.first, entry.second);
+    }
+    auto taxon_index_fn = [&taxa] (const TestData & nv) { return taxa.find_taxon(nv.get_label()); };
+    // with a polytomy, a leaf with no data and a head edge (ignored)
+    TreeType tree = read_tree("((a:0.3,b:0.5,c:0.2):0.4,(d:0.7,(e:0.1,x:0.2):0.3):0.6,f:1.1):2.0;");
+    ContrastsType contrasts(matrix, taxon_index_fn, get_edge_length);
+    contrasts.compute(tree);
+    fails += platypus::testing::compare_equal(6UL, contrasts.num_leaves(), __FILE__, __LINE__, "leaves");
+    fails += platypus::testing::compare_equal(5UL, contrasts.num_contrasts(), __FILE__, __LINE__, "contrasts");
+    fails += platypus::testing::compare_equal(15UL, contrasts.contrasts().size(), __FILE__, __LINE__, "contrast values");
+
+    std::vector<const NodeType *> leaves;
+    for (auto ndi = tree.leaf_begin(); ndi != tree.leaf_end(); ++ndi) {
+        if (ndi->get_label() != "x") {
+            leaves.push_back(ndi.node());
+        }
+    }
+    std::size_t n = leaves.size();
+    std::vector<double> covariance(n * n);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+            covariance[i * n + j] = shared_depth(leaves[i], leaves[j]);
+        }
+    }
+    std::vector<double> ones(n, 1.0);
+    double log_det = solve(covariance, ones, n);
+    double ones_weight = 0.0;
+    for (auto w : ones) {
+        ones_weight += w;
+    }
+    for (std::size_t trait = 0; trait < 3; ++trait) {
+        std::vector<double> x;
+        for (auto leaf : leaves) {
+            x.push_back(data[leaf->value().get_label()][trait]);
+        }
+        // generalized least-squares estimate of the root
+        double root = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            root += ones[i] * x[i] / ones_weight;
+        }
+        std::vector<double> residuals(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            residuals[i] = x[i] - root;
+        }
+        std::vector<double> weighted = residuals;
+        solve(covariance, weighted, n);
+        double quadratic = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            quadratic += residuals[i] * weighted[i];
+        }
+        fails += check_close(root, contrasts.root_values()[trait], 1e-12, __LINE__, "root value, trait ", trait);
+        fails += check_close(quadratic, contrasts.sums_of_squares()[trait], 1e-12, __LINE__, "sum of squares, trait ", trait);
+        fails += check_close(quadratic / 5.0, contrasts.rate_estimate(trait), 1e-12, __LINE__, "REML rate, trait ", trait);
+        for (double sigma2 : {0.3, 1.7}) {
+            double expected = -0.5 * (n * std::log(2.0 * 3.14159265358979323846 * sigma2) + log_det + quadratic / sigma2);
+            fails += check_close(expected, contrasts.log_likelihood(trait, sigma2), 1e-12, __LINE__, "log-likelihood, trait ", trait);
+        }
+        double ml_sigma2 = quadratic / n;
+        double expected = -0.5 * (n * std::log(2.0 * 3.14159265358979323846 * ml_sigma2) + log_det + n);
+        fails += check_close(expected, contrasts.max_log_likelihood(trait), 1e-12, __LINE__, "maximum log-likelihood, trait ", trait);
+    }
+
+    // across trees, concurrently
+    std::vector<TreeType> trees;
+    trees.push_back(read_tree("((a:0.3,b:0.5,c:0.2):0.4,(d:0.7,(e:0.1,x:0.2):0.3):0.6,f:1.1);"));
+    trees.push_back(read_tree("(((a:0.3,b:0.5):0.1,c:0.2):0.4,(d:0.7,e:0.4):0.6,f:1.1);"));
+    trees.push_back(read_tree("(a:1.0,(b:0.5,(c:0.2,(d:0.7,(e:0.4,f:0.3):0.2):0.1):0.3):0.2);"));
+    for (unsigned int num_threads : {1U, 2U}) {
+        std::vector<double> log_likelihoods;
+        std::vector<double> rates;
+        contrasts.fit_trees(trees.begin(), trees.end(), log_likelihoods, rates, num_threads);
+        fails += platypus::testing::compare_equal(9UL, log_likelihoods.size(), __FILE__, __LINE__, "fitted trees");
+        for (std::size_t tree_idx = 0; tree_idx < trees.size(); ++tree_idx) {
+            ContrastsType single(matrix, taxon_index_fn, get_edge_length);
+            single.compute(trees[tree_idx]);
+            for (std::size_t trait = 0; trait < 3; ++trait) {
+                fails += check_close(single.max_log_likelihood(trait), log_likelihoods[tree_idx * 3 + trait], 1e-12, __LINE__,
+                        "fitted log-likelihood, threads: ", num_threads, ", tree: ", tree_idx);
+                fails += check_close(single.rate_estimate(trait), rates[tree_idx * 3 + trait], 1e-12, __LINE__,
+                        "fitted rate, threads: ", num_threads, ", tree: ", tree_idx);
+            }
+        }
+    }
+    return fails;
+}
+
+// moments of the simulated values of two leaves across traits
+void leaf_moments(const platypus::ContinuousTraitMatrix & matrix, std::size_t row1, std::size_t row2,
+        double & mean1, double & var1, double & covariance) {
+    std::size_t m = matrix.num_traits();
+    mean1 = 0.0;
+    double mean2 = 0.0;
+    for (std::size_t trait = 0; trait < m; ++trait) {
+        mean1 += matrix.row(row1)[trait] / m;
+        mean2 += matrix.row(row2)[trait] / m;
+    }
+    var1 = 0.0;
+    covariance = 0.0;
+    for (std::size_t trait = 0; trait < m; ++trait) {
+        var1 += (matrix.row(row1)[trait] - mean1) * (matrix.row(row1)[trait] - mean1) / m;
+        covariance += (matrix.row(row1)[trait] - mean1) * (matrix.row(row2)[trait] - mean2) / m;
+    }
+}
+
+int check_simulation() {
+    int fails = 0;
+    const std::size_t num_traits = 40000;
+    platypus::numeric::RandomNumberGenerator rng(13);
+    double mean;
+    double var;
+    double covariance;
+    {
+        TreeType tree = read_tree("((a:1.0,b:1.0):1.0,c:2.0);");
+        SimulatorType simulator(rng, platypus::ContinuousTraitModel::brownian_motion(0.5, 3.0), get_label, get_edge_length);
+        platypus::ContinuousTraitMatrix matrix(0);
+        simulator.simulate(tree, num_traits, matrix);
+        fails += platypus::testing::compare_equal(3UL, matrix.num_taxa(), __FILE__, __LINE__, "rows");
+        fails += platypus::testing::compare_equal(std::string("a"), matrix.get_taxon_label(0), __FILE__, __LINE__, "leaf order");
+        leaf_moments(matrix, 0, 1, mean, var, covariance);
+        fails += check_close(3.0, mean, 0.02, __LINE__, "BM mean");
+        fails += check_close(1.0, var, 0.03, __LINE__, "BM variance");
+        fails += check_close(0.5, covariance, 0.03, __LINE__, "BM covariance of sisters");
+        leaf_moments(matrix, 0, 2, mean, var, covariance);
+        fails += check_close(0.0, covariance, 0.02, __LINE__, "BM covariance across root");
+    }
+    {
+        TreeType tree = read_tree("(a:0.5,b:1.5);");
+        double alpha = 2.0;
+        SimulatorType simulator(rng, platypus::ContinuousTraitModel::ornstein_uhlenbeck(0.5, alpha, 1.0, 3.0), get_label, get_edge_length);
+        platypus::ContinuousTraitMatrix matrix(0);
+        simulator.simulate(tree, num_traits, matrix);
+        leaf_moments(matrix, 0, 1, mean, var, covariance);
+        fails += check_close(1.0 + 2.0 * std::exp(-alpha * 0.5), mean, 0.02, __LINE__, "OU mean");
+        fails += check_close(0.5 * (1.0 - std::exp(-2.0 * alpha * 0.5)) / (2.0 * alpha), var, 0.03, __LINE__, "OU variance");
+        fails += check_close(0.0, covariance, 0.02, __LINE__, "OU covariance");
+    }
+    {
+        // batches do not depend on the number of threads
+        std::vector<TreeType> trees;
+        trees.push_back(read_tree("((a:1.0,b:1.0):1.0,c:2.0);"));
+        trees.push_back(read_tree("(a:0.5,(b:1.5,c:0.2):0.3);"));
+        trees.push_back(read_tree("(a:0.5,b:1.5,c:0.1);"));
+        SimulatorType simulator(rng, platypus::ContinuousTraitModel::ornstein_uhlenbeck(1.0, 0.5, 0.0), get_label, get_edge_length);
+        std::vector<std::vector<double>> expected;
+        for (unsigned int num_threads : {1U, 3U}) {
+            std::vector<std::vector<double>> observed;
+            unsigned long num_simulated = simulator.simulate_batch(trees.begin(), trees.end(), 5, num_threads,
+                    [&observed] (const platypus::ContinuousTraitMatrix & matrix, unsigned long tree_idx) {
+                        observed.emplace_back();
+                        for (std::size_t row = 0; row < matrix.num_taxa(); ++row) {
+                            observed.back().insert(observed.back().end(), matrix.row(row), matrix.row(row) + matrix.num_traits());
+                        }
+                        observed.back().push_back(static_cast<double>(tree_idx));
+                    }, 77);
+            fails += platypus::testing::compare_equal(3UL, num_simulated, __FILE__, __LINE__, "batch size");
+            if (expected.empty()) {
+                expected = observed;
+            }
+            fails += platypus::testing::compare_equal(true, expected == observed, __FILE__, __LINE__, "batch with threads: ", num_threads);
+        }
+    }
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_contrasts();
+    fails += check_simulation();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,121 @@
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <platypus/model/datatable.hpp>
+#include "platypus_testing.hpp"
+
+class LittleEndianReader {
+    public:
+        LittleEndianReader(const std::string & data)
+            : data_(data)
+            , pos_(0) { }
+        std::uint64_t read(unsigned int num_bytes) {
+            std::uint64_t v = 0;
+            for (unsigned int i = 0; i < num_bytes; ++i) {
+                v |= static_cast<std::uint64_t>(static_cast<unsigned char>(this->data_.at(this->pos_ + i))) << (8 * i);
+            }
+            this->pos_ += num_bytes;
+            return v;
+        }
+        double read_float64() {
+            std::uint64_t bits = this->read(8);
+            double v;
+            std::memcpy(&v, &bits, sizeof(v));
+            return v;
+        }
+        std::string read_string(std::size_t size) {
+            std::string s = this->data_.substr(this->pos_, size);
+            this->pos_ += size;
+            return s;
+        }
+        std::size_t pos() const {
+            return this->pos_;
+        }
+        void skip_padding() {
+            while (this->pos_ % 8 != 0) {
+                this->pos_ += 1;
+            }
+        }
+    private:
+        const std::string & data_;
+        std::size_t         pos_;
+};
+
+int main() {
+    int fails = 0;
+
+    platypus::DataTable table;
+    table.add_key_column<std::string>("rep");
+    table.add_data_column<long>("delta");
+    table.add_data_column<unsigned long>("ntips", {std::setw(10)});
+    table.add_data_column<double>("length", {std::fixed, std::setprecision(1)});
+    table.add_data_column<double>("scratch").set_hidden(true);
+    std::vector<std::string> reps{"a", "", "ccc", "dddddddddd", "e"};
+    std::vector<long> deltas{-3, 0, 9223372036854775807L, -9223372036854775807L, 1};
+    std::vector<unsigned long> ntips{0, 1, 2, 18446744073709551615UL, 4};
+    std::vector<double> lengths{0.125, -2.5, 1e300, 1.0/3.0, 0.0};
+    for (unsigned int i = 0; i < reps.size(); ++i) {
+        table.add_row() << reps[i] << deltas[i] << ntips[i] << lengths[i] << 99.0;
+    }
+
+    std::ostringstream out;
+    table.write_binary(out);
+    std::string data = out.str();
+    LittleEndianReader reader(data);
+
+    fails += platypus::testing::compare_equal(std::string("PLTYDTB\0", 8), reader.read_string(8), __FILE__, __LINE__, "magic");
+    fails += platypus::testing::compare_equal(1UL, static_cast<unsigned long>(reader.read(4)), __FILE__, __LINE__, "version");
+    fails += platypus::testing::compare_equal(4UL, static_cast<unsigned long>(reader.read(4)), __FILE__, __LINE__, "num columns");
+    fails += platypus::testing::compare_equal(5UL, static_cast<unsigned long>(reader.read(8)), __FILE__, __LINE__, "num rows");
+    std::vector<std::string> expected_labels{"rep", "delta", "ntips", "length"};
+    std::vector<unsigned long> expected_types{3, 0, 1, 2};
+    std::vector<unsigned long> expected_flags{1, 0, 0, 0};
+    for (unsigned int i = 0; i < expected_labels.size(); ++i) {
+        fails += platypus::testing::compare_equal(expected_types[i], static_cast<unsigned long>(reader.read(1)), __FILE__, __LINE__, "type: ", i);
+        fails += platypus::testing::compare_equal(expected_flags[i], static_cast<unsigned long>(reader.read(1)), __FILE__, __LINE__, "flags: ", i);
+        reader.read(2);
+        std::size_t label_size = reader.read(4);
+        fails += platypus::testing::compare_equal(expected_labels[i], reader.read_string(label_size), __FILE__, __LINE__, "label: ", i);
+    }
+    reader.skip_padding();
+
+    // string column
+    std::vector<std::uint64_t> offsets;
+    for (unsigned int i = 0; i <= reps.size(); ++i) {
+        offsets.push_back(reader.read(8));
+    }
+    for (unsigned int i = 0; i < reps.size(); ++i) {
+        fails += platypus::testing::compare_equal(reps[i], reader.read_string(offsets[i+1] - offsets[i]), __FILE__, __LINE__, "rep: ", i);
+    }
+    reader.skip_padding();
+    // integer columns, unformatted
+    for (unsigned int i = 0; i < deltas.size(); ++i) {
+        fails += platypus::testing::compare_equal(deltas[i], static_cast<long>(static_cast<std::int64_t>(reader.read(8))), __FILE__, __LINE__, "delta: ", i);
+    }
+    for (unsigned int i = 0; i < ntips.size(); ++i) {
+        fails += platypus::testing::compare_equal(ntips[i], static_cast<unsigned long>(reader.read(8)), __FILE__, __LINE__, "ntips: ", i);
+    }
+    // floating-point column, at full double precision
+    for (unsigned int i = 0; i < lengths.size(); ++i) {
+        fails += platypus::testing::compare_equal(lengths[i], reader.read_float64(), __FILE__, __LINE__, "length: ", i);
+    }
+    fails += platypus::testing::compare_equal(data.size(), reader.pos(), __FILE__, __LINE__, "hidden column written");
+
+    // hidden columns on request
+    std::ostringstream out_all;
+    table.write_binary(out_all, true);
+    std::string data_all = out_all.str();
+    LittleEndianReader reader_all(data_all);
+    reader_all.read_string(12);
+    fails += platypus::testing::compare_equal(5UL, static_cast<unsigned long>(reader_all.read(4)), __FILE__, __LINE__, "num columns with hidden column");
+    fails += platypus::testing::compare_equal(true, out_all.str().size() >= data.size() + 5*8, __FILE__, __LINE__, "size with hidden column");
+    fails += platypus::testing::compare_equal(0UL, static_cast<unsigned long>(out_all.str().size() % 8), __FILE__, __LINE__, "alignment with hidden column");
+
+    if (fails != 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -73,10 +73,47 @@ int test_summarize() {
     return fails;
 }
 
+int test_summarize_large() {
+    int fails = 0;
+    platypus::DataTable table;
+    table.add_column<unsigned long>("i");
+    table.add_column<double>("x");
+    const unsigned long num_rows = 200000;
+    platypus::numeric::RunningStatistics<long double> incremental;
+    unsigned long num_summarized = 0;
+    for (unsigned long i = 0; i < num_rows; ++i) {
+        table.add_row() << i << (1e6 + (i % 7) * 0.25);
+        if (i % 1000 == 999) {
+            table.update_column_summary("x", incremental, num_summarized);
+            num_summarized = table.num_rows();
+        }
+    }
+    table.update_column_summary("x", incremental, num_summarized);
+    auto serial = table.summarize_column<long double>("x");
+    auto threaded = table.summarize_column<long double>("x", 4);
+    auto compensated = table.summarize_column<long double>("x", 4, true);
+    for (auto * summary : {&threaded, &compensated}) {
+        fails += platypus::testing::compare_equal(serial.size, summary->size, __FILE__, __LINE__, "size");
+        fails += platypus::testing::compare_almost_equal(serial.sum, summary->sum, __FILE__, __LINE__, "sum");
+        fails += platypus::testing::compare_almost_equal(serial.mean, summary->mean, __FILE__, __LINE__, "mean");
+        fails += platypus::testing::compare_almost_equal(serial.sample_variance, summary->sample_variance, __FILE__, __LINE__, "sample variance");
+        fails += platypus::testing::compare_equal(serial.minimum, summary->minimum, __FILE__, __LINE__, "minimum");
+        fails += platypus::testing::compare_equal(serial.maximum, summary->maximum, __FILE__, __LINE__, "maximum");
+    }
+    fails += platypus::testing::compare_equal(static_cast<std::size_t>(num_rows), incremental.size(), __FILE__, __LINE__, "incremental size");
+    fails += platypus::testing::compare_almost_equal(serial.mean, incremental.mean(), __FILE__, __LINE__, "incremental mean");
+    fails += platypus::testing::compare_almost_equal(serial.sample_variance, incremental.sample_variance(), __FILE__, __LINE__, "incremental variance");
+    auto isum = table.summarize_column<long double>("i", 3);
+    fails += platypus::testing::compare_equal(static_cast<long double>(num_rows * (num_rows - 1) / 2), isum.sum, __FILE__, __LINE__, "integer column sum");
+    fails += platypus::testing::compare_equal(static_cast<long double>(num_rows - 1), isum.maximum, __FILE__, __LINE__, "integer column maximum");
+    return fails;
+}
+
 int main() {
     int fails = 0;
     fails += test_get_column();
     fails += test_summarize();
+    fails += test_summarize_large();
     if (fails != 0) {
         return EXIT_FAILURE;
     } else {
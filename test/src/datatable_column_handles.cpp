@@ -0,0 +1,65 @@
+#include <string>
+#include <platypus/model/datatable.hpp>
+#include "platypus_testing.hpp"
+
+int main() {
+    int fails = 0;
+    platypus::DataTable table;
+    table.add_key_column<std::string>("replicate");
+    table.add_data_column<unsigned long>("num_tips");
+    table.add_data_column<long>("balance");
+    table.add_data_column<double>("tree_length");
+
+    auto replicate = table.column_handle<std::string>("replicate");
+    auto num_tips = table.column_handle<unsigned long>("num_tips");
+    auto balance = table.column_handle<int>(2);
+    auto tree_length = table.column_handle<double>("tree_length");
+    fails += platypus::testing::compare_equal(3UL, tree_length.column_index(), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(std::string("tree_length"), tree_length.column().get_label(), __FILE__, __LINE__);
+
+    const unsigned long num_rows = 1000;
+    for (unsigned long i = 0; i < num_rows; ++i) {
+        auto & row = table.add_row();
+        row.set(replicate, "r" + std::to_string(i));
+        row.set(num_tips, i);
+        row.set(balance, -static_cast<int>(i));
+        row.set(tree_length, i * 0.5);
+    }
+    // handles see the same values as access by name, after storage has grown
+    for (unsigned long i = 0; i < num_rows; i += 37) {
+        fails += platypus::testing::compare_equal(table.get<std::string>(i, "replicate"), table.get(i, replicate), __FILE__, __LINE__, "row: ", i);
+        fails += platypus::testing::compare_equal(i, table.get(i, num_tips), __FILE__, __LINE__, "row: ", i);
+        fails += platypus::testing::compare_equal(-static_cast<long>(i), table.get<long>(i, "balance"), __FILE__, __LINE__, "row: ", i);
+        fails += platypus::testing::compare_equal(-static_cast<int>(i), table.row(i).get(balance), __FILE__, __LINE__, "row: ", i);
+        fails += platypus::testing::compare_equal(i * 0.5, table.get<double>(i, "tree_length"), __FILE__, __LINE__, "row: ", i);
+    }
+
+    // type mismatches are rejected when the handle is created
+    bool caught = false;
+    try {
+        table.column_handle<double>("num_tips");
+    } catch (const platypus::DataTableUndefinedColumnValueType &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "floating-point handle to integer column");
+    caught = false;
+    try {
+        table.column_handle<unsigned long>("balance");
+    } catch (const platypus::DataTableUndefinedColumnValueType &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "unsigned handle to signed column");
+    caught = false;
+    try {
+        table.column_handle<double>("no_such_column");
+    } catch (const platypus::DataTableUndefinedColumnError &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "handle to undefined column");
+
+    if (fails != 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
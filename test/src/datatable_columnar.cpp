@@ -0,0 +1,104 @@
+#include <string>
+#include <sstream>
+#include <vector>
+#include <platypus/model/datatable.hpp>
+#include "platypus_testing.hpp"
+
+typedef platypus::DataTable::Column::signed_integer_implementation_type      signed_int_type;
+typedef platypus::DataTable::Column::unsigned_integer_implementation_type    unsigned_int_type;
+typedef platypus::DataTable::Column::floating_point_implementation_type      float_type;
+typedef platypus::DataTable::Column::string_implementation_type              str_type;
+
+int test_storage() {
+    int fails = 0;
+    platypus::DataTable table;
+    table.add_key_column<str_type>("id");
+    table.add_data_column<signed_int_type>("s");
+    table.add_data_column<unsigned_int_type>("u");
+    table.add_data_column<float_type>("f", {std::fixed, std::setprecision(2)});
+    const unsigned long num_rows = 10000;
+    table.reserve(num_rows);
+    auto & first_row = table.add_row();
+    first_row << "r0" << -1 << 0 << 0.5;
+    for (unsigned long i = 1; i < num_rows; ++i) {
+        table.add_row() << ("r" + std::to_string(i)) << -static_cast<long>(i) - 1 << i << (i + 0.5);
+    }
+    // rows are views, and remain valid as further rows are added
+    fails += platypus::testing::compare_equal(0UL, first_row.get_row_index(), __FILE__, __LINE__);
+    first_row.set("u", 99);
+    fails += platypus::testing::compare_equal(99UL, table.get<unsigned_int_type>(0, "u"), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(num_rows, table.num_rows(), __FILE__, __LINE__);
+
+    // direct access to column storage
+    auto & u_vals = table.column("u").values<unsigned_int_type>();
+    fails += platypus::testing::compare_equal(num_rows, static_cast<unsigned long>(u_vals.size()), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(99UL, u_vals[0], __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(num_rows - 1, u_vals[num_rows - 1], __FILE__, __LINE__);
+    auto & s_vals = table.column("s").values<signed_int_type>();
+    fails += platypus::testing::compare_equal(-static_cast<long>(num_rows), s_vals.back(), __FILE__, __LINE__);
+
+    // wrong implementation type is rejected
+    bool caught = false;
+    try {
+        table.column("u").values<signed_int_type>();
+    } catch (const platypus::DataTableUndefinedColumnValueType &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "type mismatch not detected");
+
+    // reductions and conversions
+    fails += platypus::testing::compare_equal(num_rows - 1, table.column("u").max<unsigned_int_type>(), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(-1L, table.column("s").max<signed_int_type>(), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(str_type("r9999"), table.column("id").max<str_type>(), __FILE__, __LINE__);
+    auto f_strs = table.get_column<str_type>("f");
+    fails += platypus::testing::compare_equal(str_type("0.50"), f_strs[0], __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(str_type("9999.50"), f_strs.back(), __FILE__, __LINE__);
+    auto u_dbls = table.get_column<double>("u");
+    fails += platypus::testing::compare_equal(5.0, u_dbls[5], __FILE__, __LINE__);
+
+    // numeric cells set from strings are parsed; string cells set from
+    // numbers are rendered
+    table.row(1).set("f", str_type("12.25"));
+    fails += platypus::testing::compare_equal(str_type("12.25"), table.get<str_type>(1, "f"), __FILE__, __LINE__);
+    table.row(1).set("id", 42);
+    fails += platypus::testing::compare_equal(str_type("42"), table.get<str_type>(1, "id"), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(42L, table.get<signed_int_type>(1, "id"), __FILE__, __LINE__);
+
+    return fails;
+}
+
+int test_write() {
+    int fails = 0;
+    platypus::DataTable table;
+    table.add_key_column<str_type>("k");
+    table.add_data_column<unsigned_int_type>("a");
+    table.add_data_column<float_type>("b", {std::fixed, std::setprecision(1)});
+    table.add_row() << "x" << 1 << 1.25;
+    table.add_row() << "y" << 2 << 2.75;
+    std::ostringstream out;
+    table.write(out);
+    fails += platypus::testing::compare_equal(
+            str_type("k\ta\tb\nx\t1\t1.2\ny\t2\t2.8\n"),
+            out.str(),
+            __FILE__,
+            __LINE__);
+    std::ostringstream stacked;
+    table.write_stacked(stacked);
+    fails += platypus::testing::compare_equal(
+            str_type("k\tkey\tvalue\nx\ta\t1\nx\tb\t1.2\ny\ta\t2\ny\tb\t2.8\n"),
+            stacked.str(),
+            __FILE__,
+            __LINE__);
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += test_storage();
+    fails += test_write();
+    if (fails != 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,90 @@
+#include <stdlib.h>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <platypus/model/datatable.hpp>
+#include <platypus/utility/testing.hpp>
+#include "platypus_testing.hpp"
+
+typedef platypus::stream::OutputStreamFormatters Formatters;
+
+void populate(platypus::DataTable & table, const Formatters & formatters) {
+    table.add_key_column<long>("i", formatters);
+    table.add_data_column<unsigned long>("u", formatters);
+    table.add_data_column<double>("f", formatters);
+    table.add_data_column<std::string>("s", formatters);
+    std::vector<double> values{0.0, -0.0, 1.0, -2.5, 1.0 / 3.0, 6.02214076e23, -1.6e-19, 1e300,
+        std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity(),
+        -std::numeric_limits<double>::infinity(), 123456.789};
+    for (unsigned long idx = 0; idx < values.size(); ++idx) {
+        table.add_row() << (static_cast<long>(idx) - 5) * 1000003 << idx * idx << values[idx] << std::string(idx, 'x');
+    }
+}
+
+std::string format(const Formatters & formatters, bool compiled, bool streaming) {
+    platypus::DataTable table;
+    table.set_compiled_formatting(compiled);
+    std::ostringstream out;
+    if (streaming) {
+        populate(table, {});
+        std::vector<std::vector<std::string>> cells;
+        for (unsigned long idx = 0; idx < table.num_rows(); ++idx) {
+            cells.push_back({table.get<std::string>(idx, "i"), table.get<std::string>(idx, "u"), table.get<std::string>(idx, "f"), table.get<std::string>(idx, "s")});
+        }
+        platypus::DataTable streamed;
+        streamed.set_compiled_formatting(compiled);
+        streamed.add_key_column<long>("i", formatters);
+        streamed.add_data_column<unsigned long>("u", formatters);
+        streamed.add_data_column<long double>("f", formatters);
+        streamed.add_data_column<std::string>("s", formatters);
+        streamed.begin_streaming(out);
+        for (unsigned long idx = 0; idx < table.num_rows(); ++idx) {
+            streamed.add_row() << table.get<long>(idx, "i") << table.get<unsigned long>(idx, "u") << table.get<long double>(idx, "f") << table.get<std::string>(idx, "s");
+        }
+        streamed.end_streaming();
+    } else {
+        populate(table, formatters);
+        table.write(out);
+    }
+    return out.str();
+}
+
+int main() {
+    int fails = 0;
+    std::vector<std::pair<std::string, Formatters>> cases{
+        {"none", {}},
+        {"precision", {std::setprecision(12)}},
+        {"fixed", {std::fixed, std::setprecision(2)}},
+        {"scientific", {std::scientific, std::uppercase, std::setprecision(4)}},
+        {"showpos and showpoint", {std::showpos, std::showpoint, std::setprecision(3)}},
+        {"width", {std::setw(14)}},
+        {"left", {std::left, std::setw(14), std::fixed}},
+        {"precision 0", {std::setprecision(0)}},
+        // not compiled
+        {"fill", {std::setfill('*'), std::setw(14)}},
+        {"internal", {std::internal, std::setw(14)}},
+        {"hex", {std::hex}},
+    };
+    for (auto & c : cases) {
+        for (bool streaming : {false, true}) {
+            fails += platypus::testing::compare_equal(format(c.second, false, streaming), format(c.second, true, streaming),
+                    __FILE__, __LINE__, "formatting: ", c.first, ", streaming: ", streaming);
+        }
+    }
+
+    platypus::DataTable table;
+    auto & col = table.add_data_column<double>("x", {std::fixed, std::setprecision(3)});
+    fails += platypus::testing::compare_equal(true, col.compile_formatting(), __FILE__, __LINE__, "compiled");
+    col.add_formatting(std::setfill('0'));
+    fails += platypus::testing::compare_equal(false, col.has_compiled_formatting(), __FILE__, __LINE__, "compiled formatting discarded on change");
+    col.add_formatting(std::setw(8));
+    fails += platypus::testing::compare_equal(false, col.compile_formatting(), __FILE__, __LINE__, "fill not compiled");
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
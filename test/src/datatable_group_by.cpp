@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <platypus/model/datatable.hpp>
+#include <platypus/utility/testing.hpp>
+#include "platypus_testing.hpp"
+
+int check_small_table() {
+    int fails = 0;
+    platypus::DataTable table;
+    table.add_key_column<std::string>("model");
+    table.add_key_column<double>("rate");
+    table.add_data_column<long>("size");
+    table.add_data_column<double>("length");
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    std::vector<std::tuple<std::string, double, long, double>> rows{
+        std::make_tuple("bd", 0.5, 10L, 1.0),
+        std::make_tuple("yule", 0.5, 20L, 2.0),
+        std::make_tuple("bd", 0.5, 30L, 3.0),
+        std::make_tuple("bd", -0.0, 40L, 4.0),
+        std::make_tuple("bd", 0.0, 50L, 5.0),
+        std::make_tuple("bd", nan, 60L, 6.0),
+        std::make_tuple("bd", nan, 70L, 8.0),
+    };
+    for (auto & r : rows) {
+        table.add_row() << std::get<0>(r) << std::get<1>(r) << std::get<2>(r) << std::get<3>(r);
+    }
+    auto groups = table.group_by();
+    fails += platypus::testing::compare_equal(4UL, static_cast<unsigned long>(groups.num_groups()), __FILE__, __LINE__, "number of groups");
+    std::vector<std::size_t> expected_groups{0, 1, 0, 2, 2, 3, 3};
+    fails += platypus::testing::compare_equal(expected_groups, groups.row_groups(), __FILE__, __LINE__, "row groups");
+    fails += platypus::testing::compare_equal(3UL, groups.get_first_row(2), __FILE__, __LINE__, "first row");
+
+    platypus::DataTable summary;
+    groups.summarize<double>(summary);
+    std::vector<std::string> expected_columns{"model", "rate", "count",
+        "size_mean", "size_variance", "size_min", "size_max",
+        "length_mean", "length_variance", "length_min", "length_max"};
+    fails += platypus::testing::compare_equal(expected_columns, summary.column_names(), __FILE__, __LINE__, "summary columns");
+    fails += platypus::testing::compare_equal(std::vector<std::string>{"model", "rate"}, summary.key_column_names(), __FILE__, __LINE__, "summary key columns");
+    fails += platypus::testing::compare_equal(4UL, summary.num_rows(), __FILE__, __LINE__, "summary rows");
+    fails += platypus::testing::compare_equal(std::vector<std::string>{"bd", "yule", "bd", "bd"}, summary.get_column<std::string>("model"), __FILE__, __LINE__, "model keys");
+    fails += platypus::testing::compare_equal(std::vector<unsigned long>{2, 1, 2, 2}, summary.get_column<unsigned long>("count"), __FILE__, __LINE__, "counts");
+    fails += platypus::testing::compare_equal(std::vector<double>{20, 20, 45, 65}, summary.get_column<double>("size_mean"), __FILE__, __LINE__, "means");
+    fails += platypus::testing::compare_equal(std::vector<double>{200, 0, 50, 50}, summary.get_column<double>("size_variance"), __FILE__, __LINE__, "variances");
+    fails += platypus::testing::compare_equal(std::vector<double>{1, 2, 4, 6}, summary.get_column<double>("length_min"), __FILE__, __LINE__, "minima");
+    fails += platypus::testing::compare_equal(std::vector<double>{3, 2, 5, 8}, summary.get_column<double>("length_max"), __FILE__, __LINE__, "maxima");
+    fails += platypus::testing::compare_equal(true, std::isnan(summary.get_column<double>("rate")[3]), __FILE__, __LINE__, "NaN key");
+
+    auto by_model = table.group_by({"model"}).summarize_column<double>("length");
+    fails += platypus::testing::compare_equal(2UL, static_cast<unsigned long>(by_model.size()), __FILE__, __LINE__, "summarize_column() groups");
+    fails += platypus::testing::compare_equal(27.0 / 6, static_cast<double>(by_model[0].mean), __FILE__, __LINE__, "summarize_column() mean");
+
+    try {
+        table.group_by({"undefined"});
+        fails += platypus::testing::fail_test(__FILE__, __LINE__, "exception", "none", "undefined key column");
+    } catch (const platypus::DataTableUndefinedColumnError &) {
+    }
+    return fails;
+}
+
+int check_large_table() {
+    int fails = 0;
+    platypus::DataTable table;
+    table.add_data_column<long>("replicate");
+    table.add_data_column<unsigned long>("num_tips");
+    table.add_data_column<std::string>("model");
+    table.add_data_column<double>("value");
+    const unsigned long num_rows = 150000;
+    std::map<std::tuple<unsigned long, std::string>, std::vector<double>> expected;
+    unsigned long state = 11;
+    for (unsigned long idx = 0; idx < num_rows; ++idx) {
+        state = state * 6364136223846793005UL + 1442695040888963407UL;
+        unsigned long num_tips = 4 + (state >> 40) % 37;
+        std::string model = (state >> 20) % 3 == 0 ? "yule" : "bd";
+        double value = static_cast<double>((state >> 33) % 1000) / 8.0;
+        table.add_row() << static_cast<long>(idx) << num_tips << model << value;
+        expected[std::make_tuple(num_tips, model)].push_back(value);
+    }
+    std::vector<std::vector<double>> results;
+    for (unsigned int num_threads : {1U, 4U}) {
+        auto groups = table.group_by({"num_tips", "model"}, num_threads);
+        fails += platypus::testing::compare_equal(static_cast<unsigned long>(expected.size()), static_cast<unsigned long>(groups.num_groups()), __FILE__, __LINE__, "number of groups");
+        platypus::DataTable summary;
+        groups.summarize<double>(summary, {"value"}, num_threads);
+        auto num_tips = summary.get_column<unsigned long>("num_tips");
+        auto models = summary.get_column<std::string>("model");
+        auto counts = summary.get_column<unsigned long>("count");
+        auto means = summary.get_column<double>("value_mean");
+        auto maxima = summary.get_column<double>("value_max");
+        for (unsigned long idx = 0; idx < summary.num_rows(); ++idx) {
+            auto & values = expected[std::make_tuple(num_tips[idx], models[idx])];
+            double sum = 0.0;
+            double maximum = values[0];
+            for (auto v : values) {
+                sum += v;
+                maximum = std::max(maximum, v);
+            }
+            fails += platypus::testing::compare_equal(static_cast<unsigned long>(values.size()), counts[idx], __FILE__, __LINE__, "count of group ", idx);
+            fails += platypus::testing::compare_equal(true, std::fabs(sum / values.size() - means[idx]) < 1e-9, __FILE__, __LINE__, "mean of group ", idx);
+            fails += platypus::testing::compare_equal(maximum, maxima[idx], __FILE__, __LINE__, "maximum of group ", idx);
+        }
+        results.push_back(means);
+    }
+    fails += platypus::testing::compare_equal(results[0].size(), results[1].size(), __FILE__, __LINE__, "results depend on number of threads");
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_small_table();
+    fails += check_large_table();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
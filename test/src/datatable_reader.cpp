@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <platypus/model/datatable.hpp>
+#include <platypus/parse/datatable.hpp>
+#include <platypus/utility/testing.hpp>
+#include "platypus_testing.hpp"
+
+int check_inference() {
+    int fails = 0;
+    std::string src = "id\tname\tlength\tflag\n"
+        "1\talpha\t0.5\t\n"
+        "-2\tbeta\t3\tyes\r\n"
+        "\n"
+        "30\tgamma\tnan\tno\n";
+    platypus::DataTable table;
+    platypus::DataTableReader reader;
+    reader.set_key_column_names({"id"});
+    fails += platypus::testing::compare_equal(3UL, reader.read_buffer(table, src), __FILE__, __LINE__, "rows read");
+    std::vector<std::string> names{"id", "name", "length", "flag"};
+    fails += platypus::testing::compare_equal(names, table.column_names(), __FILE__, __LINE__, "column names");
+    fails += platypus::testing::compare_equal(std::vector<std::string>{"id"}, table.key_column_names(), __FILE__, __LINE__, "key columns");
+    fails += platypus::testing::compare_equal(std::string("SignedInteger"),
+            platypus::DataTableColumn::get_value_type_name_as_string(table.column("id").get_value_type()), __FILE__, __LINE__, "integer column");
+    fails += platypus::testing::compare_equal(std::string("String"),
+            platypus::DataTableColumn::get_value_type_name_as_string(table.column("name").get_value_type()), __FILE__, __LINE__, "string column");
+    fails += platypus::testing::compare_equal(std::string("FloatingPoint"),
+            platypus::DataTableColumn::get_value_type_name_as_string(table.column("length").get_value_type()), __FILE__, __LINE__, "floating-point column");
+    fails += platypus::testing::compare_equal(std::vector<long>{1, -2, 30}, table.get_column<long>("id"), __FILE__, __LINE__, "integer values");
+    fails += platypus::testing::compare_equal(std::vector<std::string>{"", "yes", "no"}, table.get_column<std::string>("flag"), __FILE__, __LINE__, "string values");
+    fails += platypus::testing::compare_equal(true, std::isnan(table.get<double>(2, "length")), __FILE__, __LINE__, "NaN");
+
+    // schema, separator, no header
+    platypus::DataTable csv;
+    platypus::DataTableReader csv_reader(',', false);
+    csv_reader.set_column_type("column_1", platypus::DataTableColumn::ValueType::UnsignedInteger);
+    csv_reader.set_column_type("column_3", platypus::DataTableColumn::ValueType::String);
+    csv_reader.read(csv, std::istringstream("7,1.5,10\n8,2.25,11\n"));
+    fails += platypus::testing::compare_equal(std::string("UnsignedInteger"),
+            platypus::DataTableColumn::get_value_type_name_as_string(csv.column("column_1").get_value_type()), __FILE__, __LINE__, "schema type");
+    fails += platypus::testing::compare_equal(std::vector<double>{1.5, 2.25}, csv.get_column<double>("column_2"), __FILE__, __LINE__, "CSV values");
+    fails += platypus::testing::compare_equal(std::vector<std::string>{"10", "11"}, csv.get_column<std::string>("column_3"), __FILE__, __LINE__, "schema string column");
+
+    // values after the sampled rows that do not fit the inferred type
+    platypus::DataTable sampled;
+    platypus::DataTableReader sampling_reader;
+    sampling_reader.set_num_inference_rows(2);
+    try {
+        sampling_reader.read_buffer(sampled, "x\n1\n2\n3.5\n");
+        fails += platypus::testing::fail_test(__FILE__, __LINE__, "exception", "none", "value not of sampled type");
+    } catch (const platypus::DataTableReaderError & e) {
+        fails += platypus::testing::compare_equal(4UL, e.get_input_line_num(), __FILE__, __LINE__, "error line");
+    }
+    fails += platypus::testing::compare_equal(0UL, sampled.num_rows(), __FILE__, __LINE__, "no rows added on error");
+    try {
+        reader.read_buffer(sampled, "x\n1\t2\n");
+        fails += platypus::testing::fail_test(__FILE__, __LINE__, "exception", "none", "too many fields");
+    } catch (const platypus::DataTableReaderError &) {
+    }
+    try {
+        reader.read_buffer(sampled, "y\n1\n");
+        fails += platypus::testing::fail_test(__FILE__, __LINE__, "exception", "none", "unknown column");
+    } catch (const platypus::DataTableReaderError &) {
+    }
+    return fails;
+}
+
+int check_round_trip() {
+    int fails = 0;
+    platypus::DataTable table;
+    table.add_key_column<long>("replicate");
+    table.add_data_column<std::string>("model");
+    table.add_data_column<double>("length", {std::setprecision(17)});
+    const long num_rows = 120000;
+    for (long idx = 0; idx < num_rows; ++idx) {
+        table.add_row() << idx << (idx % 3 ? "bd" : "yule") << (idx * 0.1 - 7.3);
+    }
+    std::ostringstream out;
+    table.write(out);
+    std::string src = out.str();
+    fails += platypus::testing::compare_equal(true, src.size() > 2 * platypus::DataTableReader::MIN_BYTES_PER_CHUNK, __FILE__, __LINE__, "input large enough to split");
+    std::string path = "datatable_reader_test.tsv";
+    {
+        std::ofstream f(path);
+        f << src;
+    }
+    for (unsigned int num_threads : {1U, 4U}) {
+        platypus::DataTable copy;
+        copy.add_key_column<long>("replicate");
+        copy.add_data_column<std::string>("model");
+        copy.add_data_column<double>("length", {std::setprecision(17)});
+        platypus::DataTableReader reader;
+        // merging two inputs into one table
+        reader.read_file(copy, path, num_threads);
+        reader.read_buffer(copy, src, num_threads);
+        fails += platypus::testing::compare_equal(static_cast<unsigned long>(2 * num_rows), copy.num_rows(), __FILE__, __LINE__, "rows, threads: ", num_threads);
+        std::ostringstream copy_out;
+        copy.write(copy_out);
+        fails += platypus::testing::compare_equal(src + src.substr(src.find('\n') + 1), copy_out.str(), __FILE__, __LINE__, "round trip, threads: ", num_threads);
+
+        platypus::DataTable inferred;
+        reader.read_buffer(inferred, src, num_threads);
+        fails += platypus::testing::compare_equal(table.get_column<double>("length"), inferred.get_column<double>("length"), __FILE__, __LINE__, "inferred columns, threads: ", num_threads);
+    }
+    std::remove(path.c_str());
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_inference();
+    fails += check_round_trip();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,98 @@
+#include <stdlib.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <platypus/model/datatable.hpp>
+#include <platypus/utility/parallel.hpp>
+#include <platypus/utility/testing.hpp>
+#include "platypus_testing.hpp"
+
+void add_columns(platypus::DataTable & table) {
+    table.add_key_column<unsigned long>("replicate");
+    table.add_data_column<std::string>("label");
+    table.add_data_column<double>("length");
+}
+
+int check_shards() {
+    int fails = 0;
+    platypus::DataTable table;
+    add_columns(table);
+    table.add_row() << 0UL << "zero" << 0.5;
+    auto shard1 = table.create_shard();
+    auto shard2 = table.create_shard();
+    shard2.add_row() << 3UL << "three" << 3.5;
+    shard1.add_row() << 2UL << "two" << 2.5;
+    auto length = shard1.column_handle<double>("length");
+    auto row = shard1.add_row();
+    row.set("replicate", 1UL);
+    row.set("label", std::string("one"));
+    row.set(length, 1.5);
+    fails += platypus::testing::compare_equal(2UL, shard1.num_rows(), __FILE__, __LINE__, "shard rows");
+    fails += platypus::testing::compare_equal(1UL, table.num_rows(), __FILE__, __LINE__, "table rows before appending");
+
+    std::vector<platypus::DataTableShard> shards;
+    shards.push_back(std::move(shard1));
+    shards.push_back(std::move(shard2));
+    table.append_shards(shards);
+    fails += platypus::testing::compare_equal(std::vector<unsigned long>{0, 2, 1, 3}, table.get_column<unsigned long>("replicate"), __FILE__, __LINE__, "shard order");
+    fails += platypus::testing::compare_equal(0UL, shards[0].num_rows(), __FILE__, __LINE__, "appended shard is emptied");
+    fails += platypus::testing::compare_equal(std::string("one"), table.get<std::string>(2, "label"), __FILE__, __LINE__, "row access after appending");
+
+    shards[1].add_row() << 5UL << "five" << 5.5;
+    shards[0].add_row() << 4UL << "four" << 4.5;
+    table.append_shards(shards, "replicate");
+    fails += platypus::testing::compare_equal(std::vector<unsigned long>{0, 2, 1, 3, 4, 5}, table.get_column<unsigned long>("replicate"), __FILE__, __LINE__, "only appended rows are sorted");
+    fails += platypus::testing::compare_equal(std::vector<std::string>{"zero", "two", "one", "three", "four", "five"}, table.get_column<std::string>("label"), __FILE__, __LINE__, "sorted rows");
+
+    platypus::DataTable other;
+    other.add_data_column<double>("x");
+    auto mismatched = other.create_shard();
+    try {
+        table.append_shard(mismatched);
+        fails += platypus::testing::fail_test(__FILE__, __LINE__, "exception", "none", "mismatched columns");
+    } catch (const platypus::DataTableStructureError &) {
+    }
+    return fails;
+}
+
+int check_concurrent_appends() {
+    int fails = 0;
+    const unsigned long num_replicates = 20000;
+    const unsigned int num_threads = 4;
+    platypus::DataTable expected;
+    add_columns(expected);
+    for (unsigned long idx = 0; idx < num_replicates; ++idx) {
+        expected.add_row() << idx << ("t" + std::to_string(idx)) << idx * 0.25;
+    }
+    platypus::DataTable table;
+    add_columns(table);
+    std::vector<platypus::DataTableShard> shards;
+    for (unsigned int idx = 0; idx < num_threads; ++idx) {
+        shards.push_back(table.create_shard());
+    }
+    // replicates distributed round-robin, so each shard holds rows out of
+    // replicate order relative to the others
+    platypus::parallel_for(num_threads, num_threads, [&](std::size_t shard_idx) {
+        for (unsigned long idx = shard_idx; idx < num_replicates; idx += num_threads) {
+            shards[shard_idx].add_row() << idx << ("t" + std::to_string(idx)) << idx * 0.25;
+        }
+    });
+    table.append_shards(shards, "replicate");
+    std::ostringstream expected_out;
+    std::ostringstream observed_out;
+    expected.write(expected_out);
+    table.write(observed_out);
+    fails += platypus::testing::compare_equal(expected_out.str(), observed_out.str(), __FILE__, __LINE__, "concurrently appended table");
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_shards();
+    fails += check_concurrent_appends();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
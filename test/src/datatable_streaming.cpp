@@ -0,0 +1,68 @@
+#include <string>
+#include <sstream>
+#include <platypus/model/datatable.hpp>
+#include "platypus_testing.hpp"
+
+void add_columns(platypus::DataTable & table) {
+    table.add_key_column<std::string>("id");
+    table.add_data_column<long>("s");
+    table.add_data_column<double>("f", {std::fixed, std::setprecision(3)});
+    table.add_data_column<unsigned long>("hidden").set_hidden(true);
+}
+
+void fill_row(platypus::DataTable::Row & row, unsigned long i) {
+    row << ("replicate" + std::to_string(i)) << -static_cast<long>(i) << (i / 7.0) << i;
+}
+
+int main() {
+    int fails = 0;
+    const unsigned long num_rows = 5000;
+
+    platypus::DataTable reference;
+    add_columns(reference);
+    for (unsigned long i = 0; i < num_rows; ++i) {
+        fill_row(reference.add_row(), i);
+    }
+    std::ostringstream expected;
+    reference.write(expected);
+
+    for (int background = 0; background < 2; ++background) {
+        std::ostringstream out;
+        {
+            platypus::DataTable table;
+            add_columns(table);
+            table.begin_streaming(out, "\t", true, 1024, background != 0);
+            bool caught = false;
+            try {
+                table.add_data_column<double>("late");
+            } catch (const platypus::DataTableStructureError &) {
+                caught = true;
+            }
+            fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "column added while streaming");
+            for (unsigned long i = 0; i < num_rows; ++i) {
+                auto & row = table.add_row();
+                // partially filled rows are blank in untouched cells
+                if (i == 0) {
+                    fails += platypus::testing::compare_equal(std::string(""), row.get<std::string>("id"), __FILE__, __LINE__);
+                }
+                fill_row(row, i);
+                fails += platypus::testing::compare_equal(1UL, table.num_rows(), __FILE__, __LINE__, "rows held while streaming");
+            }
+            fails += platypus::testing::compare_equal(num_rows - 1, table.num_rows_streamed(), __FILE__, __LINE__);
+            if (background == 0) {
+                table.end_streaming();
+                fails += platypus::testing::compare_equal(num_rows, table.num_rows_streamed(), __FILE__, __LINE__);
+                fails += platypus::testing::compare_equal(0UL, table.num_rows(), __FILE__, __LINE__);
+                fails += platypus::testing::compare_equal(false, table.is_streaming(), __FILE__, __LINE__);
+            }
+            // otherwise, the last row is written when the table is destroyed
+        }
+        fails += platypus::testing::compare_equal(expected.str(), out.str(), __FILE__, __LINE__, "background: ", background);
+    }
+
+    if (fails != 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,172 @@
+#include <stdlib.h>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <platypus/model/datatable.hpp>
+#include <platypus/utility/testing.hpp>
+#include "platypus_testing.hpp"
+
+int check_small_table() {
+    int fails = 0;
+    platypus::DataTable table;
+    table.add_key_column<std::string>("model");
+    table.add_key_column<double>("rate");
+    table.add_data_column<long>("size");
+    table.add_data_column<double>("length");
+    std::vector<std::tuple<std::string, double, long, double>> rows{
+        std::make_tuple("bd", 0.5, 10L, 1.0),
+        std::make_tuple("yule", 0.5, 20L, 2.0),
+        std::make_tuple("bd", 0.25, 30L, 3.0),
+        std::make_tuple("bd", 0.5, 40L, 4.0),
+        std::make_tuple("yule", 0.25, 50L, 5.0),
+        std::make_tuple("bd", 0.5, 60L, 6.5),
+    };
+    for (auto & r : rows) {
+        table.add_row() << std::get<0>(r) << std::get<1>(r) << std::get<2>(r) << std::get<3>(r);
+    }
+
+    auto all = table.select();
+    fails += platypus::testing::compare_equal(6UL, all.num_rows(), __FILE__, __LINE__, "rows of unfiltered view");
+    fails += platypus::testing::compare_equal(table.column_names(), all.column_names(), __FILE__, __LINE__, "columns of unprojected view");
+
+    auto view = table.select({"model", "length"});
+    view.where<double>("rate", [](double v) { return v == 0.5; });
+    fails += platypus::testing::compare_equal(std::vector<unsigned long>{0, 1, 3, 5}, view.row_indexes(), __FILE__, __LINE__, "rows where rate is 0.5");
+    view.where([](const platypus::DataTable::Row & row) { return row.get<std::string>("model") == "bd"; });
+    fails += platypus::testing::compare_equal(std::vector<unsigned long>{0, 3, 5}, view.row_indexes(), __FILE__, __LINE__, "rows where model is also bd");
+    fails += platypus::testing::compare_equal(3UL, view.num_rows(), __FILE__, __LINE__, "rows selected");
+    fails += platypus::testing::compare_equal(2UL, view.num_columns(), __FILE__, __LINE__, "columns projected");
+    fails += platypus::testing::compare_equal(true, view.is_selected(3) && !view.is_selected(2) && !view.is_selected(1000), __FILE__, __LINE__, "is_selected()");
+    fails += platypus::testing::compare_equal(std::vector<long>{10, 40, 60}, view.get_column<long>("size"), __FILE__, __LINE__, "values of unprojected column");
+    fails += platypus::testing::compare_equal(6UL, table.num_rows(), __FILE__, __LINE__, "table modified by view");
+
+    auto summary = view.summarize_column("length");
+    fails += platypus::testing::compare_equal(3.0, summary.size, __FILE__, __LINE__, "summary size");
+    fails += platypus::testing::compare_equal(true, std::fabs(11.5 / 3 - summary.mean) < 1e-12, __FILE__, __LINE__, "summary mean");
+    fails += platypus::testing::compare_equal(6.5, summary.maximum, __FILE__, __LINE__, "summary maximum");
+
+    // as written by a table holding only the selected rows and columns
+    {
+        platypus::DataTable expected_table;
+        expected_table.add_key_column<std::string>("model");
+        expected_table.add_data_column<double>("length");
+        for (auto row_idx : view.row_indexes()) {
+            expected_table.add_row() << table.get<std::string>(row_idx, "model") << table.get<double>(row_idx, "length");
+        }
+        std::ostringstream expected;
+        expected_table.write(expected);
+        std::ostringstream observed;
+        view.write(observed);
+        fails += platypus::testing::compare_equal(expected.str(), observed.str(), __FILE__, __LINE__, "written view");
+        std::ostringstream no_header;
+        view.write(no_header, ",", false);
+        fails += platypus::testing::compare_equal(std::string("bd,1\nbd,4\nbd,6.5\n"), no_header.str(), __FILE__, __LINE__, "written view without header");
+    }
+
+    // grouping the selected rows only; the projection gives the data columns
+    {
+        auto groups = table.select({"model", "rate", "length"})
+            .where<long>("size", [](long v) { return v >= 20; })
+            .group_by();
+        fails += platypus::testing::compare_equal(4UL, static_cast<unsigned long>(groups.num_groups()), __FILE__, __LINE__, "number of groups");
+        std::vector<std::size_t> expected_groups{platypus::DataTableGroups::npos(), 0, 1, 2, 3, 2};
+        fails += platypus::testing::compare_equal(expected_groups, groups.row_groups(), __FILE__, __LINE__, "row groups");
+        platypus::DataTable grouped;
+        groups.summarize<double>(grouped);
+        std::vector<std::string> expected_columns{"model", "rate", "count", "length_mean", "length_variance", "length_min", "length_max"};
+        fails += platypus::testing::compare_equal(expected_columns, grouped.column_names(), __FILE__, __LINE__, "summary columns");
+        fails += platypus::testing::compare_equal(std::vector<unsigned long>{1, 1, 2, 1}, grouped.get_column<unsigned long>("count"), __FILE__, __LINE__, "counts");
+        fails += platypus::testing::compare_equal(std::vector<double>{2.0, 3.0, 5.25, 5.0}, grouped.get_column<double>("length_mean"), __FILE__, __LINE__, "means");
+    }
+
+    try {
+        table.select({"undefined"});
+        fails += platypus::testing::fail_test(__FILE__, __LINE__, "exception", "none", "undefined projected column");
+    } catch (const platypus::DataTableUndefinedColumnError &) {
+    }
+    try {
+        table.select().where<double>("undefined", [](double) { return true; });
+        fails += platypus::testing::fail_test(__FILE__, __LINE__, "exception", "none", "undefined filtered column");
+    } catch (const platypus::DataTableUndefinedColumnError &) {
+    }
+
+    // no rows
+    {
+        platypus::DataTable empty;
+        empty.add_data_column<double>("x");
+        auto empty_view = empty.select().where<double>("x", [](double v) { return v > 0; });
+        fails += platypus::testing::compare_equal(0UL, empty_view.num_rows(), __FILE__, __LINE__, "rows of empty view");
+        fails += platypus::testing::compare_equal(0.0, empty_view.summarize_column("x").size, __FILE__, __LINE__, "summary of empty view");
+    }
+    return fails;
+}
+
+int check_large_table() {
+    int fails = 0;
+    platypus::DataTable table;
+    table.add_data_column<unsigned long>("replicate");
+    table.add_key_column<double>("birth_rate");
+    table.add_data_column<double>("value");
+    const unsigned long num_rows = 200003;
+    std::vector<unsigned long> expected_rows;
+    double expected_sum = 0.0;
+    unsigned long state = 7;
+    for (unsigned long idx = 0; idx < num_rows; ++idx) {
+        state = state * 6364136223846793005UL + 1442695040888963407UL;
+        double birth_rate = static_cast<double>((state >> 40) % 10) / 10.0;
+        double value = static_cast<double>((state >> 20) % 1000) / 4.0;
+        table.add_row() << idx << birth_rate << value;
+        if (birth_rate > 0.25 && birth_rate < 0.75 && value < 100.0) {
+            expected_rows.push_back(idx);
+            expected_sum += value;
+        }
+    }
+    std::vector<std::vector<double>> group_means;
+    for (unsigned int num_threads : {1U, 4U}) {
+        auto view = table.select({"birth_rate", "value"})
+            .where<double>("birth_rate", [](double v) { return v > 0.25 && v < 0.75; }, num_threads)
+            .where<double>("value", [](double v) { return v < 100.0; }, num_threads);
+        fails += platypus::testing::compare_equal(static_cast<unsigned long>(expected_rows.size()), view.num_rows(), __FILE__, __LINE__, "rows selected, threads: ", num_threads);
+        fails += platypus::testing::compare_equal(expected_rows, view.row_indexes(), __FILE__, __LINE__, "rows selected, threads: ", num_threads);
+        // a row predicate selecting every other remaining row
+        auto odd_view = view;
+        odd_view.where([](const platypus::DataTable::Row & row) { return row.get<unsigned long>("replicate") % 2 == 1; }, num_threads);
+        unsigned long num_odd = 0;
+        for (auto row_idx : expected_rows) {
+            num_odd += row_idx % 2;
+        }
+        fails += platypus::testing::compare_equal(num_odd, odd_view.num_rows(), __FILE__, __LINE__, "odd rows selected, threads: ", num_threads);
+        fails += platypus::testing::compare_equal(static_cast<unsigned long>(expected_rows.size()), view.num_rows(), __FILE__, __LINE__, "copied view filtered");
+
+        auto summary = view.summarize_column("value", num_threads);
+        fails += platypus::testing::compare_equal(static_cast<double>(expected_rows.size()), summary.size, __FILE__, __LINE__, "summary size, threads: ", num_threads);
+        fails += platypus::testing::compare_equal(true, std::fabs(expected_sum / expected_rows.size() - summary.mean) < 1e-9, __FILE__, __LINE__,
+                "summary mean, threads: ", num_threads);
+
+        platypus::DataTable grouped;
+        view.group_by({}, num_threads).summarize<double>(grouped, {}, num_threads);
+        // birth rates of 0.3 to 0.7
+        fails += platypus::testing::compare_equal(5UL, grouped.num_rows(), __FILE__, __LINE__, "groups, threads: ", num_threads);
+        unsigned long num_grouped = 0;
+        for (auto count : grouped.get_column<unsigned long>("count")) {
+            num_grouped += count;
+        }
+        fails += platypus::testing::compare_equal(static_cast<unsigned long>(expected_rows.size()), num_grouped, __FILE__, __LINE__, "rows grouped, threads: ", num_threads);
+        group_means.push_back(grouped.get_column<double>("value_mean"));
+    }
+    fails += platypus::testing::compare_equal(group_means[0].size(), group_means[1].size(), __FILE__, __LINE__, "groups depend on number of threads");
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_small_table();
+    fails += check_large_table();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,176 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include <platypus/model/parsimony.hpp>
+#include <platypus/model/treepattern.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree TreeType;
+typedef TreeType::node_type NodeType;
+
+// Straightforward recursive Fitch parsimony, for reference.
+template <class MatrixT, class TaxonIndexFnT>
+unsigned long reference_score(const NodeType * nd,
+        const MatrixT & matrix,
+        TaxonIndexFnT taxon_index_fn,
+        std::vector<typename MatrixT::state_set_type> & sets) {
+    sets.assign(matrix.num_sites(), matrix.get_all_states_set());
+    if (nd->is_leaf()) {
+        std::size_t row = matrix.find_row(taxon_index_fn(nd->value()));
+        if (row != MatrixT::npos()) {
+            for (std::size_t site = 0; site < matrix.num_sites(); ++site) {
+                sets[site] = matrix.get_state_set(row, site);
+            }
+        }
+        return 0;
+    }
+    unsigned long score = 0;
+    bool is_first = true;
+    std::vector<typename MatrixT::state_set_type> child_sets;
+    for (auto ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+        score += reference_score(ch, matrix, taxon_index_fn, child_sets);
+        for (std::size_t site = 0; site < matrix.num_sites(); ++site) {
+            if (is_first) {
+                sets[site] = child_sets[site];
+            } else if ((sets[site] & child_sets[site]) == 0) {
+                sets[site] |= child_sets[site];
+                score += matrix.get_pattern_weight(site);
+            } else {
+                sets[site] &= child_sets[site];
+            }
+        }
+        is_first = false;
+    }
+    return score;
+}
+
+int check_small_trees() {
+    int fails = 0;
+    platypus::TaxonNamespace taxa;
+    platypus::NucleotideCharacterMatrix matrix(platypus::CharacterStateAlphabet::dna(), &taxa);
+    matrix.add_sequence("a", "AAACA");
+    matrix.add_sequence("b", "AAGCC");
+    matrix.add_sequence("c", "ACGCA");
+    matrix.add_sequence("d", "CCGTC");
+    matrix.add_sequence("x", "ACGTA");
+    auto taxon_index_fn = [&taxa] (const TestData & nv) { return taxa.find_taxon(nv.get_label()); };
+    platypus::FitchParsimony<std::uint8_t> scorer(matrix);
+    std::vector<std::pair<std::string, unsigned long>> cases{
+        {"((a,b),(c,d));", 6},
+        {"((a,c),(b,d));", 6},
+        {"(a,(b,(c,d)));", 6},
+        {"(a,b,c,d);", 6},
+        {"((a,b),(c,(d,e)));", 6},  // e has no row
+        {"(a,b);", 2},
+        {"((a,(b)),(c,d));", 6},
+        {"(a);", 0},
+    };
+    for (auto & c : cases) {
+        TreeType tree = read_tree(c.first, true);
+        fails += platypus::testing::compare_equal(c.second, static_cast<unsigned long>(scorer.score(tree, taxon_index_fn)), __FILE__, __LINE__, c.first);
+    }
+    return fails;
+}
+
+TreeType random_tree(std::size_t num_taxa, std::mt19937 & rng) {
+    std::vector<TestData> labels;
+    for (std::size_t taxon = 0; taxon < num_taxa; ++taxon) {
+        labels.push_back(TestData("t" + std::to_string(taxon)));
+    }
+    std::shuffle(labels.begin(), labels.end(), rng);
+    TreeType tree;
+    tree.set_node_recycling(true);
+    if (rng() % 2) {
+        platypus::build_maximally_balanced_tree(tree, labels.begin(), labels.end());
+    } else {
+        platypus::build_maximally_unbalanced_tree(tree, labels.begin(), labels.end());
+    }
+    return tree;
+}
+
+int check_random_trees() {
+    int fails = 0;
+    std::mt19937 rng(42);
+    const std::size_t num_taxa = 40;
+    platypus::TaxonNamespace taxa;
+    platypus::NucleotideCharacterMatrix matrix(platypus::CharacterStateAlphabet::dna(), &taxa);
+    add_random_sequences(matrix, num_taxa, 250, rng, "ACGTNR", 3);
+    platypus::NucleotideCharacterMatrix compressed(matrix);
+    compressed.compress_patterns();
+    auto taxon_index_fn = [&taxa] (const TestData & nv) { return taxa.find_taxon(nv.get_label()); };
+
+    std::vector<TreeType> trees;
+    for (int idx = 0; idx < 25; ++idx) {
+        trees.push_back(random_tree(num_taxa, rng));
+    }
+    platypus::FitchParsimony<std::uint8_t> scorer(matrix);
+    platypus::FitchParsimony<std::uint8_t> compressed_scorer(compressed);
+    std::vector<std::uint8_t> sets;
+    std::vector<std::uint64_t> expected;
+    for (auto & tree : trees) {
+        unsigned long reference = reference_score(tree.head_node(), matrix, taxon_index_fn, sets);
+        expected.push_back(reference);
+        fails += platypus::testing::compare_equal(reference, static_cast<unsigned long>(scorer.score(tree, taxon_index_fn)), __FILE__, __LINE__, "score");
+        fails += platypus::testing::compare_equal(reference, static_cast<unsigned long>(compressed_scorer.score(tree, taxon_index_fn)), __FILE__, __LINE__, "score on compressed patterns");
+    }
+    for (unsigned int num_threads : {1U, 4U}) {
+        auto scores = compressed_scorer.score_trees(trees.begin(), trees.end(), taxon_index_fn, num_threads);
+        fails += platypus::testing::compare_equal(expected, scores, __FILE__, __LINE__, "score_trees() with threads: ", num_threads);
+    }
+    return fails;
+}
+
+int check_incremental() {
+    int fails = 0;
+    std::mt19937 rng(7);
+    const std::size_t num_taxa = 30;
+    platypus::TaxonNamespace taxa;
+    platypus::NucleotideCharacterMatrix matrix(platypus::CharacterStateAlphabet::dna(), &taxa);
+    add_random_sequences(matrix, num_taxa, 100, rng, "ACGTNR", 3);
+    matrix.compress_patterns();
+    auto taxon_index_fn = [&taxa] (const TestData & nv) { return taxa.find_taxon(nv.get_label()); };
+
+    TreeType tree = random_tree(num_taxa, rng);
+    platypus::FitchParsimony<std::uint8_t> scorer(matrix);
+    platypus::IncrementalFitchParsimony<TreeType, std::uint8_t> incremental(matrix, taxon_index_fn);
+    fails += platypus::testing::compare_equal(scorer.score(tree, taxon_index_fn), incremental.score(tree), __FILE__, __LINE__, "initial score");
+    for (int move = 0; move < 200; ++move) {
+        // a subtree whose parent is not the head node, and a target outside it
+        std::vector<NodeType *> nodes;
+        for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+            if (ndi.node() != tree.head_node() && ndi.node()->parent_node() != tree.head_node()) {
+                nodes.push_back(ndi.node());
+            }
+        }
+        NodeType * nd = nodes[rng() % nodes.size()];
+        NodeType * grandparent = nd->parent_node()->parent_node();
+        tree.prune_subtree(nd);
+        std::vector<NodeType *> targets;
+        for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+            targets.push_back(ndi.node());
+        }
+        NodeType * new_node = tree.regraft(nd, targets[rng() % targets.size()]);
+        std::uint64_t rescored = incremental.rescore(tree, {grandparent, new_node});
+        fails += platypus::testing::compare_equal(scorer.score(tree, taxon_index_fn), rescored, __FILE__, __LINE__, "rescore() after move ", move);
+        fails += platypus::testing::compare_equal(rescored, incremental.get_score(), __FILE__, __LINE__, "get_score()");
+    }
+    fails += platypus::testing::compare_equal(scorer.score(tree, taxon_index_fn), incremental.score(tree), __FILE__, __LINE__, "final score");
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_small_trees();
+    fails += check_random_trees();
+    fails += check_incremental();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,151 @@
+#include <sstream>
+#include <map>
+#include <platypus/model/flattree.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::FlatTree<double> FlatTreeType;
+
+int check_flat_tree(const TestDataTree & tree, const FlatTreeType & flat_tree, const std::string & remarks) {
+    int fails = 0;
+    // preorder: compare labels, edge lengths, parents and child counts
+    std::map<const TestDataTree::node_type *, FlatTreeType::index_type> node_index;
+    std::vector<std::string> expected_labels;
+    std::vector<double> expected_edge_lengths;
+    std::vector<FlatTreeType::index_type> expected_parents;
+    std::vector<FlatTreeType::index_type> expected_num_children;
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        FlatTreeType::index_type idx = expected_labels.size();
+        node_index[ndi.node()] = idx;
+        expected_labels.push_back(ndi->get_label());
+        expected_edge_lengths.push_back(ndi->get_edge_length());
+        if (idx == 0) {
+            expected_parents.push_back(FlatTreeType::npos);
+        } else {
+            expected_parents.push_back(node_index[ndi.parent_node()]);
+        }
+        FlatTreeType::index_type num_children = 0;
+        for (auto chi = tree.children_begin(ndi); chi != tree.children_end(ndi); ++chi) {
+            ++num_children;
+        }
+        expected_num_children.push_back(num_children);
+    }
+    fails += platypus::testing::compare_equal(expected_labels, flat_tree.labels(), __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(expected_edge_lengths, flat_tree.edge_lengths(), __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(expected_parents, flat_tree.parents(), __FILE__, __LINE__, remarks);
+    std::vector<FlatTreeType::index_type> observed_num_children;
+    std::vector<FlatTreeType::index_type> observed_preorder;
+    for (auto nd = flat_tree.preorder_begin(); nd != flat_tree.preorder_end(); ++nd) {
+        observed_num_children.push_back(flat_tree.num_children(*nd));
+        observed_preorder.push_back(*nd);
+        // children are linked in order, and are all in the subtree range
+        FlatTreeType::index_type expected_child = *nd + 1;
+        for (auto ch = flat_tree.first_child(*nd); ch != FlatTreeType::npos; ch = flat_tree.next_sibling(ch)) {
+            fails += platypus::testing::compare_equal(expected_child, ch, __FILE__, __LINE__, remarks);
+            fails += platypus::testing::compare_equal(*nd, flat_tree.parent(ch), __FILE__, __LINE__, remarks);
+            expected_child = flat_tree.subtree_end(ch);
+        }
+        fails += platypus::testing::compare_equal(flat_tree.subtree_end(*nd), expected_child, __FILE__, __LINE__, remarks);
+        fails += platypus::testing::compare_equal(flat_tree.is_leaf(*nd), flat_tree.num_children(*nd) == 0, __FILE__, __LINE__, remarks);
+    }
+    fails += platypus::testing::compare_equal(expected_num_children, observed_num_children, __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(expected_labels.size(), observed_preorder.size(), __FILE__, __LINE__, remarks);
+
+    // postorder
+    std::vector<std::string> expected_postorder;
+    for (auto ndi = tree.postorder_begin(); ndi != tree.postorder_end(); ++ndi) {
+        expected_postorder.push_back(ndi->get_label());
+    }
+    std::vector<std::string> observed_postorder;
+    for (auto nd = flat_tree.postorder_begin(); nd != flat_tree.postorder_end(); ++nd) {
+        observed_postorder.push_back(flat_tree.label(*nd));
+    }
+    fails += platypus::testing::compare_equal(expected_postorder, observed_postorder, __FILE__, __LINE__, remarks);
+
+    // leaves
+    std::vector<std::string> expected_leaves;
+    for (auto ndi = tree.leaf_begin(); ndi != tree.leaf_end(); ++ndi) {
+        expected_leaves.push_back(ndi->get_label());
+    }
+    std::vector<std::string> observed_leaves;
+    for (auto nd = flat_tree.leaf_begin(); nd != flat_tree.leaf_end(); ++nd) {
+        observed_leaves.push_back(flat_tree.label(*nd));
+    }
+    fails += platypus::testing::compare_equal(expected_leaves, observed_leaves, __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(expected_leaves.size(), flat_tree.num_leaves(), __FILE__, __LINE__, remarks);
+
+    // leaves of every subtree
+    FlatTreeType::index_type idx = 0;
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi, ++idx) {
+        std::vector<std::string> expected_subtree_leaves;
+        if (ndi.is_leaf()) {
+            expected_subtree_leaves.push_back(ndi->get_label());
+        } else {
+            for (auto leaf = tree.leaf_begin(ndi); leaf != tree.leaf_end(ndi); ++leaf) {
+                expected_subtree_leaves.push_back(leaf->get_label());
+            }
+        }
+        std::vector<std::string> observed_subtree_leaves;
+        for (auto nd = flat_tree.leaf_begin(idx); nd != flat_tree.leaf_end(idx); ++nd) {
+            observed_subtree_leaves.push_back(flat_tree.label(*nd));
+            fails += platypus::testing::compare_equal(true, flat_tree.is_in_subtree(*nd, idx), __FILE__, __LINE__, remarks);
+        }
+        fails += platypus::testing::compare_equal(expected_subtree_leaves, observed_subtree_leaves, __FILE__, __LINE__, remarks);
+        fails += platypus::testing::compare_equal(expected_subtree_leaves.size(), flat_tree.num_leaves(idx), __FILE__, __LINE__, remarks);
+        fails += platypus::testing::compare_equal(flat_tree.leaf_begin(idx) - flat_tree.leaf_begin(), static_cast<std::ptrdiff_t>(flat_tree.leaf_offset(idx)), __FILE__, __LINE__, remarks);
+    }
+    return fails;
+}
+
+int main () {
+    int fails = 0;
+
+    std::string src = STANDARD_TEST_TREE_NEWICK;
+    src += "\n(a:1,(b:2,c:3,d:4)e:5,f:6)g:7;\n(a:1)b:2;\n((((a:1)b:2)c:3)d:4)e:5;";
+    auto trees = get_test_data_tree_vector_from_string<TestDataTree>(src);
+    for (unsigned long i = 0; i < trees.size(); ++i) {
+        auto flat_tree = build_flat_tree(trees[i]);
+        std::ostringstream remarks;
+        remarks << "tree " << i;
+        fails += check_flat_tree(trees[i], flat_tree, remarks.str());
+    }
+
+    // subtree ranges
+    auto flat_tree = build_flat_tree(trees[1]);
+    fails += platypus::testing::compare_equal(7UL, flat_tree.size(), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(std::string("e"), flat_tree.label(2), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(4UL, flat_tree.subtree_size(2), __FILE__, __LINE__);
+    std::vector<std::string> subtree_labels;
+    for (auto nd = flat_tree.preorder_begin(2); nd != flat_tree.preorder_end(2); ++nd) {
+        subtree_labels.push_back(flat_tree.label(*nd));
+    }
+    fails += platypus::testing::compare_equal(std::vector<std::string>{"e", "b", "c", "d"}, subtree_labels, __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(true, flat_tree.is_in_subtree(3, 2), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(true, flat_tree.is_in_subtree(2, 2), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(false, flat_tree.is_in_subtree(1, 2), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(false, flat_tree.is_in_subtree(6, 2), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(3UL, flat_tree.num_leaves(2), __FILE__, __LINE__);
+
+    // missing getters
+    FlatTreeType bare(trees[1], nullptr, nullptr);
+    fails += platypus::testing::compare_equal(std::string(""), bare.label(1), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(0.0, bare.edge_length(1), __FILE__, __LINE__);
+
+    // built for each tree as it is read
+    auto tree_reader = get_test_data_tree_newick_reader<TestDataTree>();
+    std::vector<FlatTreeType> flat_trees;
+    tree_reader.read_each(std::istringstream(src), [&flat_trees](TestDataTree & tree, unsigned long) {
+        flat_trees.push_back(build_flat_tree(tree));
+    });
+    fails += platypus::testing::compare_equal(trees.size(), flat_trees.size(), __FILE__, __LINE__);
+    for (unsigned long i = 0; i < trees.size() && i < flat_trees.size(); ++i) {
+        fails += check_flat_tree(trees[i], flat_trees[i], "read_each");
+    }
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,129 @@
+#include <sstream>
+#include <zlib.h>
+#include <platypus/parse/newick.hpp>
+#include <platypus/serialize/newick.hpp>
+#include <platypus/utility/gzipstream.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+std::string gzip_compress(const std::string & src) {
+    std::ostringstream dest;
+    platypus::GzipOutputStream gz(dest);
+    gz << src;
+    gz.close();
+    return dest.str();
+}
+
+std::string gzip_decompress(const std::string & src, std::size_t chunk_size) {
+    std::istringstream compressed(src);
+    platypus::GzipInputStream gz(compressed, chunk_size, 2);
+    std::ostringstream dest;
+    dest << gz.rdbuf();
+    return dest.str();
+}
+
+int main() {
+    int fails = 0;
+
+    std::ostringstream o;
+    unsigned long num_trees = 500;
+    for (unsigned long i = 0; i < num_trees; ++i) {
+        o << "[" << i << "] " << STANDARD_TEST_TREE_NEWICK << "\n";
+    }
+    std::string src = o.str();
+
+    // round trip, with chunks smaller than the data
+    std::string compressed = gzip_compress(src);
+    fails += platypus::testing::compare_equal(true, compressed.size() < src.size(), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(0x1f, static_cast<unsigned char>(compressed[0]), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(0x8b, static_cast<unsigned char>(compressed[1]), __FILE__, __LINE__);
+    for (std::size_t chunk_size : {7, 1000, 262144}) {
+        fails += platypus::testing::compare_equal(src, gzip_decompress(compressed, chunk_size), __FILE__, __LINE__, "round trip");
+    }
+
+    // compatible with zlib's own gzip implementation
+    {
+        std::vector<Bytef> raw(src.size() + 1024);
+        z_stream zs;
+        zs.zalloc = Z_NULL;
+        zs.zfree = Z_NULL;
+        zs.opaque = Z_NULL;
+        deflateInit2(&zs, 9, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+        zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(src.data()));
+        zs.avail_in = static_cast<uInt>(src.size());
+        zs.next_out = raw.data();
+        zs.avail_out = static_cast<uInt>(raw.size());
+        deflate(&zs, Z_FINISH);
+        std::string zlib_compressed(reinterpret_cast<char *>(raw.data()), raw.size() - zs.avail_out);
+        deflateEnd(&zs);
+        fails += platypus::testing::compare_equal(src, gzip_decompress(zlib_compressed, 4096), __FILE__, __LINE__, "zlib-compressed");
+    }
+
+    // concatenated members
+    fails += platypus::testing::compare_equal(src + src, gzip_decompress(compressed + compressed, 1000), __FILE__, __LINE__, "concatenated");
+
+    // uncompressed data passes through
+    fails += platypus::testing::compare_equal(src, gzip_decompress(src, 1000), __FILE__, __LINE__, "uncompressed");
+    fails += platypus::testing::compare_equal(std::string(), gzip_decompress(std::string(), 1000), __FILE__, __LINE__, "empty");
+
+    // trees read from compressed source
+    auto tree_reader = get_test_data_tree_newick_reader<TestDataTree>();
+    std::vector<TestDataTree> trees;
+    auto tree_factory = [&trees]() -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+    {
+        std::istringstream compressed_src(compressed);
+        platypus::GzipInputStream gz(compressed_src, 1000);
+        tree_reader.read(gz, tree_factory);
+    }
+    fails += platypus::testing::compare_equal(num_trees, trees.size(), __FILE__, __LINE__);
+    for (auto & tree : trees) {
+        fails += compare_against_standard_test_tree(tree);
+    }
+
+    // trees written to compressed destination
+    auto tree_writer = get_standard_newick_writer<TestDataTree>(false);
+    std::ostringstream formatted;
+    tree_writer.write(formatted, trees.begin(), trees.end());
+    std::ostringstream compressed_dest;
+    {
+        platypus::GzipOutputStream gz(compressed_dest, 1, 100);
+        tree_writer.write(gz, trees.begin(), trees.end());
+        // completed on destruction
+    }
+    fails += platypus::testing::compare_equal(formatted.str(), gzip_decompress(compressed_dest.str(), 1000), __FILE__, __LINE__, "written");
+
+    // corrupt and truncated data are errors
+    std::string corrupt = compressed;
+    for (std::size_t idx = 20; idx < 60; ++idx) {
+        corrupt[idx] = static_cast<char>(corrupt[idx] ^ 0x5a);
+    }
+    for (const std::string & bad : {corrupt, compressed.substr(0, compressed.size() / 2)}) {
+        bool caught = false;
+        try {
+            trees.clear();
+            std::istringstream bad_src(bad);
+            platypus::GzipInputStream gz(bad_src, 1000);
+            tree_reader.read(gz, tree_factory);
+        } catch (const platypus::GzipStreamError &) {
+            caught = true;
+        } catch (const platypus::NewickReaderException &) {
+            // corrupt data may decompress into a malformed tree first
+            caught = true;
+        }
+        fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "bad data");
+    }
+
+    // early destruction stops the decompressor
+    {
+        std::istringstream compressed_src(compressed);
+        platypus::GzipInputStream gz(compressed_src, 7, 1);
+        gz.get();
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
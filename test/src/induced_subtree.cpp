@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include <platypus/model/inducedsubtree.hpp>
+#include <platypus/model/treenodearena.hpp>
+#include <platypus/model/treepattern.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree TreeType;
+typedef TreeType::node_type NodeType;
+
+class ArenaTree : public platypus::Tree<TestData, platypus::TreeNodeArena<NodeType>> {
+    public:
+        bool is_rooted() const {
+            return true;
+        }
+};
+
+// the induced subtree by pruning one leaf at a time from a copy
+TreeType reference_subtree(const TreeType & tree, const platypus::InducedSubtree & subset) {
+    TreeType result;
+    result.deep_copy_from(tree);
+    std::vector<NodeType *> removed;
+    for (auto ndi = result.leaf_begin(); ndi != result.leaf_end(); ++ndi) {
+        if (!subset.contains(get_taxon_index(*ndi))) {
+            removed.push_back(ndi.node());
+        }
+    }
+    for (auto nd : removed) {
+        if (nd->parent_node() != nullptr) {
+            result.prune_subtree(nd, get_edge_length, set_edge_length);
+        }
+    }
+    result.collapse_unifurcations(get_edge_length, set_edge_length);
+    return result;
+}
+
+int check_small_trees() {
+    int fails = 0;
+    auto writer = get_standard_newick_writer<TreeType>();
+    auto arena_writer = get_standard_newick_writer<ArenaTree>();
+    std::vector<std::pair<std::vector<std::size_t>, std::string>> cases{
+        // i, j, l
+        {{8, 9, 11}, "[&R] ((i:1.000000, j:6.000000)b:5.000000, l:28.000000)a:15.000000;"},
+        {{8}, "[&R] (i:6.000000)a:15.000000;"},
+        {{}, "[&R] a:15.000000;"},
+        // n, o, p
+        {{13, 14, 15}, "[&R] (n:9.000000, (o:10.000000, p:11.000000)h:12.000000)a:42.000000;"},
+        {{8, 9, 10, 11, 12, 13, 14, 15}, ""},
+    };
+    for (auto & c : cases) {
+        platypus::InducedSubtree subset(c.first);
+        TreeType tree = read_tree(STANDARD_TEST_TREE_WEDGE_NEWICK);
+        std::string expected = c.second.empty() ? writer.format(tree) : c.second;
+        ArenaTree extracted;
+        unsigned long num_kept = subset.extract(tree, extracted, get_taxon_index, copy_value, get_edge_length, set_edge_length);
+        fails += platypus::testing::compare_equal(expected, arena_writer.format(extracted), __FILE__, __LINE__, "extract()");
+        fails += platypus::testing::compare_equal(static_cast<unsigned long>(subset.size()), num_kept, __FILE__, __LINE__, "extract() leaves kept");
+        if (subset.size() > 0) {
+            fails += platypus::testing::compare_equal(expected, writer.format(reference_subtree(tree, subset)), __FILE__, __LINE__, "reference");
+        }
+        num_kept = subset.restrict(tree, get_taxon_index, get_edge_length, set_edge_length);
+        fails += platypus::testing::compare_equal(expected, writer.format(tree), __FILE__, __LINE__, "restrict()");
+        fails += platypus::testing::compare_equal(static_cast<unsigned long>(subset.size()), num_kept, __FILE__, __LINE__, "restrict() leaves kept");
+    }
+    {
+        // topology only, with a unifurcation present in the source
+        platypus::InducedSubtree subset({0, 2, 3});
+        TreeType tree = read_tree("((a:1,b:1):1,((c:1):1,(d:1,e:1):1):1);");
+        auto topology_writer = get_standard_newick_writer<TreeType>(false);
+        TreeType extracted;
+        subset.extract(tree, extracted, get_taxon_index);
+        fails += platypus::testing::compare_equal(std::string("[&R] (a, (c, d));"), topology_writer.format(extracted), __FILE__, __LINE__, "extract() topology");
+        subset.restrict(tree, get_taxon_index);
+        fails += platypus::testing::compare_equal(std::string("[&R] (a, (c, d));"), topology_writer.format(tree), __FILE__, __LINE__, "restrict() topology");
+    }
+    return fails;
+}
+
+int check_random_trees() {
+    int fails = 0;
+    std::mt19937 rng(11);
+    const std::size_t num_taxa = 60;
+    std::vector<TreeType> trees;
+    for (int idx = 0; idx < 30; ++idx) {
+        std::vector<TestData> leaves;
+        for (std::size_t taxon = 0; taxon < num_taxa; ++taxon) {
+            if (rng() % 5 != 0) {
+                leaves.push_back(TestData("t" + std::to_string(taxon)));
+            }
+        }
+        std::shuffle(leaves.begin(), leaves.end(), rng);
+        TreeType tree;
+        if (idx % 2) {
+            platypus::build_maximally_balanced_tree(tree, leaves.begin(), leaves.end());
+        } else {
+            platypus::build_maximally_unbalanced_tree(tree, leaves.begin(), leaves.end());
+        }
+        for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+            ndi->set_edge_length(static_cast<double>(1 + rng() % 8));
+        }
+        trees.push_back(std::move(tree));
+    }
+    std::vector<std::size_t> taxa;
+    for (std::size_t taxon = 0; taxon < num_taxa + 5; taxon += 3) {
+        taxa.push_back(taxon);
+    }
+    platypus::InducedSubtree subset(taxa);
+    auto writer = get_standard_newick_writer<TreeType>();
+    auto arena_writer = get_standard_newick_writer<ArenaTree>();
+    std::vector<std::string> expected;
+    for (auto & tree : trees) {
+        expected.push_back(writer.format(reference_subtree(tree, subset)));
+    }
+    for (unsigned int num_threads : {1U, 4U}) {
+        std::vector<ArenaTree> extracted(trees.size());
+        auto num_extracted = subset.extract_trees(trees.begin(), trees.end(), extracted.begin(),
+                get_taxon_index, copy_value, get_edge_length, set_edge_length, num_threads);
+        std::vector<TreeType> restricted(trees.size());
+        for (std::size_t idx = 0; idx < trees.size(); ++idx) {
+            restricted[idx].deep_copy_from(trees[idx]);
+        }
+        auto num_restricted = subset.restrict_trees(restricted.begin(), restricted.end(),
+                get_taxon_index, get_edge_length, set_edge_length, num_threads);
+        for (std::size_t idx = 0; idx < trees.size(); ++idx) {
+            fails += platypus::testing::compare_equal(expected[idx], arena_writer.format(extracted[idx]), __FILE__, __LINE__,
+                    "extract_trees(), tree ", idx, ", threads: ", num_threads);
+            fails += platypus::testing::compare_equal(expected[idx], writer.format(restricted[idx]), __FILE__, __LINE__,
+                    "restrict_trees(), tree ", idx, ", threads: ", num_threads);
+            fails += platypus::testing::compare_equal(restricted[idx].get_num_leaves(), num_restricted[idx], __FILE__, __LINE__, "leaves kept");
+            fails += platypus::testing::compare_equal(num_restricted[idx], num_extracted[idx], __FILE__, __LINE__, "leaves kept");
+        }
+    }
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_small_trees();
+    fails += check_random_trees();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,123 @@
+#define PLATYPUS_ENABLE_INSTRUMENTATION
+#include <sstream>
+#include <platypus/parse/newick.hpp>
+#include <platypus/serialize/newick.hpp>
+#include <platypus/model/coalescent.hpp>
+#include <platypus/model/datatable.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+int check_reader_stats(const platypus::InstrumentationStats & stats,
+        unsigned long num_trees,
+        unsigned long num_bytes,
+        const std::string & remarks) {
+    int fails = 0;
+    // each tree: "[&R] [n] ((a:1, b:2)c, (d, e)f)g;"
+    fails += platypus::testing::compare_equal(num_trees, stats.num_trees, __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(num_trees * 7, stats.num_nodes, __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(num_bytes, stats.num_bytes_read, __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(num_trees * 21, stats.num_tokens, __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(num_trees * 2, stats.num_comments, __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(true, stats.build_seconds >= 0.0, __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(0UL, stats.num_bytes_written, __FILE__, __LINE__, remarks);
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += platypus::testing::compare_equal(true, platypus::InstrumentationStats::is_enabled(), __FILE__, __LINE__);
+
+    std::ostringstream o;
+    unsigned long num_trees = 50;
+    for (unsigned long i = 0; i < num_trees; ++i) {
+        o << "[&R] [" << i << "] ((a:1, b:2)c, (d, e)f)g;\n";
+    }
+    std::string src = o.str();
+
+    auto tree_reader = get_test_data_tree_newick_reader<TestDataTree>();
+    tree_reader.set_capture_comments(true);
+    unsigned long num_postprocessed = 0;
+    tree_reader.set_tree_postprocess_fn([&num_postprocessed](TestDataTree &, unsigned long, unsigned long, unsigned long, double) {
+        ++num_postprocessed;
+    });
+    std::vector<TestDataTree> trees;
+    auto tree_factory = [&trees]() -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+
+    // stream
+    tree_reader.read(std::istringstream(src), tree_factory);
+    fails += check_reader_stats(tree_reader.get_stats(), num_trees, src.size(), "stream");
+    fails += platypus::testing::compare_equal(num_trees, num_postprocessed, __FILE__, __LINE__);
+
+    // buffer
+    tree_reader.reset_stats();
+    fails += platypus::testing::compare_equal(0UL, tree_reader.get_stats().num_trees, __FILE__, __LINE__);
+    tree_reader.read_buffer(src, tree_factory);
+    fails += check_reader_stats(tree_reader.get_stats(), num_trees, src.size(), "buffer");
+
+    // parallel
+    for (unsigned int num_threads : {1, 4}) {
+        tree_reader.reset_stats();
+        tree_reader.read_parallel(src, tree_factory, num_threads);
+        fails += check_reader_stats(tree_reader.get_stats(), num_trees, src.size(), "parallel");
+    }
+
+    // accumulation
+    platypus::InstrumentationStats total;
+    total += tree_reader.get_stats();
+    total += tree_reader.get_stats();
+    fails += platypus::testing::compare_equal(2 * num_trees, total.num_trees, __FILE__, __LINE__);
+
+    // writer
+    trees.resize(num_trees);
+    platypus::NewickWriter<TestDataTree> writer = get_standard_newick_writer<TestDataTree>();
+    std::ostringstream out;
+    writer.write(out, trees.cbegin(), trees.cend());
+    writer.write(out, trees.front());
+    fails += platypus::testing::compare_equal(num_trees + 1, writer.get_stats().num_trees, __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(static_cast<unsigned long>(out.str().size()), writer.get_stats().num_bytes_written, __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(true, writer.get_stats().write_seconds >= 0.0, __FILE__, __LINE__);
+
+    // simulator
+    platypus::numeric::RandomNumberGenerator rng(1);
+    TestDataTree sim_tree;
+    platypus::coalescent::BasicCoalescentSimulator<TestDataTree> simulator(rng,
+            [&sim_tree]() -> TestDataTree & { sim_tree.clear(); return sim_tree; },
+            [](TestDataTree & tree, bool is_rooted) { tree.set_is_rooted(is_rooted); },
+            [](TestData & nd, const std::string & label) { nd.set_label(label); },
+            [](TestData & nd, double edge_length) { nd.set_edge_length(edge_length); });
+    simulator.generate_fixed_pop_size_tree(10, 1000);
+    simulator.generate_fixed_pop_size_tree(20, 1000);
+    fails += platypus::testing::compare_equal(2UL, simulator.get_stats().num_trees, __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(19UL + 39UL, simulator.get_stats().num_nodes, __FILE__, __LINE__);
+
+    // batches of Lambda-coalescent trees, whose multiple mergers leave
+    // fewer than 2n - 1 nodes
+    simulator.reset_stats();
+    auto rates = platypus::coalescent::LambdaCoalescentRates::beta(1.0, 30);
+    unsigned long num_built_nodes = 0;
+    simulator.generate_batch(12, 30, rates, 2, [&num_built_nodes] (TestDataTree & tree, unsigned long) {
+                for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+                    ++num_built_nodes;
+                }
+            }, 7);
+    fails += platypus::testing::compare_equal(12UL, simulator.get_stats().num_trees, __FILE__, __LINE__, "Lambda-coalescent batch");
+    fails += platypus::testing::compare_equal(true, num_built_nodes < 12UL * 59UL, __FILE__, __LINE__, "Lambda-coalescent batch multiple mergers");
+    fails += platypus::testing::compare_equal(num_built_nodes, simulator.get_stats().num_nodes, __FILE__, __LINE__, "Lambda-coalescent batch");
+
+    // reporting
+    platypus::DataTable table;
+    tree_reader.get_stats().export_table(table);
+    writer.get_stats().export_table(table);
+    fails += platypus::testing::compare_equal(11UL, static_cast<unsigned long>(table.num_columns()), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(true, table.row(0).get<unsigned long>("peak_resident_bytes") > 0, __FILE__, __LINE__, "peak memory");
+    fails += platypus::testing::compare_equal(2UL, static_cast<unsigned long>(table.num_rows()), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(num_trees, table.row(0).get<unsigned long>("trees"), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(num_trees + 1, table.row(1).get<unsigned long>("trees"), __FILE__, __LINE__);
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,190 @@
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <platypus/model/coalescent.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::coalescent::BasicCoalescentSimulator<TestDataTree> SimulatorType;
+typedef platypus::coalescent::LambdaCoalescentRates RatesType;
+
+int check_alias_table() {
+    int fails = 0;
+    std::vector<double> weights{1.0, 2.0, 3.0, 0.0, 4.0};
+    platypus::numeric::AliasTable table(weights.begin(), weights.end());
+    fails += platypus::testing::compare_equal(static_cast<std::size_t>(5), table.size(), __FILE__, __LINE__);
+    platypus::numeric::RandomNumberGenerator rng(3);
+    std::vector<unsigned long> counts(weights.size(), 0);
+    const unsigned long num_draws = 200000;
+    for (unsigned long idx = 0; idx < num_draws; ++idx) {
+        ++counts[table.sample(rng)];
+    }
+    for (std::size_t idx = 0; idx < weights.size(); ++idx) {
+        double observed = static_cast<double>(counts[idx]) / num_draws;
+        fails += platypus::testing::compare_equal(true, std::fabs(weights[idx] / 10.0 - observed) < 0.005, __FILE__, __LINE__,
+                "index ", idx, ": ", observed);
+    }
+    fails += platypus::testing::compare_equal(0UL, counts[3], __FILE__, __LINE__, "zero weight");
+    for (auto bad : std::vector<std::vector<double>>{{}, {0.0, 0.0}, {1.0, -1.0}}) {
+        try {
+            platypus::numeric::AliasTable bad_table(bad.begin(), bad.end());
+            fails += platypus::testing::fail_test(__FILE__, __LINE__, "std::invalid_argument", "no exception");
+        } catch (const std::invalid_argument &) {
+        }
+    }
+    return fails;
+}
+
+int check_rates() {
+    int fails = 0;
+    // Bolthausen-Sznitman: lambda_{b,k} = (k-2)! (b-k)! / (b-1)!, and lambda_b = b - 1
+    RatesType rates = RatesType::beta(1.0, 60, 8);
+    for (unsigned long b = 2; b <= 60; ++b) {
+        fails += platypus::testing::compare_equal(true, std::fabs(b - 1.0 - rates.get_total_rate(b)) < 1e-9 * b, __FILE__, __LINE__,
+                "total rate of ", b, " lineages: ", rates.get_total_rate(b));
+    }
+    for (unsigned long k = 2; k <= 10; ++k) {
+        double expected = std::exp(platypus::numeric::log_binomial_coefficient(10, k)
+                + std::lgamma(k - 1.0) + std::lgamma(11.0 - k) - std::lgamma(10.0));
+        fails += platypus::testing::compare_equal(true, std::fabs(expected - rates.get_merger_rate(10, k)) < 1e-9, __FILE__, __LINE__,
+                "merger rate of ", k, " of 10");
+    }
+    // merger sizes, both tabulated and beyond the table
+    platypus::numeric::RandomNumberGenerator rng(5);
+    const unsigned long b = 40;
+    std::vector<unsigned long> counts(b + 1, 0);
+    const unsigned long num_draws = 200000;
+    for (unsigned long idx = 0; idx < num_draws; ++idx) {
+        unsigned long k = rates.sample_merger_size(rng, b);
+        if (k < 2 || k > b) {
+            fails += platypus::testing::fail_test(__FILE__, __LINE__, "merger size in [2, 40]", k);
+            return fails;
+        }
+        ++counts[k];
+    }
+    double tail_expected = 0.0;
+    unsigned long tail_observed = 0;
+    for (unsigned long k = 2; k <= b; ++k) {
+        double expected = rates.get_merger_rate(b, k) / rates.get_total_rate(b);
+        double observed = static_cast<double>(counts[k]) / num_draws;
+        fails += platypus::testing::compare_equal(true, std::fabs(expected - observed) < 0.005, __FILE__, __LINE__,
+                "merger size ", k, ": ", observed, ", expected ", expected);
+        if (k > 8) {
+            tail_expected += expected;
+            tail_observed += counts[k];
+        }
+    }
+    fails += platypus::testing::compare_equal(true, std::fabs(tail_expected - static_cast<double>(tail_observed) / num_draws) < 0.005, __FILE__, __LINE__,
+            "untabulated merger sizes");
+    // with the rates of all untabulated mergers 0, there is no entry for
+    // them, and only tabulated sizes are drawn
+    RatesType no_tail(10,
+            [] (unsigned long) { return 1.0; },
+            [] (unsigned long, unsigned long k) { return k < 3 ? 1.0 : 0.0; },
+            3);
+    fails += platypus::testing::compare_equal(2.0, no_tail.get_total_rate(10), __FILE__, __LINE__, "total rate without untabulated mergers");
+    for (unsigned long idx = 0; idx < 1000; ++idx) {
+        unsigned long k = no_tail.sample_merger_size(rng, 10);
+        if (k != 2 && k != 3) {
+            fails += platypus::testing::fail_test(__FILE__, __LINE__, "merger size in [2, 3]", k);
+            break;
+        }
+    }
+    // close to the Kingman coalescent
+    RatesType kingman_like = RatesType::beta(1.999, 20);
+    fails += platypus::testing::compare_equal(true, std::fabs(190.0 - kingman_like.get_total_rate(20)) < 1.0, __FILE__, __LINE__,
+            "alpha near 2: ", kingman_like.get_total_rate(20));
+    for (double alpha : {0.0, 2.0, -1.0}) {
+        try {
+            RatesType::beta(alpha, 10);
+            fails += platypus::testing::fail_test(__FILE__, __LINE__, "std::invalid_argument", "no exception");
+        } catch (const std::invalid_argument &) {
+        }
+    }
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_alias_table();
+    fails += check_rates();
+
+    std::vector<TestDataTree> trees;
+    auto tree_factory = [&trees] () -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+    auto is_rooted_f = [] (TestDataTree & tree, bool is_rooted) { tree.set_is_rooted(is_rooted); };
+    auto node_label_f = [] (TestData & nd, const std::string & label) { nd.set_label(label); };
+    auto node_edge_f = [] (TestData & nd, double len) { nd.set_edge_length(len); };
+    platypus::numeric::RandomNumberGenerator rng(42);
+    SimulatorType sim(rng, tree_factory, is_rooted_f, node_label_f, node_edge_f);
+    auto writer = get_standard_newick_writer<TestDataTree>();
+
+    // three lineages under Bolthausen-Sznitman: a triple merger with
+    // probability 1/4, and an expected height of 1/2 + 3/4
+    {
+        RatesType rates = RatesType::beta(1.0, 3);
+        const unsigned long num_trees = 40000;
+        unsigned long num_triple = 0;
+        double sum_height = 0.0;
+        sim.generate_batch(num_trees, 3, rates, 4, [&] (TestDataTree & tree, unsigned long) {
+                    num_triple += tree.head_node()->num_child_nodes() == 3;
+                    double height = 0.0;
+                    for (auto nd = tree.head_node()->first_child_node(); nd != nullptr; nd = nd->first_child_node()) {
+                        height += nd->value().get_edge_length();
+                    }
+                    sum_height += height;
+                }, 2024, 2.0);
+        double triple = static_cast<double>(num_triple) / num_trees;
+        fails += platypus::testing::compare_equal(true, std::fabs(0.25 - triple) < 0.01, __FILE__, __LINE__, "triple mergers: ", triple);
+        double height = sum_height / num_trees;
+        fails += platypus::testing::compare_equal(true, std::fabs(2.5 - height) < 0.05, __FILE__, __LINE__, "mean height: ", height);
+    }
+
+    // large samples: every leaf present, every node with at least two
+    // children, reproducible regardless of the number of threads
+    {
+        const unsigned long num_leaves = 2000;
+        RatesType rates = RatesType::beta(1.5, num_leaves);
+        std::vector<std::string> expected;
+        for (unsigned int num_threads : {1U, 3U}) {
+            std::vector<std::string> observed;
+            sim.generate_batch(6, num_leaves, rates, num_threads, [&] (TestDataTree & tree, unsigned long idx) {
+                        unsigned long leaves = 0;
+                        unsigned long max_children = 0;
+                        for (auto ndi = tree.postorder_begin(); ndi != tree.postorder_end(); ++ndi) {
+                            unsigned long num_children = ndi.node()->num_child_nodes();
+                            if (num_children == 0) {
+                                ++leaves;
+                            } else if (num_children == 1) {
+                                fails += platypus::testing::fail_test(__FILE__, __LINE__, "at least 2 children", num_children);
+                            }
+                            if (ndi->get_edge_length() < 0.0) {
+                                fails += platypus::testing::fail_test(__FILE__, __LINE__, "non-negative edge length", ndi->get_edge_length());
+                            }
+                            max_children = std::max(max_children, num_children);
+                        }
+                        fails += platypus::testing::compare_equal(num_leaves, leaves, __FILE__, __LINE__, "tree ", idx);
+                        fails += platypus::testing::compare_equal(true, max_children > 2, __FILE__, __LINE__, "multiple mergers in tree ", idx);
+                        observed.push_back(writer.format(tree));
+                    }, 77);
+            if (expected.empty()) {
+                expected = observed;
+            } else {
+                fails += platypus::testing::compare_equal(expected, observed, __FILE__, __LINE__, "threads: ", num_threads);
+            }
+        }
+        try {
+            sim.generate_lambda_coalescent_tree(num_leaves + 1, rates);
+            fails += platypus::testing::fail_test(__FILE__, __LINE__, "std::invalid_argument", "no exception");
+        } catch (const std::invalid_argument &) {
+        }
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
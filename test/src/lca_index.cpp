@@ -0,0 +1,148 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include <platypus/model/lcaindex.hpp>
+#include <platypus/model/treepattern.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree TreeType;
+typedef TreeType::node_type NodeType;
+
+// by walking up from the deeper node, for reference
+const NodeType * naive_lca(const NodeType * a, const NodeType * b) {
+    auto depth = [] (const NodeType * nd) {
+        unsigned long d = 0;
+        for (; nd->parent_node() != nullptr; nd = nd->parent_node()) {
+            ++d;
+        }
+        return d;
+    };
+    unsigned long da = depth(a);
+    unsigned long db = depth(b);
+    while (a != b) {
+        if (da >= db) {
+            a = a->parent_node();
+            --da;
+        } else {
+            b = b->parent_node();
+            --db;
+        }
+    }
+    return a;
+}
+
+std::vector<const NodeType *> get_nodes(const TreeType & tree) {
+    std::vector<const NodeType *> nodes;
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        nodes.push_back(ndi.node());
+    }
+    return nodes;
+}
+
+const NodeType * find_node(const TreeType & tree, const std::string & label) {
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        if (ndi->get_label() == label) {
+            return ndi.node();
+        }
+    }
+    return nullptr;
+}
+
+int check_all_pairs(TreeType & tree, platypus::LcaIndex<TreeType> & lca_index, const std::string & remarks) {
+    int fails = 0;
+    auto nodes = get_nodes(tree);
+    fails += platypus::testing::compare_equal(nodes.size(), lca_index.size(), __FILE__, __LINE__, remarks, ": size");
+    for (auto a : nodes) {
+        for (auto b : nodes) {
+            const NodeType * expected = naive_lca(a, b);
+            if (lca_index.lca(a, b) != expected) {
+                fails += platypus::testing::fail_test(__FILE__, __LINE__, expected->value().get_label(), lca_index.lca(a, b)->value().get_label(), remarks, ": lca()");
+            }
+            if (lca_index.is_ancestor(a, b) != (expected == a)) {
+                fails += platypus::testing::fail_test(__FILE__, __LINE__, expected == a, !(expected == a), remarks, ": is_ancestor()");
+            }
+        }
+    }
+    return fails;
+}
+
+int check_small_tree() {
+    int fails = 0;
+    auto trees = get_test_data_tree_vector_from_string<TreeType>("(((a,b)ab,c)abc,(d,(e,f,g)efg)defg,h)root;");
+    TreeType tree(std::move(trees[0]));
+    platypus::LcaIndex<TreeType> lca_index(tree);
+    auto node = [&tree] (const std::string & label) { return find_node(tree, label); };
+    fails += platypus::testing::compare_equal(node("ab"), lca_index.lca(node("a"), node("b")), __FILE__, __LINE__, "lca(a, b)");
+    fails += platypus::testing::compare_equal(node("abc"), lca_index.lca(node("c"), node("a")), __FILE__, __LINE__, "lca(c, a)");
+    fails += platypus::testing::compare_equal(node("root"), lca_index.lca(node("b"), node("h")), __FILE__, __LINE__, "lca(b, h)");
+    fails += platypus::testing::compare_equal(node("defg"), lca_index.lca(node("defg"), node("g")), __FILE__, __LINE__, "lca(defg, g)");
+    fails += platypus::testing::compare_equal(node("e"), lca_index.lca(node("e"), node("e")), __FILE__, __LINE__, "lca(e, e)");
+    fails += platypus::testing::compare_equal(3UL, lca_index.depth(node("a")), __FILE__, __LINE__, "depth(a)");
+
+    std::vector<const NodeType *> clade{node("f"), node("d"), node("g")};
+    fails += platypus::testing::compare_equal(node("defg"), lca_index.mrca(clade.begin(), clade.end()), __FILE__, __LINE__, "mrca(f, d, g)");
+    clade = {node("g"), node("e")};
+    fails += platypus::testing::compare_equal(node("efg"), lca_index.mrca(clade.begin(), clade.end()), __FILE__, __LINE__, "mrca(g, e)");
+    clade.push_back(node("c"));
+    fails += platypus::testing::compare_equal(node("root"), lca_index.mrca(clade.begin(), clade.end()), __FILE__, __LINE__, "mrca(g, e, c)");
+    fails += platypus::testing::compare_equal(static_cast<const NodeType *>(nullptr), lca_index.mrca(clade.end(), clade.end()), __FILE__, __LINE__, "mrca of nothing");
+    fails += check_all_pairs(tree, lca_index, "small tree");
+
+    // rebuilt on the first query after the structure changes
+    fails += platypus::testing::compare_equal(true, lca_index.is_current(), __FILE__, __LINE__, "current");
+    tree.prune_subtree(const_cast<NodeType *>(node("c")));
+    fails += platypus::testing::compare_equal(false, lca_index.is_current(), __FILE__, __LINE__, "out of date after pruning");
+    fails += check_all_pairs(tree, lca_index, "after pruning");
+    TreeType::preorder_iterator pos(const_cast<NodeType *>(node("a")));
+    tree.add_child(pos, TestData("i"));
+    fails += platypus::testing::compare_equal(node("a"), lca_index.lca(node("i"), node("a")), __FILE__, __LINE__, "after adding a child");
+    fails += check_all_pairs(tree, lca_index, "after adding a child");
+
+    bool caught = false;
+    TreeType other(tree);
+    try {
+        lca_index.lca(node("a"), other.head_node());
+    } catch (const std::invalid_argument &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "node of another tree");
+    return fails;
+}
+
+int check_random_trees() {
+    int fails = 0;
+    std::mt19937 rng(11);
+    for (std::size_t num_taxa : {1, 2, 3, 17, 64, 100}) {
+        std::vector<TestData> labels;
+        for (std::size_t taxon = 0; taxon < num_taxa; ++taxon) {
+            labels.push_back(TestData("t" + std::to_string(taxon)));
+        }
+        for (int balanced = 0; balanced < 2; ++balanced) {
+            std::shuffle(labels.begin(), labels.end(), rng);
+            TreeType tree;
+            if (balanced) {
+                platypus::build_maximally_balanced_tree(tree, labels.begin(), labels.end());
+            } else {
+                platypus::build_maximally_unbalanced_tree(tree, labels.begin(), labels.end());
+            }
+            platypus::LcaIndex<TreeType> lca_index(tree);
+            fails += check_all_pairs(tree, lca_index, "random tree of " + std::to_string(num_taxa) + " taxa");
+        }
+    }
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_small_tree();
+    fails += check_random_trees();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
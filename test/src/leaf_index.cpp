@@ -0,0 +1,76 @@
+#include <string>
+#include <vector>
+#include <platypus/model/leafindex.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree::node_type NodeType;
+typedef platypus::LeafIndex<TestDataTree> LabelIndexType;
+
+// the leaf with each label, found by scanning the leaves
+std::vector<NodeType *> scan_leaves(const TestDataTree & tree, const std::vector<std::string> & labels) {
+    std::vector<NodeType *> nodes;
+    for (auto & label : labels) {
+        NodeType * found = nullptr;
+        for (auto nd = tree.leaf_begin(); nd != tree.leaf_end(); ++nd) {
+            if (nd->get_label() == label) {
+                found = nd.node();
+                break;
+            }
+        }
+        nodes.push_back(found);
+    }
+    return nodes;
+}
+
+int main() {
+    int fails = 0;
+    auto trees = get_test_data_tree_vector_from_string<TestDataTree>(
+            "((i:1,(j:2,k:3)e:1)b:2,((l:1,m:1)g:4,(n:2,(o:1,p:5)h:1)f:1)c:1)a;");
+    TestDataTree & tree = trees[0];
+    LabelIndexType index(tree, [](const TestData & nv) { return nv.get_label(); });
+    fails += platypus::testing::compare_equal(false, index.is_current(), __FILE__, __LINE__, "not built before first lookup");
+    fails += platypus::testing::compare_equal(8UL, static_cast<unsigned long>(index.size()), __FILE__, __LINE__, "size");
+    fails += platypus::testing::compare_equal(true, index.is_current(), __FILE__, __LINE__, "current after lookup");
+    fails += platypus::testing::compare_equal(true, index.is_unique(), __FILE__, __LINE__, "unique labels");
+
+    std::vector<std::string> labels{"p", "i", "x", "l", "e", "j"};
+    auto expected = scan_leaves(tree, labels);
+    std::vector<NodeType *> observed = index.find(labels);
+    fails += platypus::testing::compare_equal(expected, observed, __FILE__, __LINE__, "bulk lookup");
+    fails += platypus::testing::compare_equal(static_cast<NodeType *>(nullptr), index.find("e"), __FILE__, __LINE__, "internal nodes are not indexed");
+    fails += platypus::testing::compare_equal(expected[0], index.find("p"), __FILE__, __LINE__, "single lookup");
+    std::vector<NodeType *> appended;
+    fails += platypus::testing::compare_equal(2UL, static_cast<unsigned long>(index.find(labels.begin(), labels.end(), appended)), __FILE__, __LINE__, "number missing");
+    fails += platypus::testing::compare_equal(expected, appended, __FILE__, __LINE__, "lookup of range");
+
+    // structural changes are picked up
+    NodeType * p = index.find("p");
+    tree.prune_subtree(p);
+    fails += platypus::testing::compare_equal(false, index.is_current(), __FILE__, __LINE__, "stale after pruning");
+    fails += platypus::testing::compare_equal(static_cast<NodeType *>(nullptr), index.find("p"), __FILE__, __LINE__, "pruned leaf");
+    TestDataTree::preorder_iterator l_pos(index.find("l"));
+    tree.add_child(l_pos, TestData("q"));
+    tree.add_child(l_pos, TestData("m"));
+    labels = {"q", "m", "l", "o"};
+    fails += platypus::testing::compare_equal(scan_leaves(tree, labels), index.find(labels), __FILE__, __LINE__, "after additions");
+    fails += platypus::testing::compare_equal(false, index.is_unique(), __FILE__, __LINE__, "duplicated label");
+    fails += platypus::testing::compare_equal(8UL, static_cast<unsigned long>(index.num_leaves()), __FILE__, __LINE__, "number of leaves");
+
+    // changes to keys are not tracked
+    index.find("q")->value().set_label("r");
+    fails += platypus::testing::compare_equal(true, index.find("r") == nullptr, __FILE__, __LINE__, "untracked relabeling");
+    index.invalidate();
+    fails += platypus::testing::compare_equal(true, index.find("r") != nullptr && index.find("q") == nullptr, __FILE__, __LINE__, "after invalidate()");
+
+    // by other keys
+    platypus::LeafIndex<TestDataTree, double> by_length(tree, [](const TestData & nv) { return nv.get_edge_length(); });
+    fails += platypus::testing::compare_equal(std::string("k"), by_length.find(3.0)->value().get_label(), __FILE__, __LINE__, "by edge length");
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,183 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <platypus/model/lineagesthroughtime.hpp>
+#include <platypus/model/treepattern.hpp>
+#include <platypus/numeric/rng.hpp>
+#include <platypus/utility/partialstate.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree TreeType;
+typedef platypus::LineagesThroughTime<TreeType> LttType;
+
+// lineages of ``tree`` at each age of ``grid``, by checking every edge against every age
+std::vector<unsigned long> naive_lineage_counts(const TreeType & tree, const std::vector<double> & grid) {
+    std::map<const TreeType::node_type *, double> distances;
+    double present = 0.0;
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        const TreeType::node_type * nd = ndi.node();
+        double distance = nd->parent_node() == nullptr ? 0.0 : distances[nd->parent_node()] + nd->value().get_edge_length();
+        distances[nd] = distance;
+        present = std::max(present, distance);
+    }
+    std::vector<unsigned long> counts(grid.size(), 0);
+    for (std::size_t idx = 0; idx < grid.size(); ++idx) {
+        for (auto & entry : distances) {
+            if (entry.first->parent_node() == nullptr) {
+                continue;
+            }
+            double age = present - entry.second;
+            double parent_age = present - distances[entry.first->parent_node()];
+            if (age <= grid[idx] && grid[idx] < parent_age) {
+                ++counts[idx];
+            }
+        }
+    }
+    return counts;
+}
+
+int check_single_trees() {
+    int fails = 0;
+    LttType ltt(get_edge_length, LttType::uniform_grid(3.5, 8));
+    fails += platypus::testing::compare_equal(std::vector<double>{0.0, 0.5, 1.0, 1.5, 2.0, 2.5, 3.0, 3.5}, ltt.grid(), __FILE__, __LINE__, "grid");
+    {
+        TreeType tree = read_tree("((a:1,b:1):2,(c:2,d:2):1);");
+        fails += platypus::testing::compare_equal(std::vector<unsigned long>{4, 4, 3, 3, 2, 2, 0, 0}, ltt.compute(tree), __FILE__, __LINE__, "ultrametric tree");
+    }
+    {
+        // b alone reaches the present; a and c end before it
+        TreeType tree = read_tree("((a:1,b:2):1,c:1);");
+        fails += platypus::testing::compare_equal(std::vector<unsigned long>{1, 1, 2, 2, 2, 2, 0, 0}, ltt.compute(tree), __FILE__, __LINE__, "non-ultrametric tree");
+    }
+    {
+        // polytomy, with rounding error in the ages of the leaves
+        TreeType tree = read_tree("(a:0.1,b:0.1,(c:0.07,d:0.07):0.03);");
+        LttType fine_ltt(get_edge_length, std::vector<double>{0.0, 0.08, 0.2});
+        fails += platypus::testing::compare_equal(std::vector<unsigned long>{4, 3, 0}, fine_ltt.compute(tree), __FILE__, __LINE__, "polytomy");
+    }
+    bool caught = false;
+    try {
+        LttType bad(get_edge_length, std::vector<double>{0.0, 2.0, 1.0});
+    } catch (const std::invalid_argument &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "decreasing grid not detected");
+    return fails;
+}
+
+int check_accumulation() {
+    int fails = 0;
+    platypus::numeric::RandomNumberGenerator rng(11);
+    std::vector<TreeType> trees;
+    for (int idx = 0; idx < 300; ++idx) {
+        std::vector<TestData> leaves;
+        for (unsigned long leaf = 0, num_leaves = 2 + rng.uniform_int(0, 19); leaf < num_leaves; ++leaf) {
+            leaves.emplace_back("t" + std::to_string(leaf));
+        }
+        trees.emplace_back();
+        platypus::build_uniform_random_tree(trees.back(), leaves.begin(), leaves.end(), rng);
+        for (auto ndi = trees.back().preorder_begin(); ndi != trees.back().preorder_end(); ++ndi) {
+            ndi->set_edge_length(static_cast<double>(rng.uniform_int(1, 3)));
+        }
+    }
+    std::vector<double> grid = LttType::uniform_grid(30.0, 61);
+    LttType ltt(get_edge_length, grid);
+    std::vector<std::vector<unsigned long>> expected_counts(grid.size());
+    for (auto & tree : trees) {
+        std::vector<unsigned long> expected = naive_lineage_counts(tree, grid);
+        fails += platypus::testing::compare_equal(expected, ltt.compute(tree), __FILE__, __LINE__, "lineage counts");
+        for (std::size_t idx = 0; idx < grid.size(); ++idx) {
+            expected_counts[idx].push_back(expected[idx]);
+        }
+    }
+    for (auto & counts : expected_counts) {
+        std::sort(counts.begin(), counts.end());
+    }
+
+    for (unsigned int num_threads : {1U, 4U}) {
+        LttType accumulated(get_edge_length, grid);
+        accumulated.add_trees(trees.begin(), trees.end(), num_threads);
+        fails += platypus::testing::compare_equal(300UL, accumulated.num_trees(), __FILE__, __LINE__, "trees, threads: ", num_threads);
+        for (std::size_t idx = 0; idx < grid.size(); ++idx) {
+            const std::vector<unsigned long> & counts = expected_counts[idx];
+            double mean = 0.0;
+            for (unsigned long count : counts) {
+                mean += static_cast<double>(count);
+            }
+            mean /= static_cast<double>(counts.size());
+            if (std::fabs(mean - accumulated.get_mean(idx)) > 1e-9) {
+                fails += platypus::testing::fail_test(__FILE__, __LINE__, mean, accumulated.get_mean(idx), "mean at grid point ", idx);
+            }
+            // least count of at least a proportion q of the trees
+            for (double q : {0.0, 0.025, 0.5, 0.975, 1.0}) {
+                std::size_t rank = static_cast<std::size_t>(std::ceil(q * static_cast<double>(counts.size())));
+                unsigned long expected = counts[rank > 0 ? rank - 1 : 0];
+                if (accumulated.get_quantile(idx, q) != expected) {
+                    fails += platypus::testing::fail_test(__FILE__, __LINE__, expected, accumulated.get_quantile(idx, q),
+                            "quantile ", q, " at grid point ", idx, ", threads: ", num_threads);
+                }
+            }
+        }
+
+        platypus::DataTable table;
+        accumulated.export_table(table, {0.025, 0.975});
+        fails += platypus::testing::compare_equal(static_cast<unsigned long>(grid.size()), static_cast<unsigned long>(table.num_rows()), __FILE__, __LINE__, "table rows");
+        fails += platypus::testing::compare_equal(7UL, static_cast<unsigned long>(table.num_columns()), __FILE__, __LINE__, "table columns");
+        auto age_handle = table.column_handle<double>("age");
+        auto median_handle = table.column_handle<unsigned long>("median");
+        auto upper_handle = table.column_handle<unsigned long>("q0.975");
+        for (std::size_t idx = 0; idx < grid.size(); ++idx) {
+            if (table.get(idx, age_handle) != grid[idx]
+                    || table.get(idx, median_handle) != accumulated.get_quantile(idx, 0.5)
+                    || table.get(idx, upper_handle) != accumulated.get_quantile(idx, 0.975)) {
+                fails += platypus::testing::fail_test(__FILE__, __LINE__, "row", "different", "table row ", idx);
+            }
+        }
+    }
+
+    // sharded accumulation, through partial states
+    {
+        LttType whole(get_edge_length, grid);
+        whole.add_trees(trees.begin(), trees.end());
+        LttType first(get_edge_length, grid);
+        first.add_trees(trees.begin(), trees.begin() + 120);
+        LttType second(get_edge_length, grid);
+        second.add_trees(trees.begin() + 120, trees.end());
+        LttType merged(get_edge_length, grid);
+        platypus::merge_partial_state(merged, platypus::encode_partial_state(first));
+        platypus::merge_partial_state(merged, platypus::encode_partial_state(second));
+        fails += platypus::testing::compare_equal(whole.num_trees(), merged.num_trees(), __FILE__, __LINE__, "merged trees");
+        unsigned long num_different = 0;
+        for (std::size_t idx = 0; idx < grid.size(); ++idx) {
+            for (unsigned long count = 0; count < 25; ++count) {
+                num_different += whole.get_count(idx, count) != merged.get_count(idx, count) ? 1 : 0;
+            }
+        }
+        fails += platypus::testing::compare_equal(0UL, num_different, __FILE__, __LINE__, "merged counts");
+
+        LttType other_grid(get_edge_length, LttType::uniform_grid(10.0, 61));
+        bool caught = false;
+        try {
+            platypus::merge_partial_state(other_grid, platypus::encode_partial_state(first));
+        } catch (const platypus::PartialStateError &) {
+            caught = true;
+        }
+        fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "merge of state on another grid not detected");
+    }
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_single_trees();
+    fails += check_accumulation();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,106 @@
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <platypus/model/mappednodearena.hpp>
+#include <platypus/parse/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::TreeNode<std::string> NodeType;
+typedef platypus::Tree<std::string, platypus::MappedNodeArena<NodeType>> MappedTree;
+
+int main() {
+    int fails = 0;
+
+    fails += platypus::testing::compare_equal(true, MappedTree::allocator_tracks_node_ownership, __FILE__, __LINE__,
+            "mapped arena not detected as tracking node ownership");
+
+    // building, copying, clearing
+    {
+        MappedTree tree;
+        build_tree(tree, STANDARD_TEST_TREE_STRING);
+        if (compare_against_newick_string(tree, "tree built using mapped arena failed to yield expected newick string")) {
+            fails += 1;
+        }
+        fails += platypus::testing::compare_equal(16UL, static_cast<unsigned long>(tree.node_allocator().size()), __FILE__, __LINE__,
+                "incorrect number of live nodes");
+        fails += platypus::testing::compare_equal(true, tree.node_allocator().storage().file_size() >= 16 * sizeof(NodeType), __FILE__, __LINE__,
+                "nodes not placed in storage file");
+        MappedTree tree_copy(tree);
+        tree.clear();
+        if (compare_against_newick_string(tree_copy, "copy of tree built using mapped arena failed to yield expected newick string")) {
+            fails += 1;
+        }
+        build_tree(tree, STANDARD_TEST_TREE_STRING);
+        if (compare_against_newick_string(tree, "rebuilt tree failed to yield expected newick string")) {
+            fails += 1;
+        }
+    }
+
+    // reading, with each tree in a single mapped region laid out in preorder
+    {
+        const unsigned long num_tips = 20000;
+        platypus::NewickReader<MappedTree> reader;
+        reader.set_node_label_setter([](std::string & nv, const std::string & label) { nv = label; });
+        reader.set_prescan_node_counts(true);
+        MappedTree tree;
+        unsigned long initial_slabs = tree.node_allocator().num_slabs();
+        reader.read_buffer(balanced_tree_string(0, num_tips) + ";", [&tree]() -> MappedTree & { return tree; });
+        fails += platypus::testing::compare_equal(initial_slabs + 1, static_cast<unsigned long>(tree.node_allocator().num_slabs()), __FILE__, __LINE__,
+                "tree not read into a single region");
+        unsigned long num_leaves = 0;
+        unsigned long num_out_of_order = 0;
+        const NodeType * prev = nullptr;
+        for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+            const NodeType * nd = ndi.node();
+            num_leaves += nd->is_leaf() ? 1 : 0;
+            if (prev != nullptr && prev != tree.head_node() && nd != prev + 1) {
+                ++num_out_of_order;
+            }
+            prev = nd;
+        }
+        fails += platypus::testing::compare_equal(num_tips, num_leaves, __FILE__, __LINE__, "leaves read");
+        // contiguous, but for the step from the remainder of the slab
+        // holding the head node to the reserved one
+        fails += platypus::testing::compare_equal(true, num_out_of_order <= 1, __FILE__, __LINE__, "nodes not placed in preorder: ", num_out_of_order);
+    }
+
+    // storage in a given directory
+    {
+        platypus::MappedNodeArena<int> arena(16, 64, platypus::MappedSlabStorage("."));
+        std::vector<int *> values;
+        for (int i = 0; i < 1000; ++i) {
+            int * p = arena.allocate(1);
+            arena.construct(p, i);
+            values.push_back(p);
+        }
+        int num_wrong = 0;
+        for (int i = 0; i < 1000; ++i) {
+            num_wrong += *values[i] != i ? 1 : 0;
+        }
+        fails += platypus::testing::compare_equal(0, num_wrong, __FILE__, __LINE__, "values overwritten");
+        fails += platypus::testing::compare_equal(std::string("."), arena.storage().directory(), __FILE__, __LINE__);
+        arena.release();
+        fails += platypus::testing::compare_equal(0UL, static_cast<unsigned long>(arena.storage().file_size()), __FILE__, __LINE__,
+                "storage file not truncated on release");
+        int * p = arena.allocate(1);
+        arena.construct(p, 7);
+        fails += platypus::testing::compare_equal(7, *p, __FILE__, __LINE__, "storage not reusable after release");
+
+        bool caught = false;
+        try {
+            platypus::MappedNodeArena<int> bad_arena(16, 64, platypus::MappedSlabStorage("./no/such/directory"));
+            bad_arena.allocate(1);
+        } catch (const platypus::MappedFileError &) {
+            caught = true;
+        }
+        fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "missing storage directory not detected");
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
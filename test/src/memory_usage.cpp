@@ -0,0 +1,104 @@
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <platypus/model/datatable.hpp>
+#include <platypus/model/tree.hpp>
+#include <platypus/model/treenodearena.hpp>
+#include <platypus/model/treepool.hpp>
+#include <platypus/utility/memoryusage.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::Tree<std::string, platypus::TreeNodeArena<platypus::TreeNode<std::string>>> ArenaTree;
+
+template <class TreeT>
+void build_caterpillar(TreeT & tree, unsigned long num_leaves, const std::string & label) {
+    auto nd = tree.head_node();
+    for (unsigned long idx = 0; idx < num_leaves; ++idx) {
+        auto leaf = tree.create_leaf_node();
+        leaf->value() = label;
+        nd->add_child(leaf);
+        if (idx + 1 < num_leaves) {
+            auto internal = tree.create_internal_node();
+            nd->add_child(internal);
+            nd = internal;
+        }
+    }
+    tree.mark_structure_modified();
+}
+
+int main() {
+    int fails = 0;
+    auto label_bytes = [](const std::string & v) { return platypus::memory::heap_bytes(v); };
+    const std::string long_label(100, 'x');
+
+    {
+        platypus::Tree<std::string> tree;
+        build_caterpillar(tree, 50, long_label);
+        // 50 leaves, 49 internal nodes, head and stop
+        auto usage = tree.memory_usage();
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(101), usage.num_objects, __FILE__, __LINE__, "nodes");
+        fails += platypus::testing::compare_equal(101 * sizeof(platypus::TreeNode<std::string>), usage.object_bytes, __FILE__, __LINE__, "node bytes");
+        fails += platypus::testing::compare_equal(true, usage.bookkeeping_bytes >= 101 * sizeof(void *), __FILE__, __LINE__, "allocated node set");
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(0), usage.heap_bytes, __FILE__, __LINE__, "no value accounting");
+        auto with_labels = tree.memory_usage(label_bytes);
+        fails += platypus::testing::compare_equal(50 * platypus::memory::heap_bytes(long_label), with_labels.heap_bytes, __FILE__, __LINE__, "label bytes");
+        fails += platypus::testing::compare_equal(usage.object_bytes + usage.bookkeeping_bytes + with_labels.heap_bytes, with_labels.total_bytes(), __FILE__, __LINE__, "total");
+    }
+    {
+        ArenaTree tree;
+        tree.reserve_nodes(1000);
+        build_caterpillar(tree, 50, "a");
+        auto usage = tree.memory_usage(label_bytes);
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(101), usage.num_objects, __FILE__, __LINE__, "arena nodes");
+        fails += platypus::testing::compare_equal(true, usage.object_bytes >= 1000 * sizeof(platypus::TreeNode<std::string>), __FILE__, __LINE__, "arena capacity");
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(0), usage.heap_bytes, __FILE__, __LINE__, "short labels are held in place");
+    }
+    {
+        platypus::TreePool<platypus::Tree<std::string>> pool;
+        for (int idx = 0; idx < 3; ++idx) {
+            build_caterpillar(pool.create(), 10, long_label);
+        }
+        auto usage = pool.memory_usage(label_bytes);
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(3 * 21), usage.num_objects, __FILE__, __LINE__, "pool nodes");
+        fails += platypus::testing::compare_equal(30 * platypus::memory::heap_bytes(long_label), usage.heap_bytes, __FILE__, __LINE__, "pool labels");
+    }
+    {
+        platypus::DataTable table;
+        table.add_data_column<double>("x");
+        table.add_data_column<std::string>("s");
+        table.reserve(100);
+        for (int idx = 0; idx < 10; ++idx) {
+            table.add_row() << idx * 0.5 << long_label;
+        }
+        auto x_usage = table.column("x").memory_usage();
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(10), x_usage.num_objects, __FILE__, __LINE__, "column values");
+        fails += platypus::testing::compare_equal(100 * sizeof(long double), x_usage.object_bytes, __FILE__, __LINE__, "reserved column storage");
+        auto s_usage = table.column("s").memory_usage();
+        fails += platypus::testing::compare_equal(10 * platypus::memory::heap_bytes(long_label), s_usage.heap_bytes, __FILE__, __LINE__, "string storage");
+        auto usage = table.memory_usage();
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(10), usage.num_objects, __FILE__, __LINE__, "table rows");
+        fails += platypus::testing::compare_equal(x_usage.object_bytes + s_usage.object_bytes, usage.object_bytes, __FILE__, __LINE__, "table storage");
+        fails += platypus::testing::compare_equal(true, usage.bookkeeping_bytes >= 10 * sizeof(platypus::DataTableRow), __FILE__, __LINE__, "table rows");
+    }
+    {
+        platypus::MemoryProfile profile;
+        profile.checkpoint("start");
+        std::vector<char> block(1 << 24, 1);
+        profile.checkpoint("allocated", block.size());
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(2), profile.checkpoints().size(), __FILE__, __LINE__, "checkpoints");
+        fails += platypus::testing::compare_equal(true, profile.checkpoints()[1].peak_resident_bytes >= profile.checkpoints()[0].peak_resident_bytes, __FILE__, __LINE__, "peak memory");
+        fails += platypus::testing::compare_equal(true, profile.checkpoints()[1].current_resident_bytes > (1UL << 24), __FILE__, __LINE__, "current memory");
+        platypus::DataTable table;
+        profile.export_table(table);
+        fails += platypus::testing::compare_equal(std::string("allocated"), table.get<std::string>(1, "phase"), __FILE__, __LINE__, "exported phase");
+        fails += platypus::testing::compare_equal(static_cast<unsigned long>(1 << 24), table.get<unsigned long>(1, "accounted_bytes"), __FILE__, __LINE__, "exported bytes");
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
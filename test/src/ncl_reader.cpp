@@ -0,0 +1,281 @@
+#include <stdlib.h>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <platypus/model/charactermatrix.hpp>
+#include <platypus/model/standardinterface.hpp>
+#include <platypus/model/taxonnamespace.hpp>
+#include <platypus/parse/nclreader.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::StandardTree<platypus::TaxonNodeValue<>> TaxonTree;
+
+const std::vector<std::string> TAXA{"a", "b", "c", "d", "e", "f"};
+const std::vector<std::string> TREES{
+    "((a:1,b:2):3,(c:4,(d:5,e:6):7):8,f:9);",
+    "(((f:1,e:2):3,d:4):5,(b:6,a:7):8,c:9);",
+    "(a:1,(b:2,(c:3,(d:4,(e:5,f:6):7):8):9):10);",
+    "((d:0.5,c:0.25):1.5,(a:2,b:3):4,(f:5,e:6):7);",
+    "((e:1,a:2):3,(c:4,(f:5,(b:6,d:7):8):9):10);",
+};
+
+// A NEXUS source of ``trees`` over ``taxa``, with leaves given by their
+// translate table keys (the 1-based indexes of their taxa).
+std::string get_nexus_source(const std::vector<std::string> & taxa, const std::vector<std::string> & trees) {
+    std::ostringstream o;
+    o << "#NEXUS\nBEGIN TAXA;\n    DIMENSIONS NTAX=" << taxa.size() << ";\n    TAXLABELS";
+    for (auto & label : taxa) {
+        o << " " << label;
+    }
+    o << ";\nEND;\nBEGIN TREES;\n    TRANSLATE\n";
+    for (std::size_t idx = 0; idx < taxa.size(); ++idx) {
+        o << "        " << idx + 1 << " " << taxa[idx] << (idx + 1 < taxa.size() ? ",\n" : ";\n");
+    }
+    for (std::size_t tree_idx = 0; tree_idx < trees.size(); ++tree_idx) {
+        std::string tree = trees[tree_idx];
+        for (std::size_t idx = 0; idx < taxa.size(); ++idx) {
+            for (std::size_t pos = tree.find(taxa[idx] + ":"); pos != std::string::npos; pos = tree.find(taxa[idx] + ":", pos)) {
+                tree.replace(pos, taxa[idx].size(), std::to_string(idx + 1));
+            }
+        }
+        o << "    TREE t" << tree_idx << " = [&R] " << tree << "\n";
+    }
+    o << "END;\n";
+    return o.str();
+}
+
+std::string get_expected(const std::vector<std::string> & trees) {
+    auto expected_trees = get_test_data_tree_vector_from_string<TestDataTree>(
+            std::accumulate(trees.begin(), trees.end(), std::string()));
+    auto writer = get_standard_newick_writer<TestDataTree>();
+    writer.set_suppress_rooting(true);
+    return writer.format(expected_trees.begin(), expected_trees.end());
+}
+
+platypus::NclTreeReader<TestDataTree> get_test_data_tree_ncl_reader() {
+    platypus::NclTreeReader<TestDataTree> reader;
+    platypus::bind_standard_interface(reader);
+    return reader;
+}
+
+template <class TreeT>
+std::string format_trees(const std::vector<TreeT> & trees) {
+    auto writer = get_standard_newick_writer<TreeT>();
+    writer.set_suppress_rooting(true);
+    return writer.format(trees.begin(), trees.end());
+}
+
+std::string format_trees(const std::vector<TaxonTree> & trees, const platypus::TaxonNamespace * taxon_namespace) {
+    auto writer = get_standard_newick_writer<TaxonTree>();
+    writer.set_suppress_rooting(true);
+    if (taxon_namespace) {
+        platypus::bind_taxon_namespace(writer, *taxon_namespace);
+    }
+    return writer.format(trees.begin(), trees.end());
+}
+
+int check_read() {
+    int fails = 0;
+    std::string src = get_nexus_source(TAXA, TREES);
+    std::string expected = get_expected(TREES);
+    for (bool streaming : {false, true}) {
+        std::string remarks = streaming ? "streaming" : "not streaming";
+        auto reader = get_test_data_tree_ncl_reader();
+        reader.set_streaming(streaming);
+        std::vector<TestDataTree> trees;
+        auto tf = [&trees]() -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+        fails += platypus::testing::compare_equal(5UL, reader.read(std::istringstream(src), tf), __FILE__, __LINE__, remarks, ": trees read");
+        fails += platypus::testing::compare_equal(expected, format_trees(trees), __FILE__, __LINE__, remarks, ": trees");
+
+        trees.clear();
+        fails += platypus::testing::compare_equal(2UL, reader.read(std::istringstream(src), tf, "nexus", 2), __FILE__, __LINE__, remarks, ": tree limit");
+        fails += platypus::testing::compare_equal(get_expected({TREES[0], TREES[1]}), format_trees(trees), __FILE__, __LINE__, remarks, ": trees up to limit");
+
+        trees.clear();
+        reader.set_skip_first(1);
+        reader.set_every_nth(2);
+        fails += platypus::testing::compare_equal(2UL, reader.read(std::istringstream(src), tf), __FILE__, __LINE__, remarks, ": skipped and thinned");
+        fails += platypus::testing::compare_equal(get_expected({TREES[1], TREES[3]}), format_trees(trees), __FILE__, __LINE__, remarks, ": trees skipped and thinned");
+    }
+    return fails;
+}
+
+int check_session() {
+    int fails = 0;
+    // consecutive sources sharing their first taxa, or not
+    std::vector<std::vector<std::string>> sources_taxa{
+        TAXA,
+        TAXA,
+        {"a", "b", "c", "f", "e", "d"},
+        {"f", "e", "d", "c", "b", "a"},
+    };
+    platypus::NclReaderSession session;
+    for (bool has_taxon_namespace : {false, true}) {
+        std::string remarks = has_taxon_namespace ? "taxon namespace" : "labels";
+        platypus::TaxonNamespace taxon_namespace;
+        platypus::NclTreeReader<TaxonTree> reader;
+        platypus::bind_standard_interface(reader);
+        if (has_taxon_namespace) {
+            platypus::bind_taxon_namespace(reader, taxon_namespace);
+        }
+        reader.set_session(&session);
+        for (std::size_t source_idx = 0; source_idx < sources_taxa.size(); ++source_idx) {
+            std::vector<TaxonTree> trees;
+            reader.read(std::istringstream(get_nexus_source(sources_taxa[source_idx], TREES)),
+                    [&trees]() -> TaxonTree & { trees.emplace_back(); return trees.back(); });
+            fails += platypus::testing::compare_equal(get_expected(TREES),
+                    format_trees(trees, has_taxon_namespace ? &taxon_namespace : nullptr),
+                    __FILE__, __LINE__, remarks, ": source ", source_idx);
+        }
+        if (has_taxon_namespace) {
+            fails += platypus::testing::compare_equal(6UL, static_cast<unsigned long>(taxon_namespace.size()), __FILE__, __LINE__, "taxa in namespace");
+        }
+    }
+    return fails;
+}
+
+int check_lazy() {
+    int fails = 0;
+    auto reader = get_test_data_tree_ncl_reader();
+    auto trees = reader.read_lazy(std::istringstream(get_nexus_source(TAXA, TREES)));
+    fails += platypus::testing::compare_equal(5UL, trees.size(), __FILE__, __LINE__, "lazy trees");
+    fails += platypus::testing::compare_equal(std::string("t3"), trees.get_tree_name(3), __FILE__, __LINE__, "tree name");
+    auto selected = trees.select(1, 2);
+    fails += platypus::testing::compare_equal(std::vector<unsigned long>{1, 3}, selected, __FILE__, __LINE__, "selected trees");
+    std::vector<TestDataTree> built;
+    std::vector<unsigned long> built_indexes;
+    trees.get_each(selected, [&] (TestDataTree & tree, unsigned long idx) {
+        built.push_back(tree);
+        built_indexes.push_back(idx);
+    });
+    fails += platypus::testing::compare_equal(selected, built_indexes, __FILE__, __LINE__, "indexes of built trees");
+    fails += platypus::testing::compare_equal(get_expected({TREES[1], TREES[3]}), format_trees(built), __FILE__, __LINE__, "built trees");
+    bool caught = false;
+    try {
+        TestDataTree tree;
+        trees.get(5, tree);
+    } catch (const std::out_of_range &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "tree index out of range not detected");
+
+    // move assignment over a loaded collection releases its blocks and
+    // takes over those of the other
+    auto other_trees = reader.read_lazy(std::istringstream(get_nexus_source(TAXA, {TREES[4], TREES[2]})));
+    trees = std::move(other_trees);
+    fails += platypus::testing::compare_equal(2UL, trees.size(), __FILE__, __LINE__, "trees after move assignment");
+    fails += platypus::testing::compare_equal(0UL, other_trees.size(), __FILE__, __LINE__, "trees left after move assignment");
+    built.clear();
+    trees.get_each(trees.select(), [&] (TestDataTree & tree, unsigned long) { built.push_back(tree); });
+    fails += platypus::testing::compare_equal(get_expected({TREES[4], TREES[2]}), format_trees(built), __FILE__, __LINE__, "trees built after move assignment");
+    auto moved_trees(std::move(trees));
+    fails += platypus::testing::compare_equal(2UL, moved_trees.size(), __FILE__, __LINE__, "trees after move construction");
+    fails += platypus::testing::compare_equal(true, trees.empty(), __FILE__, __LINE__, "trees left after move construction");
+    return fails;
+}
+
+int check_characters() {
+    int fails = 0;
+    std::string src =
+        "#NEXUS\n"
+        "BEGIN DATA;\n"
+        "    DIMENSIONS NTAX=3 NCHAR=10;\n"
+        "    FORMAT DATATYPE=DNA MISSING=? GAP=-;\n"
+        "    MATRIX\n"
+        "        a ACGTACGTAC\n"
+        "        b ACGTACRY-?\n"
+        "        c AAGTAAGTAN\n"
+        "    ;\n"
+        "END;\n";
+    platypus::NucleotideCharacterMatrix expected(platypus::CharacterStateAlphabet::dna());
+    expected.add_sequence("a", "ACGTACGTAC");
+    expected.add_sequence("b", "ACGTACRY-?");
+    expected.add_sequence("c", "AAGTAAGTAN");
+    for (bool compress_patterns : {false, true}) {
+        std::string remarks = compress_patterns ? "compressed" : "not compressed";
+        platypus::TaxonNamespace taxon_namespace;
+        std::istringstream in(src);
+        auto matrix = platypus::NclCharacterMatrixReader::read<platypus::NucleotideCharacterMatrix>(in, "nexus", &taxon_namespace, compress_patterns);
+        fails += platypus::testing::compare_equal(3UL, static_cast<unsigned long>(matrix.num_taxa()), __FILE__, __LINE__, remarks, ": taxa");
+        fails += platypus::testing::compare_equal(3UL, static_cast<unsigned long>(taxon_namespace.size()), __FILE__, __LINE__, remarks, ": taxa in namespace");
+        fails += platypus::testing::compare_equal(10UL, static_cast<unsigned long>(matrix.num_original_sites()), __FILE__, __LINE__, remarks, ": sites");
+        unsigned long num_different = 0;
+        for (std::size_t row_idx = 0; row_idx < matrix.num_taxa(); ++row_idx) {
+            fails += platypus::testing::compare_equal(expected.get_taxon_label(row_idx), matrix.get_taxon_label(row_idx), __FILE__, __LINE__, remarks, ": taxon ", row_idx);
+            for (std::size_t site_idx = 0; site_idx < matrix.num_original_sites(); ++site_idx) {
+                std::size_t pattern_idx = compress_patterns ? matrix.get_site_pattern(site_idx) : site_idx;
+                num_different += matrix.get_state_set(row_idx, pattern_idx) != expected.get_state_set(row_idx, site_idx) ? 1 : 0;
+            }
+        }
+        fails += platypus::testing::compare_equal(0UL, num_different, __FILE__, __LINE__, remarks, ": state sets");
+    }
+    // sites 1 and 5, and 2 and 6, are alike
+    std::istringstream in(src);
+    auto compressed = platypus::NclCharacterMatrixReader::read<platypus::NucleotideCharacterMatrix>(in, "nexus", nullptr, true);
+    fails += platypus::testing::compare_equal(8UL, static_cast<unsigned long>(compressed.num_sites()), __FILE__, __LINE__, "patterns");
+
+    bool caught = false;
+    try {
+        std::istringstream trees_only(get_nexus_source(TAXA, TREES));
+        platypus::NclCharacterMatrixReader::read<platypus::CharacterMatrix>(trees_only);
+    } catch (const platypus::ReaderException &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "source without characters not detected");
+    return fails;
+}
+
+int check_distances() {
+    int fails = 0;
+    std::string src =
+        "#NEXUS\n"
+        "BEGIN TAXA;\n"
+        "    DIMENSIONS NTAX=4;\n"
+        "    TAXLABELS a b c d;\n"
+        "END;\n"
+        "BEGIN DISTANCES;\n"
+        "    FORMAT TRIANGLE=LOWER DIAGONAL;\n"
+        "    MATRIX\n"
+        "        a 0\n"
+        "        b 5 0\n"
+        "        c 9 10 0\n"
+        "        d 9 10 8 0\n"
+        "    ;\n"
+        "END;\n";
+    platypus::TaxonNamespace taxon_namespace;
+    taxon_namespace.add_taxon("d");
+    platypus::TriangularMatrix<double> matrix;
+    auto taxon_indexes = platypus::NclDistanceMatrixReader::read(std::istringstream(src), matrix, taxon_namespace);
+    fails += platypus::testing::compare_equal(4UL, static_cast<unsigned long>(matrix.size()), __FILE__, __LINE__, "matrix size");
+    std::vector<unsigned long> expected_indexes{1, 2, 3, 0};
+    fails += platypus::testing::compare_equal(expected_indexes,
+            std::vector<unsigned long>(taxon_indexes.begin(), taxon_indexes.end()),
+            __FILE__, __LINE__, "taxon indexes");
+    std::vector<double> expected{5, 9, 9, 10, 10, 8};
+    std::vector<double> distances;
+    for (std::size_t i = 0; i < matrix.size(); ++i) {
+        for (std::size_t j = i + 1; j < matrix.size(); ++j) {
+            distances.push_back(matrix.get(i, j));
+        }
+    }
+    fails += platypus::testing::compare_equal(expected, distances, __FILE__, __LINE__, "distances");
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_read();
+    fails += check_session();
+    fails += check_lazy();
+    fails += check_characters();
+    fails += check_distances();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <platypus/model/neighborjoining.hpp>
+#include <platypus/model/standardinterface.hpp>
+#include <platypus/parse/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TaxonTree::node_type NodeType;
+
+// random binary tree on taxa t0, ..., t{num_taxa-1}, with positive edge lengths
+std::string random_tree_string(std::mt19937 & rng, int num_taxa) {
+    std::uniform_real_distribution<double> length(0.5, 5.0);
+    std::vector<std::string> subtrees;
+    for (int i = 0; i < num_taxa; ++i) {
+        std::ostringstream o;
+        o << "t" << i << ":" << length(rng);
+        subtrees.push_back(o.str());
+    }
+    while (subtrees.size() > 1) {
+        std::size_t i = rng() % subtrees.size();
+        std::string a = subtrees[i];
+        subtrees.erase(subtrees.begin() + i);
+        std::size_t j = rng() % subtrees.size();
+        std::string b = subtrees[j];
+        subtrees.erase(subtrees.begin() + j);
+        std::ostringstream o;
+        o << "(" << a << "," << b << "):" << length(rng);
+        subtrees.push_back(o.str());
+    }
+    return subtrees[0] + ";";
+}
+
+platypus::TriangularMatrix<double> get_patristic_distances(const TaxonTree & tree, std::size_t num_taxa) {
+    platypus::PatristicDistances<> patristic;
+    patristic.assign(tree,
+            num_taxa,
+            [] (const platypus::TaxonNodeValue<> & nv) { return nv.get_taxon_index(); },
+            [] (const platypus::TaxonNodeValue<> & nv) { return nv.get_edge_length(); });
+    return patristic.distances();
+}
+
+// Straightforward neighbor-joining, searching all pairs at each step, for
+// reference.
+void reference_neighbor_joining(const platypus::TriangularMatrix<double> & distances, TaxonTree & tree) {
+    std::size_t n = distances.size();
+    std::vector<std::vector<double>> d(n, std::vector<double>(n, 0.0));
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+            d[i][j] = distances.get(i, j);
+        }
+    }
+    std::vector<NodeType *> nodes;
+    for (std::size_t i = 0; i < n; ++i) {
+        nodes.push_back(tree.create_leaf_node());
+        nodes.back()->value().set_taxon_index(i);
+    }
+    std::vector<std::size_t> active;
+    for (std::size_t i = 0; i < n; ++i) {
+        active.push_back(i);
+    }
+    while (active.size() > 3) {
+        std::size_t m = active.size();
+        std::vector<double> r(n, 0.0);
+        for (auto i : active) {
+            for (auto j : active) {
+                r[i] += d[i][j];
+            }
+        }
+        double best = INFINITY;
+        std::size_t bi = 0;
+        std::size_t bj = 0;
+        for (std::size_t x = 0; x < m; ++x) {
+            for (std::size_t y = x + 1; y < m; ++y) {
+                std::size_t i = active[x];
+                std::size_t j = active[y];
+                double q = (m - 2) * d[i][j] - r[i] - r[j];
+                if (q < best) {
+                    best = q;
+                    bi = i;
+                    bj = j;
+                }
+            }
+        }
+        double li = std::max(0.0, d[bi][bj] / 2 + (r[bi] - r[bj]) / (2.0 * (m - 2)));
+        double lj = std::max(0.0, d[bi][bj] - (d[bi][bj] / 2 + (r[bi] - r[bj]) / (2.0 * (m - 2))));
+        NodeType * nd = tree.create_internal_node();
+        nodes[bi]->value().set_edge_length(li);
+        nodes[bj]->value().set_edge_length(lj);
+        nd->add_child(nodes[bi]);
+        nd->add_child(nodes[bj]);
+        nodes[bi] = nd;
+        for (auto k : active) {
+            if (k != bi && k != bj) {
+                d[bi][k] = d[k][bi] = (d[bi][k] + d[bj][k] - d[bi][bj]) / 2;
+            }
+        }
+        active.erase(std::find(active.begin(), active.end(), bj));
+    }
+    std::size_t a = active[0];
+    std::size_t b = active[1];
+    std::size_t c = active[2];
+    nodes[a]->value().set_edge_length(std::max(0.0, (d[a][b] + d[a][c] - d[b][c]) / 2));
+    nodes[b]->value().set_edge_length(std::max(0.0, (d[a][b] + d[b][c] - d[a][c]) / 2));
+    nodes[c]->value().set_edge_length(std::max(0.0, (d[a][c] + d[b][c] - d[a][b]) / 2));
+    for (auto k : active) {
+        tree.head_node()->add_child(nodes[k]);
+    }
+    tree.mark_structure_modified();
+}
+
+int compare_distances(const platypus::TriangularMatrix<double> & expected,
+        const platypus::TriangularMatrix<double> & observed,
+        double tolerance,
+        const std::string & remarks) {
+    double max_error = 0.0;
+    for (std::size_t idx = 0; idx < expected.values().size(); ++idx) {
+        max_error = std::max(max_error, std::fabs(expected.values()[idx] - observed.values()[idx]));
+    }
+    return platypus::testing::compare_equal(true, max_error <= tolerance, __FILE__, __LINE__, remarks, ": maximum difference ", max_error);
+}
+
+int check_small_matrices() {
+    int fails = 0;
+    platypus::NeighborJoining<> nj;
+    // an additive matrix (as in the example of Saitou and Nei 1987)
+    platypus::TriangularMatrix<double> distances(5);
+    std::vector<double> values{5, 9, 9, 8, 10, 10, 9, 8, 7, 3};
+    for (std::size_t i = 0, idx = 0; i < 5; ++i) {
+        for (std::size_t j = i + 1; j < 5; ++j, ++idx) {
+            distances.set(i, j, values[idx]);
+        }
+    }
+    TaxonTree tree;
+    nj.build(tree, distances);
+    fails += platypus::testing::compare_equal(5UL, static_cast<unsigned long>(tree.get_num_leaves()), __FILE__, __LINE__, "number of leaves");
+    fails += platypus::testing::compare_equal(3UL, static_cast<unsigned long>(tree.head_node()->num_child_nodes()), __FILE__, __LINE__, "basal trifurcation");
+    fails += compare_distances(distances, get_patristic_distances(tree, 5), 1e-12, "additive five-taxon matrix");
+
+    for (std::size_t n : {0UL, 1UL, 2UL, 3UL}) {
+        platypus::TriangularMatrix<double> small(n);
+        if (n > 1) {
+            small.set(0, 1, 4.0);
+        }
+        if (n > 2) {
+            small.set(0, 2, 5.0);
+            small.set(1, 2, 7.0);
+        }
+        TaxonTree small_tree;
+        nj.build(small_tree, small);
+        fails += platypus::testing::compare_equal(n, static_cast<std::size_t>(small_tree.get_num_leaves()), __FILE__, __LINE__, "leaves of tree of ", n, " taxa");
+        if (n > 1) {
+            fails += compare_distances(small, get_patristic_distances(small_tree, n), 1e-12, "tree of " + std::to_string(n) + " taxa");
+        }
+    }
+
+    // integer-valued matrices, e.g. of Robinson-Foulds distances
+    platypus::TriangularMatrix<unsigned long> counts(4);
+    counts.set(0, 1, 2);
+    counts.set(0, 2, 4);
+    counts.set(0, 3, 4);
+    counts.set(1, 2, 4);
+    counts.set(1, 3, 4);
+    counts.set(2, 3, 2);
+    TaxonTree count_tree;
+    nj.build(count_tree, counts);
+    fails += platypus::testing::compare_equal(4UL, static_cast<unsigned long>(count_tree.get_num_leaves()), __FILE__, __LINE__, "tree from integer distances");
+    return fails;
+}
+
+int check_random_matrices() {
+    int fails = 0;
+    std::mt19937 rng(11);
+    for (int num_taxa : {4, 10, 60, 300}) {
+        // additive distances: the generating tree is recovered
+        platypus::TaxonNamespace taxa;
+        TaxonTree source_tree = read_tree(random_tree_string(rng, num_taxa), taxa);
+        platypus::TriangularMatrix<double> additive = get_patristic_distances(source_tree, taxa.size());
+        for (unsigned int num_threads : {1U, 4U}) {
+            platypus::NeighborJoining<> nj;
+            TaxonTree tree;
+            nj.build(tree, additive, num_threads);
+            fails += compare_distances(additive, get_patristic_distances(tree, taxa.size()), 1e-9,
+                    "additive distances of " + std::to_string(num_taxa) + " taxa, threads: " + std::to_string(num_threads));
+        }
+
+        // arbitrary distances: the same tree as an exhaustive search
+        std::uniform_real_distribution<double> uniform(1.0, 10.0);
+        platypus::TriangularMatrix<double> arbitrary(num_taxa);
+        for (int i = 0; i < num_taxa; ++i) {
+            for (int j = i + 1; j < num_taxa; ++j) {
+                arbitrary.set(i, j, uniform(rng));
+            }
+        }
+        TaxonTree reference_tree;
+        reference_neighbor_joining(arbitrary, reference_tree);
+        platypus::TriangularMatrix<double> expected = get_patristic_distances(reference_tree, num_taxa);
+        std::vector<platypus::TriangularMatrix<double>> observed;
+        for (unsigned int num_threads : {1U, 4U}) {
+            platypus::NeighborJoining<> nj;
+            TaxonTree tree;
+            nj.build(tree, arbitrary, num_threads);
+            observed.push_back(get_patristic_distances(tree, num_taxa));
+            fails += compare_distances(expected, observed.back(), 1e-9,
+                    "arbitrary distances of " + std::to_string(num_taxa) + " taxa, threads: " + std::to_string(num_threads));
+            if (num_taxa >= 60) {
+                unsigned long long exhaustive = 0;
+                for (unsigned long long m = 4; m <= static_cast<unsigned long long>(num_taxa); ++m) {
+                    exhaustive += m * (m - 1) / 2;
+                }
+                fails += platypus::testing::compare_equal(true, nj.get_num_pairs_evaluated() < exhaustive, __FILE__, __LINE__,
+                        "pairs evaluated: ", nj.get_num_pairs_evaluated(), " of ", exhaustive);
+            }
+        }
+        fails += platypus::testing::compare_equal(observed[0].values(), observed[1].values(), __FILE__, __LINE__, "result depends on number of threads");
+
+        // single-precision working distances
+        platypus::NeighborJoining<float> nj_float;
+        TaxonTree float_tree;
+        nj_float.build(float_tree, additive);
+        fails += compare_distances(additive, get_patristic_distances(float_tree, taxa.size()), 1e-2 * num_taxa,
+                "single-precision distances of " + std::to_string(num_taxa) + " taxa");
+    }
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_small_matrices();
+    fails += check_random_matrices();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,131 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <platypus/parse/newick.hpp>
+#include <platypus/model/tree.hpp>
+#include <platypus/model/standardinterface.hpp>
+#include <platypus/model/treenodearena.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::Tree<std::string, platypus::TreeNodeArena<platypus::TreeNode<std::string>>> ArenaTree;
+
+int check_trees(const std::vector<TestDataTree> & trees, unsigned long expected_num_trees, const std::string & remarks) {
+    int fails = 0;
+    fails += platypus::testing::compare_equal(expected_num_trees, trees.size(), __FILE__, __LINE__, remarks);
+    for (auto & tree : trees) {
+        auto t = tree;
+        fails += compare_against_standard_test_tree(t);
+        fails += compare_edge_lengths_against_standard_test_tree(t);
+    }
+    return fails;
+}
+
+// leaves with quoted labels and comments holding parentheses and commas
+std::string quoted_leaf_string(unsigned long i) {
+    return "'t(" + std::to_string(i) + ",)'[&x=(1,2)]";
+}
+
+int check_prescan_node_counts() {
+    int fails = 0;
+    const unsigned long num_tips = 3000;
+    std::string src = balanced_tree_string(0, num_tips, quoted_leaf_string, ":1") + ";\n(a,(b,c),d,e);";
+    for (bool prescan : {false, true}) {
+        platypus::NewickReader<ArenaTree> reader;
+        reader.set_node_label_setter([](std::string & nv, const std::string & label) { nv = label; });
+        reader.set_prescan_node_counts(prescan);
+        fails += platypus::testing::compare_equal(prescan, reader.get_prescan_node_counts(), __FILE__, __LINE__);
+        std::vector<ArenaTree> trees;
+        trees.reserve(2);
+        std::vector<unsigned long> initial_slabs;
+        auto tree_factory = [&trees, &initial_slabs]() -> ArenaTree & {
+            trees.emplace_back();
+            initial_slabs.push_back(trees.back().node_allocator().num_slabs());
+            return trees.back();
+        };
+        reader.read_buffer(src, tree_factory);
+        fails += platypus::testing::compare_equal(2UL, static_cast<unsigned long>(trees.size()), __FILE__, __LINE__);
+        if (trees.size() != 2) {
+            continue;
+        }
+        unsigned long num_leaves = 0;
+        unsigned long num_nodes = 0;
+        for (auto ndi = trees[0].preorder_begin(); ndi != trees[0].preorder_end(); ++ndi) {
+            ++num_nodes;
+            num_leaves += ndi.node()->is_leaf() ? 1 : 0;
+        }
+        fails += platypus::testing::compare_equal(num_tips, num_leaves, __FILE__, __LINE__, "prescan: ", prescan);
+        fails += platypus::testing::compare_equal(2 * num_tips - 1, num_nodes, __FILE__, __LINE__, "prescan: ", prescan);
+        unsigned long added_slabs = trees[0].node_allocator().num_slabs() - initial_slabs[0];
+        if (prescan) {
+            fails += platypus::testing::compare_equal(1UL, added_slabs, __FILE__, __LINE__, "nodes not allocated from a single slab");
+        } else if (added_slabs <= 1) {
+            fails += platypus::testing::fail_test(__FILE__, __LINE__, "> 1", added_slabs, "expecting slab growth without prescan");
+        }
+    }
+    return fails;
+}
+
+int main () {
+    std::ostringstream o;
+    o << ";;\n";
+    for (int i = 0; i < 5; ++i) {
+        o << "[tree " << i << "] " << STANDARD_TEST_TREE_WEDGE_NEWICK << "\n";
+    }
+    o << "('a b':1, 'c''d':2[x]);";
+    std::string src = o.str();
+
+    auto tree_reader = get_test_data_tree_newick_reader<TestDataTree>();
+    int fails = 0;
+
+    // buffer
+    std::vector<TestDataTree> trees;
+    auto tree_factory = [&trees]() -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+    tree_reader.read_buffer(src, tree_factory, 5);
+    fails += check_trees(trees, 5, "incorrect number of trees read from buffer");
+
+    // last tree
+    trees.clear();
+    tree_reader.read_buffer(src, tree_factory);
+    fails += platypus::testing::compare_equal(6UL, trees.size(), __FILE__, __LINE__);
+    if (trees.size() == 6) {
+        std::vector<std::string> labels;
+        std::vector<double> edge_lengths;
+        for (auto ndi = trees.back().leaf_begin(); ndi != trees.back().leaf_end(); ++ndi) {
+            labels.push_back(ndi->get_label());
+            edge_lengths.push_back(ndi->get_edge_length());
+        }
+        fails += platypus::testing::compare_equal(std::vector<std::string>{"a b", "c'd"}, labels, __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(std::vector<double>{1.0, 2.0}, edge_lengths, __FILE__, __LINE__);
+    }
+
+    // file
+    std::string path = "newick_reader_buffer.tre";
+    {
+        std::ofstream out(path);
+        out << src;
+    }
+    trees.clear();
+    tree_reader.read_file(path, tree_factory, 5);
+    std::remove(path.c_str());
+    fails += check_trees(trees, 5, "incorrect number of trees read from file");
+
+    // errors
+    bool caught = false;
+    try {
+        trees.clear();
+        tree_reader.read_buffer(std::string("(a,b"), tree_factory);
+    } catch (const platypus::TokenizerUnexpectedEndOfStreamError & e) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "premature end of buffer not detected");
+
+    fails += check_prescan_node_counts();
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,93 @@
+#include <sstream>
+#include <platypus/parse/newick.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+std::string read_and_write(const std::string & src, bool recursive_parsing, std::string & error) {
+    auto tree_reader = get_test_data_tree_newick_reader<TestDataTree>();
+    tree_reader.set_recursive_parsing(recursive_parsing);
+    std::vector<TestDataTree> trees;
+    try {
+        tree_reader.read(std::istringstream(src), [&trees]() -> TestDataTree & { trees.emplace_back(); return trees.back(); });
+    } catch (const platypus::NewickReaderMalformedStatementError & e) {
+        error = "NewickReaderMalformedStatementError";
+    } catch (const platypus::NewickReaderInvalidTokenError & e) {
+        error = "NewickReaderInvalidTokenError";
+    } catch (const platypus::TokenizerUnexpectedEndOfStreamError & e) {
+        error = "TokenizerUnexpectedEndOfStreamError";
+    }
+    platypus::NewickWriter<TestDataTree> writer = get_standard_newick_writer<TestDataTree>();
+    std::ostringstream o;
+    writer.write(o, trees.cbegin(), trees.cend());
+    return o.str();
+}
+
+int main () {
+    int fails = 0;
+
+    fails += platypus::testing::compare_equal(
+            false,
+            get_test_data_tree_newick_reader<TestDataTree>().get_recursive_parsing(),
+            __FILE__,
+            __LINE__,
+            "iterative parsing is not the default");
+
+    // iterative and recursive parsers yield identical trees and errors
+    std::vector<std::string> sources{
+        STANDARD_TEST_TREE_NEWICK,
+        STANDARD_TEST_TREE_WEDGE_NEWICK,
+        "(a:1,b:2)c:3;((d,e),(f,(g,h)));",
+        "(,);(,,);((,),(,));(a,,b);(a,(,)b,);",
+        "a;(a);((a));[&R] (a[x],'b c'[y])[z];",
+        ";;;(a,b);;;(c,d);",
+        "(a,b)c d;",
+        "(a,b)(c,d);",
+        "(a,(b,c);",
+        "(a,b):;",
+        "(a,b:x);",
+    };
+    for (auto & src : sources) {
+        std::string iterative_error;
+        std::string recursive_error;
+        std::string iterative_result = read_and_write(src, false, iterative_error);
+        std::string recursive_result = read_and_write(src, true, recursive_error);
+        fails += platypus::testing::compare_equal(recursive_result, iterative_result, __FILE__, __LINE__, src);
+        fails += platypus::testing::compare_equal(recursive_error, iterative_error, __FILE__, __LINE__, src);
+    }
+
+    // nesting deep enough to exhaust the call stack of a recursive parser
+    unsigned long num_tips = 100000;
+    std::ostringstream o;
+    for (unsigned long i = 1; i < num_tips; ++i) {
+        o << "(t" << i << ":1,";
+    }
+    o << "t" << num_tips << ":1";
+    for (unsigned long i = 1; i < num_tips; ++i) {
+        o << "):1";
+    }
+    o << ";";
+    auto tree_reader = get_test_data_tree_newick_reader<TestDataTree>();
+    tree_reader.set_tree_postprocess_fn([](TestDataTree & tree, unsigned long, unsigned long ntips, unsigned long nints, double length) {
+        tree.set_ntips(ntips);
+        tree.set_nints(nints);
+        tree.set_length(length);
+    });
+    TestDataTree tree;
+    tree_reader.read(std::istringstream(o.str()), [&tree]() -> TestDataTree & { return tree; });
+    fails += platypus::testing::compare_equal(num_tips, tree.get_ntips(), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(num_tips - 1, tree.get_nints(), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(static_cast<double>(2 * num_tips - 1), tree.get_length(), __FILE__, __LINE__);
+    unsigned long num_leaves = 0;
+    for (auto ndi = tree.leaf_begin(); ndi != tree.leaf_end(); ++ndi) {
+        ++num_leaves;
+    }
+    fails += platypus::testing::compare_equal(num_tips, num_leaves, __FILE__, __LINE__);
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
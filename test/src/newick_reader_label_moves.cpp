@@ -0,0 +1,107 @@
+#include <sstream>
+#include <platypus/model/standardinterface.hpp>
+#include <platypus/model/labelpool.hpp>
+#include <platypus/parse/newick.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+static unsigned long NUM_LABEL_COPIES = 0;
+static unsigned long NUM_LABEL_MOVES = 0;
+
+class CountingValue : public TestData {
+    public:
+        void set_label(const std::string & label) {
+            ++NUM_LABEL_COPIES;
+            this->label_ = label;
+        }
+        void set_label(std::string && label) {
+            ++NUM_LABEL_MOVES;
+            this->label_ = std::move(label);
+        }
+}; // CountingValue
+
+typedef platypus::StandardTree<CountingValue> CountingTree;
+typedef platypus::StandardTree<platypus::InternedLabelNodeValue<>> InternedTree;
+
+template <class TreeT>
+std::vector<TreeT> read_trees(platypus::NewickReader<TreeT> & reader, const std::string & src, bool from_buffer) {
+    std::vector<TreeT> trees;
+    auto tf = [&trees]() -> TreeT & { trees.emplace_back(); return trees.back(); };
+    if (from_buffer) {
+        reader.read_buffer(src, tf);
+    } else {
+        reader.read(std::istringstream(src), tf);
+    }
+    return trees;
+}
+
+int main () {
+    std::ostringstream o;
+    for (int i = 0; i < 20; ++i) {
+        o << "((a:1, 'b c''d with a label longer than the small string buffer':2)c" << i << ":3, (d:4, (e:5, f:6)g:7)h:8)i:9;\n";
+    }
+    std::string src = o.str();
+    // every node of every tree is labeled
+    unsigned long num_labels = 20 * 9;
+
+    int fails = 0;
+    auto writer = get_standard_newick_writer<CountingTree>();
+    writer.set_suppress_rooting(true);
+    std::string expected;
+    for (int from_buffer = 0; from_buffer < 2; ++from_buffer) {
+        std::string remarks = from_buffer ? "buffer" : "stream";
+        auto reader = get_test_data_tree_newick_reader<CountingTree>();
+
+        // labels moved into node values
+        NUM_LABEL_COPIES = 0;
+        NUM_LABEL_MOVES = 0;
+        auto trees = read_trees(reader, src, from_buffer);
+        fails += platypus::testing::compare_equal(0UL, NUM_LABEL_COPIES, __FILE__, __LINE__, remarks + ": labels copied");
+        fails += platypus::testing::compare_equal(num_labels, NUM_LABEL_MOVES, __FILE__, __LINE__, remarks + ": labels moved");
+        std::string observed = writer.format(trees.begin(), trees.end());
+        if (expected.empty()) {
+            expected = observed;
+        }
+        fails += platypus::testing::compare_equal(expected, observed, __FILE__, __LINE__, remarks + ": moved labels");
+
+        // without a mover, labels are copied in through the setter
+        reader.clear_node_label_mover();
+        NUM_LABEL_COPIES = 0;
+        NUM_LABEL_MOVES = 0;
+        trees = read_trees(reader, src, from_buffer);
+        fails += platypus::testing::compare_equal(num_labels, NUM_LABEL_COPIES, __FILE__, __LINE__, remarks + ": labels copied");
+        fails += platypus::testing::compare_equal(0UL, NUM_LABEL_MOVES, __FILE__, __LINE__, remarks + ": labels moved");
+        fails += platypus::testing::compare_equal(expected, writer.format(trees.begin(), trees.end()), __FILE__, __LINE__, remarks + ": copied labels");
+    }
+
+    // interned labels
+    for (int from_buffer = 0; from_buffer < 2; ++from_buffer) {
+        std::string remarks = from_buffer ? "interned, buffer" : "interned, stream";
+        platypus::LabelPool pool;
+        platypus::NewickReader<InternedTree> reader;
+        platypus::bind_label_pool(reader, pool);
+        reader.set_edge_length_setter([] (InternedTree::value_type & nv, double length) { nv.set_edge_length(length); });
+        auto trees = read_trees(reader, src, from_buffer);
+        // 8 labels shared by all trees, one distinct per tree, and the empty label
+        fails += platypus::testing::compare_equal(8UL + 20UL + 1UL, pool.size(), __FILE__, __LINE__, remarks + ": pool size");
+        auto leaf1 = trees[0].leaf_begin();
+        auto leaf2 = trees[19].leaf_begin();
+        fails += platypus::testing::compare_equal(
+                true,
+                leaf1->get_label_ptr() == leaf2->get_label_ptr(),
+                __FILE__,
+                __LINE__,
+                remarks + ": leaf labels not shared");
+        auto interned_writer = get_standard_newick_writer<InternedTree>();
+        interned_writer.set_suppress_rooting(true);
+        fails += platypus::testing::compare_equal(expected, interned_writer.format(trees.begin(), trees.end()), __FILE__, __LINE__, remarks);
+    }
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
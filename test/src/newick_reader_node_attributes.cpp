@@ -0,0 +1,140 @@
+#include <sstream>
+#include <platypus/parse/newick.hpp>
+#include <platypus/model/nodeattributes.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+// "[&R] ((A[&rate=0.5,height=1]:1.5,B:2[&rate=0.25,state=\"forest\"])[&height=3,hpd={2.5,3.5}]:0.5,C[&&NHX:S=human:D=N]:1)[&height=4];"
+// nodes in preorder: 0 (root), 1 (parent of A and B), 2 (A), 3 (B), 4 (C)
+int check_attributes(const platypus::NodeAttributeTable & attributes, const std::string & remarks) {
+    int fails = 0;
+    typedef platypus::NodeAttributeTable::index_type index_type;
+    fails += platypus::testing::compare_equal(5U, static_cast<unsigned int>(attributes.num_nodes()), __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(6U, static_cast<unsigned int>(attributes.num_attributes()), __FILE__, __LINE__, remarks);
+    std::vector<std::string> expected_names{"rate", "height", "state", "hpd", "S", "D"};
+    for (index_type idx = 0; idx < expected_names.size(); ++idx) {
+        fails += platypus::testing::compare_equal(expected_names[idx], attributes.get_attribute_name(idx), __FILE__, __LINE__, remarks);
+    }
+    fails += platypus::testing::compare_equal(true, attributes.find_attribute("missing") == platypus::NodeAttributeTable::npos, __FILE__, __LINE__, remarks);
+
+    index_type rate = attributes.find_attribute("rate");
+    fails += platypus::testing::compare_equal(false, attributes.has_value(0, rate), __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(false, attributes.has_value(1, rate), __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(0.5, attributes.get_number(2, rate), __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(0.25, attributes.get_number(3, rate), __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(false, attributes.has_value(4, rate), __FILE__, __LINE__, remarks);
+
+    index_type height = attributes.find_attribute("height");
+    std::vector<double> heights = attributes.get_numbers(height);
+    fails += platypus::testing::compare_equal(5UL, heights.size(), __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(4.0, heights[0], __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(3.0, heights[1], __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(1.0, heights[2], __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(true, heights[3] != heights[3], __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(true, heights[4] != heights[4], __FILE__, __LINE__, remarks);
+
+    index_type hpd = attributes.find_attribute("hpd");
+    fails += platypus::testing::compare_equal(2U, static_cast<unsigned int>(attributes.get_num_elements(1, hpd)), __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(2.5, attributes.get_number(1, hpd, 0), __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(3.5, attributes.get_number(1, hpd, 1), __FILE__, __LINE__, remarks);
+
+    index_type state = attributes.find_attribute("state");
+    fails += platypus::testing::compare_equal(false, attributes.is_number(3, state), __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(std::string("forest"), attributes.get_text(3, state).str(), __FILE__, __LINE__, remarks);
+
+    fails += platypus::testing::compare_equal(std::string("human"), attributes.get_text(4, attributes.find_attribute("S")).str(), __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(std::string("N"), attributes.get_text(4, attributes.find_attribute("D")).str(), __FILE__, __LINE__, remarks);
+    fails += platypus::testing::compare_equal(true, attributes.get_text(4, rate).empty(), __FILE__, __LINE__, remarks);
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    std::string tree_string = "[&R] ((A[&rate=0.5,height=1]:1.5,B:2[&rate=0.25,state=\"forest\"])[&height=3,hpd={2.5,3.5}]:0.5,C[&&NHX:S=human:D=N]:1)[&height=4];\n";
+    std::string src = tree_string + "((a,b),c);\n" + tree_string;
+
+    std::vector<TestDataTree> trees;
+    auto tree_factory = [&trees]() -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+    auto tree_reader = get_test_data_tree_newick_reader<TestDataTree>();
+    std::vector<unsigned long> tree_indexes;
+    std::string remarks;
+    tree_reader.set_node_attributes_fn([&](TestDataTree &, unsigned long tree_idx, const platypus::NodeAttributeTable & attributes) {
+        tree_indexes.push_back(tree_idx);
+        if (tree_idx == 1) {
+            fails += platypus::testing::compare_equal(5U, static_cast<unsigned int>(attributes.num_nodes()), __FILE__, __LINE__, remarks);
+            for (platypus::NodeAttributeTable::index_type attr_idx = 0; attr_idx < attributes.num_attributes(); ++attr_idx) {
+                for (platypus::NodeAttributeTable::index_type node_idx = 0; node_idx < attributes.num_nodes(); ++node_idx) {
+                    fails += platypus::testing::compare_equal(false, attributes.has_value(node_idx, attr_idx), __FILE__, __LINE__, remarks);
+                }
+            }
+        } else {
+            fails += check_attributes(attributes, remarks);
+        }
+    });
+    std::vector<unsigned long> expected_indexes{0, 1, 2};
+
+    for (bool recursive : {false, true}) {
+        tree_reader.set_recursive_parsing(recursive);
+        std::string suffix = recursive ? " (recursive)" : "";
+
+        remarks = "stream" + suffix;
+        tree_indexes.clear();
+        tree_reader.read(std::istringstream(src), tree_factory);
+        fails += platypus::testing::compare_equal(expected_indexes, tree_indexes, __FILE__, __LINE__, remarks);
+
+        remarks = "buffer" + suffix;
+        tree_indexes.clear();
+        tree_reader.read_buffer(src, tree_factory);
+        fails += platypus::testing::compare_equal(expected_indexes, tree_indexes, __FILE__, __LINE__, remarks);
+
+        for (unsigned int num_threads : {1, 4}) {
+            remarks = "parallel" + suffix;
+            tree_indexes.clear();
+            tree_reader.read_parallel(src, tree_factory, num_threads);
+            fails += platypus::testing::compare_equal(expected_indexes, tree_indexes, __FILE__, __LINE__, remarks);
+        }
+    }
+
+    // trees are built as usual
+    trees.clear();
+    tree_reader.read_buffer(tree_string, tree_factory);
+    std::vector<std::string> expected_labels{"", "", "A", "B", "C"};
+    std::vector<std::string> labels;
+    for (auto ndi = trees.back().preorder_begin(); ndi != trees.back().preorder_end(); ++ndi) {
+        labels.push_back(ndi->get_label());
+    }
+    fails += platypus::testing::compare_equal(expected_labels, labels, __FILE__, __LINE__);
+
+    // metadata is not extracted once the function is cleared
+    tree_reader.clear_node_attributes_fn();
+    tree_indexes.clear();
+    tree_reader.read_buffer(src, tree_factory);
+    fails += platypus::testing::compare_equal(0UL, tree_indexes.size(), __FILE__, __LINE__);
+
+    // table used directly
+    platypus::NodeAttributeTable table;
+    const char * comment = "&label='a, b',x = 2 ,flag, y={1,{2,3}},z=1e-3x";
+    fails += platypus::testing::compare_equal(true, table.parse_comment(3, comment, comment + std::strlen(comment)), __FILE__, __LINE__);
+    const char * non_metadata = "not metadata";
+    fails += platypus::testing::compare_equal(false, table.parse_comment(0, non_metadata, non_metadata + std::strlen(non_metadata)), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(4U, static_cast<unsigned int>(table.num_nodes()), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(std::string("a, b"), table.get_text(3, table.find_attribute("label")).str(), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(2.0, table.get_number(3, table.find_attribute("x")), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(true, table.has_value(3, table.find_attribute("flag")), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(0U, static_cast<unsigned int>(table.get_num_elements(3, table.find_attribute("flag"))), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(3U, static_cast<unsigned int>(table.get_num_elements(3, table.find_attribute("y"))), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(3.0, table.get_number(3, table.find_attribute("y"), 2), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(std::string("1e-3x"), table.get_text(3, table.find_attribute("z")).str(), __FILE__, __LINE__);
+    table.clear();
+    fails += platypus::testing::compare_equal(5U, static_cast<unsigned int>(table.num_attributes()), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(false, table.has_value(3, table.find_attribute("x")), __FILE__, __LINE__);
+    table.reset();
+    fails += platypus::testing::compare_equal(0U, static_cast<unsigned int>(table.num_attributes()), __FILE__, __LINE__);
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
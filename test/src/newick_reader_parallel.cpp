@@ -0,0 +1,69 @@
+#include <sstream>
+#include <platypus/parse/newick.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+int main () {
+    std::ostringstream o;
+    o << ";\n";
+    unsigned long num_trees = 500;
+    for (unsigned long i = 0; i < num_trees; ++i) {
+        o << "[&R] [tree; " << i << "] ((a" << i << ":" << i << ", 'b;" << i << "':1.5)[x;y]c:2, (d:" << (i * 0.5) << ", e:3)f:4)g;\n";
+    }
+    std::string src = o.str();
+
+    auto tree_reader = get_test_data_tree_newick_reader<TestDataTree>();
+    tree_reader.set_tree_postprocess_fn([](TestDataTree & tree, unsigned long idx, unsigned long ntips, unsigned long nints, double length) {
+        tree.set_index(idx);
+        tree.set_ntips(ntips);
+        tree.set_nints(nints);
+        tree.set_length(length);
+    });
+
+    std::vector<TestDataTree> expected_trees;
+    tree_reader.read(std::istringstream(src), [&expected_trees]() -> TestDataTree & { expected_trees.emplace_back(); return expected_trees.back(); });
+
+    int fails = 0;
+    fails += platypus::testing::compare_equal(num_trees, expected_trees.size(), __FILE__, __LINE__);
+    std::string expected = write_trees(expected_trees);
+
+    for (unsigned int num_threads : {1, 2, 4, 7}) {
+        std::vector<TestDataTree> trees;
+        auto tree_factory = [&trees]() -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+        unsigned long count = tree_reader.read_parallel(src, tree_factory, num_threads);
+        fails += platypus::testing::compare_equal(num_trees, count, __FILE__, __LINE__, "threads: ", num_threads);
+        fails += platypus::testing::compare_equal(expected, write_trees(trees), __FILE__, __LINE__, "threads: ", num_threads);
+        for (unsigned long i = 0; i < trees.size() && i < expected_trees.size(); ++i) {
+            fails += platypus::testing::compare_equal(i, trees[i].get_index(), __FILE__, __LINE__, "threads: ", num_threads);
+            fails += platypus::testing::compare_equal(expected_trees[i].get_ntips(), trees[i].get_ntips(), __FILE__, __LINE__);
+            fails += platypus::testing::compare_equal(expected_trees[i].get_nints(), trees[i].get_nints(), __FILE__, __LINE__);
+            fails += platypus::testing::compare_equal(expected_trees[i].get_length(), trees[i].get_length(), __FILE__, __LINE__);
+        }
+
+        // limit
+        trees.clear();
+        count = tree_reader.read_parallel(std::istringstream(src), tree_factory, num_threads, 37);
+        fails += platypus::testing::compare_equal(37UL, count, __FILE__, __LINE__, "threads: ", num_threads);
+        fails += platypus::testing::compare_equal(37UL, trees.size(), __FILE__, __LINE__, "threads: ", num_threads);
+
+        // errors: trees before the malformed statement are delivered
+        std::string bad_src = "(a,b);(c,d);(e,(f g));(h,i);";
+        trees.clear();
+        bool caught = false;
+        try {
+            tree_reader.read_parallel(bad_src, tree_factory, num_threads);
+        } catch (const platypus::NewickReaderMalformedStatementError & e) {
+            caught = true;
+        }
+        fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "threads: ", num_threads);
+        fails += platypus::testing::compare_equal(2UL, trees.size(), __FILE__, __LINE__, "threads: ", num_threads);
+    }
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,138 @@
+#include <sstream>
+#include <stdexcept>
+#include <platypus/parse/newick.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+// Serves the characters of a string, then fails.
+class FailingStreamBuffer : public std::streambuf {
+    public:
+        FailingStreamBuffer(const std::string & src, std::size_t fail_at)
+            : src_(src.substr(0, fail_at)) {
+            char * begin = &this->src_[0];
+            this->setg(begin, begin, begin + this->src_.size());
+        }
+    protected:
+        int_type underflow() override {
+            throw std::runtime_error("source failed");
+        }
+    private:
+        std::string src_;
+};
+
+int main () {
+    std::ostringstream o;
+    o << ";\n";
+    unsigned long num_trees = 300;
+    for (unsigned long i = 0; i < num_trees; ++i) {
+        o << "[&R] [tree; " << i << "] ((a" << i << ":" << i << ", 'b;" << i << "':1.5)[x;y]c:2, (d:" << (i * 0.5) << ", e:3)f:4)g;\n";
+        if (i % 50 == 0) {
+            o << ";\n";
+        }
+    }
+    std::string src = o.str();
+
+    auto tree_reader = get_test_data_tree_newick_reader<TestDataTree>();
+    tree_reader.set_tree_postprocess_fn([](TestDataTree & tree, unsigned long idx, unsigned long ntips, unsigned long nints, double length) {
+        tree.set_index(idx);
+        tree.set_ntips(ntips);
+        tree.set_nints(nints);
+        tree.set_length(length);
+    });
+
+    std::vector<TestDataTree> expected_trees;
+    tree_reader.read(std::istringstream(src), [&expected_trees]() -> TestDataTree & { expected_trees.emplace_back(); return expected_trees.back(); });
+
+    int fails = 0;
+    fails += platypus::testing::compare_equal(num_trees, expected_trees.size(), __FILE__, __LINE__);
+    std::string expected = write_trees(expected_trees);
+
+    std::vector<TestDataTree> trees;
+    auto tree_factory = [&trees]() -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+    for (unsigned int num_threads : {1, 2, 5}) {
+        // chunks smaller than, around, and larger than a single statement
+        for (std::size_t chunk_size : {7, 100, 1 << 20}) {
+            trees.clear();
+            unsigned long count = tree_reader.read_pipelined(std::istringstream(src), tree_factory, num_threads, 0, chunk_size);
+            fails += platypus::testing::compare_equal(num_trees, count, __FILE__, __LINE__, "threads: ", num_threads, ", chunk: ", chunk_size);
+            fails += platypus::testing::compare_equal(expected, write_trees(trees), __FILE__, __LINE__, "threads: ", num_threads, ", chunk: ", chunk_size);
+            for (unsigned long i = 0; i < trees.size() && i < expected_trees.size(); ++i) {
+                fails += platypus::testing::compare_equal(i, trees[i].get_index(), __FILE__, __LINE__);
+                fails += platypus::testing::compare_equal(expected_trees[i].get_ntips(), trees[i].get_ntips(), __FILE__, __LINE__);
+                fails += platypus::testing::compare_equal(expected_trees[i].get_length(), trees[i].get_length(), __FILE__, __LINE__);
+            }
+        }
+
+        // limit
+        trees.clear();
+        unsigned long count = tree_reader.read_pipelined(std::istringstream(src), tree_factory, num_threads, 37, 64);
+        fails += platypus::testing::compare_equal(37UL, count, __FILE__, __LINE__, "threads: ", num_threads);
+        fails += platypus::testing::compare_equal(37UL, trees.size(), __FILE__, __LINE__, "threads: ", num_threads);
+
+        // parse errors: trees before the malformed statement are delivered
+        trees.clear();
+        bool caught = false;
+        try {
+            tree_reader.read_pipelined(std::istringstream("(a,b);(c,d);(e,(f g));(h,i);"), tree_factory, num_threads, 0, 3);
+        } catch (const platypus::NewickReaderMalformedStatementError & e) {
+            caught = true;
+        }
+        fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "threads: ", num_threads);
+        fails += platypus::testing::compare_equal(2UL, trees.size(), __FILE__, __LINE__, "threads: ", num_threads);
+
+        // source errors: complete statements read before the failure are
+        // delivered (other than those in a chunk being read when the source
+        // failed)
+        trees.clear();
+        caught = false;
+        std::size_t fail_at = src.find("[tree; 120]");
+        FailingStreamBuffer failing_buffer(src, fail_at + 3);
+        std::istream failing_src(&failing_buffer);
+        failing_src.exceptions(std::ios::badbit);
+        try {
+            tree_reader.read_pipelined(failing_src, tree_factory, num_threads, 0, 256);
+        } catch (const std::runtime_error & e) {
+            caught = true;
+        }
+        fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "threads: ", num_threads);
+        fails += platypus::testing::compare_equal(true, trees.size() >= 117 && trees.size() <= 120, __FILE__, __LINE__, "threads: ", num_threads, ", trees: ", trees.size());
+        fails += platypus::testing::compare_equal(
+                write_trees(std::vector<TestDataTree>(expected_trees.begin(), expected_trees.begin() + trees.size())),
+                write_trees(trees),
+                __FILE__, __LINE__, "threads: ", num_threads);
+
+        // errors raised by the caller's functions tear down the pipeline
+        trees.clear();
+        caught = false;
+        auto throwing_factory = [&trees]() -> TestDataTree & {
+            if (trees.size() == 10) {
+                throw std::logic_error("enough");
+            }
+            trees.emplace_back();
+            return trees.back();
+        };
+        try {
+            tree_reader.read_pipelined(std::istringstream(src), throwing_factory, num_threads, 0, 16);
+        } catch (const std::logic_error & e) {
+            caught = true;
+        }
+        fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "threads: ", num_threads);
+    }
+
+    // skipping and thinning
+    tree_reader.set_skip_first(10);
+    tree_reader.set_every_nth(3);
+    std::vector<TestDataTree> expected_thinned;
+    tree_reader.read(std::istringstream(src), [&expected_thinned]() -> TestDataTree & { expected_thinned.emplace_back(); return expected_thinned.back(); });
+    trees.clear();
+    tree_reader.read_pipelined(std::istringstream(src), tree_factory, 3, 0, 50);
+    fails += platypus::testing::compare_equal(write_trees(expected_thinned), write_trees(trees), __FILE__, __LINE__);
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,76 @@
+#include <sstream>
+#include <platypus/parse/newick.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+int main () {
+    std::ostringstream o;
+    unsigned long num_trees = 53;
+    for (unsigned long i = 0; i < num_trees; ++i) {
+        // quoted labels and comments with semi-colons must not end a
+        // skipped statement
+        o << "[&R] ((a" << i << ":1, 'b;[':2)c:3, (d:4 [x;(], (e:5, f:" << i << ")g:6)h:7)i;";
+        if (i % 5 == 0) {
+            o << ";;";
+        }
+        o << "\n";
+    }
+    std::string src = o.str();
+
+    auto tree_reader = get_test_data_tree_newick_reader<TestDataTree>();
+    std::vector<TestDataTree> all_trees;
+    tree_reader.read(std::istringstream(src), [&all_trees]() -> TestDataTree & { all_trees.emplace_back(); return all_trees.back(); });
+
+    int fails = 0;
+    fails += platypus::testing::compare_equal(num_trees, static_cast<unsigned long>(all_trees.size()), __FILE__, __LINE__);
+
+    struct Case { unsigned long skip_first; unsigned long every_nth; unsigned long limit; };
+    std::vector<Case> cases = { {0, 1, 0}, {10, 1, 0}, {0, 7, 0}, {13, 4, 0}, {13, 4, 5}, {52, 3, 0}, {60, 1, 0} };
+    for (auto & c : cases) {
+        std::vector<TestDataTree> expected;
+        for (unsigned long i = c.skip_first; i < num_trees; i += c.every_nth) {
+            if (c.limit > 0 && expected.size() >= c.limit) {
+                break;
+            }
+            expected.push_back(all_trees[i]);
+        }
+        std::string expected_src = write_trees(expected);
+        tree_reader.set_skip_first(c.skip_first);
+        tree_reader.set_every_nth(c.every_nth);
+
+        // stream
+        std::vector<TestDataTree> trees;
+        auto tf = [&trees]() -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+        unsigned long count = tree_reader.read(std::istringstream(src), tf, c.limit);
+        fails += platypus::testing::compare_equal(static_cast<unsigned long>(expected.size()), count, __FILE__, __LINE__, "stream");
+        fails += platypus::testing::compare_equal(expected_src, write_trees(trees), __FILE__, __LINE__, "stream");
+
+        // buffer
+        trees.clear();
+        count = tree_reader.read_buffer(src, tf, c.limit);
+        fails += platypus::testing::compare_equal(static_cast<unsigned long>(expected.size()), count, __FILE__, __LINE__, "buffer");
+        fails += platypus::testing::compare_equal(expected_src, write_trees(trees), __FILE__, __LINE__, "buffer");
+
+        // parallel
+        trees.clear();
+        count = tree_reader.read_parallel(src, tf, 3, c.limit);
+        fails += platypus::testing::compare_equal(static_cast<unsigned long>(expected.size()), count, __FILE__, __LINE__, "parallel");
+        fails += platypus::testing::compare_equal(expected_src, write_trees(trees), __FILE__, __LINE__, "parallel");
+
+        // streaming, with indexes of trees read
+        unsigned long num_visited = 0;
+        tree_reader.read_each(std::istringstream(src), [&](TestDataTree &, unsigned long idx) {
+            fails += platypus::testing::compare_equal(num_visited, idx, __FILE__, __LINE__, "read_each");
+            ++num_visited;
+        }, c.limit);
+        fails += platypus::testing::compare_equal(static_cast<unsigned long>(expected.size()), num_visited, __FILE__, __LINE__, "read_each");
+    }
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
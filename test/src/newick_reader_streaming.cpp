@@ -0,0 +1,65 @@
+#include <sstream>
+#include <platypus/parse/newick.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+int main () {
+    std::ostringstream o;
+    unsigned long num_trees = 50;
+    for (unsigned long i = 0; i < num_trees; ++i) {
+        o << "((a" << i << ":1, b:2)c:3, (d:4, (e:5, f:" << i << ")g:6)h:7)i;\n";
+    }
+    std::string src = o.str();
+
+    auto tree_reader = get_test_data_tree_newick_reader<TestDataTree>();
+    tree_reader.set_tree_postprocess_fn([](TestDataTree & tree, unsigned long idx, unsigned long, unsigned long, double length) {
+        tree.set_index(idx);
+        tree.set_length(length);
+    });
+    platypus::NewickWriter<TestDataTree> writer = get_standard_newick_writer<TestDataTree>();
+    std::vector<TestDataTree> expected_trees;
+    tree_reader.read(std::istringstream(src), [&expected_trees]() -> TestDataTree & { expected_trees.emplace_back(); return expected_trees.back(); });
+
+    int fails = 0;
+    TestDataTree tree;
+    unsigned long num_visited = 0;
+    unsigned long count = tree_reader.read_each(std::istringstream(src), tree,
+            [&](TestDataTree & t, unsigned long idx) {
+                fails += platypus::testing::compare_equal(true, &t == &tree, __FILE__, __LINE__, "tree not reused");
+                fails += platypus::testing::compare_equal(num_visited, idx, __FILE__, __LINE__);
+                // post-processing has already been applied
+                fails += platypus::testing::compare_equal(idx, t.get_index(), __FILE__, __LINE__);
+                fails += platypus::testing::compare_equal(expected_trees[idx].get_length(), t.get_length(), __FILE__, __LINE__);
+                std::ostringstream expected;
+                writer.write(expected, expected_trees[idx]);
+                std::ostringstream observed;
+                writer.write(observed, t);
+                fails += platypus::testing::compare_equal(expected.str(), observed.str(), __FILE__, __LINE__);
+                ++num_visited;
+            });
+    fails += platypus::testing::compare_equal(num_trees, count, __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(num_trees, num_visited, __FILE__, __LINE__);
+
+    // limit, default-constructed tree
+    num_visited = 0;
+    count = tree_reader.read_each(std::istringstream(src),
+            [&](TestDataTree &, unsigned long) { ++num_visited; },
+            7);
+    fails += platypus::testing::compare_equal(7UL, count, __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(7UL, num_visited, __FILE__, __LINE__);
+
+    // empty source
+    num_visited = 0;
+    count = tree_reader.read_each(std::istringstream(";;"),
+            [&](TestDataTree &, unsigned long) { ++num_visited; });
+    fails += platypus::testing::compare_equal(0UL, count, __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(0UL, num_visited, __FILE__, __LINE__);
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
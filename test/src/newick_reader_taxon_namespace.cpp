@@ -0,0 +1,126 @@
+#include <sstream>
+#include <platypus/model/standardinterface.hpp>
+#include <platypus/model/taxonnamespace.hpp>
+#include <platypus/parse/newick.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::StandardTree<platypus::TaxonNodeValue<>> TaxonTree;
+
+template <class TreeT>
+std::vector<TreeT> read_trees(platypus::NewickReader<TreeT> & reader, const std::string & src, int mode) {
+    std::vector<TreeT> trees;
+    auto tf = [&trees]() -> TreeT & { trees.emplace_back(); return trees.back(); };
+    if (mode == 0) {
+        reader.read(std::istringstream(src), tf);
+    } else if (mode == 1) {
+        reader.read_buffer(src, tf);
+    } else {
+        reader.read_parallel(src, tf, 4);
+    }
+    return trees;
+}
+
+platypus::NewickReader<TaxonTree> get_taxon_tree_reader(platypus::TaxonNamespace & taxon_namespace) {
+    platypus::NewickReader<TaxonTree> reader;
+    platypus::bind_standard_interface(reader);
+    platypus::bind_taxon_namespace(reader, taxon_namespace);
+    return reader;
+}
+
+int main () {
+    std::ostringstream o;
+    for (int i = 0; i < 40; ++i) {
+        if (i % 2 == 0) {
+            o << "((a:1, 'b c':2)0.9" << i << ":3, (d:4, (e:5, f:6)0.5:7):8);\n";
+        } else {
+            o << "(((f:1, e:2):3, d:4)g:5, ('b c':6, a:7):8);\n";
+        }
+    }
+    std::string src = o.str();
+
+    int fails = 0;
+    auto test_data_reader = get_test_data_tree_newick_reader<TestDataTree>();
+    auto test_data_trees = read_trees(test_data_reader, src, 0);
+    auto test_data_writer = get_standard_newick_writer<TestDataTree>();
+    test_data_writer.set_suppress_rooting(true);
+    std::string expected = test_data_writer.format(test_data_trees.begin(), test_data_trees.end());
+    std::vector<std::string> expected_labels{"a", "b c", "d", "e", "f"};
+
+    for (int mode = 0; mode < 3; ++mode) {
+        std::string remarks = mode == 0 ? "stream" : (mode == 1 ? "buffer" : "parallel");
+        platypus::TaxonNamespace taxon_namespace;
+        if (mode == 2) {
+            // indexes assigned by parallel reads are not ordered
+            for (auto & label : expected_labels) {
+                taxon_namespace.add_taxon(label);
+            }
+        }
+        auto reader = get_taxon_tree_reader(taxon_namespace);
+        auto trees = read_trees(reader, src, mode);
+        fails += platypus::testing::compare_equal(
+                expected_labels,
+                std::vector<std::string>(taxon_namespace.labels().begin(), taxon_namespace.labels().end()),
+                __FILE__,
+                __LINE__,
+                remarks + ": taxon namespace");
+
+        // leaves hold taxa (but not labels); internal nodes hold labels
+        unsigned long num_label_errors = 0;
+        for (auto & tree : trees) {
+            for (auto nd = tree.preorder_begin(); nd != tree.preorder_end(); ++nd) {
+                if (nd.is_leaf()) {
+                    if (!nd->has_taxon() || !nd->get_label().empty()) {
+                        ++num_label_errors;
+                    }
+                } else if (nd->has_taxon()) {
+                    ++num_label_errors;
+                }
+            }
+        }
+        fails += platypus::testing::compare_equal(0UL, num_label_errors, __FILE__, __LINE__, remarks + ": node labels");
+
+        auto writer = get_standard_newick_writer<TaxonTree>();
+        writer.set_suppress_rooting(true);
+        platypus::bind_taxon_namespace(writer, taxon_namespace);
+        fails += platypus::testing::compare_equal(
+                expected,
+                writer.format(trees.begin(), trees.end()),
+                __FILE__,
+                __LINE__,
+                remarks + ": trees");
+    }
+
+    // namespace shared across readers
+    platypus::TaxonNamespace shared_namespace;
+    auto reader1 = get_taxon_tree_reader(shared_namespace);
+    auto reader2 = get_taxon_tree_reader(shared_namespace);
+    auto trees1 = read_trees(reader1, "((a,b),(c,d));", 1);
+    auto trees2 = read_trees(reader2, "((x,d),(c,a));", 0);
+    fails += platypus::testing::compare_equal(5UL, static_cast<unsigned long>(shared_namespace.size()), __FILE__, __LINE__, "shared namespace size");
+    fails += platypus::testing::compare_equal(
+            static_cast<unsigned long>(trees1[0].leaf_begin()->get_taxon_index()),
+            static_cast<unsigned long>(std::next(trees2[0].leaf_begin(), 3)->get_taxon_index()),
+            __FILE__,
+            __LINE__,
+            "shared taxon index");
+
+    // locked namespace
+    shared_namespace.set_is_locked(true);
+    bool thrown = false;
+    try {
+        read_trees(reader1, "((a,b),(c,z));", 1);
+    } catch (const platypus::TaxonNamespaceError &) {
+        thrown = true;
+    }
+    fails += platypus::testing::compare_equal(true, thrown, __FILE__, __LINE__, "unknown taxon in locked namespace");
+    fails += platypus::testing::compare_equal(5UL, static_cast<unsigned long>(shared_namespace.size()), __FILE__, __LINE__, "locked namespace size");
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,120 @@
+#include <stdlib.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <platypus/model/treenodearena.hpp>
+#include <platypus/model/treepool.hpp>
+#include <platypus/parse/newick.hpp>
+#include <platypus/utility/parallel.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::TreeNode<TestData> NodeType;
+
+// counts live instances, to check that pooled trees are destroyed
+class CountedTree : public platypus::StandardTree<TestData, platypus::TreeNodeArena<NodeType>> {
+    public:
+        CountedTree() {
+            ++CountedTree::num_live;
+        }
+        CountedTree(const CountedTree & other)
+            : platypus::StandardTree<TestData, platypus::TreeNodeArena<NodeType>>(other) {
+            ++CountedTree::num_live;
+        }
+        ~CountedTree() {
+            --CountedTree::num_live;
+        }
+        static long num_live;
+};
+long CountedTree::num_live = 0;
+
+
+int main() {
+    int fails = 0;
+    std::ostringstream o;
+    for (int idx = 0; idx < 150; ++idx) {
+        o << "((a:1,b:" << idx << ")c:2,(d:3,e:4)f:5)g;\n";
+    }
+    const std::string src = o.str();
+    auto reader = get_test_data_tree_newick_reader<CountedTree>();
+    auto writer = get_standard_newick_writer<CountedTree>();
+
+    std::istringstream src_vector_stream(src);
+    std::vector<CountedTree> tree_vector = reader.get_tree_vector(src_vector_stream);
+    std::string expected = writer.format(tree_vector.begin(), tree_vector.end());
+    fails += platypus::testing::compare_equal(150UL, static_cast<unsigned long>(tree_vector.size()), __FILE__, __LINE__, "vector size");
+
+    {
+        std::istringstream src_stream(src);
+        auto tree_ptrs = reader.get_tree_ptr_vector(src_stream);
+        fails += platypus::testing::compare_equal(150UL, static_cast<unsigned long>(tree_ptrs.size()), __FILE__, __LINE__, "pointer vector size");
+        std::vector<CountedTree> copies;
+        for (auto & tree : tree_ptrs) {
+            copies.push_back(*tree);
+        }
+        fails += platypus::testing::compare_equal(expected, writer.format(copies.begin(), copies.end()), __FILE__, __LINE__, "pointer vector");
+    }
+
+    long num_live_before = CountedTree::num_live;
+    {
+        std::istringstream src_stream(src);
+        platypus::TreePool<CountedTree> pool = reader.get_tree_pool(src_stream, 100);
+        fails += platypus::testing::compare_equal(100UL, static_cast<unsigned long>(pool.size()), __FILE__, __LINE__, "pool size with limit");
+        fails += platypus::testing::compare_equal(num_live_before + 100, CountedTree::num_live, __FILE__, __LINE__, "live pooled trees");
+        std::vector<CountedTree> copies;
+        for (auto tree : pool) {
+            copies.push_back(*tree);
+        }
+        fails += platypus::testing::compare_equal(writer.format(tree_vector.begin(), tree_vector.begin() + 100),
+                writer.format(copies.begin(), copies.end()), __FILE__, __LINE__, "pool");
+
+        // trees keep their addresses when the pool is moved
+        CountedTree * first = &pool[0];
+        platypus::TreePool<CountedTree> moved(std::move(pool));
+        fails += platypus::testing::compare_equal(true, first == &moved[0], __FILE__, __LINE__, "address after move");
+        fails += platypus::testing::compare_equal(0UL, static_cast<unsigned long>(pool.size()), __FILE__, __LINE__, "moved-from pool");
+
+        // pooled trees can be visited in parallel
+        std::vector<unsigned long> num_leaves(moved.size(), 0);
+        platypus::parallel::for_each_tree(moved, [&num_leaves] (CountedTree & tree, std::size_t idx) {
+            num_leaves[idx] = tree.get_num_leaves();
+        }, 3);
+        fails += platypus::testing::compare_equal(std::vector<unsigned long>(moved.size(), 4), num_leaves, __FILE__, __LINE__, "parallel over pool");
+    }
+    fails += platypus::testing::compare_equal(num_live_before, CountedTree::num_live, __FILE__, __LINE__, "pooled trees destroyed");
+
+    // indexed sources
+    {
+        platypus::TreeOffsetIndex index = platypus::TreeOffsetIndex::build(src);
+        std::istringstream src_stream(src);
+        std::vector<CountedTree> indexed = reader.get_tree_vector(src_stream, index);
+        fails += platypus::testing::compare_equal(expected, writer.format(indexed.begin(), indexed.end()), __FILE__, __LINE__, "indexed vector");
+        platypus::TreePool<CountedTree> pool = reader.get_tree_pool(src_stream, index);
+        fails += platypus::testing::compare_equal(150UL, static_cast<unsigned long>(pool.size()), __FILE__, __LINE__, "indexed pool size");
+        auto tree_ptrs = reader.get_tree_ptr_vector(src_stream, index);
+        fails += platypus::testing::compare_equal(150UL, static_cast<unsigned long>(tree_ptrs.size()), __FILE__, __LINE__, "indexed pointer vector size");
+    }
+
+    // growth beyond the reserved capacity
+    {
+        platypus::TreePool<CountedTree> pool(4);
+        pool.reserve(6);
+        for (int idx = 0; idx < 30; ++idx) {
+            pool.create();
+        }
+        pool.reserve(40);
+        for (int idx = 0; idx < 10; ++idx) {
+            pool.create();
+        }
+        fails += platypus::testing::compare_equal(40UL, static_cast<unsigned long>(pool.size()), __FILE__, __LINE__, "pool growth");
+        pool.clear();
+        fails += platypus::testing::compare_equal(num_live_before, CountedTree::num_live, __FILE__, __LINE__, "pool cleared");
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
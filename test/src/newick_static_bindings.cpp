@@ -0,0 +1,97 @@
+#include <sstream>
+#include <platypus/model/standardinterface.hpp>
+#include <platypus/parse/newick.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::StandardTree<platypus::StandardNodeValue<double>> StandardTreeType;
+
+template <class TreeT, class ReaderT>
+std::vector<TreeT> read_all(ReaderT & reader, const std::string & src, int mode) {
+    std::vector<TreeT> trees;
+    auto tf = [&trees]() -> TreeT & { trees.emplace_back(); return trees.back(); };
+    if (mode == 0) {
+        reader.read(std::istringstream(src), tf);
+    } else if (mode == 1) {
+        reader.read_buffer(src, tf);
+    } else {
+        reader.read_parallel(src, tf, 3);
+    }
+    return trees;
+}
+
+int main () {
+    std::ostringstream o;
+    for (unsigned long i = 0; i < 30; ++i) {
+        o << "[&R] ((a" << i << ":1.5, 'b c''d':2)c:3, (d:4, ([x]e[y]:5, f:" << i << ")g:6)h:7)i:0.25;\n";
+    }
+    std::string src = o.str();
+
+    static_assert(!platypus::NewickReader<TestDataTree>::has_static_setters, "default reader has static setters");
+    static_assert(platypus::StandardNewickReader<TestDataTree>::has_static_setters, "standard reader has no static setters");
+    static_assert(!platypus::NewickWriter<TestDataTree>::has_static_getters, "default writer has static getters");
+    static_assert(platypus::StandardNewickWriter<TestDataTree>::has_static_getters, "standard writer has no static getters");
+
+    int fails = 0;
+
+    auto function_reader = get_test_data_tree_newick_reader<TestDataTree>();
+    auto function_writer = get_standard_newick_writer<TestDataTree>();
+    platypus::StandardNewickReader<TestDataTree> static_reader;
+    platypus::StandardNewickWriter<TestDataTree> static_writer;
+    for (int mode = 0; mode < 3; ++mode) {
+        auto expected_trees = read_all<TestDataTree>(function_reader, src, mode);
+        auto observed_trees = read_all<TestDataTree>(static_reader, src, mode);
+        std::string expected = function_writer.format(expected_trees.begin(), expected_trees.end());
+        fails += platypus::testing::compare_equal(
+                expected,
+                function_writer.format(observed_trees.begin(), observed_trees.end()),
+                __FILE__,
+                __LINE__,
+                "static setters");
+        fails += platypus::testing::compare_equal(
+                expected,
+                static_writer.format(expected_trees.begin(), expected_trees.end()),
+                __FILE__,
+                __LINE__,
+                "static getters");
+    }
+
+    // suppression flags apply to static getters
+    auto trees = read_all<TestDataTree>(static_reader, src, 1);
+    function_writer.set_suppress_rooting(true);
+    function_writer.set_suppress_internal_node_labels(true);
+    function_writer.set_suppress_edge_lengths(true);
+    static_writer.set_suppress_rooting(true);
+    static_writer.set_suppress_internal_node_labels(true);
+    static_writer.set_suppress_edge_lengths(true);
+    fails += platypus::testing::compare_equal(
+            function_writer.format(trees.begin(), trees.end()),
+            static_writer.format(trees.begin(), trees.end()),
+            __FILE__,
+            __LINE__,
+            "suppressed output");
+
+    // standard tree and node value types (trees differ in default rooting)
+    platypus::StandardNewickReader<StandardTreeType> standard_reader;
+    platypus::StandardNewickWriter<StandardTreeType> standard_writer;
+    standard_writer.set_compact_spaces(true);
+    standard_writer.set_suppress_rooting(true);
+    auto standard_trees = read_all<StandardTreeType>(standard_reader, src, 1);
+    function_writer = get_standard_newick_writer<TestDataTree>();
+    function_writer.set_compact_spaces(true);
+    function_writer.set_suppress_rooting(true);
+    fails += platypus::testing::compare_equal(
+            function_writer.format(trees.begin(), trees.end()),
+            standard_writer.format(standard_trees.begin(), standard_trees.end()),
+            __FILE__,
+            __LINE__,
+            "standard tree");
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
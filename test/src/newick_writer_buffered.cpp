@@ -0,0 +1,99 @@
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+// Reference implementation: recursive, formatting edge lengths through the
+// stream.
+void write_node_reference(const TestDataTree & tree,
+        const TestDataTree::iterator & node_iter,
+        std::ostream & out,
+        unsigned int precision) {
+    if (!node_iter.is_leaf()) {
+        out << "(";
+        int ch_count = 0;
+        for (auto chi = tree.children_begin(node_iter); chi != tree.children_end(node_iter); ++chi, ++ch_count) {
+            if (ch_count > 0) {
+                out << ", ";
+            }
+            write_node_reference(tree, chi, out, precision);
+        }
+        out << ")";
+    }
+    out << node_iter->get_label();
+    out << ":" << std::fixed << std::setprecision(precision) << node_iter->get_edge_length();
+    out.copyfmt(std::ios(NULL));
+}
+
+int main () {
+    int fails = 0;
+
+    std::string src = "((a:1.5,b:1e-7)c:123456.789,(d:-2.25,(e:0,f:1e300)g:0.0000005)h:3)i:0.1;\n"
+                      "(j:1,k:2)l;\n(m,n);\n";
+    auto trees = get_test_data_tree_vector_from_string<TestDataTree>(src);
+    for (unsigned int precision : {0u, 1u, 3u, 6u, 12u, 40u}) {
+        platypus::NewickWriter<TestDataTree> writer = get_standard_newick_writer<TestDataTree>();
+        writer.set_suppress_rooting(true);
+        writer.set_edge_length_precision(precision);
+        std::ostringstream expected;
+        for (auto & tree : trees) {
+            write_node_reference(tree, tree.begin(), expected, precision);
+            expected << ";\n";
+        }
+        for (std::size_t block_size : {static_cast<std::size_t>(1), static_cast<std::size_t>(16), static_cast<std::size_t>(65536)}) {
+            writer.set_output_block_size(block_size);
+            std::ostringstream observed;
+            writer.write(observed, trees.cbegin(), trees.cend());
+            fails += platypus::testing::compare_equal(true, expected.str() == observed.str(), __FILE__, __LINE__,
+                    "precision: ", precision, ", block size: ", block_size);
+        }
+    }
+
+    // stream formatting state is not modified
+    {
+        platypus::NewickWriter<TestDataTree> writer = get_standard_newick_writer<TestDataTree>();
+        std::ostringstream o;
+        o << std::setprecision(2);
+        writer.write(o, trees[0]);
+        o << " " << 3.14159;
+        std::string s = o.str();
+        fails += platypus::testing::compare_equal(std::string(" 3.1"), s.substr(s.size() - 4), __FILE__, __LINE__);
+    }
+
+    // nesting deeper than a recursive writer could handle
+    unsigned long num_tips = 100000;
+    TestDataTree tree;
+    auto parent = tree.head_node();
+    for (unsigned long i = 1; i < num_tips; ++i) {
+        auto leaf = tree.create_leaf_node();
+        leaf->value().set_label("t");
+        parent->add_child(leaf);
+        auto internal = tree.create_internal_node();
+        parent->add_child(internal);
+        parent = internal;
+    }
+    parent->value().set_label("t");
+    platypus::NewickWriter<TestDataTree> writer = get_standard_newick_writer<TestDataTree>(false);
+    writer.set_compact_spaces(true);
+    std::string observed = writer.format(tree);
+    std::ostringstream expected;
+    expected << "[&R]";
+    for (unsigned long i = 1; i < num_tips; ++i) {
+        expected << "(t,";
+    }
+    expected << "t";
+    for (unsigned long i = 1; i < num_tips; ++i) {
+        expected << ")";
+    }
+    expected << ";";
+    fails += platypus::testing::compare_equal(expected.str().size(), observed.size(), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(true, expected.str() == observed, __FILE__, __LINE__);
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
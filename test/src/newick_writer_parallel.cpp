@@ -0,0 +1,83 @@
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <platypus/model/coalescent.hpp>
+#include <platypus/model/treepattern.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::coalescent::BasicCoalescentSimulator<TestDataTree> SimulatorType;
+
+std::vector<TestDataTree> build_trees(std::size_t num_trees) {
+    std::vector<TestDataTree> trees(num_trees);
+    for (std::size_t tree_idx = 0; tree_idx < num_trees; ++tree_idx) {
+        std::vector<TestData> leaves;
+        for (std::size_t leaf_idx = 0; leaf_idx < 1 + tree_idx % 23; ++leaf_idx) {
+            TestData value("t" + std::to_string(tree_idx) + "_" + std::to_string(leaf_idx));
+            value.set_edge_length(0.5 * leaf_idx);
+            leaves.push_back(value);
+        }
+        if (tree_idx % 2) {
+            platypus::build_maximally_balanced_tree(trees[tree_idx], leaves.begin(), leaves.end());
+        } else {
+            platypus::build_maximally_unbalanced_tree(trees[tree_idx], leaves.begin(), leaves.end());
+        }
+    }
+    return trees;
+}
+
+int main() {
+    int fails = 0;
+
+    // output is identical to that of the serial writer, in input order
+    {
+        auto writer = get_standard_newick_writer<TestDataTree>();
+        for (std::size_t num_trees : {0, 1, 15, 17, 1000}) {
+            auto trees = build_trees(num_trees);
+            std::string expected = writer.format(trees.cbegin(), trees.cend());
+            for (unsigned int num_threads : {1U, 2U, 3U, 8U}) {
+                std::ostringstream observed;
+                writer.write_parallel(observed, trees.cbegin(), trees.cend(), num_threads);
+                fails += platypus::testing::compare_equal(true, expected == observed.str(), __FILE__, __LINE__,
+                        "trees: ", num_trees, ", threads: ", num_threads);
+            }
+        }
+    }
+
+    // as a sink for the batch simulators
+    {
+        std::vector<TestDataTree> trees;
+        auto tree_factory = [&trees] () -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+        auto is_rooted_f = [] (TestDataTree & tree, bool is_rooted) { tree.set_is_rooted(is_rooted); };
+        auto node_label_f = [] (TestData & nd, const std::string & label) { nd.set_label(label); };
+        auto node_edge_f = [] (TestData & nd, double len) { nd.set_edge_length(len); };
+        platypus::numeric::RandomNumberGenerator rng(42);
+        SimulatorType sim(rng, tree_factory, is_rooted_f, node_label_f, node_edge_f);
+        auto writer = get_standard_newick_writer<TestDataTree>();
+        std::ostringstream expected;
+        sim.generate_batch(300, 30, 1.0, 2, [&] (TestDataTree & tree, unsigned long) { writer.write(expected, tree); expected << "\n"; }, 777);
+        for (std::size_t batch_size : {1, 7, 0}) {
+            std::ostringstream observed;
+            {
+                platypus::NewickTreeSink<TestDataTree> sink(writer, observed, 3, batch_size);
+                sim.generate_batch(300, 30, 1.0, 2, std::ref(sink), 777);
+                if (batch_size > 0) {
+                    sink.flush();
+                    fails += platypus::testing::compare_equal(300UL, sink.get_num_trees_written(), __FILE__, __LINE__, "batch size: ", batch_size);
+                }
+                // otherwise, the trees are written on destruction
+            }
+            fails += platypus::testing::compare_equal(true, expected.str() == observed.str(), __FILE__, __LINE__,
+                    "sink output, batch size: ", batch_size);
+        }
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include <platypus/model/nodeages.hpp>
+#include <platypus/model/treeannotationcache.hpp>
+#include <platypus/model/treepattern.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree TreeType;
+typedef platypus::NodeAges<TreeType> NodeAgesType;
+
+int check_single_trees() {
+    int fails = 0;
+    NodeAgesType node_ages(get_edge_length);
+    {
+        TreeType tree = read_tree(STANDARD_TEST_TREE_WEDGE_NEWICK);
+        auto summary = node_ages.compute(tree);
+        fails += platypus::testing::compare_equal(15UL, summary.num_nodes, __FILE__, __LINE__, "number of nodes");
+        fails += platypus::testing::compare_equal(8UL, summary.num_leaves, __FILE__, __LINE__, "number of leaves");
+        fails += platypus::testing::compare_equal(50.0, summary.root_age, __FILE__, __LINE__, "root age");
+        fails += platypus::testing::compare_equal(6.0, summary.min_root_to_tip, __FILE__, __LINE__, "least distance to a leaf");
+        fails += platypus::testing::compare_equal(50.0, summary.max_root_to_tip, __FILE__, __LINE__, "greatest distance to a leaf");
+        fails += platypus::testing::compare_equal(false, summary.is_ultrametric, __FILE__, __LINE__, "not ultrametric");
+        platypus::TreeAnnotationCache<TreeType> annotations(tree, get_edge_length);
+        std::size_t idx = 0;
+        for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi, ++idx) {
+            fails += platypus::testing::compare_equal(ndi.node(), node_ages.nodes()[idx], __FILE__, __LINE__, "node ", idx);
+            fails += platypus::testing::compare_equal(annotations.distance_from_root(ndi.node()), node_ages.distances_from_root()[idx], __FILE__, __LINE__, "distance from root of ", ndi->get_label());
+            fails += platypus::testing::compare_equal(annotations.age(ndi.node()), node_ages.ages()[idx], __FILE__, __LINE__, "age of ", ndi->get_label());
+            if (idx > 0) {
+                fails += platypus::testing::compare_equal(ndi.node()->parent_node(), node_ages.nodes()[node_ages.parents()[idx]], __FILE__, __LINE__, "parent of ", ndi->get_label());
+            }
+        }
+        fails += platypus::testing::compare_equal(NodeAgesType::npos, node_ages.parents()[0], __FILE__, __LINE__, "parent of root");
+        std::vector<double> assigned;
+        node_ages.assign_ages(tree, [&assigned] (TestData &, double age) { assigned.push_back(age); });
+        fails += platypus::testing::compare_equal(node_ages.ages(), assigned, __FILE__, __LINE__, "assign_ages()");
+    }
+    {
+        TreeType tree = read_tree("((a:1,b:1):2,(c:2.5,d:2.5):0.5,e:3):7;");
+        auto summary = node_ages.compute(tree);
+        fails += platypus::testing::compare_equal(true, summary.is_ultrametric, __FILE__, __LINE__, "ultrametric");
+        fails += platypus::testing::compare_equal(3.0, summary.root_age, __FILE__, __LINE__, "root age ignores root edge");
+        fails += platypus::testing::compare_equal(std::vector<double>{3, 1, 0, 0, 2.5, 0, 0, 0}, node_ages.ages(), __FILE__, __LINE__, "ages");
+    }
+    {
+        TreeType tree = read_tree("((a:1,b:1.0000001):2,c:3);");
+        fails += platypus::testing::compare_equal(true, node_ages.compute(tree).is_ultrametric, __FILE__, __LINE__, "ultrametric within tolerance");
+        node_ages.set_tolerance(1e-9);
+        fails += platypus::testing::compare_equal(false, node_ages.compute(tree).is_ultrametric, __FILE__, __LINE__, "not ultrametric within tolerance");
+        node_ages.set_tolerance(1e-6);
+    }
+    {
+        auto summary = node_ages.compute(read_tree("(a:2);"));
+        fails += platypus::testing::compare_equal(1UL, summary.num_leaves, __FILE__, __LINE__, "single leaf");
+        fails += platypus::testing::compare_equal(true, summary.is_ultrametric, __FILE__, __LINE__, "single leaf ultrametric");
+    }
+    return fails;
+}
+
+int check_tabulate() {
+    int fails = 0;
+    std::mt19937 rng(5);
+    std::vector<TreeType> trees;
+    unsigned long num_nodes = 0;
+    for (int idx = 0; idx < 700; ++idx) {
+        std::vector<TestData> leaves;
+        for (unsigned long leaf = 0, num_leaves = 2 + rng() % 30; leaf < num_leaves; ++leaf) {
+            leaves.emplace_back("t" + std::to_string(leaf));
+        }
+        trees.emplace_back();
+        platypus::build_maximally_balanced_tree(trees.back(), leaves.begin(), leaves.end());
+        for (auto ndi = trees.back().preorder_begin(); ndi != trees.back().preorder_end(); ++ndi) {
+            ndi->set_edge_length(idx % 2 ? 1.0 : 1.0 + rng() % 3);
+            ++num_nodes;
+        }
+    }
+    NodeAgesType node_ages(get_edge_length);
+    for (unsigned int num_threads : {1U, 4U}) {
+        platypus::DataTable table;
+        node_ages.tabulate(trees.begin(), trees.begin() + 100, table, num_threads);
+        node_ages.tabulate(trees.begin() + 100, trees.end(), table, num_threads);
+        fails += platypus::testing::compare_equal(trees.size(), static_cast<std::size_t>(table.num_rows()), __FILE__, __LINE__, "rows, threads: ", num_threads);
+        auto tree_handle = table.column_handle<unsigned long>("tree");
+        auto root_age_handle = table.column_handle<double>("root_age");
+        auto min_handle = table.column_handle<double>("min_root_to_tip");
+        auto ultrametric_handle = table.column_handle<unsigned long>("is_ultrametric");
+        unsigned long num_ultrametric = 0;
+        for (unsigned long idx = 0; idx < trees.size(); ++idx) {
+            auto summary = node_ages.compute(trees[idx]);
+            num_ultrametric += summary.is_ultrametric;
+            if (table.get(idx, tree_handle) != idx
+                    || table.get(idx, root_age_handle) != summary.root_age
+                    || table.get(idx, min_handle) != summary.min_root_to_tip
+                    || table.get(idx, ultrametric_handle) != static_cast<unsigned long>(summary.is_ultrametric)) {
+                fails += platypus::testing::fail_test(__FILE__, __LINE__, "", "", "row ", idx, ", threads: ", num_threads);
+            }
+        }
+        fails += platypus::testing::compare_equal(true, num_ultrametric > 0 && num_ultrametric < trees.size(), __FILE__, __LINE__, "some trees ultrametric");
+
+        platypus::DataTable node_table;
+        node_ages.tabulate_nodes(trees.begin(), trees.end(), node_table, num_threads);
+        fails += platypus::testing::compare_equal(num_nodes, node_table.num_rows(), __FILE__, __LINE__, "node rows, threads: ", num_threads);
+        auto node_tree_handle = node_table.column_handle<unsigned long>("tree");
+        auto node_handle = node_table.column_handle<unsigned long>("node");
+        auto parent_handle = node_table.column_handle<long>("parent");
+        auto age_handle = node_table.column_handle<double>("age");
+        unsigned long row_idx = 0;
+        for (unsigned long idx = 0; idx < trees.size(); ++idx) {
+            node_ages.compute(trees[idx]);
+            for (std::size_t nd_idx = 0; nd_idx < node_ages.num_nodes(); ++nd_idx, ++row_idx) {
+                long parent = nd_idx == 0 ? -1L : static_cast<long>(node_ages.parents()[nd_idx]);
+                if (node_table.get(row_idx, node_tree_handle) != idx
+                        || node_table.get(row_idx, node_handle) != nd_idx
+                        || node_table.get(row_idx, parent_handle) != parent
+                        || node_table.get(row_idx, age_handle) != node_ages.ages()[nd_idx]) {
+                    fails += platypus::testing::fail_test(__FILE__, __LINE__, "", "", "node row ", row_idx, ", threads: ", num_threads);
+                }
+            }
+        }
+    }
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_single_trees();
+    fails += check_tabulate();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <platypus/parse/newick.hpp>
+#include <platypus/utility/numberparsing.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+int check_parse_decimal(const std::string & src) {
+    double observed = -999.0;
+    bool parsed = platypus::parse_decimal(src.data(), src.data() + src.size(), observed);
+    double expected = std::strtod(src.c_str(), nullptr);
+    int fails = 0;
+    fails += platypus::testing::compare_equal(true, parsed, __FILE__, __LINE__, src);
+    // bitwise comparison: results must be correctly rounded
+    fails += platypus::testing::compare_equal(true, std::memcmp(&expected, &observed, sizeof(double)) == 0, __FILE__, __LINE__, src);
+    return fails;
+}
+
+int check_malformed(const std::string & src) {
+    double value = -999.0;
+    bool parsed = platypus::parse_decimal(src.data(), src.data() + src.size(), value);
+    int fails = 0;
+    fails += platypus::testing::compare_equal(false, parsed, __FILE__, __LINE__, src);
+    fails += platypus::testing::compare_equal(-999.0, value, __FILE__, __LINE__, src);
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+
+    for (const char * src : {"0", "1", "-1", "+2.5", "0.1", ".25", "5.", "-0.0", "3e-7", "1.2E+10",
+            "0.000123456789", "123456789012345678", "1234567890123456789012345",
+            "0.1234567890123456789012", "1e22", "1e23", "4.9e-324", "1.7976931348623157e308",
+            "2.2250738585072014e-308", "9007199254740993", "0.30000000000000004", "1e-30",
+            "1e400", "-1e400", "1797693134862315800000e288", "1e-400"}) {
+        fails += check_parse_decimal(src);
+    }
+    for (const char * src : {"", "-", "+", ".", "e5", "1e", "1e+", "1.2.3", "1,5", "abc", "1x", " 1", "1 ", "--1", "0x10", "inf", "nan"}) {
+        fails += check_malformed(src);
+    }
+
+    // integers, with overflow detected
+    {
+        long lv = -999;
+        unsigned long uv = 999;
+        fails += platypus::testing::compare_equal(true, platypus::parse_integer("-9223372036854775808", "-9223372036854775808" + 20, lv), __FILE__, __LINE__, "minimum long");
+        fails += platypus::testing::compare_equal(std::numeric_limits<long>::min(), lv, __FILE__, __LINE__, "minimum long");
+        fails += platypus::testing::compare_equal(false, platypus::parse_integer("9223372036854775808", "9223372036854775808" + 19, lv), __FILE__, __LINE__, "long overflow");
+        fails += platypus::testing::compare_equal(true, platypus::parse_integer("+42", "+42" + 3, lv), __FILE__, __LINE__, "+42");
+        fails += platypus::testing::compare_equal(42L, lv, __FILE__, __LINE__, "+42");
+        fails += platypus::testing::compare_equal(true, platypus::parse_integer("18446744073709551615", "18446744073709551615" + 20, uv), __FILE__, __LINE__, "maximum unsigned long");
+        fails += platypus::testing::compare_equal(std::numeric_limits<unsigned long>::max(), uv, __FILE__, __LINE__, "maximum unsigned long");
+        fails += platypus::testing::compare_equal(false, platypus::parse_integer("18446744073709551616", "18446744073709551616" + 20, uv), __FILE__, __LINE__, "unsigned long overflow");
+        for (const char * src : {"", "-", "+", "-1", "1.0", "1e3", " 1", "1 ", "0x10"}) {
+            fails += platypus::testing::compare_equal(false, platypus::parse_integer(src, src + std::strlen(src), uv), __FILE__, __LINE__, src);
+        }
+        fails += platypus::testing::compare_equal(std::numeric_limits<unsigned long>::max(), uv, __FILE__, __LINE__, "value unchanged on failure");
+    }
+
+    // edge lengths are parsed in both parsers, from streams and buffers
+    std::string tree_string = "((a:1.5e-3,b:2)c:.25,(d:1E2,e:-0.5)f:3)g;";
+    auto tree_reader = get_test_data_tree_newick_reader<TestDataTree>();
+    std::vector<TestDataTree> trees;
+    auto tree_factory = [&trees]() -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+    std::vector<double> expected_lengths{0.0, 3.0, 1.5e-3, 2.0, 0.25, 100.0, -0.5};
+    for (bool recursive : {false, true}) {
+        tree_reader.set_recursive_parsing(recursive);
+        for (bool from_buffer : {false, true}) {
+            trees.clear();
+            if (from_buffer) {
+                tree_reader.read_buffer(tree_string, tree_factory);
+            } else {
+                tree_reader.read(std::istringstream(tree_string), tree_factory);
+            }
+            std::vector<double> lengths;
+            for (auto ndi = trees.back().postorder_begin(); ndi != trees.back().postorder_end(); ++ndi) {
+                lengths.push_back(ndi->get_edge_length());
+            }
+            std::sort(lengths.begin(), lengths.end());
+            std::vector<double> expected = expected_lengths;
+            std::sort(expected.begin(), expected.end());
+            fails += platypus::testing::compare_equal(expected, lengths, __FILE__, __LINE__);
+        }
+    }
+
+    // malformed edge lengths are errors
+    for (const char * src : {"(a:1.5x,b:2);", "(a:-,b:2);", "(a:1,b:e);"}) {
+        for (bool recursive : {false, true}) {
+            tree_reader.set_recursive_parsing(recursive);
+            for (bool from_buffer : {false, true}) {
+                bool caught = false;
+                try {
+                    if (from_buffer) {
+                        tree_reader.read_buffer(src, tree_factory);
+                    } else {
+                        tree_reader.read(std::istringstream(src), tree_factory);
+                    }
+                } catch (const platypus::NewickReaderInvalidTokenError &) {
+                    caught = true;
+                }
+                fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, src);
+            }
+        }
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,111 @@
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <platypus/numeric/function.hpp>
+#include "platypus_testing.hpp"
+
+int main() {
+    int fails = 0;
+
+    // exact values against Pascal's triangle, across the table boundary
+    std::vector<std::vector<std::uint64_t>> pascal(1, std::vector<std::uint64_t>(1, 1));
+    for (unsigned long n = 1; n <= 80; ++n) {
+        std::vector<std::uint64_t> row(n + 1, 1);
+        for (unsigned long k = 1; k < n; ++k) {
+            row[k] = pascal[n-1][k-1] + pascal[n-1][k];
+        }
+        pascal.push_back(row);
+    }
+    for (unsigned long n = 0; n <= 80; ++n) {
+        for (unsigned long k = 0; k <= n; ++k) {
+            // rows beyond 67 overflow in the middle, and wrap in the reference
+            if (n > 67 && k > 10 && k < n - 10) {
+                continue;
+            }
+            fails += platypus::testing::compare_equal(
+                    pascal[n][k],
+                    platypus::numeric::binomial_coefficient_exact(n, k),
+                    __FILE__,
+                    __LINE__,
+                    "n = ", n, ", k = ", k);
+        }
+    }
+
+    fails += platypus::testing::compare_equal(
+            161700UL,
+            platypus::numeric::binomial_coefficient(100, 3),
+            __FILE__,
+            __LINE__);
+    fails += platypus::testing::compare_equal(
+            0UL,
+            platypus::numeric::binomial_coefficient(3, 5),
+            __FILE__,
+            __LINE__);
+    fails += platypus::testing::compare_equal(
+            0.0,
+            platypus::numeric::binomial_coefficient<double>(3, 5),
+            __FILE__,
+            __LINE__);
+    fails += platypus::testing::compare_equal(
+            true,
+            std::isinf(platypus::numeric::log_binomial_coefficient(3, 5)),
+            __FILE__,
+            __LINE__);
+
+    // exact results that do not fit are reported, not wrapped
+    bool overflowed = false;
+    try {
+        platypus::numeric::binomial_coefficient(100, 50);
+    } catch (const std::overflow_error &) {
+        overflowed = true;
+    }
+    fails += platypus::testing::compare_equal(true, overflowed, __FILE__, __LINE__, "C(100, 50)");
+    overflowed = false;
+    try {
+        platypus::numeric::binomial_coefficient<std::uint8_t>(12, 6);
+    } catch (const std::overflow_error &) {
+        overflowed = true;
+    }
+    fails += platypus::testing::compare_equal(true, overflowed, __FILE__, __LINE__, "C(12, 6) as uint8");
+
+    // floating-point results
+    for (unsigned long n = 0; n <= 67; ++n) {
+        for (unsigned long k = 0; k <= n; ++k) {
+            fails += platypus::testing::compare_equal(
+                    static_cast<double>(pascal[n][k]),
+                    platypus::numeric::binomial_coefficient<double>(n, k),
+                    __FILE__,
+                    __LINE__,
+                    "n = ", n, ", k = ", k);
+        }
+    }
+    const unsigned long large_n[] = {100, 1000, 100000};
+    for (unsigned long n : large_n) {
+        for (unsigned long k = 0; k <= n; k += n / 10) {
+            double expected = std::exp(std::lgamma(n + 1.0) - std::lgamma(k + 1.0) - std::lgamma(n - k + 1.0));
+            double observed = platypus::numeric::binomial_coefficient<double>(n, k);
+            if (std::isinf(expected)) {
+                fails += platypus::testing::compare_equal(true, std::isinf(observed), __FILE__, __LINE__, "n = ", n, ", k = ", k);
+            } else {
+                fails += platypus::testing::compare_equal(
+                        true,
+                        std::fabs(observed - expected) <= 1e-9 * expected,
+                        __FILE__,
+                        __LINE__,
+                        "n = ", n, ", k = ", k);
+            }
+        }
+    }
+    fails += platypus::testing::compare_equal(
+            4999950000.0,
+            platypus::numeric::binomial_coefficient<double>(100000, 2),
+            __FILE__,
+            __LINE__);
+
+    if (fails) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
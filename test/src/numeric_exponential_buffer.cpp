@@ -0,0 +1,65 @@
+#include <random>
+#include <vector>
+#include <platypus/numeric/function.hpp>
+#include <platypus/numeric/rng.hpp>
+#include "platypus_testing.hpp"
+
+int main() {
+    int fails = 0;
+
+    for (unsigned long n = 0; n < 5000; ++n) {
+        fails += platypus::testing::compare_equal(
+                platypus::numeric::binomial_coefficient(n, 2),
+                platypus::numeric::num_pairs(n),
+                __FILE__,
+                __LINE__,
+                "n = ", n);
+    }
+    fails += platypus::testing::compare_equal(
+            4999950000UL,
+            platypus::numeric::num_pairs(100000),
+            __FILE__,
+            __LINE__);
+
+    std::vector<double> rates;
+    for (int i = 0; i < 1000; ++i) {
+        rates.push_back(i % 10 == 0 ? 0.0 : static_cast<double>(i % 97) + 0.5);
+    }
+
+    // reference: drawing one at a time
+    std::vector<double> expected;
+    {
+        platypus::numeric::RandomNumberGenerator rng(2013);
+        platypus::numeric::ExponentialVariateBuffer<platypus::numeric::RandomNumberGenerator> buffer(rng, 1);
+        for (auto rate : rates) {
+            expected.push_back(buffer.exponential(rate));
+        }
+    }
+    for (std::size_t block_size : {static_cast<std::size_t>(2), static_cast<std::size_t>(64), static_cast<std::size_t>(1000), static_cast<std::size_t>(4096)}) {
+        platypus::numeric::RandomNumberGenerator rng(2013);
+        platypus::numeric::ExponentialVariateBuffer<platypus::numeric::RandomNumberGenerator> buffer(rng, block_size);
+        std::vector<double> observed;
+        for (auto rate : rates) {
+            observed.push_back(buffer.exponential(rate));
+        }
+        fails += platypus::testing::compare_equal(expected, observed, __FILE__, __LINE__, "block size: ", block_size);
+    }
+
+#if defined(__GLIBCXX__)
+    // identical to the generator's own (scalar) exponential draws
+    {
+        platypus::numeric::RandomNumberGenerator rng(2013);
+        std::vector<double> observed;
+        for (auto rate : rates) {
+            observed.push_back(rng.exponential(rate));
+        }
+        fails += platypus::testing::compare_equal(expected, observed, __FILE__, __LINE__, "scalar draws");
+    }
+#endif
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,182 @@
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+#include <platypus/numeric/rng.hpp>
+#include "platypus_testing.hpp"
+
+template <class RngT>
+int check_generator(const char * name) {
+    int fails = 0;
+
+    RngT rng(271828);
+    fails += platypus::testing::compare_equal(271828UL, static_cast<unsigned long>(rng.get_seed()), __FILE__, __LINE__, name);
+
+    // reproducible
+    RngT rng2(271828);
+    for (int i = 0; i < 100; ++i) {
+        fails += platypus::testing::compare_equal(rng.uniform_pos_int(1000), rng2.uniform_pos_int(1000), __FILE__, __LINE__, name);
+    }
+
+    // bounded integers: within bounds, and roughly uniform
+    const unsigned long num_bins = 7;
+    const unsigned long num_draws = 70000;
+    std::vector<unsigned long> counts(num_bins, 0);
+    for (unsigned long i = 0; i < num_draws; ++i) {
+        unsigned long x = rng.uniform_pos_int(10, 10 + num_bins - 1);
+        if (x < 10 || x >= 10 + num_bins) {
+            fails += platypus::testing::compare_equal(true, false, __FILE__, __LINE__, name, ": out of range: ", x);
+            break;
+        }
+        ++counts[x - 10];
+    }
+    double chi_square = 0.0;
+    double expected_count = static_cast<double>(num_draws) / num_bins;
+    for (auto count : counts) {
+        chi_square += (count - expected_count) * (count - expected_count) / expected_count;
+    }
+    // 6 degrees of freedom: P(chi^2 > 22.46) = 0.001
+    fails += platypus::testing::compare_equal(true, chi_square < 22.46, __FILE__, __LINE__, name, ": chi-square: ", chi_square);
+    for (int i = 0; i < 1000; ++i) {
+        long x = rng.uniform_int(-3, 3);
+        if (x < -3 || x > 3) {
+            fails += platypus::testing::compare_equal(true, false, __FILE__, __LINE__, name, ": out of range: ", x);
+            break;
+        }
+    }
+    fails += platypus::testing::compare_equal(0UL, rng.uniform_pos_int(0), __FILE__, __LINE__, name);
+    fails += platypus::testing::compare_equal(-5L, rng.uniform_int(-5, -5), __FILE__, __LINE__, name);
+    // full range does not hang or overflow
+    rng.uniform_pos_int(0, std::numeric_limits<unsigned long>::max());
+    rng.uniform_int(std::numeric_limits<long>::min(), std::numeric_limits<long>::max());
+
+    // bulk fills
+    std::vector<double> values(20000);
+    rng.fill_uniform(values.data(), values.size());
+    double sum = 0.0;
+    for (auto x : values) {
+        if (x < 0.0 || x >= 1.0) {
+            fails += platypus::testing::compare_equal(true, false, __FILE__, __LINE__, name, ": out of range: ", x);
+            break;
+        }
+        sum += x;
+    }
+    fails += platypus::testing::compare_equal(true, std::fabs(sum / values.size() - 0.5) < 0.01, __FILE__, __LINE__, name, ": uniform mean: ", sum / values.size());
+    rng.fill_exponential(values.data(), values.size(), 4.0);
+    sum = 0.0;
+    for (auto x : values) {
+        sum += x;
+    }
+    fails += platypus::testing::compare_equal(true, std::fabs(sum / values.size() - 0.25) < 0.01, __FILE__, __LINE__, name, ": exponential mean: ", sum / values.size());
+    rng.fill_exponential(values.data(), values.size(), 0.0);
+    fails += platypus::testing::compare_equal(0.0, values[0], __FILE__, __LINE__, name);
+
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_generator<platypus::numeric::RandomNumberGenerator>("mt19937_64");
+    fails += check_generator<platypus::numeric::FastRandomNumberGenerator>("xoshiro256**");
+    fails += check_generator<platypus::numeric::RandomNumberGeneratorTemplate<std::mt19937>>("mt19937");
+    fails += check_generator<platypus::numeric::CounterRandomNumberGenerator>("philox4x32");
+
+    // Philox4x32-10 known-answer tests (from Random123)
+    {
+        const std::uint32_t counters[3][4] = {
+            {0, 0, 0, 0},
+            {0xffffffffU, 0xffffffffU, 0xffffffffU, 0xffffffffU},
+            {0x243f6a88U, 0x85a308d3U, 0x13198a2eU, 0x03707344U} };
+        const std::uint32_t keys[3][2] = {
+            {0, 0},
+            {0xffffffffU, 0xffffffffU},
+            {0xa4093822U, 0x299f31d0U} };
+        const std::uint32_t expected[3][4] = {
+            {0x6627e8d5U, 0xe169c58dU, 0xbc57ac4cU, 0x9b00dbd8U},
+            {0x408f276dU, 0x41c83b0eU, 0xa20bc7c6U, 0x6d5451fdU},
+            {0xd16cfe09U, 0x94fdccebU, 0x5001e420U, 0x24126ea1U} };
+        for (int i = 0; i < 3; ++i) {
+            std::uint32_t out[4];
+            platypus::numeric::Philox4x32::generate_block(counters[i], keys[i], out);
+            for (int j = 0; j < 4; ++j) {
+                fails += platypus::testing::compare_equal(expected[i][j], out[j], __FILE__, __LINE__, "test vector ", i, ", word ", j);
+            }
+        }
+    }
+
+    // counter-based streams: random access, and stream outputs depend only
+    // on the seed and stream index
+    {
+        platypus::numeric::Philox4x32 e(12345, 3);
+        std::vector<std::uint64_t> values;
+        for (int i = 0; i < 11; ++i) {
+            values.push_back(e());
+        }
+        fails += platypus::testing::compare_equal(11UL, static_cast<unsigned long>(e.get_position()), __FILE__, __LINE__);
+        for (std::uint64_t position : {0, 1, 4, 7, 10}) {
+            platypus::numeric::Philox4x32 f(12345, 3);
+            f.discard(position);
+            fails += platypus::testing::compare_equal(values[position], f(), __FILE__, __LINE__, "position: ", position);
+        }
+        platypus::numeric::Philox4x32 g(12345);
+        g();
+        g.set_stream(3);
+        fails += platypus::testing::compare_equal(values[0], g(), __FILE__, __LINE__);
+        platypus::numeric::Philox4x32 h(12345, 4);
+        fails += platypus::testing::compare_equal(true, values[0] != h(), __FILE__, __LINE__);
+        platypus::numeric::Philox4x32 i(12346, 3);
+        fails += platypus::testing::compare_equal(true, values[0] != i(), __FILE__, __LINE__);
+        // replicate generators
+        auto r1 = platypus::numeric::ReplicateRandomNumberGenerator<platypus::numeric::CounterRandomNumberGenerator>::create(12345, 3);
+        fails += platypus::testing::compare_equal(values[0], r1.engine()(), __FILE__, __LINE__);
+        auto r2 = platypus::numeric::ReplicateRandomNumberGenerator<platypus::numeric::RandomNumberGenerator>::create(12345, 3);
+        fails += platypus::testing::compare_equal(
+                static_cast<unsigned long>(platypus::numeric::derive_seed(12345, 3)),
+                static_cast<unsigned long>(r2.get_seed()), __FILE__, __LINE__);
+    }
+
+    // usable with standard distributions
+    platypus::numeric::Xoshiro256StarStar engine(1);
+    std::normal_distribution<double> normal(10.0, 1.0);
+    double sum = 0.0;
+    for (int i = 0; i < 10000; ++i) {
+        sum += normal(engine);
+    }
+    fails += platypus::testing::compare_equal(true, std::fabs(sum / 10000 - 10.0) < 0.05, __FILE__, __LINE__);
+
+    // jumping yields distinct, reproducible streams
+    platypus::numeric::Xoshiro256StarStar a(7);
+    platypus::numeric::Xoshiro256StarStar b(7);
+    fails += platypus::testing::compare_equal(true, a == b, __FILE__, __LINE__);
+    b.jump();
+    fails += platypus::testing::compare_equal(true, a != b, __FILE__, __LINE__);
+    a.jump();
+    fails += platypus::testing::compare_equal(true, a == b, __FILE__, __LINE__);
+    b.long_jump();
+    a.long_jump();
+    fails += platypus::testing::compare_equal(a(), b(), __FILE__, __LINE__);
+    platypus::numeric::FastRandomNumberGenerator stream0(99);
+    platypus::numeric::FastRandomNumberGenerator stream1(stream0);
+    stream1.jump();
+    unsigned long num_equal = 0;
+    for (int i = 0; i < 100; ++i) {
+        num_equal += stream0.engine()() == stream1.engine()() ? 1 : 0;
+    }
+    fails += platypus::testing::compare_equal(0UL, num_equal, __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(stream0.get_seed(), stream1.get_seed(), __FILE__, __LINE__);
+
+    // discard
+    platypus::numeric::Xoshiro256StarStar c(3);
+    platypus::numeric::Xoshiro256StarStar d(3);
+    for (int i = 0; i < 10; ++i) {
+        c();
+    }
+    d.discard(10);
+    fails += platypus::testing::compare_equal(true, c == d, __FILE__, __LINE__);
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
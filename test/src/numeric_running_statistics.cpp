@@ -0,0 +1,65 @@
+#include <cmath>
+#include <vector>
+#include <platypus/numeric/statistics.hpp>
+#include "platypus_testing.hpp"
+
+int main() {
+    int fails = 0;
+
+    std::vector<double> vals{10.24377,-5.8934286,14.068025,10.345747,19.058397,0.077046906,0.15296858,-2.0715523,6.8968938,-8.8573444};
+    platypus::numeric::RunningStatistics<double> all;
+    for (auto v : vals) {
+        all.add(v);
+    }
+    fails += platypus::testing::compare_equal(vals.size(), all.size(), __FILE__, __LINE__, "size");
+    fails += platypus::testing::compare_almost_equal(44.020522985999996 , all.sum()                 , __FILE__ , __LINE__ , "sum");
+    fails += platypus::testing::compare_almost_equal(4.402052298599999  , all.mean()                , __FILE__ , __LINE__ , "mean");
+    fails += platypus::testing::compare_almost_equal(82.71037145898468  , all.sample_variance()     , __FILE__ , __LINE__ , "sample variance");
+    fails += platypus::testing::compare_almost_equal(74.43933431308622  , all.population_variance() , __FILE__ , __LINE__ , "population variance");
+    fails += platypus::testing::compare_almost_equal(-8.8573444         , all.minimum()             , __FILE__ , __LINE__ , "minimum");
+    fails += platypus::testing::compare_almost_equal(19.058397          , all.maximum()             , __FILE__ , __LINE__ , "maximum");
+
+    // merging partial summaries gives the same result as a single pass
+    for (unsigned long split = 0; split <= vals.size(); ++split) {
+        platypus::numeric::RunningStatistics<double> a;
+        platypus::numeric::RunningStatistics<double> b;
+        for (unsigned long i = 0; i < vals.size(); ++i) {
+            (i < split ? a : b).add(vals[i]);
+        }
+        a.merge(b);
+        fails += platypus::testing::compare_equal(all.size(), a.size(), __FILE__, __LINE__, "split: ", split);
+        fails += platypus::testing::compare_almost_equal(all.mean(), a.mean(), __FILE__, __LINE__, "split: ", split);
+        fails += platypus::testing::compare_almost_equal(all.sample_variance(), a.sample_variance(), __FILE__, __LINE__, "split: ", split);
+        fails += platypus::testing::compare_almost_equal(all.minimum(), a.minimum(), __FILE__, __LINE__, "split: ", split);
+        fails += platypus::testing::compare_almost_equal(all.maximum(), a.maximum(), __FILE__, __LINE__, "split: ", split);
+    }
+
+    // variance is not lost to cancellation with a large offset
+    platypus::numeric::RunningStatistics<double> offset;
+    for (auto v : vals) {
+        offset.add(v + 1e9);
+    }
+    fails += platypus::testing::compare_equal(true,
+            std::fabs(offset.sample_variance() - all.sample_variance()) < 1e-5,
+            __FILE__, __LINE__, "offset variance: ", offset.sample_variance());
+
+    // compensated summation recovers the small terms
+    platypus::numeric::RunningStatistics<double> plain;
+    platypus::numeric::RunningStatistics<double> compensated(true);
+    plain.add(1.0);
+    compensated.add(1.0);
+    for (int i = 0; i < 1000000; ++i) {
+        plain.add(1e-16);
+        compensated.add(1e-16);
+    }
+    fails += platypus::testing::compare_equal(1.0, plain.sum(), __FILE__, __LINE__, "uncompensated sum");
+    fails += platypus::testing::compare_equal(true,
+            std::fabs(compensated.sum() - (1.0 + 1e-10)) < 1e-22,
+            __FILE__, __LINE__, "compensated sum");
+
+    if (fails != 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,136 @@
+#include <stdlib.h>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <platypus/utility/parallel.hpp>
+#include <platypus/model/treepattern.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree TreeType;
+
+std::size_t num_leaves(const TreeType & tree) {
+    return tree.get_num_leaves();
+}
+
+std::vector<TreeType> make_trees(std::size_t num_trees, std::mt19937 & rng) {
+    std::vector<TreeType> trees;
+    std::uniform_real_distribution<double> length(0.0, 1.0);
+    for (std::size_t tree_idx = 0; tree_idx < num_trees; ++tree_idx) {
+        // a few large trees among many small ones
+        std::size_t n = tree_idx % 97 == 0 ? 2000 : 2 + rng() % 30;
+        std::vector<TestData> leaves;
+        for (std::size_t idx = 0; idx < n; ++idx) {
+            leaves.emplace_back("t" + std::to_string(idx));
+            leaves.back().set_edge_length(length(rng));
+        }
+        trees.emplace_back();
+        platypus::build_maximally_balanced_tree(trees.back(), leaves.begin(), leaves.end());
+    }
+    return trees;
+}
+
+int main() {
+    int fails = 0;
+    std::mt19937 rng(5);
+    std::vector<TreeType> trees = make_trees(3000, rng);
+    const std::vector<TreeType> & const_trees = trees;
+    std::vector<double> expected;
+    double expected_sum = 0.0;
+    for (auto & tree : trees) {
+        expected.push_back(tree_length(tree));
+        expected_sum += expected.back();
+    }
+
+    for (unsigned int num_threads : {1U, 2U, 8U}) {
+        for (int with_costs = 0; with_costs < 2; ++with_costs) {
+            std::function<std::size_t (const TreeType &)> cost_fn;
+            if (with_costs) {
+                cost_fn = num_leaves;
+            }
+            std::vector<double> observed(trees.size(), -1.0);
+            bool completed = platypus::parallel::for_each_tree(const_trees,
+                    [&observed] (const TreeType & tree, std::size_t idx) { observed[idx] = tree_length(tree); },
+                    num_threads,
+                    cost_fn);
+            fails += platypus::testing::compare_equal(true, completed, __FILE__, __LINE__, "completed");
+            fails += platypus::testing::compare_equal(expected, observed, __FILE__, __LINE__,
+                    "for_each_tree(), threads: ", num_threads, ", costs: ", with_costs);
+        }
+    }
+
+    // the reduction does not depend on the number of threads
+    std::vector<double> sums;
+    for (unsigned int num_threads : {1U, 3U, 8U}) {
+        sums.push_back(platypus::parallel::transform_reduce_trees(trees, 0.0, std::plus<double>(), tree_length, num_threads));
+        sums.push_back(platypus::parallel::transform_reduce_trees(trees, 0.0, std::plus<double>(), tree_length, num_threads, num_leaves));
+    }
+    fails += platypus::testing::compare_equal(sums[0], sums[2], __FILE__, __LINE__, "sum with 1 and 3 threads");
+    fails += platypus::testing::compare_equal(sums[0], sums[4], __FILE__, __LINE__, "sum with 1 and 8 threads");
+    fails += platypus::testing::compare_equal(sums[1], sums[3], __FILE__, __LINE__, "cost-balanced sum with 1 and 3 threads");
+    fails += platypus::testing::compare_equal(sums[1], sums[5], __FILE__, __LINE__, "cost-balanced sum with 1 and 8 threads");
+    if (std::fabs(sums[0] - expected_sum) > 1e-9 * expected_sum) {
+        fails += platypus::testing::fail_test(__FILE__, __LINE__, expected_sum, sums[0], "sum");
+    }
+    // non-commutative reduction
+    std::string order = platypus::parallel::transform_reduce_trees(trees, std::string(">"),
+            [] (const std::string & a, const std::string & b) { return a + b; },
+            [] (const TreeType & tree) { return std::to_string(tree.get_num_leaves() % 10); },
+            4);
+    std::string expected_order = ">";
+    for (auto & tree : trees) {
+        expected_order += std::to_string(tree.get_num_leaves() % 10);
+    }
+    fails += platypus::testing::compare_equal(expected_order, order, __FILE__, __LINE__, "order of reduction");
+
+    // collections of pointers
+    std::vector<std::unique_ptr<TreeType>> tree_ptrs;
+    for (std::size_t idx = 0; idx < 200; ++idx) {
+        tree_ptrs.emplace_back(new TreeType(trees[idx]));
+    }
+    std::vector<double> observed(tree_ptrs.size(), -1.0);
+    platypus::parallel::for_each_tree(tree_ptrs, [&observed] (TreeType & tree, std::size_t idx) {
+        observed[idx] = tree_length(tree);
+    }, 4);
+    fails += platypus::testing::compare_equal(std::vector<double>(expected.begin(), expected.begin() + 200), observed, __FILE__, __LINE__, "unique_ptr collection");
+
+    // cancellation
+    platypus::parallel::CancellationToken token;
+    std::atomic<std::size_t> num_visited(0);
+    bool completed = platypus::parallel::for_each_tree(trees, [&] (TreeType &, std::size_t) {
+        if (++num_visited == 100) {
+            token.cancel();
+        }
+    }, 4, nullptr, &token);
+    fails += platypus::testing::compare_equal(false, completed, __FILE__, __LINE__, "cancelled");
+    fails += platypus::testing::compare_equal(true, num_visited.load() < trees.size(), __FILE__, __LINE__, "trees visited after cancellation: ", num_visited.load());
+
+    // exceptions
+    bool caught = false;
+    try {
+        platypus::parallel::for_each_tree(trees, [] (TreeType &, std::size_t idx) {
+            if (idx == 1234) {
+                throw std::runtime_error("task failed");
+            }
+        }, 4);
+    } catch (const std::runtime_error &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "exception rethrown");
+
+    // empty collection
+    std::vector<TreeType> no_trees;
+    fails += platypus::testing::compare_equal(1.5, platypus::parallel::transform_reduce_trees(no_trees, 1.5, std::plus<double>(), tree_length, 4), __FILE__, __LINE__, "empty");
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
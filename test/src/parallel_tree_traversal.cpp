@@ -0,0 +1,161 @@
+#include <stdlib.h>
+#include <atomic>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <platypus/model/paralleltraversal.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree TreeType;
+typedef TreeType::node_type NodeType;
+typedef platypus::FlatTree<> FlatTreeType;
+
+// a random tree, grown by giving random nodes two (leaves) or one (internal
+// nodes) new children, so that it has long paths and polytomies
+TreeType random_tree(std::size_t num_nodes, std::mt19937 & rng) {
+    TreeType tree;
+    std::vector<NodeType *> nodes{tree.head_node()};
+    while (nodes.size() < num_nodes) {
+        NodeType * nd = nodes[rng() % 4 == 0 ? rng() % nodes.size() : nodes.size() - 1 - rng() % std::min<std::size_t>(nodes.size(), 8)];
+        TreeType::preorder_iterator pos(nd);
+        bool is_leaf = nd->is_leaf();
+        nodes.push_back(tree.add_child(pos, TestData("")).node());
+        if (is_leaf) {
+            nodes.push_back(tree.add_child(pos, TestData("")).node());
+        }
+    }
+    return tree;
+}
+
+void set_values(TreeType & tree, double value) {
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        ndi->set_edge_length(value);
+    }
+}
+
+// number of leaves subtended, bottom-up, and depth, top-down, held in the
+// edge lengths, which are negative until a node is visited
+int check_tree(TreeType & tree, std::size_t serial_cutoff, unsigned int num_threads) {
+    int fails = 0;
+    platypus::ParallelTreeTraversal<TreeType> traversal(tree, serial_cutoff, num_threads);
+    std::string remarks = "cutoff " + std::to_string(serial_cutoff) + ", threads " + std::to_string(num_threads)
+        + ", tasks " + std::to_string(traversal.num_tasks());
+    std::atomic<unsigned long> num_out_of_order(0);
+
+    set_values(tree, -1.0);
+    traversal.bottom_up([&] (NodeType * nd) {
+        double count = nd->is_leaf() ? 1.0 : 0.0;
+        for (auto ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+            if (ch->value().get_edge_length() < 0) {
+                ++num_out_of_order;
+            }
+            count += ch->value().get_edge_length();
+        }
+        nd->value().set_edge_length(count);
+    });
+    fails += platypus::testing::compare_equal(0UL, num_out_of_order.load(), __FILE__, __LINE__, "bottom-up order: ", remarks);
+    fails += platypus::testing::compare_equal(static_cast<double>(tree.get_num_leaves()), tree.head_node()->value().get_edge_length(),
+            __FILE__, __LINE__, "bottom-up: ", remarks);
+
+    set_values(tree, -1.0);
+    traversal.top_down([&] (NodeType * nd) {
+        if (nd->parent_node() == nullptr) {
+            nd->value().set_edge_length(0.0);
+            return;
+        }
+        double parent_depth = nd->parent_node()->value().get_edge_length();
+        if (parent_depth < 0) {
+            ++num_out_of_order;
+        }
+        nd->value().set_edge_length(parent_depth + 1.0);
+    });
+    fails += platypus::testing::compare_equal(0UL, num_out_of_order.load(), __FILE__, __LINE__, "top-down order: ", remarks);
+    unsigned long num_wrong = 0;
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        double depth = 0.0;
+        for (auto nd = ndi.node(); nd->parent_node() != nullptr; nd = nd->parent_node()) {
+            depth += 1.0;
+        }
+        num_wrong += ndi->get_edge_length() != depth;
+    }
+    fails += platypus::testing::compare_equal(0UL, num_wrong, __FILE__, __LINE__, "top-down: ", remarks);
+    return fails;
+}
+
+int check_flat_tree(const FlatTreeType & flat_tree, std::size_t serial_cutoff, unsigned int num_threads) {
+    int fails = 0;
+    platypus::ParallelTreeTraversal<FlatTreeType> traversal(flat_tree, serial_cutoff, num_threads);
+    std::string remarks = "flat tree, cutoff " + std::to_string(serial_cutoff) + ", threads " + std::to_string(num_threads);
+    std::vector<long> sizes(flat_tree.size(), -1);
+    traversal.bottom_up([&] (FlatTreeType::index_type nd) {
+        long size = 1;
+        for (auto ch = flat_tree.first_child(nd); ch != FlatTreeType::npos; ch = flat_tree.next_sibling(ch)) {
+            size += sizes[ch] < 0 ? -1000000 : sizes[ch];
+        }
+        sizes[nd] = size;
+    });
+    unsigned long num_wrong = 0;
+    for (FlatTreeType::index_type nd = 0; nd < flat_tree.size(); ++nd) {
+        num_wrong += sizes[nd] != static_cast<long>(flat_tree.subtree_size(nd));
+    }
+    fails += platypus::testing::compare_equal(0UL, num_wrong, __FILE__, __LINE__, "bottom-up: ", remarks);
+
+    std::vector<long> depths(flat_tree.size(), -1);
+    traversal.top_down([&] (FlatTreeType::index_type nd) {
+        FlatTreeType::index_type parent = flat_tree.parent(nd);
+        depths[nd] = parent == FlatTreeType::npos ? 0 : (depths[parent] < 0 ? -1000000 : depths[parent] + 1);
+    });
+    num_wrong = 0;
+    for (FlatTreeType::index_type nd = 1; nd < flat_tree.size(); ++nd) {
+        num_wrong += depths[nd] != depths[flat_tree.parent(nd)] + 1;
+    }
+    fails += platypus::testing::compare_equal(0UL, num_wrong + (depths[0] != 0), __FILE__, __LINE__, "top-down: ", remarks);
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    std::mt19937 rng(1);
+    TreeType tree = random_tree(50000, rng);
+    FlatTreeType flat_tree(tree, nullptr, nullptr);
+    for (std::size_t serial_cutoff : {0UL, 1UL, 100UL, 5000UL, 100000UL}) {
+        for (unsigned int num_threads : {1U, 2U, 8U}) {
+            fails += check_tree(tree, serial_cutoff, num_threads);
+            fails += check_flat_tree(flat_tree, serial_cutoff, num_threads);
+        }
+    }
+
+    // the division into tasks is recomputed when the tree changes
+    platypus::ParallelTreeTraversal<TreeType> traversal(tree, 1000, 4);
+    std::size_t num_tasks = traversal.num_tasks();
+    fails += platypus::testing::compare_equal(true, traversal.is_current(), __FILE__, __LINE__, "current");
+    fails += platypus::testing::compare_equal(true, num_tasks > 1, __FILE__, __LINE__, "number of tasks: ", num_tasks);
+    TreeType::preorder_iterator pos(tree.head_node());
+    tree.add_child(pos, TestData(""));
+    fails += platypus::testing::compare_equal(false, traversal.is_current(), __FILE__, __LINE__, "out of date");
+    fails += platypus::testing::compare_equal(num_tasks + 1, traversal.num_tasks(), __FILE__, __LINE__, "tasks after adding a leaf");
+    fails += check_tree(tree, 1000, 4);
+
+    // exceptions are rethrown
+    bool caught = false;
+    try {
+        std::atomic<unsigned long> num_visited(0);
+        traversal.bottom_up([&] (NodeType *) {
+            if (++num_visited == 20000) {
+                throw std::runtime_error("failed");
+            }
+        });
+    } catch (const std::runtime_error &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "exception");
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
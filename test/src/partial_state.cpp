@@ -0,0 +1,187 @@
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <platypus/model/splitdistribution.hpp>
+#include <platypus/model/standardinterface.hpp>
+#include <platypus/model/topologyhash.hpp>
+#include <platypus/parse/newick.hpp>
+#include <platypus/utility/partialstate.hpp>
+#include <platypus/utility/treeoffsetindex.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+template <class FnT>
+bool throws_partial_state_error(FnT fn) {
+    try {
+        fn();
+    } catch (const platypus::PartialStateError &) {
+        return true;
+    }
+    return false;
+}
+
+int main() {
+    int fails = 0;
+
+    // shards cover the items, in order, with sizes differing by at most one
+    for (unsigned long num_items : {0UL, 1UL, 7UL, 100UL}) {
+        for (unsigned long num_shards : {1UL, 3UL, 8UL}) {
+            unsigned long expected_begin = 0;
+            for (unsigned long shard_idx = 0; shard_idx < num_shards; ++shard_idx) {
+                auto shard = platypus::shard_range(num_items, shard_idx, num_shards);
+                unsigned long size = shard.second - shard.first;
+                fails += platypus::testing::compare_equal(expected_begin, shard.first, __FILE__, __LINE__,
+                        "shard begin, items: ", num_items, ", shard: ", shard_idx, " of ", num_shards);
+                if (size != num_items / num_shards && size != num_items / num_shards + 1) {
+                    fails += platypus::testing::fail_test(__FILE__, __LINE__, "", "", "uneven shard of ", num_items, " items");
+                }
+                expected_begin = shard.second;
+            }
+            fails += platypus::testing::compare_equal(num_items, expected_begin, __FILE__, __LINE__, "shards cover items");
+        }
+    }
+    fails += platypus::testing::compare_equal(true,
+            throws_partial_state_error([] () { platypus::shard_range(10, 3, 3); }),
+            __FILE__, __LINE__, "shard index out of range");
+
+    // running statistics, merged exactly (in long double) as in memory
+    {
+        std::vector<platypus::numeric::RunningStatistics<>> shards(3);
+        for (int i = 0; i < 300; ++i) {
+            shards[i % 3].add(1.0L / (i + 3) + i * 1e-3L);
+        }
+        platypus::numeric::RunningStatistics<> expected;
+        platypus::numeric::RunningStatistics<> merged;
+        for (auto & shard : shards) {
+            expected.merge(shard);
+            platypus::merge_partial_state(merged, platypus::encode_partial_state(shard));
+        }
+        fails += platypus::testing::compare_equal(expected.size(), merged.size(), __FILE__, __LINE__, "statistics size");
+        fails += platypus::testing::compare_equal(true, expected.mean() == merged.mean(), __FILE__, __LINE__, "statistics mean");
+        fails += platypus::testing::compare_equal(true, expected.sum() == merged.sum(), __FILE__, __LINE__, "statistics sum");
+        fails += platypus::testing::compare_equal(true,
+                expected.sum_of_squared_deviations() == merged.sum_of_squared_deviations(),
+                __FILE__, __LINE__, "statistics sum of squared deviations");
+        fails += platypus::testing::compare_equal(true, expected.minimum() == merged.minimum(), __FILE__, __LINE__, "statistics minimum");
+        fails += platypus::testing::compare_equal(true, expected.maximum() == merged.maximum(), __FILE__, __LINE__, "statistics maximum");
+    }
+
+    // split distributions and topology counts over shards of indexed trees
+    // random binary trees on taxa a, ..., e, so that topologies repeat
+    platypus::numeric::RandomNumberGenerator rng(29);
+    std::string src;
+    for (int tree_idx = 0; tree_idx < 61; ++tree_idx) {
+        src += random_tree_string(rng, {"a", "b", "c", "d", "e"}) + "\n";
+    }
+    platypus::TaxonNamespace taxa;
+    platypus::NewickReader<TaxonTree> reader;
+    platypus::bind_standard_interface(reader);
+    platypus::bind_taxon_namespace(reader, taxa);
+    std::vector<TaxonTree> all_trees;
+    reader.read(std::istringstream(src), [&all_trees]() -> TaxonTree & { all_trees.emplace_back(); return all_trees.back(); });
+    platypus::TopologyHash<TaxonTree> topology_hash([] (const TaxonTree::value_type & nv) { return nv.get_taxon_index(); }, false);
+
+    platypus::TopologyCounts expected_counts;
+    for (auto hash : topology_hash.compute_trees(all_trees.cbegin(), all_trees.cend())) {
+        expected_counts.add(hash);
+    }
+    platypus::SplitDistribution<> single_pass(taxa, false);
+    single_pass.add_trees(all_trees.cbegin(), all_trees.cend());
+
+    platypus::TreeOffsetIndex index = platypus::TreeOffsetIndex::build(src);
+    const unsigned long num_shards = 4;
+    std::vector<std::string> split_states;
+    std::vector<std::string> count_paths;
+    platypus::SplitDistribution<> expected_splits(taxa, false);
+    std::istringstream shared_src(src);
+    for (unsigned long shard_idx = 0; shard_idx < num_shards; ++shard_idx) {
+        auto shard = platypus::shard_range(index.num_trees(), shard_idx, num_shards);
+        std::vector<TaxonTree> trees;
+        reader.read_range(shared_src, index, shard.first, shard.second, [&trees]() -> TaxonTree & { trees.emplace_back(); return trees.back(); });
+        platypus::SplitDistribution<> splits(taxa, false);
+        splits.add_trees(trees.cbegin(), trees.cend());
+        expected_splits.merge(splits);
+        split_states.push_back(platypus::encode_partial_state(splits));
+        platypus::TopologyCounts counts;
+        std::vector<std::uint64_t> hashes = topology_hash.compute_trees(trees.cbegin(), trees.cend());
+        counts.add(hashes.cbegin(), hashes.cend());
+        count_paths.push_back("partial_state_test." + std::to_string(shard_idx));
+        platypus::save_partial_state(counts, count_paths.back());
+    }
+
+    platypus::SplitDistribution<> merged_splits(taxa, false);
+    for (auto & bytes : split_states) {
+        platypus::merge_partial_state(merged_splits, bytes);
+    }
+    fails += platypus::testing::compare_equal(single_pass.num_trees(), merged_splits.num_trees(), __FILE__, __LINE__, "split trees");
+    fails += platypus::testing::compare_equal(single_pass.size(), merged_splits.size(), __FILE__, __LINE__, "distinct splits");
+    fails += platypus::testing::compare_equal(true, single_pass.observed_taxa() == merged_splits.observed_taxa(), __FILE__, __LINE__, "observed taxa");
+    for (auto & entry : expected_splits.splits()) {
+        auto found = merged_splits.splits().find(entry.first);
+        if (found == merged_splits.splits().end()) {
+            fails += platypus::testing::fail_test(__FILE__, __LINE__, "", "", "missing split ", entry.first.to_string());
+            continue;
+        }
+        fails += platypus::testing::compare_equal(single_pass.splits().at(entry.first).count, found->second.count,
+                __FILE__, __LINE__, "split count ", entry.first.to_string());
+        fails += platypus::testing::compare_equal(true, entry.second.edge_lengths.mean() == found->second.edge_lengths.mean(),
+                __FILE__, __LINE__, "split edge length mean ", entry.first.to_string());
+        fails += platypus::testing::compare_equal(true,
+                entry.second.edge_lengths.sample_variance() == found->second.edge_lengths.sample_variance(),
+                __FILE__, __LINE__, "split edge length variance ", entry.first.to_string());
+    }
+
+    platypus::TopologyCounts merged_counts;
+    platypus::merge_partial_state_files(merged_counts, count_paths);
+    fails += platypus::testing::compare_equal(expected_counts.get_num_trees(), merged_counts.get_num_trees(), __FILE__, __LINE__, "topology trees");
+    fails += platypus::testing::compare_equal(expected_counts.size(), merged_counts.size(), __FILE__, __LINE__, "distinct topologies");
+    if (expected_counts.size() == merged_counts.size()) {
+        for (std::size_t idx = 0; idx < expected_counts.size(); ++idx) {
+            fails += platypus::testing::compare_equal(expected_counts[idx].hash, merged_counts[idx].hash, __FILE__, __LINE__, "topology ", idx);
+            fails += platypus::testing::compare_equal(expected_counts[idx].count, merged_counts[idx].count, __FILE__, __LINE__, "topology count ", idx);
+            fails += platypus::testing::compare_equal(expected_counts[idx].first_index, merged_counts[idx].first_index,
+                    __FILE__, __LINE__, "topology first index ", idx);
+        }
+    }
+    if (expected_counts.size() >= all_trees.size()) {
+        fails += platypus::testing::fail_test(__FILE__, __LINE__, "", "", "expecting repeated topologies");
+    }
+    for (auto & path : count_paths) {
+        std::remove(path.c_str());
+    }
+
+    // states that cannot be merged
+    std::string bytes = split_states[0];
+    fails += platypus::testing::compare_equal(true, throws_partial_state_error([&bytes] () {
+                platypus::TopologyCounts counts;
+                platypus::merge_partial_state(counts, bytes);
+            }), __FILE__, __LINE__, "wrong kind");
+    fails += platypus::testing::compare_equal(true, throws_partial_state_error([&bytes] () {
+                platypus::SplitDistribution<> splits(5, true);
+                platypus::merge_partial_state(splits, bytes);
+            }), __FILE__, __LINE__, "wrong rootedness");
+    fails += platypus::testing::compare_equal(true, throws_partial_state_error([&bytes] () {
+                platypus::SplitDistribution<> splits(6, false);
+                platypus::merge_partial_state(splits, bytes);
+            }), __FILE__, __LINE__, "wrong number of taxa");
+    fails += platypus::testing::compare_equal(true, throws_partial_state_error([&bytes] () {
+                platypus::SplitDistribution<> splits(5, false);
+                platypus::merge_partial_state(splits, bytes.substr(0, bytes.size() - 1));
+            }), __FILE__, __LINE__, "truncated");
+    fails += platypus::testing::compare_equal(true, throws_partial_state_error([&bytes] () {
+                platypus::SplitDistribution<> splits(5, false);
+                platypus::merge_partial_state(splits, bytes + "x");
+            }), __FILE__, __LINE__, "trailing data");
+    fails += platypus::testing::compare_equal(true, throws_partial_state_error([&bytes] () {
+                platypus::SplitDistribution<> splits(5, false);
+                platypus::merge_partial_state(splits, "PLTX" + bytes.substr(4));
+            }), __FILE__, __LINE__, "bad magic");
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
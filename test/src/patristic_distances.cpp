@@ -0,0 +1,113 @@
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <platypus/model/treedistance.hpp>
+#include <platypus/model/standardinterface.hpp>
+#include <platypus/parse/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TaxonTree::node_type NodeType;
+
+// random binary tree on taxa t0, ..., t{num_taxa-1}, with the basal split
+// of the taxa as even as possible
+std::string random_tree_string(platypus::numeric::RandomNumberGenerator & rng, int num_taxa) {
+    std::vector<std::string> labels = taxon_labels(num_taxa);
+    std::vector<std::string> left(labels.begin(), labels.begin() + num_taxa / 2);
+    std::vector<std::string> right(labels.begin() + num_taxa / 2, labels.end());
+    std::ostringstream o;
+    o << "(" << random_subtree_string(rng, left) << ":" << rng.uniform_pos_int(1, 4)
+        << "," << random_subtree_string(rng, right) << ":" << rng.uniform_pos_int(1, 4) << ");";
+    return o.str();
+}
+
+// distances by walking up from each leaf of every pair to their common ancestor
+std::vector<double> naive_distances(const TaxonTree & tree, std::size_t num_taxa) {
+    std::vector<const NodeType *> leaves(num_taxa, nullptr);
+    for (auto ndi = tree.leaf_begin(); ndi != tree.leaf_end(); ++ndi) {
+        leaves[ndi->get_taxon_index()] = ndi.node();
+    }
+    auto depth = [] (const NodeType * nd) {
+        unsigned long d = 0;
+        for (; nd->parent_node() != nullptr; nd = nd->parent_node()) {
+            ++d;
+        }
+        return d;
+    };
+    std::vector<double> result;
+    for (std::size_t i = 0; i < num_taxa; ++i) {
+        for (std::size_t j = i + 1; j < num_taxa; ++j) {
+            const NodeType * a = leaves[i];
+            const NodeType * b = leaves[j];
+            unsigned long da = depth(a);
+            unsigned long db = depth(b);
+            double distance = 0.0;
+            while (a != b) {
+                if (da >= db) {
+                    distance += a->value().get_edge_length();
+                    a = a->parent_node();
+                    --da;
+                } else {
+                    distance += b->value().get_edge_length();
+                    b = b->parent_node();
+                    --db;
+                }
+            }
+            result.push_back(distance);
+        }
+    }
+    return result;
+}
+
+int main() {
+    int fails = 0;
+
+    {
+        platypus::TaxonNamespace taxa;
+        TaxonTree tree = read_tree("((a:1,b:2):3,(c:4,(d:5):1):6,e:7):100;", taxa);
+        platypus::PatristicDistances<> patristic;
+        patristic.assign(tree, taxa);
+        std::vector<double> expected{
+            // a  b   c   d   e
+                  3, 14, 16, 11,
+                     15, 17, 12,
+                          10, 17,
+                              19,
+        };
+        fails += platypus::testing::compare_equal(expected, patristic.distances().values(), __FILE__, __LINE__, "small tree");
+        fails += platypus::testing::compare_equal(17.0, patristic.get_distance(3, 1), __FILE__, __LINE__, "get_distance()");
+
+        platypus::DataTable table;
+        patristic.export_table(table);
+        fails += platypus::testing::compare_equal(10UL, table.num_rows(), __FILE__, __LINE__, "table rows");
+
+        std::ostringstream out;
+        patristic.write_binary(out, 16);
+        std::string data = out.str();
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(8 + 8 * 10), data.size(), __FILE__, __LINE__, "binary size");
+        fails += platypus::testing::compare_equal(5UL, static_cast<unsigned long>(platypus::binary_format::decode_u64(data.data())), __FILE__, __LINE__, "binary size header");
+        fails += platypus::testing::compare_equal(16.0, platypus::binary_format::decode_f64(data.data() + 8 + 8 * 2), __FILE__, __LINE__, "binary value");
+    }
+
+    // large enough for the basal pairs to be filled concurrently
+    platypus::numeric::RandomNumberGenerator rng(17);
+    for (int num_taxa : {2, 3, 50, 1200}) {
+        platypus::TaxonNamespace taxa;
+        TaxonTree tree = read_tree(random_tree_string(rng, num_taxa), taxa);
+        std::vector<double> expected = naive_distances(tree, taxa.size());
+        for (unsigned int num_threads : {1U, 4U}) {
+            platypus::PatristicDistances<> patristic;
+            patristic.assign(tree, taxa, num_threads);
+            fails += platypus::testing::compare_equal(expected, patristic.distances().values(), __FILE__, __LINE__,
+                    "random tree of ", num_taxa, " taxa, threads: ", num_threads);
+        }
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,142 @@
+#include <stdlib.h>
+#include <random>
+#include <string>
+#include <vector>
+#include <platypus/model/persistenttree.hpp>
+#include <platypus/model/treepattern.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree TreeType;
+typedef platypus::PersistentTree<TestData> PersistentTreeType;
+
+template <class IterT>
+std::vector<std::string> get_labels(IterT begin, IterT end) {
+    std::vector<std::string> labels;
+    for (auto ndi = begin; ndi != end; ++ndi) {
+        labels.push_back(ndi->get_label());
+    }
+    return labels;
+}
+
+std::string to_newick(const PersistentTreeType & tree) {
+    TreeType result;
+    tree.copy_to(result);
+    return get_standard_newick_writer<TreeType>().format(result);
+}
+
+// the iterator at the node labeled ``label``
+PersistentTreeType::preorder_iterator find(const PersistentTreeType & tree, const std::string & label) {
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        if (ndi->get_label() == label) {
+            return ndi;
+        }
+    }
+    return tree.preorder_end();
+}
+
+int check_traversal() {
+    int fails = 0;
+    TreeType tree = read_tree(STANDARD_TEST_TREE_WEDGE_NEWICK);
+    PersistentTreeType persistent(tree);
+    fails += platypus::testing::compare_equal(static_cast<std::size_t>(15), persistent.size(), __FILE__, __LINE__, "size");
+    fails += platypus::testing::compare_equal(static_cast<std::size_t>(8), persistent.num_leaves(), __FILE__, __LINE__, "leaves");
+    fails += platypus::testing::compare_equal(get_labels(tree.preorder_begin(), tree.preorder_end()),
+            get_labels(persistent.preorder_begin(), persistent.preorder_end()), __FILE__, __LINE__, "preorder");
+    fails += platypus::testing::compare_equal(get_labels(tree.postorder_begin(), tree.postorder_end()),
+            get_labels(persistent.postorder_begin(), persistent.postorder_end()), __FILE__, __LINE__, "postorder");
+    fails += platypus::testing::compare_equal(get_labels(tree.leaf_begin(), tree.leaf_end()),
+            get_labels(persistent.leaf_begin(), persistent.leaf_end()), __FILE__, __LINE__, "leaves");
+    auto ndi = find(persistent, "o");
+    fails += platypus::testing::compare_equal(static_cast<std::size_t>(4), ndi.depth(), __FILE__, __LINE__, "depth");
+    fails += platypus::testing::compare_equal(std::string("h"), ndi.parent_node()->value().get_label(), __FILE__, __LINE__, "parent");
+    fails += platypus::testing::compare_equal(get_standard_newick_writer<TreeType>().format(tree), to_newick(persistent), __FILE__, __LINE__, "copy_to()");
+
+    PersistentTreeType empty;
+    fails += platypus::testing::compare_equal(true, empty.preorder_begin() == empty.preorder_end(), __FILE__, __LINE__, "empty");
+    fails += platypus::testing::compare_equal(static_cast<std::size_t>(0), empty.size(), __FILE__, __LINE__, "empty size");
+    return fails;
+}
+
+int check_edits() {
+    int fails = 0;
+    TreeType tree = read_tree(STANDARD_TEST_TREE_WEDGE_NEWICK);
+    const std::string original = get_standard_newick_writer<TreeType>().format(tree);
+    PersistentTreeType base(tree);
+    {
+        PersistentTreeType variant(base);
+        auto pos = find(base, "o");
+        variant.value(pos).set_edge_length(100);
+        fails += platypus::testing::compare_equal(original, to_newick(base), __FILE__, __LINE__, "base unchanged by value()");
+        fails += platypus::testing::compare_equal(100.0, find(variant, "o")->get_edge_length(), __FILE__, __LINE__, "value()");
+        // only the path a, c, f, h, o is copied
+        fails += platypus::testing::compare_equal(find(base, "b").node(), find(variant, "b").node(), __FILE__, __LINE__, "unchanged subtree shared");
+        fails += platypus::testing::compare_equal(find(base, "p").node(), find(variant, "p").node(), __FILE__, __LINE__, "sibling shared");
+        fails += platypus::testing::compare_equal(true, find(base, "h").node() != find(variant, "h").node(), __FILE__, __LINE__, "path copied");
+        // a node no longer shared is modified in place
+        const PersistentTreeType::node_type * h = find(variant, "h").node();
+        variant.value(find(variant, "p")).set_edge_length(200);
+        fails += platypus::testing::compare_equal(h, find(variant, "h").node(), __FILE__, __LINE__, "unshared path modified in place");
+        fails += platypus::testing::compare_equal(original, to_newick(base), __FILE__, __LINE__, "base unchanged");
+    }
+    {
+        PersistentTreeType variant(base);
+        PersistentTreeType removed = variant.remove_subtree(find(variant, "f"));
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(5), removed.size(), __FILE__, __LINE__, "removed size");
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(10), variant.size(), __FILE__, __LINE__, "size after remove_subtree()");
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(5), variant.num_leaves(), __FILE__, __LINE__, "leaves after remove_subtree()");
+        variant.add_child(find(variant, "e"), removed);
+        fails += platypus::testing::compare_equal(
+                std::string("[&R] ((i:1.000000, (j:2.000000, k:3.000000, (n:9.000000, (o:10.000000, p:11.000000)h:12.000000)f:13.000000)e:4.000000)b:5.000000, ((l:6.000000, m:7.000000)g:8.000000)c:14.000000)a:15.000000;"),
+                to_newick(variant), __FILE__, __LINE__, "add_child()");
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(8), variant.num_leaves(), __FILE__, __LINE__, "leaves after add_child()");
+        fails += platypus::testing::compare_equal(find(base, "f").node(), find(variant, "f").node(), __FILE__, __LINE__, "moved subtree shared");
+        variant.replace_subtree(find(variant, "g"), PersistentTreeType(TestData("x")));
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(7), variant.num_leaves(), __FILE__, __LINE__, "leaves after replace_subtree()");
+        fails += platypus::testing::compare_equal(std::string("x"), find(variant, "c").node()->child_node(0)->value().get_label(), __FILE__, __LINE__, "replace_subtree()");
+        fails += platypus::testing::compare_equal(original, to_newick(base), __FILE__, __LINE__, "base unchanged");
+    }
+    {
+        PersistentTreeType built(TestData("r"), {PersistentTreeType(TestData("s")), base.subtree(find(base, "g"))});
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(5), built.size(), __FILE__, __LINE__, "built size");
+        fails += platypus::testing::compare_equal(std::vector<std::string>{"s", "l", "m"},
+                get_labels(built.leaf_begin(), built.leaf_end()), __FILE__, __LINE__, "built leaves");
+    }
+    {
+        // many variants, each differing from the base at one leaf
+        std::vector<TestData> leaves;
+        for (int idx = 0; idx < 500; ++idx) {
+            leaves.emplace_back("t" + std::to_string(idx));
+        }
+        TreeType big;
+        platypus::build_maximally_balanced_tree(big, leaves.begin(), leaves.end());
+        PersistentTreeType big_base(big);
+        std::vector<PersistentTreeType> variants;
+        for (auto ndi = big_base.leaf_begin(); ndi != big_base.leaf_end(); ++ndi) {
+            variants.push_back(big_base);
+            variants.back().value(ndi).set_label("changed");
+        }
+        const std::vector<std::string> base_labels = get_labels(big_base.leaf_begin(), big_base.leaf_end());
+        for (std::size_t idx = 0; idx < variants.size(); ++idx) {
+            auto expected = base_labels;
+            expected[idx] = "changed";
+            if (expected != get_labels(variants[idx].leaf_begin(), variants[idx].leaf_end())) {
+                fails += platypus::testing::fail_test(__FILE__, __LINE__, "", "", "variant ", idx);
+            }
+        }
+        fails += platypus::testing::compare_equal(get_labels(big.leaf_begin(), big.leaf_end()), base_labels, __FILE__, __LINE__, "base unchanged");
+    }
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_traversal();
+    fails += check_edits();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -23,6 +23,124 @@ std::ostream& operator<<(std::ostream& stream, const TestData& data) {
     return stream;
 }
 
+TestDataTree read_tree(const std::string & newick, bool node_recycling) {
+    auto trees = get_test_data_tree_vector_from_string<TestDataTree>(newick);
+    TestDataTree tree(std::move(trees[0]));
+    tree.set_node_recycling(node_recycling);
+    return tree;
+}
+
+std::string get_label(const TestData & nv) {
+    return nv.get_label();
+}
+
+double get_edge_length(const TestData & nv) {
+    return nv.get_edge_length();
+}
+
+void set_edge_length(TestData & nv, double length) {
+    nv.set_edge_length(length);
+}
+
+void copy_value(const TestData & src, TestData & dest) {
+    dest = src;
+}
+
+std::size_t get_taxon_index(const TestData & nv) {
+    const std::string & label = nv.get_label();
+    if (label.size() > 1 && label[0] == 't') {
+        return std::stoul(label.substr(1));
+    }
+    return static_cast<std::size_t>(label[0] - 'a');
+}
+
+double tree_length(const TestDataTree & tree) {
+    double length = 0.0;
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        length += ndi->get_edge_length();
+    }
+    return length;
+}
+
+std::string write_trees(const std::vector<TestDataTree> & trees) {
+    platypus::NewickWriter<TestDataTree> writer = get_standard_newick_writer<TestDataTree>();
+    std::ostringstream o;
+    writer.write(o, trees.cbegin(), trees.cend());
+    return o.str();
+}
+
+platypus::FlatTree<double> build_flat_tree(const TestDataTree & tree) {
+    return platypus::FlatTree<double>(tree,
+            [](const TestData & nv) { return nv.get_label(); },
+            [](const TestData & nv) { return nv.get_edge_length(); });
+}
+
+std::vector<TaxonTree> read_trees(const std::string & src, platypus::TaxonNamespace & taxon_namespace) {
+    std::vector<TaxonTree> trees;
+    platypus::NewickReader<TaxonTree> reader;
+    platypus::bind_standard_interface(reader);
+    platypus::bind_taxon_namespace(reader, taxon_namespace);
+    reader.read(std::istringstream(src), [&trees]() -> TaxonTree & { trees.emplace_back(); return trees.back(); });
+    return trees;
+}
+
+TaxonTree read_tree(const std::string & src, platypus::TaxonNamespace & taxon_namespace) {
+    std::vector<TaxonTree> trees = read_trees(src, taxon_namespace);
+    return std::move(trees[0]);
+}
+
+std::vector<std::string> taxon_labels(unsigned long num_taxa) {
+    std::vector<std::string> labels;
+    for (unsigned long idx = 0; idx < num_taxa; ++idx) {
+        labels.push_back("t" + std::to_string(idx));
+    }
+    return labels;
+}
+
+std::string random_subtree_string(platypus::numeric::RandomNumberGenerator & rng,
+        const std::vector<std::string> & labels,
+        bool with_edge_lengths,
+        bool with_polytomies) {
+    std::vector<std::string> subtrees(labels);
+    while (subtrees.size() > 1) {
+        std::size_t num_joined = 2;
+        if (with_polytomies && rng.uniform_pos_int(2) == 0) {
+            num_joined = std::min<std::size_t>(subtrees.size(), rng.uniform_pos_int(3, 5));
+        }
+        std::string joined = "(";
+        for (std::size_t k = 0; k < num_joined; ++k) {
+            std::size_t idx = rng.uniform_pos_int(subtrees.size() - 1);
+            joined += (k > 0 ? "," : "") + subtrees[idx];
+            if (with_edge_lengths) {
+                joined += ":" + std::to_string(rng.uniform_pos_int(1, 4));
+            }
+            subtrees.erase(subtrees.begin() + idx);
+        }
+        subtrees.push_back(joined + ")");
+    }
+    return subtrees.empty() ? std::string() : subtrees[0];
+}
+
+std::string random_tree_string(platypus::numeric::RandomNumberGenerator & rng,
+        const std::vector<std::string> & labels,
+        bool with_edge_lengths,
+        bool with_polytomies) {
+    return random_subtree_string(rng, labels, with_edge_lengths, with_polytomies) + ";";
+}
+
+std::string balanced_tree_string(unsigned long first,
+        unsigned long num_tips,
+        const std::function<std::string (unsigned long)> & leaf_string,
+        const std::string & edge_suffix) {
+    if (num_tips == 1) {
+        return (leaf_string ? leaf_string(first) : "t" + std::to_string(first)) + edge_suffix;
+    }
+    unsigned long half = num_tips / 2;
+    return "(" + balanced_tree_string(first, half, leaf_string, edge_suffix)
+        + "," + balanced_tree_string(first + half, num_tips - half, leaf_string, edge_suffix)
+        + ")" + edge_suffix;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // General String Support/Utility
 
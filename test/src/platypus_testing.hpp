@@ -9,11 +9,14 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <map>
+#include <random>
 #include <functional>
 #include <platypus/model/tree.hpp>
+#include <platypus/model/flattree.hpp>
 #include <platypus/parse/newick.hpp>
 #include <platypus/serialize/newick.hpp>
 #include <platypus/model/standardinterface.hpp>
+#include <platypus/numeric/rng.hpp>
 #include <platypus/utility/tokenizer.hpp>
 #include <platypus/utility/testing.hpp>
 
@@ -40,6 +43,9 @@ class TestData {
         TestData(const std::string & label)
             : label_(label)
               , edge_length_(0.0) { }
+        TestData(const TestData & nd)
+            : label_(nd.label_)
+              , edge_length_(nd.edge_length_) { }
         TestData & operator=(const TestData & nd) {
             this->label_ = nd.label_;
             this->edge_length_ = nd.edge_length_;
@@ -143,6 +149,102 @@ platypus::NewickWriter<TreeT> get_standard_newick_writer(bool include_edge_lengt
     return tree_writer;
 }
 
+// The first tree of the Newick string ``newick``, with node recycling
+// enabled if ``node_recycling`` is true.
+TestDataTree read_tree(const std::string & newick, bool node_recycling=false);
+
+// Accessors of TestData values, to pass to the algorithms that take
+// getters and setters of node labels, edge lengths or whole values.
+std::string get_label(const TestData & nv);
+double get_edge_length(const TestData & nv);
+void set_edge_length(TestData & nv, double length);
+void copy_value(const TestData & src, TestData & dest);
+
+// The index of the taxon of a leaf labeled "a", "b", ..., or "t0", "t1", ....
+std::size_t get_taxon_index(const TestData & nv);
+
+// The sum of the edge lengths of all of the nodes of ``tree``.
+double tree_length(const TestDataTree & tree);
+
+// The trees of ``trees``, written by the standard Newick writer, one per
+// line.
+std::string write_trees(const std::vector<TestDataTree> & trees);
+
+// A FlatTree of ``tree``, with its labels and edge lengths.
+platypus::FlatTree<double> build_flat_tree(const TestDataTree & tree);
+
+//////////////////////////////////////////////////////////////////////////////
+// TaxonTree
+
+typedef platypus::StandardTree<platypus::TaxonNodeValue<>> TaxonTree;
+
+// The trees of the Newick string ``src``, with their leaves bound to taxa
+// of ``taxon_namespace``.
+std::vector<TaxonTree> read_trees(const std::string & src, platypus::TaxonNamespace & taxon_namespace);
+
+// The first tree of the Newick string ``src``, with its leaves bound to
+// taxa of ``taxon_namespace``.
+TaxonTree read_tree(const std::string & src, platypus::TaxonNamespace & taxon_namespace);
+
+//////////////////////////////////////////////////////////////////////////////
+// Random Trees
+
+// Labels "t0", ..., "t{num_taxa-1}".
+std::vector<std::string> taxon_labels(unsigned long num_taxa);
+
+// Newick representation, without a terminating ';', of a random tree on
+// the leaves ``labels``, formed by joining randomly chosen subtrees two at
+// a time (or, if ``with_polytomies``, sometimes three to five at a time).
+// If ``with_edge_lengths``, the edge of every node but the root is given
+// an integer length from 1 to 4.
+std::string random_subtree_string(platypus::numeric::RandomNumberGenerator & rng,
+        const std::vector<std::string> & labels,
+        bool with_edge_lengths=true,
+        bool with_polytomies=false);
+
+// As random_subtree_string(), terminated by ';'.
+std::string random_tree_string(platypus::numeric::RandomNumberGenerator & rng,
+        const std::vector<std::string> & labels,
+        bool with_edge_lengths=true,
+        bool with_polytomies=false);
+
+// Newick representation, without a terminating ';', of a balanced tree on
+// ``num_tips`` leaves numbered from ``first``, labeled by
+// ``leaf_string(i)`` (by default, "t<i>"), with ``edge_suffix`` (e.g.
+// ":1") after every node.
+std::string balanced_tree_string(unsigned long first,
+        unsigned long num_tips,
+        const std::function<std::string (unsigned long)> & leaf_string=nullptr,
+        const std::string & edge_suffix="");
+
+// Adds sequences of ``num_sites`` symbols drawn uniformly from ``symbols``
+// to ``matrix``, for taxa "t0", ..., "t{num_taxa-1}", and returns them. If
+// ``repeat_period`` is not 0, the last of every ``repeat_period`` sites is
+// a copy of the first site, to give repeated site patterns.
+template <class MatrixT>
+std::vector<std::string> add_random_sequences(MatrixT & matrix,
+        std::size_t num_taxa,
+        std::size_t num_sites,
+        std::mt19937 & rng,
+        const std::string & symbols="ACGT",
+        std::size_t repeat_period=0) {
+    std::uniform_int_distribution<int> symbol(0, static_cast<int>(symbols.size()) - 1);
+    std::vector<std::string> sequences;
+    for (std::size_t taxon = 0; taxon < num_taxa; ++taxon) {
+        std::string sequence;
+        for (std::size_t site = 0; site < num_sites; ++site) {
+            if (repeat_period > 0 && site % repeat_period == repeat_period - 1) {
+                sequence.push_back(sequence[0]);
+            } else {
+                sequence.push_back(symbols[symbol(rng)]);
+            }
+        }
+        matrix.add_sequence("t" + std::to_string(taxon), sequence);
+        sequences.push_back(sequence);
+    }
+    return sequences;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // General String Support/Utility
 
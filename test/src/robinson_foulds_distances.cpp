@@ -0,0 +1,147 @@
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <platypus/model/treedistance.hpp>
+#include <platypus/model/standardinterface.hpp>
+#include <platypus/parse/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+// edge lengths of splits (non-trivial and trivial, excluding the root), by bitmask
+std::map<std::string, double> split_lengths(const TaxonTree & tree, std::size_t num_taxa, bool normalize) {
+    std::map<std::string, double> result;
+    platypus::SplitSet splits(tree,
+            num_taxa,
+            [] (const TaxonTree::value_type & nv) { return nv.get_taxon_index(); },
+            normalize);
+    std::size_t idx = 0;
+    for (auto nd = tree.postorder_begin(); idx + 1 < splits.size(); ++nd, ++idx) {
+        result[splits.get_split(idx).to_string()] += nd->get_edge_length();
+    }
+    return result;
+}
+
+void naive_distances(const std::map<std::string, double> & a,
+        const std::map<std::string, double> & b,
+        std::size_t num_taxa,
+        bool is_rooted,
+        unsigned long & rf,
+        double & weighted_rf) {
+    rf = 0;
+    weighted_rf = 0.0;
+    std::map<std::string, std::pair<double, double>> all;
+    for (auto & s : a) {
+        all[s.first].first = s.second;
+    }
+    for (auto & s : b) {
+        all[s.first].second = s.second;
+    }
+    for (auto & s : all) {
+        weighted_rf += std::abs(s.second.first - s.second.second);
+        std::size_t n = std::count(s.first.begin(), s.first.end(), '1');
+        bool is_trivial = n < 2 || (!is_rooted && n + 2 > num_taxa);
+        if (!is_trivial && (a.count(s.first) == 0 || b.count(s.first) == 0)) {
+            ++rf;
+        }
+    }
+}
+
+int main () {
+    int fails = 0;
+
+    // known distances
+    {
+        std::string src =
+            "((a:1,b:1):1,(c:1,(d:1,e:1):1):1);\n"
+            "((a:1,c:1):1,(b:1,(d:1,e:1):2):1);\n"
+            "(((d:1,e:1):3,c:1):1,(b:1,a:1):1);\n"
+            "(a:1,(b:1,(c:1,(d:1,e:1):1):1):1);\n";
+        platypus::TaxonNamespace taxon_namespace;
+        auto trees = read_trees(src, taxon_namespace);
+        platypus::RobinsonFouldsDistances<> unrooted(false, true);
+        unrooted.assign(trees.begin(), trees.end(), taxon_namespace, 1);
+        fails += platypus::testing::compare_equal(4UL, static_cast<unsigned long>(unrooted.size()), __FILE__, __LINE__, "number of trees");
+        fails += platypus::testing::compare_equal(2UL, unrooted.get_distance(0, 1), __FILE__, __LINE__, "unrooted RF(0, 1)");
+        fails += platypus::testing::compare_equal(2UL, unrooted.get_distance(1, 0), __FILE__, __LINE__, "unrooted RF(1, 0)");
+        fails += platypus::testing::compare_equal(0UL, unrooted.get_distance(0, 2), __FILE__, __LINE__, "unrooted RF(0, 2)");
+        fails += platypus::testing::compare_equal(0UL, unrooted.get_distance(0, 3), __FILE__, __LINE__, "unrooted RF(0, 3)");
+        fails += platypus::testing::compare_equal(0UL, unrooted.get_distance(1, 1), __FILE__, __LINE__, "unrooted RF(1, 1)");
+        // {d,e}: |1 - 3|; {a,b}: basal bifurcation of 1 + 1 in both
+        fails += platypus::testing::compare_equal(2.0, unrooted.get_weighted_distance(0, 2), __FILE__, __LINE__, "unrooted weighted RF(0, 2)");
+        // {a,b} and {a,c}: 2 each; {d,e}: |1 - 2|
+        fails += platypus::testing::compare_equal(5.0, unrooted.get_weighted_distance(0, 1), __FILE__, __LINE__, "unrooted weighted RF(0, 1)");
+        // {a,b}: 2 vs 1 (as {c,d,e}); a: 1 vs 1 + 1, of the basal bifurcation
+        fails += platypus::testing::compare_equal(2.0, unrooted.get_weighted_distance(0, 3), __FILE__, __LINE__, "unrooted weighted RF(0, 3)");
+
+        platypus::RobinsonFouldsDistances<> rooted(true);
+        rooted.assign(trees.begin(), trees.end(), taxon_namespace, 1);
+        fails += platypus::testing::compare_equal(0UL, rooted.get_distance(0, 2), __FILE__, __LINE__, "rooted RF(0, 2)");
+        fails += platypus::testing::compare_equal(4UL, rooted.get_distance(0, 1), __FILE__, __LINE__, "rooted RF(0, 1)");
+        fails += platypus::testing::compare_equal(2UL, rooted.get_distance(0, 3), __FILE__, __LINE__, "rooted RF(0, 3)");
+        fails += platypus::testing::compare_equal(0UL, static_cast<unsigned long>(rooted.weighted_distances().size()), __FILE__, __LINE__, "weighted distances not requested");
+
+        platypus::DataTable table;
+        unrooted.export_table(table);
+        fails += platypus::testing::compare_equal(6UL, table.num_rows(), __FILE__, __LINE__, "exported rows");
+        fails += platypus::testing::compare_equal(4UL, table.num_columns(), __FILE__, __LINE__, "exported columns");
+        std::ostringstream o;
+        table.write(o);
+        std::vector<std::string> lines;
+        std::istringstream lines_src(o.str());
+        for (std::string line; std::getline(lines_src, line); ) {
+            lines.push_back(line);
+        }
+        fails += platypus::testing::compare_equal(std::string("tree1\ttree2\trf\tweighted_rf"), lines.at(0), __FILE__, __LINE__, "exported header");
+        fails += platypus::testing::compare_equal(std::string("0\t1\t2\t5"), lines.at(1), __FILE__, __LINE__, "exported first row");
+        fails += platypus::testing::compare_equal(std::string("2\t3\t0\t4"), lines.at(6), __FILE__, __LINE__, "exported last row");
+    }
+
+    // against naive comparison of splits, across several tiles and threads
+    {
+        const int num_taxa = 12;
+        platypus::numeric::RandomNumberGenerator rng(42);
+        std::ostringstream o;
+        for (int i = 0; i < num_taxa; ++i) {
+            o << (i == 0 ? "(" : ",") << "t" << i;
+        }
+        o << ");\n"; // fixes taxon order
+        for (int i = 0; i < 80; ++i) {
+            o << random_tree_string(rng, taxon_labels(num_taxa)) << "\n";
+        }
+        platypus::TaxonNamespace taxon_namespace;
+        auto trees = read_trees(o.str(), taxon_namespace);
+        trees.erase(trees.begin());
+        for (int rooted = 0; rooted < 2; ++rooted) {
+            std::vector<std::map<std::string, double>> lengths;
+            for (auto & tree : trees) {
+                lengths.push_back(split_lengths(tree, num_taxa, !rooted));
+            }
+            platypus::RobinsonFouldsDistances<> serial(rooted, true);
+            serial.assign(trees.begin(), trees.end(), taxon_namespace, 1);
+            platypus::RobinsonFouldsDistances<> threaded(rooted, true);
+            threaded.assign(trees.begin(), trees.end(), taxon_namespace, 4);
+            int num_mismatches = 0;
+            for (std::size_t i = 0; i < trees.size(); ++i) {
+                for (std::size_t j = i + 1; j < trees.size(); ++j) {
+                    unsigned long rf = 0;
+                    double weighted_rf = 0.0;
+                    naive_distances(lengths[i], lengths[j], num_taxa, rooted, rf, weighted_rf);
+                    if (rf != serial.get_distance(i, j)
+                            || rf != threaded.get_distance(j, i)
+                            || std::abs(weighted_rf - serial.get_weighted_distance(i, j)) > 1e-9
+                            || std::abs(weighted_rf - threaded.get_weighted_distance(i, j)) > 1e-9) {
+                        ++num_mismatches;
+                    }
+                }
+            }
+            fails += platypus::testing::compare_equal(0, num_mismatches, __FILE__, __LINE__, rooted ? "rooted distances" : "unrooted distances");
+        }
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,134 @@
+#include <stdlib.h>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <platypus/model/sequencesimulator.hpp>
+#include <platypus/serialize/charactermatrix.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree TreeType;
+typedef platypus::SequenceSimulator<TreeType> SimulatorType;
+typedef platypus::CharacterMatrixWriter<platypus::NucleotideCharacterMatrix> WriterType;
+
+double proportion_different(const platypus::NucleotideCharacterMatrix & matrix, std::size_t row1, std::size_t row2) {
+    unsigned long num_different = 0;
+    for (std::size_t site = 0; site < matrix.num_sites(); ++site) {
+        if (matrix.get_state_set(row1, site) != matrix.get_state_set(row2, site)) {
+            ++num_different;
+        }
+    }
+    return static_cast<double>(num_different) / matrix.num_sites();
+}
+
+int check_writer() {
+    int fails = 0;
+    platypus::NucleotideCharacterMatrix matrix(platypus::CharacterStateAlphabet::dna());
+    matrix.add_sequence("a", "ACGTAR");
+    matrix.add_sequence("b", "ACGTA-");
+    matrix.add_sequence("c", "ACNTAY");
+    WriterType writer;
+    fails += platypus::testing::compare_equal(
+            std::string(">a\nACGTAR\n>b\nACGTA-\n>c\nAC-TAY\n"),
+            writer.format(matrix),
+            __FILE__, __LINE__, "FASTA");
+    writer.set_line_width(4);
+    fails += platypus::testing::compare_equal(
+            std::string(">a\nACGT\nAR\n>b\nACGT\nA-\n>c\nAC-T\nAY\n"),
+            writer.format(matrix),
+            __FILE__, __LINE__, "FASTA with line width");
+    writer.set_format(WriterType::Format::PHYLIP);
+    std::string phylip = "3 6\na  ACGTAR\nb  ACGTA-\nc  AC-TAY\n";
+    fails += platypus::testing::compare_equal(phylip, writer.format(matrix), __FILE__, __LINE__, "PHYLIP");
+    matrix.compress_patterns();
+    writer.set_output_block_size(1);
+    fails += platypus::testing::compare_equal(phylip, writer.format(matrix), __FILE__, __LINE__, "PHYLIP of compressed matrix");
+    return fails;
+}
+
+int check_substitution_rates() {
+    int fails = 0;
+    const std::size_t num_sites = 100000;
+    TreeType tree = read_tree("(a:0.1,(b:0.15,c:0.05):0.05);");
+    platypus::numeric::RandomNumberGenerator rng(17);
+    {
+        SimulatorType simulator(rng, platypus::SubstitutionModel::jc69(), platypus::CharacterStateAlphabet::dna(), get_label, get_edge_length);
+        platypus::NucleotideCharacterMatrix matrix(simulator.alphabet());
+        simulator.simulate(tree, num_sites, matrix);
+        fails += platypus::testing::compare_equal(3UL, static_cast<unsigned long>(matrix.num_taxa()), __FILE__, __LINE__, "number of rows");
+        fails += platypus::testing::compare_equal(std::string("b"), matrix.get_taxon_label(1), __FILE__, __LINE__, "rows in leaf order");
+        double expected = 0.75 * (1.0 - std::exp(-4.0 * 0.3 / 3.0));
+        double observed = proportion_different(matrix, 0, 1);
+        fails += platypus::testing::compare_equal(true, std::fabs(expected - observed) < 0.01, __FILE__, __LINE__, "JC69 differences: ", observed, ", expected ", expected);
+        // re-using the matrix
+        simulator.simulate(tree, 10, matrix);
+        fails += platypus::testing::compare_equal(10UL, static_cast<unsigned long>(matrix.num_sites()), __FILE__, __LINE__, "re-used matrix");
+    }
+    {
+        SimulatorType simulator(rng, platypus::SubstitutionModel::jc69(), platypus::CharacterStateAlphabet::dna(), get_label, get_edge_length, 4, 0.5);
+        platypus::NucleotideCharacterMatrix matrix(simulator.alphabet());
+        simulator.simulate(tree, num_sites, matrix);
+        double expected = 0.0;
+        for (auto rate : simulator.category_rates()) {
+            expected += 0.25 * 0.75 * (1.0 - std::exp(-4.0 * 0.3 * rate / 3.0));
+        }
+        double observed = proportion_different(matrix, 0, 1);
+        fails += platypus::testing::compare_equal(true, std::fabs(expected - observed) < 0.01, __FILE__, __LINE__, "JC69+G differences: ", observed, ", expected ", expected);
+    }
+    {
+        std::vector<double> freqs{0.1, 0.2, 0.3, 0.4};
+        SimulatorType simulator(rng, platypus::SubstitutionModel::hky85(3.0, freqs), platypus::CharacterStateAlphabet::dna(), get_label, get_edge_length);
+        platypus::NucleotideCharacterMatrix matrix(simulator.alphabet());
+        simulator.simulate(tree, num_sites, matrix);
+        for (std::size_t state = 0; state < 4; ++state) {
+            unsigned long count = 0;
+            for (std::size_t site = 0; site < num_sites; ++site) {
+                count += matrix.get_state_set(2, site) == (1U << state);
+            }
+            double observed = static_cast<double>(count) / num_sites;
+            fails += platypus::testing::compare_equal(true, std::fabs(freqs[state] - observed) < 0.01, __FILE__, __LINE__, "HKY85 frequency of state ", state, ": ", observed);
+        }
+    }
+    return fails;
+}
+
+int check_batch() {
+    int fails = 0;
+    std::vector<TreeType> trees;
+    for (int idx = 0; idx < 40; ++idx) {
+        trees.push_back(read_tree("((a:0.1,b:0.2):0.05,(c:0.3,d:0.1):0.1,e:" + std::to_string(0.1 * idx) + ");"));
+    }
+    platypus::numeric::RandomNumberGenerator rng;
+    SimulatorType simulator(rng, platypus::SubstitutionModel::jc69(), platypus::CharacterStateAlphabet::dna(), get_label, get_edge_length, 4, 1.0);
+    WriterType writer;
+    std::vector<std::string> outputs;
+    for (unsigned int num_threads : {1U, 3U}) {
+        std::ostringstream out;
+        unsigned long next_idx = 0;
+        simulator.simulate_batch(trees.begin(), trees.end(), 50, num_threads,
+                [&] (const platypus::NucleotideCharacterMatrix & matrix, unsigned long idx) {
+                    fails += platypus::testing::compare_equal(next_idx++, idx, __FILE__, __LINE__, "alignments out of order");
+                    writer.write(out, matrix);
+                },
+                12345);
+        outputs.push_back(out.str());
+    }
+    fails += platypus::testing::compare_equal(outputs[0], outputs[1], __FILE__, __LINE__, "output depends on number of threads");
+    fails += platypus::testing::compare_equal(static_cast<std::size_t>(40 * 5 * (3 + 51)), outputs[0].size(), __FILE__, __LINE__, "size of output");
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_writer();
+    fails += check_substitution_rates();
+    fails += check_batch();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <string>
+#include <vector>
+#include <platypus/parse/binary.hpp>
+#include "platypus_testing.hpp"
+
+// Smoke test of the sim-coalescent-trees example program, the path of which
+// is given as the only argument.
+
+using namespace platypus::test;
+
+// Runs the program with ``args``, returning its exit status and, in
+// ``output``, what it wrote to standard output.
+int run(const std::string & program, const std::string & args, std::string & output) {
+    output.clear();
+    std::string command = "\"" + program + "\" " + args;
+    FILE * pipe = popen(command.c_str(), "r");
+    if (!pipe) {
+        return -1;
+    }
+    char buffer[4096];
+    std::size_t num_read = 0;
+    while ((num_read = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, num_read);
+    }
+    int status = pclose(pipe);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+std::vector<std::string> get_lines(const std::string & output) {
+    return split(output, "\n", true, false);
+}
+
+// Trees that are not binary trees of ``num_leaves`` leaves.
+unsigned long count_bad_trees(std::vector<TestDataTree> & trees, unsigned long num_leaves) {
+    unsigned long num_bad_trees = 0;
+    for (auto & tree : trees) {
+        unsigned long num_tree_leaves = 0;
+        unsigned long num_bad_nodes = 0;
+        for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+            unsigned long num_children = 0;
+            for (auto chi = tree.children_begin(ndi); chi != tree.children_end(); ++chi) {
+                ++num_children;
+            }
+            num_tree_leaves += num_children == 0 ? 1 : 0;
+            num_bad_nodes += (num_children == 0 || num_children == 2) ? 0 : 1;
+        }
+        num_bad_trees += (num_tree_leaves != num_leaves || num_bad_nodes > 0) ? 1 : 0;
+    }
+    return num_bad_trees;
+}
+
+int main(int argc, const char * argv[]) {
+    if (argc != 2) {
+        return platypus::testing::fail_test(__FILE__, __LINE__, "path of sim-coalescent-trees", argc - 1, "arguments");
+    }
+    const std::string program = argv[1];
+    int fails = 0;
+
+    std::string output;
+    fails += platypus::testing::compare_equal(0, run(program, "-q -z 7 -t 25 8", output), __FILE__, __LINE__, "exit status");
+    auto trees = get_test_data_tree_vector_from_string<TestDataTree>(output);
+    fails += platypus::testing::compare_equal(25UL, static_cast<unsigned long>(trees.size()), __FILE__, __LINE__, "trees parsed");
+    fails += platypus::testing::compare_equal(0UL, count_bad_trees(trees, 8), __FILE__, __LINE__, "trees not binary on 8 leaves");
+    std::vector<std::string> lines = get_lines(output);
+    if (lines.size() != 25) {
+        return platypus::testing::fail_test(__FILE__, __LINE__, 25, lines.size(), "lines written");
+    }
+
+    // the trees depend on the seed and replicate, not on the threads
+    std::string threaded_output;
+    run(program, "-q -z 7 -t 25 -j 4 -b 3 8", threaded_output);
+    fails += platypus::testing::compare_equal(output, threaded_output, __FILE__, __LINE__, "trees depend on threads");
+    std::string split_output;
+    run(program, "-q -z 7 -s 10 -t 15 8", split_output);
+    fails += platypus::testing::compare_equal(std::vector<std::string>(lines.begin() + 10, lines.end()), get_lines(split_output),
+            __FILE__, __LINE__, "trees from first replicate");
+
+    // binary output, through a file
+    std::string ignored;
+    fails += platypus::testing::compare_equal(0, run(program, "-q -z 7 -t 25 -f binary -o sim_coalescent_trees.bin 8", ignored),
+            __FILE__, __LINE__, "exit status of binary output");
+    fails += platypus::testing::compare_equal(true, ignored.empty(), __FILE__, __LINE__, "standard output written with output file");
+    std::vector<TestDataTree> binary_trees;
+    platypus::BinaryTreeReader<TestDataTree> reader;
+    platypus::bind_standard_interface(reader);
+    fails += platypus::testing::compare_equal(25UL,
+            reader.read_file("sim_coalescent_trees.bin", [&binary_trees]() -> TestDataTree & { binary_trees.emplace_back(); return binary_trees.back(); }),
+            __FILE__, __LINE__, "binary trees read");
+    fails += platypus::testing::compare_equal(0UL, count_bad_trees(binary_trees, 8), __FILE__, __LINE__, "binary trees not binary on 8 leaves");
+
+    fails += platypus::testing::compare_equal(true, run(program, "-q", ignored) != 0, __FILE__, __LINE__, "missing number of tips not detected");
+    fails += platypus::testing::compare_equal(true, run(program, "-q -f nexml 8", ignored) != 0, __FILE__, __LINE__, "unknown format not detected");
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,245 @@
+#include <cmath>
+#include <map>
+#include <set>
+#include <sstream>
+#include <platypus/model/splitdistribution.hpp>
+#include <platypus/model/standardinterface.hpp>
+#include <platypus/parse/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+platypus::Split make_split(const std::string & bits) {
+    platypus::Split split(bits.size());
+    for (std::size_t i = 0; i < bits.size(); ++i) {
+        if (bits[i] == '1') {
+            split.set(i);
+        }
+    }
+    return split;
+}
+
+std::vector<std::string> non_trivial_splits(const TaxonTree & tree, std::size_t num_taxa, bool normalize) {
+    std::set<std::string> result;
+    platypus::SplitSet splits(tree,
+            num_taxa,
+            [] (const TaxonTree::value_type & nv) { return nv.get_taxon_index(); },
+            normalize);
+    for (std::size_t i = 0; i < splits.size(); ++i) {
+        if (!splits.is_trivial(i)) {
+            result.insert(splits.get_split(i).to_string());
+        }
+    }
+    return std::vector<std::string>(result.begin(), result.end());
+}
+
+int main () {
+    int fails = 0;
+
+    // rooted
+    {
+        std::ostringstream o;
+        o << "(a:1,((b:1,c:1):1,(d:1,e:1):1):1);\n"; // fixes taxon order
+        for (int i = 0; i < 6; ++i) {
+            o << "((a:1,b:1):" << i << ",(c:1,(d:1,e:1):" << (i + 1) << "):1);\n";
+        }
+        for (int i = 0; i < 3; ++i) {
+            o << "((a:1,c:1):1,(b:1,(d:1,e:1):" << (i + 1) << "):1);\n";
+        }
+        platypus::TaxonNamespace taxon_namespace;
+        auto trees = read_trees(o.str(), taxon_namespace);
+        platypus::SplitDistribution<> split_distribution(taxon_namespace);
+        split_distribution.add_trees(trees.begin(), trees.end());
+        fails += platypus::testing::compare_equal(10UL, split_distribution.num_trees(), __FILE__, __LINE__, "number of trees");
+        fails += platypus::testing::compare_equal(0.6, split_distribution.get_frequency(make_split("11000")), __FILE__, __LINE__, "frequency");
+        fails += platypus::testing::compare_equal(1.0, split_distribution.get_frequency(make_split("00011")), __FILE__, __LINE__, "frequency");
+        fails += platypus::testing::compare_equal(0.0, split_distribution.get_frequency(make_split("10011")), __FILE__, __LINE__, "frequency");
+        auto summary = split_distribution.get_edge_length_summary(make_split("00011"));
+        fails += platypus::testing::compare_equal(10.0, summary.size, __FILE__, __LINE__, "edge length summary");
+        fails += platypus::testing::compare_equal(true, std::abs((1.0 + 21.0 + 6.0) / 10.0 - summary.mean) < 1e-12, __FILE__, __LINE__, "edge length summary");
+
+        platypus::DataTable table;
+        split_distribution.summarize(table);
+        std::vector<std::string> splits;
+        std::vector<unsigned long> counts;
+        for (unsigned long r = 0; r < table.num_rows(); ++r) {
+            splits.push_back(table.get<std::string>(r, "split"));
+            counts.push_back(table.get<unsigned long>(r, "count"));
+        }
+        fails += platypus::testing::compare_equal(
+                std::vector<std::string>{"00011", "11000", "00111", "10100", "01011", "01100", "01111"},
+                splits,
+                __FILE__,
+                __LINE__,
+                "summary splits");
+        fails += platypus::testing::compare_equal(
+                std::vector<unsigned long>{10, 6, 6, 3, 3, 1, 1},
+                counts,
+                __FILE__,
+                __LINE__,
+                "summary counts");
+
+        TaxonTree consensus_tree;
+        split_distribution.build_consensus_tree(consensus_tree);
+        fails += platypus::testing::compare_equal(
+                std::vector<std::string>{"00011", "00111", "11000"},
+                non_trivial_splits(consensus_tree, taxon_namespace.size(), false),
+                __FILE__,
+                __LINE__,
+                "majority-rule consensus");
+        std::multiset<std::string> support_labels;
+        for (auto nd = consensus_tree.preorder_begin(); nd != consensus_tree.preorder_end(); ++nd) {
+            if (!nd.is_leaf() && nd.node() != consensus_tree.head_node()) {
+                support_labels.insert(nd->get_label());
+            } else if (nd.is_leaf() && nd->get_edge_length() != 1.0) {
+                ++fails;
+            }
+        }
+        fails += platypus::testing::compare_equal(
+                std::vector<std::string>{"0.6", "0.6", "1"},
+                std::vector<std::string>(support_labels.begin(), support_labels.end()),
+                __FILE__,
+                __LINE__,
+                "support labels");
+
+        // greedy consensus: all other splits conflict with those of the majority
+        split_distribution.build_consensus_tree(consensus_tree, 0.0);
+        fails += platypus::testing::compare_equal(
+                std::vector<std::string>{"00011", "00111", "11000"},
+                non_trivial_splits(consensus_tree, taxon_namespace.size(), false),
+                __FILE__,
+                __LINE__,
+                "greedy consensus");
+    }
+
+    // unrooted: basal bifurcations are not counted twice
+    {
+        platypus::TaxonNamespace taxon_namespace;
+        auto trees = read_trees("((a:1,b:1):1,(c:1,(d:1,e:1):1):2);\n(a:1,b:1,(c:1,(d:1,e:1):1):4);\n(a:1,(b:1,c:1):1,(d:1,e:1):1);", taxon_namespace);
+        platypus::SplitDistribution<> split_distribution(taxon_namespace, false);
+        for (auto & tree : trees) {
+            split_distribution.add_tree(tree);
+        }
+        fails += platypus::testing::compare_equal(2UL, split_distribution.get_count(make_split("11000")), __FILE__, __LINE__, "bipartition count");
+        fails += platypus::testing::compare_equal(2UL, split_distribution.get_count(make_split("00111")), __FILE__, __LINE__, "bipartition count");
+        fails += platypus::testing::compare_equal(3.5, split_distribution.get_edge_length_summary(make_split("00111")).mean, __FILE__, __LINE__, "bipartition edge length");
+        fails += platypus::testing::compare_equal(3UL, split_distribution.get_count(make_split("00011")), __FILE__, __LINE__, "bipartition count");
+        TaxonTree consensus_tree;
+        split_distribution.build_consensus_tree(consensus_tree);
+        fails += platypus::testing::compare_equal(
+                std::vector<std::string>{"00011", "00111"},
+                non_trivial_splits(consensus_tree, taxon_namespace.size(), true),
+                __FILE__,
+                __LINE__,
+                "unrooted consensus");
+    }
+
+    // parallel accumulation
+    {
+        std::ostringstream o;
+        for (int i = 0; i < 200; ++i) {
+            int p = (i * 7) % 5;
+            o << "((t" << p << ":" << i << ",t" << ((p + 1) % 5) << "),(t" << ((p + 2) % 5) << ",(t" << ((p + 3) % 5) << ",(t" << ((p + 4) % 5) << ",t" << (5 + i % 3) << "))));\n";
+        }
+        platypus::TaxonNamespace taxon_namespace;
+        auto trees = read_trees(o.str(), taxon_namespace);
+        platypus::SplitDistribution<> serial(taxon_namespace);
+        serial.add_trees(trees.begin(), trees.end(), 1);
+        platypus::SplitDistribution<> parallel(taxon_namespace);
+        parallel.add_trees(trees.begin(), trees.end(), 4);
+        platypus::DataTable serial_table;
+        serial.summarize(serial_table, true);
+        platypus::DataTable parallel_table;
+        parallel.summarize(parallel_table, true);
+        fails += platypus::testing::compare_equal(serial_table.num_rows(), parallel_table.num_rows(), __FILE__, __LINE__, "parallel summary");
+        unsigned long num_mismatches = 0;
+        for (unsigned long r = 0; r < serial_table.num_rows() && r < parallel_table.num_rows(); ++r) {
+            if (serial_table.get<std::string>(r, "split") != parallel_table.get<std::string>(r, "split")
+                    || serial_table.get<unsigned long>(r, "count") != parallel_table.get<unsigned long>(r, "count")
+                    || std::abs(serial_table.get<double>(r, "mean_edge_length") - parallel_table.get<double>(r, "mean_edge_length")) > 1e-9) {
+                ++num_mismatches;
+            }
+        }
+        fails += platypus::testing::compare_equal(0UL, num_mismatches, __FILE__, __LINE__, "parallel summary");
+    }
+
+    // maximum clade credibility tree, annotated with mean node heights
+    {
+        platypus::TaxonNamespace taxon_namespace;
+        auto trees = read_trees(
+                "((a:1,b:1):1,(c:0.5,d:0.5):1.5);\n"
+                "((a:2,b:2):1,(c:1,d:1):2);\n"
+                "((a:1,c:1):1,(b:1,d:1):1);", taxon_namespace);
+        platypus::SplitDistribution<> split_distribution(taxon_namespace);
+        split_distribution.add_trees(trees.begin(), trees.end());
+        std::vector<double> scores = split_distribution.score_trees(trees.begin(), trees.end(), 2);
+        fails += platypus::testing::compare_equal(3UL, static_cast<unsigned long>(scores.size()), __FILE__, __LINE__, "scores");
+        if (scores.size() == 3) {
+            fails += platypus::testing::compare_equal(true, std::fabs(scores[0] - 2 * std::log(2.0 / 3.0)) < 1e-12, __FILE__, __LINE__, "log clade credibility");
+            fails += platypus::testing::compare_equal(true, scores[0] == scores[1], __FILE__, __LINE__, "log clade credibility");
+            fails += platypus::testing::compare_equal(true, std::fabs(scores[2] - 2 * std::log(1.0 / 3.0)) < 1e-12, __FILE__, __LINE__, "log clade credibility");
+        }
+        fails += platypus::testing::compare_equal(0UL, static_cast<unsigned long>(split_distribution.find_mcc_tree(trees.begin(), trees.end())),
+                __FILE__, __LINE__, "MCC tree");
+        auto unseen = read_trees("((a:1,d:1):1,(b:1,c:1):1);", taxon_namespace);
+        fails += platypus::testing::compare_equal(true, std::isinf(split_distribution.get_log_clade_credibility(unseen[0])), __FILE__, __LINE__, "unseen clade");
+
+        TaxonTree & mcc_tree = trees[0];
+        split_distribution.annotate_tree(mcc_tree);
+        std::map<std::string, double> edge_lengths;
+        std::set<std::string> labels;
+        for (auto nd = mcc_tree.preorder_begin(); nd != mcc_tree.preorder_end(); ++nd) {
+            if (nd.is_leaf()) {
+                edge_lengths[taxon_namespace.get_label(nd->get_taxon_index())] = nd->get_edge_length();
+            } else if (nd.node() != mcc_tree.head_node()) {
+                labels.insert(nd->get_label());
+                edge_lengths[std::to_string(nd.node()->num_child_nodes()) + taxon_namespace.get_label(nd.node()->first_child_node()->value().get_taxon_index())]
+                    = nd->get_edge_length();
+            }
+        }
+        fails += platypus::testing::compare_equal(std::vector<std::string>{"0.666667"}, std::vector<std::string>(labels.begin(), labels.end()), __FILE__, __LINE__, "clade credibility labels");
+        // mean heights: ab, 1.5; cd, 0.75; root, 7/3
+        fails += platypus::testing::compare_equal(true, std::fabs(edge_lengths["a"] - 1.5) < 1e-12, __FILE__, __LINE__, "leaf edge length");
+        fails += platypus::testing::compare_equal(true, std::fabs(edge_lengths["c"] - 0.75) < 1e-12, __FILE__, __LINE__, "leaf edge length");
+        fails += platypus::testing::compare_equal(true, std::fabs(edge_lengths["2a"] - (7.0 / 3.0 - 1.5)) < 1e-12, __FILE__, __LINE__, "clade edge length");
+        fails += platypus::testing::compare_equal(true, std::fabs(edge_lengths["2c"] - (7.0 / 3.0 - 0.75)) < 1e-12, __FILE__, __LINE__, "clade edge length");
+    }
+
+    // unrooted maximum clade credibility tree, annotated with mean edge
+    // lengths: the basal edges are one, and its length is not doubled
+    {
+        platypus::TaxonNamespace taxon_namespace;
+        auto trees = read_trees(
+                "((a:1,b:1):1,(c:1,d:1):2);\n"
+                "((a:1,b:1):1,(c:1,d:1):2);", taxon_namespace);
+        platypus::SplitDistribution<> split_distribution(taxon_namespace, false);
+        split_distribution.add_trees(trees.begin(), trees.end());
+        TaxonTree & mcc_tree = trees[split_distribution.find_mcc_tree(trees.begin(), trees.end())];
+        split_distribution.annotate_tree(mcc_tree);
+        std::vector<double> basal_edge_lengths;
+        for (auto nd = mcc_tree.children_begin(); nd != mcc_tree.children_end(); ++nd) {
+            basal_edge_lengths.push_back(nd->get_edge_length());
+        }
+        fails += platypus::testing::compare_equal(std::vector<double>{1, 2}, basal_edge_lengths, __FILE__, __LINE__, "basal edge lengths");
+        double length = 0.0;
+        for (auto nd = mcc_tree.preorder_begin(); nd != mcc_tree.preorder_end(); ++nd) {
+            length += nd->get_edge_length();
+        }
+        fails += platypus::testing::compare_equal(7.0, length, __FILE__, __LINE__, "tree length");
+
+        // all on the first basal edge, if both are of zero length
+        auto zero_basal = read_trees("((a:1,b:1):0,(c:1,d:1):0);", taxon_namespace);
+        split_distribution.annotate_tree(zero_basal[0]);
+        basal_edge_lengths.clear();
+        for (auto nd = zero_basal[0].children_begin(); nd != zero_basal[0].children_end(); ++nd) {
+            basal_edge_lengths.push_back(nd->get_edge_length());
+        }
+        fails += platypus::testing::compare_equal(std::vector<double>{3, 0}, basal_edge_lengths, __FILE__, __LINE__, "zero-length basal edges");
+    }
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
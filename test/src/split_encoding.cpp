@@ -0,0 +1,149 @@
+#include <set>
+#include <sstream>
+#include <unordered_set>
+#include <platypus/model/split.hpp>
+#include <platypus/model/standardinterface.hpp>
+#include <platypus/parse/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+std::vector<std::string> split_strings(const platypus::SplitSet & splits, bool non_trivial_only=false) {
+    std::vector<std::string> result;
+    for (std::size_t i = 0; i < splits.size(); ++i) {
+        if (!non_trivial_only || !splits.is_trivial(i)) {
+            result.push_back(splits.get_split(i).to_string());
+        }
+    }
+    return result;
+}
+
+int main () {
+    int fails = 0;
+
+    // small tree (bitmasks stored inline)
+    {
+        platypus::TaxonNamespace taxon_namespace;
+        auto trees = read_trees("((a,b),(c,(d,e)));\n((d,e),((b,a),c));", taxon_namespace);
+        platypus::SplitSet splits(trees[0], taxon_namespace);
+        std::vector<std::string> expected{"10000", "01000", "11000", "00100", "00010", "00001", "00011", "00111", "11111"};
+        fails += platypus::testing::compare_equal(expected, split_strings(splits), __FILE__, __LINE__, "rooted splits");
+        std::vector<bool> is_leaf;
+        for (std::size_t i = 0; i < splits.size(); ++i) {
+            is_leaf.push_back(splits.is_leaf(i));
+        }
+        fails += platypus::testing::compare_equal(
+                std::vector<bool>{true, true, false, true, true, true, false, false, false},
+                is_leaf,
+                __FILE__,
+                __LINE__,
+                "leaf splits");
+        std::vector<std::string> expected_non_trivial{"11000", "00011", "00111"};
+        fails += platypus::testing::compare_equal(expected_non_trivial, split_strings(splits, true), __FILE__, __LINE__, "non-trivial splits");
+
+        // normalized: same (non-trivial) bipartitions for both trees
+        splits.assign(trees[0], taxon_namespace, true);
+        std::set<std::string> splits1;
+        for (auto & s : split_strings(splits, true)) {
+            splits1.insert(s);
+        }
+        splits.assign(trees[1], taxon_namespace, true);
+        std::set<std::string> splits2;
+        for (auto & s : split_strings(splits, true)) {
+            splits2.insert(s);
+        }
+        fails += platypus::testing::compare_equal(
+                std::vector<std::string>(splits1.begin(), splits1.end()),
+                std::vector<std::string>(splits2.begin(), splits2.end()),
+                __FILE__,
+                __LINE__,
+                "normalized splits");
+        fails += platypus::testing::compare_equal(
+                std::vector<std::string>{"00011", "00111"},
+                std::vector<std::string>(splits1.begin(), splits1.end()),
+                __FILE__,
+                __LINE__,
+                "normalized splits");
+    }
+
+    // large tree (bitmasks allocated): caterpillar on 300 taxa
+    {
+        const int num_taxa = 300;
+        std::ostringstream o;
+        for (int i = 1; i < num_taxa; ++i) {
+            o << "(";
+        }
+        o << "t0";
+        for (int i = 1; i < num_taxa; ++i) {
+            o << ",t" << i << ")";
+        }
+        o << ";";
+        platypus::TaxonNamespace taxon_namespace;
+        auto trees = read_trees(o.str(), taxon_namespace);
+        platypus::SplitSet splits(trees[0], taxon_namespace);
+        fails += platypus::testing::compare_equal(
+                static_cast<unsigned long>(2 * num_taxa - 1),
+                static_cast<unsigned long>(splits.size()),
+                __FILE__,
+                __LINE__,
+                "number of splits");
+        // internal split ``k`` holds taxa t0 ... t(k+1)
+        unsigned long num_errors = 0;
+        std::size_t k = 0;
+        for (std::size_t i = 0; i < splits.size(); ++i) {
+            if (splits.is_leaf(i)) {
+                continue;
+            }
+            platypus::Split split = splits.get_split(i);
+            if (split.count() != k + 2 || !split.test(k + 1) || (k + 2 < static_cast<std::size_t>(num_taxa) && split.test(k + 2))) {
+                ++num_errors;
+            }
+            ++k;
+        }
+        fails += platypus::testing::compare_equal(0UL, num_errors, __FILE__, __LINE__, "caterpillar splits");
+
+        // hashing and set operations
+        std::unordered_set<platypus::Split> split_hash_set;
+        for (std::size_t i = 0; i < splits.size(); ++i) {
+            split_hash_set.insert(splits.get_split(i));
+            split_hash_set.insert(splits.get_split(i));
+        }
+        fails += platypus::testing::compare_equal(
+                static_cast<unsigned long>(splits.size()),
+                static_cast<unsigned long>(split_hash_set.size()),
+                __FILE__,
+                __LINE__,
+                "distinct splits");
+        platypus::Split root = splits.get_split(splits.size() - 1);
+        platypus::Split s1 = splits.get_split(splits.size() - 2);
+        fails += platypus::testing::compare_equal(true, s1.is_subset_of(root), __FILE__, __LINE__, "subset");
+        platypus::Split s2 = s1;
+        s2.complement();
+        fails += platypus::testing::compare_equal(true, s2.is_disjoint_from(s1), __FILE__, __LINE__, "complement disjoint");
+        s2 |= s1;
+        fails += platypus::testing::compare_equal(true, s2 == root, __FILE__, __LINE__, "complement union");
+        platypus::Split s3(std::move(s2));
+        fails += platypus::testing::compare_equal(true, s3 == root, __FILE__, __LINE__, "moved split");
+        s3.normalize();
+        fails += platypus::testing::compare_equal(0UL, static_cast<unsigned long>(s3.count()), __FILE__, __LINE__, "normalized root split");
+    }
+
+    // leaf without a taxon
+    {
+        platypus::TaxonNamespace taxon_namespace;
+        auto trees = read_trees("((a,b),(,c));", taxon_namespace);
+        bool thrown = false;
+        try {
+            platypus::SplitSet splits(trees[0], taxon_namespace);
+        } catch (const platypus::SplitError &) {
+            thrown = true;
+        }
+        fails += platypus::testing::compare_equal(true, thrown, __FILE__, __LINE__, "leaf without taxon");
+    }
+
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include <memory>
+#include <vector>
+#include <type_traits>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+static unsigned long NUM_NODE_ALLOCATIONS = 0;
+
+template <class T>
+class CountingAllocator : public std::allocator<T> {
+    public:
+        template <class U> struct rebind {
+            typedef CountingAllocator<U> other;
+        };
+        CountingAllocator() { }
+        CountingAllocator(const CountingAllocator & other)
+            : std::allocator<T>(other) { }
+        CountingAllocator & operator=(const CountingAllocator &) = default;
+        template <class U> CountingAllocator(const CountingAllocator<U> & other)
+            : std::allocator<T>(other) { }
+        T * allocate(std::size_t n, const void * =0) {
+            NUM_NODE_ALLOCATIONS += n;
+            return std::allocator<T>::allocate(n);
+        }
+}; // CountingAllocator
+
+typedef TestData NodeValueType;
+typedef platypus::StandardTree<NodeValueType, CountingAllocator<platypus::TreeNode<NodeValueType>>> TreeType;
+
+int main() {
+
+    int fails = 0;
+
+    fails += platypus::testing::compare_equal(
+            true,
+            std::is_nothrow_move_constructible<TreeType>::value,
+            __FILE__,
+            __LINE__,
+            "StandardTree is not nothrow-move-constructible");
+    fails += platypus::testing::compare_equal(
+            true,
+            std::is_nothrow_move_assignable<TreeType>::value,
+            __FILE__,
+            __LINE__,
+            "StandardTree is not nothrow-move-assignable");
+
+    // move construction
+    TreeType tree1(true);
+    build_tree(tree1, STANDARD_TEST_TREE_STRING);
+    unsigned long num_allocations = NUM_NODE_ALLOCATIONS;
+    TreeType tree2(std::move(tree1));
+    fails += platypus::testing::compare_equal(
+            num_allocations,
+            NUM_NODE_ALLOCATIONS,
+            __FILE__,
+            __LINE__,
+            "nodes allocated on move construction");
+    fails += platypus::testing::compare_equal(
+            true,
+            tree2.is_rooted(),
+            __FILE__,
+            __LINE__,
+            "rooting state not carried over on move construction");
+    fails += compare_against_standard_test_tree(tree2);
+
+    // move assignment
+    TreeType tree3;
+    build_tree(tree3, STANDARD_TEST_TREE_STRING);
+    num_allocations = NUM_NODE_ALLOCATIONS;
+    tree3 = std::move(tree2);
+    fails += platypus::testing::compare_equal(
+            num_allocations,
+            NUM_NODE_ALLOCATIONS,
+            __FILE__,
+            __LINE__,
+            "nodes allocated on move assignment");
+    fails += platypus::testing::compare_equal(
+            true,
+            tree3.is_rooted(),
+            __FILE__,
+            __LINE__,
+            "rooting state not carried over on move assignment");
+    fails += compare_against_standard_test_tree(tree3);
+
+    // moved-from tree can be reused after clearing
+    tree1.clear();
+    build_tree(tree1, STANDARD_TEST_TREE_STRING);
+    fails += compare_against_standard_test_tree(tree1);
+
+    // vector growth moves rather than copies
+    std::vector<TreeType> trees;
+    trees.emplace_back();
+    build_tree(trees.back(), STANDARD_TEST_TREE_STRING);
+    for (int i = 0; i < 100; ++i) {
+        trees.emplace_back();
+        build_tree(trees.back(), STANDARD_TEST_TREE_STRING);
+    }
+    num_allocations = NUM_NODE_ALLOCATIONS;
+    trees.reserve(trees.capacity() * 2);
+    fails += platypus::testing::compare_equal(
+            num_allocations,
+            NUM_NODE_ALLOCATIONS,
+            __FILE__,
+            __LINE__,
+            "nodes allocated on vector reallocation");
+    for (auto & tree : trees) {
+        fails += compare_against_standard_test_tree(tree);
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
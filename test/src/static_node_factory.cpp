@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include <sstream>
+#include <vector>
+#include <platypus/model/staticnodefactory.hpp>
+#include <platypus/model/treenodearena.hpp>
+#include <platypus/parse/newick.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+static unsigned long NUM_NODES_CREATED = 0;
+static unsigned long NUM_LEAF_NODES_CREATED = 0;
+static unsigned long NUM_INTERNAL_NODES_CREATED = 0;
+static unsigned long NUM_NODES_DISPOSED = 0;
+
+struct CountingNodeFactory {
+    template <class TreeT>
+    static inline typename TreeT::node_type * create_node(TreeT & tree) {
+        ++NUM_NODES_CREATED;
+        return tree.new_node();
+    }
+    template <class TreeT>
+    static inline typename TreeT::node_type * create_node(TreeT & tree, const typename TreeT::value_type & value) {
+        ++NUM_NODES_CREATED;
+        return tree.new_node(value);
+    }
+    template <class TreeT>
+    static inline typename TreeT::node_type * create_leaf_node(TreeT & tree) {
+        ++NUM_LEAF_NODES_CREATED;
+        return tree.new_node();
+    }
+    template <class TreeT>
+    static inline typename TreeT::node_type * create_leaf_node(TreeT & tree, const typename TreeT::value_type & value) {
+        ++NUM_LEAF_NODES_CREATED;
+        return tree.new_node(value);
+    }
+    template <class TreeT>
+    static inline typename TreeT::node_type * create_internal_node(TreeT & tree) {
+        ++NUM_INTERNAL_NODES_CREATED;
+        return tree.new_node();
+    }
+    template <class TreeT>
+    static inline typename TreeT::node_type * create_internal_node(TreeT & tree, const typename TreeT::value_type & value) {
+        ++NUM_INTERNAL_NODES_CREATED;
+        return tree.new_node(value);
+    }
+    template <class TreeT>
+    static inline void dispose_node(TreeT & tree, typename TreeT::node_type * nd) {
+        ++NUM_NODES_DISPOSED;
+        tree.delete_node(nd);
+    }
+};
+
+typedef platypus::StaticNodeFactoryTree<TestDataTree, CountingNodeFactory> CountingTree;
+typedef platypus::StandardTree<TestData, platypus::TreeNodeArena<platypus::TreeNode<TestData>>> ArenaTree;
+typedef platypus::StaticNodeFactoryTree<ArenaTree> StaticArenaTree;
+
+template <class TreeT>
+std::vector<std::string> read_and_write(const std::string & src) {
+    auto tree_reader = get_test_data_tree_newick_reader<TreeT>();
+    auto writer = get_standard_newick_writer<TreeT>();
+    std::vector<std::string> results;
+    tree_reader.read_each(std::istringstream(src), [&](TreeT & tree, unsigned long) {
+        std::ostringstream o;
+        writer.write(o, tree);
+        results.push_back(o.str());
+    });
+    return results;
+}
+
+int main() {
+
+    int fails = 0;
+
+    // calls through the derived type go to the policy
+    CountingTree tree;
+    build_tree(tree, STANDARD_TEST_TREE_STRING);
+    fails += compare_against_standard_test_tree(tree);
+    // 14 nodes in the standard test tree, apart from the root
+    fails += platypus::testing::compare_equal(
+            14UL,
+            NUM_NODES_CREATED,
+            __FILE__,
+            __LINE__,
+            "nodes not created through policy");
+
+    // as do (virtual) calls through the base type
+    TestDataTree & base_tree = tree;
+    unsigned long num_leaf_nodes_created = NUM_LEAF_NODES_CREATED;
+    auto nd = base_tree.create_leaf_node();
+    base_tree.dispose_node(nd);
+    fails += platypus::testing::compare_equal(
+            num_leaf_nodes_created + 1,
+            NUM_LEAF_NODES_CREATED,
+            __FILE__,
+            __LINE__,
+            "node not created through policy from base");
+    fails += platypus::testing::compare_equal(
+            1UL,
+            NUM_NODES_DISPOSED,
+            __FILE__,
+            __LINE__,
+            "node not disposed of through policy from base");
+
+    // copies and derived state
+    tree.set_is_rooted(false);
+    CountingTree tree_copy(tree);
+    fails += compare_against_standard_test_tree(tree_copy);
+    fails += platypus::testing::compare_equal(false, tree_copy.is_rooted(), __FILE__, __LINE__);
+    CountingTree tree_moved(std::move(tree_copy));
+    fails += compare_against_standard_test_tree(tree_moved);
+
+    // parsing
+    std::ostringstream o;
+    for (int i = 0; i < 20; ++i) {
+        o << "((a" << i << ":1, b:2)c:3, (d:4, (e:5, f:" << i << ")g:6)h:7)i;\n";
+    }
+    NUM_LEAF_NODES_CREATED = 0;
+    NUM_INTERNAL_NODES_CREATED = 0;
+    auto expected = read_and_write<TestDataTree>(o.str());
+    fails += platypus::testing::compare_equal(expected, read_and_write<CountingTree>(o.str()), __FILE__, __LINE__);
+    // five leaves per tree; three internal nodes, plus the head and stop
+    // nodes created when the tree is cleared for each tree
+    fails += platypus::testing::compare_equal(5UL * 20, NUM_LEAF_NODES_CREATED, __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(5UL * 20, NUM_INTERNAL_NODES_CREATED, __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(
+            read_and_write<ArenaTree>(o.str()),
+            read_and_write<StaticArenaTree>(o.str()),
+            __FILE__,
+            __LINE__);
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,187 @@
+#include <stdlib.h>
+#include <cmath>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <platypus/model/tipsubsampler.hpp>
+#include <platypus/model/treepattern.hpp>
+#include <platypus/numeric/rng.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree TreeType;
+typedef platypus::TipSubsampler<TreeType> SubsamplerType;
+
+// length of the edges of all nodes but the head node
+double get_tree_length(const TreeType & tree) {
+    double length = 0.0;
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        if (ndi.node() != tree.head_node()) {
+            length += ndi->get_edge_length();
+        }
+    }
+    return length;
+}
+
+// total length of the paths from the leaves of ``subset`` to the root, by
+// walking each of them
+double naive_phylogenetic_diversity(const SubsamplerType & subsampler, const std::vector<std::size_t> & subset) {
+    std::set<const TreeType::node_type *> edges;
+    for (auto leaf_idx : subset) {
+        for (auto nd = subsampler.leaves()[leaf_idx]; nd->parent_node() != nullptr; nd = nd->parent_node()) {
+            edges.insert(nd);
+        }
+    }
+    double length = 0.0;
+    for (auto nd : edges) {
+        length += nd->value().get_edge_length();
+    }
+    return length;
+}
+
+int check_single_tree() {
+    int fails = 0;
+    TreeType tree = read_tree("((t0:1,t1:2):3,(t2:4,t3:5):6);");
+    SubsamplerType subsampler(tree, get_edge_length);
+    fails += platypus::testing::compare_equal(4UL, static_cast<unsigned long>(subsampler.num_leaves()), __FILE__, __LINE__, "leaves");
+    auto values = subsampler.compute({0, 1});
+    fails += platypus::testing::compare_equal(6.0, values.phylogenetic_diversity, __FILE__, __LINE__, "phylogenetic diversity of sister leaves");
+    fails += platypus::testing::compare_equal(3.0, values.tree_length, __FILE__, __LINE__, "tree length of sister leaves");
+    values = subsampler.compute({2, 0});
+    fails += platypus::testing::compare_equal(14.0, values.phylogenetic_diversity, __FILE__, __LINE__, "phylogenetic diversity across the root");
+    fails += platypus::testing::compare_equal(14.0, values.tree_length, __FILE__, __LINE__, "tree length across the root");
+    values = subsampler.compute({0, 1, 2, 3});
+    fails += platypus::testing::compare_equal(21.0, values.phylogenetic_diversity, __FILE__, __LINE__, "phylogenetic diversity of all leaves");
+    fails += platypus::testing::compare_equal(21.0, values.tree_length, __FILE__, __LINE__, "tree length of all leaves");
+    values = subsampler.compute({3});
+    fails += platypus::testing::compare_equal(11.0, values.phylogenetic_diversity, __FILE__, __LINE__, "phylogenetic diversity of a single leaf");
+    fails += platypus::testing::compare_equal(0.0, values.tree_length, __FILE__, __LINE__, "tree length of a single leaf");
+
+    TreeType subtree;
+    fails += platypus::testing::compare_equal(2UL, subsampler.extract({1, 2}, subtree, get_taxon_index, copy_value, set_edge_length), __FILE__, __LINE__, "leaves extracted");
+    fails += platypus::testing::compare_equal(15.0, get_tree_length(subtree), __FILE__, __LINE__, "length of extracted tree");
+
+    platypus::numeric::RandomNumberGenerator rng(3);
+    std::vector<std::size_t> subset;
+    bool caught = false;
+    try {
+        subsampler.draw(5, rng, subset);
+    } catch (const std::invalid_argument &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "subset larger than tree not detected");
+    return fails;
+}
+
+int check_random_trees() {
+    int fails = 0;
+    platypus::numeric::RandomNumberGenerator rng(5);
+    const unsigned long num_leaves = 60;
+    std::vector<TestData> leaves;
+    for (unsigned long leaf = 0; leaf < num_leaves; ++leaf) {
+        leaves.emplace_back("t" + std::to_string(leaf));
+    }
+    TreeType tree;
+    platypus::build_uniform_random_tree(tree, leaves.begin(), leaves.end(), rng);
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        ndi->set_edge_length(static_cast<double>(rng.uniform_int(1, 9)));
+    }
+    SubsamplerType subsampler(tree, get_edge_length);
+
+    // subsets are of distinct leaves, each drawn with probability k / n
+    {
+        const unsigned long k = 15;
+        const unsigned long num_draws = 20000;
+        std::vector<unsigned long> times_drawn(num_leaves, 0);
+        std::vector<std::size_t> subset;
+        unsigned long num_bad_subsets = 0;
+        for (unsigned long draw_idx = 0; draw_idx < num_draws; ++draw_idx) {
+            subsampler.draw(k, rng, subset);
+            std::set<std::size_t> distinct(subset.begin(), subset.end());
+            num_bad_subsets += (distinct.size() != k || *distinct.rbegin() >= num_leaves) ? 1 : 0;
+            for (auto leaf_idx : subset) {
+                ++times_drawn[leaf_idx];
+            }
+        }
+        fails += platypus::testing::compare_equal(0UL, num_bad_subsets, __FILE__, __LINE__, "subsets not of k distinct leaves");
+        // expected 5000 draws of each leaf, with a standard deviation of about 61
+        for (unsigned long leaf_idx = 0; leaf_idx < num_leaves; ++leaf_idx) {
+            if (times_drawn[leaf_idx] < 4600 || times_drawn[leaf_idx] > 5400) {
+                fails += platypus::testing::fail_test(__FILE__, __LINE__, 5000, times_drawn[leaf_idx], "draws of leaf ", leaf_idx);
+            }
+        }
+    }
+
+    // statistics against those of the extracted subtrees, and of the paths to the root
+    {
+        std::vector<std::size_t> subset;
+        TreeType subtree;
+        for (unsigned long k = 2; k <= num_leaves; k += 3) {
+            subsampler.draw(k, rng, subset);
+            auto values = subsampler.compute(subset);
+            subsampler.extract(subset, subtree, get_taxon_index, copy_value, set_edge_length);
+            fails += platypus::testing::compare_equal(get_tree_length(subtree), values.tree_length, __FILE__, __LINE__, "tree length of subset of ", k);
+            fails += platypus::testing::compare_equal(naive_phylogenetic_diversity(subsampler, subset), values.phylogenetic_diversity, __FILE__, __LINE__,
+                    "phylogenetic diversity of subset of ", k);
+        }
+    }
+
+    // batches
+    {
+        const unsigned long k = 20;
+        const unsigned long num_subsamples = 500;
+        auto expected = subsampler.compute_subsamples(k, num_subsamples, 77);
+        std::vector<double> expected_lengths;
+        for (auto & v : expected) {
+            expected_lengths.push_back(v.tree_length);
+        }
+        for (unsigned int num_threads : {3U, 8U}) {
+            auto values = subsampler.compute_subsamples(k, num_subsamples, 77, num_threads);
+            unsigned long num_different = 0;
+            for (unsigned long idx = 0; idx < num_subsamples; ++idx) {
+                num_different += (values[idx].tree_length != expected[idx].tree_length
+                        || values[idx].phylogenetic_diversity != expected[idx].phylogenetic_diversity) ? 1 : 0;
+            }
+            fails += platypus::testing::compare_equal(0UL, num_different, __FILE__, __LINE__, "subsamples depend on threads: ", num_threads);
+        }
+        std::vector<TreeType> subtrees(num_subsamples);
+        subsampler.extract_subsamples(k, num_subsamples, 77, subtrees.begin(), get_taxon_index, copy_value, set_edge_length, 4);
+        std::vector<double> lengths;
+        for (auto & subtree : subtrees) {
+            lengths.push_back(get_tree_length(subtree));
+        }
+        fails += platypus::testing::compare_equal(expected_lengths, lengths, __FILE__, __LINE__, "lengths of extracted subsamples");
+    }
+
+    // rarefaction
+    {
+        platypus::DataTable table;
+        std::vector<unsigned long> sizes{1, 10, 30, num_leaves};
+        subsampler.export_rarefaction(table, sizes, 200, 13, 4);
+        fails += platypus::testing::compare_equal(sizes, table.get_column<unsigned long>("num_leaves"), __FILE__, __LINE__, "rarefaction sizes");
+        auto means = table.get_column<double>("phylogenetic_diversity_mean");
+        for (std::size_t idx = 1; idx < means.size(); ++idx) {
+            fails += platypus::testing::compare_equal(true, means[idx] > means[idx - 1], __FILE__, __LINE__, "rarefaction curve not increasing at ", idx);
+        }
+        double full_length = get_tree_length(tree);
+        fails += platypus::testing::compare_equal(full_length, means.back(), __FILE__, __LINE__, "phylogenetic diversity of all leaves");
+        fails += platypus::testing::compare_equal(full_length, table.get_column<double>("tree_length_max").back(), __FILE__, __LINE__, "tree length of all leaves");
+        fails += platypus::testing::compare_equal(0.0, table.get_column<double>("phylogenetic_diversity_variance").back(), __FILE__, __LINE__, "variance with all leaves");
+        fails += platypus::testing::compare_equal(0.0, table.get_column<double>("tree_length_mean").front(), __FILE__, __LINE__, "tree length of single leaves");
+    }
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_single_tree();
+    fails += check_random_trees();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,111 @@
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <iterator>
+#include <map>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+int main() {
+    std::vector<std::string> sources{
+        "the quick brown fox jumps over the lazy dog",
+        "  \t  the quick\n brown fox jumps \r\n over the lazy dog  ",
+        "the quick 'brown fox''s friend' jumps over the 'lazy dog''s colleague'",
+        "the 'quick' \"brown\" '' fox",
+        "((a,b)c,(d,e)f)g;",
+        "([the quick]apple[brown],([fox]banjo,([jumps]cucumber[over the],[really]dogwood)[lazy]eggplant)) rhubarb[dog];",
+        "ap[a comment]ple ba[x]na[y]na [z](",
+        "nested [a [b] c] comments",
+        "",
+        "   ",
+        "[only a comment]",
+    };
+    platypus::Tokenizer tokenizer = get_nexus_tokenizer();
+    platypus::NexusBufferTokenizer buffer_tokenizer;
+    int fail = 0;
+    for (auto & str : sources) {
+        std::vector<std::string> expected;
+        std::vector<std::vector<std::string>> expected_comments;
+        for (auto iter = tokenizer.begin(str); iter != tokenizer.end(); ++iter) {
+            expected.push_back(*iter);
+            expected_comments.push_back(iter.captured_comments());
+            iter.clear_captured_comments();
+        }
+        std::vector<std::string> observed;
+        std::vector<std::vector<std::string>> observed_comments;
+        for (auto iter = buffer_tokenizer.begin(str); iter != buffer_tokenizer.end(); ++iter) {
+            observed.push_back(iter->str());
+            observed_comments.push_back(iter.captured_comments());
+            iter.clear_captured_comments();
+        }
+        fail += compare_token_vectors(expected, observed, __FILE__, __LINE__);
+        fail += platypus::testing::compare_equal(expected_comments.size(), observed_comments.size(), __FILE__, __LINE__, "Source: ", str);
+        for (unsigned long idx = 0; idx < expected_comments.size() && idx < observed_comments.size(); ++idx) {
+            fail += platypus::testing::compare_equal(expected_comments[idx], observed_comments[idx], __FILE__, __LINE__, "Source: ", str);
+        }
+    }
+
+    // unescaped tokens are views into the source
+    std::string src = "apple 'banana' 'cherry''s'";
+    auto iter = buffer_tokenizer.begin(src);
+    fail += platypus::testing::compare_equal(true, iter->data() == src.data(), __FILE__, __LINE__, "Token not a view into the source");
+    ++iter;
+    fail += platypus::testing::compare_equal(true, iter.token_is_quoted(), __FILE__, __LINE__, "Token not flagged as quoted");
+    fail += platypus::testing::compare_equal(true, iter->data() == src.data() + 7, __FILE__, __LINE__, "Quoted token not a view into the source");
+    ++iter;
+    fail += platypus::testing::compare_equal(std::string("cherry's"), iter->str(), __FILE__, __LINE__, "Escaped quote not unescaped");
+    auto iter_copy = iter;
+    ++iter;
+    fail += platypus::testing::compare_equal(std::string("cherry's"), iter_copy->str(), __FILE__, __LINE__, "Copied iterator token invalidated");
+    fail += platypus::testing::compare_equal(true, iter == buffer_tokenizer.end(), __FILE__, __LINE__, "Iterator not at end");
+
+    // comments are captured as views into the source
+    std::string commented = "apple[&rate=1.5][a [nested] one],banana";
+    iter = buffer_tokenizer.begin(commented);
+    fail += platypus::testing::compare_equal(2UL, static_cast<unsigned long>(iter.captured_comment_views().size()), __FILE__, __LINE__, "Comment views not captured");
+    if (iter.captured_comment_views().size() == 2) {
+        fail += platypus::testing::compare_equal(true, iter.captured_comment_views()[0].data() == commented.data() + 6, __FILE__, __LINE__, "Comment not a view into the source");
+        fail += platypus::testing::compare_equal(std::string("a [nested] one"), iter.captured_comment_views()[1].str(), __FILE__, __LINE__, "Nested comment view");
+    }
+    std::vector<std::string> expected_comments{"&rate=1.5", "a nested one"};
+    fail += platypus::testing::compare_equal(expected_comments, iter.captured_comments(), __FILE__, __LINE__, "Comments not built from views");
+    iter.clear_captured_comments();
+    fail += platypus::testing::compare_equal(false, iter.token_has_comments(), __FILE__, __LINE__, "Comments not cleared");
+
+    // capture can be turned off
+    platypus::Tokenizer uncapturing_tokenizer = get_nexus_tokenizer();
+    uncapturing_tokenizer.set_capture_comments(false);
+    buffer_tokenizer.set_capture_comments(false);
+    std::vector<std::string> expected_tokens{"apple", ",", "banana"};
+    std::vector<std::string> observed_tokens;
+    for (auto iter = uncapturing_tokenizer.begin(commented); iter != uncapturing_tokenizer.end(); ++iter) {
+        fail += platypus::testing::compare_equal(false, iter.token_has_comments(), __FILE__, __LINE__, "Comments captured by stream tokenizer");
+        observed_tokens.push_back(*iter);
+    }
+    fail += compare_token_vectors(expected_tokens, observed_tokens, __FILE__, __LINE__);
+    observed_tokens.clear();
+    for (auto iter = buffer_tokenizer.begin(commented); iter != buffer_tokenizer.end(); ++iter) {
+        fail += platypus::testing::compare_equal(false, iter.token_has_comments(), __FILE__, __LINE__, "Comments captured by buffer tokenizer");
+        observed_tokens.push_back(iter->str());
+    }
+    fail += compare_token_vectors(expected_tokens, observed_tokens, __FILE__, __LINE__);
+    buffer_tokenizer.set_capture_comments(true);
+
+    // unterminated quote
+    std::string bad = "apple 'banana";
+    bool caught = false;
+    try {
+        for (auto iter = buffer_tokenizer.begin(bad); iter != buffer_tokenizer.end(); ++iter) {
+        }
+    } catch (const platypus::TokenizerUnterminatedQuoteError & e) {
+        caught = true;
+    }
+    fail += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "Unterminated quote not detected");
+
+    if (fail == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,66 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+int main() {
+    int fail = 0;
+
+    platypus::CharacterClassTable table(" \t\n\r", "(),;:", "\"'", "[", "]");
+    typedef platypus::CharacterClassTable CC;
+    fail += platypus::testing::compare_equal(true, table.is(' ', CC::UNCAPTURED_DELIMITER), __FILE__, __LINE__);
+    fail += platypus::testing::compare_equal(true, table.is('\n', CC::UNCAPTURED_DELIMITER), __FILE__, __LINE__);
+    fail += platypus::testing::compare_equal(true, table.is(':', CC::CAPTURED_DELIMITER), __FILE__, __LINE__);
+    fail += platypus::testing::compare_equal(true, table.is('\'', CC::QUOTE), __FILE__, __LINE__);
+    fail += platypus::testing::compare_equal(true, table.is('[', CC::COMMENT_BEGIN), __FILE__, __LINE__);
+    fail += platypus::testing::compare_equal(true, table.is(']', CC::COMMENT_END), __FILE__, __LINE__);
+    fail += platypus::testing::compare_equal(false, table.is('(', CC::UNCAPTURED_DELIMITER), __FILE__, __LINE__);
+    fail += platypus::testing::compare_equal(true, table.is_ordinary('a'), __FILE__, __LINE__);
+    fail += platypus::testing::compare_equal(true, table.is_ordinary(static_cast<char>(0xE9)), __FILE__, __LINE__);
+    fail += platypus::testing::compare_equal(static_cast<int>(CC::ORDINARY), static_cast<int>(table[EOF]), __FILE__, __LINE__);
+
+    // compile-time syntax of the same configuration
+    platypus::StaticCharacterClassTable<platypus::NewickSyntax> static_table;
+    for (int ch = 0; ch < 256; ++ch) {
+        fail += platypus::testing::compare_equal(static_cast<int>(table[ch]), static_cast<int>(static_table[ch]), __FILE__, __LINE__, "class of ", ch);
+    }
+    fail += platypus::testing::compare_equal(static_cast<int>(CC::ORDINARY), static_cast<int>(static_table[EOF]), __FILE__, __LINE__);
+
+    // long runs of ordinary characters, spanning stream buffer boundaries
+    std::string long_label(100000, 'x');
+    std::ostringstream o;
+    o << "(" << long_label << ":1," << long_label << "y[c]z)" << long_label;
+    std::string src = o.str();
+    std::vector<std::string> expected{"(", long_label, ":", "1", ",", long_label + "yz", ")", long_label};
+
+    platypus::Tokenizer tokenizer = get_nexus_tokenizer();
+    std::vector<std::string> observed;
+    std::istringstream src_stream(src);
+    for (auto iter = tokenizer.begin(src_stream); iter != tokenizer.end(); ++iter) {
+        observed.push_back(*iter);
+    }
+    fail += compare_token_vectors(expected, observed, __FILE__, __LINE__);
+
+    platypus::NewickTokenizer newick_tokenizer;
+    observed.clear();
+    std::istringstream newick_src_stream(src);
+    for (auto iter = newick_tokenizer.begin(newick_src_stream); iter != newick_tokenizer.end(); ++iter) {
+        observed.push_back(*iter);
+    }
+    fail += compare_token_vectors(expected, observed, __FILE__, __LINE__);
+
+    platypus::NexusBufferTokenizer buffer_tokenizer;
+    observed.clear();
+    for (auto iter = buffer_tokenizer.begin(src); iter != buffer_tokenizer.end(); ++iter) {
+        observed.push_back(iter->str());
+    }
+    fail += compare_token_vectors(expected, observed, __FILE__, __LINE__);
+
+    if (fail == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
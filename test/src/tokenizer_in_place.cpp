@@ -0,0 +1,79 @@
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <iterator>
+#include <string>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+template <class TokenizerT, class IteratorT>
+std::vector<std::string> get_tokens(TokenizerT & tokenizer, IteratorT iter) {
+    std::vector<std::string> tokens;
+    for (; iter != tokenizer.end(); ++iter) {
+        tokens.push_back(*iter);
+        for (auto & comment : iter.captured_comments()) {
+            tokens.push_back("[" + comment + "]");
+        }
+        iter.clear_captured_comments();
+    }
+    return tokens;
+}
+
+template <class TokenizerT>
+int check_tokenizer(TokenizerT & tokenizer, const std::string & name) {
+    int fails = 0;
+    std::vector<std::string> sources{
+        "",
+        "   ",
+        "(a:1,b:2)c;",
+        "[&R] ('a b':1 [a foo object], 'it''s'[x]:2, c)d [[nested] comment];",
+        "((xxxxxxxxxxxxxxxxxxxxxxxxx,yyyyyyyyyyyyyyyyyyyyyyy)zzzzzzzzzzzzzzzzzzzz);\n(q)r;",
+        "trailing",
+        "[unterminated comment",
+    };
+    for (auto & src : sources) {
+        std::istringstream s(src);
+        std::vector<std::string> expected = get_tokens(tokenizer, tokenizer.begin(s));
+        fails += compare_token_vectors(expected, get_tokens(tokenizer, tokenizer.begin(src)), name + ": view of string \"" + src + "\"", __LINE__);
+        fails += compare_token_vectors(expected, get_tokens(tokenizer, tokenizer.begin(std::string(src))), name + ": temporary string \"" + src + "\"", __LINE__);
+        // only the given characters are read
+        std::string padded = "x(" + src + "(y";
+        fails += compare_token_vectors(expected, get_tokens(tokenizer, tokenizer.begin(padded.data() + 2, src.size())), name + ": buffer \"" + src + "\"", __LINE__);
+    }
+
+    // copies of an iterator continue from the same position, independently
+    std::string src = "(a,b,c);";
+    auto iter = tokenizer.begin(src);
+    ++iter;
+    auto copy = iter++;
+    fails += platypus::testing::compare_equal(std::string("a"), *copy, __FILE__, __LINE__, name, ": copy");
+    fails += platypus::testing::compare_equal(std::string(","), *iter, __FILE__, __LINE__, name, ": original");
+    ++copy;
+    ++copy;
+    fails += platypus::testing::compare_equal(std::string("b"), *copy, __FILE__, __LINE__, name, ": advanced copy");
+    fails += platypus::testing::compare_equal(std::string(","), *iter, __FILE__, __LINE__, name, ": original after advancing copy");
+    fails += compare_token_vectors(std::vector<std::string>{",", "b", ",", "c", ")", ";"}, get_tokens(tokenizer, iter), name + ": rest of original", __LINE__);
+
+    std::string unterminated = "('a";
+    try {
+        get_tokens(tokenizer, tokenizer.begin(unterminated));
+        fails += platypus::testing::fail_test(__FILE__, __LINE__, "", "", name, ": unterminated quote not detected");
+    } catch (const platypus::TokenizerUnterminatedQuoteError &) {
+    }
+
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    platypus::Tokenizer tokenizer = get_nexus_tokenizer();
+    fails += check_tokenizer(tokenizer, "Tokenizer");
+    platypus::NewickTokenizer newick_tokenizer;
+    fails += check_tokenizer(newick_tokenizer, "NewickTokenizer");
+    if (fails == 0) {
+        return EXIT_SUCCESS;
+    } else {
+        return EXIT_FAILURE;
+    }
+}
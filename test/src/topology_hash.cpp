@@ -0,0 +1,163 @@
+#include <stdlib.h>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include <platypus/model/split.hpp>
+#include <platypus/model/topologyhash.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree TreeType;
+typedef platypus::TopologyHash<TreeType> TopologyHashType;
+
+// random tree on the first ``num_taxa`` letters, joining two (or sometimes
+// three) subtrees at a time, in random order
+std::string random_tree_string(std::size_t num_taxa, std::mt19937 & rng) {
+    std::vector<std::string> subtrees;
+    for (std::size_t idx = 0; idx < num_taxa; ++idx) {
+        subtrees.push_back(std::string(1, static_cast<char>('a' + idx)));
+    }
+    while (subtrees.size() > 1) {
+        std::size_t num_joined = (subtrees.size() > 2 && rng() % 4 == 0) ? 3 : 2;
+        std::string joined = "(";
+        for (std::size_t idx = 0; idx < num_joined; ++idx) {
+            std::size_t pick = rng() % subtrees.size();
+            joined += (idx > 0 ? "," : "") + subtrees[pick];
+            subtrees.erase(subtrees.begin() + pick);
+        }
+        subtrees.push_back(joined + ")");
+    }
+    return subtrees[0] + ";";
+}
+
+std::set<platypus::Split> get_splits(const TreeType & tree, std::size_t num_taxa, bool normalize) {
+    platypus::SplitSet split_set;
+    split_set.assign(tree, num_taxa, get_taxon_index, normalize);
+    std::set<platypus::Split> splits;
+    for (std::size_t idx = 0; idx < split_set.size(); ++idx) {
+        splits.insert(split_set.get_split(idx));
+    }
+    return splits;
+}
+
+int check_examples() {
+    int fails = 0;
+    struct Example {
+        std::string tree1;
+        std::string tree2;
+        bool is_rooted;
+        bool with_edge_lengths;
+        bool expected;
+    };
+    std::vector<Example> examples{
+        {"((a,b),(c,d));", "((d,c),(b,a));", true, false, true},
+        {"((a,b),(c,d));", "((a,c),(b,d));", true, false, false},
+        {"((a,b),(c,d));", "(((a,b),c),d);", true, false, false},
+        {"((a,b),(c,d));", "(((a,b),c),d);", false, false, true},
+        {"((a,b),(c,d));", "(a,b,(c,d));", false, false, true},
+        {"((a,b),(c,d));", "(c,(d,(b,a)));", false, false, true},
+        {"((a,b),(c,d));", "((a,c),(b,d));", false, false, false},
+        {"((a,b),(c,d));", "(a,b,c,d);", false, false, false},
+        {"(a,b);", "(b,a);", false, false, true},
+        {"(a,b);", "(a,c);", false, false, false},
+        {"(a);", "(a);", false, false, true},
+        {"((a:1,b:2):3,(c:4,d:5):6);", "((d:5,c:4):6,(b:2,a:1):3);", true, true, true},
+        {"((a:1,b:2):3,(c:4,d:5):6);", "((a:1,b:2):4,(c:4,d:5):5);", true, true, false},
+        {"((a:1,b:2):3,(c:4,d:5):6);", "((a:1,b:2):4,(c:4,d:5):5);", true, false, true},
+        {"((a:1,b:2):3,(c:4,d:5):6);", "((a:1,b:2):4,(c:4,d:5):5);", false, true, true},
+        {"((a:1,b:2):3,(c:4,d:5):6);", "(a:1,b:2,(c:4,d:5):9);", false, true, true},
+        {"((a:1,b:2):3,(c:4,d:5):6);", "(((a:1,b:2):9,c:4):2.5,d:2.5);", false, true, true},
+        {"((a:1,b:2):3,(c:4,d:5):6);", "(((a:1,b:2):9,c:4):2.5,d:3.5);", false, true, false},
+        {"((a:1,b:2):3,(c:4,d:5):6):7;", "((a:1,b:2):3,(c:4,d:5):6):1;", true, true, true},
+        {"((a:0,b:2):3,(c:4,d:5):6);", "((a:-0,b:2):3,(c:4,d:5):6);", true, true, true},
+    };
+    for (auto & example : examples) {
+        TopologyHashType topology_hash(get_taxon_index,
+                example.is_rooted,
+                example.with_edge_lengths ? TopologyHashType::edge_length_getter_type(get_edge_length) : TopologyHashType::edge_length_getter_type());
+        TreeType tree1 = read_tree(example.tree1);
+        TreeType tree2 = read_tree(example.tree2);
+        bool observed = topology_hash.compute(tree1) == topology_hash.compute(tree2);
+        fails += platypus::testing::compare_equal(example.expected, observed, __FILE__, __LINE__,
+                example.tree1, " vs. ", example.tree2, ", rooted: ", example.is_rooted, ", edge lengths: ", example.with_edge_lengths);
+    }
+    return fails;
+}
+
+// trees hash alike if and only if they have the same clades (rooted) or
+// splits (unrooted)
+int check_random_trees() {
+    int fails = 0;
+    const std::size_t num_taxa = 5;
+    std::mt19937 rng(11);
+    std::vector<TreeType> trees;
+    for (int idx = 0; idx < 200; ++idx) {
+        trees.push_back(read_tree(random_tree_string(num_taxa, rng)));
+    }
+    for (bool is_rooted : {true, false}) {
+        TopologyHashType topology_hash(get_taxon_index, is_rooted);
+        std::vector<std::set<platypus::Split>> splits;
+        std::vector<std::uint64_t> hashes;
+        for (auto & tree : trees) {
+            splits.push_back(get_splits(tree, num_taxa, !is_rooted));
+            hashes.push_back(topology_hash.compute(tree));
+        }
+        unsigned long num_equal = 0;
+        for (std::size_t i = 0; i < trees.size(); ++i) {
+            for (std::size_t j = i + 1; j < trees.size(); ++j) {
+                bool expected = splits[i] == splits[j];
+                num_equal += expected;
+                if (expected != (hashes[i] == hashes[j])) {
+                    fails += platypus::testing::fail_test(__FILE__, __LINE__, expected, !expected,
+                            "trees ", i, " and ", j, ", rooted: ", is_rooted);
+                }
+            }
+        }
+        fails += platypus::testing::compare_equal(true, num_equal > 0, __FILE__, __LINE__, "no equal topologies, rooted: ", is_rooted);
+        fails += platypus::testing::compare_equal(hashes, topology_hash.compute_trees(trees.begin(), trees.end(), 3), __FILE__, __LINE__, "compute_trees()");
+
+        // cache of distinct topologies
+        std::set<std::set<platypus::Split>> distinct(splits.begin(), splits.end());
+        platypus::TopologyCache<TreeType> cache(topology_hash);
+        std::size_t num_new = 0;
+        for (auto & tree : trees) {
+            num_new += cache.add_tree(tree);
+        }
+        fails += platypus::testing::compare_equal(distinct.size(), cache.size(), __FILE__, __LINE__, "distinct topologies, rooted: ", is_rooted);
+        fails += platypus::testing::compare_equal(distinct.size(), num_new, __FILE__, __LINE__, "new topologies");
+        fails += platypus::testing::compare_equal(trees.size(), static_cast<std::size_t>(cache.get_num_trees()), __FILE__, __LINE__, "number of trees");
+        unsigned long total_count = 0;
+        for (auto & topology : cache) {
+            total_count += topology.count;
+            fails += platypus::testing::compare_equal(hashes[topology.first_index], topology.hash, __FILE__, __LINE__, "first index");
+            fails += platypus::testing::compare_equal(topology.hash, topology_hash.compute(topology.tree), __FILE__, __LINE__, "stored tree");
+        }
+        fails += platypus::testing::compare_equal(200UL, total_count, __FILE__, __LINE__, "total count");
+        fails += platypus::testing::compare_equal(cache.find(hashes[7]), cache.find(trees[7]), __FILE__, __LINE__, "find()");
+        fails += platypus::testing::compare_equal(platypus::TopologyCache<TreeType>::npos(), cache.find(std::uint64_t(0)), __FILE__, __LINE__, "find() of unknown hash");
+
+        platypus::TopologyCache<TreeType> batch_cache(topology_hash);
+        fails += platypus::testing::compare_equal(distinct.size(), batch_cache.add_trees(trees.begin(), trees.end(), 4), __FILE__, __LINE__, "add_trees()");
+        for (std::size_t idx = 0; idx < cache.size(); ++idx) {
+            fails += platypus::testing::compare_equal(cache[idx].hash, batch_cache[idx].hash, __FILE__, __LINE__, "add_trees() hash");
+            fails += platypus::testing::compare_equal(cache[idx].count, batch_cache[idx].count, __FILE__, __LINE__, "add_trees() count");
+        }
+        TreeType moved(trees[0]);
+        fails += platypus::testing::compare_equal(false, cache.add_tree(std::move(moved)), __FILE__, __LINE__, "add_tree() of a seen topology");
+        fails += platypus::testing::compare_equal(batch_cache[0].count + 1, cache[0].count, __FILE__, __LINE__, "count after add_tree()");
+    }
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_examples();
+    fails += check_random_trees();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
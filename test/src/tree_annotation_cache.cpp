@@ -0,0 +1,122 @@
+#include <map>
+#include <platypus/model/treeannotationcache.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::TreeAnnotationCache<TestDataTree> AnnotationsType;
+
+// aggregates of every node by label, computed independently by walking the tree
+std::map<std::string, std::vector<double>> expected_annotations(const TestDataTree & tree) {
+    std::map<std::string, std::vector<double>> result;
+    for (auto nd = tree.preorder_begin(); nd != tree.preorder_end(); ++nd) {
+        double num_leaves = nd.node()->is_leaf() ? 1 : 0;
+        if (!nd.node()->is_leaf()) {
+            for (auto leaf = tree.leaf_begin(nd.node()); leaf != tree.leaf_end(nd.node()); ++leaf) {
+                ++num_leaves;
+            }
+        }
+        double depth = 0;
+        double distance = 0.0;
+        for (auto anc = nd.node(); anc->parent_node() != nullptr; anc = anc->parent_node()) {
+            ++depth;
+            distance += anc->value().get_edge_length();
+        }
+        double height = 0;
+        double age = 0.0;
+        for (auto desc = tree.preorder_begin(); desc != tree.preorder_end(); ++desc) {
+            double path_edges = 0;
+            double path_length = 0.0;
+            auto anc = desc.node();
+            for (; anc != nullptr && anc != nd.node(); anc = anc->parent_node()) {
+                ++path_edges;
+                path_length += anc->value().get_edge_length();
+            }
+            if (anc == nd.node()) {
+                height = std::max(height, path_edges);
+                age = std::max(age, path_length);
+            }
+        }
+        result[nd->get_label()] = {num_leaves, depth, height, distance, age};
+    }
+    return result;
+}
+
+std::map<std::string, std::vector<double>> observed_annotations(const TestDataTree & tree, AnnotationsType & annotations) {
+    std::map<std::string, std::vector<double>> result;
+    for (auto nd = tree.preorder_begin(); nd != tree.preorder_end(); ++nd) {
+        result[nd->get_label()] = {
+            static_cast<double>(annotations.num_leaves(nd.node())),
+            static_cast<double>(annotations.depth(nd.node())),
+            static_cast<double>(annotations.height(nd.node())),
+            annotations.distance_from_root(nd.node()),
+            annotations.age(nd.node())};
+    }
+    return result;
+}
+
+int check_annotations(const TestDataTree & tree, AnnotationsType & annotations, const std::string & remarks) {
+    int fails = 0;
+    auto expected = expected_annotations(tree);
+    auto observed = observed_annotations(tree, annotations);
+    fails += platypus::testing::compare_equal(expected.size(), observed.size(), __FILE__, __LINE__, remarks);
+    for (auto & e : expected) {
+        fails += platypus::testing::compare_equal(e.second, observed[e.first], __FILE__, __LINE__, remarks + ": " + e.first);
+    }
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    auto trees = get_test_data_tree_vector_from_string<TestDataTree>(
+            "((i:1,(j:2,k:3)e:1)b:2,((l:1,m:1)g:4,(n:2,(o:1,p:5)h:1)f:1)c:1)a;");
+    TestDataTree & tree = trees[0];
+    AnnotationsType annotations(tree, [](const TestData & nv) { return nv.get_edge_length(); });
+    fails += platypus::testing::compare_equal(false, annotations.is_current(), __FILE__, __LINE__, "not computed before first lookup");
+    fails += check_annotations(tree, annotations, "initial");
+    fails += platypus::testing::compare_equal(true, annotations.is_current(), __FILE__, __LINE__, "current after lookup");
+    fails += platypus::testing::compare_equal(8UL, annotations.num_leaves(tree.head_node()), __FILE__, __LINE__, "root leaves");
+    fails += platypus::testing::compare_equal(8.0, annotations.age(tree.head_node()), __FILE__, __LINE__, "root age");
+    fails += platypus::testing::compare_equal(4UL, annotations.height(tree.head_node()), __FILE__, __LINE__, "root height");
+
+    // incremental: a leaf added to an internal node, and to a leaf
+    std::map<std::string, TestDataTree::node_type *> nodes;
+    for (auto nd = tree.preorder_begin(); nd != tree.preorder_end(); ++nd) {
+        nodes[nd->get_label()] = nd.node();
+    }
+    TestDataTree::preorder_iterator e_pos(nodes["e"]);
+    TestData q("q");
+    q.set_edge_length(20.0);
+    auto q_pos = tree.add_child(e_pos, q);
+    annotations.child_added(q_pos.node());
+    fails += platypus::testing::compare_equal(true, annotations.is_current(), __FILE__, __LINE__, "current after incremental update");
+    fails += check_annotations(tree, annotations, "leaf added to internal node");
+    TestDataTree::preorder_iterator p_pos(nodes["p"]);
+    TestData r("r");
+    r.set_edge_length(0.5);
+    auto r_pos = tree.add_child(p_pos, r);
+    annotations.child_added(r_pos.node());
+    fails += platypus::testing::compare_equal(true, annotations.is_current(), __FILE__, __LINE__, "current after incremental update");
+    fails += check_annotations(tree, annotations, "leaf added to leaf");
+
+    // untracked additions are recomputed on demand
+    TestDataTree::preorder_iterator l_pos(nodes["l"]);
+    tree.add_child(l_pos, TestData("s"));
+    tree.add_child(l_pos, TestData("t"));
+    fails += platypus::testing::compare_equal(false, annotations.is_current(), __FILE__, __LINE__, "stale after untracked additions");
+    fails += check_annotations(tree, annotations, "recomputed");
+
+    // edge length changes are not tracked
+    nodes["b"]->value().set_edge_length(100.0);
+    annotations.invalidate();
+    fails += check_annotations(tree, annotations, "invalidated");
+
+    tree.clear();
+    fails += platypus::testing::compare_equal(1UL, static_cast<unsigned long>(annotations.size()), __FILE__, __LINE__, "cleared tree");
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <vector>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+int main() {
+
+    int fails = 0;
+
+    TestDataTree src;
+    src.set_is_rooted(false);
+    build_tree(src, STANDARD_TEST_TREE_STRING);
+
+    // functor copying values
+    TestDataTree copy1;
+    unsigned long num_nodes_copied = 0;
+    copy1.deep_copy_from(src, [&num_nodes_copied](const TestData & s, TestData & d) {
+        d = s;
+        ++num_nodes_copied;
+    });
+    fails += compare_against_standard_test_tree(copy1);
+    // 14 nodes in the standard test tree + root
+    fails += platypus::testing::compare_equal(
+            15UL,
+            num_nodes_copied,
+            __FILE__,
+            __LINE__,
+            "incorrect number of node values copied");
+
+    // copy into a tree that is not empty
+    TestDataTree copy2;
+    build_tree(copy2, STANDARD_TEST_TREE_STRING);
+    copy2.deep_copy_from(copy1);
+    fails += compare_against_standard_test_tree(copy2);
+
+    // single-node tree
+    TestDataTree single;
+    single.head_node()->value().set_label("x");
+    TestDataTree single_copy(single);
+    fails += platypus::testing::compare_equal(
+            std::string("x"),
+            single_copy.head_node()->value().get_label(),
+            __FILE__,
+            __LINE__);
+    fails += platypus::testing::compare_equal(
+            true,
+            single_copy.head_node()->is_leaf(),
+            __FILE__,
+            __LINE__);
+
+    // deep (caterpillar) tree: no recursion
+    unsigned long num_leaves = 100000;
+    TestDataTree deep;
+    auto node = deep.head_node();
+    for (unsigned long i = 0; i < num_leaves - 1; ++i) {
+        auto leaf = deep.create_leaf_node();
+        leaf->value().set_label("t" + std::to_string(i));
+        node->add_child(leaf);
+        auto internal = deep.create_internal_node();
+        node->add_child(internal);
+        node = internal;
+    }
+    node->value().set_label("t" + std::to_string(num_leaves - 1));
+    TestDataTree deep_copy(deep);
+    std::vector<std::string> expected;
+    for (auto ndi = deep.preorder_begin(); ndi != deep.preorder_end(); ++ndi) {
+        expected.push_back(ndi->get_label());
+    }
+    std::vector<std::string> observed;
+    for (auto ndi = deep_copy.preorder_begin(); ndi != deep_copy.preorder_end(); ++ndi) {
+        observed.push_back(ndi->get_label());
+    }
+    fails += platypus::testing::compare_equal(expected, observed, __FILE__, __LINE__, "deep tree");
+    fails += platypus::testing::compare_equal(
+            num_leaves,
+            deep_copy.get_num_leaves(),
+            __FILE__,
+            __LINE__,
+            "deep tree");
+
+    // bulk cloning
+    for (unsigned int num_threads : {1U, 4U}) {
+        auto clones = platypus::clone_n(src, 25, num_threads);
+        fails += platypus::testing::compare_equal(
+                25UL,
+                static_cast<unsigned long>(clones.size()),
+                __FILE__,
+                __LINE__);
+        for (auto & clone : clones) {
+            fails += compare_against_standard_test_tree(clone);
+            fails += platypus::testing::compare_equal(
+                    false,
+                    clone.is_rooted(),
+                    __FILE__,
+                    __LINE__,
+                    "rooting state not cloned");
+            fails += platypus::testing::compare_equal(
+                    false,
+                    clone.head_node() == src.head_node(),
+                    __FILE__,
+                    __LINE__,
+                    "clone shares nodes with source");
+        }
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <string>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree TreeType;
+typedef TreeType::node_type NodeType;
+
+NodeType * find_node(const TreeType & tree, const std::string & label) {
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        if (ndi->get_label() == label) {
+            return ndi.node();
+        }
+    }
+    return nullptr;
+}
+
+std::string compose(const TreeType & tree, bool with_edge_lengths=true) {
+    auto writer = get_standard_newick_writer<TreeType>(with_edge_lengths);
+    writer.set_suppress_rooting(true);
+    writer.set_compact_spaces(true);
+    writer.set_edge_length_precision(2);
+    return writer.format(tree);
+}
+
+double get_length(const TestData & nv) {
+    return nv.get_edge_length();
+}
+
+void set_length(TestData & nv, double length) {
+    nv.set_edge_length(length);
+}
+
+int check(const std::string & expected, const TreeType & tree, int line, const std::string & remarks, bool with_edge_lengths=true) {
+    return platypus::testing::compare_equal(expected, compose(tree, with_edge_lengths), __FILE__, line, remarks);
+}
+
+int main() {
+    int fails = 0;
+    const std::string source = "[&R] (((a:1,b:2)e:3,c:4)f:5,d:6)g:0;";
+
+    // prune with suppression of the unifurcation left behind
+    {
+        TreeType tree = read_tree(source, true);
+        unsigned long version = tree.structure_version();
+        NodeType * c = tree.prune_subtree(find_node(tree, "c"), get_length, set_length);
+        fails += check("((a:1.00,b:2.00)e:8.00,d:6.00)g:0.00;", tree, __LINE__, "prune_subtree()");
+        fails += platypus::testing::compare_equal(true, tree.structure_version() != version, __FILE__, __LINE__, "structure version not changed");
+        fails += platypus::testing::compare_equal(1UL, tree.num_spare_nodes(), __FILE__, __LINE__, "suppressed node not disposed");
+        // regraft onto the edge subtending d
+        NodeType * new_node = tree.regraft(c, find_node(tree, "d"), get_length, set_length, 0.5);
+        new_node->value().set_label("h");
+        fails += check("((a:1.00,b:2.00)e:8.00,(d:3.00,c:4.00)h:3.00)g:0.00;", tree, __LINE__, "regraft()");
+        fails += platypus::testing::compare_equal(0UL, tree.num_spare_nodes(), __FILE__, __LINE__, "spare node not reused");
+    }
+
+    // prune without suppression, and with the head node as parent
+    {
+        TreeType tree = read_tree(source, true);
+        NodeType * e = tree.prune_subtree(find_node(tree, "e"), false);
+        fails += check("((c)f,d)g;", tree, __LINE__, "prune_subtree() without suppression", false);
+        tree.dispose_subtree(e);
+        fails += platypus::testing::compare_equal(3UL, tree.num_spare_nodes(), __FILE__, __LINE__, "subtree not disposed");
+        tree.prune_subtree(find_node(tree, "d"));
+        fails += check("(c)g;", tree, __LINE__, "prune_subtree() at head merges remaining internal child", false);
+        tree.collapse_unifurcations();
+        fails += check("(c)g;", tree, __LINE__, "collapse_unifurcations() keeps leaf under head", false);
+    }
+    {
+        TreeType tree = read_tree(source, true);
+        tree.prune_subtree(find_node(tree, "d"), get_length, set_length);
+        fails += check("((a:1.00,b:2.00)e:3.00,c:4.00)g:5.00;", tree, __LINE__, "prune_subtree() of child of head");
+    }
+
+    // regraft onto the head node
+    {
+        TreeType tree = read_tree(source, true);
+        NodeType * a = tree.prune_subtree(find_node(tree, "a"), get_length, set_length);
+        tree.regraft(a, tree.head_node(), get_length, set_length, 0.5);
+        fails += check("(((b:5.00,c:4.00)f:5.00,d:6.00):0.00,a:1.00)g:0.00;", tree, __LINE__, "regraft() at head");
+    }
+
+    // rerooting
+    {
+        TreeType tree = read_tree(source, true);
+        tree.reroot_at_edge(find_node(tree, "a"), get_length, set_length, 0.5);
+        fails += check("(a:0.50,(b:2.00,(c:4.00,d:11.00)f:3.00)e:0.50)g:0.00;", tree, __LINE__, "reroot_at_edge()");
+        // and back again, to the edge joining f and d
+        tree.reroot_at_edge(find_node(tree, "d"), get_length, set_length, 0.5);
+        fails += check("(d:5.50,(c:4.00,(b:2.00,a:1.00)e:3.00)f:5.50)g:0.00;", tree, __LINE__, "reroot_at_edge() again");
+        // child of a bifurcating root
+        tree.reroot_at_edge(find_node(tree, "f"), get_length, set_length, 0.25);
+        fails += check("((c:4.00,(b:2.00,a:1.00)e:3.00)f:2.75,d:8.25)g:0.00;", tree, __LINE__, "reroot_at_edge() on root edge");
+    }
+    {
+        // multifurcating root is kept as a new node
+        TreeType tree = read_tree("((a:1,b:1)e:2,c:3,d:4)g;", true);
+        tree.reroot_at_edge(find_node(tree, "a"));
+        fails += check("(a,(b,(c,d))e)g;", tree, __LINE__, "reroot_at_edge() with multifurcating root", false);
+        tree.reroot_at_edge(find_node(tree, "c"));
+        fails += check("(c,(d,(b,a)e))g;", tree, __LINE__, "reroot_at_edge() within the new node", false);
+    }
+
+    // ladderizing
+    {
+        TreeType tree = read_tree("((a,(b,(c,d))),(e,f),g)h;", true);
+        tree.ladderize();
+        fails += check("(g,(e,f),(a,(b,(c,d))))h;", tree, __LINE__, "ladderize()", false);
+        tree.ladderize(false);
+        fails += check("((((c,d),b),a),(e,f),g)h;", tree, __LINE__, "ladderize(false)", false);
+    }
+
+    // collapsing unifurcations
+    {
+        TreeType tree = read_tree("((((a:1)x:1,b:1)y:1)z:1)w:0;", true);
+        tree.collapse_unifurcations(get_length, set_length);
+        fails += check("(a:2.00,b:1.00)w:2.00;", tree, __LINE__, "collapse_unifurcations()");
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
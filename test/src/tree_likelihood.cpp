@@ -0,0 +1,352 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include <platypus/model/likelihood.hpp>
+#include <platypus/model/treepattern.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree TreeType;
+typedef TreeType::node_type NodeType;
+typedef platypus::TreeLikelihood<TreeType, std::uint8_t> LikelihoodType;
+
+template <typename... Types>
+int check_close(double expected, double observed, double tolerance, unsigned long line_num, const Types&... args) {
+    if (!(std::fabs(expected - observed) <= tolerance * (1.0 + std::fabs(expected)))) {
+        return platypus::testing::fail_test(__FILE__, line_num, expected, observed, args...);
+    }
+    return 0;
+}
+
+int check_model() {
+    int fails = 0;
+    std::vector<double> freqs{0.1, 0.2, 0.3, 0.4};
+    std::vector<platypus::SubstitutionModel> models{
+        platypus::SubstitutionModel::jc69(),
+        platypus::SubstitutionModel::hky85(4.0, freqs),
+        platypus::SubstitutionModel::gtr({1.2, 3.4, 0.5, 0.8, 5.1, 1.0}, freqs),
+    };
+    std::vector<double> p0(16);
+    std::vector<double> ps(16);
+    std::vector<double> pt(16);
+    std::vector<double> pst(16);
+    for (auto & model : models) {
+        const auto & pi = model.frequencies();
+        const auto & q = model.rate_matrix();
+        double mean_rate = 0.0;
+        for (std::size_t i = 0; i < 4; ++i) {
+            mean_rate -= pi[i] * q[i * 4 + i];
+        }
+        fails += check_close(1.0, mean_rate, 1e-12, __LINE__, "mean rate");
+        model.transition_probabilities(0.0, p0.data());
+        model.transition_probabilities(0.3, ps.data());
+        model.transition_probabilities(0.5, pt.data());
+        model.transition_probabilities(0.8, pst.data());
+        for (std::size_t i = 0; i < 4; ++i) {
+            double row_sum = 0.0;
+            for (std::size_t j = 0; j < 4; ++j) {
+                fails += check_close(i == j ? 1.0 : 0.0, p0[i * 4 + j], 1e-12, __LINE__, "P(0)");
+                fails += check_close(pi[i] * ps[i * 4 + j], pi[j] * ps[j * 4 + i], 1e-12, __LINE__, "detailed balance");
+                double product = 0.0;
+                for (std::size_t k = 0; k < 4; ++k) {
+                    product += ps[i * 4 + k] * pt[k * 4 + j];
+                }
+                fails += check_close(pst[i * 4 + j], product, 1e-12, __LINE__, "P(s)P(t) = P(s + t)");
+                row_sum += ps[i * 4 + j];
+            }
+            fails += check_close(1.0, row_sum, 1e-12, __LINE__, "row sum");
+        }
+    }
+    // JC69 in closed form, and HKY85 with kappa = 1 and equal frequencies is JC69
+    auto hky = platypus::SubstitutionModel::hky85(1.0, {1, 1, 1, 1});
+    hky.transition_probabilities(0.7, ps.data());
+    for (std::size_t i = 0; i < 4; ++i) {
+        for (std::size_t j = 0; j < 4; ++j) {
+            double expected = i == j ? 0.25 + 0.75 * std::exp(-4.0 * 0.7 / 3.0) : 0.25 - 0.25 * std::exp(-4.0 * 0.7 / 3.0);
+            fails += check_close(expected, ps[i * 4 + j], 1e-12, __LINE__, "JC69 transition probability");
+        }
+    }
+    bool caught = false;
+    try {
+        platypus::SubstitutionModel({1, 1, 1}, {0.25, 0.25, 0.25, 0.25});
+    } catch (const std::invalid_argument &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "wrong number of exchangeabilities not rejected");
+    return fails;
+}
+
+int check_gamma_rates() {
+    int fails = 0;
+    // Yang (1994), table 1
+    std::vector<double> expected{0.033388, 0.251916, 0.820268, 2.894428};
+    auto rates = platypus::discrete_gamma_rates(0.5, 4);
+    for (std::size_t idx = 0; idx < 4; ++idx) {
+        fails += check_close(expected[idx], rates[idx], 1e-5, __LINE__, "gamma rate ", idx);
+    }
+    for (double shape : {0.05, 1.0, 20.0}) {
+        double sum = 0.0;
+        for (auto rate : platypus::discrete_gamma_rates(shape, 8)) {
+            sum += rate;
+        }
+        fails += check_close(8.0, sum, 1e-12, __LINE__, "mean rate, shape ", shape);
+    }
+    return fails;
+}
+
+int check_two_taxa() {
+    int fails = 0;
+    platypus::TaxonNamespace taxa;
+    platypus::NucleotideCharacterMatrix matrix(platypus::CharacterStateAlphabet::dna(), &taxa);
+    matrix.add_sequence("a", "ACGTACGTAA");
+    matrix.add_sequence("b", "ACGTACGTCG");
+    auto taxon_index_fn = [&taxa] (const TestData & nv) { return taxa.find_taxon(nv.get_label()); };
+    auto edge_length_fn = [] (const TestData & nv) { return nv.get_edge_length(); };
+    TreeType tree = read_tree("(a:0.1,b:0.2);");
+    auto jc = [] (double t, bool same) {
+        return same ? 0.25 + 0.75 * std::exp(-4.0 * t / 3.0) : 0.25 - 0.25 * std::exp(-4.0 * t / 3.0);
+    };
+    {
+        LikelihoodType likelihood(matrix, platypus::SubstitutionModel::jc69(), taxon_index_fn, edge_length_fn);
+        double expected = 8 * std::log(0.25 * jc(0.3, true)) + 2 * std::log(0.25 * jc(0.3, false));
+        fails += check_close(expected, likelihood.log_likelihood(tree), 1e-12, __LINE__, "JC69 two taxa");
+        fails += check_close(expected, likelihood.get_log_likelihood(), 1e-12, __LINE__, "get_log_likelihood()");
+    }
+    {
+        LikelihoodType likelihood(matrix, platypus::SubstitutionModel::jc69(), taxon_index_fn, edge_length_fn, 4, 0.5);
+        auto rates = platypus::discrete_gamma_rates(0.5, 4);
+        double same = 0.0;
+        double different = 0.0;
+        for (auto rate : rates) {
+            same += 0.25 * 0.25 * jc(0.3 * rate, true);
+            different += 0.25 * 0.25 * jc(0.3 * rate, false);
+        }
+        double expected = 8 * std::log(same) + 2 * std::log(different);
+        fails += check_close(expected, likelihood.log_likelihood(tree), 1e-12, __LINE__, "JC69+G two taxa");
+    }
+    {
+        // a leaf with no row in the matrix contributes nothing
+        TreeType tree_with_missing = read_tree("((a:0.1,x:0.5):0,b:0.2);");
+        LikelihoodType likelihood(matrix, platypus::SubstitutionModel::jc69(), taxon_index_fn, edge_length_fn);
+        fails += check_close(likelihood.log_likelihood(tree), likelihood.log_likelihood(tree_with_missing), 1e-12, __LINE__, "missing data");
+    }
+    return fails;
+}
+
+int check_rooting_and_compression() {
+    int fails = 0;
+    std::mt19937 rng(11);
+    platypus::TaxonNamespace taxa;
+    platypus::NucleotideCharacterMatrix matrix(platypus::CharacterStateAlphabet::dna(), &taxa);
+    add_random_sequences(matrix, 5, 60, rng, "ACGTN", 2);
+    platypus::NucleotideCharacterMatrix compressed(matrix);
+    compressed.compress_patterns();
+    auto taxon_index_fn = [&taxa] (const TestData & nv) { return taxa.find_taxon(nv.get_label()); };
+    auto edge_length_fn = [] (const TestData & nv) { return nv.get_edge_length(); };
+    auto model = platypus::SubstitutionModel::gtr({1.2, 3.4, 0.5, 0.8, 5.1, 1.0}, {0.1, 0.2, 0.3, 0.4});
+    // the same unrooted tree, rooted in three ways
+    std::vector<TreeType> trees;
+    trees.push_back(read_tree("(((t0:0.1,t1:0.2):0.1,t2:0.3):0.05,(t3:0.4,t4:0.5):0.25);"));
+    trees.push_back(read_tree("((t0:0.1,t1:0.2):0.1,t2:0.3,(t3:0.4,t4:0.5):0.3);"));
+    trees.push_back(read_tree("(t0:0.05,(t1:0.2,(t2:0.3,(t3:0.4,t4:0.5):0.3):0.1):0.05);"));
+    LikelihoodType likelihood(matrix, model, taxon_index_fn, edge_length_fn, 4, 0.8);
+    LikelihoodType compressed_likelihood(compressed, model, taxon_index_fn, edge_length_fn, 4, 0.8);
+    double expected = likelihood.log_likelihood(trees[0]);
+    for (auto & tree : trees) {
+        fails += check_close(expected, likelihood.log_likelihood(tree), 1e-10, __LINE__, "rooting");
+        fails += check_close(expected, compressed_likelihood.log_likelihood(tree), 1e-10, __LINE__, "compressed patterns");
+    }
+    return fails;
+}
+
+int check_large_tree_and_updates() {
+    int fails = 0;
+    std::mt19937 rng(5);
+    const std::size_t num_taxa = 2000;
+    platypus::TaxonNamespace taxa;
+    platypus::NucleotideCharacterMatrix matrix(platypus::CharacterStateAlphabet::dna(), &taxa);
+    add_random_sequences(matrix, num_taxa, 20, rng, "ACGTN", 2);
+    matrix.compress_patterns();
+    auto taxon_index_fn = [&taxa] (const TestData & nv) { return taxa.find_taxon(nv.get_label()); };
+    auto edge_length_fn = [] (const TestData & nv) { return nv.get_edge_length(); };
+    std::vector<TestData> leaves;
+    for (std::size_t taxon = 0; taxon < num_taxa; ++taxon) {
+        leaves.push_back(TestData("t" + std::to_string(taxon)));
+    }
+    TreeType tree;
+    platypus::build_maximally_unbalanced_tree(tree, leaves.begin(), leaves.end());
+    std::vector<NodeType *> nodes;
+    std::uniform_real_distribution<double> length(0.01, 1.0);
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        ndi->set_edge_length(length(rng));
+        nodes.push_back(ndi.node());
+    }
+    LikelihoodType likelihood(matrix, platypus::SubstitutionModel::hky85(2.0, {0.3, 0.2, 0.2, 0.3}), taxon_index_fn, edge_length_fn, 4, 0.5);
+    double log_likelihood = likelihood.log_likelihood(tree);
+    // without rescaling, the likelihood of each site underflows
+    fails += platypus::testing::compare_equal(true, std::isfinite(log_likelihood) && log_likelihood < -1000.0, __FILE__, __LINE__, "log-likelihood: ", log_likelihood);
+
+    // batches of trees, differing in edge lengths
+    {
+        std::vector<TreeType> trees;
+        std::vector<double> expected;
+        for (int tree_idx = 0; tree_idx < 7; ++tree_idx) {
+            for (auto nd : nodes) {
+                nd->value().set_edge_length(length(rng));
+            }
+            trees.push_back(tree);
+            expected.push_back(likelihood.log_likelihood(tree));
+        }
+        for (unsigned int num_threads : {1U, 3U}) {
+            auto observed = likelihood.log_likelihood_trees(trees.begin(), trees.end(), num_threads);
+            fails += platypus::testing::compare_equal(expected.size(), observed.size(), __FILE__, __LINE__, "batch size");
+            for (std::size_t idx = 0; idx < expected.size() && idx < observed.size(); ++idx) {
+                fails += check_close(expected[idx], observed[idx], 1e-12, __LINE__, "log_likelihood_trees(), threads: ", num_threads, ", tree: ", idx);
+            }
+        }
+        fails += check_close(expected.back(), likelihood.get_log_likelihood(), 1e-12, __LINE__, "state unchanged by batch");
+        likelihood.log_likelihood(tree);
+    }
+
+    LikelihoodType fresh(matrix, likelihood.model(), taxon_index_fn, edge_length_fn, 4, 0.5);
+    for (int step = 0; step < 20; ++step) {
+        std::vector<NodeType *> modified;
+        for (int idx = 0; idx < 3; ++idx) {
+            NodeType * nd = nodes[rng() % nodes.size()];
+            nd->value().set_edge_length(length(rng));
+            modified.push_back(nd);
+        }
+        double updated = likelihood.update_log_likelihood(tree, modified);
+        fails += check_close(fresh.log_likelihood(tree), updated, 1e-10, __LINE__, "update_log_likelihood(), step ", step);
+    }
+    return fails;
+}
+
+// marginal state probabilities of the internal nodes, for each site, by
+// enumerating the assignments of states to all of them
+std::vector<std::vector<double>> enumerate_ancestral_states(const TreeType & tree,
+        const std::vector<std::string> & sequences,
+        const platypus::SubstitutionModel & model,
+        const std::vector<double> & rates,
+        std::size_t site) {
+    std::vector<const NodeType *> nodes;
+    std::vector<int> internal_idx;
+    std::size_t num_internal = 0;
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        nodes.push_back(ndi.node());
+        internal_idx.push_back(ndi.is_leaf() ? -1 : static_cast<int>(num_internal++));
+    }
+    auto node_idx = [&nodes] (const NodeType * nd) {
+        return static_cast<std::size_t>(std::find(nodes.begin(), nodes.end(), nd) - nodes.begin());
+    };
+    std::vector<std::vector<double>> joint(num_internal, std::vector<double>(4, 0.0));
+    std::vector<double> pmat(16);
+    std::size_t num_assignments = 1;
+    for (std::size_t idx = 0; idx < num_internal; ++idx) {
+        num_assignments *= 4;
+    }
+    for (auto rate : rates) {
+        for (std::size_t assignment = 0; assignment < num_assignments; ++assignment) {
+            std::vector<std::size_t> states(num_internal);
+            for (std::size_t idx = 0, a = assignment; idx < num_internal; ++idx, a /= 4) {
+                states[idx] = a % 4;
+            }
+            double probability = model.frequencies()[states[0]];
+            for (std::size_t idx = 1; idx < nodes.size(); ++idx) {
+                const NodeType * nd = nodes[idx];
+                std::size_t parent_state = states[internal_idx[node_idx(nd->parent_node())]];
+                model.transition_probabilities(nd->value().get_edge_length() * rate, pmat.data());
+                if (internal_idx[idx] >= 0) {
+                    probability *= pmat[parent_state * 4 + states[internal_idx[idx]]];
+                } else {
+                    std::string label = nd->value().get_label();
+                    std::size_t symbol = std::string("ACGT").find(sequences[std::stoi(label.substr(1))][site]);
+                    double leaf_probability = 0.0;
+                    for (std::size_t state = 0; state < 4; ++state) {
+                        leaf_probability += symbol == std::string::npos || symbol == state ? pmat[parent_state * 4 + state] : 0.0;
+                    }
+                    probability *= leaf_probability;
+                }
+            }
+            for (std::size_t idx = 0; idx < num_internal; ++idx) {
+                joint[idx][states[idx]] += probability;
+            }
+        }
+    }
+    for (auto & node_joint : joint) {
+        double total = node_joint[0] + node_joint[1] + node_joint[2] + node_joint[3];
+        for (auto & p : node_joint) {
+            p /= total;
+        }
+    }
+    return joint;
+}
+
+int check_ancestral_states() {
+    int fails = 0;
+    std::mt19937 rng(17);
+    platypus::TaxonNamespace taxa;
+    platypus::NucleotideCharacterMatrix matrix(platypus::CharacterStateAlphabet::dna(), &taxa);
+    std::vector<std::string> sequences = add_random_sequences(matrix, 6, 12, rng, "ACGTN", 2);
+    const std::size_t num_sites = matrix.num_sites();
+    matrix.compress_patterns();
+    auto taxon_index_fn = [&taxa] (const TestData & nv) { return taxa.find_taxon(nv.get_label()); };
+    auto edge_length_fn = [] (const TestData & nv) { return nv.get_edge_length(); };
+    auto model = platypus::SubstitutionModel::gtr({1.2, 3.4, 0.5, 0.8, 5.1, 1.0}, {0.1, 0.2, 0.3, 0.4});
+    std::vector<TreeType> trees;
+    trees.push_back(read_tree("((t0:0.1,t1:0.2):0.1,(t2:0.3,t3:0.15):0.2,(t4:0.4,t5:0.5):0.3);"));
+    trees.push_back(read_tree("((t0:0.1,t1:0.2,t2:0.05):0.1,(t3:0.3,(t4:0.4,t5:0.5):0.3):0.2);"));
+    for (std::size_t num_categories : {1UL, 3UL}) {
+        LikelihoodType likelihood(matrix, model, taxon_index_fn, edge_length_fn, num_categories, 0.7);
+        std::vector<double> rates = num_categories > 1 ? platypus::discrete_gamma_rates(0.7, num_categories) : std::vector<double>{1.0};
+        for (auto & tree : trees) {
+            double log_likelihood = likelihood.log_likelihood(tree);
+            fails += check_close(log_likelihood, likelihood.compute_ancestral_states(tree), 1e-12, __LINE__, "log-likelihood");
+            for (std::size_t site = 0; site < num_sites; ++site) {
+                auto expected = enumerate_ancestral_states(tree, sequences, model, rates, site);
+                std::size_t internal_idx = 0;
+                for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+                    if (ndi.is_leaf()) {
+                        continue;
+                    }
+                    const double * observed = likelihood.get_ancestral_state_probabilities(ndi.node()) + matrix.get_site_pattern(site) * 4;
+                    for (std::size_t state = 0; state < 4; ++state) {
+                        fails += check_close(expected[internal_idx][state], observed[state], 1e-10, __LINE__,
+                                "state probability, categories: ", num_categories, ", site: ", site, ", node: ", internal_idx, ", state: ", state);
+                    }
+                    ++internal_idx;
+                }
+            }
+        }
+    }
+    {
+        TreeType & tree = trees[0];
+        LikelihoodType likelihood(matrix, model, taxon_index_fn, edge_length_fn);
+        likelihood.compute_ancestral_states(tree);
+        platypus::DataTable table;
+        likelihood.export_ancestral_states(tree, table);
+        fails += platypus::testing::compare_equal(4UL * likelihood.num_patterns(), table.num_rows(), __FILE__, __LINE__, "table rows");
+        fails += platypus::testing::compare_equal(6UL, table.num_columns(), __FILE__, __LINE__, "table columns");
+    }
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_model();
+    fails += check_gamma_rates();
+    fails += check_two_taxa();
+    fails += check_rooting_and_compression();
+    fails += check_large_tree_and_updates();
+    fails += check_ancestral_states();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
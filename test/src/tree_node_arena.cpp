@@ -0,0 +1,132 @@
+#include <stdlib.h>
+#include <sstream>
+#include <iostream>
+#include <platypus/model/treenodearena.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::Tree<std::string, platypus::TreeNodeArena<platypus::TreeNode<std::string>>> ArenaTree;
+
+int main() {
+
+    int fails = 0;
+
+    fails += platypus::testing::compare_equal(
+            true,
+            ArenaTree::allocator_tracks_node_ownership,
+            __FILE__,
+            __LINE__,
+            "arena allocator not detected as tracking node ownership");
+    fails += platypus::testing::compare_equal(
+            false,
+            BasicTree::allocator_tracks_node_ownership,
+            __FILE__,
+            __LINE__,
+            "standard allocator detected as tracking node ownership");
+
+    // building, traversal
+    ArenaTree tree;
+    build_tree(tree, STANDARD_TEST_TREE_STRING);
+    if (compare_against_newick_string(tree, "tree built using arena failed to yield expected newick string")) {
+        fails += 1;
+    }
+    // 14 non-root nodes in the standard test tree + head (root) + stop
+    fails += platypus::testing::compare_equal(
+            16UL,
+            static_cast<unsigned long>(tree.node_allocator().size()),
+            __FILE__,
+            __LINE__,
+            "incorrect number of live nodes in arena");
+
+    // disposing of individual nodes recycles their storage
+    auto nd = tree.create_node("x");
+    tree.dispose_node(nd);
+    auto nd2 = tree.create_node("y");
+    fails += platypus::testing::compare_equal(
+            static_cast<void *>(nd),
+            static_cast<void *>(nd2),
+            __FILE__,
+            __LINE__,
+            "storage of disposed node not reused");
+    tree.dispose_node(nd2);
+
+    // deep copy allocates from its own arena
+    ArenaTree tree_copy(tree);
+    if (compare_against_newick_string(tree_copy, "copy of tree built using arena failed to yield expected newick string")) {
+        fails += 1;
+    }
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        std::string s = *ndi;
+        uppercase(s);
+        *ndi = s;
+    }
+    if (compare_against_newick_string(tree_copy, "copy of tree built using arena shares nodes with original")) {
+        fails += 1;
+    }
+
+    // clearing releases the slabs; the tree can then be rebuilt
+    tree.clear();
+    fails += platypus::testing::compare_equal(
+            2UL,
+            static_cast<unsigned long>(tree.node_allocator().size()),
+            __FILE__,
+            __LINE__,
+            "incorrect number of live nodes in arena after clearing tree");
+    build_tree(tree, STANDARD_TEST_TREE_STRING);
+    if (compare_against_newick_string(tree, "rebuilt tree failed to yield expected newick string")) {
+        fails += 1;
+    }
+
+    // slab growth and reservation
+    platypus::TreeNodeArena<platypus::TreeNode<std::string>> arena(4, 16);
+    std::vector<platypus::TreeNode<std::string> *> nodes;
+    for (int i = 0; i < 100; ++i) {
+        auto p = arena.allocate(1);
+        arena.construct(p, std::to_string(i));
+        nodes.push_back(p);
+    }
+    fails += platypus::testing::compare_equal(
+            100UL,
+            static_cast<unsigned long>(arena.size()),
+            __FILE__,
+            __LINE__,
+            "incorrect number of live objects in arena");
+    // 4 + 8 + 16 + 16 + 16 + 16 + 16 + 16 = 108
+    fails += platypus::testing::compare_equal(
+            8UL,
+            static_cast<unsigned long>(arena.num_slabs()),
+            __FILE__,
+            __LINE__,
+            "incorrect number of slabs in arena");
+    for (int i = 0; i < 100; ++i) {
+        fails += platypus::testing::compare_equal(
+                std::to_string(i),
+                nodes[i]->value(),
+                __FILE__,
+                __LINE__,
+                "arena object value overwritten");
+    }
+    arena.destroy(nodes[50]);
+    arena.deallocate(nodes[50], 1);
+    arena.reserve(50);
+    fails += platypus::testing::compare_equal(
+            true,
+            arena.capacity() - arena.size() >= 50,
+            __FILE__,
+            __LINE__,
+            "reservation failed");
+    arena.release();
+    fails += platypus::testing::compare_equal(
+            0UL,
+            static_cast<unsigned long>(arena.num_slabs()),
+            __FILE__,
+            __LINE__,
+            "slabs not released");
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
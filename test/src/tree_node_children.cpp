@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef BasicTree::node_type NodeType;
+
+// labels of the children of ``nd``, walking forwards, and checking the
+// backward links against them
+int check_children(const NodeType * nd, const std::vector<std::string> & expected, const std::string & remarks) {
+    int fails = 0;
+    std::vector<std::string> forward;
+    std::vector<std::string> backward;
+    for (auto ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+        forward.push_back(ch->value());
+        if (ch->parent_node() != nd) {
+            fails += platypus::testing::fail_test(__FILE__, __LINE__, "parent", "other", remarks);
+        }
+    }
+    for (auto ch = nd->last_child_node(); ch != nullptr; ch = ch->prev_sibling_node()) {
+        backward.push_back(ch->value());
+    }
+    std::reverse(backward.begin(), backward.end());
+    fails += platypus::testing::compare_equal(expected, forward, __FILE__, __LINE__, remarks, ": forward");
+    fails += platypus::testing::compare_equal(expected, backward, __FILE__, __LINE__, remarks, ": backward");
+    fails += platypus::testing::compare_equal(expected.size(), nd->num_child_nodes(), __FILE__, __LINE__, remarks, ": count");
+    // every child near the ends, and a sample of those in between
+    for (std::size_t idx = 0; idx < expected.size(); idx += (idx < 10 || idx + 10 >= expected.size()) ? 1 : 97) {
+        if (nd->child_node(idx)->value() != expected[idx]) {
+            fails += platypus::testing::fail_test(__FILE__, __LINE__, expected[idx], nd->child_node(idx)->value(), remarks, ": child ", idx);
+        }
+    }
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+
+    BasicTree tree;
+    NodeType * head = tree.head_node();
+    std::vector<std::string> expected;
+    std::vector<NodeType *> nodes;
+    for (int i = 0; i < 10000; ++i) {
+        nodes.push_back(tree.create_node("t" + std::to_string(i)));
+        head->add_child(nodes.back());
+        expected.push_back(nodes.back()->value());
+    }
+    fails += check_children(head, expected, "star tree");
+
+    // removal from the front, middle and back
+    for (std::size_t idx : {9999UL, 5000UL, 0UL, 1234UL}) {
+        head->remove_child(nodes[idx]);
+        expected.erase(std::find(expected.begin(), expected.end(), nodes[idx]->value()));
+        fails += platypus::testing::compare_equal(true,
+                nodes[idx]->parent_node() == nullptr && nodes[idx]->next_sibling_node() == nullptr && nodes[idx]->prev_sibling_node() == nullptr,
+                __FILE__, __LINE__, "links of removed node not cleared");
+    }
+    fails += check_children(head, expected, "after removal");
+
+    // insertion and replacement
+    head->insert_child(nodes[1], nodes[0]);
+    expected.insert(expected.begin(), nodes[0]->value());
+    head->insert_child(nodes[5001], nodes[5000]);
+    expected.insert(std::find(expected.begin(), expected.end(), nodes[5001]->value()), nodes[5000]->value());
+    head->insert_child(nullptr, nodes[9999]);
+    expected.push_back(nodes[9999]->value());
+    head->replace_child(nodes[9998], nodes[1234]);
+    *std::find(expected.begin(), expected.end(), nodes[9998]->value()) = nodes[1234]->value();
+    head->replace_child(nodes[0], nodes[9998]);
+    expected.front() = nodes[9998]->value();
+    fails += check_children(head, expected, "after insertion and replacement");
+
+    // moving all children to another node
+    NodeType * other = tree.create_node("x");
+    other->take_children(head);
+    fails += check_children(head, std::vector<std::string>{}, "after children taken");
+    fails += check_children(other, expected, "taken children");
+    head->add_child(other);
+    fails += check_children(head, std::vector<std::string>{"x"}, "single child");
+    tree.dispose_node(nodes[0]);
+
+    // as built by the tree itself
+    BasicTree tree2;
+    build_tree(tree2, STANDARD_TEST_TREE_STRING);
+    for (auto ndi = tree2.preorder_begin(); ndi != tree2.preorder_end(); ++ndi) {
+        fails += check_children(ndi.node(), STANDARD_TEST_TREE_CHILDREN.find(*ndi)->second, *ndi);
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,129 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <platypus/parse/newick.hpp>
+#include <platypus/serialize/newick.hpp>
+#include <platypus/utility/treeoffsetindex.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+int main() {
+    int fails = 0;
+
+    // statements with semi-colons in comments and quotes, and empty
+    // statements, which are not indexed
+    std::ostringstream o;
+    unsigned long num_trees = 25;
+    o << ";;\n";
+    for (unsigned long i = 0; i < num_trees; ++i) {
+        o << "[&R] [tree " << i << "; of " << num_trees << "] ((a:" << i << ", 'b;c':2)c, (d, e)f)g;\n";
+        if (i % 5 == 0) {
+            o << " ;\n";
+        }
+    }
+    std::string src = o.str();
+
+    auto tree_reader = get_test_data_tree_newick_reader<TestDataTree>();
+    auto tree_writer = get_standard_newick_writer<TestDataTree>();
+    auto all_trees = get_test_data_tree_vector_from_string<TestDataTree>(src);
+    fails += platypus::testing::compare_equal(num_trees, all_trees.size(), __FILE__, __LINE__);
+
+    platypus::TreeOffsetIndex index = platypus::TreeOffsetIndex::build(src);
+    fails += platypus::testing::compare_equal(num_trees, index.num_trees(), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(false, index.is_nexus(), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(static_cast<std::uint64_t>(src.size()), index.get_source_size(), __FILE__, __LINE__);
+
+    // single trees
+    for (std::size_t tree_idx : {24, 0, 7, 13}) {
+        TestDataTree tree;
+        tree_reader.read_at(std::istringstream(src), index, tree_idx, tree);
+        fails += platypus::testing::compare_equal(tree_writer.format(all_trees[tree_idx]), tree_writer.format(tree), __FILE__, __LINE__, "read_at");
+    }
+
+    // ranges, unaffected by skipping and thinning
+    tree_reader.set_skip_first(3);
+    tree_reader.set_every_nth(2);
+    std::vector<unsigned long> postprocessed;
+    tree_reader.set_tree_postprocess_fn([&postprocessed](TestDataTree &, unsigned long tree_idx, unsigned long, unsigned long, double) {
+        postprocessed.push_back(tree_idx);
+    });
+    std::vector<TestDataTree> trees;
+    auto tree_factory = [&trees]() -> TestDataTree & { trees.emplace_back(); return trees.back(); };
+    std::istringstream shared_src(src);
+    for (std::size_t begin_idx = 0; begin_idx < num_trees; begin_idx += 10) {
+        trees.clear();
+        postprocessed.clear();
+        unsigned long num_read = tree_reader.read_range(shared_src, index, begin_idx, begin_idx + 10, tree_factory);
+        std::size_t expected_num_read = std::min(num_trees - begin_idx, static_cast<std::size_t>(10));
+        fails += platypus::testing::compare_equal(expected_num_read, static_cast<std::size_t>(num_read), __FILE__, __LINE__);
+        fails += platypus::testing::compare_equal(
+                tree_writer.format(all_trees.begin() + begin_idx, all_trees.begin() + begin_idx + expected_num_read),
+                tree_writer.format(trees.begin(), trees.end()),
+                __FILE__, __LINE__, "read_range");
+        fails += platypus::testing::compare_equal(0UL, postprocessed[0], __FILE__, __LINE__);
+    }
+    fails += platypus::testing::compare_equal(3UL, tree_reader.get_skip_first(), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(2UL, tree_reader.get_every_nth(), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(0UL, tree_reader.read_range(shared_src, index, 30, 40, tree_factory), __FILE__, __LINE__);
+
+    // sidecar file
+    std::string source_path = "tree_offset_index.tmp.tre";
+    std::string index_path = source_path + ".idx";
+    {
+        std::ofstream f(source_path, std::ios::out | std::ios::binary);
+        f << src;
+    }
+    platypus::TreeOffsetIndex::build_from_file(source_path).save(index_path);
+    platypus::TreeOffsetIndex loaded = platypus::TreeOffsetIndex::load(index_path);
+    fails += platypus::testing::compare_equal(index.num_trees(), loaded.num_trees(), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(index.get_source_size(), loaded.get_source_size(), __FILE__, __LINE__);
+    for (std::size_t tree_idx = 0; tree_idx < index.num_trees(); ++tree_idx) {
+        fails += platypus::testing::compare_equal(index.get_tree_offset(tree_idx), loaded.get_tree_offset(tree_idx), __FILE__, __LINE__);
+    }
+    {
+        std::ifstream f(source_path, std::ios::in | std::ios::binary);
+        TestDataTree tree;
+        tree_reader.read_at(f, loaded, 18, tree);
+        fails += platypus::testing::compare_equal(tree_writer.format(all_trees[18]), tree_writer.format(tree), __FILE__, __LINE__, "sidecar");
+    }
+    std::remove(source_path.c_str());
+    std::remove(index_path.c_str());
+    bool caught = false;
+    try {
+        std::istringstream not_an_index("PLTB....");
+        platypus::TreeOffsetIndex::read(not_an_index);
+    } catch (const platypus::TreeOffsetIndexError &) {
+        caught = true;
+    }
+    fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__);
+
+    // NEXUS
+    std::string nexus = "#NEXUS\n"
+        "BEGIN TAXA; DIMENSIONS NTAX=3; TAXLABELS a b c; END;\n"
+        "Begin Trees;\n"
+        "    Translate 1 a, 2 b, 3 c;\n"
+        "    tree one = [&R] (1,(2,3));\n"
+        "    TREE two = [&R] ((1,2),3);\n"
+        "    tree 'three;' = [&U] (1,2,3);\n"
+        "End;\n"
+        "begin characters; end;\n";
+    platypus::TreeOffsetIndex nexus_index = platypus::TreeOffsetIndex::build(nexus);
+    fails += platypus::testing::compare_equal(true, nexus_index.is_nexus(), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(3UL, nexus_index.num_trees(), __FILE__, __LINE__);
+    auto statement_at = [&nexus](std::uint64_t offset) {
+        std::size_t begin = nexus.find_first_not_of(" \t\n", static_cast<std::size_t>(offset));
+        return nexus.substr(begin, 12);
+    };
+    fails += platypus::testing::compare_equal(std::string("Begin Trees;"), statement_at(nexus_index.get_trees_block_offset()), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(std::string("tree one ="), statement_at(nexus_index.get_tree_offset(0)).substr(0, 10), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(std::string("TREE two ="), statement_at(nexus_index.get_tree_offset(1)).substr(0, 10), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(std::string("tree 'three"), statement_at(nexus_index.get_tree_offset(2)).substr(0, 11), __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(std::string("End;"), statement_at(nexus_index.get_trees_block_end_offset()).substr(0, 4), __FILE__, __LINE__);
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
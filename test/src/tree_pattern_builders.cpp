@@ -0,0 +1,313 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <platypus/model/treepattern.hpp>
+#include <platypus/model/treenodearena.hpp>
+#include <platypus/numeric/rng.hpp>
+#include <platypus/utility/parallel.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::Tree<std::string, platypus::TreeNodeArena<platypus::TreeNode<std::string>>> ArenaTree;
+
+template <class TreeT>
+std::string compose_newick(TreeT & tree) {
+    std::ostringstream o;
+    write_newick(tree, o);
+    std::string result = o.str();
+    trim(result, " \t\n\r");
+    return result;
+}
+
+std::vector<std::string> make_labels(unsigned long num_leaves) {
+    std::vector<std::string> labels;
+    labels.reserve(num_leaves);
+    for (unsigned long idx = 0; idx < num_leaves; ++idx) {
+        labels.push_back("t" + std::to_string(idx));
+    }
+    return labels;
+}
+
+template <class TreeT>
+void count_nodes(TreeT & tree, unsigned long & num_leaves, unsigned long & num_internals) {
+    num_leaves = 0;
+    num_internals = 0;
+    for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+        if (ndi.is_leaf()) {
+            ++num_leaves;
+        } else {
+            ++num_internals;
+        }
+    }
+}
+
+int check_degenerate_sizes() {
+    int fails = 0;
+    {
+        std::vector<std::string> labels;
+        BasicTree tree;
+        platypus::build_maximally_balanced_tree(tree, labels.begin(), labels.end());
+        platypus::build_maximally_unbalanced_tree(tree, labels.begin(), labels.end());
+        unsigned long num_leaves = 0;
+        unsigned long num_internals = 0;
+        count_nodes(tree, num_leaves, num_internals);
+        fails += platypus::testing::compare_equal(1UL, num_leaves + num_internals, __FILE__, __LINE__, "empty leaf set");
+    }
+    for (unsigned long n = 1; n <= 4; ++n) {
+        std::vector<std::string> labels = make_labels(n);
+        BasicTree balanced;
+        platypus::build_maximally_balanced_tree(balanced, labels.begin(), labels.end());
+        BasicTree unbalanced;
+        platypus::build_maximally_unbalanced_tree(unbalanced, labels.begin(), labels.end());
+        for (auto tree : {&balanced, &unbalanced}) {
+            unsigned long num_leaves = 0;
+            unsigned long num_internals = 0;
+            count_nodes(*tree, num_leaves, num_internals);
+            fails += platypus::testing::compare_equal(n, num_leaves, __FILE__, __LINE__, "number of leaves, n = ", n);
+            fails += platypus::testing::compare_equal(n > 1 ? n - 1 : 1, num_internals, __FILE__, __LINE__, "number of internal nodes, n = ", n);
+        }
+    }
+    return fails;
+}
+
+int check_large_trees() {
+    int fails = 0;
+    const unsigned long num_tips = 200000;
+    std::vector<std::string> labels = make_labels(num_tips);
+    {
+        BasicTree tree;
+        platypus::build_maximally_balanced_tree(tree, labels.begin(), labels.end());
+        unsigned long num_leaves = 0;
+        unsigned long num_internals = 0;
+        count_nodes(tree, num_leaves, num_internals);
+        fails += platypus::testing::compare_equal(num_tips, num_leaves, __FILE__, __LINE__, "large balanced tree leaves");
+        fails += platypus::testing::compare_equal(num_tips - 1, num_internals, __FILE__, __LINE__, "large balanced tree internal nodes");
+    }
+    {
+        BasicTree tree;
+        platypus::build_maximally_unbalanced_tree(tree, labels.begin(), labels.end(), false);
+        unsigned long num_leaves = 0;
+        unsigned long num_internals = 0;
+        count_nodes(tree, num_leaves, num_internals);
+        fails += platypus::testing::compare_equal(num_tips, num_leaves, __FILE__, __LINE__, "large unbalanced tree leaves");
+        fails += platypus::testing::compare_equal(num_tips - 1, num_internals, __FILE__, __LINE__, "large unbalanced tree internal nodes");
+    }
+    return fails;
+}
+
+int check_arena_reservation() {
+    int fails = 0;
+    std::vector<std::string> labels = make_labels(5000);
+    ArenaTree tree;
+    unsigned long initial_slabs = tree.node_allocator().num_slabs();
+    platypus::build_maximally_balanced_tree(tree, labels.begin(), labels.end());
+    fails += platypus::testing::compare_equal(
+            initial_slabs + 1,
+            static_cast<unsigned long>(tree.node_allocator().num_slabs()),
+            __FILE__,
+            __LINE__,
+            "nodes not allocated from a single reserved slab");
+    unsigned long num_leaves = 0;
+    unsigned long num_internals = 0;
+    count_nodes(tree, num_leaves, num_internals);
+    fails += platypus::testing::compare_equal(5000UL, num_leaves, __FILE__, __LINE__, "arena tree leaves");
+    return fails;
+}
+
+int check_parent_array() {
+    int fails = 0;
+
+    // (d,(c,(a,b)e)f)g: children are added in order of index
+    std::vector<int> parents{4, 4, 5, 6, 5, 6, -1};
+    std::vector<std::string> values{"a", "b", "c", "d", "e", "f", "g"};
+    {
+        BasicTree tree;
+        platypus::build_from_parent_array(tree, parents, values);
+        fails += platypus::testing::compare_equal(
+                std::string("(d, (c, (a, b)e)f)g;"),
+                compose_newick(tree),
+                __FILE__,
+                __LINE__,
+                "tree built from parent array");
+    }
+    {
+        std::vector<unsigned int> unsigned_parents{6, 6, 6, 6, 6, 6, static_cast<unsigned int>(-1)};
+        BasicTree tree;
+        platypus::build_from_parent_array(tree, unsigned_parents, values);
+        fails += platypus::testing::compare_equal(
+                std::string("(a, b, c, d, e, f)g;"),
+                compose_newick(tree),
+                __FILE__,
+                __LINE__,
+                "tree built from unsigned parent array");
+    }
+
+    // a long chain: node i is a child of node i - 1
+    {
+        const long num_nodes = 200000;
+        std::vector<long> chain_parents;
+        std::vector<std::string> chain_values;
+        for (long idx = 0; idx < num_nodes; ++idx) {
+            chain_parents.push_back(idx - 1);
+            chain_values.push_back(std::to_string(idx));
+        }
+        BasicTree tree;
+        platypus::build_from_parent_array(tree, chain_parents, chain_values);
+        unsigned long num_leaves = 0;
+        unsigned long num_internals = 0;
+        count_nodes(tree, num_leaves, num_internals);
+        fails += platypus::testing::compare_equal(1UL, num_leaves, __FILE__, __LINE__, "chain leaves");
+        fails += platypus::testing::compare_equal(static_cast<unsigned long>(num_nodes - 1), num_internals, __FILE__, __LINE__, "chain internal nodes");
+    }
+
+    // invalid input
+    std::vector<std::vector<int>> bad_parents{
+        {4, 4, 5, 6, 5, 6},         // size mismatch
+        {4, 4, 5, 6, 5, 6, 6},      // no root
+        {4, 4, 5, -1, 5, 6, -1},    // two roots
+        {4, 4, 5, 6, 5, 9, -1},     // out of range
+        {4, 4, 5, 6, 5, -2, -1},    // out of range
+        {4, 4, 4, 6, 2, 6, -1},     // cycle: 2 -> 4 -> 2
+    };
+    for (auto & bad : bad_parents) {
+        BasicTree tree;
+        bool caught = false;
+        try {
+            platypus::build_from_parent_array(tree, bad, values);
+        } catch (const std::invalid_argument &) {
+            caught = true;
+        }
+        fails += platypus::testing::compare_equal(true, caught, __FILE__, __LINE__, "invalid parent array not rejected");
+    }
+    return fails;
+}
+
+// the topology of the subtree of ``nd``, independent of the order of children
+template <class NodeT>
+std::string canonical_topology(const NodeT * nd) {
+    if (nd->is_leaf()) {
+        return nd->value();
+    }
+    std::vector<std::string> subtrees;
+    for (auto ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+        subtrees.push_back(canonical_topology(ch));
+    }
+    std::sort(subtrees.begin(), subtrees.end());
+    std::string result = "(";
+    for (std::size_t idx = 0; idx < subtrees.size(); ++idx) {
+        result += (idx > 0 ? "," : "") + subtrees[idx];
+    }
+    return result + ")";
+}
+
+int check_uniform_random_trees() {
+    int fails = 0;
+    platypus::numeric::RandomNumberGenerator rng(3);
+    for (unsigned long n = 0; n <= 4; ++n) {
+        std::vector<std::string> labels = make_labels(n);
+        BasicTree tree;
+        platypus::build_uniform_random_tree(tree, labels.begin(), labels.end(), rng);
+        unsigned long num_leaves = 0;
+        unsigned long num_internals = 0;
+        count_nodes(tree, num_leaves, num_internals);
+        if (n == 0) {
+            fails += platypus::testing::compare_equal(1UL, num_leaves + num_internals, __FILE__, __LINE__, "random tree on empty leaf set");
+            continue;
+        }
+        fails += platypus::testing::compare_equal(n, num_leaves, __FILE__, __LINE__, "random tree leaves, n = ", n);
+        fails += platypus::testing::compare_equal(n > 1 ? n - 1 : 1, num_internals, __FILE__, __LINE__, "random tree internal nodes, n = ", n);
+    }
+    // each of the 15 rooted topologies on four leaves equally often
+    {
+        std::vector<std::string> labels = make_labels(4);
+        std::map<std::string, unsigned long> counts;
+        const unsigned long num_trees = 30000;
+        for (unsigned long idx = 0; idx < num_trees; ++idx) {
+            BasicTree tree;
+            platypus::build_uniform_random_tree(tree, labels.begin(), labels.end(), rng);
+            ++counts[canonical_topology(tree.head_node())];
+        }
+        fails += platypus::testing::compare_equal(15UL, static_cast<unsigned long>(counts.size()), __FILE__, __LINE__, "distinct topologies");
+        for (auto & entry : counts) {
+            // expecting 2000 +/- 43
+            if (entry.second < 1800 || entry.second > 2200) {
+                fails += platypus::testing::fail_test(__FILE__, __LINE__, 2000, entry.second, "topology ", entry.first);
+            }
+        }
+    }
+    // large trees, in a single reserved arena slab
+    {
+        std::vector<std::string> labels = make_labels(100000);
+        ArenaTree tree;
+        unsigned long initial_slabs = tree.node_allocator().num_slabs();
+        platypus::build_uniform_random_tree(tree, labels.begin(), labels.end(), rng);
+        fails += platypus::testing::compare_equal(initial_slabs + 1, static_cast<unsigned long>(tree.node_allocator().num_slabs()),
+                __FILE__, __LINE__, "random tree nodes not allocated from a single reserved slab");
+        unsigned long num_leaves = 0;
+        unsigned long num_internals = 0;
+        count_nodes(tree, num_leaves, num_internals);
+        fails += platypus::testing::compare_equal(100000UL, num_leaves, __FILE__, __LINE__, "large random tree leaves");
+        fails += platypus::testing::compare_equal(99999UL, num_internals, __FILE__, __LINE__, "large random tree internal nodes");
+    }
+    // edge lengths
+    {
+        std::vector<TestData> leaves;
+        for (auto & label : make_labels(5000)) {
+            leaves.push_back(TestData(label));
+        }
+        TestDataTree tree;
+        platypus::build_uniform_random_tree(tree, leaves.begin(), leaves.end(), rng,
+                [] (TestData & nv, double length) { nv.set_edge_length(length); }, 0.5);
+        double total = 0.0;
+        unsigned long num_edges = 0;
+        for (auto ndi = tree.preorder_begin(); ndi != tree.preorder_end(); ++ndi) {
+            if (ndi.node() != tree.head_node()) {
+                total += ndi->get_edge_length();
+                ++num_edges;
+            }
+        }
+        fails += platypus::testing::compare_equal(9998UL, num_edges, __FILE__, __LINE__, "edges");
+        if (std::fabs(total / num_edges - 0.5) > 0.03) {
+            fails += platypus::testing::fail_test(__FILE__, __LINE__, 0.5, total / num_edges, "mean edge length");
+        }
+        fails += platypus::testing::compare_equal(0.0, tree.head_node()->value().get_edge_length(), __FILE__, __LINE__, "head edge length");
+    }
+    // batches with a generator for each tree do not depend on the number of threads
+    {
+        std::vector<std::string> labels = make_labels(50);
+        std::vector<std::string> expected;
+        for (unsigned int num_threads : {1U, 4U}) {
+            std::vector<std::string> observed(64);
+            platypus::parallel_for(observed.size(), num_threads, [&] (std::size_t idx) {
+                auto replicate_rng = platypus::numeric::ReplicateRandomNumberGenerator<platypus::numeric::RandomNumberGenerator>::create(11, idx);
+                BasicTree tree;
+                platypus::build_uniform_random_tree(tree, labels.begin(), labels.end(), replicate_rng);
+                observed[idx] = compose_newick(tree);
+            });
+            if (expected.empty()) {
+                expected = observed;
+            }
+            fails += platypus::testing::compare_equal(true, expected == observed, __FILE__, __LINE__, "batch with threads: ", num_threads);
+        }
+    }
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_degenerate_sizes();
+    fails += check_large_trees();
+    fails += check_arena_reservation();
+    fails += check_parent_array();
+    fails += check_uniform_random_trees();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
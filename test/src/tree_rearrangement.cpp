@@ -0,0 +1,263 @@
+#include <stdlib.h>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <platypus/model/likelihood.hpp>
+#include <platypus/model/parsimony.hpp>
+#include <platypus/model/treerearrangement.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree TreeType;
+typedef TreeType::node_type NodeType;
+typedef platypus::TreeRearrangements<TreeType> RearrangementsType;
+
+// random tree on taxa t0, ..., t{num_taxa-1}, joining two (or, if
+// ``with_polytomies``, sometimes three) subtrees at a time, and with a head
+// node of ``head_degree`` children (if possible)
+std::string random_tree_string(std::mt19937 & rng, int num_taxa, bool with_polytomies, std::size_t head_degree) {
+    std::uniform_int_distribution<int> length(1, 100);
+    std::vector<std::string> subtrees;
+    for (int i = 0; i < num_taxa; ++i) {
+        subtrees.push_back("t" + std::to_string(i) + ":" + std::to_string(length(rng) / 8.0));
+    }
+    while (subtrees.size() > head_degree) {
+        std::size_t num_joined = with_polytomies && rng() % 3 == 0 && subtrees.size() > head_degree + 1 ? 3 : 2;
+        std::string joined = "(";
+        for (std::size_t k = 0; k < num_joined; ++k) {
+            std::size_t i = rng() % subtrees.size();
+            joined += (k > 0 ? "," : "") + subtrees[i];
+            subtrees.erase(subtrees.begin() + i);
+        }
+        subtrees.push_back(joined + "):" + std::to_string(length(rng) / 8.0));
+    }
+    std::string newick = "(";
+    for (std::size_t k = 0; k < subtrees.size(); ++k) {
+        newick += (k > 0 ? "," : "") + subtrees[k];
+    }
+    return newick + ");";
+}
+
+// the exact structure, labels and edge lengths
+void write_exact(const NodeType * nd, std::ostream & out) {
+    if (!nd->is_leaf()) {
+        out << "(";
+        for (const NodeType * ch = nd->first_child_node(); ch != nullptr; ch = ch->next_sibling_node()) {
+            out << (ch != nd->first_child_node() ? "," : "");
+            write_exact(ch, out);
+        }
+        out << ")";
+    }
+    out << nd->value().get_label() << ":" << nd->value().get_edge_length();
+}
+
+std::string exact_string(const TreeType & tree) {
+    std::ostringstream out;
+    out.precision(17);
+    write_exact(tree.head_node(), out);
+    return out.str();
+}
+
+// the splits of the edges of ``tree``, as reported by TreeRearrangements
+std::set<platypus::Split> edge_splits(const TreeType & tree, const platypus::TaxonNamespace & taxa, bool is_rooted) {
+    auto taxon_index_fn = [&taxa] (const TestData & nv) { return taxa.find_taxon(nv.get_label()); };
+    platypus::SplitSet splits(tree, taxa.size(), taxon_index_fn, false);
+    std::size_t num_tree_taxa = splits.count(splits.size() - 1);
+    std::set<platypus::Split> result;
+    for (std::size_t idx = 0; idx < splits.size(); ++idx) {
+        std::size_t n = splits.count(idx);
+        if (n < 2 || (is_rooted ? n >= num_tree_taxa : n + 2 > num_tree_taxa)) {
+            continue;
+        }
+        platypus::Split split = splits.get_split(idx);
+        if (!is_rooted) {
+            split.normalize();
+        }
+        result.insert(split);
+    }
+    return result;
+}
+
+std::vector<platypus::Split> difference(const std::set<platypus::Split> & a, const std::set<platypus::Split> & b) {
+    std::vector<platypus::Split> result;
+    for (auto & split : a) {
+        if (b.count(split) == 0) {
+            result.push_back(split);
+        }
+    }
+    return result;
+}
+
+int check_neighborhood_sizes() {
+    int fails = 0;
+    std::mt19937 rng(3);
+    for (int num_taxa : {4, 7, 12}) {
+        for (std::size_t head_degree : {2, 3}) {
+            platypus::TaxonNamespace taxa;
+            TreeType tree = read_tree(random_tree_string(rng, num_taxa, false, head_degree));
+            for (int idx = 0; idx < num_taxa; ++idx) {
+                taxa.add_taxon("t" + std::to_string(idx));
+            }
+            auto taxon_index_fn = [&taxa] (const TestData & nv) { return taxa.find_taxon(nv.get_label()); };
+            std::set<platypus::Split> original = edge_splits(tree, taxa, false);
+            for (bool is_rooted : {false, true}) {
+                RearrangementsType rearrangements(tree, taxa.size(), taxon_index_fn, is_rooted);
+                std::vector<RearrangementsType::Move> moves;
+                rearrangements.nni_moves(moves);
+                if (!is_rooted) {
+                    fails += platypus::testing::compare_equal(2UL * (num_taxa - 3), moves.size(), __FILE__, __LINE__,
+                            "unrooted NNI moves, taxa: ", num_taxa, ", head degree: ", head_degree);
+                } else if (head_degree == 2) {
+                    fails += platypus::testing::compare_equal(2UL * (num_taxa - 2), moves.size(), __FILE__, __LINE__,
+                            "rooted NNI moves, taxa: ", num_taxa);
+                }
+                if (is_rooted) {
+                    continue;
+                }
+                // distinct unrooted neighbors, none the original tree
+                moves.clear();
+                rearrangements.nni_moves(moves);
+                std::size_t num_nni = moves.size();
+                rearrangements.spr_moves(moves);
+                std::set<std::set<platypus::Split>> nni_neighbors;
+                std::set<std::set<platypus::Split>> spr_neighbors;
+                for (std::size_t idx = 0; idx < moves.size(); ++idx) {
+                    rearrangements.apply(moves[idx]);
+                    std::set<platypus::Split> neighbor = edge_splits(tree, taxa, false);
+                    rearrangements.undo();
+                    if (neighbor == original) {
+                        fails += platypus::testing::fail_test(__FILE__, __LINE__, "", "", "move ", idx, " gives the same tree");
+                    }
+                    (idx < num_nni ? nni_neighbors : spr_neighbors).insert(neighbor);
+                }
+                fails += platypus::testing::compare_equal(num_nni, nni_neighbors.size(), __FILE__, __LINE__, "distinct NNI neighbors");
+                fails += platypus::testing::compare_equal(2UL * (num_taxa - 3) * (2 * num_taxa - 7), spr_neighbors.size(), __FILE__, __LINE__,
+                        "distinct SPR neighbors, taxa: ", num_taxa, ", head degree: ", head_degree);
+            }
+        }
+    }
+    return fails;
+}
+
+int check_moves() {
+    int fails = 0;
+    std::mt19937 rng(17);
+    const int num_taxa = 11;
+    platypus::TaxonNamespace taxa;
+    platypus::NucleotideCharacterMatrix matrix(platypus::CharacterStateAlphabet::dna(), &taxa);
+    add_random_sequences(matrix, num_taxa, 40, rng);
+    auto taxon_index_fn = [&taxa] (const TestData & nv) { return taxa.find_taxon(nv.get_label()); };
+    auto edge_length_fn = [] (const TestData & nv) { return nv.get_edge_length(); };
+    auto edge_length_setter = [] (TestData & nv, double length) { nv.set_edge_length(length); };
+    auto model = platypus::SubstitutionModel::hky85(2.0, {0.3, 0.2, 0.2, 0.3});
+    platypus::FitchParsimony<std::uint8_t> scorer(matrix);
+    platypus::TreeLikelihood<TreeType, std::uint8_t> fresh_likelihood(matrix, model, taxon_index_fn, edge_length_fn, 4, 0.5);
+    for (bool with_polytomies : {false, true}) {
+        for (std::size_t head_degree : {2, 3}) {
+            for (bool is_rooted : {false, true}) {
+                TreeType tree = read_tree(random_tree_string(rng, num_taxa, with_polytomies, head_degree));
+                const std::string original = exact_string(tree);
+                const double original_length = tree_length(tree);
+                platypus::IncrementalFitchParsimony<TreeType, std::uint8_t> parsimony(matrix, taxon_index_fn);
+                parsimony.score(tree);
+                platypus::TreeLikelihood<TreeType, std::uint8_t> likelihood(matrix, model, taxon_index_fn, edge_length_fn, 4, 0.5);
+                double original_log_likelihood = likelihood.log_likelihood(tree);
+                RearrangementsType rearrangements(tree, taxa.size(), taxon_index_fn, is_rooted);
+                std::vector<RearrangementsType::Move> moves;
+                rearrangements.nni_moves(moves);
+                rearrangements.spr_moves(moves);
+                std::set<platypus::Split> splits = edge_splits(tree, taxa, is_rooted);
+                std::vector<platypus::Split> lost;
+                std::vector<platypus::Split> gained;
+                for (std::size_t idx = 0; idx < moves.size(); ++idx) {
+                    rearrangements.get_split_changes(moves[idx], lost, gained);
+                    rearrangements.apply(moves[idx], edge_length_fn, edge_length_setter, 0.25);
+                    std::set<platypus::Split> neighbor_splits = edge_splits(tree, taxa, is_rooted);
+                    fails += platypus::testing::compare_equal(true, difference(splits, neighbor_splits) == lost, __FILE__, __LINE__,
+                            "lost splits, move ", idx, ", polytomies: ", with_polytomies, ", rooted: ", is_rooted);
+                    fails += platypus::testing::compare_equal(true, difference(neighbor_splits, splits) == gained, __FILE__, __LINE__,
+                            "gained splits, move ", idx, ", polytomies: ", with_polytomies, ", rooted: ", is_rooted);
+                    if (std::fabs(original_length - tree_length(tree)) > 1e-9) {
+                        fails += platypus::testing::fail_test(__FILE__, __LINE__, original_length, tree_length(tree), "tree length, move ", idx);
+                    }
+                    fails += platypus::testing::compare_equal(scorer.score(tree, taxon_index_fn),
+                            parsimony.rescore(tree, rearrangements.modified_nodes()),
+                            __FILE__, __LINE__, "parsimony rescore, move ", idx);
+                    double expected = fresh_likelihood.log_likelihood(tree);
+                    double updated = likelihood.update_log_likelihood(tree, rearrangements.relinked_nodes());
+                    if (std::fabs(expected - updated) > 1e-9 * (1.0 + std::fabs(expected))) {
+                        fails += platypus::testing::fail_test(__FILE__, __LINE__, expected, updated, "likelihood update, move ", idx);
+                    }
+                    rearrangements.undo(edge_length_setter);
+                    fails += platypus::testing::compare_equal(original, exact_string(tree), __FILE__, __LINE__, "undo, move ", idx);
+                    std::uint64_t restored = parsimony.rescore(tree, rearrangements.modified_nodes());
+                    fails += platypus::testing::compare_equal(scorer.score(tree, taxon_index_fn), restored, __FILE__, __LINE__, "parsimony after undo");
+                    updated = likelihood.update_log_likelihood(tree, rearrangements.relinked_nodes());
+                    if (std::fabs(original_log_likelihood - updated) > 1e-9 * (1.0 + std::fabs(updated))) {
+                        fails += platypus::testing::fail_test(__FILE__, __LINE__, original_log_likelihood, updated, "likelihood after undo, move ", idx);
+                    }
+                }
+            }
+        }
+    }
+    return fails;
+}
+
+// a walk of kept moves, checking the splits after each
+int check_walk() {
+    int fails = 0;
+    std::mt19937 rng(23);
+    const int num_taxa = 9;
+    platypus::TaxonNamespace taxa;
+    for (int idx = 0; idx < num_taxa; ++idx) {
+        taxa.add_taxon("t" + std::to_string(idx));
+    }
+    auto taxon_index_fn = [&taxa] (const TestData & nv) { return taxa.find_taxon(nv.get_label()); };
+    TreeType tree = read_tree(random_tree_string(rng, num_taxa, true, 3));
+    RearrangementsType rearrangements(tree, taxa.size(), taxon_index_fn, false);
+    std::vector<RearrangementsType::Move> moves;
+    std::vector<platypus::Split> lost;
+    std::vector<platypus::Split> gained;
+    for (int step = 0; step < 60; ++step) {
+        moves.clear();
+        if (step % 2 == 0) {
+            rearrangements.nni_moves(moves);
+        } else {
+            rearrangements.spr_moves(moves);
+        }
+        if (moves.empty()) {
+            continue;
+        }
+        auto & move = moves[rng() % moves.size()];
+        std::set<platypus::Split> splits = edge_splits(tree, taxa, false);
+        rearrangements.get_split_changes(move, lost, gained);
+        rearrangements.apply(move);
+        rearrangements.commit();
+        std::set<platypus::Split> neighbor_splits = edge_splits(tree, taxa, false);
+        fails += platypus::testing::compare_equal(true, difference(splits, neighbor_splits) == lost, __FILE__, __LINE__, "lost splits, step ", step);
+        fails += platypus::testing::compare_equal(true, difference(neighbor_splits, splits) == gained, __FILE__, __LINE__, "gained splits, step ", step);
+        std::size_t num_leaves = 0;
+        for (auto ndi = tree.leaf_begin(); ndi != tree.leaf_end(); ++ndi) {
+            ++num_leaves;
+        }
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(num_taxa), num_leaves, __FILE__, __LINE__, "leaves, step ", step);
+    }
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_neighborhood_sizes();
+    fails += check_moves();
+    fails += check_walk();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
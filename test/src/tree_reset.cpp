@@ -0,0 +1,203 @@
+#include <stdlib.h>
+#include <memory>
+#include <sstream>
+#include <vector>
+#include <platypus/model/treenodearena.hpp>
+#include <platypus/parse/newick.hpp>
+#include <platypus/serialize/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+static unsigned long NUM_NODE_ALLOCATIONS = 0;
+static unsigned long NUM_NODE_DEALLOCATIONS = 0;
+
+template <class T>
+class CountingAllocator : public std::allocator<T> {
+    public:
+        template <class U> struct rebind {
+            typedef CountingAllocator<U> other;
+        };
+        CountingAllocator() { }
+        CountingAllocator(const CountingAllocator & other)
+            : std::allocator<T>(other) { }
+        CountingAllocator & operator=(const CountingAllocator &) = default;
+        template <class U> CountingAllocator(const CountingAllocator<U> & other)
+            : std::allocator<T>(other) { }
+        T * allocate(std::size_t n, const void * =0) {
+            NUM_NODE_ALLOCATIONS += n;
+            return std::allocator<T>::allocate(n);
+        }
+        void deallocate(T * p, std::size_t n) {
+            NUM_NODE_DEALLOCATIONS += n;
+            std::allocator<T>::deallocate(p, n);
+        }
+}; // CountingAllocator
+
+typedef platypus::StandardTree<TestData, CountingAllocator<platypus::TreeNode<TestData>>> CountingTree;
+typedef platypus::StandardTree<TestData, platypus::TreeNodeArena<platypus::TreeNode<TestData>>> ArenaTree;
+
+template <class TreeT>
+int check_node_values_reset(TreeT & tree) {
+    int fails = 0;
+    fails += platypus::testing::compare_equal(
+            std::string(""),
+            tree.head_node()->value().get_label(),
+            __FILE__,
+            __LINE__,
+            "root value not reset");
+    fails += platypus::testing::compare_equal(
+            true,
+            tree.head_node()->is_leaf(),
+            __FILE__,
+            __LINE__,
+            "root still has children");
+    return fails;
+}
+
+int main() {
+
+    int fails = 0;
+
+    // reset() retains nodes
+    CountingTree tree;
+    build_tree(tree, STANDARD_TEST_TREE_STRING);
+    fails += compare_against_standard_test_tree(tree);
+    unsigned long num_allocations = NUM_NODE_ALLOCATIONS;
+    unsigned long num_deallocations = NUM_NODE_DEALLOCATIONS;
+    tree.reset();
+    fails += check_node_values_reset(tree);
+    // 14 nodes in the standard test tree, apart from the root
+    fails += platypus::testing::compare_equal(
+            14UL,
+            static_cast<unsigned long>(tree.num_spare_nodes()),
+            __FILE__,
+            __LINE__,
+            "incorrect number of spare nodes");
+    for (int i = 0; i < 10; ++i) {
+        build_tree(tree, STANDARD_TEST_TREE_STRING);
+        fails += compare_against_standard_test_tree(tree);
+        tree.reset();
+    }
+    fails += platypus::testing::compare_equal(
+            num_allocations,
+            NUM_NODE_ALLOCATIONS,
+            __FILE__,
+            __LINE__,
+            "nodes allocated when rebuilding reset tree");
+    fails += platypus::testing::compare_equal(
+            num_deallocations,
+            NUM_NODE_DEALLOCATIONS,
+            __FILE__,
+            __LINE__,
+            "nodes deallocated when resetting tree");
+
+    // spare nodes can be released
+    tree.release_spare_nodes();
+    fails += platypus::testing::compare_equal(
+            0UL,
+            static_cast<unsigned long>(tree.num_spare_nodes()),
+            __FILE__,
+            __LINE__,
+            "spare nodes not released");
+    fails += platypus::testing::compare_equal(
+            num_deallocations + 14,
+            NUM_NODE_DEALLOCATIONS,
+            __FILE__,
+            __LINE__,
+            "spare nodes not deallocated");
+    build_tree(tree, STANDARD_TEST_TREE_STRING);
+    fails += compare_against_standard_test_tree(tree);
+
+    // recycling mode: clear() and dispose_node() retain nodes
+    tree.set_node_recycling(true);
+    tree.clear();
+    fails += check_node_values_reset(tree);
+    build_tree(tree, STANDARD_TEST_TREE_STRING);
+    auto extra_node = tree.create_leaf_node();
+    num_allocations = NUM_NODE_ALLOCATIONS;
+    tree.dispose_node(extra_node);
+    fails += platypus::testing::compare_equal(
+            1UL,
+            static_cast<unsigned long>(tree.num_spare_nodes()),
+            __FILE__,
+            __LINE__,
+            "disposed node not recycled");
+    tree.clear();
+    build_tree(tree, STANDARD_TEST_TREE_STRING);
+    fails += compare_against_standard_test_tree(tree);
+    fails += platypus::testing::compare_equal(
+            num_allocations,
+            NUM_NODE_ALLOCATIONS,
+            __FILE__,
+            __LINE__,
+            "nodes allocated when rebuilding cleared tree in recycling mode");
+
+    // spare nodes are carried over on moves, and disposed of with the tree
+    tree.reset();
+    CountingTree tree2(std::move(tree));
+    fails += platypus::testing::compare_equal(
+            15UL,
+            static_cast<unsigned long>(tree2.num_spare_nodes()),
+            __FILE__,
+            __LINE__,
+            "spare nodes not carried over on move");
+    tree.clear();
+    build_tree(tree, STANDARD_TEST_TREE_STRING);
+    fails += compare_against_standard_test_tree(tree);
+
+    // streaming a source into a recycling tree
+    std::ostringstream o;
+    for (int i = 0; i < 20; ++i) {
+        o << "((a" << i << ":1, b:2)c:3, (d:4, (e:5, f:" << i << ")g:6)h:7)i;\n";
+    }
+    auto tree_reader = get_test_data_tree_newick_reader<CountingTree>();
+    auto writer = get_standard_newick_writer<CountingTree>();
+    std::vector<std::string> expected;
+    tree_reader.read_each(std::istringstream(o.str()), [&](CountingTree & t, unsigned long) {
+        std::ostringstream s;
+        writer.write(s, t);
+        expected.push_back(s.str());
+    });
+    CountingTree reused;
+    reused.set_node_recycling(true);
+    std::vector<std::string> observed;
+    unsigned long num_allocations_after_first = 0;
+    tree_reader.read_each(std::istringstream(o.str()), reused, [&](CountingTree & t, unsigned long idx) {
+        std::ostringstream s;
+        writer.write(s, t);
+        observed.push_back(s.str());
+        if (idx == 0) {
+            num_allocations_after_first = NUM_NODE_ALLOCATIONS;
+        }
+    });
+    fails += platypus::testing::compare_equal(expected, observed, __FILE__, __LINE__);
+    fails += platypus::testing::compare_equal(
+            num_allocations_after_first,
+            NUM_NODE_ALLOCATIONS,
+            __FILE__,
+            __LINE__,
+            "nodes allocated when streaming into recycling tree");
+
+    // arena-allocated trees
+    ArenaTree arena_tree;
+    build_tree(arena_tree, STANDARD_TEST_TREE_STRING);
+    unsigned long num_live = arena_tree.node_allocator().size();
+    for (int i = 0; i < 5; ++i) {
+        arena_tree.reset();
+        build_tree(arena_tree, STANDARD_TEST_TREE_STRING);
+        fails += compare_against_standard_test_tree(arena_tree);
+    }
+    fails += platypus::testing::compare_equal(
+            num_live,
+            static_cast<unsigned long>(arena_tree.node_allocator().size()),
+            __FILE__,
+            __LINE__,
+            "arena nodes allocated when rebuilding reset tree");
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
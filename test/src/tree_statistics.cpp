@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include <platypus/model/treestatistics.hpp>
+#include <platypus/model/treepattern.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TestDataTree TreeType;
+typedef platypus::TreeStatistics<TreeType> StatisticsType;
+
+std::vector<TestData> get_leaves(unsigned long num_leaves) {
+    std::vector<TestData> leaves;
+    for (unsigned long idx = 0; idx < num_leaves; ++idx) {
+        leaves.emplace_back("t" + std::to_string(idx));
+    }
+    return leaves;
+}
+
+int check_close(double expected, double observed, const char * file, int line, const std::string & remarks) {
+    if (std::fabs(expected - observed) > 1e-10 * std::max(1.0, std::fabs(expected))) {
+        return platypus::testing::fail_test(file, line, expected, observed, remarks);
+    }
+    return 0;
+}
+
+int check_extremes() {
+    int fails = 0;
+    StatisticsType statistics;
+    // maximally balanced trees on 2^k leaves
+    for (unsigned long k = 1; k <= 7; ++k) {
+        unsigned long n = 1UL << k;
+        auto leaves = get_leaves(n);
+        TreeType tree;
+        platypus::build_maximally_balanced_tree(tree, leaves.begin(), leaves.end());
+        auto values = statistics.compute(tree);
+        std::string remarks = "balanced tree of " + std::to_string(n) + " leaves";
+        fails += platypus::testing::compare_equal(n, values.num_leaves, __FILE__, __LINE__, remarks);
+        fails += platypus::testing::compare_equal(0UL, values.colless, __FILE__, __LINE__, remarks);
+        fails += platypus::testing::compare_equal(n * k, values.sackin, __FILE__, __LINE__, remarks);
+        fails += platypus::testing::compare_equal(n / 2, values.cherries, __FILE__, __LINE__, remarks);
+        double b1 = 0.0;
+        for (unsigned long level = 1; level < k; ++level) {
+            // 2^level nodes of height k - level
+            b1 += static_cast<double>(1UL << level) / (k - level);
+        }
+        fails += check_close(b1, values.b1, __FILE__, __LINE__, remarks + ": b1");
+    }
+    // maximally unbalanced trees
+    for (unsigned long n : {2UL, 3UL, 10UL, 57UL}) {
+        auto leaves = get_leaves(n);
+        TreeType tree;
+        platypus::build_maximally_unbalanced_tree(tree, leaves.begin(), leaves.end());
+        auto values = statistics.compute(tree);
+        std::string remarks = "unbalanced tree of " + std::to_string(n) + " leaves";
+        fails += platypus::testing::compare_equal(n, values.num_leaves, __FILE__, __LINE__, remarks);
+        fails += platypus::testing::compare_equal((n - 1) * (n - 2) / 2, values.colless, __FILE__, __LINE__, remarks);
+        fails += platypus::testing::compare_equal(n * (n + 1) / 2 - 1, values.sackin, __FILE__, __LINE__, remarks);
+        fails += platypus::testing::compare_equal(1UL, values.cherries, __FILE__, __LINE__, remarks);
+        double b1 = 0.0;
+        for (unsigned long height = 1; height + 1 < n; ++height) {
+            b1 += 1.0 / height;
+        }
+        fails += check_close(b1, values.b1, __FILE__, __LINE__, remarks + ": b1");
+    }
+    return fails;
+}
+
+int check_edge_lengths() {
+    int fails = 0;
+    StatisticsType statistics(get_edge_length);
+    {
+        // ultrametric, with branching times 3, 2 and 1
+        auto values = statistics.compute(read_tree("(((a:1,b:1):1,c:2):1,d:3):5;"));
+        fails += check_close(9.0, values.tree_length, __FILE__, __LINE__, "tree length");
+        fails += check_close(3.0, values.tree_height, __FILE__, __LINE__, "tree height");
+        // intervals of 1 with 2, 3 and 4 lineages
+        double expected = ((2.0 + 5.0) / 2.0 - 9.0 / 2.0) / (9.0 * std::sqrt(1.0 / 24.0));
+        fails += check_close(expected, values.gamma, __FILE__, __LINE__, "gamma");
+    }
+    {
+        // a polytomy is equivalent to simultaneous branchings
+        auto resolved = statistics.compute(read_tree("(((a:1,b:1):0,c:1):2,(d:2,e:2):1);"));
+        auto polytomy = statistics.compute(read_tree("((a:1,b:1,c:1):2,(d:2,e:2):1);"));
+        fails += check_close(resolved.gamma, polytomy.gamma, __FILE__, __LINE__, "gamma with polytomy");
+        fails += check_close(resolved.tree_height, polytomy.tree_height, __FILE__, __LINE__, "height with polytomy");
+        fails += platypus::testing::compare_equal(resolved.sackin - 2, polytomy.sackin, __FILE__, __LINE__, "sackin with polytomy");
+        fails += platypus::testing::compare_equal(1UL, polytomy.cherries, __FILE__, __LINE__, "cherries with polytomy");
+    }
+    {
+        auto values = statistics.compute(read_tree("(a:1,b:2);"));
+        fails += platypus::testing::compare_equal(true, std::isnan(values.gamma), __FILE__, __LINE__, "gamma of two leaves");
+        fails += check_close(2.0, values.tree_height, __FILE__, __LINE__, "height of two leaves");
+    }
+    return fails;
+}
+
+int check_tabulate() {
+    int fails = 0;
+    std::mt19937 rng(3);
+    std::vector<TreeType> trees;
+    for (int idx = 0; idx < 600; ++idx) {
+        auto leaves = get_leaves(3 + rng() % 40);
+        for (auto & leaf : leaves) {
+            leaf.set_edge_length(1.0 + rng() % 5);
+        }
+        trees.emplace_back();
+        if (rng() % 2) {
+            platypus::build_maximally_balanced_tree(trees.back(), leaves.begin(), leaves.end());
+        } else {
+            platypus::build_maximally_unbalanced_tree(trees.back(), leaves.begin(), leaves.end());
+        }
+    }
+    StatisticsType statistics(get_edge_length);
+    for (unsigned int num_threads : {1U, 4U}) {
+        platypus::DataTable table;
+        statistics.tabulate(trees.begin(), trees.begin() + 100, table, num_threads);
+        statistics.tabulate(trees.begin() + 100, trees.end(), table, num_threads);
+        fails += platypus::testing::compare_equal(trees.size(), static_cast<std::size_t>(table.num_rows()), __FILE__, __LINE__, "rows, threads: ", num_threads);
+        auto tree_handle = table.column_handle<unsigned long>("tree");
+        auto colless_handle = table.column_handle<unsigned long>("colless");
+        auto sackin_handle = table.column_handle<unsigned long>("sackin");
+        auto length_handle = table.column_handle<double>("tree_length");
+        auto gamma_handle = table.column_handle<double>("gamma");
+        for (std::size_t idx = 0; idx < trees.size(); ++idx) {
+            auto values = statistics.compute(trees[idx]);
+            if (table.get(idx, tree_handle) != idx
+                    || table.get(idx, colless_handle) != values.colless
+                    || table.get(idx, sackin_handle) != values.sackin
+                    || table.get(idx, length_handle) != values.tree_length
+                    || !(table.get(idx, gamma_handle) == values.gamma)) {
+                fails += platypus::testing::fail_test(__FILE__, __LINE__, "", "", "row ", idx, ", threads: ", num_threads);
+            }
+        }
+    }
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    fails += check_extremes();
+    fails += check_edge_lengths();
+    fails += check_tabulate();
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,144 @@
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <platypus/model/treestore.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef platypus::FlatTree<double> FlatTreeType;
+typedef platypus::TreeStoreView::index_type IndexType;
+
+// the store's data, copied to 8-byte aligned memory
+std::vector<std::uint64_t> aligned_copy(const std::string & data) {
+    std::vector<std::uint64_t> buffer((data.size() + 7) / 8);
+    std::memcpy(buffer.data(), data.data(), data.size());
+    return buffer;
+}
+
+int check_view(const FlatTreeType & expected, const platypus::TreeStoreView & view, const std::string & remarks) {
+    int fails = 0;
+    fails += platypus::testing::compare_equal(expected.size(), view.size(), __FILE__, __LINE__, remarks, ": size");
+    fails += platypus::testing::compare_equal(expected.num_leaves(), view.num_leaves(), __FILE__, __LINE__, remarks, ": leaves");
+    if (expected.size() != view.size()) {
+        return fails;
+    }
+    std::vector<IndexType> expected_structure;
+    std::vector<IndexType> observed_structure;
+    std::vector<std::string> expected_labels;
+    std::vector<std::string> observed_labels;
+    std::vector<double> observed_edge_lengths;
+    for (auto nd = expected.preorder_begin(); nd != expected.preorder_end(); ++nd) {
+        for (IndexType value : {expected.parent(*nd), expected.first_child(*nd), expected.next_sibling(*nd),
+                expected.num_children(*nd), expected.subtree_end(*nd), static_cast<IndexType>(expected.num_leaves(*nd)),
+                static_cast<IndexType>(expected.leaf_offset(*nd)), static_cast<IndexType>(expected.is_leaf(*nd))}) {
+            expected_structure.push_back(value);
+        }
+        expected_labels.push_back(expected.label(*nd));
+    }
+    for (auto nd = view.preorder_begin(); nd != view.preorder_end(); ++nd) {
+        for (IndexType value : {view.parent(*nd), view.first_child(*nd), view.next_sibling(*nd),
+                view.num_children(*nd), view.subtree_end(*nd), static_cast<IndexType>(view.num_leaves(*nd)),
+                static_cast<IndexType>(view.leaf_offset(*nd)), static_cast<IndexType>(view.is_leaf(*nd))}) {
+            observed_structure.push_back(value);
+        }
+        observed_labels.push_back(view.label(*nd).str());
+        observed_edge_lengths.push_back(view.edge_length(*nd));
+    }
+    fails += platypus::testing::compare_equal(expected_structure, observed_structure, __FILE__, __LINE__, remarks, ": structure");
+    fails += platypus::testing::compare_equal(expected_labels, observed_labels, __FILE__, __LINE__, remarks, ": labels");
+    fails += platypus::testing::compare_equal(expected.edge_lengths(), observed_edge_lengths, __FILE__, __LINE__, remarks, ": edge lengths");
+    fails += platypus::testing::compare_equal(
+            std::vector<IndexType>(expected.postorder_begin(), expected.postorder_end()),
+            std::vector<IndexType>(view.postorder_begin(), view.postorder_end()),
+            __FILE__, __LINE__, remarks, ": postorder");
+    fails += platypus::testing::compare_equal(
+            std::vector<IndexType>(expected.leaf_begin(), expected.leaf_end()),
+            std::vector<IndexType>(view.leaf_begin(), view.leaf_end()),
+            __FILE__, __LINE__, remarks, ": leaves");
+    IndexType clade = expected.size() > 1 ? 1 : 0;
+    fails += platypus::testing::compare_equal(
+            std::vector<IndexType>(expected.leaf_begin(clade), expected.leaf_end(clade)),
+            std::vector<IndexType>(view.leaf_begin(clade), view.leaf_end(clade)),
+            __FILE__, __LINE__, remarks, ": leaves of clade");
+    return fails;
+}
+
+int main() {
+    int fails = 0;
+    std::vector<std::string> sources{
+        STANDARD_TEST_TREE_NEWICK,
+        "((a:1,b:2)c:3,(d:4,(e:5,f:6,g:7):8):9,h:10):11;",
+        "(a:2);",
+        "((((a,b),c),d),(e,(f,(g,h))));",
+    };
+    std::vector<FlatTreeType> flat_trees;
+    platypus::TreeStoreWriter writer;
+    for (auto & src : sources) {
+        auto trees = get_test_data_tree_vector_from_string<TestDataTree>(src);
+        flat_trees.push_back(build_flat_tree(trees[0]));
+        writer.add_tree(trees[0], get_label, get_edge_length);
+    }
+    fails += platypus::testing::compare_equal(sources.size(), writer.num_trees(), __FILE__, __LINE__, "trees added");
+
+    std::ostringstream out;
+    writer.write(out);
+    std::string data = out.str();
+    fails += platypus::testing::compare_equal(static_cast<std::size_t>(0), data.size() % 8, __FILE__, __LINE__, "padded size");
+    std::vector<std::uint64_t> buffer = aligned_copy(data);
+    {
+        platypus::TreeStore store(reinterpret_cast<const char *>(buffer.data()), data.size());
+        fails += platypus::testing::compare_equal(sources.size(), store.num_trees(), __FILE__, __LINE__, "number of trees");
+        // labels are pooled: those of the others are all in the first tree
+        fails += platypus::testing::compare_equal(static_cast<std::size_t>(16), store.num_labels(), __FILE__, __LINE__, "number of labels");
+        fails += platypus::testing::compare_equal(std::string("a"), store.label(0).str(), __FILE__, __LINE__, "first label");
+        for (std::size_t tree_idx = 0; tree_idx < store.num_trees(); ++tree_idx) {
+            fails += check_view(flat_trees[tree_idx], store.tree(tree_idx), "tree " + std::to_string(tree_idx));
+        }
+        // iterators outlive the view they came from
+        auto postorder = store.tree(1).postorder_begin();
+        fails += platypus::testing::compare_equal(2U, *postorder, __FILE__, __LINE__, "iterator of temporary view");
+
+        TestDataTree copy;
+        store.tree(1).copy_to(copy,
+                [](TestData & nv, const std::string & label) { nv.set_label(label); },
+                [](TestData & nv, double length) { nv.set_edge_length(length); });
+        fails += check_view(flat_trees[1], platypus::TreeStore(reinterpret_cast<const char *>(buffer.data()), data.size()).tree(1), "store re-opened");
+        fails += platypus::testing::compare_equal(flat_trees[1].labels(), build_flat_tree(copy).labels(), __FILE__, __LINE__, "copy_to() labels");
+        fails += platypus::testing::compare_equal(flat_trees[1].edge_lengths(), build_flat_tree(copy).edge_lengths(), __FILE__, __LINE__, "copy_to() edge lengths");
+        fails += platypus::testing::compare_equal(flat_trees[1].parents(), build_flat_tree(copy).parents(), __FILE__, __LINE__, "copy_to() structure");
+    }
+
+    // memory-mapped file
+    std::string path = "tree_store_test.pts";
+    writer.write_file(path);
+    {
+        platypus::TreeStore store(path);
+        for (std::size_t tree_idx = 0; tree_idx < store.num_trees(); ++tree_idx) {
+            fails += check_view(flat_trees[tree_idx], store.tree(tree_idx), "mapped tree " + std::to_string(tree_idx));
+        }
+    }
+    std::remove(path.c_str());
+
+    // malformed stores
+    std::vector<std::pair<std::string, std::string>> bad_stores{
+        {"not a store", std::string(64, 'x')},
+        {"truncated", data.substr(0, data.size() - 8)},
+        {"wrong byte order", data.substr(0, 8) + std::string("\x01\x02\x03\x04", 4) + data.substr(12)},
+    };
+    for (auto & bad : bad_stores) {
+        std::vector<std::uint64_t> bad_buffer = aligned_copy(bad.second);
+        try {
+            platypus::TreeStore store(reinterpret_cast<const char *>(bad_buffer.data()), bad.second.size());
+            fails += platypus::testing::fail_test(__FILE__, __LINE__, "", "", bad.first, ": not detected");
+        } catch (const platypus::TreeStoreError &) {
+        }
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,72 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <platypus/model/flattree.hpp>
+#include <platypus/model/treetraversal.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+int main() {
+    int fails = 0;
+    BasicTree tree;
+    build_tree(tree, STANDARD_TEST_TREE_STRING);
+
+    std::vector<std::string> visits;
+    platypus::for_each_postorder(tree, [&visits](BasicTree::node_type * nd) { visits.push_back(nd->value()); });
+    fails += platypus::testing::compare_equal(STANDARD_TEST_TREE_POSTORDER, visits, __FILE__, __LINE__, "for_each_postorder()");
+
+    visits.clear();
+    platypus::for_each_preorder(tree, [&visits](BasicTree::node_type * nd) { visits.push_back(nd->value()); });
+    fails += platypus::testing::compare_equal(STANDARD_TEST_TREE_PREORDER, visits, __FILE__, __LINE__, "for_each_preorder()");
+
+    // reverse preorder: every node after all of its descendants
+    std::vector<std::string> reverse_preorder(STANDARD_TEST_TREE_PREORDER.rbegin(), STANDARD_TEST_TREE_PREORDER.rend());
+    visits.clear();
+    platypus::for_each_child_before_parent(tree, [&visits](BasicTree::node_type * nd) { visits.push_back(nd->value()); });
+    fails += platypus::testing::compare_equal(reverse_preorder, visits, __FILE__, __LINE__, "for_each_child_before_parent()");
+
+    platypus::PreorderNodeSequence<BasicTree> sequence(tree);
+    fails += platypus::testing::compare_equal(true, sequence.is_current(tree), __FILE__, __LINE__, "sequence is current");
+    fails += platypus::testing::compare_equal(STANDARD_TEST_TREE_PREORDER.size(), sequence.size(), __FILE__, __LINE__, "sequence size");
+    auto nd = tree.create_leaf_node();
+    nd->value() = "q";
+    tree.head_node()->add_child(nd);
+    tree.mark_structure_modified();
+    fails += platypus::testing::compare_equal(false, sequence.is_current(tree), __FILE__, __LINE__, "sequence is out of date");
+    sequence.update(tree);
+    visits.clear();
+    sequence.for_each_child_before_parent([&visits](BasicTree::node_type * nd) { visits.push_back(nd->value()); });
+    fails += platypus::testing::compare_equal(std::string("q"), visits.front(), __FILE__, __LINE__, "updated sequence");
+    fails += platypus::testing::compare_equal(std::string("a"), visits.back(), __FILE__, __LINE__, "updated sequence");
+
+    // the visitor may unlink visited nodes
+    unsigned long num_visited = 0;
+    platypus::for_each_postorder(tree, [&num_visited](BasicTree::node_type * nd) {
+        ++num_visited;
+        if (nd->parent_node() != nullptr && nd->is_leaf()) {
+            nd->parent_node()->remove_child(nd);
+        }
+    });
+    fails += platypus::testing::compare_equal(16UL, num_visited, __FILE__, __LINE__, "visits while unlinking leaves");
+
+    BasicTree standard;
+    build_tree(standard, STANDARD_TEST_TREE_STRING);
+    platypus::FlatTree<> flat(standard, [](const std::string & v) { return v; }, {});
+    visits.clear();
+    platypus::for_each_postorder(flat, [&](platypus::FlatTree<>::index_type nd) { visits.push_back(flat.label(nd)); });
+    fails += platypus::testing::compare_equal(STANDARD_TEST_TREE_POSTORDER, visits, __FILE__, __LINE__, "FlatTree postorder");
+    visits.clear();
+    platypus::for_each_preorder(flat, [&](platypus::FlatTree<>::index_type nd) { visits.push_back(flat.label(nd)); });
+    fails += platypus::testing::compare_equal(STANDARD_TEST_TREE_PREORDER, visits, __FILE__, __LINE__, "FlatTree preorder");
+    visits.clear();
+    platypus::for_each_child_before_parent(flat, [&](platypus::FlatTree<>::index_type nd) { visits.push_back(flat.label(nd)); });
+    fails += platypus::testing::compare_equal(reverse_preorder, visits, __FILE__, __LINE__, "FlatTree reverse preorder");
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,222 @@
+#include <sstream>
+#include <string>
+#include <vector>
+#include <platypus/model/treedistance.hpp>
+#include <platypus/model/standardinterface.hpp>
+#include <platypus/parse/newick.hpp>
+#include "platypus_testing.hpp"
+
+using namespace platypus::test;
+
+typedef TaxonTree::node_type NodeType;
+
+// random tree on a random subset of at least ``num_taxa - 2`` of taxa t0,
+// ..., t{num_taxa-1}, joining two (or, if ``with_polytomies``, sometimes
+// three or more) subtrees at a time
+std::string random_tree_string(platypus::numeric::RandomNumberGenerator & rng, int num_taxa, bool with_polytomies) {
+    std::vector<std::string> labels;
+    for (int i = 0; i < num_taxa; ++i) {
+        if (i >= 2 && rng.uniform_pos_int(7) == 0 && labels.size() + 2 < static_cast<std::size_t>(num_taxa)) {
+            continue;
+        }
+        labels.push_back("t" + std::to_string(i));
+    }
+    return platypus::test::random_tree_string(rng, labels, false, with_polytomies) + "\n";
+}
+
+// leaves by taxon, with their depths
+struct NaiveTree {
+    NaiveTree(const TaxonTree & tree, std::size_t num_taxa)
+        : leaves(num_taxa, nullptr) {
+        for (auto ndi = tree.leaf_begin(); ndi != tree.leaf_end(); ++ndi) {
+            this->leaves[ndi->get_taxon_index()] = ndi.node();
+        }
+    }
+    static unsigned long depth(const NodeType * nd) {
+        unsigned long d = 0;
+        for (; nd->parent_node() != nullptr; nd = nd->parent_node()) {
+            ++d;
+        }
+        return d;
+    }
+    // depth of the most recent common ancestor and number of edges between two leaves
+    std::pair<unsigned long, unsigned long> lca(std::size_t i, std::size_t j) const {
+        const NodeType * a = this->leaves[i];
+        const NodeType * b = this->leaves[j];
+        unsigned long da = depth(a);
+        unsigned long db = depth(b);
+        unsigned long path = 0;
+        while (a != b) {
+            if (da >= db) {
+                a = a->parent_node();
+                --da;
+            } else {
+                b = b->parent_node();
+                --db;
+            }
+            ++path;
+        }
+        return std::make_pair(da, path);
+    }
+    // 0: unresolved; otherwise 1 + the index of the taxon separated from
+    // the other two (rooted triplet), or of the taxon paired with the first (quartet)
+    int triplet(std::size_t a, std::size_t b, std::size_t c) const {
+        unsigned long ab = this->lca(a, b).first;
+        unsigned long ac = this->lca(a, c).first;
+        unsigned long bc = this->lca(b, c).first;
+        if (ab > ac && ab > bc) {
+            return 3;
+        } else if (ac > ab && ac > bc) {
+            return 2;
+        } else if (bc > ab && bc > ac) {
+            return 1;
+        }
+        return 0;
+    }
+    int quartet(std::size_t a, std::size_t b, std::size_t c, std::size_t d) const {
+        unsigned long ab_cd = this->lca(a, b).second + this->lca(c, d).second;
+        unsigned long ac_bd = this->lca(a, c).second + this->lca(b, d).second;
+        unsigned long ad_bc = this->lca(a, d).second + this->lca(b, c).second;
+        if (ab_cd < ac_bd && ab_cd < ad_bc) {
+            return 2;
+        } else if (ac_bd < ab_cd && ac_bd < ad_bc) {
+            return 3;
+        } else if (ad_bc < ab_cd && ad_bc < ac_bd) {
+            return 4;
+        }
+        return 0;
+    }
+    std::vector<const NodeType *> leaves;
+};
+
+// (distance, shared resolved) by enumerating the triplets or quartets of shared taxa
+std::pair<unsigned long, unsigned long> naive_distance(const NaiveTree & a, const NaiveTree & b, bool with_quartets) {
+    std::vector<std::size_t> taxa;
+    for (std::size_t t = 0; t < a.leaves.size(); ++t) {
+        if (a.leaves[t] != nullptr && b.leaves[t] != nullptr) {
+            taxa.push_back(t);
+        }
+    }
+    unsigned long distance = 0;
+    unsigned long shared = 0;
+    std::size_t n = taxa.size();
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = i + 1; j < n; ++j) {
+            for (std::size_t k = j + 1; k < n; ++k) {
+                if (!with_quartets) {
+                    int ra = a.triplet(taxa[i], taxa[j], taxa[k]);
+                    int rb = b.triplet(taxa[i], taxa[j], taxa[k]);
+                    distance += ra != rb ? 1 : 0;
+                    shared += ra == rb && ra != 0 ? 1 : 0;
+                    continue;
+                }
+                for (std::size_t l = k + 1; l < n; ++l) {
+                    int ra = a.quartet(taxa[i], taxa[j], taxa[k], taxa[l]);
+                    int rb = b.quartet(taxa[i], taxa[j], taxa[k], taxa[l]);
+                    distance += ra != rb ? 1 : 0;
+                    shared += ra == rb && ra != 0 ? 1 : 0;
+                }
+            }
+        }
+    }
+    return std::make_pair(distance, shared);
+}
+
+int main() {
+    int fails = 0;
+
+    {
+        platypus::TaxonNamespace taxa;
+        std::vector<TaxonTree> trees = read_trees(
+                "((a,b),(c,(d,e)));"
+                "((a,b),((c,d),e));"
+                "(a,b,c,d,e);", taxa);
+        platypus::TripletDistances triplets;
+        triplets.assign(trees.begin(), trees.end(), taxa);
+        // only triplet cde differs
+        fails += platypus::testing::compare_equal(1UL, static_cast<unsigned long>(triplets.get_distance(0, 1)), __FILE__, __LINE__, "triplets");
+        fails += platypus::testing::compare_equal(9UL, static_cast<unsigned long>(triplets.get_num_shared_resolved(0, 1)), __FILE__, __LINE__, "shared triplets");
+        fails += platypus::testing::compare_equal(10UL, static_cast<unsigned long>(triplets.get_distance(0, 2)), __FILE__, __LINE__, "triplets, star tree");
+        platypus::QuartetDistances quartets;
+        quartets.assign(trees.begin(), trees.end(), taxa);
+        // quartets acde and bcde differ
+        fails += platypus::testing::compare_equal(2UL, static_cast<unsigned long>(quartets.get_distance(0, 1)), __FILE__, __LINE__, "quartets");
+        fails += platypus::testing::compare_equal(5UL, static_cast<unsigned long>(quartets.get_distance(1, 2)), __FILE__, __LINE__, "quartets, star tree");
+
+        platypus::DataTable table;
+        quartets.export_table(table);
+        fails += platypus::testing::compare_equal(3UL, table.num_rows(), __FILE__, __LINE__, "table rows");
+        fails += platypus::testing::compare_equal(4UL, table.num_columns(), __FILE__, __LINE__, "table columns");
+    }
+
+    // identical trees with polytomies
+    {
+        platypus::TaxonNamespace taxa;
+        std::vector<TaxonTree> trees = read_trees(
+                "(a,b,c,d,e);"
+                "(a,b,c,d,e);"
+                "((a,b),c,d,e);"
+                "((a,b),c,d,e);"
+                "((a,b,c),(d,e,f),g,h);"
+                "((a,b,c),(d,e,f),g,h);", taxa);
+        platypus::TripletDistances triplets;
+        triplets.assign(trees.begin(), trees.end(), taxa);
+        platypus::QuartetDistances quartets;
+        quartets.assign(trees.begin(), trees.end(), taxa);
+        for (std::size_t i = 0; i < trees.size(); i += 2) {
+            fails += platypus::testing::compare_equal(0UL, static_cast<unsigned long>(triplets.get_distance(i, i + 1)), __FILE__, __LINE__, "triplets, identical trees ", i);
+            fails += platypus::testing::compare_equal(0UL, static_cast<unsigned long>(quartets.get_distance(i, i + 1)), __FILE__, __LINE__, "quartets, identical trees ", i);
+        }
+        // quartets abcd, abce and abde differ, acde and bcde are unresolved in both
+        fails += platypus::testing::compare_equal(3UL, static_cast<unsigned long>(quartets.get_distance(0, 2)), __FILE__, __LINE__, "quartets, star tree and polytomy");
+        fails += platypus::testing::compare_equal(0UL, static_cast<unsigned long>(quartets.get_num_shared_resolved(0, 2)), __FILE__, __LINE__, "shared quartets, star tree and polytomy");
+    }
+
+    // against enumeration, including polytomies and trees on different subsets of taxa
+    platypus::numeric::RandomNumberGenerator rng(41);
+    for (bool with_polytomies : {false, true}) {
+        for (int num_taxa : {4, 7, 13}) {
+            std::string src;
+            for (int i = 0; i < 6; ++i) {
+                src += random_tree_string(rng, num_taxa, with_polytomies);
+            }
+            // and a tree identical to another
+            src += src.substr(0, src.find('\n') + 1);
+            platypus::TaxonNamespace taxa;
+            std::vector<TaxonTree> trees = read_trees(src, taxa);
+            std::vector<NaiveTree> naive_trees;
+            for (auto & tree : trees) {
+                naive_trees.emplace_back(tree, taxa.size());
+            }
+            for (bool with_quartets : {false, true}) {
+                for (unsigned int num_threads : {1U, 3U}) {
+                    platypus::TripletDistances triplets;
+                    platypus::QuartetDistances quartets;
+                    platypus::TopologyDistances & distances = with_quartets
+                        ? static_cast<platypus::TopologyDistances &>(quartets)
+                        : static_cast<platypus::TopologyDistances &>(triplets);
+                    distances.assign(trees.begin(), trees.end(), taxa, num_threads);
+                    for (std::size_t i = 0; i < trees.size(); ++i) {
+                        for (std::size_t j = i + 1; j < trees.size(); ++j) {
+                            auto expected = naive_distance(naive_trees[i], naive_trees[j], with_quartets);
+                            fails += platypus::testing::compare_equal(expected.first,
+                                    static_cast<unsigned long>(distances.get_distance(i, j)),
+                                    __FILE__, __LINE__, with_quartets ? "quartet" : "triplet", " distance, ",
+                                    num_taxa, " taxa, polytomies: ", with_polytomies, ", trees ", i, ", ", j);
+                            fails += platypus::testing::compare_equal(expected.second,
+                                    static_cast<unsigned long>(distances.get_num_shared_resolved(i, j)),
+                                    __FILE__, __LINE__, with_quartets ? "quartet" : "triplet", " shared, ",
+                                    num_taxa, " taxa, polytomies: ", with_polytomies, ", trees ", i, ", ", j);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (fails > 0) {
+        return EXIT_FAILURE;
+    } else {
+        return EXIT_SUCCESS;
+    }
+}